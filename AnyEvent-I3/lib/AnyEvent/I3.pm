@@ -17,11 +17,11 @@ AnyEvent::I3 - communicate with the i3 window manager
 
 =cut
 
-our $VERSION = '0.18';
+our $VERSION = '0.19';
 
 =head1 VERSION
 
-Version 0.18
+Version 0.19
 
 =head1 SYNOPSIS
 
@@ -102,12 +102,21 @@ use constant TYPE_GET_CONFIG => 9;
 use constant TYPE_SEND_TICK => 10;
 use constant TYPE_SYNC => 11;
 use constant TYPE_GET_BINDING_STATE => 12;
+use constant TYPE_GET_STATS => 13;
+use constant TYPE_SET_ENCODING => 14;
+use constant TYPE_SET_COMMAND_TIMING => 15;
+use constant TYPE_GET_MEMORY => 16;
+use constant TYPE_X_SYNC => 17;
+use constant TYPE_SET_BACKPRESSURE => 18;
+use constant TYPE_SET_PRIORITY => 19;
 
 our %EXPORT_TAGS = ( 'all' => [
     qw(i3 TYPE_RUN_COMMAND TYPE_COMMAND TYPE_GET_WORKSPACES TYPE_SUBSCRIBE TYPE_GET_OUTPUTS
        TYPE_GET_TREE TYPE_GET_MARKS TYPE_GET_BAR_CONFIG TYPE_GET_VERSION
        TYPE_GET_BINDING_MODES TYPE_GET_CONFIG TYPE_SEND_TICK TYPE_SYNC
-       TYPE_GET_BINDING_STATE)
+       TYPE_GET_BINDING_STATE TYPE_GET_STATS TYPE_SET_ENCODING
+       TYPE_SET_COMMAND_TIMING TYPE_GET_MEMORY TYPE_X_SYNC
+       TYPE_SET_BACKPRESSURE TYPE_SET_PRIORITY)
 ] );
 
 our @EXPORT_OK = ( @{ $EXPORT_TAGS{all} } );
@@ -121,10 +130,16 @@ my %events = (
     output => ($event_mask | 1),
     mode => ($event_mask | 2),
     window => ($event_mask | 3),
+    window_uncoalesced => ($event_mask | 3),
+    window_compact => ($event_mask | 3),
     barconfig_update => ($event_mask | 4),
     binding => ($event_mask | 5),
+    binding_compact => ($event_mask | 5),
     shutdown => ($event_mask | 6),
     tick => ($event_mask | 7),
+    tree => ($event_mask | 8),
+    stats => ($event_mask | 9),
+    lagged => ($event_mask | 10),
     _error => 0xFFFFFFFF,
 );
 
@@ -230,11 +245,10 @@ sub connect {
 
                 my $cb = $self->{callbacks};
 
-                # Trigger all one-time callbacks with undef
-                for my $type (keys %{$cb}) {
-                    next if ($type & $event_mask) == $event_mask;
-                    $cb->{$type}->();
-                    delete $cb->{$type};
+                # Trigger the callbacks of all pending replies with undef
+                my $replies = delete $self->{replies};
+                for my $type (keys %{$replies}) {
+                    $_->() for @{$replies->{$type}};
                 }
 
                 # Trigger _error callback, if set
@@ -270,16 +284,19 @@ sub _data_available {
 sub _handle_i3_message {
     my ($self, $type, $payload) = @_;
 
-    return unless defined($self->{callbacks}->{$type});
+    if (($type & $event_mask) == $event_mask) {
+        return unless defined($self->{callbacks}->{$type});
+        $self->{callbacks}->{$type}->(decode_json $payload);
+        return;
+    }
 
-    my $cb = $self->{callbacks}->{$type};
+    # i3 replies in the order of the requests, so the reply belongs to the
+    # oldest pending request of its type (when the connection is lost, the
+    # callbacks of all pending requests get triggered).
+    my $pending = $self->{replies}->{$type};
+    return unless defined($pending) && @{$pending} > 0;
+    my $cb = shift @{$pending};
     $cb->(decode_json $payload);
-
-    return if ($type & $event_mask) == $event_mask;
-
-    # If this was a one-time callback, we delete it
-    # (when connection is lost, all one-time callbacks get triggered)
-    delete $self->{callbacks}->{$type};
 }
 
 =head2 $i3->subscribe(\%callbacks)
@@ -309,17 +326,48 @@ use it to print an appropriate message and exit cleanly or to try to reconnect.
 
     $i3->subscribe(\%callbacks)->recv;
 
+Instead of a callback, the value can be a hashref with the callback in C<cb>
+and the filters i3 (>= 4.21) applies before sending an event in C<filters>
+(see "Subscribing to events" in docs/ipc), so that only the matching events
+are sent:
+
+    $i3->subscribe({
+        window => {
+            cb => sub { say "Firefox got focus" },
+            filters => [ { change => [ 'focus' ], class => '^Firefox$' } ],
+        },
+    })->recv;
+
+The compact event formats are selected with their names, e.g.
+C<window_compact> or C<binding_compact>. The optional second argument is a
+hashref of options; C<priority> selects the priority class of the connection
+(see SET_PRIORITY in docs/ipc):
+
+    $i3->subscribe({ window => sub { ... } }, { priority => 'interactive' })->recv;
+
 =cut
 sub subscribe {
-    my ($self, $callbacks) = @_;
+    my ($self, $callbacks, $options) = @_;
 
-    # Register callbacks for each message type
+    my @subscriptions;
     for my $key (keys %{$callbacks}) {
+        my $value = $callbacks->{$key};
+        my $cb = $value;
+        if (ref($value) eq 'HASH') {
+            $cb = $value->{cb};
+            push @subscriptions, map { { %{$_}, event => $key } } @{$value->{filters} // []};
+        }
+        push @subscriptions, $key unless ref($value) eq 'HASH' && $value->{filters};
+
+        # Register callbacks for each message type
         my $type = $events{$key};
-        $self->{callbacks}->{$type} = $callbacks->{$key};
+        $self->{callbacks}->{$type} = $cb;
+    }
+    if (defined($options) && defined($options->{priority})) {
+        push @subscriptions, { priority => $options->{priority} };
     }
 
-    $self->message(TYPE_SUBSCRIBE, [ keys %{$callbacks} ])
+    $self->message(TYPE_SUBSCRIBE, \@subscriptions)
 }
 
 =head2 $i3->message($type, $content)
@@ -333,6 +381,13 @@ scalar), if specified.
         say "Configuration successfully reloaded";
     }
 
+The message is sent right away, without waiting for the replies to earlier
+messages, so several requests can be pipelined and their condvars received
+afterwards:
+
+    my @cvs = map { $i3->message(TYPE_RUN_COMMAND, "workspace $_") } 1 .. 10;
+    my @replies = map { $_->recv } @cvs;
+
 =cut
 sub message {
     my ($self, $type, $content) = @_;
@@ -355,14 +410,41 @@ sub message {
 
     my $cv = AnyEvent->condvar;
 
-    # We don’t preserve the old callback as it makes no sense to
-    # have a callback on message reply types (only on events)
-    $self->{callbacks}->{$type} =
-        sub {
-            my ($reply) = @_;
-            $cv->send($reply);
-            undef $self->{callbacks}->{$type};
-        };
+    push @{$self->{replies}->{$type}}, sub {
+        my ($reply) = @_;
+        $cv->send($reply);
+    };
+
+    $cv
+}
+
+=head2 $i3->pipeline(@requests)
+
+Sends all requests (arrayrefs with the message type and content, like the
+arguments of C<message>) at once and returns an C<AnyEvent::CondVar> which
+is triggered with an arrayref of the replies, in the order of the requests.
+
+    my $replies = $i3->pipeline(
+        [ TYPE_GET_WORKSPACES ],
+        [ TYPE_GET_OUTPUTS ],
+        [ TYPE_RUN_COMMAND, 'focus left' ],
+    )->recv;
+
+=cut
+sub pipeline {
+    my ($self, @requests) = @_;
+
+    my $cv = AnyEvent->condvar;
+    my @replies;
+    $cv->begin(sub { $cv->send(\@replies) });
+    for my $i (0 .. $#requests) {
+        $cv->begin;
+        $self->message(@{$requests[$i]})->cb(sub {
+            $replies[$i] = $_[0]->recv;
+            $cv->end;
+        });
+    }
+    $cv->end;
 
     $cv
 }
@@ -422,13 +504,18 @@ Gets the layout tree from i3 (>= v4.0).
     my $tree = i3->get_tree->recv;
     say Dumper($tree);
 
+Optionally, a hash reference restricting the reply can be passed (i3 >= 4.21),
+see the GET_TREE documentation in docs/ipc:
+
+    my $leaves = i3->get_tree({ root => $ws_id, fields => [ 'id', 'name' ] })->recv;
+
 =cut
 sub get_tree {
-    my ($self) = @_;
+    my ($self, $request) = @_;
 
     $self->_ensure_connection;
 
-    $self->message(TYPE_GET_TREE)
+    $self->message(TYPE_GET_TREE, $request)
 }
 
 =head2 get_marks
@@ -0,0 +1,271 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * config.c: Benchmarks loading and reloading large configurations. Generates
+ *           a configuration with the given number of bindings, modes and
+ *           for_window rules (or uses the given one), reloads it the given
+ *           number of times and reports how long parse_file(),
+ *           check_for_duplicate_bindings(), reorder_bindings(),
+ *           translate_keysyms() and the whole reload command took (see
+ *           stats.h). Keys are grabbed and fonts loaded for real, so it needs
+ *           an X server without a window manager:
+ *
+ *           Xvfb :99 &
+ *           DISPLAY=:99 bench.config [--bindings <n>] [<config>]
+ *
+ */
+#include "all.h"
+
+#include <getopt.h>
+#include <time.h>
+
+/* Defined in main_stubs.c, used by libi3's drawing code */
+extern xcb_visualtype_t *visual_type;
+
+/* The keys of the generated bindsym bindings */
+static const char *keys[] = {
+    "a", "b", "c", "d", "e", "f", "g", "h", "i", "j", "k", "l", "m",
+    "n", "o", "p", "q", "r", "s", "t", "u", "v", "w", "x", "y", "z",
+    "0", "1", "2", "3", "4", "5", "6", "7", "8", "9",
+    "F1", "F2", "F3", "F4", "F5", "F6", "F7", "F8", "F9", "F10", "F11", "F12"};
+#define NUM_KEYS (sizeof(keys) / sizeof(keys[0]))
+
+/* Every combination of these is used, see write_binding() */
+static const char *modifiers[] = {"Shift", "Control", "Mod1", "Mod4"};
+#define NUM_MODIFIER_COMBINATIONS (1 << (sizeof(modifiers) / sizeof(modifiers[0])))
+
+/* The keycodes of the generated bindcode bindings */
+#define MIN_KEYCODE 8
+#define NUM_KEYCODES (256 - MIN_KEYCODE)
+
+/* Without --release, there are this many distinct bindings per mode */
+#define DISTINCT_BINDINGS ((int)((NUM_KEYS + NUM_KEYCODES) * NUM_MODIFIER_COMBINATIONS))
+
+static const stats_timing_t steps[] = {
+    STATS_PARSE_FILE,
+    STATS_CHECK_DUPLICATE_BINDINGS,
+    STATS_REORDER_BINDINGS,
+    STATS_TRANSLATE_KEYSYMS,
+    STATS_RELOAD,
+};
+#define NUM_STEPS (sizeof(steps) / sizeof(steps[0]))
+
+static const char *step_names[] = {
+    "parse_file",
+    "check_for_duplicate_bindings",
+    "reorder_bindings",
+    "translate_keysyms",
+    "reload",
+};
+
+static int compare_uint64(const void *a, const void *b) {
+    const uint64_t x = *(const uint64_t *)a;
+    const uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Writes the nth distinct binding of a mode: first the bindsym bindings for
+ * each key with every combination of modifiers, then the bindcode bindings,
+ * then all of them again with --release.
+ *
+ */
+static void write_binding(FILE *file, int n, const char *command) {
+    const bool release = (n >= DISTINCT_BINDINGS);
+    n %= DISTINCT_BINDINGS;
+    const int combination = n % NUM_MODIFIER_COMBINATIONS;
+    const int key = n / NUM_MODIFIER_COMBINATIONS;
+
+    fprintf(file, "    %s %s", (key < (int)NUM_KEYS ? "bindsym" : "bindcode"), (release ? "--release " : ""));
+    for (int i = 0; i < (int)(sizeof(modifiers) / sizeof(modifiers[0])); i++) {
+        if (combination & (1 << i)) {
+            fprintf(file, "%s+", modifiers[i]);
+        }
+    }
+    if (key < (int)NUM_KEYS) {
+        fprintf(file, "%s", keys[key]);
+    } else {
+        fprintf(file, "%d", MIN_KEYCODE + key - (int)NUM_KEYS);
+    }
+    fprintf(file, " %s\n", command);
+}
+
+static void write_bindings(FILE *file, int count, bool in_mode) {
+    for (int i = 0; i < count; i++) {
+        char *command;
+        switch (i % 4) {
+            case 0:
+                sasprintf(&command, "workspace number %d", 1 + i % 10);
+                break;
+            case 1:
+                command = sstrdup("focus left");
+                break;
+            case 2:
+                command = sstrdup(in_mode ? "mode default" : "layout toggle split");
+                break;
+            default:
+                command = sstrdup("exec --no-startup-id true");
+                break;
+        }
+        write_binding(file, i, command);
+        free(command);
+    }
+}
+
+/*
+ * Generates a configuration with the given number of bindings in the default
+ * mode, modes (with mode_bindings bindings each) and for_window rules.
+ *
+ */
+static void generate_config(const char *path, int num_bindings, int num_modes, int mode_bindings, int num_rules) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        err(EXIT_FAILURE, "Cannot create %s", path);
+    }
+    fprintf(file, "# i3 config file (v4)\n");
+    fprintf(file, "font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1\n");
+    write_bindings(file, num_bindings, false);
+    for (int mode = 0; mode < num_modes; mode++) {
+        fprintf(file, "mode \"mode_%d\" {\n", mode);
+        write_bindings(file, mode_bindings, true);
+        fprintf(file, "}\n");
+    }
+    for (int rule = 0; rule < num_rules; rule++) {
+        fprintf(file, "for_window [class=\"^app_%d$\" title=\"document %d\"] floating enable, border pixel %d\n",
+                rule, rule, 1 + rule % 3);
+    }
+    fclose(file);
+}
+
+/*
+ * Sets up the globals of src/main.c which loading the configuration needs.
+ *
+ */
+static void init_x(void) {
+    conn = xcb_connect(NULL, &conn_screen);
+    if (xcb_connection_has_error(conn)) {
+        errx(EXIT_FAILURE, "Cannot open display");
+    }
+    root_screen = xcb_aux_get_screen(conn, conn_screen);
+    root = root_screen->root;
+    root_depth = root_screen->root_depth;
+    colormap = root_screen->default_colormap;
+    visual_type = get_visualtype(root_screen);
+    init_dpi();
+
+    keysyms = xcb_key_symbols_alloc(conn);
+    if (!load_keymap()) {
+        errx(EXIT_FAILURE, "Could not load the keymap");
+    }
+}
+
+static void print_usage(const char *name) {
+    fprintf(stderr, "Usage: %s [--bindings <n>] [--modes <n>] [--mode-bindings <n>] [--rules <n>]\n", name);
+    fprintf(stderr, "       [--iterations <n>] [<config>]\n");
+    fprintf(stderr, "Reloads the given configuration (default: a generated one with 2000 bindings,\n");
+    fprintf(stderr, "50 modes with 50 bindings each and 1000 for_window rules) 10 times.\n");
+    fprintf(stderr, "Needs an X server without a window manager, e.g. Xvfb.\n");
+}
+
+int main(int argc, char *argv[]) {
+    static struct option long_options[] = {
+        {"bindings", required_argument, 0, 'b'},
+        {"modes", required_argument, 0, 'm'},
+        {"mode-bindings", required_argument, 0, 'k'},
+        {"rules", required_argument, 0, 'r'},
+        {"iterations", required_argument, 0, 'i'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}};
+
+    int num_bindings = 2000;
+    int num_modes = 50;
+    int mode_bindings = 50;
+    int num_rules = 1000;
+    int iterations = 10;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "b:m:k:r:i:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'b':
+                num_bindings = atoi(optarg);
+                break;
+            case 'm':
+                num_modes = atoi(optarg);
+                break;
+            case 'k':
+                mode_bindings = atoi(optarg);
+                break;
+            case 'r':
+                num_rules = atoi(optarg);
+                break;
+            case 'i':
+                iterations = atoi(optarg);
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (argc - optind > 1 || iterations < 1 || num_bindings < 0 || num_modes < 0 || mode_bindings < 0 || num_rules < 0) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    /* Duplicates would start i3-nagbar. */
+    if (num_bindings > 2 * DISTINCT_BINDINGS || mode_bindings > 2 * DISTINCT_BINDINGS) {
+        errx(EXIT_FAILURE, "At most %d bindings per mode can be generated", 2 * DISTINCT_BINDINGS);
+    }
+
+    char *path;
+    const bool generated = (optind == argc);
+    if (generated) {
+        sasprintf(&path, "/tmp/i3-bench-config-%d", getpid());
+        generate_config(path, num_bindings, num_modes, mode_bindings, num_rules);
+        printf("%d bindings, %d modes with %d bindings, %d for_window rules\n",
+               num_bindings, num_modes, mode_bindings, num_rules);
+    } else {
+        path = sstrdup(argv[optind]);
+    }
+
+    main_loop = ev_default_loop(0);
+    init_x();
+    xcb_get_geometry_reply_t geometry = {.width = root_screen->width_in_pixels, .height = root_screen->height_in_pixels};
+    tree_init(&geometry);
+
+    /* Like i3 does on startup, the reloads afterwards use the same path. */
+    load_configuration(path, C_LOAD);
+    translate_keysyms();
+    grab_all_keys(conn);
+    xcb_flush(conn);
+
+    uint64_t *durations[NUM_STEPS];
+    for (size_t step = 0; step < NUM_STEPS; step++) {
+        durations[step] = smalloc(sizeof(uint64_t) * iterations);
+    }
+    for (int i = 0; i < iterations; i++) {
+        CommandResult *result = parse_command("reload", NULL, NULL);
+        command_result_free(result);
+        xcb_aux_sync(conn);
+        for (size_t step = 0; step < NUM_STEPS; step++) {
+            durations[step][i] = stats_last_duration(steps[step]);
+        }
+    }
+
+    for (size_t step = 0; step < NUM_STEPS; step++) {
+        qsort(durations[step], iterations, sizeof(uint64_t), compare_uint64);
+        printf("%-30s median %10.3f ms  max %10.3f ms\n", step_names[step],
+               durations[step][iterations / 2] / 1e3, durations[step][iterations - 1] / 1e3);
+        free(durations[step]);
+    }
+
+    if (generated) {
+        unlink(path);
+    }
+    free(path);
+    xcb_disconnect(conn);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,471 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * latency.c: Measures the input-to-render latency of a running i3: presses
+ *            the keys bound in bench/latency.config using XTEST and waits
+ *            until the resulting focus change, ConfigureNotify or WM_STATE
+ *            change arrives at its own windows. This covers the whole path
+ *            from handle_key_press() over the command to tree_render() and
+ *            x_push_changes(). Also measures how long it takes until a newly
+ *            mapped window is managed (MapNotify) and until clicking a tab of
+ *            a tabbed container focuses its window. Run it the way the
+ *            testcases run i3:
+ *
+ *            Xvfb :99 &
+ *            DISPLAY=:99 i3 -c bench/latency.config &
+ *            DISPLAY=:99 bench.latency [--samples <n>] [<windows>...]
+ *
+ */
+#include "libi3.h"
+
+#include <err.h>
+#include <getopt.h>
+#include <i3/ipc.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <X11/keysym.h>
+#include <xcb/xcb.h>
+#include <xcb/xcb_aux.h>
+#include <xcb/xcb_keysyms.h>
+#include <xcb/xtest.h>
+
+/*
+ * Having verboselog() and errorlog() is necessary when using libi3.
+ *
+ */
+void verboselog(char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf(stdout, fmt, args);
+    va_end(args);
+}
+
+void errorlog(char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+/* Gives up if i3 does not react within this time */
+#define EVENT_TIMEOUT_MS 10000
+
+#define WORKSPACE "bench-latency"
+
+xcb_connection_t *conn;
+static xcb_screen_t *screen;
+static xcb_atom_t wm_state;
+
+struct bench_window {
+    xcb_window_t id;
+    /* The generation in which the window was last mapped, configured or had
+     * its WM_STATE changed, so that every window is counted once */
+    int mapped;
+    int configured;
+    int state_changed;
+};
+
+static struct bench_window *windows;
+static int num_windows;
+
+/* Counts the windows which reacted since the last call to reset() */
+static int generation;
+static int mapped_windows;
+static int configured_windows;
+static int state_changed_windows;
+static int focus_changes;
+
+static xcb_window_t focused;
+
+/* When the last counted event was received */
+static double last_event;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void reset(void) {
+    generation++;
+    mapped_windows = 0;
+    configured_windows = 0;
+    state_changed_windows = 0;
+    focus_changes = 0;
+}
+
+static struct bench_window *window_by_id(xcb_window_t id) {
+    for (int i = 0; i < num_windows; i++) {
+        if (windows[i].id == id) {
+            return &windows[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Counts the window if it did not yet react in the current generation.
+ *
+ */
+static void count(int *seen, int *counter) {
+    if (*seen == generation) {
+        return;
+    }
+    *seen = generation;
+    (*counter)++;
+    last_event = now_us();
+}
+
+static void handle_event(xcb_generic_event_t *event) {
+    struct bench_window *window;
+
+    switch (event->response_type & 0x7F) {
+        case XCB_MAP_NOTIFY: {
+            xcb_map_notify_event_t *map = (xcb_map_notify_event_t *)event;
+            if ((window = window_by_id(map->window)) != NULL) {
+                count(&window->mapped, &mapped_windows);
+            }
+            break;
+        }
+        case XCB_CONFIGURE_NOTIFY: {
+            xcb_configure_notify_event_t *configure = (xcb_configure_notify_event_t *)event;
+            if ((window = window_by_id(configure->window)) != NULL) {
+                count(&window->configured, &configured_windows);
+            }
+            break;
+        }
+        case XCB_PROPERTY_NOTIFY: {
+            xcb_property_notify_event_t *property = (xcb_property_notify_event_t *)event;
+            if (property->atom == wm_state && (window = window_by_id(property->window)) != NULL) {
+                count(&window->state_changed, &state_changed_windows);
+            }
+            break;
+        }
+        case XCB_FOCUS_IN: {
+            xcb_focus_in_event_t *focus = (xcb_focus_in_event_t *)event;
+            /* The passive grab of the key binding generates focus events,
+             * too. */
+            if (focus->mode == XCB_NOTIFY_MODE_GRAB || focus->mode == XCB_NOTIFY_MODE_UNGRAB ||
+                focus->detail == XCB_NOTIFY_DETAIL_POINTER) {
+                break;
+            }
+            if (focus->event != focused && window_by_id(focus->event) != NULL) {
+                focused = focus->event;
+                focus_changes++;
+                last_event = now_us();
+            }
+            break;
+        }
+        case 0: {
+            xcb_generic_error_t *error = (xcb_generic_error_t *)event;
+            errx(EXIT_FAILURE, "X11 error %d (request %d.%d)", error->error_code, error->major_code, error->minor_code);
+        }
+    }
+}
+
+/*
+ * Handles all queued events or waits for new ones. Returns false if no event
+ * arrived within the timeout.
+ *
+ */
+static bool process_events(void) {
+    xcb_generic_event_t *event;
+    bool handled = false;
+    while ((event = xcb_poll_for_event(conn)) != NULL) {
+        handle_event(event);
+        free(event);
+        handled = true;
+    }
+    if (handled) {
+        return true;
+    }
+    if (xcb_connection_has_error(conn)) {
+        errx(EXIT_FAILURE, "The X11 connection broke");
+    }
+
+    struct pollfd pfd = {
+        .fd = xcb_get_file_descriptor(conn),
+        .events = POLLIN,
+    };
+    const int ready = poll(&pfd, 1, EVENT_TIMEOUT_MS);
+    if (ready == -1) {
+        err(EXIT_FAILURE, "poll()");
+    }
+    return (ready > 0);
+}
+
+/*
+ * Handles the events of all requests sent so far.
+ *
+ */
+static void drain_events(void) {
+    xcb_aux_sync(conn);
+    xcb_generic_event_t *event;
+    while ((event = xcb_poll_for_event(conn)) != NULL) {
+        handle_event(event);
+        free(event);
+    }
+}
+
+/*
+ * Waits until the counter reaches target and returns the µs between start and
+ * the event which reached it.
+ *
+ */
+static double wait_for(const int *counter, int target, double start, const char *what) {
+    while (*counter < target) {
+        if (!process_events()) {
+            errx(EXIT_FAILURE, "%s did not arrive within %d ms (%d of %d). Is i3 running with bench/latency.config?",
+                 what, EVENT_TIMEOUT_MS, *counter, target);
+        }
+    }
+    return last_event - start;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void print_percentiles(const char *name, int size, double *values, int num) {
+    qsort(values, num, sizeof(double), compare_doubles);
+    printf("%-10s %5d windows  p50 %9.1f us  p90 %9.1f us  p99 %9.1f us  max %9.1f us\n",
+           name, size,
+           values[num / 2],
+           values[num * 9 / 10],
+           values[num * 99 / 100],
+           values[num - 1]);
+    fflush(stdout);
+}
+
+static xcb_keycode_t keycode_for(xcb_key_symbols_t *symbols, xcb_keysym_t keysym, const char *name) {
+    xcb_keycode_t *codes = xcb_key_symbols_get_keycode(symbols, keysym);
+    if (codes == NULL || codes[0] == XCB_NO_SYMBOL) {
+        errx(EXIT_FAILURE, "There is no keycode for %s", name);
+    }
+    const xcb_keycode_t code = codes[0];
+    free(codes);
+    return code;
+}
+
+/*
+ * Injects a key press (and release) and returns when it was sent.
+ *
+ */
+static double press(xcb_keycode_t keycode) {
+    xcb_test_fake_input(conn, XCB_KEY_PRESS, keycode, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+    xcb_test_fake_input(conn, XCB_KEY_RELEASE, keycode, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+    const double start = now_us();
+    xcb_flush(conn);
+    return start;
+}
+
+/*
+ * Clicks the tab of the given window, assuming that all windows are tabs of
+ * the workspace (which fills the screen, there is no bar) in the order in
+ * which they were opened. Returns when the click was sent.
+ *
+ */
+static double click_tab(int index) {
+    const int tab_width = screen->width_in_pixels / num_windows;
+    const int16_t x = index * tab_width + tab_width / 2;
+    const int16_t y = 2;
+    xcb_test_fake_input(conn, XCB_MOTION_NOTIFY, false, XCB_CURRENT_TIME, screen->root, x, y, 0);
+    xcb_test_fake_input(conn, XCB_BUTTON_PRESS, XCB_BUTTON_INDEX_1, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+    xcb_test_fake_input(conn, XCB_BUTTON_RELEASE, XCB_BUTTON_INDEX_1, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+    const double start = now_us();
+    xcb_flush(conn);
+    return start;
+}
+
+/*
+ * Creates and maps windows until there are count of them and returns the
+ * latency of every map in latencies.
+ *
+ */
+static int open_windows(int count, double *latencies) {
+    static const uint32_t event_mask = XCB_EVENT_MASK_STRUCTURE_NOTIFY |
+                                       XCB_EVENT_MASK_FOCUS_CHANGE |
+                                       XCB_EVENT_MASK_PROPERTY_CHANGE;
+    const uint32_t values[] = {screen->white_pixel, event_mask};
+
+    int opened = 0;
+    windows = srealloc(windows, sizeof(struct bench_window) * count);
+    while (num_windows < count) {
+        struct bench_window *window = &windows[num_windows++];
+        window->id = xcb_generate_id(conn);
+        window->mapped = window->configured = window->state_changed = 0;
+        xcb_create_window(conn, XCB_COPY_FROM_PARENT, window->id, screen->root,
+                          0, 0, 100, 100, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                          XCB_COPY_FROM_PARENT, XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK, values);
+
+        reset();
+        xcb_map_window(conn, window->id);
+        const double start = now_us();
+        xcb_flush(conn);
+        latencies[opened++] = wait_for(&mapped_windows, 1, start, "MapNotify");
+    }
+    /* i3 focuses every new window, so wait until the focus settled. */
+    drain_events();
+    return opened;
+}
+
+static void run_command(int sockfd, const char *command) {
+    if (ipc_send_message(sockfd, strlen(command), I3_IPC_MESSAGE_TYPE_RUN_COMMAND, (const uint8_t *)command) == -1) {
+        err(EXIT_FAILURE, "IPC: write()");
+    }
+    uint32_t reply_type;
+    uint32_t reply_length;
+    uint8_t *reply;
+    if (ipc_recv_message(sockfd, &reply_type, &reply_length, &reply) != 0) {
+        errx(EXIT_FAILURE, "IPC: Could not read the reply");
+    }
+    free(reply);
+}
+
+static void print_usage(const char *name) {
+    fprintf(stderr, "Usage: %s [--samples <n>] [<windows>...]\n", name);
+    fprintf(stderr, "Measures the latency with the given numbers of windows (default: 2 10 50 100).\n");
+    fprintf(stderr, "Needs an i3 (in Xvfb) running with bench/latency.config.\n");
+}
+
+int main(int argc, char *argv[]) {
+    static struct option long_options[] = {
+        {"samples", required_argument, 0, 'n'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}};
+
+    int samples = 200;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n':
+                samples = atoi(optarg);
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    static const int default_sizes[] = {2, 10, 50, 100};
+    int num_sizes = argc - optind;
+    int *sizes = smalloc(sizeof(int) * (num_sizes > 0 ? num_sizes : 4));
+    if (num_sizes == 0) {
+        num_sizes = 4;
+        memcpy(sizes, default_sizes, sizeof(default_sizes));
+    } else {
+        for (int i = 0; i < num_sizes; i++) {
+            sizes[i] = atoi(argv[optind + i]);
+            /* Focus and layout changes need at least two windows. */
+            if (sizes[i] < 2 || (i > 0 && sizes[i] < sizes[i - 1])) {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    if (samples <= 0) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int screen_number;
+    conn = xcb_connect(NULL, &screen_number);
+    if (xcb_connection_has_error(conn)) {
+        errx(EXIT_FAILURE, "Cannot open display");
+    }
+    screen = xcb_aux_get_screen(conn, screen_number);
+    if (!xcb_get_extension_data(conn, &xcb_test_id)->present) {
+        errx(EXIT_FAILURE, "The X server does not support XTEST");
+    }
+
+    xcb_intern_atom_reply_t *atom = xcb_intern_atom_reply(conn, xcb_intern_atom(conn, 0, strlen("WM_STATE"), "WM_STATE"), NULL);
+    if (atom == NULL) {
+        errx(EXIT_FAILURE, "Cannot intern WM_STATE");
+    }
+    wm_state = atom->atom;
+    free(atom);
+
+    xcb_key_symbols_t *symbols = xcb_key_symbols_alloc(conn);
+    const xcb_keycode_t focus_key = keycode_for(symbols, XK_F1, "F1");
+    const xcb_keycode_t layout_key = keycode_for(symbols, XK_F2, "F2");
+    const xcb_keycode_t workspace_key = keycode_for(symbols, XK_F3, "F3");
+    xcb_key_symbols_free(symbols);
+
+    /* Start on an empty workspace and make sure that back_and_forth has a
+     * workspace to switch to. */
+    int sockfd = ipc_connect(NULL);
+    run_command(sockfd, "workspace " WORKSPACE "-other; workspace " WORKSPACE);
+
+    double *latencies = smalloc(sizeof(double) * (2 * samples > sizes[num_sizes - 1] ? 2 * samples : sizes[num_sizes - 1]));
+    for (int i = 0; i < num_sizes; i++) {
+        const int opened = open_windows(sizes[i], latencies);
+        if (opened > 0) {
+            print_percentiles("manage", sizes[i], latencies, opened);
+        }
+        run_command(sockfd, "layout splith");
+        drain_events();
+
+        for (int j = 0; j < samples; j++) {
+            reset();
+            latencies[j] = wait_for(&focus_changes, 1, press(focus_key), "The focus change");
+        }
+        print_percentiles("focus", sizes[i], latencies, samples);
+
+        for (int j = 0; j < samples; j++) {
+            reset();
+            latencies[j] = wait_for(&configured_windows, num_windows, press(layout_key), "ConfigureNotify");
+        }
+        print_percentiles("layout", sizes[i], latencies, samples);
+
+        /* The frames are unmapped and mapped on workspace switches, not the
+         * windows themselves, but their WM_STATE changes in the same push. */
+        for (int j = 0; j < 2 * samples; j++) {
+            reset();
+            latencies[j] = wait_for(&state_changed_windows, num_windows, press(workspace_key), "The WM_STATE change");
+        }
+        print_percentiles("workspace", sizes[i], latencies, 2 * samples);
+
+        /* Click the tab next to the focused one, so that every click changes
+         * the focus. */
+        run_command(sockfd, "layout tabbed");
+        drain_events();
+        for (int j = 0; j < samples; j++) {
+            int index = 0;
+            while (index < num_windows && windows[index].id != focused) {
+                index++;
+            }
+            reset();
+            latencies[j] = wait_for(&focus_changes, 1, click_tab((index + 1) % num_windows), "The focus change");
+        }
+        print_percentiles("click", sizes[i], latencies, samples);
+    }
+
+    for (int i = 0; i < num_windows; i++) {
+        xcb_destroy_window(conn, windows[i].id);
+    }
+    xcb_aux_sync(conn);
+    xcb_disconnect(conn);
+    close(sockfd);
+
+    free(latencies);
+    free(windows);
+    free(sizes);
+    return EXIT_SUCCESS;
+}
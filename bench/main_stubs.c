@@ -0,0 +1,47 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * main_stubs.c: The globals of src/main.c, which is not linked into the
+ *               benchmarks. The benchmarks which talk to an X server set up
+ *               the ones they need themselves.
+ *
+ */
+#include "all.h"
+
+struct rlimit original_rlimit_core;
+int listen_fds;
+char **start_argv;
+xcb_connection_t *conn;
+int conn_screen;
+SnDisplay *sndisplay;
+xcb_timestamp_t last_timestamp = XCB_CURRENT_TIME;
+xcb_screen_t *root_screen;
+xcb_window_t root;
+xcb_window_t wm_sn_selection_owner;
+xcb_atom_t wm_sn;
+uint8_t root_depth;
+xcb_visualtype_t *visual_type;
+xcb_colormap_t colormap;
+struct ev_loop *main_loop;
+xcb_key_symbols_t *keysyms;
+const int default_shmlog_size = 0;
+struct bindings_head *bindings;
+const char *current_binding_mode = NULL;
+struct autostarts_head autostarts = TAILQ_HEAD_INITIALIZER(autostarts);
+struct autostarts_always_head autostarts_always = TAILQ_HEAD_INITIALIZER(autostarts_always);
+struct assignments_head assignments = TAILQ_HEAD_INITIALIZER(assignments);
+struct ws_assignments_head ws_assignments = TAILQ_HEAD_INITIALIZER(ws_assignments);
+bool xkb_supported = false;
+bool shape_supported = false;
+bool force_xinerama = false;
+
+#define xmacro(atom) xcb_atom_t A_##atom;
+I3_NET_SUPPORTED_ATOMS_XMACRO
+I3_REST_ATOMS_XMACRO
+#undef xmacro
+
+void main_set_x11_cb(bool enable) {
+}
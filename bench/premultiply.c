@@ -0,0 +1,163 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * premultiply.c: Compares premultiply_argb() (libi3/premultiply_argb.c)
+ *                with the per-pixel loop which window_icon_scale() used
+ *                before, on icon sized buffers. Fails if the results
+ *                differ. Run with “meson test --benchmark” or directly:
+ *
+ *                bench.premultiply [--min-time <ms>] [<width>...]
+ *
+ */
+#include "libi3.h"
+
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Every benchmark runs for at least this long */
+static double min_time_ns = 200e6;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * The loop from window_icon_scale() before premultiply_argb() existed.
+ *
+ */
+static void premultiply_scalar(uint32_t *dst, const uint32_t *src, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        uint8_t r, g, b, a;
+        const uint32_t pixel = src[i];
+        a = (pixel >> 24) & 0xff;
+        r = (pixel >> 16) & 0xff;
+        g = (pixel >> 8) & 0xff;
+        b = (pixel >> 0) & 0xff;
+
+        r = (r * a) / 0xff;
+        g = (g * a) / 0xff;
+        b = (b * a) / 0xff;
+
+        dst[i] = ((uint32_t)a << 24) | (r << 16) | (g << 8) | b;
+    }
+}
+
+/*
+ * Calls fn until min_time_ns passed (at least 3 times) and returns the
+ * nanoseconds per call.
+ *
+ */
+static double run(void (*fn)(uint32_t *, const uint32_t *, size_t),
+                  uint32_t *dst, const uint32_t *src, size_t len) {
+    /* Warm up the caches. */
+    fn(dst, src, len);
+
+    const double start = now_ns();
+    double elapsed = 0;
+    long calls = 0;
+    long batch = 1;
+    while (calls < 3 || elapsed < min_time_ns) {
+        for (long i = 0; i < batch; i++) {
+            fn(dst, src, len);
+        }
+        calls += batch;
+        elapsed = now_ns() - start;
+        if (batch < 1024) {
+            batch *= 2;
+        }
+    }
+    return elapsed / calls;
+}
+
+/*
+ * Benchmarks both conversions on a width × width icon of random pixels.
+ * Returns false if their results differ.
+ *
+ */
+static bool bench_icon(int width) {
+    const size_t len = (size_t)width * width;
+    uint32_t *src = smalloc(len * sizeof(uint32_t));
+    uint32_t *expected = smalloc(len * sizeof(uint32_t));
+    uint32_t *dst = smalloc(len * sizeof(uint32_t));
+
+    /* Fixed seed, so that runs are comparable. */
+    srand(width);
+    for (size_t i = 0; i < len; i++) {
+        src[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+    }
+
+    const double scalar_ns = run(premultiply_scalar, expected, src, len);
+    const double simd_ns = run(premultiply_argb, dst, src, len);
+    const bool equal = (memcmp(expected, dst, len * sizeof(uint32_t)) == 0);
+
+    printf("%4dx%-4d  scalar %10.0f ns/op  premultiply_argb %10.0f ns/op  (%.1fx)%s\n",
+           width, width, scalar_ns, simd_ns, scalar_ns / simd_ns,
+           (equal ? "" : "  RESULTS DIFFER"));
+    fflush(stdout);
+
+    free(src);
+    free(expected);
+    free(dst);
+    return equal;
+}
+
+static void print_usage(const char *name) {
+    fprintf(stderr, "Usage: %s [--min-time <ms>] [<width>...]\n", name);
+    fprintf(stderr, "Runs the benchmarks on square icons of the given widths (default: 16 22 32 48 256).\n");
+}
+
+int main(int argc, char *argv[]) {
+    static struct option long_options[] = {
+        {"min-time", required_argument, 0, 't'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}};
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "t:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 't':
+                min_time_ns = atof(optarg) * 1e6;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    /* The usual icon sizes, and a large one */
+    static const int default_widths[] = {16, 22, 32, 48, 256};
+    int num_widths = argc - optind;
+    int *widths = smalloc(sizeof(int) * (num_widths > 0 ? num_widths : 5));
+    if (num_widths == 0) {
+        num_widths = 5;
+        memcpy(widths, default_widths, sizeof(default_widths));
+    } else {
+        for (int i = 0; i < num_widths; i++) {
+            widths[i] = atoi(argv[optind + i]);
+            if (widths[i] <= 0) {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    bool success = true;
+    for (int i = 0; i < num_widths; i++) {
+        success &= bench_icon(widths[i]);
+    }
+
+    free(widths);
+    return (success ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,583 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * replay.c: Replays a trace recorded with “i3 --record-trace <file>” against a
+ *           running i3 and reports the CPU time i3 spent and the number of
+ *           renders. Run it the way the testcases run i3:
+ *
+ *           Xvfb :99 &
+ *           DISPLAY=:99 i3 -c <config> &
+ *           DISPLAY=:99 bench.replay [--speed <factor>] <trace>
+ *
+ *           The events are reproduced from the client side: windows which
+ *           were managed are replaced by windows of the replay, key presses,
+ *           button presses and pointer motion (including the resulting
+ *           EnterNotify events) are injected using XTEST, and property
+ *           changes, configure requests and client messages are repeated on
+ *           the replacement windows. Events which i3 caused itself and
+ *           extension events (e.g. RandR changes) are skipped.
+ *
+ */
+#include "libi3.h"
+#include "trace.h"
+
+#include <err.h>
+#include <getopt.h>
+#include <i3/ipc.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <xcb/xcb.h>
+#include <xcb/xcb_aux.h>
+#include <xcb/xtest.h>
+
+/*
+ * Having verboselog() and errorlog() is necessary when using libi3.
+ *
+ */
+void verboselog(char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf(stdout, fmt, args);
+    va_end(args);
+}
+
+void errorlog(char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+xcb_connection_t *conn;
+static xcb_screen_t *screen;
+static int sockfd;
+
+static xcb_atom_t net_wm_name;
+static xcb_atom_t net_wm_state;
+static xcb_atom_t utf8_string;
+static xcb_atom_t i3_sync;
+
+/* The recorded atoms and the atoms of the same name on this server */
+struct atom_mapping {
+    xcb_atom_t recorded;
+    xcb_atom_t atom;
+};
+static struct atom_mapping *atoms;
+static int num_atoms;
+
+/* The recorded client windows and the windows of the replay replacing them */
+struct window_mapping {
+    xcb_window_t recorded;
+    xcb_window_t window;
+};
+static struct window_mapping *windows;
+static int num_windows;
+
+static long replayed;
+static long skipped;
+static long commands;
+static long titles;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static xcb_atom_t intern_atom(const char *name, size_t length) {
+    xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(conn, xcb_intern_atom(conn, 0, length, name), NULL);
+    if (reply == NULL) {
+        errx(EXIT_FAILURE, "Cannot intern atom %.*s", (int)length, name);
+    }
+    const xcb_atom_t atom = reply->atom;
+    free(reply);
+    return atom;
+}
+
+/*
+ * Returns the atom which corresponds to the recorded one or XCB_NONE.
+ * Predefined atoms (up to WM_TRANSIENT_FOR) are the same on every server.
+ *
+ */
+static xcb_atom_t translate_atom(xcb_atom_t recorded) {
+    for (int i = 0; i < num_atoms; i++) {
+        if (atoms[i].recorded == recorded) {
+            return atoms[i].atom;
+        }
+    }
+    return (recorded <= XCB_ATOM_WM_TRANSIENT_FOR ? recorded : XCB_NONE);
+}
+
+static struct window_mapping *window_mapping(xcb_window_t recorded) {
+    for (int i = 0; i < num_windows; i++) {
+        if (windows[i].recorded == recorded) {
+            return &windows[i];
+        }
+    }
+    return NULL;
+}
+
+static xcb_window_t translate_window(xcb_window_t recorded) {
+    struct window_mapping *mapping = window_mapping(recorded);
+    return (mapping != NULL ? mapping->window : XCB_NONE);
+}
+
+/*
+ * Creates the window which replaces the recorded one.
+ *
+ */
+static xcb_window_t create_window(xcb_window_t recorded) {
+    const xcb_window_t window = xcb_generate_id(conn);
+    const uint32_t values[] = {screen->white_pixel};
+    xcb_create_window(conn, XCB_COPY_FROM_PARENT, window, screen->root,
+                      0, 0, 300, 200, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                      XCB_COPY_FROM_PARENT, XCB_CW_BACK_PIXEL, values);
+
+    char *name;
+    const int length = sasprintf(&name, "replay of 0x%08x", recorded);
+    xcb_change_property(conn, XCB_PROP_MODE_REPLACE, window, XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, length, name);
+    free(name);
+
+    windows = srealloc(windows, sizeof(struct window_mapping) * (num_windows + 1));
+    windows[num_windows].recorded = recorded;
+    windows[num_windows].window = window;
+    num_windows++;
+    return window;
+}
+
+static void destroy_window(struct window_mapping *mapping) {
+    xcb_destroy_window(conn, mapping->window);
+    *mapping = windows[--num_windows];
+}
+
+static void fake_motion(int16_t x, int16_t y) {
+    xcb_test_fake_input(conn, XCB_MOTION_NOTIFY, 0, XCB_CURRENT_TIME, screen->root, x, y, 0);
+}
+
+/*
+ * Changes the property on the replacement window. Titles get a new value, so
+ * that the decorations are redrawn. For other properties, the recorded values
+ * are not known, so an empty change only generates the PropertyNotify.
+ *
+ */
+static void replay_property(const xcb_property_notify_event_t *event) {
+    const xcb_window_t window = translate_window(event->window);
+    const xcb_atom_t atom = translate_atom(event->atom);
+    if (window == XCB_NONE || atom == XCB_NONE) {
+        skipped++;
+        return;
+    }
+
+    if (event->state == XCB_PROPERTY_DELETE) {
+        xcb_delete_property(conn, window, atom);
+    } else if (atom == XCB_ATOM_WM_NAME || atom == net_wm_name) {
+        char *title;
+        const int length = sasprintf(&title, "replayed title %ld", ++titles);
+        xcb_change_property(conn, XCB_PROP_MODE_REPLACE, window, atom,
+                            (atom == net_wm_name ? utf8_string : XCB_ATOM_STRING), 8, length, title);
+        free(title);
+    } else {
+        xcb_change_property(conn, XCB_PROP_MODE_APPEND, window, atom, XCB_ATOM_CARDINAL, 32, 0, NULL);
+    }
+    replayed++;
+}
+
+static void replay_configure_request(const xcb_configure_request_event_t *event) {
+    const xcb_window_t window = translate_window(event->window);
+    if (window == XCB_NONE) {
+        skipped++;
+        return;
+    }
+
+    /* The values follow the order of the mask bits. The sibling is not
+     * known, so the stacking is left out with it. */
+    uint32_t values[5];
+    uint16_t mask = 0;
+    int num = 0;
+#define VALUE(bit, value)                  \
+    if (event->value_mask & (bit)) {       \
+        mask |= (bit);                     \
+        values[num++] = (uint32_t)(value); \
+    }
+    VALUE(XCB_CONFIG_WINDOW_X, event->x);
+    VALUE(XCB_CONFIG_WINDOW_Y, event->y);
+    VALUE(XCB_CONFIG_WINDOW_WIDTH, event->width);
+    VALUE(XCB_CONFIG_WINDOW_HEIGHT, event->height);
+    VALUE(XCB_CONFIG_WINDOW_BORDER_WIDTH, event->border_width);
+#undef VALUE
+    xcb_configure_window(conn, window, mask, values);
+    replayed++;
+}
+
+static void replay_client_message(const xcb_client_message_event_t *event) {
+    const xcb_atom_t type = translate_atom(event->type);
+    if (type == XCB_NONE || type == i3_sync) {
+        skipped++;
+        return;
+    }
+
+    xcb_client_message_event_t message = *event;
+    message.response_type = XCB_CLIENT_MESSAGE;
+    message.type = type;
+    /* Messages to the root window are sent to the root window of the
+     * replay. */
+    const xcb_window_t window = translate_window(event->window);
+    message.window = (window != XCB_NONE ? window : screen->root);
+    if (type == net_wm_state && event->format == 32) {
+        message.data.data32[1] = translate_atom(event->data.data32[1]);
+        message.data.data32[2] = translate_atom(event->data.data32[2]);
+    }
+
+    xcb_send_event(conn, false, screen->root,
+                   XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT | XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY,
+                   (const char *)&message);
+    replayed++;
+}
+
+static void replay_event(const xcb_generic_event_t *event) {
+    switch (event->response_type & 0x7F) {
+        case XCB_MAP_REQUEST: {
+            const xcb_map_request_event_t *request = (const xcb_map_request_event_t *)event;
+            xcb_window_t window = translate_window(request->window);
+            if (window == XCB_NONE) {
+                window = create_window(request->window);
+            }
+            xcb_map_window(conn, window);
+            replayed++;
+            break;
+        }
+        case XCB_DESTROY_NOTIFY: {
+            struct window_mapping *mapping = window_mapping(((const xcb_destroy_notify_event_t *)event)->window);
+            if (mapping == NULL) {
+                skipped++;
+                break;
+            }
+            destroy_window(mapping);
+            replayed++;
+            break;
+        }
+        case XCB_CONFIGURE_REQUEST:
+            replay_configure_request((const xcb_configure_request_event_t *)event);
+            break;
+        case XCB_PROPERTY_NOTIFY:
+            replay_property((const xcb_property_notify_event_t *)event);
+            break;
+        case XCB_CLIENT_MESSAGE:
+            replay_client_message((const xcb_client_message_event_t *)event);
+            break;
+        case XCB_KEY_PRESS:
+        case XCB_KEY_RELEASE: {
+            const xcb_key_press_event_t *key = (const xcb_key_press_event_t *)event;
+            xcb_test_fake_input(conn, key->response_type & 0x7F, key->detail, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+            replayed++;
+            break;
+        }
+        case XCB_BUTTON_PRESS:
+        case XCB_BUTTON_RELEASE: {
+            const xcb_button_press_event_t *button = (const xcb_button_press_event_t *)event;
+            fake_motion(button->root_x, button->root_y);
+            xcb_test_fake_input(conn, button->response_type & 0x7F, button->detail, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+            replayed++;
+            break;
+        }
+        case XCB_MOTION_NOTIFY: {
+            const xcb_motion_notify_event_t *motion = (const xcb_motion_notify_event_t *)event;
+            fake_motion(motion->root_x, motion->root_y);
+            replayed++;
+            break;
+        }
+        case XCB_ENTER_NOTIFY: {
+            /* Moving the pointer into the window generates the EnterNotify
+             * (and the ones of the windows on the way). */
+            const xcb_enter_notify_event_t *enter = (const xcb_enter_notify_event_t *)event;
+            fake_motion(enter->root_x, enter->root_y);
+            replayed++;
+            break;
+        }
+        default:
+            skipped++;
+            break;
+    }
+}
+
+static void run_command(const char *command, size_t length) {
+    if (ipc_send_message(sockfd, length, I3_IPC_MESSAGE_TYPE_RUN_COMMAND, (const uint8_t *)command) == -1) {
+        err(EXIT_FAILURE, "IPC: write()");
+    }
+    uint32_t reply_type;
+    uint32_t reply_length;
+    uint8_t *reply;
+    if (ipc_recv_message(sockfd, &reply_type, &reply_length, &reply) != 0) {
+        errx(EXIT_FAILURE, "IPC: Could not read the reply");
+    }
+    free(reply);
+    commands++;
+}
+
+/*
+ * Waits until i3 handled all events sent so far, using the i3 sync protocol
+ * (see docs/testsuite).
+ *
+ */
+static void sync_with_i3(void) {
+    const xcb_window_t window = xcb_generate_id(conn);
+    xcb_create_window(conn, XCB_COPY_FROM_PARENT, window, screen->root, 0, 0, 1, 1, 0,
+                      XCB_WINDOW_CLASS_INPUT_ONLY, XCB_COPY_FROM_PARENT, 0, NULL);
+
+    const uint32_t rnd = (uint32_t)random();
+    xcb_client_message_event_t message = {
+        .response_type = XCB_CLIENT_MESSAGE,
+        .format = 32,
+        .window = screen->root,
+        .type = i3_sync,
+        .data.data32 = {window, rnd},
+    };
+    xcb_send_event(conn, false, screen->root, XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT, (const char *)&message);
+    xcb_flush(conn);
+
+    xcb_generic_event_t *event;
+    while ((event = xcb_wait_for_event(conn)) != NULL) {
+        const bool done = ((event->response_type & 0x7F) == XCB_CLIENT_MESSAGE &&
+                           ((xcb_client_message_event_t *)event)->data.data32[1] == rnd);
+        free(event);
+        if (done) {
+            break;
+        }
+    }
+    if (event == NULL) {
+        errx(EXIT_FAILURE, "The X11 connection broke");
+    }
+    xcb_destroy_window(conn, window);
+}
+
+/*
+ * Returns the number of calls in the given latency histogram of the GET_STATS
+ * reply.
+ *
+ */
+static uint64_t stats_count(const char *stats, const char *name) {
+    char *key;
+    sasprintf(&key, "\"%s\":{\"count\":", name);
+    const char *found = strstr(stats, key);
+    const uint64_t count = (found != NULL ? strtoull(found + strlen(key), NULL, 10) : 0);
+    free(key);
+    return count;
+}
+
+static char *get_stats(void) {
+    if (ipc_send_message(sockfd, 0, I3_IPC_MESSAGE_TYPE_GET_STATS, (const uint8_t *)"") == -1) {
+        err(EXIT_FAILURE, "IPC: write()");
+    }
+    uint32_t reply_type;
+    uint32_t reply_length;
+    uint8_t *reply;
+    if (ipc_recv_message(sockfd, &reply_type, &reply_length, &reply) != 0) {
+        errx(EXIT_FAILURE, "IPC: Could not read the GET_STATS reply");
+    }
+    char *stats = sstrndup((const char *)reply, reply_length);
+    free(reply);
+    return stats;
+}
+
+/*
+ * Returns the CPU time (user and system, in seconds) used by the process.
+ *
+ */
+static bool cpu_time(long pid, double *user, double *system) {
+    char *path;
+    sasprintf(&path, "/proc/%ld/stat", pid);
+    FILE *file = fopen(path, "r");
+    free(path);
+    if (file == NULL) {
+        return false;
+    }
+    char line[4096];
+    const bool read = (fgets(line, sizeof(line), file) != NULL);
+    fclose(file);
+    /* The command name can contain spaces, the fields follow its ')' */
+    const char *fields = (read ? strrchr(line, ')') : NULL);
+    unsigned long utime;
+    unsigned long stime;
+    if (fields == NULL ||
+        sscanf(fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) {
+        return false;
+    }
+    const long ticks = sysconf(_SC_CLK_TCK);
+    *user = (double)utime / ticks;
+    *system = (double)stime / ticks;
+    return true;
+}
+
+static char *read_trace(const char *path, size_t *size) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        err(EXIT_FAILURE, "Cannot open %s", path);
+    }
+    char *data = NULL;
+    *size = 0;
+    size_t capacity = 0;
+    size_t n;
+    do {
+        if (*size == capacity) {
+            capacity = (capacity == 0 ? 65536 : capacity * 2);
+            data = srealloc(data, capacity);
+        }
+        n = fread(data + *size, 1, capacity - *size, file);
+        *size += n;
+    } while (n > 0);
+    if (ferror(file)) {
+        err(EXIT_FAILURE, "Cannot read %s", path);
+    }
+    fclose(file);
+    return data;
+}
+
+static void print_usage(const char *name) {
+    fprintf(stderr, "Usage: %s [--speed <factor>] <trace>\n", name);
+    fprintf(stderr, "Replays a trace recorded with \"i3 --record-trace <trace>\" against the running i3.\n");
+    fprintf(stderr, "The speed is relative to the recording (default: 1), 0 replays without pauses.\n");
+}
+
+int main(int argc, char *argv[]) {
+    static struct option long_options[] = {
+        {"speed", required_argument, 0, 's'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}};
+
+    double speed = 1;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "s:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                speed = atof(optarg);
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind != argc - 1 || speed < 0) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    size_t size;
+    char *trace = read_trace(argv[optind], &size);
+    if (size < sizeof(struct trace_header) || memcmp(trace, TRACE_MAGIC, strlen(TRACE_MAGIC)) != 0) {
+        errx(EXIT_FAILURE, "%s is not an i3 trace", argv[optind]);
+    }
+
+    int screen_number;
+    conn = xcb_connect(NULL, &screen_number);
+    if (xcb_connection_has_error(conn)) {
+        errx(EXIT_FAILURE, "Cannot open display");
+    }
+    screen = xcb_aux_get_screen(conn, screen_number);
+    if (!xcb_get_extension_data(conn, &xcb_test_id)->present) {
+        errx(EXIT_FAILURE, "The X server does not support XTEST");
+    }
+    net_wm_name = intern_atom("_NET_WM_NAME", strlen("_NET_WM_NAME"));
+    net_wm_state = intern_atom("_NET_WM_STATE", strlen("_NET_WM_STATE"));
+    utf8_string = intern_atom("UTF8_STRING", strlen("UTF8_STRING"));
+    i3_sync = intern_atom("I3_SYNC", strlen("I3_SYNC"));
+
+    sockfd = ipc_connect(NULL);
+    char *pid_str = root_atom_contents("I3_PID", conn, screen_number);
+    const long pid = (pid_str != NULL ? atol(pid_str) : 0);
+    free(pid_str);
+
+    double user_before = 0;
+    double system_before = 0;
+    const bool have_cpu = (pid > 0 && cpu_time(pid, &user_before, &system_before));
+    char *stats = get_stats();
+    const uint64_t renders_before = stats_count(stats, "tree_render");
+    const uint64_t pushes_before = stats_count(stats, "x_push_changes");
+    free(stats);
+
+    const double start = now_us();
+    double due = start;
+    size_t offset = sizeof(struct trace_header);
+    while (offset + sizeof(struct trace_record) <= size) {
+        struct trace_record record;
+        memcpy(&record, trace + offset, sizeof(record));
+        const char *data = trace + offset + sizeof(record);
+        offset += sizeof(record) + record.length;
+        if (offset > size) {
+            warnx("The trace is truncated");
+            break;
+        }
+
+        if (speed > 0) {
+            due += record.delta_us / speed;
+            const double wait = due - now_us();
+            if (wait > 0) {
+                xcb_flush(conn);
+                usleep(wait);
+            }
+        }
+
+        switch (record.type) {
+            case TRACE_X_EVENT:
+                if (record.length >= sizeof(xcb_generic_event_t)) {
+                    replay_event((const xcb_generic_event_t *)data);
+                }
+                break;
+            case TRACE_COMMAND:
+                xcb_flush(conn);
+                run_command(data, record.length);
+                break;
+            case TRACE_ATOM:
+                if (record.length > sizeof(uint32_t)) {
+                    atoms = srealloc(atoms, sizeof(struct atom_mapping) * (num_atoms + 1));
+                    memcpy(&atoms[num_atoms].recorded, data, sizeof(uint32_t));
+                    atoms[num_atoms].atom = intern_atom(data + sizeof(uint32_t), record.length - sizeof(uint32_t));
+                    num_atoms++;
+                }
+                break;
+        }
+    }
+    sync_with_i3();
+    const double elapsed = now_us() - start;
+
+    stats = get_stats();
+    const uint64_t renders = stats_count(stats, "tree_render") - renders_before;
+    const uint64_t pushes = stats_count(stats, "x_push_changes") - pushes_before;
+    free(stats);
+
+    printf("replayed %ld events (%ld skipped) and %ld commands in %.3f s\n",
+           replayed, skipped, commands, elapsed / 1e6);
+    double user;
+    double system;
+    if (have_cpu && cpu_time(pid, &user, &system)) {
+        printf("i3 cpu time: %.3f s user, %.3f s system\n", user - user_before, system - system_before);
+    } else {
+        printf("i3 cpu time: unknown (is i3 running on this machine?)\n");
+    }
+    printf("i3 renders: %" PRIu64 " tree_render, %" PRIu64 " x_push_changes\n", renders, pushes);
+
+    while (num_windows > 0) {
+        destroy_window(&windows[0]);
+    }
+    xcb_aux_sync(conn);
+    xcb_disconnect(conn);
+    close(sockfd);
+    free(windows);
+    free(atoms);
+    free(trace);
+    return EXIT_SUCCESS;
+}
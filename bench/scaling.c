@@ -0,0 +1,457 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * scaling.c: Measures how i3's latencies grow with the number of outputs,
+ *            workspaces and windows. For each size, starts an i3 with fake
+ *            outputs (see src/fake_outputs.c), fills its workspaces with
+ *            windows of its own and measures the startup time, the time to
+ *            manage the windows and the latency of workspace switches,
+ *            output focus changes and directional moves (each as the round
+ *            trip of the IPC command, which includes the render). Run it in
+ *            an Xvfb:
+ *
+ *            Xvfb :99 &
+ *            DISPLAY=:99 bench.scaling [--i3 build/i3]
+ *
+ *            Fails if a latency grows linearly (or worse) with the size.
+ *
+ */
+#include "libi3.h"
+
+#include <err.h>
+#include <getopt.h>
+#include <i3/ipc.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <xcb/xcb.h>
+#include <xcb/xcb_aux.h>
+
+/*
+ * Having verboselog() and errorlog() is necessary when using libi3.
+ *
+ */
+void verboselog(char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf(stdout, fmt, args);
+    va_end(args);
+}
+
+void errorlog(char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+/* Gives up if i3 does not react within this time */
+#define EVENT_TIMEOUT_MS 10000
+
+/* The size of each fake output, arranged in a grid */
+#define OUTPUT_WIDTH 1280
+#define OUTPUT_HEIGHT 800
+
+xcb_connection_t *conn;
+static xcb_screen_t *screen;
+
+static xcb_window_t *windows;
+static int num_windows;
+static int mapped_windows;
+
+/* The latencies measured for one size, see measure() */
+enum {
+    METRIC_WORKSPACE,
+    METRIC_FOCUS_OUTPUT,
+    METRIC_MOVE,
+    NUM_METRICS,
+};
+
+static const char *metric_names[NUM_METRICS] = {
+    [METRIC_WORKSPACE] = "workspace",
+    [METRIC_FOCUS_OUTPUT] = "focus output",
+    [METRIC_MOVE] = "move",
+};
+
+struct result {
+    int outputs;
+    int workspaces;
+    int windows;
+    double startup_us;
+    double manage_us;
+    double p50[NUM_METRICS];
+    double p90[NUM_METRICS];
+};
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Writes a configuration with the given number of fake outputs and a socket
+ * path of its own, so that a stale I3_SOCKET_PATH does not get in the way.
+ *
+ */
+static void write_config(const char *path, const char *socket_path, int outputs) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        err(EXIT_FAILURE, "Cannot create %s", path);
+    }
+    fprintf(file, "# i3 config file (v4)\n");
+    fprintf(file, "font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1\n");
+    fprintf(file, "ipc-socket %s\n", socket_path);
+    fprintf(file, "focus_follows_mouse no\n");
+    fprintf(file, "mouse_warping none\n");
+
+    int columns = (int)ceil(sqrt(outputs));
+    fprintf(file, "fake-outputs ");
+    for (int i = 0; i < outputs; i++) {
+        fprintf(file, "%s%dx%d+%d+%d", (i > 0 ? "," : ""),
+                OUTPUT_WIDTH, OUTPUT_HEIGHT,
+                (i % columns) * OUTPUT_WIDTH, (i / columns) * OUTPUT_HEIGHT);
+    }
+    fprintf(file, "\n");
+    fclose(file);
+}
+
+/*
+ * Starts i3 and returns its pid once it accepts IPC connections. The time
+ * this took is returned in startup_us.
+ *
+ */
+static pid_t start_i3(const char *i3_path, const char *config_path, const char *socket_path,
+                      int *sockfd, double *startup_us) {
+    unlink(socket_path);
+    const double start = now_us();
+    const pid_t pid = fork();
+    if (pid == -1) {
+        err(EXIT_FAILURE, "fork()");
+    }
+    if (pid == 0) {
+        execlp(i3_path, i3_path, "-c", config_path, (char *)NULL);
+        err(EXIT_FAILURE, "Cannot execute %s", i3_path);
+    }
+
+    while ((*sockfd = ipc_connect_impl(socket_path)) == -1) {
+        int status;
+        if (waitpid(pid, &status, WNOHANG) == pid) {
+            errx(EXIT_FAILURE, "i3 exited during startup (status %d)", status);
+        }
+        if (now_us() - start > EVENT_TIMEOUT_MS * 1000.0) {
+            kill(pid, SIGTERM);
+            errx(EXIT_FAILURE, "i3 did not open its IPC socket within %d ms", EVENT_TIMEOUT_MS);
+        }
+        usleep(1000);
+    }
+
+    /* The socket is opened before the initial render, so wait for a reply. */
+    if (ipc_send_message(*sockfd, 0, I3_IPC_MESSAGE_TYPE_GET_VERSION, (const uint8_t *)"") == -1) {
+        err(EXIT_FAILURE, "IPC: write()");
+    }
+    uint32_t reply_type;
+    uint32_t reply_length;
+    uint8_t *reply;
+    if (ipc_recv_message(*sockfd, &reply_type, &reply_length, &reply) != 0) {
+        errx(EXIT_FAILURE, "IPC: Could not read the reply");
+    }
+    free(reply);
+    *startup_us = now_us() - start;
+    return pid;
+}
+
+static void stop_i3(pid_t pid, int sockfd) {
+    /* i3 exits without replying to "exit". */
+    ipc_send_message(sockfd, strlen("exit"), I3_IPC_MESSAGE_TYPE_RUN_COMMAND, (const uint8_t *)"exit");
+    close(sockfd);
+    if (waitpid(pid, NULL, 0) == -1) {
+        err(EXIT_FAILURE, "waitpid()");
+    }
+}
+
+/*
+ * Runs the command and returns the µs until the reply arrived, i.e. until i3
+ * executed the command and rendered the result.
+ *
+ */
+static double run_command(int sockfd, const char *command) {
+    const double start = now_us();
+    if (ipc_send_message(sockfd, strlen(command), I3_IPC_MESSAGE_TYPE_RUN_COMMAND, (const uint8_t *)command) == -1) {
+        err(EXIT_FAILURE, "IPC: write()");
+    }
+    uint32_t reply_type;
+    uint32_t reply_length;
+    uint8_t *reply;
+    if (ipc_recv_message(sockfd, &reply_type, &reply_length, &reply) != 0) {
+        errx(EXIT_FAILURE, "IPC: Could not read the reply to \"%s\"", command);
+    }
+    const double elapsed = now_us() - start;
+    free(reply);
+    return elapsed;
+}
+
+static void handle_event(xcb_generic_event_t *event) {
+    if ((event->response_type & 0x7F) == XCB_MAP_NOTIFY) {
+        mapped_windows++;
+    }
+}
+
+/*
+ * Waits until i3 mapped (i.e. managed) target windows.
+ *
+ */
+static void wait_for_mapped(int target) {
+    xcb_flush(conn);
+    while (mapped_windows < target) {
+        xcb_generic_event_t *event;
+        while ((event = xcb_poll_for_event(conn)) != NULL) {
+            handle_event(event);
+            free(event);
+        }
+        if (mapped_windows >= target) {
+            break;
+        }
+        if (xcb_connection_has_error(conn)) {
+            errx(EXIT_FAILURE, "The X11 connection broke");
+        }
+        struct pollfd pfd = {
+            .fd = xcb_get_file_descriptor(conn),
+            .events = POLLIN,
+        };
+        const int ready = poll(&pfd, 1, EVENT_TIMEOUT_MS);
+        if (ready == -1) {
+            err(EXIT_FAILURE, "poll()");
+        }
+        if (ready == 0) {
+            errx(EXIT_FAILURE, "i3 did not manage the windows within %d ms (%d of %d)",
+                 EVENT_TIMEOUT_MS, mapped_windows, target);
+        }
+    }
+}
+
+/*
+ * Opens count windows on the focused workspace and waits until i3 managed
+ * them.
+ *
+ */
+static void open_windows(int count) {
+    const uint32_t values[] = {screen->white_pixel, XCB_EVENT_MASK_STRUCTURE_NOTIFY};
+    windows = srealloc(windows, sizeof(xcb_window_t) * (num_windows + count));
+    for (int i = 0; i < count; i++) {
+        const xcb_window_t window = xcb_generate_id(conn);
+        xcb_create_window(conn, XCB_COPY_FROM_PARENT, window, screen->root,
+                          0, 0, 50, 50, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                          XCB_COPY_FROM_PARENT, XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK, values);
+        xcb_map_window(conn, window);
+        windows[num_windows++] = window;
+    }
+    wait_for_mapped(num_windows);
+}
+
+static void close_windows(void) {
+    for (int i = 0; i < num_windows; i++) {
+        xcb_destroy_window(conn, windows[i]);
+    }
+    xcb_aux_sync(conn);
+    num_windows = 0;
+    mapped_windows = 0;
+}
+
+static void percentiles(double *values, int num, double *p50, double *p90) {
+    qsort(values, num, sizeof(double), compare_doubles);
+    *p50 = values[num / 2];
+    *p90 = values[num * 9 / 10];
+}
+
+/*
+ * Measures one size: starts i3, distributes the workspaces over the outputs
+ * and the windows over the workspaces, then measures the commands.
+ *
+ */
+static void measure(const char *i3_path, struct result *result, int samples) {
+    char *config_path;
+    char *socket_path;
+    sasprintf(&config_path, "/tmp/i3-bench-scaling-%d.config", getpid());
+    sasprintf(&socket_path, "/tmp/i3-bench-scaling-%d.sock", getpid());
+    write_config(config_path, socket_path, result->outputs);
+
+    int sockfd;
+    const pid_t pid = start_i3(i3_path, config_path, socket_path, &sockfd, &result->startup_us);
+
+    char *command;
+    const double start = now_us();
+    for (int ws = 1; ws <= result->workspaces; ws++) {
+        sasprintf(&command, "focus output fake-%d; workspace number %d", (ws - 1) % result->outputs, ws);
+        run_command(sockfd, command);
+        free(command);
+        /* The remainder goes to the first workspaces. */
+        const int count = result->windows / result->workspaces +
+                          (ws <= result->windows % result->workspaces ? 1 : 0);
+        open_windows(count);
+    }
+    result->manage_us = (now_us() - start) / (result->windows > 0 ? result->windows : 1);
+
+    double *latencies = smalloc(sizeof(double) * samples);
+    srandom(1);
+    for (int i = 0; i < samples; i++) {
+        sasprintf(&command, "workspace number %ld", 1 + random() % result->workspaces);
+        latencies[i] = run_command(sockfd, command);
+        free(command);
+    }
+    percentiles(latencies, samples, &result->p50[METRIC_WORKSPACE], &result->p90[METRIC_WORKSPACE]);
+
+    for (int i = 0; i < samples; i++) {
+        sasprintf(&command, "focus output fake-%ld", random() % result->outputs);
+        latencies[i] = run_command(sockfd, command);
+        free(command);
+    }
+    percentiles(latencies, samples, &result->p50[METRIC_FOCUS_OUTPUT], &result->p90[METRIC_FOCUS_OUTPUT]);
+
+    /* Moving back and forth keeps the layout (and crosses outputs when the
+     * window is at the edge of its workspace). */
+    for (int i = 0; i < samples; i++) {
+        latencies[i] = run_command(sockfd, (i % 2 == 0 ? "move left" : "move right"));
+    }
+    percentiles(latencies, samples, &result->p50[METRIC_MOVE], &result->p90[METRIC_MOVE]);
+    free(latencies);
+
+    stop_i3(pid, sockfd);
+    close_windows();
+    unlink(config_path);
+    unlink(socket_path);
+    free(config_path);
+    free(socket_path);
+}
+
+static void print_result(const struct result *result) {
+    printf("%3d outputs %4d workspaces %5d windows  startup %8.1f ms  manage %7.1f us/window",
+           result->outputs, result->workspaces, result->windows,
+           result->startup_us / 1e3, result->manage_us);
+    for (int metric = 0; metric < NUM_METRICS; metric++) {
+        printf("  %s p50 %7.1f us p90 %7.1f us", metric_names[metric], result->p50[metric], result->p90[metric]);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+static void print_usage(const char *name) {
+    fprintf(stderr, "Usage: %s [--i3 <path>] [--outputs <n>] [--workspaces <n>] [--windows <n>]\n", name);
+    fprintf(stderr, "       [--steps <n>] [--samples <n>]\n");
+    fprintf(stderr, "Measures i3 with 1/2^(steps-1) up to all of the outputs, workspaces and windows\n");
+    fprintf(stderr, "(default: 16 outputs, 200 workspaces, 2000 windows, 4 steps, 200 samples).\n");
+    fprintf(stderr, "Needs an X server without a window manager, e.g. Xvfb.\n");
+}
+
+int main(int argc, char *argv[]) {
+    static struct option long_options[] = {
+        {"i3", required_argument, 0, 'i'},
+        {"outputs", required_argument, 0, 'o'},
+        {"workspaces", required_argument, 0, 'w'},
+        {"windows", required_argument, 0, 'n'},
+        {"steps", required_argument, 0, 's'},
+        {"samples", required_argument, 0, 'r'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}};
+
+    const char *i3_path = "i3";
+    int outputs = 16;
+    int workspaces = 200;
+    int max_windows = 2000;
+    int steps = 4;
+    int samples = 200;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "i:o:w:n:s:r:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'i':
+                i3_path = optarg;
+                break;
+            case 'o':
+                outputs = atoi(optarg);
+                break;
+            case 'w':
+                workspaces = atoi(optarg);
+                break;
+            case 'n':
+                max_windows = atoi(optarg);
+                break;
+            case 's':
+                steps = atoi(optarg);
+                break;
+            case 'r':
+                samples = atoi(optarg);
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind != argc || outputs < 1 || workspaces < 1 || max_windows < 0 || steps < 1 || samples < 1) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int screen_number;
+    conn = xcb_connect(NULL, &screen_number);
+    if (xcb_connection_has_error(conn)) {
+        errx(EXIT_FAILURE, "Cannot open display");
+    }
+    screen = xcb_aux_get_screen(conn, screen_number);
+
+    struct result *results = scalloc(steps, sizeof(struct result));
+    for (int step = 0; step < steps; step++) {
+        const int divisor = 1 << (steps - 1 - step);
+        struct result *result = &results[step];
+        result->outputs = (outputs / divisor > 0 ? outputs / divisor : 1);
+        result->workspaces = (workspaces / divisor > 0 ? workspaces / divisor : 1);
+        result->windows = max_windows / divisor;
+        measure(i3_path, result, samples);
+        print_result(result);
+    }
+
+    /* With n times as many windows (and outputs and workspaces), a latency
+     * which grows sub-linearly grows less than n times. */
+    int failures = 0;
+    const struct result *first = &results[0];
+    const struct result *last = &results[steps - 1];
+    if (steps > 1 && first->windows > 0) {
+        const double growth = log((double)last->windows / first->windows);
+        for (int metric = 0; metric < NUM_METRICS; metric++) {
+            const double exponent = log(last->p50[metric] / first->p50[metric]) / growth;
+            const bool ok = (exponent < 1);
+            printf("%-12s grows with size^%.2f: %s\n", metric_names[metric], exponent,
+                   (ok ? "sub-linear" : "NOT sub-linear"));
+            if (!ok) {
+                failures++;
+            }
+        }
+    }
+
+    free(results);
+    free(windows);
+    xcb_disconnect(conn);
+    return (failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,796 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * soak.c: Runs i3 for hours under a churning workload and checks that its
+ *         memory stays flat. Starts an i3 of its own and repeatedly opens,
+ *         renames, marks and closes windows, connects and disconnects IPC
+ *         subscribers (one of which only reads its events when a sample is
+ *         taken), reloads the configuration, resizes the SHM log and adds and
+ *         removes a RandR 1.5 monitor. Every interval, it samples the RSS of
+ *         i3, the GET_MEMORY categories (including the heap statistics) and
+ *         the live objects of the GET_STATS pools. Run it in an Xvfb:
+ *
+ *         Xvfb :99 -screen 0 2560x1024x24 &
+ *         DISPLAY=:99 bench.soak [--i3 build/i3] [--duration <s>]
+ *
+ *         Fails if a sample series grows (almost) monotonically after the
+ *         warmup, which points to a leak, or if the RSS grows while the heap in
+ *         use does not, which points to fragmentation.
+ *
+ */
+#include "libi3.h"
+
+#include <err.h>
+#include <getopt.h>
+#include <i3/ipc.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <xcb/randr.h>
+#include <xcb/xcb.h>
+#include <xcb/xcb_aux.h>
+#include <yajl/yajl_parse.h>
+
+/*
+ * Having verboselog() and errorlog() is necessary when using libi3.
+ *
+ */
+void verboselog(char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf(stdout, fmt, args);
+    va_end(args);
+}
+
+void errorlog(char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+/* Gives up if i3 does not react within this time */
+#define EVENT_TIMEOUT_MS 10000
+
+/* The number of IPC subscribers connected (and disconnected) per round */
+#define SUBSCRIBERS_PER_ROUND 4
+
+/* A series is flagged if at least this share of its steps after the warmup
+ * did not decrease, and it grew by more than GROWTH_TOLERANCE overall. */
+#define MONOTONIC_SHARE 0.9
+#define GROWTH_TOLERANCE 0.02
+
+xcb_connection_t *conn;
+static xcb_screen_t *screen;
+
+static xcb_window_t *windows;
+static int num_windows;
+static int mapped_windows;
+
+static xcb_atom_t net_wm_name;
+static xcb_atom_t utf8_string;
+
+/* The values of one quantity over time, e.g. "memory.cons.count". */
+struct series {
+    char *name;
+    double *values;
+    int num;
+};
+
+static struct series *all_series;
+static int num_series;
+static int num_samples;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Appends the value to the series with the given name. Series which appear
+ * later (e.g. a pool used for the first time) are padded with zeros.
+ *
+ */
+static void record(const char *name, double value) {
+    struct series *series = NULL;
+    for (int i = 0; i < num_series; i++) {
+        if (strcmp(all_series[i].name, name) == 0) {
+            series = &all_series[i];
+            break;
+        }
+    }
+    if (series == NULL) {
+        all_series = srealloc(all_series, sizeof(struct series) * (num_series + 1));
+        series = &all_series[num_series++];
+        series->name = sstrdup(name);
+        series->values = NULL;
+        series->num = 0;
+    }
+    series->values = srealloc(series->values, sizeof(double) * (num_samples + 1));
+    while (series->num < num_samples) {
+        series->values[series->num++] = 0;
+    }
+    series->values[series->num++] = value;
+}
+
+static double latest(const char *name) {
+    for (int i = 0; i < num_series; i++) {
+        if (strcmp(all_series[i].name, name) == 0 && all_series[i].num > 0) {
+            return all_series[i].values[all_series[i].num - 1];
+        }
+    }
+    return 0;
+}
+
+/*
+ * Writes a configuration with a socket path of its own, so that a stale
+ * I3_SOCKET_PATH does not get in the way. No fake-outputs, so that the
+ * RandR monitors reach i3.
+ *
+ */
+static void write_config(const char *path, const char *socket_path, bool variant) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        err(EXIT_FAILURE, "Cannot create %s", path);
+    }
+    fprintf(file, "# i3 config file (v4)\n");
+    fprintf(file, "font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1\n");
+    fprintf(file, "ipc-socket %s\n", socket_path);
+    fprintf(file, "focus_follows_mouse no\n");
+    fprintf(file, "mouse_warping none\n");
+    /* Reloads alternate between two configurations, so that the bindings and
+     * assignments are really replaced. */
+    fprintf(file, "bindsym Mod1+%s nop soak\n", (variant ? "x" : "y"));
+    fprintf(file, "for_window [class=\"^soak-%s$\"] border pixel 1\n", (variant ? "a" : "b"));
+    fprintf(file, "assign [instance=\"^soak-assigned$\"] soak-%s\n", (variant ? "a" : "b"));
+    fclose(file);
+}
+
+/*
+ * Starts i3 and returns its pid once it replied to an IPC message.
+ *
+ */
+static pid_t start_i3(const char *i3_path, const char *config_path, const char *socket_path, int *sockfd) {
+    unlink(socket_path);
+    const double start = now_s();
+    const pid_t pid = fork();
+    if (pid == -1) {
+        err(EXIT_FAILURE, "fork()");
+    }
+    if (pid == 0) {
+        execlp(i3_path, i3_path, "-c", config_path, "--shmlog-size", "1048576", (char *)NULL);
+        err(EXIT_FAILURE, "Cannot execute %s", i3_path);
+    }
+
+    while ((*sockfd = ipc_connect_impl(socket_path)) == -1) {
+        int status;
+        if (waitpid(pid, &status, WNOHANG) == pid) {
+            errx(EXIT_FAILURE, "i3 exited during startup (status %d)", status);
+        }
+        if (now_s() - start > EVENT_TIMEOUT_MS / 1000.0) {
+            kill(pid, SIGTERM);
+            errx(EXIT_FAILURE, "i3 did not open its IPC socket within %d ms", EVENT_TIMEOUT_MS);
+        }
+        usleep(1000);
+    }
+    return pid;
+}
+
+static void stop_i3(pid_t pid, int sockfd) {
+    /* i3 exits without replying to "exit". */
+    ipc_send_message(sockfd, strlen("exit"), I3_IPC_MESSAGE_TYPE_RUN_COMMAND, (const uint8_t *)"exit");
+    close(sockfd);
+    if (waitpid(pid, NULL, 0) == -1) {
+        err(EXIT_FAILURE, "waitpid()");
+    }
+}
+
+/*
+ * Sends the message and returns the reply (NUL-terminated), which needs to be
+ * freed.
+ *
+ */
+static char *request(int sockfd, uint32_t type, const char *payload) {
+    if (ipc_send_message(sockfd, strlen(payload), type, (const uint8_t *)payload) == -1) {
+        err(EXIT_FAILURE, "IPC: write()");
+    }
+    uint32_t reply_type;
+    uint32_t reply_length;
+    uint8_t *reply;
+    if (ipc_recv_message(sockfd, &reply_type, &reply_length, &reply) != 0) {
+        errx(EXIT_FAILURE, "IPC: Could not read the reply to message type %u", type);
+    }
+    char *result = sstrndup((const char *)reply, reply_length);
+    free(reply);
+    return result;
+}
+
+static void run_command(int sockfd, const char *command) {
+    free(request(sockfd, I3_IPC_MESSAGE_TYPE_RUN_COMMAND, command));
+}
+
+/*******************************************************************************
+ * Workload
+ ******************************************************************************/
+
+static void handle_event(xcb_generic_event_t *event) {
+    if ((event->response_type & 0x7F) == XCB_MAP_NOTIFY) {
+        mapped_windows++;
+    }
+}
+
+/*
+ * Waits until i3 mapped (i.e. managed) target windows.
+ *
+ */
+static void wait_for_mapped(int target) {
+    xcb_flush(conn);
+    while (mapped_windows < target) {
+        xcb_generic_event_t *event;
+        while ((event = xcb_poll_for_event(conn)) != NULL) {
+            handle_event(event);
+            free(event);
+        }
+        if (mapped_windows >= target) {
+            break;
+        }
+        if (xcb_connection_has_error(conn)) {
+            errx(EXIT_FAILURE, "The X11 connection broke");
+        }
+        struct pollfd pfd = {
+            .fd = xcb_get_file_descriptor(conn),
+            .events = POLLIN,
+        };
+        const int ready = poll(&pfd, 1, EVENT_TIMEOUT_MS);
+        if (ready == -1) {
+            err(EXIT_FAILURE, "poll()");
+        }
+        if (ready == 0) {
+            errx(EXIT_FAILURE, "i3 did not manage the windows within %d ms (%d of %d)",
+                 EVENT_TIMEOUT_MS, mapped_windows, target);
+        }
+    }
+}
+
+static void set_title(xcb_window_t window, const char *title) {
+    xcb_change_property(conn, XCB_PROP_MODE_REPLACE, window, net_wm_name, utf8_string,
+                        8, strlen(title), title);
+    xcb_change_property(conn, XCB_PROP_MODE_REPLACE, window, XCB_ATOM_WM_NAME, XCB_ATOM_STRING,
+                        8, strlen(title), title);
+}
+
+/*
+ * Opens count windows, with a class matching one of the for_window rules and
+ * an instance matching one of the assignments for some of them, and waits
+ * until i3 managed them.
+ *
+ */
+static void open_windows(int count, long round) {
+    const uint32_t values[] = {screen->white_pixel, XCB_EVENT_MASK_STRUCTURE_NOTIFY};
+    windows = srealloc(windows, sizeof(xcb_window_t) * (num_windows + count));
+    for (int i = 0; i < count; i++) {
+        const xcb_window_t window = xcb_generate_id(conn);
+        xcb_create_window(conn, XCB_COPY_FROM_PARENT, window, screen->root,
+                          0, 0, 50, 50, 0, XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                          XCB_COPY_FROM_PARENT, XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK, values);
+
+        /* WM_CLASS is instance\0class\0 */
+        char class[64];
+        const int length = snprintf(class, sizeof(class), "%s%csoak-%c",
+                                    (i % 8 == 0 ? "soak-assigned" : "soak"), '\0',
+                                    (i % 2 == 0 ? 'a' : 'b'));
+        xcb_change_property(conn, XCB_PROP_MODE_REPLACE, window, XCB_ATOM_WM_CLASS, XCB_ATOM_STRING,
+                            8, length + 1, class);
+
+        char title[64];
+        snprintf(title, sizeof(title), "soak %ld/%d", round, i);
+        set_title(window, title);
+
+        xcb_map_window(conn, window);
+        windows[num_windows++] = window;
+    }
+    wait_for_mapped(num_windows);
+}
+
+static void close_windows(void) {
+    for (int i = 0; i < num_windows; i++) {
+        xcb_destroy_window(conn, windows[i]);
+    }
+    xcb_aux_sync(conn);
+    num_windows = 0;
+    mapped_windows = 0;
+}
+
+/*
+ * Renames every window a few times, with titles of varying length, so that
+ * the title caches and interned strings are replaced.
+ *
+ */
+static void rename_windows(long round) {
+    for (int pass = 0; pass < 3; pass++) {
+        for (int i = 0; i < num_windows; i++) {
+            char title[128];
+            snprintf(title, sizeof(title), "soak %ld/%d pass %d %.*s", round, i, pass,
+                     (int)((round + i) % 64), "................................................................");
+            set_title(windows[i], title);
+        }
+        xcb_flush(conn);
+    }
+}
+
+static void mark_windows(int sockfd, long round) {
+    char *command;
+    for (int i = 0; i < num_windows; i++) {
+        sasprintf(&command, "[id=%u] mark --add soak-%ld-%d, mark --add --toggle soak-keep", windows[i], round, i);
+        run_command(sockfd, command);
+        free(command);
+    }
+    run_command(sockfd, "[con_mark=\"^soak-\"] layout toggle all");
+    run_command(sockfd, "unmark");
+}
+
+/*
+ * Connects subscribers, lets i3 queue some events for them and disconnects
+ * them again, some without reading anything.
+ *
+ */
+static void churn_subscribers(const char *socket_path, long round) {
+    int fds[SUBSCRIBERS_PER_ROUND];
+    for (int i = 0; i < SUBSCRIBERS_PER_ROUND; i++) {
+        if ((fds[i] = ipc_connect_impl(socket_path)) == -1) {
+            errx(EXIT_FAILURE, "Cannot connect to %s", socket_path);
+        }
+        free(request(fds[i], I3_IPC_MESSAGE_TYPE_SUBSCRIBE,
+                     "[\"window\", \"workspace\", \"output\", \"binding\", \"tick\"]"));
+    }
+    for (int i = 0; i < SUBSCRIBERS_PER_ROUND; i++) {
+        char *payload;
+        sasprintf(&payload, "soak %ld", round);
+        ipc_send_message(fds[i], strlen(payload), I3_IPC_MESSAGE_TYPE_SEND_TICK, (const uint8_t *)payload);
+        free(payload);
+    }
+    for (int i = 0; i < SUBSCRIBERS_PER_ROUND; i++) {
+        close(fds[i]);
+    }
+}
+
+/*
+ * Reads (and discards) everything i3 queued for the lazy subscriber.
+ *
+ */
+static void drain(int fd) {
+    char buffer[4096];
+    struct pollfd pfd = {.fd = fd, .events = POLLIN};
+    while (poll(&pfd, 1, 0) == 1) {
+        if (read(fd, buffer, sizeof(buffer)) <= 0) {
+            errx(EXIT_FAILURE, "i3 disconnected the lazy subscriber");
+        }
+    }
+}
+
+static xcb_atom_t intern_atom(const char *name) {
+    xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(
+        conn, xcb_intern_atom(conn, false, strlen(name), name), NULL);
+    if (reply == NULL) {
+        errx(EXIT_FAILURE, "Cannot intern %s", name);
+    }
+    const xcb_atom_t atom = reply->atom;
+    free(reply);
+    return atom;
+}
+
+/*
+ * Adds a RandR 1.5 monitor to the right half of the screen, or removes it
+ * again, which makes i3 query its outputs. Returns false if the X server does
+ * not support RandR 1.5.
+ *
+ */
+static bool toggle_monitor(void) {
+    static bool present = false;
+    static xcb_atom_t name = XCB_NONE;
+    if (name == XCB_NONE) {
+        xcb_randr_query_version_reply_t *version = xcb_randr_query_version_reply(
+            conn, xcb_randr_query_version(conn, 1, 5), NULL);
+        const bool supported = (version != NULL && (version->major_version > 1 || version->minor_version >= 5));
+        free(version);
+        if (!supported) {
+            return false;
+        }
+        name = intern_atom("SOAK-1");
+    }
+
+    xcb_void_cookie_t cookie;
+    if (present) {
+        cookie = xcb_randr_delete_monitor_checked(conn, screen->root, name);
+    } else {
+        /* The monitor info is followed by its (zero) outputs. */
+        xcb_randr_monitor_info_t info = {
+            .name = name,
+            .primary = false,
+            .automatic = false,
+            .nOutput = 0,
+            .x = screen->width_in_pixels / 2,
+            .y = 0,
+            .width = screen->width_in_pixels / 2,
+            .height = screen->height_in_pixels,
+        };
+        cookie = xcb_randr_set_monitor_checked(conn, screen->root, &info);
+    }
+    xcb_generic_error_t *error = xcb_request_check(conn, cookie);
+    if (error != NULL) {
+        free(error);
+        return false;
+    }
+    present = !present;
+    return true;
+}
+
+/*******************************************************************************
+ * Sampling
+ ******************************************************************************/
+
+/* Flattens the numbers of a JSON reply into series named after their path,
+ * e.g. "memory.cons.count". Maps in arrays are named after their "name"
+ * member (e.g. "stats.pools.con.live"), which i3 sends first. */
+#define MAX_DEPTH 8
+
+struct flatten_state {
+    const char *prefix;
+    int depth;
+    bool in_array[MAX_DEPTH];
+    char keys[MAX_DEPTH][64];
+};
+
+static int flatten_map_key(void *ctx, const unsigned char *key, size_t len) {
+    struct flatten_state *state = ctx;
+    if (state->depth > 0 && state->depth <= MAX_DEPTH) {
+        snprintf(state->keys[state->depth - 1], sizeof(state->keys[0]), "%.*s", (int)len, key);
+    }
+    return 1;
+}
+
+static int flatten_start_map(void *ctx) {
+    struct flatten_state *state = ctx;
+    state->depth++;
+    if (state->depth <= MAX_DEPTH) {
+        state->in_array[state->depth - 1] = false;
+        state->keys[state->depth - 1][0] = '\0';
+    }
+    return 1;
+}
+
+static int flatten_start_array(void *ctx) {
+    struct flatten_state *state = ctx;
+    state->depth++;
+    if (state->depth <= MAX_DEPTH) {
+        state->in_array[state->depth - 1] = true;
+        state->keys[state->depth - 1][0] = '\0';
+    }
+    return 1;
+}
+
+static int flatten_end(void *ctx) {
+    struct flatten_state *state = ctx;
+    state->depth--;
+    return 1;
+}
+
+static int flatten_string(void *ctx, const unsigned char *val, size_t len) {
+    struct flatten_state *state = ctx;
+    /* The "name" member of a map in an array names the map. */
+    if (state->depth >= 2 && state->depth <= MAX_DEPTH &&
+        state->in_array[state->depth - 2] &&
+        strcmp(state->keys[state->depth - 1], "name") == 0) {
+        snprintf(state->keys[state->depth - 2], sizeof(state->keys[0]), "%.*s", (int)len, val);
+    }
+    return 1;
+}
+
+static int flatten_integer(void *ctx, long long val) {
+    struct flatten_state *state = ctx;
+    if (state->depth > MAX_DEPTH) {
+        return 1;
+    }
+    char name[MAX_DEPTH * 64 + 64];
+    int length = snprintf(name, sizeof(name), "%s", state->prefix);
+    for (int i = 0; i < state->depth; i++) {
+        if (state->keys[i][0] != '\0') {
+            length += snprintf(name + length, sizeof(name) - length, ".%s", state->keys[i]);
+        }
+    }
+    record(name, val);
+    return 1;
+}
+
+static void sample_reply(int sockfd, uint32_t type, const char *prefix) {
+    static yajl_callbacks callbacks = {
+        .yajl_integer = flatten_integer,
+        .yajl_string = flatten_string,
+        .yajl_start_map = flatten_start_map,
+        .yajl_map_key = flatten_map_key,
+        .yajl_end_map = flatten_end,
+        .yajl_start_array = flatten_start_array,
+        .yajl_end_array = flatten_end,
+    };
+    char *reply = request(sockfd, type, "");
+    struct flatten_state state = {.prefix = prefix};
+    yajl_handle handle = yajl_alloc(&callbacks, NULL, &state);
+    if (yajl_parse(handle, (const unsigned char *)reply, strlen(reply)) != yajl_status_ok ||
+        yajl_complete_parse(handle) != yajl_status_ok) {
+        errx(EXIT_FAILURE, "Cannot parse the reply to message type %u", type);
+    }
+    yajl_free(handle);
+    free(reply);
+}
+
+static long rss_kb(pid_t pid) {
+    char *path;
+    sasprintf(&path, "/proc/%d/status", pid);
+    FILE *file = fopen(path, "r");
+    free(path);
+    if (file == NULL) {
+        return 0;
+    }
+    long rss = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (sscanf(line, "VmRSS: %ld kB", &rss) == 1) {
+            break;
+        }
+    }
+    fclose(file);
+    return rss;
+}
+
+static void take_sample(pid_t pid, int sockfd, double elapsed) {
+    record("rss_kb", rss_kb(pid));
+    sample_reply(sockfd, I3_IPC_MESSAGE_TYPE_GET_MEMORY, "memory");
+    sample_reply(sockfd, I3_IPC_MESSAGE_TYPE_GET_STATS, "stats");
+    num_samples++;
+
+    printf("%8.0f s  rss %7.0f kB  heap in_use %9.0f free %9.0f  cons %5.0f  windows %4.0f  ipc %8.0f B  regexes %4.0f\n",
+           elapsed, latest("rss_kb"), latest("memory.heap.in_use"), latest("memory.heap.free"),
+           latest("memory.cons.count"), latest("memory.windows.count"),
+           latest("memory.ipc.bytes"), latest("memory.regexes.count"));
+    fflush(stdout);
+}
+
+/*
+ * Returns true if the series grows after the first warmup samples: (almost)
+ * every step does not decrease and it grew by more than the tolerance.
+ *
+ */
+static bool grows(const struct series *series, int warmup, double *growth) {
+    const int first = warmup;
+    const int steps = series->num - 1 - first;
+    if (steps < 4) {
+        return false;
+    }
+    int not_decreasing = 0;
+    for (int i = first + 1; i < series->num; i++) {
+        if (series->values[i] >= series->values[i - 1]) {
+            not_decreasing++;
+        }
+    }
+    const double start = series->values[first];
+    const double end = series->values[series->num - 1];
+    *growth = end - start;
+    return (not_decreasing >= MONOTONIC_SHARE * steps &&
+            *growth > GROWTH_TOLERANCE * (start > 0 ? start : 1));
+}
+
+static const struct series *find_series(const char *name) {
+    for (int i = 0; i < num_series; i++) {
+        if (strcmp(all_series[i].name, name) == 0) {
+            return &all_series[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Reports the series which grow. Of GET_STATS, only the pools are checked:
+ * the other statistics are counters which only ever increase, like the
+ * allocations and peaks of the pools.
+ *
+ */
+static int report(int warmup, double hours) {
+    int failures = 0;
+    for (int i = 0; i < num_series; i++) {
+        const struct series *series = &all_series[i];
+        const bool is_stat = (strncmp(series->name, "stats.", strlen("stats.")) == 0);
+        const bool is_pool = (strncmp(series->name, "stats.pools.", strlen("stats.pools.")) == 0);
+        if ((is_stat && !is_pool) ||
+            strstr(series->name, ".allocations") != NULL ||
+            strstr(series->name, ".peak") != NULL) {
+            continue;
+        }
+
+        double growth;
+        if (grows(series, warmup, &growth)) {
+            printf("GROWS: %-48s +%.0f (%.0f per hour)\n", series->name, growth, growth / hours);
+            failures++;
+        }
+    }
+
+    /* A growing RSS with a flat heap means the heap fragments (or memory is
+     * not returned to the system). */
+    const struct series *rss = find_series("rss_kb");
+    const struct series *in_use = find_series("memory.heap.in_use");
+    double rss_growth, heap_growth;
+    if (rss != NULL && in_use != NULL && grows(rss, warmup, &rss_growth) &&
+        !grows(in_use, warmup, &heap_growth)) {
+        printf("FRAGMENTATION: the RSS grows by %.0f kB while the heap in use stays flat\n", rss_growth);
+        failures++;
+    }
+
+    if (failures == 0) {
+        printf("No monotonic growth in %d series over %d samples\n", num_series, num_samples);
+    }
+    return failures;
+}
+
+static void print_usage(const char *name) {
+    fprintf(stderr, "Usage: %s [--i3 <path>] [--duration <s>] [--interval <s>] [--windows <n>]\n", name);
+    fprintf(stderr, "       [--reload-every <rounds>] [--randr-every <rounds>] [--warmup <samples>]\n");
+    fprintf(stderr, "Churns windows, marks, IPC subscribers, reloads and RandR monitors (default:\n");
+    fprintf(stderr, "4 hours, a sample every 60 s, 20 windows per round, reload and RandR change\n");
+    fprintf(stderr, "every 10 rounds, 5 warmup samples) and fails if i3's memory grows.\n");
+    fprintf(stderr, "Needs an X server without a window manager, e.g. Xvfb.\n");
+}
+
+int main(int argc, char *argv[]) {
+    static struct option long_options[] = {
+        {"i3", required_argument, 0, 'i'},
+        {"duration", required_argument, 0, 'd'},
+        {"interval", required_argument, 0, 's'},
+        {"windows", required_argument, 0, 'n'},
+        {"reload-every", required_argument, 0, 'r'},
+        {"randr-every", required_argument, 0, 'o'},
+        {"warmup", required_argument, 0, 'w'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}};
+
+    const char *i3_path = "i3";
+    double duration = 4 * 3600;
+    double interval = 60;
+    int count = 20;
+    int reload_every = 10;
+    int randr_every = 10;
+    int warmup = 5;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "i:d:s:n:r:o:w:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'i':
+                i3_path = optarg;
+                break;
+            case 'd':
+                duration = atof(optarg);
+                break;
+            case 's':
+                interval = atof(optarg);
+                break;
+            case 'n':
+                count = atoi(optarg);
+                break;
+            case 'r':
+                reload_every = atoi(optarg);
+                break;
+            case 'o':
+                randr_every = atoi(optarg);
+                break;
+            case 'w':
+                warmup = atoi(optarg);
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind != argc || duration <= 0 || interval <= 0 || count < 1 ||
+        reload_every < 1 || randr_every < 1 || warmup < 0) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int screen_number;
+    conn = xcb_connect(NULL, &screen_number);
+    if (xcb_connection_has_error(conn)) {
+        errx(EXIT_FAILURE, "Cannot open display");
+    }
+    screen = xcb_aux_get_screen(conn, screen_number);
+    net_wm_name = intern_atom("_NET_WM_NAME");
+    utf8_string = intern_atom("UTF8_STRING");
+
+    char *config_path;
+    char *socket_path;
+    sasprintf(&config_path, "/tmp/i3-bench-soak-%d.config", getpid());
+    sasprintf(&socket_path, "/tmp/i3-bench-soak-%d.sock", getpid());
+    write_config(config_path, socket_path, false);
+
+    int sockfd;
+    const pid_t pid = start_i3(i3_path, config_path, socket_path, &sockfd);
+
+    /* Reads its events only when a sample is taken, so that i3 has to queue
+     * them in between. */
+    const int lazy = ipc_connect_impl(socket_path);
+    if (lazy == -1) {
+        errx(EXIT_FAILURE, "Cannot connect to %s", socket_path);
+    }
+    free(request(lazy, I3_IPC_MESSAGE_TYPE_SUBSCRIBE, "[\"window\", \"workspace\", \"tick\"]"));
+
+    bool randr = true;
+    const double start = now_s();
+    double next_sample = start;
+    long round = 0;
+    while (true) {
+        const double now = now_s();
+        if (now >= next_sample) {
+            drain(lazy);
+            take_sample(pid, sockfd, now - start);
+            next_sample += interval;
+            if (now - start >= duration) {
+                break;
+            }
+        }
+
+        char *command;
+        sasprintf(&command, "workspace soak-%ld", round % 5);
+        run_command(sockfd, command);
+        free(command);
+
+        open_windows(count, round);
+        rename_windows(round);
+        mark_windows(sockfd, round);
+        churn_subscribers(socket_path, round);
+        close_windows();
+
+        if (round % reload_every == reload_every - 1) {
+            write_config(config_path, socket_path, (round / reload_every) % 2 == 0);
+            run_command(sockfd, "reload");
+            run_command(sockfd, ((round / reload_every) % 2 == 0 ? "shmlog 2097152" : "shmlog 1048576"));
+        }
+        if (randr && round % randr_every == randr_every - 1) {
+            if (!toggle_monitor()) {
+                printf("The X server does not support RandR 1.5 monitors, not changing outputs\n");
+                randr = false;
+            }
+        }
+        round++;
+    }
+
+    printf("%ld rounds in %.0f s\n", round, now_s() - start);
+    const int failures = report(warmup, (now_s() - start) / 3600);
+
+    close(lazy);
+    stop_i3(pid, sockfd);
+    unlink(config_path);
+    unlink(socket_path);
+    free(config_path);
+    free(socket_path);
+    for (int i = 0; i < num_series; i++) {
+        free(all_series[i].name);
+        free(all_series[i].values);
+    }
+    free(all_series);
+    free(windows);
+    xcb_disconnect(conn);
+    return (failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
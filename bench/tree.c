@@ -0,0 +1,256 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * tree.c: Microbenchmarks for the tree operations (attaching and detaching
+ *         containers, rendering, moving containers to another workspace,
+ *         walking and flattening the tree and generating the GET_TREE
+ *         JSON with yajl and with json_snapshot_write()). Links the tree
+ *         code against the X11 stubs in x_stubs.c and main_stubs.c, so it
+ *         runs without an X server. Run with “meson test --benchmark” or
+ *         directly:
+ *
+ *         bench.tree [--min-time <ms>] [<leaves>...]
+ *
+ */
+#include "all.h"
+
+#include <getopt.h>
+#include <time.h>
+
+typedef enum {
+    MIX_SPLIT,
+    MIX_TABBED,
+    MIX_STACKED,
+    MIX_MIXED,
+} mix_t;
+
+static const char *mix_names[] = {"split", "tabbed", "stacked", "mixed"};
+
+/* Leaves per container in the mixed trees */
+#define MIXED_GROUP_SIZE 10
+
+/* Every benchmark runs for at least this long */
+static double min_time_ns = 200e6;
+
+/* The workspace the benchmarks run on and the leaf they move around */
+static Con *bench_ws;
+static Con *bench_leaf;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * Fills the workspace with the given number of leaves, arranged as given by
+ * mix. Returns the last leaf.
+ *
+ */
+static Con *build_tree(Con *ws, int leaves, mix_t mix) {
+    static const layout_t group_layouts[] = {L_SPLITV, L_TABBED, L_STACKED};
+
+    ws->layout = L_SPLITH;
+    Con *parent = ws;
+    if (mix == MIX_TABBED || mix == MIX_STACKED) {
+        parent = con_new(ws, NULL);
+        parent->layout = (mix == MIX_TABBED ? L_TABBED : L_STACKED);
+    }
+
+    Con *leaf = NULL;
+    for (int i = 0; i < leaves; i++) {
+        if (mix == MIX_MIXED && i % MIXED_GROUP_SIZE == 0) {
+            parent = con_new(ws, NULL);
+            parent->layout = group_layouts[(i / MIXED_GROUP_SIZE) % 3];
+        }
+        leaf = con_new(parent, NULL);
+    }
+    return leaf;
+}
+
+static void bench_attach_detach(void) {
+    Con *parent = bench_leaf->parent;
+    con_detach(bench_leaf);
+    con_attach(bench_leaf, parent, true);
+}
+
+static void bench_render(void) {
+    tree_render();
+}
+
+static void bench_move_to_workspace(void) {
+    /* The target workspace is closed once it is empty again, so it has to be
+     * looked up (and recreated) every time. */
+    con_move_to_workspace(bench_leaf, workspace_get("bench-target"), true, true, true);
+    con_move_to_workspace(bench_leaf, bench_ws, true, true, true);
+}
+
+/* Summed up by bench_walk(), so that the walk cannot be optimized away */
+static volatile uint64_t walk_sum;
+
+/*
+ * Visits every container below con the way rendering and lookups do, reading
+ * only the fields which struct Con keeps inline.
+ *
+ */
+static uint64_t walk(Con *con) {
+    uint64_t sum = con->type + con->layout + con->rect.width + con->rect.height;
+    Con *child;
+    TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
+        sum += walk(child);
+    }
+    TAILQ_FOREACH (child, &(con->floating_head), floating_windows) {
+        sum += walk(child);
+    }
+    return sum;
+}
+
+static void bench_walk(void) {
+    walk_sum += walk(croot);
+}
+
+static void bench_flatten(void) {
+    tree_flatten(croot);
+}
+
+/* The GET_TREE reply for the benchmark's tree, recorded once */
+static json_snapshot_t *bench_snapshot;
+
+static void bench_json_yajl(void) {
+    yajl_gen gen = yajl_gen_alloc(NULL);
+    json_snapshot_replay(bench_snapshot, gen);
+    yajl_gen_free(gen);
+}
+
+static void bench_json_writer(void) {
+    uint8_t *payload;
+    size_t size;
+    json_snapshot_write(bench_snapshot, &payload, &size);
+    free(payload);
+}
+
+/*
+ * Calls fn until min_time_ns passed (at least 3 times) and returns the
+ * nanoseconds per call.
+ *
+ */
+static double run(void (*fn)(void)) {
+    /* Warm up the caches and allocations. */
+    fn();
+
+    const double start = now_ns();
+    double elapsed = 0;
+    long calls = 0;
+    long batch = 1;
+    while (calls < 3 || elapsed < min_time_ns) {
+        for (long i = 0; i < batch; i++) {
+            fn();
+        }
+        calls += batch;
+        elapsed = now_ns() - start;
+        if (batch < 1024) {
+            batch *= 2;
+        }
+    }
+    return elapsed / calls;
+}
+
+static void bench_tree(int leaves, mix_t mix) {
+    static const struct {
+        const char *name;
+        void (*fn)(void);
+    } benchmarks[] = {
+        {"attach+detach", bench_attach_detach},
+        {"tree_render", bench_render},
+        {"move_to_workspace", bench_move_to_workspace},
+        {"tree_walk", bench_walk},
+        {"tree_flatten", bench_flatten},
+        {"tree_json_yajl", bench_json_yajl},
+        {"tree_json_writer", bench_json_writer},
+    };
+
+    bench_ws = workspace_get("bench");
+    workspace_show(bench_ws);
+    bench_leaf = build_tree(bench_ws, leaves, mix);
+    tree_render();
+    bench_snapshot = json_snapshot_new();
+    dump_node_snapshot(bench_snapshot, croot);
+
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        const double ns = run(benchmarks[i].fn);
+        printf("%-8s %6d leaves  %-18s %14.0f ns/op\n",
+               mix_names[mix], leaves, benchmarks[i].name, ns);
+        fflush(stdout);
+    }
+
+    json_snapshot_free(bench_snapshot);
+
+    /* Switch away, so that the workspace can be closed with all its
+     * containers. */
+    workspace_show(workspace_get("1"));
+    tree_close_internal(bench_ws, DONT_KILL_WINDOW, false);
+}
+
+static void print_usage(const char *name) {
+    fprintf(stderr, "Usage: %s [--min-time <ms>] [<leaves>...]\n", name);
+    fprintf(stderr, "Runs the tree benchmarks with the given numbers of leaves (default: 10 100 1000 10000).\n");
+}
+
+int main(int argc, char *argv[]) {
+    static struct option long_options[] = {
+        {"min-time", required_argument, 0, 't'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}};
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "t:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 't':
+                min_time_ns = atof(optarg) * 1e6;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    static const int default_leaves[] = {10, 100, 1000, 10000};
+    int num_leaves = argc - optind;
+    int *leaves = smalloc(sizeof(int) * (num_leaves > 0 ? num_leaves : 4));
+    if (num_leaves == 0) {
+        num_leaves = 4;
+        memcpy(leaves, default_leaves, sizeof(default_leaves));
+    } else {
+        for (int i = 0; i < num_leaves; i++) {
+            leaves[i] = atoi(argv[optind + i]);
+            if (leaves[i] <= 0) {
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    main_loop = ev_default_loop(0);
+    bindings = scalloc(1, sizeof(struct bindings_head));
+    TAILQ_INIT(bindings);
+
+    xcb_get_geometry_reply_t geometry = {.width = 1280, .height = 1024};
+    tree_init(&geometry);
+    fake_outputs_init("1280x1024+0+0");
+    con_activate(con_descend_focused(output_get_content(get_first_output()->con)));
+
+    for (int i = 0; i < num_leaves; i++) {
+        for (mix_t mix = MIX_SPLIT; mix <= MIX_MIXED; mix++) {
+            bench_tree(leaves[i], mix);
+        }
+    }
+
+    free(leaves);
+    return EXIT_SUCCESS;
+}
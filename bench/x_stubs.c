@@ -0,0 +1,143 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * x_stubs.c: Replaces src/x.c and src/ewmh.c in the benchmarks, so that the
+ *            tree code runs without an X server. None of the functions talk
+ *            to X11, x_push_changes() only walks the tree like the real one
+ *            does before it sends anything.
+ *
+ */
+#include "all.h"
+
+xcb_window_t focused_id = XCB_NONE;
+xcb_window_t ewmh_window = XCB_NONE;
+
+void x_con_init(Con *con) {
+}
+
+void x_move_win(Con *src, Con *dest) {
+}
+
+bool x_con_has_frame(Con *con) {
+    return false;
+}
+
+void x_adopt_child(Con *con, bool viewable) {
+}
+
+bool x_con_child_hidden(Con *con) {
+    return false;
+}
+
+void x_reparent_child(Con *con, Con *old) {
+}
+
+void x_reinit(Con *con) {
+}
+
+void x_con_kill(Con *con) {
+}
+
+void x_con_reframe(Con *con) {
+}
+
+void x_window_kill(i3Window *win, kill_window_t kill_window) {
+}
+
+void x_draw_decoration(Con *con) {
+}
+
+bool x_con_is_idle(Con *con) {
+    return true;
+}
+
+void x_deco_cache_free(Con *con) {
+}
+
+void x_deco_recurse(Con *con) {
+}
+
+void x_push_node(Con *con) {
+}
+
+static void walk_tree(Con *con) {
+    Con *child;
+    TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
+        walk_tree(child);
+    }
+    TAILQ_FOREACH (child, &(con->floating_head), floating_windows) {
+        walk_tree(child);
+    }
+}
+
+void x_push_changes(Con *con) {
+    walk_tree(con);
+}
+
+void x_raise_con(Con *con) {
+}
+
+void x_set_name(Con *con, const char *name) {
+}
+
+void update_shmlog_atom(void) {
+}
+
+void x_set_i3_atoms(void) {
+}
+
+void x_set_warp_to(Rect *rect) {
+}
+
+void x_mask_event_mask(uint32_t mask) {
+}
+
+void x_set_shape(Con *con, xcb_shape_sk_t kind, bool enable) {
+}
+
+void ewmh_update_desktop_properties(void) {
+}
+
+void ewmh_update_current_desktop(void) {
+}
+
+void ewmh_update_wm_desktop(void) {
+}
+
+void ewmh_flush_deferred_updates(void) {
+}
+
+void ewmh_update_active_window(xcb_window_t window) {
+}
+
+void ewmh_update_visible_name(xcb_window_t window, const char *name) {
+}
+
+void ewmh_update_client_list(xcb_window_t *list, int num_windows) {
+}
+
+void ewmh_update_client_list_stacking(xcb_window_t *stack, int num_windows) {
+}
+
+void ewmh_update_sticky(xcb_window_t window, bool sticky) {
+}
+
+void ewmh_update_focused(xcb_window_t window, bool is_focused) {
+}
+
+void ewmh_setup_hints(void) {
+}
+
+void ewmh_update_workarea(void) {
+}
+
+Con *ewmh_get_workspace_by_index(uint32_t idx) {
+    return NULL;
+}
+
+uint32_t ewmh_get_workspace_index(Con *con) {
+    return 0;
+}
@@ -127,6 +127,15 @@ for my $state (@keys, '__CALL') {
     $cnt++;
 }
 say $enumfh "\n} cmdp_state;";
+say $enumfh 'typedef enum {';
+say $enumfh '    TOKEN_LITERAL,';
+say $enumfh '    TOKEN_NUMBER,';
+say $enumfh '    TOKEN_STRING,';
+say $enumfh '    TOKEN_WORD,';
+say $enumfh '    TOKEN_LINE,';
+say $enumfh '    TOKEN_END,';
+say $enumfh '    TOKEN_ERROR';
+say $enumfh '} cmdp_token_type;';
 close($enumfh);
 
 # Third step: Generate the call function.
@@ -136,6 +145,7 @@ say $callfh '#pragma once';
 say $callfh "static void GENERATED_call(Match *current_match, struct stack *stack, const int call_identifier, struct $resultname *result) {";
 say $callfh '    switch (call_identifier) {';
 my $call_id = 0;
+my @call_next_states;
 for my $state (@keys) {
     my $tokens = $states{$state};
     for my $token (@$tokens) {
@@ -170,6 +180,7 @@ for my $state (@keys) {
 
         $fmt = $funcname . $fmt;
 
+        push @call_next_states, $next_state;
         say $callfh "         case $call_id:";
         say $callfh "             result->next_state = $next_state;";
         say $callfh '#ifndef TEST_PARSER';
@@ -203,6 +214,15 @@ say $callfh '            printf("BUG in the parser. state = %d\n", call_identifi
 say $callfh '            assert(false);';
 say $callfh '    }';
 say $callfh '}';
+say $callfh '';
+# The state after a call does not depend on the call itself, which allows
+# parsing a command without executing it (see command_compile()).
+say $callfh 'static inline int GENERATED_call_next_state(const int call_identifier) {';
+say $callfh '    static const int next_states[] = {';
+say $callfh "        $_," for @call_next_states;
+say $callfh '    };';
+say $callfh '    return next_states[call_identifier];';
+say $callfh '}';
 close($callfh);
 
 # Fourth step: Generate the token datastructures.
@@ -236,7 +256,12 @@ for my $state (@keys) {
         else{
             $identifier = qq|"$token->{identifier}"|;
         }
-        say $tokfh qq|    { "$token_name", $identifier, $next_state, { $call_identifier } },|;
+        my ($type, $length) = ('TOKEN_' . uc($token_name), 0);
+        if ($token_name =~ /^'/) {
+            $type = 'TOKEN_LITERAL';
+            $length = length($token->{token}) - 2;
+        }
+        say $tokfh qq|    { "$token_name", $identifier, $next_state, { $call_identifier }, $type, $length },|;
     }
     say $tokfh '};';
 }
@@ -248,4 +273,58 @@ for my $state (@keys) {
 }
 say $tokfh '};';
 
+# Fifth step: Generate the keyword dispatch. Instead of comparing the input
+# against every literal of the current state, the parser only looks at the
+# tokens which can match the first (lowercased) character of the input: the
+# literals starting with that character and all other tokens (numbers, strings,
+# etc.), in the order of the specification.
+say $tokfh '';
+say $tokfh 'static inline int GENERATED_candidates(const cmdp_state state, const char first, const uint8_t **candidates) {';
+say $tokfh '    switch (state) {';
+for my $state (@keys) {
+    my $tokens = $states{$state};
+    die "State $state has too many tokens" if @$tokens > 255;
+    my %by_char;
+    my @others;
+    for my $idx (0 .. $#$tokens) {
+        my $name = $tokens->[$idx]->{token};
+        # The empty literal ('') matches any input.
+        if ($name =~ /^'(.)/ && length($name) > 2) {
+            push @{$by_char{ord(lc($1))}}, $idx;
+        } else {
+            push @others, $idx;
+        }
+    }
+    say $tokfh "        case $state:";
+    say $tokfh '            switch (tolower((unsigned char)first)) {';
+    for my $char (sort { $a <=> $b } keys %by_char) {
+        # Merge the literals for this character with the other tokens,
+        # keeping the order.
+        my @list = sort { $a <=> $b } (@{$by_char{$char}}, @others);
+        my $chr = chr($char);
+        $chr = '?' unless $chr =~ /^[[:graph:]]$/ && $chr ne '/' && $chr ne '*';
+        say $tokfh "                case $char: { /* $chr */";
+        say $tokfh '                    static const uint8_t list[] = {' . join(', ', @list) . '};';
+        say $tokfh '                    *candidates = list;';
+        say $tokfh '                    return ' . scalar(@list) . ';';
+        say $tokfh '                }';
+    }
+    say $tokfh '                default: {';
+    if (@others) {
+        say $tokfh '                    static const uint8_t list[] = {' . join(', ', @others) . '};';
+        say $tokfh '                    *candidates = list;';
+        say $tokfh '                    return ' . scalar(@others) . ';';
+    } else {
+        say $tokfh '                    *candidates = NULL;';
+        say $tokfh '                    return 0;';
+    }
+    say $tokfh '                }';
+    say $tokfh '            }';
+}
+say $tokfh '        default:';
+say $tokfh '            *candidates = NULL;';
+say $tokfh '            return 0;';
+say $tokfh '    }';
+say $tokfh '}';
+
 close($tokfh);
@@ -114,6 +114,9 @@ typedef struct token {
     union {
         uint16_t call_identifier;
     } extra;
+    cmdp_token_type type;
+    /* For literals: the length of the name, without the leading quote. */
+    uint16_t length;
 } cmdp_token;
 
 typedef struct tokenptr {
@@ -12,11 +12,16 @@
 #include "libi3.h"
 #include "shmlog.h"
 
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+
 #include <err.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
 #include <i3/ipc.h>
 #include <signal.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -24,16 +29,14 @@
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 
-static uint32_t wrap_count;
-
 static i3_shmlog_header *header;
-static char *logbuffer,
-    *walk;
+static char *logbuffer;
 static int ipcfd = -1;
 
 static void disable_shmlog(void) {
@@ -52,24 +55,493 @@ static void disable_shmlog(void) {
     free(reply);
 }
 
-static int check_for_wrap(void) {
-    if (wrap_count == header->wrap_count)
-        return 0;
+/*
+ * The formatted message of the record which is currently being processed.
+ *
+ */
+static char *line;
+static size_t line_len;
+static size_t line_size;
+
+static void line_reserve(const size_t len) {
+    if (line_len + len + 1 <= line_size) {
+        return;
+    }
+    while (line_len + len + 1 > line_size) {
+        line_size = (line_size == 0 ? 4096 : line_size * 2);
+    }
+    line = srealloc(line, line_size);
+}
+
+static void line_append(const char *str, const size_t len) {
+    line_reserve(len);
+    memcpy(line + line_len, str, len);
+    line_len += len;
+    line[line_len] = '\0';
+}
+
+static void line_printf(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    const int len = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+    if (len <= 0) {
+        return;
+    }
+
+    line_reserve(len);
+    va_start(args, fmt);
+    vsnprintf(line + line_len, len + 1, fmt, args);
+    va_end(args);
+    line_len += len;
+}
+
+/* Filters given on the command line. */
+static bool filter_since;
+static time_t since;
+static bool filter_until;
+static time_t until;
+static bool filter_pattern;
+static pcre2_code *pattern;
+static pcre2_match_data *match_data;
+
+static bool pattern_matches(const char *str, const size_t len) {
+    return pcre2_match(pattern, (PCRE2_SPTR)str, len, 0, 0, match_data, NULL) >= 0;
+}
+
+/* The last lines to print when -n is given: a ring of tail_size lines, of
+ * which tail_used are in use, the oldest one at tail_start. */
+static char **tail;
+static size_t tail_size;
+static size_t tail_used;
+static size_t tail_start;
+
+/*
+ * Prints the current line, or remembers it if only the last lines are
+ * printed.
+ *
+ */
+static void emit_line(void) {
+    if (filter_pattern && !pattern_matches(line, line_len)) {
+        return;
+    }
+    if (tail == NULL) {
+        fwrite(line, line_len, 1, stdout);
+        return;
+    }
+    if (tail_size == 0) {
+        return;
+    }
+    const size_t idx = (tail_start + tail_used) % tail_size;
+    if (tail_used == tail_size) {
+        free(tail[tail_start]);
+        tail_start = (tail_start + 1) % tail_size;
+    } else {
+        tail_used++;
+    }
+    tail[idx] = sstrndup(line, line_len);
+}
+
+static void print_tail(void) {
+    for (size_t i = 0; i < tail_used; i++) {
+        char *str = tail[(tail_start + i) % tail_size];
+        fputs(str, stdout);
+        free(str);
+    }
+    tail_used = 0;
+}
+
+/*
+ * Formats the argument of the given conversion, which is read from *payload.
+ * Returns false if the payload is too short.
+ *
+ */
+static bool format_conversion(const printf_conversion_t *conv, const char **payload, const char *end) {
+#define READ(type, var)                             \
+    type var;                                       \
+    do {                                            \
+        if ((size_t)(end - *payload) < sizeof(var)) \
+            return false;                           \
+        memcpy(&var, *payload, sizeof(var));        \
+        *payload += sizeof(var);                    \
+    } while (0)
+
+    int32_t width = 0, precision = -1;
+    if (conv->width_star) {
+        READ(int32_t, value);
+        width = value;
+    }
+    if (conv->precision_star) {
+        READ(int32_t, value);
+        precision = value;
+    }
 
-    /* The log wrapped. Print the remaining content and reset walk to the top
-     * of the log. */
-    wrap_count = header->wrap_count;
-    const int len = (logbuffer + header->offset_last_wrap) - walk;
-    swrite(STDOUT_FILENO, walk, len);
-    walk = logbuffer + sizeof(i3_shmlog_header);
-    return 1;
+    /* Copy the conversion specification, replacing "*" by the numbers. A
+     * negative precision is taken as if it was omitted. */
+    char spec[64];
+    size_t len = 0;
+    bool width_done = !conv->width_star;
+    for (const char *walk = conv->start; walk < conv->end; walk++) {
+        if (len + 16 >= sizeof(spec)) {
+            return false;
+        }
+        if (*walk == '.' && walk[1] == '*' && precision < 0) {
+            walk++;
+        } else if (*walk == '*') {
+            len += snprintf(spec + len, sizeof(spec) - len, "%d", (width_done ? precision : width));
+            width_done = true;
+        } else {
+            spec[len++] = *walk;
+        }
+    }
+    spec[len] = '\0';
+
+    switch (conv->type) {
+        case PRINTF_ARG_NONE:
+            line_append("%", 1);
+            break;
+        case PRINTF_ARG_UNSUPPORTED:
+            return false;
+        case PRINTF_ARG_INT: {
+            READ(int32_t, value);
+            line_printf(spec, (int)value);
+            break;
+        }
+        case PRINTF_ARG_LONG: {
+            READ(int64_t, value);
+            line_printf(spec, (long)value);
+            break;
+        }
+        case PRINTF_ARG_LONG_LONG: {
+            READ(int64_t, value);
+            line_printf(spec, (long long)value);
+            break;
+        }
+        case PRINTF_ARG_INTMAX: {
+            READ(int64_t, value);
+            line_printf(spec, (intmax_t)value);
+            break;
+        }
+        case PRINTF_ARG_SIZE: {
+            READ(int64_t, value);
+            line_printf(spec, (size_t)value);
+            break;
+        }
+        case PRINTF_ARG_PTRDIFF: {
+            READ(int64_t, value);
+            line_printf(spec, (ptrdiff_t)value);
+            break;
+        }
+        case PRINTF_ARG_DOUBLE: {
+            READ(double, value);
+            line_printf(spec, value);
+            break;
+        }
+        case PRINTF_ARG_POINTER: {
+            READ(uint64_t, value);
+            line_printf(spec, (void *)(uintptr_t)value);
+            break;
+        }
+        case PRINTF_ARG_STRING: {
+            READ(uint32_t, str_len);
+            if (str_len == UINT32_MAX) {
+                line_printf(spec, (char *)NULL);
+                break;
+            }
+            if ((size_t)(end - *payload) < str_len) {
+                return false;
+            }
+            char *str = sstrndup(*payload, str_len);
+            *payload += str_len;
+            line_printf(spec, str);
+            free(str);
+            break;
+        }
+    }
+#undef READ
+    return true;
 }
 
-static void print_till_end(void) {
-    check_for_wrap();
-    const int len = (logbuffer + header->offset_next_write) - walk;
-    swrite(STDOUT_FILENO, walk, len);
-    walk += len;
+/*
+ * Formats the given record into line. Records in binary form are formatted
+ * using the format string they refer to in the call site table.
+ *
+ */
+static void format_record(const i3_shmlog_record *record, const char *payload) {
+    line_len = 0;
+    line_reserve(0);
+    line[0] = '\0';
+
+    if (record->site == 0) {
+        line_append(payload, record->length);
+        return;
+    }
+    if (record->site < header->offset_sites ||
+        record->site >= header->offset_sites + header->sites_size) {
+        line_append("<invalid log record>\n", strlen("<invalid log record>\n"));
+        return;
+    }
+
+    /* Same time prefix as in log.c vlog() */
+    char prefix[64];
+    const time_t t = record->time;
+    struct tm tm;
+    const size_t prefix_len = strftime(prefix, sizeof(prefix), "%x %X - ", localtime_r(&t, &tm));
+    line_append(prefix, prefix_len);
+
+    const char *walk = logbuffer + record->site;
+    const char *end = payload + record->length;
+    printf_conversion_t conv;
+    while (printf_next_conversion(walk, &conv)) {
+        line_append(walk, conv.start - walk);
+        if (!format_conversion(&conv, &payload, end)) {
+            line_append("<invalid log record>\n", strlen("<invalid log record>\n"));
+            return;
+        }
+        walk = conv.end;
+    }
+    line_append(walk, strlen(walk));
+}
+
+/*
+ * The position of i3 in a ring buffer, see i3_shmlog_ring.
+ *
+ */
+typedef struct log_position {
+    uint32_t wrap_count;
+    uint32_t oldest;
+    uint32_t last_wrap;
+    uint32_t next_write;
+} log_position;
+
+/*
+ * Reads a consistent position, i.e. one in which all offsets belong to the
+ * same wrap count.
+ *
+ */
+static void load_position(const i3_shmlog_ring *ring, log_position *pos) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    do {
+        pos->wrap_count = __atomic_load_n(&(ring->wrap_count), __ATOMIC_ACQUIRE);
+        pos->oldest = __atomic_load_n(&(ring->offset_oldest), __ATOMIC_ACQUIRE);
+        pos->last_wrap = __atomic_load_n(&(ring->offset_last_wrap), __ATOMIC_ACQUIRE);
+        pos->next_write = __atomic_load_n(&(ring->offset_next_write), __ATOMIC_ACQUIRE);
+    } while (pos->wrap_count != __atomic_load_n(&(ring->wrap_count), __ATOMIC_ACQUIRE));
+}
+
+/* The rings given with -r, as a comma-separated list (NULL: all rings). */
+static char *ring_filter;
+
+/*
+ * Returns whether the ring with the given name should be printed.
+ *
+ */
+static bool ring_wanted(const char *name) {
+    if (ring_filter == NULL) {
+        return true;
+    }
+    const size_t len = strlen(name);
+    for (const char *walk = ring_filter; *walk != '\0';) {
+        const size_t tok_len = strcspn(walk, ",");
+        if (tok_len == len && strncmp(walk, name, len) == 0) {
+            return true;
+        }
+        walk += tok_len;
+        walk += (*walk == ',');
+    }
+    return false;
+}
+
+/*
+ * Reads the records of one ring. The records are identified by the wrap count
+ * at the time they were written (their lap) and their offset. We read all
+ * records up to the position at the time we started.
+ *
+ */
+typedef struct ring_reader {
+    const i3_shmlog_ring *ring;
+    log_position end_pos;
+    uint32_t lap;
+    uint32_t offset;
+    uint32_t end;
+
+    /* Whether record holds the header of the record at offset. */
+    bool loaded;
+    i3_shmlog_record record;
+} ring_reader;
+
+/*
+ * Loads the header of the next record, moving on to the records written since
+ * the last wrap at the end of the older ones. Sets loaded to false once all
+ * records were read.
+ *
+ */
+static void reader_load(ring_reader *r) {
+    r->loaded = false;
+    for (;;) {
+        if (r->offset > r->end || r->end - r->offset < sizeof(i3_shmlog_record)) {
+            if (r->lap == r->end_pos.wrap_count) {
+                return;
+            }
+            r->lap = r->end_pos.wrap_count;
+            r->offset = r->ring->offset_start;
+            r->end = r->end_pos.next_write;
+            continue;
+        }
+        memcpy(&(r->record), logbuffer + r->offset, sizeof(r->record));
+        r->loaded = true;
+        return;
+    }
+}
+
+/*
+ * Starts reading the given ring. Returns false if its header is invalid.
+ *
+ */
+static bool reader_init(ring_reader *r, const i3_shmlog_ring *ring) {
+    r->ring = ring;
+    load_position(ring, &(r->end_pos));
+    const uint32_t ring_end = ring->offset_start + ring->size;
+    if (ring->offset_start > header->size || ring->size > header->size - ring->offset_start ||
+        r->end_pos.next_write > ring_end || r->end_pos.last_wrap > ring_end) {
+        return false;
+    }
+
+    /* Start with the records written before the last wrap, if any. */
+    r->lap = r->end_pos.wrap_count - 1;
+    r->offset = r->end_pos.oldest;
+    r->end = r->end_pos.last_wrap;
+    if (r->end_pos.oldest >= r->end_pos.last_wrap) {
+        r->lap = r->end_pos.wrap_count;
+        r->offset = ring->offset_start;
+        r->end = r->end_pos.next_write;
+    }
+    reader_load(r);
+    return true;
+}
+
+/*
+ * Checks that i3 did not overwrite the current record while we read it: i3
+ * only overwrites records written before its last wrap and moves
+ * offset_oldest past them before doing so. If it did, the reader continues
+ * with the oldest record and false is returned.
+ *
+ */
+static bool reader_intact(ring_reader *r) {
+    log_position now;
+    load_position(r->ring, &now);
+    if (r->lap == now.wrap_count ||
+        (r->lap + 1 == now.wrap_count && r->offset >= now.oldest)) {
+        return true;
+    }
+
+    /* i3 caught up with us, continue with its oldest record. */
+    if (now.wrap_count == r->end_pos.wrap_count) {
+        r->offset = now.oldest;
+    } else if (now.wrap_count == r->end_pos.wrap_count + 1) {
+        r->lap = r->end_pos.wrap_count;
+        r->offset = now.oldest;
+        r->end = r->end_pos.next_write;
+    } else {
+        r->loaded = false;
+        return false;
+    }
+    reader_load(r);
+    return false;
+}
+
+/*
+ * Prints the log, reading the records in place. i3 keeps on writing while we
+ * read the log. The rings are merged in the order the records were written,
+ * by always printing the record with the lowest sequence number next.
+ *
+ */
+static void print_log(void) {
+    ring_reader readers[I3_SHMLOG_MAX_RINGS];
+    uint32_t num_readers = 0;
+    for (uint32_t i = 0; i < header->num_rings; i++) {
+        if (!ring_wanted(header->rings[i].name)) {
+            continue;
+        }
+        if (reader_init(&readers[num_readers], &(header->rings[i]))) {
+            num_readers++;
+        }
+    }
+
+    bool lost = false;
+    for (;;) {
+        ring_reader *r = NULL;
+        for (uint32_t i = 0; i < num_readers; i++) {
+            if (readers[i].loaded && (r == NULL || readers[i].record.seq < r->record.seq)) {
+                r = &readers[i];
+            }
+        }
+        if (r == NULL) {
+            break;
+        }
+
+        const i3_shmlog_record record = r->record;
+        const uint32_t payload = r->offset + sizeof(record);
+        const bool complete = (record.length <= r->end - payload);
+        const bool wanted = complete &&
+                            (!filter_since || record.time >= since) &&
+                            (!filter_until || record.time <= until);
+        if (wanted) {
+            format_record(&record, logbuffer + payload);
+        }
+
+        if (!reader_intact(r)) {
+            lost = true;
+            continue;
+        }
+
+        if (!complete) {
+            r->loaded = false;
+            continue;
+        }
+        if (wanted) {
+            emit_line();
+        }
+        r->offset = payload + record.length;
+        reader_load(r);
+    }
+
+    print_tail();
+    fflush(stdout);
+    if (lost) {
+        fprintf(stderr, "i3-dump-log: some log records were overwritten while reading the log\n");
+    }
+}
+
+/*
+ * Parses a time given on the command line: either seconds since the epoch or,
+ * when prefixed by a minus sign, a number of seconds (or minutes, hours with
+ * the suffix m or h) before now.
+ *
+ */
+static time_t parse_time(const char *str) {
+    const bool relative = (*str == '-');
+    char *end;
+    errno = 0;
+    long long value = strtoll(str + (relative ? 1 : 0), &end, 10);
+    if (errno != 0 || end == str || value < 0) {
+        errx(EXIT_FAILURE, "Invalid time \"%s\"", str);
+    }
+    if (!relative) {
+        if (*end != '\0') {
+            errx(EXIT_FAILURE, "Invalid time \"%s\"", str);
+        }
+        return (time_t)value;
+    }
+
+    if (strcmp(end, "h") == 0) {
+        value *= 60 * 60;
+    } else if (strcmp(end, "m") == 0) {
+        value *= 60;
+    } else if (*end != '\0' && strcmp(end, "s") != 0) {
+        errx(EXIT_FAILURE, "Invalid time \"%s\"", str);
+    }
+    return time(NULL) - (time_t)value;
 }
 
 void errorlog(char *fmt, ...) {
@@ -85,6 +557,7 @@ int main(int argc, char *argv[]) {
     bool verbose = false;
 #if !defined(__OpenBSD__)
     bool follow = false;
+    bool lossy = false;
 #endif
 
     static struct option long_options[] = {
@@ -92,15 +565,21 @@ int main(int argc, char *argv[]) {
         {"verbose", no_argument, 0, 'V'},
 #if !defined(__OpenBSD__)
         {"follow", no_argument, 0, 'f'},
+        {"lossy", no_argument, 0, 'l'},
 #endif
+        {"since", required_argument, 0, 'a'},
+        {"until", required_argument, 0, 'b'},
+        {"grep", required_argument, 0, 'g'},
+        {"lines", required_argument, 0, 'n'},
+        {"rings", required_argument, 0, 'r'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
 
 #if !defined(__OpenBSD__)
-    char *options_string = "s:vfVh";
+    char *options_string = "s:vflVha:b:g:n:r:";
 #else
-    char *options_string = "vVh";
+    char *options_string = "vVha:b:g:n:r:";
 #endif
 
     while ((o = getopt_long(argc, argv, options_string, long_options, &option_index)) != -1) {
@@ -112,13 +591,45 @@ int main(int argc, char *argv[]) {
 #if !defined(__OpenBSD__)
         } else if (o == 'f') {
             follow = true;
+        } else if (o == 'l') {
+            lossy = true;
 #endif
+        } else if (o == 'a') {
+            filter_since = true;
+            since = parse_time(optarg);
+        } else if (o == 'b') {
+            filter_until = true;
+            until = parse_time(optarg);
+        } else if (o == 'g') {
+            int error;
+            PCRE2_SIZE error_offset;
+            pattern = pcre2_compile((PCRE2_SPTR)optarg, PCRE2_ZERO_TERMINATED, PCRE2_UTF | PCRE2_UCP,
+                                    &error, &error_offset, NULL);
+            if (pattern == NULL) {
+                PCRE2_UCHAR msg[256];
+                pcre2_get_error_message(error, msg, sizeof(msg));
+                errx(EXIT_FAILURE, "Invalid pattern \"%s\" at %zu: %s", optarg, (size_t)error_offset, msg);
+            }
+            match_data = pcre2_match_data_create_from_pattern(pattern, NULL);
+            filter_pattern = true;
+        } else if (o == 'n') {
+            char *end;
+            errno = 0;
+            const long value = strtol(optarg, &end, 10);
+            if (errno != 0 || end == optarg || *end != '\0' || value < 0) {
+                errx(EXIT_FAILURE, "Invalid number of lines \"%s\"", optarg);
+            }
+            tail_size = value;
+            tail = scalloc(tail_size + 1, sizeof(char *));
+        } else if (o == 'r') {
+            free(ring_filter);
+            ring_filter = sstrdup(optarg);
         } else if (o == 'h') {
             printf("i3-dump-log " I3_VERSION "\n");
 #if !defined(__OpenBSD__)
-            printf("i3-dump-log [-fhVv]\n");
+            printf("i3-dump-log [-fhlVv] [-a <time>] [-b <time>] [-g <pattern>] [-n <lines>] [-r <rings>]\n");
 #else
-            printf("i3-dump-log [-hVv]\n");
+            printf("i3-dump-log [-hVv] [-a <time>] [-b <time>] [-g <pattern>] [-n <lines>] [-r <rings>]\n");
 #endif
             return 0;
         }
@@ -197,33 +708,25 @@ int main(int argc, char *argv[]) {
 
     header = (i3_shmlog_header *)logbuffer;
 
-    if (verbose) {
-        printf("next_write = %d, last_wrap = %d, logbuffer_size = %d, shmname = %s\n",
-               header->offset_next_write, header->offset_last_wrap, header->size, shmname);
+    if (header->size > statbuf.st_size ||
+        header->offset_sites + header->sites_size > header->size ||
+        header->num_rings > I3_SHMLOG_MAX_RINGS) {
+        errx(EXIT_FAILURE, "Invalid SHM log header: possible i3-dump-log and i3 version mismatch");
     }
-    free(shmname);
-    walk = logbuffer + header->offset_next_write;
-
-    /* We first need to print old content in case there was at least one
-     * wrapping already. */
 
-    if (*walk != '\0') {
-        /* In case there was a write to the buffer already, skip the first
-         * old line, it very likely is mangled. Not a problem, though, the log
-         * is chatty enough to have plenty lines left. */
-        while (*walk != '\n')
-            walk++;
-        walk++;
+    if (verbose) {
+        printf("logbuffer_size = %d, sites_used = %d, shmname = %s\n",
+               header->size, header->sites_used, shmname);
+        for (uint32_t i = 0; i < header->num_rings; i++) {
+            const i3_shmlog_ring *ring = &(header->rings[i]);
+            printf("ring %.*s: size = %d, next_write = %d, last_wrap = %d, oldest = %d, wrap_count = %d\n",
+                   (int)sizeof(ring->name), ring->name, ring->size, ring->offset_next_write,
+                   ring->offset_last_wrap, ring->offset_oldest, ring->wrap_count);
+        }
     }
+    free(shmname);
 
-    /* In case there was no wrapping, this is a no-op, otherwise it prints the
-     * old lines. */
-    wrap_count = 0;
-    check_for_wrap();
-
-    /* Then start from the beginning and print the newer lines */
-    walk = logbuffer + sizeof(i3_shmlog_header);
-    print_till_end();
+    print_log();
 
 #if !defined(__OpenBSD__)
     if (!follow) {
@@ -250,6 +753,13 @@ int main(int argc, char *argv[]) {
         err(EXIT_FAILURE, "Could not connect to i3 on socket %s", log_stream_socket_path);
     }
 
+    /* Ask i3 to drop lines instead of disconnecting us if we fall behind. */
+    if (lossy && writeall(sockfd, "lossy\n", strlen("lossy\n")) == -1) {
+        err(EXIT_FAILURE, "Could not write to i3 on socket %s", log_stream_socket_path);
+    }
+
+    line_len = 0;
+
     /* Same size as the buffer used in log.c vlog(): */
     char buf[4096];
     for (;;) {
@@ -261,7 +771,22 @@ int main(int argc, char *argv[]) {
             exit(0); /* i3 closed the socket */
         }
         buf[n] = '\0';
-        swrite(STDOUT_FILENO, buf, n);
+        if (!filter_pattern) {
+            swrite(STDOUT_FILENO, buf, n);
+            continue;
+        }
+
+        /* Split the stream into lines to match them against the pattern. */
+        line_append(buf, n);
+        char *walk = line, *nl;
+        while ((nl = memchr(walk, '\n', line + line_len - walk)) != NULL) {
+            if (pattern_matches(walk, nl - walk)) {
+                swrite(STDOUT_FILENO, walk, nl - walk + 1);
+            }
+            walk = nl + 1;
+        }
+        line_len -= walk - line;
+        memmove(line, walk, line_len + 1);
     }
 
 #endif
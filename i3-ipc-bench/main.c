@@ -0,0 +1,571 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * i3-ipc-bench/main.c: Measures the IPC throughput of a running i3 instance
+ * with many subscribers: the fan-out latency of tick and workspace events,
+ * the events per second i3 delivers before the clients fall behind and the
+ * GET_TREE latency for growing trees.
+ *
+ * The benchmark changes the layout of the running instance (it switches
+ * workspaces and opens containers), so run it against a nested i3, the same
+ * way the testcases do:
+ *
+ *     Xvfb :99 &
+ *     DISPLAY=:99 i3 -c testcases/i3-test.config &
+ *     DISPLAY=:99 i3-ipc-bench
+ *
+ */
+#include "libi3.h"
+
+#include <err.h>
+#include <getopt.h>
+#include <i3/ipc.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <yajl/yajl_parse.h>
+
+/*
+ * Having verboselog() and errorlog() is necessary when using libi3.
+ *
+ */
+void verboselog(char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf(stdout, fmt, args);
+    va_end(args);
+}
+
+void errorlog(char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+/* Gives up if i3 does not deliver an event within this time */
+#define EVENT_TIMEOUT_MS 10000
+
+/* The number of containers opened (or killed) with a single command */
+#define COMMAND_BATCH 100
+
+#define TICK_PREFIX "i3-ipc-bench "
+
+/* The connection which sends the requests */
+static int control;
+
+static int *subscribers;
+static int num_subscribers = 16;
+
+/* The most bytes that were waiting in the socket of a single subscriber */
+static int peak_unread;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/*
+ * Receives a message and returns its payload as a NUL-terminated string, which
+ * has to be freed by the caller.
+ *
+ */
+static char *recv_message(int fd, uint32_t *type) {
+    uint32_t length;
+    uint8_t *payload;
+    const int ret = ipc_recv_message(fd, type, &length, &payload);
+    if (ret == -2) {
+        errx(EXIT_FAILURE, "i3 closed the connection");
+    }
+    if (ret == -1) {
+        err(EXIT_FAILURE, "IPC: read()");
+    }
+    char *str = sstrndup((const char *)payload, length);
+    free(payload);
+    return str;
+}
+
+static void send_message(int fd, uint32_t type, const char *payload) {
+    if (ipc_send_message(fd, strlen(payload), type, (const uint8_t *)payload) == -1) {
+        err(EXIT_FAILURE, "IPC: write()");
+    }
+}
+
+/*
+ * Sends a request on the control connection and returns the reply.
+ *
+ */
+static char *request(uint32_t type, const char *payload) {
+    send_message(control, type, payload);
+    uint32_t reply_type;
+    char *reply = recv_message(control, &reply_type);
+    if (reply_type != type) {
+        errx(EXIT_FAILURE, "IPC: Received reply of type %d but expected %d", reply_type, type);
+    }
+    return reply;
+}
+
+static void run_command(const char *command) {
+    char *reply = request(I3_IPC_MESSAGE_TYPE_RUN_COMMAND, command);
+    if (strstr(reply, "\"success\":false") != NULL) {
+        errx(EXIT_FAILURE, "Command \"%s\" failed: %s", command, reply);
+    }
+    free(reply);
+}
+
+/*
+ * Records how many bytes are waiting in the socket of the subscriber.
+ *
+ */
+static void sample_unread(int fd) {
+    int unread;
+    if (ioctl(fd, FIONREAD, &unread) == 0 && unread > peak_unread) {
+        peak_unread = unread;
+    }
+}
+
+/*
+ * Returns the index of the given tick event or -1 if it was not sent by the
+ * benchmark.
+ *
+ */
+static long tick_index(const char *event) {
+    const char *payload = strstr(event, "\"payload\":\"" TICK_PREFIX);
+    if (payload == NULL) {
+        return -1;
+    }
+    return atol(payload + strlen("\"payload\":\"" TICK_PREFIX));
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void print_percentiles(const char *name, double *values, size_t num) {
+    qsort(values, num, sizeof(double), compare_doubles);
+    printf("%-36s p50 %9.1f us  p90 %9.1f us  p99 %9.1f us  max %9.1f us\n",
+           name,
+           values[num / 2],
+           values[num * 9 / 10],
+           values[num * 99 / 100],
+           values[num - 1]);
+    fflush(stdout);
+}
+
+/*
+ * Waits until every subscriber received an event of the given type which
+ * contains needle and stores the latencies relative to sent (in µs) in
+ * latencies. Other events are skipped.
+ *
+ */
+static void collect(double sent, uint32_t type, const char *needle, double *latencies) {
+    struct pollfd *fds = scalloc(num_subscribers, sizeof(struct pollfd));
+    int *index = scalloc(num_subscribers, sizeof(int));
+    int waiting = num_subscribers;
+    for (int i = 0; i < num_subscribers; i++) {
+        fds[i].fd = subscribers[i];
+        fds[i].events = POLLIN;
+        index[i] = i;
+    }
+
+    while (waiting > 0) {
+        const int ready = poll(fds, waiting, EVENT_TIMEOUT_MS);
+        if (ready == -1) {
+            err(EXIT_FAILURE, "poll()");
+        }
+        if (ready == 0) {
+            errx(EXIT_FAILURE, "%d subscribers did not receive the event within %d ms", waiting, EVENT_TIMEOUT_MS);
+        }
+
+        for (int i = waiting - 1; i >= 0; i--) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP))) {
+                continue;
+            }
+            sample_unread(fds[i].fd);
+            uint32_t event_type;
+            char *event = recv_message(fds[i].fd, &event_type);
+            const bool match = (event_type == type && strstr(event, needle) != NULL);
+            free(event);
+            if (!match) {
+                continue;
+            }
+
+            latencies[index[i]] = now_us() - sent;
+            waiting--;
+            fds[i] = fds[waiting];
+            index[i] = index[waiting];
+        }
+    }
+
+    free(index);
+    free(fds);
+}
+
+/*
+ * Sends one tick at a time and measures how long it takes until every
+ * subscriber received it.
+ *
+ */
+static void bench_tick_latency(int events) {
+    double *latencies = smalloc(sizeof(double) * events * num_subscribers);
+    for (int i = 0; i < events; i++) {
+        char *payload;
+        sasprintf(&payload, TICK_PREFIX "%d", i);
+        const double sent = now_us();
+        send_message(control, I3_IPC_MESSAGE_TYPE_SEND_TICK, payload);
+        collect(sent, I3_IPC_EVENT_TICK, payload, latencies + (size_t)i * num_subscribers);
+        free(payload);
+        free(recv_message(control, &(uint32_t){0}));
+    }
+
+    char *name;
+    sasprintf(&name, "tick fan-out (%d subscribers)", num_subscribers);
+    print_percentiles(name, latencies, (size_t)events * num_subscribers);
+    free(name);
+    free(latencies);
+}
+
+/*
+ * Sends the ticks as fast as i3 accepts them while the subscribers read them
+ * and reports the events per second delivered to all subscribers, the latency
+ * of the queued ticks and the most bytes which were waiting for a subscriber.
+ *
+ */
+static void bench_tick_throughput(int events) {
+    const size_t total = (size_t)events * num_subscribers;
+    double *sent = smalloc(sizeof(double) * events);
+    double *latencies = smalloc(sizeof(double) * total);
+    size_t delivered = 0;
+    int num_sent = 0;
+    int replies = 0;
+
+    /* The subscribers come first, the control connection last. */
+    struct pollfd *fds = scalloc(num_subscribers + 1, sizeof(struct pollfd));
+    for (int i = 0; i < num_subscribers; i++) {
+        fds[i].fd = subscribers[i];
+        fds[i].events = POLLIN;
+    }
+    fds[num_subscribers].fd = control;
+    fds[num_subscribers].events = POLLIN;
+
+    peak_unread = 0;
+    const double start = now_us();
+    while (delivered < total || replies < events) {
+        if (num_sent < events) {
+            char *payload;
+            sasprintf(&payload, TICK_PREFIX "%d", num_sent);
+            sent[num_sent] = now_us();
+            send_message(control, I3_IPC_MESSAGE_TYPE_SEND_TICK, payload);
+            free(payload);
+            num_sent++;
+        }
+
+        const int ready = poll(fds, num_subscribers + 1, (num_sent < events ? 0 : EVENT_TIMEOUT_MS));
+        if (ready == -1) {
+            err(EXIT_FAILURE, "poll()");
+        }
+        if (ready == 0 && num_sent == events) {
+            errx(EXIT_FAILURE, "Only %zu of %zu ticks were delivered within %d ms", delivered, total, EVENT_TIMEOUT_MS);
+        }
+
+        for (int i = 0; i <= num_subscribers; i++) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP))) {
+                continue;
+            }
+            if (i == num_subscribers) {
+                free(recv_message(control, &(uint32_t){0}));
+                replies++;
+                continue;
+            }
+
+            sample_unread(fds[i].fd);
+            uint32_t event_type;
+            char *event = recv_message(fds[i].fd, &event_type);
+            const long index = (event_type == I3_IPC_EVENT_TICK ? tick_index(event) : -1);
+            free(event);
+            if (index >= 0 && index < num_sent) {
+                latencies[delivered++] = now_us() - sent[index];
+            }
+        }
+    }
+    const double elapsed = now_us() - start;
+
+    printf("tick throughput (%d subscribers)      %zu events in %.3f s, %.0f events/s, peak unread %d bytes\n",
+           num_subscribers, total, elapsed / 1e6, total / (elapsed / 1e6), peak_unread);
+    print_percentiles("tick throughput latency", latencies, total);
+
+    free(fds);
+    free(latencies);
+    free(sent);
+}
+
+/*
+ * Switches between two workspaces using RUN_COMMAND and measures how long it
+ * takes until every subscriber received the workspace focus event.
+ *
+ */
+static void bench_workspace_latency(int switches) {
+    double *latencies = smalloc(sizeof(double) * switches * num_subscribers);
+    for (int i = 0; i < switches; i++) {
+        char *command;
+        sasprintf(&command, "workspace i3-ipc-bench-%c", (i % 2 ? 'b' : 'a'));
+        const double sent = now_us();
+        send_message(control, I3_IPC_MESSAGE_TYPE_RUN_COMMAND, command);
+        collect(sent, I3_IPC_EVENT_WORKSPACE, "\"change\":\"focus\"", latencies + (size_t)i * num_subscribers);
+        free(command);
+        free(recv_message(control, &(uint32_t){0}));
+    }
+
+    char *name;
+    sasprintf(&name, "workspace fan-out (%d subscribers)", num_subscribers);
+    print_percentiles(name, latencies, (size_t)switches * num_subscribers);
+    free(name);
+    free(latencies);
+}
+
+/*
+ * Runs the given command count times, COMMAND_BATCH commands per message.
+ *
+ */
+static void run_commands(const char *command, int count) {
+    while (count > 0) {
+        const int batch = (count < COMMAND_BATCH ? count : COMMAND_BATCH);
+        char *commands = scalloc(batch, strlen(command) + 2);
+        for (int i = 0; i < batch; i++) {
+            strcat(commands, command);
+            strcat(commands, ";");
+        }
+        run_command(commands);
+        free(commands);
+        count -= batch;
+    }
+}
+
+/*
+ * Opens containers on a new workspace until it contains each of the given
+ * numbers of containers and measures the GET_TREE round trip, which is
+ * dominated by the serialization of the tree for larger trees.
+ *
+ */
+static void bench_get_tree(const int *sizes, int num_sizes, int repetitions) {
+    double *latencies = smalloc(sizeof(double) * repetitions);
+    int containers = 0;
+
+    run_command("workspace i3-ipc-bench-tree");
+    for (int i = 0; i < num_sizes; i++) {
+        run_commands("open", sizes[i] - containers);
+        containers = sizes[i];
+
+        size_t length = 0;
+        for (int j = 0; j < repetitions; j++) {
+            const double start = now_us();
+            char *reply = request(I3_IPC_MESSAGE_TYPE_GET_TREE, "");
+            latencies[j] = now_us() - start;
+            length = strlen(reply);
+            free(reply);
+        }
+
+        char *name;
+        sasprintf(&name, "get_tree (%d containers, %zu bytes)", containers, length);
+        print_percentiles(name, latencies, repetitions);
+        free(name);
+    }
+    run_commands("kill", containers);
+
+    free(latencies);
+}
+
+static char *last_key;
+static char *current_name;
+static char *focused_name;
+
+static int workspace_map_key_cb(void *params, const unsigned char *key, size_t len) {
+    free(last_key);
+    last_key = sstrndup((const char *)key, len);
+    return 1;
+}
+
+static int workspace_string_cb(void *params, const unsigned char *val, size_t len) {
+    if (strcmp(last_key, "name") == 0) {
+        free(current_name);
+        current_name = sstrndup((const char *)val, len);
+    }
+    return 1;
+}
+
+static int workspace_boolean_cb(void *params, int val) {
+    if (strcmp(last_key, "focused") == 0 && val && current_name != NULL) {
+        free(focused_name);
+        focused_name = sstrdup(current_name);
+    }
+    return 1;
+}
+
+/*
+ * Returns the name of the focused workspace, so that it can be shown again
+ * after the benchmark.
+ *
+ */
+static char *get_focused_workspace(void) {
+    static yajl_callbacks callbacks = {
+        .yajl_boolean = workspace_boolean_cb,
+        .yajl_string = workspace_string_cb,
+        .yajl_map_key = workspace_map_key_cb,
+    };
+
+    char *reply = request(I3_IPC_MESSAGE_TYPE_GET_WORKSPACES, "");
+    yajl_handle handle = yajl_alloc(&callbacks, NULL, NULL);
+    if (yajl_parse(handle, (const unsigned char *)reply, strlen(reply)) != yajl_status_ok ||
+        yajl_complete_parse(handle) != yajl_status_ok) {
+        errx(EXIT_FAILURE, "IPC: Could not parse the GET_WORKSPACES reply");
+    }
+    yajl_free(handle);
+    free(reply);
+    free(last_key);
+    free(current_name);
+    last_key = NULL;
+    current_name = NULL;
+
+    char *name = focused_name;
+    focused_name = NULL;
+    return name;
+}
+
+/*
+ * Parses a comma separated list of positive numbers.
+ *
+ */
+static int parse_sizes(const char *str, int **sizes) {
+    int num = 0;
+    *sizes = NULL;
+    char *copy = sstrdup(str);
+    for (char *tok = strtok(copy, ","); tok != NULL; tok = strtok(NULL, ",")) {
+        const int size = atoi(tok);
+        if (size <= 0 || (num > 0 && size < (*sizes)[num - 1])) {
+            errx(EXIT_FAILURE, "Invalid tree sizes \"%s\", expected increasing numbers", str);
+        }
+        *sizes = srealloc(*sizes, sizeof(int) * (num + 1));
+        (*sizes)[num++] = size;
+    }
+    free(copy);
+    if (num == 0) {
+        errx(EXIT_FAILURE, "Invalid tree sizes \"%s\"", str);
+    }
+    return num;
+}
+
+static void print_usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-s <socket>] [-n <subscribers>] [-e <events>] [-t <sizes>] [-r <repetitions>]\n", name);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "  -n, --subscribers  number of connections subscribed to tick and workspace events (default: 16)\n");
+    fprintf(stderr, "  -e, --events       ticks and workspace switches per measurement (default: 1000)\n");
+    fprintf(stderr, "  -t, --tree-sizes   increasing numbers of containers for GET_TREE (default: 10,100,1000)\n");
+    fprintf(stderr, "  -r, --repetitions  GET_TREE requests per tree size (default: 50)\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "The benchmark switches workspaces and opens containers, so run it against\n");
+    fprintf(stderr, "an i3 in Xvfb, like the testcases do.\n");
+}
+
+int main(int argc, char *argv[]) {
+    char *socket_path = NULL;
+    int events = 1000;
+    int repetitions = 50;
+    int *sizes = NULL;
+    int num_sizes = parse_sizes("10,100,1000", &sizes);
+
+    static struct option long_options[] = {
+        {"socket", required_argument, 0, 's'},
+        {"subscribers", required_argument, 0, 'n'},
+        {"events", required_argument, 0, 'e'},
+        {"tree-sizes", required_argument, 0, 't'},
+        {"repetitions", required_argument, 0, 'r'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}};
+
+    int o;
+    while ((o = getopt_long(argc, argv, "s:n:e:t:r:h", long_options, NULL)) != -1) {
+        switch (o) {
+            case 's':
+                free(socket_path);
+                socket_path = sstrdup(optarg);
+                break;
+            case 'n':
+                num_subscribers = atoi(optarg);
+                break;
+            case 'e':
+                events = atoi(optarg);
+                break;
+            case 't':
+                free(sizes);
+                num_sizes = parse_sizes(optarg, &sizes);
+                break;
+            case 'r':
+                repetitions = atoi(optarg);
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (num_subscribers <= 0 || events <= 0 || repetitions <= 0) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    control = ipc_connect(socket_path);
+    subscribers = smalloc(sizeof(int) * num_subscribers);
+    for (int i = 0; i < num_subscribers; i++) {
+        subscribers[i] = ipc_connect(socket_path);
+        send_message(subscribers[i], I3_IPC_MESSAGE_TYPE_SUBSCRIBE, "[\"tick\",\"workspace\"]");
+        uint32_t type;
+        char *reply = recv_message(subscribers[i], &type);
+        if (type != I3_IPC_REPLY_TYPE_SUBSCRIBE || strstr(reply, "\"success\":true") == NULL) {
+            errx(EXIT_FAILURE, "Could not subscribe: %s", reply);
+        }
+        free(reply);
+        /* The first tick event is sent on subscribing. */
+        free(recv_message(subscribers[i], &type));
+    }
+
+    char *workspace = get_focused_workspace();
+
+    bench_tick_latency(events);
+    bench_tick_throughput(events);
+    bench_workspace_latency(events);
+    bench_get_tree(sizes, num_sizes, repetitions);
+
+    if (workspace != NULL) {
+        char *command;
+        sasprintf(&command, "workspace \"%s\"", workspace);
+        run_command(command);
+        free(command);
+        free(workspace);
+    }
+
+    for (int i = 0; i < num_subscribers; i++) {
+        close(subscribers[i]);
+    }
+    close(control);
+    free(subscribers);
+    free(sizes);
+    free(socket_path);
+    return EXIT_SUCCESS;
+}
@@ -17,8 +17,10 @@
 #include "libi3.h"
 
 #include <err.h>
+#include <errno.h>
 #include <getopt.h>
 #include <i3/ipc.h>
+#include <poll.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -59,6 +61,8 @@ typedef struct reply_t {
 
 static int exit_code = 0;
 static reply_t last_reply;
+/* The number of open maps, to skip the timing maps within the results. */
+static int reply_map_depth = 0;
 
 static int reply_boolean_cb(void *params, int val) {
     if (strcmp(last_key, "success") == 0)
@@ -81,10 +85,14 @@ static int reply_string_cb(void *params, const unsigned char *val, size_t len) {
 }
 
 static int reply_start_map_cb(void *params) {
+    reply_map_depth++;
     return 1;
 }
 
 static int reply_end_map_cb(void *params) {
+    if (--reply_map_depth > 0) {
+        return 1;
+    }
     if (!last_reply.success) {
         if (last_reply.input) {
             fprintf(stderr, "ERROR: Your command: %s\n", last_reply.input);
@@ -145,6 +153,275 @@ static yajl_callbacks config_callbacks = {
     .yajl_end_map = config_end_map_cb,
 };
 
+/*
+ * Receives a message like ipc_recv_message() but converts CBOR-encoded
+ * replies back into JSON, so that they can be printed and parsed as usual.
+ *
+ */
+static int recv_message(int sockfd, bool cbor, uint32_t *message_type,
+                        uint32_t *reply_length, uint8_t **reply) {
+    const int ret = ipc_recv_message(sockfd, message_type, reply_length, reply);
+    if (ret != 0 || !cbor) {
+        return ret;
+    }
+
+    char *json = ipc_cbor_to_json(*reply, *reply_length);
+    if (json == NULL) {
+        errx(EXIT_FAILURE, "IPC: Could not decode CBOR reply.");
+    }
+    free(*reply);
+    *reply = (uint8_t *)json;
+    *reply_length = strlen(json);
+    return 0;
+}
+
+/*
+ * Sets message_type to the IPC message type with the given name (as used with
+ * -t). Returns false if there is no such type.
+ *
+ */
+static bool parse_message_type(const char *name, uint32_t *message_type) {
+    if (strcasecmp(name, "command") == 0) {
+        *message_type = I3_IPC_MESSAGE_TYPE_RUN_COMMAND;
+    } else if (strcasecmp(name, "run_command") == 0) {
+        *message_type = I3_IPC_MESSAGE_TYPE_RUN_COMMAND;
+    } else if (strcasecmp(name, "get_workspaces") == 0) {
+        *message_type = I3_IPC_MESSAGE_TYPE_GET_WORKSPACES;
+    } else if (strcasecmp(name, "get_outputs") == 0) {
+        *message_type = I3_IPC_MESSAGE_TYPE_GET_OUTPUTS;
+    } else if (strcasecmp(name, "get_tree") == 0) {
+        *message_type = I3_IPC_MESSAGE_TYPE_GET_TREE;
+    } else if (strcasecmp(name, "get_marks") == 0) {
+        *message_type = I3_IPC_MESSAGE_TYPE_GET_MARKS;
+    } else if (strcasecmp(name, "get_bar_config") == 0) {
+        *message_type = I3_IPC_MESSAGE_TYPE_GET_BAR_CONFIG;
+    } else if (strcasecmp(name, "get_binding_modes") == 0) {
+        *message_type = I3_IPC_MESSAGE_TYPE_GET_BINDING_MODES;
+    } else if (strcasecmp(name, "get_binding_state") == 0) {
+        *message_type = I3_IPC_MESSAGE_TYPE_GET_BINDING_STATE;
+    } else if (strcasecmp(name, "get_stats") == 0) {
+        *message_type = I3_IPC_MESSAGE_TYPE_GET_STATS;
+    } else if (strcasecmp(name, "get_memory") == 0) {
+        *message_type = I3_IPC_MESSAGE_TYPE_GET_MEMORY;
+    } else if (strcasecmp(name, "get_version") == 0) {
+        *message_type = I3_IPC_MESSAGE_TYPE_GET_VERSION;
+    } else if (strcasecmp(name, "get_config") == 0) {
+        *message_type = I3_IPC_MESSAGE_TYPE_GET_CONFIG;
+    } else if (strcasecmp(name, "send_tick") == 0) {
+        *message_type = I3_IPC_MESSAGE_TYPE_SEND_TICK;
+    } else if (strcasecmp(name, "subscribe") == 0) {
+        *message_type = I3_IPC_MESSAGE_TYPE_SUBSCRIBE;
+    } else if (strcasecmp(name, "x_sync") == 0) {
+        *message_type = I3_IPC_MESSAGE_TYPE_X_SYNC;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Prints the reply to a message: For commands, errors are formatted nicely,
+ * for GET_CONFIG only the configuration is printed.
+ *
+ */
+static void print_reply(uint32_t reply_type, const uint8_t *reply, uint32_t reply_length, bool quiet, bool raw_reply) {
+    /* For the reply of commands, have a look if that command was successful.
+     * If not, nicely format the error message. */
+    if (reply_type == I3_IPC_REPLY_TYPE_COMMAND) {
+        /* In batch mode, there is one reply per command message. */
+        free(last_reply.error);
+        free(last_reply.input);
+        free(last_reply.errorposition);
+        memset(&last_reply, 0, sizeof(last_reply));
+        if (!raw_reply) {
+            yajl_handle handle = yajl_alloc(&reply_callbacks, NULL, NULL);
+            yajl_status state = yajl_parse(handle, (const unsigned char *)reply, reply_length);
+            yajl_free(handle);
+
+            switch (state) {
+                case yajl_status_ok:
+                    break;
+                case yajl_status_client_canceled:
+                case yajl_status_error:
+                    errx(EXIT_FAILURE, "IPC: Could not parse JSON reply.");
+            }
+        }
+
+        if (!quiet || raw_reply) {
+            printf("%.*s\n", reply_length, reply);
+        }
+    } else if (reply_type == I3_IPC_REPLY_TYPE_CONFIG) {
+        if (raw_reply) {
+            printf("%.*s\n", reply_length, reply);
+        } else {
+            yajl_handle handle = yajl_alloc(&config_callbacks, NULL, NULL);
+            yajl_status state = yajl_parse(handle, (const unsigned char *)reply, reply_length);
+            yajl_free(handle);
+
+            switch (state) {
+                case yajl_status_ok:
+                    break;
+                case yajl_status_client_canceled:
+                case yajl_status_error:
+                    errx(EXIT_FAILURE, "IPC: Could not parse JSON reply.");
+            }
+        }
+    } else {
+        if (!quiet) {
+            printf("%.*s\n", reply_length, reply);
+        }
+    }
+}
+
+/*
+ * Reads stdin for --batch. Unlike stdio, this tells whether a complete line is
+ * available without blocking.
+ *
+ */
+typedef struct line_reader {
+    char *data;
+    size_t size;
+    size_t capacity;
+    /* The start of the next line in data. */
+    size_t start;
+    bool eof;
+} line_reader;
+
+/*
+ * Returns the next line from stdin without its newline, or NULL at the end of
+ * the input. If block is false, NULL is also returned when no complete line
+ * can be read right now. The line is only valid until the next call.
+ *
+ */
+static char *next_line(line_reader *reader, bool block) {
+    while (true) {
+        char *begin = reader->data + reader->start;
+        char *newline = memchr(begin, '\n', reader->size - reader->start);
+        if (newline != NULL) {
+            *newline = '\0';
+            reader->start = (newline + 1) - reader->data;
+            return begin;
+        }
+        if (reader->eof) {
+            if (reader->start == reader->size) {
+                return NULL;
+            }
+            /* The last line does not end with a newline. There is always
+             * room for the terminating NUL, see below. */
+            reader->data[reader->size] = '\0';
+            reader->start = reader->size;
+            return begin;
+        }
+        if (!block) {
+            struct pollfd pfd = {.fd = STDIN_FILENO, .events = POLLIN};
+            if (poll(&pfd, 1, 0) <= 0) {
+                return NULL;
+            }
+        }
+
+        memmove(reader->data, begin, reader->size - reader->start);
+        reader->size -= reader->start;
+        reader->start = 0;
+        if (reader->capacity - reader->size < 4096) {
+            reader->capacity = reader->size + 65536;
+            reader->data = srealloc(reader->data, reader->capacity);
+        }
+        const ssize_t n = read(STDIN_FILENO, reader->data + reader->size, reader->capacity - reader->size - 1);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            err(EXIT_FAILURE, "read(stdin)");
+        }
+        if (n == 0) {
+            reader->eof = true;
+        } else {
+            reader->size += n;
+        }
+    }
+}
+
+/*
+ * Receives the reply to a message of the given type and prints it.
+ *
+ */
+static void recv_and_print_reply(int sockfd, bool cbor, uint32_t message_type, bool quiet, bool raw_reply) {
+    uint32_t reply_length;
+    uint32_t reply_type;
+    uint8_t *reply;
+    int ret;
+    if ((ret = recv_message(sockfd, cbor, &reply_type, &reply_length, &reply)) != 0) {
+        if (ret == -1)
+            err(EXIT_FAILURE, "IPC: read()");
+        exit(1);
+    }
+    if (reply_type != message_type)
+        errx(EXIT_FAILURE, "IPC: Received reply of type %d but expected %d", reply_type, message_type);
+    print_reply(reply_type, reply, reply_length, quiet, raw_reply);
+    free(reply);
+}
+
+/*
+ * Implements --batch: reads one message per line from stdin (the type as
+ * with -t, optionally followed by a space and the payload) and sends them all
+ * over the same connection. Messages are sent as soon as they are read, the
+ * replies are read (and printed in order) whenever no more input is available
+ * right away, so that i3 handles a burst of messages without a round trip per
+ * message.
+ *
+ */
+static void run_batch(int sockfd, bool cbor, bool quiet, bool raw_reply) {
+    line_reader reader = {
+        .data = smalloc(65536),
+        .capacity = 65536,
+    };
+    uint32_t *pending = NULL;
+    size_t num_pending = 0;
+    size_t pending_capacity = 0;
+
+    while (true) {
+        char *line = next_line(&reader, (num_pending == 0));
+        if (line == NULL) {
+            if (num_pending == 0) {
+                break;
+            }
+            for (size_t i = 0; i < num_pending; i++) {
+                recv_and_print_reply(sockfd, cbor, pending[i], quiet, raw_reply);
+            }
+            num_pending = 0;
+            fflush(stdout);
+            continue;
+        }
+        if (line[0] == '\0') {
+            continue;
+        }
+
+        char *payload = strchr(line, ' ');
+        if (payload != NULL) {
+            *(payload++) = '\0';
+        } else {
+            payload = "";
+        }
+        uint32_t message_type;
+        if (!parse_message_type(line, &message_type) || message_type == I3_IPC_MESSAGE_TYPE_SUBSCRIBE) {
+            fprintf(stderr, "ERROR: Unknown message type in batch mode: %s\n", line);
+            exit_code = EXIT_FAILURE;
+            continue;
+        }
+
+        if (ipc_send_message(sockfd, strlen(payload), message_type, (uint8_t *)payload) == -1)
+            err(EXIT_FAILURE, "IPC: write()");
+        if (num_pending == pending_capacity) {
+            pending_capacity = (pending_capacity == 0 ? 64 : pending_capacity * 2);
+            pending = srealloc(pending, pending_capacity * sizeof(uint32_t));
+        }
+        pending[num_pending++] = message_type;
+    }
+
+    free(pending);
+    free(reader.data);
+}
+
 int main(int argc, char *argv[]) {
 #if defined(__OpenBSD__)
     if (pledge("stdio rpath unix", NULL) == -1)
@@ -157,6 +434,9 @@ int main(int argc, char *argv[]) {
     bool quiet = false;
     bool monitor = false;
     bool raw_reply = false;
+    bool cbor = false;
+    bool timing = false;
+    bool batch = false;
 
     static struct option long_options[] = {
         {"socket", required_argument, 0, 's'},
@@ -166,44 +446,21 @@ int main(int argc, char *argv[]) {
         {"monitor", no_argument, 0, 'm'},
         {"help", no_argument, 0, 'h'},
         {"raw", no_argument, 0, 'r'},
+        {"encoding", required_argument, 0, 'e'},
+        {"timing", no_argument, 0, 'T'},
+        {"batch", no_argument, 0, 'b'},
         {0, 0, 0, 0}};
 
-    char *options_string = "s:t:vhqmr";
+    char *options_string = "s:t:vhqmre:Tb";
 
     while ((o = getopt_long(argc, argv, options_string, long_options, &option_index)) != -1) {
         if (o == 's') {
             free(socket_path);
             socket_path = sstrdup(optarg);
         } else if (o == 't') {
-            if (strcasecmp(optarg, "command") == 0) {
-                message_type = I3_IPC_MESSAGE_TYPE_RUN_COMMAND;
-            } else if (strcasecmp(optarg, "run_command") == 0) {
-                message_type = I3_IPC_MESSAGE_TYPE_RUN_COMMAND;
-            } else if (strcasecmp(optarg, "get_workspaces") == 0) {
-                message_type = I3_IPC_MESSAGE_TYPE_GET_WORKSPACES;
-            } else if (strcasecmp(optarg, "get_outputs") == 0) {
-                message_type = I3_IPC_MESSAGE_TYPE_GET_OUTPUTS;
-            } else if (strcasecmp(optarg, "get_tree") == 0) {
-                message_type = I3_IPC_MESSAGE_TYPE_GET_TREE;
-            } else if (strcasecmp(optarg, "get_marks") == 0) {
-                message_type = I3_IPC_MESSAGE_TYPE_GET_MARKS;
-            } else if (strcasecmp(optarg, "get_bar_config") == 0) {
-                message_type = I3_IPC_MESSAGE_TYPE_GET_BAR_CONFIG;
-            } else if (strcasecmp(optarg, "get_binding_modes") == 0) {
-                message_type = I3_IPC_MESSAGE_TYPE_GET_BINDING_MODES;
-            } else if (strcasecmp(optarg, "get_binding_state") == 0) {
-                message_type = I3_IPC_MESSAGE_TYPE_GET_BINDING_STATE;
-            } else if (strcasecmp(optarg, "get_version") == 0) {
-                message_type = I3_IPC_MESSAGE_TYPE_GET_VERSION;
-            } else if (strcasecmp(optarg, "get_config") == 0) {
-                message_type = I3_IPC_MESSAGE_TYPE_GET_CONFIG;
-            } else if (strcasecmp(optarg, "send_tick") == 0) {
-                message_type = I3_IPC_MESSAGE_TYPE_SEND_TICK;
-            } else if (strcasecmp(optarg, "subscribe") == 0) {
-                message_type = I3_IPC_MESSAGE_TYPE_SUBSCRIBE;
-            } else {
+            if (!parse_message_type(optarg, &message_type)) {
                 printf("Unknown message type\n");
-                printf("Known types: run_command, get_workspaces, get_outputs, get_tree, get_marks, get_bar_config, get_binding_modes, get_binding_state, get_version, get_config, send_tick, subscribe\n");
+                printf("Known types: run_command, get_workspaces, get_outputs, get_tree, get_marks, get_bar_config, get_binding_modes, get_binding_state, get_stats, get_memory, get_version, get_config, send_tick, subscribe, x_sync\n");
                 exit(EXIT_FAILURE);
             }
         } else if (o == 'q') {
@@ -215,12 +472,24 @@ int main(int argc, char *argv[]) {
             return 0;
         } else if (o == 'h') {
             printf("i3-msg " I3_VERSION "\n");
-            printf("i3-msg [-s <socket>] [-t <type>] [-m] <message>\n");
+            printf("i3-msg [-s <socket>] [-t <type>] [-e <encoding>] [-T] [-m] <message>\n");
+            printf("i3-msg [-s <socket>] [-e <encoding>] [-T] --batch < <messages>\n");
             return 0;
         } else if (o == '?') {
             exit(EXIT_FAILURE);
         } else if (o == 'r') {
             raw_reply = true;
+        } else if (o == 'T') {
+            timing = true;
+        } else if (o == 'b') {
+            batch = true;
+        } else if (o == 'e') {
+            if (strcasecmp(optarg, "cbor") == 0) {
+                cbor = true;
+            } else if (strcasecmp(optarg, "json") != 0) {
+                printf("Unknown encoding, known encodings: json, cbor\n");
+                exit(EXIT_FAILURE);
+            }
         }
     }
 
@@ -229,6 +498,11 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
+    if (batch && (monitor || optind < argc)) {
+        fprintf(stderr, "The batch option -b reads the messages from stdin and cannot be used with -m or a message.\n");
+        exit(EXIT_FAILURE);
+    }
+
     /* Use all arguments, separated by whitespace, as payload.
      * This way, you don’t have to do i3-msg 'mark foo', you can use
      * i3-msg mark foo */
@@ -248,61 +522,62 @@ int main(int argc, char *argv[]) {
         payload = sstrdup("");
 
     int sockfd = ipc_connect(socket_path);
-    if (ipc_send_message(sockfd, strlen(payload), message_type, (uint8_t *)payload) == -1)
-        err(EXIT_FAILURE, "IPC: write()");
-    free(payload);
 
     uint32_t reply_length;
     uint32_t reply_type;
     uint8_t *reply;
     int ret;
-    if ((ret = ipc_recv_message(sockfd, &reply_type, &reply_length, &reply)) != 0) {
+    if (cbor) {
+        /* The reply to SET_ENCODING is always JSON. */
+        if (ipc_send_message(sockfd, strlen("cbor"), I3_IPC_MESSAGE_TYPE_SET_ENCODING, (uint8_t *)"cbor") == -1)
+            err(EXIT_FAILURE, "IPC: write()");
+        if ((ret = ipc_recv_message(sockfd, &reply_type, &reply_length, &reply)) != 0) {
+            if (ret == -1)
+                err(EXIT_FAILURE, "IPC: read()");
+            exit(1);
+        }
+        if (reply_type != I3_IPC_REPLY_TYPE_SET_ENCODING)
+            errx(EXIT_FAILURE, "IPC: Received reply of type %d but expected %d", reply_type, I3_IPC_REPLY_TYPE_SET_ENCODING);
+        free(reply);
+    }
+
+    if (timing) {
+        if (ipc_send_message(sockfd, strlen("true"), I3_IPC_MESSAGE_TYPE_SET_COMMAND_TIMING, (uint8_t *)"true") == -1)
+            err(EXIT_FAILURE, "IPC: write()");
+        if ((ret = recv_message(sockfd, cbor, &reply_type, &reply_length, &reply)) != 0) {
+            if (ret == -1)
+                err(EXIT_FAILURE, "IPC: read()");
+            exit(1);
+        }
+        if (reply_type != I3_IPC_REPLY_TYPE_SET_COMMAND_TIMING)
+            errx(EXIT_FAILURE, "IPC: Received reply of type %d but expected %d", reply_type, I3_IPC_REPLY_TYPE_SET_COMMAND_TIMING);
+        free(reply);
+    }
+
+    if (batch) {
+        free(payload);
+        run_batch(sockfd, cbor, quiet, raw_reply);
+        close(sockfd);
+        return exit_code;
+    }
+
+    if (ipc_send_message(sockfd, strlen(payload), message_type, (uint8_t *)payload) == -1)
+        err(EXIT_FAILURE, "IPC: write()");
+    free(payload);
+
+    if ((ret = recv_message(sockfd, cbor, &reply_type, &reply_length, &reply)) != 0) {
         if (ret == -1)
             err(EXIT_FAILURE, "IPC: read()");
         exit(1);
     }
     if (reply_type != message_type)
         errx(EXIT_FAILURE, "IPC: Received reply of type %d but expected %d", reply_type, message_type);
-    /* For the reply of commands, have a look if that command was successful.
-     * If not, nicely format the error message. */
-    if (reply_type == I3_IPC_REPLY_TYPE_COMMAND) {
-        if (!raw_reply) {
-            yajl_handle handle = yajl_alloc(&reply_callbacks, NULL, NULL);
-            yajl_status state = yajl_parse(handle, (const unsigned char *)reply, reply_length);
-            yajl_free(handle);
-
-            switch (state) {
-                case yajl_status_ok:
-                    break;
-                case yajl_status_client_canceled:
-                case yajl_status_error:
-                    errx(EXIT_FAILURE, "IPC: Could not parse JSON reply.");
-            }
-        }
-
-        if (!quiet || raw_reply) {
-            printf("%.*s\n", reply_length, reply);
-        }
-    } else if (reply_type == I3_IPC_REPLY_TYPE_CONFIG) {
-        if (raw_reply) {
-            printf("%.*s\n", reply_length, reply);
-        } else {
-            yajl_handle handle = yajl_alloc(&config_callbacks, NULL, NULL);
-            yajl_status state = yajl_parse(handle, (const unsigned char *)reply, reply_length);
-            yajl_free(handle);
-
-            switch (state) {
-                case yajl_status_ok:
-                    break;
-                case yajl_status_client_canceled:
-                case yajl_status_error:
-                    errx(EXIT_FAILURE, "IPC: Could not parse JSON reply.");
-            }
-        }
-    } else if (reply_type == I3_IPC_REPLY_TYPE_SUBSCRIBE) {
+    if (reply_type != I3_IPC_REPLY_TYPE_SUBSCRIBE) {
+        print_reply(reply_type, reply, reply_length, quiet, raw_reply);
+    } else {
         do {
             free(reply);
-            if ((ret = ipc_recv_message(sockfd, &reply_type, &reply_length, &reply)) != 0) {
+            if ((ret = recv_message(sockfd, cbor, &reply_type, &reply_length, &reply)) != 0) {
                 if (ret == -1)
                     err(EXIT_FAILURE, "IPC: read()");
                 exit(1);
@@ -317,10 +592,6 @@ int main(int argc, char *argv[]) {
                 fflush(stdout);
             }
         } while (monitor);
-    } else {
-        if (!quiet) {
-            printf("%.*s\n", reply_length, reply);
-        }
     }
 
     free(reply);
@@ -0,0 +1,64 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3bar - an xcb-based status- and ws-bar for i3
+ * © 2010 Axel Wagner and contributors (see also: LICENSE)
+ *
+ * bars.c: Serving multiple bar configurations from one i3bar process
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+#include "common.h"
+
+/* Repairs a TAILQ head after it was copied to a different address. */
+#define TAILQ_RELOCATE(head, field)                                \
+    do {                                                           \
+        if (TAILQ_EMPTY(head))                                     \
+            (head)->tqh_last = &TAILQ_FIRST(head);                 \
+        else                                                       \
+            TAILQ_FIRST(head)->field.tqe_prev = &TAILQ_FIRST(head); \
+    } while (0)
+
+struct child_state;
+struct xcb_state;
+
+/* One bar configuration (bar { } block) served by this process. The code works
+ * on the global variables (config, outputs, statusline_head, …) of the active
+ * bar. The state of the other bars is kept here until activate_bar() swaps it
+ * in. */
+typedef struct i3_bar i3_bar;
+struct i3_bar {
+    config_t config;
+    struct outputs_head *outputs;
+    struct child_state *child;
+    struct xcb_state *xcb;
+
+    /* Whether the bar configuration arrived. Events and replies which are
+     * meant for all bars are not passed to the bar before. */
+    bool configured;
+
+    TAILQ_ENTRY(i3_bar) bars;
+};
+
+TAILQ_HEAD(bars_head, i3_bar);
+extern struct bars_head bars;
+
+/* The bar whose state is in the global variables */
+extern i3_bar *active_bar;
+
+/*
+ * Creates the state for the bar with the given id (or for the first bar of the
+ * i3 config if bar_id is NULL). The bar is not activated.
+ *
+ */
+i3_bar *bar_new(const char *bar_id, bool transparency, bool verbose);
+
+/*
+ * Makes the given bar the active bar: saves the global state of the currently
+ * active bar and loads the state of the given one.
+ *
+ */
+void activate_bar(i3_bar *bar);
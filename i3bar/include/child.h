@@ -40,14 +40,55 @@ typedef struct {
      */
     bool click_events;
     bool click_events_init;
+
+    /**
+     * The name of the shared memory segment containing the statusline
+     * (protocol version 2)
+     */
+    char *shm_name;
 } i3bar_child;
 
+/*
+ * The number of status lines which were never drawn because a newer status
+ * line arrived before the next redraw (see status_update_interval).
+ *
+ */
+extern uint64_t status_updates_dropped;
+
+/*
+ * Returns the width of the separator block of blocks which do not specify
+ * separator_block_width.
+ *
+ */
+uint32_t default_sep_block_width(void);
+
 /*
  * Remove all blocks from the given statusline.
  * If free_resources is set, the fields of each status block will be free'd.
  */
 void clear_statusline(struct statusline_head *head, bool free_resources);
 
+/* The statusline state (child process, parser, blocks) of an inactive bar */
+struct child_state;
+
+/*
+ * Allocates the statusline state of a bar which has no child (yet).
+ *
+ */
+struct child_state *child_state_new(void);
+
+/*
+ * Saves the statusline state of the active bar.
+ *
+ */
+void child_save_state(struct child_state *state);
+
+/*
+ * Loads the statusline state of the bar which becomes active.
+ *
+ */
+void child_load_state(const struct child_state *state);
+
 /*
  * Start a child process with the specified command and reroute stdin.
  * We actually start a $SHELL to execute the command so we don't have to care
@@ -57,7 +98,7 @@ void clear_statusline(struct statusline_head *head, bool free_resources);
 void start_child(char *command);
 
 /*
- * kill()s the child process (if any). Called when exit()ing.
+ * kill()s the child processes (if any) of all bars. Called when exit()ing.
  *
  */
 void kill_child_at_exit(void);
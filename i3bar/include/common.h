@@ -69,6 +69,14 @@ struct status_block {
     /* The amount of pixels necessary to render a separator after the block. */
     uint32_t sep_block_width;
 
+    /* The measured widths of full_text and short_text, if the corresponding
+     * flag is set. Carried over from the previous statusline for blocks whose
+     * text did not change, see stdin_end_array(). */
+    uint32_t full_text_width;
+    uint32_t short_text_width;
+    bool full_text_width_valid;
+    bool short_text_width_valid;
+
     /* Continuously-updated information on how to render this status block. */
     struct status_block_render_desc full_render;
     struct status_block_render_desc short_render;
@@ -92,3 +100,5 @@ extern TAILQ_HEAD(statusline_head, status_block) statusline_head;
 #include "xcb.h"
 #include "configuration.h"
 #include "parse_json_header.h"
+#include "status_shm.h"
+#include "bars.h"
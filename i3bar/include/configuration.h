@@ -48,6 +48,7 @@ typedef struct config_t {
     bool disable_binding_mode_indicator;
     bool disable_ws;
     int ws_min_width;
+    int status_update_interval;
     bool strip_ws_numbers;
     bool strip_ws_name;
     char *bar_id;
@@ -86,3 +87,9 @@ void parse_get_first_i3bar_config(char *json);
  *
  */
 void free_colors(struct xcb_color_strings_t *colors);
+
+/**
+ * Returns true if any of the color strings differ.
+ *
+ */
+bool colors_differ(const struct xcb_color_strings_t *a, const struct xcb_color_strings_t *b);
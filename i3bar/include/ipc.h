@@ -27,7 +27,7 @@ void init_connection(const char *socket_path);
 void destroy_connection(void);
 
 /*
- * Sends a message to i3.
+ * Sends a message to i3. The reply is handled by the active bar.
  * type must be a valid I3_IPC_MESSAGE_TYPE (see i3/ipc.h for further information)
  *
  */
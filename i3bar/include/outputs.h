@@ -18,20 +18,42 @@
 
 typedef struct i3_output i3_output;
 
+/* Where the statusline was drawn on an output, see draw_bars(). */
+typedef struct statusline_geometry {
+    int workspace_width;
+    int tray_width;
+    uint32_t width;
+    uint32_t clip_left;
+    bool use_short_text;
+    bool use_focus_colors;
+    int visible_width;
+    int x_dest;
+} statusline_geometry;
+
 SLIST_HEAD(outputs_head, i3_output);
 extern struct outputs_head* outputs;
 
 /*
- * Start parsing the received JSON string
+ * Updates the outputs list from the received JSON string. Outputs which are
+ * no longer listed are removed, and those whose geometry, active or primary
+ * flag changed are marked as changed. Returns true if anything changed.
+ *
+ */
+bool parse_outputs_json(char* json);
+
+/*
+ * Marks all outputs as changed, so that the next reconfig_windows()
+ * reconfigures all bars, e.g. because the bar height changed.
  *
  */
-void parse_outputs_json(char* json);
+void mark_outputs_changed(void);
 
 /*
- * Initiate the outputs list
+ * Allocates an empty outputs list. Every bar has its own, the one of the
+ * active bar is in 'outputs'.
  *
  */
-void init_outputs(void);
+struct outputs_head *init_outputs(void);
 
 /*
  * free() all outputs data structures.
@@ -67,8 +89,21 @@ struct i3_output {
     int statusline_width;
     /* Whether statusline block short texts where used on last statusline render. */
     bool statusline_short_text;
+    /* Whether buffer and the bar currently show the statusline as drawn by the
+     * last statusline render, with the given geometry and one string
+     * describing each drawn block (see draw_statusline_changes()). */
+    bool statusline_drawn;
+    statusline_geometry statusline_geometry;
+    char** statusline_block_keys;
+    int statusline_num_blocks;
+    /* Describes the workspace buttons currently drawn in buffer, NULL if
+     * they have to be drawn again (see draw_workspace_buttons()). */
+    char* workspace_buttons_key;
     /* The actual window on which we draw. */
     surface_t bar;
+    /* Whether the geometry, the active or the primary flag changed since the
+     * bar was last configured by reconfig_windows(). */
+    bool changed;
 
     struct ws_head* workspaces;  /* The workspaces on this output */
     struct tc_head* trayclients; /* The tray clients on this output */
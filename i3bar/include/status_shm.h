@@ -0,0 +1,114 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3bar - an xcb-based status- and ws-bar for i3
+ * © 2010 Axel Wagner and contributors (see also: LICENSE)
+ *
+ * status_shm.c: Read the statusline from a shared memory segment (protocol
+ *               version 2, see docs/i3bar-protocol).
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common.h"
+
+/* The protocol version which selects the shared memory protocol */
+#define STATUS_SHM_VERSION 2
+
+/* "i3sb", the first four bytes of the segment */
+#define STATUS_SHM_MAGIC 0x69337362
+
+/* flags of a block */
+#define STATUS_SHM_URGENT (1 << 0)
+#define STATUS_SHM_NO_SEPARATOR (1 << 1)
+#define STATUS_SHM_PANGO_MARKUP (1 << 2)
+#define STATUS_SHM_SEPARATOR_BLOCK_WIDTH (1 << 3)
+
+/* The segment starts with a header, followed by num_blocks blocks. All fields
+ * use the byte order of the machine, strings are NUL-terminated UTF-8 and
+ * empty strings mean that the key is not set. */
+struct status_shm_header {
+    uint32_t magic;
+    /* sizeof(struct status_shm_block), to detect incompatible layouts */
+    uint32_t block_size;
+    uint32_t num_blocks;
+    uint32_t reserved;
+};
+
+struct status_shm_block {
+    /* Incremented before and after the block is changed, so it is odd while
+     * the block is written. i3bar only reads blocks whose sequence number
+     * changed. */
+    uint32_t sequence;
+    uint32_t flags;
+    uint32_t min_width;
+    /* Only used if STATUS_SHM_SEPARATOR_BLOCK_WIDTH is set */
+    uint32_t separator_block_width;
+    uint32_t border_top;
+    uint32_t border_right;
+    uint32_t border_bottom;
+    uint32_t border_left;
+    /* 0 = left, 1 = center, 2 = right */
+    uint32_t align;
+    uint32_t reserved;
+
+    char full_text[512];
+    char short_text[256];
+    char color[16];
+    char background[16];
+    char border[16];
+    char name[64];
+    char instance[64];
+};
+
+/* The state of a mapped segment */
+struct status_shm {
+    void *segment;
+    size_t segment_size;
+    uint32_t max_blocks;
+
+    /* Private copies of the blocks which were read last. The strings of the
+     * status blocks point into them, since the shared blocks can change at
+     * any time. */
+    struct status_shm_block *copies;
+    /* The sequence numbers of the copies. An odd number means that the copy
+     * is not consistent and has to be read again. */
+    uint32_t *sequences;
+};
+
+/* The segment of the active bar */
+extern struct status_shm status_shm;
+
+/*
+ * Maps the shared memory segment with the given name (as passed to
+ * shm_open(3)). Returns false if it cannot be used.
+ *
+ */
+bool status_shm_open(const char *name);
+
+/*
+ * Unmaps the segment.
+ *
+ */
+void status_shm_close(void);
+
+/*
+ * Returns the number of blocks in the segment.
+ *
+ */
+uint32_t status_shm_num_blocks(void);
+
+/*
+ * Copies the block with the given index to the given status block if its
+ * sequence number changed since it was read last (or if force is set). The
+ * strings of the block stay valid until the block is read again or the segment
+ * is closed. Returns whether the block changed.
+ *
+ */
+bool status_shm_read_block(uint32_t index, bool force, struct status_block *block);
@@ -17,6 +17,7 @@ struct trayclient {
     xcb_window_t win; /* The window ID of the tray client */
     bool mapped;      /* Whether this window is mapped */
     int xe_version;   /* The XEMBED version supported by the client */
+    uint32_t x;       /* The x coordinate the window was moved to last */
 
     char *class_class;
     char *class_instance;
@@ -23,6 +23,14 @@ TAILQ_HEAD(ws_head, i3_ws);
  */
 void parse_workspaces_json(char *json);
 
+/*
+ * Applies a workspace event (see docs/ipc) to the workspace lists, so that
+ * they need not be requested again. Returns false if the event could not be
+ * applied, in which case the workspaces have to be requested again.
+ *
+ */
+bool apply_workspace_event(const char *json);
+
 /*
  * free() all workspace data structures
  *
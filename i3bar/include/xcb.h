@@ -26,6 +26,12 @@
 #define xcb_request_failed(cookie, err_msg) _xcb_request_failed(cookie, err_msg, __LINE__)
 int _xcb_request_failed(xcb_void_cookie_t cookie, char *err_msg, int line);
 
+/* Like xcb_request_failed, but without waiting for the X server: the request
+ * is sent unchecked and i3bar exits once its error arrives. Requests have to
+ * be added in the order in which they were sent. */
+#define xcb_request_check_async(cookie, err_msg) _xcb_request_check_async(cookie, err_msg, __LINE__)
+void _xcb_request_check_async(xcb_void_cookie_t cookie, const char *err_msg, int line);
+
 struct xcb_color_strings_t {
     char *bar_fg;
     char *bar_bg;
@@ -82,6 +88,27 @@ void init_colors(const struct xcb_color_strings_t *colors);
  */
 void clean_xcb(void);
 
+/* The X11 state (font, colors, tray selection) of an inactive bar */
+struct xcb_state;
+
+/*
+ * Allocates the X11 state of a bar which did not get its configuration yet.
+ *
+ */
+struct xcb_state *xcb_state_new(void);
+
+/*
+ * Saves the X11 state of the active bar.
+ *
+ */
+void xcb_save_state(struct xcb_state *state);
+
+/*
+ * Loads the X11 state of the bar which becomes active.
+ *
+ */
+void xcb_load_state(const struct xcb_state *state);
+
 /*
  * Get the earlier requested atoms and save them in the prepared data structure
  *
@@ -132,6 +159,14 @@ void reconfig_windows(bool redraw_bars);
  */
 void draw_bars(bool force_unhide);
 
+/*
+ * Like draw_bars(), but only for a changed statusline: if the statusline still
+ * has the same size on every output, only the blocks which changed are drawn
+ * again and copied to the bars.
+ *
+ */
+void draw_statusline_changes(bool force_unhide);
+
 /*
  * Redraw the bars, i.e. simply copy the buffer to the barwindow
  *
@@ -0,0 +1,74 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3bar - an xcb-based status- and ws-bar for i3
+ * © 2010 Axel Wagner and contributors (see also: LICENSE)
+ *
+ * bars.c: Serving multiple bar configurations from one i3bar process
+ *
+ */
+#include "common.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct bars_head bars = TAILQ_HEAD_INITIALIZER(bars);
+
+i3_bar *active_bar;
+
+/*
+ * Creates the state for the bar with the given id (or for the first bar of the
+ * i3 config if bar_id is NULL). The bar is not activated.
+ *
+ */
+i3_bar *bar_new(const char *bar_id, bool transparency, bool verbose) {
+    i3_bar *bar = scalloc(1, sizeof(i3_bar));
+    TAILQ_INIT(&(bar->config.bindings));
+    TAILQ_INIT(&(bar->config.tray_outputs));
+    bar->config.bar_id = (bar_id ? sstrdup(bar_id) : NULL);
+    bar->config.transparency = transparency;
+    bar->config.verbose = verbose;
+
+    bar->outputs = init_outputs();
+
+    bar->child = child_state_new();
+    bar->xcb = xcb_state_new();
+
+    TAILQ_INSERT_TAIL(&bars, bar, bars);
+    return bar;
+}
+
+static void save_state(i3_bar *bar) {
+    bar->config = config;
+    TAILQ_RELOCATE(&(bar->config.bindings), bindings);
+    TAILQ_RELOCATE(&(bar->config.tray_outputs), tray_outputs);
+    bar->outputs = outputs;
+    child_save_state(bar->child);
+    xcb_save_state(bar->xcb);
+}
+
+static void load_state(i3_bar *bar) {
+    config = bar->config;
+    TAILQ_RELOCATE(&(config.bindings), bindings);
+    TAILQ_RELOCATE(&(config.tray_outputs), tray_outputs);
+    outputs = bar->outputs;
+    child_load_state(bar->child);
+    xcb_load_state(bar->xcb);
+}
+
+/*
+ * Makes the given bar the active bar: saves the global state of the currently
+ * active bar and loads the state of the given one.
+ *
+ */
+void activate_bar(i3_bar *bar) {
+    if (bar == active_bar || bar == NULL) {
+        return;
+    }
+
+    if (active_bar != NULL) {
+        save_state(active_bar);
+    }
+    load_state(bar);
+    active_bar = bar;
+}
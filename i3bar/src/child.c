@@ -14,6 +14,7 @@
 #include <errno.h>
 #include <ev.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <paths.h>
 #include <signal.h>
 #include <stdarg.h>
@@ -36,18 +37,79 @@ ev_io *stdin_io;
 int stdin_fd;
 ev_child *child_sig;
 
+/* Timer for deferred statusline redraws (see status_update_interval) */
+ev_timer *status_redraw_timer;
+static ev_tstamp last_status_redraw;
+/* Status lines which were read since the last redraw */
+static unsigned int status_updates_pending;
+/* Whether one of the pending status lines was urgent */
+static bool status_redraw_unhide;
+/* Status lines which were never drawn because a newer one replaced them */
+uint64_t status_updates_dropped;
+
 /* JSON parser for stdin */
 yajl_handle parser;
 
 /* JSON generator for stdout */
 yajl_gen gen;
 
+/* The keys of a status block, see the i3bar protocol. */
+typedef enum {
+    BLOCK_FULL_TEXT,
+    BLOCK_SHORT_TEXT,
+    BLOCK_COLOR,
+    BLOCK_BACKGROUND,
+    BLOCK_BORDER,
+    BLOCK_MARKUP,
+    BLOCK_ALIGN,
+    BLOCK_MIN_WIDTH,
+    BLOCK_NAME,
+    BLOCK_INSTANCE,
+    BLOCK_URGENT,
+    BLOCK_SEPARATOR,
+    BLOCK_SEPARATOR_BLOCK_WIDTH,
+    BLOCK_BORDER_TOP,
+    BLOCK_BORDER_RIGHT,
+    BLOCK_BORDER_BOTTOM,
+    BLOCK_BORDER_LEFT,
+} block_key_t;
+
+static const char *const block_key_names[] = {
+    [BLOCK_FULL_TEXT] = "full_text",
+    [BLOCK_SHORT_TEXT] = "short_text",
+    [BLOCK_COLOR] = "color",
+    [BLOCK_BACKGROUND] = "background",
+    [BLOCK_BORDER] = "border",
+    [BLOCK_MARKUP] = "markup",
+    [BLOCK_ALIGN] = "align",
+    [BLOCK_MIN_WIDTH] = "min_width",
+    [BLOCK_NAME] = "name",
+    [BLOCK_INSTANCE] = "instance",
+    [BLOCK_URGENT] = "urgent",
+    [BLOCK_SEPARATOR] = "separator",
+    [BLOCK_SEPARATOR_BLOCK_WIDTH] = "separator_block_width",
+    [BLOCK_BORDER_TOP] = "border_top",
+    [BLOCK_BORDER_RIGHT] = "border_right",
+    [BLOCK_BORDER_BOTTOM] = "border_bottom",
+    [BLOCK_BORDER_LEFT] = "border_left",
+};
+
+/* Block keys are matched case-insensitively. */
+static json_key_table_t block_keys = JSON_KEY_TABLE(block_key_names, true);
+
 typedef struct parser_ctx {
     /* True if one of the parsed blocks was urgent */
     bool has_urgent;
 
-    /* A copy of the last JSON map key. */
-    char *last_map_key;
+    /* The last JSON map key (a block_key_t or JSON_KEY_UNKNOWN), valid once
+     * has_map_key is set. */
+    bool has_map_key;
+    int map_key;
+
+    /* The block of statusline_head at the position of the current block.
+     * Texts which did not change are shared with it instead of being copied,
+     * see unshare_texts(). */
+    struct status_block *old_block;
 
     /* The current block. Will be filled, then copied and put into the list of
      * blocks. */
@@ -60,38 +122,264 @@ struct statusline_head statusline_head = TAILQ_HEAD_INITIALIZER(statusline_head)
 /* Used temporarily while reading a statusline */
 struct statusline_head statusline_buffer = TAILQ_HEAD_INITIALIZER(statusline_buffer);
 
+/* Blocks which were removed from a statusline, reused for the next ones */
+static struct statusline_head spare_blocks = TAILQ_HEAD_INITIALIZER(spare_blocks);
+
+/* The plain strings of the blocks (color, name, ...) are allocated from an
+ * arena per statusline. The arena of a statusline is reset when it is replaced,
+ * so once the arenas grew large enough, reading a status line does not allocate
+ * memory for them. */
+struct arena_chunk {
+    struct arena_chunk *prev;
+    size_t size;
+    size_t used;
+    char data[];
+};
+
+#define ARENA_CHUNK_SIZE 1024
+
+static struct arena_chunk *head_arena;
+static struct arena_chunk *buffer_arena;
+
+/* The buffer stdin is read into, reused for all reads */
+static unsigned char *stdin_buffer;
+static int stdin_buffer_len;
+
 int child_stdin;
 
+/* Click events which were not (completely) written to the child yet. They are
+ * written whenever the child's stdin is writable, so a child which stops
+ * reading them does not block i3bar. */
+struct pending_click {
+    size_t len;
+    size_t written;
+    /* The opening bracket of the click event array must not be dropped */
+    bool droppable;
+
+    TAILQ_ENTRY(pending_click) clicks;
+
+    char data[];
+};
+TAILQ_HEAD(pending_clicks_head, pending_click);
+static struct pending_clicks_head pending_clicks = TAILQ_HEAD_INITIALIZER(pending_clicks);
+static unsigned int num_pending_clicks;
+/* Click events which were dropped because the child did not read them */
+static uint64_t clicks_dropped;
+
+/* When more click events are pending, the oldest ones are dropped */
+#define MAX_PENDING_CLICKS 64
+
+/* Write watcher for the child's stdin, active while clicks are pending */
+static ev_io *child_stdin_io;
+
+/* The variables above belong to the active bar, see activate_bar(). This is
+ * where the ones of the other bars are kept. */
+struct child_state {
+    i3bar_child child;
+    ev_io *stdin_io;
+    int stdin_fd;
+    ev_child *child_sig;
+    ev_timer *status_redraw_timer;
+    ev_tstamp last_status_redraw;
+    unsigned int status_updates_pending;
+    bool status_redraw_unhide;
+    uint64_t status_updates_dropped;
+    yajl_handle parser;
+    yajl_gen gen;
+    parser_ctx parser_context;
+    struct statusline_head statusline_head;
+    struct statusline_head statusline_buffer;
+    struct arena_chunk *head_arena;
+    struct arena_chunk *buffer_arena;
+    int child_stdin;
+    struct pending_clicks_head pending_clicks;
+    unsigned int num_pending_clicks;
+    uint64_t clicks_dropped;
+    ev_io *child_stdin_io;
+    struct status_shm status_shm;
+};
+
+/*
+ * Allocates the statusline state of a bar which has no child (yet).
+ *
+ */
+struct child_state *child_state_new(void) {
+    struct child_state *state = scalloc(1, sizeof(struct child_state));
+    TAILQ_INIT(&(state->statusline_head));
+    TAILQ_INIT(&(state->statusline_buffer));
+    TAILQ_INIT(&(state->pending_clicks));
+    return state;
+}
+
+/*
+ * Saves the statusline state of the active bar.
+ *
+ */
+void child_save_state(struct child_state *state) {
+    state->child = child;
+    state->stdin_io = stdin_io;
+    state->stdin_fd = stdin_fd;
+    state->child_sig = child_sig;
+    state->status_redraw_timer = status_redraw_timer;
+    state->last_status_redraw = last_status_redraw;
+    state->status_updates_pending = status_updates_pending;
+    state->status_redraw_unhide = status_redraw_unhide;
+    state->status_updates_dropped = status_updates_dropped;
+    state->parser = parser;
+    state->gen = gen;
+    state->parser_context = parser_context;
+    state->statusline_head = statusline_head;
+    TAILQ_RELOCATE(&(state->statusline_head), blocks);
+    state->statusline_buffer = statusline_buffer;
+    TAILQ_RELOCATE(&(state->statusline_buffer), blocks);
+    state->head_arena = head_arena;
+    state->buffer_arena = buffer_arena;
+    state->child_stdin = child_stdin;
+    state->pending_clicks = pending_clicks;
+    TAILQ_RELOCATE(&(state->pending_clicks), clicks);
+    state->num_pending_clicks = num_pending_clicks;
+    state->clicks_dropped = clicks_dropped;
+    state->child_stdin_io = child_stdin_io;
+    state->status_shm = status_shm;
+}
+
+/*
+ * Loads the statusline state of the bar which becomes active.
+ *
+ */
+void child_load_state(const struct child_state *state) {
+    child = state->child;
+    stdin_io = state->stdin_io;
+    stdin_fd = state->stdin_fd;
+    child_sig = state->child_sig;
+    status_redraw_timer = state->status_redraw_timer;
+    last_status_redraw = state->last_status_redraw;
+    status_updates_pending = state->status_updates_pending;
+    status_redraw_unhide = state->status_redraw_unhide;
+    status_updates_dropped = state->status_updates_dropped;
+    parser = state->parser;
+    gen = state->gen;
+    parser_context = state->parser_context;
+    statusline_head = state->statusline_head;
+    TAILQ_RELOCATE(&statusline_head, blocks);
+    statusline_buffer = state->statusline_buffer;
+    TAILQ_RELOCATE(&statusline_buffer, blocks);
+    head_arena = state->head_arena;
+    buffer_arena = state->buffer_arena;
+    child_stdin = state->child_stdin;
+    pending_clicks = state->pending_clicks;
+    TAILQ_RELOCATE(&pending_clicks, clicks);
+    num_pending_clicks = state->num_pending_clicks;
+    clicks_dropped = state->clicks_dropped;
+    child_stdin_io = state->child_stdin_io;
+    status_shm = state->status_shm;
+}
+
+static char *arena_strndup(struct arena_chunk **arena, const char *str, size_t len) {
+    struct arena_chunk *chunk = *arena;
+    if (chunk == NULL || chunk->size - chunk->used < len + 1) {
+        /* Strings must not move, so we start a new chunk, and the chunks are
+         * merged when the arena is reset. */
+        size_t size = (chunk == NULL ? ARENA_CHUNK_SIZE : 2 * chunk->size);
+        if (size < len + 1) {
+            size = len + 1;
+        }
+        struct arena_chunk *new_chunk = smalloc(sizeof(struct arena_chunk) + size);
+        new_chunk->prev = chunk;
+        new_chunk->size = size;
+        new_chunk->used = 0;
+        *arena = chunk = new_chunk;
+    }
+
+    char *result = chunk->data + chunk->used;
+    memcpy(result, str, len);
+    result[len] = '\0';
+    chunk->used += len + 1;
+    return result;
+}
+
+static void arena_reset(struct arena_chunk **arena) {
+    struct arena_chunk *chunk = *arena;
+    if (chunk == NULL) {
+        return;
+    }
+
+    if (chunk->prev != NULL) {
+        size_t size = 0;
+        while (chunk != NULL) {
+            struct arena_chunk *prev = chunk->prev;
+            size += chunk->size;
+            free(chunk);
+            chunk = prev;
+        }
+        chunk = smalloc(sizeof(struct arena_chunk) + size);
+        chunk->prev = NULL;
+        chunk->size = size;
+        *arena = chunk;
+    }
+    chunk->used = 0;
+}
+
+/*
+ * Returns an unused block, all fields set to zero.
+ *
+ */
+static struct status_block *new_status_block(void) {
+    struct status_block *block = TAILQ_FIRST(&spare_blocks);
+    if (block == NULL) {
+        return scalloc(1, sizeof(struct status_block));
+    }
+    TAILQ_REMOVE(&spare_blocks, block, blocks);
+    memset(block, 0, sizeof(struct status_block));
+    return block;
+}
+
+/*
+ * Blocks of statusline_buffer share texts which did not change with the block
+ * at the same position in statusline_head. This drops the shared references
+ * from the blocks in from, so that the texts belong to the blocks in to.
+ *
+ */
+static void unshare_texts(struct statusline_head *from, struct statusline_head *to) {
+    struct status_block *other = TAILQ_FIRST(to);
+    struct status_block *block;
+    TAILQ_FOREACH (block, from, blocks) {
+        if (other == NULL) {
+            break;
+        }
+        if (block->full_text == other->full_text) {
+            block->full_text = NULL;
+        }
+        if (block->short_text == other->short_text) {
+            block->short_text = NULL;
+        }
+        other = TAILQ_NEXT(other, blocks);
+    }
+}
+
 /*
  * Remove all blocks from the given statusline.
- * If free_resources is set, the fields of each status block will be free'd.
+ * If free_resources is set, the texts of each status block will be free'd.
+ * The other strings belong to the statusline's arena.
  */
 void clear_statusline(struct statusline_head *head, bool free_resources) {
+    if (head == &statusline_head) {
+        /* A status line which is being read must not keep texts of the
+         * blocks which are freed here. */
+        unshare_texts(&statusline_buffer, &statusline_head);
+        parser_context.old_block = NULL;
+    }
+
     struct status_block *first;
     while (!TAILQ_EMPTY(head)) {
         first = TAILQ_FIRST(head);
         if (free_resources) {
             I3STRING_FREE(first->full_text);
             I3STRING_FREE(first->short_text);
-            FREE(first->color);
-            FREE(first->name);
-            FREE(first->instance);
-            FREE(first->min_width_str);
-            FREE(first->background);
-            FREE(first->border);
         }
 
         TAILQ_REMOVE(head, first, blocks);
-        free(first);
-    }
-}
-
-static void copy_statusline(struct statusline_head *from, struct statusline_head *to) {
-    struct status_block *current;
-    TAILQ_FOREACH (current, from, blocks) {
-        struct status_block *new_block = smalloc(sizeof(struct status_block));
-        memcpy(new_block, current, sizeof(struct status_block));
-        TAILQ_INSERT_TAIL(to, new_block, blocks);
+        TAILQ_INSERT_TAIL(&spare_blocks, first, blocks);
     }
 }
 
@@ -103,6 +391,7 @@ static void copy_statusline(struct statusline_head *from, struct statusline_head
  */
 __attribute__((format(printf, 1, 2))) static void set_statusline_error(const char *format, ...) {
     clear_statusline(&statusline_head, true);
+    arena_reset(&head_arena);
 
     char *message;
     va_list args;
@@ -111,16 +400,16 @@ __attribute__((format(printf, 1, 2))) static void set_statusline_error(const cha
         goto finish;
     }
 
-    struct status_block *err_block = scalloc(1, sizeof(struct status_block));
+    struct status_block *err_block = new_status_block();
     err_block->full_text = i3string_from_utf8("Error: ");
-    err_block->name = sstrdup("error");
-    err_block->color = sstrdup("#ff0000");
+    err_block->name = arena_strndup(&head_arena, "error", strlen("error"));
+    err_block->color = arena_strndup(&head_arena, "#ff0000", strlen("#ff0000"));
     err_block->no_separator = true;
 
-    struct status_block *message_block = scalloc(1, sizeof(struct status_block));
+    struct status_block *message_block = new_status_block();
     message_block->full_text = i3string_from_utf8(message);
-    message_block->name = sstrdup("error_message");
-    message_block->color = sstrdup("#ff0000");
+    message_block->name = arena_strndup(&head_arena, "error_message", strlen("error_message"));
+    message_block->color = arena_strndup(&head_arena, "#ff0000", strlen("#ff0000"));
     message_block->no_separator = true;
 
     TAILQ_INSERT_HEAD(&statusline_head, err_block, blocks);
@@ -136,6 +425,17 @@ finish:
  *
  */
 static void cleanup(void) {
+    if (child_stdin_io != NULL) {
+        ev_io_stop(main_loop, child_stdin_io);
+        FREE(child_stdin_io);
+    }
+    while (!TAILQ_EMPTY(&pending_clicks)) {
+        struct pending_click *click = TAILQ_FIRST(&pending_clicks);
+        TAILQ_REMOVE(&pending_clicks, click, clicks);
+        free(click);
+    }
+    num_pending_clicks = 0;
+
     if (stdin_io != NULL) {
         ev_io_stop(main_loop, stdin_io);
         FREE(stdin_io);
@@ -150,17 +450,42 @@ static void cleanup(void) {
         FREE(child_sig);
     }
 
+    if (status_redraw_timer != NULL) {
+        ev_timer_stop(main_loop, status_redraw_timer);
+        FREE(status_redraw_timer);
+    }
+    status_updates_pending = 0;
+    status_redraw_unhide = false;
+
+    status_shm_close();
+    FREE(child.shm_name);
     memset(&child, 0, sizeof(i3bar_child));
 }
 
+/*
+ * Returns the width of the separator block of blocks which do not specify
+ * separator_block_width.
+ *
+ */
+uint32_t default_sep_block_width(void) {
+    if (config.separator_symbol == NULL)
+        return logical_px(9);
+    else
+        return logical_px(8) + separator_symbol_width;
+}
+
 /*
  * The start of a new array is the start of a new status line, so we clear all
  * previous entries from the buffer.
  */
 static int stdin_start_array(void *context) {
-    // the blocks are still used by statusline_head, so we won't free the
-    // resources here.
-    clear_statusline(&statusline_buffer, false);
+    parser_ctx *ctx = context;
+    /* The buffer only contains blocks of a status line which was not
+     * completed. Some of their texts might belong to statusline_head. */
+    unshare_texts(&statusline_buffer, &statusline_head);
+    clear_statusline(&statusline_buffer, true);
+    arena_reset(&buffer_arena);
+    ctx->old_block = NULL;
     return 1;
 }
 
@@ -172,11 +497,13 @@ static int stdin_start_map(void *context) {
     parser_ctx *ctx = context;
     memset(&(ctx->block), '\0', sizeof(struct status_block));
 
-    /* Default width of the separator block. */
-    if (config.separator_symbol == NULL)
-        ctx->block.sep_block_width = logical_px(9);
-    else
-        ctx->block.sep_block_width = logical_px(8) + separator_symbol_width;
+    if (TAILQ_EMPTY(&statusline_buffer)) {
+        ctx->old_block = TAILQ_FIRST(&statusline_head);
+    } else if (ctx->old_block != NULL) {
+        ctx->old_block = TAILQ_NEXT(ctx->old_block, blocks);
+    }
+
+    ctx->block.sep_block_width = default_sep_block_width();
 
     /* By default we draw all four borders if a border is set. */
     ctx->block.border_top = 1;
@@ -189,25 +516,42 @@ static int stdin_start_map(void *context) {
 
 static int stdin_map_key(void *context, const unsigned char *key, size_t len) {
     parser_ctx *ctx = context;
-    FREE(ctx->last_map_key);
-    sasprintf(&(ctx->last_map_key), "%.*s", len, key);
+    ctx->map_key = json_key_lookup(&block_keys, key, len);
+    ctx->has_map_key = true;
     return 1;
 }
 
+/*
+ * Returns the given text of the block at the same position in the current
+ * statusline if it has the given contents, otherwise a new i3String. Whether
+ * the text is markup is only known at the end of the block, see
+ * stdin_end_map().
+ *
+ */
+static i3String *status_text(i3String *old, const unsigned char *val, size_t len) {
+    if (old != NULL && strlen(i3string_as_utf8(old)) == len &&
+        memcmp(i3string_as_utf8(old), val, len) == 0) {
+        return old;
+    }
+    return i3string_from_markup_with_length((const char *)val, len);
+}
+
 static int stdin_boolean(void *context, int val) {
     parser_ctx *ctx = context;
 
-    if (!ctx->last_map_key) {
+    if (!ctx->has_map_key) {
         return 0;
     }
 
-    if (strcasecmp(ctx->last_map_key, "urgent") == 0) {
-        ctx->block.urgent = val;
-        return 1;
-    }
-    if (strcasecmp(ctx->last_map_key, "separator") == 0) {
-        ctx->block.no_separator = !val;
-        return 1;
+    switch (ctx->map_key) {
+        case BLOCK_URGENT:
+            ctx->block.urgent = val;
+            break;
+        case BLOCK_SEPARATOR:
+            ctx->block.no_separator = !val;
+            break;
+        default:
+            break;
     }
 
     return 1;
@@ -216,55 +560,49 @@ static int stdin_boolean(void *context, int val) {
 static int stdin_string(void *context, const unsigned char *val, size_t len) {
     parser_ctx *ctx = context;
 
-    if (!ctx->last_map_key) {
+    if (!ctx->has_map_key) {
         return 0;
     }
 
-    if (strcasecmp(ctx->last_map_key, "full_text") == 0) {
-        ctx->block.full_text = i3string_from_markup_with_length((const char *)val, len);
-        return 1;
-    }
-    if (strcasecmp(ctx->last_map_key, "short_text") == 0) {
-        ctx->block.short_text = i3string_from_markup_with_length((const char *)val, len);
-        return 1;
-    }
-    if (strcasecmp(ctx->last_map_key, "color") == 0) {
-        sasprintf(&(ctx->block.color), "%.*s", len, val);
-        return 1;
-    }
-    if (strcasecmp(ctx->last_map_key, "background") == 0) {
-        sasprintf(&(ctx->block.background), "%.*s", len, val);
-        return 1;
-    }
-    if (strcasecmp(ctx->last_map_key, "border") == 0) {
-        sasprintf(&(ctx->block.border), "%.*s", len, val);
-        return 1;
-    }
-    if (strcasecmp(ctx->last_map_key, "markup") == 0) {
-        ctx->block.pango_markup = (len == strlen("pango") && !strncasecmp((const char *)val, "pango", strlen("pango")));
-        return 1;
-    }
-    if (strcasecmp(ctx->last_map_key, "align") == 0) {
-        if (len == strlen("center") && !strncmp((const char *)val, "center", strlen("center"))) {
-            ctx->block.align = ALIGN_CENTER;
-        } else if (len == strlen("right") && !strncmp((const char *)val, "right", strlen("right"))) {
-            ctx->block.align = ALIGN_RIGHT;
-        } else {
-            ctx->block.align = ALIGN_LEFT;
-        }
-        return 1;
-    }
-    if (strcasecmp(ctx->last_map_key, "min_width") == 0) {
-        sasprintf(&(ctx->block.min_width_str), "%.*s", len, val);
-        return 1;
-    }
-    if (strcasecmp(ctx->last_map_key, "name") == 0) {
-        sasprintf(&(ctx->block.name), "%.*s", len, val);
-        return 1;
-    }
-    if (strcasecmp(ctx->last_map_key, "instance") == 0) {
-        sasprintf(&(ctx->block.instance), "%.*s", len, val);
-        return 1;
+    switch (ctx->map_key) {
+        case BLOCK_FULL_TEXT:
+            ctx->block.full_text = status_text(ctx->old_block ? ctx->old_block->full_text : NULL, val, len);
+            break;
+        case BLOCK_SHORT_TEXT:
+            ctx->block.short_text = status_text(ctx->old_block ? ctx->old_block->short_text : NULL, val, len);
+            break;
+        case BLOCK_COLOR:
+            ctx->block.color = arena_strndup(&buffer_arena, (const char *)val, len);
+            break;
+        case BLOCK_BACKGROUND:
+            ctx->block.background = arena_strndup(&buffer_arena, (const char *)val, len);
+            break;
+        case BLOCK_BORDER:
+            ctx->block.border = arena_strndup(&buffer_arena, (const char *)val, len);
+            break;
+        case BLOCK_MARKUP:
+            ctx->block.pango_markup = (len == strlen("pango") && !strncasecmp((const char *)val, "pango", strlen("pango")));
+            break;
+        case BLOCK_ALIGN:
+            if (len == strlen("center") && !strncmp((const char *)val, "center", strlen("center"))) {
+                ctx->block.align = ALIGN_CENTER;
+            } else if (len == strlen("right") && !strncmp((const char *)val, "right", strlen("right"))) {
+                ctx->block.align = ALIGN_RIGHT;
+            } else {
+                ctx->block.align = ALIGN_LEFT;
+            }
+            break;
+        case BLOCK_MIN_WIDTH:
+            ctx->block.min_width_str = arena_strndup(&buffer_arena, (const char *)val, len);
+            break;
+        case BLOCK_NAME:
+            ctx->block.name = arena_strndup(&buffer_arena, (const char *)val, len);
+            break;
+        case BLOCK_INSTANCE:
+            ctx->block.instance = arena_strndup(&buffer_arena, (const char *)val, len);
+            break;
+        default:
+            break;
     }
 
     return 1;
@@ -273,33 +611,31 @@ static int stdin_string(void *context, const unsigned char *val, size_t len) {
 static int stdin_integer(void *context, long long val) {
     parser_ctx *ctx = context;
 
-    if (!ctx->last_map_key) {
+    if (!ctx->has_map_key) {
         return 0;
     }
 
-    if (strcasecmp(ctx->last_map_key, "min_width") == 0) {
-        ctx->block.min_width = (uint32_t)val;
-        return 1;
-    }
-    if (strcasecmp(ctx->last_map_key, "separator_block_width") == 0) {
-        ctx->block.sep_block_width = (uint32_t)val;
-        return 1;
-    }
-    if (strcasecmp(ctx->last_map_key, "border_top") == 0) {
-        ctx->block.border_top = (uint32_t)val;
-        return 1;
-    }
-    if (strcasecmp(ctx->last_map_key, "border_right") == 0) {
-        ctx->block.border_right = (uint32_t)val;
-        return 1;
-    }
-    if (strcasecmp(ctx->last_map_key, "border_bottom") == 0) {
-        ctx->block.border_bottom = (uint32_t)val;
-        return 1;
-    }
-    if (strcasecmp(ctx->last_map_key, "border_left") == 0) {
-        ctx->block.border_left = (uint32_t)val;
-        return 1;
+    switch (ctx->map_key) {
+        case BLOCK_MIN_WIDTH:
+            ctx->block.min_width = (uint32_t)val;
+            break;
+        case BLOCK_SEPARATOR_BLOCK_WIDTH:
+            ctx->block.sep_block_width = (uint32_t)val;
+            break;
+        case BLOCK_BORDER_TOP:
+            ctx->block.border_top = (uint32_t)val;
+            break;
+        case BLOCK_BORDER_RIGHT:
+            ctx->block.border_right = (uint32_t)val;
+            break;
+        case BLOCK_BORDER_BOTTOM:
+            ctx->block.border_bottom = (uint32_t)val;
+            break;
+        case BLOCK_BORDER_LEFT:
+            ctx->block.border_left = (uint32_t)val;
+            break;
+        default:
+            break;
     }
 
     return 1;
@@ -311,7 +647,7 @@ static int stdin_integer(void *context, long long val) {
  */
 static int stdin_end_map(void *context) {
     parser_ctx *ctx = context;
-    struct status_block *new_block = smalloc(sizeof(struct status_block));
+    struct status_block *new_block = new_status_block();
     memcpy(new_block, &(ctx->block), sizeof(struct status_block));
     /* Ensure we have a full_text set, so that when it is missing (or null),
      * i3bar doesn’t crash and the user gets an annoying message. */
@@ -320,11 +656,16 @@ static int stdin_end_map(void *context) {
     if (new_block->urgent)
         ctx->has_urgent = true;
 
-    if (new_block->min_width_str) {
-        i3String *text = i3string_from_utf8(new_block->min_width_str);
-        i3string_set_markup(text, new_block->pango_markup);
-        new_block->min_width = (uint32_t)predict_text_width(text);
-        i3string_free(text);
+    /* A text shared with the current statusline cannot be changed, so it is
+     * only kept if it has the same markup setting. */
+    struct status_block *old = ctx->old_block;
+    if (old != NULL && new_block->full_text == old->full_text &&
+        i3string_is_markup(old->full_text) != new_block->pango_markup) {
+        new_block->full_text = i3string_from_utf8(i3string_as_utf8(old->full_text));
+    }
+    if (old != NULL && new_block->short_text != NULL && new_block->short_text == old->short_text &&
+        i3string_is_markup(old->short_text) != new_block->pango_markup) {
+        new_block->short_text = i3string_from_utf8(i3string_as_utf8(old->short_text));
     }
 
     i3string_set_markup(new_block->full_text, new_block->pango_markup);
@@ -336,14 +677,73 @@ static int stdin_end_map(void *context) {
     return 1;
 }
 
+static bool same_text(i3String *a, i3String *b) {
+    if (a == NULL || b == NULL) {
+        return a == b;
+    }
+    return (i3string_is_markup(a) == i3string_is_markup(b) &&
+            strcmp(i3string_as_utf8(a), i3string_as_utf8(b)) == 0);
+}
+
+/*
+ * Takes the text widths measured for the blocks of the previous statusline
+ * over to the blocks at the same position in the new one where the text did
+ * not change, and measures min_width_str where it changed.
+ *
+ */
+static void carry_over_widths(struct statusline_head *from, struct statusline_head *to) {
+    struct status_block *old = TAILQ_FIRST(from);
+    struct status_block *block;
+    TAILQ_FOREACH (block, to, blocks) {
+        if (old != NULL && old->full_text_width_valid && same_text(old->full_text, block->full_text)) {
+            block->full_text_width = old->full_text_width;
+            block->full_text_width_valid = true;
+        }
+        if (old != NULL && old->short_text_width_valid && same_text(old->short_text, block->short_text)) {
+            block->short_text_width = old->short_text_width;
+            block->short_text_width_valid = true;
+        }
+
+        if (block->min_width_str) {
+            if (old != NULL && old->min_width_str != NULL &&
+                old->pango_markup == block->pango_markup &&
+                strcmp(old->min_width_str, block->min_width_str) == 0) {
+                block->min_width = old->min_width;
+            } else {
+                i3String *text = i3string_from_utf8(block->min_width_str);
+                i3string_set_markup(text, block->pango_markup);
+                block->min_width = (uint32_t)predict_text_width(text);
+                i3string_free(text);
+            }
+        }
+
+        if (old != NULL) {
+            old = TAILQ_NEXT(old, blocks);
+        }
+    }
+}
+
 /*
  * When an array is finished, we have an entire statusline.
- * Copy it from the buffer to the actual statusline.
+ * Move it from the buffer to the actual statusline.
  */
 static int stdin_end_array(void *context) {
-    DLOG("copying statusline_buffer to statusline_head\n");
+    DLOG("moving statusline_buffer to statusline_head\n");
+    carry_over_widths(&statusline_head, &statusline_buffer);
+    unshare_texts(&statusline_head, &statusline_buffer);
     clear_statusline(&statusline_head, true);
-    copy_statusline(&statusline_buffer, &statusline_head);
+    struct status_block *block;
+    while ((block = TAILQ_FIRST(&statusline_buffer)) != NULL) {
+        TAILQ_REMOVE(&statusline_buffer, block, blocks);
+        TAILQ_INSERT_TAIL(&statusline_head, block, blocks);
+    }
+
+    /* The strings of the old statusline are only freed once the next status
+     * line starts. */
+    struct arena_chunk *old_arena = head_arena;
+    head_arena = buffer_arena;
+    buffer_arena = old_arena;
+    status_updates_pending++;
 
     DLOG("dumping statusline:\n");
     struct status_block *current;
@@ -359,43 +759,44 @@ static int stdin_end_array(void *context) {
 /*
  * Helper function to read stdin
  *
- * Returns NULL on EOF.
+ * Returns NULL on EOF. The returned buffer is reused by the next call.
  *
  */
 static unsigned char *get_buffer(ev_io *watcher, int *ret_buffer_len) {
     int fd = watcher->fd;
     int n = 0;
     int rec = 0;
-    int buffer_len = STDIN_CHUNK_SIZE;
-    unsigned char *buffer = smalloc(buffer_len + 1);
+    if (stdin_buffer == NULL) {
+        stdin_buffer_len = STDIN_CHUNK_SIZE;
+        stdin_buffer = smalloc(stdin_buffer_len + 1);
+    }
+    unsigned char *buffer = stdin_buffer;
     buffer[0] = '\0';
     while (1) {
-        n = read(fd, buffer + rec, buffer_len - rec);
+        n = read(fd, buffer + rec, stdin_buffer_len - rec);
         if (n == -1) {
             if (errno == EAGAIN) {
                 /* finish up */
                 break;
             }
             ELOG("read() failed!: %s\n", strerror(errno));
-            FREE(buffer);
             exit(EXIT_FAILURE);
         }
         if (n == 0) {
             ELOG("stdin: received EOF\n");
-            FREE(buffer);
             *ret_buffer_len = -1;
             return NULL;
         }
         rec += n;
 
-        if (rec == buffer_len) {
-            buffer_len += STDIN_CHUNK_SIZE;
-            buffer = srealloc(buffer, buffer_len);
+        if (rec == stdin_buffer_len) {
+            stdin_buffer_len += STDIN_CHUNK_SIZE;
+            stdin_buffer = buffer = srealloc(buffer, stdin_buffer_len + 1);
         }
     }
     if (*buffer == '\0') {
-        FREE(buffer);
-        rec = -1;
+        *ret_buffer_len = -1;
+        return NULL;
     }
     *ret_buffer_len = rec;
     return buffer;
@@ -403,8 +804,6 @@ static unsigned char *get_buffer(ev_io *watcher, int *ret_buffer_len) {
 
 static void read_flat_input(char *buffer, int length) {
     struct status_block *first = TAILQ_FIRST(&statusline_head);
-    /* Clear the old buffer if any. */
-    I3STRING_FREE(first->full_text);
     /* Remove the trailing newline and terminate the string at the same
      * time. */
     if (buffer[length - 1] == '\n' || buffer[length - 1] == '\r') {
@@ -413,7 +812,16 @@ static void read_flat_input(char *buffer, int length) {
         buffer[length] = '\0';
     }
 
+    status_updates_pending++;
+    if (first->full_text != NULL && !i3string_is_markup(first->full_text) &&
+        strcmp(i3string_as_utf8(first->full_text), buffer) == 0) {
+        return;
+    }
+
+    /* Clear the old buffer if any. */
+    I3STRING_FREE(first->full_text);
     first->full_text = i3string_from_utf8(buffer);
+    first->full_text_width_valid = false;
 }
 
 static bool read_json_input(unsigned char *input, int length) {
@@ -438,24 +846,107 @@ static bool read_json_input(unsigned char *input, int length) {
     return has_urgent;
 }
 
+/*
+ * Reads the blocks which changed from the status segment (protocol version 2).
+ * Returns whether one of the blocks is urgent.
+ *
+ */
+static bool read_shm_input(void) {
+    const uint32_t num_blocks = status_shm_num_blocks();
+    uint32_t num_current = 0;
+    struct status_block *block;
+    TAILQ_FOREACH (block, &statusline_head, blocks) {
+        num_current++;
+    }
+
+    const bool rebuild = (num_current != num_blocks);
+    if (rebuild) {
+        clear_statusline(&statusline_head, true);
+        arena_reset(&head_arena);
+        for (uint32_t i = 0; i < num_blocks; i++) {
+            TAILQ_INSERT_TAIL(&statusline_head, new_status_block(), blocks);
+        }
+    }
+
+    bool changed = rebuild;
+    bool has_urgent = false;
+    uint32_t index = 0;
+    TAILQ_FOREACH (block, &statusline_head, blocks) {
+        changed |= status_shm_read_block(index++, rebuild, block);
+        has_urgent |= block->urgent;
+    }
+    if (!changed) {
+        return false;
+    }
+    status_updates_pending++;
+    return has_urgent;
+}
+
+/*
+ * Draws the most recent status line. All status lines which were read since the
+ * last redraw except for the most recent one are counted as dropped.
+ *
+ */
+static void redraw_statusline(void) {
+    if (status_updates_pending > 1) {
+        status_updates_dropped += status_updates_pending - 1;
+        DLOG("Coalesced %u status lines, %" PRIu64 " dropped in total\n",
+             status_updates_pending, status_updates_dropped);
+    }
+    bool unhide = status_redraw_unhide;
+    status_updates_pending = 0;
+    status_redraw_unhide = false;
+    last_status_redraw = ev_now(main_loop);
+    draw_statusline_changes(unhide);
+}
+
+static void status_redraw_timer_cb(struct ev_loop *loop, ev_timer *watcher, int revents) {
+    activate_bar(watcher->data);
+    redraw_statusline();
+}
+
 /*
  * Callbalk for stdin. We read a line from stdin and store the result
  * in statusline
  *
  */
 static void stdin_io_cb(struct ev_loop *loop, ev_io *watcher, int revents) {
+    activate_bar(watcher->data);
     int rec;
     unsigned char *buffer = get_buffer(watcher, &rec);
     if (buffer == NULL)
         return;
-    bool has_urgent = false;
-    if (child.version > 0) {
-        has_urgent = read_json_input(buffer, rec);
+    if (child.version == STATUS_SHM_VERSION) {
+        /* The input only signals that the segment changed. */
+        status_redraw_unhide |= read_shm_input();
+    } else if (child.version > 0) {
+        status_redraw_unhide |= read_json_input(buffer, rec);
     } else {
         read_flat_input((char *)buffer, rec);
     }
-    free(buffer);
-    draw_bars(has_urgent);
+
+    /* Nothing to draw until a status line is complete. */
+    if (status_updates_pending == 0 && !status_redraw_unhide) {
+        return;
+    }
+
+    if (config.status_update_interval <= 0) {
+        redraw_statusline();
+        return;
+    }
+
+    /* A redraw is already scheduled, it will pick up this status line. */
+    if (ev_is_active(status_redraw_timer)) {
+        return;
+    }
+
+    const ev_tstamp wait = last_status_redraw + config.status_update_interval / 1000.0 - ev_now(main_loop);
+    if (wait <= 0) {
+        redraw_statusline();
+        return;
+    }
+    ev_timer_set(status_redraw_timer, wait, 0.);
+    ev_timer_start(main_loop, status_redraw_timer);
 }
 
 /*
@@ -464,6 +955,7 @@ static void stdin_io_cb(struct ev_loop *loop, ev_io *watcher, int revents) {
  *
  */
 static void stdin_io_first_line_cb(struct ev_loop *loop, ev_io *watcher, int revents) {
+    activate_bar(watcher->data);
     int rec;
     unsigned char *buffer = get_buffer(watcher, &rec);
     if (buffer == NULL)
@@ -480,7 +972,14 @@ static void stdin_io_first_line_cb(struct ev_loop *loop, ev_io *watcher, int rev
         if (config.hide_on_modifier) {
             stop_child();
         }
-        draw_bars(read_json_input(buffer + consumed, rec - consumed));
+        if (child.version != STATUS_SHM_VERSION) {
+            draw_bars(read_json_input(buffer + consumed, rec - consumed));
+        } else if (child.shm_name == NULL || !status_shm_open(child.shm_name)) {
+            set_statusline_error("Could not open the status segment %s", child.shm_name ? child.shm_name : "(not set)");
+            draw_bars(false);
+        } else {
+            draw_bars(read_shm_input());
+        }
     } else {
         /* In case of plaintext, we just add a single block and change its
          * full_text pointer later. */
@@ -488,9 +987,11 @@ static void stdin_io_first_line_cb(struct ev_loop *loop, ev_io *watcher, int rev
         TAILQ_INSERT_TAIL(&statusline_head, new_block, blocks);
         read_flat_input((char *)buffer, rec);
     }
-    free(buffer);
+    status_updates_pending = 0;
+    last_status_redraw = ev_now(main_loop);
     ev_io_stop(main_loop, stdin_io);
     ev_io_init(stdin_io, &stdin_io_cb, stdin_fd, EV_READ);
+    stdin_io->data = active_bar;
     ev_io_start(main_loop, stdin_io);
 }
 
@@ -501,6 +1002,7 @@ static void stdin_io_first_line_cb(struct ev_loop *loop, ev_io *watcher, int rev
  *
  */
 static void child_sig_cb(struct ev_loop *loop, ev_child *watcher, int revents) {
+    activate_bar(watcher->data);
     int exit_status = WEXITSTATUS(watcher->rstatus);
 
     ELOG("Child (pid: %d) unexpectedly exited with status %d\n",
@@ -520,26 +1022,90 @@ static void child_sig_cb(struct ev_loop *loop, ev_child *watcher, int revents) {
     draw_bars(false);
 }
 
-static void child_write_output(void) {
+/*
+ * Writes as many of the pending click events to the child as it accepts
+ * without blocking. The rest is written once the child's stdin is writable.
+ *
+ */
+static void flush_clicks(void) {
+    while (!TAILQ_EMPTY(&pending_clicks)) {
+        struct pending_click *click = TAILQ_FIRST(&pending_clicks);
+        const ssize_t n = writeall_nonblock(child_stdin, click->data + click->written, click->len - click->written);
+        if (n == -1) {
+            child.click_events = false;
+            kill_child();
+            set_statusline_error("child_write_output failed");
+            draw_bars(false);
+            return;
+        }
+
+        click->written += n;
+        if (click->written < click->len) {
+            ev_io_start(main_loop, child_stdin_io);
+            return;
+        }
+        TAILQ_REMOVE(&pending_clicks, click, clicks);
+        free(click);
+        num_pending_clicks--;
+    }
+    ev_io_stop(main_loop, child_stdin_io);
+}
+
+static void child_stdin_writable_cb(struct ev_loop *loop, ev_io *watcher, int revents) {
+    activate_bar(watcher->data);
+    flush_clicks();
+}
+
+/*
+ * Drops the oldest click event which was not started to be written yet.
+ *
+ */
+static void drop_oldest_click(void) {
+    struct pending_click *click;
+    TAILQ_FOREACH (click, &pending_clicks, clicks) {
+        if (click->droppable && click->written == 0) {
+            break;
+        }
+    }
+    if (click == NULL) {
+        return;
+    }
+
+    TAILQ_REMOVE(&pending_clicks, click, clicks);
+    free(click);
+    num_pending_clicks--;
+    clicks_dropped++;
+    ELOG("The status command does not read its click events, dropped the oldest one (%" PRIu64 " dropped in total)\n",
+         clicks_dropped);
+}
+
+/*
+ * Queues the output of the JSON generator (and a newline) to be written to
+ * the child.
+ *
+ */
+static void child_write_output(bool droppable) {
     if (child.click_events) {
         const unsigned char *output;
         size_t size;
-        ssize_t n;
 
         yajl_gen_get_buf(gen, &output, &size);
 
-        n = writeall(child_stdin, output, size);
-        if (n != -1)
-            n = writeall(child_stdin, "\n", 1);
+        if (num_pending_clicks >= MAX_PENDING_CLICKS) {
+            drop_oldest_click();
+        }
+        struct pending_click *click = smalloc(sizeof(struct pending_click) + size + 1);
+        memcpy(click->data, output, size);
+        click->data[size] = '\n';
+        click->len = size + 1;
+        click->written = 0;
+        click->droppable = droppable;
+        TAILQ_INSERT_TAIL(&pending_clicks, click, clicks);
+        num_pending_clicks++;
 
         yajl_gen_clear(gen);
 
-        if (n == -1) {
-            child.click_events = false;
-            kill_child();
-            set_statusline_error("child_write_output failed");
-            draw_bars(false);
-        }
+        flush_clicks();
     }
 }
 
@@ -610,17 +1176,32 @@ void start_child(char *command) {
 
     /* We set O_NONBLOCK because blocking is evil in event-driven software */
     fcntl(stdin_fd, F_SETFL, O_NONBLOCK);
+    fcntl(child_stdin, F_SETFL, O_NONBLOCK);
+
+    child_stdin_io = smalloc(sizeof(ev_io));
+    ev_io_init(child_stdin_io, &child_stdin_writable_cb, child_stdin, EV_WRITE);
+    child_stdin_io->data = active_bar;
 
     stdin_io = smalloc(sizeof(ev_io));
     ev_io_init(stdin_io, &stdin_io_first_line_cb, stdin_fd, EV_READ);
+    stdin_io->data = active_bar;
     ev_io_start(main_loop, stdin_io);
 
     /* We must cleanup, if the child unexpectedly terminates */
     child_sig = smalloc(sizeof(ev_child));
     ev_child_init(child_sig, &child_sig_cb, child.pid, 0);
+    child_sig->data = active_bar;
     ev_child_start(main_loop, child_sig);
 
-    atexit(kill_child_at_exit);
+    status_redraw_timer = smalloc(sizeof(ev_timer));
+    ev_timer_init(status_redraw_timer, &status_redraw_timer_cb, 0., 0.);
+    status_redraw_timer->data = active_bar;
+
+    static bool atexit_registered = false;
+    if (!atexit_registered) {
+        atexit(kill_child_at_exit);
+        atexit_registered = true;
+    }
     DLOG_CHILD;
 }
 
@@ -629,7 +1210,7 @@ static void child_click_events_initialize(void) {
 
     if (!child.click_events_init) {
         yajl_gen_array_open(gen);
-        child_write_output();
+        child_write_output(false);
         child.click_events_init = true;
     }
 }
@@ -703,20 +1284,24 @@ void send_block_clicked(int button, const char *name, const char *instance, int
     yajl_gen_integer(gen, height);
 
     yajl_gen_map_close(gen);
-    child_write_output();
+    child_write_output(true);
 }
 
 /*
- * kill()s the child process (if any). Called when exit()ing.
+ * kill()s the child processes (if any) of all bars. Called when exit()ing.
  *
  */
 void kill_child_at_exit(void) {
     DLOG_CHILD;
 
-    if (child.pid > 0) {
-        if (child.cont_signal > 0 && child.stopped)
-            killpg(child.pid, child.cont_signal);
-        killpg(child.pid, SIGTERM);
+    i3_bar *bar;
+    TAILQ_FOREACH (bar, &bars, bars) {
+        const i3bar_child *c = (bar == active_bar ? &child : &(bar->child->child));
+        if (c->pid > 0) {
+            if (c->cont_signal > 0 && c->stopped)
+                killpg(c->pid, c->cont_signal);
+            killpg(c->pid, SIGTERM);
+        }
     }
 }
 
@@ -17,24 +17,117 @@
 
 config_t config;
 static char *cur_key;
+static int cur_key_id = JSON_KEY_UNKNOWN;
 static bool parsing_bindings;
 static bool parsing_tray_outputs;
 
+/* The colors of the bar config, as (JSON key, member of config.colors). */
+#define BAR_COLORS(X)                                \
+    X(statusline, bar_fg)                            \
+    X(background, bar_bg)                            \
+    X(separator, sep_fg)                             \
+    X(focused_statusline, focus_bar_fg)              \
+    X(focused_background, focus_bar_bg)              \
+    X(focused_separator, focus_sep_fg)               \
+    X(focused_workspace_border, focus_ws_border)     \
+    X(focused_workspace_bg, focus_ws_bg)             \
+    X(focused_workspace_text, focus_ws_fg)           \
+    X(active_workspace_border, active_ws_border)     \
+    X(active_workspace_bg, active_ws_bg)             \
+    X(active_workspace_text, active_ws_fg)           \
+    X(inactive_workspace_border, inactive_ws_border) \
+    X(inactive_workspace_bg, inactive_ws_bg)         \
+    X(inactive_workspace_text, inactive_ws_fg)       \
+    X(urgent_workspace_border, urgent_ws_border)     \
+    X(urgent_workspace_bg, urgent_ws_bg)             \
+    X(urgent_workspace_text, urgent_ws_fg)           \
+    X(binding_mode_border, binding_mode_border)      \
+    X(binding_mode_bg, binding_mode_bg)              \
+    X(binding_mode_text, binding_mode_fg)
+
+/* The keys of a GET_BAR_CONFIG reply. */
+typedef enum {
+    KEY_ID,
+    KEY_SOCKET_PATH,
+    KEY_BINDINGS,
+    KEY_TRAY_OUTPUTS,
+    KEY_COMMAND,
+    KEY_RELEASE,
+    KEY_INPUT_CODE,
+    KEY_MODE,
+    KEY_HIDDEN_STATE,
+    KEY_MODIFIER,
+    KEY_WHEEL_UP_CMD,
+    KEY_WHEEL_DOWN_CMD,
+    KEY_POSITION,
+    KEY_STATUS_COMMAND,
+    KEY_FONT,
+    KEY_SEPARATOR_SYMBOL,
+    KEY_OUTPUTS,
+    KEY_TRAY_OUTPUT,
+    KEY_BINDING_MODE_INDICATOR,
+    KEY_WORKSPACE_BUTTONS,
+    KEY_STRIP_WORKSPACE_NUMBERS,
+    KEY_STRIP_WORKSPACE_NAME,
+    KEY_VERBOSE,
+    KEY_TRAY_PADDING,
+    KEY_WORKSPACE_MIN_WIDTH,
+    KEY_STATUS_UPDATE_INTERVAL,
+#define COLOR_KEY(json_name, struct_name) KEY_COLOR_##json_name,
+    BAR_COLORS(COLOR_KEY)
+#undef COLOR_KEY
+} config_key_t;
+
+static const char *const config_key_names[] = {
+    [KEY_ID] = "id",
+    [KEY_SOCKET_PATH] = "socket_path",
+    [KEY_BINDINGS] = "bindings",
+    [KEY_TRAY_OUTPUTS] = "tray_outputs",
+    [KEY_COMMAND] = "command",
+    [KEY_RELEASE] = "release",
+    [KEY_INPUT_CODE] = "input_code",
+    [KEY_MODE] = "mode",
+    [KEY_HIDDEN_STATE] = "hidden_state",
+    [KEY_MODIFIER] = "modifier",
+    [KEY_WHEEL_UP_CMD] = "wheel_up_cmd",
+    [KEY_WHEEL_DOWN_CMD] = "wheel_down_cmd",
+    [KEY_POSITION] = "position",
+    [KEY_STATUS_COMMAND] = "status_command",
+    [KEY_FONT] = "font",
+    [KEY_SEPARATOR_SYMBOL] = "separator_symbol",
+    [KEY_OUTPUTS] = "outputs",
+    [KEY_TRAY_OUTPUT] = "tray_output",
+    [KEY_BINDING_MODE_INDICATOR] = "binding_mode_indicator",
+    [KEY_WORKSPACE_BUTTONS] = "workspace_buttons",
+    [KEY_STRIP_WORKSPACE_NUMBERS] = "strip_workspace_numbers",
+    [KEY_STRIP_WORKSPACE_NAME] = "strip_workspace_name",
+    [KEY_VERBOSE] = "verbose",
+    [KEY_TRAY_PADDING] = "tray_padding",
+    [KEY_WORKSPACE_MIN_WIDTH] = "workspace_min_width",
+    [KEY_STATUS_UPDATE_INTERVAL] = "status_update_interval",
+#define COLOR_NAME(json_name, struct_name) [KEY_COLOR_##json_name] = #json_name,
+    BAR_COLORS(COLOR_NAME)
+#undef COLOR_NAME
+};
+
+static json_key_table_t config_keys = JSON_KEY_TABLE(config_key_names, false);
+
 /*
  * Parse a key.
  *
- * Essentially we just save it in cur_key.
+ * Essentially we just save it (and its id) in cur_key.
  *
  */
 static int config_map_key_cb(void *params_, const unsigned char *keyVal, size_t keyLen) {
     FREE(cur_key);
     sasprintf(&(cur_key), "%.*s", keyLen, keyVal);
+    cur_key_id = json_key_lookup(&config_keys, keyVal, keyLen);
 
-    if (strcmp(cur_key, "bindings") == 0) {
+    if (cur_key_id == KEY_BINDINGS) {
         parsing_bindings = true;
     }
 
-    if (strcmp(cur_key, "tray_outputs") == 0) {
+    if (cur_key_id == KEY_TRAY_OUTPUTS) {
         parsing_tray_outputs = true;
     }
 
@@ -52,7 +145,7 @@ static int config_end_array_cb(void *params_) {
  *
  */
 static int config_null_cb(void *params_) {
-    if (!strcmp(cur_key, "id")) {
+    if (cur_key_id == KEY_ID) {
         /* If 'id' is NULL, the bar config was not found. Error out. */
         ELOG("No such bar config. Use 'i3-msg -t get_bar_config' to get the available configs.\n");
         ELOG("Are you starting i3bar by hand? You should not:\n");
@@ -69,12 +162,9 @@ static int config_null_cb(void *params_) {
  */
 static int config_string_cb(void *params_, const unsigned char *val, size_t _len) {
     int len = (int)_len;
-    /* The id and socket_path are ignored, we already know them. */
-    if (!strcmp(cur_key, "id") || !strcmp(cur_key, "socket_path"))
-        return 1;
 
     if (parsing_bindings) {
-        if (strcmp(cur_key, "command") == 0) {
+        if (cur_key_id == KEY_COMMAND) {
             binding_t *binding = TAILQ_LAST(&(config.bindings), bindings_head);
             if (binding == NULL) {
                 ELOG("There is no binding to put the current command onto. This is a bug in i3.\n");
@@ -102,155 +192,127 @@ static int config_string_cb(void *params_, const unsigned char *val, size_t _len
         return 1;
     }
 
-    if (!strcmp(cur_key, "mode")) {
-        DLOG("mode = %.*s, len = %d\n", len, val, len);
-        config.hide_on_modifier = (len == strlen("dock") && !strncmp((const char *)val, "dock", strlen("dock")) ? M_DOCK
-                                                                                                                : (len == strlen("hide") && !strncmp((const char *)val, "hide", strlen("hide")) ? M_HIDE
-                                                                                                                                                                                                : M_INVISIBLE));
-        return 1;
-    }
+    switch (cur_key_id) {
+        case KEY_ID:
+        case KEY_SOCKET_PATH:
+            /* The id and socket_path are ignored, we already know them. */
+            return 1;
 
-    if (!strcmp(cur_key, "hidden_state")) {
-        DLOG("hidden_state = %.*s, len = %d\n", len, val, len);
-        config.hidden_state = (len == strlen("hide") && !strncmp((const char *)val, "hide", strlen("hide")) ? S_HIDE : S_SHOW);
-        return 1;
-    }
+        case KEY_MODE:
+            DLOG("mode = %.*s, len = %d\n", len, val, len);
+            config.hide_on_modifier = (len == strlen("dock") && !strncmp((const char *)val, "dock", strlen("dock")) ? M_DOCK
+                                                                                                                    : (len == strlen("hide") && !strncmp((const char *)val, "hide", strlen("hide")) ? M_HIDE
+                                                                                                                                                                                                    : M_INVISIBLE));
+            return 1;
 
-    /* Kept for backwards compatibility. */
-    if (!strcmp(cur_key, "modifier")) {
-        DLOG("modifier = %.*s\n", len, val);
-        if (len == strlen("none") && !strncmp((const char *)val, "none", strlen("none"))) {
-            config.modifier = XCB_NONE;
+        case KEY_HIDDEN_STATE:
+            DLOG("hidden_state = %.*s, len = %d\n", len, val, len);
+            config.hidden_state = (len == strlen("hide") && !strncmp((const char *)val, "hide", strlen("hide")) ? S_HIDE : S_SHOW);
             return 1;
-        }
 
-        if (len == strlen("shift") && !strncmp((const char *)val, "shift", strlen("shift"))) {
-            config.modifier = XCB_MOD_MASK_SHIFT;
+        /* Kept for backwards compatibility. */
+        case KEY_MODIFIER:
+            DLOG("modifier = %.*s\n", len, val);
+            if (len == strlen("none") && !strncmp((const char *)val, "none", strlen("none"))) {
+                config.modifier = XCB_NONE;
+                return 1;
+            }
+
+            if (len == strlen("shift") && !strncmp((const char *)val, "shift", strlen("shift"))) {
+                config.modifier = XCB_MOD_MASK_SHIFT;
+                return 1;
+            }
+            if (len == strlen("ctrl") && !strncmp((const char *)val, "ctrl", strlen("ctrl"))) {
+                config.modifier = XCB_MOD_MASK_CONTROL;
+                return 1;
+            }
+            if (len == strlen("Mod") + 1 && !strncmp((const char *)val, "Mod", strlen("Mod"))) {
+                switch (val[3]) {
+                    case '1':
+                        config.modifier = XCB_MOD_MASK_1;
+                        return 1;
+                    case '2':
+                        config.modifier = XCB_MOD_MASK_2;
+                        return 1;
+                    case '3':
+                        config.modifier = XCB_MOD_MASK_3;
+                        return 1;
+                    case '5':
+                        config.modifier = XCB_MOD_MASK_5;
+                        return 1;
+                }
+            }
+
+            config.modifier = XCB_MOD_MASK_4;
             return 1;
-        }
-        if (len == strlen("ctrl") && !strncmp((const char *)val, "ctrl", strlen("ctrl"))) {
-            config.modifier = XCB_MOD_MASK_CONTROL;
+
+        /* These keys were sent in <= 4.10.2. We keep them around to avoid
+         * breakage for users updating from that version and restarting i3bar
+         * before i3. */
+        case KEY_WHEEL_UP_CMD:
+        case KEY_WHEEL_DOWN_CMD: {
+            DLOG("%s = %.*s\n", cur_key, len, val);
+            binding_t *binding = scalloc(1, sizeof(binding_t));
+            binding->input_code = (cur_key_id == KEY_WHEEL_UP_CMD ? 4 : 5);
+            sasprintf(&(binding->command), "%.*s", len, val);
+            TAILQ_INSERT_TAIL(&(config.bindings), binding, bindings);
             return 1;
         }
-        if (len == strlen("Mod") + 1 && !strncmp((const char *)val, "Mod", strlen("Mod"))) {
-            switch (val[3]) {
-                case '1':
-                    config.modifier = XCB_MOD_MASK_1;
-                    return 1;
-                case '2':
-                    config.modifier = XCB_MOD_MASK_2;
-                    return 1;
-                case '3':
-                    config.modifier = XCB_MOD_MASK_3;
-                    return 1;
-                case '5':
-                    config.modifier = XCB_MOD_MASK_5;
-                    return 1;
-            }
-        }
 
-        config.modifier = XCB_MOD_MASK_4;
-        return 1;
-    }
+        case KEY_POSITION:
+            DLOG("position = %.*s\n", len, val);
+            config.position = (len == strlen("top") && !strncmp((const char *)val, "top", strlen("top")) ? POS_TOP : POS_BOT);
+            return 1;
 
-    /* This key was sent in <= 4.10.2. We keep it around to avoid breakage for
-     * users updating from that version and restarting i3bar before i3. */
-    if (!strcmp(cur_key, "wheel_up_cmd")) {
-        DLOG("wheel_up_cmd = %.*s\n", len, val);
-        binding_t *binding = scalloc(1, sizeof(binding_t));
-        binding->input_code = 4;
-        sasprintf(&(binding->command), "%.*s", len, val);
-        TAILQ_INSERT_TAIL(&(config.bindings), binding, bindings);
-        return 1;
-    }
+        case KEY_STATUS_COMMAND:
+            DLOG("command = %.*s\n", len, val);
+            sasprintf(&config.command, "%.*s", len, val);
+            return 1;
 
-    /* This key was sent in <= 4.10.2. We keep it around to avoid breakage for
-     * users updating from that version and restarting i3bar before i3. */
-    if (!strcmp(cur_key, "wheel_down_cmd")) {
-        DLOG("wheel_down_cmd = %.*s\n", len, val);
-        binding_t *binding = scalloc(1, sizeof(binding_t));
-        binding->input_code = 5;
-        sasprintf(&(binding->command), "%.*s", len, val);
-        TAILQ_INSERT_TAIL(&(config.bindings), binding, bindings);
-        return 1;
-    }
+        case KEY_FONT:
+            DLOG("font = %.*s\n", len, val);
+            FREE(config.fontname);
+            sasprintf(&config.fontname, "%.*s", len, val);
+            return 1;
 
-    if (!strcmp(cur_key, "position")) {
-        DLOG("position = %.*s\n", len, val);
-        config.position = (len == strlen("top") && !strncmp((const char *)val, "top", strlen("top")) ? POS_TOP : POS_BOT);
-        return 1;
-    }
+        case KEY_SEPARATOR_SYMBOL:
+            DLOG("separator = %.*s\n", len, val);
+            I3STRING_FREE(config.separator_symbol);
+            config.separator_symbol = i3string_from_utf8_with_length((const char *)val, len);
+            return 1;
 
-    if (!strcmp(cur_key, "status_command")) {
-        DLOG("command = %.*s\n", len, val);
-        sasprintf(&config.command, "%.*s", len, val);
-        return 1;
-    }
+        case KEY_OUTPUTS: {
+            DLOG("+output %.*s\n", len, val);
+            int new_num_outputs = config.num_outputs + 1;
+            config.outputs = srealloc(config.outputs, sizeof(char *) * new_num_outputs);
+            sasprintf(&config.outputs[config.num_outputs], "%.*s", len, val);
+            config.num_outputs = new_num_outputs;
+            return 1;
+        }
 
-    if (!strcmp(cur_key, "font")) {
-        DLOG("font = %.*s\n", len, val);
-        FREE(config.fontname);
-        sasprintf(&config.fontname, "%.*s", len, val);
-        return 1;
-    }
+        /* We keep the old single tray_output working for users who only restart i3bar
+         * after updating. */
+        case KEY_TRAY_OUTPUT: {
+            DLOG("Found deprecated key tray_output %.*s.\n", len, val);
+            tray_output_t *tray_output = scalloc(1, sizeof(tray_output_t));
+            sasprintf(&(tray_output->output), "%.*s", len, val);
+            TAILQ_INSERT_TAIL(&(config.tray_outputs), tray_output, tray_outputs);
+            return 1;
+        }
 
-    if (!strcmp(cur_key, "separator_symbol")) {
-        DLOG("separator = %.*s\n", len, val);
-        I3STRING_FREE(config.separator_symbol);
-        config.separator_symbol = i3string_from_utf8_with_length((const char *)val, len);
+#define COLOR(json_name, struct_name)                              \
+    case KEY_COLOR_##json_name:                                    \
+        DLOG(#json_name " = " #struct_name " = %.*s\n", len, val); \
+        sasprintf(&(config.colors.struct_name), "%.*s", len, val); \
         return 1;
-    }
 
-    if (!strcmp(cur_key, "outputs")) {
-        DLOG("+output %.*s\n", len, val);
-        int new_num_outputs = config.num_outputs + 1;
-        config.outputs = srealloc(config.outputs, sizeof(char *) * new_num_outputs);
-        sasprintf(&config.outputs[config.num_outputs], "%.*s", len, val);
-        config.num_outputs = new_num_outputs;
-        return 1;
-    }
+        BAR_COLORS(COLOR)
+#undef COLOR
 
-    /* We keep the old single tray_output working for users who only restart i3bar
-     * after updating. */
-    if (!strcmp(cur_key, "tray_output")) {
-        DLOG("Found deprecated key tray_output %.*s.\n", len, val);
-        tray_output_t *tray_output = scalloc(1, sizeof(tray_output_t));
-        sasprintf(&(tray_output->output), "%.*s", len, val);
-        TAILQ_INSERT_TAIL(&(config.tray_outputs), tray_output, tray_outputs);
-        return 1;
+        default:
+            break;
     }
 
-#define COLOR(json_name, struct_name)                                  \
-    do {                                                               \
-        if (!strcmp(cur_key, #json_name)) {                            \
-            DLOG(#json_name " = " #struct_name " = %.*s\n", len, val); \
-            sasprintf(&(config.colors.struct_name), "%.*s", len, val); \
-            return 1;                                                  \
-        }                                                              \
-    } while (0)
-
-    COLOR(statusline, bar_fg);
-    COLOR(background, bar_bg);
-    COLOR(separator, sep_fg);
-    COLOR(focused_statusline, focus_bar_fg);
-    COLOR(focused_background, focus_bar_bg);
-    COLOR(focused_separator, focus_sep_fg);
-    COLOR(focused_workspace_border, focus_ws_border);
-    COLOR(focused_workspace_bg, focus_ws_bg);
-    COLOR(focused_workspace_text, focus_ws_fg);
-    COLOR(active_workspace_border, active_ws_border);
-    COLOR(active_workspace_bg, active_ws_bg);
-    COLOR(active_workspace_text, active_ws_fg);
-    COLOR(inactive_workspace_border, inactive_ws_border);
-    COLOR(inactive_workspace_bg, inactive_ws_bg);
-    COLOR(inactive_workspace_text, inactive_ws_fg);
-    COLOR(urgent_workspace_border, urgent_ws_border);
-    COLOR(urgent_workspace_bg, urgent_ws_bg);
-    COLOR(urgent_workspace_text, urgent_ws_fg);
-    COLOR(binding_mode_border, binding_mode_border);
-    COLOR(binding_mode_bg, binding_mode_bg);
-    COLOR(binding_mode_text, binding_mode_fg);
-
     printf("got unexpected string %.*s for cur_key = %s\n", len, val, cur_key);
 
     return 0;
@@ -262,7 +324,7 @@ static int config_string_cb(void *params_, const unsigned char *val, size_t _len
  */
 static int config_boolean_cb(void *params_, int val) {
     if (parsing_bindings) {
-        if (strcmp(cur_key, "release") == 0) {
+        if (cur_key_id == KEY_RELEASE) {
             binding_t *binding = TAILQ_LAST(&(config.bindings), bindings_head);
             if (binding == NULL) {
                 ELOG("There is no binding to put the current command onto. This is a bug in i3.\n");
@@ -276,39 +338,37 @@ static int config_boolean_cb(void *params_, int val) {
         ELOG("Unknown key \"%s\" while parsing bar bindings.\n", cur_key);
     }
 
-    if (!strcmp(cur_key, "binding_mode_indicator")) {
-        DLOG("binding_mode_indicator = %d\n", val);
-        config.disable_binding_mode_indicator = !val;
-        return 1;
-    }
+    switch (cur_key_id) {
+        case KEY_BINDING_MODE_INDICATOR:
+            DLOG("binding_mode_indicator = %d\n", val);
+            config.disable_binding_mode_indicator = !val;
+            return 1;
 
-    if (!strcmp(cur_key, "workspace_buttons")) {
-        DLOG("workspace_buttons = %d\n", val);
-        config.disable_ws = !val;
-        return 1;
-    }
+        case KEY_WORKSPACE_BUTTONS:
+            DLOG("workspace_buttons = %d\n", val);
+            config.disable_ws = !val;
+            return 1;
 
-    if (!strcmp(cur_key, "strip_workspace_numbers")) {
-        DLOG("strip_workspace_numbers = %d\n", val);
-        config.strip_ws_numbers = val;
-        return 1;
-    }
+        case KEY_STRIP_WORKSPACE_NUMBERS:
+            DLOG("strip_workspace_numbers = %d\n", val);
+            config.strip_ws_numbers = val;
+            return 1;
 
-    if (!strcmp(cur_key, "strip_workspace_name")) {
-        DLOG("strip_workspace_name = %d\n", val);
-        config.strip_ws_name = val;
-        return 1;
-    }
+        case KEY_STRIP_WORKSPACE_NAME:
+            DLOG("strip_workspace_name = %d\n", val);
+            config.strip_ws_name = val;
+            return 1;
 
-    if (!strcmp(cur_key, "verbose")) {
-        if (!config.verbose) {
-            DLOG("verbose = %d\n", val);
-            config.verbose = val;
-        }
-        return 1;
-    }
+        case KEY_VERBOSE:
+            if (!config.verbose) {
+                DLOG("verbose = %d\n", val);
+                config.verbose = val;
+            }
+            return 1;
 
-    return 0;
+        default:
+            return 0;
+    }
 }
 
 /*
@@ -317,7 +377,7 @@ static int config_boolean_cb(void *params_, int val) {
  */
 static int config_integer_cb(void *params_, long long val) {
     if (parsing_bindings) {
-        if (strcmp(cur_key, "input_code") == 0) {
+        if (cur_key_id == KEY_INPUT_CODE) {
             binding_t *binding = scalloc(1, sizeof(binding_t));
             binding->input_code = val;
             TAILQ_INSERT_TAIL(&(config.bindings), binding, bindings);
@@ -329,25 +389,30 @@ static int config_integer_cb(void *params_, long long val) {
         return 0;
     }
 
-    if (!strcmp(cur_key, "tray_padding")) {
-        DLOG("tray_padding = %lld\n", val);
-        config.tray_padding = val;
-        return 1;
-    }
+    switch (cur_key_id) {
+        case KEY_TRAY_PADDING:
+            DLOG("tray_padding = %lld\n", val);
+            config.tray_padding = val;
+            return 1;
 
-    if (!strcmp(cur_key, "modifier")) {
-        DLOG("modifier = %lld\n", val);
-        config.modifier = (uint32_t)val;
-        return 1;
-    }
+        case KEY_MODIFIER:
+            DLOG("modifier = %lld\n", val);
+            config.modifier = (uint32_t)val;
+            return 1;
 
-    if (!strcmp(cur_key, "workspace_min_width")) {
-        DLOG("workspace_min_width = %lld\n", val);
-        config.ws_min_width = val;
-        return 1;
-    }
+        case KEY_WORKSPACE_MIN_WIDTH:
+            DLOG("workspace_min_width = %lld\n", val);
+            config.ws_min_width = val;
+            return 1;
 
-    return 0;
+        case KEY_STATUS_UPDATE_INTERVAL:
+            DLOG("status_update_interval = %lld\n", val);
+            config.status_update_interval = val;
+            return 1;
+
+        default:
+            return 0;
+    }
 }
 
 /* A datastructure to pass all these callbacks to yajl */
@@ -437,3 +502,40 @@ void free_colors(struct xcb_color_strings_t *colors) {
     FREE_COLOR(binding_mode_border);
 #undef FREE_COLOR
 }
+
+/*
+ * Returns true if any of the color strings differ.
+ *
+ */
+bool colors_differ(const struct xcb_color_strings_t *a, const struct xcb_color_strings_t *b) {
+#define COLOR_DIFFERS(x)                      \
+    do {                                      \
+        if ((a->x == NULL) != (b->x == NULL)) \
+            return true;                      \
+        if (a->x && strcmp(a->x, b->x) != 0)  \
+            return true;                      \
+    } while (0)
+    COLOR_DIFFERS(bar_fg);
+    COLOR_DIFFERS(bar_bg);
+    COLOR_DIFFERS(sep_fg);
+    COLOR_DIFFERS(focus_bar_fg);
+    COLOR_DIFFERS(focus_bar_bg);
+    COLOR_DIFFERS(focus_sep_fg);
+    COLOR_DIFFERS(active_ws_fg);
+    COLOR_DIFFERS(active_ws_bg);
+    COLOR_DIFFERS(active_ws_border);
+    COLOR_DIFFERS(inactive_ws_fg);
+    COLOR_DIFFERS(inactive_ws_bg);
+    COLOR_DIFFERS(inactive_ws_border);
+    COLOR_DIFFERS(urgent_ws_fg);
+    COLOR_DIFFERS(urgent_ws_bg);
+    COLOR_DIFFERS(urgent_ws_border);
+    COLOR_DIFFERS(focus_ws_fg);
+    COLOR_DIFFERS(focus_ws_bg);
+    COLOR_DIFFERS(focus_ws_border);
+    COLOR_DIFFERS(binding_mode_fg);
+    COLOR_DIFFERS(binding_mode_bg);
+    COLOR_DIFFERS(binding_mode_border);
+#undef COLOR_DIFFERS
+    return false;
+}
@@ -26,6 +26,24 @@ const char *sock_path;
 
 typedef void (*handler_t)(char *);
 
+/* The bars which sent the messages whose replies did not arrive yet, in the
+ * order in which the messages were sent (i3 replies in the same order). A NULL
+ * bar means that the reply is handled by all bars. */
+struct pending_reply {
+    i3_bar *bar;
+
+    TAILQ_ENTRY(pending_reply) replies;
+};
+static TAILQ_HEAD(pending_replies_head, pending_reply) pending_replies = TAILQ_HEAD_INITIALIZER(pending_replies);
+
+/* Requests which the event handlers of several bars need. They are sent once,
+ * after all bars handled the event, and their replies are handled by all
+ * bars. */
+static bool request_outputs;
+static bool request_workspaces;
+
+static int send_msg(i3_bar *bar, uint32_t type, const char *payload);
+
 /*
  * Called, when we get a reply to a command from i3.
  * Since i3 does not give us much feedback on commands, we do not much
@@ -40,6 +58,9 @@ static void got_command_reply(char *reply) {
  *
  */
 static void got_workspace_reply(char *reply) {
+    if (config.disable_ws) {
+        return;
+    }
     DLOG("Got workspace data!\n");
     parse_workspaces_json(reply);
     draw_bars(false);
@@ -60,19 +81,24 @@ static void got_subscribe_reply(char *reply) {
  *
  */
 static void got_output_reply(char *reply) {
-    DLOG("Clearing old output configuration...\n");
-    free_outputs();
-
     DLOG("Parsing outputs JSON...\n");
-    parse_outputs_json(reply);
-    DLOG("Reconfiguring windows...\n");
-    reconfig_windows(false);
+    if (!parse_outputs_json(reply)) {
+        DLOG("Outputs unchanged, nothing to reconfigure\n");
+        return;
+    }
 
+    /* The tray clients of a changed output dock again, as they did when
+     * all bars were recreated. */
     i3_output *o_walk;
     SLIST_FOREACH (o_walk, outputs, slist) {
-        kick_tray_clients(o_walk);
+        if (o_walk->changed) {
+            kick_tray_clients(o_walk);
+        }
     }
 
+    DLOG("Reconfiguring windows...\n");
+    reconfig_windows(false);
+
     if (!config.disable_ws) {
         i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_WORKSPACES, NULL);
     }
@@ -121,6 +147,7 @@ static void got_bar_config(char *reply) {
     init_colors(&(config.colors));
 
     start_child(config.command);
+    active_bar->configured = true;
 }
 
 /* Data structure to easily call the reply handlers later */
@@ -144,8 +171,16 @@ handler_t reply_handlers[] = {
  *
  */
 static void got_workspace_event(char *event) {
+    /* We only get workspace events because another bar subscribed to them. */
+    if (config.disable_ws) {
+        return;
+    }
     DLOG("Got workspace event!\n");
-    i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_WORKSPACES, NULL);
+    if (apply_workspace_event(event)) {
+        draw_bars(false);
+        return;
+    }
+    request_workspaces = true;
 }
 
 /*
@@ -154,7 +189,7 @@ static void got_workspace_event(char *event) {
  */
 static void got_output_event(char *event) {
     DLOG("Got output event!\n");
-    i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_OUTPUTS, NULL);
+    request_outputs = true;
 }
 
 /*
@@ -179,9 +214,31 @@ static bool strings_differ(char *a, char *b) {
     return strcmp(a, b) != 0;
 }
 
+/*
+ * Returns true if the tray outputs of both lists differ.
+ *
+ */
+static bool tray_outputs_differ(struct tray_outputs_head *a, struct tray_outputs_head *b) {
+    tray_output_t *walk_a = TAILQ_FIRST(a);
+    tray_output_t *walk_b = TAILQ_FIRST(b);
+    while (walk_a != NULL && walk_b != NULL) {
+        if (strcmp(walk_a->output, walk_b->output) != 0) {
+            return true;
+        }
+        walk_a = TAILQ_NEXT(walk_a, tray_outputs);
+        walk_b = TAILQ_NEXT(walk_b, tray_outputs);
+    }
+    return (walk_a != walk_b);
+}
+
 /*
  * Called, when a barconfig_update event arrives (i.e. i3 changed the bar hidden_state or mode)
  *
+ * i3 sends the whole bar configuration, but usually only the mode or the
+ * hidden_state changed (e.g. for bar mode toggle bindings). Only what actually
+ * changed is applied, so that the bars are neither reconfigured nor redrawn
+ * from scratch in that case.
+ *
  */
 static void got_bar_config_update(char *event) {
     /* check whether this affect this bar instance by checking the bar_id */
@@ -192,26 +249,93 @@ static void got_bar_config_update(char *event) {
     if (found_id == NULL)
         return;
 
-    /* reconfigure the bar based on the current outputs */
-    i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_OUTPUTS, NULL);
-
-    free_colors(&(config.colors));
-
     /* update the configuration with the received settings */
     DLOG("Received bar config update \"%s\"\n", event);
 
+    /* Take the values which the parser appends to or replaces, so that they
+     * can be compared to the new ones. */
     char *old_command = config.command;
     config.command = NULL;
-    bar_display_mode_t old_mode = config.hide_on_modifier;
+    char *old_fontname = config.fontname;
+    config.fontname = NULL;
+    i3String *old_separator_symbol = config.separator_symbol;
+    config.separator_symbol = NULL;
+    struct xcb_color_strings_t old_colors = config.colors;
+    memset(&(config.colors), 0, sizeof(config.colors));
+    char **old_outputs = config.outputs;
+    const int old_num_outputs = config.num_outputs;
+    config.outputs = NULL;
+    config.num_outputs = 0;
+    struct tray_outputs_head old_tray_outputs = TAILQ_HEAD_INITIALIZER(old_tray_outputs);
+    while (!TAILQ_EMPTY(&(config.tray_outputs))) {
+        tray_output_t *tray_output = TAILQ_FIRST(&(config.tray_outputs));
+        TAILQ_REMOVE(&(config.tray_outputs), tray_output, tray_outputs);
+        TAILQ_INSERT_TAIL(&old_tray_outputs, tray_output, tray_outputs);
+    }
+    struct bindings_head old_bindings = TAILQ_HEAD_INITIALIZER(old_bindings);
+    while (!TAILQ_EMPTY(&(config.bindings))) {
+        binding_t *binding = TAILQ_FIRST(&(config.bindings));
+        TAILQ_REMOVE(&(config.bindings), binding, bindings);
+        TAILQ_INSERT_TAIL(&old_bindings, binding, bindings);
+    }
+    const bar_display_mode_t old_mode = config.hide_on_modifier;
+    const position_t old_position = config.position;
+    const int old_tray_padding = config.tray_padding;
+    const bool old_disable_ws = config.disable_ws;
 
     parse_config_json(event);
+
+    /* Keys which are only sent when set keep their old value. */
+    const bool font_changed = (config.fontname != NULL &&
+                               strings_differ(old_fontname, config.fontname));
+    if (config.fontname == NULL) {
+        config.fontname = old_fontname;
+        old_fontname = NULL;
+    }
+    const bool separator_changed = (config.separator_symbol != NULL &&
+                                    (old_separator_symbol == NULL ||
+                                     strcmp(i3string_as_utf8(old_separator_symbol), i3string_as_utf8(config.separator_symbol)) != 0));
+    if (config.separator_symbol == NULL) {
+        config.separator_symbol = old_separator_symbol;
+        old_separator_symbol = NULL;
+    }
+
+    bool outputs_changed = (old_num_outputs != config.num_outputs);
+    for (int i = 0; i < old_num_outputs; i++) {
+        if (!outputs_changed && strcmp(old_outputs[i], config.outputs[i]) != 0) {
+            outputs_changed = true;
+        }
+        free(old_outputs[i]);
+    }
+    free(old_outputs);
+
+    /* The geometry of the bars depends on the font (bar height), the position,
+     * the outputs and the tray. Only then the outputs are requested again,
+     * which reconfigures all bars. */
+    const bool geometry_changed = (font_changed ||
+                                   outputs_changed ||
+                                   old_position != config.position ||
+                                   old_tray_padding != config.tray_padding ||
+                                   tray_outputs_differ(&old_tray_outputs, &(config.tray_outputs)));
+    if (geometry_changed) {
+        mark_outputs_changed();
+        i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_OUTPUTS, NULL);
+    } else if (old_disable_ws && !config.disable_ws) {
+        i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_WORKSPACES, NULL);
+    }
+
     if (old_mode != config.hide_on_modifier) {
         reconfig_windows(true);
     }
 
     /* update fonts and colors */
-    init_xcb_late(config.fontname);
-    init_colors(&(config.colors));
+    if (font_changed || separator_changed) {
+        init_xcb_late(config.fontname);
+    }
+    if (colors_differ(&old_colors, &(config.colors))) {
+        init_colors(&(config.colors));
+    }
+    free_colors(&old_colors);
 
     /* restart status command process */
     if (strings_differ(old_command, config.command)) {
@@ -220,6 +344,21 @@ static void got_bar_config_update(char *event) {
         start_child(config.command);
     }
     free(old_command);
+    free(old_fontname);
+    I3STRING_FREE(old_separator_symbol);
+
+    while (!TAILQ_EMPTY(&old_tray_outputs)) {
+        tray_output_t *tray_output = TAILQ_FIRST(&old_tray_outputs);
+        TAILQ_REMOVE(&old_tray_outputs, tray_output, tray_outputs);
+        free(tray_output->output);
+        free(tray_output);
+    }
+    while (!TAILQ_EMPTY(&old_bindings)) {
+        binding_t *binding = TAILQ_FIRST(&old_bindings);
+        TAILQ_REMOVE(&old_bindings, binding, bindings);
+        free(binding->command);
+        free(binding);
+    }
 
     draw_bars(false);
 }
@@ -301,25 +440,54 @@ static void got_data(struct ev_loop *loop, ev_io *watcher, int events) {
     }
     buffer[size] = '\0';
 
-    /* And call the callback (indexed by the type) */
+    /* And call the callback (indexed by the type) for the bar which sent the
+     * message, or for all bars in case of events */
+    i3_bar *bar = NULL;
+    handler_t handler;
     if (type & (1UL << 31)) {
         type ^= 1UL << 31;
-        event_handlers[type](buffer);
+        handler = event_handlers[type];
     } else {
-        if (reply_handlers[type])
-            reply_handlers[type](buffer);
+        struct pending_reply *pending = TAILQ_FIRST(&pending_replies);
+        if (pending != NULL) {
+            bar = pending->bar;
+            TAILQ_REMOVE(&pending_replies, pending, replies);
+            free(pending);
+        }
+        handler = reply_handlers[type];
+    }
+
+    if (handler != NULL) {
+        if (bar != NULL) {
+            activate_bar(bar);
+            handler(buffer);
+        } else {
+            TAILQ_FOREACH (bar, &bars, bars) {
+                /* Bars which did not get their configuration yet have nothing
+                 * to update. */
+                if (!bar->configured) {
+                    continue;
+                }
+                activate_bar(bar);
+                handler(buffer);
+            }
+        }
+    }
+
+    if (request_outputs) {
+        request_outputs = false;
+        send_msg(NULL, I3_IPC_MESSAGE_TYPE_GET_OUTPUTS, NULL);
+    }
+    if (request_workspaces) {
+        request_workspaces = false;
+        send_msg(NULL, I3_IPC_MESSAGE_TYPE_GET_WORKSPACES, NULL);
     }
 
     FREE(header);
     FREE(buffer);
 }
 
-/*
- * Sends a message to i3.
- * type must be a valid I3_IPC_MESSAGE_TYPE (see i3/ipc.h for further information)
- *
- */
-int i3_send_msg(uint32_t type, const char *payload) {
+static int send_msg(i3_bar *bar, uint32_t type, const char *payload) {
     uint32_t len = 0;
     if (payload != NULL) {
         len = strlen(payload);
@@ -347,9 +515,22 @@ int i3_send_msg(uint32_t type, const char *payload) {
 
     FREE(buffer);
 
+    struct pending_reply *pending = smalloc(sizeof(struct pending_reply));
+    pending->bar = bar;
+    TAILQ_INSERT_TAIL(&pending_replies, pending, replies);
+
     return 1;
 }
 
+/*
+ * Sends a message to i3. The reply is handled by the active bar.
+ * type must be a valid I3_IPC_MESSAGE_TYPE (see i3/ipc.h for further information)
+ *
+ */
+int i3_send_msg(uint32_t type, const char *payload) {
+    return send_msg(active_bar, type, payload);
+}
+
 /*
  * Initiate a connection to i3.
  * socket_path must be a valid path to the ipc_socket of i3
@@ -56,9 +56,10 @@ static char *expand_path(char *path) {
 }
 
 static void print_usage(char *elf_name) {
-    printf("Usage: %s [-b bar_id] [-s sock_path] [-t] [-h] [-v] [-V]\n", elf_name);
+    printf("Usage: %s [-b bar_id]... [-s sock_path] [-t] [-h] [-v] [-V]\n", elf_name);
     printf("\n");
-    printf("-b, --bar_id       <bar_id>\tBar ID for which to get the configuration, defaults to the first bar from the i3 config\n");
+    printf("-b, --bar_id       <bar_id>\tBar ID for which to get the configuration, defaults to the first bar from the i3 config.\n"
+           "                            \tCan be given multiple times to display several bars.\n");
     printf("-s, --socket       <sock_path>\tConnect to i3 via <sock_path>\n");
     printf("-t, --transparency Enable transparency (RGBA colors)\n");
     printf("-h, --help         Display this help message and exit\n");
@@ -93,6 +94,11 @@ static void sig_cb(struct ev_loop *loop, ev_signal *watcher, int revents) {
 
 int main(int argc, char **argv) {
     char *socket_path = NULL;
+    bool transparency = false;
+    bool verbose = false;
+    /* The bars given using --bar_id */
+    char **bar_ids = NULL;
+    int num_bar_ids = 0;
 
     /* Initialize the standard config to use 0 as default */
     memset(&config, '\0', sizeof(config_t));
@@ -118,13 +124,14 @@ int main(int argc, char **argv) {
                 exit(EXIT_SUCCESS);
                 break;
             case 'b':
-                config.bar_id = sstrdup(optarg);
+                bar_ids = srealloc(bar_ids, (num_bar_ids + 1) * sizeof(char *));
+                bar_ids[num_bar_ids++] = optarg;
                 break;
             case 't':
-                config.transparency = true;
+                transparency = true;
                 break;
             case 'V':
-                config.verbose = true;
+                verbose = true;
                 break;
             default:
                 print_usage(argv[0]);
@@ -133,6 +140,9 @@ int main(int argc, char **argv) {
         }
     }
 
+    config.transparency = transparency;
+    config.verbose = verbose;
+
     LOG("i3bar version " I3_VERSION "\n");
 
     main_loop = ev_default_loop(0); /* needed in init_xcb_early */
@@ -160,14 +170,24 @@ int main(int argc, char **argv) {
 
     init_dpi();
 
-    init_outputs();
+    if (num_bar_ids == 0) {
+        bar_new(NULL, transparency, verbose);
+    }
+    for (int i = 0; i < num_bar_ids; i++) {
+        bar_new(bar_ids[i], transparency, verbose);
+    }
+    free(bar_ids);
 
     init_connection(socket_path);
-    /* Request the bar configuration. When it arrives, we fill the config
-     * array. In case that config.bar_id is empty, we will receive a list of
-     * available configs and then request the configuration for the first bar.
-     * See got_bar_config for more. */
-    i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_BAR_CONFIG, config.bar_id);
+    /* Request the bar configurations. When one arrives, we fill the config
+     * array of its bar. In case that config.bar_id is empty, we will receive a
+     * list of available configs and then request the configuration for the
+     * first bar. See got_bar_config for more. */
+    i3_bar *bar;
+    TAILQ_FOREACH (bar, &bars, bars) {
+        activate_bar(bar);
+        i3_send_msg(I3_IPC_MESSAGE_TYPE_GET_BAR_CONFIG, config.bar_id);
+    }
     free(socket_path);
 
     /* We listen to SIGTERM/QUIT/INT and try to exit cleanly, by stopping the main loop.
@@ -189,7 +209,10 @@ int main(int argc, char **argv) {
      * events. We stop simply stop the event loop, when we are finished */
     ev_loop(main_loop, 0);
 
-    kill_child();
+    TAILQ_FOREACH (bar, &bars, bars) {
+        activate_bar(bar);
+        kill_child();
+    }
 
     clean_xcb();
     ev_default_destroy();
@@ -16,11 +16,45 @@
 
 #include <yajl/yajl_parse.h>
 
+/* The keys of a GET_OUTPUTS reply. */
+typedef enum {
+    /* No key, i.e. the next map is a new output. */
+    OUTPUT_KEY_NONE = -2,
+    OUTPUT_KEY_NAME = 0,
+    OUTPUT_KEY_ACTIVE,
+    OUTPUT_KEY_PRIMARY,
+    OUTPUT_KEY_CURRENT_WORKSPACE,
+    OUTPUT_KEY_RECT,
+    OUTPUT_KEY_X,
+    OUTPUT_KEY_Y,
+    OUTPUT_KEY_WIDTH,
+    OUTPUT_KEY_HEIGHT,
+} output_key_t;
+
+static const char *const output_key_names[] = {
+    [OUTPUT_KEY_NAME] = "name",
+    [OUTPUT_KEY_ACTIVE] = "active",
+    [OUTPUT_KEY_PRIMARY] = "primary",
+    [OUTPUT_KEY_CURRENT_WORKSPACE] = "current_workspace",
+    [OUTPUT_KEY_RECT] = "rect",
+    [OUTPUT_KEY_X] = "x",
+    [OUTPUT_KEY_Y] = "y",
+    [OUTPUT_KEY_WIDTH] = "width",
+    [OUTPUT_KEY_HEIGHT] = "height",
+};
+
+static json_key_table_t output_keys = JSON_KEY_TABLE(output_key_names, false);
+
 /* A datatype to pass through the callbacks to save the state */
 struct outputs_json_params {
     struct outputs_head *outputs;
+    /* The outputs listed in the reply so far, in the same (reversed) order as
+     * if the list had been built from scratch. */
+    struct outputs_head listed;
+    bool changed;
     i3_output *outputs_walk;
-    char *cur_key;
+    /* An output_key_t or JSON_KEY_UNKNOWN */
+    int cur_key;
     char *json;
     bool in_rect;
 };
@@ -32,7 +66,7 @@ struct outputs_json_params {
 static int outputs_null_cb(void *params_) {
     struct outputs_json_params *params = (struct outputs_json_params *)params_;
 
-    FREE(params->cur_key);
+    params->cur_key = OUTPUT_KEY_NONE;
 
     return 1;
 }
@@ -44,19 +78,19 @@ static int outputs_null_cb(void *params_) {
 static int outputs_boolean_cb(void *params_, int val) {
     struct outputs_json_params *params = (struct outputs_json_params *)params_;
 
-    if (!strcmp(params->cur_key, "active")) {
-        params->outputs_walk->active = val;
-        FREE(params->cur_key);
-        return 1;
-    }
-
-    if (!strcmp(params->cur_key, "primary")) {
-        params->outputs_walk->primary = val;
-        FREE(params->cur_key);
-        return 1;
+    switch (params->cur_key) {
+        case OUTPUT_KEY_ACTIVE:
+            params->outputs_walk->active = val;
+            break;
+        case OUTPUT_KEY_PRIMARY:
+            params->outputs_walk->primary = val;
+            break;
+        default:
+            return 0;
     }
 
-    return 0;
+    params->cur_key = OUTPUT_KEY_NONE;
+    return 1;
 }
 
 /*
@@ -66,37 +100,28 @@ static int outputs_boolean_cb(void *params_, int val) {
 static int outputs_integer_cb(void *params_, long long val) {
     struct outputs_json_params *params = (struct outputs_json_params *)params_;
 
-    if (!strcmp(params->cur_key, "current_workspace")) {
-        params->outputs_walk->ws = (int)val;
-        FREE(params->cur_key);
-        return 1;
-    }
-
-    if (!strcmp(params->cur_key, "x")) {
-        params->outputs_walk->rect.x = (int)val;
-        FREE(params->cur_key);
-        return 1;
-    }
-
-    if (!strcmp(params->cur_key, "y")) {
-        params->outputs_walk->rect.y = (int)val;
-        FREE(params->cur_key);
-        return 1;
-    }
-
-    if (!strcmp(params->cur_key, "width")) {
-        params->outputs_walk->rect.w = (int)val;
-        FREE(params->cur_key);
-        return 1;
-    }
-
-    if (!strcmp(params->cur_key, "height")) {
-        params->outputs_walk->rect.h = (int)val;
-        FREE(params->cur_key);
-        return 1;
+    switch (params->cur_key) {
+        case OUTPUT_KEY_CURRENT_WORKSPACE:
+            params->outputs_walk->ws = (int)val;
+            break;
+        case OUTPUT_KEY_X:
+            params->outputs_walk->rect.x = (int)val;
+            break;
+        case OUTPUT_KEY_Y:
+            params->outputs_walk->rect.y = (int)val;
+            break;
+        case OUTPUT_KEY_WIDTH:
+            params->outputs_walk->rect.w = (int)val;
+            break;
+        case OUTPUT_KEY_HEIGHT:
+            params->outputs_walk->rect.h = (int)val;
+            break;
+        default:
+            return 0;
     }
 
-    return 0;
+    params->cur_key = OUTPUT_KEY_NONE;
+    return 1;
 }
 
 /*
@@ -106,29 +131,29 @@ static int outputs_integer_cb(void *params_, long long val) {
 static int outputs_string_cb(void *params_, const unsigned char *val, size_t len) {
     struct outputs_json_params *params = (struct outputs_json_params *)params_;
 
-    if (!strcmp(params->cur_key, "current_workspace")) {
-        char *copy = NULL;
-        sasprintf(&copy, "%.*s", len, val);
+    switch (params->cur_key) {
+        case OUTPUT_KEY_CURRENT_WORKSPACE: {
+            char *copy = NULL;
+            sasprintf(&copy, "%.*s", len, val);
 
-        char *end;
-        errno = 0;
-        long parsed_num = strtol(copy, &end, 10);
-        if (errno == 0 &&
-            (end && *end == '\0'))
-            params->outputs_walk->ws = parsed_num;
+            char *end;
+            errno = 0;
+            long parsed_num = strtol(copy, &end, 10);
+            if (errno == 0 &&
+                (end && *end == '\0'))
+                params->outputs_walk->ws = parsed_num;
 
-        FREE(copy);
-        FREE(params->cur_key);
-        return 1;
-    }
-
-    if (strcmp(params->cur_key, "name")) {
-        return 0;
+            FREE(copy);
+            break;
+        }
+        case OUTPUT_KEY_NAME:
+            sasprintf(&(params->outputs_walk->name), "%.*s", len, val);
+            break;
+        default:
+            return 0;
     }
 
-    sasprintf(&(params->outputs_walk->name), "%.*s", len, val);
-
-    FREE(params->cur_key);
+    params->cur_key = OUTPUT_KEY_NONE;
     return 1;
 }
 
@@ -140,7 +165,7 @@ static int outputs_start_map_cb(void *params_) {
     struct outputs_json_params *params = (struct outputs_json_params *)params_;
     i3_output *new_output = NULL;
 
-    if (params->cur_key == NULL) {
+    if (params->cur_key == OUTPUT_KEY_NONE) {
         new_output = smalloc(sizeof(i3_output));
         new_output->name = NULL;
         new_output->active = false;
@@ -149,6 +174,11 @@ static int outputs_start_map_cb(void *params_) {
         new_output->ws = 0,
         new_output->statusline_width = 0;
         new_output->statusline_short_text = false;
+        new_output->statusline_drawn = false;
+        new_output->statusline_block_keys = NULL;
+        new_output->statusline_num_blocks = 0;
+        new_output->workspace_buttons_key = NULL;
+        new_output->changed = true;
         memset(&new_output->rect, 0, sizeof(rect));
         memset(&new_output->bar, 0, sizeof(surface_t));
         memset(&new_output->buffer, 0, sizeof(surface_t));
@@ -165,7 +195,7 @@ static int outputs_start_map_cb(void *params_) {
         return 1;
     }
 
-    if (!strcmp(params->cur_key, "rect")) {
+    if (params->cur_key == OUTPUT_KEY_RECT) {
         params->in_rect = true;
     }
 
@@ -173,6 +203,11 @@ static int outputs_start_map_cb(void *params_) {
 }
 
 static void clear_output(i3_output *output) {
+    for (int i = 0; i < output->statusline_num_blocks; i++) {
+        free(output->statusline_block_keys[i]);
+    }
+    FREE(output->statusline_block_keys);
+    FREE(output->workspace_buttons_key);
     FREE(output->name);
     FREE(output->workspaces);
     FREE(output->trayclients);
@@ -207,7 +242,7 @@ static int outputs_end_map_cb(void *params_) {
                  params->outputs_walk->name);
             clear_output(params->outputs_walk);
             FREE(params->outputs_walk);
-            FREE(params->cur_key);
+            params->cur_key = OUTPUT_KEY_NONE;
             return 1;
         }
     }
@@ -215,14 +250,27 @@ static int outputs_end_map_cb(void *params_) {
     i3_output *target = get_output_by_name(params->outputs_walk->name);
 
     if (target == NULL) {
-        SLIST_INSERT_HEAD(outputs, params->outputs_walk, slist);
+        DLOG("New output \"%s\"\n", params->outputs_walk->name);
+        SLIST_INSERT_HEAD(&(params->listed), params->outputs_walk, slist);
+        params->changed = true;
     } else {
-        target->active = params->outputs_walk->active;
-        target->primary = params->outputs_walk->primary;
-        target->ws = params->outputs_walk->ws;
-        target->rect = params->outputs_walk->rect;
+        i3_output *update = params->outputs_walk;
+        if (target->active != update->active ||
+            target->primary != update->primary ||
+            memcmp(&(target->rect), &(update->rect), sizeof(rect)) != 0) {
+            DLOG("Output \"%s\" changed\n", target->name);
+            target->active = update->active;
+            target->primary = update->primary;
+            target->rect = update->rect;
+            target->changed = true;
+            params->changed = true;
+        }
+        target->ws = update->ws;
+
+        SLIST_REMOVE(outputs, target, i3_output, slist);
+        SLIST_INSERT_HEAD(&(params->listed), target, slist);
 
-        clear_output(params->outputs_walk);
+        clear_output(update);
         FREE(params->outputs_walk);
     }
     return 1;
@@ -236,8 +284,7 @@ static int outputs_end_map_cb(void *params_) {
  */
 static int outputs_map_key_cb(void *params_, const unsigned char *keyVal, size_t keyLen) {
     struct outputs_json_params *params = (struct outputs_json_params *)params_;
-    FREE(params->cur_key);
-    sasprintf(&(params->cur_key), "%.*s", keyLen, keyVal);
+    params->cur_key = json_key_lookup(&output_keys, keyVal, keyLen);
     return 1;
 }
 
@@ -254,22 +301,50 @@ static yajl_callbacks outputs_callbacks = {
 
 struct outputs_head *outputs;
 /*
- * Initiate the outputs list
+ * Allocates an empty outputs list. Every bar has its own, the one of the
+ * active bar is in 'outputs'.
  *
  */
-void init_outputs(void) {
-    outputs = smalloc(sizeof(struct outputs_head));
-    SLIST_INIT(outputs);
+struct outputs_head *init_outputs(void) {
+    struct outputs_head *head = smalloc(sizeof(struct outputs_head));
+    SLIST_INIT(head);
+    return head;
+}
+
+/*
+ * Removes the bar of an output which was not listed any more and frees it.
+ *
+ */
+static void free_output(i3_output *output) {
+    DLOG("Output \"%s\" is gone\n", output->name);
+    destroy_window(output);
+    if (output->trayclients != NULL && !TAILQ_EMPTY(output->trayclients)) {
+        FREE_TAILQ(output->trayclients, trayclient);
+    }
+    if (output->workspaces != NULL && !TAILQ_EMPTY(output->workspaces)) {
+        i3_ws *ws_walk;
+        TAILQ_FOREACH (ws_walk, output->workspaces, tailq) {
+            I3STRING_FREE(ws_walk->name);
+            FREE(ws_walk->canonical_name);
+        }
+        FREE_TAILQ(output->workspaces, i3_ws);
+    }
+    clear_output(output);
+    free(output);
 }
 
 /*
- * Start parsing the received JSON string
+ * Updates the outputs list from the received JSON string. Outputs which are
+ * no longer listed are removed, and those whose geometry, active or primary
+ * flag changed are marked as changed. Returns true if anything changed.
  *
  */
-void parse_outputs_json(char *json) {
+bool parse_outputs_json(char *json) {
     struct outputs_json_params params;
+    SLIST_INIT(&(params.listed));
+    params.changed = false;
     params.outputs_walk = NULL;
-    params.cur_key = NULL;
+    params.cur_key = OUTPUT_KEY_NONE;
     params.json = json;
     params.in_rect = false;
 
@@ -291,6 +366,34 @@ void parse_outputs_json(char *json) {
     }
 
     yajl_free(handle);
+
+    /* Whatever is left in the list was not part of the reply. */
+    while (!SLIST_EMPTY(outputs)) {
+        i3_output *gone = SLIST_FIRST(outputs);
+        SLIST_REMOVE_HEAD(outputs, slist);
+        free_output(gone);
+        params.changed = true;
+    }
+    *outputs = params.listed;
+
+    /* Outputs can also have been marked by mark_outputs_changed(). */
+    i3_output *walk;
+    SLIST_FOREACH (walk, outputs, slist) {
+        params.changed |= walk->changed;
+    }
+    return params.changed;
+}
+
+/*
+ * Marks all outputs as changed, so that the next reconfig_windows()
+ * reconfigures all bars, e.g. because the bar height changed.
+ *
+ */
+void mark_outputs_changed(void) {
+    i3_output *walk;
+    SLIST_FOREACH (walk, outputs, slist) {
+        walk->changed = true;
+    }
 }
 
 /*
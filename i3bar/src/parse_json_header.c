@@ -11,6 +11,7 @@
 #include "common.h"
 
 #include <signal.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <yajl/yajl_parse.h>
@@ -20,6 +21,7 @@ static enum {
     KEY_STOP_SIGNAL,
     KEY_CONT_SIGNAL,
     KEY_CLICK_EVENTS,
+    KEY_SHM,
     NO_KEY
 } current_key;
 
@@ -57,6 +59,21 @@ static int header_boolean(void *ctx, int val) {
     return 1;
 }
 
+static int header_string(void *ctx, const unsigned char *val, size_t len) {
+    i3bar_child *child = ctx;
+
+    switch (current_key) {
+        case KEY_SHM:
+            FREE(child->shm_name);
+            child->shm_name = sstrndup((const char *)val, len);
+            break;
+        default:
+            break;
+    }
+
+    return 1;
+}
+
 #define CHECK_KEY(name) (stringlen == strlen(name) && \
                          STARTS_WITH((const char *)stringval, stringlen, name))
 
@@ -69,6 +86,8 @@ static int header_map_key(void *ctx, const unsigned char *stringval, size_t stri
         current_key = KEY_CONT_SIGNAL;
     } else if (CHECK_KEY("click_events")) {
         current_key = KEY_CLICK_EVENTS;
+    } else if (CHECK_KEY("shm")) {
+        current_key = KEY_SHM;
     }
     return 1;
 }
@@ -77,6 +96,7 @@ static void child_init(i3bar_child *child) {
     child->version = 0;
     child->stop_signal = SIGSTOP;
     child->cont_signal = SIGCONT;
+    FREE(child->shm_name);
 }
 
 /*
@@ -91,6 +111,7 @@ void parse_json_header(i3bar_child *child, const unsigned char *buffer, int leng
     static yajl_callbacks version_callbacks = {
         .yajl_boolean = header_boolean,
         .yajl_integer = header_integer,
+        .yajl_string = header_string,
         .yajl_map_key = &header_map_key,
     };
 
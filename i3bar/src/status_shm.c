@@ -0,0 +1,189 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3bar - an xcb-based status- and ws-bar for i3
+ * © 2010 Axel Wagner and contributors (see also: LICENSE)
+ *
+ * status_shm.c: Read the statusline from a shared memory segment (protocol
+ *               version 2, see docs/i3bar-protocol).
+ *
+ */
+#include "common.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* The segment of the active bar */
+struct status_shm status_shm;
+
+static const struct status_shm_header *shared_header(void) {
+    return status_shm.segment;
+}
+
+static const struct status_shm_block *shared_blocks(void) {
+    return (const struct status_shm_block *)((const char *)status_shm.segment + sizeof(struct status_shm_header));
+}
+
+/*
+ * Maps the shared memory segment with the given name (as passed to
+ * shm_open(3)). Returns false if it cannot be used.
+ *
+ */
+bool status_shm_open(const char *name) {
+    status_shm_close();
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd == -1) {
+        ELOG("Could not open the status segment \"%s\": %s\n", name, strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(struct status_shm_header)) {
+        ELOG("The status segment \"%s\" is too small\n", name);
+        close(fd);
+        return false;
+    }
+
+    status_shm.segment_size = st.st_size;
+    status_shm.segment = mmap(NULL, status_shm.segment_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (status_shm.segment == MAP_FAILED) {
+        ELOG("Could not mmap the status segment \"%s\": %s\n", name, strerror(errno));
+        status_shm.segment = NULL;
+        return false;
+    }
+
+    const struct status_shm_header *header = shared_header();
+    if (header->magic != STATUS_SHM_MAGIC || header->block_size != sizeof(struct status_shm_block)) {
+        ELOG("The status segment \"%s\" has an unknown layout (magic 0x%08x, block size %u)\n",
+             name, header->magic, header->block_size);
+        status_shm_close();
+        return false;
+    }
+
+    status_shm.max_blocks = (status_shm.segment_size - sizeof(struct status_shm_header)) / sizeof(struct status_shm_block);
+    status_shm.copies = scalloc(status_shm.max_blocks == 0 ? 1 : status_shm.max_blocks, sizeof(struct status_shm_block));
+    status_shm.sequences = scalloc(status_shm.max_blocks == 0 ? 1 : status_shm.max_blocks, sizeof(uint32_t));
+    DLOG("Mapped the status segment \"%s\" with room for %u blocks\n", name, status_shm.max_blocks);
+    return true;
+}
+
+/*
+ * Unmaps the segment.
+ *
+ */
+void status_shm_close(void) {
+    if (status_shm.segment != NULL) {
+        munmap(status_shm.segment, status_shm.segment_size);
+        status_shm.segment = NULL;
+    }
+    status_shm.segment_size = 0;
+    status_shm.max_blocks = 0;
+    FREE(status_shm.copies);
+    FREE(status_shm.sequences);
+}
+
+/*
+ * Returns the number of blocks in the segment.
+ *
+ */
+uint32_t status_shm_num_blocks(void) {
+    if (status_shm.segment == NULL) {
+        return 0;
+    }
+    uint32_t num_blocks = __atomic_load_n(&shared_header()->num_blocks, __ATOMIC_ACQUIRE);
+    return (num_blocks < status_shm.max_blocks ? num_blocks : status_shm.max_blocks);
+}
+
+static void set_text(i3String **text, bool *width_valid, const char *str, bool markup) {
+    if (*text != NULL && i3string_is_markup(*text) == markup &&
+        strcmp(i3string_as_utf8(*text), str) == 0) {
+        return;
+    }
+    I3STRING_FREE(*text);
+    *text = i3string_from_utf8(str);
+    i3string_set_markup(*text, markup);
+    *width_valid = false;
+}
+
+#define TERMINATE(field) (field)[sizeof(field) - 1] = '\0'
+#define OPTIONAL(field) ((field)[0] != '\0' ? (field) : NULL)
+
+/*
+ * Copies the block with the given index to the given status block if its
+ * sequence number changed since it was read last (or if force is set). The
+ * strings of the block stay valid until the block is read again or the segment
+ * is closed. Returns whether the block changed.
+ *
+ */
+bool status_shm_read_block(uint32_t index, bool force, struct status_block *block) {
+    if (index >= status_shm.max_blocks) {
+        return false;
+    }
+
+    const struct status_shm_block *shared = &shared_blocks()[index];
+    const uint32_t sequence = __atomic_load_n(&shared->sequence, __ATOMIC_ACQUIRE);
+    if (!force && ((sequence & 1) || sequence == status_shm.sequences[index])) {
+        return false;
+    }
+
+    struct status_shm_block read;
+    memcpy(&read, shared, sizeof(struct status_shm_block));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    const bool consistent = !(sequence & 1) &&
+                            __atomic_load_n(&shared->sequence, __ATOMIC_RELAXED) == sequence;
+    /* The generator signals us again once it finished writing, so an
+     * inconsistent copy is only used if there is no older one. */
+    status_shm.sequences[index] = (consistent ? sequence : (sequence | 1));
+    if (!consistent && !force) {
+        return false;
+    }
+
+    struct status_shm_block *copy = &status_shm.copies[index];
+    memcpy(copy, &read, sizeof(struct status_shm_block));
+
+    TERMINATE(copy->full_text);
+    TERMINATE(copy->short_text);
+    TERMINATE(copy->color);
+    TERMINATE(copy->background);
+    TERMINATE(copy->border);
+    TERMINATE(copy->name);
+    TERMINATE(copy->instance);
+
+    const bool markup = (copy->flags & STATUS_SHM_PANGO_MARKUP);
+    set_text(&block->full_text, &block->full_text_width_valid, copy->full_text, markup);
+    if (copy->short_text[0] == '\0') {
+        I3STRING_FREE(block->short_text);
+    } else {
+        set_text(&block->short_text, &block->short_text_width_valid, copy->short_text, markup);
+    }
+    block->pango_markup = markup;
+
+    block->color = OPTIONAL(copy->color);
+    block->background = OPTIONAL(copy->background);
+    block->border = OPTIONAL(copy->border);
+    block->name = OPTIONAL(copy->name);
+    block->instance = OPTIONAL(copy->instance);
+
+    block->min_width = copy->min_width;
+    block->min_width_str = NULL;
+    block->align = (copy->align <= ALIGN_RIGHT ? (blockalign_t)copy->align : ALIGN_LEFT);
+    block->urgent = (copy->flags & STATUS_SHM_URGENT);
+    block->no_separator = (copy->flags & STATUS_SHM_NO_SEPARATOR);
+    if (copy->flags & STATUS_SHM_SEPARATOR_BLOCK_WIDTH) {
+        block->sep_block_width = copy->separator_block_width;
+    } else {
+        block->sep_block_width = default_sep_block_width();
+    }
+    block->border_top = copy->border_top;
+    block->border_right = copy->border_right;
+    block->border_bottom = copy->border_bottom;
+    block->border_left = copy->border_left;
+    return true;
+}
@@ -14,89 +14,152 @@
 
 #include <yajl/yajl_parse.h>
 
+/* The keys of a GET_WORKSPACES reply and of workspace events. */
+typedef enum {
+    /* No key, i.e. the next map is a new workspace. */
+    WS_KEY_NONE = -2,
+    WS_KEY_ID = 0,
+    WS_KEY_NUM,
+    WS_KEY_NAME,
+    WS_KEY_VISIBLE,
+    WS_KEY_FOCUSED,
+    WS_KEY_URGENT,
+    WS_KEY_X,
+    WS_KEY_Y,
+    WS_KEY_WIDTH,
+    WS_KEY_HEIGHT,
+    WS_KEY_OUTPUT,
+    WS_KEY_CHANGE,
+    WS_KEY_CURRENT,
+} ws_key_t;
+
+static const char *const ws_key_names[] = {
+    [WS_KEY_ID] = "id",
+    [WS_KEY_NUM] = "num",
+    [WS_KEY_NAME] = "name",
+    [WS_KEY_VISIBLE] = "visible",
+    [WS_KEY_FOCUSED] = "focused",
+    [WS_KEY_URGENT] = "urgent",
+    [WS_KEY_X] = "x",
+    [WS_KEY_Y] = "y",
+    [WS_KEY_WIDTH] = "width",
+    [WS_KEY_HEIGHT] = "height",
+    [WS_KEY_OUTPUT] = "output",
+    [WS_KEY_CHANGE] = "change",
+    [WS_KEY_CURRENT] = "current",
+};
+
+static json_key_table_t ws_keys = JSON_KEY_TABLE(ws_key_names, false);
+
 /* A datatype to pass through the callbacks to save the state */
 struct workspaces_json_params {
     struct ws_head *workspaces;
     i3_ws *workspaces_walk;
-    char *cur_key;
+    /* A ws_key_t or JSON_KEY_UNKNOWN */
+    int cur_key;
     char *json;
 };
 
 /*
- * Parse a boolean value (visible, focused, urgent)
+ * Sets the canonical name of the given workspace and the name displayed on the
+ * bar (see strip_workspace_numbers and strip_workspace_name), whose width is
+ * measured. The workspace number must already be set.
  *
  */
-static int workspaces_boolean_cb(void *params_, int val) {
-    struct workspaces_json_params *params = (struct workspaces_json_params *)params_;
+static void set_workspace_name(i3_ws *ws, const char *ws_name, size_t len) {
+    ws->canonical_name = sstrndup(ws_name, len);
 
-    if (!strcmp(params->cur_key, "visible")) {
-        params->workspaces_walk->visible = val;
-        FREE(params->cur_key);
-        return 1;
-    }
+    if ((config.strip_ws_numbers || config.strip_ws_name) && ws->num >= 0) {
+        /* Special case: strip off the workspace number/name */
+        static char ws_num[32];
 
-    if (!strcmp(params->cur_key, "focused")) {
-        params->workspaces_walk->focused = val;
-        FREE(params->cur_key);
-        return 1;
-    }
+        snprintf(ws_num, sizeof(ws_num), "%d", ws->num);
 
-    if (!strcmp(params->cur_key, "urgent")) {
-        params->workspaces_walk->urgent = val;
-        FREE(params->cur_key);
-        return 1;
+        /* Calculate the length of the number str in the name */
+        size_t offset = strspn(ws_name, ws_num);
+
+        /* Also strip off the conventional ws name delimiter */
+        if (offset && ws_name[offset] == ':')
+            offset += 1;
+
+        if (config.strip_ws_numbers) {
+            /* Offset may be equal to length, in which case display the number */
+            ws->name = (offset < len
+                            ? i3string_from_markup_with_length(ws_name + offset, len - offset)
+                            : i3string_from_markup(ws_num));
+        } else {
+            ws->name = i3string_from_markup(ws_num);
+        }
+    } else {
+        /* Default case: just save the name */
+        ws->name = i3string_from_markup_with_length(ws_name, len);
     }
 
-    FREE(params->cur_key);
+    /* Save its rendered width */
+    ws->name_width = predict_text_width(ws->name);
 
-    return 0;
+    DLOG("Got workspace canonical: %s, name: '%s', name_width: %d, glyphs: %zu\n",
+         ws->canonical_name,
+         i3string_as_utf8(ws->name),
+         ws->name_width,
+         i3string_get_num_glyphs(ws->name));
 }
 
 /*
- * Parse an integer (num or the rect)
+ * Parse a boolean value (visible, focused, urgent)
  *
  */
-static int workspaces_integer_cb(void *params_, long long val) {
+static int workspaces_boolean_cb(void *params_, int val) {
     struct workspaces_json_params *params = (struct workspaces_json_params *)params_;
 
-    if (!strcmp(params->cur_key, "id")) {
-        params->workspaces_walk->id = val;
-        FREE(params->cur_key);
-        return 1;
-    }
-
-    if (!strcmp(params->cur_key, "num")) {
-        params->workspaces_walk->num = (int)val;
-        FREE(params->cur_key);
-        return 1;
-    }
-
-    if (!strcmp(params->cur_key, "x")) {
-        params->workspaces_walk->rect.x = (int)val;
-        FREE(params->cur_key);
-        return 1;
-    }
-
-    if (!strcmp(params->cur_key, "y")) {
-        params->workspaces_walk->rect.y = (int)val;
-        FREE(params->cur_key);
-        return 1;
+    const int key = params->cur_key;
+    params->cur_key = WS_KEY_NONE;
+    switch (key) {
+        case WS_KEY_VISIBLE:
+            params->workspaces_walk->visible = val;
+            return 1;
+        case WS_KEY_FOCUSED:
+            params->workspaces_walk->focused = val;
+            return 1;
+        case WS_KEY_URGENT:
+            params->workspaces_walk->urgent = val;
+            return 1;
+        default:
+            return 0;
     }
+}
 
-    if (!strcmp(params->cur_key, "width")) {
-        params->workspaces_walk->rect.w = (int)val;
-        FREE(params->cur_key);
-        return 1;
-    }
+/*
+ * Parse an integer (num or the rect)
+ *
+ */
+static int workspaces_integer_cb(void *params_, long long val) {
+    struct workspaces_json_params *params = (struct workspaces_json_params *)params_;
 
-    if (!strcmp(params->cur_key, "height")) {
-        params->workspaces_walk->rect.h = (int)val;
-        FREE(params->cur_key);
-        return 1;
+    const int key = params->cur_key;
+    params->cur_key = WS_KEY_NONE;
+    switch (key) {
+        case WS_KEY_ID:
+            params->workspaces_walk->id = val;
+            return 1;
+        case WS_KEY_NUM:
+            params->workspaces_walk->num = (int)val;
+            return 1;
+        case WS_KEY_X:
+            params->workspaces_walk->rect.x = (int)val;
+            return 1;
+        case WS_KEY_Y:
+            params->workspaces_walk->rect.y = (int)val;
+            return 1;
+        case WS_KEY_WIDTH:
+            params->workspaces_walk->rect.w = (int)val;
+            return 1;
+        case WS_KEY_HEIGHT:
+            params->workspaces_walk->rect.h = (int)val;
+            return 1;
+        default:
+            return 0;
     }
-
-    FREE(params->cur_key);
-    return 0;
 }
 
 /*
@@ -106,69 +169,33 @@ static int workspaces_integer_cb(void *params_, long long val) {
 static int workspaces_string_cb(void *params_, const unsigned char *val, size_t len) {
     struct workspaces_json_params *params = (struct workspaces_json_params *)params_;
 
-    if (!strcmp(params->cur_key, "name")) {
-        const char *ws_name = (const char *)val;
-        params->workspaces_walk->canonical_name = sstrndup(ws_name, len);
-
-        if ((config.strip_ws_numbers || config.strip_ws_name) && params->workspaces_walk->num >= 0) {
-            /* Special case: strip off the workspace number/name */
-            static char ws_num[32];
+    switch (params->cur_key) {
+        case WS_KEY_NAME:
+            set_workspace_name(params->workspaces_walk, (const char *)val, len);
+            params->cur_key = WS_KEY_NONE;
+            return 1;
 
-            snprintf(ws_num, sizeof(ws_num), "%d", params->workspaces_walk->num);
+        case WS_KEY_OUTPUT: {
+            /* We add the ws to the TAILQ of the output, it belongs to */
+            char *output_name = NULL;
+            sasprintf(&output_name, "%.*s", len, val);
 
-            /* Calculate the length of the number str in the name */
-            size_t offset = strspn(ws_name, ws_num);
+            i3_output *target = get_output_by_name(output_name);
+            if (target != NULL) {
+                params->workspaces_walk->output = target;
 
-            /* Also strip off the conventional ws name delimiter */
-            if (offset && ws_name[offset] == ':')
-                offset += 1;
-
-            if (config.strip_ws_numbers) {
-                /* Offset may be equal to length, in which case display the number */
-                params->workspaces_walk->name = (offset < len
-                                                     ? i3string_from_markup_with_length(ws_name + offset, len - offset)
-                                                     : i3string_from_markup(ws_num));
-            } else {
-                params->workspaces_walk->name = i3string_from_markup(ws_num);
+                TAILQ_INSERT_TAIL(params->workspaces_walk->output->workspaces,
+                                  params->workspaces_walk,
+                                  tailq);
             }
-        } else {
-            /* Default case: just save the name */
-            params->workspaces_walk->name = i3string_from_markup_with_length(ws_name, len);
-        }
-
-        /* Save its rendered width */
-        params->workspaces_walk->name_width =
-            predict_text_width(params->workspaces_walk->name);
-
-        DLOG("Got workspace canonical: %s, name: '%s', name_width: %d, glyphs: %zu\n",
-             params->workspaces_walk->canonical_name,
-             i3string_as_utf8(params->workspaces_walk->name),
-             params->workspaces_walk->name_width,
-             i3string_get_num_glyphs(params->workspaces_walk->name));
-        FREE(params->cur_key);
 
-        return 1;
-    }
-
-    if (!strcmp(params->cur_key, "output")) {
-        /* We add the ws to the TAILQ of the output, it belongs to */
-        char *output_name = NULL;
-        sasprintf(&output_name, "%.*s", len, val);
-
-        i3_output *target = get_output_by_name(output_name);
-        if (target != NULL) {
-            params->workspaces_walk->output = target;
-
-            TAILQ_INSERT_TAIL(params->workspaces_walk->output->workspaces,
-                              params->workspaces_walk,
-                              tailq);
+            FREE(output_name);
+            return 1;
         }
 
-        FREE(output_name);
-        return 1;
+        default:
+            return 0;
     }
-
-    return 0;
 }
 
 /*
@@ -180,7 +207,7 @@ static int workspaces_start_map_cb(void *params_) {
 
     i3_ws *new_workspace = NULL;
 
-    if (params->cur_key == NULL) {
+    if (params->cur_key == WS_KEY_NONE) {
         new_workspace = smalloc(sizeof(i3_ws));
         new_workspace->num = -1;
         new_workspace->name = NULL;
@@ -205,8 +232,7 @@ static int workspaces_start_map_cb(void *params_) {
  */
 static int workspaces_map_key_cb(void *params_, const unsigned char *keyVal, size_t keyLen) {
     struct workspaces_json_params *params = (struct workspaces_json_params *)params_;
-    FREE(params->cur_key);
-    sasprintf(&(params->cur_key), "%.*s", keyLen, keyVal);
+    params->cur_key = json_key_lookup(&ws_keys, keyVal, keyLen);
     return 1;
 }
 
@@ -231,7 +257,7 @@ void parse_workspaces_json(char *json) {
     free_workspaces();
 
     params.workspaces_walk = NULL;
-    params.cur_key = NULL;
+    params.cur_key = WS_KEY_NONE;
     params.json = json;
 
     yajl_handle handle;
@@ -252,8 +278,282 @@ void parse_workspaces_json(char *json) {
     }
 
     yajl_free(handle);
+}
+
+/* The fields of the workspace in a workspace event ("current"). */
+struct workspace_event_ws {
+    bool present;
+    uintptr_t id;
+    int num;
+    char *name;
+    char *output;
+    bool urgent;
+};
+
+/* A datatype to pass through the callbacks of the workspace event parser */
+struct workspace_event_params {
+    /* Nesting depth of maps and arrays, 1 within the event itself. */
+    int depth;
+    /* A ws_key_t or JSON_KEY_UNKNOWN */
+    int cur_key;
+    char *change;
+    struct workspace_event_ws current;
+    /* The workspace whose top-level fields are being parsed, if any. */
+    struct workspace_event_ws *walk;
+};
+
+static int workspace_event_boolean_cb(void *params_, int val) {
+    struct workspace_event_params *params = (struct workspace_event_params *)params_;
+    if (params->walk != NULL && params->depth == 2 && params->cur_key == WS_KEY_URGENT) {
+        params->walk->urgent = val;
+    }
+    return 1;
+}
+
+static int workspace_event_integer_cb(void *params_, long long val) {
+    struct workspace_event_params *params = (struct workspace_event_params *)params_;
+    if (params->walk == NULL || params->depth != 2) {
+        return 1;
+    }
+    if (params->cur_key == WS_KEY_ID) {
+        params->walk->id = val;
+    } else if (params->cur_key == WS_KEY_NUM) {
+        params->walk->num = (int)val;
+    }
+    return 1;
+}
+
+static int workspace_event_string_cb(void *params_, const unsigned char *val, size_t len) {
+    struct workspace_event_params *params = (struct workspace_event_params *)params_;
+    if (params->depth == 1 && params->cur_key == WS_KEY_CHANGE) {
+        FREE(params->change);
+        params->change = sstrndup((const char *)val, len);
+    } else if (params->walk != NULL && params->depth == 2) {
+        if (params->cur_key == WS_KEY_NAME) {
+            FREE(params->walk->name);
+            params->walk->name = sstrndup((const char *)val, len);
+        } else if (params->cur_key == WS_KEY_OUTPUT) {
+            FREE(params->walk->output);
+            params->walk->output = sstrndup((const char *)val, len);
+        }
+    }
+    return 1;
+}
+
+static int workspace_event_start_map_cb(void *params_) {
+    struct workspace_event_params *params = (struct workspace_event_params *)params_;
+    params->depth++;
+    if (params->depth == 2 && params->cur_key == WS_KEY_CURRENT) {
+        params->walk = &(params->current);
+        params->walk->present = true;
+        params->walk->num = -1;
+    }
+    return 1;
+}
+
+static int workspace_event_end_map_cb(void *params_) {
+    struct workspace_event_params *params = (struct workspace_event_params *)params_;
+    if (params->depth == 2) {
+        params->walk = NULL;
+    }
+    params->depth--;
+    return 1;
+}
+
+static int workspace_event_start_array_cb(void *params_) {
+    struct workspace_event_params *params = (struct workspace_event_params *)params_;
+    params->depth++;
+    return 1;
+}
+
+static int workspace_event_end_array_cb(void *params_) {
+    struct workspace_event_params *params = (struct workspace_event_params *)params_;
+    params->depth--;
+    return 1;
+}
+
+static int workspace_event_map_key_cb(void *params_, const unsigned char *keyVal, size_t keyLen) {
+    struct workspace_event_params *params = (struct workspace_event_params *)params_;
+    /* Only the keys of the event and of its workspaces are of interest. */
+    if (params->depth <= 2) {
+        params->cur_key = json_key_lookup(&ws_keys, keyVal, keyLen);
+    }
+    return 1;
+}
+
+static yajl_callbacks workspace_event_callbacks = {
+    .yajl_boolean = workspace_event_boolean_cb,
+    .yajl_integer = workspace_event_integer_cb,
+    .yajl_string = workspace_event_string_cb,
+    .yajl_start_map = workspace_event_start_map_cb,
+    .yajl_end_map = workspace_event_end_map_cb,
+    .yajl_start_array = workspace_event_start_array_cb,
+    .yajl_end_array = workspace_event_end_array_cb,
+    .yajl_map_key = workspace_event_map_key_cb,
+};
+
+/*
+ * Returns the workspace with the given ID, or NULL.
+ *
+ */
+static i3_ws *get_workspace_by_id(uintptr_t id) {
+    i3_output *outputs_walk;
+    SLIST_FOREACH (outputs_walk, outputs, slist) {
+        i3_ws *ws_walk;
+        TAILQ_FOREACH (ws_walk, outputs_walk->workspaces, tailq) {
+            if (ws_walk->id == id) {
+                return ws_walk;
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Inserts the workspace into the list of its output at the position where i3
+ * attaches it (see _con_attach()): numbered workspaces sorted by number, named
+ * workspaces at the end.
+ *
+ */
+static void insert_workspace(i3_ws *ws) {
+    struct ws_head *head = ws->output->workspaces;
+    i3_ws *current = TAILQ_FIRST(head);
+    if (ws->num == -1 || current == NULL) {
+        TAILQ_INSERT_TAIL(head, ws, tailq);
+        return;
+    }
+    if (ws->num < current->num) {
+        TAILQ_INSERT_HEAD(head, ws, tailq);
+        return;
+    }
+    while (current != NULL && current->num != -1 && ws->num > current->num) {
+        current = TAILQ_NEXT(current, tailq);
+    }
+    if (current != NULL) {
+        TAILQ_INSERT_BEFORE(current, ws, tailq);
+    } else {
+        TAILQ_INSERT_TAIL(head, ws, tailq);
+    }
+}
+
+static void free_workspace(i3_ws *ws) {
+    I3STRING_FREE(ws->name);
+    FREE(ws->canonical_name);
+    free(ws);
+}
+
+/*
+ * Applies the parsed workspace event to the workspace lists. Returns false if
+ * it cannot be applied.
+ *
+ */
+static bool apply_parsed_workspace_event(struct workspace_event_params *params) {
+    struct workspace_event_ws *current = &(params->current);
+    if (params->change == NULL || !current->present || current->output == NULL) {
+        return false;
+    }
+
+    i3_output *output = get_output_by_name(current->output);
+    i3_ws *ws = get_workspace_by_id(current->id);
+    if (output == NULL) {
+        /* A workspace on an output without a bar (or an i3-internal one). */
+        return (ws == NULL);
+    }
+
+    if (!strcmp(params->change, "init")) {
+        if (ws != NULL || current->name == NULL) {
+            return false;
+        }
+        ws = scalloc(1, sizeof(i3_ws));
+        ws->id = current->id;
+        ws->num = current->num;
+        ws->urgent = current->urgent;
+        ws->output = output;
+        set_workspace_name(ws, current->name, strlen(current->name));
+        insert_workspace(ws);
+        return true;
+    }
+
+    if (ws == NULL || ws->output != output) {
+        return false;
+    }
+
+    if (!strcmp(params->change, "focus")) {
+        i3_output *outputs_walk;
+        SLIST_FOREACH (outputs_walk, outputs, slist) {
+            i3_ws *ws_walk;
+            TAILQ_FOREACH (ws_walk, outputs_walk->workspaces, tailq) {
+                ws_walk->focused = (ws_walk == ws);
+                if (outputs_walk == output) {
+                    ws_walk->visible = (ws_walk == ws);
+                }
+            }
+        }
+        return true;
+    }
+
+    if (!strcmp(params->change, "urgent")) {
+        ws->urgent = current->urgent;
+        return true;
+    }
+
+    if (!strcmp(params->change, "empty")) {
+        if (ws->visible) {
+            return false;
+        }
+        TAILQ_REMOVE(output->workspaces, ws, tailq);
+        free_workspace(ws);
+        return true;
+    }
+
+    if (!strcmp(params->change, "rename")) {
+        if (current->name == NULL) {
+            return false;
+        }
+        I3STRING_FREE(ws->name);
+        FREE(ws->canonical_name);
+        ws->num = current->num;
+        set_workspace_name(ws, current->name, strlen(current->name));
+        /* i3 re-attaches the workspace to keep the workspaces sorted. */
+        TAILQ_REMOVE(output->workspaces, ws, tailq);
+        insert_workspace(ws);
+        return true;
+    }
+
+    /* "move" also changes which workspaces are visible on both outputs, and
+     * "reload" and "restored" carry no usable workspace state. */
+    return false;
+}
+
+/*
+ * Applies a workspace event (see docs/ipc) to the workspace lists, so that
+ * they need not be requested again. Returns false if the event could not be
+ * applied, in which case the workspaces have to be requested again.
+ *
+ */
+bool apply_workspace_event(const char *json) {
+    struct workspace_event_params params = {.cur_key = WS_KEY_NONE};
+
+    yajl_handle handle = yajl_alloc(&workspace_event_callbacks, NULL, (void *)&params);
+    yajl_status state = yajl_parse(handle, (const unsigned char *)json, strlen(json));
+    if (state == yajl_status_ok) {
+        state = yajl_complete_parse(handle);
+    }
+    yajl_free(handle);
+
+    bool applied = false;
+    if (state == yajl_status_ok) {
+        applied = apply_parsed_workspace_event(&params);
+        DLOG("Workspace event \"%s\" %s\n", params.change ? params.change : "(none)",
+             applied ? "applied" : "not applied, requesting workspaces");
+    } else {
+        ELOG("Could not parse workspace event!\n");
+    }
 
-    FREE(params.cur_key);
+    FREE(params.change);
+    FREE(params.current.name);
+    FREE(params.current.output);
+    return applied;
 }
 
 /*
@@ -49,8 +49,21 @@ static xcb_intern_atom_reply_t *tray_reply = NULL;
 /* This is needed for integration with libi3 */
 xcb_connection_t *conn;
 
+/* The fonts loaded by any bar. Bars which use the same font share it, so they
+ * also share the text width cache of libi3. */
+struct bar_font {
+    char *name;
+    i3Font font;
+    int refcount;
+
+    SLIST_ENTRY(bar_font) fonts;
+};
+static SLIST_HEAD(fonts_head, bar_font) fonts = SLIST_HEAD_INITIALIZER(fonts);
+
 /* The font we'll use */
-static i3Font font;
+static struct bar_font *font;
+/* The font libi3 currently draws with */
+static struct bar_font *current_font;
 
 /* Icon size (based on font size) */
 int icon_size;
@@ -77,9 +90,17 @@ static mode binding;
 /* Indicates whether a new binding mode was recently activated */
 bool activated_mode = false;
 
+/* Whether unhide_bars() mapped the bars and they were not hidden or
+ * reconfigured since. Hiding and unhiding bars in that state is a no-op, so
+ * that modifier presses and redraws don't raise and map them again. */
+static bool bars_unhidden = false;
+
 /* The output in which the tray should be displayed. */
 static i3_output *output_for_tray;
 
+/* Whether the tray clients have to be moved, see configure_trayclients() */
+static bool trayclients_changed;
+
 /* The parsed colors */
 struct xcb_colors_t {
     color_t bar_fg;
@@ -128,6 +149,169 @@ static const int sep_voff_px = 4;
 /* Cached width of the custom separator if one was set */
 int separator_symbol_width;
 
+/* The variables above which depend on the bar configuration belong to the
+ * active bar, see activate_bar(). This is where the ones of the other bars are
+ * kept. */
+struct xcb_state {
+    struct bar_font *font;
+    int icon_size;
+    int bar_height;
+    bool mod_pressed;
+    mode binding;
+    bool activated_mode;
+    bool bars_unhidden;
+    i3_output *output_for_tray;
+    bool trayclients_changed;
+    struct xcb_colors_t colors;
+    int separator_symbol_width;
+    xcb_window_t selwin;
+};
+
+/*
+ * Allocates the X11 state of a bar which did not get its configuration yet.
+ *
+ */
+struct xcb_state *xcb_state_new(void) {
+    struct xcb_state *state = scalloc(1, sizeof(struct xcb_state));
+    state->selwin = XCB_NONE;
+    return state;
+}
+
+/*
+ * Saves the X11 state of the active bar.
+ *
+ */
+void xcb_save_state(struct xcb_state *state) {
+    state->font = font;
+    state->icon_size = icon_size;
+    state->bar_height = bar_height;
+    state->mod_pressed = mod_pressed;
+    state->binding = binding;
+    state->activated_mode = activated_mode;
+    state->bars_unhidden = bars_unhidden;
+    state->output_for_tray = output_for_tray;
+    state->trayclients_changed = trayclients_changed;
+    state->colors = colors;
+    state->separator_symbol_width = separator_symbol_width;
+    state->selwin = selwin;
+}
+
+/*
+ * Loads the X11 state of the bar which becomes active.
+ *
+ */
+void xcb_load_state(const struct xcb_state *state) {
+    font = state->font;
+    icon_size = state->icon_size;
+    bar_height = state->bar_height;
+    mod_pressed = state->mod_pressed;
+    binding = state->binding;
+    activated_mode = state->activated_mode;
+    bars_unhidden = state->bars_unhidden;
+    output_for_tray = state->output_for_tray;
+    trayclients_changed = state->trayclients_changed;
+    colors = state->colors;
+    separator_symbol_width = state->separator_symbol_width;
+    selwin = state->selwin;
+
+    /* Switching the font of libi3 clears its caches, so we only do it if the
+     * bars use different fonts. */
+    if (font != NULL && font != current_font) {
+        set_font(&(font->font));
+        current_font = font;
+    }
+}
+
+/*
+ * Returns the loaded font with the given name, loading it if no bar uses it
+ * yet. Every call returns a new reference, see release_font().
+ *
+ */
+static struct bar_font *acquire_font(const char *name) {
+    struct bar_font *walk;
+    SLIST_FOREACH (walk, &fonts, fonts) {
+        if (strcmp(walk->name, name) == 0) {
+            walk->refcount++;
+            return walk;
+        }
+    }
+
+    walk = scalloc(1, sizeof(struct bar_font));
+    walk->name = sstrdup(name);
+    walk->refcount = 1;
+    /* load_font() frees the current font of libi3, which other bars may still
+     * use. */
+    set_font(NULL);
+    current_font = NULL;
+    walk->font = load_font(name, true);
+    SLIST_INSERT_HEAD(&fonts, walk, fonts);
+    return walk;
+}
+
+/*
+ * Releases a reference to the given font (which may be NULL), freeing it once
+ * no bar uses it anymore.
+ *
+ */
+static void release_font(struct bar_font *bar_font) {
+    if (bar_font == NULL || --bar_font->refcount > 0) {
+        return;
+    }
+
+    set_font(&(bar_font->font));
+    free_font();
+    current_font = NULL;
+    SLIST_REMOVE(&fonts, bar_font, bar_font, fonts);
+    free(bar_font->name);
+    free(bar_font);
+}
+
+/*
+ * Returns the bar which the given window belongs to (a bar window, a tray
+ * selection window or a tray client), or NULL if it is not ours.
+ *
+ */
+static i3_bar *bar_for_window(xcb_window_t win) {
+    i3_bar *bar;
+    TAILQ_FOREACH (bar, &bars, bars) {
+        const bool active = (bar == active_bar);
+        if (win == (active ? selwin : bar->xcb->selwin)) {
+            return bar;
+        }
+
+        i3_output *output;
+        SLIST_FOREACH (output, (active ? outputs : bar->outputs), slist) {
+            if (output->bar.id == win) {
+                return bar;
+            }
+            if (output->trayclients == NULL) {
+                continue;
+            }
+            trayclient *client;
+            TAILQ_FOREACH (client, output->trayclients, tailq) {
+                if (client->win == win) {
+                    return bar;
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Activates the bar which the given window belongs to. Returns false if the
+ * window is none of ours, in which case the active bar does not change.
+ *
+ */
+static bool activate_bar_for_window(xcb_window_t win) {
+    i3_bar *bar = bar_for_window(win);
+    if (bar == NULL) {
+        return false;
+    }
+    activate_bar(bar);
+    return true;
+}
+
 int _xcb_request_failed(xcb_void_cookie_t cookie, char *err_msg, int line) {
     xcb_generic_error_t *err;
     if ((err = xcb_request_check(xcb_connection, cookie)) != NULL) {
@@ -137,6 +321,49 @@ int _xcb_request_failed(xcb_void_cookie_t cookie, char *err_msg, int line) {
     return 0;
 }
 
+/* Requests whose errors are fatal, in the order in which they were sent (so
+ * they have to be added in that order). Their errors arrive like events, see
+ * handle_async_checks(). */
+struct async_check {
+    unsigned int sequence;
+    const char *err_msg;
+    int line;
+
+    TAILQ_ENTRY(async_check) checks;
+};
+static TAILQ_HEAD(async_checks_head, async_check) async_checks = TAILQ_HEAD_INITIALIZER(async_checks);
+
+void _xcb_request_check_async(xcb_void_cookie_t cookie, const char *err_msg, int line) {
+    struct async_check *check = smalloc(sizeof(struct async_check));
+    check->sequence = cookie.sequence;
+    check->err_msg = err_msg;
+    check->line = line;
+    TAILQ_INSERT_TAIL(&async_checks, check, checks);
+}
+
+/*
+ * Called for every event or error (which may be NULL) received with the given
+ * sequence number. The X server handles the requests in order, so all requests
+ * up to that sequence number are done: If one of them failed, this is its
+ * error.
+ *
+ */
+static void handle_async_checks(uint32_t full_sequence, xcb_generic_error_t *error) {
+    while (!TAILQ_EMPTY(&async_checks)) {
+        struct async_check *check = TAILQ_FIRST(&async_checks);
+        if ((int32_t)(check->sequence - full_sequence) > 0) {
+            break;
+        }
+
+        if (error != NULL && check->sequence == full_sequence) {
+            fprintf(stderr, "[%s:%d] ERROR: %s. X Error Code: %d\n", __FILE__, check->line, check->err_msg, error->error_code);
+            exit(EXIT_FAILURE);
+        }
+        TAILQ_REMOVE(&async_checks, check, checks);
+        free(check);
+    }
+}
+
 static uint32_t get_sep_offset(struct status_block *block) {
     if (!block->no_separator && block->sep_block_width > 0)
         return block->sep_block_width / 2 + block->sep_block_width % 2;
@@ -184,6 +411,27 @@ static void draw_separator(i3_output *output, uint32_t x, struct status_block *b
     }
 }
 
+/*
+ * Returns the width of the full or short text of the given block, measuring
+ * it only if it was not measured yet.
+ *
+ */
+static uint32_t block_text_width(struct status_block *block, bool use_short_text) {
+    if (use_short_text) {
+        if (!block->short_text_width_valid) {
+            block->short_text_width = predict_text_width(block->short_text);
+            block->short_text_width_valid = true;
+        }
+        return block->short_text_width;
+    }
+
+    if (!block->full_text_width_valid) {
+        block->full_text_width = predict_text_width(block->full_text);
+        block->full_text_width_valid = true;
+    }
+    return block->full_text_width;
+}
+
 static uint32_t predict_statusline_length(bool use_short_text) {
     uint32_t width = 0;
     struct status_block *block;
@@ -199,7 +447,7 @@ static uint32_t predict_statusline_length(bool use_short_text) {
         if (i3string_get_num_bytes(text) == 0)
             continue;
 
-        render->width = predict_text_width(text);
+        render->width = block_text_width(block, text == block->short_text);
         if (block->border)
             render->width += logical_px(block->border_left + block->border_right);
 
@@ -234,13 +482,65 @@ static uint32_t predict_statusline_length(bool use_short_text) {
 }
 
 /*
- * Redraws the statusline to the output's statusline_buffer
+ * Returns a string describing everything which affects how the given block is
+ * drawn at the given position, to tell whether it changed since the last
+ * statusline render.
+ *
+ */
+static char *statusline_block_key(struct status_block *block, i3String *text,
+                                  struct status_block_render_desc *render, uint32_t x) {
+    char *key;
+    sasprintf(&key, "%d,%d,%u,%u,%u,%u,%u,%u,%u,%u,%d,%d,%s,%s,%s,%d,%s",
+              (int32_t)x, block->urgent,
+              block->border_top, block->border_right, block->border_bottom, block->border_left,
+              render->width, render->x_offset, render->x_append,
+              block->sep_block_width, get_sep_offset(block), TAILQ_NEXT(block, blocks) != NULL,
+              block->color ? block->color : "", block->background ? block->background : "",
+              block->border ? block->border : "", i3string_is_markup(text), i3string_as_utf8(text));
+    return key;
+}
+
+/*
+ * Copies the given horizontal range of the output's statusline_buffer to its
+ * buffer and bar window.
+ *
+ */
+static void copy_statusline_range(i3_output *output, int start, int end) {
+    const statusline_geometry *geometry = &(output->statusline_geometry);
+    start = MAX(start, 0);
+    end = MIN(end, geometry->visible_width);
+    if (start >= end) {
+        return;
+    }
+
+    draw_util_copy_surface(&output->statusline_buffer, &output->buffer, start, 0,
+                           geometry->x_dest + start, 0, end - start, (int16_t)bar_height);
+    draw_util_copy_surface(&output->buffer, &output->bar, geometry->x_dest + start, 0,
+                           geometry->x_dest + start, 0, end - start, (int16_t)bar_height);
+}
+
+/*
+ * Redraws the statusline to the output's statusline_buffer.
+ *
+ * If only_changes is true, only the blocks which changed since the last
+ * statusline render are drawn again (the statusline must have the same
+ * geometry), and copied to the output's buffer and bar window right away.
+ *
  */
-static void draw_statusline(i3_output *output, uint32_t clip_left, bool use_focus_colors, bool use_short_text) {
+static void draw_statusline(i3_output *output, uint32_t clip_left, bool use_focus_colors, bool use_short_text, bool only_changes) {
     struct status_block *block;
 
     color_t bar_color = (use_focus_colors ? colors.focus_bar_bg : colors.bar_bg);
-    draw_util_clear_surface(&output->statusline_buffer, bar_color);
+    if (!only_changes) {
+        draw_util_clear_surface(&output->statusline_buffer, bar_color);
+    }
+
+    int num_blocks = 0;
+    TAILQ_FOREACH (block, &statusline_head, blocks) {
+        num_blocks++;
+    }
+    char **keys = scalloc(MAX(num_blocks, 1), sizeof(char *));
+    int drawn = 0;
 
     /* Use unsigned integer wraparound to clip off the left side.
      * For example, if clip_left is 75, then x will start at the very large
@@ -262,6 +562,29 @@ static void draw_statusline(i3_output *output, uint32_t clip_left, bool use_focu
         if (i3string_get_num_bytes(text) == 0)
             continue;
 
+        int full_render_width = render->width + render->x_offset + render->x_append;
+        const int block_start = (int32_t)x;
+        const int block_end = block_start + full_render_width +
+                              (TAILQ_NEXT(block, blocks) != NULL ? block->sep_block_width : 0);
+
+        /* The blocks cover the whole statusline, whose width did not change
+         * if only_changes is set. A block with the same key as the block
+         * drawn at the same index last time has the same position and
+         * contents, so every pixel outside of such blocks is drawn again. */
+        char *key = statusline_block_key(block, text, render, x);
+        const bool unchanged = (only_changes &&
+                                drawn < output->statusline_num_blocks &&
+                                strcmp(key, output->statusline_block_keys[drawn]) == 0);
+        keys[drawn++] = key;
+        if (unchanged) {
+            x = block_end;
+            continue;
+        }
+        if (only_changes && block_end > MAX(block_start, 0)) {
+            draw_util_rectangle(&output->statusline_buffer, bar_color,
+                                MAX(block_start, 0), 0, block_end - MAX(block_start, 0), bar_height);
+        }
+
         color_t fg_color;
         if (block->urgent) {
             fg_color = colors.urgent_ws_fg;
@@ -275,7 +598,6 @@ static void draw_statusline(i3_output *output, uint32_t clip_left, bool use_focu
 
         color_t bg_color = bar_color;
 
-        int full_render_width = render->width + render->x_offset + render->x_append;
         int has_border = block->border ? 1 : 0;
         if (block->border || block->background || block->urgent) {
             /* Let's determine the colors first. */
@@ -306,7 +628,7 @@ static void draw_statusline(i3_output *output, uint32_t clip_left, bool use_focu
 
         draw_util_text(text, &output->statusline_buffer, fg_color, bg_color,
                        x + render->x_offset + has_border * logical_px(block->border_left),
-                       bar_height / 2 - font.height / 2,
+                       bar_height / 2 - font->font.height / 2,
                        render->width - has_border * logical_px(block->border_left + block->border_right));
         x += full_render_width;
 
@@ -315,7 +637,18 @@ static void draw_statusline(i3_output *output, uint32_t clip_left, bool use_focu
             x += block->sep_block_width;
             draw_separator(output, x, block, use_focus_colors);
         }
+
+        if (only_changes) {
+            copy_statusline_range(output, block_start, block_end);
+        }
+    }
+
+    for (int i = 0; i < output->statusline_num_blocks; i++) {
+        free(output->statusline_block_keys[i]);
     }
+    free(output->statusline_block_keys);
+    output->statusline_block_keys = keys;
+    output->statusline_num_blocks = drawn;
 }
 
 /*
@@ -327,6 +660,11 @@ static void hide_bars(void) {
         return;
     }
 
+    stop_child();
+    if (!bars_unhidden) {
+        return;
+    }
+
     i3_output *walk;
     SLIST_FOREACH (walk, outputs, slist) {
         if (!walk->active) {
@@ -334,7 +672,7 @@ static void hide_bars(void) {
         }
         xcb_unmap_window(xcb_connection, walk->bar.id);
     }
-    stop_child();
+    bars_unhidden = false;
 }
 
 /*
@@ -353,6 +691,12 @@ static void unhide_bars(void) {
 
     cont_child();
 
+    /* The buffers are kept up to date while the bars are hidden, so mapping
+     * them again is enough (the Expose events copy the buffers). */
+    if (bars_unhidden) {
+        return;
+    }
+
     SLIST_FOREACH (walk, outputs, slist) {
         if (walk->bar.id == XCB_NONE) {
             continue;
@@ -371,16 +715,14 @@ static void unhide_bars(void) {
         values[3] = bar_height;
         values[4] = XCB_STACK_MODE_ABOVE;
         DLOG("Reconfiguring window for output %s to %d,%d\n", walk->name, values[0], values[1]);
-        cookie = xcb_configure_window_checked(xcb_connection,
-                                              walk->bar.id,
-                                              mask,
-                                              values);
-
-        if (xcb_request_failed(cookie, "Could not reconfigure window")) {
-            exit(EXIT_FAILURE);
-        }
+        cookie = xcb_configure_window(xcb_connection,
+                                      walk->bar.id,
+                                      mask,
+                                      values);
+        xcb_request_check_async(cookie, "Could not reconfigure window");
         xcb_map_window(xcb_connection, walk->bar.id);
     }
+    bars_unhidden = true;
 }
 
 /*
@@ -695,11 +1037,14 @@ static int reorder_trayclients_cmp(const void *_a, const void *_b) {
 
 /*
  * Adjusts the size of the tray window and alignment of the tray clients by
- * configuring their respective x coordinates. To be called when mapping or
- * unmapping a tray client window.
+ * configuring their respective x coordinates. Clients which are already at
+ * the right position are not moved. Called from xcb_prep_cb() after mapping or
+ * unmapping a tray client window set trayclients_changed.
  *
  */
 static void configure_trayclients(void) {
+    trayclients_changed = false;
+
     i3_output *output;
     SLIST_FOREACH (output, outputs, slist) {
         if (!output->active) {
@@ -728,11 +1073,16 @@ static void configure_trayclients(void) {
         for (idx = count; idx > 0; idx--) {
             x -= icon_size + logical_px(config.tray_padding);
 
-            DLOG("Configuring tray window %08x to x=%d\n", trayclients[idx - 1]->win, x);
+            client = trayclients[idx - 1];
+            if (client->x == x) {
+                continue;
+            }
+            DLOG("Configuring tray window %08x to x=%d\n", client->win, x);
             xcb_configure_window(xcb_connection,
-                                 trayclients[idx - 1]->win,
+                                 client->win,
                                  XCB_CONFIG_WINDOW_X,
                                  &x);
+            client->x = x;
         }
 
         free(trayclients);
@@ -935,6 +1285,7 @@ static void handle_client_message(xcb_client_message_event_t *event) {
             trayclient *tc = scalloc(1, sizeof(trayclient));
             tc->win = client;
             tc->xe_version = xe_version;
+            tc->x = output_for_tray->rect.w - icon_size - logical_px(config.tray_padding);
             tc->mapped = false;
             TAILQ_INSERT_TAIL(output_for_tray->trayclients, tc, tailq);
             trayclient_update_class(tc);
@@ -947,7 +1298,7 @@ static void handle_client_message(xcb_client_message_event_t *event) {
             }
             /* Trigger an update to copy the statusline text to the appropriate
              * position */
-            configure_trayclients();
+            trayclients_changed = true;
             draw_bars(false);
         }
     }
@@ -979,7 +1330,7 @@ static void handle_destroy_notify(xcb_destroy_notify_event_t *event) {
     FREE(client);
 
     /* Trigger an update, we now have more space for the statusline */
-    configure_trayclients();
+    trayclients_changed = true;
     draw_bars(false);
 }
 
@@ -1001,7 +1352,7 @@ static void handle_map_notify(xcb_map_notify_event_t *event) {
     client->mapped = true;
 
     /* Trigger an update, we now have one extra tray client. */
-    configure_trayclients();
+    trayclients_changed = true;
     draw_bars(false);
 }
 /*
@@ -1022,7 +1373,7 @@ static void handle_unmap_notify(xcb_unmap_notify_event_t *event) {
     client->mapped = false;
 
     /* Trigger an update, we now have more space for the statusline */
-    configure_trayclients();
+    trayclients_changed = true;
     draw_bars(false);
 }
 
@@ -1148,26 +1499,36 @@ static void xcb_prep_cb(struct ev_loop *loop, ev_prepare *watcher, int revents)
         if (event->response_type == 0) {
             xcb_generic_error_t *error = (xcb_generic_error_t *)event;
             DLOG("Received X11 error, sequence 0x%x, error_code = %d\n", error->sequence, error->error_code);
+            handle_async_checks(error->full_sequence, error);
             free(event);
             continue;
         }
+        handle_async_checks(event->full_sequence, NULL);
 
         int type = (event->response_type & ~0x80);
 
         if (type == xkb_base && xkb_base > -1) {
             DLOG("received an xkb event\n");
 
+            /* Every bar has its own modifier. */
             xcb_xkb_state_notify_event_t *state = (xcb_xkb_state_notify_event_t *)event;
-            const uint32_t mod = (config.modifier & 0xFFFF);
-            const bool new_mod_pressed = (mod != 0 && (state->mods & mod) == mod);
-            if (new_mod_pressed != mod_pressed) {
-                mod_pressed = new_mod_pressed;
-                if (state->xkbType == XCB_XKB_STATE_NOTIFY && config.modifier != XCB_NONE) {
-                    if (mod_pressed) {
-                        activated_mode = false;
-                        unhide_bars();
-                    } else if (!activated_mode) {
-                        hide_bars();
+            i3_bar *bar;
+            TAILQ_FOREACH (bar, &bars, bars) {
+                if (!bar->configured) {
+                    continue;
+                }
+                activate_bar(bar);
+                const uint32_t mod = (config.modifier & 0xFFFF);
+                const bool new_mod_pressed = (mod != 0 && (state->mods & mod) == mod);
+                if (new_mod_pressed != mod_pressed) {
+                    mod_pressed = new_mod_pressed;
+                    if (state->xkbType == XCB_XKB_STATE_NOTIFY && config.modifier != XCB_NONE) {
+                        if (mod_pressed) {
+                            activated_mode = false;
+                            unhide_bars();
+                        } else if (!activated_mode) {
+                            hide_bars();
+                        }
                     }
                 }
             }
@@ -1179,10 +1540,12 @@ static void xcb_prep_cb(struct ev_loop *loop, ev_prepare *watcher, int revents)
         switch (type) {
             case XCB_VISIBILITY_NOTIFY:
                 /* Visibility change: a bar is [un]obscured by other window */
+                activate_bar_for_window(((xcb_visibility_notify_event_t *)event)->window);
                 handle_visibility_notify((xcb_visibility_notify_event_t *)event);
                 break;
             case XCB_EXPOSE:
-                if (((xcb_expose_event_t *)event)->count == 0) {
+                if (((xcb_expose_event_t *)event)->count == 0 &&
+                    activate_bar_for_window(((xcb_expose_event_t *)event)->window)) {
                     /* Expose-events happen, when the window needs to be redrawn */
                     redraw_bars();
                 }
@@ -1191,40 +1554,58 @@ static void xcb_prep_cb(struct ev_loop *loop, ev_prepare *watcher, int revents)
             case XCB_BUTTON_RELEASE:
             case XCB_BUTTON_PRESS:
                 /* Button press events are mouse buttons clicked on one of our bars */
+                activate_bar_for_window(((xcb_button_press_event_t *)event)->event);
                 handle_button((xcb_button_press_event_t *)event);
                 break;
             case XCB_CLIENT_MESSAGE:
                 /* Client messages are used for client-to-client communication, for
                  * example system tray widgets talk to us directly via client messages. */
+                activate_bar_for_window(((xcb_client_message_event_t *)event)->window);
                 handle_client_message((xcb_client_message_event_t *)event);
                 break;
             case XCB_DESTROY_NOTIFY:
                 /* DestroyNotify signifies the end of the XEmbed protocol */
+                activate_bar_for_window(((xcb_destroy_notify_event_t *)event)->window);
                 handle_destroy_notify((xcb_destroy_notify_event_t *)event);
                 break;
             case XCB_UNMAP_NOTIFY:
                 /* UnmapNotify is received when a tray client hides its window. */
+                activate_bar_for_window(((xcb_unmap_notify_event_t *)event)->window);
                 handle_unmap_notify((xcb_unmap_notify_event_t *)event);
                 break;
             case XCB_MAP_NOTIFY:
+                activate_bar_for_window(((xcb_map_notify_event_t *)event)->window);
                 handle_map_notify((xcb_map_notify_event_t *)event);
                 break;
             case XCB_PROPERTY_NOTIFY:
                 /* PropertyNotify */
+                activate_bar_for_window(((xcb_property_notify_event_t *)event)->window);
                 handle_property_notify((xcb_property_notify_event_t *)event);
                 break;
             case XCB_CONFIGURE_REQUEST:
                 /* ConfigureRequest, sent by a tray child */
+                activate_bar_for_window(((xcb_configure_request_event_t *)event)->window);
                 handle_configure_request((xcb_configure_request_event_t *)event);
                 break;
             case XCB_RESIZE_REQUEST:
                 /* ResizeRequest sent by a tray child using override_redirect. */
+                activate_bar_for_window(((xcb_resize_request_event_t *)event)->window);
                 handle_resize_request((xcb_resize_request_event_t *)event);
                 break;
         }
         free(event);
     }
 
+    /* The tray clients are moved once per loop iteration, after all events
+     * which changed them were handled. */
+    i3_bar *bar;
+    TAILQ_FOREACH (bar, &bars, bars) {
+        if (bar == active_bar ? trayclients_changed : bar->xcb->trayclients_changed) {
+            activate_bar(bar);
+            configure_trayclients();
+        }
+    }
+
     xcb_flush(xcb_connection);
 }
 
@@ -1352,10 +1733,13 @@ void init_xcb_late(char *fontname) {
         fontname = "-misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1";
 
     /* Load the font */
-    font = load_font(fontname, true);
-    set_font(&font);
-    DLOG("Calculated font height: %d\n", font.height);
-    bar_height = font.height + 2 * logical_px(ws_voff_px);
+    struct bar_font *old_font = font;
+    font = acquire_font(fontname);
+    release_font(old_font);
+    set_font(&(font->font));
+    current_font = font;
+    DLOG("Calculated font height: %d\n", font->font.height);
+    bar_height = font->font.height + 2 * logical_px(ws_voff_px);
     icon_size = bar_height - 2 * logical_px(config.tray_padding);
 
     if (config.separator_symbol)
@@ -1527,9 +1911,17 @@ void init_tray_colors(void) {
  *
  */
 void clean_xcb(void) {
-    free_outputs();
+    i3_bar *bar;
+    TAILQ_FOREACH (bar, &bars, bars) {
+        activate_bar(bar);
+        free_outputs();
+    }
 
-    free_font();
+    while (!SLIST_EMPTY(&fonts)) {
+        struct bar_font *bar_font = SLIST_FIRST(&fonts);
+        bar_font->refcount = 1;
+        release_font(bar_font);
+    }
 
     xcb_free_cursor(xcb_connection, cursor);
     xcb_aux_sync(xcb_connection);
@@ -1627,6 +2019,8 @@ void destroy_window(i3_output *output) {
     xcb_free_pixmap(xcb_connection, output->buffer.id);
     xcb_free_pixmap(xcb_connection, output->statusline_buffer.id);
     output->bar.id = XCB_NONE;
+    output->statusline_drawn = false;
+    FREE(output->workspace_buttons_key);
 }
 
 /* Strut partial tells i3 where to reserve space for i3bar. This is determined
@@ -1731,8 +2125,22 @@ void reconfig_windows(bool redraw_bars) {
     uint32_t mask;
     uint32_t values[6];
 
+    /* New bars are not mapped in hide mode, and redraw_bars unmaps all of
+     * them, so the next unhide_bars() needs to map them. */
+    if (redraw_bars) {
+        bars_unhidden = false;
+    }
+
     i3_output *walk;
     SLIST_FOREACH (walk, outputs, slist) {
+        /* Bars of outputs which did not change are left alone, unless all
+         * of them have to be redrawn. */
+        const bool changed = walk->changed;
+        walk->changed = false;
+        if (!changed && !redraw_bars && walk->bar.id != XCB_NONE) {
+            continue;
+        }
+
         if (!walk->active) {
             /* If an output is not active, we destroy its bar */
             /* FIXME: Maybe we rather want to unmap? */
@@ -1742,6 +2150,7 @@ void reconfig_windows(bool redraw_bars) {
         }
         if (walk->bar.id == XCB_NONE) {
             DLOG("Creating window for output %s\n", walk->name);
+            bars_unhidden = false;
 
             xcb_window_t bar_id = xcb_generate_id(xcb_connection);
             xcb_pixmap_t buffer_id = xcb_generate_id(xcb_connection);
@@ -1771,33 +2180,33 @@ void reconfig_windows(bool redraw_bars) {
             values[4] = colormap;
             values[5] = cursor;
 
-            xcb_void_cookie_t win_cookie = xcb_create_window_checked(xcb_connection,
-                                                                     depth,
-                                                                     bar_id,
-                                                                     xcb_root,
-                                                                     walk->rect.x, walk->rect.y + walk->rect.h - bar_height,
-                                                                     walk->rect.w, bar_height,
-                                                                     0,
-                                                                     XCB_WINDOW_CLASS_INPUT_OUTPUT,
-                                                                     visual_type->visual_id,
-                                                                     mask,
-                                                                     values);
+            xcb_void_cookie_t win_cookie = xcb_create_window(xcb_connection,
+                                                             depth,
+                                                             bar_id,
+                                                             xcb_root,
+                                                             walk->rect.x, walk->rect.y + walk->rect.h - bar_height,
+                                                             walk->rect.w, bar_height,
+                                                             0,
+                                                             XCB_WINDOW_CLASS_INPUT_OUTPUT,
+                                                             visual_type->visual_id,
+                                                             mask,
+                                                             values);
 
             /* The double-buffer we use to render stuff off-screen */
-            xcb_void_cookie_t pm_cookie = xcb_create_pixmap_checked(xcb_connection,
-                                                                    depth,
-                                                                    buffer_id,
-                                                                    bar_id,
-                                                                    walk->rect.w,
-                                                                    bar_height);
+            xcb_void_cookie_t pm_cookie = xcb_create_pixmap(xcb_connection,
+                                                            depth,
+                                                            buffer_id,
+                                                            bar_id,
+                                                            walk->rect.w,
+                                                            bar_height);
 
             /* The double-buffer we use to render the statusline before copying to buffer */
-            xcb_void_cookie_t slpm_cookie = xcb_create_pixmap_checked(xcb_connection,
-                                                                      depth,
-                                                                      statusline_buffer_id,
-                                                                      bar_id,
-                                                                      walk->rect.w,
-                                                                      bar_height);
+            xcb_void_cookie_t slpm_cookie = xcb_create_pixmap(xcb_connection,
+                                                              depth,
+                                                              statusline_buffer_id,
+                                                              bar_id,
+                                                              walk->rect.w,
+                                                              bar_height);
 
             /* Set the WM_CLASS and WM_NAME (we don't need UTF-8) atoms */
             char *class;
@@ -1839,24 +2248,28 @@ void reconfig_windows(bool redraw_bars) {
             draw_util_surface_init(xcb_connection, &walk->bar, bar_id, NULL, walk->rect.w, bar_height);
             draw_util_surface_init(xcb_connection, &walk->buffer, buffer_id, NULL, walk->rect.w, bar_height);
             draw_util_surface_init(xcb_connection, &walk->statusline_buffer, statusline_buffer_id, NULL, walk->rect.w, bar_height);
+            walk->statusline_drawn = false;
+            FREE(walk->workspace_buttons_key);
 
             xcb_void_cookie_t strut_cookie = config_strut_partial(walk);
 
             /* We finally map the bar (display it on screen), unless the modifier-switch is on */
             xcb_void_cookie_t map_cookie;
             if (config.hide_on_modifier == M_DOCK) {
-                map_cookie = xcb_map_window_checked(xcb_connection, bar_id);
+                map_cookie = xcb_map_window(xcb_connection, bar_id);
             }
 
-            if (xcb_request_failed(win_cookie, "Could not create window") ||
-                xcb_request_failed(pm_cookie, "Could not create pixmap") ||
-                xcb_request_failed(slpm_cookie, "Could not create statusline pixmap") ||
-                xcb_request_failed(dock_cookie, "Could not set dock mode") ||
-                xcb_request_failed(class_cookie, "Could not set WM_CLASS") ||
-                xcb_request_failed(name_cookie, "Could not set WM_NAME") ||
-                xcb_request_failed(strut_cookie, "Could not set strut") ||
-                ((config.hide_on_modifier == M_DOCK) && xcb_request_failed(map_cookie, "Could not map window"))) {
-                exit(EXIT_FAILURE);
+            /* The errors are checked once they arrive, so that creating the
+             * bars of all outputs takes no round trips. */
+            xcb_request_check_async(win_cookie, "Could not create window");
+            xcb_request_check_async(pm_cookie, "Could not create pixmap");
+            xcb_request_check_async(slpm_cookie, "Could not create statusline pixmap");
+            xcb_request_check_async(class_cookie, "Could not set WM_CLASS");
+            xcb_request_check_async(name_cookie, "Could not set WM_NAME");
+            xcb_request_check_async(dock_cookie, "Could not set dock mode");
+            xcb_request_check_async(strut_cookie, "Could not set strut");
+            if (config.hide_on_modifier == M_DOCK) {
+                xcb_request_check_async(map_cookie, "Could not map window");
             }
 
         } else {
@@ -1885,10 +2298,10 @@ void reconfig_windows(bool redraw_bars) {
             xcb_free_pixmap(xcb_connection, walk->statusline_buffer.id);
 
             DLOG("Reconfiguring window for output %s to %d,%d\n", walk->name, values[0], values[1]);
-            xcb_void_cookie_t cfg_cookie = xcb_configure_window_checked(xcb_connection,
-                                                                        walk->bar.id,
-                                                                        mask,
-                                                                        values);
+            xcb_void_cookie_t cfg_cookie = xcb_configure_window(xcb_connection,
+                                                                walk->bar.id,
+                                                                mask,
+                                                                values);
 
             mask = XCB_CW_OVERRIDE_REDIRECT;
             values[0] = (config.hide_on_modifier == M_DOCK ? 0 : 1);
@@ -1899,20 +2312,20 @@ void reconfig_windows(bool redraw_bars) {
                                                                         values);
 
             DLOG("Recreating buffer for output %s\n", walk->name);
-            xcb_void_cookie_t pm_cookie = xcb_create_pixmap_checked(xcb_connection,
-                                                                    depth,
-                                                                    walk->buffer.id,
-                                                                    walk->bar.id,
-                                                                    walk->rect.w,
-                                                                    bar_height);
+            xcb_void_cookie_t pm_cookie = xcb_create_pixmap(xcb_connection,
+                                                            depth,
+                                                            walk->buffer.id,
+                                                            walk->bar.id,
+                                                            walk->rect.w,
+                                                            bar_height);
 
             DLOG("Recreating statusline buffer for output %s\n", walk->name);
-            xcb_void_cookie_t slpm_cookie = xcb_create_pixmap_checked(xcb_connection,
-                                                                      depth,
-                                                                      walk->statusline_buffer.id,
-                                                                      walk->bar.id,
-                                                                      walk->rect.w,
-                                                                      bar_height);
+            xcb_void_cookie_t slpm_cookie = xcb_create_pixmap(xcb_connection,
+                                                              depth,
+                                                              walk->statusline_buffer.id,
+                                                              walk->bar.id,
+                                                              walk->rect.w,
+                                                              bar_height);
 
             draw_util_surface_free(xcb_connection, &(walk->bar));
             draw_util_surface_free(xcb_connection, &(walk->buffer));
@@ -1920,14 +2333,23 @@ void reconfig_windows(bool redraw_bars) {
             draw_util_surface_init(xcb_connection, &(walk->bar), walk->bar.id, NULL, walk->rect.w, bar_height);
             draw_util_surface_init(xcb_connection, &(walk->buffer), walk->buffer.id, NULL, walk->rect.w, bar_height);
             draw_util_surface_init(xcb_connection, &(walk->statusline_buffer), walk->statusline_buffer.id, NULL, walk->rect.w, bar_height);
+            walk->statusline_drawn = false;
+            FREE(walk->workspace_buttons_key);
+
+            xcb_request_check_async(strut_cookie, "Could not set strut");
+            xcb_request_check_async(cfg_cookie, "Could not reconfigure window");
+            xcb_request_check_async(chg_cookie, "Could not change window");
+            xcb_request_check_async(pm_cookie, "Could not create pixmap");
+            xcb_request_check_async(slpm_cookie, "Could not create statusline pixmap");
 
-            xcb_void_cookie_t map_cookie, umap_cookie;
             if (redraw_bars) {
                 /* Unmap the window, and draw it again when in dock mode */
-                umap_cookie = xcb_unmap_window_checked(xcb_connection, walk->bar.id);
+                xcb_request_check_async(xcb_unmap_window(xcb_connection, walk->bar.id),
+                                        "Could not unmap window");
                 if (config.hide_on_modifier == M_DOCK) {
                     cont_child();
-                    map_cookie = xcb_map_window_checked(xcb_connection, walk->bar.id);
+                    xcb_request_check_async(xcb_map_window(xcb_connection, walk->bar.id),
+                                            "Could not map window");
                 } else {
                     stop_child();
                 }
@@ -1940,22 +2362,22 @@ void reconfig_windows(bool redraw_bars) {
                     deregister_xkb_keyevents();
                 }
             }
-
-            if (xcb_request_failed(cfg_cookie, "Could not reconfigure window") ||
-                xcb_request_failed(chg_cookie, "Could not change window") ||
-                xcb_request_failed(pm_cookie, "Could not create pixmap") ||
-                xcb_request_failed(slpm_cookie, "Could not create statusline pixmap") ||
-                xcb_request_failed(strut_cookie, "Could not set strut") ||
-                (redraw_bars && (xcb_request_failed(umap_cookie, "Could not unmap window") ||
-                                 (config.hide_on_modifier == M_DOCK && xcb_request_failed(map_cookie, "Could not map window"))))) {
-                exit(EXIT_FAILURE);
-            }
         }
     }
 
     /* Finally, check if we want to initialize the tray or destroy the selection
-     * window. The result of get_tray_output() is cached. */
+     * window. The result of get_tray_output() is cached. When the tray moves
+     * to another output, its clients dock again on the new one. */
+    i3_output *old_output_for_tray = output_for_tray;
     output_for_tray = get_tray_output();
+    if (old_output_for_tray != NULL && old_output_for_tray != output_for_tray) {
+        SLIST_FOREACH (walk, outputs, slist) {
+            if (walk == old_output_for_tray) {
+                kick_tray_clients(walk);
+                break;
+            }
+        }
+    }
     if (output_for_tray) {
         if (selwin == XCB_NONE) {
             init_tray();
@@ -1973,7 +2395,7 @@ void reconfig_windows(bool redraw_bars) {
  */
 static void draw_button(surface_t *surface, color_t fg_color, color_t bg_color, color_t border_color,
                         int x, int width, int text_width, i3String *text) {
-    int height = font.height + 2 * logical_px(ws_voff_px) - 2 * logical_px(1);
+    int height = font->font.height + 2 * logical_px(ws_voff_px) - 2 * logical_px(1);
 
     /* Draw the border of the button. */
     draw_util_rectangle(surface, border_color, x, logical_px(1), width, height);
@@ -1986,6 +2408,244 @@ static void draw_button(surface_t *surface, color_t fg_color, color_t bg_color,
                    logical_px(ws_voff_px), text_width);
 }
 
+/*
+ * Returns the colors of the button for the given workspace.
+ *
+ */
+static void get_workspace_button_colors(i3_ws *ws, color_t *fg_color, color_t *bg_color, color_t *border_color) {
+    *fg_color = colors.inactive_ws_fg;
+    *bg_color = colors.inactive_ws_bg;
+    *border_color = colors.inactive_ws_border;
+    if (ws->visible) {
+        if (!ws->focused) {
+            *fg_color = colors.active_ws_fg;
+            *bg_color = colors.active_ws_bg;
+            *border_color = colors.active_ws_border;
+        } else {
+            *fg_color = colors.focus_ws_fg;
+            *bg_color = colors.focus_ws_bg;
+            *border_color = colors.focus_ws_border;
+        }
+    }
+    if (ws->urgent) {
+        *fg_color = colors.urgent_ws_fg;
+        *bg_color = colors.urgent_ws_bg;
+        *border_color = colors.urgent_ws_border;
+    }
+}
+
+/*
+ * Draws the workspace buttons and the binding mode indicator to the output's
+ * buffer, and clears the rest of it. Returns the width of the buttons and sets
+ * *unhide if a workspace is urgent or a binding mode is active.
+ *
+ * The buffer keeps its contents between draws, so if the buttons look the
+ * same as when they were last drawn (same names, states and colors, see
+ * workspace_buttons_key), they are not drawn again.
+ *
+ */
+static int draw_workspace_buttons(i3_output *output, bool use_focus_colors, bool *unhide) {
+    color_t bar_bg = (use_focus_colors ? colors.focus_bar_bg : colors.bar_bg);
+    const bool draw_binding = (binding.name && !config.disable_binding_mode_indicator);
+
+    /* Describe the buttons first to tell whether they changed. */
+    char *key;
+    sasprintf(&key, "%08x", bar_bg.colorpixel);
+    int workspace_width = 0;
+    if (!config.disable_ws) {
+        i3_ws *ws_walk;
+        TAILQ_FOREACH (ws_walk, output->workspaces, tailq) {
+            color_t fg_color, bg_color, border_color;
+            get_workspace_button_colors(ws_walk, &fg_color, &bg_color, &border_color);
+            if (ws_walk->urgent) {
+                DLOG("WS %s is urgent!\n", i3string_as_utf8(ws_walk->name));
+                *unhide = true;
+            }
+
+            char *next;
+            sasprintf(&next, "%s|%08x,%08x,%08x,%d,%d,%s", key,
+                      fg_color.colorpixel, bg_color.colorpixel, border_color.colorpixel,
+                      ws_walk->name_width, i3string_is_markup(ws_walk->name), i3string_as_utf8(ws_walk->name));
+            free(key);
+            key = next;
+
+            workspace_width += predict_button_width(ws_walk->name_width);
+            if (TAILQ_NEXT(ws_walk, tailq) != NULL)
+                workspace_width += logical_px(ws_spacing_px);
+        }
+    }
+
+    if (draw_binding) {
+        char *next;
+        sasprintf(&next, "%s|mode,%d,%d,%s", key, binding.name_width,
+                  i3string_is_markup(binding.name), i3string_as_utf8(binding.name));
+        free(key);
+        key = next;
+
+        *unhide = true;
+        workspace_width += logical_px(ws_spacing_px) + predict_button_width(binding.name_width);
+    }
+
+    const bool unchanged = (output->workspace_buttons_key != NULL &&
+                            strcmp(key, output->workspace_buttons_key) == 0);
+    free(output->workspace_buttons_key);
+    output->workspace_buttons_key = key;
+
+    if (unchanged) {
+        DLOG("Workspace buttons on output %s did not change\n", output->name);
+        draw_util_rectangle(&(output->buffer), bar_bg, workspace_width, 0,
+                            output->rect.w - workspace_width, bar_height);
+        return workspace_width;
+    }
+
+    /* First things first: clear the backbuffer */
+    draw_util_clear_surface(&(output->buffer), bar_bg);
+
+    int x = 0;
+    if (!config.disable_ws) {
+        i3_ws *ws_walk;
+        TAILQ_FOREACH (ws_walk, output->workspaces, tailq) {
+            DLOG("Drawing button for WS %s at x = %d, len = %d\n",
+                 i3string_as_utf8(ws_walk->name), x, ws_walk->name_width);
+            color_t fg_color, bg_color, border_color;
+            get_workspace_button_colors(ws_walk, &fg_color, &bg_color, &border_color);
+
+            int w = predict_button_width(ws_walk->name_width);
+            draw_button(&(output->buffer), fg_color, bg_color, border_color,
+                        x, w, ws_walk->name_width, ws_walk->name);
+
+            x += w;
+            if (TAILQ_NEXT(ws_walk, tailq) != NULL)
+                x += logical_px(ws_spacing_px);
+        }
+    }
+
+    if (draw_binding) {
+        x += logical_px(ws_spacing_px);
+
+        int w = predict_button_width(binding.name_width);
+        draw_button(&(output->buffer), colors.binding_mode_fg, colors.binding_mode_bg,
+                    colors.binding_mode_border, x, w, binding.name_width, binding.name);
+    }
+
+    return workspace_width;
+}
+
+/*
+ * Computes where the statusline is drawn on the given output, next to
+ * workspace_width pixels of workspace buttons (and the binding mode
+ * indicator).
+ *
+ */
+static statusline_geometry get_statusline_geometry(i3_output *output, int workspace_width,
+                                                   uint32_t full_statusline_width,
+                                                   uint32_t short_statusline_width) {
+    statusline_geometry geometry = {
+        .workspace_width = workspace_width,
+        .tray_width = get_tray_width(output->trayclients),
+        .width = full_statusline_width,
+        .clip_left = 0,
+        .use_short_text = false,
+        .use_focus_colors = output_has_focus(output),
+    };
+
+    uint32_t hoff = logical_px(((workspace_width > 0) + (geometry.tray_width > 0)) * sb_hoff_px);
+    uint32_t max_statusline_width = output->rect.w - workspace_width - geometry.tray_width - hoff;
+
+    if (geometry.width > max_statusline_width) {
+        geometry.width = short_statusline_width;
+        geometry.use_short_text = true;
+        if (geometry.width > max_statusline_width) {
+            geometry.clip_left = geometry.width - max_statusline_width;
+        }
+    }
+
+    geometry.visible_width = (int16_t)MIN(geometry.width, max_statusline_width);
+    geometry.x_dest = output->rect.w - geometry.tray_width - logical_px((geometry.tray_width > 0) * sb_hoff_px) - geometry.visible_width;
+    return geometry;
+}
+
+static bool statusline_geometry_equals(const statusline_geometry *a, const statusline_geometry *b) {
+    return (a->workspace_width == b->workspace_width &&
+            a->tray_width == b->tray_width &&
+            a->width == b->width &&
+            a->clip_left == b->clip_left &&
+            a->use_short_text == b->use_short_text &&
+            a->use_focus_colors == b->use_focus_colors &&
+            a->visible_width == b->visible_width &&
+            a->x_dest == b->x_dest);
+}
+
+/*
+ * Returns whether statuslines drawn with the given geometries have the same
+ * pixels (they can be at different positions of their bars).
+ *
+ */
+static bool statusline_geometry_same_pixels(const statusline_geometry *a, const statusline_geometry *b) {
+    return (a->width == b->width &&
+            a->clip_left == b->clip_left &&
+            a->use_short_text == b->use_short_text &&
+            a->use_focus_colors == b->use_focus_colors &&
+            a->visible_width == b->visible_width);
+}
+
+/*
+ * Returns an output before the given one in the list of outputs whose
+ * statusline has the same pixels, so that it can be copied instead of being
+ * drawn again. Returns NULL if there is none.
+ *
+ */
+static i3_output *find_statusline_twin(i3_output *output) {
+    i3_output *walk;
+    SLIST_FOREACH (walk, outputs, slist) {
+        if (walk == output) {
+            break;
+        }
+        if (walk->active && walk->statusline_drawn &&
+            statusline_geometry_same_pixels(&(walk->statusline_geometry), &(output->statusline_geometry))) {
+            return walk;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Returns whether both outputs show the same statusline blocks.
+ *
+ */
+static bool statusline_blocks_equal(i3_output *a, i3_output *b) {
+    if (a->statusline_num_blocks != b->statusline_num_blocks) {
+        return false;
+    }
+    for (int i = 0; i < a->statusline_num_blocks; i++) {
+        if (strcmp(a->statusline_block_keys[i], b->statusline_block_keys[i]) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Copies the statusline of twin (see find_statusline_twin()) to the
+ * statusline_buffer of the given output, instead of drawing the same text
+ * again.
+ *
+ */
+static void copy_statusline(i3_output *output, i3_output *twin) {
+    draw_util_copy_surface(&twin->statusline_buffer, &output->statusline_buffer, 0, 0,
+                           0, 0, output->statusline_geometry.visible_width, (int16_t)bar_height);
+
+    for (int i = 0; i < output->statusline_num_blocks; i++) {
+        free(output->statusline_block_keys[i]);
+    }
+    free(output->statusline_block_keys);
+    output->statusline_block_keys = scalloc(MAX(twin->statusline_num_blocks, 1), sizeof(char *));
+    for (int i = 0; i < twin->statusline_num_blocks; i++) {
+        output->statusline_block_keys[i] = sstrdup(twin->statusline_block_keys[i]);
+    }
+    output->statusline_num_blocks = twin->statusline_num_blocks;
+}
+
 /*
  * Render the bars, with buttons and statusline
  *
@@ -2011,84 +2671,29 @@ void draw_bars(bool unhide) {
 
         bool use_focus_colors = output_has_focus(outputs_walk);
 
-        /* First things first: clear the backbuffer */
-        draw_util_clear_surface(&(outputs_walk->buffer), (use_focus_colors ? colors.focus_bar_bg : colors.bar_bg));
-
-        if (!config.disable_ws) {
-            i3_ws *ws_walk;
-            TAILQ_FOREACH (ws_walk, outputs_walk->workspaces, tailq) {
-                DLOG("Drawing button for WS %s at x = %d, len = %d\n",
-                     i3string_as_utf8(ws_walk->name), workspace_width, ws_walk->name_width);
-                color_t fg_color = colors.inactive_ws_fg;
-                color_t bg_color = colors.inactive_ws_bg;
-                color_t border_color = colors.inactive_ws_border;
-                if (ws_walk->visible) {
-                    if (!ws_walk->focused) {
-                        fg_color = colors.active_ws_fg;
-                        bg_color = colors.active_ws_bg;
-                        border_color = colors.active_ws_border;
-                    } else {
-                        fg_color = colors.focus_ws_fg;
-                        bg_color = colors.focus_ws_bg;
-                        border_color = colors.focus_ws_border;
-                    }
-                }
-                if (ws_walk->urgent) {
-                    DLOG("WS %s is urgent!\n", i3string_as_utf8(ws_walk->name));
-                    fg_color = colors.urgent_ws_fg;
-                    bg_color = colors.urgent_ws_bg;
-                    border_color = colors.urgent_ws_border;
-                    unhide = true;
-                }
-
-                int w = predict_button_width(ws_walk->name_width);
-                draw_button(&(outputs_walk->buffer), fg_color, bg_color, border_color,
-                            workspace_width, w, ws_walk->name_width, ws_walk->name);
-
-                workspace_width += w;
-                if (TAILQ_NEXT(ws_walk, tailq) != NULL)
-                    workspace_width += logical_px(ws_spacing_px);
-            }
-        }
-
-        if (binding.name && !config.disable_binding_mode_indicator) {
-            workspace_width += logical_px(ws_spacing_px);
-
-            int w = predict_button_width(binding.name_width);
-            draw_button(&(outputs_walk->buffer), colors.binding_mode_fg, colors.binding_mode_bg,
-                        colors.binding_mode_border, workspace_width, w, binding.name_width, binding.name);
-
-            unhide = true;
-            workspace_width += w;
-        }
+        workspace_width = draw_workspace_buttons(outputs_walk, use_focus_colors, &unhide);
 
         if (!TAILQ_EMPTY(&statusline_head)) {
             DLOG("Printing statusline!\n");
 
-            int tray_width = get_tray_width(outputs_walk->trayclients);
-            uint32_t hoff = logical_px(((workspace_width > 0) + (tray_width > 0)) * sb_hoff_px);
-            uint32_t max_statusline_width = outputs_walk->rect.w - workspace_width - tray_width - hoff;
-            uint32_t clip_left = 0;
-            uint32_t statusline_width = full_statusline_width;
-            bool use_short_text = false;
-
-            if (statusline_width > max_statusline_width) {
-                statusline_width = short_statusline_width;
-                use_short_text = true;
-                if (statusline_width > max_statusline_width) {
-                    clip_left = statusline_width - max_statusline_width;
-                }
-            }
+            statusline_geometry geometry = get_statusline_geometry(outputs_walk, workspace_width,
+                                                                   full_statusline_width, short_statusline_width);
 
-            int16_t visible_statusline_width = MIN(statusline_width, max_statusline_width);
-            int x_dest = outputs_walk->rect.w - tray_width - logical_px((tray_width > 0) * sb_hoff_px) - visible_statusline_width;
-
-            draw_statusline(outputs_walk, clip_left, use_focus_colors, use_short_text);
+            outputs_walk->statusline_geometry = geometry;
+            i3_output *twin = find_statusline_twin(outputs_walk);
+            if (twin != NULL) {
+                copy_statusline(outputs_walk, twin);
+            } else {
+                draw_statusline(outputs_walk, geometry.clip_left, geometry.use_focus_colors, geometry.use_short_text, false);
+            }
             draw_util_copy_surface(&outputs_walk->statusline_buffer, &outputs_walk->buffer, 0, 0,
-                                   x_dest, 0, visible_statusline_width, (int16_t)bar_height);
+                                   geometry.x_dest, 0, geometry.visible_width, (int16_t)bar_height);
 
-            outputs_walk->statusline_width = statusline_width;
-            outputs_walk->statusline_short_text = use_short_text;
+            outputs_walk->statusline_width = geometry.width;
+            outputs_walk->statusline_short_text = geometry.use_short_text;
+            outputs_walk->statusline_drawn = true;
+        } else {
+            outputs_walk->statusline_drawn = false;
         }
     }
 
@@ -2104,6 +2709,58 @@ void draw_bars(bool unhide) {
     redraw_bars();
 }
 
+/*
+ * Like draw_bars(), but only for a changed statusline: if the statusline still
+ * has the same size on every output, only the blocks which changed are drawn
+ * again and copied to the bars.
+ *
+ */
+void draw_statusline_changes(bool unhide) {
+    /* Whether the bars are hidden depends on the whole bar, see draw_bars(). */
+    if (unhide || config.hide_on_modifier != M_DOCK || TAILQ_EMPTY(&statusline_head)) {
+        draw_bars(unhide);
+        return;
+    }
+
+    uint32_t full_statusline_width = predict_statusline_length(false);
+    uint32_t short_statusline_width = predict_statusline_length(true);
+
+    i3_output *outputs_walk;
+    SLIST_FOREACH (outputs_walk, outputs, slist) {
+        if (!outputs_walk->active) {
+            continue;
+        }
+        if (outputs_walk->bar.id == XCB_NONE || !outputs_walk->statusline_drawn) {
+            draw_bars(false);
+            return;
+        }
+
+        statusline_geometry geometry = get_statusline_geometry(outputs_walk, outputs_walk->statusline_geometry.workspace_width,
+                                                               full_statusline_width, short_statusline_width);
+        if (!statusline_geometry_equals(&geometry, &(outputs_walk->statusline_geometry))) {
+            DLOG("Statusline geometry changed on output %s, drawing the whole bar\n", outputs_walk->name);
+            draw_bars(false);
+            return;
+        }
+    }
+
+    SLIST_FOREACH (outputs_walk, outputs, slist) {
+        if (!outputs_walk->active) {
+            continue;
+        }
+
+        const statusline_geometry *geometry = &(outputs_walk->statusline_geometry);
+        i3_output *twin = find_statusline_twin(outputs_walk);
+        if (twin == NULL) {
+            draw_statusline(outputs_walk, geometry->clip_left, geometry->use_focus_colors, geometry->use_short_text, true);
+        } else if (!statusline_blocks_equal(outputs_walk, twin)) {
+            copy_statusline(outputs_walk, twin);
+            copy_statusline_range(outputs_walk, 0, geometry->visible_width);
+        }
+    }
+    xcb_flush(xcb_connection);
+}
+
 /*
  * Redraw the bars, i.e. simply copy the buffer to the barwindow
  *
@@ -65,6 +65,7 @@
 #include "assignments.h"
 #include "regex.h"
 #include "startup.h"
+#include "launcher.h"
 #include "scratchpad.h"
 #include "commands.h"
 #include "commands_parser.h"
@@ -76,3 +77,16 @@
 #include "restore_layout.h"
 #include "sync.h"
 #include "main.h"
+#include "pool.h"
+#include "tree_events.h"
+#include "stats.h"
+#include "probes.h"
+#include "trace.h"
+#include "intern.h"
+#include "memory.h"
+#include "worker.h"
+#include "timer_wheel.h"
+#include "maintenance.h"
+#include "tree_shm.h"
+#include "raw_pointer.h"
+#include "json_snapshot.h"
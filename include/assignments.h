@@ -11,12 +11,23 @@
 
 #include <config.h>
 
+/**
+ * Sorts the assignments into buckets by the exact class or instance they
+ * require, so that windows are only checked against the assignments which
+ * can possibly match them. Needs to be called after the configuration was
+ * (re-)loaded.
+ *
+ */
+void compile_assignments(void);
+
 /**
  * Checks the list of assignments for the given window and runs all matching
- * ones (unless they have already been run for this specific window).
+ * ones (unless they have already been run for this specific window). Only
+ * the assignments which depend on one of the changed window properties
+ * (WP_*) are checked, WP_ALL checks all of them.
  *
  */
-void run_assignments(i3Window *window);
+void run_assignments(i3Window *window, uint32_t changed);
 
 /**
  * Returns the first matching assignment for the given window.
@@ -31,17 +31,28 @@ Binding *configure_binding(const char *bindtype, const char *modifiers, const ch
                            bool pango_markup);
 
 /**
- * Grab the bound keys (tell X to send us keypress events for those keycodes)
+ * Grab the bound keys (tell X to send us keypress events for those keycodes).
+ * Only the keys which are not grabbed yet are grabbed, and keys which are no
+ * longer bound (e.g. after a mode or XKB group switch) are ungrabbed.
  *
  */
 void grab_all_keys(xcb_connection_t *conn);
 
 /**
- * Release the button grabs on all managed windows and regrab them,
- * reevaluating which buttons need to be grabbed.
+ * Forgets about the active key grabs. To be called when all keys were
+ * ungrabbed, see ungrab_all_keys().
  *
  */
-void regrab_all_buttons(xcb_connection_t *conn);
+void forget_key_grabs(void);
+
+/**
+ * Updates the button grabs on all managed windows, reevaluating which buttons
+ * need to be grabbed. If old_buttons is not NULL, all windows have exactly
+ * those buttons grabbed, so only the difference is ungrabbed and grabbed.
+ * Otherwise, all button grabs are released and grabbed again.
+ *
+ */
+void regrab_all_buttons(xcb_connection_t *conn, const int *old_buttons);
 
 /**
  * Returns a pointer to the Binding that matches the given xcb event or NULL if
@@ -62,6 +73,15 @@ void translate_keysyms(void);
  */
 void switch_mode(const char *new_mode);
 
+/**
+ * Assigns every binding an id derived from its mode and its input (type,
+ * symbol or keycode, modifiers and flags), but not its command. The ids thus
+ * stay the same across reloads, even when other bindings are added or
+ * removed. Collisions are resolved by using the next free id.
+ *
+ */
+void assign_binding_ids(void);
+
 /**
  * Reorders bindings by event_state_mask descendingly so that get_binding()
  * correctly matches more specific bindings before more generic bindings. Take
@@ -114,3 +134,19 @@ bool load_keymap(void);
  * The list is terminated by a 0.
  */
 int *bindings_get_buttons_to_grab(void);
+
+/**
+ * Returns true if both lists of buttons (as returned by
+ * bindings_get_buttons_to_grab()) are the same.
+ *
+ */
+bool bindings_buttons_equal(const int *a, const int *b);
+
+/**
+ * Returns the list of buttons to grab (see bindings_get_buttons_to_grab()) if
+ * it is the same in every mode, NULL otherwise. Since windows get the buttons
+ * of the mode which was active when they were managed, this tells whether all
+ * windows have the same buttons grabbed.
+ *
+ */
+int *bindings_get_buttons_to_grab_in_all_modes(void);
@@ -349,6 +349,18 @@ void cmd_shmlog(I3_CMD, const char *argument);
  */
 void cmd_debuglog(I3_CMD, const char *argument);
 
+/**
+ * Implementation of 'debuglog filter <file>[,<file>…]|off'
+ *
+ */
+void cmd_debuglog_filter(I3_CMD, const char *files);
+
+/**
+ * Implementation of 'batch begin|commit'.
+ *
+ */
+void cmd_batch(I3_CMD, const char *action);
+
 /**
  * Implementation of 'title_window_icon <yes|no|toggle>' and 'title_window_icon <padding|toggle> <px>'
  *
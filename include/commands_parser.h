@@ -40,6 +40,23 @@ struct CommandResultIR {
 
 typedef struct CommandResult CommandResult;
 
+/**
+ * A command which was parsed once and can be executed repeatedly, see
+ * command_compile().
+ */
+typedef struct ParsedCommand ParsedCommand;
+
+/**
+ * The time spent on a single command of a RUN_COMMAND message, reported to
+ * clients which enabled it with SET_COMMAND_TIMING.
+ */
+struct command_timing {
+    /* Microseconds spent parsing the command */
+    uint64_t parse_us;
+    /* Microseconds spent executing the command, including its criteria */
+    uint64_t exec_us;
+};
+
 /**
  * A struct that contains useful information about the result of a command as a
  * whole (e.g. a compound command like "floating enable, border none").
@@ -51,6 +68,12 @@ struct CommandResult {
     /* the error_message is currently only set for parse errors */
     char *error_message;
     bool needs_tree_render;
+
+    /* For IPC clients which enabled command timing: the time spent on each
+     * command which added a result to the reply, in the order of the
+     * results. */
+    struct command_timing *timings;
+    int num_timings;
 };
 
 /**
@@ -74,3 +97,32 @@ CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client
  * Frees a CommandResult
  */
 void command_result_free(CommandResult *result);
+
+/**
+ * Parses the given command without executing it. Returns NULL if the command
+ * contains a parse error, otherwise the calls it consists of (with their
+ * arguments), which can be executed any number of times with
+ * run_parsed_command().
+ *
+ */
+ParsedCommand *command_compile(const char *input);
+
+/**
+ * Executes a command compiled with command_compile(). Behaves like
+ * parse_command() on the original input, without parsing it again.
+ *
+ * Free the returned CommandResult with command_result_free().
+ */
+CommandResult *run_parsed_command(ParsedCommand *parsed, yajl_gen gen, ipc_client *client);
+
+/**
+ * Returns a new reference to the given compiled command, which may be NULL.
+ *
+ */
+ParsedCommand *parsed_command_ref(ParsedCommand *parsed);
+
+/**
+ * Releases a reference to a compiled command. parsed may be NULL.
+ *
+ */
+void parsed_command_unref(ParsedCommand *parsed);
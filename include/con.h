@@ -32,6 +32,40 @@ Con *con_new(Con *parent, i3Window *window);
  */
 void con_free(Con *con);
 
+/**
+ * Adds the container to the window ID index. Needs to be called whenever
+ * con->window is set to a new window.
+ *
+ */
+void con_index_window(Con *con);
+
+/**
+ * Removes the container from the window ID index. Needs to be called before
+ * con->window is cleared or handed to another container.
+ *
+ */
+void con_unindex_window(Con *con);
+
+/**
+ * Updates the window property index after the class, instance, role or type
+ * of the given window changed.
+ *
+ */
+void con_reindex_window_properties(i3Window *window);
+
+/**
+ * Adds the container to the frame ID index. Called from x_con_init() once the
+ * ID of the frame window was allocated.
+ *
+ */
+void con_index_frame(Con *con);
+
+/**
+ * Removes the container from the frame ID index.
+ *
+ */
+void con_unindex_frame(Con *con);
+
 /**
  * Sets input focus to the given container. Will be updated in X11 in the next
  * run of x_push_changes().
@@ -115,6 +149,21 @@ Con *con_get_output(Con *con);
  */
 Con *con_get_workspace(Con *con);
 
+/**
+ * Notes that parent pointers, focus lists or the focused container changed,
+ * which invalidates the results cached by con_get_workspace(),
+ * con_get_output(), con_descend_focused() and con_descend_tiling_focused().
+ *
+ */
+void con_invalidate_lookups(void);
+
+/**
+ * Returns the current lookup generation, so other caches of the tree structure
+ * can tell whether it changed.
+ *
+ */
+uint64_t con_lookup_generation(void);
+
 /**
  * Searches parents of the given 'con' until it reaches one with the specified
  * 'orientation'. Aborts when it comes across a floating_con.
@@ -182,18 +231,84 @@ Con *con_by_window_id(xcb_window_t window);
 
 /**
  * Returns the container with the given container ID or NULL if no such
- * container exists.
+ * container exists. The ID is the address of the container, which is looked
+ * up in the registry maintained by con_new_skeleton() and con_free().
  *
  */
 Con *con_by_con_id(long target);
 
 /**
- * Returns true if the given container (still) exists.
- * This can be used, e.g., to make sure a container hasn't been closed in the meantime.
+ * Returns true if a live container exists at the given address. This is a
+ * single hash lookup in the registry of live containers (like
+ * con_by_con_id()), so it is cheap enough for hot paths.
+ *
+ * It does not tell whether the container is still the one the pointer was
+ * taken from: containers are allocated from a pool, so the address of a
+ * closed container can be reused by a new one, and this then returns true for
+ * the stale pointer. Compare creation_order as well if that matters.
  *
  */
 bool con_exists(Con *con);
 
+/**
+ * Returns the containers whose window has the given class, instance, role or
+ * type (formatted as a decimal atom) and stores their number in num. The
+ * array is owned by the index and only valid until the next change to the
+ * tree. The containers are in no particular order.
+ *
+ */
+Con **con_by_window_property(window_property_t property, const char *value, size_t *num);
+
+/**
+ * Sets con->sticky and updates the list of sticky containers.
+ *
+ */
+void con_set_sticky(Con *con, bool sticky);
+
+/**
+ * Returns the containers with con->sticky set and stores their number in num.
+ * The array is only valid until the next change to the tree. The containers
+ * are in no particular order.
+ *
+ */
+Con **con_sticky_cons(size_t *num);
+
+/**
+ * Sets (a copy of) the sticky group of the container, which may be NULL, and
+ * updates the sticky group index.
+ *
+ */
+void con_set_sticky_group(Con *con, const char *sticky_group);
+
+/**
+ * Returns whether any container has a sticky group.
+ *
+ */
+bool con_has_sticky_groups(void);
+
+/**
+ * Returns the containers in the given sticky group and stores their number
+ * in num. The array is only valid until the next change to the tree. The
+ * containers are in no particular order.
+ *
+ */
+Con **con_by_sticky_group(const char *sticky_group, size_t *num);
+
+/**
+ * Sets the scratchpad state of the container and updates the list of
+ * scratchpad containers.
+ *
+ */
+void con_set_scratchpad_state(Con *con, scratchpad_state_t state);
+
+/**
+ * Returns the containers whose scratchpad state is not SCRATCHPAD_NONE and
+ * stores their number in num. The array is only valid until the next change
+ * to the tree. The containers are in no particular order.
+ *
+ */
+Con **con_scratchpad_cons(size_t *num);
+
 /**
  * Returns the container with the given frame ID or NULL if no such container
  * exists.
@@ -222,6 +337,14 @@ bool con_find_transient_for_window(Con *start, xcb_window_t target);
  */
 bool con_has_mark(Con *con, const char *mark);
 
+/**
+ * Returns true if one of the container’s marks matches the given regular
+ * expression. Patterns which can only match one mark name exactly (like
+ * ^name$) are answered from the mark index.
+ *
+ */
+bool con_has_mark_matching(Con *con, struct regex *regex);
+
 /**
  * Toggles the mark on a container.
  * If the container already has this mark, the mark is removed.
@@ -245,6 +368,27 @@ void con_mark(Con *con, const char *mark, mark_mode_t mode);
  */
 void con_unmark(Con *con, const char *name);
 
+/**
+ * Adds the given match to the swallow criteria of the container, either in
+ * front of or after the existing ones, and indexes it for con_for_window().
+ *
+ */
+void con_add_swallow(Con *con, Match *match, bool head);
+
+/**
+ * (Re-)indexes a match of the container's swallow criteria. This has to be
+ * called whenever the criteria of such a match change.
+ *
+ */
+void con_index_swallow(Con *con, Match *match);
+
+/**
+ * Removes the given match from the container's swallow criteria and from the
+ * index. The match is not freed.
+ *
+ */
+void con_remove_swallow(Con *con, Match *match);
+
 /**
  * Returns the first container below 'con' which wants to swallow this window
  * TODO: priority
@@ -377,6 +521,22 @@ bool con_move_to_output_name(Con *con, const char *name, bool fix_coordinates);
  */
 bool con_move_to_mark(Con *con, const char *mark);
 
+/**
+ * Starts moving several containers at once (e.g. all windows matching the
+ * criteria of a command). Until con_end_bulk_move() is called, the
+ * percentages of the containers the moved ones are attached to and
+ * _NET_WM_DESKTOP are not updated after every move.
+ *
+ */
+void con_begin_bulk_move(void);
+
+/**
+ * Fixes the percentages of all containers which got children since
+ * con_begin_bulk_move() and updates _NET_WM_DESKTOP once.
+ *
+ */
+void con_end_bulk_move(void);
+
 /**
  * Returns the orientation of the given container (for stacked containers,
  * vertical orientation is used regardless of the actual orientation of the
@@ -433,6 +593,22 @@ Rect con_border_style_rect(Con *con);
  */
 adjacent_t con_adjacent_borders(Con *con);
 
+/**
+ * Starts a layout pass: rendering the tree or pushing it to X11. The tree does
+ * not change during a pass, so the number of visible windows on each
+ * workspace and the adjacent screen edges of each container, which every
+ * con_border_style_rect() needs, are only computed once per pass instead of
+ * once per container. Passes can be nested.
+ *
+ */
+void con_begin_layout_pass(void);
+
+/**
+ * Ends the layout pass started with con_begin_layout_pass().
+ *
+ */
+void con_end_layout_pass(void);
+
 /**
  * Use this function to get a container’s border style. This is important
  * because when inside a stack, the border style is always BS_NORMAL.
@@ -518,18 +694,53 @@ void con_update_parents_urgency(Con *con);
  */
 void con_set_urgency(Con *con, bool urgent);
 
+/**
+ * Sets con->urgent and updates the number of urgent descendants of all
+ * parents. Only containers with a window count as urgent on their own, the
+ * urgency of split containers is inherited from their children. Unlike
+ * con_set_urgency(), this neither updates the urgency flags of the parents
+ * nor sends any events.
+ *
+ */
+void con_set_urgent_flag(Con *con, bool urgent);
+
 /**
  * Create a string representing the subtree under con.
  *
  */
 char *con_get_tree_representation(Con *con);
 
+/**
+ * Invalidates the cached tree representation of the container and all of its
+ * parents. Has to be called whenever children are added, removed or
+ * reordered, the layout changes or a leaf gets a different window.
+ *
+ */
+void con_invalidate_tree_representation(Con *con);
+
 /**
  * force parent split containers to be redrawn
  *
  */
 void con_force_split_parents_redraw(Con *con);
 
+/**
+ * Marks the given container (and therefore all of its parents) as dirty, so
+ * that the next tree_render() lays it out again instead of reusing the result
+ * of the previous render. Needs to be called whenever something that
+ * render_con() depends on changes (children, layout, percentages, borders,
+ * fullscreen mode).
+ *
+ */
+void con_set_dirty(Con *con);
+
+/**
+ * Marks every container as dirty, e.g. after the configuration (and thus the
+ * font and default borders) changed.
+ *
+ */
+void con_set_all_dirty(void);
+
 /**
  * Returns the window title considering the current title format.
  *
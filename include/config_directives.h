@@ -59,12 +59,18 @@ CFGFUN(force_display_urgency_hint, const long duration_ms);
 CFGFUN(focus_on_window_activation, const char *mode);
 CFGFUN(title_align, const char *alignment);
 CFGFUN(show_marks, const char *value);
+CFGFUN(live_resize, const char *value);
+CFGFUN(tab_min_width, const long width);
 CFGFUN(hide_edge_borders, const char *borders);
 CFGFUN(assign_output, const char *output);
 CFGFUN(assign, const char *workspace, bool is_number);
 CFGFUN(no_focus);
 CFGFUN(ipc_socket, const char *path);
 CFGFUN(ipc_kill_timeout, const long timeout_ms);
+CFGFUN(ipc_queue_limit, const long limit);
+CFGFUN(ipc_coalesce_events, const char *event, const long interval_ms);
+CFGFUN(tree_shm_size, const long size);
+CFGFUN(drag_refresh_rate, const long rate);
 CFGFUN(restart_state, const char *path);
 CFGFUN(popup_during_fullscreen, const char *value);
 CFGFUN(color, const char *colorclass, const char *border, const char *background, const char *text, const char *indicator, const char *child_border);
@@ -99,6 +105,7 @@ CFGFUN(bar_status_command, const char *command);
 CFGFUN(bar_binding_mode_indicator, const char *value);
 CFGFUN(bar_workspace_buttons, const char *value);
 CFGFUN(bar_workspace_min_width, const long width);
+CFGFUN(bar_status_update_interval, const long interval);
 CFGFUN(bar_strip_workspace_numbers, const char *value);
 CFGFUN(bar_strip_workspace_name, const char *value);
 CFGFUN(bar_start);
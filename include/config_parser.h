@@ -89,6 +89,23 @@ void start_config_error_nagbar(const char *configpath, bool has_errors);
  */
 void free_variables(struct parser_ctx *ctx);
 
+/**
+ * Called after the main config file and all included files are parsed. The
+ * resource database is kept if it was parsed from the RESOURCE_MANAGER
+ * property. Otherwise, it was loaded from files which may change until the
+ * next reload, so it is freed.
+ *
+ */
+void free_resource_database(void);
+
+/**
+ * Notes that the RESOURCE_MANAGER property of the root window changed, so
+ * that the resource database is loaded again when the configuration is
+ * reloaded.
+ *
+ */
+void resource_database_changed(void);
+
 typedef enum {
     PARSE_FILE_FAILED = -1,
     PARSE_FILE_SUCCESS = 0,
@@ -124,6 +124,10 @@ struct Config {
      * It is not planned to add any different focus models. */
     bool disable_focus_follows_mouse;
 
+    /** Whether focus follows XInput 2 raw pointer motion instead of
+     * EnterNotify events (focus_follows_mouse raw), see raw_pointer.c. */
+    bool focus_follows_mouse_raw;
+
     /** By default, when switching focus to a window on a different output
      * (e.g. focusing a window on workspace 3 on output VGA-1, coming from
      * workspace 2 on LVDS-1), the mouse cursor is warped to the center of
@@ -194,6 +198,21 @@ struct Config {
      * flag can be delayed using an urgency timer. */
     float workspace_urgency_timer;
 
+    /** Intervals (in seconds) within which repeated window::title and
+     * window::mark events for the same container are merged into one, see
+     * ipc_send_window_event(). 0 sends every event immediately. */
+    float ipc_coalesce_title;
+    float ipc_coalesce_mark;
+
+    /** Rate (in Hz) at which the geometry is updated while dragging or
+     * resizing a container with the mouse. 0 uses the highest refresh rate
+     * of all outputs, see drag_pointer(). */
+    long drag_refresh_rate;
+
+    /** Size (in bytes) of the shared memory segment in which the tree is
+     * published, see tree_shm.c. 0 disables it. */
+    long tree_shm_size;
+
     /** Behavior when a window sends a NET_ACTIVE_WINDOW message. */
     enum {
         /* Focus if the target workspace is visible, set urgency hint otherwise. */
@@ -210,6 +229,16 @@ struct Config {
      * decoration. Marks starting with a "_" will be ignored either way. */
     bool show_marks;
 
+    /** Minimum width of a tab in pixels. When the tabs of a tabbed container
+     * would be narrower, only as many tabs as fit (always including the
+     * focused one) are shown. 0 shows all tabs. */
+    int tab_min_width;
+
+    /** Whether resizing tiling containers with the mouse resizes them while
+     * dragging instead of only moving a resize bar until the button is
+     * released. */
+    bool live_resize;
+
     /** Title alignment options. */
     enum {
         ALIGN_LEFT,
@@ -337,6 +366,11 @@ struct Barconfig {
     /** The minimal width for workspace buttons. */
     int workspace_min_width;
 
+    /** The minimal time between two redraws of the statusline in
+     * milliseconds. Status lines received in between are coalesced. 0 means
+     * that every status line is drawn. */
+    int status_update_interval;
+
     /** Strip workspace numbers? Configuration option is
      * 'strip_workspace_numbers yes'. */
     bool strip_workspace_numbers;
@@ -430,7 +464,18 @@ bool load_configuration(const char *override_configfile, config_load_t load_type
 
 /**
  * Ungrabs all keys, to be called before re-grabbing the keys because of a
- * mapping_notify event or a configuration file reload
+ * mapping_notify event
  *
  */
 void ungrab_all_keys(xcb_connection_t *conn);
+
+/**
+ * Loads the font with the given pattern for the configuration. When
+ * reloading, the font of the previous configuration is reused if the pattern
+ * did not change.
+ *
+ * The font is loaded asynchronously, load_configuration() (or main() on
+ * startup, see finish_font_loading()) waits for it.
+ *
+ */
+i3Font load_config_font(const char *pattern);
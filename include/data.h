@@ -100,6 +100,21 @@ typedef enum {
     L_SPLITH = 6
 } layout_t;
 
+/**
+ * Scratchpad states. See Con::scratchpad_state.
+ */
+typedef enum {
+    /* Not a scratchpad window. */
+    SCRATCHPAD_NONE = 0,
+
+    /* Just moved to scratchpad, not resized by the user yet.
+     * Window will be auto-centered and sized appropriately. */
+    SCRATCHPAD_FRESH = 1,
+
+    /* The user changed position/size of the scratchpad window. */
+    SCRATCHPAD_CHANGED = 2
+} scratchpad_state_t;
+
 /**
  * Binding input types. See Binding::input_type.
  */
@@ -199,6 +214,8 @@ struct deco_render_params {
     color_t background;
     layout_t parent_layout;
     bool con_is_leaf;
+    int tabs_hidden_before;
+    int tabs_hidden_after;
 };
 
 /**
@@ -213,11 +230,9 @@ struct Workspace_Assignment {
 };
 
 struct Ignore_Event {
-    int sequence;
+    /* The sequence number as sent by the X server (16 bits) */
+    uint16_t sequence;
     int response_type;
-    time_t added;
-
-    SLIST_ENTRY(Ignore_Event) ignore_events;
 };
 
 /**
@@ -232,25 +247,51 @@ struct Startup_Sequence {
     char *workspace;
     /** libstartup-notification context for this launch */
     SnLauncherContext *context;
+    /** PID of the started process as reported by the launcher, 0 if unknown */
+    pid_t pid;
+    /** time at which the sequence is completed unless the application did so
+     * before */
+    time_t timeout_at;
+    /** whether the sequence is still waiting for timeout_at */
+    bool timeout_pending;
     /** time at which this sequence should be deleted (after it was marked as
      * completed) */
     time_t delete_at;
 
     TAILQ_ENTRY(Startup_Sequence) sequences;
+    /** in the list of pending timeouts or of pending deletions, see startup.c */
+    TAILQ_ENTRY(Startup_Sequence) expiry;
 };
 
+#define REGEX_RESULT_CACHE_SIZE 8
+
 /**
  * Regular expression wrapper. It contains the pattern itself as a string (like
- * ^foo[0-9]$) as well as a pointer to the compiled PCRE expression and the
- * pcre_extra data returned by pcre_study().
+ * ^foo[0-9]$) as well as a pointer to the compiled (and, if possible,
+ * JIT-compiled) PCRE expression.
  *
  * This makes it easier to have a useful logfile, including the matching or
  * non-matching pattern.
  *
  */
 struct regex {
+    /** Compiled regular expressions are shared between all users of the same
+     * pattern, see regex_new(). */
+    int refcount;
     char *pattern;
     pcre2_code *regex;
+    /** If the pattern contains no metacharacters apart from a leading "^"
+     * and a trailing "$", the pattern without those anchors. Such patterns
+     * are matched using string comparisons instead of PCRE. */
+    char *literal;
+    bool anchored_start;
+    bool anchored_end;
+    /** Results of matching interned strings (see regex_matches_interned()),
+     * indexed by intern_id() modulo REGEX_RESULT_CACHE_SIZE. */
+    struct regex_result {
+        uint64_t id;
+        bool matches;
+    } result_cache[REGEX_RESULT_CACHE_SIZE];
 };
 
 /**
@@ -275,6 +316,11 @@ struct Binding_Keycode {
  *
  */
 struct Binding {
+    /** Identifies the binding in IPC replies and compact binding events. It
+     * is derived from the mode and the input (not the command), see
+     * assign_binding_ids(). */
+    uint32_t id;
+
     /* The type of input this binding is for. (Mouse bindings are not yet
      * implemented. All bindings are currently assumed to be keyboard bindings.) */
     input_type_t input_type;
@@ -327,6 +373,11 @@ struct Binding {
     /** Command, like in command mode */
     char *command;
 
+    /** The command, parsed when the binding is configured so that pressing
+     * the key does not need to parse it again. NULL if the command does not
+     * parse (the error is then reported when the binding is used). */
+    struct ParsedCommand *parsed_command;
+
     TAILQ_ENTRY(Binding) bindings;
 };
 
@@ -387,6 +438,33 @@ struct xoutput {
     TAILQ_ENTRY(xoutput) outputs;
 };
 
+/**
+ * A window icon (from _NET_WM_ICON), shared between all windows which set the
+ * same icon data, see window_update_icon().
+ *
+ */
+struct window_icon {
+    int refcount;
+    uint64_t hash;
+    /** The icon data in the format of _NET_WM_ICON (ARGB, not premultiplied),
+     * kept to scale the icon again when the decoration height changes. */
+    uint32_t *pixels;
+    uint32_t width;
+    uint32_t height;
+    /** The icon converted for Cairo and scaled to fit into a square of
+     * size x size pixels. NULL while a large icon is still being converted
+     * (see window_icon_scale()). */
+    cairo_surface_t *surface;
+    int size;
+    /** The surface uploaded into the X server (see draw_util_image_upload()),
+     * created when the icon is drawn first. */
+    surface_t pixmap;
+    /** Set when a conversion finished, until the title bars are redrawn. */
+    bool converted;
+
+    TAILQ_ENTRY(window_icon) icons;
+};
+
 /**
  * A 'Window' is a type which contains an xcb_window_t and all the related
  * information (hints like _NET_WM_NAME for that window).
@@ -400,6 +478,10 @@ struct Window {
     xcb_window_t leader;
     xcb_window_t transient_for;
 
+    /** The _NET_WM_PID of this window, 0 if it is not set. Used to find the
+     * startup sequence of windows without _NET_STARTUP_ID. */
+    pid_t pid;
+
     /** Pointers to the Assignments which were already ran for this Window
      * (assignments run only once) */
     uint32_t nr_assignments;
@@ -428,10 +510,17 @@ struct Window {
     /** Whether the application needs to receive WM_TAKE_FOCUS */
     bool needs_take_focus;
 
+    /** Whether the application supports WM_DELETE_WINDOW (both are taken
+     * from WM_PROTOCOLS) */
+    bool supports_delete_window;
+
     /** Whether this window accepts focus. We store this inverted so that the
      * default will be 'accepts focus'. */
     bool doesnt_accept_focus;
 
+    /** Whether i3 added _NET_WM_STATE_FOCUSED to its _NET_WM_STATE. */
+    bool net_wm_state_focused;
+
     /** The _NET_WM_WINDOW_TYPE for this window. */
     xcb_atom_t window_type;
 
@@ -473,8 +562,8 @@ struct Window {
     double min_aspect_ratio;
     double max_aspect_ratio;
 
-    /** Window icon, as Cairo surface */
-    cairo_surface_t *icon;
+    /** Window icon, shared with other windows using the same icon */
+    struct window_icon *icon;
 
     /** The window has a nonrectangular shape. */
     bool shaped;
@@ -489,11 +578,65 @@ struct Window {
     bool swallowed;
 };
 
+/**
+ * The criteria a Match can contain. A Match only stores the criteria which
+ * were specified, sorted by type, so that match_matches_window() checks them
+ * cheapest first: plain comparisons, then regular expressions, then the
+ * criteria which need to look up the container (or all containers).
+ *
+ */
+typedef enum {
+    CRIT_ID = 0,
+    CRIT_CON_ID,
+    CRIT_WINDOW_TYPE,
+    CRIT_CLASS,
+    CRIT_INSTANCE,
+    CRIT_WINDOW_ROLE,
+    CRIT_MACHINE,
+    CRIT_TITLE,
+    CRIT_WINDOW_MODE,
+    CRIT_WORKSPACE,
+    CRIT_MARK,
+    CRIT_URGENT,
+} criterion_t;
+
+typedef enum {
+    U_LATEST = 0,
+    U_OLDEST = 1
+} match_urgent_t;
+
+typedef enum {
+    WM_TILING_AUTO = 1,
+    WM_TILING_USER,
+    WM_TILING,
+    WM_FLOATING_AUTO,
+    WM_FLOATING_USER,
+    WM_FLOATING
+} match_window_mode_t;
+
+/**
+ * A criterion of a Match. Which member of the union is used depends on the
+ * type: regex for the string criteria (class, instance, window_role, machine,
+ * title, workspace, mark), the others are named after their criterion.
+ *
+ */
+struct match_criterion {
+    criterion_t type;
+    union {
+        struct regex *regex;
+        xcb_window_t id;
+        Con *con_id;
+        xcb_atom_t window_type;
+        match_window_mode_t window_mode;
+        match_urgent_t urgent;
+    };
+};
+
 /**
  * A "match" is a data structure which acts like a mask or expression to match
  * certain windows or not. For example, when using commands, you can specify a
- * command like this: [title="*Firefox*"] kill. The title member of the match
- * data structure will then be filled and i3 will check each window using
+ * command like this: [title="*Firefox*"] kill. A criterion of type CRIT_TITLE
+ * will then be added to the match and i3 will check each window using
  * match_matches_window() to find the windows affected by this command.
  *
  */
@@ -501,20 +644,11 @@ struct Match {
     /* Set if a criterion was specified incorrectly. */
     char *error;
 
-    struct regex *title;
-    struct regex *application;
-    struct regex *class;
-    struct regex *instance;
-    struct regex *mark;
-    struct regex *window_role;
-    struct regex *workspace;
-    struct regex *machine;
-    xcb_atom_t window_type;
-    enum {
-        U_DONTCHECK = -1,
-        U_LATEST = 0,
-        U_OLDEST = 1
-    } urgent;
+    /* The criteria which were specified, sorted by type. See match_get() and
+     * match_set(). */
+    struct match_criterion *criteria;
+    int num_criteria;
+
     enum {
         M_DONTCHECK = -1,
         M_NODOCK = 0,
@@ -522,15 +656,6 @@ struct Match {
         M_DOCK_TOP = 2,
         M_DOCK_BOTTOM = 3
     } dock;
-    xcb_window_t id;
-    enum { WM_ANY = 0,
-           WM_TILING_AUTO,
-           WM_TILING_USER,
-           WM_TILING,
-           WM_FLOATING_AUTO,
-           WM_FLOATING_USER,
-           WM_FLOATING } window_mode;
-    Con *con_id;
     bool match_all_windows;
 
     /* Where the window looking for a match should be inserted:
@@ -548,12 +673,39 @@ struct Match {
 
     TAILQ_ENTRY(Match) matches;
 
+    /* For swallow criteria: the container whose swallow_head contains this
+     * match and the con_for_window() index bucket it is in (NULL while it is
+     * not indexed). */
+    Con *swallow_con;
+    struct swallow_bucket *swallow_bucket;
+    TAILQ_ENTRY(Match) swallow_entries;
+
     /* Whether this match was generated when restarting i3 inplace.
      * Leads to not setting focus when managing a new window, because the old
      * focus stack should be restored. */
     bool restart_mode;
 };
 
+/**
+ * The window properties which criteria can depend on, see
+ * match_dependencies(). When one of them changes, only the assignments which
+ * depend on it need to be checked again.
+ *
+ */
+typedef enum {
+    WP_TITLE = (1 << 0),
+    /* WM_CLASS, that is class and instance */
+    WP_CLASS = (1 << 1),
+    WP_ROLE = (1 << 2),
+    WP_WINDOW_TYPE = (1 << 3),
+    WP_MACHINE = (1 << 4),
+    WP_FLOATING = (1 << 5),
+    /* Everything else which can change without a property change (the
+     * workspace, marks, urgency, the focused window for __focused__). */
+    WP_OTHER = (1 << 6),
+    WP_ALL = (1 << 7) - 1
+} match_dependency_t;
+
 /**
  * An Assignment makes specific windows go to a specific workspace/output or
  * run a command for that window. With this mechanism, the user can -- for
@@ -593,6 +745,13 @@ struct Assignment {
         char *output;
     } dest;
 
+    /** Position in the assignments list, set by compile_assignments(). */
+    uint32_t position;
+
+    /** The window properties (WP_*) the criteria depend on, set by
+     * compile_assignments(). */
+    uint32_t depends_on;
+
     TAILQ_ENTRY(Assignment) assignments;
 };
 
@@ -607,69 +766,34 @@ struct mark_t {
     TAILQ_ENTRY(mark_t) marks;
 };
 
+/** Window properties for which containers are indexed, see
+ * con_by_window_property(). */
+typedef enum {
+    WINDOW_PROPERTY_CLASS = 0,
+    WINDOW_PROPERTY_INSTANCE = 1,
+    WINDOW_PROPERTY_ROLE = 2,
+    WINDOW_PROPERTY_TYPE = 3,
+    WINDOW_PROPERTY_MAX = 4
+} window_property_t;
+
 /**
- * A 'Con' represents everything from the X11 root window down to a single X11 window.
+ * The fields of a Con which are rarely used, or only used when drawing its
+ * decoration. They are allocated separately (see Con.cold), so that the
+ * containers themselves stay small and walks over the tree touch fewer cache
+ * lines.
  *
  */
-struct Con {
-    bool mapped;
-
-    /* Should this container be marked urgent? This gets set when the window
-     * inside this container (if any) sets the urgency hint, for example. */
-    bool urgent;
-
-    /** This counter contains the number of UnmapNotify events for this
-     * container (or, more precisely, for its ->frame) which should be ignored.
-     * UnmapNotify events need to be ignored when they are caused by i3 itself,
-     * for example when reparenting or when unmapping the window on a workspace
-     * change. */
-    uint8_t ignore_unmap;
-
-    /* The surface used for the frame window. */
-    surface_t frame;
-    surface_t frame_buffer;
-    bool pixmap_recreated;
-
-    enum {
-        CT_ROOT = 0,
-        CT_OUTPUT = 1,
-        CT_CON = 2,
-        CT_FLOATING_CON = 3,
-        CT_WORKSPACE = 4,
-        CT_DOCKAREA = 5
-    } type;
-
-    /** the workspace number, if this Con is of type CT_WORKSPACE and the
-     * workspace is not a named workspace (for named workspaces, num == -1) */
-    int num;
-
-    struct Con *parent;
-
-    /* The position and size for this con. These coordinates are absolute. Note
-     * that the rect of a container does not include the decoration. */
-    struct Rect rect;
-    /* The position and size of the actual client window. These coordinates are
-     * relative to the container's rect. */
-    struct Rect window_rect;
-    /* The position and size of the container's decoration. These coordinates
-     * are relative to the container's parent's rect. */
-    struct Rect deco_rect;
-    /** the geometry this window requested when getting mapped */
-    struct Rect geometry;
-
-    char *name;
-
+struct con_cold {
     /** The format with which the window's name should be displayed. */
     char *title_format;
-
-    /** Whether the window icon should be displayed, and with what padding. -1
-     * means display no window icon (default behavior), 0 means display without
-     * any padding, 1 means display with 1 pixel of padding and so on. */
-    int window_icon_padding;
+    /** title_format compiled into segments and the last title built from it,
+     * see con_parse_title_format(). */
+    struct title_format_cache *title_format_cache;
 
     /* a sticky-group is an identifier which bundles several containers to a
      * group. The contents are shared between all of them, that is they are
-     * displayed on whichever of the containers is currently visible */
+     * displayed on whichever of the containers is currently visible. Use
+     * con_set_sticky_group() to change this. */
     char *sticky_group;
 
     /* user-definable marks to jump to this container later */
@@ -677,34 +801,29 @@ struct Con {
     /* cached to decide whether a redraw is needed */
     bool mark_changed;
 
-    double percent;
-
-    /* the x11 border pixel attribute */
-    int border_width;
-    int current_border_width;
-
-    struct Window *window;
-
-    /* timer used for disabling urgency */
-    struct ev_timer *urgency_timer;
+    TAILQ_HEAD(swallow_head, Match) swallow_head;
 
     /** Cache for the decoration rendering */
     struct deco_render_params *deco_render_params;
+};
 
-    /* Only workspace-containers can have floating clients */
-    TAILQ_HEAD(floating_head, Con) floating_head;
-
-    TAILQ_HEAD(nodes_head, Con) nodes_head;
-    TAILQ_HEAD(focus_head, Con) focus_head;
-
-    TAILQ_HEAD(swallow_head, Match) swallow_head;
-
-    fullscreen_mode_t fullscreen_mode;
-
-    /* Whether this window should stick to the glass. This corresponds to
-     * the _NET_WM_STATE_STICKY atom and will only be respected if the
-     * window is floating. */
-    bool sticky;
+/**
+ * A 'Con' represents everything from the X11 root window down to a single X11 window.
+ *
+ */
+struct Con {
+    /* The fields up to (and including) name are the ones read while walking
+     * the tree (rendering, focus and lookups). They are kept together at the
+     * start of the struct so that walks touch as few cache lines as
+     * possible. */
+    enum {
+        CT_ROOT = 0,
+        CT_OUTPUT = 1,
+        CT_CON = 2,
+        CT_FLOATING_CON = 3,
+        CT_WORKSPACE = 4,
+        CT_DOCKAREA = 5
+    } type;
 
     /* layout is the layout of this container: one of split[v|h], stacked or
      * tabbed. Special containers in the tree (above workspaces) have special
@@ -721,7 +840,6 @@ struct Con {
      * layout in workspace_layout and creates a new split container with that
      * layout whenever a new container is attached to the workspace. */
     layout_t layout, last_split_layout, workspace_layout;
-    border_style_t border_style;
     /** floating? (= not in tiling layout) This cannot be simply a bool
      * because we want to keep track of whether the status was set by the
      * application (by setting _NET_WM_WINDOW_TYPE appropriately) or by the
@@ -734,26 +852,175 @@ struct Con {
         FLOATING_AUTO_ON = 2,
         FLOATING_USER_ON = 3
     } floating;
+    fullscreen_mode_t fullscreen_mode;
+    border_style_t border_style;
+
+    bool mapped;
+
+    /** Set by con_set_dirty() when this container or one of its descendants
+     * changed in a way which requires render_con() to lay out its children
+     * again. Cleared by render_con(). */
+    bool dirty;
+
+    /** Set while this container is on the list of containers which
+     * tree_flatten_candidates() checks, see tree_note_flatten_candidate(). */
+    bool flatten_candidate;
+
+    /* Should this container be marked urgent? This gets set when the window
+     * inside this container (if any) sets the urgency hint, for example. */
+    bool urgent;
+
+    /* Whether this window should stick to the glass. This corresponds to
+     * the _NET_WM_STATE_STICKY atom and will only be respected if the
+     * window is floating. Use con_set_sticky() to change this. */
+    bool sticky;
+
+    struct Con *parent;
+    struct Window *window;
+
+    /* The position and size for this con. These coordinates are absolute. Note
+     * that the rect of a container does not include the decoration. */
+    struct Rect rect;
+    /* The position and size of the actual client window. These coordinates are
+     * relative to the container's rect. */
+    struct Rect window_rect;
+    /* The position and size of the container's decoration. These coordinates
+     * are relative to the container's parent's rect. */
+    struct Rect deco_rect;
+
+    double percent;
+
+    /** The rect this container had when render_con() last laid out its
+     * children. */
+    Rect rendered_rect;
+
+    /** The children of a stacked or tabbed container which have a title bar,
+     * in the order of their deco_rect (left to right in tabbed, top to bottom
+     * in stacked containers), so that clicks can be routed using a binary
+     * search. Computed by render_con() and freed when a child is attached or
+     * detached. */
+    Con **deco_hits;
+    int num_deco_hits;
+
+    /** Cached results of con_get_workspace() / con_get_output() and of
+     * con_descend_focused() / con_descend_tiling_focused(). They are valid
+     * while their generation matches the one of con_invalidate_lookups(),
+     * which is bumped whenever parents, focus lists or the focused container
+     * change. */
+    Con *cached_workspace;
+    Con *cached_output;
+    uint64_t ancestors_generation;
+    Con *cached_focused;
+    Con *cached_tiling_focused;
+    uint64_t focus_generation;
+
+    /** The number of visible tiling windows (of a workspace) and the screen
+     * edges the container is adjacent to, computed once per layout pass (see
+     * con_begin_layout_pass()) for the border computations. */
+    int visible_children;
+    uint64_t visible_children_pass;
+    adjacent_t adjacent;
+    Rect adjacent_rect;
+    uint64_t adjacent_pass;
+
+    /* Only workspace-containers can have floating clients */
+    TAILQ_HEAD(floating_head, Con) floating_head;
+
+    TAILQ_HEAD(nodes_head, Con) nodes_head;
+    TAILQ_HEAD(focus_head, Con) focus_head;
 
     TAILQ_ENTRY(Con) nodes;
     TAILQ_ENTRY(Con) focused;
     TAILQ_ENTRY(Con) all_cons;
     TAILQ_ENTRY(Con) floating_windows;
 
-    /** callbacks */
-    void (*on_remove_child)(Con *);
+    /** the workspace number, if this Con is of type CT_WORKSPACE and the
+     * workspace is not a named workspace (for named workspaces, num == -1) */
+    int num;
 
-    enum {
-        /* Not a scratchpad window. */
-        SCRATCHPAD_NONE = 0,
+    char *name;
+
+    /** For split containers: the child sizes computed by the last render,
+     * together with the size and child percentages they were computed for.
+     * Reused as long as those do not change. */
+    int *split_sizes;
+    double *split_sizes_percents;
+    int split_sizes_children;
+    uint32_t split_sizes_total;
+
+    /** For tabbed containers whose tabs do not all fit (see tab_min_width):
+     * the index of the first tab shown and the number of tabs shown. */
+    int tabs_first;
+    int tabs_shown;
+    /** For children of such containers: the number of tabs hidden before /
+     * after this tab, if it is the first / last one shown. Drawn as overflow
+     * indicators in the title bar. */
+    int tabs_hidden_before;
+    int tabs_hidden_after;
+
+    /* the x11 border pixel attribute */
+    int border_width;
+    int current_border_width;
+
+    /** the geometry this window requested when getting mapped */
+    struct Rect geometry;
+
+    /** Whether this container holds an urgent window (as opposed to being
+     * urgent because one of its children is), see con_set_urgent_flag().
+     * Such containers are counted in urgent_descendants of all parents. */
+    bool urgent_source;
+    /** Number of containers below this one (tiling and floating) which are
+     * urgent on their own. */
+    int urgent_descendants;
+
+    /** This counter contains the number of UnmapNotify events for this
+     * container (or, more precisely, for its ->frame) which should be ignored.
+     * UnmapNotify events need to be ignored when they are caused by i3 itself,
+     * for example when reparenting or when unmapping the window on a workspace
+     * change. */
+    uint8_t ignore_unmap;
+
+    /* The surface used for the frame window. */
+    surface_t frame;
+    surface_t frame_buffer;
+    bool pixmap_recreated;
 
-        /* Just moved to scratchpad, not resized by the user yet.
-         * Window will be auto-centered and sized appropriately. */
-        SCRATCHPAD_FRESH = 1,
+    /** Increases with every container created, so that index lookups can be
+     * returned in the same order as all_cons. */
+    uint64_t creation_order;
+    /** The keys under which this container is stored in the window property
+     * index (see con_index_window()), or NULL. */
+    char *window_property_keys[WINDOW_PROPERTY_MAX];
+
+    /** Whether the window icon should be displayed, and with what padding. -1
+     * means display no window icon (default behavior), 0 means display without
+     * any padding, 1 means display with 1 pixel of padding and so on. */
+    int window_icon_padding;
+
+    /** The fields which are not needed while walking the tree, see struct
+     * con_cold. Allocated together with the container, never NULL. */
+    struct con_cold *cold;
+
+    /* timer used for disabling urgency */
+    struct wheel_timer *urgency_timer;
+
+    /** The last title bar drawn for this container and a string describing
+     * its contents (colors, size, title, marks, …), see x_draw_decoration(). */
+    surface_t deco_cache;
+    char *deco_cache_key;
+    /** Cached result of con_get_tree_representation(), NULL if not computed
+     * yet or invalidated by con_invalidate_tree_representation(). */
+    char *tree_representation;
+
+    /** The state last reported in a tree event, see tree_events.c. NULL if
+     * nobody is subscribed to tree events. */
+    struct tree_event_state *tree_event_state;
+
+    /** callbacks */
+    void (*on_remove_child)(Con *);
 
-        /* The user changed position/size of the scratchpad window. */
-        SCRATCHPAD_CHANGED = 2
-    } scratchpad_state;
+    /** Use con_set_scratchpad_state() to change this. */
+    scratchpad_state_t scratchpad_state;
 
     /* The ID of this container before restarting. Necessary to correctly
      * interpret back-references in the JSON (such as the focus stack). */
@@ -12,7 +12,8 @@
 #include <config.h>
 
 /**
- * Updates all the EWMH desktop properties.
+ * Updates all the EWMH desktop properties. Properties whose value did not
+ * change are not written again.
  *
  */
 void ewmh_update_desktop_properties(void);
@@ -33,6 +34,13 @@ void ewmh_update_current_desktop(void);
  */
 void ewmh_update_wm_desktop(void);
 
+/**
+ * Performs the desktop property updates which were deferred while a batch of
+ * commands was open.
+ *
+ */
+void ewmh_flush_deferred_updates(void);
+
 /**
  * Updates _NET_ACTIVE_WINDOW with the currently focused window.
  *
@@ -49,7 +57,8 @@ void ewmh_update_active_window(xcb_window_t window);
 void ewmh_update_visible_name(xcb_window_t window, const char *name);
 
 /**
- * Updates the _NET_CLIENT_LIST hint. Used for window listers.
+ * Updates the _NET_CLIENT_LIST hint. Used for window listers. Does nothing if
+ * the list did not change since the last update.
  */
 void ewmh_update_client_list(xcb_window_t *list, int num_windows);
 
@@ -62,6 +71,8 @@ void ewmh_update_client_list(xcb_window_t *list, int num_windows);
  * _NET_CLIENT_LIST_STACKING has bottom-to-top stacking order. These properties
  * SHOULD be set and updated by the Window Manager.
  *
+ * Does nothing if the stack did not change since the last update.
+ *
  */
 void ewmh_update_client_list_stacking(xcb_window_t *stack, int num_windows);
 
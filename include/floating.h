@@ -107,6 +107,13 @@ void floating_check_size(Con *floating_con, bool prefer_height);
  */
 bool floating_reposition(Con *con, Rect newrect);
 
+/**
+ * Like floating_reposition(), but leaves rendering the tree to the caller, so
+ * that several containers can be repositioned at once.
+ *
+ */
+bool floating_reposition_deferred(Con *con, Rect newrect);
+
 /**
  * Sets size of the CT_FLOATING_CON to specified dimensions. Might limit the
  * actual size with regard to size constraints taken from user settings.
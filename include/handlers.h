@@ -13,6 +13,7 @@
 #include <config.h>
 
 #include <xcb/randr.h>
+#include <yajl/yajl_gen.h>
 
 extern int randr_base;
 extern int xkb_base;
@@ -23,7 +24,8 @@ extern int shape_base;
  * If this ignore should only affect a specific response_type, pass
  * response_type, otherwise, pass -1.
  *
- * Every ignored sequence number gets garbage collected after 5 seconds.
+ * An ignored sequence number is retired once an event with a later sequence
+ * number was handled.
  *
  */
 void add_ignore_event(const int sequence, const int response_type);
@@ -41,6 +43,36 @@ bool event_is_ignored(const int sequence, const int response_type);
  */
 void handle_event(int type, xcb_generic_event_t *event);
 
+/**
+ * Adds the handlers for the events of the RandR, XKB and shape extensions to
+ * the event dispatch table, once their event bases are known.
+ *
+ */
+void event_handlers_init(void);
+
+/**
+ * Serializes the number of events handled per event type and the total time
+ * spent handling them as members of the currently open JSON map.
+ *
+ */
+void event_handlers_dump(yajl_gen gen);
+
+/**
+ * Handles the PropertyNotify events which were queued by handle_event(), so
+ * that their properties are requested together. Pushes or renders the tree
+ * once if needed. Returns true if any events were queued.
+ *
+ */
+bool handle_queued_property_notifies(void);
+
+/**
+ * Applies the ConfigureRequests of floating windows which were queued by
+ * handle_event(), so that a burst of them renders once. Returns true if any
+ * requests were queued.
+ *
+ */
+bool handle_queued_configure_requests(void);
+
 /**
  * Sets the appropriate atoms for the property handlers after the atoms were
  * received from X11
@@ -2,6 +2,7 @@
 #define I3_REST_ATOMS_XMACRO \
 xmacro(_NET_WM_USER_TIME) \
 xmacro(_NET_STARTUP_ID) \
+xmacro(_NET_WM_PID) \
 xmacro(_NET_WORKAREA) \
 xmacro(_NET_WM_ICON) \
 xmacro(WM_PROTOCOLS) \
@@ -15,6 +16,7 @@ xmacro(I3_SOCKET_PATH) \
 xmacro(I3_CONFIG_PATH) \
 xmacro(I3_SYNC) \
 xmacro(I3_SHMLOG_PATH) \
+xmacro(I3_TREE_SHM_PATH) \
 xmacro(I3_PID) \
 xmacro(I3_LOG_STREAM_SOCKET_PATH) \
 xmacro(I3_FLOATING_WINDOW) \
@@ -69,6 +69,27 @@ typedef struct i3_ipc_header {
 /** Request the current binding state. */
 #define I3_IPC_MESSAGE_TYPE_GET_BINDING_STATE 12
 
+/** Request internal statistics (allocator pools etc.). */
+#define I3_IPC_MESSAGE_TYPE_GET_STATS 13
+
+/** Select the encoding (JSON or CBOR) of replies and events. */
+#define I3_IPC_MESSAGE_TYPE_SET_ENCODING 14
+
+/** Enable or disable the timing of commands in RUN_COMMAND replies. */
+#define I3_IPC_MESSAGE_TYPE_SET_COMMAND_TIMING 15
+
+/** Request the memory used by i3, by category. */
+#define I3_IPC_MESSAGE_TYPE_GET_MEMORY 16
+
+/** Reply once the X server processed the effects of all preceding messages. */
+#define I3_IPC_MESSAGE_TYPE_X_SYNC 17
+
+/** Select what happens when a client does not read its events fast enough */
+#define I3_IPC_MESSAGE_TYPE_SET_BACKPRESSURE 18
+
+/** Select the priority class of a client for the delivery of events */
+#define I3_IPC_MESSAGE_TYPE_SET_PRIORITY 19
+
 /*
  * Messages from i3 to clients
  *
@@ -86,6 +107,13 @@ typedef struct i3_ipc_header {
 #define I3_IPC_REPLY_TYPE_TICK 10
 #define I3_IPC_REPLY_TYPE_SYNC 11
 #define I3_IPC_REPLY_TYPE_GET_BINDING_STATE 12
+#define I3_IPC_REPLY_TYPE_STATS 13
+#define I3_IPC_REPLY_TYPE_SET_ENCODING 14
+#define I3_IPC_REPLY_TYPE_SET_COMMAND_TIMING 15
+#define I3_IPC_REPLY_TYPE_MEMORY 16
+#define I3_IPC_REPLY_TYPE_X_SYNC 17
+#define I3_IPC_REPLY_TYPE_SET_BACKPRESSURE 18
+#define I3_IPC_REPLY_TYPE_SET_PRIORITY 19
 
 /*
  * Events from i3 to clients. Events have the first bit set high.
@@ -116,3 +144,14 @@ typedef struct i3_ipc_header {
 
 /** The tick event will be sent upon a tick IPC message */
 #define I3_IPC_EVENT_TICK (I3_IPC_EVENT_MASK | 7)
+
+/** The tree event will be triggered with structural diffs of the layout tree */
+#define I3_IPC_EVENT_TREE (I3_IPC_EVENT_MASK | 8)
+
+/** The stats event periodically sends the GET_STATS counters */
+#define I3_IPC_EVENT_STATS (I3_IPC_EVENT_MASK | 9)
+
+/** The lagged event tells clients which selected the "drop" or "coalesce"
+ * backpressure policy that events were dropped. It is sent without
+ * subscription. */
+#define I3_IPC_EVENT_LAGGED (I3_IPC_EVENT_MASK | 10)
@@ -0,0 +1,37 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * intern.c: Reference counted pool of strings shared between windows (window
+ *           class, instance, role and machine).
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+/**
+ * Returns the interned copy of the first len bytes of str (or up to the first
+ * NUL byte, whichever comes first). Equal strings are interned to the same
+ * pointer, so interned strings can be compared using ==. Every call returns a
+ * new reference, which has to be released using intern_release().
+ *
+ */
+char *intern_string(const char *str, size_t len);
+
+/**
+ * Releases a reference to the given interned string (which may be NULL). The
+ * string is freed once its last reference is gone.
+ *
+ */
+void intern_release(char *str);
+
+/**
+ * Returns a number identifying the given interned string. Unlike its address,
+ * the number is never reused for another string, so it can be used as a cache
+ * key (see regex_matches_interned()).
+ *
+ */
+uint64_t intern_id(const char *str);
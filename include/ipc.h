@@ -18,27 +18,123 @@
 #include "data.h"
 #include "tree.h"
 #include "configuration.h"
+#include "json_snapshot.h"
 
 #include "i3/ipc.h"
 
 extern char *current_socketpath;
 
+/* The encoding of the replies and events sent to a client. */
+typedef enum {
+    IPC_ENCODING_JSON = 0,
+    IPC_ENCODING_CBOR = 1,
+} ipc_encoding_t;
+
+/* What happens when more than the queue limit (see the ipc_queue_limit
+ * directive) would be queued for a client which does not read its events. */
+typedef enum {
+    /* Disconnect the client. */
+    IPC_BACKPRESSURE_KILL = 0,
+    /* Discard the queued events and send a lagged event once the client
+     * caught up. */
+    IPC_BACKPRESSURE_DROP = 1,
+    /* Discard the queued events of the same type as the new one first, and
+     * all of them (like IPC_BACKPRESSURE_DROP) if that is not enough. */
+    IPC_BACKPRESSURE_COALESCE = 2,
+} ipc_backpressure_t;
+
+/* The priority class of a client, selected with SET_PRIORITY or SUBSCRIBE.
+ * Events are delivered to interactive clients first, bulk clients are served
+ * last and shed load before the others. */
+typedef enum {
+    IPC_PRIORITY_NORMAL = 0,
+    IPC_PRIORITY_INTERACTIVE = 1,
+    /* Events are written once the socket is writeable in a later loop
+     * iteration, and the backpressure policy applies at a quarter of the
+     * queue limit. */
+    IPC_PRIORITY_BULK = 2,
+} ipc_priority_t;
+
+/* A serialized message waiting in a client's output queue. The message itself
+ * is refcounted and shared between all clients it is sent to. */
+struct ipc_queued_message;
+
 typedef struct ipc_client {
     int fd;
 
-    /* The events which this client wants to receive */
-    int num_events;
-    char **events;
+    /* The events which this client wants to receive, as a bitmask over the
+     * I3_IPC_EVENT_* types (bit n is set for I3_IPC_EVENT_MASK | n). */
+    uint32_t event_mask;
+
+    /* Selected with the SET_ENCODING message, JSON by default. */
+    ipc_encoding_t encoding;
+
+    /* Set with the SET_COMMAND_TIMING message: RUN_COMMAND replies contain
+     * the time spent on each command. */
+    bool command_timing;
+
+    /* Selected with the SET_BACKPRESSURE message, IPC_BACKPRESSURE_KILL by
+     * default. */
+    ipc_backpressure_t backpressure;
+
+    /* Selected with SET_PRIORITY (or SUBSCRIBE), IPC_PRIORITY_NORMAL by
+     * default. */
+    ipc_priority_t priority;
+
+    /* Number of events dropped since the client was last sent a lagged
+     * event, and in total (reported via GET_STATS). */
+    uint64_t lagged_events;
+    uint64_t dropped_events;
+    /* Set when a client with IPC_BACKPRESSURE_KILL exceeded the queue limit
+     * and is about to be disconnected. */
+    bool over_limit;
 
     /* For clients which subscribe to the tick event: whether the first tick
      * event has been sent by i3. */
     bool first_tick_sent;
 
+    /* Set when the client subscribed to "window_uncoalesced": it receives
+     * every window event, even when ipc_coalesce_events is configured. */
+    bool uncoalesced_window_events;
+
+    /* Set when the client subscribed to "binding_compact": its binding events
+     * only carry the id of the binding. */
+    bool compact_binding_events;
+
+    /* Set when the client subscribed to "window_compact": its window events
+     * only carry the ids and the fields which changed. */
+    bool compact_window_events;
+
+    /* The filters given with SUBSCRIBE per event type (indexed like
+     * event_mask), NULL if the client did not use any. */
+    struct event_filter **event_filters;
+
     struct ev_io *read_callback;
     struct ev_io *write_callback;
     struct ev_timer *timeout;
-    uint8_t *buffer;
-    size_t buffer_size;
+
+    /* Data read from the client which was not handled yet, see
+     * ipc_receive_message(). */
+    uint8_t *read_buffer;
+    size_t read_size;
+    size_t read_capacity;
+    /* Points to a flag which free_ipc_client() sets while the client's
+     * messages are being handled, NULL otherwise. */
+    bool *freed;
+    /* Set while the client is not read from because the IPC budget of an
+     * event loop iteration was exhausted, see ipc_handle_messages(). */
+    bool deferred;
+
+    /* Messages which still have to be written to the client, and the number
+     * of bytes of the first one which have already been written. */
+    TAILQ_HEAD(ipc_queue_head, ipc_queued_message) queue;
+    size_t queue_offset;
+
+    /* Statistics reported via GET_STATS: the total number of bytes written
+     * to the client, and the current and highest number of bytes queued. */
+    uint64_t bytes_sent;
+    size_t queued_bytes;
+    size_t queued_bytes_peak;
 
     TAILQ_ENTRY(ipc_client) clients;
 } ipc_client;
@@ -85,7 +181,43 @@ ipc_client *ipc_new_client_on_fd(EV_P_ int fd);
  * and subscribed to this kind of event.
  *
  */
-void ipc_send_event(const char *event, uint32_t message_type, const char *payload);
+void ipc_send_event(uint32_t message_type, const char *payload);
+
+/**
+ * Returns the number of connected IPC clients and the total size of their
+ * output queues. Messages sent to several clients are counted for each.
+ *
+ */
+void ipc_clients_memory(uint64_t *count, uint64_t *queued_bytes);
+
+/**
+ * Returns true if at least one IPC client is subscribed to the given event
+ * type (one of the I3_IPC_EVENT_* constants). Used to avoid generating the
+ * JSON for events nobody listens to.
+ *
+ */
+bool ipc_has_event_listeners(uint32_t message_type);
+
+/**
+ * Sends the events which were deferred while a batch of commands was open.
+ *
+ */
+void ipc_flush_deferred_events(void);
+
+/**
+ * Points the symlink returned by ipc_socket_link_path() to the given socket,
+ * so that clients can find it without asking the X server, and exports the
+ * socket path as I3SOCK for all processes started by i3.
+ *
+ */
+void ipc_create_socket_link(const char *socketpath);
+
+/**
+ * Removes the symlink created by ipc_create_socket_link(), unless another
+ * i3 instance replaced it in the meantime.
+ *
+ */
+void ipc_remove_socket_link(const char *socketpath);
 
 /**
  * Calls to ipc_shutdown() should provide a reason for the shutdown.
@@ -106,12 +238,37 @@ void ipc_shutdown(shutdown_reason_t reason, int exempt_fd);
 
 void dump_node(yajl_gen gen, Con *con, bool inplace_restart);
 
+/**
+ * Records the serialization of the given container and its children (see
+ * dump_node()) into the snapshot.
+ *
+ */
+void dump_node_snapshot(json_snapshot_t *snapshot, Con *con);
+
 /**
  * Generates a json workspace event. Returns a dynamically allocated yajl
  * generator. Free with yajl_gen_free().
  */
 yajl_gen ipc_marshal_workspace_event(const char *change, Con *current, Con *old);
 
+/** An event which was serialized in advance, see ipc_prepare_workspace_event(). */
+typedef struct ipc_prepared_event ipc_prepared_event;
+
+/**
+ * Serializes a workspace event like ipc_send_workspace_event(), to be sent
+ * later using ipc_send_prepared_event(). Used for the "empty" event, which
+ * is sent once the workspace is closed. Returns NULL if no client would
+ * receive the event.
+ *
+ */
+ipc_prepared_event *ipc_prepare_workspace_event(const char *change, Con *current, Con *old);
+
+/**
+ * Sends and frees an event returned by ipc_prepare_workspace_event().
+ *
+ */
+void ipc_send_prepared_event(ipc_prepared_event *event);
+
 /**
  * For the workspace events we send, along with the usual "change" field, also
  * the workspace container in "current". For focus events, we send the
@@ -125,6 +282,20 @@ void ipc_send_workspace_event(const char *change, Con *current, Con *old);
  */
 void ipc_send_window_event(const char *property, Con *con);
 
+/**
+ * Invalidates the cached GET_WORKSPACES, GET_OUTPUTS and GET_MARKS replies.
+ * Called whenever workspaces, outputs or marks (may) have changed.
+ *
+ */
+void ipc_invalidate_reply_cache(void);
+
+/**
+ * Drops the coalesced window events which are pending for the given
+ * container, which is about to be freed.
+ *
+ */
+void ipc_window_events_con_freed(Con *con);
+
 /**
  * For the barconfig update events, we send the serialized barconfig.
  */
@@ -141,6 +312,18 @@ void ipc_send_binding_event(const char *event_type, Binding *bind);
  */
 void ipc_set_kill_timeout(ev_tstamp new);
 
+/**
+ * Returns the maximum duration that we allow for a connection with an
+ * unwriteable socket. Also used for log clients (see src/log.c).
+ */
+ev_tstamp ipc_get_kill_timeout(void);
+
+/**
+ * Sets the number of bytes which may be queued for a client before its
+ * backpressure policy applies. 0 disables the limit.
+ */
+void ipc_set_queue_limit(long limit);
+
 /**
  * Sends a restart reply to the IPC client on the specified fd.
  */
@@ -0,0 +1,83 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * json_snapshot.c: Records the calls of a JSON generator into a compact
+ *                  buffer, which is serialized on a worker thread.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+#include <yajl/yajl_gen.h>
+
+typedef struct json_snapshot json_snapshot_t;
+
+/**
+ * Called on the main thread with the serialized snapshot. The payload is
+ * freed after the callback returns.
+ *
+ */
+typedef void (*json_snapshot_cb)(const uint8_t *payload, size_t size, void *data);
+
+/**
+ * Creates a new, empty snapshot.
+ *
+ */
+json_snapshot_t *json_snapshot_new(void);
+
+/**
+ * Frees the snapshot.
+ *
+ */
+void json_snapshot_free(json_snapshot_t *snapshot);
+
+/**
+ * Returns the size of the recorded tokens in bytes.
+ *
+ */
+size_t json_snapshot_size(json_snapshot_t *snapshot);
+
+/*
+ * The counterparts of the yajl_gen_* functions. They return yajl_gen_status
+ * so that they can be used interchangeably, see dump_node().
+ *
+ */
+yajl_gen_status json_snapshot_map_open(json_snapshot_t *snapshot);
+yajl_gen_status json_snapshot_map_close(json_snapshot_t *snapshot);
+yajl_gen_status json_snapshot_array_open(json_snapshot_t *snapshot);
+yajl_gen_status json_snapshot_array_close(json_snapshot_t *snapshot);
+yajl_gen_status json_snapshot_null(json_snapshot_t *snapshot);
+yajl_gen_status json_snapshot_bool(json_snapshot_t *snapshot, int value);
+yajl_gen_status json_snapshot_integer(json_snapshot_t *snapshot, long long value);
+yajl_gen_status json_snapshot_double(json_snapshot_t *snapshot, double value);
+yajl_gen_status json_snapshot_string(json_snapshot_t *snapshot, const unsigned char *str, size_t len);
+
+/**
+ * Generates the recorded JSON using the given generator. Doubles are formatted
+ * according to the current locale, like yajl_gen_double() does.
+ *
+ */
+void json_snapshot_replay(json_snapshot_t *snapshot, yajl_gen gen);
+
+/**
+ * Writes the recorded JSON into a newly allocated buffer without using yajl:
+ * the snapshot is known to be well-formed, so the generator does not need to
+ * validate its state, integers are formatted without printf, and strings are
+ * only escaped where necessary. The output is the same as the one of
+ * json_snapshot_replay(), except that doubles are always formatted as in the
+ * C locale.
+ *
+ */
+void json_snapshot_write(json_snapshot_t *snapshot, uint8_t **payload, size_t *size);
+
+/**
+ * Serializes the snapshot to JSON (and converts it to CBOR if cbor is set) on
+ * a worker thread, which takes ownership of the snapshot. The callback is
+ * called from the main loop once the payload is ready.
+ *
+ */
+void json_snapshot_serialize(json_snapshot_t *snapshot, bool cbor, json_snapshot_cb callback, void *data);
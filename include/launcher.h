@@ -0,0 +1,31 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * launcher.c: A helper process, forked at startup while i3 is still small,
+ *             which starts the commands of exec using posix_spawn().
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+/**
+ * Forks the launcher process. Has to be called early, before i3 allocated
+ * much memory, as the launcher keeps a copy of i3's address space. If this
+ * fails, commands are started by forking i3 itself (see start_application()).
+ *
+ */
+void launcher_start(void);
+
+/**
+ * Asks the launcher to start the given command using /bin/sh, with I3SOCK set
+ * and DESKTOP_STARTUP_ID set to the given startup id (unless it is NULL).
+ * Returns false if there is no launcher, so that the caller can start the
+ * command itself. The PID of the started process is reported to
+ * startup_sequence_set_pid() later on.
+ *
+ */
+bool launcher_exec(const char *command, const char *startup_id);
@@ -22,6 +22,7 @@
 
 #include <pango/pango.h>
 #include <cairo/cairo-xcb.h>
+#include <yajl/yajl_parse.h>
 
 #define DEFAULT_DIR_MODE (S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)
 
@@ -70,6 +71,10 @@ struct Font {
     /** The pattern/name used to load the font. */
     char *pattern;
 
+    /** Whether the font was loaded with load_font_async() and its metrics
+     * are not known yet, see finish_font_loading(). */
+    bool loading;
+
     union {
         struct {
             /** The xcb-id for the font */
@@ -80,6 +85,16 @@ struct Font {
 
             /** Font table for this font (may be NULL) */
             xcb_charinfo_t *table;
+
+            /** Glyph widths for fonts without a font table: 256 rows (the
+             * first byte of UCS-2), which are queried when they are first
+             * used. */
+            int16_t **widths;
+
+            /** The requests sent by load_font_async() */
+            xcb_void_cookie_t open_cookie;
+            xcb_query_font_cookie_t info_cookie;
+            bool fallback;
         } xcb;
 
         /** The pango font description */
@@ -160,6 +175,51 @@ char *sstrndup(const char *str, size_t size);
  */
 int sasprintf(char **strp, const char *fmt, ...);
 
+/**
+ * Counts the memory allocated with smalloc_counted() and friends which has
+ * not been released with free_counted() yet, e.g. per subsystem.
+ *
+ */
+typedef struct mem_counter {
+    uint64_t allocations;
+    uint64_t bytes;
+} mem_counter_t;
+
+/**
+ * Like smalloc(), but accounts the allocation to the given counter. The memory
+ * has to be released using free_counted() instead of free().
+ *
+ */
+void *smalloc_counted(mem_counter_t *counter, size_t size);
+
+/**
+ * Like scalloc(), but accounts the allocation to the given counter. The memory
+ * has to be released using free_counted() instead of free().
+ *
+ */
+void *scalloc_counted(mem_counter_t *counter, size_t num, size_t size);
+
+/**
+ * Like sstrdup(), but accounts the copy to the given counter. It has to be
+ * released using free_counted() instead of free().
+ *
+ */
+char *sstrdup_counted(mem_counter_t *counter, const char *str);
+
+/**
+ * Like sstrndup(), but accounts the copy to the given counter. It has to be
+ * released using free_counted() instead of free().
+ *
+ */
+char *sstrndup_counted(mem_counter_t *counter, const char *str, size_t size);
+
+/**
+ * Releases memory allocated with smalloc_counted() and friends (ptr may be
+ * NULL) and subtracts it from its counter.
+ *
+ */
+void free_counted(void *ptr);
+
 /**
  * Wrapper around correct write which returns -1 (meaning that
  * write failed) or count (meaning that all bytes were written)
@@ -325,6 +385,32 @@ int ipc_send_message(int sockfd, const uint32_t message_size,
 int ipc_recv_message(int sockfd, uint32_t *message_type,
                      uint32_t *reply_length, uint8_t **reply);
 
+/**
+ * Converts a JSON document into its CBOR encoding. Maps and arrays are
+ * encoded with indefinite length. The result is stored in a newly allocated
+ * buffer. Returns false if the JSON could not be parsed.
+ *
+ */
+bool ipc_json_to_cbor(const uint8_t *json, size_t json_length, uint8_t **cbor, size_t *cbor_length);
+
+/**
+ * Decodes a CBOR-encoded IPC reply or event and calls the given yajl
+ * callbacks just like yajl_parse() would for the equivalent JSON, so that
+ * existing JSON parsers can be reused.
+ *
+ * Returns yajl_status_ok on success, yajl_status_client_canceled if a callback
+ * returned 0 and yajl_status_error if the data is not valid CBOR.
+ *
+ */
+yajl_status ipc_cbor_parse(const yajl_callbacks *callbacks, void *ctx, const uint8_t *cbor, size_t cbor_length);
+
+/**
+ * Converts a CBOR-encoded IPC reply or event back into JSON. Returns a newly
+ * allocated, NUL-terminated string or NULL if the data is not valid CBOR.
+ *
+ */
+char *ipc_cbor_to_json(const uint8_t *cbor, size_t cbor_length);
+
 /**
  * Generates a configure_notify event and sends it to the given window
  * Applications need this to think they’ve configured themselves correctly.
@@ -393,6 +479,22 @@ uint32_t get_mod_mask_for(uint32_t keysym,
  */
 i3Font load_font(const char *pattern, const bool fallback);
 
+/**
+ * Like load_font(), but only sends the requests for opening the font without
+ * waiting for the X server, so that other work can be done in the meantime.
+ * The font must be completed with finish_font_loading() before it is used for
+ * drawing or measuring text, or before its height is used.
+ *
+ */
+i3Font load_font_async(const char *pattern, const bool fallback);
+
+/**
+ * Waits for the font loaded by load_font_async() and gets its metrics. Does
+ * nothing for fonts which are already complete.
+ *
+ */
+void finish_font_loading(i3Font *font);
+
 /**
  * Defines the font to be used for the forthcoming calls.
  *
@@ -422,6 +524,13 @@ char *convert_ucs2_to_utf8(xcb_char2b_t *text, size_t num_glyphs);
  */
 xcb_char2b_t *convert_utf8_to_ucs2(char *input, size_t *real_strlen);
 
+/**
+ * Returns true if the first len bytes of str are all ASCII (and thus valid
+ * UTF-8 with one glyph per byte).
+ *
+ */
+bool is_ascii(const char *str, size_t len);
+
 /* Represents a color split by color channel. */
 typedef struct color_t {
     double red;
@@ -467,6 +576,20 @@ void draw_text(i3String *text, xcb_drawable_t drawable, xcb_gcontext_t gc,
  */
 int predict_text_width(i3String *text);
 
+/**
+ * Returns the number of cache hits and misses of predict_text_width() and the
+ * number of currently cached widths.
+ *
+ */
+void predict_text_width_stats(uint64_t *hits, uint64_t *misses, size_t *size);
+
+/**
+ * Drops the least recently used widths from the cache of predict_text_width()
+ * until at most size widths are left.
+ *
+ */
+void predict_text_width_trim(size_t size);
+
 /**
  * Returns the visual type associated with the given screen.
  *
@@ -486,6 +609,14 @@ bool is_debug_build(void) __attribute__((const));
  */
 char *get_process_filename(const char *prefix);
 
+/**
+ * Returns the path of the symlink to the IPC socket of the i3 instance which
+ * manages $DISPLAY ($XDG_RUNTIME_DIR/i3/ipc-socket.<display>), or NULL if
+ * either variable is not set.
+ *
+ */
+char *ipc_socket_link_path(void);
+
 /**
  * This function returns the absolute path to the executable it is running in.
  *
@@ -623,6 +754,27 @@ void draw_util_text(i3String *text, surface_t *surface, color_t fg_color, color_
  */
 void draw_util_image(cairo_surface_t *image, surface_t *surface, int x, int y, int width, int height);
 
+/**
+ * Uploads the image (an ARGB32 Cairo image surface) into a new pixmap, so that
+ * drawing it with draw_util_image_pixmap() only copies it within the X server
+ * instead of sending the pixels again. They are passed in shared memory
+ * (MIT-SHM) if the X server supports it and runs on the same machine.
+ *
+ * Returns false if the image cannot be uploaded (no 32-bit visual, different
+ * byte order), in which case it has to be drawn with draw_util_image().
+ * Otherwise, the pixmap is released with draw_util_surface_free() and
+ * xcb_free_pixmap().
+ *
+ */
+bool draw_util_image_upload(xcb_connection_t *conn, cairo_surface_t *image, surface_t *uploaded);
+
+/**
+ * Draws an image uploaded with draw_util_image_upload(), scaled like
+ * draw_util_image().
+ *
+ */
+void draw_util_image_pixmap(surface_t *image, surface_t *surface, int x, int y, int width, int height);
+
 /**
  * Draws a filled rectangle.
  * This function is a convenience wrapper and takes care of flushing the
@@ -631,6 +783,13 @@ void draw_util_image(cairo_surface_t *image, surface_t *surface, int x, int y, i
  */
 void draw_util_rectangle(surface_t *surface, color_t color, double x, double y, double w, double h);
 
+/**
+ * Draws several filled rectangles of the same color as a single path, which is
+ * cheaper than one draw_util_rectangle() call per rectangle.
+ *
+ */
+void draw_util_rectangles(surface_t *surface, color_t color, const xcb_rectangle_t *rectangles, size_t count);
+
 /**
  * Clears a surface with the given color.
  *
@@ -686,3 +845,175 @@ bool is_background_set(xcb_connection_t *conn, xcb_screen_t *screen);
  *
  */
 bool boolstr(const char *str);
+
+/**
+ * A hash map with integer or string keys (see libi3/hashmap.c). Values are
+ * opaque pointers owned by the caller.
+ *
+ */
+typedef struct hashmap hashmap_t;
+
+/**
+ * Creates a new, empty hash map.
+ *
+ */
+hashmap_t *hashmap_new(void);
+
+/**
+ * Frees the hash map and its keys. Values are not touched, the caller is
+ * responsible for them.
+ *
+ */
+void hashmap_free(hashmap_t *map);
+
+/**
+ * Removes all entries from the hash map. Values are not touched.
+ *
+ */
+void hashmap_clear(hashmap_t *map);
+
+/**
+ * Returns the number of entries stored in the hash map.
+ *
+ */
+size_t hashmap_size(hashmap_t *map);
+
+/**
+ * Stores value under the given integer key, replacing any previous value.
+ *
+ */
+void hashmap_insert(hashmap_t *map, uint64_t key, void *value);
+
+/**
+ * Returns the value stored under the given integer key or NULL.
+ *
+ */
+void *hashmap_lookup(hashmap_t *map, uint64_t key);
+
+/**
+ * Removes the given integer key and returns the value which was stored under
+ * it (or NULL).
+ *
+ */
+void *hashmap_remove(hashmap_t *map, uint64_t key);
+
+/**
+ * Stores value under the given string key (the key is copied), replacing any
+ * previous value.
+ *
+ */
+void hashmap_insert_str(hashmap_t *map, const char *key, void *value);
+
+/**
+ * Returns the value stored under the given string key or NULL.
+ *
+ */
+void *hashmap_lookup_str(hashmap_t *map, const char *key);
+
+/**
+ * Removes the given string key and returns the value which was stored under
+ * it (or NULL).
+ *
+ */
+void *hashmap_remove_str(hashmap_t *map, const char *key);
+
+/**
+ * Calls cb for every value in the hash map, in no particular order. The
+ * callback must not modify the hash map.
+ *
+ */
+void hashmap_foreach(hashmap_t *map, void (*cb)(void *value, void *userdata), void *userdata);
+
+/**
+ * The keys of a JSON schema, mapped to their index in names by a perfect
+ * hash table (see libi3/json_keys.c). Define it with JSON_KEY_TABLE from an
+ * array of key names indexed by an enum, then switch on the result of
+ * json_key_lookup() in the yajl callbacks.
+ *
+ */
+typedef struct json_key_table {
+    const char *const *names;
+    size_t num_names;
+    /* Whether "Full_Text" matches "full_text". */
+    bool ignore_case;
+
+    /* Built on the first lookup: */
+    uint32_t seed;
+    uint32_t mask;
+    int *slots;
+    size_t *lengths;
+} json_key_table_t;
+
+#define JSON_KEY_TABLE(key_names, case_insensitive) \
+    { .names = (key_names), .num_names = sizeof(key_names) / sizeof((key_names)[0]), .ignore_case = (case_insensitive) }
+
+/** Returned by json_key_lookup() for keys which are not in the table. */
+#define JSON_KEY_UNKNOWN (-1)
+
+/**
+ * Returns the index of the given key (of len bytes, not NUL-terminated) in
+ * the names of the table, or JSON_KEY_UNKNOWN.
+ *
+ */
+int json_key_lookup(json_key_table_t *table, const unsigned char *key, size_t len);
+
+/**
+ * The type of the argument a printf(3) conversion specification consumes.
+ *
+ */
+typedef enum {
+    /* "%%" consumes no argument */
+    PRINTF_ARG_NONE = 0,
+    /* int, also used for char and short, which are promoted to int */
+    PRINTF_ARG_INT,
+    PRINTF_ARG_LONG,
+    PRINTF_ARG_LONG_LONG,
+    PRINTF_ARG_INTMAX,
+    PRINTF_ARG_SIZE,
+    PRINTF_ARG_PTRDIFF,
+    PRINTF_ARG_DOUBLE,
+    PRINTF_ARG_STRING,
+    PRINTF_ARG_POINTER,
+    /* %n, %m, positional arguments, long double and wide characters */
+    PRINTF_ARG_UNSUPPORTED,
+} printf_arg_t;
+
+/**
+ * A conversion specification of a printf(3) format string, see
+ * printf_next_conversion().
+ *
+ */
+typedef struct printf_conversion_t {
+    /* The '%' and the byte after the conversion specifier. */
+    const char *start;
+    const char *end;
+
+    /* Whether the field width or precision is given as "*", i.e. as an int
+     * argument preceding the converted argument. */
+    bool width_star;
+    bool precision_star;
+
+    /* The precision, if given as a number, -1 otherwise. */
+    int precision;
+
+    printf_arg_t type;
+} printf_conversion_t;
+
+/**
+ * Finds the first conversion specification of the printf(3) format string at
+ * or after fmt and describes it in conv. Returns false if there is none.
+ *
+ * Used to store log messages in binary form (see src/log.c) and to format them
+ * later on (see i3-dump-log).
+ *
+ */
+bool printf_next_conversion(const char *fmt, printf_conversion_t *conv);
+
+/**
+ * Converts len pixels of ARGB data (as found in _NET_WM_ICON, one pixel per
+ * uint32_t, not premultiplied) to Cairo's CAIRO_FORMAT_ARGB32, which uses
+ * premultiplied alpha. src and dst may be the same buffer. Uses SIMD
+ * instructions when the compiler targets SSE2, AVX2 or NEON.
+ *
+ */
+void premultiply_argb(uint32_t *dst, const uint32_t *src, size_t len);
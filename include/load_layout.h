@@ -27,16 +27,23 @@ typedef enum {
     JSON_CONTENT_WORKSPACE = 2,
 } json_content_t;
 
-/* Parses the given JSON file until it encounters the first “type” property to
- * determine whether the file contains workspaces or regular containers, which
- * is important to know when deciding where (and how) to append the contents.
- * */
-json_content_t json_determine_content(const char *buf, const size_t len);
-
 /**
- * Returns true if the provided JSON could be parsed by yajl.
+ * Validates the given JSON and determines from its first “type” property
+ * whether it contains workspaces or regular containers, which is important to
+ * know when deciding where (and how) to append the contents. Both are done in
+ * a single pass which does not build anything. Returns JSON_CONTENT_UNKNOWN
+ * if the JSON could not be parsed.
  *
  */
-bool json_validate(const char *buf, const size_t len);
+json_content_t json_validate_content(const char *buf, const size_t len);
 
 void tree_append_json(Con *con, const char *buf, const size_t len, char **errormsg);
+
+/**
+ * Like tree_append_json(), but for the CBOR encoding of a layout (see
+ * ipc_json_to_cbor()), as used by the restart snapshot. Returns false if the
+ * data could not be decoded; containers which were restored completely up to
+ * that point are kept.
+ *
+ */
+bool tree_append_cbor(Con *con, const uint8_t *buf, const size_t len);
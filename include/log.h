@@ -23,17 +23,53 @@
 #if defined(DLOG)
 #undef DLOG
 #endif
+/* Messages below I3_LOG_LEVEL (see the log_level build option) are compiled
+ * out. Their arguments are still type-checked, but never evaluated. */
+#define I3_LOG_LEVEL_DEBUG 0
+#define I3_LOG_LEVEL_INFO 1
+#define I3_LOG_LEVEL_ERROR 2
+#ifndef I3_LOG_LEVEL
+#define I3_LOG_LEVEL I3_LOG_LEVEL_DEBUG
+#endif
+
+/* The prefix of debug messages. It is followed by __FILE__, __FUNCTION__ and
+ * __LINE__ in the arguments, which the SHM log uses to pick the ring of the
+ * message (see set_shmlog_rings()). */
+#define LOG_DEBUG_PREFIX "%s:%s:%d - "
+
 /** ##__VA_ARGS__ means: leave out __VA_ARGS__ completely if it is empty, that
-   is, delete the preceding comma */
-#define LOG(fmt, ...) verboselog(fmt, ##__VA_ARGS__)
+   is, delete the preceding comma.
+   The arguments are only evaluated if the message is written anywhere. */
+#if I3_LOG_LEVEL <= I3_LOG_LEVEL_INFO
+#define LOG(fmt, ...) (log_verbose_active ? verboselog(fmt, ##__VA_ARGS__) : (void)0)
+#else
+#define LOG(fmt, ...) (0 ? verboselog(fmt, ##__VA_ARGS__) : (void)0)
+#endif
 #define ELOG(fmt, ...) errorlog("ERROR: " fmt, ##__VA_ARGS__)
-#define DLOG(fmt, ...) debuglog("%s:%s:%d - " fmt, __FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__)
+#if I3_LOG_LEVEL <= I3_LOG_LEVEL_DEBUG
+#define DLOG(fmt, ...)                                                                     \
+    ((log_debug_active && (!log_filter_active || log_file_enabled(__FILE__)))              \
+         ? debuglog(LOG_DEBUG_PREFIX fmt, __FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__) \
+         : (void)0)
+#else
+#define DLOG(fmt, ...) \
+    (0 ? debuglog(LOG_DEBUG_PREFIX fmt, __FILE__, __FUNCTION__, __LINE__, ##__VA_ARGS__) : (void)0)
+#endif
 
 extern char *errorfilename;
 extern char *shmlogname;
 extern int shmlog_size;
 extern char *current_log_stream_socket_path;
 
+/* Whether debug (DLOG) and verbose (LOG) messages are currently written to
+ * stdout or the SHM log. */
+extern bool log_debug_active;
+extern bool log_verbose_active;
+
+/* Whether debug logging is restricted to some source files, see
+ * set_debug_log_filter(). */
+extern bool log_filter_active;
+
 /**
  * Initializes logging by creating an error logfile in /tmp (or
  * XDG_RUNTIME_DIR, see get_process_filename()).
@@ -53,6 +89,22 @@ void open_logbuffer(void);
  */
 void close_logbuffer(void);
 
+/**
+ * Returns the size of the SHM log in bytes, 0 if it is disabled.
+ *
+ */
+size_t log_buffer_size(void);
+
+/**
+ * Changes the weights of the rings of the SHM log, given as a comma-separated
+ * list of name=weight pairs (e.g. "x=20,important=30"). The rings not listed
+ * keep their weight, a weight of 0 disables the ring. Takes effect when the
+ * logbuffer is opened the next time. Returns false (changing nothing) if spec
+ * is invalid.
+ *
+ */
+bool set_shmlog_rings(const char *spec);
+
 /**
  * Checks if debug logging is active.
  *
@@ -65,6 +117,21 @@ bool get_debug_logging(void);
  */
 void set_debug_logging(const bool _debug_logging);
 
+/**
+ * Restricts debug logging to the given comma-separated list of source files
+ * (e.g. "x.c,handlers"; the ".c" suffix is optional), or logs all files
+ * again if files is NULL.
+ *
+ */
+void set_debug_log_filter(const char *files);
+
+/**
+ * Returns whether debug messages of the given source file (__FILE__) pass the
+ * filter set by set_debug_log_filter().
+ *
+ */
+bool log_file_enabled(const char *file);
+
 /**
  * Set verbosity of i3. If verbose is set to true, informative messages will
  * be printed to stdout. If verbose is set to false, only errors will be
@@ -0,0 +1,70 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * maintenance.c: A queue of cheap deferred cleanup tasks (trimming caches,
+ *                returning memory), run while i3 is idle.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+#include <yajl/yajl_gen.h>
+
+typedef struct maintenance_task maintenance_task;
+
+/**
+ * Does a bounded amount of work (a few milliseconds at most). Returns true if
+ * there is more work left, the task is queued again then.
+ *
+ */
+typedef bool (*maintenance_task_cb)(maintenance_task *task);
+
+/**
+ * A maintenance task, usually a static variable of the subsystem it cleans
+ * up after.
+ *
+ */
+struct maintenance_task {
+    /** Name of the task, as reported via IPC. */
+    const char *name;
+    maintenance_task_cb cb;
+
+    /* Managed by the queue: */
+    bool queued;
+    uint64_t runs;
+    TAILQ_ENTRY(maintenance_task) tasks;
+
+    bool registered;
+    SLIST_ENTRY(maintenance_task) all_tasks;
+};
+
+#define MAINTENANCE_TASK_INITIALIZER(task_name, task_cb) \
+    { .name = (task_name), .cb = (task_cb) }
+
+/** The time tasks may take per idle slice, in seconds. Once it is used up,
+ * the remaining tasks wait for the next time i3 is idle. */
+#define MAINTENANCE_BUDGET 0.002
+
+/**
+ * Queues the task, unless it is queued already. It runs once there are no
+ * pending X11 events, IPC messages or timers.
+ *
+ */
+void maintenance_schedule(maintenance_task *task);
+
+/**
+ * Removes the task from the queue if it is queued.
+ *
+ */
+void maintenance_cancel(maintenance_task *task);
+
+/**
+ * Serializes the counters of the maintenance queue as the "maintenance" member
+ * of the currently open JSON map.
+ *
+ */
+void maintenance_dump(yajl_gen gen);
@@ -31,7 +31,8 @@ void manage_existing_windows(xcb_window_t root);
 void restore_geometry(void);
 
 /**
- * Do some sanity checks and then reparent the window.
+ * Do some sanity checks and then reparent the window. The replies are waited
+ * for in the event loop, see manage_window_continue().
  *
  */
 void manage_window(xcb_window_t window,
@@ -39,8 +40,24 @@ void manage_window(xcb_window_t window,
                    bool needs_to_be_mapped);
 
 /**
- * Remanages a window: performs a swallow check and runs assignments.
- * Returns con for the window regardless if it updated.
+ * Returns true while a window passed to manage_window() is waiting for
+ * replies.
  *
  */
-Con *remanage_window(Con *con);
+bool manage_window_pending(void);
+
+/**
+ * Continues managing the windows passed to manage_window() whose replies have
+ * arrived, in the order in which they were passed. Returns true if any window
+ * made progress.
+ *
+ */
+bool manage_window_continue(void);
+
+/**
+ * Remanages a window: performs a swallow check and runs the assignments which
+ * depend on the changed window properties (WP_*). Returns con for the window
+ * regardless if it updated.
+ *
+ */
+Con *remanage_window(Con *con, uint32_t changed);
@@ -6,8 +6,8 @@
  *
  * A "match" is a data structure which acts like a mask or expression to match
  * certain windows or not. For example, when using commands, you can specify a
- * command like this: [title="*Firefox*"] kill. The title member of the match
- * data structure will then be filled and i3 will check each window using
+ * command like this: [title="*Firefox*"] kill. A CRIT_TITLE criterion will then
+ * be added to the match and i3 will check each window using
  * match_matches_window() to find the windows affected by this command.
  *
  */
@@ -16,13 +16,46 @@
 #include <config.h>
 
 /**
- * Initializes the Match data structure. This function is necessary because the
- * members representing boolean values (like dock) need to be initialized with
- * -1 instead of 0.
+ * Initializes the Match data structure, which then contains no criteria.
  *
  */
 void match_init(Match *match);
 
+/**
+ * Returns the criterion of the given type, or NULL if the match does not
+ * contain one.
+ *
+ */
+struct match_criterion *match_get(Match *match, criterion_t type);
+
+/**
+ * Returns the regular expression of the given string criterion, or NULL if
+ * the match does not contain one.
+ *
+ */
+struct regex *match_get_regex(Match *match, criterion_t type);
+
+/**
+ * Adds a criterion of the given type to the match, replacing the existing one
+ * (and freeing its regular expression). Returns it, so that the caller can
+ * fill in the value.
+ *
+ */
+struct match_criterion *match_set(Match *match, criterion_t type);
+
+/**
+ * Adds (or replaces) a string criterion of the given type.
+ *
+ */
+void match_set_regex(Match *match, criterion_t type, const char *pattern);
+
+/**
+ * Returns the window properties (WP_*) the given match depends on, that is
+ * whose changes can change whether a window matches.
+ *
+ */
+uint32_t match_dependencies(Match *match);
+
 /**
  * Check if a match is empty. This is necessary while parsing commands to see
  * whether the user specified a match at all.
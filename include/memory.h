@@ -0,0 +1,50 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * memory.c: Accounting of i3's memory by category, reported via the
+ *           GET_MEMORY IPC message.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+#include <yajl/yajl_gen.h>
+
+/**
+ * The subsystems whose allocations are counted with smalloc_counted() and
+ * friends. Everything else is measured by walking the data structures when
+ * the report is generated.
+ *
+ */
+typedef enum {
+    /* The interned window properties (class, instance, role, machine) */
+    MEM_PROPERTIES,
+    /* The window icons as received from the clients */
+    MEM_ICONS,
+    /* The IPC replies and events waiting to be written to clients */
+    MEM_IPC,
+    /* The regular expressions of criteria, assignments and for_window */
+    MEM_REGEX,
+    NUM_MEMORY_COUNTERS,
+} memory_counter_t;
+
+extern mem_counter_t memory_counters[NUM_MEMORY_COUNTERS];
+
+/**
+ * Notes that a window (or something of similar size) was freed. After many
+ * of them, the free memory at the end of the heap is returned to the system
+ * once i3 is idle (with glibc).
+ *
+ */
+void memory_trim_later(void);
+
+/**
+ * Generates the GET_MEMORY reply: a map with the number of objects and bytes
+ * per category.
+ *
+ */
+void memory_dump(yajl_gen gen);
@@ -0,0 +1,109 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * pool.c: Type-specific pool allocator for frequently allocated objects
+ *         (containers, window states, windows, matches, marks) and the frame
+ *         arena for temporaries of a render pass.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+#include <yajl/yajl_gen.h>
+
+#include "queue.h"
+
+/**
+ * A pool hands out zeroed objects of one fixed size. Objects are carved out of
+ * larger slabs and recycled through a free list, which keeps objects of the
+ * same type close together in memory and avoids fragmenting the heap when
+ * windows are opened and closed rapidly.
+ *
+ * When i3 is built without the pool_allocator option (or with
+ * AddressSanitizer), every object is allocated using scalloc() instead, so
+ * that use-after-free bugs can still be caught. The counters are maintained
+ * in either case.
+ *
+ */
+typedef struct pool {
+    /** Name of the pool, as reported via IPC. */
+    const char *name;
+    /** Size of one object in bytes. */
+    size_t object_size;
+
+    /** Number of objects currently handed out. */
+    uint32_t live;
+    /** Maximum of live since i3 started. */
+    uint32_t peak;
+    /** Number of objects the allocated slabs can hold. */
+    uint32_t capacity;
+    /** Number of times pool_alloc() was called. */
+    uint64_t allocations;
+
+    /** Singly linked list of free objects (stored inside the objects). */
+    void *free_list;
+    /** Singly linked list of slabs (stored at the beginning of each slab). */
+    void *slabs;
+
+    bool registered;
+    SLIST_ENTRY(pool) pools;
+} pool_t;
+
+#define POOL_INITIALIZER(pool_name, type) \
+    { .name = (pool_name), .object_size = sizeof(type) }
+
+/**
+ * Pools for the structures defined in data.h. The con_state pool is private
+ * to x.c.
+ *
+ */
+extern pool_t con_pool;
+extern pool_t con_cold_pool;
+extern pool_t window_pool;
+extern pool_t match_pool;
+extern pool_t mark_pool;
+
+/**
+ * Returns a zeroed object from the given pool. Never returns NULL.
+ *
+ */
+void *pool_alloc(pool_t *pool);
+
+/**
+ * Returns the object to its pool. ptr may be NULL.
+ *
+ */
+void pool_free(pool_t *pool, void *ptr);
+
+/**
+ * Serializes the counters of all pools which have been used so far as a JSON
+ * array.
+ *
+ */
+void pool_dump_stats(yajl_gen gen);
+
+/**
+ * Returns size bytes from the frame arena, suitably aligned for any type.
+ * The memory is not zeroed and stays valid until the next frame_reset(), so
+ * it must not be freed or stored beyond the current render pass. Never
+ * returns NULL.
+ *
+ */
+void *frame_alloc(size_t size);
+
+/**
+ * Like sasprintf(), but the string is allocated from the frame arena.
+ *
+ */
+char *frame_asprintf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/**
+ * Releases everything allocated from the frame arena. Called at the end of
+ * x_push_changes(), i.e. at the end of every tree_render().
+ *
+ */
+void frame_reset(void);
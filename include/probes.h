@@ -0,0 +1,51 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * probes.h: Static (USDT) probes in the hot paths, for tracing with perf,
+ *           bpftrace or SystemTap. They are only compiled in with the usdt
+ *           build option, see docs/hacking-howto for the list of probes.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+#if defined(I3_USDT_PROBES) && !defined(TEST_PARSER)
+
+#include <sys/sdt.h>
+
+#define PROBE0(name) DTRACE_PROBE(i3, name)
+#define PROBE1(name, a) DTRACE_PROBE1(i3, name, a)
+#define PROBE2(name, a, b) DTRACE_PROBE2(i3, name, a, b)
+#define PROBE3(name, a, b, c) DTRACE_PROBE3(i3, name, a, b, c)
+
+/** The time (in µs) to compute the durations passed to probes. */
+#define PROBE_NOW() stats_now()
+
+#else
+
+#define PROBE0(name) \
+    do {             \
+    } while (0)
+#define PROBE1(name, a) \
+    do {                \
+        (void)(a);      \
+    } while (0)
+#define PROBE2(name, a, b) \
+    do {                   \
+        (void)(a);         \
+        (void)(b);         \
+    } while (0)
+#define PROBE3(name, a, b, c) \
+    do {                      \
+        (void)(a);            \
+        (void)(b);            \
+        (void)(c);            \
+    } while (0)
+
+#define PROBE_NOW() ((uint64_t)0)
+
+#endif
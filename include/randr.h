@@ -53,8 +53,26 @@ void init_ws_for_output(Output *output);
 /**
  * (Re-)queries the outputs via RandR and stores them in the list of outputs.
  *
+ * Only outputs which changed are reconfigured. Returns false if no output was
+ * added, removed or changed, in which case the layout tree was not touched.
+ *
+ */
+bool randr_query_outputs(void);
+
+/**
+ * Returns the highest refresh rate (in Hz) of all active CRTCs, as found by
+ * the last randr_query_outputs(), or 0 if it is unknown.
+ *
+ */
+double randr_get_max_refresh_rate(void);
+
+/**
+ * Invalidates the output grid and the output names. Has to be called whenever
+ * an output is added, activated, deactivated, renamed, changes its position or
+ * size or becomes the primary output.
+ *
  */
-void randr_query_outputs(void);
+void randr_outputs_changed(void);
 
 /**
  * Disables the output and moves its content.
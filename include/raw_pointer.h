@@ -0,0 +1,50 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * raw_pointer.c: Focus follows mouse based on XInput 2 raw motion events
+ *                (focus_follows_mouse raw).
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+/**
+ * Selects or deselects XInput 2 raw motion events on the root window
+ * according to the focus_follows_mouse directive. Without XInput 2, i3 falls
+ * back to following EnterNotify events.
+ *
+ */
+void raw_pointer_configure(void);
+
+/**
+ * Returns true if focus follows raw pointer motion, in which case the
+ * EnterNotify and MotionNotify handlers must not change focus.
+ *
+ */
+bool raw_pointer_active(void);
+
+/**
+ * Handles a GenericEvent. Raw motion events only note that the pointer moved
+ * and request its position, see raw_pointer_flush().
+ *
+ */
+void raw_pointer_handle_event(xcb_generic_event_t *event);
+
+/**
+ * Focuses the container below the pointer if the pointer moved since the last
+ * call. Called once per event loop iteration. Returns true if the focus
+ * changed.
+ *
+ */
+bool raw_pointer_flush(void);
+
+/**
+ * Notes that the geometry of the visible containers changed, so the index for
+ * looking up the container below the pointer has to be rebuilt.
+ *
+ */
+void raw_pointer_invalidate_index(void);
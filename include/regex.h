@@ -13,9 +13,10 @@
 
 /**
  * Creates a new 'regex' struct containing the given pattern and a PCRE
- * compiled regular expression. Also, calls pcre_study because this regex will
- * most likely be used often (like for every new window and on every relevant
- * property change of existing windows).
+ * compiled regular expression, or returns another reference to the existing
+ * one for the same pattern. Also, JIT-compiles the pattern (if supported
+ * by PCRE) because this regex will most likely be used often (like for every
+ * new window and on every relevant property change of existing windows).
  *
  * Returns NULL if the pattern could not be compiled into a regular expression
  * (and ELOGs an appropriate error message).
@@ -24,11 +25,32 @@
 struct regex *regex_new(const char *pattern);
 
 /**
- * Frees the given regular expression. It must not be used afterwards!
+ * Returns the number of distinct regular expressions in use.
+ *
+ */
+size_t regex_count(void);
+
+/**
+ * Returns another reference to the given regular expression, which has to be
+ * released using regex_free().
+ *
+ */
+struct regex *regex_ref(struct regex *regex);
+
+/**
+ * Releases a reference to the given regular expression, freeing it once the
+ * last one is gone. It must not be used afterwards!
  *
  */
 void regex_free(struct regex *regex);
 
+/**
+ * Returns the only string the given regular expression matches (the pattern
+ * was ^literal$ without any other metacharacters) or NULL.
+ *
+ */
+const char *regex_exact_literal(struct regex *regex);
+
 /**
  * Checks if the given regular expression matches the given input and returns
  * true if it does. In either case, it logs the outcome using LOG(), so it will
@@ -36,3 +58,12 @@ void regex_free(struct regex *regex);
  *
  */
 bool regex_matches(struct regex *regex, const char *input);
+
+/**
+ * Like regex_matches(), but for an interned string (see intern_string()) or
+ * NULL, which is matched like the empty string. The results for the last few
+ * interned strings are remembered, so that matching many windows with the
+ * same class (for example) does not run the regular expression every time.
+ *
+ */
+bool regex_matches_interned(struct regex *regex, const char *input);
@@ -30,6 +30,10 @@ typedef struct render_params {
     int children;
     /* A precalculated list of sizes of each child. */
     int *sizes;
+    /* For tabbed containers: the index of the first tab shown and the number
+     * of tabs shown (see tab_min_width). */
+    int tabs_first;
+    int tabs_shown;
 } render_params;
 
 /**
@@ -42,6 +46,31 @@ typedef struct render_params {
  */
 void render_con(Con *con);
 
+/**
+ * Renders only the given (tiling) container and its children. Containers
+ * outside of it keep their positions, so this is cheaper than rendering the
+ * whole tree while e.g. a resize is being previewed. The floating windows are
+ * raised again afterwards to keep them on top of the re-rendered containers.
+ *
+ */
+void render_subtree(Con *con);
+
+/**
+ * Returns whether the given output has to be rendered again because one of its
+ * containers was marked dirty or its rect changed.
+ *
+ */
+bool render_output_needed(Con *output);
+
+/**
+ * Renders only the outputs for which render_output_needed() is true and the
+ * floating windows of all outputs. The other outputs keep the result of the
+ * previous render, so this must only be used when nothing else changed on
+ * them (see tree_note_workspace_switch()).
+ *
+ */
+void render_dirty_outputs(void);
+
 /**
  * Returns the height for the decorations
  *
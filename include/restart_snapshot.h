@@ -0,0 +1,45 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * The format of the layout snapshot which i3 hands to the new process during
+ * an in-place restart, in addition to the JSON layout file.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+#define RESTART_SNAPSHOT_MAGIC "i3-snap"
+
+/* Increased whenever the format changes. A process which does not support the
+ * version of a snapshot falls back to the JSON layout file. */
+#define RESTART_SNAPSHOT_VERSION 1
+
+/**
+ * Header of the restart snapshot. Used by i3/src/util.c (writing) and
+ * i3/src/tree.c (reading).
+ *
+ * The snapshot is stored in an unlinked file whose descriptor is passed to
+ * the new process in the _I3_RESTART_SNAPSHOT_FD environment variable. The
+ * header is followed by the layout tree as dumped for in-place restarts, in
+ * its CBOR encoding (see ipc_json_to_cbor()), which the new process decodes
+ * from the memory-mapped file without parsing any JSON.
+ *
+ * All values are stored in host byte order.
+ *
+ */
+typedef struct restart_snapshot_header {
+    /* RESTART_SNAPSHOT_MAGIC, including the terminating NUL byte. */
+    char magic[8];
+
+    uint32_t version;
+
+    /* The size of this header in bytes. The tree starts right after it. */
+    uint32_t header_size;
+
+    /* The length of the CBOR-encoded tree in bytes. */
+    uint64_t length;
+} restart_snapshot_header;
@@ -15,24 +15,97 @@
 /* Default shmlog size if not set by user. */
 extern const int default_shmlog_size;
 
+/* Maximum number of rings in the shmlog, see i3_shmlog_ring. */
+#define I3_SHMLOG_MAX_RINGS 8
+
 /**
- * Header of the shmlog file. Used by i3/src/log.c and i3/i3-dump-log/main.c.
+ * One of the ring buffers of the shmlog. Each subsystem of i3 writes to its
+ * own ring, so that chatty subsystems (like X11 event handling) cannot evict
+ * the rare messages of the others from the log.
+ *
+ * All offsets are byte offsets from the start of the shmlog.
  *
  */
-typedef struct i3_shmlog_header {
-    /* Byte offset where the next line will be written to. */
+typedef struct i3_shmlog_ring {
+    /* Name of the ring (NUL-terminated), e.g. "x" or "ipc". */
+    char name[16];
+
+    /* Byte offset and size of the ring buffer. */
+    uint32_t offset_start;
+    uint32_t size;
+
+    /* Byte offset where the next record will be written to. */
     uint32_t offset_next_write;
 
     /* Byte offset where the last wrap occurred. */
     uint32_t offset_last_wrap;
 
-    /* The size of the logfile in bytes. Since the size is limited to 25 MiB
-     * an uint32_t is sufficient. */
-    uint32_t size;
-
     /* wrap counter. We need it to reliably signal to clients that we just
      * wrapped (clients cannot use offset_last_wrap because that might
      * coincidentally be exactly the same as previously). Overflows can happen
      * and don’t matter — clients use an equality check (==). */
     uint32_t wrap_count;
+
+    /* Byte offset of the oldest record which is still intact, i.e. which was
+     * written before the last wrap and not overwritten since. It is equal to
+     * offset_last_wrap if there is no such record. */
+    uint32_t offset_oldest;
+} i3_shmlog_ring;
+
+/**
+ * Header of the shmlog file. Used by i3/src/log.c and i3/i3-dump-log/main.c.
+ *
+ * The header is followed by the call site table (the format strings of the
+ * messages stored in binary form, each terminated by a NUL byte, appended as
+ * they are first used) and by the ring buffers of i3_shmlog_records, one per
+ * ring in use.
+ *
+ * There is only one writer (i3), which updates the offsets after writing the
+ * data they refer to (with release semantics), so readers need no lock.
+ *
+ */
+typedef struct i3_shmlog_header {
+    /* The size of the logfile in bytes. Since the size is limited to 25 MiB
+     * an uint32_t is sufficient. */
+    uint32_t size;
+
+    /* Byte offset and size of the call site table. The ring buffers start
+     * right after it. */
+    uint32_t offset_sites;
+    uint32_t sites_size;
+
+    /* Number of bytes of the call site table in use. */
+    uint32_t sites_used;
+
+    /* Number of entries of rings in use. */
+    uint32_t num_rings;
+
+    i3_shmlog_ring rings[I3_SHMLOG_MAX_RINGS];
 } i3_shmlog_header;
+
+/**
+ * A log message in the ring buffer, followed by length bytes of payload.
+ *
+ * If site is 0, the payload is the formatted message. Otherwise, site is the
+ * byte offset of the message's format string (in the call site table) and the
+ * payload holds its arguments, for each conversion in order:
+ *
+ * • the field width and precision if given as "*", as int32_t
+ * • the argument: all integer types as int64_t (except for int, which is
+ *   stored as int32_t), doubles as double, pointers as uint64_t and strings
+ *   as their uint32_t length (UINT32_MAX for NULL) followed by their bytes.
+ *
+ * All values are stored unaligned and in host byte order.
+ *
+ */
+typedef struct i3_shmlog_record {
+    uint32_t length;
+    uint32_t site;
+
+    /* Counts the records of all rings, so that readers can merge the rings
+     * in the order the messages were logged. */
+    uint64_t seq;
+
+    /* Seconds since the epoch. */
+    int64_t time;
+} i3_shmlog_record;
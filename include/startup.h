@@ -18,10 +18,11 @@
 #include <libsn/sn-monitor.h>
 
 /**
- * Starts the given application by passing it through a shell. We use double
- * fork to avoid zombie processes. As the started application’s parent exits
- * (immediately), the application is reparented to init (process-id 1), which
- * correctly handles children, so we don’t have to do it :-).
+ * Starts the given application by passing it through a shell. The launcher
+ * process (see launcher.c) spawns it if it is running. Otherwise, we use
+ * double fork to avoid zombie processes. As the started application’s parent
+ * exits (immediately), the application is reparented to init (process-id 1),
+ * which correctly handles children, so we don’t have to do it :-).
  *
  * The shell used to start applications is the system's bourne shell (i.e.,
  * /bin/sh).
@@ -46,6 +47,14 @@ void startup_sequence_delete(struct Startup_Sequence *sequence);
  */
 void startup_monitor_event(SnMonitorEvent *event, void *userdata);
 
+/**
+ * Remembers the PID of the process started for the given startup sequence,
+ * so that windows without _NET_STARTUP_ID can be matched by their
+ * _NET_WM_PID.
+ *
+ */
+void startup_sequence_set_pid(const char *id, pid_t pid);
+
 /**
  * Renames workspaces that are mentioned in the startup sequences.
  *
@@ -53,7 +62,9 @@ void startup_monitor_event(SnMonitorEvent *event, void *userdata);
 void startup_sequence_rename_workspace(const char *old_name, const char *new_name);
 
 /**
- * Gets the stored startup sequence for the _NET_STARTUP_ID of a given window.
+ * Gets the stored startup sequence for the _NET_STARTUP_ID of a given window
+ * (or of its leader). If neither has one, the sequence is looked up by the
+ * window's _NET_WM_PID.
  *
  */
 struct Startup_Sequence *startup_sequence_get(i3Window *cwindow,
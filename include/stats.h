@@ -0,0 +1,172 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * stats.c: Performance counters and latency histograms, reported via the
+ *          GET_STATS IPC message and the stats event.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+#include <yajl/yajl_gen.h>
+
+/** The operations whose durations are recorded in a histogram. */
+typedef enum {
+    STATS_TREE_RENDER,
+    STATS_X_PUSH_CHANGES,
+    STATS_RUN_ASSIGNMENTS,
+    /* The steps of loading the configuration, see load_configuration() */
+    STATS_PARSE_FILE,
+    STATS_CHECK_DUPLICATE_BINDINGS,
+    STATS_REORDER_BINDINGS,
+    STATS_TRANSLATE_KEYSYMS,
+    /* The whole reload command, including the steps above */
+    STATS_RELOAD,
+    NUM_STATS_TIMINGS,
+} stats_timing_t;
+
+/** The kinds of X requests which src/x.c and src/xcb.c count individually,
+ * see x_requests.h. */
+typedef enum {
+    STATS_X_CONFIGURE_WINDOW,
+    STATS_X_MAP_WINDOW,
+    STATS_X_UNMAP_WINDOW,
+    STATS_X_CHANGE_WINDOW_ATTRIBUTES,
+    STATS_X_CHANGE_PROPERTY,
+    STATS_X_COPY_AREA,
+    STATS_X_SHAPE,
+    STATS_X_SET_INPUT_FOCUS,
+    /* Requests whose reply (or error) i3 waits for */
+    STATS_X_ROUND_TRIP,
+    /* Not a request: writes of unchanged EWMH focus properties which were
+     * left out, see ewmh_update_active_window() */
+    STATS_X_ELIDED,
+    NUM_STATS_X_REQUESTS,
+} stats_x_request_t;
+
+/** The phases of main(), in order, see stats_startup_phase(). */
+typedef enum {
+    STATS_STARTUP_X_CONNECT,
+    STATS_STARTUP_ATOMS,
+    STATS_STARTUP_CONFIG,
+    STATS_STARTUP_WM_SELECTION,
+    STATS_STARTUP_XKB,
+    STATS_STARTUP_FONT,
+    STATS_STARTUP_TREE,
+    STATS_STARTUP_OUTPUTS,
+    STATS_STARTUP_RENDER,
+    STATS_STARTUP_MANAGE_WINDOWS,
+    STATS_STARTUP_AUTOSTART,
+    STATS_STARTUP_BARS,
+    NUM_STATS_STARTUP_PHASES,
+} stats_startup_phase_t;
+
+/** The number of X requests issued so far, per kind. */
+extern uint64_t stats_x_requests[NUM_STATS_X_REQUESTS];
+
+/** The number of tree_schedule_render() calls, and the number of scheduled
+ * renders which were merged into another one (see tree.c). */
+extern uint64_t stats_renders_scheduled;
+extern uint64_t stats_renders_avoided;
+
+/** The number of frame windows whose creation x_con_init() deferred, the
+ * number of them which were created later (see create_deferred_frames() in
+ * x.c) and the number of frames which do not exist yet. */
+extern uint64_t stats_frames_deferred;
+extern uint64_t stats_frames_created;
+extern uint64_t stats_frames_pending;
+
+/**
+ * Returns the current time of a monotonic clock in microseconds, to be passed
+ * to stats_record_duration() later.
+ *
+ */
+uint64_t stats_now(void);
+
+/**
+ * Records the duration of the given operation, which started at the given
+ * time (as returned by stats_now()).
+ *
+ */
+void stats_record_duration(stats_timing_t timing, uint64_t start);
+
+/**
+ * Returns the duration of the last recorded operation of the given kind.
+ *
+ */
+uint64_t stats_last_duration(stats_timing_t timing);
+
+/**
+ * Marks the beginning of main(). The startup phases are timed from here.
+ *
+ */
+void stats_startup_begin(void);
+
+/**
+ * Marks the end of the given startup phase, which began when the previous one
+ * ended, and logs its duration.
+ *
+ */
+void stats_startup_phase(stats_startup_phase_t phase);
+
+/**
+ * Marks the beginning and end of x_push_changes(), to count the X requests
+ * issued in between. The counting costs one extra (no-op) request per call
+ * and is therefore only done once statistics were requested via IPC.
+ *
+ */
+void stats_push_begin(void);
+void stats_push_end(void);
+
+/**
+ * Marks the beginning and end of tree_render(), to aggregate the counted X
+ * requests per render.
+ *
+ */
+void stats_render_begin(void);
+void stats_render_end(void);
+
+/**
+ * Marks the beginning and end of handling a KeyPress or ButtonPress event.
+ * The latency of the press is recorded at the next stats_input_flushed().
+ *
+ */
+void stats_input_begin(void);
+void stats_input_end(void);
+
+/**
+ * Does not record the latency of the press being handled, e.g. because it
+ * started dragging and its latency depends on the user.
+ *
+ */
+void stats_input_cancel(void);
+
+/**
+ * Records that the press being handled runs the given binding.
+ *
+ */
+void stats_input_binding(Binding *bind);
+
+/**
+ * Records the latency of the presses handled since the last call. Called right
+ * after the event loop flushed the requests of its iteration to X11.
+ *
+ */
+void stats_input_flushed(void);
+
+/**
+ * Enables the counters which have a cost of their own, see stats_push_begin().
+ *
+ */
+void stats_enable(void);
+
+/**
+ * Serializes the X event counters, the latency histograms and the startup
+ * phases as members of the currently open JSON map.
+ *
+ */
+void stats_dump(yajl_gen gen);
@@ -12,3 +12,26 @@
 #include <xcb/xcb.h>
 
 void sync_respond(xcb_window_t window, uint32_t rnd);
+
+typedef void (*sync_callback_t)(void *data);
+
+/**
+ * Calls the callback once the X server processed all requests which i3 sent
+ * so far, without waiting for it. The callbacks are called in the order in
+ * which they were registered, from sync_continue().
+ *
+ */
+void sync_after_x_requests(sync_callback_t callback, void *data);
+
+/**
+ * Cancels all callbacks registered with the given data.
+ *
+ */
+void sync_cancel(void *data);
+
+/**
+ * Calls the callbacks whose requests were processed, without blocking.
+ * Returns true if any callback was called.
+ *
+ */
+bool sync_continue(void);
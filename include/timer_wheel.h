@@ -0,0 +1,55 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * timer_wheel.c: One coarse libev timer for many low-precision timeouts, like
+ *                the urgency timers of containers.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+typedef struct wheel_timer wheel_timer;
+
+typedef void (*wheel_timer_cb)(wheel_timer *timer);
+
+/**
+ * A timeout on the timer wheel. Starting and stopping it is O(1), it expires
+ * with a precision of TIMER_WHEEL_RESOLUTION (but never early).
+ *
+ */
+struct wheel_timer {
+    wheel_timer_cb cb;
+    void *data;
+
+    /* Managed by the timer wheel: */
+    bool active;
+    uint64_t expires;
+    LIST_ENTRY(wheel_timer) slot;
+};
+
+/** The duration of one tick of the wheel, in seconds. */
+#define TIMER_WHEEL_RESOLUTION 0.05
+
+/**
+ * Initializes the given timer. cb is called with the timer once it expires;
+ * the timer is stopped at that point and may be freed or started again.
+ *
+ */
+void wheel_timer_init(wheel_timer *timer, wheel_timer_cb cb, void *data);
+
+/**
+ * Starts the timer so that it expires after the given number of seconds. A
+ * running timer is restarted.
+ *
+ */
+void wheel_timer_start(wheel_timer *timer, double after);
+
+/**
+ * Stops the timer if it is running.
+ *
+ */
+void wheel_timer_stop(wheel_timer *timer);
@@ -0,0 +1,75 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * trace.c: Records the X events handled by i3 and the IPC commands it runs to
+ *          a file (see --record-trace), to be replayed by bench/replay.c.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <xcb/xcb.h>
+
+#define TRACE_MAGIC "i3trace1"
+
+/** The file starts with this header, followed by the records. All fields use
+ * the byte order of the recording machine. */
+struct trace_header {
+    char magic[8];
+    /* The event bases of the extensions, -1 if not available */
+    int16_t randr_base;
+    int16_t xkb_base;
+    int16_t shape_base;
+    uint16_t reserved;
+};
+
+typedef enum {
+    /* The 32 bytes of an X event, as passed to handle_event() */
+    TRACE_X_EVENT = 1,
+    /* An IPC command, not NUL-terminated */
+    TRACE_COMMAND = 2,
+    /* An atom (uint32_t) and its name, recorded before the first event which
+     * refers to it */
+    TRACE_ATOM = 3,
+} trace_record_t;
+
+struct trace_record {
+    /* Microseconds since the previous record */
+    uint32_t delta_us;
+    uint8_t type;
+    uint8_t reserved;
+    /* The number of bytes which follow */
+    uint16_t length;
+};
+
+/**
+ * Starts recording to the given file, replacing its contents unless append is
+ * set (to continue the trace after an in-place restart). Returns false if the
+ * file cannot be opened.
+ *
+ */
+bool trace_open(const char *path, bool append);
+
+/**
+ * Stops recording and writes out buffered records.
+ *
+ */
+void trace_close(void);
+
+/**
+ * Records an X event, see handle_event().
+ *
+ */
+void trace_event(const xcb_generic_event_t *event);
+
+/**
+ * Records an IPC command.
+ *
+ */
+void trace_command(const char *command, size_t length);
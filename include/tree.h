@@ -18,6 +18,8 @@ extern Con *focused;
 TAILQ_HEAD(all_cons_head, Con);
 extern struct all_cons_head all_cons;
 
+struct ipc_client;
+
 /**
  * Initializes the tree by creating the root node, adding all RandR outputs
  * to the tree (that means randr_init() has to be called before) and
@@ -58,6 +60,117 @@ bool level_down(void);
  */
 void tree_render(void);
 
+/**
+ * Renders the tree before the event loop waits for new events, unless
+ * tree_render() is called before. Several calls within one event loop
+ * iteration result in a single render. Callers which need the result (e.g.
+ * the geometry of a container) right away have to use tree_render().
+ *
+ */
+void tree_schedule_render(void);
+
+/**
+ * Renders the tree if tree_schedule_render() was called since the last
+ * render. Returns whether it rendered.
+ *
+ */
+bool tree_flush_scheduled_render(void);
+
+/**
+ * Notes that the focus changed. Focus changes can change which children of
+ * stacked and tabbed containers are visible without marking any container
+ * dirty, so the next tree_render() renders all outputs.
+ *
+ */
+void tree_note_focus_change(void);
+
+/**
+ * Returns whether the focus changed since the last tree_render().
+ *
+ */
+bool tree_focus_changed(void);
+
+/**
+ * Notes that the tree (may have) changed, which bumps the generation reported
+ * to IPC clients.
+ *
+ */
+void tree_note_change(void);
+
+/**
+ * Returns the current generation of the tree. It increases whenever
+ * something which is part of the GET_TREE, GET_WORKSPACES or GET_OUTPUTS
+ * replies (may have) changed.
+ *
+ */
+uint64_t tree_generation(void);
+
+/**
+ * Notes that workspace_show() switched workspaces. If focus_clean is true (the
+ * focus did not change between the last tree_render() and the switch), the
+ * next tree_render() only renders the outputs which contain dirty containers
+ * and keeps the others as they are.
+ *
+ */
+void tree_note_workspace_switch(bool focus_clean);
+
+/**
+ * Notes that only the dock area (and thereby the content geometry) of the
+ * given output changed, e.g. because a dock client was mapped, unmapped or
+ * resized. Unless the focus changed since the last tree_render(), the next
+ * tree_render() only renders the outputs which contain dirty containers.
+ *
+ */
+void tree_note_output_change(Con *output);
+
+/**
+ * Starts a batch of commands. Until tree_batch_commit() is called,
+ * tree_render(), EWMH desktop updates and IPC events (except for tick and
+ * shutdown events) are deferred. The batch is committed automatically when
+ * its owner disconnects or after a timeout.
+ *
+ * Returns false if a batch is already open.
+ *
+ */
+bool tree_batch_begin(struct ipc_client *owner);
+
+/**
+ * Ends the open batch: sends the deferred EWMH updates and IPC events and
+ * renders the tree once.
+ *
+ */
+void tree_batch_commit(void);
+
+/**
+ * Starts a bulk operation on the tree (closing a workspace, moving the
+ * workspaces of an output away): like a batch of commands, rendering, EWMH
+ * desktop updates and IPC events are deferred until tree_bulk_end(). Returns
+ * false if a batch is open already, the operation is then part of it and must
+ * not call tree_bulk_end().
+ *
+ */
+bool tree_bulk_begin(void);
+
+/**
+ * Ends the bulk operation started by tree_bulk_begin(): sends the deferred
+ * EWMH updates and IPC events and renders the tree once.
+ *
+ */
+void tree_bulk_end(void);
+
+/**
+ * Returns true while a batch of commands is open.
+ *
+ */
+bool tree_batch_active(void);
+
+/**
+ * Commits the open batch if it was started by the given IPC client, which is
+ * about to be freed.
+ *
+ */
+void tree_batch_client_gone(struct ipc_client *client);
+
 /**
  * Changes focus in the given direction
  *
@@ -87,6 +200,14 @@ bool tree_close_internal(Con *con, kill_window_t kill_window, bool dont_kill_par
  */
 bool tree_restore(const char *path, xcb_get_geometry_reply_t *geometry);
 
+/**
+ * Loads the tree from the given restart snapshot (see restart_snapshot.h).
+ * Returns false if the snapshot is unusable, in which case the layout file
+ * should be restored instead.
+ *
+ */
+bool tree_restore_snapshot(const uint8_t *data, size_t size, xcb_get_geometry_reply_t *geometry);
+
 /**
  * tree_flatten() removes pairs of redundant split containers, e.g.:
  *       [workspace, horizontal]
@@ -101,3 +222,26 @@ bool tree_restore(const char *path, xcb_get_geometry_reply_t *geometry);
  *
  */
 void tree_flatten(Con *child);
+
+/**
+ * Remembers that the children or the layout of the given container changed,
+ * so that the next tree_flatten_candidates() checks whether it (or its parent
+ * or children) became part of a pair of redundant split containers.
+ *
+ */
+void tree_note_flatten_candidate(Con *con);
+
+/**
+ * Removes the given container from the list of candidates. Called when the
+ * container is freed.
+ *
+ */
+void tree_forget_flatten_candidate(Con *con);
+
+/**
+ * Like tree_flatten(croot), but only looks at the containers noted with
+ * tree_note_flatten_candidate() since the last call, instead of the whole
+ * tree.
+ *
+ */
+void tree_flatten_candidates(void);
@@ -0,0 +1,40 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * tree_events.c: Structural diffs of the layout tree for the tree IPC event.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+/**
+ * Starts tracking the tree for the tree IPC event by recording the current
+ * state of every container. Called when the first client subscribes.
+ *
+ */
+void tree_events_start(void);
+
+/**
+ * Compares the tree with the state recorded at the last call and sends a tree
+ * event describing the differences to all subscribed clients. Does nothing if
+ * nothing changed or nobody is subscribed.
+ *
+ */
+void tree_events_flush(void);
+
+/**
+ * Releases the recorded state of a container which is about to be freed and
+ * remembers its removal for the next tree event.
+ *
+ */
+void tree_events_con_freed(Con *con);
+
+/**
+ * Returns the generation of the last tree event which was sent.
+ *
+ */
+uint64_t tree_events_generation(void);
@@ -0,0 +1,137 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * tree_shm.c: Publishes a read-only snapshot of the layout tree in a shared
+ *             memory segment (see the tree_shm_size directive).
+ *
+ * The format of the segment is described below. Its path is stored in the
+ * I3_TREE_SHM_PATH atom on the root window.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+#include <stdint.h>
+
+#define I3_TREE_SHM_VERSION 1
+
+/* No node, e.g. the parent of the root. */
+#define I3_TREE_SHM_NONE UINT32_MAX
+
+/**
+ * Header of the tree segment.
+ *
+ * The header is followed by num_nodes i3_tree_shm_nodes, in pre-order (each
+ * container is followed by its tiling, then its floating children). The names
+ * are stored at the end of the segment.
+ *
+ * There is only one writer (i3), which makes sequence odd while it updates the
+ * snapshot (like a seqlock). Readers copy what they need and retry if sequence
+ * was odd before or changed after the copy:
+ *
+ *     do {
+ *         seq = __atomic_load_n(&header->sequence, __ATOMIC_ACQUIRE);
+ *         … copy …
+ *         __atomic_thread_fence(__ATOMIC_ACQUIRE);
+ *     } while ((seq & 1) || seq != __atomic_load_n(&header->sequence, __ATOMIC_RELAXED));
+ *
+ */
+typedef struct i3_tree_shm_header {
+    /* I3_TREE_SHM_VERSION */
+    uint32_t version;
+
+    /* The size of the segment in bytes. */
+    uint32_t size;
+
+    /* Odd while the snapshot is being updated. Overflows can happen and don’t
+     * matter — readers use an equality check (==). */
+    uint32_t sequence;
+
+    uint32_t num_nodes;
+
+    /* Non-zero if not all containers fit into the segment. The last ones in
+     * pre-order are missing then. */
+    uint32_t truncated;
+
+    /* Index of the focused container, or I3_TREE_SHM_NONE. */
+    uint32_t focused;
+
+    /* The tree generation which is also reported to conditional IPC requests
+     * (see docs/ipc). */
+    uint64_t generation;
+} i3_tree_shm_header;
+
+/* Values of i3_tree_shm_node.flags */
+#define I3_TREE_SHM_URGENT (1 << 0)
+#define I3_TREE_SHM_FLOATING (1 << 1)
+#define I3_TREE_SHM_FULLSCREEN (1 << 2)
+#define I3_TREE_SHM_STICKY (1 << 3)
+
+/**
+ * A container. Indexes refer to the node array following the header.
+ *
+ */
+typedef struct i3_tree_shm_node {
+    /* The container id as reported by the IPC interface. */
+    uint64_t id;
+
+    /* The X11 window id, or 0 for containers without a window. */
+    uint32_t window;
+
+    /* The container type as in the "type" IPC property: 0 (root), 1 (output),
+     * 2 (con), 3 (floating_con), 4 (workspace) or 5 (dockarea). */
+    uint32_t type;
+
+    /* I3_TREE_SHM_* flags */
+    uint32_t flags;
+
+    uint32_t parent;
+
+    /* The child which is first in the focus stack, or I3_TREE_SHM_NONE. */
+    uint32_t focus;
+
+    /* The workspace and output the container is on (the container itself
+     * for workspaces and outputs), or I3_TREE_SHM_NONE. */
+    uint32_t workspace;
+    uint32_t output;
+
+    int32_t x;
+    int32_t y;
+    uint32_t width;
+    uint32_t height;
+
+    /* Byte offset (from the start of the segment) and length of the name
+     * (UTF-8, not terminated): the window title for windows. */
+    uint32_t name_offset;
+    uint32_t name_length;
+} i3_tree_shm_node;
+
+/**
+ * Creates, resizes or removes the segment according to the tree_shm_size
+ * directive, and updates the I3_TREE_SHM_PATH atom.
+ *
+ */
+void tree_shm_configure(void);
+
+/**
+ * Writes the current tree into the segment, unless it did not change since
+ * the last update. Does nothing if the segment is disabled.
+ *
+ */
+void tree_shm_update(void);
+
+/**
+ * Removes the segment.
+ *
+ */
+void tree_shm_close(void);
+
+/**
+ * Returns the path of the segment, or NULL if it is disabled.
+ *
+ */
+const char *tree_shm_path(void);
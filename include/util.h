@@ -166,6 +166,21 @@ bool parse_long(const char *str, long *out, int base);
  */
 ssize_t slurp(const char *path, char **buf);
 
+/**
+ * Maps the file at path read-only into memory, returning the length of the
+ * file or -1 if it could not be mapped. buf is set to the mapping, which has
+ * to be released with unmap_file(), or NULL if the file is empty or -1 is
+ * returned.
+ *
+ */
+ssize_t map_file(const char *path, char **buf);
+
+/**
+ * Releases a mapping returned by map_file().
+ *
+ */
+void unmap_file(char *buf, ssize_t len);
+
 /**
  * Convert a direction to its corresponding orientation.
  *
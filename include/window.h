@@ -17,6 +17,22 @@
  */
 void window_free(i3Window *win);
 
+/**
+ * Returns the number of distinct window icons, the bytes of their scaled
+ * copies (the original data is counted in memory_counters[MEM_ICONS]) and of
+ * the pixmaps they were uploaded into.
+ *
+ */
+void window_icons_memory(uint64_t *count, uint64_t *surface_bytes, uint64_t *pixmap_bytes);
+
+/**
+ * Draws the icon into a square of the given size. The icon is uploaded into
+ * the X server the first time it is drawn, so that drawing it again does not
+ * send the pixels again.
+ *
+ */
+void window_icon_draw(struct window_icon *icon, surface_t *surface, int x, int y, int size);
+
 /**
  * Updates the WM_CLASS (consisting of the class and instance) for the
  * given window.
@@ -96,6 +112,13 @@ void window_update_hints(i3Window *win, xcb_get_property_reply_t *prop, bool *ur
  */
 void window_update_motif_hints(i3Window *win, xcb_get_property_reply_t *prop, border_style_t *motif_border_style);
 
+/**
+ * Updates the WM_PROTOCOLS (WM_TAKE_FOCUS and WM_DELETE_WINDOW), so that
+ * focusing and killing the window need no round-trip.
+ *
+ */
+void window_update_protocols(i3Window *win, xcb_get_property_reply_t *prop);
+
 /**
  * Updates the WM_CLIENT_MACHINE
  *
@@ -107,3 +130,10 @@ void window_update_machine(i3Window *win, xcb_get_property_reply_t *prop);
  *
  */
 void window_update_icon(i3Window *win, xcb_get_property_reply_t *prop);
+
+/**
+ * Scales all window icons to the current decoration height again. Called
+ * after reloading the configuration, which may change the font.
+ *
+ */
+void window_icons_rescale(void);
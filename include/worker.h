@@ -0,0 +1,26 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * worker.c: A small pool of threads for work which does not need any of i3's
+ *           state, like serializing IPC replies or scaling window icons.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+typedef void (*worker_fn)(void *data);
+
+/**
+ * Runs work(data) on one of the worker threads and afterwards done(data) on
+ * the main loop. work must not touch any of i3's state (the tree, the
+ * configuration, the X11 connection, the log, …). Jobs are started in the
+ * order in which they were submitted, but may finish in any order.
+ *
+ * If no thread can be started, both functions are called right away.
+ *
+ */
+void worker_submit(worker_fn work, worker_fn done, void *data);
@@ -31,6 +31,21 @@
  */
 extern char *previous_workspace_name;
 
+/**
+ * Adds the workspace to the name and number index. Called when the workspace
+ * is attached to a content container.
+ *
+ */
+void workspace_index(Con *ws);
+
+/**
+ * Removes the workspace from the name and number index. Called when the
+ * workspace is detached, so its name and number must not change while it is
+ * attached.
+ *
+ */
+void workspace_unindex(Con *ws);
+
 /**
  * Returns the workspace with the given name or NULL if such a workspace does
  * not exist.
@@ -58,6 +73,13 @@ Con *get_existing_workspace_by_num(int num);
  */
 Con *get_assigned_output(const char *name, long parsed_num);
 
+/**
+ * Notes that the workspace assignments or the outputs changed, which
+ * invalidates the results of get_assigned_output().
+ *
+ */
+void workspace_assignments_changed(void);
+
 /**
  * Returns true if the first output assigned to a workspace with the given
  * workspace assignment is the same as the given output.
@@ -186,3 +208,11 @@ Con *workspace_encapsulate(Con *ws);
  *
  */
 void workspace_move_to_output(Con *ws, Output *output);
+
+/**
+ * Moves the given workspaces to the specified output at once, switching
+ * the outputs they leave and the destination output only once and sending
+ * the IPC events (and rendering) only once everything has moved.
+ *
+ */
+void workspaces_move_to_output(Con **workspaces, int num_workspaces, Output *output);
@@ -17,17 +17,43 @@ extern xcb_window_t focused_id;
 
 /**
  * Initializes the X11 part for the given container. Called exactly once for
- * every container from con_new().
+ * every container from con_new(). The frame window itself is created once the
+ * container is shown for the first time.
  *
  */
 void x_con_init(Con *con);
 
+/**
+ * Returns whether the frame window of the given container exists in X11, see
+ * x_con_init().
+ *
+ */
+bool x_con_has_frame(Con *con);
+
 /**
  * Moves a child window from Container src to Container dest.
  *
  */
 void x_move_win(Con *src, Con *dest);
 
+/**
+ * Makes x_push_changes() reparent the client window of the given container,
+ * which is still a child of the root window, into the frame once the
+ * container is shown for the first time.
+ *
+ * viewable is set for windows which are adopted on startup: they get unmapped
+ * if the container is not shown.
+ *
+ */
+void x_adopt_child(Con *con, bool viewable);
+
+/**
+ * Returns whether the client window of the given container was unmapped
+ * because it got adopted into a container which has not been shown since.
+ *
+ */
+bool x_con_child_hidden(Con *con);
+
 /**
  * Reparents the child window of the given container (necessary for sticky
  * containers). The reparenting happens in the next call of x_push_changes().
@@ -56,22 +82,30 @@ void x_con_kill(Con *con);
 void x_con_reframe(Con *con);
 
 /**
- * Returns true if the client supports the given protocol atom (like WM_DELETE_WINDOW)
+ * Kills the given X11 window using WM_DELETE_WINDOW (if supported).
  *
  */
-bool window_supports_protocol(xcb_window_t window, xcb_atom_t atom);
+void x_window_kill(i3Window *win, kill_window_t kill_window);
 
 /**
- * Kills the given X11 window using WM_DELETE_WINDOW (if supported).
+ * Draws the decoration of the given container onto its parent.
  *
  */
-void x_window_kill(xcb_window_t window, kill_window_t kill_window);
+void x_draw_decoration(Con *con);
 
 /**
- * Draws the decoration of the given container onto its parent.
+ * Returns true if the given container and all of its descendants are unmapped
+ * and have not changed since the last x_push_changes(). Pushing (or
+ * decorating) such a subtree again would not change anything.
  *
  */
-void x_draw_decoration(Con *con);
+bool x_con_is_idle(Con *con);
+
+/**
+ * Frees the cached title bar of the given container (if any).
+ *
+ */
+void x_deco_cache_free(Con *con);
 
 /**
  * Recursively calls x_draw_decoration. This cannot be done in x_push_node
@@ -117,6 +151,12 @@ void x_set_name(Con *con, const char *name);
  */
 void update_shmlog_atom(void);
 
+/**
+ * Set up the I3_TREE_SHM_PATH atom.
+ *
+ */
+void update_tree_shm_atom(void);
+
 /**
  * Sets up i3 specific atoms (I3_SOCKET_PATH and I3_CONFIG_PATH)
  *
@@ -130,6 +170,21 @@ void x_set_i3_atoms(void);
  */
 void x_set_warp_to(Rect *rect);
 
+/**
+ * Remembers the pointer position reported by an event for the given window
+ * (root coordinates). x_push_changes() uses it to decide whether to warp the
+ * pointer instead of querying its position.
+ *
+ */
+void x_pointer_moved(xcb_window_t window, int16_t root_x, int16_t root_y);
+
+/**
+ * Forgets the pointer position, e.g. while i3 does not receive the events
+ * which would report its changes. The next warp queries it again.
+ *
+ */
+void x_pointer_unknown(void);
+
 /**
  * Applies the given mask to the event mask of every i3 window decoration X11
  * window. This is useful to disable EnterNotify while resizing so that focus
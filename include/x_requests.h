@@ -0,0 +1,34 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * x_requests.h: Counts the X requests issued by src/x.c and src/xcb.c per kind
+ *               (see stats_x_request_t) by wrapping the xcb functions in
+ *               macros of the same name. Has to be included after all other
+ *               headers, so that the declarations are not affected.
+ *
+ */
+#pragma once
+
+#include <config.h>
+
+#define COUNT_X_REQUEST(kind, call) (stats_x_requests[(kind)]++, (call))
+
+#define xcb_configure_window(...) COUNT_X_REQUEST(STATS_X_CONFIGURE_WINDOW, xcb_configure_window(__VA_ARGS__))
+#define xcb_map_window(...) COUNT_X_REQUEST(STATS_X_MAP_WINDOW, xcb_map_window(__VA_ARGS__))
+#define xcb_unmap_window(...) COUNT_X_REQUEST(STATS_X_UNMAP_WINDOW, xcb_unmap_window(__VA_ARGS__))
+#define xcb_change_window_attributes(...) COUNT_X_REQUEST(STATS_X_CHANGE_WINDOW_ATTRIBUTES, xcb_change_window_attributes(__VA_ARGS__))
+#define xcb_change_property(...) COUNT_X_REQUEST(STATS_X_CHANGE_PROPERTY, xcb_change_property(__VA_ARGS__))
+#define xcb_delete_property(...) COUNT_X_REQUEST(STATS_X_CHANGE_PROPERTY, xcb_delete_property(__VA_ARGS__))
+/* The decorations are drawn using cairo and copied to the frames. */
+#define draw_util_copy_surface(...) COUNT_X_REQUEST(STATS_X_COPY_AREA, draw_util_copy_surface(__VA_ARGS__))
+#define xcb_shape_combine(...) COUNT_X_REQUEST(STATS_X_SHAPE, xcb_shape_combine(__VA_ARGS__))
+#define xcb_shape_mask(...) COUNT_X_REQUEST(STATS_X_SHAPE, xcb_shape_mask(__VA_ARGS__))
+#define xcb_shape_rectangles(...) COUNT_X_REQUEST(STATS_X_SHAPE, xcb_shape_rectangles(__VA_ARGS__))
+#define xcb_set_input_focus(...) COUNT_X_REQUEST(STATS_X_SET_INPUT_FOCUS, xcb_set_input_focus(__VA_ARGS__))
+#define xcb_get_property_reply(...) COUNT_X_REQUEST(STATS_X_ROUND_TRIP, xcb_get_property_reply(__VA_ARGS__))
+#define xcb_query_pointer_reply(...) COUNT_X_REQUEST(STATS_X_ROUND_TRIP, xcb_query_pointer_reply(__VA_ARGS__))
+#define xcb_icccm_get_wm_protocols_reply(...) COUNT_X_REQUEST(STATS_X_ROUND_TRIP, xcb_icccm_get_wm_protocols_reply(__VA_ARGS__))
+#define xcb_request_check(...) COUNT_X_REQUEST(STATS_X_ROUND_TRIP, xcb_request_check(__VA_ARGS__))
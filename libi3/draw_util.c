@@ -14,6 +14,13 @@
 #include <xcb/xcb.h>
 #include <xcb/xcb_aux.h>
 
+#ifdef HAVE_XCB_SHM
+#include <errno.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <xcb/shm.h>
+#endif
+
 /* The default visual_type to use if none is specified when creating the surface. Must be defined globally. */
 extern xcb_visualtype_t *visual_type;
 
@@ -155,6 +162,21 @@ void draw_util_text(i3String *text, surface_t *surface, color_t fg_color, color_
     cairo_surface_mark_dirty(surface->surface);
 }
 
+static void draw_scaled(cairo_surface_t *source, int src_width, int src_height,
+                        surface_t *surface, int x, int y, int width, int height) {
+    cairo_save(surface->cr);
+
+    cairo_translate(surface->cr, x, y);
+
+    double scale = MIN((double)width / src_width, (double)height / src_height);
+    cairo_scale(surface->cr, scale, scale);
+
+    cairo_set_source_surface(surface->cr, source, 0, 0);
+    cairo_paint(surface->cr);
+
+    cairo_restore(surface->cr);
+}
+
 /**
  * Draw the given image using libi3.
  * This function is a convenience wrapper and takes care of flushing the
@@ -164,19 +186,188 @@ void draw_util_text(i3String *text, surface_t *surface, color_t fg_color, color_
 void draw_util_image(cairo_surface_t *image, surface_t *surface, int x, int y, int width, int height) {
     RETURN_UNLESS_SURFACE_INITIALIZED(surface);
 
-    cairo_save(surface->cr);
+    draw_scaled(image, cairo_image_surface_get_width(image), cairo_image_surface_get_height(image),
+                surface, x, y, width, height);
+}
 
-    cairo_translate(surface->cr, x, y);
+/*
+ * Returns the 32-bit TrueColor visual of the root screen, or NULL if there is
+ * none.
+ *
+ */
+static xcb_visualtype_t *argb_visual(void) {
+    xcb_depth_iterator_t depth_iter;
+    for (depth_iter = xcb_screen_allowed_depths_iterator(root_screen);
+         depth_iter.rem;
+         xcb_depth_next(&depth_iter)) {
+        if (depth_iter.data->depth != 32) {
+            continue;
+        }
+        xcb_visualtype_iterator_t visual_iter;
+        for (visual_iter = xcb_depth_visuals_iterator(depth_iter.data);
+             visual_iter.rem;
+             xcb_visualtype_next(&visual_iter)) {
+            if (visual_iter.data->_class == XCB_VISUAL_CLASS_TRUE_COLOR) {
+                return visual_iter.data;
+            }
+        }
+    }
+    return NULL;
+}
 
-    const int src_width = cairo_image_surface_get_width(image);
-    const int src_height = cairo_image_surface_get_height(image);
-    double scale = MIN((double)width / src_width, (double)height / src_height);
-    cairo_scale(surface->cr, scale, scale);
+#ifdef HAVE_XCB_SHM
+/* Smaller images are sent with PutImage, which needs no round trip. */
+#define SHM_MIN_BYTES (16 * 1024)
 
-    cairo_set_source_surface(surface->cr, image, 0, 0);
-    cairo_paint(surface->cr);
+/* Whether attaching a shared memory segment works: -1 until the first attempt.
+ * It fails if the X server runs on a different machine. */
+static int shm_usable = -1;
 
-    cairo_restore(surface->cr);
+/*
+ * Copies the image into a shared memory segment and lets the X server read it
+ * from there. Returns false if MIT-SHM cannot be used.
+ *
+ */
+static bool put_image_shm(xcb_connection_t *conn, xcb_drawable_t drawable, xcb_gcontext_t gc,
+                          const uint8_t *data, int width, int height, int stride) {
+    const size_t row_bytes = (size_t)width * 4;
+    const size_t size = row_bytes * height;
+    if (shm_usable == 0 || size < SHM_MIN_BYTES) {
+        return false;
+    }
+    if (shm_usable == -1) {
+        const xcb_query_extension_reply_t *extension = xcb_get_extension_data(conn, &xcb_shm_id);
+        if (extension == NULL || !extension->present) {
+            shm_usable = 0;
+            return false;
+        }
+    }
+
+    const int shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+    if (shmid == -1) {
+        ELOG("Could not create a shared memory segment of %zu bytes: %s\n", size, strerror(errno));
+        return false;
+    }
+    uint8_t *segment = shmat(shmid, NULL, 0);
+    if (segment == (void *)-1) {
+        ELOG("Could not attach the shared memory segment: %s\n", strerror(errno));
+        shmctl(shmid, IPC_RMID, NULL);
+        return false;
+    }
+    for (int row = 0; row < height; row++) {
+        memcpy(segment + row * row_bytes, data + (size_t)row * stride, row_bytes);
+    }
+
+    /* The segment can only be removed once the X server attached it, so this
+     * needs a round trip. Uploads are rare, so that is fine. */
+    xcb_shm_seg_t seg = xcb_generate_id(conn);
+    xcb_generic_error_t *error = xcb_request_check(conn, xcb_shm_attach_checked(conn, seg, shmid, false));
+    shmctl(shmid, IPC_RMID, NULL);
+    shmdt(segment);
+    if (error != NULL) {
+        LOG("MIT-SHM is not usable (error %d), uploading images with PutImage\n", error->error_code);
+        free(error);
+        shm_usable = 0;
+        return false;
+    }
+    shm_usable = 1;
+
+    xcb_shm_put_image(conn, drawable, gc, width, height, 0, 0, width, height, 0, 0,
+                      32, XCB_IMAGE_FORMAT_Z_PIXMAP, false, seg, 0);
+    xcb_shm_detach(conn, seg);
+    return true;
+}
+#endif
+
+/*
+ * Sends the image with PutImage requests, as many rows per request as the
+ * maximum request length allows.
+ *
+ */
+static void put_image(xcb_connection_t *conn, xcb_drawable_t drawable, xcb_gcontext_t gc,
+                      const uint8_t *data, int width, int height, int stride) {
+    const size_t row_bytes = (size_t)width * 4;
+    const size_t max_bytes = (size_t)xcb_get_maximum_request_length(conn) * 4 - sizeof(xcb_put_image_request_t);
+    int rows_per_request = max_bytes / row_bytes;
+    if (rows_per_request == 0) {
+        rows_per_request = 1;
+    }
+
+    uint8_t *rows = NULL;
+    if ((size_t)stride != row_bytes) {
+        rows = smalloc(row_bytes * rows_per_request);
+    }
+
+    for (int y = 0; y < height; y += rows_per_request) {
+        const int num_rows = MIN(rows_per_request, height - y);
+        const uint8_t *chunk = data + (size_t)y * stride;
+        if (rows != NULL) {
+            for (int row = 0; row < num_rows; row++) {
+                memcpy(rows + row * row_bytes, chunk + (size_t)row * stride, row_bytes);
+            }
+            chunk = rows;
+        }
+        xcb_put_image(conn, XCB_IMAGE_FORMAT_Z_PIXMAP, drawable, gc, width, num_rows, 0, y,
+                      0, 32, num_rows * row_bytes, chunk);
+    }
+    free(rows);
+}
+
+/*
+ * Uploads the image (an ARGB32 Cairo image surface) into a new pixmap, so that
+ * drawing it with draw_util_image_pixmap() only copies it within the X server
+ * instead of sending the pixels again. They are passed in shared memory
+ * (MIT-SHM) if the X server supports it and runs on the same machine.
+ *
+ * Returns false if the image cannot be uploaded (no 32-bit visual, different
+ * byte order), in which case it has to be drawn with draw_util_image().
+ *
+ */
+bool draw_util_image_upload(xcb_connection_t *conn, cairo_surface_t *image, surface_t *uploaded) {
+    const uint32_t one = 1;
+    const uint8_t image_byte_order = (*(const uint8_t *)&one == 1 ? XCB_IMAGE_ORDER_LSB_FIRST : XCB_IMAGE_ORDER_MSB_FIRST);
+    if (cairo_image_surface_get_format(image) != CAIRO_FORMAT_ARGB32 ||
+        xcb_get_setup(conn)->image_byte_order != image_byte_order) {
+        return false;
+    }
+
+    xcb_visualtype_t *visual = argb_visual();
+    if (visual == NULL) {
+        return false;
+    }
+
+    const int width = cairo_image_surface_get_width(image);
+    const int height = cairo_image_surface_get_height(image);
+    if (width == 0 || height == 0) {
+        return false;
+    }
+
+    xcb_pixmap_t pixmap = xcb_generate_id(conn);
+    xcb_create_pixmap(conn, 32, pixmap, root_screen->root, width, height);
+    draw_util_surface_init(conn, uploaded, pixmap, visual, width, height);
+
+    cairo_surface_flush(image);
+    const uint8_t *data = cairo_image_surface_get_data(image);
+    const int stride = cairo_image_surface_get_stride(image);
+#ifdef HAVE_XCB_SHM
+    if (put_image_shm(conn, pixmap, uploaded->gc, data, width, height, stride)) {
+        return true;
+    }
+#endif
+    put_image(conn, pixmap, uploaded->gc, data, width, height, stride);
+    return true;
+}
+
+/*
+ * Draws an image uploaded with draw_util_image_upload(), scaled like
+ * draw_util_image().
+ *
+ */
+void draw_util_image_pixmap(surface_t *image, surface_t *surface, int x, int y, int width, int height) {
+    RETURN_UNLESS_SURFACE_INITIALIZED(image);
+    RETURN_UNLESS_SURFACE_INITIALIZED(surface);
+
+    draw_scaled(image->surface, image->width, image->height, surface, x, y, width, height);
 }
 
 /*
@@ -206,6 +397,35 @@ void draw_util_rectangle(surface_t *surface, color_t color, double x, double y,
     cairo_restore(surface->cr);
 }
 
+/*
+ * Draws several filled rectangles of the same color as a single path, which is
+ * cheaper than one draw_util_rectangle() call per rectangle.
+ *
+ */
+void draw_util_rectangles(surface_t *surface, color_t color, const xcb_rectangle_t *rectangles, size_t count) {
+    RETURN_UNLESS_SURFACE_INITIALIZED(surface);
+
+    if (count == 0) {
+        return;
+    }
+
+    cairo_save(surface->cr);
+
+    cairo_set_operator(surface->cr, CAIRO_OPERATOR_SOURCE);
+    draw_util_set_source_color(surface, color);
+
+    /* All rectangles have the same orientation, so overlapping ones don’t cut
+     * holes into each other with the default (winding) fill rule. */
+    for (size_t i = 0; i < count; i++) {
+        cairo_rectangle(surface->cr, rectangles[i].x, rectangles[i].y, rectangles[i].width, rectangles[i].height);
+    }
+    cairo_fill(surface->cr);
+
+    CAIRO_SURFACE_FLUSH(surface->surface);
+
+    cairo_restore(surface->cr);
+}
+
 /*
  * Clears a surface with the given color.
  *
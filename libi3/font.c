@@ -6,6 +6,7 @@
  *
  */
 #include "libi3.h"
+#include "queue.h"
 
 #include <assert.h>
 #include <cairo/cairo-xcb.h>
@@ -22,6 +23,37 @@ static double pango_font_red;
 static double pango_font_green;
 static double pango_font_blue;
 
+/* Maximum number of entries in the text width cache. */
+#define TEXT_WIDTH_CACHE_SIZE 512
+
+struct text_width_entry {
+    /* Markup flag ('0' or '1') followed by the UTF-8 text. */
+    char *key;
+    int width;
+
+    TAILQ_ENTRY(text_width_entry) lru;
+};
+
+/* Widths of recently measured strings for the current font, most recently
+ * used first. The cache is cleared whenever the font changes. */
+static hashmap_t *text_width_map = NULL;
+static TAILQ_HEAD(text_width_head, text_width_entry) text_width_lru =
+    TAILQ_HEAD_INITIALIZER(text_width_lru);
+static uint64_t text_width_hits = 0;
+static uint64_t text_width_misses = 0;
+
+static void text_width_cache_clear(void) {
+    while (!TAILQ_EMPTY(&text_width_lru)) {
+        struct text_width_entry *entry = TAILQ_FIRST(&text_width_lru);
+        TAILQ_REMOVE(&text_width_lru, entry, lru);
+        free(entry->key);
+        free(entry);
+    }
+    if (text_width_map != NULL) {
+        hashmap_clear(text_width_map);
+    }
+}
+
 static PangoLayout *create_layout_with_dpi(cairo_t *cr) {
     PangoLayout *layout;
     PangoContext *context;
@@ -34,9 +66,88 @@ static PangoLayout *create_layout_with_dpi(cairo_t *cr) {
     return layout;
 }
 
+/* Setting up a PangoLayout (and its PangoContext) is much more expensive than
+ * laying out a short string, so the layouts are kept around for the current
+ * font and only get new text and attributes for every call. We keep one
+ * layout per kind of target surface, since pango_cairo_update_layout() has to
+ * redo the font setup whenever the font options of the target change. */
+#define MAX_DRAW_LAYOUTS 4
+
+static struct draw_layout {
+    cairo_surface_type_t type;
+    cairo_content_t content;
+    PangoLayout *layout;
+} draw_layouts[MAX_DRAW_LAYOUTS];
+static int num_draw_layouts = 0;
+
+/* Used by predict_text_width_pango(). */
+static cairo_surface_t *measure_surface = NULL;
+static cairo_t *measure_cr = NULL;
+static PangoLayout *measure_layout = NULL;
+
+static void free_pango_layouts(void) {
+    for (int i = 0; i < num_draw_layouts; i++) {
+        g_object_unref(draw_layouts[i].layout);
+    }
+    num_draw_layouts = 0;
+
+    if (measure_layout != NULL) {
+        g_object_unref(measure_layout);
+        cairo_destroy(measure_cr);
+        cairo_surface_destroy(measure_surface);
+        measure_layout = NULL;
+        measure_cr = NULL;
+        measure_surface = NULL;
+    }
+}
+
+/*
+ * Returns the layout to use for drawing onto the given surface with the
+ * current font.
+ *
+ */
+static PangoLayout *get_draw_layout(cairo_t *cr, cairo_surface_t *surface) {
+    const cairo_surface_type_t type = cairo_surface_get_type(surface);
+    const cairo_content_t content = cairo_surface_get_content(surface);
+
+    for (int i = 0; i < num_draw_layouts; i++) {
+        if (draw_layouts[i].type == type && draw_layouts[i].content == content) {
+            return draw_layouts[i].layout;
+        }
+    }
+
+    if (num_draw_layouts == MAX_DRAW_LAYOUTS) {
+        /* Unlikely: i3 and i3bar only draw onto XCB surfaces. */
+        g_object_unref(draw_layouts[--num_draw_layouts].layout);
+    }
+
+    PangoLayout *layout = create_layout_with_dpi(cr);
+    pango_layout_set_font_description(layout, savedFont->specific.pango_desc);
+    pango_layout_set_wrap(layout, PANGO_WRAP_CHAR);
+    pango_layout_set_ellipsize(layout, PANGO_ELLIPSIZE_END);
+
+    draw_layouts[num_draw_layouts++] = (struct draw_layout){
+        .type = type,
+        .content = content,
+        .layout = layout,
+    };
+    return layout;
+}
+
+static void set_layout_text(PangoLayout *layout, const char *text, size_t text_len, bool pango_markup) {
+    if (pango_markup) {
+        pango_layout_set_markup(layout, text, text_len);
+    } else {
+        /* Drop the attributes of a previous markup string. */
+        pango_layout_set_attributes(layout, NULL);
+        pango_layout_set_text(layout, text, text_len);
+    }
+}
+
 /*
  * Loads a Pango font description into an i3Font structure. Returns true
- * on success, false otherwise.
+ * on success, false otherwise. The height is determined by
+ * measure_pango_font().
  *
  */
 static bool load_pango_font(i3Font *font, const char *desc) {
@@ -56,6 +167,17 @@ static bool load_pango_font(i3Font *font, const char *desc) {
      * that would need root_visual_type */
     root_visual_type = get_visualtype(root_screen);
 
+    /* Set the font type and return successfully */
+    font->type = FONT_TYPE_PANGO;
+    return true;
+}
+
+/*
+ * Computes the height of a Pango font. This is the expensive part of loading
+ * the font, since Pango has to find and open the font files.
+ *
+ */
+static void measure_pango_font(i3Font *font) {
     /* Create a dummy Pango layout to compute the font height */
     cairo_surface_t *surface = cairo_xcb_surface_create(conn, root_screen->root, root_visual_type, 1, 1);
     cairo_t *cr = cairo_create(surface);
@@ -71,10 +193,6 @@ static bool load_pango_font(i3Font *font, const char *desc) {
     g_object_unref(layout);
     cairo_destroy(cr);
     cairo_surface_destroy(surface);
-
-    /* Set the font type and return successfully */
-    font->type = FONT_TYPE_PANGO;
-    return true;
 }
 
 /*
@@ -84,21 +202,12 @@ static bool load_pango_font(i3Font *font, const char *desc) {
 static void draw_text_pango(const char *text, size_t text_len,
                             xcb_drawable_t drawable, cairo_surface_t *surface,
                             int x, int y, int max_width, bool pango_markup) {
-    /* Create the Pango layout */
-    /* root_visual_type is cached in load_pango_font */
     cairo_t *cr = cairo_create(surface);
-    PangoLayout *layout = create_layout_with_dpi(cr);
+    PangoLayout *layout = get_draw_layout(cr, surface);
     gint height;
 
-    pango_layout_set_font_description(layout, savedFont->specific.pango_desc);
     pango_layout_set_width(layout, max_width * PANGO_SCALE);
-    pango_layout_set_wrap(layout, PANGO_WRAP_CHAR);
-    pango_layout_set_ellipsize(layout, PANGO_ELLIPSIZE_END);
-
-    if (pango_markup)
-        pango_layout_set_markup(layout, text, text_len);
-    else
-        pango_layout_set_text(layout, text, text_len);
+    set_layout_text(layout, text, text_len, pango_markup);
 
     /* Do the drawing */
     cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
@@ -110,8 +219,6 @@ static void draw_text_pango(const char *text, size_t text_len,
     cairo_move_to(cr, x, y - yoffset);
     pango_cairo_show_layout(cr, layout);
 
-    /* Free resources */
-    g_object_unref(layout);
     cairo_destroy(cr);
 }
 
@@ -120,28 +227,20 @@ static void draw_text_pango(const char *text, size_t text_len,
  *
  */
 static int predict_text_width_pango(const char *text, size_t text_len, bool pango_markup) {
-    /* Create a dummy Pango layout */
-    /* root_visual_type is cached in load_pango_font */
-    cairo_surface_t *surface = cairo_xcb_surface_create(conn, root_screen->root, root_visual_type, 1, 1);
-    cairo_t *cr = cairo_create(surface);
-    PangoLayout *layout = create_layout_with_dpi(cr);
+    if (measure_layout == NULL) {
+        /* root_visual_type is cached in load_pango_font */
+        measure_surface = cairo_xcb_surface_create(conn, root_screen->root, root_visual_type, 1, 1);
+        measure_cr = cairo_create(measure_surface);
+        measure_layout = create_layout_with_dpi(measure_cr);
+        pango_layout_set_font_description(measure_layout, savedFont->specific.pango_desc);
+    }
 
     /* Get the font width */
     gint width;
-    pango_layout_set_font_description(layout, savedFont->specific.pango_desc);
-
-    if (pango_markup)
-        pango_layout_set_markup(layout, text, text_len);
-    else
-        pango_layout_set_text(layout, text, text_len);
+    set_layout_text(measure_layout, text, text_len, pango_markup);
 
-    pango_cairo_update_layout(cr, layout);
-    pango_layout_get_pixel_size(layout, &width, NULL);
-
-    /* Free resources */
-    g_object_unref(layout);
-    cairo_destroy(cr);
-    cairo_surface_destroy(surface);
+    pango_cairo_update_layout(measure_cr, measure_layout);
+    pango_layout_get_pixel_size(measure_layout, &width, NULL);
 
     return width;
 }
@@ -153,12 +252,27 @@ static int predict_text_width_pango(const char *text, size_t text_len, bool pang
  *
  */
 i3Font load_font(const char *pattern, const bool fallback) {
+    i3Font font = load_font_async(pattern, fallback);
+    finish_font_loading(&font);
+    return font;
+}
+
+/*
+ * Like load_font(), but only sends the requests for opening the font without
+ * waiting for the X server, so that other work can be done in the meantime.
+ * The font must be completed with finish_font_loading() before it is used for
+ * drawing or measuring text, or before its height is used.
+ *
+ */
+i3Font load_font_async(const char *pattern, const bool fallback) {
     /* if any font was previously loaded, free it now */
     free_font();
 
     i3Font font;
     font.type = FONT_TYPE_NONE;
+    font.height = 0;
     font.pattern = NULL;
+    font.loading = false;
 
     /* No XCB connection, return early because we're just validating the
      * configuration file. */
@@ -171,34 +285,55 @@ i3Font load_font(const char *pattern, const bool fallback) {
         const char *font_pattern = pattern + strlen("pango:");
         if (load_pango_font(&font, font_pattern)) {
             font.pattern = sstrdup(pattern);
+            font.loading = true;
             return font;
         }
     } else if (strlen(pattern) > strlen("xft:") && !strncmp(pattern, "xft:", strlen("xft:"))) {
         const char *font_pattern = pattern + strlen("xft:");
         if (load_pango_font(&font, font_pattern)) {
             font.pattern = sstrdup(pattern);
+            font.loading = true;
             return font;
         }
     }
 
-    /* Send all our requests first */
+    /* Send our requests, the replies are read by finish_font_loading(). */
     font.specific.xcb.id = xcb_generate_id(conn);
-    xcb_void_cookie_t font_cookie = xcb_open_font_checked(conn, font.specific.xcb.id,
+    font.specific.xcb.open_cookie = xcb_open_font_checked(conn, font.specific.xcb.id,
                                                           strlen(pattern), pattern);
-    xcb_query_font_cookie_t info_cookie = xcb_query_font(conn, font.specific.xcb.id);
+    font.specific.xcb.info_cookie = xcb_query_font(conn, font.specific.xcb.id);
+    font.specific.xcb.fallback = fallback;
+    font.specific.xcb.info = NULL;
+    font.specific.xcb.table = NULL;
+    font.specific.xcb.widths = NULL;
+    font.pattern = sstrdup(pattern);
+    font.type = FONT_TYPE_XCB;
+    font.loading = true;
+    return font;
+}
+
+/*
+ * Reads the replies to the requests sent by load_font_async() for an X core
+ * font, falling back to 'fixed' or '-misc-*' if it could not be opened.
+ *
+ */
+static void finish_xcb_font(i3Font *font) {
+    const char *pattern = font->pattern;
+    xcb_void_cookie_t font_cookie = font->specific.xcb.open_cookie;
+    xcb_query_font_cookie_t info_cookie = font->specific.xcb.info_cookie;
 
     /* Check for errors. If errors, fall back to default font. */
     xcb_generic_error_t *error;
     error = xcb_request_check(conn, font_cookie);
 
     /* If we fail to open font, fall back to 'fixed' */
-    if (fallback && error != NULL) {
+    if (font->specific.xcb.fallback && error != NULL) {
         ELOG("Could not open font %s (X error %d). Trying fallback to 'fixed'.\n",
              pattern, error->error_code);
         pattern = "fixed";
-        font_cookie = xcb_open_font_checked(conn, font.specific.xcb.id,
+        font_cookie = xcb_open_font_checked(conn, font->specific.xcb.id,
                                             strlen(pattern), pattern);
-        info_cookie = xcb_query_font(conn, font.specific.xcb.id);
+        info_cookie = xcb_query_font(conn, font->specific.xcb.id);
 
         /* Check if we managed to open 'fixed' */
         free(error);
@@ -208,9 +343,9 @@ i3Font load_font(const char *pattern, const bool fallback) {
         if (error != NULL) {
             ELOG("Could not open fallback font 'fixed', trying with '-misc-*'.\n");
             pattern = "-misc-*";
-            font_cookie = xcb_open_font_checked(conn, font.specific.xcb.id,
+            font_cookie = xcb_open_font_checked(conn, font->specific.xcb.id,
                                                 strlen(pattern), pattern);
-            info_cookie = xcb_query_font(conn, font.specific.xcb.id);
+            info_cookie = xcb_query_font(conn, font->specific.xcb.id);
 
             free(error);
             if ((error = xcb_request_check(conn, font_cookie)) != NULL)
@@ -218,28 +353,54 @@ i3Font load_font(const char *pattern, const bool fallback) {
                                    "(fixed or -misc-*): X11 error %d",
                      error->error_code);
         }
+
+        free(font->pattern);
+        font->pattern = sstrdup(pattern);
     }
     free(error);
 
-    font.pattern = sstrdup(pattern);
     LOG("Using X font %s\n", pattern);
 
     /* Get information (height/name) for this font */
-    if (!(font.specific.xcb.info = xcb_query_font_reply(conn, info_cookie, NULL)))
+    if (!(font->specific.xcb.info = xcb_query_font_reply(conn, info_cookie, NULL)))
         errx(EXIT_FAILURE, "Could not load font \"%s\"", pattern);
 
     /* Get the font table, if possible */
-    if (xcb_query_font_char_infos_length(font.specific.xcb.info) == 0)
-        font.specific.xcb.table = NULL;
+    if (xcb_query_font_char_infos_length(font->specific.xcb.info) == 0)
+        font->specific.xcb.table = NULL;
     else
-        font.specific.xcb.table = xcb_query_font_char_infos(font.specific.xcb.info);
+        font->specific.xcb.table = xcb_query_font_char_infos(font->specific.xcb.info);
+
+    /* Without a font table, the widths are queried row by row. */
+    if (font->specific.xcb.table == NULL)
+        font->specific.xcb.widths = scalloc(256, sizeof(int16_t *));
 
     /* Calculate the font height */
-    font.height = font.specific.xcb.info->font_ascent + font.specific.xcb.info->font_descent;
+    font->height = font->specific.xcb.info->font_ascent + font->specific.xcb.info->font_descent;
+}
 
-    /* Set the font type and return successfully */
-    font.type = FONT_TYPE_XCB;
-    return font;
+/*
+ * Waits for the font loaded by load_font_async() and gets its metrics. Does
+ * nothing for fonts which are already complete.
+ *
+ */
+void finish_font_loading(i3Font *font) {
+    if (!font->loading) {
+        return;
+    }
+    font->loading = false;
+
+    switch (font->type) {
+        case FONT_TYPE_NONE:
+            /* Nothing to do */
+            break;
+        case FONT_TYPE_XCB:
+            finish_xcb_font(font);
+            break;
+        case FONT_TYPE_PANGO:
+            measure_pango_font(font);
+            break;
+    }
 }
 
 /*
@@ -247,7 +408,9 @@ i3Font load_font(const char *pattern, const bool fallback) {
  *
  */
 void set_font(i3Font *font) {
+    free_pango_layouts();
     savedFont = font;
+    text_width_cache_clear();
 }
 
 /*
@@ -260,15 +423,28 @@ void free_font(void) {
     if (savedFont == NULL)
         return;
 
+    text_width_cache_clear();
+    free_pango_layouts();
+
     free(savedFont->pattern);
     switch (savedFont->type) {
         case FONT_TYPE_NONE:
             /* Nothing to do */
             break;
         case FONT_TYPE_XCB: {
+            if (savedFont->loading) {
+                xcb_discard_reply(conn, savedFont->specific.xcb.open_cookie.sequence);
+                xcb_discard_reply(conn, savedFont->specific.xcb.info_cookie.sequence);
+            }
             /* Close the font and free the info */
             xcb_close_font(conn, savedFont->specific.xcb.id);
             free(savedFont->specific.xcb.info);
+            if (savedFont->specific.xcb.widths != NULL) {
+                for (int row = 0; row < 256; row++) {
+                    free(savedFont->specific.xcb.widths[row]);
+                }
+                free(savedFont->specific.xcb.widths);
+            }
             break;
         }
         case FONT_TYPE_PANGO:
@@ -357,6 +533,7 @@ static void draw_text_xcb(const xcb_char2b_t *text, size_t text_len, xcb_drawabl
 void draw_text(i3String *text, xcb_drawable_t drawable, xcb_gcontext_t gc,
                cairo_surface_t *surface, int x, int y, int max_width) {
     assert(savedFont != NULL);
+    assert(!savedFont->loading);
 
     switch (savedFont->type) {
         case FONT_TYPE_NONE:
@@ -374,32 +551,46 @@ void draw_text(i3String *text, xcb_drawable_t drawable, xcb_gcontext_t gc,
     }
 }
 
-static int xcb_query_text_width(const xcb_char2b_t *text, size_t text_len) {
-    /* Make the user know we’re using the slow path, but only once. */
-    static bool first_invocation = true;
-    if (first_invocation) {
-        fprintf(stderr, "Using slow code path for text extents\n");
-        first_invocation = false;
+/*
+ * Returns the widths of the 256 glyphs in the given row (the first byte of
+ * UCS-2) of the current font, which has no font table. The X server is asked
+ * for the whole row when it is first used: that is a single round trip,
+ * afterwards all widths in the row are known locally.
+ *
+ */
+static const int16_t *xcb_glyph_widths(uint8_t row) {
+    int16_t **rows = savedFont->specific.xcb.widths;
+    if (rows[row] != NULL) {
+        return rows[row];
     }
 
-    /* Query the text width */
-    xcb_generic_error_t *error;
-    xcb_query_text_extents_cookie_t cookie = xcb_query_text_extents(conn,
-                                                                    savedFont->specific.xcb.id, text_len, (xcb_char2b_t *)text);
-    xcb_query_text_extents_reply_t *reply = xcb_query_text_extents_reply(conn,
-                                                                         cookie, &error);
-    if (reply == NULL) {
-        /* We return a safe estimate because a rendering error is better than
-         * a crash. Plus, the user will see the error in their log. */
-        fprintf(stderr, "Could not get text extents (X error code %d)\n",
-                error->error_code);
-        free(error);
-        return savedFont->specific.xcb.info->max_bounds.character_width * text_len;
+    /* Send all requests first, then collect the replies. */
+    xcb_query_text_extents_cookie_t cookies[256];
+    for (int col = 0; col < 256; col++) {
+        xcb_char2b_t glyph = {.byte1 = row, .byte2 = col};
+        cookies[col] = xcb_query_text_extents(conn, savedFont->specific.xcb.id, 1, &glyph);
     }
 
-    int width = reply->overall_width;
-    free(reply);
-    return width;
+    int16_t *widths = smalloc(256 * sizeof(int16_t));
+    for (int col = 0; col < 256; col++) {
+        xcb_generic_error_t *error = NULL;
+        xcb_query_text_extents_reply_t *reply = xcb_query_text_extents_reply(conn, cookies[col], &error);
+        if (reply == NULL) {
+            /* We use a safe estimate because a rendering error is better than
+             * a crash. Plus, the user will see the error in their log. */
+            if (error != NULL) {
+                ELOG("Could not get text extents (X error code %d)\n", error->error_code);
+                free(error);
+            }
+            widths[col] = savedFont->specific.xcb.info->max_bounds.character_width;
+            continue;
+        }
+        widths[col] = reply->overall_width;
+        free(reply);
+    }
+
+    rows[row] = widths;
+    return widths;
 }
 
 static int predict_text_width_xcb(const xcb_char2b_t *input, size_t text_len) {
@@ -408,8 +599,18 @@ static int predict_text_width_xcb(const xcb_char2b_t *input, size_t text_len) {
 
     int width;
     if (savedFont->specific.xcb.table == NULL) {
-        /* If we don't have a font table, fall back to querying the server */
-        width = xcb_query_text_width(input, text_len);
+        xcb_query_font_reply_t *font_info = savedFont->specific.xcb.info;
+        if (memcmp(&(font_info->min_bounds), &(font_info->max_bounds), sizeof(xcb_charinfo_t)) == 0) {
+            /* X servers leave out the font table if all glyphs have the
+             * same metrics. */
+            return font_info->max_bounds.character_width * text_len;
+        }
+
+        /* Otherwise, use the widths we got from the server. */
+        width = 0;
+        for (size_t i = 0; i < text_len; i++) {
+            width += xcb_glyph_widths(input[i].byte1)[input[i].byte2];
+        }
     } else {
         /* Save some pointers for convenience */
         xcb_query_font_reply_t *font_info = savedFont->specific.xcb.info;
@@ -446,14 +647,7 @@ static int predict_text_width_xcb(const xcb_char2b_t *input, size_t text_len) {
     return width;
 }
 
-/*
- * Predict the text width in pixels for the given text. Text must be
- * specified as an i3String.
- *
- */
-int predict_text_width(i3String *text) {
-    assert(savedFont != NULL);
-
+static int predict_text_width_uncached(i3String *text) {
     switch (savedFont->type) {
         case FONT_TYPE_NONE:
             /* Nothing to do */
@@ -467,3 +661,79 @@ int predict_text_width(i3String *text) {
     }
     assert(false);
 }
+
+/*
+ * Predict the text width in pixels for the given text. Text must be
+ * specified as an i3String.
+ *
+ * Results are kept in a bounded LRU cache (per font), since the same window
+ * titles, marks and workspace names are measured over and over again.
+ *
+ */
+int predict_text_width(i3String *text) {
+    assert(savedFont != NULL);
+    assert(!savedFont->loading);
+
+    if (savedFont->type == FONT_TYPE_NONE) {
+        return 0;
+    }
+
+    char *key;
+    sasprintf(&key, "%c%s", (i3string_is_markup(text) ? '1' : '0'), i3string_as_utf8(text));
+
+    if (text_width_map == NULL) {
+        text_width_map = hashmap_new();
+    }
+
+    struct text_width_entry *entry = hashmap_lookup_str(text_width_map, key);
+    if (entry != NULL) {
+        text_width_hits++;
+        free(key);
+        TAILQ_REMOVE(&text_width_lru, entry, lru);
+        TAILQ_INSERT_HEAD(&text_width_lru, entry, lru);
+        return entry->width;
+    }
+
+    text_width_misses++;
+    if (hashmap_size(text_width_map) >= TEXT_WIDTH_CACHE_SIZE) {
+        /* Reuse the least recently used entry. */
+        entry = TAILQ_LAST(&text_width_lru, text_width_head);
+        TAILQ_REMOVE(&text_width_lru, entry, lru);
+        hashmap_remove_str(text_width_map, entry->key);
+        free(entry->key);
+    } else {
+        entry = smalloc(sizeof(struct text_width_entry));
+    }
+
+    entry->key = key;
+    entry->width = predict_text_width_uncached(text);
+    hashmap_insert_str(text_width_map, key, entry);
+    TAILQ_INSERT_HEAD(&text_width_lru, entry, lru);
+    return entry->width;
+}
+
+/*
+ * Returns the number of cache hits and misses of predict_text_width() and the
+ * number of currently cached widths.
+ *
+ */
+void predict_text_width_stats(uint64_t *hits, uint64_t *misses, size_t *size) {
+    *hits = text_width_hits;
+    *misses = text_width_misses;
+    *size = (text_width_map != NULL ? hashmap_size(text_width_map) : 0);
+}
+
+/*
+ * Drops the least recently used widths from the cache of predict_text_width()
+ * until at most size widths are left.
+ *
+ */
+void predict_text_width_trim(size_t size) {
+    while (text_width_map != NULL && hashmap_size(text_width_map) > size) {
+        struct text_width_entry *entry = TAILQ_LAST(&text_width_lru, text_width_head);
+        TAILQ_REMOVE(&text_width_lru, entry, lru);
+        hashmap_remove_str(text_width_map, entry->key);
+        free(entry->key);
+        free(entry);
+    }
+}
@@ -7,11 +7,19 @@
  */
 #include "libi3.h"
 
+/* The result of the last call. Programs only use a single screen. */
+static xcb_screen_t *cached_screen = NULL;
+static xcb_visualtype_t *cached_visualtype = NULL;
+
 /*
  * Returns the visual type associated with the given screen.
  *
  */
 xcb_visualtype_t *get_visualtype(xcb_screen_t *screen) {
+    if (screen == cached_screen && cached_visualtype != NULL) {
+        return cached_visualtype;
+    }
+
     xcb_depth_iterator_t depth_iter;
     for (depth_iter = xcb_screen_allowed_depths_iterator(screen);
          depth_iter.rem;
@@ -20,8 +28,11 @@ xcb_visualtype_t *get_visualtype(xcb_screen_t *screen) {
         for (visual_iter = xcb_depth_visuals_iterator(depth_iter.data);
              visual_iter.rem;
              xcb_visualtype_next(&visual_iter)) {
-            if (screen->root_visual == visual_iter.data->visual_id)
+            if (screen->root_visual == visual_iter.data->visual_id) {
+                cached_screen = screen;
+                cached_visualtype = visual_iter.data;
                 return visual_iter.data;
+            }
         }
     }
     return NULL;
@@ -0,0 +1,248 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * hashmap.c: A small chained hash map with integer or string keys, used to
+ *            index i3’s data structures (e.g. containers by X11 window ID).
+ *
+ */
+#include "libi3.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define HASHMAP_INITIAL_BUCKETS 64
+
+struct hashmap_entry {
+    uint64_t hash;
+    uint64_t key;
+    /* NULL for integer keys. String keys are owned by the map. */
+    char *skey;
+    void *value;
+    struct hashmap_entry *next;
+};
+
+struct hashmap {
+    struct hashmap_entry **buckets;
+    /* Always a power of two. */
+    size_t num_buckets;
+    size_t count;
+};
+
+/*
+ * Mixes the bits of an integer key (splitmix64 finalizer). X11 IDs are
+ * allocated sequentially per client, so the low bits alone would cluster.
+ *
+ */
+static uint64_t hash_int(uint64_t key) {
+    key ^= key >> 30;
+    key *= UINT64_C(0xbf58476d1ce4e5b9);
+    key ^= key >> 27;
+    key *= UINT64_C(0x94d049bb133111eb);
+    key ^= key >> 31;
+    return key;
+}
+
+/*
+ * FNV-1a over the bytes of the string key.
+ *
+ */
+static uint64_t hash_str(const char *key) {
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+    for (const unsigned char *walk = (const unsigned char *)key; *walk != '\0'; walk++) {
+        hash ^= *walk;
+        hash *= UINT64_C(0x100000001b3);
+    }
+    return hash;
+}
+
+/*
+ * Creates a new, empty hash map.
+ *
+ */
+hashmap_t *hashmap_new(void) {
+    hashmap_t *map = scalloc(1, sizeof(hashmap_t));
+    map->num_buckets = HASHMAP_INITIAL_BUCKETS;
+    map->buckets = scalloc(map->num_buckets, sizeof(struct hashmap_entry *));
+    return map;
+}
+
+/*
+ * Frees the hash map and its keys. Values are not touched, the caller is
+ * responsible for them.
+ *
+ */
+void hashmap_free(hashmap_t *map) {
+    if (map == NULL) {
+        return;
+    }
+
+    hashmap_clear(map);
+    free(map->buckets);
+    free(map);
+}
+
+/*
+ * Removes all entries from the hash map. Values are not touched.
+ *
+ */
+void hashmap_clear(hashmap_t *map) {
+    for (size_t i = 0; i < map->num_buckets; i++) {
+        struct hashmap_entry *entry = map->buckets[i];
+        while (entry != NULL) {
+            struct hashmap_entry *next = entry->next;
+            free(entry->skey);
+            free(entry);
+            entry = next;
+        }
+        map->buckets[i] = NULL;
+    }
+    map->count = 0;
+}
+
+/*
+ * Returns the number of entries stored in the hash map.
+ *
+ */
+size_t hashmap_size(hashmap_t *map) {
+    return map->count;
+}
+
+static void hashmap_grow(hashmap_t *map) {
+    const size_t num_buckets = map->num_buckets * 2;
+    struct hashmap_entry **buckets = scalloc(num_buckets, sizeof(struct hashmap_entry *));
+
+    for (size_t i = 0; i < map->num_buckets; i++) {
+        struct hashmap_entry *entry = map->buckets[i];
+        while (entry != NULL) {
+            struct hashmap_entry *next = entry->next;
+            const size_t idx = entry->hash & (num_buckets - 1);
+            entry->next = buckets[idx];
+            buckets[idx] = entry;
+            entry = next;
+        }
+    }
+
+    free(map->buckets);
+    map->buckets = buckets;
+    map->num_buckets = num_buckets;
+}
+
+static struct hashmap_entry **hashmap_find(hashmap_t *map, uint64_t hash, uint64_t key, const char *skey) {
+    struct hashmap_entry **link = &(map->buckets[hash & (map->num_buckets - 1)]);
+    for (; *link != NULL; link = &((*link)->next)) {
+        struct hashmap_entry *entry = *link;
+        if (entry->hash != hash) {
+            continue;
+        }
+        if (skey == NULL ? (entry->skey == NULL && entry->key == key)
+                         : (entry->skey != NULL && strcmp(entry->skey, skey) == 0)) {
+            break;
+        }
+    }
+    return link;
+}
+
+static void hashmap_set(hashmap_t *map, uint64_t hash, uint64_t key, const char *skey, void *value) {
+    struct hashmap_entry **link = hashmap_find(map, hash, key, skey);
+    if (*link != NULL) {
+        (*link)->value = value;
+        return;
+    }
+
+    if (map->count + 1 > map->num_buckets / 4 * 3) {
+        hashmap_grow(map);
+        link = &(map->buckets[hash & (map->num_buckets - 1)]);
+    }
+
+    struct hashmap_entry *entry = smalloc(sizeof(struct hashmap_entry));
+    entry->hash = hash;
+    entry->key = key;
+    entry->skey = (skey ? sstrdup(skey) : NULL);
+    entry->value = value;
+    entry->next = *link;
+    *link = entry;
+    map->count++;
+}
+
+static void *hashmap_unlink(hashmap_t *map, struct hashmap_entry **link) {
+    struct hashmap_entry *entry = *link;
+    if (entry == NULL) {
+        return NULL;
+    }
+
+    void *value = entry->value;
+    *link = entry->next;
+    free(entry->skey);
+    free(entry);
+    map->count--;
+    return value;
+}
+
+/*
+ * Stores value under the given integer key, replacing any previous value.
+ *
+ */
+void hashmap_insert(hashmap_t *map, uint64_t key, void *value) {
+    hashmap_set(map, hash_int(key), key, NULL, value);
+}
+
+/*
+ * Returns the value stored under the given integer key or NULL.
+ *
+ */
+void *hashmap_lookup(hashmap_t *map, uint64_t key) {
+    struct hashmap_entry *entry = *hashmap_find(map, hash_int(key), key, NULL);
+    return (entry ? entry->value : NULL);
+}
+
+/*
+ * Removes the given integer key and returns the value which was stored under
+ * it (or NULL).
+ *
+ */
+void *hashmap_remove(hashmap_t *map, uint64_t key) {
+    return hashmap_unlink(map, hashmap_find(map, hash_int(key), key, NULL));
+}
+
+/*
+ * Stores value under the given string key (the key is copied), replacing any
+ * previous value.
+ *
+ */
+void hashmap_insert_str(hashmap_t *map, const char *key, void *value) {
+    hashmap_set(map, hash_str(key), 0, key, value);
+}
+
+/*
+ * Returns the value stored under the given string key or NULL.
+ *
+ */
+void *hashmap_lookup_str(hashmap_t *map, const char *key) {
+    struct hashmap_entry *entry = *hashmap_find(map, hash_str(key), 0, key);
+    return (entry ? entry->value : NULL);
+}
+
+/*
+ * Removes the given string key and returns the value which was stored under
+ * it (or NULL).
+ *
+ */
+void *hashmap_remove_str(hashmap_t *map, const char *key) {
+    return hashmap_unlink(map, hashmap_find(map, hash_str(key), 0, key));
+}
+
+/*
+ * Calls cb for every value in the hash map, in no particular order. The
+ * callback must not modify the hash map.
+ *
+ */
+void hashmap_foreach(hashmap_t *map, void (*cb)(void *value, void *userdata), void *userdata) {
+    for (size_t i = 0; i < map->num_buckets; i++) {
+        for (struct hashmap_entry *entry = map->buckets[i]; entry != NULL; entry = entry->next) {
+            cb(entry->value, userdata);
+        }
+    }
+}
@@ -0,0 +1,526 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * ipc_cbor.c: Conversion between JSON and the CBOR (RFC 8949) encoding of IPC
+ * replies and events.
+ *
+ */
+#include "libi3.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <yajl/yajl_gen.h>
+#include <yajl/yajl_parse.h>
+
+/* CBOR major types */
+#define CBOR_UINT 0
+#define CBOR_NEGINT 1
+#define CBOR_BYTES 2
+#define CBOR_TEXT 3
+#define CBOR_ARRAY 4
+#define CBOR_MAP 5
+#define CBOR_TAG 6
+#define CBOR_SIMPLE 7
+
+/* Additional information values */
+#define CBOR_INDEFINITE 31
+
+#define CBOR_FALSE 0xf4
+#define CBOR_TRUE 0xf5
+#define CBOR_NULL 0xf6
+#define CBOR_DOUBLE 0xfb
+#define CBOR_BREAK 0xff
+
+/* Maximum nesting of maps and arrays accepted when decoding. */
+#define CBOR_MAX_DEPTH 256
+
+/*******************************************************************************
+ * Encoding
+ ******************************************************************************/
+
+struct cbor_buffer {
+    uint8_t *data;
+    size_t length;
+    size_t size;
+};
+
+static void cbor_append(struct cbor_buffer *buf, const void *data, size_t length) {
+    if (buf->length + length > buf->size) {
+        buf->size = (buf->size == 0 ? 256 : buf->size);
+        while (buf->length + length > buf->size) {
+            buf->size *= 2;
+        }
+        buf->data = srealloc(buf->data, buf->size);
+    }
+    memcpy(buf->data + buf->length, data, length);
+    buf->length += length;
+}
+
+static void cbor_append_byte(struct cbor_buffer *buf, uint8_t byte) {
+    cbor_append(buf, &byte, 1);
+}
+
+/* Appends an initial byte with the given major type and argument, using the
+ * shortest possible encoding. */
+static void cbor_append_head(struct cbor_buffer *buf, uint8_t major, uint64_t value) {
+    uint8_t head[9];
+    size_t length;
+
+    if (value < 24) {
+        head[0] = (major << 5) | value;
+        length = 1;
+    } else if (value <= UINT8_MAX) {
+        head[0] = (major << 5) | 24;
+        length = 2;
+    } else if (value <= UINT16_MAX) {
+        head[0] = (major << 5) | 25;
+        length = 3;
+    } else if (value <= UINT32_MAX) {
+        head[0] = (major << 5) | 26;
+        length = 5;
+    } else {
+        head[0] = (major << 5) | 27;
+        length = 9;
+    }
+
+    for (size_t i = length - 1; i > 0; i--) {
+        head[i] = value & 0xff;
+        value >>= 8;
+    }
+    cbor_append(buf, head, length);
+}
+
+static int encode_null(void *ctx) {
+    cbor_append_byte(ctx, CBOR_NULL);
+    return 1;
+}
+
+static int encode_boolean(void *ctx, int val) {
+    cbor_append_byte(ctx, val ? CBOR_TRUE : CBOR_FALSE);
+    return 1;
+}
+
+static int encode_integer(void *ctx, long long val) {
+    if (val >= 0) {
+        cbor_append_head(ctx, CBOR_UINT, (uint64_t)val);
+    } else {
+        cbor_append_head(ctx, CBOR_NEGINT, (uint64_t)(-1 - val));
+    }
+    return 1;
+}
+
+static int encode_double(void *ctx, double val) {
+    uint64_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+
+    uint8_t data[9];
+    data[0] = CBOR_DOUBLE;
+    for (int i = 8; i > 0; i--) {
+        data[i] = bits & 0xff;
+        bits >>= 8;
+    }
+    cbor_append(ctx, data, sizeof(data));
+    return 1;
+}
+
+static int encode_string(void *ctx, const unsigned char *val, size_t len) {
+    cbor_append_head(ctx, CBOR_TEXT, len);
+    cbor_append(ctx, val, len);
+    return 1;
+}
+
+static int encode_start_map(void *ctx) {
+    cbor_append_byte(ctx, (CBOR_MAP << 5) | CBOR_INDEFINITE);
+    return 1;
+}
+
+static int encode_start_array(void *ctx) {
+    cbor_append_byte(ctx, (CBOR_ARRAY << 5) | CBOR_INDEFINITE);
+    return 1;
+}
+
+static int encode_end(void *ctx) {
+    cbor_append_byte(ctx, CBOR_BREAK);
+    return 1;
+}
+
+static yajl_callbacks encode_callbacks = {
+    .yajl_null = encode_null,
+    .yajl_boolean = encode_boolean,
+    .yajl_integer = encode_integer,
+    .yajl_double = encode_double,
+    .yajl_string = encode_string,
+    .yajl_start_map = encode_start_map,
+    .yajl_map_key = encode_string,
+    .yajl_end_map = encode_end,
+    .yajl_start_array = encode_start_array,
+    .yajl_end_array = encode_end,
+};
+
+/*
+ * Converts a JSON document into its CBOR encoding. Maps and arrays are
+ * encoded with indefinite length. The result is stored in a newly allocated
+ * buffer. Returns false if the JSON could not be parsed.
+ *
+ */
+bool ipc_json_to_cbor(const uint8_t *json, size_t json_length, uint8_t **cbor, size_t *cbor_length) {
+    struct cbor_buffer buf = {NULL, 0, 0};
+
+    yajl_handle handle = yajl_alloc(&encode_callbacks, NULL, &buf);
+    yajl_status state = yajl_parse(handle, json, json_length);
+    if (state == yajl_status_ok) {
+        state = yajl_complete_parse(handle);
+    }
+    yajl_free(handle);
+
+    if (state != yajl_status_ok) {
+        free(buf.data);
+        return false;
+    }
+
+    *cbor = buf.data;
+    *cbor_length = buf.length;
+    return true;
+}
+
+/*******************************************************************************
+ * Decoding
+ ******************************************************************************/
+
+struct cbor_reader {
+    const yajl_callbacks *callbacks;
+    void *ctx;
+    const uint8_t *data;
+    size_t length;
+    size_t pos;
+    int depth;
+};
+
+/* Results of decoding one item */
+#define DECODE_OK 0
+#define DECODE_BREAK 1
+#define DECODE_CANCELED 2
+#define DECODE_ERROR 3
+
+/* Reads the argument following an initial byte. */
+static bool cbor_read_argument(struct cbor_reader *r, uint8_t info, uint64_t *value) {
+    size_t bytes;
+    if (info < 24) {
+        *value = info;
+        return true;
+    } else if (info == 24) {
+        bytes = 1;
+    } else if (info == 25) {
+        bytes = 2;
+    } else if (info == 26) {
+        bytes = 4;
+    } else if (info == 27) {
+        bytes = 8;
+    } else {
+        return false;
+    }
+
+    if (r->length - r->pos < bytes) {
+        return false;
+    }
+    *value = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        *value = (*value << 8) | r->data[r->pos++];
+    }
+    return true;
+}
+
+static int decode_integer(struct cbor_reader *r, long long val) {
+    if (r->callbacks->yajl_number != NULL) {
+        char number[32];
+        const int len = snprintf(number, sizeof(number), "%lld", val);
+        return r->callbacks->yajl_number(r->ctx, number, len);
+    }
+    if (r->callbacks->yajl_integer != NULL) {
+        return r->callbacks->yajl_integer(r->ctx, val);
+    }
+    return 1;
+}
+
+static int decode_double(struct cbor_reader *r, double val) {
+    if (r->callbacks->yajl_number != NULL) {
+        char number[32];
+        const int len = snprintf(number, sizeof(number), "%.17g", val);
+        return r->callbacks->yajl_number(r->ctx, number, len);
+    }
+    if (r->callbacks->yajl_double != NULL) {
+        return r->callbacks->yajl_double(r->ctx, val);
+    }
+    return 1;
+}
+
+/* Converts an IEEE 754 half-precision float. */
+static double half_to_double(uint16_t half) {
+    const int exponent = (half >> 10) & 0x1f;
+    const int mantissa = half & 0x3ff;
+    double val;
+    if (exponent == 0) {
+        val = ldexp(mantissa, -24);
+    } else if (exponent != 31) {
+        val = ldexp(mantissa + 1024, exponent - 25);
+    } else {
+        val = (mantissa == 0 ? INFINITY : NAN);
+    }
+    return (half & 0x8000) ? -val : val;
+}
+
+#define CALLBACK(name, ...)                                                 \
+    do {                                                                    \
+        if (r->callbacks->name != NULL && !r->callbacks->name(__VA_ARGS__)) \
+            return DECODE_CANCELED;                                         \
+    } while (0)
+
+static int cbor_decode_item(struct cbor_reader *r, bool is_key);
+
+/* Decodes the contents of an array or map (after its initial byte). */
+static int cbor_decode_container(struct cbor_reader *r, bool is_map, bool indefinite, uint64_t count) {
+    if (++(r->depth) > CBOR_MAX_DEPTH) {
+        return DECODE_ERROR;
+    }
+
+    for (uint64_t i = 0; indefinite || i < count; i++) {
+        int result = cbor_decode_item(r, is_map);
+        if (result == DECODE_BREAK && indefinite) {
+            break;
+        } else if (result != DECODE_OK) {
+            return (result == DECODE_BREAK ? DECODE_ERROR : result);
+        }
+
+        if (is_map) {
+            result = cbor_decode_item(r, false);
+            if (result != DECODE_OK) {
+                return (result == DECODE_BREAK ? DECODE_ERROR : result);
+            }
+        }
+    }
+
+    r->depth--;
+    return DECODE_OK;
+}
+
+static int cbor_decode_item(struct cbor_reader *r, bool is_key) {
+    if (r->pos >= r->length) {
+        return DECODE_ERROR;
+    }
+
+    const uint8_t initial = r->data[r->pos++];
+    const uint8_t major = initial >> 5;
+    const uint8_t info = initial & 0x1f;
+
+    if (initial == CBOR_BREAK) {
+        return DECODE_BREAK;
+    }
+
+    /* Only text strings are valid map keys. */
+    if (is_key && major != CBOR_TEXT) {
+        return DECODE_ERROR;
+    }
+
+    uint64_t value = 0;
+    const bool indefinite = (info == CBOR_INDEFINITE);
+    if (!indefinite && major != CBOR_SIMPLE && !cbor_read_argument(r, info, &value)) {
+        return DECODE_ERROR;
+    }
+
+    switch (major) {
+        case CBOR_UINT:
+            if (value > LLONG_MAX) {
+                return DECODE_ERROR;
+            }
+            return (decode_integer(r, (long long)value) ? DECODE_OK : DECODE_CANCELED);
+        case CBOR_NEGINT:
+            if (value > LLONG_MAX) {
+                return DECODE_ERROR;
+            }
+            return (decode_integer(r, -1 - (long long)value) ? DECODE_OK : DECODE_CANCELED);
+        case CBOR_BYTES:
+        case CBOR_TEXT:
+            /* Chunked strings are not produced by i3. */
+            if (indefinite || value > r->length - r->pos) {
+                return DECODE_ERROR;
+            }
+            if (is_key) {
+                CALLBACK(yajl_map_key, r->ctx, r->data + r->pos, value);
+            } else {
+                CALLBACK(yajl_string, r->ctx, r->data + r->pos, value);
+            }
+            r->pos += value;
+            return DECODE_OK;
+        case CBOR_ARRAY: {
+            CALLBACK(yajl_start_array, r->ctx);
+            const int result = cbor_decode_container(r, false, indefinite, value);
+            if (result != DECODE_OK) {
+                return result;
+            }
+            CALLBACK(yajl_end_array, r->ctx);
+            return DECODE_OK;
+        }
+        case CBOR_MAP: {
+            CALLBACK(yajl_start_map, r->ctx);
+            const int result = cbor_decode_container(r, true, indefinite, value);
+            if (result != DECODE_OK) {
+                return result;
+            }
+            CALLBACK(yajl_end_map, r->ctx);
+            return DECODE_OK;
+        }
+        case CBOR_TAG:
+            /* Tags carry no information for JSON, skip them. */
+            if (indefinite) {
+                return DECODE_ERROR;
+            }
+            return cbor_decode_item(r, false);
+        case CBOR_SIMPLE:
+            switch (info) {
+                case 20:
+                    CALLBACK(yajl_boolean, r->ctx, 0);
+                    return DECODE_OK;
+                case 21:
+                    CALLBACK(yajl_boolean, r->ctx, 1);
+                    return DECODE_OK;
+                case 22:
+                case 23:
+                    CALLBACK(yajl_null, r->ctx);
+                    return DECODE_OK;
+                case 25:
+                    if (!cbor_read_argument(r, info, &value)) {
+                        return DECODE_ERROR;
+                    }
+                    return (decode_double(r, half_to_double(value)) ? DECODE_OK : DECODE_CANCELED);
+                case 26: {
+                    if (!cbor_read_argument(r, info, &value)) {
+                        return DECODE_ERROR;
+                    }
+                    const uint32_t bits = value;
+                    float f;
+                    memcpy(&f, &bits, sizeof(f));
+                    return (decode_double(r, f) ? DECODE_OK : DECODE_CANCELED);
+                }
+                case 27: {
+                    if (!cbor_read_argument(r, info, &value)) {
+                        return DECODE_ERROR;
+                    }
+                    double d;
+                    memcpy(&d, &value, sizeof(d));
+                    return (decode_double(r, d) ? DECODE_OK : DECODE_CANCELED);
+                }
+                default:
+                    return DECODE_ERROR;
+            }
+    }
+
+    return DECODE_ERROR;
+}
+
+#undef CALLBACK
+
+/*
+ * Decodes a CBOR-encoded IPC reply or event and calls the given yajl
+ * callbacks just like yajl_parse() would for the equivalent JSON, so that
+ * existing JSON parsers can be reused.
+ *
+ * Returns yajl_status_ok on success, yajl_status_client_canceled if a callback
+ * returned 0 and yajl_status_error if the data is not valid CBOR.
+ *
+ */
+yajl_status ipc_cbor_parse(const yajl_callbacks *callbacks, void *ctx, const uint8_t *cbor, size_t cbor_length) {
+    struct cbor_reader r = {
+        .callbacks = callbacks,
+        .ctx = ctx,
+        .data = cbor,
+        .length = cbor_length,
+        .pos = 0,
+        .depth = 0,
+    };
+
+    switch (cbor_decode_item(&r, false)) {
+        case DECODE_OK:
+            return (r.pos == r.length ? yajl_status_ok : yajl_status_error);
+        case DECODE_CANCELED:
+            return yajl_status_client_canceled;
+        default:
+            return yajl_status_error;
+    }
+}
+
+static int gen_null(void *ctx) {
+    return yajl_gen_null(ctx) == yajl_gen_status_ok;
+}
+
+static int gen_boolean(void *ctx, int val) {
+    return yajl_gen_bool(ctx, val) == yajl_gen_status_ok;
+}
+
+static int gen_integer(void *ctx, long long val) {
+    return yajl_gen_integer(ctx, val) == yajl_gen_status_ok;
+}
+
+static int gen_double(void *ctx, double val) {
+    return yajl_gen_double(ctx, val) == yajl_gen_status_ok;
+}
+
+static int gen_string(void *ctx, const unsigned char *val, size_t len) {
+    return yajl_gen_string(ctx, val, len) == yajl_gen_status_ok;
+}
+
+static int gen_start_map(void *ctx) {
+    return yajl_gen_map_open(ctx) == yajl_gen_status_ok;
+}
+
+static int gen_end_map(void *ctx) {
+    return yajl_gen_map_close(ctx) == yajl_gen_status_ok;
+}
+
+static int gen_start_array(void *ctx) {
+    return yajl_gen_array_open(ctx) == yajl_gen_status_ok;
+}
+
+static int gen_end_array(void *ctx) {
+    return yajl_gen_array_close(ctx) == yajl_gen_status_ok;
+}
+
+static yajl_callbacks gen_callbacks = {
+    .yajl_null = gen_null,
+    .yajl_boolean = gen_boolean,
+    .yajl_integer = gen_integer,
+    .yajl_double = gen_double,
+    .yajl_string = gen_string,
+    .yajl_start_map = gen_start_map,
+    .yajl_map_key = gen_string,
+    .yajl_end_map = gen_end_map,
+    .yajl_start_array = gen_start_array,
+    .yajl_end_array = gen_end_array,
+};
+
+/*
+ * Converts a CBOR-encoded IPC reply or event back into JSON. Returns a newly
+ * allocated, NUL-terminated string or NULL if the data is not valid CBOR.
+ *
+ */
+char *ipc_cbor_to_json(const uint8_t *cbor, size_t cbor_length) {
+    yajl_gen gen = yajl_gen_alloc(NULL);
+    char *json = NULL;
+
+    if (ipc_cbor_parse(&gen_callbacks, gen, cbor, cbor_length) == yajl_status_ok) {
+        const unsigned char *buf;
+        size_t length;
+        yajl_gen_get_buf(gen, &buf, &length);
+        json = sstrndup((const char *)buf, length);
+    }
+
+    yajl_gen_free(gen);
+    return json;
+}
@@ -32,6 +32,19 @@ int ipc_connect(const char *socket_path) {
         }
     }
 
+    if (path == NULL) {
+        /* Try the symlink which i3 creates next to its socket before
+         * connecting to the X server to read the I3_SOCKET_PATH atom. */
+        char *link_path = ipc_socket_link_path();
+        if (link_path != NULL) {
+            int sockfd = ipc_connect_impl(link_path);
+            free(link_path);
+            if (sockfd >= 0) {
+                return sockfd;
+            }
+        }
+    }
+
     if (path == NULL) {
         path = root_atom_contents("I3_SOCKET_PATH", NULL, 0);
     }
@@ -0,0 +1,50 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ */
+#include "libi3.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Returns the path of the symlink to the IPC socket of the i3 instance which
+ * manages $DISPLAY ($XDG_RUNTIME_DIR/i3/ipc-socket.<display>), or NULL if
+ * either variable is not set.
+ *
+ * Clients look at this path before asking the X server for the
+ * I3_SOCKET_PATH atom, which saves them a connection to the X server.
+ *
+ */
+char *ipc_socket_link_path(void) {
+    const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+    const char *display = getenv("DISPLAY");
+    if (runtime_dir == NULL || runtime_dir[0] == '\0' ||
+        display == NULL || display[0] == '\0') {
+        return NULL;
+    }
+
+    /* Ignore the screen number, i3 manages all screens of a display: ":0" and
+     * ":0.0" refer to the same instance. */
+    char *name = sstrdup(display);
+    char *colon = strrchr(name, ':');
+    if (colon != NULL) {
+        char *dot = strchr(colon, '.');
+        if (dot != NULL) {
+            *dot = '\0';
+        }
+    }
+    for (char *c = name; *c != '\0'; c++) {
+        if (*c == '/') {
+            *c = '_';
+        }
+    }
+
+    char *path;
+    sasprintf(&path, "%s/i3/ipc-socket.%s", runtime_dir, name);
+    free(name);
+    return path;
+}
@@ -0,0 +1,109 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * json_keys.c: Perfect hash tables for the keys of the JSON schemas i3 and
+ *              i3bar parse, so yajl callbacks can switch on a key id instead
+ *              of comparing the key against every name.
+ *
+ * The table of a schema is built on its first lookup by trying seeds until
+ * no two names hash to the same slot. A lookup is then one hash, one slot and
+ * one comparison against the only name which can match.
+ *
+ */
+#include "libi3.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/*
+ * FNV-1a over the (case-folded) key, with the seed mixed into the offset
+ * basis. The final shift spreads the high bits into the masked low bits.
+ *
+ */
+static uint32_t key_hash(uint32_t seed, bool ignore_case, const unsigned char *key, size_t len) {
+    uint32_t hash = 2166136261u ^ (seed * 0x9e3779b9u);
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = key[i];
+        if (ignore_case && c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        }
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash ^ (hash >> 16);
+}
+
+/*
+ * Fills the slots of the table with the given seed and size. Returns false if
+ * two names collide.
+ *
+ */
+static bool fill_slots(json_key_table_t *table, uint32_t seed, uint32_t mask) {
+    for (uint32_t i = 0; i <= mask; i++) {
+        table->slots[i] = JSON_KEY_UNKNOWN;
+    }
+    for (size_t i = 0; i < table->num_names; i++) {
+        const uint32_t slot = key_hash(seed, table->ignore_case, (const unsigned char *)table->names[i], table->lengths[i]) & mask;
+        if (table->slots[slot] != JSON_KEY_UNKNOWN) {
+            return false;
+        }
+        table->slots[slot] = (int)i;
+    }
+    return true;
+}
+
+/*
+ * Finds a seed (and table size) for which the names of the table do not
+ * collide.
+ *
+ */
+static void build_table(json_key_table_t *table) {
+    table->lengths = smalloc(table->num_names * sizeof(size_t));
+    for (size_t i = 0; i < table->num_names; i++) {
+        table->lengths[i] = strlen(table->names[i]);
+    }
+
+    /* Start with a load factor of at most one half and grow the table if no
+     * seed works at that size. The schemas have a few dozen keys at most, so
+     * this finishes after a handful of attempts. */
+    uint32_t size = 4;
+    while (size < 2 * table->num_names) {
+        size *= 2;
+    }
+    for (;;) {
+        table->slots = srealloc(table->slots, size * sizeof(int));
+        for (uint32_t seed = 0; seed < 256; seed++) {
+            if (fill_slots(table, seed, size - 1)) {
+                table->seed = seed;
+                table->mask = size - 1;
+                return;
+            }
+        }
+        size *= 2;
+    }
+}
+
+/*
+ * Returns the index of the given key (of len bytes, not NUL-terminated) in
+ * the names of the table, or JSON_KEY_UNKNOWN.
+ *
+ */
+int json_key_lookup(json_key_table_t *table, const unsigned char *key, size_t len) {
+    if (table->slots == NULL) {
+        build_table(table);
+    }
+
+    const int id = table->slots[key_hash(table->seed, table->ignore_case, key, len) & table->mask];
+    if (id == JSON_KEY_UNKNOWN || table->lengths[id] != len) {
+        return JSON_KEY_UNKNOWN;
+    }
+    const char *name = table->names[id];
+    if (table->ignore_case ? strncasecmp(name, (const char *)key, len) != 0 : memcmp(name, key, len) != 0) {
+        return JSON_KEY_UNKNOWN;
+    }
+    return id;
+}
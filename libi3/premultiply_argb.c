@@ -0,0 +1,118 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ */
+#include "libi3.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/* All kernels compute (c * a) / 255 exactly, using
+ * x / 255 == (x + 1 + (x >> 8)) >> 8, which holds for 0 <= x <= 255 * 255. */
+
+static uint32_t premultiply_pixel(uint32_t pixel) {
+    uint8_t r, g, b, a;
+    a = (pixel >> 24) & 0xff;
+    r = (pixel >> 16) & 0xff;
+    g = (pixel >> 8) & 0xff;
+    b = (pixel >> 0) & 0xff;
+
+    r = (r * a) / 0xff;
+    g = (g * a) / 0xff;
+    b = (b * a) / 0xff;
+
+    return ((uint32_t)a << 24) | (r << 16) | (g << 8) | b;
+}
+
+#if defined(__AVX2__)
+#define VECTOR_PIXELS 8
+
+/* Premultiplies the pixels of one vector, whose channels were widened to
+ * 16 bit lanes (b, g, r, a per pixel). */
+static __m256i premultiply_lanes(__m256i c) {
+    __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    __m256i x = _mm256_mullo_epi16(c, a);
+    x = _mm256_add_epi16(x, _mm256_add_epi16(_mm256_set1_epi16(1), _mm256_srli_epi16(x, 8)));
+    return _mm256_srli_epi16(x, 8);
+}
+
+static void premultiply_vector(uint32_t *dst, const uint32_t *src) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha_mask = _mm256_set1_epi32((int)0xff000000);
+    __m256i pixels = _mm256_loadu_si256((const __m256i *)src);
+    __m256i lo = premultiply_lanes(_mm256_unpacklo_epi8(pixels, zero));
+    __m256i hi = premultiply_lanes(_mm256_unpackhi_epi8(pixels, zero));
+    __m256i result = _mm256_packus_epi16(lo, hi);
+    /* Keep the alpha channel itself unchanged. */
+    result = _mm256_or_si256(_mm256_andnot_si256(alpha_mask, result),
+                             _mm256_and_si256(alpha_mask, pixels));
+    _mm256_storeu_si256((__m256i *)dst, result);
+}
+#elif defined(__SSE2__)
+#define VECTOR_PIXELS 4
+
+static __m128i premultiply_lanes(__m128i c) {
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i x = _mm_mullo_epi16(c, a);
+    x = _mm_add_epi16(x, _mm_add_epi16(_mm_set1_epi16(1), _mm_srli_epi16(x, 8)));
+    return _mm_srli_epi16(x, 8);
+}
+
+static void premultiply_vector(uint32_t *dst, const uint32_t *src) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha_mask = _mm_set1_epi32((int)0xff000000);
+    __m128i pixels = _mm_loadu_si128((const __m128i *)src);
+    __m128i lo = premultiply_lanes(_mm_unpacklo_epi8(pixels, zero));
+    __m128i hi = premultiply_lanes(_mm_unpackhi_epi8(pixels, zero));
+    __m128i result = _mm_packus_epi16(lo, hi);
+    /* Keep the alpha channel itself unchanged. */
+    result = _mm_or_si128(_mm_andnot_si128(alpha_mask, result),
+                          _mm_and_si128(alpha_mask, pixels));
+    _mm_storeu_si128((__m128i *)dst, result);
+}
+#elif defined(__ARM_NEON) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define VECTOR_PIXELS 8
+
+static uint8x8_t premultiply_channel(uint8x8_t c, uint8x8_t a) {
+    uint16x8_t x = vmull_u8(c, a);
+    x = vaddq_u16(x, vaddq_u16(vdupq_n_u16(1), vshrq_n_u16(x, 8)));
+    return vshrn_n_u16(x, 8);
+}
+
+static void premultiply_vector(uint32_t *dst, const uint32_t *src) {
+    /* De-interleaves into b, g, r and a (little endian byte order). */
+    uint8x8x4_t pixels = vld4_u8((const uint8_t *)src);
+    pixels.val[0] = premultiply_channel(pixels.val[0], pixels.val[3]);
+    pixels.val[1] = premultiply_channel(pixels.val[1], pixels.val[3]);
+    pixels.val[2] = premultiply_channel(pixels.val[2], pixels.val[3]);
+    vst4_u8((uint8_t *)dst, pixels);
+}
+#endif
+
+/*
+ * Converts len pixels of ARGB data (as found in _NET_WM_ICON, one pixel per
+ * uint32_t, not premultiplied) to Cairo's CAIRO_FORMAT_ARGB32, which uses
+ * premultiplied alpha. src and dst may be the same buffer. Uses SIMD
+ * instructions when the compiler targets SSE2, AVX2 or NEON.
+ *
+ */
+void premultiply_argb(uint32_t *dst, const uint32_t *src, size_t len) {
+    size_t i = 0;
+#ifdef VECTOR_PIXELS
+    for (; i + VECTOR_PIXELS <= len; i += VECTOR_PIXELS) {
+        premultiply_vector(dst + i, src + i);
+    }
+#endif
+    for (; i < len; i++) {
+        dst[i] = premultiply_pixel(src[i]);
+    }
+}
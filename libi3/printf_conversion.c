@@ -0,0 +1,182 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ */
+#include "libi3.h"
+
+#include <string.h>
+
+/*
+ * Parses an optional decimal number, but no '*'. Returns -1 if there is none.
+ *
+ */
+static int parse_number(const char **walk) {
+    if (**walk < '0' || **walk > '9') {
+        return -1;
+    }
+    int number = 0;
+    for (; **walk >= '0' && **walk <= '9'; (*walk)++) {
+        number = number * 10 + (**walk - '0');
+    }
+    return number;
+}
+
+/*
+ * Finds the first conversion specification of the printf(3) format string at
+ * or after fmt and describes it in conv. Returns false if there is none.
+ *
+ */
+bool printf_next_conversion(const char *fmt, printf_conversion_t *conv) {
+    const char *walk = strchr(fmt, '%');
+    if (walk == NULL) {
+        return false;
+    }
+
+    *conv = (printf_conversion_t){
+        .start = walk,
+        .precision = -1,
+        .type = PRINTF_ARG_UNSUPPORTED,
+    };
+    walk++;
+
+    if (*walk == '%') {
+        conv->type = PRINTF_ARG_NONE;
+        conv->end = walk + 1;
+        return true;
+    }
+
+    /* Flags */
+    while (*walk != '\0' && strchr("-+ #0'", *walk) != NULL) {
+        walk++;
+    }
+
+    /* Field width. A positional argument ("%1$d") is not supported. */
+    if (*walk == '*') {
+        conv->width_star = true;
+        walk++;
+    } else if (parse_number(&walk) != -1 && *walk == '$') {
+        conv->end = walk + 1;
+        return true;
+    }
+
+    /* Precision */
+    if (*walk == '.') {
+        walk++;
+        if (*walk == '*') {
+            conv->precision_star = true;
+            walk++;
+        } else {
+            conv->precision = parse_number(&walk);
+            if (conv->precision == -1) {
+                conv->precision = 0;
+            }
+        }
+    }
+
+    /* Length modifier */
+    enum { NONE,
+           LONG,
+           LONG_LONG,
+           LONG_DOUBLE,
+           INTMAX,
+           SIZE,
+           PTRDIFF } length = NONE;
+    if (walk[0] == 'h' && walk[1] == 'h') {
+        walk += 2;
+    } else if (walk[0] == 'l' && walk[1] == 'l') {
+        length = LONG_LONG;
+        walk += 2;
+    } else if (*walk == 'h') {
+        walk++;
+    } else if (*walk == 'l') {
+        length = LONG;
+        walk++;
+    } else if (*walk == 'q') {
+        length = LONG_LONG;
+        walk++;
+    } else if (*walk == 'L') {
+        length = LONG_DOUBLE;
+        walk++;
+    } else if (*walk == 'j') {
+        length = INTMAX;
+        walk++;
+    } else if (*walk == 'z' || *walk == 'Z') {
+        length = SIZE;
+        walk++;
+    } else if (*walk == 't') {
+        length = PTRDIFF;
+        walk++;
+    }
+
+    if (*walk == '\0') {
+        conv->end = walk;
+        return true;
+    }
+    conv->end = walk + 1;
+
+    switch (*walk) {
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            switch (length) {
+                case NONE:
+                    conv->type = PRINTF_ARG_INT;
+                    break;
+                case LONG:
+                    conv->type = PRINTF_ARG_LONG;
+                    break;
+                case LONG_LONG:
+                    conv->type = PRINTF_ARG_LONG_LONG;
+                    break;
+                case INTMAX:
+                    conv->type = PRINTF_ARG_INTMAX;
+                    break;
+                case SIZE:
+                    conv->type = PRINTF_ARG_SIZE;
+                    break;
+                case PTRDIFF:
+                    conv->type = PRINTF_ARG_PTRDIFF;
+                    break;
+                case LONG_DOUBLE:
+                    break;
+            }
+            break;
+        case 'c':
+            if (length == NONE) {
+                conv->type = PRINTF_ARG_INT;
+            }
+            break;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            if (length == NONE || length == LONG) {
+                conv->type = PRINTF_ARG_DOUBLE;
+            }
+            break;
+        case 's':
+            if (length == NONE) {
+                conv->type = PRINTF_ARG_STRING;
+            }
+            break;
+        case 'p':
+            if (length == NONE) {
+                conv->type = PRINTF_ARG_POINTER;
+            }
+            break;
+        default:
+            /* %n, %m, wide characters and unknown conversions */
+            break;
+    }
+    return true;
+}
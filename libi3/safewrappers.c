@@ -9,6 +9,8 @@
 
 #include <err.h>
 #include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -53,6 +55,56 @@ char *sstrndup(const char *str, size_t size) {
     return result;
 }
 
+/* Counted allocations are preceded by a header which remembers the counter and
+ * the size, so that free_counted() does not need them. The union keeps the
+ * memory after the header suitably aligned for any type. */
+union counted_header {
+    struct {
+        mem_counter_t *counter;
+        size_t size;
+    } h;
+    max_align_t align;
+};
+
+static void *count_allocation(mem_counter_t *counter, union counted_header *header, size_t size) {
+    header->h.counter = counter;
+    header->h.size = size;
+    counter->allocations++;
+    counter->bytes += size;
+    return header + 1;
+}
+
+void *smalloc_counted(mem_counter_t *counter, size_t size) {
+    return count_allocation(counter, smalloc(sizeof(union counted_header) + size), size);
+}
+
+void *scalloc_counted(mem_counter_t *counter, size_t num, size_t size) {
+    if (size != 0 && num > (SIZE_MAX - sizeof(union counted_header)) / size)
+        errx(EXIT_FAILURE, "calloc(%zd, %zd)", num, size);
+    return count_allocation(counter, scalloc(1, sizeof(union counted_header) + num * size), num * size);
+}
+
+char *sstrdup_counted(mem_counter_t *counter, const char *str) {
+    return sstrndup_counted(counter, str, strlen(str));
+}
+
+char *sstrndup_counted(mem_counter_t *counter, const char *str, size_t size) {
+    size = strnlen(str, size);
+    char *result = smalloc_counted(counter, size + 1);
+    memcpy(result, str, size);
+    result[size] = '\0';
+    return result;
+}
+
+void free_counted(void *ptr) {
+    if (ptr == NULL)
+        return;
+    union counted_header *header = (union counted_header *)ptr - 1;
+    header->h.counter->allocations--;
+    header->h.counter->bytes -= header->h.size;
+    free(header);
+}
+
 int sasprintf(char **strp, const char *fmt, ...) {
     va_list args;
     int result;
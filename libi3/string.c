@@ -21,6 +21,9 @@ struct _i3String {
     size_t num_glyphs;
     size_t num_bytes;
     bool pango_markup;
+    /* Whether utf8 is plain ASCII, so that num_glyphs equals num_bytes
+     * without converting to UCS-2. */
+    bool ascii;
 };
 
 /*
@@ -54,6 +57,17 @@ i3String *i3string_from_markup(const char *from_markup) {
 i3String *i3string_from_utf8_with_length(const char *from_utf8, ssize_t num_bytes) {
     i3String *str = scalloc(1, sizeof(i3String));
 
+    /* ASCII needs no validation. Strings with a length may contain zero
+     * bytes, which g_utf8_make_valid() has to handle. */
+    const size_t len = (num_bytes < 0 ? strlen(from_utf8) : (size_t)num_bytes);
+    if (is_ascii(from_utf8, len) && (num_bytes < 0 || memchr(from_utf8, '\0', len) == NULL)) {
+        str->utf8 = sstrndup(from_utf8, len);
+        str->num_bytes = len;
+        str->num_glyphs = len;
+        str->ascii = true;
+        return str;
+    }
+
     /* g_utf8_make_valid NULL-terminates the string. */
     str->utf8 = g_utf8_make_valid(from_utf8, num_bytes);
 
@@ -103,7 +117,12 @@ i3String *i3string_from_ucs2(const xcb_char2b_t *from_ucs2, size_t num_glyphs) {
  * Note that this will not free the source string.
  */
 i3String *i3string_copy(i3String *str) {
-    i3String *copy = i3string_from_utf8(i3string_as_utf8(str));
+    /* The UTF-8 of an i3String is already valid. */
+    i3String *copy = scalloc(1, sizeof(i3String));
+    copy->utf8 = sstrdup(i3string_as_utf8(str));
+    copy->num_bytes = strlen(copy->utf8);
+    copy->ascii = str->ascii;
+    copy->num_glyphs = (str->ascii ? copy->num_bytes : 0);
     copy->pango_markup = str->pango_markup;
     return copy;
 }
@@ -190,6 +209,9 @@ i3String *i3string_escape_markup(i3String *str) {
  *
  */
 size_t i3string_get_num_glyphs(i3String *str) {
+    if (str->ascii) {
+        return str->num_glyphs;
+    }
     i3string_ensure_ucs2(str);
     return str->num_glyphs;
 }
@@ -15,6 +15,29 @@
 static iconv_t utf8_conversion_descriptor = (iconv_t)-1;
 static iconv_t ucs2_conversion_descriptor = (iconv_t)-1;
 
+/*
+ * Returns true if the first len bytes of str are all ASCII (and thus valid
+ * UTF-8 with one glyph per byte).
+ *
+ */
+bool is_ascii(const char *str, size_t len) {
+    /* Check eight bytes at a time: none of them may have the high bit set. */
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, str + i, sizeof(word));
+        if (word & UINT64_C(0x8080808080808080)) {
+            return false;
+        }
+    }
+    for (; i < len; i++) {
+        if ((unsigned char)str[i] & 0x80) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /*
  * Converts the given string to UTF-8 from UCS-2 big endian. The return value
  * must be freed after use.
@@ -63,6 +86,19 @@ xcb_char2b_t *convert_utf8_to_ucs2(char *input, size_t *real_strlen) {
     /* Calculate the input buffer size (UTF-8 is strlen-safe) */
     size_t input_size = strlen(input);
 
+    /* Most titles are plain ASCII, which maps to UCS-2 directly. */
+    if (input_size > 0 && is_ascii(input, input_size)) {
+        xcb_char2b_t *buffer = smalloc(input_size * sizeof(xcb_char2b_t));
+        for (size_t i = 0; i < input_size; i++) {
+            buffer[i].byte1 = 0;
+            buffer[i].byte2 = input[i];
+        }
+        if (real_strlen != NULL) {
+            *real_strlen = input_size;
+        }
+        return buffer;
+    }
+
     /* Calculate the output buffer size and allocate the buffer */
     size_t buffer_size = input_size * sizeof(xcb_char2b_t);
     xcb_char2b_t *buffer = smalloc(buffer_size);
@@ -49,6 +49,7 @@ state INITIAL:
   'finally' -> call cmd_finally()
   'setup_variable' -> VARIABLE
   'toggle' -> TOGGLE
+  'batch' -> BATCH
 
 state CRITERIA:
   ctype = 'class'       -> CRITERION
@@ -87,9 +88,16 @@ state SHMLOG:
     -> call cmd_shmlog($argument)
 
 # debuglog toggle|on|off
+# debuglog filter <file>[,<file>…]|off
 state DEBUGLOG:
   argument = 'toggle', 'on', 'off'
     -> call cmd_debuglog($argument)
+  'filter'
+    -> DEBUGLOG_FILTER
+
+state DEBUGLOG_FILTER:
+  files = string
+    -> call cmd_debuglog_filter($files)
 
 # border normal|pixel [<n>]
 # border none|1pixel|toggle
@@ -452,6 +460,11 @@ state SCRATCHPAD:
   'show'
       -> call cmd_scratchpad_show()
 
+# batch begin|commit
+state BATCH:
+  action = 'begin', 'commit'
+      -> call cmd_batch($action)
+
 # swap [container] [with] id <window>
 # swap [container] [with] con_id <con_id>
 # swap [container] [with] mark <mark>
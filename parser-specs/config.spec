@@ -48,11 +48,17 @@ state INITIAL:
   'focus_on_window_activation'             -> FOCUS_ON_WINDOW_ACTIVATION
   'title_align'                            -> TITLE_ALIGN
   'show_marks'                             -> SHOW_MARKS
+  'live_resize'                            -> LIVE_RESIZE
+  'tab_min_width'                          -> TAB_MIN_WIDTH
   'workspace'                              -> WORKSPACE
   'ipc_socket', 'ipc-socket'               -> IPC_SOCKET
   'ipc_kill_timeout'                       -> IPC_KILL_TIMEOUT
+  'ipc_queue_limit'                        -> IPC_QUEUE_LIMIT
+  'ipc_coalesce_events'                    -> IPC_COALESCE_EVENTS
   'restart_state'                          -> RESTART_STATE
   'popup_during_fullscreen'                -> POPUP_DURING_FULLSCREEN
+  'drag_refresh_rate'                      -> DRAG_REFRESH_RATE
+  'tree_shm_size'                          -> TREE_SHM_SIZE
   'setup_variable'                         -> VARIABLE
   'toggle'                                 -> TOGGLE
   exectype = 'exec_always', 'exec'         -> EXEC
@@ -230,7 +236,7 @@ state CRITERION_STR:
   cvalue = word
       -> call cfg_criteria_add($ctype, $cvalue); CRITERIA
 
-# focus_follows_mouse bool
+# focus_follows_mouse bool|raw
 state FOCUS_FOLLOWS_MOUSE:
   value = word
       -> call cfg_focus_follows_mouse($value)
@@ -286,6 +292,22 @@ state SHOW_MARKS:
   value = word
       -> call cfg_show_marks($value)
 
+# live_resize yes|no
+state LIVE_RESIZE:
+  value = word
+      -> call cfg_live_resize($value)
+
+# tab_min_width <width> [px]
+state TAB_MIN_WIDTH:
+  width = number
+      -> TAB_MIN_WIDTH_PX
+
+state TAB_MIN_WIDTH_PX:
+  'px'
+      ->
+  end
+      -> call cfg_tab_min_width(&width)
+
 state FORCE_DISPLAY_URGENCY_HINT_MS:
   'ms'
       ->
@@ -322,6 +344,44 @@ state IPC_KILL_TIMEOUT:
   timeout = number
       -> call cfg_ipc_kill_timeout(&timeout)
 
+# ipc_queue_limit <bytes>
+state IPC_QUEUE_LIMIT:
+  limit = number
+      -> call cfg_ipc_queue_limit(&limit)
+
+# ipc_coalesce_events <window::title|window::mark> <interval> ms
+state IPC_COALESCE_EVENTS:
+  event = 'window::title', 'window::mark'
+      -> IPC_COALESCE_EVENTS_INTERVAL
+
+state IPC_COALESCE_EVENTS_INTERVAL:
+  interval_ms = number
+      -> IPC_COALESCE_EVENTS_MS
+
+state IPC_COALESCE_EVENTS_MS:
+  'ms'
+      ->
+  end
+      -> call cfg_ipc_coalesce_events($event, &interval_ms)
+
+# tree_shm_size <size>
+state TREE_SHM_SIZE:
+  size = number
+      -> call cfg_tree_shm_size(&size)
+
+# drag_refresh_rate auto|<rate> Hz
+state DRAG_REFRESH_RATE:
+  'auto'
+      -> call cfg_drag_refresh_rate(0)
+  rate = number
+      -> DRAG_REFRESH_RATE_HZ
+
+state DRAG_REFRESH_RATE_HZ:
+  'Hz'
+      ->
+  end
+      -> call cfg_drag_refresh_rate(&rate)
+
 # restart_state <path> (for testcases)
 state RESTART_STATE:
   path = string
@@ -496,6 +556,7 @@ state BAR:
   'binding_mode_indicator' -> BAR_BINDING_MODE_INDICATOR
   'workspace_buttons'      -> BAR_WORKSPACE_BUTTONS
   'workspace_min_width'    -> BAR_WORKSPACE_MIN_WIDTH
+  'status_update_interval' -> BAR_STATUS_UPDATE_INTERVAL
   'strip_workspace_numbers' -> BAR_STRIP_WORKSPACE_NUMBERS
   'strip_workspace_name' -> BAR_STRIP_WORKSPACE_NAME
   'verbose'                -> BAR_VERBOSE
@@ -610,6 +671,16 @@ state BAR_WORKSPACE_MIN_WIDTH_PX:
   end
       -> call cfg_bar_workspace_min_width(&width); BAR
 
+state BAR_STATUS_UPDATE_INTERVAL:
+  interval = number
+      -> BAR_STATUS_UPDATE_INTERVAL_MS
+
+state BAR_STATUS_UPDATE_INTERVAL_MS:
+  'ms'
+      ->
+  end
+      -> call cfg_bar_status_update_interval(&interval); BAR
+
 state BAR_STRIP_WORKSPACE_NUMBERS:
   value = word
       -> call cfg_bar_strip_workspace_numbers($value); BAR
@@ -9,21 +9,193 @@
  */
 #include "all.h"
 
+#include <inttypes.h>
+
+typedef struct assignment_list {
+    size_t num;
+    size_t capacity;
+    Assignment **assignments;
+} assignment_list;
+
+/* The assignments bucketed by the exact class or (if the class is not an
+ * exact string) instance they require. All other assignments are in
+ * remaining_assignments. Every list is in config order. */
+static hashmap_t *assignments_by_class;
+static hashmap_t *assignments_by_instance;
+static assignment_list remaining_assignments;
+
+static void assignment_list_add(assignment_list *list, Assignment *assignment) {
+    if (list->num == list->capacity) {
+        list->capacity = (list->capacity == 0 ? 8 : list->capacity * 2);
+        list->assignments = srealloc(list->assignments, list->capacity * sizeof(Assignment *));
+    }
+    list->assignments[list->num++] = assignment;
+}
+
+static void assignment_list_free(void *value, void *userdata) {
+    assignment_list *list = value;
+    free(list->assignments);
+    free(list);
+}
+
+/*
+ * Returns the exact string the given criterion requires, if it can be used as
+ * a bucket key. Windows are looked up without a trailing newline, which "$"
+ * matches, so literals ending in a newline are not usable.
+ *
+ */
+static const char *bucket_key(struct regex *regex) {
+    if (regex == NULL) {
+        return NULL;
+    }
+    const char *key = regex_exact_literal(regex);
+    if (key == NULL || (key[0] != '\0' && key[strlen(key) - 1] == '\n')) {
+        return NULL;
+    }
+    return key;
+}
+
+static void bucket_add(hashmap_t *map, const char *key, Assignment *assignment) {
+    assignment_list *list = hashmap_lookup_str(map, key);
+    if (list == NULL) {
+        list = scalloc(1, sizeof(assignment_list));
+        hashmap_insert_str(map, key, list);
+    }
+    assignment_list_add(list, assignment);
+}
+
+static assignment_list *bucket_lookup(hashmap_t *map, const char *value) {
+    if (value == NULL) {
+        value = "";
+    }
+    const size_t len = strlen(value);
+    if (len > 0 && value[len - 1] == '\n') {
+        char *key = sstrndup(value, len - 1);
+        assignment_list *list = hashmap_lookup_str(map, key);
+        free(key);
+        return list;
+    }
+    return hashmap_lookup_str(map, value);
+}
+
+/*
+ * Sorts the assignments into buckets by the exact class or instance they
+ * require, so that windows are only checked against the assignments which
+ * can possibly match them. Needs to be called after the configuration was
+ * (re-)loaded.
+ *
+ */
+void compile_assignments(void) {
+    if (assignments_by_class == NULL) {
+        assignments_by_class = hashmap_new();
+        assignments_by_instance = hashmap_new();
+    }
+    hashmap_foreach(assignments_by_class, assignment_list_free, NULL);
+    hashmap_clear(assignments_by_class);
+    hashmap_foreach(assignments_by_instance, assignment_list_free, NULL);
+    hashmap_clear(assignments_by_instance);
+    remaining_assignments.num = 0;
+
+    uint32_t position = 0;
+    Assignment *assignment;
+    TAILQ_FOREACH (assignment, &assignments, assignments) {
+        assignment->position = position++;
+        assignment->depends_on = match_dependencies(&(assignment->match));
+
+        const char *key;
+        if ((key = bucket_key(match_get_regex(&(assignment->match), CRIT_CLASS))) != NULL) {
+            bucket_add(assignments_by_class, key, assignment);
+        } else if ((key = bucket_key(match_get_regex(&(assignment->match), CRIT_INSTANCE))) != NULL) {
+            bucket_add(assignments_by_instance, key, assignment);
+        } else {
+            assignment_list_add(&remaining_assignments, assignment);
+        }
+    }
+    DLOG("Compiled %u assignments, %zu by class, %zu by instance, %zu remaining\n",
+         position, hashmap_size(assignments_by_class),
+         hashmap_size(assignments_by_instance), remaining_assignments.num);
+}
+
+/*
+ * Iterates over the assignments which can possibly match the given window in
+ * config order, by merging the window's class and instance buckets with the
+ * remaining assignments. match_matches_window() checks the criteria of a
+ * candidate cheapest first (e.g. the window type before any regex).
+ *
+ * Unless all properties changed (WP_ALL), assignments which do not depend on
+ * any of the changed properties (WP_*) are skipped, since whether they match
+ * cannot have changed.
+ *
+ */
+typedef struct assignment_iter {
+    i3Window *window;
+    uint32_t changed;
+    assignment_list *lists[3];
+    size_t positions[3];
+} assignment_iter;
+
+static void assignment_iter_init(assignment_iter *iter, i3Window *window, uint32_t changed) {
+    *iter = (assignment_iter){
+        .window = window,
+        .changed = changed,
+        .lists = {
+            (assignments_by_class ? bucket_lookup(assignments_by_class, window->class_class) : NULL),
+            (assignments_by_instance ? bucket_lookup(assignments_by_instance, window->class_instance) : NULL),
+            &remaining_assignments,
+        },
+    };
+}
+
+static Assignment *assignment_iter_next(assignment_iter *iter, int type) {
+    while (true) {
+        int next = -1;
+        for (int i = 0; i < 3; i++) {
+            assignment_list *list = iter->lists[i];
+            if (list == NULL || iter->positions[i] >= list->num) {
+                continue;
+            }
+            if (next == -1 || list->assignments[iter->positions[i]]->position <
+                                  iter->lists[next]->assignments[iter->positions[next]]->position) {
+                next = i;
+            }
+        }
+        if (next == -1) {
+            return NULL;
+        }
+
+        Assignment *assignment = iter->lists[next]->assignments[iter->positions[next]++];
+        if (type != A_ANY && (assignment->type & type) == 0) {
+            continue;
+        }
+        if (iter->changed != WP_ALL &&
+            (assignment->depends_on & (iter->changed | WP_OTHER)) == 0) {
+            continue;
+        }
+        if (!match_matches_window(&(assignment->match), iter->window)) {
+            continue;
+        }
+        return assignment;
+    }
+}
+
 /*
  * Checks the list of assignments for the given window and runs all matching
- * ones (unless they have already been run for this specific window).
+ * ones (unless they have already been run for this specific window). Only
+ * the assignments which depend on one of the changed window properties
+ * (WP_*) are checked, WP_ALL checks all of them.
  *
  */
-void run_assignments(i3Window *window) {
+void run_assignments(i3Window *window, uint32_t changed) {
     DLOG("Checking if any assignments match this window\n");
+    const uint64_t start = stats_now();
 
     bool needs_tree_render = false;
 
     /* Check if any assignments match */
+    assignment_iter iter;
+    assignment_iter_init(&iter, window, changed);
     Assignment *current;
-    TAILQ_FOREACH (current, &assignments, assignments) {
-        if (current->type != A_COMMAND || !match_matches_window(&(current->match), window))
-            continue;
+    while ((current = assignment_iter_next(&iter, A_COMMAND)) != NULL) {
 
         bool skip = false;
         for (uint32_t c = 0; c < window->nr_assignments; c++) {
@@ -57,9 +229,12 @@ void run_assignments(i3Window *window) {
         command_result_free(result);
     }
 
+    stats_record_duration(STATS_RUN_ASSIGNMENTS, start);
+    DLOG("Checked assignments in %" PRIu64 " us\n", stats_now() - start);
+
     /* If any of the commands required re-rendering, we will do that now. */
     if (needs_tree_render)
-        tree_render();
+        tree_schedule_render();
 }
 
 /*
@@ -67,15 +242,11 @@ void run_assignments(i3Window *window) {
  *
  */
 Assignment *assignment_for(i3Window *window, int type) {
-    Assignment *assignment;
-
-    TAILQ_FOREACH (assignment, &assignments, assignments) {
-        if ((type != A_ANY && (assignment->type & type) == 0) ||
-            !match_matches_window(&(assignment->match), window))
-            continue;
+    assignment_iter iter;
+    assignment_iter_init(&iter, window, WP_ALL);
+    Assignment *assignment = assignment_iter_next(&iter, type);
+    if (assignment != NULL) {
         DLOG("got a matching assignment\n");
-        return assignment;
     }
-
-    return NULL;
+    return assignment;
 }
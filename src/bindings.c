@@ -8,6 +8,7 @@
  */
 #include "all.h"
 
+#include <ctype.h>
 #include <math.h>
 
 #include <xkbcommon/xkbcommon-x11.h>
@@ -18,6 +19,90 @@ static struct xkb_keymap *xkb_keymap;
 
 pid_t command_error_nagbar_pid = -1;
 
+typedef struct binding_list {
+    size_t num;
+    size_t capacity;
+    Binding **bindings;
+} binding_list;
+
+/* Index of the current mode's bindings for get_binding(), built by
+ * index_bindings(). by_key maps (input type, keycode or button) to the
+ * bindings which can be triggered by that key, in list order. Modifier and
+ * group state are not part of the key because release bindings match any
+ * modifiers once armed and groups are matched as masks. */
+static struct {
+    struct bindings_head *bindings;
+    hashmap_t *by_key;
+    /* Bindings which get_binding() may mark B_UPON_KEYRELEASE_IGNORE_MODS. */
+    binding_list release_bindings;
+} binding_index;
+
+static void binding_list_add(binding_list *list, Binding *bind) {
+    if (list->num > 0 && list->bindings[list->num - 1] == bind) {
+        return;
+    }
+    if (list->num == list->capacity) {
+        list->capacity = (list->capacity == 0 ? 4 : list->capacity * 2);
+        list->bindings = srealloc(list->bindings, list->capacity * sizeof(Binding *));
+    }
+    list->bindings[list->num++] = bind;
+}
+
+static void binding_list_free(void *value, void *userdata) {
+    binding_list *list = value;
+    free(list->bindings);
+    free(list);
+}
+
+static uint64_t binding_key(input_type_t input_type, uint32_t code) {
+    return ((uint64_t)input_type << 32) | code;
+}
+
+static void index_binding_code(Binding *bind, uint32_t code) {
+    const uint64_t key = binding_key(bind->input_type, code);
+    binding_list *list = hashmap_lookup(binding_index.by_key, key);
+    if (list == NULL) {
+        list = scalloc(1, sizeof(binding_list));
+        hashmap_insert(binding_index.by_key, key, list);
+    }
+    binding_list_add(list, bind);
+}
+
+/*
+ * (Re-)builds the index of the current bindings. Called from
+ * translate_keysyms(), which fills in the keycodes the index is built from.
+ *
+ */
+static void index_bindings(void) {
+    if (binding_index.by_key == NULL) {
+        binding_index.by_key = hashmap_new();
+    }
+    hashmap_foreach(binding_index.by_key, binding_list_free, NULL);
+    hashmap_clear(binding_index.by_key);
+    binding_index.release_bindings.num = 0;
+    binding_index.bindings = bindings;
+    if (bindings == NULL) {
+        return;
+    }
+
+    Binding *bind;
+    TAILQ_FOREACH (bind, bindings, bindings) {
+        if (bind->release != B_UPON_KEYPRESS) {
+            binding_list_add(&(binding_index.release_bindings), bind);
+        }
+
+        if (bind->input_type == B_KEYBOARD && bind->symbol != NULL) {
+            struct Binding_Keycode *binding_keycode;
+            TAILQ_FOREACH (binding_keycode, &(bind->keycodes_head), keycodes) {
+                index_binding_code(bind, binding_keycode->keycode);
+            }
+        } else {
+            index_binding_code(bind, bind->keycode);
+        }
+    }
+    DLOG("Indexed bindings by %zu keys\n", hashmap_size(binding_index.by_key));
+}
+
 /*
  * The name of the default mode.
  *
@@ -84,6 +169,7 @@ Binding *configure_binding(const char *bindtype, const char *modifiers, const ch
         new_binding->input_type = B_KEYBOARD;
     }
     new_binding->command = sstrdup(command);
+    new_binding->parsed_command = command_compile(command);
     new_binding->event_state_mask = event_state_from_str(modifiers);
     int group_bits_set = 0;
     if ((new_binding->event_state_mask >> 16) & I3_XKB_GROUP_MASK_1)
@@ -124,29 +210,97 @@ static bool binding_in_current_group(const Binding *bind) {
     }
 }
 
-static void grab_keycode_for_binding(xcb_connection_t *conn, Binding *bind, uint32_t keycode) {
-    /* Grab the key in all combinations */
-#define GRAB_KEY(modifier)                                                                       \
-    do {                                                                                         \
-        xcb_grab_key(conn, 0, root, modifier, keycode, XCB_GRAB_MODE_SYNC, XCB_GRAB_MODE_ASYNC); \
-    } while (0)
+/* The key grabs currently active on the root window, so that grab_all_keys()
+ * only needs to send the difference to the X server. */
+static hashmap_t *active_key_grabs;
+
+struct key_grab {
+    uint16_t modifiers;
+    xcb_keycode_t keycode;
+};
+
+static uint64_t key_grab_id(uint16_t modifiers, xcb_keycode_t keycode) {
+    return ((uint64_t)modifiers << 8) | keycode;
+}
+
+static void add_key_grab(hashmap_t *grabs, uint16_t modifiers, xcb_keycode_t keycode) {
+    const uint64_t id = key_grab_id(modifiers, keycode);
+    if (hashmap_lookup(grabs, id) != NULL) {
+        return;
+    }
+    struct key_grab *grab = smalloc(sizeof(struct key_grab));
+    grab->modifiers = modifiers;
+    grab->keycode = keycode;
+    hashmap_insert(grabs, id, grab);
+}
+
+static void add_keycode_grabs_for_binding(hashmap_t *grabs, Binding *bind, uint32_t keycode) {
     const int mods = (bind->event_state_mask & 0xFFFF);
     DLOG("Binding %p Grabbing keycode %d with event state mask 0x%x (mods 0x%x)\n",
          bind, keycode, bind->event_state_mask, mods);
-    GRAB_KEY(mods);
+    /* Grab the key in all combinations */
+    add_key_grab(grabs, mods, keycode);
     /* Also bind the key with active NumLock */
-    GRAB_KEY(mods | xcb_numlock_mask);
+    add_key_grab(grabs, mods | xcb_numlock_mask, keycode);
     /* Also bind the key with active CapsLock */
-    GRAB_KEY(mods | XCB_MOD_MASK_LOCK);
+    add_key_grab(grabs, mods | XCB_MOD_MASK_LOCK, keycode);
     /* Also bind the key with active NumLock+CapsLock */
-    GRAB_KEY(mods | xcb_numlock_mask | XCB_MOD_MASK_LOCK);
+    add_key_grab(grabs, mods | xcb_numlock_mask | XCB_MOD_MASK_LOCK, keycode);
+}
+
+struct grab_diff {
+    xcb_connection_t *conn;
+    /* The grabs to compare against (NULL if there are none). */
+    hashmap_t *other;
+    int requests;
+};
+
+static void grab_if_new(void *value, void *userdata) {
+    struct key_grab *grab = value;
+    struct grab_diff *diff = userdata;
+    if (diff->other != NULL && hashmap_lookup(diff->other, key_grab_id(grab->modifiers, grab->keycode)) != NULL) {
+        return;
+    }
+    xcb_grab_key(diff->conn, 0, root, grab->modifiers, grab->keycode, XCB_GRAB_MODE_SYNC, XCB_GRAB_MODE_ASYNC);
+    diff->requests++;
+}
+
+static void ungrab_if_removed(void *value, void *userdata) {
+    struct key_grab *grab = value;
+    struct grab_diff *diff = userdata;
+    if (hashmap_lookup(diff->other, key_grab_id(grab->modifiers, grab->keycode)) != NULL) {
+        return;
+    }
+    xcb_ungrab_key(diff->conn, grab->keycode, root, grab->modifiers);
+    diff->requests++;
+}
+
+static void free_key_grab(void *value, void *userdata) {
+    free(value);
 }
 
 /*
- * Grab the bound keys (tell X to send us keypress events for those keycodes)
+ * Forgets about the active key grabs. To be called when all keys were
+ * ungrabbed, see ungrab_all_keys().
+ *
+ */
+void forget_key_grabs(void) {
+    if (active_key_grabs == NULL) {
+        return;
+    }
+    hashmap_foreach(active_key_grabs, free_key_grab, NULL);
+    hashmap_free(active_key_grabs);
+    active_key_grabs = NULL;
+}
+
+/*
+ * Grab the bound keys (tell X to send us keypress events for those keycodes).
+ * Only the keys which are not grabbed yet are grabbed, and keys which are no
+ * longer bound (e.g. after a mode or XKB group switch) are ungrabbed.
  *
  */
 void grab_all_keys(xcb_connection_t *conn) {
+    hashmap_t *grabs = hashmap_new();
     Binding *bind;
     TAILQ_FOREACH (bind, bindings, bindings) {
         if (bind->input_type != B_KEYBOARD)
@@ -157,7 +311,7 @@ void grab_all_keys(xcb_connection_t *conn) {
 
         /* The easy case: the user specified a keycode directly. */
         if (bind->keycode > 0) {
-            grab_keycode_for_binding(conn, bind, bind->keycode);
+            add_keycode_grabs_for_binding(grabs, bind, bind->keycode);
             continue;
         }
 
@@ -166,18 +320,66 @@ void grab_all_keys(xcb_connection_t *conn) {
             const int keycode = binding_keycode->keycode;
             const int mods = (binding_keycode->modifiers & 0xFFFF);
             DLOG("Binding %p Grabbing keycode %d with mods %d\n", bind, keycode, mods);
-            xcb_grab_key(conn, 0, root, mods, keycode, XCB_GRAB_MODE_SYNC, XCB_GRAB_MODE_ASYNC);
+            add_key_grab(grabs, mods, keycode);
         }
     }
+
+    struct grab_diff diff = {.conn = conn, .other = grabs};
+    if (active_key_grabs != NULL) {
+        hashmap_foreach(active_key_grabs, ungrab_if_removed, &diff);
+    }
+    diff.other = active_key_grabs;
+    hashmap_foreach(grabs, grab_if_new, &diff);
+    DLOG("Updated key grabs with %d requests, %zu keys grabbed\n", diff.requests, hashmap_size(grabs));
+
+    forget_key_grabs();
+    active_key_grabs = grabs;
+}
+
+static bool buttons_contain(const int *buttons, int button) {
+    for (; *buttons != 0; buttons++) {
+        if (*buttons == button) {
+            return true;
+        }
+    }
+    return false;
 }
 
 /*
- * Release the button grabs on all managed windows and regrab them,
- * reevaluating which buttons need to be grabbed.
+ * Updates the button grabs on all managed windows, reevaluating which buttons
+ * need to be grabbed. If old_buttons is not NULL, all windows have exactly
+ * those buttons grabbed, so only the difference is ungrabbed and grabbed.
+ * Otherwise, all button grabs are released and grabbed again.
  *
  */
-void regrab_all_buttons(xcb_connection_t *conn) {
+void regrab_all_buttons(xcb_connection_t *conn, const int *old_buttons) {
     int *buttons = bindings_get_buttons_to_grab();
+    int *added = NULL;
+    int *removed = NULL;
+    if (old_buttons != NULL) {
+        size_t num_added = 0, num_removed = 0;
+        for (const int *walk = buttons; *walk != 0; walk++) {
+            num_added++;
+        }
+        for (const int *walk = old_buttons; *walk != 0; walk++) {
+            num_removed++;
+        }
+        added = scalloc(num_added + 1, sizeof(int));
+        removed = scalloc(num_removed + 1, sizeof(int));
+        num_added = num_removed = 0;
+        for (const int *walk = buttons; *walk != 0; walk++) {
+            if (!buttons_contain(old_buttons, *walk)) {
+                added[num_added++] = *walk;
+            }
+        }
+        for (const int *walk = old_buttons; *walk != 0; walk++) {
+            if (!buttons_contain(buttons, *walk)) {
+                removed[num_removed++] = *walk;
+            }
+        }
+        DLOG("Regrabbing buttons: %zu added, %zu removed\n", num_added, num_removed);
+    }
+
     xcb_grab_server(conn);
 
     Con *con;
@@ -185,10 +387,20 @@ void regrab_all_buttons(xcb_connection_t *conn) {
         if (con->window == NULL)
             continue;
 
-        xcb_ungrab_button(conn, XCB_BUTTON_INDEX_ANY, con->window->id, XCB_BUTTON_MASK_ANY);
-        xcb_grab_buttons(conn, con->window->id, buttons);
+        if (old_buttons == NULL) {
+            xcb_ungrab_button(conn, XCB_BUTTON_INDEX_ANY, con->window->id, XCB_BUTTON_MASK_ANY);
+            xcb_grab_buttons(conn, con->window->id, buttons);
+            continue;
+        }
+
+        for (const int *walk = removed; *walk != 0; walk++) {
+            xcb_ungrab_button(conn, *walk, con->window->id, XCB_BUTTON_MASK_ANY);
+        }
+        xcb_grab_buttons(conn, con->window->id, added);
     }
 
+    FREE(added);
+    FREE(removed);
     FREE(buttons);
     xcb_ungrab_server(conn);
 }
@@ -202,10 +414,15 @@ static Binding *get_binding(i3_event_state_mask_t state_filtered, bool is_releas
     Binding *bind;
     Binding *result = NULL;
 
+    if (binding_index.bindings != bindings) {
+        index_bindings();
+    }
+
     if (!is_release) {
         /* On a press event, we first reset all B_UPON_KEYRELEASE_IGNORE_MODS
          * bindings back to B_UPON_KEYRELEASE */
-        TAILQ_FOREACH (bind, bindings, bindings) {
+        for (size_t i = 0; i < binding_index.release_bindings.num; i++) {
+            bind = binding_index.release_bindings.bindings[i];
             if (bind->input_type != input_type)
                 continue;
             if (bind->release == B_UPON_KEYRELEASE_IGNORE_MODS)
@@ -213,9 +430,16 @@ static Binding *get_binding(i3_event_state_mask_t state_filtered, bool is_releas
         }
     }
 
+    /* Only the bindings for this key can match. */
+    const binding_list *candidates = hashmap_lookup(binding_index.by_key, binding_key(input_type, input_code));
+    if (candidates == NULL) {
+        return NULL;
+    }
+
     const uint32_t xkb_group_state = (state_filtered & 0xFFFF0000);
     const uint32_t modifiers_state = (state_filtered & 0x0000FFFF);
-    TAILQ_FOREACH (bind, bindings, bindings) {
+    for (size_t i = 0; i < candidates->num; i++) {
+        bind = candidates->bindings[i];
         if (bind->input_type != input_type) {
             continue;
         }
@@ -344,12 +568,46 @@ Binding *get_binding_from_xcb_event(xcb_generic_event_t *event) {
     return get_binding(state_filtered, is_release, event_detail, input_type);
 }
 
-struct resolve {
-    /* The binding which we are resolving. */
-    Binding *bind;
+#define ADD_TRANSLATED_KEY(code, mods)                                                     \
+    do {                                                                                   \
+        struct Binding_Keycode *binding_keycode = smalloc(sizeof(struct Binding_Keycode)); \
+        binding_keycode->modifiers = (mods);                                               \
+        binding_keycode->keycode = (code);                                                 \
+        TAILQ_INSERT_TAIL(&(bind->keycodes_head), binding_keycode, keycodes);              \
+    } while (0)
 
-    /* |bind|’s keysym (translated to xkb_keysym_t), e.g. XKB_KEY_R. */
-    xkb_keysym_t keysym;
+/* A keycode which produces a keysym in a keysym_table. */
+struct keysym_match {
+    xkb_keycode_t keycode;
+    /* The keysym the key produces with NumLock active (and without Shift if
+     * the match was found without Shift). */
+    xkb_keysym_t sym_numlock;
+};
+
+typedef struct keysym_matches {
+    size_t num;
+    size_t capacity;
+    struct keysym_match *matches;
+} keysym_matches;
+
+/* For one combination of modifiers and group, maps each keysym to the
+ * keycodes which produce it, in keycode order. Built once per keymap, so that
+ * translate_keysyms() does not need to look at every keycode for every
+ * binding. */
+struct keysym_table {
+    xkb_mod_mask_t mods;
+    xkb_layout_index_t group;
+    uint32_t numlock_mask;
+    hashmap_t *by_keysym;
+
+    SLIST_ENTRY(keysym_table) tables;
+};
+
+static SLIST_HEAD(keysym_tables_head, keysym_table) keysym_tables;
+
+/* The states used while building a keysym_table. */
+struct keysym_table_builder {
+    struct keysym_table *table;
 
     /* The xkb state built from the user-provided modifiers and group. */
     struct xkb_state *xkb_state;
@@ -364,42 +622,132 @@ struct resolve {
     struct xkb_state *xkb_state_numlock_no_shift;
 };
 
-#define ADD_TRANSLATED_KEY(code, mods)                                                     \
-    do {                                                                                   \
-        struct Binding_Keycode *binding_keycode = smalloc(sizeof(struct Binding_Keycode)); \
-        binding_keycode->modifiers = (mods);                                               \
-        binding_keycode->keycode = (code);                                                 \
-        TAILQ_INSERT_TAIL(&(bind->keycodes_head), binding_keycode, keycodes);              \
-    } while (0)
+static void keysym_matches_free(void *value, void *userdata) {
+    keysym_matches *list = value;
+    free(list->matches);
+    free(list);
+}
+
+/*
+ * Frees the keysym tables, which have to be rebuilt when the keymap changed.
+ *
+ */
+static void keysym_tables_free(void) {
+    while (!SLIST_EMPTY(&keysym_tables)) {
+        struct keysym_table *table = SLIST_FIRST(&keysym_tables);
+        SLIST_REMOVE_HEAD(&keysym_tables, tables);
+        hashmap_foreach(table->by_keysym, keysym_matches_free, NULL);
+        hashmap_free(table->by_keysym);
+        free(table);
+    }
+}
+
+static void keysym_table_add(struct keysym_table *table, xkb_keysym_t sym, xkb_keycode_t key, xkb_keysym_t sym_numlock) {
+    if (sym == XKB_KEY_NoSymbol) {
+        return;
+    }
+    keysym_matches *list = hashmap_lookup(table->by_keysym, sym);
+    if (list == NULL) {
+        list = scalloc(1, sizeof(keysym_matches));
+        hashmap_insert(table->by_keysym, sym, list);
+    }
+    if (list->num == list->capacity) {
+        list->capacity = (list->capacity == 0 ? 2 : list->capacity * 2);
+        list->matches = srealloc(list->matches, list->capacity * sizeof(struct keysym_match));
+    }
+    list->matches[list->num++] = (struct keysym_match){.keycode = key, .sym_numlock = sym_numlock};
+}
+
+/*
+ * Called for each keycode in the keymap, adds the keysym the keycode results
+ * in to the table. If the keysym only results from the keycode without Shift,
+ * it is added as well, so that “bindsym $mod+Shift+a nop” actually works.
+ *
+ */
+static void keysym_table_add_key(struct xkb_keymap *keymap, xkb_keycode_t key, void *data) {
+    const struct keysym_table_builder *builder = data;
+    const xkb_keysym_t sym = xkb_state_key_get_one_sym(builder->xkb_state, key);
+    keysym_table_add(builder->table, sym, key, xkb_state_key_get_one_sym(builder->xkb_state_numlock, key));
+
+    const xkb_layout_index_t layout = xkb_state_key_get_layout(builder->xkb_state, key);
+    if (layout == XKB_LAYOUT_INVALID)
+        return;
+    if (xkb_state_key_get_level(builder->xkb_state, key, layout) > 1)
+        return;
+    /* Skip the Shift fallback for keypad keys, otherwise one cannot bind
+     * KP_1 independent of KP_End. */
+    if (sym >= XKB_KEY_KP_Space && sym <= XKB_KEY_KP_Equal)
+        return;
+    const xkb_keysym_t sym_no_shift = xkb_state_key_get_one_sym(builder->xkb_state_no_shift, key);
+    if (sym_no_shift != sym) {
+        keysym_table_add(builder->table, sym_no_shift, key,
+                         xkb_state_key_get_one_sym(builder->xkb_state_numlock_no_shift, key));
+    }
+}
+
+static void update_state_mask(struct xkb_state *state, xkb_mod_mask_t mods, xkb_layout_index_t group) {
+    (void)xkb_state_update_mask(
+        state,
+        mods /* xkb_mod_mask_t base_mods, */,
+        0 /* xkb_mod_mask_t latched_mods, */,
+        0 /* xkb_mod_mask_t locked_mods, */,
+        0 /* xkb_layout_index_t base_group, */,
+        0 /* xkb_layout_index_t latched_group, */,
+        group /* xkb_layout_index_t locked_group, */);
+}
 
 /*
- * add_keycode_if_matches is called for each keycode in the keymap and will add
- * the keycode to |data->bind| if the keycode can result in the keysym
- * |data->resolving|.
+ * Returns the keysym table for the given modifiers and group, building it if
+ * it does not exist yet. Returns NULL if the XKB states cannot be created.
  *
  */
-static void add_keycode_if_matches(struct xkb_keymap *keymap, xkb_keycode_t key, void *data) {
-    const struct resolve *resolving = data;
-    struct xkb_state *numlock_state = resolving->xkb_state_numlock;
-    xkb_keysym_t sym = xkb_state_key_get_one_sym(resolving->xkb_state, key);
-    if (sym != resolving->keysym) {
-        /* Check if Shift was specified, and try resolving the symbol without
-         * shift, so that “bindsym $mod+Shift+a nop” actually works. */
-        const xkb_layout_index_t layout = xkb_state_key_get_layout(resolving->xkb_state, key);
-        if (layout == XKB_LAYOUT_INVALID)
-            return;
-        if (xkb_state_key_get_level(resolving->xkb_state, key, layout) > 1)
-            return;
-        /* Skip the Shift fallback for keypad keys, otherwise one cannot bind
-         * KP_1 independent of KP_End. */
-        if (sym >= XKB_KEY_KP_Space && sym <= XKB_KEY_KP_Equal)
-            return;
-        numlock_state = resolving->xkb_state_numlock_no_shift;
-        sym = xkb_state_key_get_one_sym(resolving->xkb_state_no_shift, key);
-        if (sym != resolving->keysym)
-            return;
+static struct keysym_table *keysym_table_get(xkb_mod_mask_t mods, xkb_layout_index_t group) {
+    struct keysym_table *table;
+    SLIST_FOREACH (table, &keysym_tables, tables) {
+        if (table->mods == mods && table->group == group && table->numlock_mask == xcb_numlock_mask) {
+            return table;
+        }
+    }
+
+    struct keysym_table_builder builder = {0};
+    if ((builder.xkb_state = xkb_state_new(xkb_keymap)) == NULL ||
+        (builder.xkb_state_no_shift = xkb_state_new(xkb_keymap)) == NULL ||
+        (builder.xkb_state_numlock = xkb_state_new(xkb_keymap)) == NULL ||
+        (builder.xkb_state_numlock_no_shift = xkb_state_new(xkb_keymap)) == NULL) {
+        table = NULL;
+        goto out;
     }
-    Binding *bind = resolving->bind;
+    update_state_mask(builder.xkb_state, mods, group);
+    update_state_mask(builder.xkb_state_no_shift, mods ^ XCB_KEY_BUT_MASK_SHIFT, group);
+    update_state_mask(builder.xkb_state_numlock, mods | xcb_numlock_mask, group);
+    update_state_mask(builder.xkb_state_numlock_no_shift, (mods | xcb_numlock_mask) ^ XCB_KEY_BUT_MASK_SHIFT, group);
+
+    table = scalloc(1, sizeof(struct keysym_table));
+    table->mods = mods;
+    table->group = group;
+    table->numlock_mask = xcb_numlock_mask;
+    table->by_keysym = hashmap_new();
+    builder.table = table;
+    xkb_keymap_key_for_each(xkb_keymap, keysym_table_add_key, &builder);
+    SLIST_INSERT_HEAD(&keysym_tables, table, tables);
+    DLOG("Built keysym table for mods 0x%x, group %d (%zu keysyms)\n",
+         mods, group, hashmap_size(table->by_keysym));
+
+out:
+    xkb_state_unref(builder.xkb_state);
+    xkb_state_unref(builder.xkb_state_no_shift);
+    xkb_state_unref(builder.xkb_state_numlock);
+    xkb_state_unref(builder.xkb_state_numlock_no_shift);
+    return table;
+}
+
+/*
+ * Adds the keycode which results in |keysym| to |bind|, together with the
+ * CapsLock and NumLock fallbacks.
+ *
+ */
+static void add_keycode_match(Binding *bind, xkb_keysym_t keysym, const struct keysym_match *match) {
+    const xkb_keycode_t key = match->keycode;
 
     ADD_TRANSLATED_KEY(key, bind->event_state_mask);
 
@@ -413,8 +761,7 @@ static void add_keycode_if_matches(struct xkb_keymap *keymap, xkb_keycode_t key,
          * active. If so, grab the key with NumLock as well, so that users don’t
          * need to duplicate every key binding with an additional Mod2 specified.
          */
-        xkb_keysym_t sym_numlock = xkb_state_key_get_one_sym(numlock_state, key);
-        if (sym_numlock == resolving->keysym) {
+        if (match->sym_numlock == keysym) {
             /* Also bind the key with active NumLock */
             ADD_TRANSLATED_KEY(key, bind->event_state_mask | xcb_numlock_mask);
 
@@ -422,7 +769,7 @@ static void add_keycode_if_matches(struct xkb_keymap *keymap, xkb_keycode_t key,
             ADD_TRANSLATED_KEY(key, bind->event_state_mask | xcb_numlock_mask | XCB_MOD_MASK_LOCK);
         } else {
             DLOG("Skipping automatic numlock fallback, key %d resolves to 0x%x with numlock\n",
-                 key, sym_numlock);
+                 key, match->sym_numlock);
         }
     }
 }
@@ -433,15 +780,11 @@ static void add_keycode_if_matches(struct xkb_keymap *keymap, xkb_keycode_t key,
  */
 void translate_keysyms(void) {
     struct xkb_state *dummy_state = NULL;
-    struct xkb_state *dummy_state_no_shift = NULL;
     struct xkb_state *dummy_state_numlock = NULL;
-    struct xkb_state *dummy_state_numlock_no_shift = NULL;
     bool has_errors = false;
 
     if ((dummy_state = xkb_state_new(xkb_keymap)) == NULL ||
-        (dummy_state_no_shift = xkb_state_new(xkb_keymap)) == NULL ||
-        (dummy_state_numlock = xkb_state_new(xkb_keymap)) == NULL ||
-        (dummy_state_numlock_no_shift = xkb_state_new(xkb_keymap)) == NULL) {
+        (dummy_state_numlock = xkb_state_new(xkb_keymap)) == NULL) {
         ELOG("Could not create XKB state, cannot translate keysyms.\n");
         goto out;
     }
@@ -474,43 +817,11 @@ void translate_keysyms(void) {
              (bind->event_state_mask & I3_XKB_GROUP_MASK_2) ? "yes" : "no",
              (bind->event_state_mask & I3_XKB_GROUP_MASK_3) ? "yes" : "no",
              (bind->event_state_mask & I3_XKB_GROUP_MASK_4) ? "yes" : "no");
-        (void)xkb_state_update_mask(
-            dummy_state,
-            (bind->event_state_mask & 0x1FFF) /* xkb_mod_mask_t base_mods, */,
-            0 /* xkb_mod_mask_t latched_mods, */,
-            0 /* xkb_mod_mask_t locked_mods, */,
-            0 /* xkb_layout_index_t base_group, */,
-            0 /* xkb_layout_index_t latched_group, */,
-            group /* xkb_layout_index_t locked_group, */);
-
-        (void)xkb_state_update_mask(
-            dummy_state_no_shift,
-            (bind->event_state_mask & 0x1FFF) ^ XCB_KEY_BUT_MASK_SHIFT /* xkb_mod_mask_t base_mods, */,
-            0 /* xkb_mod_mask_t latched_mods, */,
-            0 /* xkb_mod_mask_t locked_mods, */,
-            0 /* xkb_layout_index_t base_group, */,
-            0 /* xkb_layout_index_t latched_group, */,
-            group /* xkb_layout_index_t locked_group, */);
-
-        (void)xkb_state_update_mask(
-            dummy_state_numlock,
-            (bind->event_state_mask & 0x1FFF) | xcb_numlock_mask /* xkb_mod_mask_t base_mods, */,
-            0 /* xkb_mod_mask_t latched_mods, */,
-            0 /* xkb_mod_mask_t locked_mods, */,
-            0 /* xkb_layout_index_t base_group, */,
-            0 /* xkb_layout_index_t latched_group, */,
-            group /* xkb_layout_index_t locked_group, */);
-
-        (void)xkb_state_update_mask(
-            dummy_state_numlock_no_shift,
-            ((bind->event_state_mask & 0x1FFF) | xcb_numlock_mask) ^ XCB_KEY_BUT_MASK_SHIFT /* xkb_mod_mask_t base_mods, */,
-            0 /* xkb_mod_mask_t latched_mods, */,
-            0 /* xkb_mod_mask_t locked_mods, */,
-            0 /* xkb_layout_index_t base_group, */,
-            0 /* xkb_layout_index_t latched_group, */,
-            group /* xkb_layout_index_t locked_group, */);
 
         if (bind->keycode > 0) {
+            update_state_mask(dummy_state, bind->event_state_mask & 0x1FFF, group);
+            update_state_mask(dummy_state_numlock, (bind->event_state_mask & 0x1FFF) | xcb_numlock_mask, group);
+
             /* We need to specify modifiers for the keycode binding (numlock
              * fallback). */
             while (!TAILQ_EMPTY(&(bind->keycodes_head))) {
@@ -556,20 +867,20 @@ void translate_keysyms(void) {
             continue;
         }
 
-        struct resolve resolving = {
-            .bind = bind,
-            .keysym = keysym,
-            .xkb_state = dummy_state,
-            .xkb_state_no_shift = dummy_state_no_shift,
-            .xkb_state_numlock = dummy_state_numlock,
-            .xkb_state_numlock_no_shift = dummy_state_numlock_no_shift,
-        };
+        struct keysym_table *table = keysym_table_get(bind->event_state_mask & 0x1FFF, group);
+        if (table == NULL) {
+            ELOG("Could not create XKB state, cannot translate keysyms.\n");
+            goto out;
+        }
         while (!TAILQ_EMPTY(&(bind->keycodes_head))) {
             struct Binding_Keycode *first = TAILQ_FIRST(&(bind->keycodes_head));
             TAILQ_REMOVE(&(bind->keycodes_head), first, keycodes);
             FREE(first);
         }
-        xkb_keymap_key_for_each(xkb_keymap, add_keycode_if_matches, &resolving);
+        const keysym_matches *matches = hashmap_lookup(table->by_keysym, keysym);
+        for (size_t i = 0; matches != NULL && i < matches->num; i++) {
+            add_keycode_match(bind, keysym, &(matches->matches[i]));
+        }
         char *keycodes = sstrdup("");
         int num_keycodes = 0;
         struct Binding_Keycode *binding_keycode;
@@ -601,10 +912,10 @@ void translate_keysyms(void) {
     }
 
 out:
+    index_bindings();
+
     xkb_state_unref(dummy_state);
-    xkb_state_unref(dummy_state_no_shift);
     xkb_state_unref(dummy_state_numlock);
-    xkb_state_unref(dummy_state_numlock_no_shift);
 
     if (has_errors) {
         start_config_error_nagbar(current_configpath, true);
@@ -626,7 +937,6 @@ void switch_mode(const char *new_mode) {
         if (strcmp(mode->name, new_mode) != 0)
             continue;
 
-        ungrab_all_keys(conn);
         bindings = mode->bindings;
         current_binding_mode = mode->name;
         translate_keysyms();
@@ -640,12 +950,14 @@ void switch_mode(const char *new_mode) {
                 bind->release = B_UPON_KEYRELEASE;
         }
 
-        char *event_msg;
-        sasprintf(&event_msg, "{\"change\":\"%s\", \"pango_markup\":%s}",
-                  mode->name, (mode->pango_markup ? "true" : "false"));
+        if (ipc_has_event_listeners(I3_IPC_EVENT_MODE)) {
+            char *event_msg;
+            sasprintf(&event_msg, "{\"change\":\"%s\", \"pango_markup\":%s}",
+                      mode->name, (mode->pango_markup ? "true" : "false"));
 
-        ipc_send_event("mode", I3_IPC_EVENT_MODE, event_msg);
-        FREE(event_msg);
+            ipc_send_event(I3_IPC_EVENT_MODE, event_msg);
+            FREE(event_msg);
+        }
 
         return;
     }
@@ -694,6 +1006,58 @@ static void reorder_bindings_of_mode(struct Mode *mode) {
     mode->bindings = reordered;
 }
 
+static uint32_t hash_bytes(uint32_t hash, const void *data, size_t size) {
+    /* FNV-1a */
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619;
+    }
+    return hash;
+}
+
+/*
+ * Assigns every binding an id derived from its mode and its input (type,
+ * symbol or keycode, modifiers and flags), but not its command. The ids thus
+ * stay the same across reloads, even when other bindings are added or
+ * removed. Collisions are resolved by using the next free id.
+ *
+ */
+void assign_binding_ids(void) {
+    hashmap_t *used = hashmap_new();
+
+    struct Mode *mode;
+    SLIST_FOREACH (mode, &modes, modes) {
+        Binding *bind;
+        TAILQ_FOREACH (bind, mode->bindings, bindings) {
+            uint32_t hash = 2166136261;
+            hash = hash_bytes(hash, mode->name, strlen(mode->name) + 1);
+            if (bind->symbol != NULL) {
+                hash = hash_bytes(hash, bind->symbol, strlen(bind->symbol) + 1);
+            } else {
+                hash = hash_bytes(hash, &(bind->keycode), sizeof(bind->keycode));
+            }
+            const uint32_t flags = (bind->input_type |
+                                    (bind->release != B_UPON_KEYPRESS) << 1 |
+                                    bind->border << 2 |
+                                    bind->whole_window << 3 |
+                                    bind->exclude_titlebar << 4);
+            hash = hash_bytes(hash, &flags, sizeof(flags));
+            hash = hash_bytes(hash, &(bind->event_state_mask), sizeof(bind->event_state_mask));
+
+            /* Keep the ids positive and non-zero, so that they are easy to
+             * handle in any language. */
+            uint32_t id = (hash & INT32_MAX);
+            while (id == 0 || hashmap_lookup(used, id) != NULL) {
+                id = ((id + 1) & INT32_MAX);
+            }
+            bind->id = id;
+            hashmap_insert(used, id, bind);
+        }
+    }
+
+    hashmap_free(used);
+}
+
 /*
  * Reorders bindings by event_state_mask descendingly so that get_binding()
  * correctly matches more specific bindings before more generic bindings. Take
@@ -718,37 +1082,26 @@ void reorder_bindings(void) {
 }
 
 /*
- * Returns true if a is a key binding for the same key as b.
+ * Returns a string which is the same for two bindings exactly if they are
+ * bindings for the same key: the input type, the keycode, the keysym (compared
+ * case-insensitively, if any), the modifiers and the release mode. Has to be
+ * freed by the caller.
  *
  */
-static bool binding_same_key(Binding *a, Binding *b) {
-    /* Check if the input types are different */
-    if (a->input_type != b->input_type) {
-        return false;
-    }
-
-    /* Check if one is using keysym while the other is using bindsym. */
-    if ((a->symbol == NULL && b->symbol != NULL) ||
-        (a->symbol != NULL && b->symbol == NULL)) {
-        return false;
-    }
-
-    /* If a is NULL, b has to be NULL, too (see previous conditional).
-     * If the keycodes differ, it can't be a duplicate. */
-    if (a->symbol != NULL &&
-        strcasecmp(a->symbol, b->symbol) != 0) {
-        return false;
-    }
-
-    /* Check if the keycodes or modifiers are different. If so, they
-     * can't be duplicate */
-    if (a->keycode != b->keycode ||
-        a->event_state_mask != b->event_state_mask ||
-        a->release != b->release) {
-        return false;
+static char *binding_key_string(Binding *bind) {
+    char *symbol = NULL;
+    if (bind->symbol != NULL) {
+        symbol = sstrdup(bind->symbol);
+        for (char *walk = symbol; *walk != '\0'; walk++) {
+            *walk = tolower((unsigned char)*walk);
+        }
     }
 
-    return true;
+    char *key;
+    sasprintf(&key, "%d %u 0x%x %d %c%s", bind->input_type, bind->keycode, bind->event_state_mask,
+              bind->release, (symbol != NULL ? 's' : 'c'), (symbol != NULL ? symbol : ""));
+    free(symbol);
+    return key;
 }
 
 /*
@@ -757,31 +1110,32 @@ static bool binding_same_key(Binding *a, Binding *b) {
  * stderr and the has_errors variable is set to true, which will start
  * i3-nagbar.
  *
+ * The bindings are looked up by binding_key_string() in a hash map, so that
+ * this takes linear time even for thousands of bindings.
+ *
  */
 void check_for_duplicate_bindings(struct context *context) {
-    Binding *bind, *current;
+    hashmap_t *seen = hashmap_new();
+    Binding *current;
     TAILQ_FOREACH (current, bindings, bindings) {
-        TAILQ_FOREACH (bind, bindings, bindings) {
-            /* Abort when we reach the current keybinding, only check the
-             * bindings before */
-            if (bind == current) {
-                break;
-            }
-
-            if (!binding_same_key(bind, current)) {
-                continue;
-            }
+        char *key = binding_key_string(current);
+        if (hashmap_lookup_str(seen, key) == NULL) {
+            hashmap_insert_str(seen, key, current);
+            free(key);
+            continue;
+        }
+        free(key);
 
-            context->has_errors = true;
-            if (current->keycode != 0) {
-                ELOG("Duplicate keybinding in config file:\n  state mask 0x%x with keycode %d, command \"%s\"\n",
-                     current->event_state_mask, current->keycode, current->command);
-            } else {
-                ELOG("Duplicate keybinding in config file:\n  state mask 0x%x with keysym %s, command \"%s\"\n",
-                     current->event_state_mask, current->symbol, current->command);
-            }
+        context->has_errors = true;
+        if (current->keycode != 0) {
+            ELOG("Duplicate keybinding in config file:\n  state mask 0x%x with keycode %d, command \"%s\"\n",
+                 current->event_state_mask, current->keycode, current->command);
+        } else {
+            ELOG("Duplicate keybinding in config file:\n  state mask 0x%x with keysym %s, command \"%s\"\n",
+                 current->event_state_mask, current->symbol, current->command);
         }
     }
+    hashmap_free(seen);
 }
 
 /*
@@ -794,6 +1148,7 @@ static Binding *binding_copy(Binding *bind) {
         ret->symbol = sstrdup(bind->symbol);
     if (bind->command != NULL)
         ret->command = sstrdup(bind->command);
+    parsed_command_ref(ret->parsed_command);
     TAILQ_INIT(&(ret->keycodes_head));
     struct Binding_Keycode *binding_keycode;
     TAILQ_FOREACH (binding_keycode, &(bind->keycodes_head), keycodes) {
@@ -821,6 +1176,7 @@ void binding_free(Binding *bind) {
 
     FREE(bind->symbol);
     FREE(bind->command);
+    parsed_command_unref(bind->parsed_command);
     FREE(bind);
 }
 
@@ -837,17 +1193,24 @@ CommandResult *run_binding(Binding *bind, Con *con) {
     /* We need to copy the binding and command since “reload” may be part of
      * the command, and then the memory that bind points to may not contain the
      * same data anymore. */
-    if (con == NULL)
-        command = sstrdup(bind->command);
-    else
-        sasprintf(&command, "[con_id=\"%p\"] %s", con, bind->command);
-
     Binding *bind_cp = binding_copy(bind);
-    CommandResult *result = parse_command(command, NULL, NULL);
-    free(command);
+    stats_input_binding(bind_cp);
+    CommandResult *result;
+    if (con == NULL && bind_cp->parsed_command != NULL) {
+        DLOG("COMMAND (pre-parsed): *%.4000s*\n", bind_cp->command);
+        result = run_parsed_command(bind_cp->parsed_command, NULL, NULL);
+    } else {
+        if (con == NULL)
+            command = sstrdup(bind->command);
+        else
+            sasprintf(&command, "[con_id=\"%p\"] %s", con, bind->command);
+
+        result = parse_command(command, NULL, NULL);
+        free(command);
+    }
 
     if (result->needs_tree_render)
-        tree_render();
+        tree_schedule_render();
 
     if (result->parse_error) {
         char *pageraction;
@@ -946,8 +1309,16 @@ static int fill_rmlvo_from_root(struct xkb_rule_names *xkb_names) {
 /*
  * Loads the XKB keymap from the X11 server and feeds it to xkbcommon.
  *
+ * The keymap (and the keysym tables built from it, see keysym_table_get())
+ * is kept if the new one is identical, e.g. when the same keyboard is plugged
+ * in again. Without XKB, the keymap is only compiled again if the RMLVO names
+ * changed.
+ *
  */
 bool load_keymap(void) {
+    static char *keymap_string = NULL;
+    static char *rmlvo_key = NULL;
+
     if (xkb_context == NULL) {
         if ((xkb_context = xkb_context_new(0)) == NULL) {
             ELOG("Could not create xkbcommon context\n");
@@ -956,12 +1327,22 @@ bool load_keymap(void) {
     }
 
     struct xkb_keymap *new_keymap = NULL;
+    char *new_keymap_string = NULL;
+    char *new_rmlvo_key = NULL;
     int32_t device_id;
     if (xkb_supported && (device_id = xkb_x11_get_core_keyboard_device_id(conn)) > -1) {
         if ((new_keymap = xkb_x11_keymap_new_from_device(xkb_context, conn, device_id, 0)) == NULL) {
             ELOG("xkb_x11_keymap_new_from_device failed\n");
             return false;
         }
+        new_keymap_string = xkb_keymap_get_as_string(new_keymap, XKB_KEYMAP_FORMAT_TEXT_V1);
+        if (xkb_keymap != NULL && new_keymap_string != NULL && keymap_string != NULL &&
+            strcmp(new_keymap_string, keymap_string) == 0) {
+            DLOG("The keymap did not change, keeping it\n");
+            xkb_keymap_unref(new_keymap);
+            free(new_keymap_string);
+            return true;
+        }
     } else {
         /* Likely there is no XKB support on this server, possibly because it
          * is a VNC server. */
@@ -976,31 +1357,43 @@ bool load_keymap(void) {
             ELOG("Could not get _XKB_RULES_NAMES atom from root window, falling back to defaults.\n");
             /* Using NULL for the fields of xkb_rule_names. */
         }
-        new_keymap = xkb_keymap_new_from_names(xkb_context, &names, 0);
+        sasprintf(&new_rmlvo_key, "%s,%s,%s,%s,%s",
+                  (names.rules ? names.rules : ""), (names.model ? names.model : ""),
+                  (names.layout ? names.layout : ""), (names.variant ? names.variant : ""),
+                  (names.options ? names.options : ""));
+        const bool unchanged = (xkb_keymap != NULL && rmlvo_key != NULL && strcmp(new_rmlvo_key, rmlvo_key) == 0);
+        if (!unchanged) {
+            new_keymap = xkb_keymap_new_from_names(xkb_context, &names, 0);
+        }
         free((char *)names.rules);
         free((char *)names.model);
         free((char *)names.layout);
         free((char *)names.variant);
         free((char *)names.options);
+        if (unchanged) {
+            DLOG("The RMLVO names did not change, keeping the keymap\n");
+            free(new_rmlvo_key);
+            return true;
+        }
         if (new_keymap == NULL) {
             ELOG("xkb_keymap_new_from_names failed\n");
+            free(new_rmlvo_key);
             return false;
         }
     }
     xkb_keymap_unref(xkb_keymap);
     xkb_keymap = new_keymap;
+    keysym_tables_free();
+
+    free(keymap_string);
+    keymap_string = new_keymap_string;
+    free(rmlvo_key);
+    rmlvo_key = new_rmlvo_key;
 
     return true;
 }
 
-/*
- * Returns a list of buttons that should be grabbed on a window.
- * This list will always contain 1–3, all higher buttons will only be returned
- * if there is a whole-window binding for it on some window in the current
- * config.
- * The list is terminated by a 0.
- */
-int *bindings_get_buttons_to_grab(void) {
+static int *buttons_to_grab_for(struct bindings_head *bindings) {
     /* Let's make the reasonable assumption that there's no more than 25
      * buttons. */
     int num_max = 25;
@@ -1043,3 +1436,52 @@ int *bindings_get_buttons_to_grab(void) {
 
     return buttons;
 }
+
+/*
+ * Returns a list of buttons that should be grabbed on a window.
+ * This list will always contain 1–3, all higher buttons will only be returned
+ * if there is a whole-window binding for it on some window in the current
+ * config.
+ * The list is terminated by a 0.
+ */
+int *bindings_get_buttons_to_grab(void) {
+    return buttons_to_grab_for(bindings);
+}
+
+/*
+ * Returns true if both lists of buttons (as returned by
+ * bindings_get_buttons_to_grab()) are the same.
+ *
+ */
+bool bindings_buttons_equal(const int *a, const int *b) {
+    for (; *a != 0 && *a == *b; a++, b++) {
+    }
+    return (*a == *b);
+}
+
+/*
+ * Returns the list of buttons to grab (see bindings_get_buttons_to_grab()) if
+ * it is the same in every mode, NULL otherwise. Since windows get the buttons
+ * of the mode which was active when they were managed, this tells whether all
+ * windows have the same buttons grabbed.
+ *
+ */
+int *bindings_get_buttons_to_grab_in_all_modes(void) {
+    int *result = NULL;
+    struct Mode *mode;
+    SLIST_FOREACH (mode, &modes, modes) {
+        int *buttons = buttons_to_grab_for(mode->bindings);
+        if (result == NULL) {
+            result = buttons;
+        } else {
+            const bool equal = bindings_buttons_equal(result, buttons);
+            free(buttons);
+            if (!equal) {
+                FREE(result);
+                return NULL;
+            }
+        }
+    }
+    return result;
+}
+
@@ -306,6 +306,43 @@ done:
     tree_render();
 }
 
+/*
+ * Returns the child of con whose title bar contains the given position
+ * (relative to con), or NULL. The title bars of stacked and tabbed containers
+ * are searched in the array prepared by render_con().
+ *
+ */
+static Con *con_by_deco_position(Con *con, int x, int y) {
+    Con *child;
+    if (con->deco_hits == NULL) {
+        TAILQ_FOREACH_REVERSE (child, &(con->nodes_head), nodes_head, nodes) {
+            if (rect_contains(child->deco_rect, x, y))
+                return child;
+        }
+        return NULL;
+    }
+
+    const bool tabbed = (con->layout == L_TABBED);
+    const int position = (tabbed ? x : y);
+    int low = 0;
+    int high = con->num_deco_hits - 1;
+    while (low <= high) {
+        const int middle = low + (high - low) / 2;
+        child = con->deco_hits[middle];
+        const Rect *dr = &(child->deco_rect);
+        const int start = (tabbed ? dr->x : dr->y);
+        const int size = (tabbed ? dr->width : dr->height);
+        if (position < start) {
+            high = middle - 1;
+        } else if (position >= start + size) {
+            low = middle + 1;
+        } else {
+            return (rect_contains(*dr, x, y) ? child : NULL);
+        }
+    }
+    return NULL;
+}
+
 /*
  * The button press X callback. This function determines whether the floating
  * modifier is pressed and where the user clicked (decoration, border, inside
@@ -322,6 +359,7 @@ void handle_button_press(xcb_button_press_event_t *event) {
          event->root_y);
 
     last_timestamp = event->time;
+    x_pointer_moved((event->event == root && event->child != XCB_NONE ? event->child : event->event), event->root_x, event->root_y);
 
     const uint32_t mod = (config.floating_modifier & 0xFFFF);
     const bool mod_pressed = (mod != 0 && (event->state & mod) == mod);
@@ -369,11 +407,8 @@ void handle_button_press(xcb_button_press_event_t *event) {
     }
 
     /* Check if the click was on the decoration of a child */
-    Con *child;
-    TAILQ_FOREACH_REVERSE (child, &(con->nodes_head), nodes_head, nodes) {
-        if (!rect_contains(child->deco_rect, event->event_x, event->event_y))
-            continue;
-
+    Con *child = con_by_deco_position(con, event->event_x, event->event_y);
+    if (child != NULL) {
         route_click(child, event, mod_pressed, CLICK_DECORATION);
         return;
     }
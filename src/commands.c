@@ -146,7 +146,6 @@ void cmd_criteria_init(I3_CMD) {
         ysuccess(true);
         return;
     }
-    Con *con;
     owindow *ow;
 
     DLOG("Initializing criteria, current_match = %p\n", current_match);
@@ -158,12 +157,193 @@ void cmd_criteria_init(I3_CMD) {
         free(ow);
     }
     TAILQ_INIT(&owindows);
-    /* copy all_cons */
-    TAILQ_FOREACH (con, &all_cons, all_cons) {
-        ow = smalloc(sizeof(owindow));
-        ow->con = con;
-        TAILQ_INSERT_TAIL(&owindows, ow, owindows);
+}
+
+typedef struct candidates {
+    size_t num;
+    size_t capacity;
+    Con **cons;
+} candidates;
+
+static void candidates_add(candidates *list, Con *con) {
+    if (list->num == list->capacity) {
+        list->capacity = (list->capacity == 0 ? 16 : list->capacity * 2);
+        list->cons = srealloc(list->cons, list->capacity * sizeof(Con *));
+    }
+    list->cons[list->num++] = con;
+}
+
+static void candidates_add_windows(candidates *list, Con *con) {
+    Con *child;
+    if (con->window != NULL) {
+        candidates_add(list, con);
+    }
+    TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
+        candidates_add_windows(list, child);
+    }
+    TAILQ_FOREACH (child, &(con->floating_head), floating_windows) {
+        candidates_add_windows(list, child);
+    }
+}
+
+static int candidates_cmp(const void *a, const void *b) {
+    const Con *first = *(Con *const *)a;
+    const Con *second = *(Con *const *)b;
+    return (first->creation_order > second->creation_order) -
+           (first->creation_order < second->creation_order);
+}
+
+/*
+ * Returns the literal of a ^literal$ criterion, which then matches the literal
+ * with and without a trailing newline (PCRE's "$" also matches right before
+ * one). Returns NULL if the literal itself ends in a newline, as the indexes
+ * can not be used for those.
+ *
+ */
+static const char *criterion_literal(struct regex *regex) {
+    const char *literal = regex_exact_literal(regex);
+    if (literal == NULL || (literal[0] != '\0' && literal[strlen(literal) - 1] == '\n')) {
+        return NULL;
+    }
+    return literal;
+}
+
+/*
+ * Returns the string which the given window criterion must be equal to (up to
+ * a trailing newline, which the window property index ignores), or NULL if
+ * the criterion can match more than one string.
+ *
+ */
+static const char *exact_window_criterion(struct regex *regex, window_property_t property) {
+    if (regex == NULL) {
+        return NULL;
+    }
+    const char *exact = criterion_literal(regex);
+    if (exact != NULL) {
+        return exact;
+    }
+    if (strcmp(regex->pattern, "__focused__") == 0 &&
+        focused != NULL && focused->window != NULL) {
+        switch (property) {
+            case WINDOW_PROPERTY_CLASS:
+                return focused->window->class_class;
+            case WINDOW_PROPERTY_INSTANCE:
+                return focused->window->class_instance;
+            case WINDOW_PROPERTY_ROLE:
+                return focused->window->role;
+            default:
+                break;
+        }
     }
+    return NULL;
+}
+
+/*
+ * Uses the container indexes to collect the containers which can possibly
+ * match the given criteria, in all_cons order. Returns false if none of the
+ * criteria can be looked up, in which case every container is a candidate.
+ *
+ * cmd_criteria_match_windows() accepts containers without a window when
+ * con_id or con_mark match, so the window indexes can only be used without
+ * those criteria.
+ *
+ */
+static bool criteria_candidates(Match *match, candidates *list) {
+    struct match_criterion *con_id = match_get(match, CRIT_CON_ID);
+    if (con_id != NULL) {
+        if (con_exists(con_id->con_id)) {
+            candidates_add(list, con_id->con_id);
+        }
+        return true;
+    }
+
+    struct regex *mark_regex = match_get_regex(match, CRIT_MARK);
+    if (mark_regex != NULL) {
+        const char *mark = criterion_literal(mark_regex);
+        if (mark == NULL) {
+            return false;
+        }
+        Con *con = con_by_mark(mark);
+        if (con != NULL) {
+            candidates_add(list, con);
+        }
+        char *with_newline;
+        sasprintf(&with_newline, "%s\n", mark);
+        Con *other = con_by_mark(with_newline);
+        free(with_newline);
+        if (other != NULL && other != con) {
+            candidates_add(list, other);
+            qsort(list->cons, list->num, sizeof(Con *), candidates_cmp);
+        }
+        return true;
+    }
+
+    struct regex *regexes[WINDOW_PROPERTY_MAX] = {
+        [WINDOW_PROPERTY_CLASS] = match_get_regex(match, CRIT_CLASS),
+        [WINDOW_PROPERTY_INSTANCE] = match_get_regex(match, CRIT_INSTANCE),
+        [WINDOW_PROPERTY_ROLE] = match_get_regex(match, CRIT_WINDOW_ROLE),
+    };
+    struct match_criterion *window_type = match_get(match, CRIT_WINDOW_TYPE);
+    bool found = false;
+    Con **best = NULL;
+    size_t best_num = 0;
+    for (int property = 0; property < WINDOW_PROPERTY_MAX; property++) {
+        const char *value;
+        char type[16];
+        if (property == WINDOW_PROPERTY_TYPE) {
+            if (window_type == NULL) {
+                continue;
+            }
+            snprintf(type, sizeof(type), "%u", window_type->window_type);
+            value = type;
+        } else if ((value = exact_window_criterion(regexes[property], property)) == NULL) {
+            continue;
+        }
+
+        size_t num;
+        Con **cons = con_by_window_property(property, value, &num);
+        if (!found || num < best_num) {
+            found = true;
+            best = cons;
+            best_num = num;
+        }
+    }
+    if (found) {
+        for (size_t i = 0; i < best_num; i++) {
+            candidates_add(list, best[i]);
+        }
+        qsort(list->cons, list->num, sizeof(Con *), candidates_cmp);
+        return true;
+    }
+
+    struct regex *workspace = match_get_regex(match, CRIT_WORKSPACE);
+    if (workspace != NULL) {
+        Con *ws = NULL;
+        const char *name = criterion_literal(workspace);
+        if (name != NULL) {
+            ws = get_existing_workspace_by_name(name);
+            char *with_newline;
+            sasprintf(&with_newline, "%s\n", name);
+            Con *other = get_existing_workspace_by_name(with_newline);
+            free(with_newline);
+            if (other != NULL) {
+                candidates_add_windows(list, other);
+            }
+        } else if (strcmp(workspace->pattern, "__focused__") == 0) {
+            ws = con_get_workspace(focused);
+        } else {
+            return false;
+        }
+        if (ws != NULL) {
+            candidates_add_windows(list, ws);
+        }
+        if (list->num > 1) {
+            qsort(list->cons, list->num, sizeof(Con *), candidates_cmp);
+        }
+        return true;
+    }
+
+    return false;
 }
 
 /*
@@ -179,10 +359,30 @@ void cmd_criteria_match_windows(I3_CMD) {
     owindow *next, *current;
 
     DLOG("match specification finished, matching...\n");
-    /* copy the old list head to iterate through it and start with a fresh
-     * list which will contain only matching windows */
-    struct owindows_head old = owindows;
+    /* collect the candidates in a separate list and start with a fresh list
+     * which will contain only matching windows */
+    struct owindows_head old;
+    TAILQ_INIT(&old);
+    candidates list = {0};
+    if (criteria_candidates(current_match, &list)) {
+        DLOG("checking %zu indexed candidates\n", list.num);
+        for (size_t i = 0; i < list.num; i++) {
+            current = smalloc(sizeof(owindow));
+            current->con = list.cons[i];
+            TAILQ_INSERT_TAIL(&old, current, owindows);
+        }
+        free(list.cons);
+    } else {
+        Con *con;
+        TAILQ_FOREACH (con, &all_cons, all_cons) {
+            current = smalloc(sizeof(owindow));
+            current->con = con;
+            TAILQ_INSERT_TAIL(&old, current, owindows);
+        }
+    }
     TAILQ_INIT(&owindows);
+    struct match_criterion *con_id = match_get(current_match, CRIT_CON_ID);
+    struct regex *mark = match_get_regex(current_match, CRIT_MARK);
     for (next = TAILQ_FIRST(&old); next != TAILQ_END(&old);) {
         /* make a copy of the next pointer and advance the pointer to the
          * next element as we are going to invalidate the element’s
@@ -196,10 +396,10 @@ void cmd_criteria_match_windows(I3_CMD) {
          * only window-specific criteria were specified. */
         bool accept_match = false;
 
-        if (current_match->con_id != NULL) {
+        if (con_id != NULL) {
             accept_match = true;
 
-            if (current_match->con_id == current->con) {
+            if (con_id->con_id == current->con) {
                 DLOG("con_id matched.\n");
             } else {
                 DLOG("con_id does not match.\n");
@@ -208,21 +408,12 @@ void cmd_criteria_match_windows(I3_CMD) {
             }
         }
 
-        if (current_match->mark != NULL && !TAILQ_EMPTY(&(current->con->marks_head))) {
+        if (mark != NULL && !TAILQ_EMPTY(&(current->con->cold->marks_head))) {
             accept_match = true;
-            bool matched_by_mark = false;
-
-            mark_t *mark;
-            TAILQ_FOREACH (mark, &(current->con->marks_head), marks) {
-                if (!regex_matches(current_match->mark, mark->name))
-                    continue;
 
+            if (con_has_mark_matching(current->con, mark)) {
                 DLOG("match by mark\n");
-                matched_by_mark = true;
-                break;
-            }
-
-            if (!matched_by_mark) {
+            } else {
                 DLOG("mark does not match.\n");
                 FREE(current);
                 continue;
@@ -267,11 +458,13 @@ void cmd_criteria_add(I3_CMD, const char *ctype, const char *cvalue) {
 }
 
 static void move_matches_to_workspace(Con *ws) {
+    con_begin_bulk_move();
     owindow *current;
     TAILQ_FOREACH (current, &owindows, owindows) {
         DLOG("matching: %p / %s\n", current->con, current->con->name);
         con_move_to_workspace(current->con, ws, true, false, false);
     }
+    con_end_bulk_move();
 }
 
 #define CHECK_MOVE_CON_TO_WORKSPACE                                                          \
@@ -504,7 +697,7 @@ static void cmd_resize_floating(I3_CMD, const char *direction_str, Con *floating
 
     /* If this is a scratchpad window, don't auto center it from now on. */
     if (floating_con->scratchpad_state == SCRATCHPAD_FRESH) {
-        floating_con->scratchpad_state = SCRATCHPAD_CHANGED;
+        con_set_scratchpad_state(floating_con, SCRATCHPAD_CHANGED);
     }
 }
 
@@ -585,6 +778,7 @@ static bool cmd_resize_tiling_width_height(I3_CMD, Con *current, const char *dir
 
     current->percent = new_current_percent;
     LOG("current->percent after = %f\n", current->percent);
+    con_set_dirty(current);
 
     TAILQ_FOREACH (child, &(current->parent->nodes_head), nodes) {
         if (child == current)
@@ -822,23 +1016,19 @@ void cmd_append_layout(I3_CMD, const char *cpath) {
 
     char *buf = NULL;
     ssize_t len;
-    if ((len = slurp(path, &buf)) < 0) {
-        yerror("Could not slurp \"%s\".", path);
-        /* slurp already logged an error. */
-        goto out;
-    }
-
-    if (!json_validate(buf, len)) {
-        ELOG("Could not parse \"%s\" as JSON, not loading.\n", path);
-        yerror("Could not parse \"%s\" as JSON.", path);
+    if ((len = map_file(path, &buf)) < 0) {
+        yerror("Could not read \"%s\".", path);
+        /* map_file already logged an error. */
         goto out;
     }
 
-    json_content_t content = json_determine_content(buf, len);
+    /* Validating the file and determining its contents is one pass, so the
+     * file is only parsed twice in total. */
+    json_content_t content = json_validate_content(buf, len);
     LOG("JSON content = %d\n", content);
     if (content == JSON_CONTENT_UNKNOWN) {
-        ELOG("Could not determine the contents of \"%s\", not loading.\n", path);
-        yerror("Could not determine the contents of \"%s\".", path);
+        ELOG("Could not parse \"%s\" as JSON, not loading.\n", path);
+        yerror("Could not parse \"%s\" as JSON.", path);
         goto out;
     }
 
@@ -883,7 +1073,7 @@ void cmd_append_layout(I3_CMD, const char *cpath) {
     cmd_output->needs_tree_render = true;
 out:
     free(path);
-    free(buf);
+    unmap_file(buf, len);
 }
 
 /*
@@ -1165,6 +1355,72 @@ static void user_output_names_free(user_output_names_head *names) {
     }
 }
 
+/*
+ * Moves the workspaces of the matched windows to the next of the given
+ * outputs. Every workspace is moved once, even if several of its windows
+ * matched, and the workspaces with the same target output are moved in one go
+ * by workspaces_move_to_output(), so they produce a single render.
+ *
+ */
+static void cmd_move_workspaces_to_output(I3_CMD, user_output_names_head *names) {
+    int num_windows = 0;
+    owindow *current;
+    TAILQ_FOREACH (current, &owindows, owindows) {
+        num_windows++;
+    }
+
+    Con **workspaces = scalloc(num_windows, sizeof(Con *));
+    Output **targets = scalloc(num_windows, sizeof(Output *));
+    int num_workspaces = 0;
+    TAILQ_FOREACH (current, &owindows, owindows) {
+        Con *ws = con_get_workspace(current->con);
+        if (con_is_internal(ws)) {
+            continue;
+        }
+        bool seen = false;
+        for (int i = 0; i < num_workspaces && !seen; i++) {
+            seen = (workspaces[i] == ws);
+        }
+        if (seen) {
+            continue;
+        }
+
+        Output *target_output = user_output_names_find_next(names, get_output_for_con(ws));
+        if (target_output) {
+            workspaces[num_workspaces] = ws;
+            targets[num_workspaces] = target_output;
+            num_workspaces++;
+        }
+    }
+
+    /* Group the workspaces by their target output, keeping their order. */
+    Con **group = scalloc(num_workspaces > 0 ? num_workspaces : 1, sizeof(Con *));
+    for (int i = 0; i < num_workspaces; i++) {
+        if (targets[i] == NULL) {
+            continue;
+        }
+        Output *target_output = targets[i];
+        int num_group = 0;
+        for (int j = i; j < num_workspaces; j++) {
+            if (targets[j] == target_output) {
+                group[num_group++] = workspaces[j];
+                targets[j] = NULL;
+            }
+        }
+        workspaces_move_to_output(group, num_group, target_output);
+    }
+    free(group);
+    free(targets);
+    free(workspaces);
+
+    cmd_output->needs_tree_render = (num_workspaces > 0);
+    if (num_workspaces > 0) {
+        ysuccess(true);
+    } else {
+        yerror("No output matched");
+    }
+}
+
 /*
  * Implementation of 'move [window|container|workspace] [to] output <strings>'.
  *
@@ -1191,7 +1447,14 @@ void cmd_move_con_to_output(I3_CMD, const char *name, bool move_workspace) {
         return;
     }
 
+    if (move_workspace) {
+        cmd_move_workspaces_to_output(current_match, cmd_output, &names);
+        user_output_names_free(&names);
+        return;
+    }
+
     bool success = false;
+    con_begin_bulk_move();
     owindow *current;
     TAILQ_FOREACH (current, &owindows, owindows) {
         Con *ws = con_get_workspace(current->con);
@@ -1202,14 +1465,11 @@ void cmd_move_con_to_output(I3_CMD, const char *name, bool move_workspace) {
         Output *current_output = get_output_for_con(ws);
         Output *target_output = user_output_names_find_next(&names, current_output);
         if (target_output) {
-            if (move_workspace) {
-                workspace_move_to_output(ws, target_output);
-            } else {
-                con_move_to_output(current->con, target_output, true);
-            }
+            con_move_to_output(current->con, target_output, true);
             success = true;
         }
     }
+    con_end_bulk_move();
     user_output_names_free(&names);
 
     cmd_output->needs_tree_render = success;
@@ -1234,11 +1494,13 @@ void cmd_move_con_to_mark(I3_CMD, const char *mark) {
     HANDLE_EMPTY_MATCH;
 
     bool result = true;
+    con_begin_bulk_move();
     owindow *current;
     TAILQ_FOREACH (current, &owindows, owindows) {
         DLOG("moving matched window %p / %s to mark \"%s\"\n", current->con, current->con->name, mark);
         result &= con_move_to_mark(current->con, mark);
     }
+    con_end_bulk_move();
 
     cmd_output->needs_tree_render = true;
     ysuccess(result);
@@ -1670,7 +1932,7 @@ void cmd_sticky(I3_CMD, const char *action) {
         else if (strcmp(action, "toggle") == 0)
             sticky = !current->con->sticky;
 
-        current->con->sticky = sticky;
+        con_set_sticky(current->con, sticky);
         ewmh_update_sticky(current->con->window->id, sticky);
     }
 
@@ -1831,6 +2093,7 @@ void cmd_reload(I3_CMD) {
         return;
     }
     LOG("reloading\n");
+    const uint64_t start = stats_now();
 
     kill_nagbar(config_error_nagbar_pid, false);
     kill_nagbar(command_error_nagbar_pid, false);
@@ -1850,6 +2113,7 @@ void cmd_reload(I3_CMD) {
     TAILQ_FOREACH (current, &barconfigs, configs) {
         ipc_send_barconfig_update_event(current);
     }
+    stats_record_duration(STATS_RELOAD, start);
 
     // XXX: default reply for now, make this a better reply
     ysuccess(true);
@@ -2215,12 +2479,12 @@ void cmd_title_format(I3_CMD, const char *format) {
     owindow *current;
     TAILQ_FOREACH (current, &owindows, owindows) {
         DLOG("setting title_format for %p / %s\n", current->con, current->con->name);
-        FREE(current->con->title_format);
+        FREE(current->con->cold->title_format);
 
         /* If we only display the title without anything else, we can skip the parsing step,
          * so we remove the title format altogether. */
         if (strcasecmp(format, "%title") != 0) {
-            current->con->title_format = sstrdup(format);
+            current->con->cold->title_format = sstrdup(format);
 
             if (current->con->window != NULL) {
                 i3String *formatted_title = con_parse_title_format(current->con);
@@ -2239,7 +2503,7 @@ void cmd_title_format(I3_CMD, const char *format) {
             current->con->window->name_x_changed = true;
         } else {
             /* For windowless containers we also need to force the redrawing. */
-            FREE(current->con->deco_render_params);
+            FREE(current->con->cold->deco_render_params);
         }
     }
 
@@ -2292,7 +2556,7 @@ void cmd_title_window_icon(I3_CMD, const char *enable, int padding) {
             current->con->window->name_x_changed = true;
         } else {
             /* For windowless containers we also need to force the redrawing. */
-            FREE(current->con->deco_render_params);
+            FREE(current->con->cold->deco_render_params);
         }
     }
 
@@ -2341,6 +2605,15 @@ void cmd_rename_workspace(I3_CMD, const char *old_name, const char *new_name) {
         return;
     }
 
+    Con *previously_focused = focused;
+    Con *previously_focused_content = focused->type == CT_WORKSPACE ? focused->parent : NULL;
+
+    /* The workspace is detached while changing its name, which updates the
+     * workspace index. By re-attaching, the sort order will be correct
+     * afterwards, too. */
+    Con *parent = workspace->parent;
+    con_detach(workspace);
+
     /* Change the name and try to parse it as a number. */
     /* old_name might refer to workspace->name, so copy it before free()ing */
     char *old_name_copy = sstrdup(old_name);
@@ -2350,11 +2623,6 @@ void cmd_rename_workspace(I3_CMD, const char *old_name, const char *new_name) {
     workspace->num = ws_name_to_number(new_name);
     LOG("num = %d\n", workspace->num);
 
-    /* By re-attaching, the sort order will be correct afterwards. */
-    Con *previously_focused = focused;
-    Con *previously_focused_content = focused->type == CT_WORKSPACE ? focused->parent : NULL;
-    Con *parent = workspace->parent;
-    con_detach(workspace);
     con_attach(workspace, parent, false);
     ipc_send_workspace_event("rename", workspace, NULL);
 
@@ -2581,6 +2849,51 @@ void cmd_debuglog(I3_CMD, const char *argument) {
     ysuccess(true);
 }
 
+/*
+ * Implementation of 'debuglog filter <file>[,<file>…]|off'
+ *
+ */
+void cmd_debuglog_filter(I3_CMD, const char *files) {
+    if(cmd_output->execution_toggled) {
+        ysuccess(true);
+        return;
+    }
+    if (strcmp(files, "off") == 0) {
+        LOG("Logging debug messages of all files\n");
+        set_debug_log_filter(NULL);
+    } else {
+        LOG("Logging debug messages of %s only\n", files);
+        set_debug_log_filter(files);
+    }
+    ysuccess(true);
+}
+
+/*
+ * Implementation of 'batch begin|commit'.
+ *
+ */
+void cmd_batch(I3_CMD, const char *action) {
+    if(cmd_output->execution_toggled) {
+        ysuccess(true);
+        return;
+    }
+
+    if (strcmp(action, "begin") == 0) {
+        if (!tree_batch_begin(cmd_output->client)) {
+            yerror("A batch of commands is already open.");
+            return;
+        }
+    } else {
+        if (!tree_batch_active()) {
+            yerror("No batch of commands is open.");
+            return;
+        }
+        tree_batch_commit();
+    }
+
+    ysuccess(true);
+}
+
 /*******************************************************************************
  * Variable and Branching functions.
  ******************************************************************************/
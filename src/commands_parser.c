@@ -25,6 +25,8 @@
  */
 #include "all.h"
 
+#include <ctype.h>
+
 // Macros to make the YAJL API a bit easier to use.
 #define y(x, ...) (command_output.json_gen != NULL ? yajl_gen_##x(command_output.json_gen, ##__VA_ARGS__) : 0)
 #define ystr(str) (command_output.json_gen != NULL ? yajl_gen_string(command_output.json_gen, (unsigned char *)str, strlen(str)) : 0)
@@ -47,6 +49,9 @@ typedef struct token {
     union {
         uint16_t call_identifier;
     } extra;
+    cmdp_token_type type;
+    /* For literals: the length of the name, without the leading quote. */
+    uint16_t length;
 } cmdp_token;
 
 typedef struct tokenptr {
@@ -56,6 +61,75 @@ typedef struct tokenptr {
 
 #include "GENERATED_command_tokens.h"
 
+/*******************************************************************************
+ * The scratch arena holding the strings identified while parsing. It is
+ * released in one go once the command ran (or, for a compiled command, once
+ * the command is freed), so parsing does not allocate and free every token.
+ ******************************************************************************/
+
+/* Size of the buffer parse_command() keeps on its stack, which holds the
+ * tokens of all but very long commands. */
+#define SCRATCH_INLINE_SIZE 1024
+
+/* Minimum size of a chunk allocated when the current buffer is full. */
+#define SCRATCH_CHUNK_SIZE 256
+
+struct scratch_chunk {
+    struct scratch_chunk *next;
+    char data[];
+};
+
+struct scratch_arena {
+    /* The buffer strings are currently cut from, either the inline buffer of
+     * parse_command() or the newest chunk. */
+    char *buf;
+    size_t size;
+    size_t used;
+    struct scratch_chunk *chunks;
+};
+
+/*
+ * Returns size bytes from the arena. Never returns NULL.
+ *
+ */
+static char *scratch_alloc(struct scratch_arena *arena, size_t size) {
+    if (arena->size - arena->used < size) {
+        const size_t chunk_size = (size > SCRATCH_CHUNK_SIZE ? size : SCRATCH_CHUNK_SIZE);
+        struct scratch_chunk *chunk = smalloc(sizeof(struct scratch_chunk) + chunk_size);
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+        arena->buf = chunk->data;
+        arena->size = chunk_size;
+        arena->used = 0;
+    }
+
+    char *ptr = arena->buf + arena->used;
+    arena->used += size;
+    return ptr;
+}
+
+/*
+ * Frees the chunks of the arena. Strings allocated from it must not be used
+ * afterwards.
+ *
+ */
+static void scratch_release(struct scratch_arena *arena) {
+    struct scratch_chunk *chunk = arena->chunks;
+    while (chunk != NULL) {
+        struct scratch_chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->chunks = NULL;
+    arena->buf = NULL;
+    arena->size = 0;
+    arena->used = 0;
+}
+
+/* The arena of the parse in progress: the one of parse_command() or of the
+ * command being compiled. */
+static struct scratch_arena *scratch;
+
 /*
  * Pushes a string (identified by 'identifier') on the stack. We simply use a
  * single array, since the number of entries we have to store is very small.
@@ -126,11 +200,13 @@ static long get_long(struct stack *stack, const char *identifier) {
     return 0;
 }
 
-// TODO move to a common util
+/*
+ * Empties the stack. The strings on it are owned by the scratch arena (or are
+ * token names), so they are not freed.
+ *
+ */
 static void clear_stack(struct stack *stack) {
     for (int c = 0; c < 10; c++) {
-        if (stack->stack[c].type == STACK_STR)
-            free(stack->stack[c].val.str);
         stack->stack[c].identifier = NULL;
         stack->stack[c].val.str = NULL;
         stack->stack[c].val.num = 0;
@@ -151,14 +227,105 @@ static struct stack stack;
 static struct CommandResultIR subcommand_output;
 static struct CommandResultIR command_output;
 
+/* One step of a compiled command: a call with the arguments identified while
+ * parsing it, or a re-initialization of the criteria (call_identifier -1),
+ * which happens after every command. */
+struct command_step {
+    int call_identifier;
+    struct stack stack;
+};
+
+struct ParsedCommand {
+    int refcount;
+    int num_steps;
+    struct command_step *steps;
+    /* Holds the strings on the stacks of the steps. */
+    struct scratch_arena arena;
+};
+
+/* Set while command_compile() records the calls instead of executing them. */
+static ParsedCommand *recording;
+
+/* Set while parse_command() runs a command for a client which enabled command
+ * timing: the time the current command started (after the previous result),
+ * the time spent in calls since then and the length of the reply so far, to
+ * find the calls which added a result. */
+static CommandResult *timing_result;
+static uint64_t timing_mark;
+static uint64_t timing_calls_us;
+static size_t timing_reply_length;
+
 #include "GENERATED_command_call.h"
 
+static void record_step(int call_identifier) {
+    recording->steps = srealloc(recording->steps, (recording->num_steps + 1) * sizeof(struct command_step));
+    struct command_step *step = &(recording->steps[recording->num_steps++]);
+    step->call_identifier = call_identifier;
+    /* The strings on the stack are in the arena of the compiled command. */
+    step->stack = stack;
+    memset(&stack, 0, sizeof(struct stack));
+}
+
+static uint64_t timing_now(void) {
+/* stats.c is not linked into the parser test, which never enables timing. */
+#ifndef TEST_PARSER
+    if (timing_result != NULL)
+        return stats_now();
+#endif
+    return 0;
+}
+
+static size_t reply_length(void) {
+    const unsigned char *reply;
+    size_t length;
+    yajl_gen_get_buf(command_output.json_gen, &reply, &length);
+    return length;
+}
+
+/*
+ * Accounts the call which started at the given time. If the call added a
+ * result to the reply, the time since the previous result is recorded for it.
+ * Calls which do not add a result (like the criteria) are accounted to the
+ * next command.
+ *
+ */
+static void record_timing(uint64_t call_start) {
+    const uint64_t now = timing_now();
+    timing_calls_us += now - call_start;
+
+    /* A command run by this command replaced the reply generator. */
+    if (command_output.json_gen == NULL)
+        return;
+
+    const size_t length = reply_length();
+    if (length == timing_reply_length)
+        return;
+    timing_reply_length = length;
+
+    timing_result->timings = srealloc(timing_result->timings, (timing_result->num_timings + 1) * sizeof(struct command_timing));
+    timing_result->timings[timing_result->num_timings++] = (struct command_timing){
+        .parse_us = now - timing_mark - timing_calls_us,
+        .exec_us = timing_calls_us,
+    };
+    timing_mark = now;
+    timing_calls_us = 0;
+}
+
 static void next_state(const cmdp_token *token) {
+    if (token->next_state == __CALL && recording != NULL) {
+        record_step(token->extra.call_identifier);
+        state = GENERATED_call_next_state(token->extra.call_identifier);
+        return;
+    }
+
     if (token->next_state == __CALL) {
         subcommand_output.json_gen = command_output.json_gen;
         subcommand_output.client = command_output.client;
         subcommand_output.needs_tree_render = false;
+        const uint64_t call_start = timing_now();
         GENERATED_call(&current_match, &stack, token->extra.call_identifier, &subcommand_output);
+        if (timing_result != NULL)
+            record_timing(call_start);
         state = subcommand_output.next_state;
         /* If any subcommand requires a tree_render(), we need to make the
          * whole parser result request a tree_render(). */
@@ -175,12 +342,11 @@ static void next_state(const cmdp_token *token) {
 }
 
 /*
- * Parses a string (or word, if as_word is true). Extracted out of
- * parse_command so that it can be used in src/workspace.c for interpreting
- * workspace commands.
+ * Parses a string (or word, if as_word is true) into memory from the given
+ * arena, or from the heap if arena is NULL.
  *
  */
-char *parse_string(const char **walk, bool as_word) {
+static char *parse_string_into(const char **walk, bool as_word, struct scratch_arena *arena) {
     const char *beginning = *walk;
     /* Handle quoted strings (or words). */
     if (**walk == '"') {
@@ -213,7 +379,8 @@ char *parse_string(const char **walk, bool as_word) {
     if (*walk == beginning)
         return NULL;
 
-    char *str = scalloc(*walk - beginning + 1, 1);
+    const size_t size = *walk - beginning + 1;
+    char *str = (arena != NULL ? scratch_alloc(arena, size) : smalloc(size));
     /* We copy manually to handle escaping of characters. */
     int inpos, outpos;
     for (inpos = 0, outpos = 0;
@@ -226,31 +393,29 @@ char *parse_string(const char **walk, bool as_word) {
             inpos++;
         str[outpos] = beginning[inpos];
     }
+    str[outpos] = '\0';
 
     return str;
 }
 
 /*
- * Parses and executes the given command. If a caller-allocated yajl_gen is
- * passed, a json reply will be generated in the format specified by the ipc
- * protocol. Pass NULL if no json reply is required.
+ * Parses a string (or word, if as_word is true). Extracted out of
+ * parse_command so that it can be used in src/workspace.c for interpreting
+ * workspace commands.
  *
- * Free the returned CommandResult with command_result_free().
  */
-CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client) {
-    DLOG("COMMAND: *%.4000s*\n", input);
-    state = INITIAL;
-    CommandResult *result = scalloc(1, sizeof(CommandResult));
-
-    subcommand_output.execution_toggled = false;
-    
-    command_output.client = client;
-    
-    /* A YAJL JSON generator used for formatting replies. */
-    command_output.json_gen = gen;
+char *parse_string(const char **walk, bool as_word) {
+    return parse_string_into(walk, as_word, NULL);
+}
 
-    y(array_open);
-    command_output.needs_tree_render = false;
+/*
+ * Walks the state machine over the given input, either executing the calls
+ * right away or (while recording) appending them to the compiled command.
+ * Parse errors are stored in result.
+ *
+ */
+static void parse_command_input(const char *input, CommandResult *result) {
+    state = INITIAL;
 
     const char *walk = input;
     const size_t len = strlen(input);
@@ -258,11 +423,6 @@ CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client
     const cmdp_token *token;
     bool token_handled;
 
-// TODO: make this testable
-#ifndef TEST_PARSER
-    cmd_criteria_init(&current_match, &subcommand_output);
-#endif
-
     /* The "<=" operator is intentional: We also handle the terminating 0-byte
      * explicitly by looking for an 'end' token. */
     while ((size_t)(walk - input) <= len) {
@@ -273,17 +433,20 @@ CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client
             walk++;
         
         cmdp_token_ptr *ptr = &(tokens[state]);
+        const uint8_t *candidates;
+        const int num_candidates = GENERATED_candidates(state, *walk, &candidates);
         token_handled = false;
-        for (c = 0; c < ptr->n; c++) {
-            token = &(ptr->array[c]);
+        for (c = 0; c < num_candidates; c++) {
+            token = &(ptr->array[candidates[c]]);
 
             /* A literal. */
-            if (token->name[0] == '\'') {
-                if (strncasecmp(walk, token->name + 1, strlen(token->name) - 1) == 0) {
+            if (token->type == TOKEN_LITERAL) {
+                if (strncasecmp(walk, token->name + 1, token->length) == 0) {
                     if (token->identifier != NULL) {
-                        push_string(&stack, token->identifier, sstrdup(token->name + 1));
+                        /* Token names are static, so literals need no copy. */
+                        push_string(&stack, token->identifier, token->name + 1);
                     }
-                    walk += strlen(token->name) - 1;
+                    walk += token->length;
                     next_state(token);
                     token_handled = true;
                     break;
@@ -291,7 +454,7 @@ CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client
                 continue;
             }
 
-            if (strcmp(token->name, "number") == 0) {
+            if (token->type == TOKEN_NUMBER) {
                 /* Handle numbers. We only accept decimal numbers for now. */
                 char *end = NULL;
                 errno = 0;
@@ -315,9 +478,8 @@ CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client
                 break;
             }
 
-            if (strcmp(token->name, "string") == 0 ||
-                strcmp(token->name, "word") == 0) {
-                char *str = parse_string(&walk, (token->name[0] != 's'));
+            if (token->type == TOKEN_STRING || token->type == TOKEN_WORD) {
+                char *str = parse_string_into(&walk, (token->type == TOKEN_WORD), scratch);
                 if (str != NULL) {
                     if (token->identifier) {
                         push_string(&stack, token->identifier, str);
@@ -332,7 +494,7 @@ CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client
                 }
             }
 
-            if (strcmp(token->name, "end") == 0) {
+            if (token->type == TOKEN_END) {
                 if (*walk == '\0' || *walk == ',' || *walk == ';') {
                     next_state(token);
                     token_handled = true;
@@ -340,11 +502,16 @@ CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client
                      * datastructure for commands which do *not* specify any
                      * criteria, we re-initialize the criteria system after
                      * every command. */
+                    if (*walk == '\0' || *walk == ';') {
+                        if (recording != NULL) {
+                            record_step(-1);
+                        } else {
 // TODO: make this testable
 #ifndef TEST_PARSER
-                    if (*walk == '\0' || *walk == ';')
-                        cmd_criteria_init(&current_match, &subcommand_output);
+                            cmd_criteria_init(&current_match, &subcommand_output);
 #endif
+                        }
+                    }
                     walk++;
                     break;
                 }
@@ -427,13 +594,180 @@ CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client
             break;
         }
     }
+}
+
+/*
+ * Parses and executes the given command. If a caller-allocated yajl_gen is
+ * passed, a json reply will be generated in the format specified by the ipc
+ * protocol. Pass NULL if no json reply is required.
+ *
+ * Free the returned CommandResult with command_result_free().
+ */
+CommandResult *parse_command(const char *input, yajl_gen gen, ipc_client *client) {
+    DLOG("COMMAND: *%.4000s*\n", input);
+    const uint64_t start = PROBE_NOW();
+    PROBE1(command_start, input);
+    CommandResult *result = scalloc(1, sizeof(CommandResult));
+
+    /* Commands can run other commands, which use an arena of their own. */
+    char inline_buf[SCRATCH_INLINE_SIZE];
+    struct scratch_arena arena = {.buf = inline_buf, .size = sizeof(inline_buf)};
+    struct scratch_arena *saved_scratch = scratch;
+    scratch = &arena;
+
+    subcommand_output.execution_toggled = false;
+
+    command_output.client = client;
+
+    /* A YAJL JSON generator used for formatting replies. */
+    command_output.json_gen = gen;
+
+    y(array_open);
+    command_output.needs_tree_render = false;
+
+    /* Commands can run other commands (e.g. assignments), whose time is
+     * accounted to the command running them. */
+    CommandResult *saved_timing_result = timing_result;
+    timing_result = (gen != NULL && client != NULL && client->command_timing ? result : NULL);
+    if (timing_result != NULL) {
+        timing_mark = timing_now();
+        timing_calls_us = 0;
+        timing_reply_length = reply_length();
+    }
+
+// TODO: make this testable
+#ifndef TEST_PARSER
+    cmd_criteria_init(&current_match, &subcommand_output);
+#endif
+
+    parse_command_input(input, result);
+
+    /* Nothing refers to the identified strings after the last call. */
+    clear_stack(&stack);
+    scratch = saved_scratch;
+    scratch_release(&arena);
+
+    timing_result = saved_timing_result;
 
     y(array_close);
 
     result->needs_tree_render = command_output.needs_tree_render;
+    PROBE3(command_done, input, !result->parse_error, PROBE_NOW() - start);
     return result;
 }
 
+/*
+ * Parses the given command without executing it. Returns NULL if the command
+ * contains a parse error, otherwise the calls it consists of, which can be
+ * executed any number of times with run_parsed_command().
+ *
+ * This may be called while another command is executed (e.g. when "reload"
+ * loads the key bindings), so the parser state is saved and restored.
+ *
+ */
+ParsedCommand *command_compile(const char *input) {
+    const cmdp_state saved_state = state;
+    const struct stack saved_stack = stack;
+    const yajl_gen saved_gen = command_output.json_gen;
+    memset(&stack, 0, sizeof(struct stack));
+    command_output.json_gen = NULL;
+
+    ParsedCommand *parsed = scalloc(1, sizeof(ParsedCommand));
+    parsed->refcount = 1;
+    CommandResult result = {0};
+
+    struct scratch_arena *saved_scratch = scratch;
+    scratch = &(parsed->arena);
+    recording = parsed;
+    parse_command_input(input, &result);
+    recording = NULL;
+    scratch = saved_scratch;
+
+    state = saved_state;
+    stack = saved_stack;
+    command_output.json_gen = saved_gen;
+
+    if (result.parse_error) {
+        free(result.error_message);
+        parsed_command_unref(parsed);
+        return NULL;
+    }
+    return parsed;
+}
+
+/*
+ * Executes a command compiled with command_compile(). Behaves like
+ * parse_command() on the original input, without parsing it again.
+ *
+ */
+CommandResult *run_parsed_command(ParsedCommand *parsed, yajl_gen gen, ipc_client *client) {
+    /* Compiled commands are passed to the probes without their input. */
+    const uint64_t start = PROBE_NOW();
+    PROBE1(command_start, NULL);
+    CommandResult *result = scalloc(1, sizeof(CommandResult));
+
+    /* A command like "reload" frees the binding this command belongs to. */
+    parsed->refcount++;
+
+    subcommand_output.execution_toggled = false;
+    command_output.client = client;
+    command_output.json_gen = gen;
+
+    y(array_open);
+    command_output.needs_tree_render = false;
+
+#ifndef TEST_PARSER
+    cmd_criteria_init(&current_match, &subcommand_output);
+#endif
+
+    for (int i = 0; i < parsed->num_steps; i++) {
+        struct command_step *step = &(parsed->steps[i]);
+        if (step->call_identifier == -1) {
+#ifndef TEST_PARSER
+            cmd_criteria_init(&current_match, &subcommand_output);
+#endif
+            continue;
+        }
+
+        subcommand_output.json_gen = command_output.json_gen;
+        subcommand_output.client = command_output.client;
+        subcommand_output.needs_tree_render = false;
+        GENERATED_call(&current_match, &(step->stack), step->call_identifier, &subcommand_output);
+        if (subcommand_output.needs_tree_render)
+            command_output.needs_tree_render = true;
+    }
+
+    y(array_close);
+
+    result->needs_tree_render = command_output.needs_tree_render;
+    parsed_command_unref(parsed);
+    PROBE3(command_done, NULL, true, PROBE_NOW() - start);
+    return result;
+}
+
+/*
+ * Releases a reference to a compiled command. parsed may be NULL.
+ *
+ */
+void parsed_command_unref(ParsedCommand *parsed) {
+    if (parsed == NULL || --(parsed->refcount) > 0)
+        return;
+
+    scratch_release(&(parsed->arena));
+    free(parsed->steps);
+    free(parsed);
+}
+
+/*
+ * Returns a new reference to the given compiled command, which may be NULL.
+ *
+ */
+ParsedCommand *parsed_command_ref(ParsedCommand *parsed) {
+    if (parsed != NULL)
+        parsed->refcount++;
+    return parsed;
+}
+
 /*
  * Frees a CommandResult
  */
@@ -442,6 +776,7 @@ void command_result_free(CommandResult *result) {
         return;
 
     FREE(result->error_message);
+    FREE(result->timings);
     FREE(result);
 }
 
@@ -452,6 +787,19 @@ void command_result_free(CommandResult *result) {
 
 #ifdef TEST_PARSER
 
+/* Set with --benchmark, which discards all output. */
+static bool benchmarking = false;
+
+/* The log macros (see log.h) check these before calling debuglog() and
+ * verboselog(). */
+bool log_debug_active = true;
+bool log_verbose_active = true;
+bool log_filter_active = false;
+
+bool log_file_enabled(const char *file) {
+    return true;
+}
+
 /*
  * Logs the given message to stdout while prefixing the current time to it,
  * but only if debug logging was activated.
@@ -461,6 +809,9 @@ void command_result_free(CommandResult *result) {
 void debuglog(char *fmt, ...) {
     va_list args;
 
+    if (benchmarking)
+        return;
+
     va_start(args, fmt);
     fprintf(stdout, "# ");
     vfprintf(stdout, fmt, args);
@@ -470,14 +821,56 @@ void debuglog(char *fmt, ...) {
 void errorlog(char *fmt, ...) {
     va_list args;
 
+    if (benchmarking)
+        return;
+
     va_start(args, fmt);
     vfprintf(stderr, fmt, args);
     va_end(args);
 }
 
+/*
+ * Parses the command the given number of times with all output discarded and
+ * prints the average time per parse (used by “meson test --benchmark”).
+ *
+ */
+static int benchmark(const char *iterations_str, const char *input) {
+    const long iterations = strtol(iterations_str, NULL, 10);
+    if (iterations <= 0) {
+        fprintf(stderr, "Invalid number of iterations: %s\n", iterations_str);
+        return 1;
+    }
+
+    /* The calls are printed to stderr in TEST_PARSER builds. */
+    FILE *out = fdopen(dup(STDERR_FILENO), "w");
+    if (out == NULL || freopen("/dev/null", "w", stderr) == NULL) {
+        perror("Could not redirect stderr");
+        return 1;
+    }
+    benchmarking = true;
+
+    yajl_gen gen = yajl_gen_alloc(NULL);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        yajl_gen_clear(gen);
+        command_result_free(parse_command(input, gen, NULL));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    yajl_gen_free(gen);
+
+    const double elapsed = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    fprintf(out, "%ld iterations, %.0f ns per command\n", iterations, elapsed / iterations);
+    fclose(out);
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
+    if (argc == 4 && strcmp(argv[1], "--benchmark") == 0) {
+        return benchmark(argv[2], argv[3]);
+    }
     if (argc < 2) {
-        fprintf(stderr, "Syntax: %s <command>\n", argv[0]);
+        fprintf(stderr, "Syntax: %s [--benchmark <iterations>] <command>\n", argv[0]);
         return 1;
     }
     yajl_gen gen = yajl_gen_alloc(NULL);
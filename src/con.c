@@ -13,6 +13,201 @@
 #include "yajl_utils.h"
 
 static void con_on_remove_child(Con *con);
+static void title_format_cache_free(struct title_format_cache *cache);
+
+/* Indexes for con_by_window_id() and con_by_frame_id(), which are used on
+ * nearly every X11 event. */
+static hashmap_t *cons_by_window_id;
+static hashmap_t *cons_by_frame_id;
+
+/* Mark names are unique, so every mark maps to exactly one container. */
+static hashmap_t *cons_by_mark;
+
+/* All containers by their address, for con_by_con_id() and con_exists(). */
+static hashmap_t *cons_by_address;
+static uint64_t next_creation_order;
+
+/* Containers by the class, instance, role and type of their window. The keys
+ * are built by window_property_key(), the values are con_lists. */
+static hashmap_t *cons_by_window_property;
+
+typedef struct con_list {
+    size_t num;
+    size_t capacity;
+    Con **cons;
+} con_list;
+
+/* Containers with con->sticky set and floating containers on the scratchpad
+ * (scratchpad_state other than SCRATCHPAD_NONE), so that workspace switches
+ * and 'scratchpad show' do not need to walk the whole tree. */
+static con_list sticky_cons;
+static con_list scratchpad_cons;
+
+/* Containers by their sticky_group, the values are con_lists. */
+static hashmap_t *cons_by_sticky_group;
+
+static void con_list_add(con_list *list, Con *con) {
+    if (list->num == list->capacity) {
+        list->capacity = (list->capacity == 0 ? 4 : list->capacity * 2);
+        list->cons = srealloc(list->cons, list->capacity * sizeof(Con *));
+    }
+    list->cons[list->num++] = con;
+}
+
+static void con_list_remove(con_list *list, Con *con) {
+    for (size_t i = 0; i < list->num; i++) {
+        if (list->cons[i] == con) {
+            list->cons[i] = list->cons[--list->num];
+            return;
+        }
+    }
+}
+
+/*
+ * Returns the index key for the given window property value. A single
+ * trailing newline is dropped because PCRE's "$" also matches before it, so
+ * that ^value$ finds such windows, too.
+ *
+ */
+static char *window_property_key(window_property_t property, const char *value) {
+    static const char prefixes[WINDOW_PROPERTY_MAX] = {'c', 'i', 'r', 't'};
+    size_t len = strlen(value);
+    if (len > 0 && value[len - 1] == '\n') {
+        len--;
+    }
+    char *key;
+    sasprintf(&key, "%c%.*s", prefixes[property], (int)len, value);
+    return key;
+}
+
+/*
+ * Removes the container from the window property index.
+ *
+ */
+static void con_unindex_window_properties(Con *con) {
+    for (int property = 0; property < WINDOW_PROPERTY_MAX; property++) {
+        char *key = con->window_property_keys[property];
+        if (key == NULL) {
+            continue;
+        }
+        con_list *list = hashmap_lookup_str(cons_by_window_property, key);
+        if (list != NULL) {
+            con_list_remove(list, con);
+        }
+        if (list != NULL && list->num == 0) {
+            hashmap_remove_str(cons_by_window_property, key);
+            free(list->cons);
+            free(list);
+        }
+        FREE(con->window_property_keys[property]);
+    }
+}
+
+/*
+ * Adds the container to the window property index, replacing the entries for
+ * the values its window had before.
+ *
+ */
+static void con_index_window_properties(Con *con) {
+    con_unindex_window_properties(con);
+    if (con->window == NULL) {
+        return;
+    }
+    if (cons_by_window_property == NULL) {
+        cons_by_window_property = hashmap_new();
+    }
+
+    char type[16];
+    snprintf(type, sizeof(type), "%u", con->window->window_type);
+    const char *values[WINDOW_PROPERTY_MAX] = {
+        [WINDOW_PROPERTY_CLASS] = con->window->class_class,
+        [WINDOW_PROPERTY_INSTANCE] = con->window->class_instance,
+        [WINDOW_PROPERTY_ROLE] = con->window->role,
+        [WINDOW_PROPERTY_TYPE] = type,
+    };
+    for (int property = 0; property < WINDOW_PROPERTY_MAX; property++) {
+        /* Unset properties match like empty strings. */
+        char *key = window_property_key(property, values[property] ? values[property] : "");
+        con_list *list = hashmap_lookup_str(cons_by_window_property, key);
+        if (list == NULL) {
+            list = scalloc(1, sizeof(con_list));
+            hashmap_insert_str(cons_by_window_property, key, list);
+        }
+        con_list_add(list, con);
+        con->window_property_keys[property] = key;
+    }
+}
+
+/*
+ * Adds the container to the window ID index. Needs to be called whenever
+ * con->window is set to a new window.
+ *
+ */
+void con_index_window(Con *con) {
+    if (con->window == NULL) {
+        return;
+    }
+    if (cons_by_window_id == NULL) {
+        cons_by_window_id = hashmap_new();
+    }
+    hashmap_insert(cons_by_window_id, con->window->id, con);
+    con_index_window_properties(con);
+}
+
+/*
+ * Updates the window property index after the class, instance, role or type
+ * of the given window changed.
+ *
+ */
+void con_reindex_window_properties(i3Window *window) {
+    Con *con = con_by_window_id(window->id);
+    if (con != NULL && con->window == window) {
+        con_index_window_properties(con);
+    }
+}
+
+/*
+ * Removes the container from the window ID index. Needs to be called before
+ * con->window is cleared or handed to another container.
+ *
+ */
+void con_unindex_window(Con *con) {
+    con_unindex_window_properties(con);
+    if (con->window == NULL || cons_by_window_id == NULL) {
+        return;
+    }
+    if (hashmap_lookup(cons_by_window_id, con->window->id) == con) {
+        hashmap_remove(cons_by_window_id, con->window->id);
+    }
+}
+
+/*
+ * Adds the container to the frame ID index. Called from x_con_init() once the
+ * ID of the frame window was allocated.
+ *
+ */
+void con_index_frame(Con *con) {
+    if (con->frame.id == XCB_NONE) {
+        return;
+    }
+    if (cons_by_frame_id == NULL) {
+        cons_by_frame_id = hashmap_new();
+    }
+    hashmap_insert(cons_by_frame_id, con->frame.id, con);
+}
+
+/*
+ * Removes the container from the frame ID index.
+ *
+ */
+void con_unindex_frame(Con *con) {
+    if (con->frame.id == XCB_NONE || cons_by_frame_id == NULL) {
+        return;
+    }
+    if (hashmap_lookup(cons_by_frame_id, con->frame.id) == con) {
+        hashmap_remove(cons_by_frame_id, con->frame.id);
+    }
+}
 
 /*
  * force parent split containers to be redrawn
@@ -21,26 +216,64 @@ static void con_on_remove_child(Con *con);
 void con_force_split_parents_redraw(Con *con) {
     Con *parent = con;
 
+    con_invalidate_tree_representation(con);
+
+    con_set_dirty(con);
+
     while (parent != NULL && parent->type != CT_WORKSPACE && parent->type != CT_DOCKAREA) {
         if (!con_is_leaf(parent)) {
-            FREE(parent->deco_render_params);
+            FREE(parent->cold->deco_render_params);
         }
 
         parent = parent->parent;
     }
 }
 
+/*
+ * Marks the given container (and therefore all of its parents) as dirty, so
+ * that the next tree_render() lays it out again instead of reusing the result
+ * of the previous render.
+ *
+ */
+void con_set_dirty(Con *con) {
+    /* Do not stop at the first dirty parent: render_con() clears the flag on
+     * containers whose (hidden) children it did not lay out, e.g. when a
+     * fullscreen container covers them. */
+    for (; con != NULL; con = con->parent) {
+        con->dirty = true;
+    }
+}
+
+/*
+ * Marks every container as dirty.
+ *
+ */
+void con_set_all_dirty(void) {
+    Con *con;
+    TAILQ_FOREACH (con, &all_cons, all_cons) {
+        con->dirty = true;
+    }
+}
+
 /*
  * Create a new container (and attach it to the given parent, if not NULL).
  * This function only initializes the data structures.
  *
  */
 Con *con_new_skeleton(Con *parent, i3Window *window) {
-    Con *new = scalloc(1, sizeof(Con));
+    Con *new = pool_alloc(&con_pool);
+    new->cold = pool_alloc(&con_cold_pool);
     new->on_remove_child = con_on_remove_child;
     TAILQ_INSERT_TAIL(&all_cons, new, all_cons);
+    new->creation_order = next_creation_order++;
+    if (cons_by_address == NULL) {
+        cons_by_address = hashmap_new();
+    }
+    hashmap_insert(cons_by_address, (uintptr_t)new, new);
     new->type = CT_CON;
     new->window = window;
+    new->dirty = true;
+    con_index_window(new);
     new->border_style = config.default_border;
     new->current_border_width = -1;
     new->window_icon_padding = -1;
@@ -54,8 +287,8 @@ Con *con_new_skeleton(Con *parent, i3Window *window) {
     TAILQ_INIT(&(new->floating_head));
     TAILQ_INIT(&(new->nodes_head));
     TAILQ_INIT(&(new->focus_head));
-    TAILQ_INIT(&(new->swallow_head));
-    TAILQ_INIT(&(new->marks_head));
+    TAILQ_INIT(&(new->cold->swallow_head));
+    TAILQ_INIT(&(new->cold->marks_head));
 
     if (parent != NULL)
         con_attach(new, parent, false);
@@ -78,26 +311,60 @@ Con *con_new(Con *parent, i3Window *window) {
  */
 void con_free(Con *con) {
     free(con->name);
-    FREE(con->deco_render_params);
+    FREE(con->cold->deco_render_params);
+    FREE(con->tree_representation);
+    FREE(con->split_sizes);
+    FREE(con->split_sizes_percents);
+    FREE(con->deco_hits);
+    tree_forget_flatten_candidate(con);
+    con_invalidate_lookups();
+    title_format_cache_free(con->cold->title_format_cache);
     TAILQ_REMOVE(&all_cons, con, all_cons);
-    while (!TAILQ_EMPTY(&(con->swallow_head))) {
-        Match *match = TAILQ_FIRST(&(con->swallow_head));
-        TAILQ_REMOVE(&(con->swallow_head), match, matches);
+    hashmap_remove(cons_by_address, (uintptr_t)con);
+    con_set_sticky(con, false);
+    con_set_sticky_group(con, NULL);
+    con_set_scratchpad_state(con, SCRATCHPAD_NONE);
+    con_unindex_window(con);
+    con_unindex_frame(con);
+    tree_events_con_freed(con);
+    ipc_window_events_con_freed(con);
+    while (!TAILQ_EMPTY(&(con->cold->swallow_head))) {
+        Match *match = TAILQ_FIRST(&(con->cold->swallow_head));
+        con_remove_swallow(con, match);
         match_free(match);
-        free(match);
+        pool_free(&match_pool, match);
     }
-    while (!TAILQ_EMPTY(&(con->marks_head))) {
-        mark_t *mark = TAILQ_FIRST(&(con->marks_head));
-        TAILQ_REMOVE(&(con->marks_head), mark, marks);
+    while (!TAILQ_EMPTY(&(con->cold->marks_head))) {
+        mark_t *mark = TAILQ_FIRST(&(con->cold->marks_head));
+        TAILQ_REMOVE(&(con->cold->marks_head), mark, marks);
+        if (hashmap_lookup_str(cons_by_mark, mark->name) == con) {
+            hashmap_remove_str(cons_by_mark, mark->name);
+        }
         FREE(mark->name);
-        FREE(mark);
+        pool_free(&mark_pool, mark);
     }
+    FREE(con->cold->title_format);
+    pool_free(&con_cold_pool, con->cold);
     DLOG("con %p freed\n", con);
-    free(con);
+    pool_free(&con_pool, con);
+}
+
+/*
+ * Adds delta to the number of urgent descendants of con and all its parents.
+ *
+ */
+static void con_add_urgent_descendants(Con *con, const int delta) {
+    for (; con != NULL; con = con->parent) {
+        con->urgent_descendants += delta;
+    }
 }
 
 static void _con_attach(Con *con, Con *parent, Con *previous, bool ignore_focus) {
     con->parent = parent;
+    con_invalidate_lookups();
+    FREE(parent->deco_hits);
+    tree_note_flatten_candidate(parent);
+    con_add_urgent_descendants(parent, con->urgent_descendants + con->urgent_source);
     Con *loop;
     Con *current = previous;
     struct nodes_head *nodes_head = &(parent->nodes_head);
@@ -107,6 +374,7 @@ static void _con_attach(Con *con, Con *parent, Con *previous, bool ignore_focus)
      * right position. */
     if (con->type == CT_WORKSPACE) {
         DLOG("it's a workspace. num = %d\n", con->num);
+        workspace_index(con);
         if (con->num == -1 || TAILQ_EMPTY(nodes_head)) {
             TAILQ_INSERT_TAIL(nodes_head, con, nodes);
         } else {
@@ -206,6 +474,7 @@ add_to_focus_head:
      * This way, we have the option to insert Cons without having
      * to focus them. */
     TAILQ_INSERT_TAIL(focus_head, con, focused);
+    con_invalidate_lookups();
     con_force_split_parents_redraw(con);
 }
 
@@ -229,6 +498,12 @@ void con_attach(Con *con, Con *parent, bool ignore_focus) {
  */
 void con_detach(Con *con) {
     con_force_split_parents_redraw(con);
+    FREE(con->parent->deco_hits);
+    tree_note_flatten_candidate(con->parent);
+    con_add_urgent_descendants(con->parent, -(con->urgent_descendants + con->urgent_source));
+    if (con->type == CT_WORKSPACE) {
+        workspace_unindex(con);
+    }
     if (con->type == CT_FLOATING_CON) {
         TAILQ_REMOVE(&(con->parent->floating_head), con, floating_windows);
         TAILQ_REMOVE(&(con->parent->focus_head), con, focused);
@@ -236,6 +511,7 @@ void con_detach(Con *con) {
         TAILQ_REMOVE(&(con->parent->nodes_head), con, nodes);
         TAILQ_REMOVE(&(con->parent->focus_head), con, focused);
     }
+    con_invalidate_lookups();
 }
 
 /*
@@ -255,6 +531,8 @@ void con_focus(Con *con) {
         con_focus(con->parent);
 
     focused = con;
+    con_invalidate_lookups();
+    tree_note_focus_change();
     /* We can't blindly reset non-leaf containers since they might have
      * other urgent children. Therefore we only reset leafs and propagate
      * the changes upwards via con_update_parents_urgency() which does proper
@@ -340,6 +618,8 @@ void con_close(Con *con, kill_window_t kill_window) {
 
     if (con->type == CT_WORKSPACE) {
         DLOG("con = %p is a workspace, closing all children instead.\n", con);
+        /* Render (and send the events) once for all children. */
+        const bool bulk_begun = tree_bulk_begin();
         Con *child, *nextchild;
         for (child = TAILQ_FIRST(&(con->focus_head)); child;) {
             nextchild = TAILQ_NEXT(child, focused);
@@ -347,6 +627,9 @@ void con_close(Con *con, kill_window_t kill_window) {
             tree_close_internal(child, kill_window, false);
             child = nextchild;
         }
+        if (bulk_begun) {
+            tree_bulk_end();
+        }
 
         return;
     }
@@ -455,19 +738,71 @@ bool con_accepts_window(Con *con) {
     return (con->window == NULL);
 }
 
+/* Bumped by con_invalidate_lookups(). The lookups cached in a container are
+ * only valid while the generation they were computed in is current. */
+static uint64_t lookup_generation = 1;
+
+/*
+ * Notes that parent pointers, focus lists or the focused container changed,
+ * which invalidates the results cached by con_get_workspace(),
+ * con_get_output(), con_descend_focused() and con_descend_tiling_focused().
+ *
+ */
+void con_invalidate_lookups(void) {
+    lookup_generation++;
+}
+
+/*
+ * Returns the current lookup generation, so other caches of the tree structure
+ * can tell whether it changed.
+ *
+ */
+uint64_t con_lookup_generation(void) {
+    return lookup_generation;
+}
+
+/*
+ * Updates the cached workspace and output of the given container (and of its
+ * ancestors, so that the lookup for its siblings is a field read).
+ *
+ */
+static void con_lookup_ancestors(Con *con) {
+    if (con->ancestors_generation == lookup_generation) {
+        return;
+    }
+
+    Con *workspace = NULL;
+    Con *output = NULL;
+    if (con->parent != NULL) {
+        con_lookup_ancestors(con->parent);
+        workspace = con->parent->cached_workspace;
+        output = con->parent->cached_output;
+    }
+    /* Like walking up the tree, the first workspace or output wins. A
+     * workspace is never above an output, so cons above an output have no
+     * workspace. */
+    if (con->type == CT_WORKSPACE) {
+        workspace = con;
+    } else if (con->type == CT_OUTPUT) {
+        output = con;
+        workspace = NULL;
+    }
+    con->cached_workspace = workspace;
+    con->cached_output = output;
+    con->ancestors_generation = lookup_generation;
+}
+
 /*
  * Gets the output container (first container with CT_OUTPUT in hierarchy) this
  * node is on.
  *
  */
 Con *con_get_output(Con *con) {
-    Con *result = con;
-    while (result != NULL && result->type != CT_OUTPUT)
-        result = result->parent;
+    con_lookup_ancestors(con);
     /* We must be able to get an output because focus can never be set higher
      * in the tree (root node cannot be focused). */
-    assert(result != NULL);
-    return result;
+    assert(con->cached_output != NULL);
+    return con->cached_output;
 }
 
 /*
@@ -475,10 +810,8 @@ Con *con_get_output(Con *con) {
  *
  */
 Con *con_get_workspace(Con *con) {
-    Con *result = con;
-    while (result != NULL && result->type != CT_WORKSPACE)
-        result = result->parent;
-    return result;
+    con_lookup_ancestors(con);
+    return con->cached_workspace;
 }
 
 /*
@@ -666,34 +999,171 @@ bool con_has_parent(Con *con, Con *parent) {
  *
  */
 Con *con_by_window_id(xcb_window_t window) {
-    Con *con;
-    TAILQ_FOREACH (con, &all_cons, all_cons) {
-        if (con->window != NULL && con->window->id == window) {
-            return con;
-        }
+    if (cons_by_window_id == NULL) {
+        return NULL;
     }
-    return NULL;
+    return hashmap_lookup(cons_by_window_id, window);
 }
 
 /*
  * Returns the container with the given container ID or NULL if no such
- * container exists.
+ * container exists. The ID is the address of the container, which is looked
+ * up in the registry maintained by con_new_skeleton() and con_free().
  *
  */
 Con *con_by_con_id(long target) {
-    Con *con;
-    TAILQ_FOREACH (con, &all_cons, all_cons) {
-        if (con == (Con *)target) {
-            return con;
+    if (cons_by_address == NULL) {
+        return NULL;
+    }
+    return hashmap_lookup(cons_by_address, (uintptr_t)target);
+}
+
+/*
+ * Returns the containers whose window has the given class, instance, role or
+ * type (formatted as a decimal atom) and stores their number in num. The
+ * array is owned by the index and only valid until the next change to the
+ * tree. The containers are in no particular order.
+ *
+ */
+Con **con_by_window_property(window_property_t property, const char *value, size_t *num) {
+    *num = 0;
+    if (cons_by_window_property == NULL) {
+        return NULL;
+    }
+    char *key = window_property_key(property, value);
+    con_list *list = hashmap_lookup_str(cons_by_window_property, key);
+    free(key);
+    if (list == NULL) {
+        return NULL;
+    }
+    *num = list->num;
+    return list->cons;
+}
+
+/*
+ * Sets con->sticky and updates the list of sticky containers.
+ *
+ */
+void con_set_sticky(Con *con, bool sticky) {
+    if (con->sticky == sticky) {
+        return;
+    }
+    con->sticky = sticky;
+    if (sticky) {
+        con_list_add(&sticky_cons, con);
+    } else {
+        con_list_remove(&sticky_cons, con);
+    }
+}
+
+/*
+ * Returns the containers with con->sticky set and stores their number in num.
+ * The array is only valid until the next change to the tree. The containers
+ * are in no particular order.
+ *
+ */
+Con **con_sticky_cons(size_t *num) {
+    *num = sticky_cons.num;
+    return sticky_cons.cons;
+}
+
+/*
+ * Sets (a copy of) the sticky group of the container, which may be NULL, and
+ * updates the sticky group index.
+ *
+ */
+void con_set_sticky_group(Con *con, const char *sticky_group) {
+    if (con->cold->sticky_group != NULL) {
+        con_list *list = hashmap_lookup_str(cons_by_sticky_group, con->cold->sticky_group);
+        if (list != NULL) {
+            con_list_remove(list, con);
+            if (list->num == 0) {
+                hashmap_remove_str(cons_by_sticky_group, con->cold->sticky_group);
+                free(list->cons);
+                free(list);
+            }
         }
+        FREE(con->cold->sticky_group);
+    }
+    if (sticky_group == NULL) {
+        return;
     }
 
-    return NULL;
+    con->cold->sticky_group = sstrdup(sticky_group);
+    if (cons_by_sticky_group == NULL) {
+        cons_by_sticky_group = hashmap_new();
+    }
+    con_list *list = hashmap_lookup_str(cons_by_sticky_group, sticky_group);
+    if (list == NULL) {
+        list = scalloc(1, sizeof(con_list));
+        hashmap_insert_str(cons_by_sticky_group, sticky_group, list);
+    }
+    con_list_add(list, con);
 }
 
 /*
- * Returns true if the given container (still) exists.
- * This can be used, e.g., to make sure a container hasn't been closed in the meantime.
+ * Returns whether any container has a sticky group.
+ *
+ */
+bool con_has_sticky_groups(void) {
+    return cons_by_sticky_group != NULL && hashmap_size(cons_by_sticky_group) > 0;
+}
+
+/*
+ * Returns the containers in the given sticky group and stores their number
+ * in num. The array is only valid until the next change to the tree. The
+ * containers are in no particular order.
+ *
+ */
+Con **con_by_sticky_group(const char *sticky_group, size_t *num) {
+    *num = 0;
+    if (cons_by_sticky_group == NULL) {
+        return NULL;
+    }
+    con_list *list = hashmap_lookup_str(cons_by_sticky_group, sticky_group);
+    if (list == NULL) {
+        return NULL;
+    }
+    *num = list->num;
+    return list->cons;
+}
+
+/*
+ * Sets the scratchpad state of the container and updates the list of
+ * scratchpad containers.
+ *
+ */
+void con_set_scratchpad_state(Con *con, scratchpad_state_t state) {
+    if ((con->scratchpad_state == SCRATCHPAD_NONE) != (state == SCRATCHPAD_NONE)) {
+        if (state == SCRATCHPAD_NONE) {
+            con_list_remove(&scratchpad_cons, con);
+        } else {
+            con_list_add(&scratchpad_cons, con);
+        }
+    }
+    con->scratchpad_state = state;
+}
+
+/*
+ * Returns the containers whose scratchpad state is not SCRATCHPAD_NONE and
+ * stores their number in num. The array is only valid until the next change
+ * to the tree. The containers are in no particular order.
+ *
+ */
+Con **con_scratchpad_cons(size_t *num) {
+    *num = scratchpad_cons.num;
+    return scratchpad_cons.cons;
+}
+
+/*
+ * Returns true if a live container exists at the given address. This is a
+ * single hash lookup in the registry of live containers (like
+ * con_by_con_id()), so it is cheap enough for hot paths.
+ *
+ * It does not tell whether the container is still the one the pointer was
+ * taken from: containers are allocated from a pool, so the address of a
+ * closed container can be reused by a new one, and this then returns true for
+ * the stale pointer. Compare creation_order as well if that matters.
  *
  */
 bool con_exists(Con *con) {
@@ -706,13 +1176,10 @@ bool con_exists(Con *con) {
  *
  */
 Con *con_by_frame_id(xcb_window_t frame) {
-    Con *con;
-    TAILQ_FOREACH (con, &all_cons, all_cons) {
-        if (con->frame.id == frame) {
-            return con;
-        }
+    if (cons_by_frame_id == NULL || frame == XCB_NONE) {
+        return NULL;
     }
-    return NULL;
+    return hashmap_lookup(cons_by_frame_id, frame);
 }
 
 /*
@@ -721,13 +1188,10 @@ Con *con_by_frame_id(xcb_window_t frame) {
  *
  */
 Con *con_by_mark(const char *mark) {
-    Con *con;
-    TAILQ_FOREACH (con, &all_cons, all_cons) {
-        if (con_has_mark(con, mark))
-            return con;
+    if (cons_by_mark == NULL) {
+        return NULL;
     }
-
-    return NULL;
+    return hashmap_lookup_str(cons_by_mark, mark);
 }
 
 /*
@@ -770,12 +1234,32 @@ bool con_find_transient_for_window(Con *start, xcb_window_t target) {
  *
  */
 bool con_has_mark(Con *con, const char *mark) {
-    mark_t *current;
-    TAILQ_FOREACH (current, &(con->marks_head), marks) {
-        if (strcmp(current->name, mark) == 0)
-            return true;
+    return (con_by_mark(mark) == con);
+}
+
+/*
+ * Returns true if one of the container’s marks matches the given regular
+ * expression. Patterns which can only match one mark name exactly (like
+ * ^name$) are answered from the mark index.
+ *
+ */
+bool con_has_mark_matching(Con *con, struct regex *regex) {
+    const char *pattern = regex->pattern;
+    const size_t len = strlen(pattern);
+    if (len >= 2 && pattern[0] == '^' && pattern[len - 1] == '$' &&
+        strpbrk(pattern + 1, "\\^$.|?*+()[]{}") == pattern + len - 1) {
+        char *name = sstrndup(pattern + 1, len - 2);
+        const bool result = con_has_mark(con, name);
+        free(name);
+        return result;
     }
 
+    mark_t *mark;
+    TAILQ_FOREACH (mark, &(con->cold->marks_head), marks) {
+        if (regex_matches(regex, mark->name)) {
+            return true;
+        }
+    }
     return false;
 }
 
@@ -809,18 +1293,23 @@ void con_mark(Con *con, const char *mark, mark_mode_t mode) {
         DLOG("Removing all existing marks on con = %p.\n", con);
 
         mark_t *current;
-        while (!TAILQ_EMPTY(&(con->marks_head))) {
-            current = TAILQ_FIRST(&(con->marks_head));
+        while (!TAILQ_EMPTY(&(con->cold->marks_head))) {
+            current = TAILQ_FIRST(&(con->cold->marks_head));
             con_unmark(con, current->name);
         }
     }
 
-    mark_t *new = scalloc(1, sizeof(mark_t));
+    mark_t *new = pool_alloc(&mark_pool);
     new->name = sstrdup(mark);
-    TAILQ_INSERT_TAIL(&(con->marks_head), new, marks);
+    TAILQ_INSERT_TAIL(&(con->cold->marks_head), new, marks);
+    if (cons_by_mark == NULL) {
+        cons_by_mark = hashmap_new();
+    }
+    hashmap_insert_str(cons_by_mark, new->name, con);
     ipc_send_window_event("mark", con);
 
-    con->mark_changed = true;
+    con->cold->mark_changed = true;
+    con_set_dirty(con);
 }
 
 /*
@@ -834,24 +1323,29 @@ void con_unmark(Con *con, const char *name) {
     Con *current;
     if (name == NULL) {
         DLOG("Unmarking all containers.\n");
+        if (cons_by_mark == NULL || hashmap_size(cons_by_mark) == 0) {
+            return;
+        }
         TAILQ_FOREACH (current, &all_cons, all_cons) {
             if (con != NULL && current != con)
                 continue;
 
-            if (TAILQ_EMPTY(&(current->marks_head)))
+            if (TAILQ_EMPTY(&(current->cold->marks_head)))
                 continue;
 
             mark_t *mark;
-            while (!TAILQ_EMPTY(&(current->marks_head))) {
-                mark = TAILQ_FIRST(&(current->marks_head));
+            while (!TAILQ_EMPTY(&(current->cold->marks_head))) {
+                mark = TAILQ_FIRST(&(current->cold->marks_head));
+                hashmap_remove_str(cons_by_mark, mark->name);
                 FREE(mark->name);
-                TAILQ_REMOVE(&(current->marks_head), mark, marks);
-                FREE(mark);
+                TAILQ_REMOVE(&(current->cold->marks_head), mark, marks);
+                pool_free(&mark_pool, mark);
 
                 ipc_send_window_event("mark", current);
             }
 
-            current->mark_changed = true;
+            current->cold->mark_changed = true;
+            con_set_dirty(current);
         }
     } else {
         DLOG("Removing mark \"%s\".\n", name);
@@ -862,16 +1356,18 @@ void con_unmark(Con *con, const char *name) {
         }
 
         DLOG("Found mark on con = %p. Removing it now.\n", current);
-        current->mark_changed = true;
+        current->cold->mark_changed = true;
+        con_set_dirty(current);
 
         mark_t *mark;
-        TAILQ_FOREACH (mark, &(current->marks_head), marks) {
+        TAILQ_FOREACH (mark, &(current->cold->marks_head), marks) {
             if (strcmp(mark->name, name) != 0)
                 continue;
 
+            hashmap_remove_str(cons_by_mark, mark->name);
             FREE(mark->name);
-            TAILQ_REMOVE(&(current->marks_head), mark, marks);
-            FREE(mark);
+            TAILQ_REMOVE(&(current->cold->marks_head), mark, marks);
+            pool_free(&mark_pool, mark);
 
             ipc_send_window_event("mark", current);
             break;
@@ -879,41 +1375,268 @@ void con_unmark(Con *con, const char *name) {
     }
 }
 
+/* The swallow criteria of all containers, for con_for_window(). Criteria are
+ * bucketed by the window id they require or else by the exact class, instance
+ * or title (in that order of preference); all other criteria (e.g. those of
+ * the dock areas) are in residual_swallows. */
+struct swallow_bucket {
+    /* The map this bucket is in (NULL for residual_swallows) and its key,
+     * which is NULL for the window id map. */
+    hashmap_t *map;
+    char *key;
+    uint64_t id;
+    TAILQ_HEAD(swallow_matches_head, Match) matches;
+};
+
+static hashmap_t *swallows_by_id;
+static hashmap_t *swallows_by_class;
+static hashmap_t *swallows_by_instance;
+static hashmap_t *swallows_by_title;
+static struct swallow_bucket residual_swallows = {
+    .matches = TAILQ_HEAD_INITIALIZER(residual_swallows.matches)};
+
+/*
+ * Returns the exact string the given criterion requires, if it can be used as
+ * a bucket key. Windows are looked up without a trailing newline, which "$"
+ * matches, so literals ending in a newline are not usable. "__focused__" is
+ * compared against the focused window instead.
+ *
+ */
+static const char *swallow_key(struct regex *regex) {
+    if (regex == NULL) {
+        return NULL;
+    }
+    const char *key = regex_exact_literal(regex);
+    if (key == NULL ||
+        (key[0] != '\0' && key[strlen(key) - 1] == '\n') ||
+        strcmp(key, "__focused__") == 0) {
+        return NULL;
+    }
+    return key;
+}
+
+static struct swallow_bucket *swallow_bucket_lookup(hashmap_t *map, const char *value) {
+    if (map == NULL) {
+        return NULL;
+    }
+    if (value == NULL) {
+        value = "";
+    }
+    const size_t len = strlen(value);
+    if (len > 0 && value[len - 1] == '\n') {
+        char *key = sstrndup(value, len - 1);
+        struct swallow_bucket *bucket = hashmap_lookup_str(map, key);
+        free(key);
+        return bucket;
+    }
+    return hashmap_lookup_str(map, value);
+}
+
+static struct swallow_bucket *swallow_bucket_get(hashmap_t **map, const char *key, uint64_t id) {
+    if (*map == NULL) {
+        *map = hashmap_new();
+    }
+    struct swallow_bucket *bucket = (key ? hashmap_lookup_str(*map, key) : hashmap_lookup(*map, id));
+    if (bucket == NULL) {
+        bucket = scalloc(1, sizeof(struct swallow_bucket));
+        bucket->map = *map;
+        bucket->key = (key ? sstrdup(key) : NULL);
+        bucket->id = id;
+        TAILQ_INIT(&(bucket->matches));
+        if (key) {
+            hashmap_insert_str(*map, key, bucket);
+        } else {
+            hashmap_insert(*map, id, bucket);
+        }
+    }
+    return bucket;
+}
+
+static void swallow_unindex(Match *match) {
+    struct swallow_bucket *bucket = match->swallow_bucket;
+    if (bucket == NULL) {
+        return;
+    }
+    TAILQ_REMOVE(&(bucket->matches), match, swallow_entries);
+    match->swallow_bucket = NULL;
+    if (bucket->map == NULL || !TAILQ_EMPTY(&(bucket->matches))) {
+        return;
+    }
+    if (bucket->key) {
+        hashmap_remove_str(bucket->map, bucket->key);
+    } else {
+        hashmap_remove(bucket->map, bucket->id);
+    }
+    free(bucket->key);
+    free(bucket);
+}
+
+/*
+ * Adds the given match to the swallow criteria of the container, either in
+ * front of or after the existing ones, and indexes it for con_for_window().
+ *
+ */
+void con_add_swallow(Con *con, Match *match, bool head) {
+    if (head) {
+        TAILQ_INSERT_HEAD(&(con->cold->swallow_head), match, matches);
+    } else {
+        TAILQ_INSERT_TAIL(&(con->cold->swallow_head), match, matches);
+    }
+    con_index_swallow(con, match);
+}
+
+/*
+ * (Re-)indexes a match of the container's swallow criteria. This has to be
+ * called whenever the criteria of such a match change.
+ *
+ */
+void con_index_swallow(Con *con, Match *match) {
+    swallow_unindex(match);
+    match->swallow_con = con;
+
+    struct swallow_bucket *bucket;
+    const char *key;
+    struct match_criterion *id = match_get(match, CRIT_ID);
+    if (id != NULL && id->id != XCB_NONE) {
+        bucket = swallow_bucket_get(&swallows_by_id, NULL, id->id);
+    } else if ((key = swallow_key(match_get_regex(match, CRIT_CLASS))) != NULL) {
+        bucket = swallow_bucket_get(&swallows_by_class, key, 0);
+    } else if ((key = swallow_key(match_get_regex(match, CRIT_INSTANCE))) != NULL) {
+        bucket = swallow_bucket_get(&swallows_by_instance, key, 0);
+    } else if ((key = swallow_key(match_get_regex(match, CRIT_TITLE))) != NULL) {
+        bucket = swallow_bucket_get(&swallows_by_title, key, 0);
+    } else {
+        bucket = &residual_swallows;
+    }
+    TAILQ_INSERT_TAIL(&(bucket->matches), match, swallow_entries);
+    match->swallow_bucket = bucket;
+}
+
+/*
+ * Removes the given match from the container's swallow criteria and from the
+ * index. The match is not freed.
+ *
+ */
+void con_remove_swallow(Con *con, Match *match) {
+    TAILQ_REMOVE(&(con->cold->swallow_head), match, matches);
+    swallow_unindex(match);
+    match->swallow_con = NULL;
+}
+
+/*
+ * Returns the number of levels between con and its ancestor top, or -1 if con
+ * is not strictly below top.
+ *
+ */
+static int con_depth_below(Con *con, Con *top) {
+    int depth = 0;
+    for (; con != NULL; con = con->parent, depth++) {
+        if (con == top) {
+            return (depth > 0 ? depth : -1);
+        }
+    }
+    return -1;
+}
+
+/*
+ * Returns whether a comes before b (which are different containers at the
+ * given depths below top) in the order in which the old recursive search of
+ * con_for_window() visited containers: depth-first, parents before their
+ * children, tiling children before floating ones.
+ *
+ */
+static bool con_search_precedes(Con *a, int depth_a, Con *b, int depth_b) {
+    while (depth_b > depth_a) {
+        b = b->parent;
+        depth_b--;
+    }
+    if (b == a) {
+        /* a is an ancestor of b */
+        return true;
+    }
+    while (depth_a > depth_b) {
+        a = a->parent;
+        depth_a--;
+    }
+    if (a == b) {
+        /* b is an ancestor of a */
+        return false;
+    }
+    while (a->parent != b->parent) {
+        a = a->parent;
+        b = b->parent;
+    }
+
+    const bool a_floating = (a->type == CT_FLOATING_CON);
+    const bool b_floating = (b->type == CT_FLOATING_CON);
+    if (a_floating != b_floating) {
+        return b_floating;
+    }
+    for (Con *next = a; next != NULL;
+         next = (a_floating ? TAILQ_NEXT(next, floating_windows) : TAILQ_NEXT(next, nodes))) {
+        if (next == b) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /*
  * Returns the first container below 'con' which wants to swallow this window
  * TODO: priority
  *
  */
 Con *con_for_window(Con *con, i3Window *window, Match **store_match) {
-    Con *child;
-    Match *match;
+    /* Only the buckets the window can be in are searched, the result is the
+     * one the recursive search of the whole tree used to find first. */
+    const char *title = (window->name == NULL ? NULL : i3string_as_utf8(window->name));
+    struct swallow_bucket *buckets[] = {
+        (swallows_by_id ? hashmap_lookup(swallows_by_id, window->id) : NULL),
+        swallow_bucket_lookup(swallows_by_class, window->class_class),
+        swallow_bucket_lookup(swallows_by_instance, window->class_instance),
+        swallow_bucket_lookup(swallows_by_title, title),
+        &residual_swallows,
+    };
 
-    TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
-        TAILQ_FOREACH (match, &(child->swallow_head), matches) {
-            if (!match_matches_window(match, window))
+    Con *best = NULL;
+    int best_depth = 0;
+    for (size_t i = 0; i < sizeof(buckets) / sizeof(buckets[0]); i++) {
+        if (buckets[i] == NULL) {
+            continue;
+        }
+        Match *match;
+        TAILQ_FOREACH (match, &(buckets[i]->matches), swallow_entries) {
+            Con *candidate = match->swallow_con;
+            if (candidate == best) {
+                continue;
+            }
+            const int depth = con_depth_below(candidate, con);
+            if (depth < 0 ||
+                (best != NULL && !con_search_precedes(candidate, depth, best, best_depth))) {
+                continue;
+            }
+            if (!match_matches_window(match, window)) {
                 continue;
-            if (store_match != NULL)
-                *store_match = match;
-            return child;
+            }
+            best = candidate;
+            best_depth = depth;
         }
-        Con *result = con_for_window(child, window, store_match);
-        if (result != NULL)
-            return result;
+    }
+    if (best == NULL) {
+        return NULL;
     }
 
-    TAILQ_FOREACH (child, &(con->floating_head), floating_windows) {
-        TAILQ_FOREACH (match, &(child->swallow_head), matches) {
-            if (!match_matches_window(match, window))
-                continue;
-            if (store_match != NULL)
-                *store_match = match;
-            return child;
+    /* The first matching criterion of the container wins. */
+    Match *match;
+    TAILQ_FOREACH (match, &(best->cold->swallow_head), matches) {
+        if (!match_matches_window(match, window)) {
+            continue;
+        }
+        if (store_match != NULL) {
+            *store_match = match;
         }
-        Con *result = con_for_window(child, window, store_match);
-        if (result != NULL)
-            return result;
+        return best;
     }
-
     return NULL;
 }
 
@@ -954,6 +1677,7 @@ Con **get_focus_order(Con *con) {
  *
  */
 void set_focus_order(Con *con, Con **focus_order) {
+    con_invalidate_lookups();
     int focus_heads = 0;
     while (!TAILQ_EMPTY(&(con->focus_head))) {
         Con *current = TAILQ_FIRST(&(con->focus_head));
@@ -1043,13 +1767,16 @@ int con_num_windows(Con *con) {
  */
 void con_fix_percent(Con *con) {
     Con *child;
-    int children = con_num_children(con);
+    int children = 0;
+
+    con_set_dirty(con);
 
     /* calculate how much we have distributed and how many containers with a
      * percentage set we have */
     double total = 0.0;
     int children_with_percent = 0;
     TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
+        children++;
         if (child->percent > 0.0) {
             total += child->percent;
             ++children_with_percent;
@@ -1111,6 +1838,7 @@ void con_toggle_fullscreen(Con *con, int fullscreen_mode) {
  */
 static void con_set_fullscreen_mode(Con *con, fullscreen_mode_t fullscreen_mode) {
     con->fullscreen_mode = fullscreen_mode;
+    con_set_dirty(con);
 
     DLOG("mode now: %d\n", con->fullscreen_mode);
 
@@ -1205,6 +1933,90 @@ void con_disable_fullscreen(Con *con) {
     con_set_fullscreen_mode(con, CF_NONE);
 }
 
+/* The containers which got children during a bulk move, see
+ * con_begin_bulk_move(). */
+static bool bulk_move = false;
+static bool bulk_moved = false;
+static Con **bulk_targets = NULL;
+static int num_bulk_targets = 0;
+static int bulk_targets_size = 0;
+
+static void bulk_move_add_target(Con *target) {
+    for (int i = 0; i < num_bulk_targets; i++) {
+        if (bulk_targets[i] == target) {
+            return;
+        }
+    }
+    if (num_bulk_targets == bulk_targets_size) {
+        bulk_targets_size = (bulk_targets_size == 0 ? 8 : 2 * bulk_targets_size);
+        bulk_targets = srealloc(bulk_targets, bulk_targets_size * sizeof(Con *));
+    }
+    bulk_targets[num_bulk_targets++] = target;
+}
+
+/*
+ * Gives the children without a percentage the average percentage of the
+ * others before normalizing them, which results in the same percentages as
+ * fixing them after every single move would.
+ *
+ */
+static void bulk_move_fix_percent(Con *con) {
+    double total = 0.0;
+    int children_with_percent = 0;
+    Con *child;
+    TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
+        if (child->percent > 0.0) {
+            total += child->percent;
+            children_with_percent++;
+        }
+    }
+    if (children_with_percent > 0) {
+        const double average = total / children_with_percent;
+        TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
+            if (child->percent <= 0.0) {
+                child->percent = average;
+            }
+        }
+    }
+    con_fix_percent(con);
+}
+
+/*
+ * Starts moving several containers at once (e.g. all windows matching the
+ * criteria of a command). Until con_end_bulk_move() is called, the
+ * percentages of the containers the moved ones are attached to and
+ * _NET_WM_DESKTOP are not updated after every move.
+ *
+ */
+void con_begin_bulk_move(void) {
+    assert(!bulk_move);
+    bulk_move = true;
+    bulk_moved = false;
+    num_bulk_targets = 0;
+}
+
+/*
+ * Fixes the percentages of all containers which got children since
+ * con_begin_bulk_move() and updates _NET_WM_DESKTOP once.
+ *
+ */
+void con_end_bulk_move(void) {
+    assert(bulk_move);
+    bulk_move = false;
+
+    for (int i = 0; i < num_bulk_targets; i++) {
+        /* Later moves might have closed a target which became empty. */
+        if (con_by_con_id((long)bulk_targets[i]) == bulk_targets[i]) {
+            bulk_move_fix_percent(bulk_targets[i]);
+        }
+    }
+    num_bulk_targets = 0;
+
+    if (bulk_moved) {
+        ewmh_update_wm_desktop();
+    }
+}
+
 static bool _con_move_to_con(Con *con, Con *target, bool behind_focused, bool fix_coordinates, bool dont_warp, bool ignore_focus, bool fix_percentage) {
     Con *orig_target = target;
 
@@ -1317,7 +2129,11 @@ static bool _con_move_to_con(Con *con, Con *target, bool behind_focused, bool fi
     if (fix_percentage) {
         con_fix_percent(parent);
         con->percent = 0.0;
-        con_fix_percent(target);
+        if (bulk_move) {
+            bulk_move_add_target(target);
+        } else {
+            con_fix_percent(target);
+        }
     }
 
     /* 6: focus the con on the target workspace, but only within that
@@ -1380,12 +2196,16 @@ static bool _con_move_to_con(Con *con, Con *target, bool behind_focused, bool fi
     }
 
     /* Ensure the container will be redrawn. */
-    FREE(con->deco_render_params);
+    FREE(con->cold->deco_render_params);
 
     CALL(parent, on_remove_child);
 
     ipc_send_window_event("move", con);
-    ewmh_update_wm_desktop();
+    if (bulk_move) {
+        bulk_moved = true;
+    } else {
+        ewmh_update_wm_desktop();
+    }
     return true;
 }
 
@@ -1581,9 +2401,19 @@ Con *con_next_focused(Con *con) {
  *
  */
 Con *con_descend_focused(Con *con) {
+    if (con->focus_generation != lookup_generation) {
+        con->cached_focused = NULL;
+        con->cached_tiling_focused = NULL;
+        con->focus_generation = lookup_generation;
+    }
+    if (con->cached_focused != NULL) {
+        return con->cached_focused;
+    }
+
     Con *next = con;
     while (next != focused && !TAILQ_EMPTY(&(next->focus_head)))
         next = TAILQ_FIRST(&(next->focus_head));
+    con->cached_focused = next;
     return next;
 }
 
@@ -1596,11 +2426,22 @@ Con *con_descend_focused(Con *con) {
  *
  */
 Con *con_descend_tiling_focused(Con *con) {
+    if (con->focus_generation != lookup_generation) {
+        con->cached_focused = NULL;
+        con->cached_tiling_focused = NULL;
+        con->focus_generation = lookup_generation;
+    }
+    if (con->cached_tiling_focused != NULL) {
+        return con->cached_tiling_focused;
+    }
+
     Con *next = con;
     Con *before;
     Con *child;
-    if (next == focused)
+    if (next == focused) {
+        con->cached_tiling_focused = next;
         return next;
+    }
     do {
         before = next;
         TAILQ_FOREACH (child, &(next->focus_head), focused) {
@@ -1611,6 +2452,7 @@ Con *con_descend_tiling_focused(Con *con) {
             break;
         }
     } while (before != next && next != focused);
+    con->cached_tiling_focused = next;
     return next;
 }
 
@@ -1681,6 +2523,50 @@ Con *con_descend_direction(Con *con, direction_t direction) {
     return con_descend_direction(most, direction);
 }
 
+/* The current layout pass, see con_begin_layout_pass(). The values cached in
+ * a container are valid while the pass they were computed in is active. */
+static uint64_t layout_pass = 0;
+static int layout_pass_depth = 0;
+
+/*
+ * Starts a layout pass: rendering the tree or pushing it to X11. The tree does
+ * not change during a pass, so the number of visible windows on each
+ * workspace and the adjacent screen edges of each container, which every
+ * con_border_style_rect() needs, are only computed once per pass instead of
+ * once per container. Passes can be nested.
+ *
+ */
+void con_begin_layout_pass(void) {
+    if (layout_pass_depth++ == 0) {
+        layout_pass++;
+    }
+}
+
+/*
+ * Ends the layout pass started with con_begin_layout_pass().
+ *
+ */
+void con_end_layout_pass(void) {
+    assert(layout_pass_depth > 0);
+    layout_pass_depth--;
+}
+
+/*
+ * Returns con_num_visible_children() of the given workspace, computed once
+ * per layout pass.
+ *
+ */
+static int workspace_visible_children(Con *workspace) {
+    if (workspace == NULL || layout_pass_depth == 0) {
+        return con_num_visible_children(workspace);
+    }
+    if (workspace->visible_children_pass != layout_pass) {
+        workspace->visible_children = con_num_visible_children(workspace);
+        workspace->visible_children_pass = layout_pass;
+    }
+    return workspace->visible_children;
+}
+
 /*
  * Returns a "relative" Rect which contains the amount of pixels that need to
  * be added to the original Rect to get the final position (obviously the
@@ -1688,7 +2574,7 @@ Con *con_descend_direction(Con *con, direction_t direction) {
  *
  */
 Rect con_border_style_rect(Con *con) {
-    if (config.hide_edge_borders == HEBM_SMART && con_num_visible_children(con_get_workspace(con)) <= 1) {
+    if (config.hide_edge_borders == HEBM_SMART && workspace_visible_children(con_get_workspace(con)) <= 1) {
         if (!con_is_floating(con)) {
             return (Rect){0, 0, 0, 0};
         }
@@ -1739,21 +2625,34 @@ Rect con_border_style_rect(Con *con) {
  * enabled.
  */
 adjacent_t con_adjacent_borders(Con *con) {
+    /* During a layout pass, the result only changes with the rect of the
+     * container: render_con() sets it before rendering the container. */
+    if (layout_pass_depth > 0 &&
+        con->adjacent_pass == layout_pass &&
+        rect_equals(con->adjacent_rect, con->rect)) {
+        return con->adjacent;
+    }
+
     adjacent_t result = ADJ_NONE;
     /* Floating windows are never adjacent to any other window, so
        don’t hide their border(s). This prevents bug #998. */
-    if (con_is_floating(con))
-        return result;
-
-    Con *workspace = con_get_workspace(con);
-    if (con->rect.x == workspace->rect.x)
-        result |= ADJ_LEFT_SCREEN_EDGE;
-    if (con->rect.x + con->rect.width == workspace->rect.x + workspace->rect.width)
-        result |= ADJ_RIGHT_SCREEN_EDGE;
-    if (con->rect.y == workspace->rect.y)
-        result |= ADJ_UPPER_SCREEN_EDGE;
-    if (con->rect.y + con->rect.height == workspace->rect.y + workspace->rect.height)
-        result |= ADJ_LOWER_SCREEN_EDGE;
+    if (!con_is_floating(con)) {
+        Con *workspace = con_get_workspace(con);
+        if (con->rect.x == workspace->rect.x)
+            result |= ADJ_LEFT_SCREEN_EDGE;
+        if (con->rect.x + con->rect.width == workspace->rect.x + workspace->rect.width)
+            result |= ADJ_RIGHT_SCREEN_EDGE;
+        if (con->rect.y == workspace->rect.y)
+            result |= ADJ_UPPER_SCREEN_EDGE;
+        if (con->rect.y + con->rect.height == workspace->rect.y + workspace->rect.height)
+            result |= ADJ_LOWER_SCREEN_EDGE;
+    }
+
+    if (layout_pass_depth > 0) {
+        con->adjacent = result;
+        con->adjacent_rect = con->rect;
+        con->adjacent_pass = layout_pass;
+    }
     return result;
 }
 
@@ -1791,6 +2690,8 @@ int con_border_style(Con *con) {
  *
  */
 void con_set_border_style(Con *con, int border_style, int border_width) {
+    con_set_dirty(con);
+
     /* Handle the simple case: non-floating containerns */
     if (!con_is_floating(con)) {
         con->border_style = border_style;
@@ -1848,6 +2749,8 @@ void con_set_layout(Con *con, layout_t layout) {
     if (con->layout == L_SPLITH || con->layout == L_SPLITV)
         con->last_split_layout = con->layout;
 
+    tree_note_flatten_candidate(con);
+
     /* When the container type is CT_WORKSPACE, the user wants to change the
      * whole workspace into stacked/tabbed mode. To do this and still allow
      * intuitive operations (like level-up and then opening a new window), we
@@ -1864,6 +2767,7 @@ void con_set_layout(Con *con, layout_t layout) {
             /* 1: create a new split container */
             Con *new = con_new(NULL, NULL);
             new->parent = con;
+            con_invalidate_lookups();
 
             /* 2: Set the requested layout on the split container and mark it as
              * split. */
@@ -1888,7 +2792,7 @@ void con_set_layout(Con *con, layout_t layout) {
             DLOG("Attaching new split to ws\n");
             con_attach(new, con, false);
 
-            tree_flatten(croot);
+            tree_flatten_candidates();
             con_force_split_parents_redraw(con);
             return;
         }
@@ -2027,15 +2931,12 @@ static void con_on_remove_child(Con *con) {
     if (con->type == CT_WORKSPACE) {
         if (TAILQ_EMPTY(&(con->focus_head)) && !workspace_is_visible(con)) {
             LOG("Closing old workspace (%p / %s), it is empty\n", con, con->name);
-            yajl_gen gen = ipc_marshal_workspace_event("empty", con, NULL);
+            ipc_prepared_event *event = ipc_prepare_workspace_event("empty", con, NULL);
             tree_close_internal(con, DONT_KILL_WINDOW, false);
 
-            const unsigned char *payload;
-            ylength length;
-            y(get_buf, &payload, &length);
-            ipc_send_event("workspace", I3_IPC_EVENT_WORKSPACE, (const char *)payload);
-
-            y(free);
+            if (event != NULL) {
+                ipc_send_prepared_event(event);
+            }
         }
         return;
     }
@@ -2174,19 +3075,10 @@ bool con_fullscreen_permits_focusing(Con *con) {
  *
  */
 bool con_has_urgent_child(Con *con) {
-    Con *child;
-
     if (con_is_leaf(con))
         return con->urgent;
 
-    /* We are not interested in floating windows since they can only be
-     * attached to a workspace → nodes_head instead of focus_head */
-    TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
-        if (con_has_urgent_child(child))
-            return true;
-    }
-
-    return false;
+    return (con->urgent_descendants > 0);
 }
 
 /*
@@ -2229,9 +3121,10 @@ void con_set_urgency(Con *con, bool urgent) {
     }
 
     const bool old_urgent = con->urgent;
+    con_set_dirty(con);
 
     if (con->urgency_timer == NULL) {
-        con->urgent = urgent;
+        con_set_urgent_flag(con, urgent);
     } else
         DLOG("Discarding urgency WM_HINT because timer is running\n");
 
@@ -2259,10 +3152,32 @@ void con_set_urgency(Con *con, bool urgent) {
 }
 
 /*
- * Create a string representing the subtree under con.
+ * Sets con->urgent and updates the number of urgent descendants of all
+ * parents. Only containers with a window count as urgent on their own, the
+ * urgency of split containers is inherited from their children. Unlike
+ * con_set_urgency(), this neither updates the urgency flags of the parents
+ * nor sends any events.
  *
  */
-char *con_get_tree_representation(Con *con) {
+void con_set_urgent_flag(Con *con, bool urgent) {
+    con->urgent = urgent;
+    const bool source = (urgent && con->window != NULL);
+    if (con->urgent_source != source) {
+        con->urgent_source = source;
+        con_add_urgent_descendants(con->parent, (source ? 1 : -1));
+    }
+}
+
+/*
+ * Returns the cached string representing the subtree under con, computing it
+ * first if necessary.
+ *
+ */
+static const char *con_tree_representation(Con *con) {
+    if (con->tree_representation != NULL) {
+        return con->tree_representation;
+    }
+
     /* this code works as follows:
      *  1) create a string with the layout type (D/V/H/T/S) and an opening bracket
      *  2) append the tree representation of the children to the string
@@ -2270,63 +3185,200 @@ char *con_get_tree_representation(Con *con) {
      *
      * The recursion ends when we hit a leaf, in which case we return the
      * class_instance of the contained window.
-     */
+     *
+     * The result is cached on every level, so unchanged subtrees are not
+     * visited again. */
 
     /* end of recursion */
     if (con_is_leaf(con)) {
         if (!con->window)
-            return sstrdup("nowin");
-
-        if (!con->window->class_instance)
-            return sstrdup("noinstance");
-
-        return sstrdup(con->window->class_instance);
+            con->tree_representation = sstrdup("nowin");
+        else if (!con->window->class_instance)
+            con->tree_representation = sstrdup("noinstance");
+        else
+            con->tree_representation = sstrdup(con->window->class_instance);
+        return con->tree_representation;
     }
 
-    char *buf;
-    /* 1) add the Layout type to buf */
+    /* 1) find the Layout type */
+    char prefix;
     if (con->layout == L_DEFAULT)
-        buf = sstrdup("D[");
+        prefix = 'D';
     else if (con->layout == L_SPLITV)
-        buf = sstrdup("V[");
+        prefix = 'V';
     else if (con->layout == L_SPLITH)
-        buf = sstrdup("H[");
+        prefix = 'H';
     else if (con->layout == L_TABBED)
-        buf = sstrdup("T[");
+        prefix = 'T';
     else if (con->layout == L_STACKED)
-        buf = sstrdup("S[");
+        prefix = 'S';
     else {
         ELOG("BUG: Code not updated to account for new layout type\n");
         assert(false);
     }
 
-    /* 2) append representation of children */
+    /* 2) compute the length of the children's representations, separated
+     * by spaces, so that the string is built in one buffer */
     Con *child;
+    size_t len = 3; /* layout type and brackets */
     TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
-        char *child_txt = con_get_tree_representation(child);
+        len += strlen(con_tree_representation(child)) +
+               (TAILQ_FIRST(&(con->nodes_head)) == child ? 0 : 1);
+    }
 
-        char *tmp_buf;
-        sasprintf(&tmp_buf, "%s%s%s", buf,
-                  (TAILQ_FIRST(&(con->nodes_head)) == child ? "" : " "), child_txt);
-        free(buf);
-        buf = tmp_buf;
-        free(child_txt);
+    char *buf = smalloc(len + 1);
+    char *pos = buf;
+    *pos++ = prefix;
+    *pos++ = '[';
+    TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
+        if (TAILQ_FIRST(&(con->nodes_head)) != child) {
+            *pos++ = ' ';
+        }
+        const char *child_txt = child->tree_representation;
+        const size_t child_len = strlen(child_txt);
+        memcpy(pos, child_txt, child_len);
+        pos += child_len;
     }
 
     /* 3) close the brackets */
-    char *complete_buf;
-    sasprintf(&complete_buf, "%s]", buf);
-    free(buf);
+    *pos++ = ']';
+    *pos = '\0';
+
+    con->tree_representation = buf;
+    return buf;
+}
 
-    return complete_buf;
+/*
+ * Create a string representing the subtree under con.
+ *
+ */
+char *con_get_tree_representation(Con *con) {
+    return sstrdup(con_tree_representation(con));
+}
+
+/*
+ * Invalidates the cached tree representation of the container and all of its
+ * parents.
+ *
+ */
+void con_invalidate_tree_representation(Con *con) {
+    for (; con != NULL; con = con->parent) {
+        FREE(con->tree_representation);
+    }
+}
+
+/* The placeholders supported by title_format. */
+enum {
+    TF_TITLE = 0,
+    TF_CLASS,
+    TF_INSTANCE,
+    TF_MACHINE,
+    TF_NUM_PLACEHOLDERS
+};
+
+static const char *title_format_placeholders[TF_NUM_PLACEHOLDERS] = {
+    [TF_TITLE] = "%title",
+    [TF_CLASS] = "%class",
+    [TF_INSTANCE] = "%instance",
+    [TF_MACHINE] = "%machine",
+};
+
+struct title_format_segment {
+    /* The placeholder to insert, or -1 for the literal text. */
+    int placeholder;
+    char *literal;
+};
+
+struct title_format_cache {
+    /* The title_format the segments were compiled from. */
+    char *format;
+    struct title_format_segment *segments;
+    int num_segments;
+    bool used[TF_NUM_PLACEHOLDERS];
+
+    /* The last title and the (unescaped) placeholder values and font type it
+     * was built from. */
+    char *values[TF_NUM_PLACEHOLDERS];
+    bool pango_markup;
+    i3String *result;
+};
+
+static void title_format_cache_free(struct title_format_cache *cache) {
+    if (cache == NULL) {
+        return;
+    }
+    for (int i = 0; i < cache->num_segments; i++) {
+        free(cache->segments[i].literal);
+    }
+    for (int i = 0; i < TF_NUM_PLACEHOLDERS; i++) {
+        free(cache->values[i]);
+    }
+    free(cache->segments);
+    free(cache->format);
+    I3STRING_FREE(cache->result);
+    free(cache);
+}
+
+/*
+ * Splits the title format into literal text and placeholders the same way
+ * format_placeholders() replaces them.
+ *
+ */
+static struct title_format_cache *title_format_compile(const char *format) {
+    struct title_format_cache *cache = scalloc(1, sizeof(struct title_format_cache));
+    cache->format = sstrdup(format);
+    /* There cannot be more segments than characters. */
+    cache->segments = scalloc(strlen(format) + 1, sizeof(struct title_format_segment));
+
+    const char *literal = format;
+    const char *walk = format;
+    while (*walk != '\0') {
+        int placeholder = -1;
+        for (int i = 0; i < TF_NUM_PLACEHOLDERS && *walk == '%'; i++) {
+            if (strncmp(walk, title_format_placeholders[i], strlen(title_format_placeholders[i])) == 0) {
+                placeholder = i;
+                break;
+            }
+        }
+        if (placeholder == -1) {
+            walk++;
+            continue;
+        }
+
+        if (walk > literal) {
+            cache->segments[cache->num_segments++] = (struct title_format_segment){
+                .placeholder = -1,
+                .literal = sstrndup(literal, walk - literal)};
+        }
+        cache->segments[cache->num_segments++] = (struct title_format_segment){
+            .placeholder = placeholder};
+        cache->used[placeholder] = true;
+        walk += strlen(title_format_placeholders[placeholder]);
+        literal = walk;
+    }
+    if (walk > literal) {
+        cache->segments[cache->num_segments++] = (struct title_format_segment){
+            .placeholder = -1,
+            .literal = sstrndup(literal, walk - literal)};
+    }
+    return cache;
 }
 
 /*
  * Returns the container's title considering the current title format.
  *
+ * The format is compiled once and the title is only built again when one of
+ * the placeholder values it uses changed.
+ *
  */
 i3String *con_parse_title_format(Con *con) {
-    assert(con->title_format != NULL);
+    assert(con->cold->title_format != NULL);
+
+    struct title_format_cache *cache = con->cold->title_format_cache;
+    if (cache == NULL || strcmp(cache->format, con->cold->title_format) != 0) {
+        title_format_cache_free(cache);
+        cache = con->cold->title_format_cache = title_format_compile(con->cold->title_format);
+    }
 
     i3Window *win = con->window;
 
@@ -2334,40 +3386,63 @@ i3String *con_parse_title_format(Con *con) {
      * is used by the current font. */
     const bool pango_markup = font_is_pango();
 
-    char *title;
-    char *class;
-    char *instance;
-    char *machine;
+    const char *values[TF_NUM_PLACEHOLDERS];
     if (win == NULL) {
-        title = pango_escape_markup(con_get_tree_representation(con));
-        class = sstrdup("i3-frame");
-        instance = sstrdup("i3-frame");
-        machine = sstrdup("");
+        values[TF_TITLE] = con_tree_representation(con);
+        values[TF_CLASS] = "i3-frame";
+        values[TF_INSTANCE] = "i3-frame";
+        values[TF_MACHINE] = "";
     } else {
-        title = pango_escape_markup(sstrdup((win->name == NULL) ? "" : i3string_as_utf8(win->name)));
-        class = pango_escape_markup(sstrdup((win->class_class == NULL) ? "" : win->class_class));
-        instance = pango_escape_markup(sstrdup((win->class_instance == NULL) ? "" : win->class_instance));
-        machine = pango_escape_markup(sstrdup((win->machine == NULL) ? "" : win->machine));
+        values[TF_TITLE] = (win->name == NULL) ? "" : i3string_as_utf8(win->name);
+        values[TF_CLASS] = (win->class_class == NULL) ? "" : win->class_class;
+        values[TF_INSTANCE] = (win->class_instance == NULL) ? "" : win->class_instance;
+        values[TF_MACHINE] = (win->machine == NULL) ? "" : win->machine;
     }
 
-    placeholder_t placeholders[] = {
-        {.name = "%title", .value = title},
-        {.name = "%class", .value = class},
-        {.name = "%instance", .value = instance},
-        {.name = "%machine", .value = machine},
-    };
-    const size_t num = sizeof(placeholders) / sizeof(placeholder_t);
+    bool changed = (cache->result == NULL || cache->pango_markup != pango_markup);
+    for (int i = 0; i < TF_NUM_PLACEHOLDERS && !changed; i++) {
+        changed = (cache->used[i] && strcmp(cache->values[i], values[i]) != 0);
+    }
+    if (!changed) {
+        return i3string_copy(cache->result);
+    }
 
-    char *formatted_str = format_placeholders(con->title_format, &placeholders[0], num);
-    i3String *formatted = i3string_from_utf8(formatted_str);
-    i3string_set_markup(formatted, pango_markup);
+    char *escaped[TF_NUM_PLACEHOLDERS] = {NULL};
+    for (int i = 0; i < TF_NUM_PLACEHOLDERS; i++) {
+        FREE(cache->values[i]);
+        if (cache->used[i]) {
+            cache->values[i] = sstrdup(values[i]);
+            escaped[i] = pango_escape_markup(sstrdup(values[i]));
+        }
+    }
+
+    size_t len = 1;
+    for (int i = 0; i < cache->num_segments; i++) {
+        const struct title_format_segment *segment = &(cache->segments[i]);
+        len += strlen(segment->placeholder == -1 ? segment->literal : escaped[segment->placeholder]);
+    }
+    char *formatted_str = smalloc(len);
+    char *pos = formatted_str;
+    for (int i = 0; i < cache->num_segments; i++) {
+        const struct title_format_segment *segment = &(cache->segments[i]);
+        const char *text = (segment->placeholder == -1 ? segment->literal : escaped[segment->placeholder]);
+        const size_t text_len = strlen(text);
+        memcpy(pos, text, text_len);
+        pos += text_len;
+    }
+    *pos = '\0';
+
+    I3STRING_FREE(cache->result);
+    cache->result = i3string_from_utf8(formatted_str);
+    i3string_set_markup(cache->result, pango_markup);
+    cache->pango_markup = pango_markup;
 
     free(formatted_str);
-    free(title);
-    free(class);
-    free(instance);
+    for (int i = 0; i < TF_NUM_PLACEHOLDERS; i++) {
+        free(escaped[i]);
+    }
 
-    return formatted;
+    return i3string_copy(cache->result);
 }
 
 /*
@@ -2440,6 +3515,7 @@ bool con_swap(Con *first, Con *second) {
     SWAP_CONS_IN_TREE(nodes_head, nodes);
     SWAP_CONS_IN_TREE(focus_head, focused);
     SWAP(first->parent, second->parent, Con *);
+    con_invalidate_lookups();
 
     /* Floating nodes are children of CT_FLOATING_CONs, they are listed in
      * nodes_head and focus_head like all other containers. Thus, we don't need
@@ -2481,8 +3557,8 @@ bool con_swap(Con *first, Con *second) {
     con_fix_percent(first->parent);
     con_fix_percent(second->parent);
 
-    FREE(first->deco_render_params);
-    FREE(second->deco_render_params);
+    FREE(first->cold->deco_render_params);
+    FREE(second->cold->deco_render_params);
     con_force_split_parents_redraw(first);
     con_force_split_parents_redraw(second);
 
@@ -2505,32 +3581,35 @@ uint32_t con_rect_size_in_orientation(Con *con) {
  *
  */
 void con_merge_into(Con *old, Con *new) {
+    con_unindex_window(old);
     new->window = old->window;
     old->window = NULL;
+    con_index_window(new);
+    con_invalidate_tree_representation(new);
 
-    if (old->title_format) {
-        FREE(new->title_format);
-        new->title_format = old->title_format;
-        old->title_format = NULL;
+    if (old->cold->title_format) {
+        FREE(new->cold->title_format);
+        new->cold->title_format = old->cold->title_format;
+        old->cold->title_format = NULL;
     }
 
-    if (old->sticky_group) {
-        FREE(new->sticky_group);
-        new->sticky_group = old->sticky_group;
-        old->sticky_group = NULL;
+    if (old->cold->sticky_group) {
+        con_set_sticky_group(new, old->cold->sticky_group);
+        con_set_sticky_group(old, NULL);
     }
 
-    new->sticky = old->sticky;
+    con_set_sticky(new, old->sticky);
 
     con_set_urgency(new, old->urgent);
 
     mark_t *mark;
-    TAILQ_FOREACH (mark, &(old->marks_head), marks) {
-        TAILQ_INSERT_TAIL(&(new->marks_head), mark, marks);
+    TAILQ_FOREACH (mark, &(old->cold->marks_head), marks) {
+        TAILQ_INSERT_TAIL(&(new->cold->marks_head), mark, marks);
+        hashmap_insert_str(cons_by_mark, mark->name, new);
         ipc_send_window_event("mark", new);
     }
-    new->mark_changed = (TAILQ_FIRST(&(old->marks_head)) != NULL);
-    TAILQ_INIT(&(old->marks_head));
+    new->cold->mark_changed = (TAILQ_FIRST(&(old->cold->marks_head)) != NULL);
+    TAILQ_INIT(&(old->cold->marks_head));
 
     tree_close_internal(old, DONT_KILL_WINDOW, false);
 }
@@ -23,12 +23,39 @@ struct includedfiles_head included_files = TAILQ_HEAD_INITIALIZER(included_files
 
 /*
  * Ungrabs all keys, to be called before re-grabbing the keys because of a
- * mapping_notify event or a configuration file reload
+ * mapping_notify event
  *
  */
 void ungrab_all_keys(xcb_connection_t *conn) {
     DLOG("Ungrabbing all keys\n");
     xcb_ungrab_key(conn, XCB_GRAB_ANY, root, XCB_BUTTON_MASK_ANY);
+    forget_key_grabs();
+}
+
+/* The font of the configuration which is being reloaded, see load_config_font(). */
+static i3Font previous_font;
+
+/*
+ * Loads the font with the given pattern for the configuration. When
+ * reloading, the font of the previous configuration is reused if the pattern
+ * did not change.
+ *
+ * The font is loaded asynchronously, load_configuration() (or main() on
+ * startup, see finish_font_loading()) waits for it.
+ *
+ */
+i3Font load_config_font(const char *pattern) {
+    if (previous_font.pattern != NULL && strcmp(previous_font.pattern, pattern) == 0) {
+        DLOG("Font \"%s\" did not change, not loading it again\n", pattern);
+        i3Font font = previous_font;
+        previous_font = (i3Font){.type = FONT_TYPE_NONE};
+        return font;
+    }
+
+    /* load_font_async() frees the current font, which is the previous one. */
+    i3Font font = load_font_async(pattern, true);
+    previous_font = (i3Font){.type = FONT_TYPE_NONE};
+    return font;
 }
 
 static void free_configuration(void) {
@@ -39,8 +66,8 @@ static void free_configuration(void) {
      * after parsing the config again. See #2228. */
     switch_mode("default");
 
-    /* First ungrab the keys */
-    ungrab_all_keys(conn);
+    /* The keys are not ungrabbed here: grab_all_keys() only sends the
+     * differences once the new bindings are known. */
 
     struct Mode *mode;
     while (!SLIST_EMPTY(&modes)) {
@@ -79,6 +106,7 @@ static void free_configuration(void) {
         TAILQ_REMOVE(&ws_assignments, assign, ws_assignments);
         FREE(assign);
     }
+    workspace_assignments_changed();
 
     /* Clear bar configs */
     Barconfig *barconfig;
@@ -140,11 +168,13 @@ static void free_configuration(void) {
             FREE(con->window->ran_assignments);
         }
         /* Invalidate pixmap caches in case font or colors changed. */
-        FREE(con->deco_render_params);
+        FREE(con->cold->deco_render_params);
     }
 
-    /* Get rid of the current font */
-    free_font();
+    /* Keep the current font until the new config was parsed, it is only
+     * freed if the new config uses a different one. */
+    previous_font = config.font;
+    set_font(&previous_font);
 
     free(config.ipc_socket_path);
     free(config.restart_state_path);
@@ -164,7 +194,9 @@ static void free_configuration(void) {
  *
  */
 bool load_configuration(const char *override_configpath, config_load_t load_type) {
+    int *old_buttons = NULL;
     if (load_type == C_RELOAD) {
+        old_buttons = bindings_get_buttons_to_grab_in_all_modes();
         free_configuration();
     }
 
@@ -258,31 +290,57 @@ bool load_configuration(const char *override_configpath, config_load_t load_type
         .stack = &stack,
     };
     SLIST_INIT(&(ctx.variables));
+    const uint64_t parse_start = stats_now();
     const int result = parse_file(&ctx, resolved_path, file);
+    stats_record_duration(STATS_PARSE_FILE, parse_start);
     free_variables(&ctx);
+    free_resource_database();
     if (result == -1) {
         die("Could not open configuration file: %s\n", strerror(errno));
     }
 
     extract_workspace_names_from_bindings();
+    assign_binding_ids();
+    const uint64_t reorder_start = stats_now();
     reorder_bindings();
+    stats_record_duration(STATS_REORDER_BINDINGS, reorder_start);
+    compile_assignments();
 
     if (config.font.type == FONT_TYPE_NONE && load_type != C_VALIDATE) {
         ELOG("You did not specify required configuration option \"font\"\n");
-        config.font = load_font("fixed", true);
+        config.font = load_config_font("fixed");
         set_font(&config.font);
     }
 
     if (load_type == C_RELOAD) {
+        const uint64_t translate_start = stats_now();
         translate_keysyms();
+        stats_record_duration(STATS_TRANSLATE_KEYSYMS, translate_start);
         grab_all_keys(conn);
-        regrab_all_buttons(conn);
+
+        int *new_buttons = bindings_get_buttons_to_grab();
+        if (old_buttons != NULL && bindings_buttons_equal(old_buttons, new_buttons)) {
+            DLOG("Grabbed buttons did not change, not regrabbing them\n");
+        } else {
+            regrab_all_buttons(conn, old_buttons);
+        }
+        free(new_buttons);
+
+        finish_font_loading(&config.font);
+
+        /* The font (and thus the decoration height) may have changed, so
+         * every container needs to be laid out again. */
+        con_set_all_dirty();
+        window_icons_rescale();
+        tree_shm_configure();
+        raw_pointer_configure();
 
         /* Redraw the currently visible decorations on reload, so that the
          * possibly new drawing parameters changed. */
         x_deco_recurse(croot);
         xcb_flush(conn);
     }
+    free(old_buttons);
 
     return result == 0;
 }
@@ -168,7 +168,7 @@ i3_event_state_mask_t event_state_from_str(const char *str) {
 static char *font_pattern;
 
 CFGFUN(font, const char *font) {
-    config.font = load_font(font, true);
+    config.font = load_config_font(font);
     set_font(&config.font);
 
     /* Save the font pattern for using it as bar font later on */
@@ -317,7 +317,8 @@ CFGFUN(hide_edge_borders, const char *borders) {
 }
 
 CFGFUN(focus_follows_mouse, const char *value) {
-    config.disable_focus_follows_mouse = !boolstr(value);
+    config.focus_follows_mouse_raw = (strcasecmp(value, "raw") == 0);
+    config.disable_focus_follows_mouse = (!config.focus_follows_mouse_raw && !boolstr(value));
 }
 
 CFGFUN(mouse_warping, const char *value) {
@@ -406,6 +407,14 @@ CFGFUN(show_marks, const char *value) {
     config.show_marks = boolstr(value);
 }
 
+CFGFUN(live_resize, const char *value) {
+    config.live_resize = boolstr(value);
+}
+
+CFGFUN(tab_min_width, const long width) {
+    config.tab_min_width = logical_px(width);
+}
+
 static char *current_workspace = NULL;
 
 CFGFUN(workspace, const char *workspace, const char *output) {
@@ -441,6 +450,7 @@ CFGFUN(workspace, const char *workspace, const char *output) {
     assignment->name = sstrdup(workspace);
     assignment->output = sstrdup(output);
     TAILQ_INSERT_TAIL(&ws_assignments, assignment, ws_assignments);
+    workspace_assignments_changed();
 }
 
 CFGFUN(ipc_socket, const char *path) {
@@ -509,7 +519,7 @@ CFGFUN(assign_output, const char *output) {
         return;
     }
 
-    if (current_match->window_mode != WM_ANY) {
+    if (match_get(current_match, CRIT_WINDOW_MODE) != NULL) {
         ELOG("Assignments using window mode (floating/tiling) is not supported\n");
         return;
     }
@@ -528,7 +538,7 @@ CFGFUN(assign, const char *workspace, bool is_number) {
         return;
     }
 
-    if (current_match->window_mode != WM_ANY) {
+    if (match_get(current_match, CRIT_WINDOW_MODE) != NULL) {
         ELOG("Assignments using window mode (floating/tiling) is not supported\n");
         return;
     }
@@ -563,6 +573,26 @@ CFGFUN(ipc_kill_timeout, const long timeout_ms) {
     ipc_set_kill_timeout(timeout_ms / 1000.0);
 }
 
+CFGFUN(ipc_queue_limit, const long limit) {
+    ipc_set_queue_limit(limit);
+}
+
+CFGFUN(ipc_coalesce_events, const char *event, const long interval_ms) {
+    if (strcmp(event, "window::title") == 0) {
+        config.ipc_coalesce_title = interval_ms / 1000.0;
+    } else {
+        config.ipc_coalesce_mark = interval_ms / 1000.0;
+    }
+}
+
+CFGFUN(tree_shm_size, const long size) {
+    config.tree_shm_size = size;
+}
+
+CFGFUN(drag_refresh_rate, const long rate) {
+    config.drag_refresh_rate = rate;
+}
+
 /*******************************************************************************
  * Bar configuration (i3bar)
  ******************************************************************************/
@@ -730,6 +760,10 @@ CFGFUN(bar_workspace_min_width, const long width) {
     current_bar->workspace_min_width = width;
 }
 
+CFGFUN(bar_status_update_interval, const long interval) {
+    current_bar->status_update_interval = interval;
+}
+
 CFGFUN(bar_strip_workspace_numbers, const char *value) {
     current_bar->strip_workspace_numbers = boolstr(value);
 }
@@ -25,6 +25,7 @@
  */
 #include "all.h"
 
+#include <ctype.h>
 #include <fcntl.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -39,7 +40,17 @@
 
 #include <xcb/xcb_xrm.h>
 
-xcb_xrm_database_t *database = NULL;
+/* The resource database for set_from_resource. If it was parsed from the
+ * RESOURCE_MANAGER property, it is kept (with the property contents) across
+ * reloads until the property changes, see resource_database_changed(). The
+ * resources looked up in it are cached by name. */
+static xcb_xrm_database_t *database = NULL;
+static char *database_contents = NULL;
+static bool database_stale = true;
+static hashmap_t *resources = NULL;
+
+/* Cached for resources which are not in the database. */
+static char resource_missing[] = "";
 
 #ifndef TEST_PARSER
 pid_t config_error_nagbar_pid = -1;
@@ -63,6 +74,9 @@ typedef struct token {
     union {
         uint16_t call_identifier;
     } extra;
+    cmdp_token_type type;
+    /* For literals: the length of the name, without the leading quote. */
+    uint16_t length;
 } cmdp_token;
 
 typedef struct tokenptr {
@@ -268,17 +282,19 @@ static void parse_config(struct parser_ctx *ctx, const char *input, struct conte
             walk++;
 
         cmdp_token_ptr *ptr = &(tokens[ctx->state]);
+        const uint8_t *candidates;
+        const int num_candidates = GENERATED_candidates(ctx->state, *walk, &candidates);
         token_handled = false;
-        for (c = 0; c < ptr->n; c++) {
-            token = &(ptr->array[c]);
+        for (c = 0; c < num_candidates; c++) {
+            token = &(ptr->array[candidates[c]]);
 
             /* A literal. */
-            if (token->name[0] == '\'') {
-                if (strncasecmp(walk, token->name + 1, strlen(token->name) - 1) == 0) {
+            if (token->type == TOKEN_LITERAL) {
+                if (strncasecmp(walk, token->name + 1, token->length) == 0) {
                     if (token->identifier != NULL) {
                         push_string(ctx->stack, token->identifier, token->name + 1);
                     }
-                    walk += strlen(token->name) - 1;
+                    walk += token->length;
                     next_state(token, ctx);
                     token_handled = true;
                     break;
@@ -286,7 +302,7 @@ static void parse_config(struct parser_ctx *ctx, const char *input, struct conte
                 continue;
             }
 
-            if (strcmp(token->name, "number") == 0) {
+            if (token->type == TOKEN_NUMBER) {
                 /* Handle numbers. We only accept decimal numbers for now. */
                 char *end = NULL;
                 errno = 0;
@@ -310,8 +326,7 @@ static void parse_config(struct parser_ctx *ctx, const char *input, struct conte
                 break;
             }
 
-            if (strcmp(token->name, "string") == 0 ||
-                strcmp(token->name, "word") == 0) {
+            if (token->type == TOKEN_STRING || token->type == TOKEN_WORD) {
                 const char *beginning = walk;
                 /* Handle quoted strings (or words). */
                 if (*walk == '"') {
@@ -320,7 +335,7 @@ static void parse_config(struct parser_ctx *ctx, const char *input, struct conte
                     while (*walk != '\0' && (*walk != '"' || *(walk - 1) == '\\'))
                         walk++;
                 } else {
-                    if (token->name[0] == 's') {
+                    if (token->type == TOKEN_STRING) {
                         while (*walk != '\0' && *walk != '\r' && *walk != '\n')
                             walk++;
                     } else {
@@ -362,7 +377,7 @@ static void parse_config(struct parser_ctx *ctx, const char *input, struct conte
                 }
             }
 
-            if (strcmp(token->name, "line") == 0) {
+            if (token->type == TOKEN_LINE) {
                 while (*walk != '\0' && *walk != '\n' && *walk != '\r')
                     walk++;
                 next_state(token, ctx);
@@ -372,7 +387,7 @@ static void parse_config(struct parser_ctx *ctx, const char *input, struct conte
                 break;
             }
 
-            if (strcmp(token->name, "end") == 0) {
+            if (token->type == TOKEN_END) {
                 if (*walk == '\0' || *walk == '\n' || *walk == '\r') {
                     next_state(token, ctx);
                     token_handled = true;
@@ -508,6 +523,199 @@ static void parse_config(struct parser_ctx *ctx, const char *input, struct conte
     }
 }
 
+/*******************************************************************************
+ * Variables (set and set_from_resource).
+ ******************************************************************************/
+
+/*
+ * Inserts or updates a variable assignment depending on whether it already exists.
+ *
+ */
+static void upsert_variable(struct variables_head *variables, char *key, char *value) {
+    struct Variable *current;
+    SLIST_FOREACH (current, variables, variables) {
+        if (strcmp(current->key, key) != 0) {
+            continue;
+        }
+
+        DLOG("Updated variable: %s = %s -> %s\n", key, current->value, value);
+        FREE(current->value);
+        current->value = sstrdup(value);
+        return;
+    }
+
+    DLOG("Defined new variable: %s = %s\n", key, value);
+    struct Variable *new = scalloc(1, sizeof(struct Variable));
+    struct Variable *test = NULL, *loc = NULL;
+    new->key = sstrdup(key);
+    new->value = sstrdup(value);
+    /* ensure that the correct variable is matched in case of one being
+     * the prefix of another */
+    SLIST_FOREACH (test, variables, variables) {
+        if (strlen(new->key) >= strlen(test->key))
+            break;
+        loc = test;
+    }
+
+    if (loc == NULL) {
+        SLIST_INSERT_HEAD(variables, new, variables);
+    } else {
+        SLIST_INSERT_AFTER(loc, new, variables);
+    }
+}
+
+/*
+ * Maps the lower-cased variable names to their variables, so that each '$'
+ * in the configuration is resolved with one hash lookup per distinct name
+ * length instead of one comparison per variable.
+ *
+ */
+struct variable_index {
+    hashmap_t *by_name;
+    /* The distinct name lengths, longest first. */
+    size_t *lengths;
+    size_t num_lengths;
+    /* Holds the lower-cased candidate name. */
+    char *scratch;
+};
+
+static void variable_index_init(struct variable_index *index, struct variables_head *variables) {
+    index->by_name = hashmap_new();
+    index->lengths = NULL;
+    index->num_lengths = 0;
+
+    size_t num_variables = 0;
+    struct Variable *current;
+    SLIST_FOREACH (current, variables, variables) {
+        num_variables++;
+    }
+    index->lengths = smalloc((num_variables + 1) * sizeof(size_t));
+    /* The variables are sorted by descending name length. */
+    const size_t max_length = (SLIST_EMPTY(variables) ? 0 : strlen(SLIST_FIRST(variables)->key));
+    index->scratch = smalloc(max_length + 1);
+
+    SLIST_FOREACH (current, variables, variables) {
+        const size_t length = strlen(current->key);
+        if (length == 0) {
+            continue;
+        }
+        for (size_t i = 0; i < length; i++) {
+            index->scratch[i] = tolower((unsigned char)current->key[i]);
+        }
+        index->scratch[length] = '\0';
+        /* Names only differing in case match the same text. Like with the
+         * list, the first one wins. */
+        if (hashmap_lookup_str(index->by_name, index->scratch) == NULL) {
+            hashmap_insert_str(index->by_name, index->scratch, current);
+        }
+        if (index->num_lengths == 0 || index->lengths[index->num_lengths - 1] != length) {
+            index->lengths[index->num_lengths++] = length;
+        }
+    }
+}
+
+static void variable_index_free(struct variable_index *index) {
+    hashmap_free(index->by_name);
+    FREE(index->lengths);
+    FREE(index->scratch);
+}
+
+/*
+ * Returns the variable whose name starts at the given position, if any. The
+ * longest name wins when one name is a prefix of another.
+ *
+ */
+static struct Variable *variable_at(struct variable_index *index, const char *pos) {
+    if (index->num_lengths == 0) {
+        return NULL;
+    }
+
+    size_t available = 0;
+    while (available < index->lengths[0] && pos[available] != '\0') {
+        index->scratch[available] = tolower((unsigned char)pos[available]);
+        available++;
+    }
+
+    for (size_t i = 0; i < index->num_lengths; i++) {
+        const size_t length = index->lengths[i];
+        if (length > available) {
+            continue;
+        }
+        const char saved = index->scratch[length];
+        index->scratch[length] = '\0';
+        struct Variable *current = hashmap_lookup_str(index->by_name, index->scratch);
+        index->scratch[length] = saved;
+        if (current != NULL) {
+            return current;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Returns a copy of buf in which all variables are replaced by their values.
+ * Variable names always start with a '$', so only those positions need to be
+ * checked and the file is scanned once instead of once per variable and
+ * occurrence.
+ *
+ */
+static char *replace_variables(struct variables_head *variables, const char *buf) {
+    struct variable_index index;
+    variable_index_init(&index, variables);
+
+    /* First, calculate the size of the result. */
+    size_t size = strlen(buf);
+    const char *walk = strchr(buf, '$');
+    while (walk != NULL) {
+        struct Variable *current = variable_at(&index, walk);
+        if (current == NULL) {
+            walk = strchr(walk + 1, '$');
+            continue;
+        }
+        size = size - strlen(current->key) + strlen(current->value);
+        walk = strchr(walk + strlen(current->key), '$');
+    }
+
+    /* Then, copy the buffer and replace the variables. */
+    char *new = smalloc(size + 1);
+    char *destwalk = new;
+    const char *copied = buf;
+    walk = strchr(buf, '$');
+    while (walk != NULL) {
+        struct Variable *current = variable_at(&index, walk);
+        if (current == NULL) {
+            walk = strchr(walk + 1, '$');
+            continue;
+        }
+        memcpy(destwalk, copied, walk - copied);
+        destwalk += walk - copied;
+        const size_t value_len = strlen(current->value);
+        memcpy(destwalk, current->value, value_len);
+        destwalk += value_len;
+        copied = walk + strlen(current->key);
+        walk = strchr(copied, '$');
+    }
+    strcpy(destwalk, copied);
+
+    variable_index_free(&index);
+    return new;
+}
+
+/*
+ * Releases the memory of all variables in ctx.
+ *
+ */
+void free_variables(struct parser_ctx *ctx) {
+    struct Variable *current;
+    while (!SLIST_EMPTY(&(ctx->variables))) {
+        current = SLIST_FIRST(&(ctx->variables));
+        FREE(current->key);
+        FREE(current->value);
+        SLIST_REMOVE_HEAD(&(ctx->variables), variables);
+        FREE(current);
+    }
+}
+
 /*******************************************************************************
  * Code for building the stand-alone binary test.commands_parser which is used
  * by t/187-commands-parser.t.
@@ -515,6 +723,19 @@ static void parse_config(struct parser_ctx *ctx, const char *input, struct conte
 
 #ifdef TEST_PARSER
 
+/* Set with --benchmark, which discards all output. */
+static bool benchmarking = false;
+
+/* The log macros (see log.h) check these before calling debuglog() and
+ * verboselog(). */
+bool log_debug_active = true;
+bool log_verbose_active = true;
+bool log_filter_active = false;
+
+bool log_file_enabled(const char *file) {
+    return true;
+}
+
 /*
  * Logs the given message to stdout while prefixing the current time to it,
  * but only if debug logging was activated.
@@ -524,6 +745,9 @@ static void parse_config(struct parser_ctx *ctx, const char *input, struct conte
 void debuglog(char *fmt, ...) {
     va_list args;
 
+    if (benchmarking)
+        return;
+
     va_start(args, fmt);
     fprintf(stdout, "# ");
     vfprintf(stdout, fmt, args);
@@ -533,6 +757,9 @@ void debuglog(char *fmt, ...) {
 void errorlog(char *fmt, ...) {
     va_list args;
 
+    if (benchmarking)
+        return;
+
     va_start(args, fmt);
     vfprintf(stderr, fmt, args);
     va_end(args);
@@ -551,11 +778,7 @@ void cfg_criteria_pop_state(I3_CFG) {
     result->next_state = criteria_next_state;
 }
 
-int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        fprintf(stderr, "Syntax: %s <command>\n", argv[0]);
-        return 1;
-    }
+static void parse_test_config(const char *input) {
     struct stack stack;
     memset(&stack, '\0', sizeof(struct stack));
     struct parser_ctx ctx = {
@@ -566,7 +789,123 @@ int main(int argc, char *argv[]) {
     SLIST_INIT(&(ctx.variables));
     struct context context;
     context.filename = "<stdin>";
-    parse_config(&ctx, argv[1], &context);
+    parse_config(&ctx, input, &context);
+}
+
+/*
+ * Parses the configuration file the given number of times with all output
+ * discarded and prints the average time per parse (used by “meson test
+ * --benchmark”).
+ *
+ */
+static int benchmark(const char *iterations_str, const char *path) {
+    const long iterations = strtol(iterations_str, NULL, 10);
+    if (iterations <= 0) {
+        fprintf(stderr, "Invalid number of iterations: %s\n", iterations_str);
+        return 1;
+    }
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        return 1;
+    }
+    char *input = NULL;
+    size_t input_size = 0;
+    if (getdelim(&input, &input_size, '\0', file) == -1) {
+        perror(path);
+        fclose(file);
+        return 1;
+    }
+    fclose(file);
+
+    /* The calls are printed to stderr in TEST_PARSER builds. */
+    FILE *out = fdopen(dup(STDERR_FILENO), "w");
+    if (out == NULL || freopen("/dev/null", "w", stderr) == NULL) {
+        perror("Could not redirect stderr");
+        return 1;
+    }
+    benchmarking = true;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        parse_test_config(input);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    const double elapsed = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    fprintf(out, "%ld iterations, %.0f ns per configuration\n", iterations, elapsed / iterations);
+    fclose(out);
+    free(input);
+    return 0;
+}
+
+/*
+ * Replaces the variables in a generated configuration with the given number
+ * of variables and lines the given number of times and prints the average
+ * time per configuration (used by “meson test --benchmark”).
+ *
+ */
+static int benchmark_variables(const char *iterations_str, const char *variables_str, const char *lines_str) {
+    const long iterations = strtol(iterations_str, NULL, 10);
+    const long num_variables = strtol(variables_str, NULL, 10);
+    const long num_lines = strtol(lines_str, NULL, 10);
+    if (iterations <= 0 || num_variables <= 0 || num_lines <= 0) {
+        fprintf(stderr, "Invalid benchmark parameters: %s %s %s\n", iterations_str, variables_str, lines_str);
+        return 1;
+    }
+    benchmarking = true;
+
+    struct parser_ctx ctx;
+    memset(&ctx, '\0', sizeof(struct parser_ctx));
+    SLIST_INIT(&(ctx.variables));
+    for (long i = 0; i < num_variables; i++) {
+        char *key, *value;
+        sasprintf(&key, "$variable_%ld", i);
+        sasprintf(&value, "value of variable %ld", i);
+        upsert_variable(&(ctx.variables), key, value);
+        free(key);
+        free(value);
+    }
+
+    /* Every line uses two variables and contains a '$' which is not part of
+     * any variable name. */
+    const size_t line_length = 128;
+    char *input = smalloc(num_lines * line_length + 1);
+    char *walk = input;
+    for (long i = 0; i < num_lines; i++) {
+        walk += snprintf(walk, line_length, "bindsym $Variable_%ld+%ld exec --no-startup-id echo $5 $variable_%ld\n",
+                         i % num_variables, i, (i * 7) % num_variables);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        free(replace_variables(&(ctx.variables), input));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    const double elapsed = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    fprintf(stderr, "%ld iterations, %.0f ns per configuration\n", iterations, elapsed / iterations);
+
+    free_variables(&ctx);
+    free(input);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 4 && strcmp(argv[1], "--benchmark") == 0) {
+        return benchmark(argv[2], argv[3]);
+    }
+    if (argc == 5 && strcmp(argv[1], "--benchmark-variables") == 0) {
+        return benchmark_variables(argv[2], argv[3], argv[4]);
+    }
+    if (argc < 2) {
+        fprintf(stderr, "Syntax: %s <config> | --benchmark <iterations> <file> | --benchmark-variables <iterations> <variables> <lines>\n", argv[0]);
+        return 1;
+    }
+    parse_test_config(argv[1]);
 }
 
 #else
@@ -768,40 +1107,63 @@ void start_config_error_nagbar(const char *configpath, bool has_errors) {
     free(pageraction);
 }
 
+static void free_cached_resource(void *value, void *userdata) {
+    if (value != resource_missing) {
+        free(value);
+    }
+}
+
+static void drop_resource_database(void) {
+    if (database != NULL) {
+        xcb_xrm_database_free(database);
+        database = NULL;
+    }
+    FREE(database_contents);
+    if (resources != NULL) {
+        hashmap_foreach(resources, free_cached_resource, NULL);
+        hashmap_clear(resources);
+    }
+}
+
 /*
- * Inserts or updates a variable assignment depending on whether it already exists.
+ * Loads the resource database from the RESOURCE_MANAGER property, unless its
+ * contents did not change, or from the default locations if it is not set.
  *
  */
-static void upsert_variable(struct variables_head *variables, char *key, char *value) {
-    struct Variable *current;
-    SLIST_FOREACH (current, variables, variables) {
-        if (strcmp(current->key, key) != 0) {
-            continue;
-        }
+static void load_resource_database(void) {
+    database_stale = false;
+
+    xcb_get_property_cookie_t cookie = xcb_get_property(conn, 0, root, XCB_ATOM_RESOURCE_MANAGER,
+                                                        XCB_ATOM_STRING, 0, UINT32_MAX);
+    xcb_get_property_reply_t *reply = xcb_get_property_reply(conn, cookie, NULL);
+    char *contents = NULL;
+    if (reply != NULL && xcb_get_property_value_length(reply) > 0) {
+        sasprintf(&contents, "%.*s", xcb_get_property_value_length(reply),
+                  (char *)xcb_get_property_value(reply));
+    }
+    FREE(reply);
 
-        DLOG("Updated variable: %s = %s -> %s\n", key, current->value, value);
-        FREE(current->value);
-        current->value = sstrdup(value);
+    if (contents != NULL && database != NULL &&
+        database_contents != NULL && strcmp(contents, database_contents) == 0) {
+        DLOG("RESOURCE_MANAGER did not change, keeping the resource database.\n");
+        free(contents);
         return;
     }
 
-    DLOG("Defined new variable: %s = %s\n", key, value);
-    struct Variable *new = scalloc(1, sizeof(struct Variable));
-    struct Variable *test = NULL, *loc = NULL;
-    new->key = sstrdup(key);
-    new->value = sstrdup(value);
-    /* ensure that the correct variable is matched in case of one being
-     * the prefix of another */
-    SLIST_FOREACH (test, variables, variables) {
-        if (strlen(new->key) >= strlen(test->key))
-            break;
-        loc = test;
+    drop_resource_database();
+    if (contents != NULL) {
+        database = xcb_xrm_database_from_string(contents);
+        database_contents = contents;
+    } else {
+        database = xcb_xrm_database_from_default(conn);
     }
 
-    if (loc == NULL) {
-        SLIST_INSERT_HEAD(variables, new, variables);
-    } else {
-        SLIST_INSERT_AFTER(loc, new, variables);
+    if (database == NULL) {
+        ELOG("Failed to open the resource database.\n");
+
+        /* Load an empty database so we don't keep trying to load the
+         * default database over and over again. */
+        database = xcb_xrm_database_from_string("");
     }
 }
 
@@ -811,40 +1173,48 @@ static char *get_resource(char *name) {
     }
 
     /* Load the resource database lazily. */
-    if (database == NULL) {
-        database = xcb_xrm_database_from_default(conn);
-
-        if (database == NULL) {
-            ELOG("Failed to open the resource database.\n");
-
-            /* Load an empty database so we don't keep trying to load the
-             * default database over and over again. */
-            database = xcb_xrm_database_from_string("");
+    if (database == NULL || database_stale) {
+        load_resource_database();
+    }
 
-            return NULL;
+    if (resources == NULL) {
+        resources = hashmap_new();
+    }
+    char *resource = hashmap_lookup_str(resources, name);
+    if (resource == NULL) {
+        xcb_xrm_resource_get_string(database, name, NULL, &resource);
+        if (resource == NULL) {
+            resource = resource_missing;
         }
+        hashmap_insert_str(resources, name, resource);
     }
-
-    char *resource;
-    xcb_xrm_resource_get_string(database, name, NULL, &resource);
-    return resource;
+    return (resource != resource_missing ? sstrdup(resource) : NULL);
 }
 
 /*
- * Releases the memory of all variables in ctx.
+ * Called after the main config file and all included files are parsed. The
+ * resource database is kept if it was parsed from the RESOURCE_MANAGER
+ * property. Otherwise, it was loaded from files which may change until the
+ * next reload, so it is freed.
  *
  */
-void free_variables(struct parser_ctx *ctx) {
-    struct Variable *current;
-    while (!SLIST_EMPTY(&(ctx->variables))) {
-        current = SLIST_FIRST(&(ctx->variables));
-        FREE(current->key);
-        FREE(current->value);
-        SLIST_REMOVE_HEAD(&(ctx->variables), variables);
-        FREE(current);
+void free_resource_database(void) {
+    if (database != NULL && database_contents == NULL) {
+        drop_resource_database();
     }
 }
 
+/*
+ * Notes that the RESOURCE_MANAGER property of the root window changed, so
+ * that the resource database is loaded again when the configuration is
+ * reloaded.
+ *
+ */
+void resource_database_changed(void) {
+    DLOG("RESOURCE_MANAGER changed.\n");
+    database_stale = true;
+}
+
 /*
  * Parses the given file by first replacing the variables, then calling
  * parse_config and possibly launching i3-nagbar.
@@ -982,67 +1352,7 @@ parse_file_result_t parse_file(struct parser_ctx *ctx, const char *f, IncludedFi
     }
     fclose(fstr);
 
-    if (database != NULL) {
-        xcb_xrm_database_free(database);
-        /* Explicitly set the database to NULL again in case the config gets reloaded. */
-        database = NULL;
-    }
-
-    /* For every custom variable, see how often it occurs in the file and
-     * how much extra bytes it requires when replaced. */
-    struct Variable *current, *nearest;
-    int extra_bytes = 0;
-    /* We need to copy the buffer because we need to invalidate the
-     * variables (otherwise we will count them twice, which is bad when
-     * 'extra' is negative) */
-    char *bufcopy = sstrdup(buf);
-    SLIST_FOREACH (current, &(ctx->variables), variables) {
-        int extra = (strlen(current->value) - strlen(current->key));
-        char *next;
-        for (next = bufcopy;
-             next < (bufcopy + stbuf.st_size) &&
-             (next = strcasestr(next, current->key)) != NULL;
-             next += strlen(current->key)) {
-            *next = '_';
-            extra_bytes += extra;
-        }
-    }
-    FREE(bufcopy);
-
-    /* Then, allocate a new buffer and copy the file over to the new one,
-     * but replace occurrences of our variables */
-    char *walk = buf, *destwalk;
-    char *new = scalloc(stbuf.st_size + extra_bytes + 1, 1);
-    destwalk = new;
-    while (walk < (buf + stbuf.st_size)) {
-        /* Find the next variable */
-        SLIST_FOREACH (current, &(ctx->variables), variables) {
-            current->next_match = strcasestr(walk, current->key);
-        }
-        nearest = NULL;
-        int distance = stbuf.st_size;
-        SLIST_FOREACH (current, &(ctx->variables), variables) {
-            if (current->next_match == NULL)
-                continue;
-            if ((current->next_match - walk) < distance) {
-                distance = (current->next_match - walk);
-                nearest = current;
-            }
-        }
-        if (nearest == NULL) {
-            /* If there are no more variables, we just copy the rest */
-            strncpy(destwalk, walk, (buf + stbuf.st_size) - walk);
-            destwalk += (buf + stbuf.st_size) - walk;
-            *destwalk = '\0';
-            break;
-        } else {
-            /* Copy until the next variable, then copy its value */
-            strncpy(destwalk, walk, distance);
-            strncpy(destwalk + distance, nearest->value, strlen(nearest->value));
-            walk += distance + strlen(nearest->key);
-            destwalk += distance + strlen(nearest->value);
-        }
-    }
+    char *new = replace_variables(&(ctx->variables), buf);
 
     /* analyze the string to find out whether this is an old config file (3.x)
      * or a new config file (4.x). If it’s old, we run the converter script. */
@@ -1084,7 +1394,9 @@ parse_file_result_t parse_file(struct parser_ctx *ctx, const char *f, IncludedFi
         context->has_errors = true;
     }
 
+    const uint64_t duplicates_start = stats_now();
     check_for_duplicate_bindings(context);
+    stats_record_duration(STATS_CHECK_DUPLICATE_BINDINGS, duplicates_start);
 
     if (ctx->use_nagbar && (context->has_errors || context->has_warnings || invalid_sets)) {
         ELOG("FYI: You are using i3 version %s\n", i3_version);
@@ -13,6 +13,18 @@
 struct drag_x11_cb {
     ev_prepare prepare;
 
+    /* Fires when the next frame is due while a motion is pending. */
+    ev_timer frame_timer;
+
+    /* Minimum time between two invocations of the callback. */
+    ev_tstamp frame_interval;
+
+    /* When the callback was last invoked. */
+    ev_tstamp last_frame;
+
+    /* The latest pointer motion which was not yet passed to the callback. */
+    xcb_motion_notify_event_t *pending_motion;
+
     /* Whether this modal event loop should be exited and with which result. */
     drag_result_t result;
 
@@ -46,6 +58,55 @@ static bool threshold_exceeded(uint32_t x1, uint32_t y1,
     return (x1 - x2) * (x1 - x2) + (y1 - y2) * (y1 - y2) > threshold * threshold;
 }
 
+/*
+ * Passes the pending pointer motion (if any) to the callback and pushes the
+ * resulting changes to X11.
+ *
+ */
+static void apply_pending_motion(EV_P_ struct drag_x11_cb *dragloop) {
+    xcb_motion_notify_event_t *motion = dragloop->pending_motion;
+    if (motion == NULL) {
+        return;
+    }
+    dragloop->pending_motion = NULL;
+    ev_timer_stop(EV_A_ &(dragloop->frame_timer));
+
+    if (!dragloop->threshold_exceeded &&
+        threshold_exceeded(motion->root_x, motion->root_y,
+                           dragloop->event->root_x, dragloop->event->root_y)) {
+        if (dragloop->xcursor != XCB_NONE) {
+            xcb_change_active_pointer_grab(
+                conn,
+                dragloop->xcursor,
+                XCB_CURRENT_TIME,
+                XCB_EVENT_MASK_BUTTON_RELEASE | XCB_EVENT_MASK_POINTER_MOTION);
+        }
+        dragloop->threshold_exceeded = true;
+    }
+
+    /* Ensure that we are either dragging the resize handle (con is NULL) or that the
+     * container still exists. The latter might not be true, e.g., if the window closed
+     * for any reason while the user was dragging it. */
+    if (dragloop->threshold_exceeded && (!dragloop->con || con_exists(dragloop->con))) {
+        dragloop->callback(
+            dragloop->con,
+            &(dragloop->old_rect),
+            motion->root_x,
+            motion->root_y,
+            dragloop->event,
+            dragloop->extra);
+        dragloop->last_frame = ev_now(EV_A);
+    }
+    free(motion);
+
+    xcb_flush(conn);
+}
+
+static void drag_frame_cb(EV_P_ ev_timer *w, int revents) {
+    struct drag_x11_cb *dragloop = (struct drag_x11_cb *)w->data;
+    apply_pending_motion(EV_A_ dragloop);
+}
+
 static bool drain_drag_events(EV_P, struct drag_x11_cb *dragloop) {
     xcb_motion_notify_event_t *last_motion_notify = NULL;
     xcb_generic_event_t *event;
@@ -117,46 +178,40 @@ static bool drain_drag_events(EV_P, struct drag_x11_cb *dragloop) {
         }
     }
 
-    if (last_motion_notify == NULL) {
+    if (last_motion_notify != NULL) {
+        free(dragloop->pending_motion);
+        dragloop->pending_motion = last_motion_notify;
+    }
+    if (dragloop->pending_motion == NULL) {
         return true;
     }
 
-    if (!dragloop->threshold_exceeded &&
-        threshold_exceeded(last_motion_notify->root_x, last_motion_notify->root_y,
-                           dragloop->event->root_x, dragloop->event->root_y)) {
-        if (dragloop->xcursor != XCB_NONE) {
-            xcb_change_active_pointer_grab(
-                conn,
-                dragloop->xcursor,
-                XCB_CURRENT_TIME,
-                XCB_EVENT_MASK_BUTTON_RELEASE | XCB_EVENT_MASK_POINTER_MOTION);
+    /* High-frequency mice report far more movements than the display can
+     * show, so the callback is invoked at most once per frame. The last
+     * position is always applied when the button is released. */
+    const ev_tstamp next_frame = dragloop->last_frame + dragloop->frame_interval;
+    if (dragloop->result == DRAGGING && ev_now(EV_A) < next_frame) {
+        if (!ev_is_active(&(dragloop->frame_timer))) {
+            ev_timer_set(&(dragloop->frame_timer), next_frame - ev_now(EV_A), 0.);
+            ev_timer_start(EV_A_ &(dragloop->frame_timer));
         }
-        dragloop->threshold_exceeded = true;
-    }
-
-    /* Ensure that we are either dragging the resize handle (con is NULL) or that the
-     * container still exists. The latter might not be true, e.g., if the window closed
-     * for any reason while the user was dragging it. */
-    if (dragloop->threshold_exceeded && (!dragloop->con || con_exists(dragloop->con))) {
-        dragloop->callback(
-            dragloop->con,
-            &(dragloop->old_rect),
-            last_motion_notify->root_x,
-            last_motion_notify->root_y,
-            dragloop->event,
-            dragloop->extra);
+        return true;
     }
-    FREE(last_motion_notify);
 
-    xcb_flush(conn);
+    apply_pending_motion(EV_A_ dragloop);
     return dragloop->result != DRAGGING;
 }
 
 static void xcb_drag_prepare_cb(EV_P_ ev_prepare *w, int revents) {
     struct drag_x11_cb *dragloop = (struct drag_x11_cb *)w->data;
-    while (!drain_drag_events(EV_A, dragloop)) {
-        /* repeatedly drain events: draining might produce additional ones */
-    }
+    do {
+        while (!drain_drag_events(EV_A, dragloop)) {
+            /* repeatedly drain events: draining might produce additional ones */
+        }
+        /* The handlers of events which are passed on to handle_event() might
+         * have scheduled a render. Once the drag ended, xcb_prepare_cb()
+         * takes care of it. */
+    } while (dragloop->result == DRAGGING && tree_flush_scheduled_render());
 }
 
 /*
@@ -200,6 +255,12 @@ drag_result_t drag_pointer(Con *con, const xcb_button_press_event_t *event,
 
     free(reply);
 
+    /* How long the press which started the drag takes is up to the user. */
+    stats_input_cancel();
+
+    /* The motion events are handled by the drag loop from now on. */
+    x_pointer_unknown();
+
     /* Grab the keyboard */
     xcb_grab_keyboard_cookie_t keyb_cookie;
     xcb_grab_keyboard_reply_t *keyb_reply;
@@ -236,12 +297,26 @@ drag_result_t drag_pointer(Con *con, const xcb_button_press_event_t *event,
         loop.old_rect = con->rect;
     ev_prepare_init(prepare, xcb_drag_prepare_cb);
     prepare->data = &loop;
+
+    double refresh_rate = config.drag_refresh_rate;
+    if (refresh_rate <= 0) {
+        refresh_rate = randr_get_max_refresh_rate();
+    }
+    if (refresh_rate <= 0) {
+        refresh_rate = 60;
+    }
+    loop.frame_interval = 1. / refresh_rate;
+    ev_timer_init(&(loop.frame_timer), drag_frame_cb, 0., 0.);
+    loop.frame_timer.data = &loop;
+
     main_set_x11_cb(false);
     ev_prepare_start(main_loop, prepare);
 
     ev_loop(main_loop, 0);
 
     ev_prepare_stop(main_loop, prepare);
+    ev_timer_stop(main_loop, &(loop.frame_timer));
+    FREE(loop.pending_motion);
     main_set_x11_cb(true);
 
     xcb_ungrab_keyboard(conn, XCB_CURRENT_TIME);
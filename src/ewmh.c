@@ -13,6 +13,40 @@
 
 xcb_window_t ewmh_window;
 
+/* Updates requested while a batch of commands is open, see tree_batch_begin(). */
+static bool desktop_properties_pending = false;
+static bool current_desktop_pending = false;
+static bool wm_desktop_pending = false;
+
+/* The last value written to one of the list properties on the root window.
+ * Pagers and panels re-read the whole list on every PropertyNotify, so
+ * unchanged values are not written again. */
+struct property_cache {
+    void *data;
+    size_t size;
+};
+
+static struct property_cache desktop_names_cache;
+static struct property_cache desktop_viewport_cache;
+static struct property_cache client_list_cache;
+static struct property_cache client_list_stacking_cache;
+
+/*
+ * Returns true (and remembers the new value) if the given value differs from
+ * the one which was last written to the cached property.
+ *
+ */
+static bool property_changed(struct property_cache *cache, const void *data, size_t size) {
+    if (cache->data != NULL && cache->size == size && memcmp(cache->data, data, size) == 0) {
+        return false;
+    }
+
+    cache->data = srealloc(cache->data, size == 0 ? 1 : size);
+    memcpy(cache->data, data, size);
+    cache->size = size;
+    return true;
+}
+
 #define FOREACH_NONINTERNAL                                                  \
     TAILQ_FOREACH (output, &(croot->nodes_head), nodes)                      \
         TAILQ_FOREACH (ws, &(output_get_content(output)->nodes_head), nodes) \
@@ -26,6 +60,11 @@ xcb_window_t ewmh_window;
  *
  */
 void ewmh_update_current_desktop(void) {
+    if (tree_batch_active()) {
+        current_desktop_pending = true;
+        return;
+    }
+
     static uint32_t old_idx = NET_WM_DESKTOP_NONE;
     const uint32_t idx = ewmh_get_workspace_index(focused);
 
@@ -82,6 +121,10 @@ static void ewmh_update_desktop_names(void) {
         }
     }
 
+    if (!property_changed(&desktop_names_cache, desktop_names, msg_length)) {
+        return;
+    }
+
     xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root,
                         A__NET_DESKTOP_NAMES, A_UTF8_STRING, 8, msg_length, desktop_names);
 }
@@ -107,6 +150,10 @@ static void ewmh_update_desktop_viewport(void) {
         viewports[current_position++] = output->rect.y;
     }
 
+    if (!property_changed(&desktop_viewport_cache, viewports, sizeof(uint32_t) * current_position)) {
+        return;
+    }
+
     xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root,
                         A__NET_DESKTOP_VIEWPORT, XCB_ATOM_CARDINAL, 32, current_position, &viewports);
 }
@@ -116,6 +163,11 @@ static void ewmh_update_desktop_viewport(void) {
  *
  */
 void ewmh_update_desktop_properties(void) {
+    if (tree_batch_active()) {
+        desktop_properties_pending = true;
+        return;
+    }
+
     ewmh_update_number_of_desktops();
     ewmh_update_desktop_viewport();
     ewmh_update_current_desktop();
@@ -182,6 +234,11 @@ static void ewmh_update_wm_desktop_recursively(Con *con, const uint32_t desktop)
  *
  */
 void ewmh_update_wm_desktop(void) {
+    if (tree_batch_active()) {
+        wm_desktop_pending = true;
+        return;
+    }
+
     uint32_t desktop = 0;
 
     Con *output;
@@ -197,6 +254,28 @@ void ewmh_update_wm_desktop(void) {
     }
 }
 
+/*
+ * Performs the desktop property updates which were deferred while a batch of
+ * commands was open.
+ *
+ */
+void ewmh_flush_deferred_updates(void) {
+    if (desktop_properties_pending) {
+        /* Includes the current desktop and _NET_WM_DESKTOP. */
+        ewmh_update_desktop_properties();
+    } else {
+        if (current_desktop_pending) {
+            ewmh_update_current_desktop();
+        }
+        if (wm_desktop_pending) {
+            ewmh_update_wm_desktop();
+        }
+    }
+    desktop_properties_pending = false;
+    current_desktop_pending = false;
+    wm_desktop_pending = false;
+}
+
 /*
  * Updates _NET_ACTIVE_WINDOW with the currently focused window.
  *
@@ -205,6 +284,17 @@ void ewmh_update_wm_desktop(void) {
  *
  */
 void ewmh_update_active_window(xcb_window_t window) {
+    /* Every change of the property wakes up all pagers and panels, so an
+     * unchanged value is not written again. */
+    static bool written = false;
+    static xcb_window_t last_window = XCB_NONE;
+    if (written && window == last_window) {
+        stats_x_requests[STATS_X_ELIDED]++;
+        return;
+    }
+    written = true;
+    last_window = window;
+
     xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root,
                         A__NET_ACTIVE_WINDOW, XCB_ATOM_WINDOW, 32, 1, &window);
 }
@@ -245,6 +335,10 @@ void ewmh_update_workarea(void) {
  *
  */
 void ewmh_update_client_list(xcb_window_t *list, int num_windows) {
+    if (!property_changed(&client_list_cache, list, sizeof(xcb_window_t) * num_windows)) {
+        return;
+    }
+
     xcb_change_property(
         conn,
         XCB_PROP_MODE_REPLACE,
@@ -261,6 +355,10 @@ void ewmh_update_client_list(xcb_window_t *list, int num_windows) {
  *
  */
 void ewmh_update_client_list_stacking(xcb_window_t *stack, int num_windows) {
+    if (!property_changed(&client_list_stacking_cache, stack, sizeof(xcb_window_t) * num_windows)) {
+        return;
+    }
+
     xcb_change_property(
         conn,
         XCB_PROP_MODE_REPLACE,
@@ -291,6 +389,21 @@ void ewmh_update_sticky(xcb_window_t window, bool sticky) {
  *
  */
 void ewmh_update_focused(xcb_window_t window, bool is_focused) {
+    /* The focus often moves to or from a container without a window, whose
+     * frame never gets the atom. For managed windows, i3 remembers whether it
+     * added the atom. Removing it needs a round-trip, so this is worth it. */
+    Con *con = con_by_window_id(window);
+    if (con != NULL && con->window != NULL) {
+        if (con->window->net_wm_state_focused == is_focused) {
+            stats_x_requests[STATS_X_ELIDED]++;
+            return;
+        }
+        con->window->net_wm_state_focused = is_focused;
+    } else if (con_by_frame_id(window) != NULL) {
+        stats_x_requests[STATS_X_ELIDED]++;
+        return;
+    }
+
     if (is_focused) {
         DLOG("Setting _NET_WM_STATE_FOCUSED for window = %08x.\n", window);
         xcb_add_property_atom(conn, window, A__NET_WM_STATE, A__NET_WM_STATE_FOCUSED);
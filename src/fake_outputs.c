@@ -58,6 +58,7 @@ void fake_outputs_init(const char *output_spec) {
                can always see the complete workspace */
             new_output->rect.width = min(new_output->rect.width, width);
             new_output->rect.height = min(new_output->rect.height, height);
+            randr_outputs_changed();
         } else {
             struct output_name *output_name = scalloc(1, sizeof(struct output_name));
             new_output = scalloc(1, sizeof(Output));
@@ -70,6 +71,7 @@ void fake_outputs_init(const char *output_spec) {
             new_output->rect.y = y;
             new_output->rect.width = width;
             new_output->rect.height = height;
+            randr_outputs_changed();
             /* We always treat the screen at 0x0 as the primary screen */
             if (new_output->rect.x == 0 && new_output->rect.y == 0)
                 TAILQ_INSERT_HEAD(&outputs, new_output, outputs);
@@ -80,6 +82,7 @@ void fake_outputs_init(const char *output_spec) {
             num_screens++;
         }
         new_output->primary = primary;
+        randr_outputs_changed();
     }
 
     if (num_screens == 0) {
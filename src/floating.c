@@ -303,6 +303,7 @@ bool floating_enable(Con *con, bool automatic) {
             TAILQ_INSERT_TAIL(fh, nc, focused);
         }
     }
+    con_invalidate_lookups();
 
     /* check if the parent container is empty and close it if so */
     if ((con->parent->type == CT_CON || con->parent->type == CT_FLOATING_CON) &&
@@ -311,6 +312,7 @@ bool floating_enable(Con *con, bool automatic) {
         Con *parent = con->parent;
         /* clear the pointer before calling tree_close_internal in which the memory is freed */
         con->parent = NULL;
+        con_invalidate_lookups();
         tree_close_internal(parent, DONT_KILL_WINDOW, false);
     }
 
@@ -343,6 +345,7 @@ bool floating_enable(Con *con, bool automatic) {
     /* 3: attach the child to the new parent container. We need to do this
      * because con_border_style_rect() needs to access con->parent. */
     con->parent = nc;
+    con_invalidate_lookups();
     con->percent = 1.0;
     con->floating = FLOATING_USER_ON;
 
@@ -441,6 +444,7 @@ void floating_disable(Con *con) {
         Con *parent = con->parent;
         con_detach(con);
         con->parent = NULL;
+        con_invalidate_lookups();
         tree_close_internal(parent, DONT_KILL_WINDOW, true);
         con_attach(con, tiling_focused, false);
         con->percent = 0.0;
@@ -622,7 +626,7 @@ void floating_drag_window(Con *con, const xcb_button_press_event_t *event, bool
 
     /* If this is a scratchpad window, don't auto center it from now on. */
     if (con->scratchpad_state == SCRATCHPAD_FRESH)
-        con->scratchpad_state = SCRATCHPAD_CHANGED;
+        con_set_scratchpad_state(con, SCRATCHPAD_CHANGED);
 
     tree_render();
 }
@@ -734,7 +738,7 @@ void floating_resize_window(Con *con, const bool proportional,
 
     /* If this is a scratchpad window, don't auto center it from now on. */
     if (con->scratchpad_state == SCRATCHPAD_FRESH)
-        con->scratchpad_state = SCRATCHPAD_CHANGED;
+        con_set_scratchpad_state(con, SCRATCHPAD_CHANGED);
 }
 
 /*
@@ -745,6 +749,20 @@ void floating_resize_window(Con *con, const bool proportional,
  *
  */
 bool floating_reposition(Con *con, Rect newrect) {
+    if (!floating_reposition_deferred(con, newrect)) {
+        return false;
+    }
+
+    tree_render();
+    return true;
+}
+
+/*
+ * Like floating_reposition(), but leaves rendering the tree to the caller, so
+ * that several containers can be repositioned at once.
+ *
+ */
+bool floating_reposition_deferred(Con *con, Rect newrect) {
     /* Sanity check: Are the new coordinates on any output? If not, we
      * ignore that request. */
     if (!output_containing_rect(newrect)) {
@@ -758,9 +776,8 @@ bool floating_reposition(Con *con, Rect newrect) {
 
     /* If this is a scratchpad window, don't auto center it from now on. */
     if (con->scratchpad_state == SCRATCHPAD_FRESH)
-        con->scratchpad_state = SCRATCHPAD_CHANGED;
+        con_set_scratchpad_state(con, SCRATCHPAD_CHANGED);
 
-    tree_render();
     return true;
 }
 
@@ -793,7 +810,7 @@ void floating_resize(Con *floating_con, uint32_t x, uint32_t y) {
 
     /* If this is a scratchpad window, don't auto center it from now on. */
     if (floating_con->scratchpad_state == SCRATCHPAD_FRESH)
-        floating_con->scratchpad_state = SCRATCHPAD_CHANGED;
+        con_set_scratchpad_state(floating_con, SCRATCHPAD_CHANGED);
 }
 
 /*
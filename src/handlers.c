@@ -9,6 +9,7 @@
  *
  */
 #include "all.h"
+#include "yajl_utils.h"
 
 #include <sys/time.h>
 #include <time.h>
@@ -24,25 +25,135 @@ int shape_base = -1;
 
 /* After mapping/unmapping windows, a notify event is generated. However, we don’t want it,
    since it’d trigger an infinite loop of switching between the different windows when
-   changing workspaces */
-static SLIST_HEAD(ignore_head, Ignore_Event) ignore_events;
+   changing workspaces.
+
+   The ignored events are kept in a ring buffer, ordered by sequence number. The
+   capacity is a power of two and grows when needed. */
+static struct Ignore_Event *ignore_events;
+static uint32_t ignore_events_capacity;
+static uint32_t ignore_events_first;
+static uint32_t ignore_events_count;
+
+/* Entries this far behind a newly added sequence number are retired, so that
+ * the (16 bit, wrapping) sequence numbers in the buffer stay comparable. */
+#define IGNORE_EVENTS_WINDOW 0x4000
+
+/* The capacity the ring buffer starts with and never shrinks below. */
+#define IGNORE_EVENTS_MIN_CAPACITY 64
+
+static bool shrink_ignored_events(maintenance_task *task);
+static maintenance_task shrink_task = MAINTENANCE_TASK_INITIALIZER("ignore_events", shrink_ignored_events);
+
+static struct Ignore_Event *ignore_event_at(uint32_t index) {
+    return &ignore_events[(ignore_events_first + index) & (ignore_events_capacity - 1)];
+}
+
+/*
+ * Moves the ignored events into a buffer with the given capacity (a power of
+ * two which is large enough).
+ *
+ */
+static void resize_ignored_events(const uint32_t capacity) {
+    struct Ignore_Event *events = smalloc(capacity * sizeof(struct Ignore_Event));
+    for (uint32_t i = 0; i < ignore_events_count; i++) {
+        events[i] = *ignore_event_at(i);
+    }
+    free(ignore_events);
+    ignore_events = events;
+    ignore_events_capacity = capacity;
+    ignore_events_first = 0;
+}
+
+/*
+ * Returns the ring buffer to a smaller capacity after a burst of ignored
+ * events (e.g. when switching between workspaces with many windows).
+ *
+ */
+static bool shrink_ignored_events(maintenance_task *task) {
+    uint32_t capacity = ignore_events_capacity;
+    while (capacity > IGNORE_EVENTS_MIN_CAPACITY && ignore_events_count < capacity / 4) {
+        capacity /= 2;
+    }
+    if (capacity < ignore_events_capacity) {
+        DLOG("Shrinking the ignored events from %u to %u entries\n", ignore_events_capacity, capacity);
+        resize_ignored_events(capacity);
+    }
+    return false;
+}
+
+/*
+ * Returns true if sequence number a was sent before b, taking the wrapping
+ * into account.
+ *
+ */
+static bool sequence_before(uint16_t a, uint16_t b) {
+    return (int16_t)(uint16_t)(a - b) < 0;
+}
+
+/*
+ * Retires the ignored events which were sent before the given sequence
+ * number. The X server sends the events in order, so once an event was
+ * handled, no event with an earlier sequence number follows.
+ *
+ */
+static void retire_ignored_events(const uint16_t sequence) {
+    while (ignore_events_count > 0 && sequence_before(ignore_event_at(0)->sequence, sequence)) {
+        ignore_events_first = (ignore_events_first + 1) & (ignore_events_capacity - 1);
+        ignore_events_count--;
+    }
+
+    if (ignore_events_capacity > IGNORE_EVENTS_MIN_CAPACITY &&
+        ignore_events_count < ignore_events_capacity / 4) {
+        maintenance_schedule(&shrink_task);
+    }
+}
+
+/*
+ * Returns the index of the first ignored event whose sequence number is not
+ * before the given one.
+ *
+ */
+static uint32_t ignored_events_lower_bound(const uint16_t sequence) {
+    uint32_t low = 0;
+    uint32_t high = ignore_events_count;
+    while (low < high) {
+        const uint32_t middle = low + (high - low) / 2;
+        if (sequence_before(ignore_event_at(middle)->sequence, sequence)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
 
 /*
  * Adds the given sequence to the list of events which are ignored.
  * If this ignore should only affect a specific response_type, pass
  * response_type, otherwise, pass -1.
  *
- * Every ignored sequence number gets garbage collected after 5 seconds.
+ * An ignored sequence number is retired once an event with a later sequence
+ * number was handled.
  *
  */
 void add_ignore_event(const int sequence, const int response_type) {
-    struct Ignore_Event *event = smalloc(sizeof(struct Ignore_Event));
+    const uint16_t wire_sequence = sequence;
+    retire_ignored_events(wire_sequence - IGNORE_EVENTS_WINDOW);
 
-    event->sequence = sequence;
-    event->response_type = response_type;
-    event->added = time(NULL);
+    if (ignore_events_count == ignore_events_capacity) {
+        resize_ignored_events(ignore_events_capacity > 0 ? 2 * ignore_events_capacity : IGNORE_EVENTS_MIN_CAPACITY);
+    }
 
-    SLIST_INSERT_HEAD(&ignore_events, event, ignore_events);
+    /* Most sequence numbers are added in order, but the ones of handled
+     * events can be older than the last request. */
+    uint32_t index = ignore_events_count;
+    while (index > 0 && sequence_before(wire_sequence, ignore_event_at(index - 1)->sequence)) {
+        *ignore_event_at(index) = *ignore_event_at(index - 1);
+        index--;
+    }
+    ignore_event_at(index)->sequence = wire_sequence;
+    ignore_event_at(index)->response_type = response_type;
+    ignore_events_count++;
 }
 
 /*
@@ -50,29 +161,21 @@ void add_ignore_event(const int sequence, const int response_type) {
  *
  */
 bool event_is_ignored(const int sequence, const int response_type) {
-    struct Ignore_Event *event;
-    time_t now = time(NULL);
-    for (event = SLIST_FIRST(&ignore_events); event != SLIST_END(&ignore_events);) {
-        if ((now - event->added) > 5) {
-            struct Ignore_Event *save = event;
-            event = SLIST_NEXT(event, ignore_events);
-            SLIST_REMOVE(&ignore_events, save, Ignore_Event, ignore_events);
-            free(save);
-        } else
-            event = SLIST_NEXT(event, ignore_events);
-    }
-
-    SLIST_FOREACH (event, &ignore_events, ignore_events) {
-        if (event->sequence != sequence)
-            continue;
+    const uint16_t wire_sequence = sequence;
+
+    /* A sequence number is not removed once it matched, as it may generate
+     * multiple events (there are multiple enter_notifies for one
+     * configure_request, for example). */
+    for (uint32_t i = ignored_events_lower_bound(wire_sequence); i < ignore_events_count; i++) {
+        const struct Ignore_Event *event = ignore_event_at(i);
+        if (event->sequence != wire_sequence) {
+            break;
+        }
 
         if (event->response_type != -1 &&
             event->response_type != response_type)
             continue;
 
-        /* Instead of removing & freeing a sequence number we better wait until
-         * it gets garbage collected. It may generate multiple events (there
-         * are multiple enter_notifies for one configure_request, for example). */
         return true;
     }
 
@@ -88,8 +191,9 @@ bool event_is_ignored(const int sequence, const int response_type) {
 static void check_crossing_screen_boundary(uint32_t x, uint32_t y) {
     Output *output;
 
-    /* If the user disable focus follows mouse, we have nothing to do here */
-    if (config.disable_focus_follows_mouse)
+    /* If the user disable focus follows mouse, we have nothing to do here.
+     * With raw pointer motion, raw_pointer_flush() switches outputs. */
+    if (config.disable_focus_follows_mouse || raw_pointer_active())
         return;
 
     if ((output = get_output_containing(x, y)) == NULL) {
@@ -112,7 +216,7 @@ static void check_crossing_screen_boundary(uint32_t x, uint32_t y) {
 
     /* If the focus changed, we re-render to get updated decorations */
     if (old_focused != focused)
-        tree_render();
+        tree_schedule_render();
 }
 
 /*
@@ -127,6 +231,11 @@ static void handle_enter_notify(xcb_enter_notify_event_t *event) {
     DLOG("enter_notify for %08x, mode = %d, detail %d, serial %d\n",
          event->event, event->mode, event->detail, event->sequence);
     DLOG("coordinates %d, %d\n", event->event_x, event->event_y);
+    x_pointer_moved(event->event, event->root_x, event->root_y);
+    /* With raw pointer motion, raw_pointer_flush() changes focus instead. */
+    if (raw_pointer_active()) {
+        return;
+    }
     if (event->mode != XCB_NOTIFY_MODE_NORMAL) {
         DLOG("This was not a normal notify, ignoring\n");
         return;
@@ -183,7 +292,7 @@ static void handle_enter_notify(xcb_enter_notify_event_t *event) {
 
     focused_id = XCB_NONE;
     con_focus(con_descend_focused(con));
-    tree_render();
+    tree_schedule_render();
 }
 
 /*
@@ -194,10 +303,12 @@ static void handle_enter_notify(xcb_enter_notify_event_t *event) {
  */
 static void handle_motion_notify(xcb_motion_notify_event_t *event) {
     last_timestamp = event->time;
+    x_pointer_moved((event->event == root && event->child != XCB_NONE ? event->child : event->event), event->root_x, event->root_y);
 
     /* Skip events where the pointer was over a child window, we are only
-     * interested in events on the root window. */
-    if (event->child != XCB_NONE)
+     * interested in events on the root window. With raw pointer motion,
+     * raw_pointer_flush() changes focus instead. */
+    if (event->child != XCB_NONE || raw_pointer_active())
         return;
 
     Con *con;
@@ -264,6 +375,132 @@ static void handle_map_request(xcb_map_request_event_t *event) {
     manage_window(event->window, cookie, false);
 }
 
+/* ConfigureRequests of floating windows which were queued by
+ * handle_configure_request(), one per window. */
+struct queued_configure_request {
+    /* The latest value for every member in value_mask */
+    xcb_configure_request_event_t event;
+
+    TAILQ_ENTRY(queued_configure_request) requests;
+};
+static TAILQ_HEAD(queued_configure_requests_head, queued_configure_request) queued_configure_requests =
+    TAILQ_HEAD_INITIALIZER(queued_configure_requests);
+
+/*
+ * Queues the ConfigureRequest of a floating window, merging it with an
+ * earlier one of the same window. Some clients (games, Electron apps) send
+ * bursts of them, of which only the latest geometry matters.
+ *
+ */
+static void queue_configure_request(xcb_configure_request_event_t *event) {
+    struct queued_configure_request *queued;
+    TAILQ_FOREACH (queued, &queued_configure_requests, requests) {
+        if (queued->event.window == event->window) {
+            break;
+        }
+    }
+    if (queued == NULL) {
+        queued = smalloc(sizeof(struct queued_configure_request));
+        queued->event = *event;
+        TAILQ_INSERT_TAIL(&queued_configure_requests, queued, requests);
+        return;
+    }
+
+    DLOG("Merging ConfigureRequest of window 0x%08x with a queued one\n", event->window);
+#define MERGE_MASK_MEMBER(mask_member, event_member)         \
+    do {                                                     \
+        if (event->value_mask & mask_member) {               \
+            queued->event.value_mask |= mask_member;         \
+            queued->event.event_member = event->event_member; \
+        }                                                    \
+    } while (0)
+
+    MERGE_MASK_MEMBER(XCB_CONFIG_WINDOW_X, x);
+    MERGE_MASK_MEMBER(XCB_CONFIG_WINDOW_Y, y);
+    MERGE_MASK_MEMBER(XCB_CONFIG_WINDOW_WIDTH, width);
+    MERGE_MASK_MEMBER(XCB_CONFIG_WINDOW_HEIGHT, height);
+
+#undef MERGE_MASK_MEMBER
+}
+
+/*
+ * Applies the geometry of a (merged) ConfigureRequest to the floating
+ * container of the given leaf, without rendering.
+ *
+ */
+static void apply_floating_configure_request(Con *con, xcb_configure_request_event_t *event) {
+    /* find the height for the decorations */
+    int deco_height = con->deco_rect.height;
+    /* we actually need to apply the size/position changes to the *parent*
+     * container */
+    Rect bsr = con_border_style_rect(con);
+    if (con->border_style == BS_NORMAL) {
+        bsr.y += deco_height;
+        bsr.height -= deco_height;
+    }
+    Con *floatingcon = con->parent;
+    Rect newrect = floatingcon->rect;
+
+    if (event->value_mask & XCB_CONFIG_WINDOW_X) {
+        newrect.x = event->x + (-1) * bsr.x;
+        DLOG("proposed x = %d, new x is %d\n", event->x, newrect.x);
+    }
+    if (event->value_mask & XCB_CONFIG_WINDOW_Y) {
+        newrect.y = event->y + (-1) * bsr.y;
+        DLOG("proposed y = %d, new y is %d\n", event->y, newrect.y);
+    }
+    if (event->value_mask & XCB_CONFIG_WINDOW_WIDTH) {
+        newrect.width = event->width + (-1) * bsr.width;
+        newrect.width += con->border_width * 2;
+        DLOG("proposed width = %d, new width is %d (x11 border %d)\n",
+             event->width, newrect.width, con->border_width);
+    }
+    if (event->value_mask & XCB_CONFIG_WINDOW_HEIGHT) {
+        newrect.height = event->height + (-1) * bsr.height;
+        newrect.height += con->border_width * 2;
+        DLOG("proposed height = %d, new height is %d (x11 border %d)\n",
+             event->height, newrect.height, con->border_width);
+    }
+
+    floating_reposition_deferred(floatingcon, newrect);
+}
+
+/*
+ * Applies the ConfigureRequests queued by handle_configure_request(), renders
+ * the tree once and then tells each window its geometry with a synthetic
+ * ConfigureNotify. Returns true if any requests were queued.
+ *
+ */
+bool handle_queued_configure_requests(void) {
+    if (TAILQ_EMPTY(&queued_configure_requests)) {
+        return false;
+    }
+
+    struct queued_configure_request *queued;
+    TAILQ_FOREACH (queued, &queued_configure_requests, requests) {
+        /* The window might have been unmanaged or tiled in the meantime. */
+        Con *con = con_by_window_id(queued->event.window);
+        if (con == NULL || !con_is_floating(con) || !con_is_leaf(con)) {
+            DLOG("Window 0x%08x is no longer a floating leaf, ignoring its ConfigureRequest\n",
+                 queued->event.window);
+            continue;
+        }
+        apply_floating_configure_request(con, &(queued->event));
+    }
+
+    tree_render();
+
+    while ((queued = TAILQ_FIRST(&queued_configure_requests)) != NULL) {
+        TAILQ_REMOVE(&queued_configure_requests, queued, requests);
+        Con *con = con_by_window_id(queued->event.window);
+        if (con != NULL) {
+            fake_absolute_configure_notify(con);
+        }
+        free(queued);
+    }
+    return true;
+}
+
 /*
  * Configure requests are received when the application wants to resize windows
  * on their own.
@@ -318,41 +555,10 @@ static void handle_configure_request(xcb_configure_request_event_t *event) {
     Con *fullscreen = con_get_fullscreen_covering_ws(workspace);
 
     if (fullscreen != con && con_is_floating(con) && con_is_leaf(con)) {
-        /* find the height for the decorations */
-        int deco_height = con->deco_rect.height;
-        /* we actually need to apply the size/position changes to the *parent*
-         * container */
-        Rect bsr = con_border_style_rect(con);
-        if (con->border_style == BS_NORMAL) {
-            bsr.y += deco_height;
-            bsr.height -= deco_height;
-        }
-        Con *floatingcon = con->parent;
-        Rect newrect = floatingcon->rect;
-
-        if (event->value_mask & XCB_CONFIG_WINDOW_X) {
-            newrect.x = event->x + (-1) * bsr.x;
-            DLOG("proposed x = %d, new x is %d\n", event->x, newrect.x);
-        }
-        if (event->value_mask & XCB_CONFIG_WINDOW_Y) {
-            newrect.y = event->y + (-1) * bsr.y;
-            DLOG("proposed y = %d, new y is %d\n", event->y, newrect.y);
-        }
-        if (event->value_mask & XCB_CONFIG_WINDOW_WIDTH) {
-            newrect.width = event->width + (-1) * bsr.width;
-            newrect.width += con->border_width * 2;
-            DLOG("proposed width = %d, new width is %d (x11 border %d)\n",
-                 event->width, newrect.width, con->border_width);
-        }
-        if (event->value_mask & XCB_CONFIG_WINDOW_HEIGHT) {
-            newrect.height = event->height + (-1) * bsr.height;
-            newrect.height += con->border_width * 2;
-            DLOG("proposed height = %d, new height is %d (x11 border %d)\n",
-                 event->height, newrect.height, con->border_width);
-        }
-
         DLOG("Container is a floating leaf node, will do that.\n");
-        floating_reposition(floatingcon, newrect);
+        /* Applied by handle_queued_configure_requests(), together with all
+         * other requests of this event loop iteration. */
+        queue_configure_request(event);
         return;
     }
 
@@ -363,7 +569,9 @@ static void handle_configure_request(xcb_configure_request_event_t *event) {
             DLOG("Dock client wants to change height to %d, we can do that.\n", event->height);
 
             con->geometry.height = event->height;
-            tree_render();
+            con_set_dirty(con);
+            tree_note_output_change(con_get_output(con));
+            tree_schedule_render();
         }
 
         if (event->value_mask & XCB_CONFIG_WINDOW_X || event->value_mask & XCB_CONFIG_WINDOW_Y) {
@@ -380,7 +588,9 @@ static void handle_configure_request(xcb_configure_request_event_t *event) {
                 con_detach(con);
                 con_attach(con, nc, false);
 
-                tree_render();
+                tree_note_output_change(current_output);
+                tree_note_output_change(target->con);
+                tree_schedule_render();
             } else {
                 DLOG("Dock client will not be moved, we only support moving it to another output.\n");
             }
@@ -412,11 +622,11 @@ static void handle_configure_request(xcb_configure_request_event_t *event) {
             DLOG("Focusing con = %p\n", con);
             workspace_show(workspace);
             con_activate_unblock(con);
-            tree_render();
+            tree_schedule_render();
         } else if (config.focus_on_window_activation == FOWA_URGENT || (config.focus_on_window_activation == FOWA_SMART && !workspace_is_visible(workspace))) {
             DLOG("Marking con = %p urgent\n", con);
             con_set_urgency(con, true);
-            tree_render();
+            tree_schedule_render();
         } else {
             DLOG("Ignoring request for con = %p.\n", con);
         }
@@ -444,14 +654,22 @@ static void handle_screen_change(xcb_generic_event_t *e) {
     }
     DLOG("root geometry reply: (%d, %d) %d x %d\n", reply->x, reply->y, reply->width, reply->height);
 
+    const bool resized = (croot->rect.width != reply->width ||
+                          croot->rect.height != reply->height);
     croot->rect.width = reply->width;
     croot->rect.height = reply->height;
+    free(reply);
 
-    randr_query_outputs();
+    /* X11 sends a burst of notifications for a single change of the monitor
+     * configuration, most of which leave the outputs as they are. */
+    if (!randr_query_outputs() && !resized) {
+        return;
+    }
 
     scratchpad_fix_resolution();
 
-    ipc_send_event("output", I3_IPC_EVENT_OUTPUT, "{\"change\":\"unspecified\"}");
+    ipc_invalidate_reply_cache();
+    ipc_send_event(I3_IPC_EVENT_OUTPUT, "{\"change\":\"unspecified\"}");
 }
 
 /*
@@ -494,7 +712,10 @@ static void handle_unmap_notify_event(xcb_unmap_notify_event_t *event) {
     xcb_delete_property(conn, event->window, A__NET_WM_DESKTOP);
     xcb_delete_property(conn, event->window, A__NET_WM_STATE);
 
+    /* Closing a dock client only changes the dock area of its output. */
+    Con *dock_output = (con->parent->type == CT_DOCKAREA ? con_get_output(con) : NULL);
     tree_close_internal(con, DONT_KILL_WINDOW, false);
+    tree_note_output_change(dock_output);
     tree_render();
 
 ignore_end:
@@ -541,6 +762,23 @@ static void handle_destroy_notify_event(xcb_destroy_notify_event_t *event) {
     handle_unmap_notify_event(&unmap);
 }
 
+/* PropertyNotify events which were queued by property_notify(). */
+struct queued_property_notify {
+    xcb_window_t window;
+    uint8_t state;
+    struct property_handler_t *handler;
+    xcb_get_property_cookie_t cookie;
+
+    TAILQ_ENTRY(queued_property_notify) notifies;
+};
+static TAILQ_HEAD(queued_property_notifies_head, queued_property_notify) queued_property_notifies =
+    TAILQ_HEAD_INITIALIZER(queued_property_notifies);
+
+/* Set by the property handlers instead of pushing or rendering the tree
+ * themselves, see handle_queued_property_notifies(). */
+static bool property_push_pending = false;
+static bool property_render_pending = false;
+
 static bool window_name_changed(i3Window *window, char *old_name) {
     if ((old_name == NULL) && (window->name == NULL))
         return false;
@@ -561,9 +799,9 @@ static bool handle_windowname_change(Con *con, xcb_get_property_reply_t *prop) {
 
     window_update_name(con->window, prop);
 
-    con = remanage_window(con);
+    con = remanage_window(con, WP_TITLE);
 
-    x_push_changes(croot);
+    property_push_pending = true;
 
     if (window_name_changed(con->window, old_name))
         ipc_send_window_event("title", con);
@@ -583,9 +821,9 @@ static bool handle_windowname_change_legacy(Con *con, xcb_get_property_reply_t *
 
     window_update_name_legacy(con->window, prop);
 
-    con = remanage_window(con);
+    con = remanage_window(con, WP_TITLE);
 
-    x_push_changes(croot);
+    property_push_pending = true;
 
     if (window_name_changed(con->window, old_name))
         ipc_send_window_event("title", con);
@@ -602,7 +840,7 @@ static bool handle_windowname_change_legacy(Con *con, xcb_get_property_reply_t *
 static bool handle_windowrole_change(Con *con, xcb_get_property_reply_t *prop) {
     window_update_role(con->window, prop);
 
-    con = remanage_window(con);
+    con = remanage_window(con, WP_ROLE);
 
     return true;
 }
@@ -612,19 +850,48 @@ static bool handle_windowrole_change(Con *con, xcb_get_property_reply_t *prop) {
  *
  */
 static void handle_expose_event(xcb_expose_event_t *event) {
-    Con *parent;
+    /* The X server sends the exposed rectangles of a window in a row, the
+     * last one with count == 0. Their union is copied at once. */
+    static xcb_window_t exposed_window = XCB_NONE;
+    static int32_t x1, y1, x2, y2;
+
+    DLOG("window = %08x, count = %d\n", event->window, event->count);
+
+    if (exposed_window != event->window) {
+        /* A previous series ended without count == 0 (for example because
+         * the window was destroyed), start over. */
+        exposed_window = event->window;
+        x1 = event->x;
+        y1 = event->y;
+        x2 = event->x + event->width;
+        y2 = event->y + event->height;
+    } else {
+        x1 = min(x1, event->x);
+        y1 = min(y1, event->y);
+        x2 = max(x2, event->x + event->width);
+        y2 = max(y2, event->y + event->height);
+    }
 
-    DLOG("window = %08x\n", event->window);
+    if (event->count > 0) {
+        return;
+    }
+    exposed_window = XCB_NONE;
 
+    Con *parent;
     if ((parent = con_by_frame_id(event->window)) == NULL) {
         LOG("expose event for unknown window, ignoring\n");
         return;
     }
 
+    /* Frames which are completely covered by their window have no pixmap. */
+    if (parent->frame_buffer.id == XCB_NONE) {
+        return;
+    }
+
     /* Since we render to our surface on every change anyways, expose events
      * only tell us that the X server lost (parts of) the window contents. */
     draw_util_copy_surface(&(parent->frame_buffer), &(parent->frame),
-                           0, 0, 0, 0, parent->rect.width, parent->rect.height);
+                           x1, y1, x1, y1, x2 - x1, y2 - y1);
     xcb_flush(conn);
 }
 
@@ -694,11 +961,11 @@ static void handle_client_message(xcb_client_message_event_t *event) {
         } else if (event->data.data32[1] == A__NET_WM_STATE_STICKY) {
             DLOG("Received a client message to modify _NET_WM_STATE_STICKY.\n");
             if (event->data.data32[0] == _NET_WM_STATE_ADD)
-                con->sticky = true;
+                con_set_sticky(con, true);
             else if (event->data.data32[0] == _NET_WM_STATE_REMOVE)
-                con->sticky = false;
+                con_set_sticky(con, false);
             else if (event->data.data32[0] == _NET_WM_STATE_TOGGLE)
-                con->sticky = !con->sticky;
+                con_set_sticky(con, !con->sticky);
 
             DLOG("New sticky status for con = %p is %i.\n", con, con->sticky);
             ewmh_update_sticky(con->window->id, con->sticky);
@@ -706,7 +973,7 @@ static void handle_client_message(xcb_client_message_event_t *event) {
             ewmh_update_wm_desktop();
         }
 
-        tree_render();
+        tree_schedule_render();
     } else if (event->type == A__NET_ACTIVE_WINDOW) {
         if (event->format != 32)
             return;
@@ -761,10 +1028,13 @@ static void handle_client_message(xcb_client_message_event_t *event) {
                 DLOG("Ignoring request for con = %p.\n", con);
         }
 
-        tree_render();
+        tree_schedule_render();
     } else if (event->type == A_I3_SYNC) {
         xcb_window_t window = event->data.data32[0];
         uint32_t rnd = event->data.data32[1];
+        /* The client expects the effects of all preceding requests (and
+         * events) to be visible. */
+        tree_flush_scheduled_render();
         sync_respond(window, rnd);
     } else if (event->type == A__NET_REQUEST_FRAME_EXTENTS) {
         /*
@@ -823,7 +1093,7 @@ static void handle_client_message(xcb_client_message_event_t *event) {
 
         DLOG("Handling request to focus workspace %s\n", ws->name);
         workspace_show(ws);
-        tree_render();
+        tree_schedule_render();
     } else if (event->type == A__NET_WM_DESKTOP) {
         uint32_t index = event->data.data32[0];
         DLOG("Request to move window %d to EWMH desktop index %d\n", event->window, index);
@@ -842,7 +1112,7 @@ static void handle_client_message(xcb_client_message_event_t *event) {
             if (floating_enable(con, false)) {
                 con->floating = FLOATING_AUTO_ON;
 
-                con->sticky = true;
+                con_set_sticky(con, true);
                 ewmh_update_sticky(con->window->id, true);
                 output_push_sticky_windows(focused);
             }
@@ -856,7 +1126,7 @@ static void handle_client_message(xcb_client_message_event_t *event) {
             con_move_to_workspace(con, ws, true, false, false);
         }
 
-        tree_render();
+        tree_schedule_render();
         ewmh_update_wm_desktop();
     } else if (event->type == A__NET_CLOSE_WINDOW) {
         /*
@@ -872,7 +1142,7 @@ static void handle_client_message(xcb_client_message_event_t *event) {
                 last_timestamp = event->data.data32[0];
 
             tree_close_internal(con, KILL_WINDOW, false);
-            tree_render();
+            tree_schedule_render();
         } else {
             DLOG("Couldn't find con for _NET_CLOSE_WINDOW request. (window = %08x)\n", event->window);
         }
@@ -960,7 +1230,7 @@ static bool handle_normal_hints(Con *con, xcb_get_property_reply_t *reply) {
         Con *floating = con_inside_floating(con);
         if (floating) {
             floating_check_size(con, false);
-            tree_render();
+            property_render_pending = true;
         }
     }
 
@@ -976,7 +1246,7 @@ static bool handle_hints(Con *con, xcb_get_property_reply_t *reply) {
     bool urgency_hint;
     window_update_hints(con->window, reply, &urgency_hint);
     con_set_urgency(con, urgency_hint);
-    tree_render();
+    property_render_pending = true;
     return true;
 }
 
@@ -1053,7 +1323,7 @@ static void handle_focus_in(xcb_focus_in_event_t *event) {
 
     /* We update focused_id because we don’t need to set focus again */
     focused_id = event->event;
-    tree_render();
+    tree_schedule_render();
 }
 
 /*
@@ -1141,9 +1411,12 @@ static void handle_configure_notify(xcb_configure_notify_event_t *event) {
     if (force_xinerama) {
         return;
     }
-    randr_query_outputs();
+    if (!randr_query_outputs()) {
+        return;
+    }
 
-    ipc_send_event("output", I3_IPC_EVENT_OUTPUT, "{\"change\":\"unspecified\"}");
+    ipc_invalidate_reply_cache();
+    ipc_send_event(I3_IPC_EVENT_OUTPUT, "{\"change\":\"unspecified\"}");
 }
 
 /*
@@ -1167,7 +1440,9 @@ static void handle_selection_clear(xcb_selection_clear_event_t *event) {
  */
 static bool handle_class_change(Con *con, xcb_get_property_reply_t *prop) {
     window_update_class(con->window, prop);
-    con = remanage_window(con);
+    /* The instance is part of the title of split containers. */
+    con_invalidate_tree_representation(con);
+    con = remanage_window(con, WP_CLASS);
     return true;
 }
 
@@ -1177,7 +1452,17 @@ static bool handle_class_change(Con *con, xcb_get_property_reply_t *prop) {
  */
 static bool handle_machine_change(Con *con, xcb_get_property_reply_t *prop) {
     window_update_machine(con->window, prop);
-    con = remanage_window(con);
+    con = remanage_window(con, WP_MACHINE);
+    return true;
+}
+
+/*
+ * Handles the WM_PROTOCOLS property, which is used when focusing and killing
+ * the window.
+ *
+ */
+static bool handle_protocols_change(Con *con, xcb_get_property_reply_t *prop) {
+    window_update_protocols(con->window, prop);
     return true;
 }
 
@@ -1193,7 +1478,7 @@ static bool handle_motif_hints_change(Con *con, xcb_get_property_reply_t *prop)
         DLOG("Update border style of con %p to %d\n", con, motif_border_style);
         con_set_border_style(con, motif_border_style, con->current_border_width);
 
-        x_push_changes(croot);
+        property_push_pending = true;
     }
 
     return true;
@@ -1246,7 +1531,9 @@ static bool handle_strut_partial_change(Con *con, xcb_get_property_reply_t *prop
     con_detach(con);
     con_attach(con, dockarea, true);
 
-    tree_render();
+    /* Only the dock area and content of this output change. */
+    tree_note_output_change(con_get_output(con));
+    property_render_pending = true;
 
     return true;
 }
@@ -1265,7 +1552,7 @@ static bool handle_strut_partial_change(Con *con, xcb_get_property_reply_t *prop
 static bool handle_i3_floating(Con *con, xcb_get_property_reply_t *prop) {
     DLOG("floating change for con %p\n", con);
 
-    remanage_window(con);
+    remanage_window(con, WP_FLOATING);
 
     return true;
 }
@@ -1273,7 +1560,7 @@ static bool handle_i3_floating(Con *con, xcb_get_property_reply_t *prop) {
 static bool handle_windowicon_change(Con *con, xcb_get_property_reply_t *prop) {
     window_update_icon(con->window, prop);
 
-    x_push_changes(croot);
+    property_push_pending = true;
 
     return true;
 }
@@ -1302,7 +1589,8 @@ static struct property_handler_t property_handlers[] = {
     {0, UINT_MAX, handle_i3_floating},
     {0, 128, handle_machine_change},
     {0, 5 * sizeof(uint64_t), handle_motif_hints_change},
-    {0, UINT_MAX, handle_windowicon_change}};
+    {0, UINT_MAX, handle_windowicon_change},
+    {0, UINT_MAX, handle_protocols_change}};
 #define NUM_HANDLERS (sizeof(property_handlers) / sizeof(struct property_handler_t))
 
 /*
@@ -1327,12 +1615,17 @@ void property_handlers_init(void) {
     property_handlers[11].atom = XCB_ATOM_WM_CLIENT_MACHINE;
     property_handlers[12].atom = A__MOTIF_WM_HINTS;
     property_handlers[13].atom = A__NET_WM_ICON;
+    property_handlers[14].atom = A_WM_PROTOCOLS;
 }
 
+/*
+ * Queues the given PropertyNotify event and requests the property. The queued
+ * events are handled by handle_queued_property_notifies(), so that a burst of
+ * PropertyNotify events waits for one round-trip and renders once.
+ *
+ */
 static void property_notify(uint8_t state, xcb_window_t window, xcb_atom_t atom) {
     struct property_handler_t *handler = NULL;
-    xcb_get_property_reply_t *propr = NULL;
-    xcb_generic_error_t *err = NULL;
     Con *con;
 
     for (size_t c = 0; c < NUM_HANDLERS; c++) {
@@ -1353,176 +1646,348 @@ static void property_notify(uint8_t state, xcb_window_t window, xcb_atom_t atom)
         return;
     }
 
-    if (state != XCB_PROPERTY_DELETE) {
-        xcb_get_property_cookie_t cookie = xcb_get_property(conn, 0, window, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, handler->long_len);
-        propr = xcb_get_property_reply(conn, cookie, &err);
-        if (err != NULL) {
-            DLOG("got error %d when getting property of atom %d\n", err->error_code, atom);
-            FREE(err);
-            return;
+    /* A property which changes repeatedly within a burst only needs to be
+     * handled once, with its latest value. */
+    struct queued_property_notify *queued;
+    TAILQ_FOREACH (queued, &queued_property_notifies, notifies) {
+        if (queued->window == window && queued->handler == handler) {
+            break;
         }
     }
+    if (queued == NULL) {
+        queued = smalloc(sizeof(struct queued_property_notify));
+        queued->window = window;
+        queued->handler = handler;
+        TAILQ_INSERT_TAIL(&queued_property_notifies, queued, notifies);
+    } else if (queued->state != XCB_PROPERTY_DELETE) {
+        xcb_discard_reply(conn, queued->cookie.sequence);
+    }
 
-    /* the handler will free() the reply unless it returns false */
-    if (!handler->cb(con, propr))
-        FREE(propr);
+    queued->state = state;
+    if (state != XCB_PROPERTY_DELETE) {
+        queued->cookie = xcb_get_property(conn, 0, window, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, handler->long_len);
+    }
 }
 
 /*
- * Takes an xcb_generic_event_t and calls the appropriate handler, based on the
- * event type.
+ * Handles the PropertyNotify events queued by property_notify(), then pushes
+ * or renders the tree once if any of the handlers changed it. Returns true if
+ * any events were queued.
  *
  */
-void handle_event(int type, xcb_generic_event_t *event) {
-    if (type != XCB_MOTION_NOTIFY)
-        DLOG("event type %d, xkb_base %d\n", type, xkb_base);
+bool handle_queued_property_notifies(void) {
+    if (TAILQ_EMPTY(&queued_property_notifies)) {
+        return false;
+    }
 
-    if (randr_base > -1 &&
-        type == randr_base + XCB_RANDR_SCREEN_CHANGE_NOTIFY) {
-        handle_screen_change(event);
-        return;
+    struct queued_property_notify *queued;
+    while ((queued = TAILQ_FIRST(&queued_property_notifies)) != NULL) {
+        TAILQ_REMOVE(&queued_property_notifies, queued, notifies);
+
+        const xcb_atom_t atom = queued->handler->atom;
+        xcb_get_property_reply_t *propr = NULL;
+        if (queued->state != XCB_PROPERTY_DELETE) {
+            xcb_generic_error_t *err = NULL;
+            propr = xcb_get_property_reply(conn, queued->cookie, &err);
+            if (err != NULL) {
+                DLOG("got error %d when getting property of atom %d\n", err->error_code, atom);
+                FREE(err);
+                free(queued);
+                continue;
+            }
+        }
+
+        /* The window might have been unmanaged by an earlier handler. */
+        Con *con = con_by_window_id(queued->window);
+        if (con == NULL || con->window == NULL) {
+            DLOG("Received property for atom %d for unknown client\n", atom);
+            FREE(propr);
+            free(queued);
+            continue;
+        }
+
+        /* Window properties are part of the GET_TREE reply. */
+        tree_note_change();
+
+        /* the handler will free() the reply unless it returns false */
+        if (!queued->handler->cb(con, propr))
+            FREE(propr);
+        free(queued);
     }
 
-    if (xkb_base > -1 && type == xkb_base) {
-        DLOG("xkb event, need to handle it.\n");
+    if (property_render_pending) {
+        tree_schedule_render();
+    } else if (property_push_pending) {
+        x_push_changes(croot);
+        tree_shm_update();
+    }
+    property_render_pending = false;
+    property_push_pending = false;
+    return true;
+}
 
-        xcb_xkb_state_notify_event_t *state = (xcb_xkb_state_notify_event_t *)event;
-        if (state->xkbType == XCB_XKB_NEW_KEYBOARD_NOTIFY) {
-            DLOG("xkb new keyboard notify, sequence %d, time %d\n", state->sequence, state->time);
+/*
+ * Handles the XKB events, which all share the XKB extension's event base.
+ *
+ */
+static void handle_xkb_event(xcb_generic_event_t *event) {
+    DLOG("xkb event, need to handle it.\n");
+
+    xcb_xkb_state_notify_event_t *state = (xcb_xkb_state_notify_event_t *)event;
+    if (state->xkbType == XCB_XKB_NEW_KEYBOARD_NOTIFY) {
+        DLOG("xkb new keyboard notify, sequence %d, time %d\n", state->sequence, state->time);
+        xcb_key_symbols_free(keysyms);
+        keysyms = xcb_key_symbols_alloc(conn);
+        if (((xcb_xkb_new_keyboard_notify_event_t *)event)->changed & XCB_XKB_NKN_DETAIL_KEYCODES)
+            (void)load_keymap();
+        ungrab_all_keys(conn);
+        translate_keysyms();
+        grab_all_keys(conn);
+    } else if (state->xkbType == XCB_XKB_MAP_NOTIFY) {
+        if (event_is_ignored(event->sequence, xkb_base)) {
+            DLOG("Ignoring map notify event for sequence %d.\n", state->sequence);
+        } else {
+            DLOG("xkb map notify, sequence %d, time %d\n", state->sequence, state->time);
+            add_ignore_event(event->sequence, xkb_base);
             xcb_key_symbols_free(keysyms);
             keysyms = xcb_key_symbols_alloc(conn);
-            if (((xcb_xkb_new_keyboard_notify_event_t *)event)->changed & XCB_XKB_NKN_DETAIL_KEYCODES)
-                (void)load_keymap();
             ungrab_all_keys(conn);
             translate_keysyms();
             grab_all_keys(conn);
-        } else if (state->xkbType == XCB_XKB_MAP_NOTIFY) {
-            if (event_is_ignored(event->sequence, type)) {
-                DLOG("Ignoring map notify event for sequence %d.\n", state->sequence);
-            } else {
-                DLOG("xkb map notify, sequence %d, time %d\n", state->sequence, state->time);
-                add_ignore_event(event->sequence, type);
-                xcb_key_symbols_free(keysyms);
-                keysyms = xcb_key_symbols_alloc(conn);
-                ungrab_all_keys(conn);
-                translate_keysyms();
-                grab_all_keys(conn);
-                (void)load_keymap();
-            }
-        } else if (state->xkbType == XCB_XKB_STATE_NOTIFY) {
-            DLOG("xkb state group = %d\n", state->group);
-            if (xkb_current_group == state->group)
-                return;
-            xkb_current_group = state->group;
-            ungrab_all_keys(conn);
-            grab_all_keys(conn);
+            (void)load_keymap();
         }
-
-        return;
+    } else if (state->xkbType == XCB_XKB_STATE_NOTIFY) {
+        DLOG("xkb state group = %d\n", state->group);
+        if (xkb_current_group == state->group)
+            return;
+        xkb_current_group = state->group;
+        grab_all_keys(conn);
     }
+}
 
-    if (shape_supported && type == shape_base + XCB_SHAPE_NOTIFY) {
-        xcb_shape_notify_event_t *shape = (xcb_shape_notify_event_t *)event;
+static void handle_shape_notify(xcb_generic_event_t *event) {
+    xcb_shape_notify_event_t *shape = (xcb_shape_notify_event_t *)event;
 
-        DLOG("shape_notify_event for window 0x%08x, shape_kind = %d, shaped = %d\n",
-             shape->affected_window, shape->shape_kind, shape->shaped);
+    DLOG("shape_notify_event for window 0x%08x, shape_kind = %d, shaped = %d\n",
+         shape->affected_window, shape->shape_kind, shape->shaped);
 
-        Con *con = con_by_window_id(shape->affected_window);
-        if (con == NULL) {
-            LOG("Not a managed window 0x%08x, ignoring shape_notify_event\n",
-                shape->affected_window);
-            return;
-        }
+    Con *con = con_by_window_id(shape->affected_window);
+    if (con == NULL) {
+        LOG("Not a managed window 0x%08x, ignoring shape_notify_event\n",
+            shape->affected_window);
+        return;
+    }
 
-        if (shape->shape_kind == XCB_SHAPE_SK_BOUNDING ||
-            shape->shape_kind == XCB_SHAPE_SK_INPUT) {
-            x_set_shape(con, shape->shape_kind, shape->shaped);
-        }
+    if (shape->shape_kind == XCB_SHAPE_SK_BOUNDING ||
+        shape->shape_kind == XCB_SHAPE_SK_INPUT) {
+        x_set_shape(con, shape->shape_kind, shape->shaped);
+    }
+}
 
+static void handle_property_notify(xcb_property_notify_event_t *event) {
+    last_timestamp = event->time;
+    if (event->window == root && event->atom == XCB_ATOM_RESOURCE_MANAGER) {
+        resource_database_changed();
         return;
     }
+    property_notify(event->state, event->window, event->atom);
+}
 
-    switch (type) {
-        case XCB_KEY_PRESS:
-        case XCB_KEY_RELEASE:
-            handle_key_press((xcb_key_press_event_t *)event);
-            break;
-
-        case XCB_BUTTON_PRESS:
-        case XCB_BUTTON_RELEASE:
-            handle_button_press((xcb_button_press_event_t *)event);
-            break;
+static void handle_expose(xcb_expose_event_t *event) {
+    if (event->count == 0) {
+        handle_expose_event(event);
+    }
+}
 
-        case XCB_MAP_REQUEST:
-            handle_map_request((xcb_map_request_event_t *)event);
-            break;
+typedef void (*event_handler_cb_t)(xcb_generic_event_t *event);
 
-        case XCB_UNMAP_NOTIFY:
-            handle_unmap_notify_event((xcb_unmap_notify_event_t *)event);
-            break;
+/* Defines an event_handler_cb_t which passes the event to the given handler,
+ * which takes the specific event type. */
+#define EVENT_HANDLER_CB(handler, event_type)              \
+    static void handler##_cb(xcb_generic_event_t *event) { \
+        handler((event_type *)event);                      \
+    }
 
-        case XCB_DESTROY_NOTIFY:
-            handle_destroy_notify_event((xcb_destroy_notify_event_t *)event);
-            break;
+EVENT_HANDLER_CB(handle_key_press, xcb_key_press_event_t)
+EVENT_HANDLER_CB(handle_button_press, xcb_button_press_event_t)
+EVENT_HANDLER_CB(handle_map_request, xcb_map_request_event_t)
+EVENT_HANDLER_CB(handle_unmap_notify_event, xcb_unmap_notify_event_t)
+EVENT_HANDLER_CB(handle_destroy_notify_event, xcb_destroy_notify_event_t)
+EVENT_HANDLER_CB(handle_expose, xcb_expose_event_t)
+EVENT_HANDLER_CB(handle_motion_notify, xcb_motion_notify_event_t)
+EVENT_HANDLER_CB(handle_enter_notify, xcb_enter_notify_event_t)
+EVENT_HANDLER_CB(handle_client_message, xcb_client_message_event_t)
+EVENT_HANDLER_CB(handle_configure_request, xcb_configure_request_event_t)
+EVENT_HANDLER_CB(handle_mapping_notify, xcb_mapping_notify_event_t)
+EVENT_HANDLER_CB(handle_focus_in, xcb_focus_in_event_t)
+EVENT_HANDLER_CB(handle_focus_out, xcb_focus_out_event_t)
+EVENT_HANDLER_CB(handle_property_notify, xcb_property_notify_event_t)
+EVENT_HANDLER_CB(handle_configure_notify, xcb_configure_notify_event_t)
+EVENT_HANDLER_CB(handle_selection_clear, xcb_selection_clear_event_t)
+
+/* The entries of the event dispatch table. Events without a callback are
+ * only counted. */
+struct event_handler_t {
+    const char *name;
+    event_handler_cb_t cb;
+    uint64_t count;
+    uint64_t total_us;
+};
 
-        case XCB_EXPOSE:
-            if (((xcb_expose_event_t *)event)->count == 0) {
-                handle_expose_event((xcb_expose_event_t *)event);
-            }
+/* Indexed by response type, which is 7 bits wide once the "generated" bit is
+ * stripped off. The extension events are added by event_handlers_init(). */
+static struct event_handler_t event_handlers[128] = {
+    [XCB_KEY_PRESS] = {"KeyPress", handle_key_press_cb},
+    [XCB_KEY_RELEASE] = {"KeyRelease", handle_key_press_cb},
+    [XCB_BUTTON_PRESS] = {"ButtonPress", handle_button_press_cb},
+    [XCB_BUTTON_RELEASE] = {"ButtonRelease", handle_button_press_cb},
+    [XCB_MOTION_NOTIFY] = {"MotionNotify", handle_motion_notify_cb},
+    /* Enter window = user moved their mouse over the window */
+    [XCB_ENTER_NOTIFY] = {"EnterNotify", handle_enter_notify_cb},
+    [XCB_LEAVE_NOTIFY] = {"LeaveNotify", NULL},
+    [XCB_FOCUS_IN] = {"FocusIn", handle_focus_in_cb},
+    [XCB_FOCUS_OUT] = {"FocusOut", handle_focus_out_cb},
+    [XCB_KEYMAP_NOTIFY] = {"KeymapNotify", NULL},
+    [XCB_EXPOSE] = {"Expose", handle_expose_cb},
+    [XCB_GRAPHICS_EXPOSURE] = {"GraphicsExposure", NULL},
+    [XCB_NO_EXPOSURE] = {"NoExposure", NULL},
+    [XCB_VISIBILITY_NOTIFY] = {"VisibilityNotify", NULL},
+    [XCB_CREATE_NOTIFY] = {"CreateNotify", NULL},
+    [XCB_DESTROY_NOTIFY] = {"DestroyNotify", handle_destroy_notify_event_cb},
+    [XCB_UNMAP_NOTIFY] = {"UnmapNotify", handle_unmap_notify_event_cb},
+    [XCB_MAP_NOTIFY] = {"MapNotify", NULL},
+    [XCB_MAP_REQUEST] = {"MapRequest", handle_map_request_cb},
+    [XCB_REPARENT_NOTIFY] = {"ReparentNotify", NULL},
+    [XCB_CONFIGURE_NOTIFY] = {"ConfigureNotify", handle_configure_notify_cb},
+    /* Configure request = window tried to change size on its own */
+    [XCB_CONFIGURE_REQUEST] = {"ConfigureRequest", handle_configure_request_cb},
+    [XCB_GRAVITY_NOTIFY] = {"GravityNotify", NULL},
+    [XCB_RESIZE_REQUEST] = {"ResizeRequest", NULL},
+    [XCB_CIRCULATE_NOTIFY] = {"CirculateNotify", NULL},
+    [XCB_CIRCULATE_REQUEST] = {"CirculateRequest", NULL},
+    [XCB_PROPERTY_NOTIFY] = {"PropertyNotify", handle_property_notify_cb},
+    [XCB_SELECTION_CLEAR] = {"SelectionClear", handle_selection_clear_cb},
+    [XCB_SELECTION_REQUEST] = {"SelectionRequest", NULL},
+    [XCB_SELECTION_NOTIFY] = {"SelectionNotify", NULL},
+    [XCB_COLORMAP_NOTIFY] = {"ColormapNotify", NULL},
+    /* Client message are sent to the root window. The only interesting
+     * client message for us is _NET_WM_STATE, we honour
+     * _NET_WM_STATE_FULLSCREEN and _NET_WM_STATE_DEMANDS_ATTENTION */
+    [XCB_CLIENT_MESSAGE] = {"ClientMessage", handle_client_message_cb},
+    /* Mapping notify = keyboard mapping changed (Xmodmap), re-grab bindings */
+    [XCB_MAPPING_NOTIFY] = {"MappingNotify", handle_mapping_notify_cb},
+    [XCB_GE_GENERIC] = {"GenericEvent", raw_pointer_handle_event},
+};
+#define NUM_EVENT_HANDLERS (sizeof(event_handlers) / sizeof(event_handlers[0]))
 
-            break;
+static void register_event_handler(int type, const char *name, event_handler_cb_t cb) {
+    if (type < 0 || (size_t)type >= NUM_EVENT_HANDLERS) {
+        ELOG("Cannot handle %s events, their response type %d is out of range\n", name, type);
+        return;
+    }
+    event_handlers[type].name = name;
+    event_handlers[type].cb = cb;
+}
 
-        case XCB_MOTION_NOTIFY:
-            handle_motion_notify((xcb_motion_notify_event_t *)event);
-            break;
+/*
+ * Adds the handlers for the events of the RandR, XKB and shape extensions to
+ * the event dispatch table, once their event bases are known.
+ *
+ */
+void event_handlers_init(void) {
+    if (randr_base > -1) {
+        register_event_handler(randr_base + XCB_RANDR_SCREEN_CHANGE_NOTIFY, "RandrScreenChangeNotify", handle_screen_change);
+    }
+    if (xkb_base > -1) {
+        register_event_handler(xkb_base, "XkbEvent", handle_xkb_event);
+    }
+    if (shape_supported) {
+        register_event_handler(shape_base + XCB_SHAPE_NOTIFY, "ShapeNotify", handle_shape_notify);
+    }
+}
 
-        /* Enter window = user moved their mouse over the window */
-        case XCB_ENTER_NOTIFY:
-            handle_enter_notify((xcb_enter_notify_event_t *)event);
-            break;
+/*
+ * Takes an xcb_generic_event_t and calls the appropriate handler, based on the
+ * event type.
+ *
+ */
+void handle_event(int type, xcb_generic_event_t *event) {
+    struct event_handler_t *handler = &event_handlers[type & 0x7F];
 
-        /* Client message are sent to the root window. The only interesting
-         * client message for us is _NET_WM_STATE, we honour
-         * _NET_WM_STATE_FULLSCREEN and _NET_WM_STATE_DEMANDS_ATTENTION */
-        case XCB_CLIENT_MESSAGE:
-            handle_client_message((xcb_client_message_event_t *)event);
-            break;
+    trace_event(event);
 
-        /* Configure request = window tried to change size on its own */
-        case XCB_CONFIGURE_REQUEST:
-            handle_configure_request((xcb_configure_request_event_t *)event);
-            break;
+    /* Not in event_is_ignored(), as queued events are looked at out of order
+     * (see compress_pointer_events()). */
+    retire_ignored_events(event->sequence);
 
-        /* Mapping notify = keyboard mapping changed (Xmodmap), re-grab bindings */
-        case XCB_MAPPING_NOTIFY:
-            handle_mapping_notify((xcb_mapping_notify_event_t *)event);
-            break;
+    /* Queued PropertyNotify events and ConfigureRequests are handled before
+     * any other event, so that the events are still handled in order. */
+    if (type != XCB_PROPERTY_NOTIFY) {
+        handle_queued_property_notifies();
+    }
+    if (type != XCB_CONFIGURE_REQUEST) {
+        handle_queued_configure_requests();
+    }
 
-        case XCB_FOCUS_IN:
-            handle_focus_in((xcb_focus_in_event_t *)event);
-            break;
+    if (type != XCB_MOTION_NOTIFY)
+        DLOG("event type %d (%s)\n", type, (handler->name != NULL ? handler->name : "unknown"));
 
-        case XCB_FOCUS_OUT:
-            handle_focus_out((xcb_focus_out_event_t *)event);
-            break;
+    /* Presses are timed until their result is flushed to X11. */
+    const bool is_press = (type == XCB_KEY_PRESS || type == XCB_BUTTON_PRESS);
+    if (is_press) {
+        stats_input_begin();
+    }
 
-        case XCB_PROPERTY_NOTIFY: {
-            xcb_property_notify_event_t *e = (xcb_property_notify_event_t *)event;
-            last_timestamp = e->time;
-            property_notify(e->state, e->window, e->atom);
-            break;
-        }
+    const uint64_t start = stats_now();
+    PROBE1(event_start, type);
+    if (handler->cb != NULL) {
+        handler->cb(event);
+    }
+    const uint64_t duration = stats_now() - start;
+    if (is_press) {
+        stats_input_end();
+    }
+    handler->count++;
+    handler->total_us += duration;
+    PROBE2(event_done, type, duration);
+}
 
-        case XCB_CONFIGURE_NOTIFY:
-            handle_configure_notify((xcb_configure_notify_event_t *)event);
-            break;
+static void dump_event_handler_name(yajl_gen gen, size_t type) {
+    if (event_handlers[type].name != NULL) {
+        ystr(event_handlers[type].name);
+    } else {
+        char *name;
+        sasprintf(&name, "%zu", type);
+        ystr(name);
+        free(name);
+    }
+}
 
-        case XCB_SELECTION_CLEAR:
-            handle_selection_clear((xcb_selection_clear_event_t *)event);
-            break;
+/*
+ * Serializes the number of events handled per event type and the total time
+ * spent handling them as members of the currently open JSON map.
+ *
+ */
+void event_handlers_dump(yajl_gen gen) {
+    ystr("x_events");
+    y(map_open);
+    for (size_t type = 0; type < NUM_EVENT_HANDLERS; type++) {
+        if (event_handlers[type].count == 0) {
+            continue;
+        }
+        dump_event_handler_name(gen, type);
+        y(integer, event_handlers[type].count);
+    }
+    y(map_close);
 
-        default:
-            /* DLOG("Unhandled event of type %d\n", type); */
-            break;
+    ystr("x_event_time_us");
+    y(map_open);
+    for (size_t type = 0; type < NUM_EVENT_HANDLERS; type++) {
+        if (event_handlers[type].count == 0) {
+            continue;
+        }
+        dump_event_handler_name(gen, type);
+        y(integer, event_handlers[type].total_us);
     }
+    y(map_close);
 }
@@ -0,0 +1,85 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * intern.c: Reference counted pool of strings shared between windows (window
+ *           class, instance, role and machine).
+ *
+ */
+#include "all.h"
+
+#include <stddef.h>
+
+struct interned_string {
+    int refcount;
+    uint64_t id;
+    char str[];
+};
+
+/* Interned strings by their contents. */
+static hashmap_t *interned_strings;
+static uint64_t next_id = 1;
+
+static struct interned_string *interned_from_str(const char *str) {
+    return (struct interned_string *)(str - offsetof(struct interned_string, str));
+}
+
+/*
+ * Returns the interned copy of the first len bytes of str (or up to the first
+ * NUL byte, whichever comes first). Equal strings are interned to the same
+ * pointer, so interned strings can be compared using ==. Every call returns a
+ * new reference, which has to be released using intern_release().
+ *
+ */
+char *intern_string(const char *str, size_t len) {
+    if (interned_strings == NULL) {
+        interned_strings = hashmap_new();
+    }
+
+    len = strnlen(str, len);
+    char *key = sstrndup(str, len);
+    struct interned_string *interned = hashmap_lookup_str(interned_strings, key);
+    if (interned != NULL) {
+        free(key);
+        interned->refcount++;
+        return interned->str;
+    }
+
+    interned = smalloc_counted(&memory_counters[MEM_PROPERTIES], sizeof(struct interned_string) + len + 1);
+    interned->refcount = 1;
+    interned->id = next_id++;
+    memcpy(interned->str, key, len + 1);
+    hashmap_insert_str(interned_strings, key, interned);
+    free(key);
+    return interned->str;
+}
+
+/*
+ * Releases a reference to the given interned string (which may be NULL). The
+ * string is freed once its last reference is gone.
+ *
+ */
+void intern_release(char *str) {
+    if (str == NULL) {
+        return;
+    }
+
+    struct interned_string *interned = interned_from_str(str);
+    if (--interned->refcount > 0) {
+        return;
+    }
+    hashmap_remove_str(interned_strings, interned->str);
+    free_counted(interned);
+}
+
+/*
+ * Returns a number identifying the given interned string. Unlike its address,
+ * the number is never reused for another string, so it can be used as a cache
+ * key (see regex_matches_interned()).
+ *
+ */
+uint64_t intern_id(const char *str) {
+    return interned_from_str(str)->id;
+}
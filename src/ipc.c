@@ -13,10 +13,12 @@
 
 #include <ev.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <libgen.h>
 #include <locale.h>
 #include <stdint.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 
@@ -27,8 +29,187 @@ char *current_socketpath = NULL;
 
 TAILQ_HEAD(ipc_client_head, ipc_client) all_clients = TAILQ_HEAD_INITIALIZER(all_clients);
 
+/* The names clients use to subscribe to events, indexed by event type (the
+ * lower bits of I3_IPC_EVENT_*). */
+static const char *event_names[] = {
+    "workspace",
+    "output",
+    "mode",
+    "window",
+    "barconfig_update",
+    "binding",
+    "shutdown",
+    "tick",
+    "tree",
+    "stats",
+};
+#define NUM_EVENT_TYPES (sizeof(event_names) / sizeof(event_names[0]))
+
+/* The names of the backpressure policies, see SET_BACKPRESSURE. */
+static const char *backpressure_names[] = {
+    [IPC_BACKPRESSURE_KILL] = "kill",
+    [IPC_BACKPRESSURE_DROP] = "drop",
+    [IPC_BACKPRESSURE_COALESCE] = "coalesce",
+};
+
+/* The names of the priority classes, see SET_PRIORITY, and the order in which
+ * events are delivered to them. */
+static const char *priority_names[] = {
+    [IPC_PRIORITY_NORMAL] = "normal",
+    [IPC_PRIORITY_INTERACTIVE] = "interactive",
+    [IPC_PRIORITY_BULK] = "bulk",
+};
+static const ipc_priority_t delivery_order[] = {
+    IPC_PRIORITY_INTERACTIVE,
+    IPC_PRIORITY_NORMAL,
+    IPC_PRIORITY_BULK,
+};
+
+/* Number of clients subscribed to each event type. */
+static int event_listeners[NUM_EVENT_TYPES];
+
+#define EVENT_BIT(message_type) (1U << ((message_type) & ~I3_IPC_EVENT_MASK))
+
+/* An immutable message (header and payload) as it is written to the socket.
+ * Events are serialized once and then referenced from the queue of every
+ * client which receives them. */
+struct ipc_message {
+    int refcount;
+    size_t size;
+    uint8_t data[];
+};
+
+struct ipc_queued_message {
+    struct ipc_message *message;
+    /* Set for X_SYNC replies until the X server processed the preceding
+     * requests, and for GET_TREE replies until they are serialized (message
+     * is NULL meanwhile). Neither the message nor any following one is
+     * written. */
+    bool blocked;
+    /* Set for events, which the backpressure policy may discard. */
+    bool event;
+    TAILQ_ENTRY(ipc_queued_message) entries;
+};
+
+/* Which of the subscribed clients an event is sent to, a combination of the
+ * flags below. Only window events are coalesced, see ipc_send_window_event(). */
+typedef enum {
+    RECIPIENTS_ALL = 0,
+    RECIPIENTS_COALESCED = (1 << 0),
+    RECIPIENTS_UNCOALESCED = (1 << 1),
+    /* Binding and window events come in a full and a compact form, see
+     * ipc_send_binding_event() and send_window_event(). */
+    RECIPIENTS_FULL_BINDING = (1 << 2),
+    RECIPIENTS_COMPACT_BINDING = (1 << 3),
+    RECIPIENTS_FULL_WINDOW = (1 << 4),
+    RECIPIENTS_COMPACT_WINDOW = (1 << 5),
+} event_recipients_t;
+
+/* What the filters of a subscription (see struct event_filter) are matched
+ * against. Only window, workspace and binding events have attributes. */
+typedef struct event_attributes {
+    char *change;
+    /* The container of window events */
+    long con_id;
+    /* Interned (see intern_string()), for regex_matches_interned() */
+    char *window_class;
+    char *window_instance;
+    /* The workspace and output of the container (window events) or of the
+     * workspace (workspace events) */
+    char *workspace;
+    char *output;
+} event_attributes_t;
+
+/* A filter given with SUBSCRIBE: the client only receives the events of the
+ * type which match at least one of its filters. Unset fields match
+ * everything. */
+struct event_filter {
+    char **changes;
+    size_t num_changes;
+    long con_id;
+    struct regex *window_class;
+    struct regex *window_instance;
+    char *workspace;
+    char *output;
+
+    struct event_filter *next;
+};
+
+/*
+ * Frees the given list of filters.
+ *
+ */
+static void event_filters_free(struct event_filter *filter) {
+    while (filter != NULL) {
+        struct event_filter *next = filter->next;
+        for (size_t i = 0; i < filter->num_changes; i++) {
+            free(filter->changes[i]);
+        }
+        free(filter->changes);
+        if (filter->window_class != NULL) {
+            regex_free(filter->window_class);
+        }
+        if (filter->window_instance != NULL) {
+            regex_free(filter->window_instance);
+        }
+        free(filter->workspace);
+        free(filter->output);
+        free(filter);
+        filter = next;
+    }
+}
+
+/* An event which is sent later: deferred while a batch of commands is open
+ * (see tree_batch_begin()), or serialized before the workspace it describes
+ * was closed (see ipc_prepare_workspace_event()). */
+struct ipc_prepared_event {
+    uint32_t message_type;
+    char *payload;
+    event_recipients_t recipients;
+    bool has_attributes;
+    event_attributes_t attributes;
+    TAILQ_ENTRY(ipc_prepared_event) events;
+};
+static TAILQ_HEAD(deferred_events_head, ipc_prepared_event) deferred_events =
+    TAILQ_HEAD_INITIALIZER(deferred_events);
+
+/* A window event which was recently sent for a container. Until the timer
+ * expires, further events with the same change are only sent to clients which
+ * opted out of coalescing; the latest state is sent to everyone else when the
+ * timer fires. */
+struct coalesced_event {
+    Con *con;
+    char *property;
+    bool pending;
+    ev_timer timer;
+    TAILQ_ENTRY(coalesced_event) events;
+};
+static TAILQ_HEAD(coalesced_events_head, coalesced_event) coalesced_events =
+    TAILQ_HEAD_INITIALIZER(coalesced_events);
+
+/* Serialized replies to GET_WORKSPACES, GET_OUTPUTS and GET_MARKS (one message
+ * per encoding). They are served from memory until reply_generation is bumped
+ * by ipc_invalidate_reply_cache(). */
+typedef enum {
+    CACHED_WORKSPACES,
+    CACHED_OUTPUTS,
+    CACHED_MARKS,
+    NUM_CACHED_REPLIES,
+} cached_reply_t;
+
+struct cached_reply {
+    uint64_t generation;
+    struct ipc_message *messages[2];
+};
+static struct cached_reply cached_replies[NUM_CACHED_REPLIES];
+static uint64_t reply_generation = 1;
+
+/* Maximum number of queued messages passed to a single writev() call. */
+#define IPC_MAX_IOV 64
+
 static void ipc_client_timeout(EV_P_ ev_timer *w, int revents);
 static void ipc_socket_writeable_cb(EV_P_ struct ev_io *w, int revents);
+static void stats_event_start(void);
 
 static ev_tstamp kill_timeout = 10.0;
 
@@ -36,23 +217,169 @@ void ipc_set_kill_timeout(ev_tstamp new) {
     kill_timeout = new;
 }
 
+ev_tstamp ipc_get_kill_timeout(void) {
+    return kill_timeout;
+}
+
+/* The backpressure policy of a client applies when queueing an event would
+ * exceed this many bytes, see ipc_queue_event(). 0 disables the limit. */
+static size_t queue_limit = 32 * 1024 * 1024;
+
+void ipc_set_queue_limit(long limit) {
+    queue_limit = (limit > 0 ? (size_t)limit : 0);
+}
+
+/*
+ * Creates a message with the given type and payload, holding one reference
+ * for the caller.
+ *
+ */
+static struct ipc_message *ipc_message_new(const uint32_t message_type, size_t size, const uint8_t *payload) {
+    const i3_ipc_header_t header = {
+        .magic = {'i', '3', '-', 'i', 'p', 'c'},
+        .size = size,
+        .type = message_type};
+    const size_t header_size = sizeof(i3_ipc_header_t);
+
+    struct ipc_message *message = smalloc_counted(&memory_counters[MEM_IPC], sizeof(struct ipc_message) + header_size + size);
+    message->refcount = 1;
+    message->size = header_size + size;
+    memcpy(message->data, ((void *)&header), header_size);
+    memcpy(message->data + header_size, payload, size);
+    return message;
+}
+
 /*
- * Try to write the contents of the pending buffer to the client's subscription
- * socket. Will set, reset or clear the timeout and io write callbacks depending
- * on the result of the write operation.
+ * Like ipc_message_new(), but converts the JSON payload into the given
+ * encoding first.
+ *
+ */
+static struct ipc_message *ipc_message_new_encoded(const uint32_t message_type, size_t size, const uint8_t *payload, ipc_encoding_t encoding) {
+    if (encoding == IPC_ENCODING_CBOR) {
+        uint8_t *cbor;
+        size_t cbor_size;
+        if (ipc_json_to_cbor(payload, size, &cbor, &cbor_size)) {
+            struct ipc_message *message = ipc_message_new(message_type, cbor_size, cbor);
+            free(cbor);
+            return message;
+        }
+        ELOG("Could not convert IPC message of type %d to CBOR, sending JSON\n", message_type);
+    }
+    return ipc_message_new(message_type, size, payload);
+}
+
+static void ipc_message_unref(struct ipc_message *message) {
+    if (--(message->refcount) == 0) {
+        free_counted(message);
+    }
+}
+
+/*
+ * Drops the first n bytes from the client's queue, releasing all messages
+ * which have been written completely.
+ *
+ */
+static void ipc_queue_consume(ipc_client *client, size_t n) {
+    client->bytes_sent += n;
+    client->queued_bytes -= n;
+    while (n > 0) {
+        struct ipc_queued_message *entry = TAILQ_FIRST(&(client->queue));
+        const size_t remaining = entry->message->size - client->queue_offset;
+        if (n < remaining) {
+            client->queue_offset += n;
+            return;
+        }
+
+        n -= remaining;
+        client->queue_offset = 0;
+        TAILQ_REMOVE(&(client->queue), entry, entries);
+        ipc_message_unref(entry->message);
+        free(entry);
+    }
+}
+
+/*
+ * Writes as much of the client's queue as the socket accepts without
+ * blocking. Returns the number of bytes written or -1 on error.
+ *
+ */
+static ssize_t ipc_queue_write(ipc_client *client) {
+    ssize_t written = 0;
+
+    while (!TAILQ_EMPTY(&(client->queue)) && !TAILQ_FIRST(&(client->queue))->blocked) {
+        struct iovec iov[IPC_MAX_IOV];
+        int count = 0;
+        size_t batch = 0;
+        size_t offset = client->queue_offset;
+
+        struct ipc_queued_message *entry;
+        TAILQ_FOREACH (entry, &(client->queue), entries) {
+            if (count == IPC_MAX_IOV || entry->blocked) {
+                break;
+            }
+            iov[count].iov_base = entry->message->data + offset;
+            iov[count].iov_len = entry->message->size - offset;
+            batch += iov[count].iov_len;
+            offset = 0;
+            count++;
+        }
+
+        const ssize_t n = writev(client->fd, iov, count);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN) {
+                break;
+            }
+            return n;
+        }
+
+        written += n;
+        ipc_queue_consume(client, (size_t)n);
+        if ((size_t)n < batch) {
+            break;
+        }
+    }
+
+    return written;
+}
+
+/*
+ * Starts the timer which disconnects the client if nothing can be written to
+ * it for kill_timeout seconds.
+ *
+ */
+static void ipc_client_start_timeout(ipc_client *client) {
+    struct ev_timer *timeout = scalloc(1, sizeof(struct ev_timer));
+    ev_timer_init(timeout, ipc_client_timeout, kill_timeout, 0.);
+    timeout->data = client;
+    client->timeout = timeout;
+    ev_set_priority(timeout, EV_MINPRI);
+    ev_timer_start(main_loop, client->timeout);
+}
+
+/*
+ * Try to write the pending messages to the client's subscription socket.
+ * Will set, reset or clear the timeout and io write callbacks depending on
+ * the result of the write operation.
  *
  */
 static void ipc_push_pending(ipc_client *client) {
-    const ssize_t result = writeall_nonblock(client->fd, client->buffer, client->buffer_size);
+    if (client->over_limit) {
+        /* The client is disconnected in the next event loop iteration, see
+         * ipc_queue_event(). */
+        return;
+    }
+
+    const ssize_t result = ipc_queue_write(client);
     if (result < 0) {
         return;
     }
 
-    if ((size_t)result == client->buffer_size) {
-        /* Everything was written successfully: clear the timer and stop the io
-         * callback. */
-        FREE(client->buffer);
-        client->buffer_size = 0;
+    if (TAILQ_EMPTY(&(client->queue)) || TAILQ_FIRST(&(client->queue))->blocked) {
+        /* Everything was written successfully (up to a blocked X_SYNC reply,
+         * which waits for the X server and not for the client): clear the
+         * timer and stop the io callback. */
         if (client->timeout) {
             ev_timer_stop(main_loop, client->timeout);
             FREE(client->timeout);
@@ -66,12 +393,7 @@ static void ipc_push_pending(ipc_client *client) {
     ev_io_start(main_loop, client->write_callback);
 
     if (!client->timeout) {
-        struct ev_timer *timeout = scalloc(1, sizeof(struct ev_timer));
-        ev_timer_init(timeout, ipc_client_timeout, kill_timeout, 0.);
-        timeout->data = client;
-        client->timeout = timeout;
-        ev_set_priority(timeout, EV_MINPRI);
-        ev_timer_start(main_loop, client->timeout);
+        ipc_client_start_timeout(client);
     } else if (result > 0) {
         /* Keep the old timeout when nothing is written. Otherwise, we would
          * keep a dead connection by continuously renewing its timeouts. */
@@ -79,42 +401,259 @@ static void ipc_push_pending(ipc_client *client) {
         ev_timer_set(client->timeout, kill_timeout, 0.0);
         ev_timer_start(main_loop, client->timeout);
     }
-    if (result == 0) {
+}
+
+static void ipc_queue_account(ipc_client *client, struct ipc_message *message) {
+    client->queued_bytes += message->size;
+    if (client->queued_bytes > client->queued_bytes_peak) {
+        client->queued_bytes_peak = client->queued_bytes;
+    }
+    PROBE3(ipc_send, client->fd, ((const i3_ipc_header_t *)message->data)->type, message->size);
+}
+
+/*
+ * Appends a reference to the given message (or a placeholder for it, if
+ * message is NULL) to the client's output queue without sending it.
+ *
+ */
+static struct ipc_queued_message *ipc_queue_insert(ipc_client *client, struct ipc_message *message, bool blocked) {
+    struct ipc_queued_message *entry = smalloc(sizeof(struct ipc_queued_message));
+    entry->message = message;
+    entry->blocked = blocked;
+    entry->event = false;
+    TAILQ_INSERT_TAIL(&(client->queue), entry, entries);
+    if (message != NULL) {
+        message->refcount++;
+        ipc_queue_account(client, message);
+    }
+    return entry;
+}
+
+/*
+ * Like ipc_queue_insert(), but also sends the message if the client's queue
+ * was empty, unless it is blocked.
+ *
+ */
+static struct ipc_queued_message *ipc_queue_append(ipc_client *client, struct ipc_message *message, bool blocked) {
+    const bool push_now = TAILQ_EMPTY(&(client->queue)) && !blocked;
+
+    struct ipc_queued_message *entry = ipc_queue_insert(client, message, blocked);
+    if (push_now) {
+        ipc_push_pending(client);
+    }
+    return entry;
+}
+
+/*
+ * Makes the write callback send the client's queue once the socket is
+ * writeable, which is in a later event loop iteration and after the watchers
+ * of higher priority (see ipc_set_priority()). Used for the events of bulk
+ * clients.
+ *
+ */
+static void ipc_push_later(ipc_client *client) {
+    if (client->over_limit || ev_is_active(client->write_callback)) {
         return;
     }
+    ev_io_start(main_loop, client->write_callback);
+    if (!client->timeout) {
+        ipc_client_start_timeout(client);
+    }
+}
+
+/*
+ * Appends a reference to the given message to the client's output queue.
+ * Also, send the message if the client's queue was empty.
+ *
+ */
+static void ipc_queue_message(ipc_client *client, struct ipc_message *message) {
+    ipc_queue_append(client, message, false);
+}
+
+/*
+ * Removes the queued events of the given type (or of all types, if
+ * message_type is 0) from the client's queue, except for one which was
+ * partially written already. Lagged events are kept. Returns the number of
+ * removed events.
+ *
+ */
+static uint64_t ipc_queue_drop_events(ipc_client *client, uint32_t message_type) {
+    uint64_t dropped = 0;
+    struct ipc_queued_message *entry = TAILQ_FIRST(&(client->queue));
+    if (entry != NULL && client->queue_offset > 0) {
+        entry = TAILQ_NEXT(entry, entries);
+    }
+    while (entry != NULL) {
+        struct ipc_queued_message *next = TAILQ_NEXT(entry, entries);
+        if (entry->event &&
+            (message_type == 0 || ((const i3_ipc_header_t *)entry->message->data)->type == message_type)) {
+            client->queued_bytes -= entry->message->size;
+            TAILQ_REMOVE(&(client->queue), entry, entries);
+            ipc_message_unref(entry->message);
+            free(entry);
+            dropped++;
+        }
+        entry = next;
+    }
+    return dropped;
+}
 
-    /* Shift the buffer to the left and reduce the allocated space. */
-    client->buffer_size -= (size_t)result;
-    memmove(client->buffer, client->buffer + result, client->buffer_size);
-    client->buffer = srealloc(client->buffer, client->buffer_size);
+/*
+ * Makes ipc_client_timeout() disconnect the client in the next event loop
+ * iteration. The client cannot be freed right away, as this might be called
+ * while one of its messages is being handled.
+ *
+ */
+static void ipc_client_kill_soon(ipc_client *client) {
+    if (client->timeout == NULL) {
+        client->timeout = scalloc(1, sizeof(struct ev_timer));
+        ev_timer_init(client->timeout, ipc_client_timeout, 0., 0.);
+        client->timeout->data = client;
+        ev_set_priority(client->timeout, EV_MINPRI);
+    } else {
+        ev_timer_stop(main_loop, client->timeout);
+        ev_timer_set(client->timeout, 0., 0.);
+    }
+    ev_timer_start(main_loop, client->timeout);
+}
+
+/*
+ * Like ipc_queue_message() for events: applies the client's backpressure
+ * policy if the queue would exceed the queue limit (a quarter of it for bulk
+ * clients). Clients which lost events are sent a lagged event in front of the
+ * next event which fits.
+ *
+ */
+static void ipc_queue_event(ipc_client *client, struct ipc_message *message) {
+    const uint32_t message_type = ((const i3_ipc_header_t *)message->data)->type;
+    const bool bulk = (client->priority == IPC_PRIORITY_BULK);
+    const size_t limit = (bulk ? queue_limit / 4 : queue_limit);
+
+    if (limit > 0 && !TAILQ_EMPTY(&(client->queue)) &&
+        client->queued_bytes + message->size > limit) {
+        switch (client->backpressure) {
+            case IPC_BACKPRESSURE_KILL:
+                if (!client->over_limit) {
+                    client->over_limit = true;
+                    ELOG("IPC client on fd %d exceeds the queue limit of %zu bytes, killing\n",
+                         client->fd, limit);
+                    ipc_client_kill_soon(client);
+                }
+                return;
+            case IPC_BACKPRESSURE_COALESCE: {
+                const uint64_t dropped = ipc_queue_drop_events(client, message_type);
+                client->dropped_events += dropped;
+                if (client->queued_bytes + message->size <= limit) {
+                    break;
+                }
+                /* Not enough, drop everything like IPC_BACKPRESSURE_DROP. */
+                client->lagged_events += dropped;
+            }
+            /* fall through */
+            case IPC_BACKPRESSURE_DROP: {
+                const uint64_t dropped = ipc_queue_drop_events(client, 0) + 1;
+                DLOG("IPC client on fd %d exceeds the queue limit of %zu bytes, dropped %" PRIu64 " events\n",
+                     client->fd, limit, dropped);
+                client->lagged_events += dropped;
+                client->dropped_events += dropped;
+                return;
+            }
+        }
+    }
+
+    if (client->lagged_events > 0) {
+        char *payload;
+        sasprintf(&payload, "{\"change\":\"lagged\",\"dropped_events\":%" PRIu64 "}", client->lagged_events);
+        struct ipc_message *lagged = ipc_message_new_encoded(I3_IPC_EVENT_LAGGED, strlen(payload), (const uint8_t *)payload, client->encoding);
+        ipc_queue_message(client, lagged);
+        ipc_message_unref(lagged);
+        free(payload);
+        client->lagged_events = 0;
+    }
+    if (bulk) {
+        ipc_queue_insert(client, message, false)->event = true;
+        ipc_push_later(client);
+    } else {
+        ipc_queue_append(client, message, false)->event = true;
+    }
 }
 
 /*
  * Given a message and a message type, create the corresponding header, merge it
- * with the message and append it to the given client's output buffer. Also,
- * send the message if the client's buffer was empty.
+ * with the message and append it to the given client's output queue. Also,
+ * send the message if the client's queue was empty.
  *
  */
 static void ipc_send_client_message(ipc_client *client, size_t size, const uint32_t message_type, const uint8_t *payload) {
-    const i3_ipc_header_t header = {
-        .magic = {'i', '3', '-', 'i', 'p', 'c'},
-        .size = size,
-        .type = message_type};
-    const size_t header_size = sizeof(i3_ipc_header_t);
-    const size_t message_size = header_size + size;
+    struct ipc_message *message = ipc_message_new_encoded(message_type, size, payload, client->encoding);
+    ipc_queue_message(client, message);
+    ipc_message_unref(message);
+}
 
-    const bool push_now = (client->buffer_size == 0);
-    client->buffer = srealloc(client->buffer, client->buffer_size + message_size);
-    memcpy(client->buffer + client->buffer_size, ((void *)&header), header_size);
-    memcpy(client->buffer + client->buffer_size + header_size, payload, size);
-    client->buffer_size += message_size;
+/*
+ * Invalidates the cached GET_WORKSPACES, GET_OUTPUTS and GET_MARKS replies.
+ * Called whenever workspaces, outputs or marks (may) have changed.
+ *
+ */
+void ipc_invalidate_reply_cache(void) {
+    reply_generation++;
+    tree_note_change();
+}
 
-    if (push_now) {
-        ipc_push_pending(client);
+/*
+ * Sends the cached reply to the client if it is still valid for the current
+ * generation and the client's encoding. Returns false if the reply has to be
+ * generated.
+ *
+ */
+static bool ipc_send_cached_reply(ipc_client *client, cached_reply_t which) {
+    struct cached_reply *cached = &cached_replies[which];
+    if (cached->generation != reply_generation || cached->messages[client->encoding] == NULL) {
+        return false;
     }
+    ipc_queue_message(client, cached->messages[client->encoding]);
+    return true;
 }
 
+/*
+ * Like ipc_send_client_message(), but also stores the message in the reply
+ * cache, replacing the replies of older generations.
+ *
+ */
+static void ipc_send_cacheable_reply(ipc_client *client, cached_reply_t which, size_t size, const uint32_t message_type, const uint8_t *payload) {
+    struct cached_reply *cached = &cached_replies[which];
+    if (cached->generation != reply_generation) {
+        for (int i = 0; i < 2; i++) {
+            if (cached->messages[i] != NULL) {
+                ipc_message_unref(cached->messages[i]);
+                cached->messages[i] = NULL;
+            }
+        }
+        cached->generation = reply_generation;
+    }
+
+    struct ipc_message *message = ipc_message_new_encoded(message_type, size, payload, client->encoding);
+    ipc_queue_message(client, message);
+    if (cached->messages[client->encoding] != NULL) {
+        ipc_message_unref(cached->messages[client->encoding]);
+    }
+    cached->messages[client->encoding] = message;
+}
+
+/* A GET_TREE reply which is serialized on the worker thread (see
+ * json_snapshot.c). The client is NULL when it disconnected meanwhile. */
+struct tree_job {
+    ipc_client *client;
+    struct ipc_queued_message *entry;
+
+    TAILQ_ENTRY(tree_job) jobs;
+};
+static TAILQ_HEAD(tree_jobs_head, tree_job) tree_jobs = TAILQ_HEAD_INITIALIZER(tree_jobs);
+
 static void free_ipc_client(ipc_client *client, int exempt_fd) {
+    tree_batch_client_gone(client);
+    sync_cancel(client);
+
     if (client->fd != exempt_fd) {
         DLOG("Disconnecting client on fd %d\n", client->fd);
         close(client->fd);
@@ -129,37 +668,290 @@ static void free_ipc_client(ipc_client *client, int exempt_fd) {
         FREE(client->timeout);
     }
 
-    free(client->buffer);
+    while (!TAILQ_EMPTY(&(client->queue))) {
+        struct ipc_queued_message *entry = TAILQ_FIRST(&(client->queue));
+        TAILQ_REMOVE(&(client->queue), entry, entries);
+        if (entry->message != NULL) {
+            ipc_message_unref(entry->message);
+        }
+        free(entry);
+    }
 
-    for (int i = 0; i < client->num_events; i++) {
-        free(client->events[i]);
+    if (client->freed != NULL) {
+        /* ipc_receive_message() is handling a message from the input buffer
+         * and frees it afterwards. */
+        *(client->freed) = true;
+    } else {
+        free(client->read_buffer);
     }
-    free(client->events);
+
+    struct tree_job *job;
+    TAILQ_FOREACH (job, &tree_jobs, jobs) {
+        if (job->client == client) {
+            job->client = NULL;
+        }
+    }
+
+    for (size_t i = 0; i < NUM_EVENT_TYPES; i++) {
+        if (client->event_mask & (1U << i)) {
+            event_listeners[i]--;
+        }
+        if (client->event_filters != NULL) {
+            event_filters_free(client->event_filters[i]);
+        }
+    }
+    free(client->event_filters);
     TAILQ_REMOVE(&all_clients, client, clients);
     free(client);
 }
 
 /*
- * Sends the specified event to all IPC clients which are currently connected
- * and subscribed to this kind of event.
+ * Fills in the attributes of an event about the given container (a window or
+ * a workspace). The strings are not copied.
  *
  */
-void ipc_send_event(const char *event, uint32_t message_type, const char *payload) {
+static void event_attributes_for_con(event_attributes_t *attributes, const char *change, Con *con) {
+    *attributes = (event_attributes_t){
+        .change = (char *)change,
+        .con_id = (long)con,
+    };
+    if (con->window != NULL) {
+        attributes->window_class = con->window->class_class;
+        attributes->window_instance = con->window->class_instance;
+    }
+    /* Walk up manually, the container might not be attached anymore. */
+    for (Con *walk = con; walk != NULL; walk = walk->parent) {
+        if (walk->type == CT_WORKSPACE && attributes->workspace == NULL) {
+            attributes->workspace = walk->name;
+        } else if (walk->type == CT_OUTPUT) {
+            attributes->output = walk->name;
+            break;
+        }
+    }
+}
+
+static void event_attributes_copy(event_attributes_t *dest, const event_attributes_t *src) {
+    dest->change = (src->change ? sstrdup(src->change) : NULL);
+    dest->con_id = src->con_id;
+    dest->window_class = (src->window_class ? intern_string(src->window_class, strlen(src->window_class)) : NULL);
+    dest->window_instance = (src->window_instance ? intern_string(src->window_instance, strlen(src->window_instance)) : NULL);
+    dest->workspace = (src->workspace ? sstrdup(src->workspace) : NULL);
+    dest->output = (src->output ? sstrdup(src->output) : NULL);
+}
+
+static void event_attributes_free(event_attributes_t *attributes) {
+    free(attributes->change);
+    intern_release(attributes->window_class);
+    intern_release(attributes->window_instance);
+    free(attributes->workspace);
+    free(attributes->output);
+}
+
+static bool event_filter_matches(struct event_filter *filter, const event_attributes_t *attributes) {
+    if (filter->num_changes > 0) {
+        if (attributes->change == NULL) {
+            return false;
+        }
+        bool found = false;
+        for (size_t i = 0; i < filter->num_changes && !found; i++) {
+            found = (strcmp(filter->changes[i], attributes->change) == 0);
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    if (filter->con_id != 0 && filter->con_id != attributes->con_id) {
+        return false;
+    }
+    if (filter->window_class != NULL && !regex_matches_interned(filter->window_class, attributes->window_class)) {
+        return false;
+    }
+    if (filter->window_instance != NULL && !regex_matches_interned(filter->window_instance, attributes->window_instance)) {
+        return false;
+    }
+    if (filter->workspace != NULL &&
+        (attributes->workspace == NULL || strcmp(filter->workspace, attributes->workspace) != 0)) {
+        return false;
+    }
+    if (filter->output != NULL &&
+        (attributes->output == NULL || strcmp(filter->output, attributes->output) != 0)) {
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Returns true if the client is subscribed to the event type and its filters
+ * match the attributes (which may be NULL for events without attributes).
+ *
+ */
+static bool ipc_client_wants_event(ipc_client *client, uint32_t message_type,
+                                   event_recipients_t recipients, const event_attributes_t *attributes) {
+    const uint32_t index = (message_type & ~I3_IPC_EVENT_MASK);
+    if (!(client->event_mask & EVENT_BIT(message_type))) {
+        return false;
+    }
+    if (((recipients & RECIPIENTS_COALESCED) && client->uncoalesced_window_events) ||
+        ((recipients & RECIPIENTS_UNCOALESCED) && !client->uncoalesced_window_events) ||
+        ((recipients & RECIPIENTS_FULL_BINDING) && client->compact_binding_events) ||
+        ((recipients & RECIPIENTS_COMPACT_BINDING) && !client->compact_binding_events) ||
+        ((recipients & RECIPIENTS_FULL_WINDOW) && client->compact_window_events) ||
+        ((recipients & RECIPIENTS_COMPACT_WINDOW) && !client->compact_window_events)) {
+        return false;
+    }
+    if (attributes == NULL || client->event_filters == NULL || client->event_filters[index] == NULL) {
+        return true;
+    }
+    for (struct event_filter *filter = client->event_filters[index]; filter != NULL; filter = filter->next) {
+        if (event_filter_matches(filter, attributes)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Returns true if at least one client would receive the event, so that
+ * events nobody wants are not even serialized.
+ *
+ */
+static bool ipc_event_wanted(uint32_t message_type, event_recipients_t recipients, const event_attributes_t *attributes) {
+    if (!ipc_has_event_listeners(message_type)) {
+        return false;
+    }
     ipc_client *current;
     TAILQ_FOREACH (current, &all_clients, clients) {
-        for (int i = 0; i < current->num_events; i++) {
-            if (strcasecmp(current->events[i], event) == 0) {
-                ipc_send_client_message(current, strlen(payload), message_type, (uint8_t *)payload);
-                break;
+        if (ipc_client_wants_event(current, message_type, recipients, attributes)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static struct ipc_prepared_event *ipc_prepared_event_new(uint32_t message_type, const char *payload,
+                                                         event_recipients_t recipients,
+                                                         const event_attributes_t *attributes) {
+    struct ipc_prepared_event *event = scalloc(1, sizeof(struct ipc_prepared_event));
+    event->message_type = message_type;
+    event->payload = sstrdup(payload);
+    event->recipients = recipients;
+    if (attributes != NULL) {
+        event->has_attributes = true;
+        event_attributes_copy(&(event->attributes), attributes);
+    }
+    return event;
+}
+
+static void ipc_prepared_event_free(struct ipc_prepared_event *event) {
+    if (event->has_attributes) {
+        event_attributes_free(&(event->attributes));
+    }
+    free(event->payload);
+    free(event);
+}
+
+/*
+ * Sends the specified event to the given recipients among the IPC clients
+ * which are subscribed to this kind of event and whose filters match the
+ * attributes (NULL for events without attributes).
+ *
+ */
+static void ipc_send_event_to(uint32_t message_type, const char *payload, event_recipients_t recipients,
+                              const event_attributes_t *attributes) {
+    if (!ipc_has_event_listeners(message_type)) {
+        return;
+    }
+
+    /* Tick events are used for synchronization and the shutdown event is sent
+     * right before i3 goes away, so neither of them can wait for a batch. */
+    if (tree_batch_active() &&
+        message_type != I3_IPC_EVENT_TICK &&
+        message_type != I3_IPC_EVENT_SHUTDOWN) {
+        struct ipc_prepared_event *event = ipc_prepared_event_new(message_type, payload, recipients, attributes);
+        TAILQ_INSERT_TAIL(&deferred_events, event, events);
+        return;
+    }
+
+    /* Serialize the event once per encoding and share it between all
+     * subscribers, which get it in the order of their priority classes. */
+    const size_t length = strlen(payload);
+    struct ipc_message *messages[2] = {NULL, NULL};
+    for (size_t i = 0; i < sizeof(delivery_order) / sizeof(delivery_order[0]); i++) {
+        ipc_client *current;
+        TAILQ_FOREACH (current, &all_clients, clients) {
+            if (current->priority != delivery_order[i] ||
+                !ipc_client_wants_event(current, message_type, recipients, attributes)) {
+                continue;
+            }
+            if (messages[current->encoding] == NULL) {
+                messages[current->encoding] = ipc_message_new_encoded(message_type, length, (const uint8_t *)payload, current->encoding);
             }
+            ipc_queue_event(current, messages[current->encoding]);
         }
     }
+    for (int i = 0; i < 2; i++) {
+        if (messages[i] != NULL) {
+            ipc_message_unref(messages[i]);
+        }
+    }
+}
+
+/*
+ * Sends the specified event to all IPC clients which are currently connected
+ * and subscribed to this kind of event.
+ *
+ */
+void ipc_send_event(uint32_t message_type, const char *payload) {
+    ipc_send_event_to(message_type, payload, RECIPIENTS_ALL, NULL);
+}
+
+/*
+ * Sends the events which were deferred while a batch of commands was open.
+ *
+ */
+void ipc_flush_deferred_events(void) {
+    while (!TAILQ_EMPTY(&deferred_events)) {
+        struct ipc_prepared_event *event = TAILQ_FIRST(&deferred_events);
+        TAILQ_REMOVE(&deferred_events, event, events);
+        ipc_send_event_to(event->message_type, event->payload, event->recipients,
+                          (event->has_attributes ? &(event->attributes) : NULL));
+        ipc_prepared_event_free(event);
+    }
+}
+
+/*
+ * Returns the number of connected IPC clients and the total size of their
+ * output queues. Messages sent to several clients are counted for each.
+ *
+ */
+void ipc_clients_memory(uint64_t *count, uint64_t *queued_bytes) {
+    *count = 0;
+    *queued_bytes = 0;
+    ipc_client *current;
+    TAILQ_FOREACH (current, &all_clients, clients) {
+        (*count)++;
+        *queued_bytes += current->queued_bytes;
+    }
+}
+
+/*
+ * Returns true if at least one IPC client is subscribed to the given event
+ * type (one of the I3_IPC_EVENT_* constants).
+ *
+ */
+bool ipc_has_event_listeners(uint32_t message_type) {
+    const uint32_t index = (message_type & ~I3_IPC_EVENT_MASK);
+    return (index < NUM_EVENT_TYPES && event_listeners[index] > 0);
 }
 
 /*
  * For shutdown events, we send the reason for the shutdown.
  */
 static void ipc_send_shutdown_event(shutdown_reason_t reason) {
+    if (!ipc_has_event_listeners(I3_IPC_EVENT_SHUTDOWN)) {
+        return;
+    }
+
     yajl_gen gen = ygenalloc();
     y(map_open);
 
@@ -177,11 +969,71 @@ static void ipc_send_shutdown_event(shutdown_reason_t reason) {
     ylength length;
 
     y(get_buf, &payload, &length);
-    ipc_send_event("shutdown", I3_IPC_EVENT_SHUTDOWN, (const char *)payload);
+    ipc_send_event(I3_IPC_EVENT_SHUTDOWN, (const char *)payload);
 
     y(free);
 }
 
+/*
+ * Points the symlink returned by ipc_socket_link_path() to the given socket,
+ * so that clients can find it without asking the X server, and exports the
+ * socket path as I3SOCK for all processes started by i3.
+ *
+ */
+void ipc_create_socket_link(const char *socketpath) {
+    setenv("I3SOCK", socketpath, 1);
+
+    char *link_path = ipc_socket_link_path();
+    if (link_path == NULL) {
+        return;
+    }
+
+    char *copy = sstrdup(link_path);
+    const char *dir = dirname(copy);
+    if (!path_exists(dir)) {
+        mkdirp(dir, DEFAULT_DIR_MODE);
+    }
+    free(copy);
+
+    /* Replace an existing (stale) link atomically, so that clients never see
+     * a missing link. */
+    char *tmp_path;
+    sasprintf(&tmp_path, "%s.%d", link_path, getpid());
+    unlink(tmp_path);
+    if (symlink(socketpath, tmp_path) == -1) {
+        ELOG("Could not create the IPC socket link %s: %s\n", tmp_path, strerror(errno));
+    } else if (rename(tmp_path, link_path) == -1) {
+        ELOG("Could not create the IPC socket link %s: %s\n", link_path, strerror(errno));
+        unlink(tmp_path);
+    } else {
+        DLOG("IPC socket link %s points to %s\n", link_path, socketpath);
+    }
+    free(tmp_path);
+    free(link_path);
+}
+
+/*
+ * Removes the symlink created by ipc_create_socket_link(), unless another
+ * i3 instance replaced it in the meantime.
+ *
+ */
+void ipc_remove_socket_link(const char *socketpath) {
+    char *link_path;
+    if (socketpath == NULL || (link_path = ipc_socket_link_path()) == NULL) {
+        return;
+    }
+
+    char target[PATH_MAX];
+    const ssize_t len = readlink(link_path, target, sizeof(target) - 1);
+    if (len != -1) {
+        target[len] = '\0';
+        if (strcmp(target, socketpath) == 0) {
+            unlink(link_path);
+        }
+    }
+    free(link_path);
+}
+
 /*
  * Calls shutdown() on each socket and closes it. This function is to be called
  * when exiting or restarting only!
@@ -206,18 +1058,144 @@ void ipc_shutdown(shutdown_reason_t reason, int exempt_fd) {
  * Executes the given command.
  *
  */
+/* State of add_command_timing() while copying the reply. */
+struct timing_copy {
+    yajl_gen gen;
+    int depth;
+    int result;
+    const CommandResult *command_result;
+    uint64_t render_us;
+    uint64_t push_us;
+};
+
+static int timing_copy_null(void *ctx) {
+    return yajl_gen_null(((struct timing_copy *)ctx)->gen) == yajl_gen_status_ok;
+}
+
+static int timing_copy_boolean(void *ctx, int val) {
+    return yajl_gen_bool(((struct timing_copy *)ctx)->gen, val) == yajl_gen_status_ok;
+}
+
+static int timing_copy_number(void *ctx, const char *val, size_t len) {
+    return yajl_gen_number(((struct timing_copy *)ctx)->gen, val, len) == yajl_gen_status_ok;
+}
+
+static int timing_copy_string(void *ctx, const unsigned char *val, size_t len) {
+    return yajl_gen_string(((struct timing_copy *)ctx)->gen, val, len) == yajl_gen_status_ok;
+}
+
+static int timing_copy_start_map(void *ctx) {
+    struct timing_copy *copy = ctx;
+    copy->depth++;
+    return yajl_gen_map_open(copy->gen) == yajl_gen_status_ok;
+}
+
+static int timing_copy_end_map(void *ctx) {
+    struct timing_copy *copy = ctx;
+    yajl_gen gen = copy->gen;
+    /* The results of the commands are the maps in the top-level array.
+     * Results without timing (parse errors) come last. */
+    if (--(copy->depth) == 1 && copy->result < copy->command_result->num_timings) {
+        const struct command_timing *timing = &(copy->command_result->timings[copy->result++]);
+        ystr("timing");
+        y(map_open);
+        ystr("parse_us");
+        y(integer, timing->parse_us);
+        ystr("exec_us");
+        y(integer, timing->exec_us);
+        /* The tree is rendered once, after all commands of the message. */
+        ystr("render_us");
+        y(integer, copy->render_us);
+        ystr("push_us");
+        y(integer, copy->push_us);
+        y(map_close);
+    }
+    return yajl_gen_map_close(gen) == yajl_gen_status_ok;
+}
+
+static int timing_copy_start_array(void *ctx) {
+    struct timing_copy *copy = ctx;
+    copy->depth++;
+    return yajl_gen_array_open(copy->gen) == yajl_gen_status_ok;
+}
+
+static int timing_copy_end_array(void *ctx) {
+    struct timing_copy *copy = ctx;
+    copy->depth--;
+    return yajl_gen_array_close(copy->gen) == yajl_gen_status_ok;
+}
+
+/*
+ * Returns a copy of the RUN_COMMAND reply in reply_gen with a timing map added
+ * to the result of each command (see SET_COMMAND_TIMING). The results are
+ * generated by the commands themselves, so they are only complete once all
+ * commands ran and the tree was rendered. Returns NULL if the reply cannot be
+ * copied, in which case it is sent without timing.
+ *
+ */
+static yajl_gen add_command_timing(yajl_gen reply_gen, const CommandResult *result, uint64_t render_us, uint64_t push_us) {
+    static yajl_callbacks callbacks = {
+        .yajl_null = timing_copy_null,
+        .yajl_boolean = timing_copy_boolean,
+        .yajl_number = timing_copy_number,
+        .yajl_string = timing_copy_string,
+        .yajl_start_map = timing_copy_start_map,
+        .yajl_map_key = timing_copy_string,
+        .yajl_end_map = timing_copy_end_map,
+        .yajl_start_array = timing_copy_start_array,
+        .yajl_end_array = timing_copy_end_array,
+    };
+    struct timing_copy copy = {
+        .gen = ygenalloc(),
+        .command_result = result,
+        .render_us = render_us,
+        .push_us = push_us,
+    };
+
+    const unsigned char *reply;
+    ylength length;
+    yajl_gen_get_buf(reply_gen, &reply, &length);
+    yajl_handle handle = yalloc(&callbacks, &copy);
+    yajl_status status = yajl_parse(handle, reply, length);
+    if (status == yajl_status_ok) {
+        status = yajl_complete_parse(handle);
+    }
+    yajl_free(handle);
+    if (status != yajl_status_ok) {
+        ELOG("Could not add the command timing to the reply\n");
+        yajl_gen_free(copy.gen);
+        return NULL;
+    }
+    return copy.gen;
+}
+
 IPC_HANDLER(run_command) {
     /* To get a properly terminated buffer, we copy
      * message_size bytes out of the buffer */
     char *command = sstrndup((const char *)message, message_size);
     LOG("IPC: received: *%.4000s*\n", command);
+    trace_command(command, strlen(command));
     yajl_gen gen = yajl_gen_alloc(NULL);
 
     CommandResult *result = parse_command(command, gen, client);
     free(command);
 
-    if (result->needs_tree_render)
+    uint64_t render_us = 0;
+    uint64_t push_us = 0;
+    if (result->needs_tree_render) {
+        const uint64_t start = stats_now();
         tree_render();
+        render_us = stats_now() - start;
+        push_us = stats_last_duration(STATS_X_PUSH_CHANGES);
+    }
+
+    if (client->command_timing) {
+        yajl_gen timed = add_command_timing(gen, result, render_us, push_us);
+        if (timed != NULL) {
+            yajl_gen_free(gen);
+            gen = timed;
+        }
+    }
 
     command_result_free(result);
 
@@ -231,6 +1209,15 @@ IPC_HANDLER(run_command) {
     yajl_gen_free(gen);
 }
 
+/* While set, dump_node() and its helpers record into this snapshot instead of
+ * writing to gen, see IPC_HANDLER(tree). */
+static json_snapshot_t *dump_snapshot = NULL;
+
+#undef y
+#undef ystr
+#define y(x, ...) (dump_snapshot != NULL ? json_snapshot_##x(dump_snapshot, ##__VA_ARGS__) : yajl_gen_##x(gen, ##__VA_ARGS__))
+#define ystr(str) (dump_snapshot != NULL ? json_snapshot_string(dump_snapshot, (const unsigned char *)(str), strlen(str)) : yajl_gen_string(gen, (unsigned char *)(str), strlen(str)))
+
 static void dump_rect(yajl_gen gen, const char *name, Rect r) {
     ystr(name);
     y(map_open);
@@ -309,6 +1296,9 @@ static void dump_event_state_mask(yajl_gen gen, Binding *bind) {
 
 static void dump_binding(yajl_gen gen, Binding *bind) {
     y(map_open);
+    ystr("id");
+    y(integer, bind->id);
+
     ystr("input_code");
     y(integer, bind->keycode);
 
@@ -335,214 +1325,315 @@ static void dump_binding(yajl_gen gen, Binding *bind) {
     y(map_close);
 }
 
+/*
+ * Restricts which parts of the tree dump_node() serializes, as requested in
+ * the payload of a GET_TREE message.
+ *
+ */
+struct dump_filter {
+    /* The root of the requested subtree, or NULL for croot. */
+    Con *root;
+    /* If non-NULL, only containers matching these criteria (below root) are
+     * serialized. */
+    Match *criteria;
+    /* Maximum depth of children below the serialized containers, or -1. */
+    int max_depth;
+    int depth;
+    /* The fields to serialize, or NULL for all fields. */
+    char **fields;
+    int num_fields;
+};
+
+static struct dump_filter *dump_filter = NULL;
+
+static bool dump_field(const char *name) {
+    if (dump_filter == NULL || dump_filter->fields == NULL) {
+        return true;
+    }
+
+    for (int i = 0; i < dump_filter->num_fields; i++) {
+        if (strcmp(dump_filter->fields[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool dump_children(void) {
+    return (dump_filter == NULL ||
+            dump_filter->max_depth < 0 ||
+            dump_filter->depth < dump_filter->max_depth);
+}
+
+static const char *floating_name(Con *con) {
+    switch (con->floating) {
+        case FLOATING_AUTO_OFF:
+            return "auto_off";
+        case FLOATING_AUTO_ON:
+            return "auto_on";
+        case FLOATING_USER_OFF:
+            return "user_off";
+        case FLOATING_USER_ON:
+            return "user_on";
+    }
+    return "auto_off";
+}
+
 void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
     y(map_open);
-    ystr("id");
-    y(integer, (uintptr_t)con);
+    if (dump_field("id")) {
+        ystr("id");
+        y(integer, (uintptr_t)con);
+    }
 
-    ystr("type");
-    switch (con->type) {
-        case CT_ROOT:
-            ystr("root");
-            break;
-        case CT_OUTPUT:
-            ystr("output");
-            break;
-        case CT_CON:
-            ystr("con");
-            break;
-        case CT_FLOATING_CON:
-            ystr("floating_con");
-            break;
-        case CT_WORKSPACE:
-            ystr("workspace");
-            break;
-        case CT_DOCKAREA:
-            ystr("dockarea");
-            break;
+    if (dump_field("type")) {
+        ystr("type");
+        switch (con->type) {
+            case CT_ROOT:
+                ystr("root");
+                break;
+            case CT_OUTPUT:
+                ystr("output");
+                break;
+            case CT_CON:
+                ystr("con");
+                break;
+            case CT_FLOATING_CON:
+                ystr("floating_con");
+                break;
+            case CT_WORKSPACE:
+                ystr("workspace");
+                break;
+            case CT_DOCKAREA:
+                ystr("dockarea");
+                break;
+        }
     }
 
-    /* provided for backwards compatibility only. */
-    ystr("orientation");
-    if (!con_is_split(con))
-        ystr("none");
-    else {
-        if (con_orientation(con) == HORIZ)
-            ystr("horizontal");
-        else
-            ystr("vertical");
+    if (con->type == CT_ROOT && !inplace_restart && dump_field("tree_generation")) {
+        ystr("tree_generation");
+        y(integer, tree_events_generation());
     }
 
-    ystr("scratchpad_state");
-    switch (con->scratchpad_state) {
-        case SCRATCHPAD_NONE:
+    if (dump_field("orientation")) {
+        /* provided for backwards compatibility only. */
+        ystr("orientation");
+        if (!con_is_split(con))
             ystr("none");
-            break;
-        case SCRATCHPAD_FRESH:
-            ystr("fresh");
-            break;
-        case SCRATCHPAD_CHANGED:
-            ystr("changed");
-            break;
+        else {
+            if (con_orientation(con) == HORIZ)
+                ystr("horizontal");
+            else
+                ystr("vertical");
+        }
     }
 
-    ystr("percent");
-    if (con->percent == 0.0)
-        y(null);
-    else
-        y(double, con->percent);
+    if (dump_field("scratchpad_state")) {
+        ystr("scratchpad_state");
+        switch (con->scratchpad_state) {
+            case SCRATCHPAD_NONE:
+                ystr("none");
+                break;
+            case SCRATCHPAD_FRESH:
+                ystr("fresh");
+                break;
+            case SCRATCHPAD_CHANGED:
+                ystr("changed");
+                break;
+        }
+    }
 
-    ystr("urgent");
-    y(bool, con->urgent);
+    if (dump_field("percent")) {
+        ystr("percent");
+        if (con->percent == 0.0)
+            y(null);
+        else
+            y(double, con->percent);
+    }
 
-    ystr("marks");
-    y(array_open);
-    mark_t *mark;
-    TAILQ_FOREACH (mark, &(con->marks_head), marks) {
-        ystr(mark->name);
+    if (dump_field("urgent")) {
+        ystr("urgent");
+        y(bool, con->urgent);
     }
-    y(array_close);
 
-    ystr("focused");
-    y(bool, (con == focused));
+    if (dump_field("marks")) {
+        ystr("marks");
+        y(array_open);
+        mark_t *mark;
+        TAILQ_FOREACH (mark, &(con->cold->marks_head), marks) {
+            ystr(mark->name);
+        }
+        y(array_close);
+    }
 
-    if (con->type != CT_ROOT && con->type != CT_OUTPUT) {
+    if (dump_field("focused")) {
+        ystr("focused");
+        y(bool, (con == focused));
+    }
+
+    if (con->type != CT_ROOT && con->type != CT_OUTPUT && dump_field("output")) {
         ystr("output");
         ystr(con_get_output(con)->name);
     }
 
-    ystr("layout");
-    switch (con->layout) {
-        case L_DEFAULT:
-            DLOG("About to dump layout=default, this is a bug in the code.\n");
-            assert(false);
-            break;
-        case L_SPLITV:
-            ystr("splitv");
-            break;
-        case L_SPLITH:
-            ystr("splith");
-            break;
-        case L_STACKED:
-            ystr("stacked");
-            break;
-        case L_TABBED:
-            ystr("tabbed");
-            break;
-        case L_DOCKAREA:
-            ystr("dockarea");
-            break;
-        case L_OUTPUT:
-            ystr("output");
-            break;
+    if (dump_field("layout")) {
+        ystr("layout");
+        switch (con->layout) {
+            case L_DEFAULT:
+                DLOG("About to dump layout=default, this is a bug in the code.\n");
+                assert(false);
+                break;
+            case L_SPLITV:
+                ystr("splitv");
+                break;
+            case L_SPLITH:
+                ystr("splith");
+                break;
+            case L_STACKED:
+                ystr("stacked");
+                break;
+            case L_TABBED:
+                ystr("tabbed");
+                break;
+            case L_DOCKAREA:
+                ystr("dockarea");
+                break;
+            case L_OUTPUT:
+                ystr("output");
+                break;
+        }
     }
 
-    ystr("workspace_layout");
-    switch (con->workspace_layout) {
-        case L_DEFAULT:
-            ystr("default");
-            break;
-        case L_STACKED:
-            ystr("stacked");
-            break;
-        case L_TABBED:
-            ystr("tabbed");
-            break;
-        default:
-            DLOG("About to dump workspace_layout=%d (none of default/stacked/tabbed), this is a bug.\n", con->workspace_layout);
-            assert(false);
-            break;
+    if (dump_field("workspace_layout")) {
+        ystr("workspace_layout");
+        switch (con->workspace_layout) {
+            case L_DEFAULT:
+                ystr("default");
+                break;
+            case L_STACKED:
+                ystr("stacked");
+                break;
+            case L_TABBED:
+                ystr("tabbed");
+                break;
+            default:
+                DLOG("About to dump workspace_layout=%d (none of default/stacked/tabbed), this is a bug.\n", con->workspace_layout);
+                assert(false);
+                break;
+        }
     }
 
-    ystr("last_split_layout");
-    switch (con->layout) {
-        case L_SPLITV:
-            ystr("splitv");
-            break;
-        default:
-            ystr("splith");
-            break;
+    if (dump_field("last_split_layout")) {
+        ystr("last_split_layout");
+        switch (con->layout) {
+            case L_SPLITV:
+                ystr("splitv");
+                break;
+            default:
+                ystr("splith");
+                break;
+        }
     }
 
-    ystr("border");
-    switch (con->border_style) {
-        case BS_NORMAL:
-            ystr("normal");
-            break;
-        case BS_NONE:
-            ystr("none");
-            break;
-        case BS_PIXEL:
-            ystr("pixel");
-            break;
+    if (dump_field("border")) {
+        ystr("border");
+        switch (con->border_style) {
+            case BS_NORMAL:
+                ystr("normal");
+                break;
+            case BS_NONE:
+                ystr("none");
+                break;
+            case BS_PIXEL:
+                ystr("pixel");
+                break;
+        }
     }
 
-    ystr("current_border_width");
-    y(integer, con->current_border_width);
+    if (dump_field("current_border_width")) {
+        ystr("current_border_width");
+        y(integer, con->current_border_width);
+    }
 
-    dump_rect(gen, "rect", con->rect);
-    dump_rect(gen, "deco_rect", con->deco_rect);
-    dump_rect(gen, "window_rect", con->window_rect);
-    dump_rect(gen, "geometry", con->geometry);
+    if (dump_field("rect")) {
+        dump_rect(gen, "rect", con->rect);
+    }
+    if (dump_field("deco_rect")) {
+        dump_rect(gen, "deco_rect", con->deco_rect);
+    }
+    if (dump_field("window_rect")) {
+        dump_rect(gen, "window_rect", con->window_rect);
+    }
+    if (dump_field("geometry")) {
+        dump_rect(gen, "geometry", con->geometry);
+    }
 
-    ystr("name");
-    if (con->window && con->window->name)
-        ystr(i3string_as_utf8(con->window->name));
-    else if (con->name != NULL)
-        ystr(con->name);
-    else
-        y(null);
+    if (dump_field("name")) {
+        ystr("name");
+        if (con->window && con->window->name)
+            ystr(i3string_as_utf8(con->window->name));
+        else if (con->name != NULL)
+            ystr(con->name);
+        else
+            y(null);
+    }
 
-    if (con->title_format != NULL) {
+    if (con->cold->title_format != NULL && dump_field("title_format")) {
         ystr("title_format");
-        ystr(con->title_format);
+        ystr(con->cold->title_format);
     }
 
-    ystr("window_icon_padding");
-    y(integer, con->window_icon_padding);
+    if (dump_field("window_icon_padding")) {
+        ystr("window_icon_padding");
+        y(integer, con->window_icon_padding);
+    }
 
-    if (con->type == CT_WORKSPACE) {
+    if (con->type == CT_WORKSPACE && dump_field("num")) {
         ystr("num");
         y(integer, con->num);
     }
 
-    ystr("window");
-    if (con->window)
-        y(integer, con->window->id);
-    else
-        y(null);
+    if (dump_field("window")) {
+        ystr("window");
+        if (con->window)
+            y(integer, con->window->id);
+        else
+            y(null);
+    }
 
-    ystr("window_type");
-    if (con->window) {
-        if (con->window->window_type == A__NET_WM_WINDOW_TYPE_NORMAL) {
-            ystr("normal");
-        } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_DOCK) {
-            ystr("dock");
-        } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_DIALOG) {
-            ystr("dialog");
-        } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_UTILITY) {
-            ystr("utility");
-        } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_TOOLBAR) {
-            ystr("toolbar");
-        } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_SPLASH) {
-            ystr("splash");
-        } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_MENU) {
-            ystr("menu");
-        } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_DROPDOWN_MENU) {
-            ystr("dropdown_menu");
-        } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_POPUP_MENU) {
-            ystr("popup_menu");
-        } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_TOOLTIP) {
-            ystr("tooltip");
-        } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_NOTIFICATION) {
-            ystr("notification");
-        } else {
-            ystr("unknown");
-        }
-    } else
-        y(null);
+    if (dump_field("window_type")) {
+        ystr("window_type");
+        if (con->window) {
+            if (con->window->window_type == A__NET_WM_WINDOW_TYPE_NORMAL) {
+                ystr("normal");
+            } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_DOCK) {
+                ystr("dock");
+            } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_DIALOG) {
+                ystr("dialog");
+            } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_UTILITY) {
+                ystr("utility");
+            } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_TOOLBAR) {
+                ystr("toolbar");
+            } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_SPLASH) {
+                ystr("splash");
+            } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_MENU) {
+                ystr("menu");
+            } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_DROPDOWN_MENU) {
+                ystr("dropdown_menu");
+            } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_POPUP_MENU) {
+                ystr("popup_menu");
+            } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_TOOLTIP) {
+                ystr("tooltip");
+            } else if (con->window->window_type == A__NET_WM_WINDOW_TYPE_NOTIFICATION) {
+                ystr("notification");
+            } else {
+                ystr("unknown");
+            }
+        } else
+            y(null);
+    }
 
-    if (con->window && !inplace_restart) {
+    if (con->window && !inplace_restart && dump_field("window_properties")) {
         /* Window properties are useless to preserve when restarting because
          * they will be queried again anyway. However, for i3-save-tree(1),
          * they are very useful and save i3-save-tree dealing with X11. */
@@ -576,10 +1667,17 @@ void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
         y(map_close);
     }
 
+    /* The children are always included so that the structure of the tree is
+     * kept, but only up to the requested depth. */
+    Con *node;
+    const bool children = dump_children();
+    if (dump_filter != NULL) {
+        dump_filter->depth++;
+    }
+
     ystr("nodes");
     y(array_open);
-    Con *node;
-    if (con->type != CT_DOCKAREA || !inplace_restart) {
+    if (children && (con->type != CT_DOCKAREA || !inplace_restart)) {
         TAILQ_FOREACH (node, &(con->nodes_head), nodes) {
             dump_node(gen, node, inplace_restart);
         }
@@ -588,85 +1686,95 @@ void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
 
     ystr("floating_nodes");
     y(array_open);
-    TAILQ_FOREACH (node, &(con->floating_head), floating_windows) {
-        dump_node(gen, node, inplace_restart);
+    if (children) {
+        TAILQ_FOREACH (node, &(con->floating_head), floating_windows) {
+            dump_node(gen, node, inplace_restart);
+        }
+    }
+    y(array_close);
+
+    if (dump_filter != NULL) {
+        dump_filter->depth--;
+    }
+
+    /* Tell containers whose children were left out apart from leaves. */
+    if (!children && (!TAILQ_EMPTY(&(con->nodes_head)) || !TAILQ_EMPTY(&(con->floating_head)))) {
+        ystr("truncated");
+        y(bool, true);
     }
-    y(array_close);
 
-    ystr("focus");
-    y(array_open);
-    TAILQ_FOREACH (node, &(con->focus_head), focused) {
-        y(integer, (uintptr_t)node);
+    if (dump_field("focus")) {
+        ystr("focus");
+        y(array_open);
+        TAILQ_FOREACH (node, &(con->focus_head), focused) {
+            y(integer, (uintptr_t)node);
+        }
+        y(array_close);
     }
-    y(array_close);
 
-    ystr("fullscreen_mode");
-    y(integer, con->fullscreen_mode);
+    if (dump_field("fullscreen_mode")) {
+        ystr("fullscreen_mode");
+        y(integer, con->fullscreen_mode);
+    }
 
-    ystr("sticky");
-    y(bool, con->sticky);
+    if (dump_field("sticky")) {
+        ystr("sticky");
+        y(bool, con->sticky);
+    }
 
-    ystr("floating");
-    switch (con->floating) {
-        case FLOATING_AUTO_OFF:
-            ystr("auto_off");
-            break;
-        case FLOATING_AUTO_ON:
-            ystr("auto_on");
-            break;
-        case FLOATING_USER_OFF:
-            ystr("user_off");
-            break;
-        case FLOATING_USER_ON:
-            ystr("user_on");
-            break;
+    if (dump_field("floating")) {
+        ystr("floating");
+        ystr(floating_name(con));
     }
 
-    ystr("swallows");
-    y(array_open);
-    Match *match;
-    TAILQ_FOREACH (match, &(con->swallow_head), matches) {
-        /* We will generate a new restart_mode match specification after this
-         * loop, so skip this one. */
-        if (match->restart_mode)
-            continue;
-        y(map_open);
-        if (match->dock != M_DONTCHECK) {
-            ystr("dock");
-            y(integer, match->dock);
-            ystr("insert_where");
-            y(integer, match->insert_where);
-        }
+    if (dump_field("swallows")) {
+        ystr("swallows");
+        y(array_open);
+        Match *match;
+        TAILQ_FOREACH (match, &(con->cold->swallow_head), matches) {
+            /* We will generate a new restart_mode match specification after this
+             * loop, so skip this one. */
+            if (match->restart_mode)
+                continue;
+            y(map_open);
+            if (match->dock != M_DONTCHECK) {
+                ystr("dock");
+                y(integer, match->dock);
+                ystr("insert_where");
+                y(integer, match->insert_where);
+            }
 
-#define DUMP_REGEX(re_name)                \
-    do {                                   \
-        if (match->re_name != NULL) {      \
-            ystr(#re_name);                \
-            ystr(match->re_name->pattern); \
-        }                                  \
+#define DUMP_REGEX(re_name, type)                             \
+    do {                                                      \
+        struct regex *regex = match_get_regex(match, (type)); \
+        if (regex != NULL) {                                  \
+            ystr(#re_name);                                   \
+            ystr(regex->pattern);                             \
+        }                                                     \
     } while (0)
 
-        DUMP_REGEX(class);
-        DUMP_REGEX(instance);
-        DUMP_REGEX(window_role);
-        DUMP_REGEX(title);
-        DUMP_REGEX(machine);
+            DUMP_REGEX(class, CRIT_CLASS);
+            DUMP_REGEX(instance, CRIT_INSTANCE);
+            DUMP_REGEX(window_role, CRIT_WINDOW_ROLE);
+            DUMP_REGEX(title, CRIT_TITLE);
+            DUMP_REGEX(machine, CRIT_MACHINE);
 
 #undef DUMP_REGEX
-        y(map_close);
-    }
-
-    if (inplace_restart) {
-        if (con->window != NULL) {
-            y(map_open);
-            ystr("id");
-            y(integer, con->window->id);
-            ystr("restart_mode");
-            y(bool, true);
             y(map_close);
         }
+
+        if (inplace_restart) {
+            if (con->window != NULL) {
+                y(map_open);
+                ystr("id");
+                y(integer, con->window->id);
+                ystr("restart_mode");
+                y(bool, true);
+                y(map_close);
+            }
+        }
+        y(array_close);
     }
-    y(array_close);
 
     if (inplace_restart && con->window != NULL) {
         ystr("depth");
@@ -681,6 +1789,11 @@ void dump_node(yajl_gen gen, struct Con *con, bool inplace_restart) {
     y(map_close);
 }
 
+#undef y
+#undef ystr
+#define y(x, ...) yajl_gen_##x(gen, ##__VA_ARGS__)
+#define ystr(str) yajl_gen_string(gen, (unsigned char *)str, strlen(str))
+
 static void dump_bar_bindings(yajl_gen gen, Barconfig *config) {
     if (TAILQ_EMPTY(&(config->bar_bindings)))
         return;
@@ -808,6 +1921,9 @@ static void dump_bar_config(yajl_gen gen, Barconfig *config) {
     ystr("workspace_min_width");
     y(integer, config->workspace_min_width);
 
+    ystr("status_update_interval");
+    y(integer, config->status_update_interval);
+
     ystr("strip_workspace_numbers");
     y(bool, config->strip_workspace_numbers);
 
@@ -858,27 +1974,599 @@ static void dump_bar_config(yajl_gen gen, Barconfig *config) {
 #undef YSTR_IF_SET
 }
 
-IPC_HANDLER(tree) {
-    setlocale(LC_NUMERIC, "C");
+struct tree_request_state {
+    struct dump_filter *filter;
+    char *last_key;
+    bool in_fields;
+    bool in_criteria;
+    int map_depth;
+    long long if_newer_than;
+    bool chunked;
+    char *error;
+};
+
+static int _tree_json_key(void *extra, const unsigned char *val, size_t len) {
+    struct tree_request_state *state = extra;
+    FREE(state->last_key);
+    state->last_key = sstrndup((const char *)val, len);
+    return 1;
+}
+
+static int _tree_json_start_map(void *extra) {
+    struct tree_request_state *state = extra;
+    state->map_depth++;
+    if (state->map_depth == 2 && state->last_key != NULL &&
+        strcasecmp(state->last_key, "criteria") == 0 &&
+        state->filter->criteria == NULL) {
+        state->filter->criteria = pool_alloc(&match_pool);
+        match_init(state->filter->criteria);
+        state->in_criteria = true;
+    }
+    return 1;
+}
+
+static int _tree_json_end_map(void *extra) {
+    struct tree_request_state *state = extra;
+    state->map_depth--;
+    state->in_criteria = false;
+    return 1;
+}
+
+static int _tree_json_start_array(void *extra) {
+    struct tree_request_state *state = extra;
+    state->in_fields = (state->map_depth == 1 && state->last_key != NULL &&
+                        strcasecmp(state->last_key, "fields") == 0);
+    if (state->in_fields && state->filter->fields == NULL) {
+        /* An empty list of fields still only serializes the children. */
+        state->filter->fields = smalloc(sizeof(char *));
+    }
+    return 1;
+}
+
+static int _tree_json_end_array(void *extra) {
+    struct tree_request_state *state = extra;
+    state->in_fields = false;
+    return 1;
+}
+
+static int _tree_json_string(void *extra, const unsigned char *val, size_t len) {
+    struct tree_request_state *state = extra;
+    struct dump_filter *filter = state->filter;
+    char *str = sstrndup((const char *)val, len);
+
+    if (state->in_fields) {
+        filter->fields = srealloc(filter->fields, (filter->num_fields + 1) * sizeof(char *));
+        filter->fields[filter->num_fields++] = str;
+        return 1;
+    }
+
+    if (state->in_criteria && state->last_key != NULL) {
+        match_parse_property(filter->criteria, state->last_key, str);
+        if (filter->criteria->error != NULL && state->error == NULL) {
+            state->error = sstrdup(filter->criteria->error);
+        }
+    }
+    free(str);
+    return 1;
+}
+
+static int _tree_json_int(void *extra, long long val) {
+    struct tree_request_state *state = extra;
+    if (state->map_depth != 1 || state->last_key == NULL) {
+        return 1;
+    }
+
+    if (strcasecmp(state->last_key, "root") == 0) {
+        state->filter->root = con_by_con_id(val);
+        if (state->filter->root == NULL && state->error == NULL) {
+            state->error = sstrdup("No container with the given root id");
+        }
+    } else if (strcasecmp(state->last_key, "depth") == 0) {
+        state->filter->max_depth = (val < 0 ? -1 : (int)val);
+    } else if (strcasecmp(state->last_key, "if_newer_than") == 0) {
+        state->if_newer_than = max(val, 0);
+    }
+    return 1;
+}
+
+static int _tree_json_bool(void *extra, int val) {
+    struct tree_request_state *state = extra;
+    if (state->map_depth == 1 && state->last_key != NULL &&
+        strcasecmp(state->last_key, "chunked") == 0) {
+        state->chunked = val;
+    }
+    return 1;
+}
+
+static void free_dump_filter(struct dump_filter *filter) {
+    for (int i = 0; i < filter->num_fields; i++) {
+        free(filter->fields[i]);
+    }
+    free(filter->fields);
+    if (filter->criteria != NULL) {
+        match_free(filter->criteria);
+        pool_free(&match_pool, filter->criteria);
+    }
+}
+
+/*
+ * Returns true if the container matches the criteria of a GET_TREE request.
+ * Like command criteria, window-specific criteria do not match window-less
+ * containers.
+ *
+ */
+static bool tree_criteria_matches(Match *criteria, Con *con) {
+    bool accept_match = false;
+
+    struct match_criterion *con_id = match_get(criteria, CRIT_CON_ID);
+    if (con_id != NULL) {
+        if (con_id->con_id != con) {
+            return false;
+        }
+        accept_match = true;
+    }
+
+    struct regex *mark = match_get_regex(criteria, CRIT_MARK);
+    if (mark != NULL && !TAILQ_EMPTY(&(con->cold->marks_head))) {
+        if (!con_has_mark_matching(con, mark)) {
+            return false;
+        }
+        accept_match = true;
+    }
+
+    if (con->window != NULL) {
+        if (!match_matches_window(criteria, con->window)) {
+            return false;
+        }
+        accept_match = true;
+    }
+
+    return accept_match;
+}
+
+static void dump_matching_nodes(yajl_gen gen, Con *con, Match *criteria) {
+    if (tree_criteria_matches(criteria, con)) {
+        dump_node(gen, con, false);
+    }
+
+    Con *child;
+    TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
+        dump_matching_nodes(gen, child, criteria);
+    }
+    TAILQ_FOREACH (child, &(con->floating_head), floating_windows) {
+        dump_matching_nodes(gen, child, criteria);
+    }
+}
+
+/* Options in the payload of GET_WORKSPACES, GET_OUTPUTS and
+ * GET_BINDING_MODES requests, see ipc_parse_request_options(). */
+struct request_options {
+    /* The generation of an earlier reply, or -1 for unconditional
+     * requests. */
+    long long if_newer_than;
+    /* Whether GET_BINDING_MODES should include the bindings. */
+    bool bindings;
+};
+
+struct request_options_state {
+    char *last_key;
+    int map_depth;
+    struct request_options *options;
+};
+
+static int _request_options_key(void *extra, const unsigned char *val, size_t len) {
+    struct request_options_state *state = extra;
+    FREE(state->last_key);
+    state->last_key = sstrndup((const char *)val, len);
+    return 1;
+}
+
+static int _request_options_start_map(void *extra) {
+    struct request_options_state *state = extra;
+    state->map_depth++;
+    return 1;
+}
+
+static int _request_options_end_map(void *extra) {
+    struct request_options_state *state = extra;
+    state->map_depth--;
+    return 1;
+}
+
+static int _request_options_int(void *extra, long long val) {
+    struct request_options_state *state = extra;
+    if (state->map_depth == 1 && state->last_key != NULL &&
+        strcasecmp(state->last_key, "if_newer_than") == 0) {
+        state->options->if_newer_than = max(val, 0);
+    }
+    return 1;
+}
+
+static int _request_options_bool(void *extra, int val) {
+    struct request_options_state *state = extra;
+    if (state->map_depth == 1 && state->last_key != NULL &&
+        strcasecmp(state->last_key, "bindings") == 0) {
+        state->options->bindings = val;
+    }
+    return 1;
+}
+
+/*
+ * Parses the optional payload of a GET_WORKSPACES, GET_OUTPUTS or
+ * GET_BINDING_MODES request, a JSON map with "if_newer_than" (the generation
+ * of an earlier reply) or "bindings". Invalid payloads, which were ignored
+ * before, are treated like an empty payload.
+ *
+ */
+static struct request_options ipc_parse_request_options(const uint8_t *message, uint32_t message_size) {
+    struct request_options options = {.if_newer_than = -1, .bindings = false};
+    if (message_size == 0) {
+        return options;
+    }
+
+    static yajl_callbacks callbacks = {
+        .yajl_map_key = _request_options_key,
+        .yajl_start_map = _request_options_start_map,
+        .yajl_end_map = _request_options_end_map,
+        .yajl_integer = _request_options_int,
+        .yajl_boolean = _request_options_bool,
+    };
+
+    struct request_options parsed = options;
+    struct request_options_state state = {.options = &parsed};
+    yajl_handle p = yalloc(&callbacks, (void *)&state);
+    yajl_status stat = yajl_parse(p, (const unsigned char *)message, message_size);
+    if (stat == yajl_status_ok) {
+        stat = yajl_complete_parse(p);
+    }
+    yajl_free(p);
+    FREE(state.last_key);
+    return (stat == yajl_status_ok ? parsed : options);
+}
+
+/*
+ * Replies to a conditional request with {"generation":…,"unchanged":true} if
+ * the tree did not change since the generation the client passed in
+ * if_newer_than. Returns false if the full reply has to be sent.
+ *
+ */
+static bool ipc_send_unchanged_reply(ipc_client *client, const uint32_t message_type, long long if_newer_than) {
+    /* A generation newer than ours stems from before a restart. */
+    if (if_newer_than < 0 || (uint64_t)if_newer_than != tree_generation()) {
+        return false;
+    }
+
     yajl_gen gen = ygenalloc();
-    dump_node(gen, croot, false);
-    setlocale(LC_NUMERIC, "");
+    y(map_open);
+    ystr("generation");
+    y(integer, tree_generation());
+    ystr("unchanged");
+    y(bool, true);
+    y(map_close);
 
     const unsigned char *payload;
     ylength length;
     y(get_buf, &payload, &length);
+    ipc_send_client_message(client, length, message_type, payload);
+    y(free);
+    return true;
+}
+
+/*
+ * Starts the map which wraps the reply to a conditional request whose tree
+ * changed. The caller generates the usual reply and closes the map.
+ *
+ */
+static void ipc_conditional_reply_open(yajl_gen gen) {
+    y(map_open);
+    ystr("generation");
+    y(integer, tree_generation());
+    ystr("unchanged");
+    y(bool, false);
+    ystr("reply");
+}
+
+/* GET_TREE replies whose snapshot is at least this large are serialized on
+ * the worker thread. For smaller ones, handing them over costs more than it
+ * saves. */
+#define TREE_ASYNC_THRESHOLD (64 * 1024)
+
+/*
+ * Called on the main thread once a GET_TREE reply was serialized. Fills in
+ * its placeholder in the client's queue.
+ *
+ */
+static void ipc_tree_job_done(const uint8_t *payload, size_t size, void *data) {
+    struct tree_job *job = data;
+    TAILQ_REMOVE(&tree_jobs, job, jobs);
+
+    ipc_client *client = job->client;
+    if (client != NULL) {
+        /* The payload is already encoded for the client. */
+        struct ipc_message *message = ipc_message_new(I3_IPC_REPLY_TYPE_TREE, size, payload);
+        job->entry->message = message;
+        job->entry->blocked = false;
+        ipc_queue_account(client, message);
+        ipc_push_pending(client);
+    }
+    free(job);
+}
+
+/* Size of the payload of each message of a chunked GET_TREE reply. */
+#define TREE_CHUNK_SIZE (64 * 1024)
+
+/* A chunked GET_TREE reply which is being generated. The current chunk is
+ * allocated as a message, so the JSON is written right into it. */
+struct tree_stream {
+    ipc_client *client;
+    struct ipc_message *chunk;
+    size_t used;
+};
+
+/*
+ * Queues the current chunk, if any, which sends it right away unless the
+ * client is still busy with earlier messages.
+ *
+ */
+static void tree_stream_flush(struct tree_stream *stream) {
+    if (stream->chunk == NULL) {
+        return;
+    }
+
+    const i3_ipc_header_t header = {
+        .magic = {'i', '3', '-', 'i', 'p', 'c'},
+        .size = stream->used,
+        .type = I3_IPC_REPLY_TYPE_TREE};
+    memcpy(stream->chunk->data, ((void *)&header), sizeof(i3_ipc_header_t));
+    stream->chunk->size = sizeof(i3_ipc_header_t) + stream->used;
+
+    ipc_queue_message(stream->client, stream->chunk);
+    ipc_message_unref(stream->chunk);
+    stream->chunk = NULL;
+    stream->used = 0;
+}
+
+/*
+ * The yajl print callback of chunked GET_TREE replies.
+ *
+ */
+static void tree_stream_print(void *ctx, const char *str, size_t len) {
+    struct tree_stream *stream = ctx;
+    while (len > 0) {
+        if (stream->chunk == NULL) {
+            stream->chunk = smalloc_counted(&memory_counters[MEM_IPC], sizeof(struct ipc_message) + sizeof(i3_ipc_header_t) + TREE_CHUNK_SIZE);
+            stream->chunk->refcount = 1;
+            stream->used = 0;
+        }
+
+        const size_t n = min(len, TREE_CHUNK_SIZE - stream->used);
+        memcpy(stream->chunk->data + sizeof(i3_ipc_header_t) + stream->used, str, n);
+        stream->used += n;
+        str += n;
+        len -= n;
+
+        if (stream->used == TREE_CHUNK_SIZE) {
+            tree_stream_flush(stream);
+        }
+    }
+}
+
+/*
+ * Sends the empty message which terminates a chunked GET_TREE reply.
+ *
+ */
+static void ipc_send_tree_end(ipc_client *client) {
+    struct ipc_message *message = ipc_message_new(I3_IPC_REPLY_TYPE_TREE, 0, (const uint8_t *)"");
+    ipc_queue_message(client, message);
+    ipc_message_unref(message);
+}
+
+/*
+ * Generates a GET_TREE reply directly into messages of TREE_CHUNK_SIZE bytes,
+ * which are sent while the tree is still being serialized, followed by an
+ * empty message. Unlike the other replies, this never holds the complete JSON
+ * in memory.
+ *
+ */
+static void ipc_send_tree_chunked(ipc_client *client, Con *root, struct dump_filter *filter, long long if_newer_than) {
+    struct tree_stream stream = {.client = client};
+
+    setlocale(LC_NUMERIC, "C");
+    yajl_gen gen = ygenalloc();
+    yajl_gen_config(gen, yajl_gen_print_callback, tree_stream_print, &stream);
+
+    if (if_newer_than >= 0) {
+        ipc_conditional_reply_open(gen);
+    }
+    if (filter->criteria != NULL) {
+        y(array_open);
+        dump_matching_nodes(gen, root, filter->criteria);
+        y(array_close);
+    } else {
+        dump_node(gen, root, false);
+    }
+    if (if_newer_than >= 0) {
+        y(map_close);
+    }
+
+    y(free);
+    setlocale(LC_NUMERIC, "");
+
+    tree_stream_flush(&stream);
+    ipc_send_tree_end(client);
+}
+
+/*
+ * Formats the reply message for a GET_TREE request and sends it to the client.
+ *
+ * The optional payload is a JSON map which restricts the reply to a subtree
+ * ("root", a container id), to all containers matching "criteria" (a map as in
+ * command criteria, the reply is then a list of containers), to a maximum
+ * "depth" of children and to a list of "fields" of each container. With
+ * "chunked", the reply is streamed, see ipc_send_tree_chunked().
+ *
+ */
+IPC_HANDLER(tree) {
+    /* Send pending tree events first so that the tree_generation in the reply
+     * matches what subscribers have seen. */
+    tree_events_flush();
+
+    struct dump_filter filter = {
+        .root = NULL,
+        .criteria = NULL,
+        .max_depth = -1,
+        .depth = 0,
+        .fields = NULL,
+        .num_fields = 0,
+    };
+    long long if_newer_than = -1;
+    bool chunked = false;
+
+    if (message_size > 0) {
+        static yajl_callbacks callbacks = {
+            .yajl_map_key = _tree_json_key,
+            .yajl_start_map = _tree_json_start_map,
+            .yajl_end_map = _tree_json_end_map,
+            .yajl_start_array = _tree_json_start_array,
+            .yajl_end_array = _tree_json_end_array,
+            .yajl_string = _tree_json_string,
+            .yajl_integer = _tree_json_int,
+            .yajl_boolean = _tree_json_bool,
+        };
+
+        struct tree_request_state state = {.filter = &filter, .if_newer_than = -1};
+        yajl_handle p = yalloc(&callbacks, (void *)&state);
+        yajl_status stat = yajl_parse(p, (const unsigned char *)message, message_size);
+        if (stat == yajl_status_ok) {
+            stat = yajl_complete_parse(p);
+        }
+        const bool invalid = (stat != yajl_status_ok && state.error == NULL);
+        if (invalid) {
+            /* Clients used to be able to send anything as the payload, it
+             * was ignored. Keep doing that for payloads which are no JSON. */
+            unsigned char *err = yajl_get_error(p, true, (const unsigned char *)message, message_size);
+            ELOG("Ignoring GET_TREE payload, YAJL parse error: %s\n", err);
+            yajl_free_error(p, err);
+            free_dump_filter(&filter);
+            filter = (struct dump_filter){.max_depth = -1};
+        } else {
+            if_newer_than = state.if_newer_than;
+            /* The chunks are not converted to CBOR one by one. */
+            chunked = (state.chunked && client->encoding == IPC_ENCODING_JSON);
+        }
+        yajl_free(p);
+        FREE(state.last_key);
+
+        if (state.error != NULL) {
+            ELOG("Invalid GET_TREE request: %s\n", state.error);
+            yajl_gen gen = ygenalloc();
+            y(map_open);
+            ystr("success");
+            y(bool, false);
+            ystr("error");
+            ystr(state.error);
+            y(map_close);
+
+            const unsigned char *payload;
+            ylength length;
+            y(get_buf, &payload, &length);
+            ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_TREE, payload);
+            y(free);
+            if (chunked) {
+                ipc_send_tree_end(client);
+            }
+
+            free(state.error);
+            free_dump_filter(&filter);
+            return;
+        }
+
+        if (ipc_send_unchanged_reply(client, I3_IPC_REPLY_TYPE_TREE, if_newer_than)) {
+            if (chunked) {
+                ipc_send_tree_end(client);
+            }
+            free_dump_filter(&filter);
+            return;
+        }
+
+        if (!invalid) {
+            dump_filter = &filter;
+        }
+    }
+
+    Con *root = (filter.root != NULL ? filter.root : croot);
+
+    if (chunked) {
+        ipc_send_tree_chunked(client, root, &filter, if_newer_than);
+        dump_filter = NULL;
+        free_dump_filter(&filter);
+        return;
+    }
+
+    /* Only copy the values here, the JSON is generated from the snapshot
+     * afterwards. */
+    json_snapshot_t *snapshot = json_snapshot_new();
+    dump_snapshot = snapshot;
+    if (if_newer_than >= 0) {
+        /* Like ipc_conditional_reply_open(). */
+        json_snapshot_map_open(snapshot);
+        json_snapshot_string(snapshot, (const unsigned char *)"generation", strlen("generation"));
+        json_snapshot_integer(snapshot, tree_generation());
+        json_snapshot_string(snapshot, (const unsigned char *)"unchanged", strlen("unchanged"));
+        json_snapshot_bool(snapshot, false);
+        json_snapshot_string(snapshot, (const unsigned char *)"reply", strlen("reply"));
+    }
+    if (filter.criteria != NULL) {
+        json_snapshot_array_open(snapshot);
+        dump_matching_nodes(NULL, root, filter.criteria);
+        json_snapshot_array_close(snapshot);
+    } else {
+        dump_node(NULL, root, false);
+    }
+    if (if_newer_than >= 0) {
+        json_snapshot_map_close(snapshot);
+    }
+    dump_snapshot = NULL;
+    dump_filter = NULL;
+    free_dump_filter(&filter);
+
+    if (json_snapshot_size(snapshot) >= TREE_ASYNC_THRESHOLD) {
+        /* Reserve the reply's place in the queue, so that the replies stay in
+         * the order of the messages. */
+        struct tree_job *job = smalloc(sizeof(struct tree_job));
+        job->client = client;
+        job->entry = ipc_queue_append(client, NULL, true);
+        TAILQ_INSERT_TAIL(&tree_jobs, job, jobs);
+        json_snapshot_serialize(snapshot, (client->encoding == IPC_ENCODING_CBOR), ipc_tree_job_done, job);
+        return;
+    }
+
+    /* The writer formats numbers independently of the locale. */
+    uint8_t *payload;
+    size_t length;
+    json_snapshot_write(snapshot, &payload, &length);
+    json_snapshot_free(snapshot);
+
+    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_TREE, payload);
+    free(payload);
+}
 
-    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_TREE, payload);
-    y(free);
+/*
+ * Records the serialization of the given container and its children (see
+ * dump_node()) into the snapshot.
+ *
+ */
+void dump_node_snapshot(json_snapshot_t *snapshot, Con *con) {
+    dump_snapshot = snapshot;
+    dump_node(NULL, con, false);
+    dump_snapshot = NULL;
 }
 
 /*
- * Formats the reply message for a GET_WORKSPACES request and sends it to the
- * client
+ * Generates the list of workspaces for the GET_WORKSPACES reply.
  *
  */
-IPC_HANDLER(get_workspaces) {
-    yajl_gen gen = ygenalloc();
+static void dump_workspaces(yajl_gen gen) {
     y(array_open);
 
     Con *focused_ws = con_get_workspace(focused);
@@ -930,22 +2618,48 @@ IPC_HANDLER(get_workspaces) {
     }
 
     y(array_close);
+}
+
+/*
+ * Formats the reply message for a GET_WORKSPACES request and sends it to the
+ * client. See ipc_parse_request_options() for the optional payload.
+ *
+ */
+IPC_HANDLER(get_workspaces) {
+    const long long if_newer_than = ipc_parse_request_options(message, message_size).if_newer_than;
+    if (if_newer_than < 0 && ipc_send_cached_reply(client, CACHED_WORKSPACES)) {
+        return;
+    }
+    if (ipc_send_unchanged_reply(client, I3_IPC_REPLY_TYPE_WORKSPACES, if_newer_than)) {
+        return;
+    }
+
+    yajl_gen gen = ygenalloc();
+    if (if_newer_than >= 0) {
+        ipc_conditional_reply_open(gen);
+    }
+    dump_workspaces(gen);
+    if (if_newer_than >= 0) {
+        y(map_close);
+    }
 
     const unsigned char *payload;
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_WORKSPACES, payload);
+    if (if_newer_than >= 0) {
+        ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_WORKSPACES, payload);
+    } else {
+        ipc_send_cacheable_reply(client, CACHED_WORKSPACES, length, I3_IPC_REPLY_TYPE_WORKSPACES, payload);
+    }
     y(free);
 }
 
 /*
- * Formats the reply message for a GET_OUTPUTS request and sends it to the
- * client
+ * Generates the list of outputs for the GET_OUTPUTS reply.
  *
  */
-IPC_HANDLER(get_outputs) {
-    yajl_gen gen = ygenalloc();
+static void dump_outputs(yajl_gen gen) {
     y(array_open);
 
     Output *output;
@@ -984,12 +2698,40 @@ IPC_HANDLER(get_outputs) {
     }
 
     y(array_close);
+}
+
+/*
+ * Formats the reply message for a GET_OUTPUTS request and sends it to the
+ * client. See ipc_parse_request_options() for the optional payload.
+ *
+ */
+IPC_HANDLER(get_outputs) {
+    const long long if_newer_than = ipc_parse_request_options(message, message_size).if_newer_than;
+    if (if_newer_than < 0 && ipc_send_cached_reply(client, CACHED_OUTPUTS)) {
+        return;
+    }
+    if (ipc_send_unchanged_reply(client, I3_IPC_REPLY_TYPE_OUTPUTS, if_newer_than)) {
+        return;
+    }
+
+    yajl_gen gen = ygenalloc();
+    if (if_newer_than >= 0) {
+        ipc_conditional_reply_open(gen);
+    }
+    dump_outputs(gen);
+    if (if_newer_than >= 0) {
+        y(map_close);
+    }
 
     const unsigned char *payload;
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_OUTPUTS, payload);
+    if (if_newer_than >= 0) {
+        ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_OUTPUTS, payload);
+    } else {
+        ipc_send_cacheable_reply(client, CACHED_OUTPUTS, length, I3_IPC_REPLY_TYPE_OUTPUTS, payload);
+    }
     y(free);
 }
 
@@ -999,13 +2741,17 @@ IPC_HANDLER(get_outputs) {
  *
  */
 IPC_HANDLER(get_marks) {
+    if (ipc_send_cached_reply(client, CACHED_MARKS)) {
+        return;
+    }
+
     yajl_gen gen = ygenalloc();
     y(array_open);
 
     Con *con;
     TAILQ_FOREACH (con, &all_cons, all_cons) {
         mark_t *mark;
-        TAILQ_FOREACH (mark, &(con->marks_head), marks) {
+        TAILQ_FOREACH (mark, &(con->cold->marks_head), marks) {
             ystr(mark->name);
         }
     }
@@ -1016,7 +2762,7 @@ IPC_HANDLER(get_marks) {
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_MARKS, payload);
+    ipc_send_cacheable_reply(client, CACHED_MARKS, length, I3_IPC_REPLY_TYPE_MARKS, payload);
     y(free);
 }
 
@@ -1127,18 +2873,47 @@ IPC_HANDLER(get_bar_config) {
 }
 
 /*
- * Returns a list of configured binding modes
+ * Generates a list of all binding modes with their bindings.
  *
  */
-IPC_HANDLER(get_binding_modes) {
-    yajl_gen gen = ygenalloc();
-
+static void dump_binding_modes(yajl_gen gen) {
     y(array_open);
     struct Mode *mode;
     SLIST_FOREACH (mode, &modes, modes) {
+        y(map_open);
+        ystr("name");
         ystr(mode->name);
+        ystr("bindings");
+        y(array_open);
+        Binding *bind;
+        TAILQ_FOREACH (bind, mode->bindings, bindings) {
+            dump_binding(gen, bind);
+        }
+        y(array_close);
+        y(map_close);
     }
     y(array_close);
+}
+
+/*
+ * Returns a list of configured binding modes. With "bindings" in the payload,
+ * the list contains the modes with their bindings instead of just the names.
+ *
+ */
+IPC_HANDLER(get_binding_modes) {
+    const struct request_options options = ipc_parse_request_options(message, message_size);
+    yajl_gen gen = ygenalloc();
+
+    if (options.bindings) {
+        dump_binding_modes(gen);
+    } else {
+        y(array_open);
+        struct Mode *mode;
+        SLIST_FOREACH (mode, &modes, modes) {
+            ystr(mode->name);
+        }
+        y(array_close);
+    }
 
     const unsigned char *payload;
     ylength length;
@@ -1149,35 +2924,267 @@ IPC_HANDLER(get_binding_modes) {
 }
 
 /*
- * Callback for the YAJL parser (will be called when a string is parsed).
+ * Changes the libev priority of the watcher, which is only possible while it
+ * is stopped.
+ *
+ */
+static void ipc_set_watcher_priority(struct ev_io *watcher, int priority) {
+    const bool active = ev_is_active(watcher);
+    if (active) {
+        ev_io_stop(main_loop, watcher);
+    }
+    ev_set_priority(watcher, priority);
+    if (active) {
+        ev_io_start(main_loop, watcher);
+    }
+}
+
+/*
+ * Puts the client into the given priority class: its socket is read from and
+ * written to before (interactive) or after (bulk) the other clients within an
+ * event loop iteration, but always after X11 input. Bulk clients coalesce
+ * their events under backpressure, unless they select another policy with
+ * SET_BACKPRESSURE afterwards.
+ *
+ */
+static void ipc_set_priority(ipc_client *client, ipc_priority_t priority) {
+    client->priority = priority;
+    const int ev_priority = (priority == IPC_PRIORITY_INTERACTIVE ? 1 : (priority == IPC_PRIORITY_BULK ? -1 : 0));
+    ipc_set_watcher_priority(client->read_callback, ev_priority);
+    ipc_set_watcher_priority(client->write_callback, ev_priority);
+    if (priority == IPC_PRIORITY_BULK) {
+        client->backpressure = IPC_BACKPRESSURE_COALESCE;
+    }
+    DLOG("IPC client on fd %d: priority %s\n", client->fd, priority_names[priority]);
+}
+
+/*
+ * Looks up the priority class with the given name (of len bytes). Returns
+ * false if there is no such class.
+ *
+ */
+static bool ipc_parse_priority(const char *name, size_t len, ipc_priority_t *priority) {
+    for (size_t i = 0; i < sizeof(priority_names) / sizeof(priority_names[0]); i++) {
+        if (len == strlen(priority_names[i]) && strncasecmp(name, priority_names[i], len) == 0) {
+            *priority = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Subscribes the client to the event type with the given name. A filter (or
+ * NULL) restricts which events of that type the client receives; subscribing
+ * without a filter replaces all filters. Takes ownership of the filter.
+ * Returns false if there is no such event type.
  *
  */
-static int add_subscription(void *extra, const unsigned char *s,
-                            ylength len) {
-    ipc_client *client = extra;
+static bool add_subscription(ipc_client *client, const char *name, size_t len, struct event_filter *filter) {
+    DLOG("should add subscription to extra %p, sub %.*s\n", client, (int)len, name);
+
+    /* "window_uncoalesced" subscribes to window events, opting out of the
+     * coalescing of title and mark changes. */
+    static const char *uncoalesced = "window_uncoalesced";
+    if (strlen(uncoalesced) == len && strncasecmp(uncoalesced, name, len) == 0) {
+        client->uncoalesced_window_events = true;
+        name = "window";
+        len = strlen("window");
+    }
+
+    /* "window_compact" subscribes to window events which only carry the
+     * fields that changed, see send_compact_window_event(). */
+    static const char *compact_window = "window_compact";
+    if (strlen(compact_window) == len && strncasecmp(compact_window, name, len) == 0) {
+        client->compact_window_events = true;
+        name = "window";
+        len = strlen("window");
+    }
+
+    /* "binding_compact" subscribes to binding events which only carry the
+     * id of the binding, see ipc_send_binding_event(). */
+    static const char *compact = "binding_compact";
+    if (strlen(compact) == len && strncasecmp(compact, name, len) == 0) {
+        client->compact_binding_events = true;
+        name = "binding";
+        len = strlen("binding");
+    }
+
+    for (size_t i = 0; i < NUM_EVENT_TYPES; i++) {
+        if (strlen(event_names[i]) != len ||
+            strncasecmp(event_names[i], name, len) != 0) {
+            continue;
+        }
+
+        const bool subscribed = (client->event_mask & (1U << i));
+        if (!subscribed) {
+            client->event_mask |= (1U << i);
+            event_listeners[i]++;
+        }
+        if (filter == NULL) {
+            if (client->event_filters != NULL) {
+                event_filters_free(client->event_filters[i]);
+                client->event_filters[i] = NULL;
+            }
+        } else if (subscribed && (client->event_filters == NULL || client->event_filters[i] == NULL)) {
+            /* The client already receives all events of this type. */
+            event_filters_free(filter);
+        } else {
+            if (client->event_filters == NULL) {
+                client->event_filters = scalloc(NUM_EVENT_TYPES, sizeof(struct event_filter *));
+            }
+            filter->next = client->event_filters[i];
+            client->event_filters[i] = filter;
+        }
+        if (EVENT_BIT(I3_IPC_EVENT_TREE) == (1U << i)) {
+            tree_events_start();
+        }
+        if (EVENT_BIT(I3_IPC_EVENT_STATS) == (1U << i)) {
+            stats_event_start();
+        }
+        DLOG("client is now subscribed to event mask 0x%x\n", client->event_mask);
+        return true;
+    }
+
+    DLOG("Ignoring subscription to unknown event \"%.*s\"\n", (int)len, name);
+    event_filters_free(filter);
+    return false;
+}
+
+/* The state of parsing a SUBSCRIBE payload. Its elements are either event
+ * names or objects with the event name in "event" and the filter. An object
+ * can also (or only) contain the "priority" class of the client. */
+struct subscribe_state {
+    ipc_client *client;
+    int depth;
+    char *key;
+    /* Set while parsing an object */
+    struct event_filter *filter;
+    char *event;
+    bool has_priority;
+};
+
+static int subscribe_start_map(void *extra) {
+    struct subscribe_state *state = extra;
+    if (state->depth != 1) {
+        ELOG("Subscription filters have to be objects within the array\n");
+        return 0;
+    }
+    state->depth++;
+    state->filter = scalloc(1, sizeof(struct event_filter));
+    return 1;
+}
+
+static int subscribe_map_key(void *extra, const unsigned char *key, ylength len) {
+    struct subscribe_state *state = extra;
+    FREE(state->key);
+    state->key = sstrndup((const char *)key, len);
+    return 1;
+}
+
+static int subscribe_end_map(void *extra) {
+    struct subscribe_state *state = extra;
+    state->depth--;
+    struct event_filter *filter = state->filter;
+    state->filter = NULL;
+    if (state->event == NULL) {
+        event_filters_free(filter);
+        if (state->has_priority) {
+            state->has_priority = false;
+            FREE(state->key);
+            return 1;
+        }
+        ELOG("Subscription filter without \"event\"\n");
+        return 0;
+    }
+    state->has_priority = false;
+    add_subscription(state->client, state->event, strlen(state->event), filter);
+    FREE(state->event);
+    FREE(state->key);
+    return 1;
+}
+
+static int subscribe_start_array(void *extra) {
+    struct subscribe_state *state = extra;
+    /* Only the top-level array and "change" arrays within filters */
+    if (state->depth == 0 || (state->depth == 2 && state->key != NULL && strcmp(state->key, "change") == 0)) {
+        state->depth++;
+        return 1;
+    }
+    ELOG("Unexpected array in the subscription\n");
+    return 0;
+}
+
+static int subscribe_end_array(void *extra) {
+    struct subscribe_state *state = extra;
+    state->depth--;
+    return 1;
+}
 
-    DLOG("should add subscription to extra %p, sub %.*s\n", client, (int)len, s);
-    int event = client->num_events;
+static int subscribe_string(void *extra, const unsigned char *val, ylength len) {
+    struct subscribe_state *state = extra;
+    struct event_filter *filter = state->filter;
+    if (filter == NULL) {
+        add_subscription(state->client, (const char *)val, len, NULL);
+        return 1;
+    }
 
-    client->num_events++;
-    client->events = srealloc(client->events, client->num_events * sizeof(char *));
-    /* We copy the string because it is not null-terminated and strndup()
-     * is missing on some BSD systems */
-    client->events[event] = scalloc(len + 1, 1);
-    memcpy(client->events[event], s, len);
+    if (strcmp(state->key, "priority") == 0) {
+        ipc_priority_t priority;
+        if (!ipc_parse_priority((const char *)val, len, &priority)) {
+            ELOG("Invalid priority \"%.*s\" in the subscription\n", (int)len, (const char *)val);
+            return 0;
+        }
+        ipc_set_priority(state->client, priority);
+        state->has_priority = true;
+        return 1;
+    }
 
-    DLOG("client is now subscribed to:\n");
-    for (int i = 0; i < client->num_events; i++) {
-        DLOG("event %s\n", client->events[i]);
+    char *value = sstrndup((const char *)val, len);
+    if (strcmp(state->key, "event") == 0) {
+        FREE(state->event);
+        state->event = value;
+    } else if (strcmp(state->key, "change") == 0) {
+        filter->changes = srealloc(filter->changes, (filter->num_changes + 1) * sizeof(char *));
+        filter->changes[filter->num_changes++] = value;
+    } else if (strcmp(state->key, "class") == 0 || strcmp(state->key, "instance") == 0) {
+        struct regex *regex = regex_new(value);
+        free(value);
+        if (regex == NULL) {
+            return 0;
+        }
+        struct regex **field = (strcmp(state->key, "class") == 0 ? &(filter->window_class) : &(filter->window_instance));
+        if (*field != NULL) {
+            regex_free(*field);
+        }
+        *field = regex;
+    } else if (strcmp(state->key, "workspace") == 0) {
+        FREE(filter->workspace);
+        filter->workspace = value;
+    } else if (strcmp(state->key, "output") == 0) {
+        FREE(filter->output);
+        filter->output = value;
+    } else {
+        DLOG("Ignoring unknown subscription filter \"%s\"\n", state->key);
+        free(value);
     }
-    DLOG("(done)\n");
+    return 1;
+}
 
+static int subscribe_integer(void *extra, long long val) {
+    struct subscribe_state *state = extra;
+    if (state->filter == NULL || strcmp(state->key, "con_id") != 0) {
+        ELOG("Unexpected number in the subscription\n");
+        return 0;
+    }
+    state->filter->con_id = val;
     return 1;
 }
 
 /*
  * Subscribes this connection to the event types which were given as a JSON
- * serialized array in the payload field of the message.
+ * serialized array in the payload field of the message. Elements can be
+ * objects with filters instead of just the event name.
  *
  */
 IPC_HANDLER(subscribe) {
@@ -1186,11 +3193,21 @@ IPC_HANDLER(subscribe) {
 
     /* Setup the JSON parser */
     static yajl_callbacks callbacks = {
-        .yajl_string = add_subscription,
+        .yajl_string = subscribe_string,
+        .yajl_integer = subscribe_integer,
+        .yajl_start_map = subscribe_start_map,
+        .yajl_map_key = subscribe_map_key,
+        .yajl_end_map = subscribe_end_map,
+        .yajl_start_array = subscribe_start_array,
+        .yajl_end_array = subscribe_end_array,
     };
 
-    p = yalloc(&callbacks, (void *)client);
+    struct subscribe_state state = {.client = client};
+    p = yalloc(&callbacks, (void *)&state);
     stat = yajl_parse(p, (const unsigned char *)message, message_size);
+    event_filters_free(state.filter);
+    free(state.event);
+    free(state.key);
     if (stat != yajl_status_ok) {
         unsigned char *err;
         err = yajl_get_error(p, true, (const unsigned char *)message,
@@ -1211,14 +3228,7 @@ IPC_HANDLER(subscribe) {
         return;
     }
 
-    bool is_tick = false;
-    for (int i = 0; i < client->num_events; i++) {
-        if (strcmp(client->events[i], "tick") == 0) {
-            is_tick = true;
-            break;
-        }
-    }
-    if (!is_tick) {
+    if (!(client->event_mask & EVENT_BIT(I3_IPC_EVENT_TICK))) {
         return;
     }
 
@@ -1253,6 +3263,9 @@ IPC_HANDLER(get_config) {
     }
     y(array_close);
 
+    ystr("binding_modes");
+    dump_binding_modes(gen);
+
     y(map_close);
 
     const unsigned char *payload;
@@ -1284,7 +3297,7 @@ IPC_HANDLER(send_tick) {
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_event("tick", I3_IPC_EVENT_TICK, (const char *)payload);
+    ipc_send_event(I3_IPC_EVENT_TICK, (const char *)payload);
     y(free);
 
     const char *reply = "{\"success\":true}";
@@ -1345,33 +3358,287 @@ IPC_HANDLER(sync) {
     }
     yajl_free(p);
 
-    DLOG("received IPC sync request (rnd = %d, window = 0x%08x)\n", state.rnd, state.window);
-    sync_respond(state.window, state.rnd);
-    const char *reply = "{\"success\":true}";
-    ipc_send_client_message(client, strlen(reply), I3_IPC_REPLY_TYPE_SYNC, (const uint8_t *)reply);
+    DLOG("received IPC sync request (rnd = %d, window = 0x%08x)\n", state.rnd, state.window);
+    sync_respond(state.window, state.rnd);
+    const char *reply = "{\"success\":true}";
+    ipc_send_client_message(client, strlen(reply), I3_IPC_REPLY_TYPE_SYNC, (const uint8_t *)reply);
+}
+
+IPC_HANDLER(get_binding_state) {
+    yajl_gen gen = ygenalloc();
+
+    y(map_open);
+
+    ystr("name");
+    ystr(current_binding_mode);
+
+    y(map_close);
+
+    const unsigned char *payload;
+    ylength length;
+    y(get_buf, &payload, &length);
+
+    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_GET_BINDING_STATE, payload);
+    y(free);
+}
+
+/*
+ * Serializes the statistics sent in the GET_STATS reply and the stats event.
+ *
+ */
+static void dump_stats(yajl_gen gen) {
+    /* Counting X requests costs requests of its own, so it only starts once
+     * somebody is interested. */
+    stats_enable();
+
+    y(map_open);
+
+    ystr("pools");
+    pool_dump_stats(gen);
+
+    uint64_t hits, misses;
+    size_t cached;
+    predict_text_width_stats(&hits, &misses, &cached);
+    ystr("text_width_cache");
+    y(map_open);
+    ystr("hits");
+    y(integer, hits);
+    ystr("misses");
+    y(integer, misses);
+    ystr("size");
+    y(integer, cached);
+    y(map_close);
+
+    stats_dump(gen);
+
+    maintenance_dump(gen);
+
+    ystr("ipc_clients");
+    y(array_open);
+    ipc_client *current;
+    TAILQ_FOREACH (current, &all_clients, clients) {
+        y(map_open);
+        ystr("fd");
+        y(integer, current->fd);
+        ystr("bytes_sent");
+        y(integer, current->bytes_sent);
+        ystr("queued_bytes");
+        y(integer, current->queued_bytes);
+        ystr("queued_bytes_peak");
+        y(integer, current->queued_bytes_peak);
+        ystr("backpressure");
+        ystr(backpressure_names[current->backpressure]);
+        ystr("priority");
+        ystr(priority_names[current->priority]);
+        ystr("dropped_events");
+        y(integer, current->dropped_events);
+        y(map_close);
+    }
+    y(array_close);
+
+    y(map_close);
+}
+
+/*
+ * Sends i3’s internal statistics: allocator pools, caches, X events, render
+ * latencies and IPC clients.
+ *
+ */
+IPC_HANDLER(get_stats) {
+    yajl_gen gen = ygenalloc();
+    dump_stats(gen);
+
+    const unsigned char *payload;
+    ylength length;
+    y(get_buf, &payload, &length);
+
+    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_STATS, payload);
+    y(free);
+}
+
+/* The stats event is sent in this interval (seconds) while there are
+ * subscribers. */
+#define STATS_EVENT_INTERVAL 10.0
+
+static ev_timer *stats_timer;
+
+static void stats_event_cb(EV_P_ ev_timer *w, int revents) {
+    if (!ipc_has_event_listeners(I3_IPC_EVENT_STATS)) {
+        ev_timer_stop(main_loop, stats_timer);
+        FREE(stats_timer);
+        return;
+    }
+
+    yajl_gen gen = ygenalloc();
+    dump_stats(gen);
+
+    const unsigned char *payload;
+    ylength length;
+    y(get_buf, &payload, &length);
+
+    ipc_send_event(I3_IPC_EVENT_STATS, (const char *)payload);
+    y(free);
+}
+
+/*
+ * Starts sending the periodic stats event, unless it already is.
+ *
+ */
+static void stats_event_start(void) {
+    if (stats_timer != NULL) {
+        return;
+    }
+    stats_timer = scalloc(1, sizeof(struct ev_timer));
+    ev_timer_init(stats_timer, stats_event_cb, STATS_EVENT_INTERVAL, STATS_EVENT_INTERVAL);
+    ev_timer_start(main_loop, stats_timer);
+}
+
+/*
+ * Selects the encoding of all further replies and events sent to the client.
+ * The payload is the name of the encoding ("json" or "cbor"). The reply
+ * itself is always JSON.
+ *
+ */
+IPC_HANDLER(set_encoding) {
+    const char *reply = "{\"success\":true}";
+
+    if (message_size == strlen("cbor") && strncasecmp((const char *)message, "cbor", message_size) == 0) {
+        client->encoding = IPC_ENCODING_CBOR;
+    } else if (message_size == strlen("json") && strncasecmp((const char *)message, "json", message_size) == 0) {
+        client->encoding = IPC_ENCODING_JSON;
+    } else {
+        ELOG("Unknown IPC encoding \"%.*s\"\n", (int)message_size, (const char *)message);
+        reply = "{\"success\":false,\"error\":\"unknown encoding\"}";
+    }
+    DLOG("IPC client on fd %d now uses encoding %d\n", client->fd, client->encoding);
+
+    struct ipc_message *msg = ipc_message_new(I3_IPC_REPLY_TYPE_SET_ENCODING, strlen(reply), (const uint8_t *)reply);
+    ipc_queue_message(client, msg);
+    ipc_message_unref(msg);
+}
+
+/*
+ * Enables ("true") or disables ("false") the timing of commands in the
+ * RUN_COMMAND replies sent to this client.
+ *
+ */
+IPC_HANDLER(set_command_timing) {
+    const char *reply = "{\"success\":true}";
+
+    if (message_size == strlen("true") && strncasecmp((const char *)message, "true", message_size) == 0) {
+        client->command_timing = true;
+    } else if (message_size == strlen("false") && strncasecmp((const char *)message, "false", message_size) == 0) {
+        client->command_timing = false;
+    } else {
+        ELOG("Invalid SET_COMMAND_TIMING payload \"%.*s\"\n", (int)message_size, (const char *)message);
+        reply = "{\"success\":false,\"error\":\"expected true or false\"}";
+    }
+    DLOG("IPC client on fd %d: command timing %s\n", client->fd, (client->command_timing ? "enabled" : "disabled"));
+
+    ipc_send_client_message(client, strlen(reply), I3_IPC_REPLY_TYPE_SET_COMMAND_TIMING, (const uint8_t *)reply);
+}
+
+/*
+ * Selects what happens when the client does not read its events and the
+ * queue limit is reached. The payload is the name of the policy ("kill",
+ * "drop" or "coalesce").
+ *
+ */
+IPC_HANDLER(set_backpressure) {
+    const char *reply = "{\"success\":true}";
+
+    size_t i = 0;
+    while (i < sizeof(backpressure_names) / sizeof(backpressure_names[0]) &&
+           (message_size != strlen(backpressure_names[i]) ||
+            strncasecmp((const char *)message, backpressure_names[i], message_size) != 0)) {
+        i++;
+    }
+    if (i < sizeof(backpressure_names) / sizeof(backpressure_names[0])) {
+        client->backpressure = i;
+    } else {
+        ELOG("Invalid SET_BACKPRESSURE payload \"%.*s\"\n", (int)message_size, (const char *)message);
+        reply = "{\"success\":false,\"error\":\"expected kill, drop or coalesce\"}";
+    }
+    DLOG("IPC client on fd %d: backpressure policy %s\n", client->fd, backpressure_names[client->backpressure]);
+
+    ipc_send_client_message(client, strlen(reply), I3_IPC_REPLY_TYPE_SET_BACKPRESSURE, (const uint8_t *)reply);
 }
 
-IPC_HANDLER(get_binding_state) {
-    yajl_gen gen = ygenalloc();
+/*
+ * Selects the priority class of the client for the delivery of events and
+ * the handling of its messages. The payload is the name of the class
+ * ("interactive", "normal" or "bulk").
+ *
+ */
+IPC_HANDLER(set_priority) {
+    const char *reply = "{\"success\":true}";
 
-    y(map_open);
+    ipc_priority_t priority;
+    if (ipc_parse_priority((const char *)message, message_size, &priority)) {
+        ipc_set_priority(client, priority);
+    } else {
+        ELOG("Invalid SET_PRIORITY payload \"%.*s\"\n", (int)message_size, (const char *)message);
+        reply = "{\"success\":false,\"error\":\"expected interactive, normal or bulk\"}";
+    }
 
-    ystr("name");
-    ystr(current_binding_mode);
+    ipc_send_client_message(client, strlen(reply), I3_IPC_REPLY_TYPE_SET_PRIORITY, (const uint8_t *)reply);
+}
 
-    y(map_close);
+/*
+ * Sends the memory used by i3, by category (see memory.c).
+ *
+ */
+IPC_HANDLER(get_memory) {
+    yajl_gen gen = ygenalloc();
+    memory_dump(gen);
 
     const unsigned char *payload;
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_GET_BINDING_STATE, payload);
+    ipc_send_client_message(client, length, I3_IPC_REPLY_TYPE_MEMORY, payload);
     y(free);
 }
 
+/*
+ * Called once the X server processed the requests preceding an X_SYNC
+ * message. Unblocks the first blocked reply, as the replies are queued in the
+ * order of the messages.
+ *
+ */
+static void ipc_x_sync_done(void *data) {
+    ipc_client *client = data;
+    struct ipc_queued_message *entry;
+    TAILQ_FOREACH (entry, &(client->queue), entries) {
+        /* Skip the GET_TREE replies which are still being serialized. */
+        if (entry->blocked && entry->message != NULL) {
+            entry->blocked = false;
+            break;
+        }
+    }
+    ipc_push_pending(client);
+}
+
+/*
+ * Replies once the X server processed all requests which i3 sent before,
+ * including those of the preceding messages on this connection. i3 does not
+ * wait for the X server meanwhile: the reply is queued right away, but it and
+ * everything after it is only written when the X server caught up, so a client
+ * can send many RUN_COMMAND and X_SYNC messages without waiting for replies.
+ *
+ */
+IPC_HANDLER(x_sync) {
+    const char *reply = "{\"success\":true}";
+    struct ipc_message *sync_reply = ipc_message_new_encoded(
+        I3_IPC_REPLY_TYPE_X_SYNC, strlen(reply), (const uint8_t *)reply, client->encoding);
+    ipc_queue_append(client, sync_reply, true);
+    ipc_message_unref(sync_reply);
+    sync_after_x_requests(ipc_x_sync_done, client);
+}
+
 /* The index of each callback function corresponds to the numeric
  * value of the message type (see include/i3/ipc.h) */
-handler_t handlers[13] = {
+handler_t handlers[20] = {
     handle_run_command,
     handle_get_workspaces,
     handle_subscribe,
@@ -1385,49 +3652,203 @@ handler_t handlers[13] = {
     handle_send_tick,
     handle_sync,
     handle_get_binding_state,
+    handle_get_stats,
+    handle_set_encoding,
+    handle_set_command_timing,
+    handle_get_memory,
+    handle_x_sync,
+    handle_set_backpressure,
+    handle_set_priority,
 };
 
+/* The number of bytes read from a client at once. */
+#define IPC_READ_CHUNK (64 * 1024)
+
+/* The size of the message header: magic, length and type. */
+#define IPC_HEADER_SIZE (strlen(I3_IPC_MAGIC) + 2 * sizeof(uint32_t))
+
+/* Budget of each event loop iteration for handling IPC messages (of all
+ * clients together), see ipc_handle_messages(). */
+#define IPC_BUDGET_MESSAGES 64
+#define IPC_BUDGET_US 5000
+
+static unsigned int budget_iteration;
+static unsigned int budget_messages;
+static uint64_t budget_start;
+
+/* Started while clients are deferred. */
+static struct ev_idle *resume_idle;
+
+static void ipc_resume_cb(EV_P_ ev_idle *w, int revents);
+
+/*
+ * Returns whether the IPC work of the current event loop iteration exceeds
+ * its budget, see ipc_handle_messages().
+ *
+ */
+static bool ipc_budget_exhausted(EV_P) {
+    if (budget_iteration != ev_iteration(EV_A)) {
+        budget_iteration = ev_iteration(EV_A);
+        budget_messages = 0;
+        budget_start = stats_now();
+        return false;
+    }
+    return (budget_messages >= IPC_BUDGET_MESSAGES ||
+            stats_now() - budget_start >= IPC_BUDGET_US);
+}
+
+/*
+ * Stops reading from the client until ipc_resume_cb() handles its remaining
+ * messages in a later event loop iteration.
+ *
+ */
+static void ipc_defer_client(EV_P_ ipc_client *client) {
+    DLOG("IPC: budget of this iteration exhausted, deferring client on fd %d\n", client->fd);
+    client->deferred = true;
+    ev_io_stop(EV_A_ client->read_callback);
+    if (resume_idle == NULL) {
+        resume_idle = scalloc(1, sizeof(struct ev_idle));
+        ev_idle_init(resume_idle, ipc_resume_cb);
+    }
+    ev_idle_start(EV_A_ resume_idle);
+}
+
+/*
+ * Handles the complete messages in the client's input buffer, unless the
+ * budget of the current event loop iteration is exhausted: then the client is
+ * deferred, so that X11 input (and other clients) are not delayed by a flood
+ * of requests.
+ *
+ */
+static void ipc_handle_messages(EV_P_ ipc_client *client) {
+    /* A handler might disconnect the client (e.g. when restarting). The
+     * buffer is then freed here, after the handler is done with it. */
+    bool freed = false;
+    uint8_t *buffer = client->read_buffer;
+    client->freed = &freed;
+
+    size_t offset = 0;
+    while (client->read_size - offset >= IPC_HEADER_SIZE) {
+        uint8_t *header = buffer + offset;
+        if (memcmp(header, I3_IPC_MAGIC, strlen(I3_IPC_MAGIC)) != 0) {
+            ELOG("IPC: invalid magic in header, got \"%.*s\", want \"%s\"\n",
+                 (int)strlen(I3_IPC_MAGIC), header, I3_IPC_MAGIC);
+            free_ipc_client(client, -1);
+            free(buffer);
+            return;
+        }
+
+        uint32_t message_length;
+        uint32_t message_type;
+        memcpy(&message_length, header + strlen(I3_IPC_MAGIC), sizeof(uint32_t));
+        memcpy(&message_type, header + strlen(I3_IPC_MAGIC) + sizeof(uint32_t), sizeof(uint32_t));
+        const size_t message_size = IPC_HEADER_SIZE + (size_t)message_length;
+        if (client->read_size - offset < message_size) {
+            /* Make room for the rest of the message right away instead of
+             * growing the buffer chunk by chunk. */
+            if (client->read_capacity < message_size) {
+                memmove(buffer, header, client->read_size - offset);
+                client->read_size -= offset;
+                offset = 0;
+                client->read_capacity = message_size;
+                client->read_buffer = srealloc(client->read_buffer, client->read_capacity);
+                buffer = client->read_buffer;
+            }
+            break;
+        }
+
+        if (ipc_budget_exhausted(EV_A)) {
+            ipc_defer_client(EV_A_ client);
+            break;
+        }
+        budget_messages++;
+        offset += message_size;
+
+        PROBE3(ipc_recv, client->fd, message_type, message_length);
+        if (message_type >= (sizeof(handlers) / sizeof(handler_t)))
+            DLOG("Unhandled message type: %d\n", message_type);
+        else {
+            handler_t h = handlers[message_type];
+            h(client, header + IPC_HEADER_SIZE, 0, message_length, message_type);
+        }
+
+        if (freed) {
+            free(buffer);
+            return;
+        }
+    }
+    client->freed = NULL;
+
+    if (offset > 0) {
+        memmove(buffer, buffer + offset, client->read_size - offset);
+        client->read_size -= offset;
+    }
+}
+
+/*
+ * Handles the remaining messages of deferred clients, once there is nothing
+ * more important to do.
+ *
+ */
+static void ipc_resume_cb(EV_P_ ev_idle *w, int revents) {
+    while (!ipc_budget_exhausted(EV_A)) {
+        /* Start from the beginning every time: handling a message can
+         * disconnect other clients. Interactive clients go first. */
+        ipc_client *client = NULL;
+        for (size_t i = 0; i < sizeof(delivery_order) / sizeof(delivery_order[0]) && client == NULL; i++) {
+            TAILQ_FOREACH (client, &all_clients, clients) {
+                if (client->deferred && client->priority == delivery_order[i]) {
+                    break;
+                }
+            }
+        }
+        if (client == NULL) {
+            ev_idle_stop(EV_A_ w);
+            return;
+        }
+
+        client->deferred = false;
+        ev_io_start(EV_A_ client->read_callback);
+        ipc_handle_messages(EV_A_ client);
+    }
+}
+
 /*
- * Handler for activity on a client connection, receives a message from a
+ * Handler for activity on a client connection, receives messages from a
  * client.
  *
- * For now, the maximum message size is 2048. I’m not sure for what the
- * IPC interface will be used in the future, thus I’m not implementing a
- * mechanism for arbitrarily long messages, as it seems like overkill
- * at the moment.
+ * Reads as much as is available (up to IPC_READ_CHUNK) into the client's
+ * input buffer and handles the complete messages in it, so that clients which
+ * send many messages at once do not cost a wakeup and several reads per
+ * message. The handlers get the payload in the input buffer itself.
  *
  */
 static void ipc_receive_message(EV_P_ struct ev_io *w, int revents) {
-    uint32_t message_type;
-    uint32_t message_length;
-    uint8_t *message = NULL;
     ipc_client *client = (ipc_client *)w->data;
     assert(client->fd == w->fd);
 
-    int ret = ipc_recv_message(w->fd, &message_type, &message_length, &message);
-    /* EOF or other error */
-    if (ret < 0) {
-        /* Was this a spurious read? See ev(3) */
-        if (ret == -1 && errno == EAGAIN) {
-            FREE(message);
-            return;
-        }
-
-        /* If not, there was some kind of error. We don’t bother and close the
+    if (client->read_capacity - client->read_size < IPC_READ_CHUNK) {
+        client->read_capacity = client->read_size + IPC_READ_CHUNK;
+        client->read_buffer = srealloc(client->read_buffer, client->read_capacity);
+    }
+    const ssize_t n = read(w->fd, client->read_buffer + client->read_size,
+                           client->read_capacity - client->read_size);
+    if (n == -1 && (errno == EAGAIN || errno == EINTR)) {
+        /* Spurious read, see ev(3) */
+        return;
+    }
+    if (n <= 0) {
+        /* EOF or some kind of error. We don’t bother and close the
          * connection. Delete the client from the list of clients. */
+        if (n == 0 && client->read_size > 0) {
+            ELOG("IPC: unexpected EOF with %zu bytes of an incomplete message\n", client->read_size);
+        }
         free_ipc_client(client, -1);
-        FREE(message);
         return;
     }
+    client->read_size += n;
 
-    if (message_type >= (sizeof(handlers) / sizeof(handler_t)))
-        DLOG("Unhandled message type: %d\n", message_type);
-    else {
-        handler_t h = handlers[message_type];
-        h(client, message, 0, message_length, message_type);
-    }
-
-    FREE(message);
+    ipc_handle_messages(EV_A_ client);
 }
 
 static void ipc_client_timeout(EV_P_ ev_timer *w, int revents) {
@@ -1523,6 +3944,7 @@ ipc_client *ipc_new_client_on_fd(EV_P_ int fd) {
 
     ipc_client *client = scalloc(1, sizeof(ipc_client));
     client->fd = fd;
+    TAILQ_INIT(&(client->queue));
 
     client->read_callback = scalloc(1, sizeof(struct ev_io));
     client->read_callback->data = client;
@@ -1576,22 +3998,149 @@ yajl_gen ipc_marshal_workspace_event(const char *change, Con *current, Con *old)
  * previously focused workspace in "old".
  */
 void ipc_send_workspace_event(const char *change, Con *current, Con *old) {
+    ipc_invalidate_reply_cache();
+
+    event_attributes_t attributes = {.change = (char *)change};
+    if (current != NULL) {
+        event_attributes_for_con(&attributes, change, current);
+    }
+    if (!ipc_event_wanted(I3_IPC_EVENT_WORKSPACE, RECIPIENTS_ALL, &attributes)) {
+        return;
+    }
+
     yajl_gen gen = ipc_marshal_workspace_event(change, current, old);
 
     const unsigned char *payload;
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_event("workspace", I3_IPC_EVENT_WORKSPACE, (const char *)payload);
+    ipc_send_event_to(I3_IPC_EVENT_WORKSPACE, (const char *)payload, RECIPIENTS_ALL, &attributes);
 
     y(free);
 }
 
 /*
- * For the window events we send, along the usual "change" field,
- * also the window container, in "container".
+ * Serializes a workspace event like ipc_send_workspace_event(), to be sent
+ * later using ipc_send_prepared_event(). Used for the "empty" event, which
+ * is sent once the workspace is closed. Returns NULL if no client would
+ * receive the event.
+ *
  */
-void ipc_send_window_event(const char *property, Con *con) {
+ipc_prepared_event *ipc_prepare_workspace_event(const char *change, Con *current, Con *old) {
+    event_attributes_t attributes = {.change = (char *)change};
+    if (current != NULL) {
+        event_attributes_for_con(&attributes, change, current);
+    }
+    if (!ipc_event_wanted(I3_IPC_EVENT_WORKSPACE, RECIPIENTS_ALL, &attributes)) {
+        return NULL;
+    }
+
+    yajl_gen gen = ipc_marshal_workspace_event(change, current, old);
+
+    const unsigned char *payload;
+    ylength length;
+    y(get_buf, &payload, &length);
+
+    ipc_prepared_event *event = ipc_prepared_event_new(I3_IPC_EVENT_WORKSPACE, (const char *)payload, RECIPIENTS_ALL, &attributes);
+
+    y(free);
+    return event;
+}
+
+/*
+ * Sends and frees an event returned by ipc_prepare_workspace_event().
+ *
+ */
+void ipc_send_prepared_event(ipc_prepared_event *event) {
+    ipc_send_event_to(event->message_type, event->payload, event->recipients,
+                      (event->has_attributes ? &(event->attributes) : NULL));
+    ipc_prepared_event_free(event);
+}
+
+/*
+ * Sends the compact form of a window event, which only carries the id of the
+ * container, its window and the fields which the change is about, instead of
+ * the whole serialized container.
+ *
+ */
+static void send_compact_window_event(const char *property, Con *con, event_recipients_t recipients,
+                                      const event_attributes_t *attributes) {
+    yajl_gen gen = ygenalloc();
+
+    y(map_open);
+    ystr("change");
+    ystr(property);
+    ystr("id");
+    y(integer, (uintptr_t)con);
+    ystr("window");
+    if (con->window) {
+        y(integer, con->window->id);
+    } else {
+        y(null);
+    }
+
+    if (strcmp(property, "title") == 0) {
+        ystr("name");
+        if (con->window && con->window->name) {
+            ystr(i3string_as_utf8(con->window->name));
+        } else if (con->name != NULL) {
+            ystr(con->name);
+        } else {
+            y(null);
+        }
+    } else if (strcmp(property, "mark") == 0) {
+        ystr("marks");
+        y(array_open);
+        mark_t *mark;
+        TAILQ_FOREACH (mark, &(con->cold->marks_head), marks) {
+            ystr(mark->name);
+        }
+        y(array_close);
+    } else if (strcmp(property, "urgent") == 0) {
+        ystr("urgent");
+        y(bool, con->urgent);
+    } else if (strcmp(property, "fullscreen_mode") == 0) {
+        ystr("fullscreen_mode");
+        y(integer, con->fullscreen_mode);
+    } else if (strcmp(property, "floating") == 0) {
+        ystr("floating");
+        ystr(floating_name(con));
+    } else if (strcmp(property, "move") == 0) {
+        Con *ws = con_get_workspace(con);
+        ystr("workspace");
+        if (ws != NULL) {
+            ystr(ws->name);
+        } else {
+            y(null);
+        }
+    }
+
+    y(map_close);
+
+    const unsigned char *payload;
+    ylength length;
+    y(get_buf, &payload, &length);
+
+    ipc_send_event_to(I3_IPC_EVENT_WINDOW, (const char *)payload, recipients, attributes);
+    y(free);
+}
+
+/*
+ * Serializes a window event for the given container and sends it to the given
+ * recipients.
+ *
+ */
+static void send_window_event(const char *property, Con *con, event_recipients_t recipients) {
+    event_attributes_t attributes;
+    event_attributes_for_con(&attributes, property, con);
+    if (ipc_event_wanted(I3_IPC_EVENT_WINDOW, recipients | RECIPIENTS_COMPACT_WINDOW, &attributes)) {
+        send_compact_window_event(property, con, recipients | RECIPIENTS_COMPACT_WINDOW, &attributes);
+    }
+    recipients |= RECIPIENTS_FULL_WINDOW;
+    if (!ipc_event_wanted(I3_IPC_EVENT_WINDOW, recipients, &attributes)) {
+        return;
+    }
+
     DLOG("Issue IPC window %s event (con = %p, window = 0x%08x)\n",
          property, con, (con->window ? con->window->id : XCB_WINDOW_NONE));
 
@@ -1612,15 +4161,145 @@ void ipc_send_window_event(const char *property, Con *con) {
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_event("window", I3_IPC_EVENT_WINDOW, (const char *)payload);
+    ipc_send_event_to(I3_IPC_EVENT_WINDOW, (const char *)payload, recipients, &attributes);
     y(free);
     setlocale(LC_NUMERIC, "");
 }
 
+static void coalesced_event_free(struct coalesced_event *event) {
+    ev_timer_stop(main_loop, &(event->timer));
+    TAILQ_REMOVE(&coalesced_events, event, events);
+    free(event->property);
+    free(event);
+}
+
+static void coalesced_event_cb(EV_P_ ev_timer *w, int revents) {
+    struct coalesced_event *event = w->data;
+    if (!event->pending) {
+        /* No updates within the last interval, the next one can be sent right
+         * away again. */
+        coalesced_event_free(event);
+        return;
+    }
+
+    event->pending = false;
+    send_window_event(event->property, event->con, RECIPIENTS_COALESCED);
+}
+
+/*
+ * Returns the configured coalescing interval for the given window event
+ * change, or 0 if those events are sent immediately.
+ *
+ */
+static ev_tstamp coalesce_interval(const char *property) {
+    if (strcmp(property, "title") == 0) {
+        return config.ipc_coalesce_title;
+    }
+    if (strcmp(property, "mark") == 0) {
+        return config.ipc_coalesce_mark;
+    }
+    return 0;
+}
+
+/*
+ * Sends the pending coalesced events of the given container and forgets about
+ * them, e.g. before it is closed.
+ *
+ */
+static void coalesced_events_flush(Con *con) {
+    struct coalesced_event *event, *next;
+    for (event = TAILQ_FIRST(&coalesced_events); event != NULL; event = next) {
+        next = TAILQ_NEXT(event, events);
+        if (event->con != con) {
+            continue;
+        }
+        if (event->pending) {
+            send_window_event(event->property, con, RECIPIENTS_COALESCED);
+        }
+        coalesced_event_free(event);
+    }
+}
+
+/*
+ * Drops the coalesced window events which are pending for the given
+ * container, which is about to be freed.
+ *
+ */
+void ipc_window_events_con_freed(Con *con) {
+    struct coalesced_event *event, *next;
+    for (event = TAILQ_FIRST(&coalesced_events); event != NULL; event = next) {
+        next = TAILQ_NEXT(event, events);
+        if (event->con == con) {
+            coalesced_event_free(event);
+        }
+    }
+}
+
+/*
+ * For the window events we send, along the usual "change" field,
+ * also the window container, in "container".
+ *
+ * Title and mark changes can be coalesced per container (see the
+ * ipc_coalesce_events directive): the first change is sent immediately, later
+ * ones within the interval are merged into a single event carrying the latest
+ * state.
+ */
+void ipc_send_window_event(const char *property, Con *con) {
+    /* Marks are part of the GET_MARKS reply. All window properties are part
+     * of the GET_TREE reply. */
+    if (strcmp(property, "mark") == 0) {
+        ipc_invalidate_reply_cache();
+    } else {
+        tree_note_change();
+    }
+
+    if (!ipc_has_event_listeners(I3_IPC_EVENT_WINDOW)) {
+        return;
+    }
+
+    if (strcmp(property, "close") == 0) {
+        coalesced_events_flush(con);
+        send_window_event(property, con, RECIPIENTS_ALL);
+        return;
+    }
+
+    const ev_tstamp interval = coalesce_interval(property);
+    if (interval <= 0) {
+        send_window_event(property, con, RECIPIENTS_ALL);
+        return;
+    }
+
+    struct coalesced_event *event;
+    TAILQ_FOREACH (event, &coalesced_events, events) {
+        if (event->con == con && strcmp(event->property, property) == 0) {
+            break;
+        }
+    }
+    if (event != NULL) {
+        event->pending = true;
+        send_window_event(property, con, RECIPIENTS_UNCOALESCED);
+        return;
+    }
+
+    event = scalloc(1, sizeof(struct coalesced_event));
+    event->con = con;
+    event->property = sstrdup(property);
+    ev_timer_init(&(event->timer), coalesced_event_cb, interval, interval);
+    event->timer.data = event;
+    ev_timer_start(main_loop, &(event->timer));
+    TAILQ_INSERT_TAIL(&coalesced_events, event, events);
+
+    send_window_event(property, con, RECIPIENTS_ALL);
+}
+
 /*
  * For the barconfig update events, we send the serialized barconfig.
  */
 void ipc_send_barconfig_update_event(Barconfig *barconfig) {
+    if (!ipc_has_event_listeners(I3_IPC_EVENT_BARCONFIG_UPDATE)) {
+        return;
+    }
+
     DLOG("Issue barconfig_update event for id = %s\n", barconfig->id);
     setlocale(LC_NUMERIC, "C");
     yajl_gen gen = ygenalloc();
@@ -1631,15 +4310,49 @@ void ipc_send_barconfig_update_event(Barconfig *barconfig) {
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_event("barconfig_update", I3_IPC_EVENT_BARCONFIG_UPDATE, (const char *)payload);
+    ipc_send_event(I3_IPC_EVENT_BARCONFIG_UPDATE, (const char *)payload);
     y(free);
     setlocale(LC_NUMERIC, "");
 }
 
 /*
- * For the binding events, we send the serialized binding struct.
+ * Sends the compact form of a binding event, which only carries the id of the
+ * binding and the X11 timestamp of the input event.
+ *
+ */
+static void ipc_send_compact_binding_event(const char *event_type, Binding *bind, const event_attributes_t *attributes) {
+    yajl_gen gen = ygenalloc();
+
+    y(map_open);
+    ystr("change");
+    ystr(event_type);
+    ystr("id");
+    y(integer, bind->id);
+    ystr("time");
+    y(integer, last_timestamp);
+    y(map_close);
+
+    const unsigned char *payload;
+    ylength length;
+    y(get_buf, &payload, &length);
+
+    ipc_send_event_to(I3_IPC_EVENT_BINDING, (const char *)payload, RECIPIENTS_COMPACT_BINDING, attributes);
+    y(free);
+}
+
+/*
+ * For the binding events, we send the serialized binding struct, or just its
+ * id to clients which subscribed to "binding_compact".
  */
 void ipc_send_binding_event(const char *event_type, Binding *bind) {
+    const event_attributes_t attributes = {.change = (char *)event_type};
+    if (ipc_event_wanted(I3_IPC_EVENT_BINDING, RECIPIENTS_COMPACT_BINDING, &attributes)) {
+        ipc_send_compact_binding_event(event_type, bind, &attributes);
+    }
+    if (!ipc_event_wanted(I3_IPC_EVENT_BINDING, RECIPIENTS_FULL_BINDING, &attributes)) {
+        return;
+    }
+
     DLOG("Issue IPC binding %s event (sym = %s, code = %d)\n", event_type, bind->symbol, bind->keycode);
 
     setlocale(LC_NUMERIC, "C");
@@ -1660,7 +4373,7 @@ void ipc_send_binding_event(const char *event_type, Binding *bind) {
     ylength length;
     y(get_buf, &payload, &length);
 
-    ipc_send_event("binding", I3_IPC_EVENT_BINDING, (const char *)payload);
+    ipc_send_event_to(I3_IPC_EVENT_BINDING, (const char *)payload, RECIPIENTS_FULL_BINDING, &attributes);
 
     y(free);
     setlocale(LC_NUMERIC, "");
@@ -0,0 +1,466 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * json_snapshot.c: Records the calls of a JSON generator into a compact
+ *                  buffer, which is serialized on a worker thread.
+ *
+ * Generating the JSON for a large tree (escaping strings, formatting numbers,
+ * converting to CBOR) takes long enough to delay the handling of input. The
+ * snapshot only copies the values, which is cheap and has to happen on the
+ * main thread because the tree is not thread-safe. The expensive part runs on
+ * a worker thread (see worker.c).
+ *
+ */
+#include "all.h"
+#include "yajl_utils.h"
+
+#include <math.h>
+
+typedef enum {
+    TOKEN_MAP_OPEN,
+    TOKEN_MAP_CLOSE,
+    TOKEN_ARRAY_OPEN,
+    TOKEN_ARRAY_CLOSE,
+    TOKEN_NULL,
+    TOKEN_FALSE,
+    TOKEN_TRUE,
+    /* followed by a long long */
+    TOKEN_INTEGER,
+    /* followed by a double */
+    TOKEN_DOUBLE,
+    /* followed by the length as uint32_t and the bytes */
+    TOKEN_STRING,
+} token_t;
+
+struct json_snapshot {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+};
+
+/* The JSON written by json_snapshot_write() */
+struct json_buffer {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+};
+
+/* The state of a map or array json_snapshot_write() is in */
+struct json_level {
+    bool map;
+    /* Keys and values written so far */
+    size_t items;
+};
+
+struct serialize_job {
+    json_snapshot_t *snapshot;
+    bool cbor;
+    json_snapshot_cb callback;
+    void *data;
+
+    uint8_t *payload;
+    size_t size;
+};
+
+/*
+ * Creates a new, empty snapshot.
+ *
+ */
+json_snapshot_t *json_snapshot_new(void) {
+    json_snapshot_t *snapshot = scalloc(1, sizeof(json_snapshot_t));
+    snapshot->capacity = 4096;
+    snapshot->data = smalloc(snapshot->capacity);
+    return snapshot;
+}
+
+/*
+ * Frees the snapshot.
+ *
+ */
+void json_snapshot_free(json_snapshot_t *snapshot) {
+    free(snapshot->data);
+    free(snapshot);
+}
+
+/*
+ * Returns the size of the recorded tokens in bytes.
+ *
+ */
+size_t json_snapshot_size(json_snapshot_t *snapshot) {
+    return snapshot->size;
+}
+
+static void snapshot_append(json_snapshot_t *snapshot, const void *data, size_t size) {
+    if (snapshot->size + size > snapshot->capacity) {
+        while (snapshot->size + size > snapshot->capacity) {
+            snapshot->capacity *= 2;
+        }
+        snapshot->data = srealloc(snapshot->data, snapshot->capacity);
+    }
+    memcpy(snapshot->data + snapshot->size, data, size);
+    snapshot->size += size;
+}
+
+static yajl_gen_status snapshot_token(json_snapshot_t *snapshot, token_t token) {
+    const uint8_t byte = token;
+    snapshot_append(snapshot, &byte, sizeof(byte));
+    return yajl_gen_status_ok;
+}
+
+yajl_gen_status json_snapshot_map_open(json_snapshot_t *snapshot) {
+    return snapshot_token(snapshot, TOKEN_MAP_OPEN);
+}
+
+yajl_gen_status json_snapshot_map_close(json_snapshot_t *snapshot) {
+    return snapshot_token(snapshot, TOKEN_MAP_CLOSE);
+}
+
+yajl_gen_status json_snapshot_array_open(json_snapshot_t *snapshot) {
+    return snapshot_token(snapshot, TOKEN_ARRAY_OPEN);
+}
+
+yajl_gen_status json_snapshot_array_close(json_snapshot_t *snapshot) {
+    return snapshot_token(snapshot, TOKEN_ARRAY_CLOSE);
+}
+
+yajl_gen_status json_snapshot_null(json_snapshot_t *snapshot) {
+    return snapshot_token(snapshot, TOKEN_NULL);
+}
+
+yajl_gen_status json_snapshot_bool(json_snapshot_t *snapshot, int value) {
+    return snapshot_token(snapshot, (value ? TOKEN_TRUE : TOKEN_FALSE));
+}
+
+yajl_gen_status json_snapshot_integer(json_snapshot_t *snapshot, long long value) {
+    snapshot_token(snapshot, TOKEN_INTEGER);
+    snapshot_append(snapshot, &value, sizeof(value));
+    return yajl_gen_status_ok;
+}
+
+yajl_gen_status json_snapshot_double(json_snapshot_t *snapshot, double value) {
+    snapshot_token(snapshot, TOKEN_DOUBLE);
+    snapshot_append(snapshot, &value, sizeof(value));
+    return yajl_gen_status_ok;
+}
+
+yajl_gen_status json_snapshot_string(json_snapshot_t *snapshot, const unsigned char *str, size_t len) {
+    const uint32_t length = len;
+    snapshot_token(snapshot, TOKEN_STRING);
+    snapshot_append(snapshot, &length, sizeof(length));
+    snapshot_append(snapshot, str, length);
+    return yajl_gen_status_ok;
+}
+
+/*
+ * Generates the recorded JSON using the given generator. Doubles are formatted
+ * according to the current locale, like yajl_gen_double() does.
+ *
+ */
+void json_snapshot_replay(json_snapshot_t *snapshot, yajl_gen gen) {
+    const uint8_t *walk = snapshot->data;
+    const uint8_t *end = snapshot->data + snapshot->size;
+    while (walk < end) {
+        const token_t token = *(walk++);
+        switch (token) {
+            case TOKEN_MAP_OPEN:
+                y(map_open);
+                break;
+            case TOKEN_MAP_CLOSE:
+                y(map_close);
+                break;
+            case TOKEN_ARRAY_OPEN:
+                y(array_open);
+                break;
+            case TOKEN_ARRAY_CLOSE:
+                y(array_close);
+                break;
+            case TOKEN_NULL:
+                y(null);
+                break;
+            case TOKEN_FALSE:
+                y(bool, false);
+                break;
+            case TOKEN_TRUE:
+                y(bool, true);
+                break;
+            case TOKEN_INTEGER: {
+                long long value;
+                memcpy(&value, walk, sizeof(value));
+                walk += sizeof(value);
+                y(integer, value);
+                break;
+            }
+            case TOKEN_DOUBLE: {
+                double value;
+                memcpy(&value, walk, sizeof(value));
+                walk += sizeof(value);
+                y(double, value);
+                break;
+            }
+            case TOKEN_STRING: {
+                uint32_t length;
+                memcpy(&length, walk, sizeof(length));
+                walk += sizeof(length);
+                y(string, walk, length);
+                walk += length;
+                break;
+            }
+        }
+    }
+}
+
+static void buffer_reserve(struct json_buffer *buffer, size_t size) {
+    if (buffer->size + size > buffer->capacity) {
+        while (buffer->size + size > buffer->capacity) {
+            buffer->capacity *= 2;
+        }
+        buffer->data = srealloc(buffer->data, buffer->capacity);
+    }
+}
+
+static void buffer_append(struct json_buffer *buffer, const void *data, size_t size) {
+    buffer_reserve(buffer, size);
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+}
+
+static void buffer_byte(struct json_buffer *buffer, uint8_t byte) {
+    buffer_reserve(buffer, 1);
+    buffer->data[buffer->size++] = byte;
+}
+
+/*
+ * Writes the string with the same escaping as yajl_gen_string().
+ *
+ */
+static void write_string(struct json_buffer *buffer, const uint8_t *str, uint32_t length) {
+    /* Keys and almost all values need no escaping at all, so the bytes up to
+     * the next character which needs it are copied at once. */
+    buffer_reserve(buffer, length + 2);
+    buffer->data[buffer->size++] = '"';
+    uint32_t start = 0;
+    for (uint32_t i = 0; i < length; i++) {
+        const uint8_t c = str[i];
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        buffer_append(buffer, str + start, i - start);
+        start = i + 1;
+
+        char escaped[7] = {'\\', 0};
+        switch (c) {
+            case '"':
+            case '\\':
+                escaped[1] = c;
+                break;
+            case '\b':
+                escaped[1] = 'b';
+                break;
+            case '\f':
+                escaped[1] = 'f';
+                break;
+            case '\n':
+                escaped[1] = 'n';
+                break;
+            case '\r':
+                escaped[1] = 'r';
+                break;
+            case '\t':
+                escaped[1] = 't';
+                break;
+            default: {
+                static const char hex[] = "0123456789ABCDEF";
+                memcpy(escaped + 1, "u00", 3);
+                escaped[4] = hex[c >> 4];
+                escaped[5] = hex[c & 0xF];
+                break;
+            }
+        }
+        buffer_append(buffer, escaped, strlen(escaped));
+    }
+    buffer_append(buffer, str + start, length - start);
+    buffer_byte(buffer, '"');
+}
+
+static void write_integer(struct json_buffer *buffer, long long value) {
+    char digits[24];
+    char *walk = digits + sizeof(digits);
+    /* Negating LLONG_MIN would overflow, its magnitude fits unsigned. */
+    unsigned long long magnitude = (value < 0 ? -(unsigned long long)value : (unsigned long long)value);
+    do {
+        *(--walk) = '0' + (magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) {
+        *(--walk) = '-';
+    }
+    buffer_append(buffer, walk, digits + sizeof(digits) - walk);
+}
+
+/*
+ * Writes the double like yajl_gen_double() does in the C locale, regardless
+ * of the current locale.
+ *
+ */
+static void write_double(struct json_buffer *buffer, double value) {
+    if (isnan(value) || isinf(value)) {
+        /* yajl refuses to generate these */
+        buffer_append(buffer, "null", strlen("null"));
+        return;
+    }
+    char formatted[32];
+    snprintf(formatted, sizeof(formatted), "%.20g", value);
+    for (char *walk = formatted; *walk != '\0'; walk++) {
+        if (*walk == ',') {
+            *walk = '.';
+        }
+    }
+    buffer_append(buffer, formatted, strlen(formatted));
+    if (strspn(formatted, "0123456789-") == strlen(formatted)) {
+        buffer_append(buffer, ".0", strlen(".0"));
+    }
+}
+
+/*
+ * Writes the recorded JSON into a newly allocated buffer without using yajl:
+ * the snapshot is known to be well-formed, so the generator does not need to
+ * validate its state, integers are formatted without printf, and strings are
+ * only escaped where necessary. The output is the same as the one of
+ * json_snapshot_replay(), except that doubles are always formatted as in the
+ * C locale.
+ *
+ */
+void json_snapshot_write(json_snapshot_t *snapshot, uint8_t **payload, size_t *size) {
+    /* Most of the snapshot is strings, which are about as long in JSON. */
+    struct json_buffer buffer = {.capacity = snapshot->size + 64};
+    buffer.data = smalloc(buffer.capacity);
+
+    int depth = 0;
+    int levels_size = 32;
+    struct json_level *levels = smalloc(levels_size * sizeof(struct json_level));
+
+    const uint8_t *walk = snapshot->data;
+    const uint8_t *end = snapshot->data + snapshot->size;
+    while (walk < end) {
+        const token_t token = *(walk++);
+
+        if (token == TOKEN_MAP_CLOSE || token == TOKEN_ARRAY_CLOSE) {
+            depth--;
+            buffer_byte(&buffer, (token == TOKEN_MAP_CLOSE ? '}' : ']'));
+            continue;
+        }
+
+        /* Within maps, keys and values alternate. */
+        if (depth > 0) {
+            struct json_level *level = &levels[depth - 1];
+            if (level->map && level->items % 2 == 1) {
+                buffer_byte(&buffer, ':');
+            } else if (level->items > 0) {
+                buffer_byte(&buffer, ',');
+            }
+            level->items++;
+        }
+
+        switch (token) {
+            case TOKEN_MAP_OPEN:
+            case TOKEN_ARRAY_OPEN:
+                if (depth == levels_size) {
+                    levels_size *= 2;
+                    levels = srealloc(levels, levels_size * sizeof(struct json_level));
+                }
+                levels[depth].map = (token == TOKEN_MAP_OPEN);
+                levels[depth].items = 0;
+                depth++;
+                buffer_byte(&buffer, (token == TOKEN_MAP_OPEN ? '{' : '['));
+                break;
+            case TOKEN_NULL:
+                buffer_append(&buffer, "null", strlen("null"));
+                break;
+            case TOKEN_FALSE:
+                buffer_append(&buffer, "false", strlen("false"));
+                break;
+            case TOKEN_TRUE:
+                buffer_append(&buffer, "true", strlen("true"));
+                break;
+            case TOKEN_INTEGER: {
+                long long value;
+                memcpy(&value, walk, sizeof(value));
+                walk += sizeof(value);
+                write_integer(&buffer, value);
+                break;
+            }
+            case TOKEN_DOUBLE: {
+                double value;
+                memcpy(&value, walk, sizeof(value));
+                walk += sizeof(value);
+                write_double(&buffer, value);
+                break;
+            }
+            case TOKEN_STRING: {
+                uint32_t length;
+                memcpy(&length, walk, sizeof(length));
+                walk += sizeof(length);
+                write_string(&buffer, walk, length);
+                walk += length;
+                break;
+            }
+            case TOKEN_MAP_CLOSE:
+            case TOKEN_ARRAY_CLOSE:
+                break;
+        }
+    }
+
+    free(levels);
+    *payload = buffer.data;
+    *size = buffer.size;
+}
+
+/*
+ * Serializes the job's snapshot, on a worker thread.
+ *
+ */
+static void serialize_job(void *data) {
+    struct serialize_job *job = data;
+    uint8_t *payload;
+    size_t length;
+    json_snapshot_write(job->snapshot, &payload, &length);
+    json_snapshot_free(job->snapshot);
+    job->snapshot = NULL;
+
+    if (job->cbor && ipc_json_to_cbor(payload, length, &(job->payload), &(job->size))) {
+        free(payload);
+    } else {
+        /* Like ipc_message_new_encoded(), fall back to JSON. */
+        job->payload = payload;
+        job->size = length;
+    }
+}
+
+/*
+ * Passes the serialized snapshot to the callback, on the main thread.
+ *
+ */
+static void serialize_job_done(void *data) {
+    struct serialize_job *job = data;
+    job->callback(job->payload, job->size, job->data);
+    free(job->payload);
+    free(job);
+}
+
+/*
+ * Serializes the snapshot to JSON (and converts it to CBOR if cbor is set) on
+ * a worker thread, which takes ownership of the snapshot. The callback is
+ * called from the main loop once the payload is ready.
+ *
+ */
+void json_snapshot_serialize(json_snapshot_t *snapshot, bool cbor, json_snapshot_cb callback, void *data) {
+    struct serialize_job *job = scalloc(1, sizeof(struct serialize_job));
+    job->snapshot = snapshot;
+    job->cbor = cbor;
+    job->callback = callback;
+    job->data = data;
+    worker_submit(serialize_job, serialize_job_done, job);
+}
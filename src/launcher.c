@@ -0,0 +1,361 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * launcher.c: A helper process, forked at startup while i3 is still small,
+ *             which starts the commands of exec using posix_spawn().
+ *
+ * Forking i3 itself for every exec copies the page tables of all its
+ * mappings (the tree, the shmlog, …), which adds noticeable latency to
+ * launching a terminal once i3 got big. The launcher receives the commands
+ * over a socketpair and spawns them without copying anything.
+ *
+ * Note that the started commands get the environment i3 had when the launcher
+ * was forked (minus the variables meant for i3 only, see launcher_main()),
+ * not i3's current environment.
+ *
+ */
+#include "all.h"
+#include "sd-daemon.h"
+
+#include <dirent.h>
+#include <paths.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+/* i3's end of the socketpair, -1 if there is no launcher */
+static int launcher_fd = -1;
+static struct ev_io *launcher_io;
+
+/* Followed by the command, the startup id and the IPC socket path, none of
+ * them NUL-terminated. */
+struct launch_request {
+    uint32_t command_length;
+    uint32_t startup_id_length;
+    uint32_t socket_path_length;
+};
+
+/* Sent back for every request with a startup id, followed by the startup id
+ * (not NUL-terminated), so that i3 can find the startup sequence of windows
+ * which only set _NET_WM_PID. */
+struct launch_reply {
+    uint32_t startup_id_length;
+    int32_t pid;
+};
+
+/* Requests are rejected if a string is longer than this. */
+#define MAX_REQUEST_STRING (1024 * 1024)
+
+/*
+ * Reads exactly count bytes. Returns false on errors and at the end of the
+ * stream (i3 exited or restarted).
+ *
+ */
+static bool read_all(int fd, void *buf, size_t count) {
+    size_t done = 0;
+    while (done < count) {
+        const ssize_t n = read(fd, (char *)buf + done, count - done);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+static char *read_string(int fd, uint32_t length) {
+    char *string = smalloc(length + 1);
+    if (!read_all(fd, string, length)) {
+        free(string);
+        return NULL;
+    }
+    string[length] = '\0';
+    return string;
+}
+
+/*
+ * Closes all file descriptors the launcher inherited from i3 (the X11
+ * connection, socket activation and restart file descriptors, …), except
+ * for stdin, stdout, stderr and the socket to i3.
+ *
+ */
+static void close_inherited_fds(int keep) {
+    DIR *dir = opendir("/proc/self/fd");
+    if (dir == NULL) {
+        /* At least close the socket activation file descriptors, which do
+         * not have FD_CLOEXEC set (see main()). */
+        long listen_fds;
+        const char *env = getenv("LISTEN_FDS");
+        if (env != NULL && parse_long(env, &listen_fds, 10)) {
+            for (int fd = SD_LISTEN_FDS_START; fd < (SD_LISTEN_FDS_START + listen_fds); fd++) {
+                close(fd);
+            }
+        }
+        return;
+    }
+
+    const int dir_fd = dirfd(dir);
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        long fd;
+        if (!parse_long(entry->d_name, &fd, 10)) {
+            continue;
+        }
+        if (fd > STDERR_FILENO && fd != keep && fd != dir_fd) {
+            close(fd);
+        }
+    }
+    closedir(dir);
+}
+
+/*
+ * Starts the command and returns the PID of the shell (which usually execs
+ * the command) or -1 on errors.
+ *
+ */
+static pid_t spawn_command(const char *command, const char *startup_id, const char *socket_path,
+                           const posix_spawnattr_t *attr) {
+    setenv("I3SOCK", socket_path, 1);
+    /* Like sn_launcher_context_setup_child_process() does */
+    if (startup_id[0] != '\0') {
+        setenv("DESKTOP_STARTUP_ID", startup_id, 1);
+    } else {
+        unsetenv("DESKTOP_STARTUP_ID");
+    }
+
+    char *argv[] = {_PATH_BSHELL, "-c", (char *)command, NULL};
+#ifdef POSIX_SPAWN_SETSID
+    pid_t pid;
+    const int error = posix_spawn(&pid, _PATH_BSHELL, NULL, attr, argv, environ);
+    if (error != 0) {
+        errno = error;
+        warn("i3 launcher: posix_spawn(%s)", command);
+        return -1;
+    }
+#else
+    /* Without POSIX_SPAWN_SETSID, the new session needs a fork. The launcher
+     * is small, so this is still cheap. */
+    const pid_t pid = fork();
+    if (pid == -1) {
+        warn("i3 launcher: fork()");
+    } else if (pid == 0) {
+        setsid();
+        signal(SIGPIPE, SIG_DFL);
+        signal(SIGCHLD, SIG_DFL);
+        execve(_PATH_BSHELL, argv, environ);
+        _exit(EXIT_FAILURE);
+    }
+#endif
+    return pid;
+}
+
+static void send_reply(int fd, const char *startup_id, pid_t pid) {
+    const struct launch_reply reply = {
+        .startup_id_length = strlen(startup_id),
+        .pid = pid,
+    };
+    const size_t length = sizeof(reply) + reply.startup_id_length;
+    char *buffer = smalloc(length);
+    memcpy(buffer, &reply, sizeof(reply));
+    memcpy(buffer + sizeof(reply), startup_id, reply.startup_id_length);
+    writeall(fd, buffer, length);
+    free(buffer);
+}
+
+static void launcher_main(int fd) {
+    close_inherited_fds(fd);
+    setrlimit(RLIMIT_CORE, &original_rlimit_core);
+    unsetenv("LISTEN_PID");
+    unsetenv("LISTEN_FDS");
+    /* i3 unsets these only after forking the launcher (see main() and
+     * sd_notify()), and they must not leak to the started commands. */
+    unsetenv("NOTIFY_SOCKET");
+    unsetenv("_I3_RESTART_FD");
+    unsetenv("_I3_RESTART_SNAPSHOT_FD");
+    /* The started processes are reaped automatically. */
+    signal(SIGCHLD, SIG_IGN);
+
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t signals;
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attr, &signals);
+    sigaddset(&signals, SIGPIPE);
+    sigaddset(&signals, SIGCHLD);
+    posix_spawnattr_setsigdefault(&attr, &signals);
+    short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+#ifdef POSIX_SPAWN_SETSID
+    flags |= POSIX_SPAWN_SETSID;
+#endif
+    posix_spawnattr_setflags(&attr, flags);
+
+    while (true) {
+        struct launch_request request;
+        if (!read_all(fd, &request, sizeof(request))) {
+            break;
+        }
+        if (request.command_length > MAX_REQUEST_STRING ||
+            request.startup_id_length > MAX_REQUEST_STRING ||
+            request.socket_path_length > MAX_REQUEST_STRING) {
+            warnx("i3 launcher: invalid request");
+            break;
+        }
+
+        char *command = read_string(fd, request.command_length);
+        char *startup_id = (command ? read_string(fd, request.startup_id_length) : NULL);
+        char *socket_path = (startup_id ? read_string(fd, request.socket_path_length) : NULL);
+        if (socket_path != NULL) {
+            const pid_t pid = spawn_command(command, startup_id, socket_path, &attr);
+            if (pid != -1 && startup_id[0] != '\0') {
+                send_reply(fd, startup_id, pid);
+            }
+        }
+        const bool complete = (socket_path != NULL);
+        free(command);
+        free(startup_id);
+        free(socket_path);
+        if (!complete) {
+            break;
+        }
+    }
+
+    posix_spawnattr_destroy(&attr);
+    _exit(EXIT_SUCCESS);
+}
+
+static void launcher_stop(void) {
+    if (launcher_io != NULL) {
+        ev_io_stop(main_loop, launcher_io);
+        FREE(launcher_io);
+    }
+    close(launcher_fd);
+    launcher_fd = -1;
+}
+
+/*
+ * Reads the PID of a started command and passes it on to the startup
+ * notification code.
+ *
+ */
+static void launcher_read_cb(EV_P_ ev_io *w, int revents) {
+    struct launch_reply reply;
+    char *startup_id = NULL;
+    if (!read_all(launcher_fd, &reply, sizeof(reply)) ||
+        reply.startup_id_length > MAX_REQUEST_STRING ||
+        (startup_id = read_string(launcher_fd, reply.startup_id_length)) == NULL) {
+        ELOG("The launcher exited, forking for exec from now on.\n");
+        launcher_stop();
+        return;
+    }
+
+    DLOG("Launcher started PID %d for startup id %s\n", reply.pid, startup_id);
+    startup_sequence_set_pid(startup_id, reply.pid);
+    free(startup_id);
+}
+
+/*
+ * Forks the launcher process. Has to be called early, before i3 allocated
+ * much memory, as the launcher keeps a copy of i3's address space. If this
+ * fails, commands are started by forking i3 itself (see start_application()).
+ *
+ * The launcher is double-forked, so that init adopts (and reaps) it: when i3
+ * restarts in place, the launcher exits, and the new i3 would not know about
+ * it.
+ *
+ */
+void launcher_start(void) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == -1) {
+        ELOG("Could not create the launcher socketpair: %s\n", strerror(errno));
+        return;
+    }
+
+    const pid_t pid = fork();
+    if (pid == -1) {
+        ELOG("Could not fork the launcher: %s\n", strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        return;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        const pid_t launcher_pid = fork();
+        if (launcher_pid == 0) {
+            launcher_main(fds[1]);
+            /* not reached */
+        }
+        /* If the second fork failed, i3 reads EOF from the socket and stops
+         * using the launcher. */
+        _exit(launcher_pid == -1 ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+
+    close(fds[1]);
+    while (waitpid(pid, NULL, 0) == -1 && errno == EINTR) {
+    }
+    launcher_fd = fds[0];
+    DLOG("Started the launcher\n");
+}
+
+/*
+ * Asks the launcher to start the given command using /bin/sh, with I3SOCK set
+ * and DESKTOP_STARTUP_ID set to the given startup id (unless it is NULL).
+ * Returns false if there is no launcher, so that the caller can start the
+ * command itself. The PID of the started process is reported to
+ * startup_sequence_set_pid() later on.
+ *
+ */
+bool launcher_exec(const char *command, const char *startup_id) {
+    if (launcher_fd == -1) {
+        return false;
+    }
+
+    if (startup_id == NULL) {
+        startup_id = "";
+    }
+    const char *socket_path = (current_socketpath ? current_socketpath : "");
+    if (strlen(command) > MAX_REQUEST_STRING || strlen(socket_path) > MAX_REQUEST_STRING) {
+        return false;
+    }
+    const struct launch_request request = {
+        .command_length = strlen(command),
+        .startup_id_length = strlen(startup_id),
+        .socket_path_length = strlen(socket_path),
+    };
+    const size_t length = sizeof(request) + request.command_length +
+                          request.startup_id_length + request.socket_path_length;
+    char *buffer = smalloc(length);
+    char *walk = buffer;
+    memcpy(walk, &request, sizeof(request));
+    walk += sizeof(request);
+    memcpy(walk, command, request.command_length);
+    walk += request.command_length;
+    memcpy(walk, startup_id, request.startup_id_length);
+    walk += request.startup_id_length;
+    memcpy(walk, socket_path, request.socket_path_length);
+
+    const bool sent = (writeall(launcher_fd, buffer, length) == (ssize_t)length);
+    free(buffer);
+    if (!sent) {
+        ELOG("Could not send the command to the launcher, forking instead: %s\n", strerror(errno));
+        launcher_stop();
+        return false;
+    }
+
+    /* The main loop does not exist yet when the launcher is started. */
+    if (launcher_io == NULL) {
+        launcher_io = scalloc(1, sizeof(struct ev_io));
+        ev_io_init(launcher_io, launcher_read_cb, launcher_fd, EV_READ);
+        ev_io_start(main_loop, launcher_io);
+    }
+    return true;
+}
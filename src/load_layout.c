@@ -16,7 +16,103 @@
 
 /* TODO: refactor the whole parsing thing */
 
+/* The keys of a layout file (or a GET_TREE reply), matched case-insensitively
+ * since the first versions of i3. */
+typedef enum {
+    LAYOUT_KEY_FLOATING_NODES,
+    LAYOUT_KEY_SWALLOWS,
+    LAYOUT_KEY_RECT,
+    LAYOUT_KEY_DECO_RECT,
+    LAYOUT_KEY_WINDOW_RECT,
+    LAYOUT_KEY_GEOMETRY,
+    LAYOUT_KEY_FOCUS,
+    LAYOUT_KEY_MARKS,
+    LAYOUT_KEY_CLASS,
+    LAYOUT_KEY_INSTANCE,
+    LAYOUT_KEY_WINDOW_ROLE,
+    LAYOUT_KEY_TITLE,
+    LAYOUT_KEY_MACHINE,
+    LAYOUT_KEY_NAME,
+    LAYOUT_KEY_TITLE_FORMAT,
+    LAYOUT_KEY_STICKY_GROUP,
+    LAYOUT_KEY_ORIENTATION,
+    LAYOUT_KEY_BORDER,
+    LAYOUT_KEY_TYPE,
+    LAYOUT_KEY_LAYOUT,
+    LAYOUT_KEY_WORKSPACE_LAYOUT,
+    LAYOUT_KEY_LAST_SPLIT_LAYOUT,
+    LAYOUT_KEY_MARK,
+    LAYOUT_KEY_FLOATING,
+    LAYOUT_KEY_SCRATCHPAD_STATE,
+    LAYOUT_KEY_PREVIOUS_WORKSPACE_NAME,
+    LAYOUT_KEY_FULLSCREEN_MODE,
+    LAYOUT_KEY_NUM,
+    LAYOUT_KEY_CURRENT_BORDER_WIDTH,
+    LAYOUT_KEY_WINDOW_ICON_PADDING,
+    LAYOUT_KEY_DEPTH,
+    LAYOUT_KEY_ID,
+    LAYOUT_KEY_X,
+    LAYOUT_KEY_Y,
+    LAYOUT_KEY_WIDTH,
+    LAYOUT_KEY_HEIGHT,
+    LAYOUT_KEY_DOCK,
+    LAYOUT_KEY_INSERT_WHERE,
+    LAYOUT_KEY_FOCUSED,
+    LAYOUT_KEY_STICKY,
+    LAYOUT_KEY_RESTART_MODE,
+    LAYOUT_KEY_PERCENT,
+} layout_key_t;
+
+static const char *const layout_key_names[] = {
+    [LAYOUT_KEY_FLOATING_NODES] = "floating_nodes",
+    [LAYOUT_KEY_SWALLOWS] = "swallows",
+    [LAYOUT_KEY_RECT] = "rect",
+    [LAYOUT_KEY_DECO_RECT] = "deco_rect",
+    [LAYOUT_KEY_WINDOW_RECT] = "window_rect",
+    [LAYOUT_KEY_GEOMETRY] = "geometry",
+    [LAYOUT_KEY_FOCUS] = "focus",
+    [LAYOUT_KEY_MARKS] = "marks",
+    [LAYOUT_KEY_CLASS] = "class",
+    [LAYOUT_KEY_INSTANCE] = "instance",
+    [LAYOUT_KEY_WINDOW_ROLE] = "window_role",
+    [LAYOUT_KEY_TITLE] = "title",
+    [LAYOUT_KEY_MACHINE] = "machine",
+    [LAYOUT_KEY_NAME] = "name",
+    [LAYOUT_KEY_TITLE_FORMAT] = "title_format",
+    [LAYOUT_KEY_STICKY_GROUP] = "sticky_group",
+    [LAYOUT_KEY_ORIENTATION] = "orientation",
+    [LAYOUT_KEY_BORDER] = "border",
+    [LAYOUT_KEY_TYPE] = "type",
+    [LAYOUT_KEY_LAYOUT] = "layout",
+    [LAYOUT_KEY_WORKSPACE_LAYOUT] = "workspace_layout",
+    [LAYOUT_KEY_LAST_SPLIT_LAYOUT] = "last_split_layout",
+    [LAYOUT_KEY_MARK] = "mark",
+    [LAYOUT_KEY_FLOATING] = "floating",
+    [LAYOUT_KEY_SCRATCHPAD_STATE] = "scratchpad_state",
+    [LAYOUT_KEY_PREVIOUS_WORKSPACE_NAME] = "previous_workspace_name",
+    [LAYOUT_KEY_FULLSCREEN_MODE] = "fullscreen_mode",
+    [LAYOUT_KEY_NUM] = "num",
+    [LAYOUT_KEY_CURRENT_BORDER_WIDTH] = "current_border_width",
+    [LAYOUT_KEY_WINDOW_ICON_PADDING] = "window_icon_padding",
+    [LAYOUT_KEY_DEPTH] = "depth",
+    [LAYOUT_KEY_ID] = "id",
+    [LAYOUT_KEY_X] = "x",
+    [LAYOUT_KEY_Y] = "y",
+    [LAYOUT_KEY_WIDTH] = "width",
+    [LAYOUT_KEY_HEIGHT] = "height",
+    [LAYOUT_KEY_DOCK] = "dock",
+    [LAYOUT_KEY_INSERT_WHERE] = "insert_where",
+    [LAYOUT_KEY_FOCUSED] = "focused",
+    [LAYOUT_KEY_STICKY] = "sticky",
+    [LAYOUT_KEY_RESTART_MODE] = "restart_mode",
+    [LAYOUT_KEY_PERCENT] = "percent",
+};
+
+static json_key_table_t layout_keys = JSON_KEY_TABLE(layout_key_names, true);
+
 static char *last_key;
+/* The layout_key_t of last_key, or JSON_KEY_UNKNOWN */
+static int last_key_id = JSON_KEY_UNKNOWN;
 static int incomplete;
 static Con *json_node;
 static Con *to_focus;
@@ -54,14 +150,14 @@ static int json_start_map(void *ctx) {
     LOG("start of map, last_key = %s\n", last_key);
     if (parsing_swallows) {
         LOG("creating new swallow\n");
-        current_swallow = smalloc(sizeof(Match));
+        current_swallow = pool_alloc(&match_pool);
         match_init(current_swallow);
         current_swallow->dock = M_DONTCHECK;
-        TAILQ_INSERT_TAIL(&(json_node->swallow_head), current_swallow, matches);
+        TAILQ_INSERT_TAIL(&(json_node->cold->swallow_head), current_swallow, matches);
         swallow_is_empty = true;
     } else {
         if (!parsing_rect && !parsing_deco_rect && !parsing_window_rect && !parsing_geometry) {
-            if (last_key && strcasecmp(last_key, "floating_nodes") == 0) {
+            if (last_key_id == LAYOUT_KEY_FLOATING_NODES) {
                 DLOG("New floating_node\n");
                 Con *ws = con_get_workspace(json_node);
                 json_node = con_new_skeleton(NULL, NULL);
@@ -93,13 +189,13 @@ static int json_end_map(void *ctx) {
 
         /* Sanity check: swallow criteria don’t make any sense on a split
          * container. */
-        if (con_is_split(json_node) > 0 && !TAILQ_EMPTY(&(json_node->swallow_head))) {
+        if (con_is_split(json_node) > 0 && !TAILQ_EMPTY(&(json_node->cold->swallow_head))) {
             DLOG("sanity check: removing swallows specification from split container\n");
-            while (!TAILQ_EMPTY(&(json_node->swallow_head))) {
-                Match *match = TAILQ_FIRST(&(json_node->swallow_head));
-                TAILQ_REMOVE(&(json_node->swallow_head), match, matches);
+            while (!TAILQ_EMPTY(&(json_node->cold->swallow_head))) {
+                Match *match = TAILQ_FIRST(&(json_node->cold->swallow_head));
+                con_remove_swallow(json_node, match);
                 match_free(match);
-                free(match);
+                pool_free(&match_pool, match);
             }
         }
 
@@ -134,6 +230,7 @@ static int json_end_map(void *ctx) {
         if (json_node->type == CT_FLOATING_CON) {
             DLOG("fixing parent which currently is %p / %s\n", json_node->parent, json_node->parent->name);
             json_node->parent = con_get_workspace(json_node->parent);
+            con_invalidate_lookups();
 
             // Also set a size if none was supplied, otherwise the placeholder
             // window cannot be created as X11 requests with width=0 or
@@ -191,6 +288,10 @@ static int json_end_map(void *ctx) {
         ELOG("Layout file is invalid: found an empty swallow definition.\n");
         return 0;
     }
+    if (parsing_swallows) {
+        /* The criteria are complete now, so the swallow can be indexed. */
+        con_index_swallow(json_node, current_swallow);
+    }
 
     parsing_rect = false;
     parsing_deco_rect = false;
@@ -224,6 +325,7 @@ static int json_end_array(void *ctx) {
                 /* Move this entry to the top of the focus list. */
                 TAILQ_REMOVE(&(json_node->focus_head), con, focused);
                 TAILQ_INSERT_HEAD(&(json_node->focus_head), con, focused);
+                con_invalidate_lookups();
                 break;
             }
         }
@@ -242,27 +344,32 @@ static int json_key(void *ctx, const unsigned char *val, size_t len) {
     FREE(last_key);
     last_key = scalloc(len + 1, 1);
     memcpy(last_key, val, len);
-    if (strcasecmp(last_key, "swallows") == 0)
-        parsing_swallows = true;
-
-    if (strcasecmp(last_key, "rect") == 0)
-        parsing_rect = true;
-
-    if (strcasecmp(last_key, "deco_rect") == 0)
-        parsing_deco_rect = true;
-
-    if (strcasecmp(last_key, "window_rect") == 0)
-        parsing_window_rect = true;
-
-    if (strcasecmp(last_key, "geometry") == 0)
-        parsing_geometry = true;
-
-    if (strcasecmp(last_key, "focus") == 0)
-        parsing_focus = true;
-
-    if (strcasecmp(last_key, "marks") == 0) {
-        num_marks = 0;
-        parsing_marks = true;
+    last_key_id = json_key_lookup(&layout_keys, val, len);
+    switch (last_key_id) {
+        case LAYOUT_KEY_SWALLOWS:
+            parsing_swallows = true;
+            break;
+        case LAYOUT_KEY_RECT:
+            parsing_rect = true;
+            break;
+        case LAYOUT_KEY_DECO_RECT:
+            parsing_deco_rect = true;
+            break;
+        case LAYOUT_KEY_WINDOW_RECT:
+            parsing_window_rect = true;
+            break;
+        case LAYOUT_KEY_GEOMETRY:
+            parsing_geometry = true;
+            break;
+        case LAYOUT_KEY_FOCUS:
+            parsing_focus = true;
+            break;
+        case LAYOUT_KEY_MARKS:
+            num_marks = 0;
+            parsing_marks = true;
+            break;
+        default:
+            break;
     }
 
     return 1;
@@ -273,23 +380,30 @@ static int json_string(void *ctx, const unsigned char *val, size_t len) {
     if (parsing_swallows) {
         char *sval;
         sasprintf(&sval, "%.*s", len, val);
-        if (strcasecmp(last_key, "class") == 0) {
-            current_swallow->class = regex_new(sval);
-            swallow_is_empty = false;
-        } else if (strcasecmp(last_key, "instance") == 0) {
-            current_swallow->instance = regex_new(sval);
-            swallow_is_empty = false;
-        } else if (strcasecmp(last_key, "window_role") == 0) {
-            current_swallow->window_role = regex_new(sval);
-            swallow_is_empty = false;
-        } else if (strcasecmp(last_key, "title") == 0) {
-            current_swallow->title = regex_new(sval);
-            swallow_is_empty = false;
-        } else if (strcasecmp(last_key, "machine") == 0) {
-            current_swallow->machine = regex_new(sval);
-            swallow_is_empty = false;
-        } else {
-            ELOG("swallow key %s unknown\n", last_key);
+        switch (last_key_id) {
+            case LAYOUT_KEY_CLASS:
+                match_set_regex(current_swallow, CRIT_CLASS, sval);
+                swallow_is_empty = false;
+                break;
+            case LAYOUT_KEY_INSTANCE:
+                match_set_regex(current_swallow, CRIT_INSTANCE, sval);
+                swallow_is_empty = false;
+                break;
+            case LAYOUT_KEY_WINDOW_ROLE:
+                match_set_regex(current_swallow, CRIT_WINDOW_ROLE, sval);
+                swallow_is_empty = false;
+                break;
+            case LAYOUT_KEY_TITLE:
+                match_set_regex(current_swallow, CRIT_TITLE, sval);
+                swallow_is_empty = false;
+                break;
+            case LAYOUT_KEY_MACHINE:
+                match_set_regex(current_swallow, CRIT_MACHINE, sval);
+                swallow_is_empty = false;
+                break;
+            default:
+                ELOG("swallow key %s unknown\n", last_key);
+                break;
         }
         free(sval);
     } else if (parsing_marks) {
@@ -300,141 +414,169 @@ static int json_string(void *ctx, const unsigned char *val, size_t len) {
         marks[num_marks - 1].mark = sstrdup(mark);
         marks[num_marks - 1].con_to_be_marked = json_node;
     } else {
-        if (strcasecmp(last_key, "name") == 0) {
-            json_node->name = scalloc(len + 1, 1);
-            memcpy(json_node->name, val, len);
-        } else if (strcasecmp(last_key, "title_format") == 0) {
-            json_node->title_format = scalloc(len + 1, 1);
-            memcpy(json_node->title_format, val, len);
-        } else if (strcasecmp(last_key, "sticky_group") == 0) {
-            json_node->sticky_group = scalloc(len + 1, 1);
-            memcpy(json_node->sticky_group, val, len);
-            LOG("sticky_group of this container is %s\n", json_node->sticky_group);
-        } else if (strcasecmp(last_key, "orientation") == 0) {
-            /* Upgrade path from older versions of i3 (doing an inplace restart
-             * to a newer version):
-             * "orientation" is dumped before "layout". Therefore, we store
-             * whether the orientation was horizontal or vertical in the
-             * last_split_layout. When we then encounter layout == "default",
-             * we will use the last_split_layout as layout instead. */
-            char *buf = NULL;
-            sasprintf(&buf, "%.*s", (int)len, val);
-            if (strcasecmp(buf, "none") == 0 ||
-                strcasecmp(buf, "horizontal") == 0)
-                json_node->last_split_layout = L_SPLITH;
-            else if (strcasecmp(buf, "vertical") == 0)
-                json_node->last_split_layout = L_SPLITV;
-            else
-                LOG("Unhandled orientation: %s\n", buf);
-            free(buf);
-        } else if (strcasecmp(last_key, "border") == 0) {
-            char *buf = NULL;
-            sasprintf(&buf, "%.*s", (int)len, val);
-            if (strcasecmp(buf, "none") == 0)
-                json_node->border_style = BS_NONE;
-            else if (strcasecmp(buf, "1pixel") == 0) {
-                json_node->border_style = BS_PIXEL;
-                json_node->current_border_width = 1;
-            } else if (strcasecmp(buf, "pixel") == 0)
-                json_node->border_style = BS_PIXEL;
-            else if (strcasecmp(buf, "normal") == 0)
-                json_node->border_style = BS_NORMAL;
-            else
-                LOG("Unhandled \"border\": %s\n", buf);
-            free(buf);
-        } else if (strcasecmp(last_key, "type") == 0) {
-            char *buf = NULL;
-            sasprintf(&buf, "%.*s", (int)len, val);
-            if (strcasecmp(buf, "root") == 0)
-                json_node->type = CT_ROOT;
-            else if (strcasecmp(buf, "output") == 0)
-                json_node->type = CT_OUTPUT;
-            else if (strcasecmp(buf, "con") == 0)
-                json_node->type = CT_CON;
-            else if (strcasecmp(buf, "floating_con") == 0)
-                json_node->type = CT_FLOATING_CON;
-            else if (strcasecmp(buf, "workspace") == 0)
-                json_node->type = CT_WORKSPACE;
-            else if (strcasecmp(buf, "dockarea") == 0)
-                json_node->type = CT_DOCKAREA;
-            else
-                LOG("Unhandled \"type\": %s\n", buf);
-            free(buf);
-        } else if (strcasecmp(last_key, "layout") == 0) {
-            char *buf = NULL;
-            sasprintf(&buf, "%.*s", (int)len, val);
-            if (strcasecmp(buf, "default") == 0)
-                /* This set above when we read "orientation". */
-                json_node->layout = json_node->last_split_layout;
-            else if (strcasecmp(buf, "stacked") == 0)
-                json_node->layout = L_STACKED;
-            else if (strcasecmp(buf, "tabbed") == 0)
-                json_node->layout = L_TABBED;
-            else if (strcasecmp(buf, "dockarea") == 0)
-                json_node->layout = L_DOCKAREA;
-            else if (strcasecmp(buf, "output") == 0)
-                json_node->layout = L_OUTPUT;
-            else if (strcasecmp(buf, "splith") == 0)
-                json_node->layout = L_SPLITH;
-            else if (strcasecmp(buf, "splitv") == 0)
-                json_node->layout = L_SPLITV;
-            else
-                LOG("Unhandled \"layout\": %s\n", buf);
-            free(buf);
-        } else if (strcasecmp(last_key, "workspace_layout") == 0) {
-            char *buf = NULL;
-            sasprintf(&buf, "%.*s", (int)len, val);
-            if (strcasecmp(buf, "default") == 0)
-                json_node->workspace_layout = L_DEFAULT;
-            else if (strcasecmp(buf, "stacked") == 0)
-                json_node->workspace_layout = L_STACKED;
-            else if (strcasecmp(buf, "tabbed") == 0)
-                json_node->workspace_layout = L_TABBED;
-            else
-                LOG("Unhandled \"workspace_layout\": %s\n", buf);
-            free(buf);
-        } else if (strcasecmp(last_key, "last_split_layout") == 0) {
-            char *buf = NULL;
-            sasprintf(&buf, "%.*s", (int)len, val);
-            if (strcasecmp(buf, "splith") == 0)
-                json_node->last_split_layout = L_SPLITH;
-            else if (strcasecmp(buf, "splitv") == 0)
-                json_node->last_split_layout = L_SPLITV;
-            else
-                LOG("Unhandled \"last_splitlayout\": %s\n", buf);
-            free(buf);
-        } else if (strcasecmp(last_key, "mark") == 0) {
-            DLOG("Found deprecated key \"mark\".\n");
-
-            char *buf = NULL;
-            sasprintf(&buf, "%.*s", (int)len, val);
-
-            con_mark(json_node, buf, MM_REPLACE);
-        } else if (strcasecmp(last_key, "floating") == 0) {
-            char *buf = NULL;
-            sasprintf(&buf, "%.*s", (int)len, val);
-            if (strcasecmp(buf, "auto_off") == 0)
-                json_node->floating = FLOATING_AUTO_OFF;
-            else if (strcasecmp(buf, "auto_on") == 0)
-                json_node->floating = FLOATING_AUTO_ON;
-            else if (strcasecmp(buf, "user_off") == 0)
-                json_node->floating = FLOATING_USER_OFF;
-            else if (strcasecmp(buf, "user_on") == 0)
-                json_node->floating = FLOATING_USER_ON;
-            free(buf);
-        } else if (strcasecmp(last_key, "scratchpad_state") == 0) {
-            char *buf = NULL;
-            sasprintf(&buf, "%.*s", (int)len, val);
-            if (strcasecmp(buf, "none") == 0)
-                json_node->scratchpad_state = SCRATCHPAD_NONE;
-            else if (strcasecmp(buf, "fresh") == 0)
-                json_node->scratchpad_state = SCRATCHPAD_FRESH;
-            else if (strcasecmp(buf, "changed") == 0)
-                json_node->scratchpad_state = SCRATCHPAD_CHANGED;
-            free(buf);
-        } else if (strcasecmp(last_key, "previous_workspace_name") == 0) {
-            FREE(previous_workspace_name);
-            previous_workspace_name = sstrndup((const char *)val, len);
+        switch (last_key_id) {
+            case LAYOUT_KEY_NAME:
+                json_node->name = scalloc(len + 1, 1);
+                memcpy(json_node->name, val, len);
+                break;
+            case LAYOUT_KEY_TITLE_FORMAT:
+                json_node->cold->title_format = scalloc(len + 1, 1);
+                memcpy(json_node->cold->title_format, val, len);
+                break;
+            case LAYOUT_KEY_STICKY_GROUP: {
+                char *sticky_group = NULL;
+                sasprintf(&sticky_group, "%.*s", (int)len, val);
+                con_set_sticky_group(json_node, sticky_group);
+                free(sticky_group);
+                LOG("sticky_group of this container is %s\n", json_node->cold->sticky_group);
+                break;
+            }
+            case LAYOUT_KEY_ORIENTATION: {
+                /* Upgrade path from older versions of i3 (doing an inplace restart
+                 * to a newer version):
+                 * "orientation" is dumped before "layout". Therefore, we store
+                 * whether the orientation was horizontal or vertical in the
+                 * last_split_layout. When we then encounter layout == "default",
+                 * we will use the last_split_layout as layout instead. */
+                char *buf = NULL;
+                sasprintf(&buf, "%.*s", (int)len, val);
+                if (strcasecmp(buf, "none") == 0 ||
+                    strcasecmp(buf, "horizontal") == 0)
+                    json_node->last_split_layout = L_SPLITH;
+                else if (strcasecmp(buf, "vertical") == 0)
+                    json_node->last_split_layout = L_SPLITV;
+                else
+                    LOG("Unhandled orientation: %s\n", buf);
+                free(buf);
+                break;
+            }
+            case LAYOUT_KEY_BORDER: {
+                char *buf = NULL;
+                sasprintf(&buf, "%.*s", (int)len, val);
+                if (strcasecmp(buf, "none") == 0)
+                    json_node->border_style = BS_NONE;
+                else if (strcasecmp(buf, "1pixel") == 0) {
+                    json_node->border_style = BS_PIXEL;
+                    json_node->current_border_width = 1;
+                } else if (strcasecmp(buf, "pixel") == 0)
+                    json_node->border_style = BS_PIXEL;
+                else if (strcasecmp(buf, "normal") == 0)
+                    json_node->border_style = BS_NORMAL;
+                else
+                    LOG("Unhandled \"border\": %s\n", buf);
+                free(buf);
+                break;
+            }
+            case LAYOUT_KEY_TYPE: {
+                char *buf = NULL;
+                sasprintf(&buf, "%.*s", (int)len, val);
+                if (strcasecmp(buf, "root") == 0)
+                    json_node->type = CT_ROOT;
+                else if (strcasecmp(buf, "output") == 0)
+                    json_node->type = CT_OUTPUT;
+                else if (strcasecmp(buf, "con") == 0)
+                    json_node->type = CT_CON;
+                else if (strcasecmp(buf, "floating_con") == 0)
+                    json_node->type = CT_FLOATING_CON;
+                else if (strcasecmp(buf, "workspace") == 0)
+                    json_node->type = CT_WORKSPACE;
+                else if (strcasecmp(buf, "dockarea") == 0)
+                    json_node->type = CT_DOCKAREA;
+                else
+                    LOG("Unhandled \"type\": %s\n", buf);
+                free(buf);
+                break;
+            }
+            case LAYOUT_KEY_LAYOUT: {
+                char *buf = NULL;
+                sasprintf(&buf, "%.*s", (int)len, val);
+                if (strcasecmp(buf, "default") == 0)
+                    /* This set above when we read "orientation". */
+                    json_node->layout = json_node->last_split_layout;
+                else if (strcasecmp(buf, "stacked") == 0)
+                    json_node->layout = L_STACKED;
+                else if (strcasecmp(buf, "tabbed") == 0)
+                    json_node->layout = L_TABBED;
+                else if (strcasecmp(buf, "dockarea") == 0)
+                    json_node->layout = L_DOCKAREA;
+                else if (strcasecmp(buf, "output") == 0)
+                    json_node->layout = L_OUTPUT;
+                else if (strcasecmp(buf, "splith") == 0)
+                    json_node->layout = L_SPLITH;
+                else if (strcasecmp(buf, "splitv") == 0)
+                    json_node->layout = L_SPLITV;
+                else
+                    LOG("Unhandled \"layout\": %s\n", buf);
+                free(buf);
+                break;
+            }
+            case LAYOUT_KEY_WORKSPACE_LAYOUT: {
+                char *buf = NULL;
+                sasprintf(&buf, "%.*s", (int)len, val);
+                if (strcasecmp(buf, "default") == 0)
+                    json_node->workspace_layout = L_DEFAULT;
+                else if (strcasecmp(buf, "stacked") == 0)
+                    json_node->workspace_layout = L_STACKED;
+                else if (strcasecmp(buf, "tabbed") == 0)
+                    json_node->workspace_layout = L_TABBED;
+                else
+                    LOG("Unhandled \"workspace_layout\": %s\n", buf);
+                free(buf);
+                break;
+            }
+            case LAYOUT_KEY_LAST_SPLIT_LAYOUT: {
+                char *buf = NULL;
+                sasprintf(&buf, "%.*s", (int)len, val);
+                if (strcasecmp(buf, "splith") == 0)
+                    json_node->last_split_layout = L_SPLITH;
+                else if (strcasecmp(buf, "splitv") == 0)
+                    json_node->last_split_layout = L_SPLITV;
+                else
+                    LOG("Unhandled \"last_splitlayout\": %s\n", buf);
+                free(buf);
+                break;
+            }
+            case LAYOUT_KEY_MARK: {
+                DLOG("Found deprecated key \"mark\".\n");
+
+                char *buf = NULL;
+                sasprintf(&buf, "%.*s", (int)len, val);
+
+                con_mark(json_node, buf, MM_REPLACE);
+                break;
+            }
+            case LAYOUT_KEY_FLOATING: {
+                char *buf = NULL;
+                sasprintf(&buf, "%.*s", (int)len, val);
+                if (strcasecmp(buf, "auto_off") == 0)
+                    json_node->floating = FLOATING_AUTO_OFF;
+                else if (strcasecmp(buf, "auto_on") == 0)
+                    json_node->floating = FLOATING_AUTO_ON;
+                else if (strcasecmp(buf, "user_off") == 0)
+                    json_node->floating = FLOATING_USER_OFF;
+                else if (strcasecmp(buf, "user_on") == 0)
+                    json_node->floating = FLOATING_USER_ON;
+                free(buf);
+                break;
+            }
+            case LAYOUT_KEY_SCRATCHPAD_STATE: {
+                char *buf = NULL;
+                sasprintf(&buf, "%.*s", (int)len, val);
+                if (strcasecmp(buf, "none") == 0)
+                    con_set_scratchpad_state(json_node, SCRATCHPAD_NONE);
+                else if (strcasecmp(buf, "fresh") == 0)
+                    con_set_scratchpad_state(json_node, SCRATCHPAD_FRESH);
+                else if (strcasecmp(buf, "changed") == 0)
+                    con_set_scratchpad_state(json_node, SCRATCHPAD_CHANGED);
+                free(buf);
+                break;
+            }
+            case LAYOUT_KEY_PREVIOUS_WORKSPACE_NAME:
+                FREE(previous_workspace_name);
+                previous_workspace_name = sstrndup((const char *)val, len);
+                break;
+            default:
+                break;
         }
     }
     return 1;
@@ -442,29 +584,34 @@ static int json_string(void *ctx, const unsigned char *val, size_t len) {
 
 static int json_int(void *ctx, long long val) {
     LOG("int %lld for key %s\n", val, last_key);
-    /* For backwards compatibility with i3 < 4.8 */
-    if (strcasecmp(last_key, "type") == 0)
-        json_node->type = val;
-
-    if (strcasecmp(last_key, "fullscreen_mode") == 0)
-        json_node->fullscreen_mode = val;
-
-    if (strcasecmp(last_key, "num") == 0)
-        json_node->num = val;
-
-    if (strcasecmp(last_key, "current_border_width") == 0)
-        json_node->current_border_width = val;
-
-    if (strcasecmp(last_key, "window_icon_padding") == 0) {
-        json_node->window_icon_padding = val;
+    switch (last_key_id) {
+        /* For backwards compatibility with i3 < 4.8 */
+        case LAYOUT_KEY_TYPE:
+            json_node->type = val;
+            break;
+        case LAYOUT_KEY_FULLSCREEN_MODE:
+            json_node->fullscreen_mode = val;
+            break;
+        case LAYOUT_KEY_NUM:
+            json_node->num = val;
+            break;
+        case LAYOUT_KEY_CURRENT_BORDER_WIDTH:
+            json_node->current_border_width = val;
+            break;
+        case LAYOUT_KEY_WINDOW_ICON_PADDING:
+            json_node->window_icon_padding = val;
+            break;
+        case LAYOUT_KEY_DEPTH:
+            json_node->depth = val;
+            break;
+        case LAYOUT_KEY_ID:
+            if (!parsing_swallows)
+                json_node->old_id = val;
+            break;
+        default:
+            break;
     }
 
-    if (strcasecmp(last_key, "depth") == 0)
-        json_node->depth = val;
-
-    if (!parsing_swallows && strcasecmp(last_key, "id") == 0)
-        json_node->old_id = val;
-
     if (parsing_focus) {
         struct focus_mapping *focus_mapping = scalloc(1, sizeof(struct focus_mapping));
         focus_mapping->old_id = val;
@@ -479,31 +626,42 @@ static int json_int(void *ctx, long long val) {
             r = &(json_node->window_rect);
         else
             r = &(json_node->geometry);
-        if (strcasecmp(last_key, "x") == 0)
-            r->x = val;
-        else if (strcasecmp(last_key, "y") == 0)
-            r->y = val;
-        else if (strcasecmp(last_key, "width") == 0)
-            r->width = val;
-        else if (strcasecmp(last_key, "height") == 0)
-            r->height = val;
-        else
-            ELOG("WARNING: unknown key %s in rect\n", last_key);
+        switch (last_key_id) {
+            case LAYOUT_KEY_X:
+                r->x = val;
+                break;
+            case LAYOUT_KEY_Y:
+                r->y = val;
+                break;
+            case LAYOUT_KEY_WIDTH:
+                r->width = val;
+                break;
+            case LAYOUT_KEY_HEIGHT:
+                r->height = val;
+                break;
+            default:
+                ELOG("WARNING: unknown key %s in rect\n", last_key);
+                break;
+        }
         DLOG("rect now: (%d, %d, %d, %d)\n",
              r->x, r->y, r->width, r->height);
     }
     if (parsing_swallows) {
-        if (strcasecmp(last_key, "id") == 0) {
-            current_swallow->id = val;
-            swallow_is_empty = false;
-        }
-        if (strcasecmp(last_key, "dock") == 0) {
-            current_swallow->dock = val;
-            swallow_is_empty = false;
-        }
-        if (strcasecmp(last_key, "insert_where") == 0) {
-            current_swallow->insert_where = val;
-            swallow_is_empty = false;
+        switch (last_key_id) {
+            case LAYOUT_KEY_ID:
+                match_set(current_swallow, CRIT_ID)->id = val;
+                swallow_is_empty = false;
+                break;
+            case LAYOUT_KEY_DOCK:
+                current_swallow->dock = val;
+                swallow_is_empty = false;
+                break;
+            case LAYOUT_KEY_INSERT_WHERE:
+                current_swallow->insert_where = val;
+                swallow_is_empty = false;
+                break;
+            default:
+                break;
         }
     }
 
@@ -512,15 +670,15 @@ static int json_int(void *ctx, long long val) {
 
 static int json_bool(void *ctx, int val) {
     LOG("bool %d for key %s\n", val, last_key);
-    if (strcasecmp(last_key, "focused") == 0 && val) {
+    if (last_key_id == LAYOUT_KEY_FOCUSED && val) {
         to_focus = json_node;
     }
 
-    if (strcasecmp(last_key, "sticky") == 0)
-        json_node->sticky = val;
+    if (last_key_id == LAYOUT_KEY_STICKY)
+        con_set_sticky(json_node, val);
 
     if (parsing_swallows) {
-        if (strcasecmp(last_key, "restart_mode") == 0) {
+        if (last_key_id == LAYOUT_KEY_RESTART_MODE) {
             current_swallow->restart_mode = val;
             swallow_is_empty = false;
         }
@@ -531,7 +689,7 @@ static int json_bool(void *ctx, int val) {
 
 static int json_double(void *ctx, double val) {
     LOG("double %f for key %s\n", val, last_key);
-    if (strcasecmp(last_key, "percent") == 0) {
+    if (last_key_id == LAYOUT_KEY_PERCENT) {
         json_node->percent = val;
     }
     return 1;
@@ -550,52 +708,34 @@ static int json_determine_content_shallower(void *ctx) {
     return 1;
 }
 
+static bool content_found;
+
 static int json_determine_content_string(void *ctx, const unsigned char *val, size_t len) {
-    if (strcasecmp(last_key, "type") != 0 || content_level > 1)
+    if (content_found || last_key_id != LAYOUT_KEY_TYPE || content_level > 1)
         return 1;
 
     DLOG("string = %.*s, last_key = %s\n", (int)len, val, last_key);
     if (strncasecmp((const char *)val, "workspace", len) == 0)
         content_result = JSON_CONTENT_WORKSPACE;
-    return 0;
+    /* Keep going to validate the rest of the file. */
+    content_found = true;
+    return 1;
 }
 
 /*
- * Returns true if the provided JSON could be parsed by yajl.
+ * Validates the given JSON and determines from its first “type” property
+ * whether it contains workspaces or regular containers, which is important to
+ * know when deciding where (and how) to append the contents. Both are done in
+ * a single pass which does not build anything. Returns JSON_CONTENT_UNKNOWN
+ * if the JSON could not be parsed.
  *
  */
-bool json_validate(const char *buf, const size_t len) {
-    bool valid = true;
-    yajl_handle hand = yajl_alloc(NULL, NULL, NULL);
-    /* Allowing comments allows for more user-friendly layout files. */
-    yajl_config(hand, yajl_allow_comments, true);
-    /* Allow multiple values, i.e. multiple nodes to attach */
-    yajl_config(hand, yajl_allow_multiple_values, true);
-
-    setlocale(LC_NUMERIC, "C");
-    if (yajl_parse(hand, (const unsigned char *)buf, len) != yajl_status_ok) {
-        unsigned char *str = yajl_get_error(hand, 1, (const unsigned char *)buf, len);
-        ELOG("JSON parsing error: %s\n", str);
-        yajl_free_error(hand, str);
-        valid = false;
-    }
-    setlocale(LC_NUMERIC, "");
-
-    yajl_complete_parse(hand);
-    yajl_free(hand);
-
-    return valid;
-}
-
-/* Parses the given JSON file until it encounters the first “type” property to
- * determine whether the file contains workspaces or regular containers, which
- * is important to know when deciding where (and how) to append the contents.
- * */
-json_content_t json_determine_content(const char *buf, const size_t len) {
+json_content_t json_validate_content(const char *buf, const size_t len) {
     // We default to JSON_CONTENT_CON because it is legal to not include
     // “"type": "con"” in the JSON files for better readability.
     content_result = JSON_CONTENT_CON;
     content_level = 0;
+    content_found = false;
     static yajl_callbacks callbacks = {
         .yajl_string = json_determine_content_string,
         .yajl_map_key = json_key,
@@ -610,11 +750,11 @@ json_content_t json_determine_content(const char *buf, const size_t len) {
     /* Allow multiple values, i.e. multiple nodes to attach */
     yajl_config(hand, yajl_allow_multiple_values, true);
     setlocale(LC_NUMERIC, "C");
-    const yajl_status stat = yajl_parse(hand, (const unsigned char *)buf, len);
-    if (stat != yajl_status_ok && stat != yajl_status_client_canceled) {
+    if (yajl_parse(hand, (const unsigned char *)buf, len) != yajl_status_ok) {
         unsigned char *str = yajl_get_error(hand, 1, (const unsigned char *)buf, len);
         ELOG("JSON parsing error: %s\n", str);
         yajl_free_error(hand, str);
+        content_result = JSON_CONTENT_UNKNOWN;
     }
 
     setlocale(LC_NUMERIC, "");
@@ -624,25 +764,64 @@ json_content_t json_determine_content(const char *buf, const size_t len) {
     return content_result;
 }
 
+static yajl_callbacks tree_append_callbacks = {
+    .yajl_boolean = json_bool,
+    .yajl_integer = json_int,
+    .yajl_double = json_double,
+    .yajl_string = json_string,
+    .yajl_start_map = json_start_map,
+    .yajl_map_key = json_key,
+    .yajl_end_map = json_end_map,
+    .yajl_end_array = json_end_array,
+};
+
+/* Resets the parser state before appending to the given container. */
+static void tree_append_begin(Con *con) {
+    json_node = con;
+    to_focus = NULL;
+    incomplete = 0;
+    parsing_swallows = false;
+    parsing_rect = false;
+    parsing_deco_rect = false;
+    parsing_window_rect = false;
+    parsing_geometry = false;
+    parsing_focus = false;
+    parsing_marks = false;
+}
+
+/* Frees the containers which were not parsed completely. */
+static void tree_append_abort(void) {
+    while (incomplete-- > 0) {
+        Con *parent = json_node->parent;
+        DLOG("freeing incomplete container %p\n", json_node);
+        if (json_node == to_focus) {
+            to_focus = NULL;
+        }
+        con_free(json_node);
+        json_node = parent;
+    }
+}
+
+static void tree_append_end(Con *con) {
+    /* In case not all containers were restored, we need to fix the
+     * percentages, otherwise i3 will crash immediately when rendering the
+     * next time. */
+    con_fix_percent(con);
+
+    if (to_focus) {
+        con_activate(to_focus);
+    }
+}
+
 void tree_append_json(Con *con, const char *buf, const size_t len, char **errormsg) {
-    static yajl_callbacks callbacks = {
-        .yajl_boolean = json_bool,
-        .yajl_integer = json_int,
-        .yajl_double = json_double,
-        .yajl_string = json_string,
-        .yajl_start_map = json_start_map,
-        .yajl_map_key = json_key,
-        .yajl_end_map = json_end_map,
-        .yajl_end_array = json_end_array,
-    };
-    yajl_handle hand = yajl_alloc(&callbacks, NULL, NULL);
+    yajl_handle hand = yajl_alloc(&tree_append_callbacks, NULL, NULL);
     /* Allowing comments allows for more user-friendly layout files. */
     yajl_config(hand, yajl_allow_comments, true);
     /* Allow multiple values, i.e. multiple nodes to attach */
     yajl_config(hand, yajl_allow_multiple_values, true);
     /* We don't need to validate that the input is valid UTF8 here.
      * tree_append_json is called in two cases:
-     * 1. With the append_layout command. json_validate is called first and will
+     * 1. With the append_layout command. json_validate_content is called first and will
      *    fail on invalid UTF8 characters so we don't need to recheck.
      * 2. With an in-place restart. The rest of the codebase should be
      *    responsible for producing valid UTF8 JSON output. If not,
@@ -651,16 +830,7 @@ void tree_append_json(Con *con, const char *buf, const size_t len, char **errorm
      *    problems like in #3156.
      * Either way, disabling UTF8 validation slightly speeds up yajl. */
     yajl_config(hand, yajl_dont_validate_strings, true);
-    json_node = con;
-    to_focus = NULL;
-    incomplete = 0;
-    parsing_swallows = false;
-    parsing_rect = false;
-    parsing_deco_rect = false;
-    parsing_window_rect = false;
-    parsing_geometry = false;
-    parsing_focus = false;
-    parsing_marks = false;
+    tree_append_begin(con);
     setlocale(LC_NUMERIC, "C");
     const yajl_status stat = yajl_parse(hand, (const unsigned char *)buf, len);
     if (stat != yajl_status_ok) {
@@ -669,27 +839,31 @@ void tree_append_json(Con *con, const char *buf, const size_t len, char **errorm
         if (errormsg != NULL)
             *errormsg = sstrdup((const char *)str);
         yajl_free_error(hand, str);
-        while (incomplete-- > 0) {
-            Con *parent = json_node->parent;
-            DLOG("freeing incomplete container %p\n", json_node);
-            if (json_node == to_focus) {
-                to_focus = NULL;
-            }
-            con_free(json_node);
-            json_node = parent;
-        }
+        tree_append_abort();
     }
 
-    /* In case not all containers were restored, we need to fix the
-     * percentages, otherwise i3 will crash immediately when rendering the
-     * next time. */
-    con_fix_percent(con);
-
     setlocale(LC_NUMERIC, "");
     yajl_complete_parse(hand);
     yajl_free(hand);
 
-    if (to_focus) {
-        con_activate(to_focus);
+    tree_append_end(con);
+}
+
+/*
+ * Like tree_append_json(), but for the CBOR encoding of a layout (see
+ * ipc_json_to_cbor()), as used by the restart snapshot. Returns false if the
+ * data could not be decoded; containers which were restored completely up to
+ * that point are kept.
+ *
+ */
+bool tree_append_cbor(Con *con, const uint8_t *buf, const size_t len) {
+    tree_append_begin(con);
+    const yajl_status stat = ipc_cbor_parse(&tree_append_callbacks, NULL, buf, len);
+    if (stat != yajl_status_ok) {
+        ELOG("Could not decode the CBOR layout (status %d)\n", stat);
+        tree_append_abort();
     }
+
+    tree_append_end(con);
+    return (stat == yajl_status_ok);
 }
@@ -12,6 +12,8 @@
 #include "all.h"
 #include "shmlog.h"
 
+#include <inttypes.h>
+
 #include <ev.h>
 #include <libgen.h>
 #include <sys/socket.h>
@@ -37,6 +39,17 @@ static bool verbose = false;
 static FILE *errorfile;
 char *errorfilename;
 
+bool log_debug_active = false;
+bool log_verbose_active = false;
+bool log_filter_active = false;
+
+/* The source files debug logging is restricted to (see
+ * set_debug_log_filter()) and whether a given __FILE__ passes the filter, by
+ * pointer. */
+static char **log_filter_files;
+static int log_filter_num_files;
+static hashmap_t *log_filter_cache;
+
 /* SHM logging variables */
 
 /* The name for the SHM (/i3-log-%pid). Will end up on /dev/shm on most
@@ -47,13 +60,8 @@ char *shmlogname = "";
 int shmlog_size = 0;
 /* If enabled, logbuffer will point to a memory mapping of the i3 SHM log. */
 static char *logbuffer;
-/* A pointer (within logbuffer) where data will be written to next. */
-static char *logwalk;
 /* A pointer to the shmlog header */
 static i3_shmlog_header *header;
-/* A pointer to the byte where we last wrapped. Necessary to not print the
- * left-overs at the end of the ringbuffer. */
-static char *loglastwrap;
 /* Size (in bytes) of the i3 SHM log. */
 static int logbuffer_size;
 /* File descriptor for shm_open. */
@@ -61,9 +69,77 @@ static int logbuffer_shm;
 /* Size (in bytes) of physical memory */
 static long long physical_mem_bytes;
 
+/* In lossy mode, lines are dropped while more than this many bytes are
+ * waiting to be written to a log client. */
+#define LOG_CLIENT_LOSSY_LIMIT (1024 * 1024)
+
+/* A ring of the SHM log (see i3_shmlog_ring). Debug messages go to the ring
+ * of their source file, error messages to the important ring and all other
+ * messages to the main ring. The rings share the space of the SHM log by
+ * their weights, which can be changed with set_shmlog_rings(). */
+struct log_ring {
+    const char *name;
+    int weight;
+
+    /* The source files (without the ".c" suffix) whose debug messages go to
+     * this ring. */
+    const char *files[12];
+
+    /* The following pointers are within logbuffer and only valid while it is
+     * open. */
+    i3_shmlog_ring *header;
+    char *start;
+    char *end;
+    /* Where data will be written to next. */
+    char *walk;
+    /* The byte where we last wrapped. Necessary to not print the left-overs
+     * at the end of the ringbuffer. */
+    char *lastwrap;
+    /* The oldest record written before the last wrap which was not
+     * overwritten yet. */
+    char *oldest;
+};
+
+enum {
+    RING_MAIN = 0,
+    RING_IMPORTANT,
+    RING_X,
+    RING_IPC,
+    NUM_RINGS
+};
+
+static struct log_ring log_rings[NUM_RINGS] = {
+    [RING_MAIN] = {"main", 30, {NULL}},
+    [RING_IMPORTANT] = {"important", 15, {"config", "config_directives", "config_parser", "main", "randr", "xinerama", "fake_outputs", "load_layout", "restore_layout", "sighandler", NULL}},
+    [RING_X] = {"x", 35, {"x", "handlers", "render", "click", "drag", "key_press", "raw_pointer", "xcursor", NULL}},
+    [RING_IPC] = {"ipc", 20, {"ipc", "tree_events", NULL}},
+};
+
+/* Sequence number of the next record, counting the records of all rings. */
+static uint64_t log_seq;
+
 typedef struct log_client {
     int fd;
 
+    /* Set when the client sent "lossy": lines are dropped instead of killing
+     * the client when it does not keep up. */
+    bool lossy;
+
+    /* Number of lines dropped since the client was last told about it. */
+    uint64_t dropped_lines;
+
+    /* Data which still has to be written to the client, starting at
+     * buffer_offset. */
+    char *buffer;
+    size_t buffer_offset;
+    size_t buffer_len;
+    size_t buffer_size;
+
+    struct ev_io read_callback;
+    struct ev_io write_callback;
+    /* Running while data is queued, see log_client_push(). */
+    struct ev_timer timeout;
+
     TAILQ_ENTRY(log_client)
     clients;
 } log_client;
@@ -71,18 +147,317 @@ typedef struct log_client {
 TAILQ_HEAD(log_client_head, log_client)
 log_clients = TAILQ_HEAD_INITIALIZER(log_clients);
 
+/* A call site of the log functions, identified by its format string. */
+struct log_site {
+    /* Copy of the format string, in case the pointer is reused for a
+     * different one. */
+    char *fmt;
+
+    /* Byte offset of the format string in the call site table of the SHM
+     * log, or 0 if the messages of this site are always formatted right away
+     * (because the table is full or the format string is not supported). */
+    uint32_t offset;
+
+    /* The ring the messages of this site are stored in. */
+    struct log_ring *ring;
+
+    int num_conversions;
+    printf_conversion_t *conversions;
+};
+
+/* All log sites seen since the logbuffer was opened, by format string
+ * pointer. */
+static hashmap_t *log_sites;
+
+/* The arguments of a message in binary form, see encode_arguments(). */
+static char log_payload[4096];
+
 void log_broadcast_to_clients(const char *message, size_t len);
 
+/*
+ * Updates log_debug_active and log_verbose_active, which the *LOG() macros
+ * check before evaluating their arguments.
+ *
+ */
+static void update_log_active(void) {
+    log_debug_active = (logbuffer != NULL || debug_logging);
+    log_verbose_active = (logbuffer != NULL || verbose);
+}
+
 /*
  * Writes the offsets for the next write and for the last wrap to the
- * shmlog_header.
+ * header of the ring.
  * Necessary to print the i3 SHM log in the correct order.
  *
+ * The offsets are written after the data they refer to, so that readers can
+ * access the log without locking.
+ *
  */
-static void store_log_markers(void) {
-    header->offset_next_write = (logwalk - logbuffer);
-    header->offset_last_wrap = (loglastwrap - logbuffer);
-    header->size = logbuffer_size;
+static void store_log_markers(struct log_ring *ring) {
+    __atomic_store_n(&(ring->header->offset_oldest), ring->oldest - logbuffer, __ATOMIC_RELEASE);
+    __atomic_store_n(&(ring->header->offset_last_wrap), ring->lastwrap - logbuffer, __ATOMIC_RELEASE);
+    __atomic_store_n(&(ring->header->offset_next_write), ring->walk - logbuffer, __ATOMIC_RELEASE);
+}
+
+/*
+ * Appends a record with the given payload to the ring, wrapping and dropping
+ * the oldest records of the ring as necessary.
+ *
+ */
+static void shmlog_append(struct log_ring *ring, const uint32_t site, const char *payload, const uint32_t len) {
+    const i3_shmlog_record record = {
+        .length = len,
+        .site = site,
+        .seq = log_seq++,
+        .time = time(NULL),
+    };
+    const size_t size = sizeof(record) + len;
+    if (size > (size_t)(ring->end - ring->start)) {
+        return;
+    }
+
+    /* If there is no space for the current message in the ringbuffer, we
+     * need to wrap and write to the beginning again. The records written
+     * since the last wrap become the oldest ones. */
+    if (size > (size_t)(ring->end - ring->walk)) {
+        ring->lastwrap = ring->walk;
+        ring->walk = ring->start;
+        ring->oldest = ring->start;
+        store_log_markers(ring);
+        __atomic_add_fetch(&(ring->header->wrap_count), 1, __ATOMIC_RELEASE);
+    }
+
+    /* Drop the old records we are about to overwrite. */
+    if (ring->oldest < ring->lastwrap && ring->oldest < ring->walk + size) {
+        while (ring->oldest < ring->lastwrap && ring->oldest < ring->walk + size) {
+            i3_shmlog_record old;
+            memcpy(&old, ring->oldest, sizeof(old));
+            ring->oldest += sizeof(old) + old.length;
+        }
+        if (ring->oldest > ring->lastwrap) {
+            ring->oldest = ring->lastwrap;
+        }
+        store_log_markers(ring);
+    }
+
+    /* Copy the record, move the write pointer to the byte after it. */
+    memcpy(ring->walk, &record, sizeof(record));
+    memcpy(ring->walk + sizeof(record), payload, len);
+    ring->walk += size;
+
+    store_log_markers(ring);
+}
+
+/*
+ * Returns the ring for the messages of the given format string. The ring of
+ * debug messages depends on their source file, which is their first argument
+ * (see DLOG()).
+ *
+ */
+static struct log_ring *log_ring_for(const char *fmt, va_list args) {
+    if (strncmp(fmt, "ERROR: ", strlen("ERROR: ")) == 0) {
+        return &log_rings[RING_IMPORTANT];
+    }
+    if (strncmp(fmt, LOG_DEBUG_PREFIX, strlen(LOG_DEBUG_PREFIX)) != 0) {
+        return &log_rings[RING_MAIN];
+    }
+
+    va_list copy;
+    va_copy(copy, args);
+    const char *file = va_arg(copy, const char *);
+    va_end(copy);
+
+    const char *name = strrchr(file, '/');
+    name = (name != NULL ? name + 1 : file);
+    const char *suffix = strrchr(name, '.');
+    const size_t len = (suffix != NULL ? (size_t)(suffix - name) : strlen(name));
+    for (int i = 0; i < NUM_RINGS; i++) {
+        for (const char **walk = log_rings[i].files; *walk != NULL; walk++) {
+            if (strlen(*walk) == len && strncmp(name, *walk, len) == 0) {
+                return &log_rings[i];
+            }
+        }
+    }
+    return &log_rings[RING_MAIN];
+}
+
+/*
+ * Changes the weights of the rings of the SHM log, given as a comma-separated
+ * list of name=weight pairs (e.g. "x=20,important=30"). The rings not listed
+ * keep their weight, a weight of 0 disables the ring. Takes effect when the
+ * logbuffer is opened the next time. Returns false (changing nothing) if spec
+ * is invalid.
+ *
+ */
+bool set_shmlog_rings(const char *spec) {
+    int weights[NUM_RINGS];
+    for (int i = 0; i < NUM_RINGS; i++) {
+        weights[i] = log_rings[i].weight;
+    }
+
+    bool valid = true;
+    char *copy = sstrdup(spec);
+    for (char *tok = strtok(copy, ", "); tok != NULL && valid; tok = strtok(NULL, ", ")) {
+        char *eq = strchr(tok, '=');
+        if (eq == NULL) {
+            valid = false;
+            break;
+        }
+        *eq = '\0';
+        long weight;
+        int ring;
+        for (ring = 0; ring < NUM_RINGS; ring++) {
+            if (strcmp(tok, log_rings[ring].name) == 0) {
+                break;
+            }
+        }
+        valid = (ring < NUM_RINGS && parse_long(eq + 1, &weight, 10) && weight >= 0 && weight <= 1000);
+        if (valid) {
+            weights[ring] = (int)weight;
+        }
+    }
+    free(copy);
+
+    if (!valid) {
+        return false;
+    }
+    for (int i = 0; i < NUM_RINGS; i++) {
+        log_rings[i].weight = weights[i];
+    }
+    return true;
+}
+
+static void log_site_free(void *value, void *userdata) {
+    struct log_site *site = value;
+    free(site->fmt);
+    free(site->conversions);
+    free(site);
+}
+
+/*
+ * Returns the log site for the given format string (and the arguments of the
+ * current message), registering it in the call site table of the SHM log when
+ * it is first used.
+ *
+ */
+static struct log_site *log_site_get(const char *fmt, va_list args) {
+    if (log_sites == NULL) {
+        log_sites = hashmap_new();
+    }
+
+    struct log_site *site = hashmap_lookup(log_sites, (uintptr_t)fmt);
+    if (site != NULL) {
+        if (strcmp(site->fmt, fmt) == 0) {
+            return site;
+        }
+        log_site_free(site, NULL);
+    }
+
+    site = scalloc(1, sizeof(struct log_site));
+    site->fmt = sstrdup(fmt);
+    site->ring = log_ring_for(fmt, args);
+    hashmap_insert(log_sites, (uintptr_t)fmt, site);
+
+    bool supported = true;
+    printf_conversion_t conv;
+    for (const char *walk = site->fmt; printf_next_conversion(walk, &conv); walk = conv.end) {
+        if (conv.type == PRINTF_ARG_UNSUPPORTED) {
+            supported = false;
+            break;
+        }
+        site->conversions = srealloc(site->conversions, (site->num_conversions + 1) * sizeof(printf_conversion_t));
+        site->conversions[site->num_conversions++] = conv;
+    }
+
+    const size_t len = strlen(fmt) + 1;
+    if (supported && header->sites_used + len <= header->sites_size) {
+        site->offset = header->offset_sites + header->sites_used;
+        memcpy(logbuffer + site->offset, fmt, len);
+        __atomic_store_n(&(header->sites_used), header->sites_used + len, __ATOMIC_RELEASE);
+    }
+    return site;
+}
+
+/*
+ * Stores the arguments of a message of the given site in log_payload (see
+ * i3_shmlog_record for the format). Returns false if they do not fit.
+ *
+ */
+static bool encode_arguments(const struct log_site *site, va_list args, size_t *len) {
+    size_t pos = 0;
+#define APPEND(ptr, size)                          \
+    do {                                           \
+        if (pos + (size) > sizeof(log_payload)) {  \
+            return false;                          \
+        }                                          \
+        memcpy(log_payload + pos, (ptr), (size));  \
+        pos += (size);                             \
+    } while (0)
+#define APPEND_VALUE(type, value)   \
+    do {                            \
+        const type v = (value);     \
+        APPEND(&v, sizeof(v));      \
+    } while (0)
+
+    for (int i = 0; i < site->num_conversions; i++) {
+        const printf_conversion_t *conv = &(site->conversions[i]);
+        if (conv->width_star) {
+            APPEND_VALUE(int32_t, va_arg(args, int));
+        }
+        int precision = conv->precision;
+        if (conv->precision_star) {
+            precision = va_arg(args, int);
+            APPEND_VALUE(int32_t, precision);
+        }
+
+        switch (conv->type) {
+            case PRINTF_ARG_NONE:
+            case PRINTF_ARG_UNSUPPORTED:
+                break;
+            case PRINTF_ARG_INT:
+                APPEND_VALUE(int32_t, va_arg(args, int));
+                break;
+            case PRINTF_ARG_LONG:
+                APPEND_VALUE(int64_t, va_arg(args, long));
+                break;
+            case PRINTF_ARG_LONG_LONG:
+                APPEND_VALUE(int64_t, va_arg(args, long long));
+                break;
+            case PRINTF_ARG_INTMAX:
+                APPEND_VALUE(int64_t, va_arg(args, intmax_t));
+                break;
+            case PRINTF_ARG_SIZE:
+                APPEND_VALUE(int64_t, va_arg(args, size_t));
+                break;
+            case PRINTF_ARG_PTRDIFF:
+                APPEND_VALUE(int64_t, va_arg(args, ptrdiff_t));
+                break;
+            case PRINTF_ARG_DOUBLE:
+                APPEND_VALUE(double, va_arg(args, double));
+                break;
+            case PRINTF_ARG_POINTER:
+                APPEND_VALUE(uint64_t, (uintptr_t)va_arg(args, void *));
+                break;
+            case PRINTF_ARG_STRING: {
+                const char *str = va_arg(args, const char *);
+                if (str == NULL) {
+                    APPEND_VALUE(uint32_t, UINT32_MAX);
+                    break;
+                }
+                /* The string does not need to be terminated if a precision
+                 * is given. */
+                const size_t str_len = (precision >= 0 ? strnlen(str, precision) : strlen(str));
+                APPEND_VALUE(uint32_t, str_len);
+                APPEND(str, str_len);
+                break;
+            }
+        }
+    }
+#undef APPEND_VALUE
+#undef APPEND
+
+    *len = pos;
+    return true;
 }
 
 /*
@@ -173,10 +548,43 @@ void open_logbuffer(void) {
     memset(logbuffer, '\0', logbuffer_size);
 
     header = (i3_shmlog_header *)logbuffer;
+    header->size = logbuffer_size;
+    header->offset_sites = sizeof(i3_shmlog_header);
+    /* i3 uses a few thousand distinct format strings of about 50 bytes. */
+    header->sites_size = logbuffer_size / 16;
 
-    logwalk = logbuffer + sizeof(i3_shmlog_header);
-    loglastwrap = logbuffer + logbuffer_size;
-    store_log_markers();
+    /* The offsets of previously registered log sites refer to the previous
+     * logbuffer. */
+    if (log_sites != NULL) {
+        hashmap_foreach(log_sites, log_site_free, NULL);
+        hashmap_clear(log_sites);
+    }
+
+    /* The rings split the remaining space by their weights. */
+    char *walk = logbuffer + header->offset_sites + header->sites_size;
+    const uint64_t space = logbuffer + logbuffer_size - walk;
+    int total_weight = 0;
+    for (int i = 0; i < NUM_RINGS; i++) {
+        total_weight += log_rings[i].weight;
+    }
+    header->num_rings = NUM_RINGS;
+    for (int i = 0; i < NUM_RINGS; i++) {
+        struct log_ring *ring = &log_rings[i];
+        const size_t size = (total_weight > 0 ? space * ring->weight / total_weight : 0);
+
+        ring->header = &(header->rings[i]);
+        snprintf(ring->header->name, sizeof(ring->header->name), "%s", ring->name);
+        ring->header->offset_start = walk - logbuffer;
+        ring->header->size = size;
+        ring->start = walk;
+        ring->end = walk + size;
+        ring->walk = ring->start;
+        ring->lastwrap = ring->end;
+        ring->oldest = ring->lastwrap;
+        store_log_markers(ring);
+        walk += size;
+    }
+    update_log_active();
 }
 
 /*
@@ -189,6 +597,15 @@ void close_logbuffer(void) {
     free(shmlogname);
     logbuffer = NULL;
     shmlogname = "";
+    update_log_active();
+}
+
+/*
+ * Returns the size of the SHM log in bytes, 0 if it is disabled.
+ *
+ */
+size_t log_buffer_size(void) {
+    return (logbuffer != NULL ? (size_t)logbuffer_size : 0);
 }
 
 /*
@@ -199,6 +616,7 @@ void close_logbuffer(void) {
  */
 void set_verbosity(bool _verbose) {
     verbose = _verbose;
+    update_log_active();
 }
 
 /*
@@ -215,6 +633,63 @@ bool get_debug_logging(void) {
  */
 void set_debug_logging(const bool _debug_logging) {
     debug_logging = _debug_logging;
+    update_log_active();
+}
+
+/*
+ * Restricts debug logging to the given comma-separated list of source files
+ * (e.g. "x.c,handlers"; the ".c" suffix is optional), or logs all files
+ * again if files is NULL.
+ *
+ */
+void set_debug_log_filter(const char *files) {
+    for (int i = 0; i < log_filter_num_files; i++) {
+        free(log_filter_files[i]);
+    }
+    FREE(log_filter_files);
+    log_filter_num_files = 0;
+    if (log_filter_cache != NULL) {
+        hashmap_clear(log_filter_cache);
+    }
+
+    if (files != NULL) {
+        char *copy = sstrdup(files);
+        for (char *tok = strtok(copy, ", "); tok != NULL; tok = strtok(NULL, ", ")) {
+            log_filter_files = srealloc(log_filter_files, (log_filter_num_files + 1) * sizeof(char *));
+            log_filter_files[log_filter_num_files++] = sstrdup(tok);
+        }
+        free(copy);
+    }
+    log_filter_active = (log_filter_num_files > 0);
+}
+
+/*
+ * Returns whether debug messages of the given source file (__FILE__) pass the
+ * filter set by set_debug_log_filter().
+ *
+ */
+bool log_file_enabled(const char *file) {
+    /* The cache stores pointers to these to tell both results from a miss. */
+    static const char enabled, disabled;
+
+    if (log_filter_cache == NULL) {
+        log_filter_cache = hashmap_new();
+    }
+    const char *cached = hashmap_lookup(log_filter_cache, (uintptr_t)file);
+    if (cached != NULL) {
+        return (cached == &enabled);
+    }
+
+    const char *name = strrchr(file, '/');
+    name = (name != NULL ? name + 1 : file);
+    bool result = false;
+    for (int i = 0; i < log_filter_num_files && !result; i++) {
+        const size_t len = strlen(log_filter_files[i]);
+        result = (strncmp(name, log_filter_files[i], len) == 0 &&
+                  (name[len] == '\0' || strcmp(name + len, ".c") == 0));
+    }
+    hashmap_insert(log_filter_cache, (uintptr_t)file, (void *)(result ? &enabled : &disabled));
+    return result;
 }
 
 /*
@@ -223,8 +698,28 @@ void set_debug_logging(const bool _debug_logging) {
  * log if enabled.
  * This is to be called by *LOG() which includes filename/linenumber/function.
  *
+ * Messages which are only saved in the SHM log are stored in binary form:
+ * their arguments are copied and i3-dump-log formats them.
+ *
  */
 static void vlog(const bool print, const char *fmt, va_list args) {
+    struct log_ring *ring = NULL;
+    if (logbuffer) {
+        const struct log_site *site = log_site_get(fmt, args);
+        ring = site->ring;
+        if (!print && TAILQ_EMPTY(&log_clients) && site->offset != 0) {
+            size_t len;
+            va_list copy;
+            va_copy(copy, args);
+            const bool encoded = encode_arguments(site, copy, &len);
+            va_end(copy);
+            if (encoded) {
+                shmlog_append(ring, site->offset, log_payload, len);
+                return;
+            }
+        }
+    }
+
     /* Precisely one page to not consume too much memory but to hold enough
      * data to be useful. */
     static char message[4096];
@@ -272,21 +767,7 @@ static void vlog(const bool print, const char *fmt, va_list args) {
             message[len - 2] = '\n';
         }
 
-        /* If there is no space for the current message in the ringbuffer, we
-         * need to wrap and write to the beginning again. */
-        if (len >= (size_t)(logbuffer_size - (logwalk - logbuffer))) {
-            loglastwrap = logwalk;
-            logwalk = logbuffer + sizeof(i3_shmlog_header);
-            store_log_markers();
-            header->wrap_count++;
-        }
-
-        /* Copy the buffer, move the write pointer to the byte after our
-         * current message. */
-        strncpy(logwalk, message, len);
-        logwalk += len;
-
-        store_log_markers();
+        shmlog_append(ring, 0, message, len);
 
         if (print)
             fwrite(message, len, 1, stdout);
@@ -375,6 +856,117 @@ void purge_zerobyte_logfile(void) {
 
 char *current_log_stream_socket_path = NULL;
 
+/*
+ * Disconnects the log client and frees it.
+ *
+ */
+static void log_client_free(log_client *client) {
+    ev_io_stop(main_loop, &(client->read_callback));
+    ev_io_stop(main_loop, &(client->write_callback));
+    ev_timer_stop(main_loop, &(client->timeout));
+    close(client->fd);
+    TAILQ_REMOVE(&log_clients, client, clients);
+    free(client->buffer);
+    free(client);
+}
+
+/*
+ * Writes as much of the queued data as possible without blocking. Returns
+ * false if the client was freed because the connection failed.
+ *
+ * Must not log anything: it is called from vlog().
+ *
+ */
+static bool log_client_push(log_client *client) {
+    bool progress = false;
+    while (client->buffer_offset < client->buffer_len) {
+        const ssize_t n = write(client->fd, client->buffer + client->buffer_offset,
+                                client->buffer_len - client->buffer_offset);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            log_client_free(client);
+            return false;
+        }
+        client->buffer_offset += n;
+        progress = true;
+    }
+
+    if (client->buffer_offset == client->buffer_len) {
+        client->buffer_offset = client->buffer_len = 0;
+        ev_io_stop(main_loop, &(client->write_callback));
+        ev_timer_stop(main_loop, &(client->timeout));
+        return true;
+    }
+
+    ev_io_start(main_loop, &(client->write_callback));
+    /* Lossy clients are never killed. For the others, keep the old timeout
+     * when nothing was written, like for IPC clients (see
+     * ipc_push_pending()). */
+    if (!client->lossy && (progress || !ev_is_active(&(client->timeout)))) {
+        ev_timer_stop(main_loop, &(client->timeout));
+        ev_timer_set(&(client->timeout), ipc_get_kill_timeout(), 0.);
+        ev_timer_start(main_loop, &(client->timeout));
+    }
+    return true;
+}
+
+/*
+ * Appends the given data to the client's queue, compacting the queue first.
+ *
+ */
+static void log_client_queue(log_client *client, const char *data, size_t len) {
+    if (client->buffer_offset > 0) {
+        memmove(client->buffer, client->buffer + client->buffer_offset,
+                client->buffer_len - client->buffer_offset);
+        client->buffer_len -= client->buffer_offset;
+        client->buffer_offset = 0;
+    }
+    if (client->buffer_len + len > client->buffer_size) {
+        client->buffer_size = 2 * client->buffer_size;
+        if (client->buffer_size < client->buffer_len + len) {
+            client->buffer_size = client->buffer_len + len;
+        }
+        client->buffer = srealloc(client->buffer, client->buffer_size);
+    }
+    memcpy(client->buffer + client->buffer_len, data, len);
+    client->buffer_len += len;
+}
+
+static void log_client_writeable_cb(EV_P_ ev_io *w, int revents) {
+    log_client_push((log_client *)w->data);
+}
+
+static void log_client_read_cb(EV_P_ ev_io *w, int revents) {
+    log_client *client = (log_client *)w->data;
+    char buf[64];
+    const ssize_t n = read(client->fd, buf, sizeof(buf) - 1);
+    if (n == -1 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return;
+    }
+    if (n <= 0) {
+        DLOG("log: client on fd %d disconnected\n", client->fd);
+        log_client_free(client);
+        return;
+    }
+    buf[n] = '\0';
+    if (strstr(buf, "lossy") != NULL) {
+        DLOG("log: client on fd %d switched to lossy mode\n", client->fd);
+        client->lossy = true;
+        ev_timer_stop(main_loop, &(client->timeout));
+    }
+}
+
+static void log_client_timeout_cb(EV_P_ ev_timer *w, int revents) {
+    log_client *client = (log_client *)w->data;
+    const int fd = client->fd;
+    log_client_free(client);
+    ELOG("log client on fd %d did not read the log for too long, disconnected\n", fd);
+}
+
 /*
  * Handler for activity on the listening socket, meaning that a new client
  * has just connected and we should accept() them. Sets up the event handler
@@ -400,23 +992,48 @@ void log_new_client(EV_P_ struct ev_io *w, int revents) {
 
     log_client *client = scalloc(1, sizeof(log_client));
     client->fd = fd;
+    ev_io_init(&(client->read_callback), log_client_read_cb, fd, EV_READ);
+    client->read_callback.data = client;
+    ev_io_start(EV_A_ &(client->read_callback));
+    ev_io_init(&(client->write_callback), log_client_writeable_cb, fd, EV_WRITE);
+    client->write_callback.data = client;
+    ev_timer_init(&(client->timeout), log_client_timeout_cb, 0., 0.);
+    client->timeout.data = client;
     TAILQ_INSERT_TAIL(&log_clients, client, clients);
 
     DLOG("log: new client connected on fd %d\n", fd);
 }
 
+/*
+ * Sends the message to all log clients. Writes never block: data which cannot
+ * be written right away is queued. Clients in lossy mode drop the message
+ * instead if too much data is queued already and are told how many lines
+ * were dropped once they caught up.
+ *
+ * Must not log anything: it is called from vlog().
+ *
+ */
 void log_broadcast_to_clients(const char *message, size_t len) {
     log_client *current = TAILQ_FIRST(&log_clients);
     while (current != TAILQ_END(&log_clients)) {
-        /* XXX: In case slow connections turn out to be a problem here
-         * (unlikely as long as i3-dump-log is the only consumer), introduce
-         * buffering, similar to the IPC interface. */
-        ssize_t n = writeall(current->fd, message, len);
-        log_client *previous = current;
+        log_client *client = current;
         current = TAILQ_NEXT(current, clients);
-        if (n < 0) {
-            TAILQ_REMOVE(&log_clients, previous, clients);
-            free(previous);
+
+        const size_t queued = client->buffer_len - client->buffer_offset;
+        if (client->lossy && queued + len > LOG_CLIENT_LOSSY_LIMIT) {
+            client->dropped_lines++;
+            continue;
+        }
+        if (client->dropped_lines > 0) {
+            char note[64];
+            const int note_len = snprintf(note, sizeof(note), "i3: %" PRIu64 " log lines dropped\n",
+                                          client->dropped_lines);
+            log_client_queue(client, note, note_len);
+            client->dropped_lines = 0;
+        }
+        log_client_queue(client, message, len);
+        if (queued == 0) {
+            log_client_push(client);
         }
     }
 }
@@ -121,6 +121,60 @@ static void xcb_got_event(EV_P_ struct ev_io *w, int revents) {
     /* empty, because xcb_prepare_cb are used */
 }
 
+/* X11 events which were read but not handled yet. They are handled in order,
+ * but not while a window is being managed, so that events which arrive in the
+ * meantime are still handled after the window is managed. */
+struct queued_event {
+    xcb_generic_event_t *event;
+    TAILQ_ENTRY(queued_event) events;
+};
+static TAILQ_HEAD(queued_events_head, queued_event) queued_events =
+    TAILQ_HEAD_INITIALIZER(queued_events);
+
+/*
+ * Drops the MotionNotify and EnterNotify events which are superseded by a
+ * later event of the same type, so that focus follows the mouse only to the
+ * final pointer position when the pointer sweeps across many windows. Only
+ * runs of pointer events are compressed: any other event (e.g. a click) keeps
+ * the pointer events before it.
+ *
+ */
+static void compress_pointer_events(void) {
+    bool later_motion = false;
+    bool later_enter = false;
+
+    struct queued_event *queued = TAILQ_LAST(&queued_events, queued_events_head);
+    while (queued != NULL) {
+        struct queued_event *prev = TAILQ_PREV(queued, queued_events_head, events);
+        const int type = (queued->event->response_type & 0x7F);
+        bool drop = false;
+
+        if (type == XCB_MOTION_NOTIFY) {
+            drop = later_motion;
+            later_motion = true;
+        } else if (type == XCB_ENTER_NOTIFY) {
+            xcb_enter_notify_event_t *enter = (xcb_enter_notify_event_t *)queued->event;
+            drop = later_enter;
+            /* Only an EnterNotify which will actually be handled supersedes
+             * the earlier ones. */
+            if (enter->mode == XCB_NOTIFY_MODE_NORMAL &&
+                !event_is_ignored(enter->sequence, XCB_ENTER_NOTIFY)) {
+                later_enter = true;
+            }
+        } else if (type != XCB_LEAVE_NOTIFY) {
+            later_motion = false;
+            later_enter = false;
+        }
+
+        if (drop) {
+            TAILQ_REMOVE(&queued_events, queued, events);
+            free(queued->event);
+            free(queued);
+        }
+        queued = prev;
+    }
+}
+
 /*
  * Called just before the event loop sleeps. Ensures xcb’s incoming and outgoing
  * queues are empty so that any activity will trigger another event loop
@@ -128,33 +182,80 @@ static void xcb_got_event(EV_P_ struct ev_io *w, int revents) {
  *
  */
 static void xcb_prepare_cb(EV_P_ ev_prepare *w, int revents) {
-    /* Process all queued (and possibly new) events before the event loop
-       sleeps. */
-    xcb_generic_event_t *event;
+    bool progress;
+
+    do {
+        /* Read all queued (and possibly new) events before the event loop
+           sleeps. */
+        xcb_generic_event_t *event;
 
-    while ((event = xcb_poll_for_event(conn)) != NULL) {
-        if (event->response_type == 0) {
-            if (event_is_ignored(event->sequence, 0))
-                DLOG("Expected X11 Error received for sequence %x\n", event->sequence);
-            else {
-                xcb_generic_error_t *error = (xcb_generic_error_t *)event;
-                DLOG("X11 Error received (probably harmless)! sequence 0x%x, error_code = %d\n",
-                     error->sequence, error->error_code);
+        while ((event = xcb_poll_for_event(conn)) != NULL) {
+            if (event->response_type == 0) {
+                if (event_is_ignored(event->sequence, 0))
+                    DLOG("Expected X11 Error received for sequence %x\n", event->sequence);
+                else {
+                    xcb_generic_error_t *error = (xcb_generic_error_t *)event;
+                    DLOG("X11 Error received (probably harmless)! sequence 0x%x, error_code = %d\n",
+                         error->sequence, error->error_code);
+                }
+                free(event);
+                continue;
             }
-            free(event);
-            continue;
+
+            struct queued_event *queued = smalloc(sizeof(struct queued_event));
+            queued->event = event;
+            TAILQ_INSERT_TAIL(&queued_events, queued, events);
         }
 
-        /* Strip off the highest bit (set if the event is generated) */
-        int type = (event->response_type & 0x7F);
+        compress_pointer_events();
+
+        /* The PropertyNotify events of this iteration were only queued,
+         * handle them together. */
+        progress = handle_queued_property_notifies();
+        if (handle_queued_configure_requests()) {
+            progress = true;
+        }
 
-        handle_event(type, event);
+        /* Reading the events also reads the replies which windows that are
+         * being managed and X_SYNC messages wait for. Handling the events can read further
+         * replies, so repeat until nothing changes anymore. */
+        if (manage_window_continue()) {
+            progress = true;
+        }
+        if (sync_continue()) {
+            progress = true;
+        }
 
-        free(event);
-    }
+        struct queued_event *queued;
+        while (!manage_window_pending() && (queued = TAILQ_FIRST(&queued_events)) != NULL) {
+            TAILQ_REMOVE(&queued_events, queued, events);
+
+            /* Strip off the highest bit (set if the event is generated) */
+            int type = (queued->event->response_type & 0x7F);
+
+            handle_event(type, queued->event);
+
+            free(queued->event);
+            free(queued);
+            progress = true;
+        }
+
+        /* Focus the container the pointer moved to during the events
+         * above (focus_follows_mouse raw). */
+        if (raw_pointer_flush()) {
+            progress = true;
+        }
+
+        /* Render once for all events handled above. Rendering can read
+         * further events, so this needs to happen before the loop ends. */
+        if (tree_flush_scheduled_render()) {
+            progress = true;
+        }
+    } while (progress);
 
     /* Flush all queued events to X11. */
     xcb_flush(conn);
+    stats_input_flushed();
 }
 
 /*
@@ -180,12 +281,15 @@ void main_set_x11_cb(bool enable) {
  *
  */
 static void i3_exit(void) {
+    trace_close();
     if (*shmlogname != '\0') {
         fprintf(stderr, "Closing SHM log \"%s\"\n", shmlogname);
         fflush(stderr);
         shm_unlink(shmlogname);
     }
+    tree_shm_close();
     ipc_shutdown(SHUTDOWN_REASON_EXIT, -1);
+    ipc_remove_socket_link(current_socketpath);
     unlink(config.ipc_socket_path);
     if (current_log_stream_socket_path != NULL) {
         unlink(current_log_stream_socket_path);
@@ -218,6 +322,9 @@ static void handle_core_signal(int sig, siginfo_t *info, void *data) {
     if (*shmlogname != '\0') {
         shm_unlink(shmlogname);
     }
+    if (tree_shm_path() != NULL) {
+        shm_unlink(tree_shm_path());
+    }
     raise(sig);
 }
 
@@ -262,20 +369,54 @@ static void setup_term_handlers(void) {
     }
 }
 
-static int parse_restart_fd(void) {
-    const char *restart_fd = getenv("_I3_RESTART_FD");
+static int parse_restart_fd(const char *name) {
+    const char *restart_fd = getenv(name);
     if (restart_fd == NULL) {
         return -1;
     }
 
     long int fd = -1;
     if (!parse_long(restart_fd, &fd, 10)) {
-        ELOG("Malformed _I3_RESTART_FD \"%s\"\n", restart_fd);
+        ELOG("Malformed %s \"%s\"\n", name, restart_fd);
         return -1;
     }
     return fd;
 }
 
+/*
+ * Restores the tree from the restart snapshot which the previous process
+ * passed in _I3_RESTART_SNAPSHOT_FD, if any. Returns true on success.
+ *
+ */
+static bool restore_restart_snapshot(xcb_get_geometry_reply_t *geometry) {
+    const int fd = parse_restart_fd("_I3_RESTART_SNAPSHOT_FD");
+    unsetenv("_I3_RESTART_SNAPSHOT_FD");
+    if (fd == -1) {
+        return false;
+    }
+
+    bool result = false;
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        ELOG("Could not use the restart snapshot on fd %d\n", fd);
+        goto out;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        ELOG("Could not mmap the restart snapshot: %s\n", strerror(errno));
+        goto out;
+    }
+
+    LOG("Trying to restore the layout from the restart snapshot.\n");
+    result = tree_restore_snapshot(data, st.st_size, geometry);
+    munmap(data, st.st_size);
+
+out:
+    close(fd);
+    return result;
+}
+
 int main(int argc, char *argv[]) {
     /* Keep a symbol pointing to the I3_VERSION string constant so that we have
      * it in gdb backtraces. */
@@ -286,6 +427,7 @@ int main(int argc, char *argv[]) {
     bool delete_layout_path = false;
     bool disable_randr15 = false;
     char *fake_outputs = NULL;
+    char *trace_path = NULL;
     bool disable_signalhandler = false;
     bool only_check_config = false;
     bool replace_wm = false;
@@ -306,15 +448,19 @@ int main(int argc, char *argv[]) {
         {"disable-signalhandler", no_argument, 0, 0},
         {"shmlog-size", required_argument, 0, 0},
         {"shmlog_size", required_argument, 0, 0},
+        {"shmlog-rings", required_argument, 0, 0},
         {"get-socketpath", no_argument, 0, 0},
         {"get_socketpath", no_argument, 0, 0},
         {"fake_outputs", required_argument, 0, 0},
         {"fake-outputs", required_argument, 0, 0},
         {"force-old-config-parser-v4.4-only", no_argument, 0, 0},
         {"replace", no_argument, 0, 'r'},
+        {"record-trace", required_argument, 0, 0},
         {0, 0, 0, 0}};
     int option_index = 0, opt;
 
+    stats_startup_begin();
+
     setlocale(LC_ALL, "");
 
     /* Get the RLIMIT_CORE limit at startup time to restore this before
@@ -416,6 +562,16 @@ int main(int argc, char *argv[]) {
                     init_logging();
                     LOG("Limiting SHM log size to %d bytes\n", shmlog_size);
                     break;
+                } else if (strcmp(long_options[option_index].name, "shmlog-rings") == 0) {
+                    if (!set_shmlog_rings(optarg)) {
+                        errx(EXIT_FAILURE, "Invalid SHM log rings \"%s\"", optarg);
+                    }
+                    /* Re-open the SHM log if --shmlog-size opened it already. */
+                    if (log_buffer_size() > 0) {
+                        close_logbuffer();
+                        init_logging();
+                    }
+                    break;
                 } else if (strcmp(long_options[option_index].name, "restart") == 0) {
                     FREE(layout_path);
                     layout_path = sstrdup(optarg);
@@ -426,6 +582,10 @@ int main(int argc, char *argv[]) {
                     LOG("Initializing fake outputs: %s\n", optarg);
                     fake_outputs = sstrdup(optarg);
                     break;
+                } else if (strcmp(long_options[option_index].name, "record-trace") == 0) {
+                    FREE(trace_path);
+                    trace_path = sstrdup(optarg);
+                    break;
                 } else if (strcmp(long_options[option_index].name, "force-old-config-parser-v4.4-only") == 0) {
                     ELOG("You are passing --force-old-config-parser-v4.4-only, but that flag was removed by now.\n");
                     break;
@@ -457,9 +617,18 @@ int main(int argc, char *argv[]) {
                                 "\tThe default is %d bytes.\n",
                         shmlog_size);
                 fprintf(stderr, "\n");
+                fprintf(stderr, "\t--shmlog-rings <name>=<weight>[,...]\n"
+                                "\tChanges how the SHM log is split into the rings main, important\n"
+                                "\t(errors, RandR, config), x (X11 events, rendering) and ipc.\n"
+                                "\tThe defaults are main=30,important=15,x=35,ipc=20.\n");
+                fprintf(stderr, "\n");
                 fprintf(stderr, "\t--replace\n"
                                 "\tReplace an existing window manager.\n");
                 fprintf(stderr, "\n");
+                fprintf(stderr, "\t--record-trace <file>\n"
+                                "\tRecord the handled X events and IPC commands to <file>, to be\n"
+                                "\treplayed with bench.replay.\n");
+                fprintf(stderr, "\n");
                 fprintf(stderr, "If you pass plain text arguments, i3 will interpret them as a command\n"
                                 "to send to a currently running i3 (like i3-msg). This allows you to\n"
                                 "use nice and logical commands, such as:\n"
@@ -571,6 +740,9 @@ int main(int argc, char *argv[]) {
 
     LOG("i3 %s starting\n", i3_version);
 
+    /* Fork the launcher for exec while i3 is small (see launcher.c). */
+    launcher_start();
+
     conn = xcb_connect(NULL, &conn_screen);
     if (xcb_connection_has_error(conn))
         errx(EXIT_FAILURE, "Cannot open display");
@@ -658,6 +830,7 @@ int main(int argc, char *argv[]) {
         }
         DLOG("got timestamp %d\n", last_timestamp);
     }
+    stats_startup_phase(STATS_STARTUP_X_CONNECT);
 
     /* Setup NetWM atoms */
 #define xmacro(name)                                                                       \
@@ -673,8 +846,10 @@ int main(int argc, char *argv[]) {
     I3_NET_SUPPORTED_ATOMS_XMACRO
     I3_REST_ATOMS_XMACRO
 #undef xmacro
+    stats_startup_phase(STATS_STARTUP_ATOMS);
 
     load_configuration(override_configpath, C_LOAD);
+    stats_startup_phase(STATS_STARTUP_CONFIG);
 
     if (config.ipc_socket_path == NULL) {
         /* Fall back to a file name in /tmp/ based on the PID */
@@ -688,6 +863,7 @@ int main(int argc, char *argv[]) {
     if (ipc_socket == -1) {
         die("Could not create the IPC socket: %s", config.ipc_socket_path);
     }
+    ipc_create_socket_link(current_socketpath);
 
     if (config.force_xinerama) {
         force_xinerama = true;
@@ -814,6 +990,8 @@ int main(int argc, char *argv[]) {
        cursor until the first client is launched). */
     xcursor_set_root_cursor(XCURSOR_CURSOR_POINTER);
 
+    stats_startup_phase(STATS_STARTUP_WM_SELECTION);
+
     const xcb_query_extension_reply_t *extreply;
     extreply = xcb_get_extension_data(conn, &xcb_xkb_id);
     xkb_supported = extreply->present;
@@ -908,11 +1086,22 @@ int main(int argc, char *argv[]) {
 
     translate_keysyms();
     grab_all_keys(conn);
+    stats_startup_phase(STATS_STARTUP_XKB);
+
+    /* The font was requested while parsing the configuration, so the X server
+     * opened it while we set up the IPC socket and the keyboard. Restoring
+     * floating containers needs the decoration height, so we have to wait for
+     * it now. */
+    finish_font_loading(&config.font);
+    stats_startup_phase(STATS_STARTUP_FONT);
 
-    bool needs_tree_init = true;
+    bool needs_tree_init = !restore_restart_snapshot(greply);
+    const bool restored_snapshot = !needs_tree_init;
     if (layout_path != NULL) {
-        LOG("Trying to restore the layout from \"%s\".\n", layout_path);
-        needs_tree_init = !tree_restore(layout_path, greply);
+        if (needs_tree_init) {
+            LOG("Trying to restore the layout from \"%s\".\n", layout_path);
+            needs_tree_init = !tree_restore(layout_path, greply);
+        }
         if (delete_layout_path) {
             unlink(layout_path);
             const char *dir = dirname(layout_path);
@@ -925,6 +1114,7 @@ int main(int argc, char *argv[]) {
         tree_init(greply);
 
     free(greply);
+    stats_startup_phase(STATS_STARTUP_TREE);
 
     /* Setup fake outputs for testing */
     if (fake_outputs == NULL && config.fake_outputs != NULL)
@@ -944,11 +1134,19 @@ int main(int argc, char *argv[]) {
         randr_init(&randr_base, disable_randr15 || config.disable_randr15);
     }
 
+    event_handlers_init();
+
+    if (trace_path != NULL) {
+        /* After an in-place restart, the trace is continued. */
+        trace_open(trace_path, delete_layout_path);
+        free(trace_path);
+    }
+
     /* We need to force disabling outputs which have been loaded from the
      * layout file but are no longer active. This can happen if the output has
      * been disabled in the short time between writing the restart layout file
      * and restarting i3. See #2326. */
-    if (layout_path != NULL && randr_base > -1) {
+    if ((layout_path != NULL || restored_snapshot) && randr_base > -1) {
         Con *con;
         TAILQ_FOREACH (con, &(croot->nodes_head), nodes) {
             Output *output;
@@ -971,6 +1169,7 @@ int main(int argc, char *argv[]) {
     }
     FREE(layout_path);
 
+    stats_startup_phase(STATS_STARTUP_OUTPUTS);
     scratchpad_fix_resolution();
 
     xcb_query_pointer_reply_t *pointerreply;
@@ -992,6 +1191,7 @@ int main(int argc, char *argv[]) {
     free(pointerreply);
 
     tree_render();
+    stats_startup_phase(STATS_STARTUP_RENDER);
 
     /* Listen to the IPC socket for clients */
     struct ev_io *ipc_io = scalloc(1, sizeof(struct ev_io));
@@ -1040,7 +1240,7 @@ int main(int argc, char *argv[]) {
     }
 
     {
-        const int restart_fd = parse_restart_fd();
+        const int restart_fd = parse_restart_fd("_I3_RESTART_FD");
         if (restart_fd != -1) {
             DLOG("serving restart fd %d", restart_fd);
             ipc_client *client = ipc_new_client_on_fd(main_loop, restart_fd);
@@ -1051,6 +1251,8 @@ int main(int argc, char *argv[]) {
 
     /* Set up i3 specific atoms like I3_SOCKET_PATH and I3_CONFIG_PATH */
     x_set_i3_atoms();
+    tree_shm_configure();
+    raw_pointer_configure();
     ewmh_update_workarea();
 
     /* Set the ewmh desktop properties. */
@@ -1059,10 +1261,14 @@ int main(int argc, char *argv[]) {
     struct ev_io *xcb_watcher = scalloc(1, sizeof(struct ev_io));
     xcb_prepare = scalloc(1, sizeof(struct ev_prepare));
 
+    /* X11 input comes first: while the watcher is pending, IPC clients which
+     * exhausted their budget are not resumed (see ipc_handle_messages()). */
     ev_io_init(xcb_watcher, xcb_got_event, xcb_get_file_descriptor(conn), EV_READ);
+    ev_set_priority(xcb_watcher, EV_MAXPRI);
     ev_io_start(main_loop, xcb_watcher);
 
     ev_prepare_init(xcb_prepare, xcb_prepare_cb);
+    ev_set_priority(xcb_prepare, EV_MAXPRI);
     ev_prepare_start(main_loop, xcb_prepare);
 
     xcb_flush(conn);
@@ -1104,6 +1310,7 @@ int main(int argc, char *argv[]) {
         manage_existing_windows(root);
     }
     xcb_ungrab_server(conn);
+    stats_startup_phase(STATS_STARTUP_MANAGE_WINDOWS);
 
     if (autostart) {
         /* When the root's window background is set to NONE, that might mean
@@ -1178,19 +1385,47 @@ int main(int argc, char *argv[]) {
         TAILQ_REMOVE(&autostarts_always, exec_always, autostarts_always);
         FREE(exec_always);
     }
+    stats_startup_phase(STATS_STARTUP_AUTOSTART);
 
-    /* Start i3bar processes for all configured bars */
+    /* Start i3bar processes for all configured bars. The bars which use the
+     * default i3bar command share one process (one per verbosity), which
+     * saves the memory and startup time of loading fonts and connecting to
+     * X11 and i3 for every bar. */
+    char *shared_bar_ids[2] = {NULL, NULL};
     Barconfig *barconfig;
     TAILQ_FOREACH (barconfig, &barconfigs, configs) {
+        if (barconfig->i3bar_command == NULL) {
+            char **bar_ids = &shared_bar_ids[barconfig->verbose ? 1 : 0];
+            char *new_bar_ids = NULL;
+            sasprintf(&new_bar_ids, "%s --bar_id=%s", *bar_ids ? *bar_ids : "", barconfig->id);
+            free(*bar_ids);
+            *bar_ids = new_bar_ids;
+            continue;
+        }
+
         char *command = NULL;
         sasprintf(&command, "%s %s --bar_id=%s --socket=\"%s\"",
-                  barconfig->i3bar_command ? barconfig->i3bar_command : "exec i3bar",
+                  barconfig->i3bar_command,
                   barconfig->verbose ? "-V" : "",
                   barconfig->id, current_socketpath);
         LOG("Starting bar process: %s\n", command);
         start_application(command, true);
         free(command);
     }
+    for (int i = 0; i < 2; i++) {
+        if (shared_bar_ids[i] == NULL) {
+            continue;
+        }
+        char *command = NULL;
+        sasprintf(&command, "exec i3bar %s%s --socket=\"%s\"",
+                  i == 1 ? "-V" : "", shared_bar_ids[i], current_socketpath);
+        LOG("Starting bar process: %s\n", command);
+        start_application(command, true);
+        free(command);
+        free(shared_bar_ids[i]);
+    }
+
+    stats_startup_phase(STATS_STARTUP_BARS);
 
     /* Make sure to destroy the event loop to invoke the cleanup callbacks
      * when calling exit() */
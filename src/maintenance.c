@@ -0,0 +1,122 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * maintenance.c: A queue of cheap deferred cleanup tasks (trimming caches,
+ *                returning memory), run while i3 is idle.
+ *
+ * Subsystems queue their cleanup instead of doing it on the path which made
+ * it necessary (e.g. closing a window). The tasks are run by an idle watcher
+ * with the lowest priority, which libev only invokes when no other watcher is
+ * pending, so they never delay input. Each idle slice runs tasks for at most
+ * MAINTENANCE_BUDGET seconds, tasks with more work left are queued again.
+ *
+ */
+#include "all.h"
+#include "yajl_utils.h"
+
+static TAILQ_HEAD(maintenance_head, maintenance_task) queue = TAILQ_HEAD_INITIALIZER(queue);
+static SLIST_HEAD(all_tasks_head, maintenance_task) all_tasks = SLIST_HEAD_INITIALIZER(all_tasks);
+static struct ev_idle *idle_watcher = NULL;
+static uint64_t slices = 0;
+
+/*
+ * Runs the queued tasks in order until the budget of this slice is used up.
+ *
+ */
+static void maintenance_idle_cb(EV_P_ ev_idle *w, int revents) {
+    const ev_tstamp start = ev_time();
+    slices++;
+
+    /* Tasks queued again (or newly) in this slice go to the end of the queue,
+     * so every task gets its turn. */
+    maintenance_task *task;
+    while ((task = TAILQ_FIRST(&queue)) != NULL) {
+        TAILQ_REMOVE(&queue, task, tasks);
+        task->queued = false;
+        task->runs++;
+        if (task->cb(task)) {
+            maintenance_schedule(task);
+        }
+
+        if (ev_time() - start >= MAINTENANCE_BUDGET) {
+            break;
+        }
+    }
+
+    if (TAILQ_EMPTY(&queue)) {
+        ev_idle_stop(EV_A_ w);
+    }
+}
+
+/*
+ * Queues the task, unless it is queued already. It runs once there are no
+ * pending X11 events, IPC messages or timers.
+ *
+ */
+void maintenance_schedule(maintenance_task *task) {
+    if (!task->registered) {
+        SLIST_INSERT_HEAD(&all_tasks, task, all_tasks);
+        task->registered = true;
+    }
+    if (task->queued) {
+        return;
+    }
+
+    if (idle_watcher == NULL) {
+        idle_watcher = scalloc(1, sizeof(struct ev_idle));
+        ev_idle_init(idle_watcher, maintenance_idle_cb);
+        ev_set_priority(idle_watcher, EV_MINPRI);
+    }
+    if (TAILQ_EMPTY(&queue)) {
+        ev_idle_start(main_loop, idle_watcher);
+    }
+
+    TAILQ_INSERT_TAIL(&queue, task, tasks);
+    task->queued = true;
+}
+
+/*
+ * Removes the task from the queue if it is queued.
+ *
+ */
+void maintenance_cancel(maintenance_task *task) {
+    if (!task->queued) {
+        return;
+    }
+
+    TAILQ_REMOVE(&queue, task, tasks);
+    task->queued = false;
+    if (TAILQ_EMPTY(&queue)) {
+        ev_idle_stop(main_loop, idle_watcher);
+    }
+}
+
+/*
+ * Serializes the counters of the maintenance queue as the "maintenance" member
+ * of the currently open JSON map.
+ *
+ */
+void maintenance_dump(yajl_gen gen) {
+    ystr("maintenance");
+    y(map_open);
+    ystr("slices");
+    y(integer, slices);
+    ystr("tasks");
+    y(array_open);
+    maintenance_task *task;
+    SLIST_FOREACH (task, &all_tasks, all_tasks) {
+        y(map_open);
+        ystr("name");
+        ystr(task->name);
+        ystr("runs");
+        y(integer, task->runs);
+        ystr("queued");
+        y(bool, task->queued);
+        y(map_close);
+    }
+    y(array_close);
+    y(map_close);
+}
@@ -9,6 +9,9 @@
  */
 #include "all.h"
 
+#include <inttypes.h>
+#include <xcb/xcbext.h>
+
 /*
  * Match frame and window depth. This is needed because X will refuse to reparent a
  * window whose background is ParentRelative under a window with a different depth.
@@ -17,7 +20,9 @@
 static xcb_window_t _match_depth(i3Window *win, Con *con) {
     xcb_window_t old_frame = XCB_NONE;
     if (con->depth != win->depth) {
-        old_frame = con->frame.id;
+        if (x_con_has_frame(con)) {
+            old_frame = con->frame.id;
+        }
         con->depth = win->depth;
         x_con_reframe(con);
     }
@@ -29,44 +34,14 @@ static xcb_window_t _match_depth(i3Window *win, Con *con) {
  *
  */
 static void _remove_matches(Con *con) {
-    while (!TAILQ_EMPTY(&(con->swallow_head))) {
-        Match *first = TAILQ_FIRST(&(con->swallow_head));
-        TAILQ_REMOVE(&(con->swallow_head), first, matches);
+    while (!TAILQ_EMPTY(&(con->cold->swallow_head))) {
+        Match *first = TAILQ_FIRST(&(con->cold->swallow_head));
+        con_remove_swallow(con, first);
         match_free(first);
-        free(first);
+        pool_free(&match_pool, first);
     }
 }
 
-/*
- * Go through all existing windows (if the window manager is restarted) and manage them
- *
- */
-void manage_existing_windows(xcb_window_t root) {
-    xcb_query_tree_reply_t *reply;
-    int i, len;
-    xcb_window_t *children;
-    xcb_get_window_attributes_cookie_t *cookies;
-
-    /* Get the tree of windows whose parent is the root window (= all) */
-    if ((reply = xcb_query_tree_reply(conn, xcb_query_tree(conn, root), 0)) == NULL)
-        return;
-
-    len = xcb_query_tree_children_length(reply);
-    cookies = smalloc(len * sizeof(*cookies));
-
-    /* Request the window attributes for every window */
-    children = xcb_query_tree_children(reply);
-    for (i = 0; i < len; ++i)
-        cookies[i] = xcb_get_window_attributes(conn, children[i]);
-
-    /* Call manage_window with the attributes for every window */
-    for (i = 0; i < len; ++i)
-        manage_window(children[i], cookies[i], true);
-
-    free(reply);
-    free(cookies);
-}
-
 /*
  * Restores the geometry of each window by reparenting it to the root window
  * at the position of its frame.
@@ -88,6 +63,11 @@ void restore_geometry(void) {
             DLOG("placing window %08x at %d %d\n", con->window->id, con->rect.x, con->rect.y);
             xcb_reparent_window(conn, con->window->id, root,
                                 con->rect.x, con->rect.y);
+            /* Windows which we unmapped when adopting them are mapped again,
+             * so that the next instance adopts them, too. */
+            if (x_con_child_hidden(con)) {
+                xcb_map_window(conn, con->window->id);
+            }
         }
     }
 
@@ -100,63 +80,94 @@ void restore_geometry(void) {
 }
 
 /*
- * Do some sanity checks and then reparent the window.
+ * The requests which are sent to manage a window. They are sent before any of
+ * the replies is needed, so that managing a window does not wait for one
+ * round-trip per property, and adopting all existing windows on restart does
+ * not wait for one round-trip per property and window.
  *
  */
-void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cookie,
-                   bool needs_to_be_mapped) {
-    DLOG("window 0x%08x\n", window);
+struct manage_request {
+    xcb_window_t window;
+    bool needs_to_be_mapped;
 
-    xcb_drawable_t d = {window};
-    xcb_get_geometry_cookie_t geomc;
-    xcb_get_geometry_reply_t *geom;
-    xcb_get_window_attributes_reply_t *attr = NULL;
+    xcb_get_window_attributes_cookie_t attr_cookie;
+    xcb_get_window_attributes_reply_t *attr;
+    xcb_get_geometry_cookie_t geom_cookie;
+    xcb_void_cookie_t event_mask_cookie;
 
     xcb_get_property_cookie_t wm_type_cookie, strut_cookie, state_cookie,
         utf8_title_cookie, title_cookie,
         class_cookie, leader_cookie, transient_cookie,
         role_cookie, startup_id_cookie, wm_hints_cookie,
         wm_normal_hints_cookie, motif_wm_hints_cookie, wm_user_time_cookie, wm_desktop_cookie,
-        wm_machine_cookie;
+        wm_machine_cookie, wm_icon_cookie, wm_protocols_cookie, wm_pid_cookie;
 
-    xcb_get_property_cookie_t wm_icon_cookie;
+    xcb_shape_query_extents_cookie_t shape_cookie;
 
-    geomc = xcb_get_geometry(conn, d);
+    /* Used by manage_window(), which waits for the replies without blocking:
+     * the replies to all requests sent before sync_cookie have arrived once
+     * its own reply is there. */
+    enum {
+        MANAGE_WAIT_ATTRIBUTES,
+        MANAGE_WAIT_PROPERTIES,
+    } state;
+    xcb_get_input_focus_cookie_t sync_cookie;
+
+    TAILQ_ENTRY(manage_request) requests;
+};
+
+/* The windows which are being managed by manage_window(), oldest first. */
+static TAILQ_HEAD(manage_requests_head, manage_request) manage_requests =
+    TAILQ_HEAD_INITIALIZER(manage_requests);
+
+/*
+ * Starts managing the given window by requesting its geometry. The window
+ * attributes have to be requested by the caller.
+ *
+ */
+static void manage_request_init(struct manage_request *req, xcb_window_t window,
+                                xcb_get_window_attributes_cookie_t cookie, bool needs_to_be_mapped) {
+    DLOG("window 0x%08x\n", window);
+
+    req->window = window;
+    req->needs_to_be_mapped = needs_to_be_mapped;
+    req->attr_cookie = cookie;
+    req->attr = NULL;
+    req->geom_cookie = xcb_get_geometry(conn, window);
+}
+
+/*
+ * Checks the window attributes and, if the window is to be managed, requests
+ * all properties which are needed to manage it. Returns false if the window
+ * will not be managed, in which case all requests have been discarded.
+ *
+ */
+static bool manage_request_properties(struct manage_request *req) {
+    const xcb_window_t window = req->window;
 
     /* Check if the window is mapped (it could be not mapped when initializing and
        calling manage_window() for every window) */
-    if ((attr = xcb_get_window_attributes_reply(conn, cookie, 0)) == NULL) {
+    if ((req->attr = xcb_get_window_attributes_reply(conn, req->attr_cookie, 0)) == NULL) {
         DLOG("Could not get attributes\n");
-        xcb_discard_reply(conn, geomc.sequence);
-        return;
+        xcb_discard_reply(conn, req->geom_cookie.sequence);
+        return false;
     }
 
-    if (needs_to_be_mapped && attr->map_state != XCB_MAP_STATE_VIEWABLE) {
-        xcb_discard_reply(conn, geomc.sequence);
+    if (req->needs_to_be_mapped && req->attr->map_state != XCB_MAP_STATE_VIEWABLE) {
         goto out;
     }
 
     /* Don’t manage clients with the override_redirect flag */
-    if (attr->override_redirect) {
-        xcb_discard_reply(conn, geomc.sequence);
+    if (req->attr->override_redirect) {
         goto out;
     }
 
     /* Check if the window is already managed */
     if (con_by_window_id(window) != NULL) {
         DLOG("already managed (by con %p)\n", con_by_window_id(window));
-        xcb_discard_reply(conn, geomc.sequence);
-        goto out;
-    }
-
-    /* Get the initial geometry (position, size, …) */
-    if ((geom = xcb_get_geometry_reply(conn, geomc, 0)) == NULL) {
-        DLOG("could not get geometry\n");
         goto out;
     }
 
-    uint32_t values[1];
-
     /* Set a temporary event mask for the new window, consisting only of
      * PropertyChange and StructureNotify. We need to be notified of
      * PropertyChanges because the client can change its properties *after* we
@@ -165,37 +176,118 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
      * We need StructureNotify because the client may unmap the window before
      * we get to re-parent it.
      * If this request fails, we assume the client has already unmapped the
-     * window between the MapRequest and our event mask change. */
-    values[0] = XCB_EVENT_MASK_PROPERTY_CHANGE |
-                XCB_EVENT_MASK_STRUCTURE_NOTIFY;
-    xcb_void_cookie_t event_mask_cookie =
+     * window between the MapRequest and our event mask change. The X server
+     * processes the requests in order, so the properties below are read with
+     * the event mask already in place. */
+    uint32_t values[] = {XCB_EVENT_MASK_PROPERTY_CHANGE |
+                         XCB_EVENT_MASK_STRUCTURE_NOTIFY};
+    req->event_mask_cookie =
         xcb_change_window_attributes_checked(conn, window, XCB_CW_EVENT_MASK, values);
-    if (xcb_request_check(conn, event_mask_cookie) != NULL) {
+
+#define GET_PROPERTY(atom, len) xcb_get_property(conn, false, window, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, len)
+
+    req->wm_type_cookie = GET_PROPERTY(A__NET_WM_WINDOW_TYPE, UINT32_MAX);
+    req->strut_cookie = GET_PROPERTY(A__NET_WM_STRUT_PARTIAL, UINT32_MAX);
+    req->state_cookie = GET_PROPERTY(A__NET_WM_STATE, UINT32_MAX);
+    req->utf8_title_cookie = GET_PROPERTY(A__NET_WM_NAME, 128);
+    req->leader_cookie = GET_PROPERTY(A_WM_CLIENT_LEADER, UINT32_MAX);
+    req->transient_cookie = GET_PROPERTY(XCB_ATOM_WM_TRANSIENT_FOR, UINT32_MAX);
+    req->title_cookie = GET_PROPERTY(XCB_ATOM_WM_NAME, 128);
+    req->class_cookie = GET_PROPERTY(XCB_ATOM_WM_CLASS, 128);
+    req->role_cookie = GET_PROPERTY(A_WM_WINDOW_ROLE, 128);
+    req->startup_id_cookie = GET_PROPERTY(A__NET_STARTUP_ID, 512);
+    req->wm_hints_cookie = xcb_icccm_get_wm_hints(conn, window);
+    req->wm_normal_hints_cookie = xcb_icccm_get_wm_normal_hints(conn, window);
+    req->motif_wm_hints_cookie = GET_PROPERTY(A__MOTIF_WM_HINTS, 5 * sizeof(uint64_t));
+    req->wm_user_time_cookie = GET_PROPERTY(A__NET_WM_USER_TIME, UINT32_MAX);
+    req->wm_desktop_cookie = GET_PROPERTY(A__NET_WM_DESKTOP, UINT32_MAX);
+    req->wm_machine_cookie = GET_PROPERTY(XCB_ATOM_WM_CLIENT_MACHINE, UINT32_MAX);
+    req->wm_icon_cookie = GET_PROPERTY(A__NET_WM_ICON, UINT32_MAX);
+    req->wm_protocols_cookie = xcb_icccm_get_wm_protocols(conn, window, A_WM_PROTOCOLS);
+    req->wm_pid_cookie = GET_PROPERTY(A__NET_WM_PID, 1);
+
+#undef GET_PROPERTY
+
+    if (shape_supported) {
+        /* Receive ShapeNotify events whenever the client altered its window
+         * shape. */
+        xcb_shape_select_input(conn, window, true);
+
+        /* Check if the window is shaped. Sadly, we can check only for the
+         * bounding shape, not for the input shape. */
+        req->shape_cookie = xcb_shape_query_extents(conn, window);
+    }
+
+    return true;
+
+out:
+    xcb_discard_reply(conn, req->geom_cookie.sequence);
+    FREE(req->attr);
+    return false;
+}
+
+/*
+ * Discards the replies to all requests sent by manage_request_properties().
+ *
+ */
+static void manage_request_discard(struct manage_request *req) {
+    const xcb_get_property_cookie_t cookies[] = {
+        req->wm_type_cookie,
+        req->strut_cookie,
+        req->state_cookie,
+        req->utf8_title_cookie,
+        req->leader_cookie,
+        req->transient_cookie,
+        req->title_cookie,
+        req->class_cookie,
+        req->role_cookie,
+        req->startup_id_cookie,
+        req->wm_hints_cookie,
+        req->wm_normal_hints_cookie,
+        req->motif_wm_hints_cookie,
+        req->wm_user_time_cookie,
+        req->wm_desktop_cookie,
+        req->wm_machine_cookie,
+        req->wm_icon_cookie,
+        req->wm_protocols_cookie,
+        req->wm_pid_cookie,
+    };
+    for (size_t i = 0; i < sizeof(cookies) / sizeof(cookies[0]); i++) {
+        xcb_discard_reply(conn, cookies[i].sequence);
+    }
+    if (shape_supported) {
+        xcb_discard_reply(conn, req->shape_cookie.sequence);
+    }
+}
+
+/*
+ * Waits for the replies to the requests of manage_request_properties() and
+ * reparents the window.
+ *
+ */
+static void manage_request_finish(struct manage_request *req) {
+    const xcb_window_t window = req->window;
+    xcb_get_window_attributes_reply_t *attr = req->attr;
+    xcb_get_geometry_reply_t *geom;
+    uint32_t values[1];
+
+    xcb_generic_error_t *error = xcb_request_check(conn, req->event_mask_cookie);
+    if (error != NULL) {
         LOG("Could not change event mask, the window probably already disappeared.\n");
+        free(error);
+        xcb_discard_reply(conn, req->geom_cookie.sequence);
+        manage_request_discard(req);
         goto out;
     }
 
-#define GET_PROPERTY(atom, len) xcb_get_property(conn, false, window, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, len)
+    /* Get the initial geometry (position, size, …) */
+    if ((geom = xcb_get_geometry_reply(conn, req->geom_cookie, 0)) == NULL) {
+        DLOG("could not get geometry\n");
+        manage_request_discard(req);
+        goto out;
+    }
 
-    wm_type_cookie = GET_PROPERTY(A__NET_WM_WINDOW_TYPE, UINT32_MAX);
-    strut_cookie = GET_PROPERTY(A__NET_WM_STRUT_PARTIAL, UINT32_MAX);
-    state_cookie = GET_PROPERTY(A__NET_WM_STATE, UINT32_MAX);
-    utf8_title_cookie = GET_PROPERTY(A__NET_WM_NAME, 128);
-    leader_cookie = GET_PROPERTY(A_WM_CLIENT_LEADER, UINT32_MAX);
-    transient_cookie = GET_PROPERTY(XCB_ATOM_WM_TRANSIENT_FOR, UINT32_MAX);
-    title_cookie = GET_PROPERTY(XCB_ATOM_WM_NAME, 128);
-    class_cookie = GET_PROPERTY(XCB_ATOM_WM_CLASS, 128);
-    role_cookie = GET_PROPERTY(A_WM_WINDOW_ROLE, 128);
-    startup_id_cookie = GET_PROPERTY(A__NET_STARTUP_ID, 512);
-    wm_hints_cookie = xcb_icccm_get_wm_hints(conn, window);
-    wm_normal_hints_cookie = xcb_icccm_get_wm_normal_hints(conn, window);
-    motif_wm_hints_cookie = GET_PROPERTY(A__MOTIF_WM_HINTS, 5 * sizeof(uint64_t));
-    wm_user_time_cookie = GET_PROPERTY(A__NET_WM_USER_TIME, UINT32_MAX);
-    wm_desktop_cookie = GET_PROPERTY(A__NET_WM_DESKTOP, UINT32_MAX);
-    wm_machine_cookie = GET_PROPERTY(XCB_ATOM_WM_CLIENT_MACHINE, UINT32_MAX);
-    wm_icon_cookie = GET_PROPERTY(A__NET_WM_ICON, UINT32_MAX);
-
-    i3Window *cwindow = scalloc(1, sizeof(i3Window));
+    i3Window *cwindow = pool_alloc(&window_pool);
     cwindow->id = window;
     cwindow->depth = get_visual_depth(attr->visual);
 
@@ -204,31 +296,40 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     FREE(buttons);
 
     /* update as much information as possible so far (some replies may be NULL) */
-    window_update_class(cwindow, xcb_get_property_reply(conn, class_cookie, NULL));
-    window_update_name_legacy(cwindow, xcb_get_property_reply(conn, title_cookie, NULL));
-    window_update_name(cwindow, xcb_get_property_reply(conn, utf8_title_cookie, NULL));
-    window_update_icon(cwindow, xcb_get_property_reply(conn, wm_icon_cookie, NULL));
-    window_update_leader(cwindow, xcb_get_property_reply(conn, leader_cookie, NULL));
-    window_update_transient_for(cwindow, xcb_get_property_reply(conn, transient_cookie, NULL));
-    window_update_strut_partial(cwindow, xcb_get_property_reply(conn, strut_cookie, NULL));
-    window_update_role(cwindow, xcb_get_property_reply(conn, role_cookie, NULL));
+    window_update_class(cwindow, xcb_get_property_reply(conn, req->class_cookie, NULL));
+    window_update_name_legacy(cwindow, xcb_get_property_reply(conn, req->title_cookie, NULL));
+    window_update_name(cwindow, xcb_get_property_reply(conn, req->utf8_title_cookie, NULL));
+    window_update_icon(cwindow, xcb_get_property_reply(conn, req->wm_icon_cookie, NULL));
+    window_update_leader(cwindow, xcb_get_property_reply(conn, req->leader_cookie, NULL));
+    window_update_transient_for(cwindow, xcb_get_property_reply(conn, req->transient_cookie, NULL));
+    window_update_strut_partial(cwindow, xcb_get_property_reply(conn, req->strut_cookie, NULL));
+    window_update_role(cwindow, xcb_get_property_reply(conn, req->role_cookie, NULL));
     bool urgency_hint;
-    window_update_hints(cwindow, xcb_get_property_reply(conn, wm_hints_cookie, NULL), &urgency_hint);
+    window_update_hints(cwindow, xcb_get_property_reply(conn, req->wm_hints_cookie, NULL), &urgency_hint);
     border_style_t motif_border_style = BS_NORMAL;
-    window_update_motif_hints(cwindow, xcb_get_property_reply(conn, motif_wm_hints_cookie, NULL), &motif_border_style);
-    window_update_normal_hints(cwindow, xcb_get_property_reply(conn, wm_normal_hints_cookie, NULL), geom);
-    window_update_machine(cwindow, xcb_get_property_reply(conn, wm_machine_cookie, NULL));
-    xcb_get_property_reply_t *type_reply = xcb_get_property_reply(conn, wm_type_cookie, NULL);
-    xcb_get_property_reply_t *state_reply = xcb_get_property_reply(conn, state_cookie, NULL);
+    window_update_motif_hints(cwindow, xcb_get_property_reply(conn, req->motif_wm_hints_cookie, NULL), &motif_border_style);
+    window_update_normal_hints(cwindow, xcb_get_property_reply(conn, req->wm_normal_hints_cookie, NULL), geom);
+    window_update_machine(cwindow, xcb_get_property_reply(conn, req->wm_machine_cookie, NULL));
+    xcb_get_property_reply_t *type_reply = xcb_get_property_reply(conn, req->wm_type_cookie, NULL);
+    xcb_get_property_reply_t *state_reply = xcb_get_property_reply(conn, req->state_cookie, NULL);
+
+    /* Get _NET_WM_PID if it was set, for startup_workspace_for_window(). */
+    xcb_get_property_reply_t *wm_pid_reply;
+    wm_pid_reply = xcb_get_property_reply(conn, req->wm_pid_cookie, NULL);
+    if (wm_pid_reply != NULL && xcb_get_property_value_length(wm_pid_reply) != 0) {
+        uint32_t *wm_pids = xcb_get_property_value(wm_pid_reply);
+        cwindow->pid = (pid_t)wm_pids[0];
+    }
+    FREE(wm_pid_reply);
 
     xcb_get_property_reply_t *startup_id_reply;
-    startup_id_reply = xcb_get_property_reply(conn, startup_id_cookie, NULL);
+    startup_id_reply = xcb_get_property_reply(conn, req->startup_id_cookie, NULL);
     char *startup_ws = startup_workspace_for_window(cwindow, startup_id_reply);
     DLOG("startup workspace = %s\n", startup_ws);
 
     /* Get _NET_WM_DESKTOP if it was set. */
     xcb_get_property_reply_t *wm_desktop_reply;
-    wm_desktop_reply = xcb_get_property_reply(conn, wm_desktop_cookie, NULL);
+    wm_desktop_reply = xcb_get_property_reply(conn, req->wm_desktop_cookie, NULL);
     cwindow->wm_desktop = NET_WM_DESKTOP_NONE;
     if (wm_desktop_reply != NULL && xcb_get_property_value_length(wm_desktop_reply) != 0) {
         uint32_t *wm_desktops = xcb_get_property_value(wm_desktop_reply);
@@ -236,8 +337,8 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     }
     FREE(wm_desktop_reply);
 
-    /* check if the window needs WM_TAKE_FOCUS */
-    cwindow->needs_take_focus = window_supports_protocol(cwindow->id, A_WM_TAKE_FOCUS);
+    /* check if the window needs WM_TAKE_FOCUS or supports WM_DELETE_WINDOW */
+    window_update_protocols(cwindow, xcb_get_property_reply(conn, req->wm_protocols_cookie, NULL));
 
     /* read the preferred _NET_WM_WINDOW_TYPE atom */
     cwindow->window_type = xcb_get_preferred_window_type(type_reply);
@@ -362,9 +463,9 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
          * once. */
         if (match != NULL && match->insert_where != M_BELOW) {
             DLOG("Removing match %p from container %p\n", match, nc);
-            TAILQ_REMOVE(&(nc->swallow_head), match, matches);
+            con_remove_swallow(nc, match);
             match_free(match);
-            FREE(match);
+            pool_free(&match_pool, match);
         }
 
         cwindow->swallowed = true;
@@ -381,11 +482,14 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     }
     xcb_window_t old_frame = XCB_NONE;
     if (nc->window != cwindow && nc->window != NULL) {
+        con_unindex_window(nc);
         window_free(nc->window);
         old_frame = _match_depth(cwindow, nc);
     }
     nc->window = cwindow;
+    con_invalidate_tree_representation(nc);
     x_reinit(nc);
+    con_set_dirty(nc);
 
     nc->border_width = geom->border_width;
 
@@ -449,6 +553,7 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
              * new windows, for example when restarting. */
             TAILQ_REMOVE(&(nc->parent->focus_head), nc, focused);
             TAILQ_INSERT_AFTER(&(nc->parent->focus_head), first, nc, focused);
+            con_invalidate_lookups();
         }
     }
 
@@ -467,14 +572,14 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     }
 
     if (xcb_reply_contains_atom(state_reply, A__NET_WM_STATE_STICKY))
-        nc->sticky = true;
+        con_set_sticky(nc, true);
 
     /* We ignore the hint for an internal workspace because windows in the
      * scratchpad also have this value, but upon restarting i3 we don't want
      * them to become sticky windows. */
     if (cwindow->wm_desktop == NET_WM_DESKTOP_ALL && (ws == NULL || !con_is_internal(ws))) {
         DLOG("This window has _NET_WM_DESKTOP = 0xFFFFFFFF. Will float it and make it sticky.\n");
-        nc->sticky = true;
+        con_set_sticky(nc, true);
         want_floating = true;
     }
 
@@ -536,20 +641,12 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
         nc->current_border_width = (want_floating ? config.default_floating_border_width : config.default_border_width);
     }
 
-    /* to avoid getting an UnmapNotify event due to reparenting, we temporarily
-     * declare no interest in any state change event of this window */
-    values[0] = XCB_NONE;
-    xcb_change_window_attributes(conn, window, XCB_CW_EVENT_MASK, values);
-
-    xcb_void_cookie_t rcookie = xcb_reparent_window_checked(conn, window, nc->frame.id, 0, 0);
-    if (xcb_request_check(conn, rcookie) != NULL) {
-        LOG("Could not reparent the window, aborting\n");
-        goto geom_out;
-    }
-
+    /* The window is reparented into the frame once the container is shown
+     * for the first time (see x_adopt_child()). Should the window disappear
+     * before, we get a DestroyNotify because of the event mask. */
     values[0] = CHILD_EVENT_MASK & ~XCB_EVENT_MASK_ENTER_WINDOW;
     xcb_change_window_attributes(conn, window, XCB_CW_EVENT_MASK, values);
-    xcb_flush(conn);
+    x_adopt_child(nc, req->attr->map_state == XCB_MAP_STATE_VIEWABLE);
 
     /* Put the client inside the save set. Upon termination (whether killed or
      * normal exit does not matter) of the window manager, these clients will
@@ -558,16 +655,8 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     xcb_change_save_set(conn, XCB_SET_MODE_INSERT, window);
 
     if (shape_supported) {
-        /* Receive ShapeNotify events whenever the client altered its window
-         * shape. */
-        xcb_shape_select_input(conn, window, true);
-
-        /* Check if the window is shaped. Sadly, we can check only for the
-         * bounding shape, not for the input shape. */
-        xcb_shape_query_extents_cookie_t cookie =
-            xcb_shape_query_extents(conn, window);
         xcb_shape_query_extents_reply_t *reply =
-            xcb_shape_query_extents_reply(conn, cookie, NULL);
+            xcb_shape_query_extents_reply(conn, req->shape_cookie, NULL);
         if (reply != NULL && reply->bounding_shaped) {
             cwindow->shaped = true;
         }
@@ -575,7 +664,7 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     }
 
     /* Check if any assignments match */
-    run_assignments(cwindow);
+    run_assignments(cwindow, WP_ALL);
 
     /* 'ws' may be invalid because of the assignments, e.g. when the user uses
      * "move window to workspace 1", but had it assigned to workspace 2. */
@@ -607,6 +696,7 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
 
     /* Send an event about window creation */
     ipc_send_window_event("new", nc);
+    PROBE2(window_manage, cwindow->id, (uintptr_t)nc);
 
     if (set_focus && assignment_for(cwindow, A_NO_FOCUS) != NULL) {
         /* The first window on a workspace should always be focused. We have to
@@ -624,7 +714,7 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
         DLOG("Checking con = %p for _NET_WM_USER_TIME.\n", nc);
 
         uint32_t *wm_user_time;
-        xcb_get_property_reply_t *wm_user_time_reply = xcb_get_property_reply(conn, wm_user_time_cookie, NULL);
+        xcb_get_property_reply_t *wm_user_time_reply = xcb_get_property_reply(conn, req->wm_user_time_cookie, NULL);
         if (wm_user_time_reply != NULL && xcb_get_property_value_length(wm_user_time_reply) != 0 &&
             (wm_user_time = xcb_get_property_value(wm_user_time_reply)) &&
             wm_user_time[0] == 0) {
@@ -634,7 +724,7 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
 
         FREE(wm_user_time_reply);
     } else {
-        xcb_discard_reply(conn, wm_user_time_cookie.sequence);
+        xcb_discard_reply(conn, req->wm_user_time_cookie.sequence);
     }
 
     if (set_focus) {
@@ -655,6 +745,10 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
         con_activate(nc);
     }
 
+    /* A new dock client only changes the dock area of its output. */
+    if (cwindow->dock) {
+        tree_note_output_change(con_get_output(nc));
+    }
     tree_render();
 
     /* Destroy the old frame if we had to reframe the container. This needs to be done
@@ -676,34 +770,147 @@ void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cooki
     /* If a sticky window was mapped onto another workspace, make sure to pop it to the front. */
     output_push_sticky_windows(focused);
 
-geom_out:
     free(geom);
 out:
     free(attr);
 }
 
 /*
- * Remanages a window: performs a swallow check and runs assignments.
- * Returns con for the window regardless if it updated.
+ * Go through all existing windows (if the window manager is restarted) and manage them
+ *
+ */
+void manage_existing_windows(xcb_window_t root) {
+    xcb_query_tree_reply_t *reply;
+    int i, len;
+    xcb_window_t *children;
+    struct manage_request *requests;
+    bool *manageable;
+
+    /* Get the tree of windows whose parent is the root window (= all) */
+    if ((reply = xcb_query_tree_reply(conn, xcb_query_tree(conn, root), 0)) == NULL)
+        return;
+
+    const uint64_t start = stats_now();
+
+    len = xcb_query_tree_children_length(reply);
+    requests = smalloc(len * sizeof(*requests));
+    manageable = smalloc(len * sizeof(*manageable));
+
+    /* Request the window attributes and geometry for every window */
+    children = xcb_query_tree_children(reply);
+    for (i = 0; i < len; ++i)
+        manage_request_init(&requests[i], children[i], xcb_get_window_attributes(conn, children[i]), true);
+
+    /* Then the properties of every window which will be managed, so that the
+     * replies for all windows arrive without waiting for each other */
+    for (i = 0; i < len; ++i)
+        manageable[i] = manage_request_properties(&requests[i]);
+
+    /* Manage every window with the replies */
+    for (i = 0; i < len; ++i)
+        if (manageable[i])
+            manage_request_finish(&requests[i]);
+
+    LOG("Managed the %d existing windows in %" PRIu64 " us\n", len, stats_now() - start);
+
+    free(reply);
+    free(requests);
+    free(manageable);
+}
+
+/*
+ * Do some sanity checks and then reparent the window. The replies are waited
+ * for in the event loop, see manage_window_continue().
+ *
+ */
+void manage_window(xcb_window_t window, xcb_get_window_attributes_cookie_t cookie,
+                   bool needs_to_be_mapped) {
+    struct manage_request *req = smalloc(sizeof(struct manage_request));
+    manage_request_init(req, window, cookie, needs_to_be_mapped);
+    req->state = MANAGE_WAIT_ATTRIBUTES;
+    req->sync_cookie = xcb_get_input_focus(conn);
+    TAILQ_INSERT_TAIL(&manage_requests, req, requests);
+    xcb_flush(conn);
+}
+
+/*
+ * Returns true while a window passed to manage_window() is waiting for
+ * replies.
+ *
+ */
+bool manage_window_pending(void) {
+    return !TAILQ_EMPTY(&manage_requests);
+}
+
+/*
+ * Returns true if the replies to all requests sent before the given one have
+ * arrived, without blocking.
+ *
+ */
+static bool replies_arrived(xcb_get_input_focus_cookie_t cookie) {
+    void *reply = NULL;
+    xcb_generic_error_t *error = NULL;
+    if (xcb_poll_for_reply(conn, cookie.sequence, &reply, &error) == 0) {
+        return false;
+    }
+    free(reply);
+    free(error);
+    return true;
+}
+
+/*
+ * Continues managing the windows passed to manage_window() whose replies have
+ * arrived, in the order in which they were passed. Returns true if any window
+ * made progress.
+ *
+ */
+bool manage_window_continue(void) {
+    bool progress = false;
+    struct manage_request *req;
+    while ((req = TAILQ_FIRST(&manage_requests)) != NULL &&
+           replies_arrived(req->sync_cookie)) {
+        progress = true;
+
+        if (req->state == MANAGE_WAIT_ATTRIBUTES) {
+            if (manage_request_properties(req)) {
+                req->state = MANAGE_WAIT_PROPERTIES;
+                req->sync_cookie = xcb_get_input_focus(conn);
+                xcb_flush(conn);
+                continue;
+            }
+        } else {
+            manage_request_finish(req);
+        }
+
+        TAILQ_REMOVE(&manage_requests, req, requests);
+        free(req);
+    }
+    return progress;
+}
+
+/*
+ * Remanages a window: performs a swallow check and runs the assignments which
+ * depend on the changed window properties (WP_*). Returns con for the window
+ * regardless if it updated.
  *
  */
-Con *remanage_window(Con *con) {
+Con *remanage_window(Con *con, uint32_t changed) {
     /* Make sure this windows hasn't already been swallowed. */
     if (con->window->swallowed) {
-        run_assignments(con->window);
+        run_assignments(con->window, changed);
         return con;
     }
     Match *match;
     Con *nc = con_for_window(croot, con->window, &match);
     if (nc == NULL || nc->window == NULL || nc->window == con->window) {
-        run_assignments(con->window);
+        run_assignments(con->window, changed);
         return con;
     }
     /* Make sure the placeholder that wants to swallow this window didn't spawn
      * after the window to follow current behavior: adding a placeholder won't
      * swallow windows currently managed. */
     if (nc->window->managed_since > con->window->managed_since) {
-        run_assignments(con->window);
+        run_assignments(con->window, changed);
         return con;
     }
 
@@ -712,6 +919,7 @@ Con *remanage_window(Con *con) {
     } else {
         _remove_matches(nc);
     }
+    con_unindex_window(nc);
     window_free(nc->window);
 
     xcb_window_t old_frame = _match_depth(con->window, nc);
@@ -728,7 +936,7 @@ Con *remanage_window(Con *con) {
         xcb_destroy_window(conn, old_frame);
     }
 
-    run_assignments(nc->window);
+    run_assignments(nc->window, WP_ALL);
 
     if (moved_workpaces) {
         /* If the window is associated with a startup sequence, delete it so
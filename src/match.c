@@ -6,8 +6,8 @@
  *
  * A "match" is a data structure which acts like a mask or expression to match
  * certain windows or not. For example, when using commands, you can specify a
- * command like this: [title="*Firefox*"] kill. The title member of the match
- * data structure will then be filled and i3 will check each window using
+ * command like this: [title="*Firefox*"] kill. A CRIT_TITLE criterion will then
+ * be added to the match and i3 will check each window using
  * match_matches_window() to find the windows affected by this command.
  *
  */
@@ -18,247 +18,340 @@
     (((a).tv_sec == (b).tv_sec) ? ((a).tv_usec CMP(b).tv_usec) : ((a).tv_sec CMP(b).tv_sec))
 
 /*
- * Initializes the Match data structure. This function is necessary because the
- * members representing boolean values (like dock) need to be initialized with
- * -1 instead of 0.
+ * Initializes the Match data structure, which then contains no criteria.
  *
  */
 void match_init(Match *match) {
     memset(match, 0, sizeof(Match));
-    match->urgent = U_DONTCHECK;
-    match->window_mode = WM_ANY;
-    /* we use this as the placeholder value for "not set". */
-    match->window_type = UINT32_MAX;
 }
 
 /*
- * Check if a match is empty. This is necessary while parsing commands to see
- * whether the user specified a match at all.
+ * Returns the criterion of the given type, or NULL if the match does not
+ * contain one.
  *
  */
-bool match_is_empty(Match *match) {
-    /* we cannot simply use memcmp() because the structure is part of a
-     * TAILQ and I don’t want to start with things like assuming that the
-     * last member of a struct really is at the end in memory… */
-    return (match->title == NULL &&
-            match->mark == NULL &&
-            match->application == NULL &&
-            match->class == NULL &&
-            match->instance == NULL &&
-            match->window_role == NULL &&
-            match->workspace == NULL &&
-            match->machine == NULL &&
-            match->urgent == U_DONTCHECK &&
-            match->id == XCB_NONE &&
-            match->window_type == UINT32_MAX &&
-            match->con_id == NULL &&
-            match->dock == M_NODOCK &&
-            match->window_mode == WM_ANY &&
-            match->match_all_windows == false);
+struct match_criterion *match_get(Match *match, criterion_t type) {
+    for (int i = 0; i < match->num_criteria; i++) {
+        if (match->criteria[i].type == type) {
+            return &(match->criteria[i]);
+        }
+        if (match->criteria[i].type > type) {
+            break;
+        }
+    }
+    return NULL;
 }
 
 /*
- * Copies the data of a match from src to dest.
+ * Returns the regular expression of the given string criterion, or NULL if
+ * the match does not contain one.
  *
  */
-void match_copy(Match *dest, Match *src) {
-    memcpy(dest, src, sizeof(Match));
+struct regex *match_get_regex(Match *match, criterion_t type) {
+    struct match_criterion *criterion = match_get(match, type);
+    return (criterion != NULL ? criterion->regex : NULL);
+}
 
-/* The DUPLICATE_REGEX macro creates a new regular expression from the
- * ->pattern of the old one. It therefore does use a little more memory then
- *  with a refcounting system, but it’s easier this way. */
-#define DUPLICATE_REGEX(field)                            \
-    do {                                                  \
-        if (src->field != NULL)                           \
-            dest->field = regex_new(src->field->pattern); \
-    } while (0)
-
-    DUPLICATE_REGEX(title);
-    DUPLICATE_REGEX(mark);
-    DUPLICATE_REGEX(application);
-    DUPLICATE_REGEX(class);
-    DUPLICATE_REGEX(instance);
-    DUPLICATE_REGEX(window_role);
-    DUPLICATE_REGEX(workspace);
+static bool criterion_has_regex(criterion_t type) {
+    switch (type) {
+        case CRIT_CLASS:
+        case CRIT_INSTANCE:
+        case CRIT_WINDOW_ROLE:
+        case CRIT_MACHINE:
+        case CRIT_TITLE:
+        case CRIT_WORKSPACE:
+        case CRIT_MARK:
+            return true;
+        default:
+            return false;
+    }
 }
 
 /*
- * Check if a match data structure matches the given window.
+ * Adds a criterion of the given type to the match, replacing the existing one
+ * (and freeing its regular expression). Returns it, so that the caller can
+ * fill in the value.
  *
  */
-bool match_matches_window(Match *match, i3Window *window) {
-    LOG("Checking window 0x%08x (class %s)\n", window->id, window->class_class);
+struct match_criterion *match_set(Match *match, criterion_t type) {
+    int pos = 0;
+    while (pos < match->num_criteria && match->criteria[pos].type < type) {
+        pos++;
+    }
 
-#define GET_FIELD_str(field) (field)
-#define GET_FIELD_i3string(field) (i3string_as_utf8(field))
-#define CHECK_WINDOW_FIELD(match_field, window_field, type)                                       \
-    do {                                                                                          \
-        if (match->match_field != NULL) {                                                         \
-            const char *window_field_str = window->window_field == NULL                           \
-                                               ? ""                                               \
-                                               : GET_FIELD_##type(window->window_field);          \
-            if (strcmp(match->match_field->pattern, "__focused__") == 0 &&                        \
-                focused && focused->window && focused->window->window_field &&                    \
-                strcmp(window_field_str, GET_FIELD_##type(focused->window->window_field)) == 0) { \
-                LOG("window " #match_field " matches focused window\n");                          \
-            } else if (regex_matches(match->match_field, window_field_str)) {                     \
-                LOG("window " #match_field " matches (%s)\n", window_field_str);                  \
-            } else {                                                                              \
-                return false;                                                                     \
-            }                                                                                     \
-        }                                                                                         \
-    } while (0)
-
-    CHECK_WINDOW_FIELD(class, class_class, str);
-    CHECK_WINDOW_FIELD(instance, class_instance, str);
-
-    if (match->id != XCB_NONE) {
-        if (window->id == match->id) {
-            LOG("match made by window id (%d)\n", window->id);
-        } else {
-            LOG("window id does not match\n");
-            return false;
+    struct match_criterion *criterion;
+    if (pos < match->num_criteria && match->criteria[pos].type == type) {
+        criterion = &(match->criteria[pos]);
+        if (criterion_has_regex(type)) {
+            regex_free(criterion->regex);
         }
+    } else {
+        /* Matches have a handful of criteria at most, so the array grows one
+         * element at a time. */
+        match->criteria = srealloc(match->criteria, (match->num_criteria + 1) * sizeof(struct match_criterion));
+        memmove(&(match->criteria[pos + 1]), &(match->criteria[pos]),
+                (match->num_criteria - pos) * sizeof(struct match_criterion));
+        match->num_criteria++;
+        criterion = &(match->criteria[pos]);
     }
 
-    CHECK_WINDOW_FIELD(title, name, i3string);
-    CHECK_WINDOW_FIELD(window_role, role, str);
+    memset(criterion, 0, sizeof(struct match_criterion));
+    criterion->type = type;
+    return criterion;
+}
 
-    if (match->window_type != UINT32_MAX) {
-        if (window->window_type == match->window_type) {
-            LOG("window_type matches (%i)\n", match->window_type);
-        } else {
-            return false;
+/*
+ * Adds (or replaces) a string criterion of the given type.
+ *
+ */
+void match_set_regex(Match *match, criterion_t type, const char *pattern) {
+    assert(criterion_has_regex(type));
+    match_set(match, type)->regex = regex_new(pattern);
+}
+
+/*
+ * Returns the window properties (WP_*) the given match depends on, that is
+ * whose changes can change whether a window matches.
+ *
+ */
+uint32_t match_dependencies(Match *match) {
+    uint32_t depends_on = 0;
+
+    for (int i = 0; i < match->num_criteria; i++) {
+        struct match_criterion *criterion = &(match->criteria[i]);
+        switch (criterion->type) {
+            case CRIT_CLASS:
+            case CRIT_INSTANCE:
+                depends_on |= WP_CLASS;
+                break;
+            case CRIT_TITLE:
+                depends_on |= WP_TITLE;
+                break;
+            case CRIT_WINDOW_ROLE:
+                depends_on |= WP_ROLE;
+                break;
+            case CRIT_MACHINE:
+                depends_on |= WP_MACHINE;
+                break;
+            case CRIT_WINDOW_TYPE:
+                depends_on |= WP_WINDOW_TYPE;
+                break;
+            case CRIT_WINDOW_MODE:
+                depends_on |= WP_FLOATING;
+                break;
+            case CRIT_URGENT:
+            case CRIT_WORKSPACE:
+            case CRIT_MARK:
+                depends_on |= WP_OTHER;
+                break;
+            case CRIT_ID:
+            case CRIT_CON_ID:
+                /* The id and con_id of a window do not change. */
+                break;
+        }
+
+        /* Whether it matches depends on the focused window, too. */
+        if (criterion_has_regex(criterion->type) &&
+            strcmp(criterion->regex->pattern, "__focused__") == 0) {
+            depends_on |= WP_OTHER;
         }
     }
+    /* The dock status of a window does not change. */
+    return depends_on;
+}
 
-    CHECK_WINDOW_FIELD(machine, machine, str);
+/*
+ * Check if a match is empty. This is necessary while parsing commands to see
+ * whether the user specified a match at all.
+ *
+ */
+bool match_is_empty(Match *match) {
+    return (match->num_criteria == 0 &&
+            match->dock == M_NODOCK &&
+            match->match_all_windows == false);
+}
 
-    Con *con = NULL;
-    if (match->urgent == U_LATEST) {
-        /* if the window isn't urgent, no sense in searching */
-        if (window->urgent.tv_sec == 0) {
-            return false;
-        }
-        /* if we find a window that is newer than this one, bail */
-        TAILQ_FOREACH (con, &all_cons, all_cons) {
-            if ((con->window != NULL) &&
-                _i3_timercmp(con->window->urgent, window->urgent, >)) {
-                return false;
-            }
-        }
-        LOG("urgent matches latest\n");
+/*
+ * Copies the data of a match from src to dest.
+ *
+ */
+void match_copy(Match *dest, Match *src) {
+    memcpy(dest, src, sizeof(Match));
+    dest->swallow_con = NULL;
+    dest->swallow_bucket = NULL;
+
+    if (src->num_criteria > 0) {
+        dest->criteria = smalloc(src->num_criteria * sizeof(struct match_criterion));
+        memcpy(dest->criteria, src->criteria, src->num_criteria * sizeof(struct match_criterion));
     }
 
-    if (match->urgent == U_OLDEST) {
-        /* if the window isn't urgent, no sense in searching */
-        if (window->urgent.tv_sec == 0) {
-            return false;
+    /* Take another reference to the compiled regular expressions of the old
+     * match, so that both can be freed independently. */
+    for (int i = 0; i < dest->num_criteria; i++) {
+        if (criterion_has_regex(dest->criteria[i].type)) {
+            dest->criteria[i].regex = regex_ref(dest->criteria[i].regex);
         }
-        /* if we find a window that is older than this one (and not 0), bail */
-        TAILQ_FOREACH (con, &all_cons, all_cons) {
-            if ((con->window != NULL) &&
-                (con->window->urgent.tv_sec != 0) &&
-                _i3_timercmp(con->window->urgent, window->urgent, <)) {
-                return false;
-            }
+    }
+}
+
+/*
+ * Checks a string criterion against the given window property. The class,
+ * instance, role and machine are interned (see intern_string()), so they can
+ * be compared by pointer and their regex results are cached.
+ *
+ */
+static bool property_matches(struct regex *regex, const char *value, const char *focused_value, bool interned) {
+    if (strcmp(regex->pattern, "__focused__") == 0 && focused_value != NULL) {
+        const bool equal = (interned ? (value == focused_value || (value == NULL && focused_value[0] == '\0'))
+                                     : strcmp((value == NULL ? "" : value), focused_value) == 0);
+        if (equal) {
+            return true;
         }
-        LOG("urgent matches oldest\n");
     }
+    if (interned) {
+        return regex_matches_interned(regex, value);
+    }
+    return regex_matches(regex, (value == NULL ? "" : value));
+}
 
-    if (match->workspace != NULL) {
-        if ((con = con_by_window_id(window->id)) == NULL)
-            return false;
+static bool window_mode_matches(match_window_mode_t window_mode, Con *con) {
+    switch (window_mode) {
+        case WM_TILING_AUTO:
+            return (con->floating == FLOATING_AUTO_OFF);
+        case WM_TILING_USER:
+            return (con->floating == FLOATING_USER_OFF);
+        case WM_TILING:
+            return (con_inside_floating(con) == NULL);
+        case WM_FLOATING_AUTO:
+            return (con->floating == FLOATING_AUTO_ON);
+        case WM_FLOATING_USER:
+            return (con->floating == FLOATING_USER_ON);
+        case WM_FLOATING:
+            return (con_inside_floating(con) != NULL);
+    }
+    return false;
+}
 
-        Con *ws = con_get_workspace(con);
-        if (ws == NULL)
-            return false;
+static bool urgent_matches(match_urgent_t urgent, i3Window *window) {
+    /* if the window isn't urgent, no sense in searching */
+    if (window->urgent.tv_sec == 0) {
+        return false;
+    }
 
-        if (strcmp(match->workspace->pattern, "__focused__") == 0 &&
-            strcmp(ws->name, con_get_workspace(focused)->name) == 0) {
-            LOG("workspace matches focused workspace\n");
-        } else if (regex_matches(match->workspace, ws->name)) {
-            LOG("workspace matches (%s)\n", ws->name);
-        } else {
+    Con *con;
+    TAILQ_FOREACH (con, &all_cons, all_cons) {
+        if (con->window == NULL) {
+            continue;
+        }
+        /* if we find a window that is newer (older) than this one, bail */
+        if (urgent == U_LATEST && _i3_timercmp(con->window->urgent, window->urgent, >)) {
             return false;
         }
-    }
-
-    if (match->dock != M_DONTCHECK) {
-        if ((window->dock == W_DOCK_TOP && match->dock == M_DOCK_TOP) ||
-            (window->dock == W_DOCK_BOTTOM && match->dock == M_DOCK_BOTTOM) ||
-            ((window->dock == W_DOCK_TOP || window->dock == W_DOCK_BOTTOM) &&
-             match->dock == M_DOCK_ANY) ||
-            (window->dock == W_NODOCK && match->dock == M_NODOCK)) {
-            LOG("dock status matches\n");
-        } else {
-            LOG("dock status does not match\n");
+        if (urgent == U_OLDEST && con->window->urgent.tv_sec != 0 &&
+            _i3_timercmp(con->window->urgent, window->urgent, <)) {
             return false;
         }
     }
+    return true;
+}
 
-    if (match->mark != NULL) {
-        if ((con = con_by_window_id(window->id)) == NULL)
-            return false;
+static bool dock_matches(Match *match, i3Window *window) {
+    switch (match->dock) {
+        case M_DONTCHECK:
+            return true;
+        case M_NODOCK:
+            return (window->dock == W_NODOCK);
+        case M_DOCK_ANY:
+            return (window->dock == W_DOCK_TOP || window->dock == W_DOCK_BOTTOM);
+        case M_DOCK_TOP:
+            return (window->dock == W_DOCK_TOP);
+        case M_DOCK_BOTTOM:
+            return (window->dock == W_DOCK_BOTTOM);
+    }
+    return false;
+}
 
-        bool matched = false;
-        mark_t *mark;
-        TAILQ_FOREACH (mark, &(con->marks_head), marks) {
-            if (regex_matches(match->mark, mark->name)) {
-                matched = true;
-                break;
-            }
-        }
+/*
+ * Check if a match data structure matches the given window.
+ *
+ */
+bool match_matches_window(Match *match, i3Window *window) {
+    LOG("Checking window 0x%08x (class %s)\n", window->id, window->class_class);
 
-        if (matched) {
-            LOG("mark matches\n");
-        } else {
-            LOG("mark does not match\n");
-            return false;
-        }
+    if (!dock_matches(match, window)) {
+        LOG("dock status does not match\n");
+        return false;
     }
 
-    if (match->window_mode != WM_ANY) {
-        if ((con = con_by_window_id(window->id)) == NULL) {
-            return false;
-        }
-
-        switch (match->window_mode) {
-            case WM_TILING_AUTO:
-                if (con->floating != FLOATING_AUTO_OFF) {
-                    return false;
-                }
+    i3Window *focused_window = (focused != NULL ? focused->window : NULL);
+    /* Looked up on demand by the criteria which need the container. */
+    Con *con = NULL;
+    for (int i = 0; i < match->num_criteria; i++) {
+        struct match_criterion *criterion = &(match->criteria[i]);
+        bool matches = true;
+        switch (criterion->type) {
+            case CRIT_ID:
+                matches = (window->id == criterion->id);
                 break;
-            case WM_TILING_USER:
-                if (con->floating != FLOATING_USER_OFF) {
-                    return false;
-                }
+            case CRIT_CON_ID:
+                /* Checked by cmd_criteria_match_windows(). */
                 break;
-            case WM_TILING:
-                if (con_inside_floating(con) != NULL) {
-                    return false;
-                }
+            case CRIT_WINDOW_TYPE:
+                matches = (window->window_type == criterion->window_type);
                 break;
-            case WM_FLOATING_AUTO:
-                if (con->floating != FLOATING_AUTO_ON) {
-                    return false;
-                }
+            case CRIT_CLASS:
+                matches = property_matches(criterion->regex, window->class_class,
+                                           (focused_window ? focused_window->class_class : NULL), true);
                 break;
-            case WM_FLOATING_USER:
-                if (con->floating != FLOATING_USER_ON) {
-                    return false;
-                }
+            case CRIT_INSTANCE:
+                matches = property_matches(criterion->regex, window->class_instance,
+                                           (focused_window ? focused_window->class_instance : NULL), true);
+                break;
+            case CRIT_WINDOW_ROLE:
+                matches = property_matches(criterion->regex, window->role,
+                                           (focused_window ? focused_window->role : NULL), true);
+                break;
+            case CRIT_MACHINE:
+                matches = property_matches(criterion->regex, window->machine,
+                                           (focused_window ? focused_window->machine : NULL), true);
                 break;
-            case WM_FLOATING:
-                if (con_inside_floating(con) == NULL) {
-                    return false;
+            case CRIT_TITLE:
+                matches = property_matches(criterion->regex, (window->name ? i3string_as_utf8(window->name) : NULL),
+                                           (focused_window && focused_window->name ? i3string_as_utf8(focused_window->name) : NULL), false);
+                break;
+            case CRIT_WINDOW_MODE:
+                matches = ((con != NULL || (con = con_by_window_id(window->id)) != NULL) &&
+                           window_mode_matches(criterion->window_mode, con));
+                break;
+            case CRIT_WORKSPACE: {
+                if (con == NULL && (con = con_by_window_id(window->id)) == NULL) {
+                    matches = false;
+                    break;
+                }
+                Con *ws = con_get_workspace(con);
+                if (ws == NULL) {
+                    matches = false;
+                } else if (strcmp(criterion->regex->pattern, "__focused__") == 0) {
+                    matches = (strcmp(ws->name, con_get_workspace(focused)->name) == 0 ||
+                               regex_matches(criterion->regex, ws->name));
+                } else {
+                    matches = regex_matches(criterion->regex, ws->name);
                 }
                 break;
-            case WM_ANY:
-                assert(false);
+            }
+            case CRIT_MARK:
+                matches = ((con != NULL || (con = con_by_window_id(window->id)) != NULL) &&
+                           con_has_mark_matching(con, criterion->regex));
+                break;
+            case CRIT_URGENT:
+                matches = urgent_matches(criterion->urgent, window);
+                break;
         }
 
-        LOG("window_mode matches\n");
+        if (!matches) {
+            LOG("criterion %d does not match\n", criterion->type);
+            return false;
+        }
     }
 
     /* NOTE: See the comment regarding 'all' in match_parse_property()
@@ -274,14 +367,13 @@ bool match_matches_window(Match *match, i3Window *window) {
  */
 void match_free(Match *match) {
     FREE(match->error);
-    regex_free(match->title);
-    regex_free(match->application);
-    regex_free(match->class);
-    regex_free(match->instance);
-    regex_free(match->mark);
-    regex_free(match->window_role);
-    regex_free(match->workspace);
-    regex_free(match->machine);
+    for (int i = 0; i < match->num_criteria; i++) {
+        if (criterion_has_regex(match->criteria[i].type)) {
+            regex_free(match->criteria[i].regex);
+        }
+    }
+    FREE(match->criteria);
+    match->num_criteria = 0;
 }
 
 /*
@@ -293,26 +385,23 @@ void match_parse_property(Match *match, const char *ctype, const char *cvalue) {
     DLOG("ctype=*%s*, cvalue=*%s*\n", ctype, cvalue);
 
     if (strcmp(ctype, "class") == 0) {
-        regex_free(match->class);
-        match->class = regex_new(cvalue);
+        match_set_regex(match, CRIT_CLASS, cvalue);
         return;
     }
 
     if (strcmp(ctype, "instance") == 0) {
-        regex_free(match->instance);
-        match->instance = regex_new(cvalue);
+        match_set_regex(match, CRIT_INSTANCE, cvalue);
         return;
     }
 
     if (strcmp(ctype, "window_role") == 0) {
-        regex_free(match->window_role);
-        match->window_role = regex_new(cvalue);
+        match_set_regex(match, CRIT_WINDOW_ROLE, cvalue);
         return;
     }
 
     if (strcmp(ctype, "con_id") == 0) {
         if (strcmp(cvalue, "__focused__") == 0) {
-            match->con_id = focused;
+            match_set(match, CRIT_CON_ID)->con_id = focused;
             return;
         }
 
@@ -321,8 +410,8 @@ void match_parse_property(Match *match, const char *ctype, const char *cvalue) {
             ELOG("Could not parse con id \"%s\"\n", cvalue);
             match->error = sstrdup("invalid con_id");
         } else {
-            match->con_id = (Con *)parsed;
-            DLOG("id as int = %p\n", match->con_id);
+            match_set(match, CRIT_CON_ID)->con_id = (Con *)parsed;
+            DLOG("id as int = %p\n", (Con *)parsed);
         }
         return;
     }
@@ -333,50 +422,51 @@ void match_parse_property(Match *match, const char *ctype, const char *cvalue) {
             ELOG("Could not parse window id \"%s\"\n", cvalue);
             match->error = sstrdup("invalid id");
         } else {
-            match->id = parsed;
-            DLOG("window id as int = %d\n", match->id);
+            match_set(match, CRIT_ID)->id = parsed;
+            DLOG("window id as int = %ld\n", parsed);
         }
         return;
     }
 
     if (strcmp(ctype, "window_type") == 0) {
+        xcb_atom_t type;
         if (strcasecmp(cvalue, "normal") == 0) {
-            match->window_type = A__NET_WM_WINDOW_TYPE_NORMAL;
+            type = A__NET_WM_WINDOW_TYPE_NORMAL;
         } else if (strcasecmp(cvalue, "dialog") == 0) {
-            match->window_type = A__NET_WM_WINDOW_TYPE_DIALOG;
+            type = A__NET_WM_WINDOW_TYPE_DIALOG;
         } else if (strcasecmp(cvalue, "utility") == 0) {
-            match->window_type = A__NET_WM_WINDOW_TYPE_UTILITY;
+            type = A__NET_WM_WINDOW_TYPE_UTILITY;
         } else if (strcasecmp(cvalue, "toolbar") == 0) {
-            match->window_type = A__NET_WM_WINDOW_TYPE_TOOLBAR;
+            type = A__NET_WM_WINDOW_TYPE_TOOLBAR;
         } else if (strcasecmp(cvalue, "splash") == 0) {
-            match->window_type = A__NET_WM_WINDOW_TYPE_SPLASH;
+            type = A__NET_WM_WINDOW_TYPE_SPLASH;
         } else if (strcasecmp(cvalue, "menu") == 0) {
-            match->window_type = A__NET_WM_WINDOW_TYPE_MENU;
+            type = A__NET_WM_WINDOW_TYPE_MENU;
         } else if (strcasecmp(cvalue, "dropdown_menu") == 0) {
-            match->window_type = A__NET_WM_WINDOW_TYPE_DROPDOWN_MENU;
+            type = A__NET_WM_WINDOW_TYPE_DROPDOWN_MENU;
         } else if (strcasecmp(cvalue, "popup_menu") == 0) {
-            match->window_type = A__NET_WM_WINDOW_TYPE_POPUP_MENU;
+            type = A__NET_WM_WINDOW_TYPE_POPUP_MENU;
         } else if (strcasecmp(cvalue, "tooltip") == 0) {
-            match->window_type = A__NET_WM_WINDOW_TYPE_TOOLTIP;
+            type = A__NET_WM_WINDOW_TYPE_TOOLTIP;
         } else if (strcasecmp(cvalue, "notification") == 0) {
-            match->window_type = A__NET_WM_WINDOW_TYPE_NOTIFICATION;
+            type = A__NET_WM_WINDOW_TYPE_NOTIFICATION;
         } else {
             ELOG("unknown window_type value \"%s\"\n", cvalue);
             match->error = sstrdup("unknown window_type value");
+            return;
         }
 
+        match_set(match, CRIT_WINDOW_TYPE)->window_type = type;
         return;
     }
 
     if (strcmp(ctype, "con_mark") == 0) {
-        regex_free(match->mark);
-        match->mark = regex_new(cvalue);
+        match_set_regex(match, CRIT_MARK, cvalue);
         return;
     }
 
     if (strcmp(ctype, "title") == 0) {
-        regex_free(match->title);
-        match->title = regex_new(cvalue);
+        match_set_regex(match, CRIT_TITLE, cvalue);
         return;
     }
 
@@ -385,61 +475,59 @@ void match_parse_property(Match *match, const char *ctype, const char *cvalue) {
             strcasecmp(cvalue, "newest") == 0 ||
             strcasecmp(cvalue, "recent") == 0 ||
             strcasecmp(cvalue, "last") == 0) {
-            match->urgent = U_LATEST;
+            match_set(match, CRIT_URGENT)->urgent = U_LATEST;
         } else if (strcasecmp(cvalue, "oldest") == 0 ||
                    strcasecmp(cvalue, "first") == 0) {
-            match->urgent = U_OLDEST;
+            match_set(match, CRIT_URGENT)->urgent = U_OLDEST;
         }
         return;
     }
 
     if (strcmp(ctype, "workspace") == 0) {
-        regex_free(match->workspace);
-        match->workspace = regex_new(cvalue);
+        match_set_regex(match, CRIT_WORKSPACE, cvalue);
         return;
     }
 
     if (strcmp(ctype, "machine") == 0) {
-        regex_free(match->machine);
-        match->machine = regex_new(cvalue);
+        match_set_regex(match, CRIT_MACHINE, cvalue);
         return;
     }
 
     if (strcmp(ctype, "tiling") == 0) {
-        match->window_mode = WM_TILING;
+        match_set(match, CRIT_WINDOW_MODE)->window_mode = WM_TILING;
         return;
     }
 
     if (strcmp(ctype, "tiling_from") == 0 &&
         cvalue != NULL &&
         strcmp(cvalue, "auto") == 0) {
-        match->window_mode = WM_TILING_AUTO;
+        match_set(match, CRIT_WINDOW_MODE)->window_mode = WM_TILING_AUTO;
         return;
     }
 
     if (strcmp(ctype, "tiling_from") == 0 &&
         cvalue != NULL &&
         strcmp(cvalue, "user") == 0) {
-        match->window_mode = WM_TILING_USER;
+        match_set(match, CRIT_WINDOW_MODE)->window_mode = WM_TILING_USER;
         return;
     }
 
     if (strcmp(ctype, "floating") == 0) {
-        match->window_mode = WM_FLOATING;
+        match_set(match, CRIT_WINDOW_MODE)->window_mode = WM_FLOATING;
         return;
     }
 
     if (strcmp(ctype, "floating_from") == 0 &&
         cvalue != NULL &&
         strcmp(cvalue, "auto") == 0) {
-        match->window_mode = WM_FLOATING_AUTO;
+        match_set(match, CRIT_WINDOW_MODE)->window_mode = WM_FLOATING_AUTO;
         return;
     }
 
     if (strcmp(ctype, "floating_from") == 0 &&
         cvalue != NULL &&
         strcmp(cvalue, "user") == 0) {
-        match->window_mode = WM_FLOATING_USER;
+        match_set(match, CRIT_WINDOW_MODE)->window_mode = WM_FLOATING_USER;
         return;
     }
 
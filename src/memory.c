@@ -0,0 +1,288 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * memory.c: Accounting of i3's memory by category, reported via the
+ *           GET_MEMORY IPC message.
+ *
+ */
+#include "all.h"
+#include "yajl_utils.h"
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+mem_counter_t memory_counters[NUM_MEMORY_COUNTERS];
+
+/* The number of memory_trim_later() calls after which the heap is trimmed. */
+#define MEMORY_TRIM_RELEASES 32
+
+static int releases = 0;
+
+static bool memory_trim(maintenance_task *task);
+static maintenance_task trim_task = MAINTENANCE_TASK_INITIALIZER("malloc_trim", memory_trim);
+
+static bool memory_trim(maintenance_task *task) {
+#if defined(__GLIBC__)
+    if (malloc_trim(0)) {
+        DLOG("Returned free memory to the system\n");
+    }
+#endif
+    return false;
+}
+
+/*
+ * Notes that a window (or something of similar size) was freed. After many
+ * of them, the free memory at the end of the heap is returned to the system
+ * once i3 is idle (with glibc).
+ *
+ */
+void memory_trim_later(void) {
+    if (++releases < MEMORY_TRIM_RELEASES) {
+        return;
+    }
+    releases = 0;
+    maintenance_schedule(&trim_task);
+}
+
+/* Totals of the objects reachable from the layout tree */
+struct tree_memory {
+    uint64_t cons;
+    uint64_t con_bytes;
+    uint64_t marks;
+    uint64_t windows;
+    uint64_t window_bytes;
+    uint64_t decorations;
+    uint64_t frame_bytes;
+    uint64_t title_cache_bytes;
+};
+
+static uint64_t string_size(const char *str) {
+    return (str != NULL ? strlen(str) + 1 : 0);
+}
+
+/*
+ * Pixmaps live in the X server, but are created (and kept alive) by i3.
+ *
+ */
+static uint64_t surface_memory(const surface_t *surface, struct tree_memory *total) {
+    if (surface->id == XCB_NONE) {
+        return 0;
+    }
+    total->decorations++;
+    return (uint64_t)surface->width * surface->height * 4;
+}
+
+static void tree_memory(Con *con, struct tree_memory *total) {
+    total->cons++;
+    total->con_bytes += sizeof(Con) + sizeof(struct con_cold);
+    total->con_bytes += string_size(con->name) +
+                        string_size(con->cold->title_format) +
+                        string_size(con->cold->sticky_group) +
+                        string_size(con->deco_cache_key) +
+                        string_size(con->tree_representation);
+    for (int property = 0; property < WINDOW_PROPERTY_MAX; property++) {
+        total->con_bytes += string_size(con->window_property_keys[property]);
+    }
+    if (con->cold->deco_render_params != NULL) {
+        total->con_bytes += sizeof(struct deco_render_params);
+    }
+
+    mark_t *mark;
+    TAILQ_FOREACH (mark, &(con->cold->marks_head), marks) {
+        total->marks++;
+        total->con_bytes += sizeof(mark_t) + string_size(mark->name);
+    }
+
+    if (con->window != NULL) {
+        total->windows++;
+        total->window_bytes += sizeof(i3Window);
+        if (con->window->name != NULL) {
+            total->window_bytes += i3string_get_num_bytes(con->window->name) + 1;
+        }
+    }
+
+    total->frame_bytes += surface_memory(&(con->frame_buffer), total);
+    total->title_cache_bytes += surface_memory(&(con->deco_cache), total);
+
+    Con *child;
+    TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
+        tree_memory(child, total);
+    }
+    TAILQ_FOREACH (child, &(con->floating_head), floating_windows) {
+        tree_memory(child, total);
+    }
+}
+
+static void dump_category(yajl_gen gen, const char *name, uint64_t count, uint64_t bytes) {
+    ystr(name);
+    y(map_open);
+    ystr("count");
+    y(integer, count);
+    ystr("bytes");
+    y(integer, bytes);
+    y(map_close);
+}
+
+static void dump_config(yajl_gen gen) {
+    uint64_t bindings = 0;
+    uint64_t bytes = sizeof(Config);
+
+    struct Mode *mode;
+    SLIST_FOREACH (mode, &modes, modes) {
+        bytes += sizeof(struct Mode) + string_size(mode->name);
+        Binding *bind;
+        TAILQ_FOREACH (bind, mode->bindings, bindings) {
+            bindings++;
+            bytes += sizeof(Binding) + string_size(bind->symbol) + string_size(bind->command);
+            struct Binding_Keycode *keycode;
+            TAILQ_FOREACH (keycode, &(bind->keycodes_head), keycodes) {
+                bytes += sizeof(struct Binding_Keycode);
+            }
+        }
+    }
+
+    uint64_t num_assignments = 0;
+    Assignment *assignment;
+    TAILQ_FOREACH (assignment, &assignments, assignments) {
+        num_assignments++;
+        /* All destinations are strings. */
+        bytes += sizeof(Assignment) + string_size(assignment->dest.command);
+    }
+
+    struct Workspace_Assignment *ws_assignment;
+    TAILQ_FOREACH (ws_assignment, &ws_assignments, ws_assignments) {
+        bytes += sizeof(struct Workspace_Assignment) + string_size(ws_assignment->name) + string_size(ws_assignment->output);
+    }
+
+    uint64_t bars = 0;
+    Barconfig *barconfig;
+    TAILQ_FOREACH (barconfig, &barconfigs, configs) {
+        bars++;
+        bytes += sizeof(Barconfig);
+    }
+
+    /* The contents of the configuration files are kept for GET_CONFIG. */
+    IncludedFile *file;
+    TAILQ_FOREACH (file, &included_files, files) {
+        bytes += sizeof(IncludedFile) + string_size(file->path) +
+                 string_size(file->raw_contents) + string_size(file->variable_replaced_contents);
+    }
+
+    ystr("config");
+    y(map_open);
+    ystr("bindings");
+    y(integer, bindings);
+    ystr("assignments");
+    y(integer, num_assignments);
+    ystr("bars");
+    y(integer, bars);
+    ystr("bytes");
+    y(integer, bytes);
+    y(map_close);
+}
+
+/*
+ * Generates the GET_MEMORY reply: a map with the number of objects and bytes
+ * per category.
+ *
+ */
+void memory_dump(yajl_gen gen) {
+    struct tree_memory tree = {0};
+    tree_memory(croot, &tree);
+
+    y(map_open);
+
+    ystr("cons");
+    y(map_open);
+    ystr("count");
+    y(integer, tree.cons);
+    ystr("marks");
+    y(integer, tree.marks);
+    ystr("bytes");
+    y(integer, tree.con_bytes);
+    y(map_close);
+
+    /* The interned properties are shared between windows. */
+    ystr("windows");
+    y(map_open);
+    ystr("count");
+    y(integer, tree.windows);
+    ystr("bytes");
+    y(integer, tree.window_bytes);
+    ystr("properties");
+    y(integer, memory_counters[MEM_PROPERTIES].allocations);
+    ystr("property_bytes");
+    y(integer, memory_counters[MEM_PROPERTIES].bytes);
+    y(map_close);
+
+    uint64_t icons, icon_surface_bytes, icon_pixmap_bytes;
+    window_icons_memory(&icons, &icon_surface_bytes, &icon_pixmap_bytes);
+    ystr("icons");
+    y(map_open);
+    ystr("count");
+    y(integer, icons);
+    ystr("bytes");
+    y(integer, memory_counters[MEM_ICONS].bytes);
+    ystr("surface_bytes");
+    y(integer, icon_surface_bytes);
+    ystr("pixmap_bytes");
+    y(integer, icon_pixmap_bytes);
+    y(map_close);
+
+    ystr("decorations");
+    y(map_open);
+    ystr("count");
+    y(integer, tree.decorations);
+    ystr("bytes");
+    y(integer, tree.frame_bytes + tree.title_cache_bytes);
+    ystr("frame_bytes");
+    y(integer, tree.frame_bytes);
+    ystr("title_cache_bytes");
+    y(integer, tree.title_cache_bytes);
+    y(map_close);
+
+    uint64_t clients, queued_bytes;
+    ipc_clients_memory(&clients, &queued_bytes);
+    ystr("ipc");
+    y(map_open);
+    ystr("clients");
+    y(integer, clients);
+    ystr("messages");
+    y(integer, memory_counters[MEM_IPC].allocations);
+    ystr("bytes");
+    y(integer, memory_counters[MEM_IPC].bytes);
+    ystr("queued_bytes");
+    y(integer, queued_bytes);
+    y(map_close);
+
+    dump_category(gen, "regexes", regex_count(), memory_counters[MEM_REGEX].bytes);
+
+    ystr("shmlog");
+    y(map_open);
+    ystr("bytes");
+    y(integer, log_buffer_size());
+    y(map_close);
+
+    dump_config(gen);
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    /* Free memory within the heap which is not returned to the system is
+     * fragmentation (or waiting for the next malloc_trim()). */
+    const struct mallinfo2 info = mallinfo2();
+    ystr("heap");
+    y(map_open);
+    ystr("bytes");
+    y(integer, info.arena + info.hblkhd);
+    ystr("in_use");
+    y(integer, info.uordblks + info.hblkhd);
+    ystr("free");
+    y(integer, info.fordblks);
+    y(map_close);
+#endif
+
+    y(map_close);
+}
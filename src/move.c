@@ -113,6 +113,7 @@ void insert_con_into(Con *con, Con *target, position_t position) {
         } else {
             TAILQ_INSERT_HEAD(&(lca->focus_head), target_ancestor, focused);
         }
+        con_invalidate_lookups();
     }
 
     con_detach(con);
@@ -160,6 +161,8 @@ void insert_con_into(Con *con, Con *target, position_t position) {
     } else if (position == AFTER) {
         TAILQ_INSERT_AFTER(&(parent->nodes_head), target, con, nodes);
     }
+    con_invalidate_lookups();
+    con_invalidate_tree_representation(parent);
 
     /* Pretend the con was just opened with regards to size percent values.
      * Since the con is moved to a completely different con, the old value
@@ -187,6 +190,8 @@ static void attach_to_workspace(Con *con, Con *ws, direction_t direction) {
         TAILQ_INSERT_TAIL(&(ws->nodes_head), con, nodes);
     }
     TAILQ_INSERT_TAIL(&(ws->focus_head), con, focused);
+    con_invalidate_lookups();
+    con_invalidate_tree_representation(ws);
 
     /* Pretend the con was just opened with regards to size percent values.
      * Since the con is moved to a completely different con, the old value
@@ -198,6 +203,16 @@ static void attach_to_workspace(Con *con, Con *ws, direction_t direction) {
     CALL(old_parent, on_remove_child);
 }
 
+/*
+ * Returns true if con has exactly one tiling child. Unlike
+ * con_num_children(), this does not walk all children.
+ *
+ */
+static bool has_single_child(Con *con) {
+    Con *first = TAILQ_FIRST(&(con->nodes_head));
+    return (first != NULL && TAILQ_NEXT(first, nodes) == NULL);
+}
+
 /*
  * Moves the given container to the closest output in the given direction if
  * such an output exists.
@@ -240,14 +255,15 @@ static void move_to_output_directed(Con *con, direction_t direction) {
          * See: #3518. */
         con_focus(con);
         focused = old_ws;
+        con_invalidate_lookups();
         workspace_show(ws);
     }
 
     /* force re-painting the indicators */
-    FREE(con->deco_render_params);
+    FREE(con->cold->deco_render_params);
 
     ipc_send_window_event("move", con);
-    tree_flatten(croot);
+    tree_flatten_candidates();
     ewmh_update_wm_desktop();
 }
 
@@ -274,7 +290,7 @@ void tree_move(Con *con, direction_t direction) {
     }
 
     if ((con->fullscreen_mode == CF_OUTPUT) ||
-        (con->parent->type == CT_WORKSPACE && con_num_children(con->parent) == 1)) {
+        (con->parent->type == CT_WORKSPACE && has_single_child(con->parent))) {
         /* This is the only con on this workspace */
         move_to_output_directed(con, direction);
         return;
@@ -329,6 +345,7 @@ void tree_move(Con *con, direction_t direction) {
                 } else {
                     TAILQ_SWAP(con, swap, &(swap->parent->nodes_head), nodes);
                 }
+                con_invalidate_tree_representation(con->parent);
 
                 ipc_send_window_event("move", con);
                 return;
@@ -376,7 +393,7 @@ void tree_move(Con *con, direction_t direction) {
     } else if (!next &&
                con->parent->parent->type == CT_WORKSPACE &&
                con->parent->layout != L_DEFAULT &&
-               con_num_children(con->parent) == 1) {
+               has_single_child(con->parent)) {
         /* Con is the lone child of a non-default layout container at the edge
          * of the workspace. Treat it as though the workspace is its parent
          * and move it to the next output. */
@@ -391,9 +408,9 @@ void tree_move(Con *con, direction_t direction) {
 
 end:
     /* force re-painting the indicators */
-    FREE(con->deco_render_params);
+    FREE(con->cold->deco_render_params);
 
     ipc_send_window_event("move", con);
-    tree_flatten(croot);
+    tree_flatten_candidates();
     ewmh_update_wm_desktop();
 }
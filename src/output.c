@@ -75,6 +75,30 @@ Output *get_output_for_con(Con *con) {
  *
  */
 void output_push_sticky_windows(Con *old_focus) {
+    /* Only the workspaces with sticky floating windows need to be looked at,
+     * which are usually none or very few. */
+    size_t num_sticky;
+    Con **sticky = con_sticky_cons(&num_sticky);
+    Con **sticky_workspaces = smalloc(max(1, num_sticky) * sizeof(Con *));
+    size_t num_workspaces = 0;
+    for (size_t i = 0; i < num_sticky; i++) {
+        Con *ws = con_get_workspace(sticky[i]);
+        if (ws == NULL || con_inside_floating(sticky[i]) == NULL || workspace_is_visible(ws)) {
+            continue;
+        }
+        bool known = false;
+        for (size_t j = 0; j < num_workspaces && !known; j++) {
+            known = (sticky_workspaces[j] == ws);
+        }
+        if (!known) {
+            sticky_workspaces[num_workspaces++] = ws;
+        }
+    }
+    if (num_workspaces == 0) {
+        free(sticky_workspaces);
+        return;
+    }
+
     Con *output;
     TAILQ_FOREACH (output, &(croot->focus_head), focused) {
         Con *workspace, *visible_ws = NULL;
@@ -88,6 +112,14 @@ void output_push_sticky_windows(Con *old_focus) {
             Con *current_ws = workspace;
             workspace = TAILQ_NEXT(workspace, focused);
 
+            bool has_sticky = false;
+            for (size_t i = 0; i < num_workspaces && !has_sticky; i++) {
+                has_sticky = (sticky_workspaces[i] == current_ws);
+            }
+            if (!has_sticky) {
+                continue;
+            }
+
             /* Since moving the windows actually removes them from the list of
              * floating windows on this workspace, here too we need to use
              * another loop than TAILQ_FOREACH. */
@@ -111,4 +143,5 @@ void output_push_sticky_windows(Con *old_focus) {
             }
         }
     }
+    free(sticky_workspaces);
 }
@@ -0,0 +1,235 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * pool.c: Type-specific pool allocator for frequently allocated objects
+ *         (containers, window states, windows, matches, marks) and the frame
+ *         arena for temporaries of a render pass.
+ *
+ */
+#include "all.h"
+#include "yajl_utils.h"
+
+#include <stdarg.h>
+
+#if defined(I3_POOL_ALLOCATOR) && !defined(I3_ASAN_ENABLED)
+#define USE_POOL_SLABS 1
+#endif
+
+/* Number of objects per slab. Slabs are never returned to the system, they
+ * are kept around for reuse. */
+#define OBJECTS_PER_SLAB 64
+
+/* Minimum size of a frame arena chunk. Big enough for the sizes arrays and
+ * title bar strings of a few hundred containers. */
+#define FRAME_CHUNK_SIZE (64 * 1024)
+
+pool_t con_pool = POOL_INITIALIZER("con", Con);
+pool_t con_cold_pool = POOL_INITIALIZER("con_cold", struct con_cold);
+pool_t window_pool = POOL_INITIALIZER("window", i3Window);
+pool_t match_pool = POOL_INITIALIZER("match", Match);
+pool_t mark_pool = POOL_INITIALIZER("mark", mark_t);
+
+static SLIST_HEAD(pools_head, pool) all_pools = SLIST_HEAD_INITIALIZER(all_pools);
+
+#ifdef USE_POOL_SLABS
+/* Objects (and slabs) need to be able to hold a pointer for the free list and
+ * must be suitably aligned for any of the pooled types. */
+static size_t pool_stride(pool_t *pool) {
+    const size_t align = sizeof(max_align_t);
+    size_t size = pool->object_size;
+    if (size < sizeof(void *)) {
+        size = sizeof(void *);
+    }
+    return (size + align - 1) / align * align;
+}
+
+static void pool_grow(pool_t *pool) {
+    const size_t stride = pool_stride(pool);
+    /* The first stride bytes of every slab link it into pool->slabs. */
+    char *slab = smalloc(stride * (OBJECTS_PER_SLAB + 1));
+    *(void **)slab = pool->slabs;
+    pool->slabs = slab;
+
+    for (int i = OBJECTS_PER_SLAB; i > 0; i--) {
+        void *object = slab + i * stride;
+        *(void **)object = pool->free_list;
+        pool->free_list = object;
+    }
+    pool->capacity += OBJECTS_PER_SLAB;
+}
+#endif
+
+/*
+ * Returns a zeroed object from the given pool. Never returns NULL.
+ *
+ */
+void *pool_alloc(pool_t *pool) {
+    if (!pool->registered) {
+        SLIST_INSERT_HEAD(&all_pools, pool, pools);
+        pool->registered = true;
+    }
+
+    pool->allocations++;
+    pool->live++;
+    if (pool->live > pool->peak) {
+        pool->peak = pool->live;
+    }
+
+#ifdef USE_POOL_SLABS
+    if (pool->free_list == NULL) {
+        pool_grow(pool);
+    }
+    void *object = pool->free_list;
+    pool->free_list = *(void **)object;
+    memset(object, 0, pool->object_size);
+    return object;
+#else
+    pool->capacity = pool->peak;
+    return scalloc(1, pool->object_size);
+#endif
+}
+
+/*
+ * Returns the object to its pool. ptr may be NULL.
+ *
+ */
+void pool_free(pool_t *pool, void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    assert(pool->live > 0);
+    pool->live--;
+
+#ifdef USE_POOL_SLABS
+    *(void **)ptr = pool->free_list;
+    pool->free_list = ptr;
+#else
+    free(ptr);
+#endif
+}
+
+/*
+ * Serializes the counters of all pools which have been used so far as a JSON
+ * array.
+ *
+ */
+void pool_dump_stats(yajl_gen gen) {
+    y(array_open);
+    pool_t *pool;
+    SLIST_FOREACH (pool, &all_pools, pools) {
+        y(map_open);
+        ystr("name");
+        ystr(pool->name);
+        ystr("object_size");
+        y(integer, pool->object_size);
+        ystr("live");
+        y(integer, pool->live);
+        ystr("peak");
+        y(integer, pool->peak);
+        ystr("capacity");
+        y(integer, pool->capacity);
+        ystr("allocations");
+        y(integer, pool->allocations);
+        y(map_close);
+    }
+    y(array_close);
+}
+
+#ifdef USE_POOL_SLABS
+/* The frame arena is a list of chunks which are filled from the front. Like
+ * slabs, chunks are kept for reuse when the arena is reset. */
+struct frame_chunk {
+    struct frame_chunk *next;
+    size_t size;
+    size_t used;
+    max_align_t data[];
+};
+
+static struct frame_chunk *frame_chunks;
+static struct frame_chunk *frame_current;
+
+/*
+ * Returns size bytes from the frame arena, suitably aligned for any type.
+ * Never returns NULL.
+ *
+ */
+void *frame_alloc(size_t size) {
+    const size_t align = sizeof(max_align_t);
+    size = (size + align - 1) / align * align;
+
+    while (frame_current != NULL && frame_current->size - frame_current->used < size) {
+        frame_current = frame_current->next;
+    }
+    if (frame_current == NULL) {
+        const size_t chunk_size = (size > FRAME_CHUNK_SIZE ? size : FRAME_CHUNK_SIZE);
+        struct frame_chunk *chunk = smalloc(sizeof(struct frame_chunk) + chunk_size);
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        chunk->next = frame_chunks;
+        frame_chunks = chunk;
+        frame_current = chunk;
+    }
+
+    void *ptr = (char *)frame_current->data + frame_current->used;
+    frame_current->used += size;
+    return ptr;
+}
+
+/*
+ * Releases everything allocated from the frame arena.
+ *
+ */
+void frame_reset(void) {
+    for (struct frame_chunk *chunk = frame_chunks; chunk != NULL; chunk = chunk->next) {
+        chunk->used = 0;
+    }
+    frame_current = frame_chunks;
+}
+#else
+/* Without slabs, every allocation is a separate malloc() which is freed on
+ * reset, so that AddressSanitizer catches uses after the reset. */
+static void **frame_allocations;
+static size_t frame_num_allocations;
+static size_t frame_capacity;
+
+void *frame_alloc(size_t size) {
+    if (frame_num_allocations == frame_capacity) {
+        frame_capacity = (frame_capacity == 0 ? 64 : frame_capacity * 2);
+        frame_allocations = srealloc(frame_allocations, frame_capacity * sizeof(void *));
+    }
+    void *ptr = smalloc(size > 0 ? size : 1);
+    frame_allocations[frame_num_allocations++] = ptr;
+    return ptr;
+}
+
+void frame_reset(void) {
+    for (size_t i = 0; i < frame_num_allocations; i++) {
+        free(frame_allocations[i]);
+    }
+    frame_num_allocations = 0;
+}
+#endif
+
+/*
+ * Like sasprintf(), but the string is allocated from the frame arena.
+ *
+ */
+char *frame_asprintf(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    const int len = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+    if (len < 0) {
+        err(EXIT_FAILURE, "vsnprintf(%s)", fmt);
+    }
+
+    char *result = frame_alloc(len + 1);
+    va_start(args, fmt);
+    vsnprintf(result, len + 1, fmt, args);
+    va_end(args);
+    return result;
+}
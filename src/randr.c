@@ -11,6 +11,7 @@
  */
 #include "all.h"
 
+#include <ctype.h>
 #include <time.h>
 
 #include <xcb/randr.h>
@@ -25,6 +26,33 @@ struct outputs_head outputs = TAILQ_HEAD_INITIALIZER(outputs);
 static Output *root_output;
 static bool has_randr_1_5 = false;
 
+/* The highest refresh rate (in Hz) of all active CRTCs, 0 if unknown. */
+static double max_refresh_rate = 0;
+
+/* A grid over the active outputs for get_output_containing(), which is called
+ * on every pointer motion crossing a window boundary. The grid lines are the
+ * sorted, distinct output edges and each cell stores the first active output
+ * (in list order) covering it, so lookups are two binary searches. It is
+ * rebuilt on the next lookup after randr_outputs_changed(). */
+static struct {
+    bool valid;
+    int num_x;
+    int num_y;
+    uint32_t *x;
+    uint32_t *y;
+    Output **cells;
+} output_grid;
+
+/* The outputs by their case-folded names for get_output_by_name(), with the
+ * primary output under "primary". Every name maps to the first output (in
+ * list order) which has it, and to the first active one. Both maps are rebuilt
+ * on the next lookup after randr_outputs_changed(). */
+static struct {
+    bool valid;
+    hashmap_t *all;
+    hashmap_t *active;
+} output_names;
+
 /*
  * Get a specific output by its internal X11 id. Used by randr_query_outputs
  * to check if the output is new (only in the first scan) or if we are
@@ -43,29 +71,65 @@ static Output *get_output_by_id(xcb_randr_output_t id) {
 }
 
 /*
- * Returns the output with the given name or NULL.
- * If require_active is true, only active outputs are considered.
+ * Returns a copy of the name with all characters lowercased, like
+ * strcasecmp() compares them.
  *
  */
-Output *get_output_by_name(const char *name, const bool require_active) {
+static char *fold_output_name(const char *name) {
+    char *folded = sstrdup(name);
+    for (char *walk = folded; *walk != '\0'; walk++) {
+        *walk = tolower((unsigned char)*walk);
+    }
+    return folded;
+}
+
+static void output_names_insert(const char *name, Output *output) {
+    char *key = fold_output_name(name);
+    if (hashmap_lookup_str(output_names.all, key) == NULL) {
+        hashmap_insert_str(output_names.all, key, output);
+    }
+    if (output->active && hashmap_lookup_str(output_names.active, key) == NULL) {
+        hashmap_insert_str(output_names.active, key, output);
+    }
+    free(key);
+}
+
+static void output_names_build(void) {
+    if (output_names.all == NULL) {
+        output_names.all = hashmap_new();
+        output_names.active = hashmap_new();
+    } else {
+        hashmap_clear(output_names.all);
+        hashmap_clear(output_names.active);
+    }
+
     Output *output;
-    bool get_primary = (strcasecmp("primary", name) == 0);
     TAILQ_FOREACH (output, &outputs, outputs) {
-        if (require_active && !output->active) {
-            continue;
-        }
-        if (output->primary && get_primary) {
-            return output;
+        if (output->primary) {
+            output_names_insert("primary", output);
         }
         struct output_name *output_name;
         SLIST_FOREACH (output_name, &output->names_head, names) {
-            if (strcasecmp(output_name->name, name) == 0) {
-                return output;
-            }
+            output_names_insert(output_name->name, output);
         }
     }
+    output_names.valid = true;
+}
 
-    return NULL;
+/*
+ * Returns the output with the given name or NULL.
+ * If require_active is true, only active outputs are considered.
+ *
+ */
+Output *get_output_by_name(const char *name, const bool require_active) {
+    if (!output_names.valid) {
+        output_names_build();
+    }
+
+    char *key = fold_output_name(name);
+    Output *output = hashmap_lookup_str(require_active ? output_names.active : output_names.all, key);
+    free(key);
+    return output;
 }
 
 /*
@@ -109,23 +173,133 @@ static bool any_randr_output_active(void) {
 }
 
 /*
- * Returns the active (!) output which contains the coordinates x, y or NULL
- * if there is no output which contains these coordinates.
+ * Invalidates the output grid and the output names. Has to be called whenever
+ * an output is added, activated, deactivated, renamed, changes its position or
+ * size or becomes the primary output.
  *
  */
-Output *get_output_containing(unsigned int x, unsigned int y) {
+void randr_outputs_changed(void) {
+    output_grid.valid = false;
+    output_names.valid = false;
+    workspace_assignments_changed();
+    x_pointer_unknown();
+}
+
+static int edge_cmp(const void *a, const void *b) {
+    const uint32_t ea = *(const uint32_t *)a;
+    const uint32_t eb = *(const uint32_t *)b;
+    return (ea > eb) - (ea < eb);
+}
+
+/*
+ * Sorts the edges and removes duplicates. Returns the new number of edges.
+ *
+ */
+static int edges_sort_unique(uint32_t *edges, int num) {
+    if (num == 0) {
+        return 0;
+    }
+    qsort(edges, num, sizeof(uint32_t), edge_cmp);
+    int unique = 1;
+    for (int i = 1; i < num; i++) {
+        if (edges[i] != edges[unique - 1]) {
+            edges[unique++] = edges[i];
+        }
+    }
+    return unique;
+}
+
+/*
+ * Returns the index of the last edge which is <= value, or -1 if there is no
+ * such edge.
+ *
+ */
+static int edge_lower(const uint32_t *edges, int num, uint32_t value) {
+    int lo = 0, hi = num;
+    while (lo < hi) {
+        const int mid = lo + (hi - lo) / 2;
+        if (edges[mid] <= value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo - 1;
+}
+
+static void output_grid_build(void) {
+    FREE(output_grid.x);
+    FREE(output_grid.y);
+    FREE(output_grid.cells);
+
+    int num_active = 0;
     Output *output;
     TAILQ_FOREACH (output, &outputs, outputs) {
-        if (!output->active)
+        if (output->active) {
+            num_active++;
+        }
+    }
+
+    output_grid.x = smalloc((2 * num_active + 1) * sizeof(uint32_t));
+    output_grid.y = smalloc((2 * num_active + 1) * sizeof(uint32_t));
+    int num_x = 0, num_y = 0;
+    TAILQ_FOREACH (output, &outputs, outputs) {
+        if (!output->active) {
             continue;
-        DLOG("comparing x=%d y=%d with x=%d and y=%d width %d height %d\n",
-             x, y, output->rect.x, output->rect.y, output->rect.width, output->rect.height);
-        if (x >= output->rect.x && x < (output->rect.x + output->rect.width) &&
-            y >= output->rect.y && y < (output->rect.y + output->rect.height))
-            return output;
+        }
+        output_grid.x[num_x++] = output->rect.x;
+        output_grid.x[num_x++] = output->rect.x + output->rect.width;
+        output_grid.y[num_y++] = output->rect.y;
+        output_grid.y[num_y++] = output->rect.y + output->rect.height;
+    }
+    output_grid.num_x = num_x = edges_sort_unique(output_grid.x, num_x);
+    output_grid.num_y = num_y = edges_sort_unique(output_grid.y, num_y);
+    output_grid.valid = true;
+    if (num_x < 2 || num_y < 2) {
+        return;
     }
 
-    return NULL;
+    const int columns = num_x - 1;
+    output_grid.cells = scalloc(columns * (num_y - 1), sizeof(Output *));
+    TAILQ_FOREACH (output, &outputs, outputs) {
+        if (!output->active) {
+            continue;
+        }
+        const int x0 = edge_lower(output_grid.x, num_x, output->rect.x);
+        const int x1 = edge_lower(output_grid.x, num_x, output->rect.x + output->rect.width);
+        const int y0 = edge_lower(output_grid.y, num_y, output->rect.y);
+        const int y1 = edge_lower(output_grid.y, num_y, output->rect.y + output->rect.height);
+        for (int row = y0; row < y1; row++) {
+            for (int column = x0; column < x1; column++) {
+                Output **cell = &(output_grid.cells[row * columns + column]);
+                if (*cell == NULL) {
+                    *cell = output;
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Returns the active (!) output which contains the coordinates x, y or NULL
+ * if there is no output which contains these coordinates.
+ *
+ */
+Output *get_output_containing(unsigned int x, unsigned int y) {
+    if (!output_grid.valid) {
+        output_grid_build();
+    }
+    if (output_grid.cells == NULL) {
+        return NULL;
+    }
+
+    const int column = edge_lower(output_grid.x, output_grid.num_x, x);
+    const int row = edge_lower(output_grid.y, output_grid.num_y, y);
+    if (column < 0 || column >= output_grid.num_x - 1 ||
+        row < 0 || row >= output_grid.num_y - 1) {
+        return NULL;
+    }
+    return output_grid.cells[row * (output_grid.num_x - 1) + column];
 }
 
 /*
@@ -370,11 +544,11 @@ void output_init_con(Output *output) {
     topdock->type = CT_DOCKAREA;
     topdock->layout = L_DOCKAREA;
     /* this container swallows dock clients */
-    Match *match = scalloc(1, sizeof(Match));
+    Match *match = pool_alloc(&match_pool);
     match_init(match);
     match->dock = M_DOCK_TOP;
     match->insert_where = M_BELOW;
-    TAILQ_INSERT_TAIL(&(topdock->swallow_head), match, matches);
+    con_add_swallow(topdock, match, false);
 
     FREE(topdock->name);
     topdock->name = sstrdup("topdock");
@@ -404,11 +578,11 @@ void output_init_con(Output *output) {
     bottomdock->type = CT_DOCKAREA;
     bottomdock->layout = L_DOCKAREA;
     /* this container swallows dock clients */
-    match = scalloc(1, sizeof(Match));
+    match = pool_alloc(&match_pool);
     match_init(match);
     match->dock = M_DOCK_BOTTOM;
     match->insert_where = M_BELOW;
-    TAILQ_INSERT_TAIL(&(bottomdock->swallow_head), match, matches);
+    con_add_swallow(bottomdock, match, false);
 
     FREE(bottomdock->name);
     bottomdock->name = sstrdup("bottomdock");
@@ -422,6 +596,7 @@ void output_init_con(Output *output) {
     /* Change focus to the content container */
     TAILQ_REMOVE(&(con->focus_head), content, focused);
     TAILQ_INSERT_HEAD(&(con->focus_head), content, focused);
+    con_invalidate_lookups();
 }
 
 /*
@@ -438,12 +613,20 @@ void init_ws_for_output(Output *output) {
     Con *content = output_get_content(output->con);
     Con *previous_focus = con_get_workspace(focused);
 
-    /* Iterate over all workspaces and check if any of them should be assigned
-     * to this output.
+    /* Collect all workspaces which should be assigned to this output and move
+     * them at once, so that the output only gets rendered once.
      * Note: in order to do that we iterate over all_cons and not using another
      * list that would be updated during iteration by the
-     * workspace_move_to_output function. */
+     * workspaces_move_to_output function. */
+    int num_workspaces = 0;
     Con *workspace;
+    TAILQ_FOREACH (workspace, &all_cons, all_cons) {
+        if (workspace->type == CT_WORKSPACE) {
+            num_workspaces++;
+        }
+    }
+    Con **assigned = scalloc(num_workspaces > 0 ? num_workspaces : 1, sizeof(Con *));
+    int num_assigned = 0;
     TAILQ_FOREACH (workspace, &all_cons, all_cons) {
         if (workspace->type != CT_WORKSPACE || con_is_internal(workspace)) {
             continue;
@@ -458,16 +641,21 @@ void init_ws_for_output(Output *output) {
         DLOG("Moving workspace \"%s\" from output \"%s\" to \"%s\" due to assignment\n",
              workspace->name, output_primary_name(get_output_for_con(workspace)),
              output_primary_name(output));
+        assigned[num_assigned++] = workspace;
+    }
 
+    if (num_assigned > 0) {
         /* Need to copy output's rect since content is not yet rendered. We
          * can't call render_con here because render_output only proceeds
          * if a workspace exists. */
         content->rect = output->con->rect;
-        workspace_move_to_output(workspace, output);
+        workspaces_move_to_output(assigned, num_assigned, output);
     }
+    free(assigned);
 
     /* Temporarily set the focused container, might not be initialized yet. */
     focused = content;
+    con_invalidate_lookups();
 
     /* if a workspace exists, we are done now */
     if (!TAILQ_EMPTY(&(content->nodes_head))) {
@@ -545,10 +733,14 @@ static void output_change_mode(xcb_connection_t *conn, Output *output) {
                 continue;
 
             workspace->layout = (output->rect.height > output->rect.width) ? L_SPLITV : L_SPLITH;
+            con_set_dirty(workspace);
+            tree_note_flatten_candidate(workspace);
             DLOG("Setting workspace [%d,%s]'s layout to %d.\n", workspace->num, workspace->name, workspace->layout);
             if ((child = TAILQ_FIRST(&(workspace->nodes_head)))) {
-                if (child->layout == L_SPLITV || child->layout == L_SPLITH)
+                if (child->layout == L_SPLITV || child->layout == L_SPLITH) {
                     child->layout = workspace->layout;
+                    con_invalidate_tree_representation(child);
+                }
                 DLOG("Setting child [%d,%s]'s layout to %d.\n", child->num, child->name, child->layout);
             }
         }
@@ -594,14 +786,24 @@ static bool randr_query_outputs_15(void) {
          xcb_randr_get_monitors_monitors_length(monitors),
          monitors->timestamp);
 
+    /* Request all monitor names before waiting for the first reply. */
+    const int num_monitors = xcb_randr_get_monitors_monitors_length(monitors);
+    xcb_get_atom_name_cookie_t atom_cookies[num_monitors + 1];
     xcb_randr_monitor_info_iterator_t iter;
+    int monitor_idx = 0;
+    for (iter = xcb_randr_get_monitors_monitors_iterator(monitors);
+         iter.rem;
+         xcb_randr_monitor_info_next(&iter)) {
+        atom_cookies[monitor_idx++] = xcb_get_atom_name(conn, iter.data->name);
+    }
+
+    monitor_idx = 0;
     for (iter = xcb_randr_get_monitors_monitors_iterator(monitors);
          iter.rem;
          xcb_randr_monitor_info_next(&iter)) {
         const xcb_randr_monitor_info_t *monitor_info = iter.data;
         xcb_get_atom_name_reply_t *atom_reply =
-            xcb_get_atom_name_reply(
-                conn, xcb_get_atom_name(conn, monitor_info->name), &err);
+            xcb_get_atom_name_reply(conn, atom_cookies[monitor_idx++], &err);
         if (err != NULL) {
             ELOG("Could not get RandR monitor name: X11 error code %d\n", err->error_code);
             free(err);
@@ -622,13 +824,13 @@ static bool randr_query_outputs_15(void) {
             /* Register associated output names in addition to the monitor name */
             xcb_randr_output_t *randr_outputs = xcb_randr_monitor_info_outputs(monitor_info);
             int randr_output_len = xcb_randr_monitor_info_outputs_length(monitor_info);
+            xcb_randr_get_output_info_cookie_t info_cookies[randr_output_len + 1];
+            for (int i = 0; i < randr_output_len; i++) {
+                info_cookies[i] = xcb_randr_get_output_info(conn, randr_outputs[i], monitors->timestamp);
+            }
             for (int i = 0; i < randr_output_len; i++) {
-                xcb_randr_output_t randr_output = randr_outputs[i];
-
                 xcb_randr_get_output_info_reply_t *info =
-                    xcb_randr_get_output_info_reply(conn,
-                                                    xcb_randr_get_output_info(conn, randr_output, monitors->timestamp),
-                                                    NULL);
+                    xcb_randr_get_output_info_reply(conn, info_cookies[i], NULL);
 
                 if (info != NULL && info->crtc != XCB_NONE) {
                     char *oname;
@@ -664,6 +866,8 @@ static bool randr_query_outputs_15(void) {
         new->to_be_disabled = false;
 
         new->primary = monitor_info->primary;
+        /* The next monitor is looked up by name. */
+        randr_outputs_changed();
 
         new->changed =
             update_if_necessary(&(new->rect.x), monitor_info->x) |
@@ -717,6 +921,7 @@ static void handle_output(xcb_connection_t *conn, xcb_randr_output_t id,
               xcb_randr_get_output_info_name_length(output),
               xcb_randr_get_output_info_name(output));
     SLIST_INSERT_HEAD(&new->names_head, output_name, names);
+    randr_outputs_changed();
 
     DLOG("found output with name %s\n", output_primary_name(new));
 
@@ -826,6 +1031,80 @@ static void randr_query_outputs_14(void) {
     FREE(res);
 }
 
+/*
+ * Calculates the refresh rate (in Hz) of the given mode, 0 if unknown.
+ *
+ */
+static double mode_refresh_rate(const xcb_randr_mode_info_t *mode) {
+    double vtotal = mode->vtotal;
+    if (mode->mode_flags & XCB_RANDR_MODE_FLAG_DOUBLE_SCAN) {
+        vtotal *= 2;
+    }
+    if (mode->mode_flags & XCB_RANDR_MODE_FLAG_INTERLACE) {
+        vtotal /= 2;
+    }
+    if (mode->htotal == 0 || vtotal == 0) {
+        return 0;
+    }
+    return mode->dot_clock / (mode->htotal * vtotal);
+}
+
+/*
+ * Updates max_refresh_rate from the modes of all active CRTCs. The CRTC
+ * requests are sent before waiting for any reply.
+ *
+ */
+static void randr_query_refresh_rate(void) {
+    max_refresh_rate = 0;
+
+    xcb_randr_get_screen_resources_current_reply_t *res =
+        xcb_randr_get_screen_resources_current_reply(
+            conn, xcb_randr_get_screen_resources_current(conn, root), NULL);
+    if (res == NULL) {
+        ELOG("Could not query screen resources.\n");
+        return;
+    }
+
+    const int num_crtcs = xcb_randr_get_screen_resources_current_crtcs_length(res);
+    xcb_randr_crtc_t *crtcs = xcb_randr_get_screen_resources_current_crtcs(res);
+    xcb_randr_get_crtc_info_cookie_t cookies[num_crtcs];
+    for (int i = 0; i < num_crtcs; i++) {
+        cookies[i] = xcb_randr_get_crtc_info(conn, crtcs[i], res->config_timestamp);
+    }
+
+    const int num_modes = xcb_randr_get_screen_resources_current_modes_length(res);
+    xcb_randr_mode_info_t *modes = xcb_randr_get_screen_resources_current_modes(res);
+    for (int i = 0; i < num_crtcs; i++) {
+        xcb_randr_get_crtc_info_reply_t *crtc =
+            xcb_randr_get_crtc_info_reply(conn, cookies[i], NULL);
+        if (crtc == NULL) {
+            continue;
+        }
+        for (int j = 0; crtc->mode != XCB_NONE && j < num_modes; j++) {
+            if (modes[j].id == crtc->mode) {
+                const double rate = mode_refresh_rate(&modes[j]);
+                if (rate > max_refresh_rate) {
+                    max_refresh_rate = rate;
+                }
+                break;
+            }
+        }
+        free(crtc);
+    }
+    free(res);
+
+    DLOG("Highest refresh rate of all CRTCs: %.2f Hz\n", max_refresh_rate);
+}
+
+/*
+ * Returns the highest refresh rate (in Hz) of all active CRTCs, as found by
+ * the last randr_query_outputs(), or 0 if it is unknown.
+ *
+ */
+double randr_get_max_refresh_rate(void) {
+    return max_refresh_rate;
+}
+
 /*
  * Move the content of an outputs container to the first output.
  *
@@ -837,6 +1116,10 @@ static void move_content(Con *con) {
     Con *first = get_first_output()->con;
     Con *first_content = output_get_content(first);
 
+    /* The workspaces and docks are moved (and the empty workspaces closed)
+     * without rendering in between, their events are sent together. */
+    const bool bulk_begun = tree_bulk_begin();
+
     /* We need to move the workspaces from the disappearing output to the first output */
     /* 1: Get the con to focus next */
     Con *next = focused;
@@ -894,20 +1177,91 @@ static void move_content(Con *con) {
 
     DLOG("Destroying disappearing con %p\n", con);
     tree_close_internal(con, DONT_KILL_WINDOW, true);
+
+    if (bulk_begun) {
+        tree_bulk_end();
+    }
+}
+
+/*
+ * The state of an output which matters to the layout tree, see
+ * randr_query_outputs().
+ *
+ */
+struct output_state {
+    Output *output;
+    bool active;
+    bool primary;
+    Rect rect;
+};
+
+static bool output_is_enabled(Output *output) {
+    return output->active && !output->to_be_disabled;
+}
+
+/*
+ * Returns true if any output was added, enabled, disabled, moved, resized or
+ * became (or stopped being) the primary output compared to the given states.
+ *
+ */
+static bool outputs_differ(struct output_state *states, int num_states) {
+    int num_enabled = 0;
+    Output *output;
+    TAILQ_FOREACH (output, &outputs, outputs) {
+        if (output_is_enabled(output)) {
+            num_enabled++;
+        }
+    }
+
+    for (int i = 0; i < num_states; i++) {
+        output = states[i].output;
+        if (output_is_enabled(output) != states[i].active ||
+            output->primary != states[i].primary ||
+            (states[i].active && memcmp(&(output->rect), &(states[i].rect), sizeof(Rect)) != 0)) {
+            return true;
+        }
+        if (states[i].active) {
+            num_enabled--;
+        }
+    }
+
+    /* Outputs which are new since the last query */
+    return (num_enabled != 0);
 }
 
 /*
  * (Re-)queries the outputs via RandR and stores them in the list of outputs.
  *
+ * Only outputs which changed are reconfigured. Returns false if no output was
+ * added, removed or changed, in which case the layout tree was not touched.
+ *
  * If no outputs are found use the root window.
  *
  */
-void randr_query_outputs(void) {
+bool randr_query_outputs(void) {
     Output *output, *other;
 
+    /* Remember the current state to find out what changed. Outputs are never
+     * removed from the list, so the pointers stay valid. */
+    int num_states = 0;
+    TAILQ_FOREACH (output, &outputs, outputs) {
+        num_states++;
+    }
+    struct output_state *states = scalloc(num_states + 1, sizeof(struct output_state));
+    num_states = 0;
+    TAILQ_FOREACH (output, &outputs, outputs) {
+        states[num_states++] = (struct output_state){
+            .output = output,
+            .active = output_is_enabled(output),
+            .primary = output->primary,
+            .rect = output->rect,
+        };
+    }
+
     if (!randr_query_outputs_15()) {
         randr_query_outputs_14();
     }
+    randr_query_refresh_rate();
 
     /* If there's no randr output, enable the output covering the root window. */
     if (any_randr_output_active()) {
@@ -959,6 +1313,22 @@ void randr_query_outputs(void) {
         }
     }
 
+    randr_outputs_changed();
+
+    const bool changed = outputs_differ(states, num_states);
+    free(states);
+    if (!changed) {
+        DLOG("Outputs did not change, not touching the layout tree\n");
+        TAILQ_FOREACH (output, &outputs, outputs) {
+            output->changed = false;
+            if (!output->active) {
+                output->to_be_disabled = false;
+            }
+        }
+        FREE(primary);
+        return false;
+    }
+
     /* Ensure that all outputs which are active also have a con. This is
      * necessary because in the next step, a clone might get disabled. Example:
      * LVDS1 active, VGA1 gets activated as a clone of LVDS1 (has no con).
@@ -1026,6 +1396,7 @@ void randr_query_outputs(void) {
     tree_render();
 
     FREE(primary);
+    return true;
 }
 
 /*
@@ -1036,6 +1407,7 @@ void randr_disable_output(Output *output) {
     assert(output->to_be_disabled);
 
     output->active = false;
+    randr_outputs_changed();
     DLOG("Output %s disabled, re-assigning workspaces/docks\n", output_primary_name(output));
 
     if (output->con != NULL) {
@@ -1051,6 +1423,7 @@ void randr_disable_output(Output *output) {
 
 static void fallback_to_root_output(void) {
     root_output->active = true;
+    randr_outputs_changed();
     output_init_con(root_output);
     init_ws_for_output(root_output);
 }
@@ -1065,6 +1438,7 @@ void randr_init(int *event_base, const bool disable_randr15) {
 
     root_output = create_root_output(conn);
     TAILQ_INSERT_TAIL(&outputs, root_output, outputs);
+    randr_outputs_changed();
 
     extreply = xcb_get_extension_data(conn, &xcb_randr_id);
     if (!extreply->present) {
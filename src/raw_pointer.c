@@ -0,0 +1,311 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * raw_pointer.c: Focus follows mouse based on XInput 2 raw motion events
+ *                (focus_follows_mouse raw).
+ *
+ * Core focus follows mouse reacts to the EnterNotify events of every frame the
+ * pointer crosses, and has to ignore the ones caused by i3 reconfiguring
+ * windows. With raw motion events, i3 only notes that the pointer moved. Raw
+ * events carry no position, so once per event loop iteration i3 queries the
+ * pointer position and looks up the container below it in an index of the
+ * visible containers, which is rebuilt after the tree was rendered.
+ *
+ */
+#include "all.h"
+
+#ifdef HAVE_XCB_XINPUT
+#include <xcb/xinput.h>
+#endif
+
+/* A visible container and the rect it covers. */
+struct index_entry {
+    Rect rect;
+    Con *con;
+};
+
+/* The visible containers of one output, topmost first. */
+struct output_index {
+    Rect rect;
+    Con *workspace;
+    struct index_entry *entries;
+    int num_entries;
+    int size;
+};
+
+static struct output_index *indexes = NULL;
+static int num_indexes = 0;
+static bool index_valid = false;
+static uint64_t index_generation = 0;
+
+static bool selected = false;
+#ifdef HAVE_XCB_XINPUT
+static uint8_t xi_opcode;
+#endif
+static bool query_pending = false;
+static xcb_query_pointer_cookie_t query_cookie;
+
+/* The container below the pointer at the last lookup. It is only compared,
+ * never dereferenced: it might have been freed since. */
+static Con *last_target = NULL;
+
+/*
+ * Selects or deselects XInput 2 raw motion events on the root window
+ * according to the focus_follows_mouse directive. Without XInput 2, i3 falls
+ * back to following EnterNotify events.
+ *
+ */
+void raw_pointer_configure(void) {
+#ifdef HAVE_XCB_XINPUT
+    const bool want = config.focus_follows_mouse_raw;
+    if (want == selected) {
+        return;
+    }
+
+    if (want) {
+        const xcb_query_extension_reply_t *extension = xcb_get_extension_data(conn, &xcb_input_id);
+        if (extension == NULL || !extension->present) {
+            ELOG("The X server does not support XInput, focus follows EnterNotify events instead.\n");
+            return;
+        }
+        /* Before XInput 2.1, raw events are only delivered to the client
+         * grabbing the device. */
+        xcb_input_xi_query_version_reply_t *version = xcb_input_xi_query_version_reply(
+            conn, xcb_input_xi_query_version(conn, 2, 1), NULL);
+        if (version == NULL || version->major_version < 2 ||
+            (version->major_version == 2 && version->minor_version < 1)) {
+            ELOG("The X server does not support XInput 2.1, focus follows EnterNotify events instead.\n");
+            free(version);
+            return;
+        }
+        free(version);
+        xi_opcode = extension->major_opcode;
+    }
+
+    /* The mask words follow the mask header in the request. */
+    struct {
+        xcb_input_event_mask_t header;
+        uint32_t mask;
+    } mask = {
+        .header = {
+            .deviceid = XCB_INPUT_DEVICE_ALL_MASTER,
+            .mask_len = 1,
+        },
+        .mask = (want ? XCB_INPUT_XI_EVENT_MASK_RAW_MOTION : 0),
+    };
+    xcb_input_xi_select_events(conn, root, 1, &mask.header);
+
+    DLOG("Raw pointer motion events %s\n", (want ? "selected" : "deselected"));
+    selected = want;
+    query_pending = false;
+    last_target = NULL;
+#else
+    if (config.focus_follows_mouse_raw) {
+        ELOG("i3 was built without XInput support, focus follows EnterNotify events instead.\n");
+    }
+#endif
+}
+
+/*
+ * Returns true if focus follows raw pointer motion, in which case the
+ * EnterNotify and MotionNotify handlers must not change focus.
+ *
+ */
+bool raw_pointer_active(void) {
+    return selected;
+}
+
+/*
+ * Handles a GenericEvent. Raw motion events only note that the pointer moved
+ * and request its position, see raw_pointer_flush().
+ *
+ */
+void raw_pointer_handle_event(xcb_generic_event_t *event) {
+#ifdef HAVE_XCB_XINPUT
+    xcb_ge_generic_event_t *generic = (xcb_ge_generic_event_t *)event;
+    if (!selected || generic->extension != xi_opcode || generic->event_type != XCB_INPUT_RAW_MOTION) {
+        return;
+    }
+
+    last_timestamp = ((xcb_input_raw_motion_event_t *)event)->time;
+
+    /* Any number of motion events until the next flush need one query. */
+    if (!query_pending) {
+        query_cookie = xcb_query_pointer(conn, root);
+        query_pending = true;
+    }
+#endif
+}
+
+/*
+ * Notes that the geometry of the visible containers changed, so the index for
+ * looking up the container below the pointer has to be rebuilt.
+ *
+ */
+void raw_pointer_invalidate_index(void) {
+    index_valid = false;
+}
+
+static void index_add(struct output_index *output, Rect rect, Con *con) {
+    if (output->num_entries == output->size) {
+        output->size = (output->size == 0 ? 16 : output->size * 2);
+        output->entries = srealloc(output->entries, output->size * sizeof(struct index_entry));
+    }
+    output->entries[output->num_entries++] = (struct index_entry){.rect = rect, .con = con};
+}
+
+/*
+ * Adds the visible leaves below con. Of stacked and tabbed containers, only
+ * the focused child is visible. The container itself covers its decorations,
+ * which keep the focus on that child.
+ *
+ */
+static void index_add_visible(struct output_index *output, Con *con) {
+    if (con_is_leaf(con)) {
+        index_add(output, con->rect, con);
+        return;
+    }
+
+    if (con->layout == L_STACKED || con->layout == L_TABBED) {
+        index_add_visible(output, TAILQ_FIRST(&(con->focus_head)));
+        index_add(output, con->rect, con);
+        return;
+    }
+
+    Con *child;
+    TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
+        index_add_visible(output, child);
+    }
+}
+
+/*
+ * Rebuilds the index from the visible workspace of every output: its
+ * fullscreen container if there is one, otherwise the floating containers in
+ * stacking order (topmost first) followed by the tiling leaves.
+ *
+ */
+static void build_index(void) {
+    for (int i = 0; i < num_indexes; i++) {
+        free(indexes[i].entries);
+    }
+    FREE(indexes);
+    num_indexes = 0;
+
+    Con *output;
+    TAILQ_FOREACH (output, &(croot->nodes_head), nodes) {
+        if (!con_is_internal(output)) {
+            num_indexes++;
+        }
+    }
+    indexes = scalloc(num_indexes, sizeof(struct output_index));
+
+    Con *global_fullscreen = con_get_fullscreen_con(croot, CF_GLOBAL);
+    int i = 0;
+    TAILQ_FOREACH (output, &(croot->nodes_head), nodes) {
+        if (con_is_internal(output)) {
+            continue;
+        }
+        struct output_index *index = &indexes[i++];
+        index->rect = output->rect;
+
+        Con *content = output_get_content(output);
+        Con *ws = (content != NULL ? TAILQ_FIRST(&(content->focus_head)) : NULL);
+        index->workspace = ws;
+        if (ws == NULL) {
+            continue;
+        }
+
+        if (global_fullscreen != NULL) {
+            index_add(index, global_fullscreen->rect, global_fullscreen);
+            continue;
+        }
+
+        Con *fullscreen = con_get_fullscreen_con(ws, CF_OUTPUT);
+        if (fullscreen != NULL) {
+            index_add(index, fullscreen->rect, fullscreen);
+            continue;
+        }
+
+        Con *floating;
+        TAILQ_FOREACH_REVERSE (floating, &(ws->floating_head), floating_head, floating_windows) {
+            index_add_visible(index, floating);
+        }
+        index_add_visible(index, ws);
+    }
+
+    index_valid = true;
+    index_generation = con_lookup_generation();
+}
+
+/*
+ * Returns the container below the given position, the visible workspace of
+ * the output if there is no container, or NULL if the position is on no
+ * output.
+ *
+ */
+static Con *lookup(int x, int y) {
+    if (!index_valid || index_generation != con_lookup_generation()) {
+        build_index();
+    }
+
+    for (int i = 0; i < num_indexes; i++) {
+        struct output_index *output = &indexes[i];
+        if (!rect_contains(output->rect, x, y)) {
+            continue;
+        }
+        for (int j = 0; j < output->num_entries; j++) {
+            if (rect_contains(output->entries[j].rect, x, y)) {
+                return output->entries[j].con;
+            }
+        }
+        return output->workspace;
+    }
+    return NULL;
+}
+
+/*
+ * Focuses the container below the pointer if the pointer moved since the last
+ * call. Called once per event loop iteration. Returns true if the focus
+ * changed.
+ *
+ */
+bool raw_pointer_flush(void) {
+    if (!query_pending) {
+        return false;
+    }
+    query_pending = false;
+
+    xcb_query_pointer_reply_t *reply = xcb_query_pointer_reply(conn, query_cookie, NULL);
+    if (reply == NULL) {
+        return false;
+    }
+    x_pointer_moved((reply->child != XCB_NONE ? reply->child : root), reply->root_x, reply->root_y);
+    Con *target = lookup(reply->root_x, reply->root_y);
+    free(reply);
+
+    /* Only crossing into another container changes focus, so focusing a
+     * different container with the keyboard sticks until the pointer leaves
+     * the one below it. */
+    if (target == NULL || target == last_target) {
+        return false;
+    }
+    last_target = target;
+
+    Con *next = con_descend_focused(target);
+    if (next == focused) {
+        return false;
+    }
+
+    Con *ws = con_get_workspace(next);
+    if (ws != con_get_workspace(focused)) {
+        workspace_show(ws);
+    }
+
+    focused_id = XCB_NONE;
+    con_focus(con_descend_focused(next));
+    tree_schedule_render();
+    return true;
+}
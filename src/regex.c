@@ -9,11 +9,20 @@
  */
 #include "all.h"
 
+/* Only used to tell whether a pattern matched, so a single pair of offsets
+ * suffices for all patterns. */
+static pcre2_match_data *match_data;
+
+/* Compiled regular expressions by pattern. Configs repeat the same patterns
+ * in many for_window and assign rules, which then share one struct regex. */
+static hashmap_t *regexes_by_pattern;
+
 /*
  * Creates a new 'regex' struct containing the given pattern and a PCRE
- * compiled regular expression. Also, calls pcre_study because this regex will
- * most likely be used often (like for every new window and on every relevant
- * property change of existing windows).
+ * compiled regular expression, or returns another reference to the existing
+ * one for the same pattern. Also, JIT-compiles the pattern (if supported
+ * by PCRE) because this regex will most likely be used often (like for every
+ * new window and on every relevant property change of existing windows).
  *
  * Returns NULL if the pattern could not be compiled into a regular expression
  * (and ELOGs an appropriate error message).
@@ -23,8 +32,17 @@ struct regex *regex_new(const char *pattern) {
     int errorcode;
     PCRE2_SIZE offset;
 
-    struct regex *re = scalloc(1, sizeof(struct regex));
-    re->pattern = sstrdup(pattern);
+    if (regexes_by_pattern == NULL) {
+        regexes_by_pattern = hashmap_new();
+    }
+    struct regex *re = hashmap_lookup_str(regexes_by_pattern, pattern);
+    if (re != NULL) {
+        return regex_ref(re);
+    }
+
+    re = scalloc_counted(&memory_counters[MEM_REGEX], 1, sizeof(struct regex));
+    re->refcount = 1;
+    re->pattern = sstrdup_counted(&memory_counters[MEM_REGEX], pattern);
     uint32_t options = PCRE2_UTF;
     /* We use PCRE_UCP so that \B, \b, \D, \d, \S, \s, \W, \w and some POSIX
      * character classes play nicely with Unicode */
@@ -37,19 +55,117 @@ struct regex *regex_new(const char *pattern) {
         regex_free(re);
         return NULL;
     }
+
+    /* Patterns without metacharacters (apart from the anchors) are matched
+     * with plain string comparisons, see regex_matches(). */
+    const char *start = pattern;
+    const char *end = pattern + strlen(pattern);
+    const bool anchored_start = (*start == '^');
+    if (anchored_start) {
+        start++;
+    }
+    const bool anchored_end = (end > start && end[-1] == '$');
+    if (anchored_end) {
+        end--;
+    }
+    if (strcspn(start, "\\^$.[]|()?*+{}") == (size_t)(end - start)) {
+        re->literal = sstrndup_counted(&memory_counters[MEM_REGEX], start, end - start);
+        re->anchored_start = anchored_start;
+        re->anchored_end = anchored_end;
+    } else {
+        errorcode = pcre2_jit_compile(re->regex, PCRE2_JIT_COMPLETE);
+        if (errorcode != 0) {
+            /* Not fatal, pcre2_match() falls back to the interpreter. */
+            DLOG("Could not JIT-compile \"%s\" (PCRE error %d)\n", pattern, errorcode);
+        }
+    }
+
+    hashmap_insert_str(regexes_by_pattern, pattern, re);
     return re;
 }
 
 /*
- * Frees the given regular expression. It must not be used afterwards!
+ * Returns the number of distinct regular expressions in use.
+ *
+ */
+size_t regex_count(void) {
+    return (regexes_by_pattern != NULL ? hashmap_size(regexes_by_pattern) : 0);
+}
+
+/*
+ * Returns another reference to the given regular expression, which has to be
+ * released using regex_free().
+ *
+ */
+struct regex *regex_ref(struct regex *regex) {
+    regex->refcount++;
+    return regex;
+}
+
+/*
+ * Releases a reference to the given regular expression, freeing it once the
+ * last one is gone. It must not be used afterwards!
  *
  */
 void regex_free(struct regex *regex) {
     if (!regex)
         return;
-    FREE(regex->pattern);
-    FREE(regex->regex);
-    FREE(regex);
+    if (--regex->refcount > 0)
+        return;
+    if (hashmap_lookup_str(regexes_by_pattern, regex->pattern) == regex)
+        hashmap_remove_str(regexes_by_pattern, regex->pattern);
+    free_counted(regex->pattern);
+    free_counted(regex->literal);
+    pcre2_code_free(regex->regex);
+    free_counted(regex);
+}
+
+/*
+ * Returns the only string the given regular expression matches (the pattern
+ * was ^literal$ without any other metacharacters) or NULL.
+ *
+ */
+const char *regex_exact_literal(struct regex *regex) {
+    if (regex->literal == NULL || !regex->anchored_start || !regex->anchored_end) {
+        return NULL;
+    }
+    return regex->literal;
+}
+
+/*
+ * Matches the literal of a pattern without metacharacters against the input,
+ * with the same semantics as PCRE.
+ *
+ */
+static bool literal_matches(struct regex *regex, const char *input) {
+    const size_t input_len = strlen(input);
+    const size_t len = strlen(regex->literal);
+
+    if (!regex->anchored_end) {
+        if (regex->anchored_start) {
+            return strncmp(input, regex->literal, len) == 0;
+        }
+        return strstr(input, regex->literal) != NULL;
+    }
+
+    /* Like in PCRE, "$" also matches right before a trailing newline. */
+    size_t ends[2] = {input_len, input_len};
+    if (input_len > 0 && input[input_len - 1] == '\n') {
+        ends[1] = input_len - 1;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (ends[i] < len) {
+            continue;
+        }
+        const size_t offset = ends[i] - len;
+        if (regex->anchored_start && offset != 0) {
+            continue;
+        }
+        if (memcmp(input + offset, regex->literal, len) == 0) {
+            return true;
+        }
+    }
+    return false;
 }
 
 /*
@@ -59,16 +175,25 @@ void regex_free(struct regex *regex) {
  *
  */
 bool regex_matches(struct regex *regex, const char *input) {
-    pcre2_match_data *match_data;
     int rc;
 
-    match_data = pcre2_match_data_create_from_pattern(regex->regex, NULL);
+    if (regex->literal != NULL) {
+        const bool matches = literal_matches(regex, input);
+        LOG("Regular expression \"%s\" %s \"%s\"\n",
+            regex->pattern, (matches ? "matches" : "does not match"), input);
+        return matches;
+    }
+
+    if (match_data == NULL) {
+        match_data = pcre2_match_data_create(1, NULL);
+    }
 
     /* We use strlen() because pcre_exec() expects the length of the input
      * string in bytes */
     rc = pcre2_match(regex->regex, (PCRE2_SPTR)input, strlen(input), 0, 0, match_data, NULL);
-    pcre2_match_data_free(match_data);
-    if (rc > 0) {
+    /* 0 means that the match data was too small to hold the offsets of all
+     * capture groups, which we do not need. */
+    if (rc >= 0) {
         LOG("Regular expression \"%s\" matches \"%s\"\n",
             regex->pattern, input);
         return true;
@@ -84,3 +209,28 @@ bool regex_matches(struct regex *regex, const char *input) {
          rc, regex->pattern, input);
     return false;
 }
+
+/*
+ * Like regex_matches(), but for an interned string (see intern_string()) or
+ * NULL, which is matched like the empty string. The results for the last few
+ * interned strings are remembered, so that matching many windows with the
+ * same class (for example) does not run the regular expression every time.
+ *
+ */
+bool regex_matches_interned(struct regex *regex, const char *input) {
+    if (input == NULL) {
+        return regex_matches(regex, "");
+    }
+
+    const uint64_t id = intern_id(input);
+    struct regex_result *cached = &(regex->result_cache[id % REGEX_RESULT_CACHE_SIZE]);
+    if (cached->id == id) {
+        DLOG("Regular expression \"%s\" %s \"%s\" (cached)\n",
+             regex->pattern, (cached->matches ? "matches" : "does not match"), input);
+        return cached->matches;
+    }
+
+    cached->matches = regex_matches(regex, input);
+    cached->id = id;
+    return cached->matches;
+}
@@ -15,10 +15,12 @@
 /* Forward declarations */
 static int *precalculate_sizes(Con *con, render_params *p);
 static void render_root(Con *con, Con *fullscreen);
+static void render_root_floating(Con *con);
 static void render_output(Con *con);
 static void render_con_split(Con *con, Con *child, render_params *p, int i);
 static void render_con_stacked(Con *con, Con *child, render_params *p, int i);
 static void render_con_tabbed(Con *con, Con *child, render_params *p, int i);
+static bool update_shown_tabs(Con *con, render_params *p);
 static void render_con_dockarea(Con *con, Con *child, render_params *p);
 
 /*
@@ -38,6 +40,10 @@ int render_deco_height(void) {
  * side-effect free). As soon as you call x_push_changes(), the changes will be
  * updated in X11.
  *
+ * The children of containers which were not marked dirty (see
+ * con_set_dirty()) and whose rect did not change since the last call keep
+ * their previous positions; they are only raised and rendered recursively.
+ *
  */
 void render_con(Con *con) {
     render_params params = {
@@ -46,8 +52,24 @@ void render_con(Con *con) {
         .y = con->rect.y,
         .children = con_num_children(con)};
 
-    DLOG("Rendering node %p / %s / layout %d / children %d\n", con, con->name,
-         con->layout, params.children);
+    /* Dock clients can change their geometry without going through any of
+     * the functions which mark containers dirty. */
+    bool relayout = (con->dirty ||
+                           con->layout == L_DOCKAREA ||
+                           !rect_equals(con->rect, con->rendered_rect));
+    con->dirty = false;
+    con->rendered_rect = con->rect;
+
+    /* Which tabs are shown depends on the focus, which does not mark any
+     * container dirty. */
+    if (con->layout == L_TABBED && update_shown_tabs(con, &params)) {
+        relayout = true;
+    }
+
+    if (relayout) {
+        DLOG("Rendering node %p / %s / layout %d / children %d\n", con, con->name,
+             con->layout, params.children);
+    }
 
     int i = 0;
     con->mapped = true;
@@ -101,34 +123,51 @@ void render_con(Con *con) {
     params.deco_height = render_deco_height();
 
     /* precalculate the sizes to be able to correct rounding errors */
-    params.sizes = precalculate_sizes(con, &params);
+    if (relayout) {
+        params.sizes = precalculate_sizes(con, &params);
+    }
 
     if (con->layout == L_OUTPUT) {
         /* Skip i3-internal outputs */
         if (con_is_internal(con))
-            goto free_params;
+            return;
         render_output(con);
     } else if (con->type == CT_ROOT) {
         render_root(con, fullscreen);
     } else {
+        if (relayout) {
+            con->num_deco_hits = 0;
+            if (con->layout == L_STACKED || con->layout == L_TABBED) {
+                con->deco_hits = srealloc(con->deco_hits, params.children * sizeof(Con *));
+            } else {
+                FREE(con->deco_hits);
+            }
+        }
+
         Con *child;
         TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
             assert(params.children > 0);
 
-            if (con->layout == L_SPLITH || con->layout == L_SPLITV) {
-                render_con_split(con, child, &params, i);
-            } else if (con->layout == L_STACKED) {
-                render_con_stacked(con, child, &params, i);
-            } else if (con->layout == L_TABBED) {
-                render_con_tabbed(con, child, &params, i);
-            } else if (con->layout == L_DOCKAREA) {
-                render_con_dockarea(con, child, &params);
-            }
+            if (relayout) {
+                if (con->layout == L_SPLITH || con->layout == L_SPLITV) {
+                    render_con_split(con, child, &params, i);
+                } else if (con->layout == L_STACKED) {
+                    render_con_stacked(con, child, &params, i);
+                } else if (con->layout == L_TABBED) {
+                    render_con_tabbed(con, child, &params, i);
+                } else if (con->layout == L_DOCKAREA) {
+                    render_con_dockarea(con, child, &params);
+                }
 
-            child->rect = rect_sanitize_dimensions(child->rect);
+                child->rect = rect_sanitize_dimensions(child->rect);
 
-            DLOG("child at (%d, %d) with (%d x %d)\n",
-                 child->rect.x, child->rect.y, child->rect.width, child->rect.height);
+                if (con->deco_hits != NULL && child->deco_rect.width > 0 && child->deco_rect.height > 0) {
+                    con->deco_hits[con->num_deco_hits++] = child;
+                }
+
+                DLOG("child at (%d, %d) with (%d x %d)\n",
+                     child->rect.x, child->rect.y, child->rect.width, child->rect.height);
+            }
             x_raise_con(child);
             render_con(child);
             i++;
@@ -155,9 +194,28 @@ void render_con(Con *con) {
                 x_raise_con(con);
         }
     }
+}
 
-free_params:
-    FREE(params.sizes);
+/*
+ * Returns whether the child sizes cached in the given split container were
+ * computed for its current size and child percentages.
+ *
+ */
+static bool split_sizes_valid(Con *con, int children, uint32_t total) {
+    if (con->split_sizes == NULL ||
+        con->split_sizes_children != children ||
+        con->split_sizes_total != total) {
+        return false;
+    }
+
+    Con *child;
+    int i = 0;
+    TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
+        if (con->split_sizes_percents[i++] != child->percent) {
+            return false;
+        }
+    }
+    return true;
 }
 
 static int *precalculate_sizes(Con *con, render_params *p) {
@@ -165,14 +223,26 @@ static int *precalculate_sizes(Con *con, render_params *p) {
         return NULL;
     }
 
-    int *sizes = smalloc(p->children * sizeof(int));
     assert(!TAILQ_EMPTY(&con->nodes_head));
 
+    int total = con_rect_size_in_orientation(con);
+    if (split_sizes_valid(con, p->children, total)) {
+        return con->split_sizes;
+    }
+
+    if (con->split_sizes_children != p->children) {
+        con->split_sizes = srealloc(con->split_sizes, p->children * sizeof(int));
+        con->split_sizes_percents = srealloc(con->split_sizes_percents, p->children * sizeof(double));
+        con->split_sizes_children = p->children;
+    }
+    con->split_sizes_total = total;
+    int *sizes = con->split_sizes;
+
     Con *child;
     int i = 0, assigned = 0;
-    int total = con_rect_size_in_orientation(con);
     TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
         double percentage = child->percent > 0.0 ? child->percent : 1.0 / p->children;
+        con->split_sizes_percents[i] = child->percent;
         assigned += sizes[i++] = lround(percentage * total);
     }
     assert(assigned == total ||
@@ -189,6 +259,45 @@ static int *precalculate_sizes(Con *con, render_params *p) {
     return sizes;
 }
 
+/*
+ * Renders only the given (tiling) container and its children. Containers
+ * outside of it keep their positions, so this is cheaper than rendering the
+ * whole tree while e.g. a resize is being previewed. The floating windows are
+ * raised again afterwards to keep them on top of the re-rendered containers.
+ *
+ */
+void render_subtree(Con *con) {
+    render_con(con);
+    render_root_floating(croot);
+}
+
+/*
+ * Returns whether the given output has to be rendered again because one of its
+ * containers was marked dirty or its rect changed.
+ *
+ */
+bool render_output_needed(Con *output) {
+    return output->dirty || !rect_equals(output->rect, output->rendered_rect);
+}
+
+/*
+ * Renders only the outputs for which render_output_needed() is true, followed
+ * by the floating windows of all outputs. The other outputs keep the result
+ * of the previous render. Used by tree_render() after workspace switches.
+ *
+ */
+void render_dirty_outputs(void) {
+    Con *output;
+    TAILQ_FOREACH (output, &(croot->nodes_head), nodes) {
+        if (render_output_needed(output)) {
+            render_con(output);
+        }
+    }
+    croot->dirty = false;
+
+    render_root_floating(croot);
+}
+
 static void render_root(Con *con, Con *fullscreen) {
     Con *output;
     if (!fullscreen) {
@@ -201,6 +310,11 @@ static void render_root(Con *con, Con *fullscreen) {
      * tiling windows because they need to be on top of *every* output at
      * all times. This is important when the user places floating
      * windows/containers so that they overlap on another output. */
+    render_root_floating(con);
+}
+
+static void render_root_floating(Con *con) {
+    Con *output;
     DLOG("Rendering floating windows:\n");
     TAILQ_FOREACH (output, &(con->nodes_head), nodes) {
         if (con_is_internal(output))
@@ -397,15 +511,24 @@ static void render_con_tabbed(Con *con, Con *child, render_params *p, int i) {
     child->rect.width = p->rect.width;
     child->rect.height = p->rect.height;
 
-    child->deco_rect.width = floor((float)child->rect.width / p->children);
-    child->deco_rect.x = p->x - con->rect.x + i * child->deco_rect.width;
-    child->deco_rect.y = p->y - con->rect.y;
-
-    /* Since the tab width may be something like 31,6 px per tab, we
-     * let the last tab have all the extra space (0,6 * children). */
-    if (i == (p->children - 1)) {
-        child->deco_rect.width = child->rect.width - child->deco_rect.x;
+    /* Tabs which are not shown get an empty title bar, which is neither drawn
+     * nor clickable. */
+    const int shown = i - p->tabs_first;
+    child->tabs_hidden_before = (shown == 0 ? p->tabs_first : 0);
+    child->tabs_hidden_after = (shown == p->tabs_shown - 1 ? p->children - p->tabs_first - p->tabs_shown : 0);
+    if (shown < 0 || shown >= p->tabs_shown) {
+        child->deco_rect.width = 0;
+        child->deco_rect.x = p->x - con->rect.x;
+    } else {
+        child->deco_rect.width = floor((float)child->rect.width / p->tabs_shown);
+        child->deco_rect.x = p->x - con->rect.x + shown * child->deco_rect.width;
+        /* Since the tab width may be something like 31,6 px per tab, we
+         * let the last tab have all the extra space (0,6 * children). */
+        if (shown == p->tabs_shown - 1) {
+            child->deco_rect.width = child->rect.width - child->deco_rect.x;
+        }
     }
+    child->deco_rect.y = p->y - con->rect.y;
 
     if (p->children > 1 || (child->border_style != BS_PIXEL && child->border_style != BS_NONE)) {
         child->rect.y += p->deco_height;
@@ -416,6 +539,47 @@ static void render_con_tabbed(Con *con, Con *child, render_params *p, int i) {
     }
 }
 
+/*
+ * Decides which tabs of the tabbed container are shown: all of them, unless
+ * they would be narrower than tab_min_width. In that case, the shown range
+ * scrolls just far enough to contain the focused tab. Returns true if the
+ * range changed since the last render.
+ *
+ */
+static bool update_shown_tabs(Con *con, render_params *p) {
+    int first = 0;
+    int shown = p->children;
+    if (config.tab_min_width > 0 && p->children > 1 &&
+        (int)p->rect.width / p->children < config.tab_min_width) {
+        shown = max(1, (int)p->rect.width / config.tab_min_width);
+
+        int focused_index = 0;
+        Con *child;
+        Con *focused_child = TAILQ_FIRST(&(con->focus_head));
+        TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
+            if (child == focused_child) {
+                break;
+            }
+            focused_index++;
+        }
+
+        first = con->tabs_first;
+        if (focused_index < first) {
+            first = focused_index;
+        } else if (focused_index >= first + shown) {
+            first = focused_index - shown + 1;
+        }
+        first = max(0, min(first, p->children - shown));
+    }
+
+    p->tabs_first = first;
+    p->tabs_shown = shown;
+    const bool changed = (con->tabs_first != first || con->tabs_shown != shown);
+    con->tabs_first = first;
+    con->tabs_shown = shown;
+    return changed;
+}
+
 static void render_con_dockarea(Con *con, Con *child, render_params *p) {
     assert(con->layout == L_DOCKAREA);
 
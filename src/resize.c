@@ -22,8 +22,42 @@ struct callback_params {
     xcb_window_t helpwin;
     uint32_t *new_position;
     bool *threshold_exceeded;
+
+    /* For live_resize: the two containers being resized, their percentages
+     * when the drag started and the position the resize bar started at. */
+    Con *first;
+    Con *second;
+    double first_percent;
+    double second_percent;
+    uint32_t initial_position;
 };
 
+/*
+ * Resizes the two containers according to the current position of the resize
+ * bar, starting from their original sizes, and renders only their parent.
+ *
+ */
+static void resize_preview(const struct callback_params *params) {
+    /* Events are still handled while dragging, so either container might
+     * have been closed or moved in the meantime. */
+    if (!con_exists(params->first) || !con_exists(params->second) ||
+        params->first->parent != params->second->parent) {
+        return;
+    }
+
+    params->first->percent = params->first_percent;
+    params->second->percent = params->second_percent;
+    con_set_dirty(params->first->parent);
+
+    const int pixels = (*params->new_position - params->initial_position);
+    if (pixels != 0) {
+        resize_neighboring_cons(params->first, params->second, pixels, 0);
+    }
+
+    render_subtree(params->first->parent);
+    x_push_changes(croot);
+}
+
 DRAGGING_CB(resize_callback) {
     const struct callback_params *params = extra;
     Con *output = params->output;
@@ -64,6 +98,10 @@ DRAGGING_CB(resize_callback) {
         xcb_configure_window(conn, params->helpwin, XCB_CONFIG_WINDOW_Y, params->new_position);
     }
 
+    if (params->first != NULL) {
+        resize_preview(params);
+    }
+
     xcb_flush(conn);
 }
 
@@ -236,7 +274,14 @@ void resize_graphical_handler(Con *first, Con *second, orientation_t orientation
 
     bool threshold_exceeded = !use_threshold;
 
-    const struct callback_params params = {orientation, output, helpwin, &new_position, &threshold_exceeded};
+    struct callback_params params = {orientation, output, helpwin, &new_position, &threshold_exceeded};
+    if (config.live_resize) {
+        params.first = first;
+        params.second = second;
+        params.first_percent = first->percent;
+        params.second_percent = second->percent;
+        params.initial_position = initial_position;
+    }
 
     /* Re-render the tree before returning to the event loop (drag_pointer()
      * runs its own event-loop) in case if there are unrendered updates. */
@@ -249,6 +294,13 @@ void resize_graphical_handler(Con *first, Con *second, orientation_t orientation
     xcb_destroy_window(conn, grabwin);
     xcb_flush(conn);
 
+    /* Undo the preview, the final resize is applied below. */
+    if (config.live_resize && con_exists(first) && con_exists(second)) {
+        first->percent = params.first_percent;
+        second->percent = params.second_percent;
+        con_set_dirty(first->parent);
+    }
+
     /* User cancelled the drag so no action should be taken. */
     if (drag_result == DRAG_REVERT) {
         return;
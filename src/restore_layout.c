@@ -26,15 +26,29 @@ typedef struct placeholder_state {
     /** Current size of the placeholder window (to detect size changes). */
     Rect rect;
 
-    /** The drawable surface */
+    /** The drawable surface. It is only created when the placeholder is
+     * exposed for the first time, since many placeholders are never visible
+     * before their window gets swallowed. */
     surface_t surface;
 
+    /** The serialized swallow criteria, one line per Match. Built together
+     * with the surface. */
+    i3String **lines;
+    int num_lines;
+
+    /** The request which created the window, checked once the whole batch of
+     * placeholders has been created. */
+    xcb_void_cookie_t cookie;
+
     TAILQ_ENTRY(placeholder_state) state;
 } placeholder_state;
 
 static TAILQ_HEAD(state_head, placeholder_state) state_head =
     TAILQ_HEAD_INITIALIZER(state_head);
 
+/* The watch symbol which all placeholders display. */
+static i3String *watch_symbol;
+
 static xcb_connection_t *restore_conn;
 
 static struct ev_io *xcb_watcher;
@@ -42,6 +56,14 @@ static struct ev_prepare *xcb_prepare;
 
 static void restore_handle_event(int type, xcb_generic_event_t *event);
 
+static void placeholder_state_free(placeholder_state *state) {
+    for (int i = 0; i < state->num_lines; i++) {
+        i3string_free(state->lines[i]);
+    }
+    free(state->lines);
+    free(state);
+}
+
 /* Documentation for these functions can be found in src/main.c, starting at xcb_got_event */
 static void restore_xcb_got_event(EV_P_ struct ev_io *w, int revents) {
 }
@@ -93,7 +115,7 @@ void restore_connect(void) {
         while (!TAILQ_EMPTY(&state_head)) {
             state = TAILQ_FIRST(&state_head);
             TAILQ_REMOVE(&state_head, state, state);
-            free(state);
+            placeholder_state_free(state);
         }
 
         /* xcb_disconnect leaks memory in libxcb versions earlier than 1.11,
@@ -127,32 +149,35 @@ void restore_connect(void) {
     ev_prepare_start(main_loop, xcb_prepare);
 }
 
-static void update_placeholder_contents(placeholder_state *state) {
-    const color_t foreground = config.client.placeholder.text;
-    const color_t background = config.client.placeholder.background;
-
-    draw_util_clear_surface(&(state->surface), background);
-
-    // TODO: make i3font functions per-connection, at least these two for now…?
-    xcb_aux_sync(restore_conn);
-
+/*
+ * Serializes the swallow criteria of the placeholder's container, one line
+ * per Match.
+ *
+ */
+static void serialize_swallows(placeholder_state *state) {
     Match *swallows;
-    int n = 0;
-    TAILQ_FOREACH (swallows, &(state->con->swallow_head), matches) {
+    TAILQ_FOREACH (swallows, &(state->con->cold->swallow_head), matches) {
+        /* Skip the temporary match for the placeholder window itself. */
+        struct match_criterion *id = match_get(swallows, CRIT_ID);
+        if (id != NULL && id->id == state->window) {
+            continue;
+        }
+
         char *serialized = NULL;
 
-#define APPEND_REGEX(re_name)                                                                                                                        \
-    do {                                                                                                                                             \
-        if (swallows->re_name != NULL) {                                                                                                             \
-            sasprintf(&serialized, "%s%s" #re_name "=\"%s\"", (serialized ? serialized : "["), (serialized ? " " : ""), swallows->re_name->pattern); \
-        }                                                                                                                                            \
+#define APPEND_REGEX(re_name, type)                                                                                                         \
+    do {                                                                                                                                    \
+        struct regex *regex = match_get_regex(swallows, type);                                                                              \
+        if (regex != NULL) {                                                                                                                \
+            sasprintf(&serialized, "%s%s" #re_name "=\"%s\"", (serialized ? serialized : "["), (serialized ? " " : ""), regex->pattern); \
+        }                                                                                                                                   \
     } while (0)
 
-        APPEND_REGEX(class);
-        APPEND_REGEX(instance);
-        APPEND_REGEX(window_role);
-        APPEND_REGEX(title);
-        APPEND_REGEX(machine);
+        APPEND_REGEX(class, CRIT_CLASS);
+        APPEND_REGEX(instance, CRIT_INSTANCE);
+        APPEND_REGEX(window_role, CRIT_WINDOW_ROLE);
+        APPEND_REGEX(title, CRIT_TITLE);
+        APPEND_REGEX(machine, CRIT_MACHINE);
 
         if (serialized == NULL) {
             DLOG("This swallows specification is not serializable?!\n");
@@ -160,46 +185,72 @@ static void update_placeholder_contents(placeholder_state *state) {
         }
 
         sasprintf(&serialized, "%s]", serialized);
-        DLOG("con %p (placeholder 0x%08x) line %d: %s\n", state->con, state->window, n, serialized);
+        DLOG("con %p (placeholder 0x%08x) line %d: %s\n", state->con, state->window, state->num_lines, serialized);
+
+        state->lines = srealloc(state->lines, (state->num_lines + 1) * sizeof(i3String *));
+        state->lines[state->num_lines++] = i3string_from_utf8(serialized);
+        free(serialized);
+    }
+}
 
-        i3String *str = i3string_from_utf8(serialized);
-        draw_util_text(str, &(state->surface), foreground, background,
+static void update_placeholder_contents(placeholder_state *state) {
+    const color_t foreground = config.client.placeholder.text;
+    const color_t background = config.client.placeholder.background;
+
+    if (state->surface.id == XCB_NONE) {
+        draw_util_surface_init(restore_conn, &(state->surface), state->window, get_visualtype(root_screen), state->rect.width, state->rect.height);
+        serialize_swallows(state);
+    }
+
+    draw_util_clear_surface(&(state->surface), background);
+
+    // TODO: make i3font functions per-connection, at least these two for now…?
+    xcb_aux_sync(restore_conn);
+
+    for (int n = 0; n < state->num_lines; n++) {
+        draw_util_text(state->lines[n], &(state->surface), foreground, background,
                        TEXT_PADDING,
                        (n * (config.font.height + TEXT_PADDING)) + TEXT_PADDING,
                        state->rect.width - 2 * TEXT_PADDING);
-        i3string_free(str);
-        n++;
-        free(serialized);
     }
 
     // TODO: render the watch symbol in a bigger font
-    i3String *line = i3string_from_utf8("⌚");
-    int text_width = predict_text_width(line);
+    if (watch_symbol == NULL) {
+        watch_symbol = i3string_from_utf8("⌚");
+    }
+    int text_width = predict_text_width(watch_symbol);
     int x = (state->rect.width / 2) - (text_width / 2);
     int y = (state->rect.height / 2) - (config.font.height / 2);
-    draw_util_text(line, &(state->surface), foreground, background, x, y, text_width);
-    i3string_free(line);
+    draw_util_text(watch_symbol, &(state->surface), foreground, background, x, y, text_width);
     xcb_aux_sync(restore_conn);
 }
 
 static void open_placeholder_window(Con *con) {
     if (con_is_leaf(con) &&
         (con->window == NULL || con->window->id == XCB_NONE) &&
-        !TAILQ_EMPTY(&(con->swallow_head)) &&
+        !TAILQ_EMPTY(&(con->cold->swallow_head)) &&
         con->type == CT_CON) {
-        xcb_window_t placeholder = create_window(
+        /* Unlike create_window(), this does not wait for the result of each
+         * request: restore_open_placeholder_windows() checks them all at
+         * once. The background pixel keeps the placeholder looking right
+         * until its contents are drawn on the first Expose. */
+        xcb_window_t placeholder = xcb_generate_id(restore_conn);
+        xcb_void_cookie_t cookie = xcb_create_window_checked(
             restore_conn,
-            con->rect,
-            XCB_COPY_FROM_PARENT,
             XCB_COPY_FROM_PARENT,
+            placeholder,
+            root,
+            con->rect.x, con->rect.y, con->rect.width, con->rect.height,
+            0,
             XCB_WINDOW_CLASS_INPUT_OUTPUT,
-            XCURSOR_CURSOR_POINTER,
-            true,
-            XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK,
+            XCB_COPY_FROM_PARENT,
+            XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK | XCB_CW_CURSOR,
             (uint32_t[]){
                 config.client.placeholder.background.colorpixel,
                 XCB_EVENT_MASK_EXPOSURE | XCB_EVENT_MASK_STRUCTURE_NOTIFY,
+                xcursor_get_cursor(XCURSOR_CURSOR_POINTER),
             });
+        xcb_map_window(restore_conn, placeholder);
         /* Make i3 not focus this window. */
         xcb_icccm_wm_hints_t hints;
         xcb_icccm_wm_hints_set_none(&hints);
@@ -218,17 +269,15 @@ static void open_placeholder_window(Con *con) {
         state->window = placeholder;
         state->con = con;
         state->rect = con->rect;
-
-        draw_util_surface_init(restore_conn, &(state->surface), placeholder, get_visualtype(root_screen), state->rect.width, state->rect.height);
-        update_placeholder_contents(state);
+        state->cookie = cookie;
         TAILQ_INSERT_TAIL(&state_head, state, state);
 
         /* create temporary id swallow to match the placeholder */
-        Match *temp_id = smalloc(sizeof(Match));
+        Match *temp_id = pool_alloc(&match_pool);
         match_init(temp_id);
         temp_id->dock = M_DONTCHECK;
-        temp_id->id = placeholder;
-        TAILQ_INSERT_HEAD(&(con->swallow_head), temp_id, matches);
+        match_set(temp_id, CRIT_ID)->id = placeholder;
+        con_add_swallow(con, temp_id, true);
     }
 
     Con *child;
@@ -248,6 +297,8 @@ static void open_placeholder_window(Con *con) {
  *
  */
 void restore_open_placeholder_windows(Con *parent) {
+    placeholder_state *last = TAILQ_LAST(&state_head, state_head);
+
     Con *child;
     TAILQ_FOREACH (child, &(parent->nodes_head), nodes) {
         open_placeholder_window(child);
@@ -256,6 +307,17 @@ void restore_open_placeholder_windows(Con *parent) {
         open_placeholder_window(child);
     }
 
+    /* Check the results of the whole batch with a single round trip. */
+    placeholder_state *state = (last ? TAILQ_NEXT(last, state) : TAILQ_FIRST(&state_head));
+    for (; state != NULL; state = TAILQ_NEXT(state, state)) {
+        xcb_generic_error_t *error = xcb_request_check(restore_conn, state->cookie);
+        if (error != NULL) {
+            ELOG("Could not create placeholder window 0x%08x. Error code: %d.\n",
+                 state->window, error->error_code);
+            free(error);
+        }
+    }
+
     xcb_flush(restore_conn);
 }
 
@@ -273,9 +335,11 @@ bool restore_kill_placeholder(xcb_window_t placeholder) {
             continue;
 
         xcb_destroy_window(restore_conn, state->window);
-        draw_util_surface_free(restore_conn, &(state->surface));
+        if (state->surface.id != XCB_NONE) {
+            draw_util_surface_free(restore_conn, &(state->surface));
+        }
         TAILQ_REMOVE(&state_head, state, state);
-        free(state);
+        placeholder_state_free(state);
         DLOG("placeholder window 0x%08x destroyed.\n", placeholder);
         return true;
     }
@@ -318,6 +382,12 @@ static void configure_notify(xcb_configure_notify_event_t *event) {
         state->rect.width = event->width;
         state->rect.height = event->height;
 
+        /* Placeholders which were never exposed are drawn on their first
+         * Expose, with the new size. */
+        if (state->surface.id == XCB_NONE) {
+            return;
+        }
+
         draw_util_surface_set_size(&(state->surface), state->rect.width, state->rect.height);
 
         update_placeholder_contents(state);
@@ -65,14 +65,30 @@ void scratchpad_move(Con *con) {
         DLOG("This window was never used as a scratchpad before.\n");
         if (con == maybe_floating_con) {
             DLOG("It was in floating mode before, set scratchpad state to changed.\n");
-            con->scratchpad_state = SCRATCHPAD_CHANGED;
+            con_set_scratchpad_state(con, SCRATCHPAD_CHANGED);
         } else {
             DLOG("It was in tiling mode before, set scratchpad state to fresh.\n");
-            con->scratchpad_state = SCRATCHPAD_FRESH;
+            con_set_scratchpad_state(con, SCRATCHPAD_FRESH);
         }
     }
 }
 
+/*
+ * Returns the container created first out of con and its descendants.
+ *
+ */
+static Con *scratchpad_oldest_con(Con *con) {
+    Con *oldest = con;
+    Con *child;
+    TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
+        Con *candidate = scratchpad_oldest_con(child);
+        if (candidate->creation_order < oldest->creation_order) {
+            oldest = candidate;
+        }
+    }
+    return oldest;
+}
+
 /*
  * Either shows the top-most scratchpad window (con == NULL) or shows the
  * specified con (if it is scratchpad window).
@@ -130,16 +146,31 @@ bool scratchpad_show(Con *con) {
      * visible scratchpad window on another workspace. In this case we move it
      * to the current workspace. */
     focused_ws = con_get_workspace(focused);
-    TAILQ_FOREACH (walk_con, &all_cons, all_cons) {
-        Con *walk_ws = con_get_workspace(walk_con);
-        if (!con && walk_ws &&
-            !con_is_internal(walk_ws) && focused_ws != walk_ws &&
-            (floating = con_inside_floating(walk_con)) &&
-            floating->scratchpad_state != SCRATCHPAD_NONE) {
+    if (!con) {
+        /* Of all candidates, pick the scratchpad container with the oldest
+         * container in it, like walking all_cons would. */
+        Con *found = NULL;
+        Con *oldest = NULL;
+        size_t num;
+        Con **scratchpad = con_scratchpad_cons(&num);
+        for (size_t i = 0; i < num; i++) {
+            floating = scratchpad[i];
+            Con *walk_ws = con_get_workspace(floating);
+            if (floating->type != CT_FLOATING_CON || !walk_ws ||
+                con_is_internal(walk_ws) || focused_ws == walk_ws) {
+                continue;
+            }
+            Con *candidate = scratchpad_oldest_con(floating);
+            if (oldest == NULL || candidate->creation_order < oldest->creation_order) {
+                found = floating;
+                oldest = candidate;
+            }
+        }
+        if (found != NULL) {
             DLOG("Found a visible scratchpad window on another workspace,\n");
-            DLOG("moving it to this workspace: con = %p\n", walk_con);
-            con_move_to_workspace(floating, focused_ws, true, false, false);
-            con_activate(con_descend_focused(walk_con));
+            DLOG("moving it to this workspace: con = %p\n", oldest);
+            con_move_to_workspace(found, focused_ws, true, false, false);
+            con_activate(con_descend_focused(oldest));
             return true;
         }
     }
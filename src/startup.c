@@ -24,75 +24,119 @@
 static TAILQ_HEAD(startup_sequence_head, Startup_Sequence) startup_sequences =
     TAILQ_HEAD_INITIALIZER(startup_sequences);
 
+/* The startup sequences by id and by the PID of the started process (as far
+ * as the launcher reported it). */
+static hashmap_t *sequences_by_id;
+static hashmap_t *sequences_by_pid;
+
+/* The sequences which are waiting for their timeout, ordered by timeout_at,
+ * and the completed ones, ordered by delete_at. As both delays are constant,
+ * appending keeps the lists sorted and a single timer for the earliest
+ * deadline expires all sequences. */
+static TAILQ_HEAD(startup_expiry_head, Startup_Sequence) startup_timeouts =
+    TAILQ_HEAD_INITIALIZER(startup_timeouts);
+static struct startup_expiry_head startup_deletions =
+    TAILQ_HEAD_INITIALIZER(startup_deletions);
+static struct ev_timer *expiry_timer;
+
+/* The number of sequences which are not marked for deletion yet */
+static int active_sequences;
+
+static void startup_expiry_cb(EV_P_ ev_timer *w, int revents);
+
+/* Completed sequences are deleted while i3 is idle, this many per run. */
+#define STARTUP_DELETIONS_PER_RUN 16
+
+static bool delete_expired_sequences(maintenance_task *task);
+static maintenance_task deletion_task = MAINTENANCE_TASK_INITIALIZER("startup_sequences", delete_expired_sequences);
+
+static struct Startup_Sequence *startup_sequence_by_id(const char *id) {
+    return (sequences_by_id ? hashmap_lookup_str(sequences_by_id, id) : NULL);
+}
+
 /*
- * After 60 seconds, a timeout will be triggered for each startup sequence.
- *
- * The timeout will just trigger completion of the sequence, so the normal
- * completion process takes place (startup_monitor_event will free it).
+ * (Re-)arms the timer for the earliest timeout or deletion. Deletions which
+ * are due already are queued for the next time i3 is idle.
  *
  */
-static void startup_timeout(EV_P_ ev_timer *w, int revents) {
-    const char *id = sn_launcher_context_get_startup_id(w->data);
-    DLOG("Timeout for startup sequence %s\n", id);
-
-    struct Startup_Sequence *current, *sequence = NULL;
-    TAILQ_FOREACH (current, &startup_sequences, sequences) {
-        if (strcmp(current->id, id) != 0)
-            continue;
-
-        sequence = current;
-        break;
+static void schedule_expiry(void) {
+    const time_t current_time = time(NULL);
+    time_t next = 0;
+    if (!TAILQ_EMPTY(&startup_timeouts)) {
+        next = TAILQ_FIRST(&startup_timeouts)->timeout_at;
+    }
+    if (!TAILQ_EMPTY(&startup_deletions)) {
+        /* Sequences are deleted once delete_at has passed. */
+        const time_t deletion = TAILQ_FIRST(&startup_deletions)->delete_at + 1;
+        if (deletion <= current_time) {
+            maintenance_schedule(&deletion_task);
+        } else if (next == 0 || deletion < next) {
+            next = deletion;
+        }
     }
 
-    /* Unref the context (for the timeout itself, see start_application) */
-    sn_launcher_context_unref(w->data);
-
-    if (!sequence) {
-        DLOG("Sequence already deleted, nevermind.\n");
-        free(w);
+    if (expiry_timer == NULL) {
+        expiry_timer = scalloc(1, sizeof(struct ev_timer));
+        ev_timer_init(expiry_timer, startup_expiry_cb, 0., 0.);
+    }
+    ev_timer_stop(main_loop, expiry_timer);
+    if (next == 0) {
         return;
     }
-
-    /* Complete the startup sequence, will trigger its deletion. */
-    sn_launcher_context_complete(w->data);
-    free(w);
+    ev_timer_set(expiry_timer, MAX(0., difftime(next, current_time)), 0.);
+    ev_timer_start(main_loop, expiry_timer);
 }
 
 /*
  * Some applications (such as Firefox) mark a startup sequence as completed
  * *before* they even map a window. Therefore, we cannot entirely delete the
  * startup sequence once it’s marked as complete. Instead, we’ll mark it for
- * deletion in 30 seconds and use that chance to delete old sequences.
- *
- * This function returns the number of active (!) startup notifications, that
- * is, those which are not marked for deletion yet. This is used for changing
- * the root window cursor.
+ * deletion in 30 seconds and delete it (from the maintenance queue) after
+ * that.
  *
  */
-static int _prune_startup_sequences(void) {
+static bool delete_expired_sequences(maintenance_task *task) {
     time_t current_time = time(NULL);
-    int active_sequences = 0;
-
-    /* Traverse the list and delete everything which was marked for deletion 30
-     * seconds ago or earlier. */
-    struct Startup_Sequence *current, *next;
-    for (next = TAILQ_FIRST(&startup_sequences);
-         next != TAILQ_END(&startup_sequences);) {
-        current = next;
-        next = TAILQ_NEXT(next, sequences);
-
-        if (current->delete_at == 0) {
-            active_sequences++;
-            continue;
+
+    /* Delete everything which was marked for deletion 30 seconds ago or
+     * earlier. The list is sorted, so this stops at the first sequence which
+     * has to stay. */
+    int deleted = 0;
+    struct Startup_Sequence *sequence;
+    while ((sequence = TAILQ_FIRST(&startup_deletions)) != NULL &&
+           current_time > sequence->delete_at) {
+        if (deleted == STARTUP_DELETIONS_PER_RUN) {
+            return true;
         }
+        startup_sequence_delete(sequence);
+        deleted++;
+    }
 
-        if (current_time <= current->delete_at)
-            continue;
+    schedule_expiry();
+    return false;
+}
 
-        startup_sequence_delete(current);
+/*
+ * After 60 seconds, a timeout will be triggered for each startup sequence.
+ *
+ * The timeout will just trigger completion of the sequence, so the normal
+ * completion process takes place (startup_monitor_event will free it).
+ *
+ */
+static void startup_expiry_cb(EV_P_ ev_timer *w, int revents) {
+    time_t current_time = time(NULL);
+    struct Startup_Sequence *sequence;
+    while ((sequence = TAILQ_FIRST(&startup_timeouts)) != NULL &&
+           current_time >= sequence->timeout_at) {
+        DLOG("Timeout for startup sequence %s\n", sequence->id);
+        TAILQ_REMOVE(&startup_timeouts, sequence, expiry);
+        sequence->timeout_pending = false;
+
+        /* Complete the startup sequence, will trigger its deletion. */
+        sn_launcher_context_complete(sequence->context);
     }
 
-    return active_sequences;
+    schedule_expiry();
 }
 
 /*
@@ -109,8 +153,21 @@ void startup_sequence_delete(struct Startup_Sequence *sequence) {
     /* Unref the context, will be free()d */
     sn_launcher_context_unref(sequence->context);
 
-    /* Delete our internal sequence */
+    /* Delete our internal sequence. The timer is not touched, it might just
+     * fire without anything to do. */
     TAILQ_REMOVE(&startup_sequences, sequence, sequences);
+    if (sequence->delete_at != 0) {
+        TAILQ_REMOVE(&startup_deletions, sequence, expiry);
+    } else {
+        active_sequences--;
+        if (sequence->timeout_pending) {
+            TAILQ_REMOVE(&startup_timeouts, sequence, expiry);
+        }
+    }
+    hashmap_remove_str(sequences_by_id, sequence->id);
+    if (sequence->pid != 0 && hashmap_lookup(sequences_by_pid, sequence->pid) == sequence) {
+        hashmap_remove(sequences_by_pid, sequence->pid);
+    }
 
     free(sequence->id);
     free(sequence->workspace);
@@ -118,10 +175,11 @@ void startup_sequence_delete(struct Startup_Sequence *sequence) {
 }
 
 /*
- * Starts the given application by passing it through a shell. We use double
- * fork to avoid zombie processes. As the started application’s parent exits
- * (immediately), the application is reparented to init (process-id 1), which
- * correctly handles children, so we don’t have to do it :-).
+ * Starts the given application by passing it through a shell. The launcher
+ * process (see launcher.c) spawns it if it is running. Otherwise, we use
+ * double fork to avoid zombie processes. As the started application’s parent
+ * exits (immediately), the application is reparented to init (process-id 1),
+ * which correctly handles children, so we don’t have to do it :-).
  *
  * The shell used to start applications is the system's bourne shell (i.e.,
  * /bin/sh).
@@ -148,12 +206,6 @@ void start_application(const char *command, bool no_startup_id) {
         sn_launcher_context_initiate(context, "i3", first_word, last_timestamp);
         free(first_word);
 
-        /* Trigger a timeout after 60 seconds */
-        struct ev_timer *timeout = scalloc(1, sizeof(struct ev_timer));
-        ev_timer_init(timeout, startup_timeout, 60.0, 0.);
-        timeout->data = context;
-        ev_timer_start(main_loop, timeout);
-
         LOG("startup id = %s\n", sn_launcher_context_get_startup_id(context));
 
         /* Save the ID and current workspace in our internal list of startup
@@ -164,40 +216,50 @@ void start_application(const char *command, bool no_startup_id) {
         sequence->workspace = sstrdup(ws->name);
         sequence->context = context;
         TAILQ_INSERT_TAIL(&startup_sequences, sequence, sequences);
+        if (sequences_by_id == NULL) {
+            sequences_by_id = hashmap_new();
+            sequences_by_pid = hashmap_new();
+        }
+        hashmap_insert_str(sequences_by_id, sequence->id, sequence);
+        active_sequences++;
 
-        /* Increase the refcount once (it starts with 1, so it will be 2 now) for
-         * the timeout. Even if the sequence gets completed, the timeout still
-         * needs the context (but will unref it then) */
-        sn_launcher_context_ref(context);
+        /* Trigger a timeout after 60 seconds */
+        sequence->timeout_at = time(NULL) + 60;
+        sequence->timeout_pending = true;
+        TAILQ_INSERT_TAIL(&startup_timeouts, sequence, expiry);
+        schedule_expiry();
     }
 
     LOG("executing: %s\n", command);
-    if (fork() == 0) {
-        /* Child process */
-        setsid();
-        setrlimit(RLIMIT_CORE, &original_rlimit_core);
-        /* Close all socket activation file descriptors explicitly, we disabled
-         * FD_CLOEXEC to keep them open when restarting i3. */
-        for (int fd = SD_LISTEN_FDS_START;
-             fd < (SD_LISTEN_FDS_START + listen_fds);
-             fd++) {
-            close(fd);
-        }
-        unsetenv("LISTEN_PID");
-        unsetenv("LISTEN_FDS");
-        signal(SIGPIPE, SIG_DFL);
+    const char *startup_id = (no_startup_id ? NULL : sn_launcher_context_get_startup_id(context));
+    if (!launcher_exec(command, startup_id)) {
         if (fork() == 0) {
-            /* Setup the environment variable(s) */
-            if (!no_startup_id)
-                sn_launcher_context_setup_child_process(context);
-            setenv("I3SOCK", current_socketpath, 1);
-
-            execl(_PATH_BSHELL, _PATH_BSHELL, "-c", command, NULL);
-            /* not reached */
+            /* Child process */
+            setsid();
+            setrlimit(RLIMIT_CORE, &original_rlimit_core);
+            /* Close all socket activation file descriptors explicitly, we disabled
+             * FD_CLOEXEC to keep them open when restarting i3. */
+            for (int fd = SD_LISTEN_FDS_START;
+                 fd < (SD_LISTEN_FDS_START + listen_fds);
+                 fd++) {
+                close(fd);
+            }
+            unsetenv("LISTEN_PID");
+            unsetenv("LISTEN_FDS");
+            signal(SIGPIPE, SIG_DFL);
+            if (fork() == 0) {
+                /* Setup the environment variable(s) */
+                if (!no_startup_id)
+                    sn_launcher_context_setup_child_process(context);
+                setenv("I3SOCK", current_socketpath, 1);
+
+                execl(_PATH_BSHELL, _PATH_BSHELL, "-c", command, NULL);
+                /* not reached */
+            }
+            _exit(EXIT_SUCCESS);
         }
-        _exit(EXIT_SUCCESS);
+        wait(0);
     }
-    wait(0);
 
     if (!no_startup_id) {
         /* Change the pointer of the root window to indicate progress */
@@ -216,15 +278,7 @@ void startup_monitor_event(SnMonitorEvent *event, void *userdata) {
 
     /* Get the corresponding internal startup sequence */
     const char *id = sn_startup_sequence_get_id(snsequence);
-    struct Startup_Sequence *current, *sequence = NULL;
-    TAILQ_FOREACH (current, &startup_sequences, sequences) {
-        if (strcmp(current->id, id) != 0)
-            continue;
-
-        sequence = current;
-        break;
-    }
-
+    struct Startup_Sequence *sequence = startup_sequence_by_id(id);
     if (!sequence) {
         DLOG("Got event for startup sequence that we did not initiate (ID = %s). Ignoring.\n", id);
         return;
@@ -235,12 +289,25 @@ void startup_monitor_event(SnMonitorEvent *event, void *userdata) {
             DLOG("startup sequence %s completed\n", sn_startup_sequence_get_id(snsequence));
 
             /* Mark the given sequence for deletion in 30 seconds. */
+            if (sequence->delete_at != 0) {
+                TAILQ_REMOVE(&startup_deletions, sequence, expiry);
+            } else {
+                active_sequences--;
+                if (sequence->timeout_pending) {
+                    TAILQ_REMOVE(&startup_timeouts, sequence, expiry);
+                    sequence->timeout_pending = false;
+                }
+            }
             time_t current_time = time(NULL);
             sequence->delete_at = current_time + 30;
+            TAILQ_INSERT_TAIL(&startup_deletions, sequence, expiry);
+            schedule_expiry();
             DLOG("Will delete startup sequence %s at timestamp %lld\n",
                  sequence->id, (long long)sequence->delete_at);
 
-            if (_prune_startup_sequences() == 0) {
+            /* The number of sequences which are not marked for deletion
+             * decides the root window cursor. */
+            if (active_sequences == 0) {
                 DLOG("No more startup sequences running, changing root window cursor to default pointer.\n");
                 /* Change the pointer of the root window to indicate progress */
                 xcursor_set_root_cursor(XCURSOR_CURSOR_POINTER);
@@ -252,6 +319,21 @@ void startup_monitor_event(SnMonitorEvent *event, void *userdata) {
     }
 }
 
+/*
+ * Remembers the PID of the process started for the given startup sequence,
+ * so that windows without _NET_STARTUP_ID can be matched by their
+ * _NET_WM_PID.
+ *
+ */
+void startup_sequence_set_pid(const char *id, pid_t pid) {
+    struct Startup_Sequence *sequence = startup_sequence_by_id(id);
+    if (sequence == NULL || pid <= 0) {
+        return;
+    }
+    sequence->pid = pid;
+    hashmap_insert(sequences_by_pid, pid, sequence);
+}
+
 /*
  * Renames workspaces that are mentioned in the startup sequences.
  *
@@ -269,7 +351,25 @@ void startup_sequence_rename_workspace(const char *old_name, const char *new_nam
 }
 
 /*
- * Gets the stored startup sequence for the _NET_STARTUP_ID of a given window.
+ * Looks up the startup sequence of a window without _NET_STARTUP_ID by its
+ * _NET_WM_PID.
+ *
+ */
+static struct Startup_Sequence *startup_sequence_by_pid(i3Window *cwindow) {
+    if (cwindow->pid == 0 || sequences_by_pid == NULL) {
+        return NULL;
+    }
+    struct Startup_Sequence *sequence = hashmap_lookup(sequences_by_pid, cwindow->pid);
+    if (sequence != NULL) {
+        DLOG("Found startup sequence %s by _NET_WM_PID %d\n", sequence->id, cwindow->pid);
+    }
+    return sequence;
+}
+
+/*
+ * Gets the stored startup sequence for the _NET_STARTUP_ID of a given window
+ * (or of its leader). If neither has one, the sequence is looked up by the
+ * window's _NET_WM_PID.
  *
  */
 struct Startup_Sequence *startup_sequence_get(i3Window *cwindow,
@@ -280,7 +380,7 @@ struct Startup_Sequence *startup_sequence_get(i3Window *cwindow,
         FREE(startup_id_reply);
         DLOG("No _NET_STARTUP_ID set on window 0x%08x\n", cwindow->id);
         if (cwindow->leader == XCB_NONE)
-            return NULL;
+            return startup_sequence_by_pid(cwindow);
 
         /* This is a special case that causes the leader's startup sequence
          * to only be returned if it has never been mapped, useful primarily
@@ -306,22 +406,14 @@ struct Startup_Sequence *startup_sequence_get(i3Window *cwindow,
             xcb_get_property_value_length(startup_id_reply) == 0) {
             FREE(startup_id_reply);
             DLOG("No _NET_STARTUP_ID set on the leader either\n");
-            return NULL;
+            return startup_sequence_by_pid(cwindow);
         }
     }
 
     char *startup_id;
     sasprintf(&startup_id, "%.*s", xcb_get_property_value_length(startup_id_reply),
               (char *)xcb_get_property_value(startup_id_reply));
-    struct Startup_Sequence *current, *sequence = NULL;
-    TAILQ_FOREACH (current, &startup_sequences, sequences) {
-        if (strcmp(current->id, startup_id) != 0)
-            continue;
-
-        sequence = current;
-        break;
-    }
-
+    struct Startup_Sequence *sequence = startup_sequence_by_id(startup_id);
     if (!sequence) {
         DLOG("WARNING: This sequence (ID %s) was not found\n", startup_id);
         free(startup_id);
@@ -0,0 +1,609 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * stats.c: Performance counters and latency histograms, reported via the
+ *          GET_STATS IPC message and the stats event.
+ *
+ */
+#include "all.h"
+#include "yajl_utils.h"
+
+#include <inttypes.h>
+#include <time.h>
+
+/* Upper bounds (in microseconds) of the histogram buckets. Durations above
+ * the last bound are counted in an additional overflow bucket. */
+static const uint64_t bucket_bounds[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000};
+#define NUM_BUCKETS (sizeof(bucket_bounds) / sizeof(bucket_bounds[0]) + 1)
+
+struct histogram {
+    const char *name;
+    uint64_t count;
+    uint64_t total;
+    uint64_t max;
+    uint64_t last;
+    uint64_t buckets[NUM_BUCKETS];
+};
+
+static struct histogram timings[NUM_STATS_TIMINGS] = {
+    [STATS_TREE_RENDER] = {.name = "tree_render"},
+    [STATS_X_PUSH_CHANGES] = {.name = "x_push_changes"},
+    [STATS_RUN_ASSIGNMENTS] = {.name = "run_assignments"},
+    [STATS_PARSE_FILE] = {.name = "parse_file"},
+    [STATS_CHECK_DUPLICATE_BINDINGS] = {.name = "check_for_duplicate_bindings"},
+    [STATS_REORDER_BINDINGS] = {.name = "reorder_bindings"},
+    [STATS_TRANSLATE_KEYSYMS] = {.name = "translate_keysyms"},
+    [STATS_RELOAD] = {.name = "reload"},
+};
+
+static bool enabled = false;
+
+/* Number of x_push_changes() calls whose requests were counted, the total of
+ * those requests and the maximum for a single call. */
+static uint64_t pushes;
+static uint64_t push_requests;
+static uint64_t push_requests_max;
+static unsigned int push_sequence;
+
+uint64_t stats_x_requests[NUM_STATS_X_REQUESTS];
+
+uint64_t stats_renders_scheduled;
+uint64_t stats_renders_avoided;
+
+uint64_t stats_frames_deferred;
+uint64_t stats_frames_created;
+uint64_t stats_frames_pending;
+
+static const char *x_request_names[NUM_STATS_X_REQUESTS] = {
+    [STATS_X_CONFIGURE_WINDOW] = "configure_window",
+    [STATS_X_MAP_WINDOW] = "map_window",
+    [STATS_X_UNMAP_WINDOW] = "unmap_window",
+    [STATS_X_CHANGE_WINDOW_ATTRIBUTES] = "change_window_attributes",
+    [STATS_X_CHANGE_PROPERTY] = "change_property",
+    [STATS_X_COPY_AREA] = "copy_area",
+    [STATS_X_SHAPE] = "shape",
+    [STATS_X_SET_INPUT_FOCUS] = "set_input_focus",
+    [STATS_X_ROUND_TRIP] = "round_trip",
+    [STATS_X_ELIDED] = "elided",
+};
+
+/* Number of tree_render() calls and, per kind of X request, the requests
+ * issued during all of them and the maximum for a single one. */
+static uint64_t renders;
+static uint64_t render_requests[NUM_STATS_X_REQUESTS];
+static uint64_t render_requests_max[NUM_STATS_X_REQUESTS];
+static uint64_t render_start_requests[NUM_STATS_X_REQUESTS];
+
+static const char *startup_phase_names[NUM_STATS_STARTUP_PHASES] = {
+    [STATS_STARTUP_X_CONNECT] = "x_connect",
+    [STATS_STARTUP_ATOMS] = "atoms",
+    [STATS_STARTUP_CONFIG] = "config",
+    [STATS_STARTUP_WM_SELECTION] = "wm_selection",
+    [STATS_STARTUP_XKB] = "xkb",
+    [STATS_STARTUP_FONT] = "font",
+    [STATS_STARTUP_TREE] = "tree",
+    [STATS_STARTUP_OUTPUTS] = "outputs",
+    [STATS_STARTUP_RENDER] = "render",
+    [STATS_STARTUP_MANAGE_WINDOWS] = "manage_windows",
+    [STATS_STARTUP_AUTOSTART] = "autostart",
+    [STATS_STARTUP_BARS] = "bars",
+};
+
+/* The input latency histograms are log-linear: values below
+ * INPUT_SUB_BUCKETS have a bucket each, larger ones are split into
+ * INPUT_SUB_BUCKETS buckets per power of two, so that each bucket is precise
+ * to 12.5%. Durations of more than INPUT_MAX_US are counted as INPUT_MAX_US. */
+#define INPUT_SUB_BITS 3
+#define INPUT_SUB_BUCKETS (1 << INPUT_SUB_BITS)
+#define INPUT_MAX_EXPONENT 30
+#define INPUT_MAX_US ((UINT64_C(1) << (INPUT_MAX_EXPONENT + 1)) - 1)
+#define INPUT_NUM_BUCKETS ((INPUT_MAX_EXPONENT - INPUT_SUB_BITS + 2) * INPUT_SUB_BUCKETS)
+
+struct input_histogram {
+    uint64_t count;
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[INPUT_NUM_BUCKETS];
+};
+
+/* The input latency of the presses which ran a binding, per binding id (see
+ * assign_binding_ids()). */
+struct binding_latency {
+    uint32_t id;
+    input_type_t input_type;
+    /* The symbol or keycode of the binding and its command when it last ran. */
+    char *input;
+    char *command;
+    struct input_histogram histogram;
+};
+
+static struct input_histogram input_latency;
+static hashmap_t *binding_latencies;
+
+/* The KeyPress and ButtonPress events handled since the last flush, see
+ * stats_input_begin(). Further presses in the same event loop iteration are
+ * not recorded. */
+#define MAX_PENDING_INPUTS 16
+static struct pending_input {
+    uint64_t start;
+    /* The binding the press ran, if any. */
+    struct binding_latency *binding;
+} pending_inputs[MAX_PENDING_INPUTS];
+static int num_pending_inputs;
+/* The press being handled right now, if it is recorded. */
+static struct pending_input *current_input;
+
+/* When main() began and when each startup phase ended (0 if it did not end
+ * yet), in microseconds of the monotonic clock. */
+static uint64_t startup_begin;
+static uint64_t startup_phase_end[NUM_STATS_STARTUP_PHASES];
+
+/*
+ * Returns the current time of a monotonic clock in microseconds, to be passed
+ * to stats_record_duration() later.
+ *
+ */
+uint64_t stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+ * Records the duration of the given operation, which started at the given
+ * time (as returned by stats_now()).
+ *
+ */
+void stats_record_duration(stats_timing_t timing, uint64_t start) {
+    const uint64_t duration = stats_now() - start;
+    struct histogram *histogram = &timings[timing];
+
+    size_t bucket = 0;
+    while (bucket < NUM_BUCKETS - 1 && duration > bucket_bounds[bucket]) {
+        bucket++;
+    }
+    histogram->buckets[bucket]++;
+    histogram->count++;
+    histogram->total += duration;
+    if (duration > histogram->max) {
+        histogram->max = duration;
+    }
+    histogram->last = duration;
+}
+
+/*
+ * Returns the duration of the last recorded operation of the given kind.
+ *
+ */
+uint64_t stats_last_duration(stats_timing_t timing) {
+    return timings[timing].last;
+}
+
+/*
+ * Marks the beginning of main(). The startup phases are timed from here.
+ *
+ */
+void stats_startup_begin(void) {
+    startup_begin = stats_now();
+}
+
+/*
+ * Returns when the phase before the given one ended, i.e. when the given one
+ * began.
+ *
+ */
+static uint64_t startup_phase_start(stats_startup_phase_t phase) {
+    for (int i = phase - 1; i >= 0; i--) {
+        if (startup_phase_end[i] != 0) {
+            return startup_phase_end[i];
+        }
+    }
+    return startup_begin;
+}
+
+/*
+ * Marks the end of the given startup phase, which began when the previous one
+ * ended, and logs its duration.
+ *
+ */
+void stats_startup_phase(stats_startup_phase_t phase) {
+    startup_phase_end[phase] = stats_now();
+    const uint64_t start = startup_phase_start(phase);
+    LOG("Startup phase %s took %" PRIu64 " us (%" PRIu64 " us since start)\n",
+        startup_phase_names[phase], startup_phase_end[phase] - start,
+        startup_phase_end[phase] - startup_begin);
+}
+
+/*
+ * X11 numbers requests sequentially. The sequence numbers of two no-op
+ * requests at the beginning and end of x_push_changes() tell how many
+ * requests were issued in between.
+ *
+ */
+void stats_push_begin(void) {
+    if (!enabled) {
+        return;
+    }
+    push_sequence = xcb_no_operation(conn).sequence;
+}
+
+void stats_push_end(void) {
+    if (!enabled || push_sequence == 0) {
+        return;
+    }
+    const uint64_t requests = (unsigned int)(xcb_no_operation(conn).sequence - push_sequence - 1);
+    push_sequence = 0;
+    pushes++;
+    push_requests += requests;
+    if (requests > push_requests_max) {
+        push_requests_max = requests;
+    }
+}
+
+/*
+ * Marks the beginning and end of tree_render(), to aggregate the counted X
+ * requests per render.
+ *
+ */
+void stats_render_begin(void) {
+    memcpy(render_start_requests, stats_x_requests, sizeof(stats_x_requests));
+}
+
+void stats_render_end(void) {
+    uint64_t requests[NUM_STATS_X_REQUESTS];
+    uint64_t total = 0;
+    for (int i = 0; i < NUM_STATS_X_REQUESTS; i++) {
+        requests[i] = stats_x_requests[i] - render_start_requests[i];
+        render_requests[i] += requests[i];
+        if (requests[i] > render_requests_max[i]) {
+            render_requests_max[i] = requests[i];
+        }
+        if (i != STATS_X_ELIDED) {
+            total += requests[i];
+        }
+    }
+    renders++;
+
+    if (total > 0) {
+        DLOG("X requests of this render: %" PRIu64 " configure, %" PRIu64 " map, %" PRIu64 " unmap, "
+             "%" PRIu64 " attributes, %" PRIu64 " property, %" PRIu64 " copy, %" PRIu64 " shape, "
+             "%" PRIu64 " focus, %" PRIu64 " round trips (%" PRIu64 " elided)\n",
+             requests[STATS_X_CONFIGURE_WINDOW], requests[STATS_X_MAP_WINDOW], requests[STATS_X_UNMAP_WINDOW],
+             requests[STATS_X_CHANGE_WINDOW_ATTRIBUTES], requests[STATS_X_CHANGE_PROPERTY], requests[STATS_X_COPY_AREA],
+             requests[STATS_X_SHAPE], requests[STATS_X_SET_INPUT_FOCUS], requests[STATS_X_ROUND_TRIP],
+             requests[STATS_X_ELIDED]);
+    }
+}
+
+/*
+ * Returns the index of the bucket of the given input latency histogram which
+ * counts the given duration.
+ *
+ */
+static size_t input_bucket(uint64_t duration) {
+    if (duration > INPUT_MAX_US) {
+        duration = INPUT_MAX_US;
+    }
+    if (duration < INPUT_SUB_BUCKETS) {
+        return duration;
+    }
+    const int exponent = 63 - __builtin_clzll(duration);
+    const size_t sub = (duration >> (exponent - INPUT_SUB_BITS)) & (INPUT_SUB_BUCKETS - 1);
+    return (exponent - INPUT_SUB_BITS + 1) * INPUT_SUB_BUCKETS + sub;
+}
+
+/*
+ * Returns the largest duration counted by the given bucket.
+ *
+ */
+static uint64_t input_bucket_bound(size_t bucket) {
+    if (bucket < INPUT_SUB_BUCKETS) {
+        return bucket;
+    }
+    const int shift = bucket / INPUT_SUB_BUCKETS - 1;
+    const uint64_t sub = bucket % INPUT_SUB_BUCKETS;
+    return ((INPUT_SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+static void input_histogram_record(struct input_histogram *histogram, uint64_t duration) {
+    histogram->buckets[input_bucket(duration)]++;
+    if (histogram->count == 0 || duration < histogram->min) {
+        histogram->min = duration;
+    }
+    if (duration > histogram->max) {
+        histogram->max = duration;
+    }
+    histogram->count++;
+    histogram->total += duration;
+}
+
+/*
+ * Marks the beginning and end of handling a KeyPress or ButtonPress event.
+ * The latency of the press is recorded at the next stats_input_flushed().
+ *
+ */
+void stats_input_begin(void) {
+    current_input = NULL;
+    if (num_pending_inputs == MAX_PENDING_INPUTS) {
+        return;
+    }
+    current_input = &pending_inputs[num_pending_inputs++];
+    current_input->start = stats_now();
+    current_input->binding = NULL;
+}
+
+void stats_input_end(void) {
+    current_input = NULL;
+}
+
+/*
+ * Does not record the latency of the press being handled, e.g. because it
+ * started dragging and its latency depends on the user.
+ *
+ */
+void stats_input_cancel(void) {
+    if (current_input == NULL) {
+        return;
+    }
+    /* The current press is always the last pending one. */
+    num_pending_inputs--;
+    current_input = NULL;
+}
+
+/*
+ * Records that the press being handled runs the given binding.
+ *
+ */
+void stats_input_binding(Binding *bind) {
+    if (current_input == NULL) {
+        return;
+    }
+
+    if (binding_latencies == NULL) {
+        binding_latencies = hashmap_new();
+    }
+    struct binding_latency *latency = hashmap_lookup(binding_latencies, bind->id);
+    if (latency == NULL) {
+        latency = scalloc(1, sizeof(struct binding_latency));
+        latency->id = bind->id;
+        hashmap_insert(binding_latencies, bind->id, latency);
+    }
+    /* Reloads can change the command (and, in case of id collisions, even the
+     * input) of a binding. */
+    const char *command = (bind->command != NULL ? bind->command : "");
+    latency->input_type = bind->input_type;
+    if (latency->command == NULL || strcmp(latency->command, command) != 0) {
+        FREE(latency->input);
+        FREE(latency->command);
+        if (bind->symbol != NULL) {
+            latency->input = sstrdup(bind->symbol);
+        } else {
+            sasprintf(&(latency->input), "%d", bind->keycode);
+        }
+        latency->command = sstrdup(command);
+    }
+    current_input->binding = latency;
+}
+
+/*
+ * Records the latency of the presses handled since the last call. Called right
+ * after the event loop flushed the requests of its iteration to X11.
+ *
+ */
+void stats_input_flushed(void) {
+    if (num_pending_inputs == 0) {
+        return;
+    }
+    const uint64_t now = stats_now();
+    for (int i = 0; i < num_pending_inputs; i++) {
+        const uint64_t duration = now - pending_inputs[i].start;
+        input_histogram_record(&input_latency, duration);
+        if (pending_inputs[i].binding != NULL) {
+            input_histogram_record(&(pending_inputs[i].binding->histogram), duration);
+        }
+    }
+    num_pending_inputs = 0;
+}
+
+/*
+ * Enables the counters which have a cost of their own, see stats_push_begin().
+ *
+ */
+void stats_enable(void) {
+    enabled = true;
+}
+
+static void dump_histogram(yajl_gen gen, struct histogram *histogram) {
+    ystr(histogram->name);
+    y(map_open);
+    ystr("count");
+    y(integer, histogram->count);
+    ystr("total_us");
+    y(integer, histogram->total);
+    ystr("max_us");
+    y(integer, histogram->max);
+    ystr("buckets");
+    y(array_open);
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        y(map_open);
+        ystr("le_us");
+        if (i < NUM_BUCKETS - 1) {
+            y(integer, bucket_bounds[i]);
+        } else {
+            y(null);
+        }
+        ystr("count");
+        y(integer, histogram->buckets[i]);
+        y(map_close);
+    }
+    y(array_close);
+    y(map_close);
+}
+
+/*
+ * Returns the smallest bucket bound which at least the given share (in
+ * thousandths) of the durations in the histogram do not exceed.
+ *
+ */
+static uint64_t input_percentile(const struct input_histogram *histogram, uint64_t permille) {
+    const uint64_t rank = (histogram->count * permille + 999) / 1000;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < INPUT_NUM_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= rank && seen > 0) {
+            const uint64_t bound = input_bucket_bound(i);
+            return (bound < histogram->max ? bound : histogram->max);
+        }
+    }
+    return histogram->max;
+}
+
+static void dump_input_histogram(yajl_gen gen, const struct input_histogram *histogram) {
+    y(map_open);
+    ystr("count");
+    y(integer, histogram->count);
+    ystr("total_us");
+    y(integer, histogram->total);
+    ystr("min_us");
+    y(integer, histogram->min);
+    ystr("max_us");
+    y(integer, histogram->max);
+    static const struct {
+        const char *name;
+        uint64_t permille;
+    } percentiles[] = {{"p50_us", 500}, {"p90_us", 900}, {"p99_us", 990}, {"p999_us", 999}};
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+        ystr(percentiles[i].name);
+        y(integer, input_percentile(histogram, percentiles[i].permille));
+    }
+    /* Only the buckets in use, there are a few hundred. */
+    ystr("buckets");
+    y(array_open);
+    for (size_t i = 0; i < INPUT_NUM_BUCKETS; i++) {
+        if (histogram->buckets[i] == 0) {
+            continue;
+        }
+        y(map_open);
+        ystr("le_us");
+        y(integer, input_bucket_bound(i));
+        ystr("count");
+        y(integer, histogram->buckets[i]);
+        y(map_close);
+    }
+    y(array_close);
+    y(map_close);
+}
+
+static void dump_binding_latency(void *value, void *userdata) {
+    const struct binding_latency *latency = value;
+    yajl_gen gen = userdata;
+
+    y(map_open);
+    ystr("id");
+    y(integer, latency->id);
+    ystr("input_type");
+    ystr((latency->input_type == B_KEYBOARD ? "keyboard" : "mouse"));
+    ystr("input");
+    ystr(latency->input);
+    ystr("command");
+    ystr(latency->command);
+    ystr("latency");
+    dump_input_histogram(gen, &(latency->histogram));
+    y(map_close);
+}
+
+/*
+ * Serializes the X event counters, the latency histograms and the startup
+ * phases as members of the currently open JSON map.
+ *
+ */
+void stats_dump(yajl_gen gen) {
+    event_handlers_dump(gen);
+
+    ystr("latency");
+    y(map_open);
+    for (int i = 0; i < NUM_STATS_TIMINGS; i++) {
+        dump_histogram(gen, &timings[i]);
+    }
+    y(map_close);
+
+    ystr("input_latency");
+    y(map_open);
+    ystr("all");
+    dump_input_histogram(gen, &input_latency);
+    ystr("bindings");
+    y(array_open);
+    if (binding_latencies != NULL) {
+        hashmap_foreach(binding_latencies, dump_binding_latency, gen);
+    }
+    y(array_close);
+    y(map_close);
+
+    ystr("x_requests");
+    y(map_open);
+    ystr("pushes");
+    y(integer, pushes);
+    ystr("total");
+    y(integer, push_requests);
+    ystr("max");
+    y(integer, push_requests_max);
+    ystr("renders");
+    y(integer, renders);
+    ystr("renders_scheduled");
+    y(integer, stats_renders_scheduled);
+    ystr("renders_avoided");
+    y(integer, stats_renders_avoided);
+    ystr("per_render");
+    y(map_open);
+    for (int i = 0; i < NUM_STATS_X_REQUESTS; i++) {
+        ystr(x_request_names[i]);
+        y(map_open);
+        ystr("total");
+        y(integer, render_requests[i]);
+        ystr("max");
+        y(integer, render_requests_max[i]);
+        y(map_close);
+    }
+    y(map_close);
+    y(map_close);
+
+    ystr("frames");
+    y(map_open);
+    ystr("deferred");
+    y(integer, stats_frames_deferred);
+    ystr("created");
+    y(integer, stats_frames_created);
+    ystr("pending");
+    y(integer, stats_frames_pending);
+    y(map_close);
+
+    ystr("startup");
+    y(map_open);
+    uint64_t total = 0;
+    ystr("phases");
+    y(array_open);
+    for (int i = 0; i < NUM_STATS_STARTUP_PHASES; i++) {
+        if (startup_phase_end[i] == 0) {
+            continue;
+        }
+        const uint64_t start = startup_phase_start(i);
+        y(map_open);
+        ystr("name");
+        ystr(startup_phase_names[i]);
+        ystr("start_us");
+        y(integer, start - startup_begin);
+        ystr("duration_us");
+        y(integer, startup_phase_end[i] - start);
+        y(map_close);
+        total = startup_phase_end[i] - startup_begin;
+    }
+    y(array_close);
+    ystr("total_us");
+    y(integer, total);
+    y(map_close);
+}
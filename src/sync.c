@@ -5,10 +5,25 @@
  * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
  *
  * sync.c: i3 sync protocol: https://i3wm.org/docs/testsuite.html#i3_sync
+ *         and waiting for the X server to process i3's requests.
  *
  */
 #include "all.h"
 
+/* A GetInputFocus request, whose reply arrives once the X server processed
+ * all requests sent before it. */
+struct pending_sync {
+    xcb_get_input_focus_cookie_t cookie;
+    sync_callback_t callback;
+    void *data;
+
+    TAILQ_ENTRY(pending_sync) syncs;
+};
+
+/* In the order of their requests, so only the first one has to be polled. */
+static TAILQ_HEAD(pending_sync_head, pending_sync) pending_syncs =
+    TAILQ_HEAD_INITIALIZER(pending_syncs);
+
 void sync_respond(xcb_window_t window, uint32_t rnd) {
     DLOG("[i3 sync protocol] Sending random value %d back to X11 window 0x%08x\n", rnd, window);
 
@@ -26,3 +41,60 @@ void sync_respond(xcb_window_t window, uint32_t rnd) {
     xcb_flush(conn);
     free(reply);
 }
+
+/*
+ * Calls the callback once the X server processed all requests which i3 sent
+ * so far, without waiting for it. The callbacks are called in the order in
+ * which they were registered, from sync_continue().
+ *
+ */
+void sync_after_x_requests(sync_callback_t callback, void *data) {
+    struct pending_sync *sync = smalloc(sizeof(struct pending_sync));
+    sync->cookie = xcb_get_input_focus(conn);
+    sync->callback = callback;
+    sync->data = data;
+    TAILQ_INSERT_TAIL(&pending_syncs, sync, syncs);
+}
+
+/*
+ * Cancels all callbacks registered with the given data.
+ *
+ */
+void sync_cancel(void *data) {
+    struct pending_sync *sync, *next;
+    for (sync = TAILQ_FIRST(&pending_syncs); sync != TAILQ_END(&pending_syncs); sync = next) {
+        next = TAILQ_NEXT(sync, syncs);
+        if (sync->data != data) {
+            continue;
+        }
+        xcb_discard_reply(conn, sync->cookie.sequence);
+        TAILQ_REMOVE(&pending_syncs, sync, syncs);
+        free(sync);
+    }
+}
+
+/*
+ * Calls the callbacks whose requests were processed, without blocking.
+ * Returns true if any callback was called.
+ *
+ */
+bool sync_continue(void) {
+    bool progress = false;
+    struct pending_sync *sync;
+    while ((sync = TAILQ_FIRST(&pending_syncs)) != NULL) {
+        void *reply = NULL;
+        xcb_generic_error_t *error = NULL;
+        if (xcb_poll_for_reply(conn, sync->cookie.sequence, &reply, &error) == 0) {
+            break;
+        }
+        free(reply);
+        free(error);
+
+        /* The callback may cancel further syncs. */
+        TAILQ_REMOVE(&pending_syncs, sync, syncs);
+        sync->callback(sync->data);
+        free(sync);
+        progress = true;
+    }
+    return progress;
+}
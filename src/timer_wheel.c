@@ -0,0 +1,121 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * timer_wheel.c: One coarse libev timer for many low-precision timeouts, like
+ *                the urgency timers of containers.
+ *
+ * Every timer is in the slot of the tick at which it expires (modulo the
+ * number of slots), so starting and stopping it only links or unlinks a list
+ * entry, instead of rebalancing libev's timer heap. The libev timer only runs
+ * while there are timers on the wheel.
+ *
+ */
+#include "all.h"
+
+#include <math.h>
+
+#define TIMER_WHEEL_SLOTS 256
+
+static LIST_HEAD(slot_head, wheel_timer) slots[TIMER_WHEEL_SLOTS];
+
+/* The last tick whose slot was processed. */
+static uint64_t current_tick;
+static unsigned int num_active = 0;
+static struct ev_timer *tick_timer = NULL;
+
+static uint64_t now_tick(void) {
+    return (uint64_t)(ev_now(main_loop) / TIMER_WHEEL_RESOLUTION);
+}
+
+/*
+ * Fires the timers which expired since the last tick.
+ *
+ */
+static void timer_wheel_tick_cb(EV_P_ ev_timer *w, int revents) {
+    const uint64_t target = now_tick();
+    /* All slots are processed at most once, even if the event loop was
+     * blocked for longer than a turn of the wheel. */
+    if (target - current_tick > TIMER_WHEEL_SLOTS) {
+        current_tick = target - TIMER_WHEEL_SLOTS;
+    }
+
+    /* Collect the expired timers first: the callbacks may start and stop
+     * other timers. */
+    struct slot_head expired = LIST_HEAD_INITIALIZER(expired);
+    while (current_tick < target) {
+        current_tick++;
+        struct slot_head *slot = &slots[current_tick % TIMER_WHEEL_SLOTS];
+        wheel_timer *timer = LIST_FIRST(slot);
+        while (timer != NULL) {
+            wheel_timer *next = LIST_NEXT(timer, slot);
+            if (timer->expires <= current_tick) {
+                LIST_REMOVE(timer, slot);
+                LIST_INSERT_HEAD(&expired, timer, slot);
+            }
+            timer = next;
+        }
+    }
+
+    while (!LIST_EMPTY(&expired)) {
+        wheel_timer *timer = LIST_FIRST(&expired);
+        wheel_timer_stop(timer);
+        timer->cb(timer);
+    }
+}
+
+/*
+ * Initializes the given timer. cb is called with the timer once it expires;
+ * the timer is stopped at that point and may be freed or started again.
+ *
+ */
+void wheel_timer_init(wheel_timer *timer, wheel_timer_cb cb, void *data) {
+    *timer = (wheel_timer){
+        .cb = cb,
+        .data = data,
+    };
+}
+
+/*
+ * Starts the timer so that it expires after the given number of seconds. A
+ * running timer is restarted.
+ *
+ */
+void wheel_timer_start(wheel_timer *timer, double after) {
+    wheel_timer_stop(timer);
+
+    if (tick_timer == NULL) {
+        tick_timer = scalloc(1, sizeof(struct ev_timer));
+        ev_timer_init(tick_timer, timer_wheel_tick_cb, TIMER_WHEEL_RESOLUTION, TIMER_WHEEL_RESOLUTION);
+    }
+    if (num_active == 0) {
+        /* The wheel does not turn while it is empty. */
+        current_tick = now_tick();
+        ev_timer_start(main_loop, tick_timer);
+    }
+
+    /* Round up, so that the timer does not expire early. */
+    const uint64_t expires = (uint64_t)ceil((ev_now(main_loop) + after) / TIMER_WHEEL_RESOLUTION);
+    timer->expires = max(expires, current_tick + 1);
+    timer->active = true;
+    LIST_INSERT_HEAD(&slots[timer->expires % TIMER_WHEEL_SLOTS], timer, slot);
+    num_active++;
+}
+
+/*
+ * Stops the timer if it is running.
+ *
+ */
+void wheel_timer_stop(wheel_timer *timer) {
+    if (!timer->active) {
+        return;
+    }
+
+    LIST_REMOVE(timer, slot);
+    timer->active = false;
+    if (--num_active == 0) {
+        ev_timer_stop(main_loop, tick_timer);
+    }
+}
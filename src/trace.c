@@ -0,0 +1,169 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * trace.c: Records the X events handled by i3 and the IPC commands it runs to
+ *          a file (see --record-trace), to be replayed by bench/replay.c.
+ *
+ */
+#include "all.h"
+
+#include <errno.h>
+
+static FILE *trace_file;
+static uint64_t last_record;
+
+/* Whether the name of an atom was recorded already, indexed by atom */
+static bool *atoms_recorded;
+static size_t num_atoms_recorded;
+
+/*
+ * Starts recording to the given file, replacing its contents unless append is
+ * set (to continue the trace after an in-place restart). Returns false if the
+ * file cannot be opened.
+ *
+ */
+bool trace_open(const char *path, bool append) {
+    trace_close();
+
+    trace_file = fopen(path, (append ? "a" : "w"));
+    if (trace_file == NULL) {
+        ELOG("Could not open the trace file \"%s\": %s\n", path, strerror(errno));
+        return false;
+    }
+
+    last_record = stats_now();
+    if (ftell(trace_file) > 0) {
+        LOG("Continuing to record X events and commands to \"%s\"\n", path);
+        return true;
+    }
+
+    struct trace_header header = {
+        .randr_base = randr_base,
+        .xkb_base = xkb_base,
+        .shape_base = (shape_supported ? shape_base : -1),
+    };
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    if (fwrite(&header, sizeof(header), 1, trace_file) != 1) {
+        ELOG("Could not write to the trace file \"%s\": %s\n", path, strerror(errno));
+        trace_close();
+        return false;
+    }
+    LOG("Recording X events and commands to \"%s\"\n", path);
+    return true;
+}
+
+/*
+ * Stops recording and writes out buffered records.
+ *
+ */
+void trace_close(void) {
+    if (trace_file == NULL) {
+        return;
+    }
+    fclose(trace_file);
+    trace_file = NULL;
+    FREE(atoms_recorded);
+    num_atoms_recorded = 0;
+}
+
+static void trace_write(trace_record_t type, const void *data, size_t length) {
+    if (trace_file == NULL) {
+        return;
+    }
+
+    const uint64_t now = stats_now();
+    const uint64_t delta = now - last_record;
+    last_record = now;
+
+    const struct trace_record record = {
+        .delta_us = (delta > UINT32_MAX ? UINT32_MAX : delta),
+        .type = type,
+        .length = length,
+    };
+    if (fwrite(&record, sizeof(record), 1, trace_file) != 1 ||
+        (length > 0 && fwrite(data, length, 1, trace_file) != 1)) {
+        ELOG("Could not write to the trace file, stopping to record: %s\n", strerror(errno));
+        trace_close();
+    }
+}
+
+/*
+ * Records the name of the atom, unless it was recorded already. Atoms are
+ * numbered by the X server, so the replay looks them up by name.
+ *
+ */
+static void trace_atom(xcb_atom_t atom) {
+    if (atom == XCB_NONE) {
+        return;
+    }
+    if (atom >= num_atoms_recorded) {
+        const size_t num = (atom + 1 > 2 * num_atoms_recorded ? atom + 1 : 2 * num_atoms_recorded);
+        atoms_recorded = srealloc(atoms_recorded, num * sizeof(bool));
+        memset(atoms_recorded + num_atoms_recorded, 0, (num - num_atoms_recorded) * sizeof(bool));
+        num_atoms_recorded = num;
+    }
+    if (atoms_recorded[atom]) {
+        return;
+    }
+    atoms_recorded[atom] = true;
+
+    xcb_get_atom_name_reply_t *reply = xcb_get_atom_name_reply(conn, xcb_get_atom_name(conn, atom), NULL);
+    if (reply == NULL) {
+        return;
+    }
+    const uint32_t id = atom;
+    const int name_length = xcb_get_atom_name_name_length(reply);
+    char *data = smalloc(sizeof(id) + name_length);
+    memcpy(data, &id, sizeof(id));
+    memcpy(data + sizeof(id), xcb_get_atom_name_name(reply), name_length);
+    trace_write(TRACE_ATOM, data, sizeof(id) + name_length);
+    free(data);
+    free(reply);
+}
+
+/*
+ * Records an X event, see handle_event().
+ *
+ */
+void trace_event(const xcb_generic_event_t *event) {
+    if (trace_file == NULL) {
+        return;
+    }
+
+    switch (event->response_type & 0x7F) {
+        case XCB_PROPERTY_NOTIFY:
+            trace_atom(((const xcb_property_notify_event_t *)event)->atom);
+            break;
+        case XCB_CLIENT_MESSAGE: {
+            const xcb_client_message_event_t *message = (const xcb_client_message_event_t *)event;
+            trace_atom(message->type);
+            /* The properties to change are atoms, too. */
+            if (message->type == A__NET_WM_STATE && message->format == 32) {
+                trace_atom(message->data.data32[1]);
+                trace_atom(message->data.data32[2]);
+            }
+            break;
+        }
+    }
+
+    /* Generic events can be longer, but i3 only uses the first 32 bytes. */
+    trace_write(TRACE_X_EVENT, event, sizeof(xcb_generic_event_t));
+}
+
+/*
+ * Records an IPC command.
+ *
+ */
+void trace_command(const char *command, size_t length) {
+    if (trace_file == NULL) {
+        return;
+    }
+    if (length > UINT16_MAX) {
+        ELOG("Not recording a command of %zu bytes\n", length);
+        return;
+    }
+    trace_write(TRACE_COMMAND, command, length);
+}
@@ -8,12 +8,36 @@
  *
  */
 #include "all.h"
+#include "restart_snapshot.h"
 
 struct Con *croot;
 struct Con *focused;
 
 struct all_cons_head all_cons = TAILQ_HEAD_INITIALIZER(all_cons);
 
+/* An open batch of commands defers rendering until it is committed, see
+ * tree_batch_begin(). The timer commits batches whose owner never does. */
+#define BATCH_TIMEOUT 2.0
+
+static bool batch_active = false;
+static bool batch_render_pending = false;
+
+/* Set by tree_schedule_render(), see tree_flush_scheduled_render(). */
+static bool render_scheduled = false;
+static struct ipc_client *batch_owner = NULL;
+static struct ev_timer *batch_timer = NULL;
+
+/* Focus changes can alter which children of stacked and tabbed containers are
+ * visible without marking anything dirty, see tree_note_focus_change(). If
+ * nothing but a workspace switch or a dock change happened since the last
+ * render, only the outputs containing dirty containers need to be rendered
+ * again, see tree_note_workspace_switch() and tree_note_output_change(). */
+static bool focus_changed = true;
+static bool switch_only = false;
+
+/* Bumped whenever the tree (may have) changed, see tree_note_change(). */
+static uint64_t generation = 1;
+
 /*
  * Create the pseudo-output __i3. Output-independent workspaces such as
  * __i3_scratch will live there.
@@ -60,25 +84,11 @@ static Con *_create___i3(void) {
 }
 
 /*
- * Loads tree from 'path' (used for in-place restarts).
+ * Creates a temporary root container to which the restored layout is
+ * appended, see tree_restore_finish().
  *
  */
-bool tree_restore(const char *path, xcb_get_geometry_reply_t *geometry) {
-    bool result = false;
-    char *globbed = resolve_tilde(path);
-    char *buf = NULL;
-
-    if (!path_exists(globbed)) {
-        LOG("%s does not exist, not restoring tree\n", globbed);
-        goto out;
-    }
-
-    ssize_t len;
-    if ((len = slurp(globbed, &buf)) < 0) {
-        /* slurp already logged an error. */
-        goto out;
-    }
-
+static void tree_restore_begin(xcb_get_geometry_reply_t *geometry) {
     /* TODO: refactor the following */
     croot = con_new(NULL, NULL);
     croot->rect = (Rect){
@@ -87,14 +97,20 @@ bool tree_restore(const char *path, xcb_get_geometry_reply_t *geometry) {
         geometry->width,
         geometry->height};
     focused = croot;
+    con_invalidate_lookups();
+}
 
-    tree_append_json(focused, buf, len, NULL);
-
+/*
+ * Makes the restored root container the new root. Returns false if nothing
+ * was restored.
+ *
+ */
+static bool tree_restore_finish(void) {
     DLOG("appended tree, using new root\n");
     croot = TAILQ_FIRST(&(croot->nodes_head));
     if (!croot) {
         /* tree_append_json failed. Continuing here would segfault. */
-        goto out;
+        return false;
     }
     DLOG("new root = %p\n", croot);
     Con *out = TAILQ_FIRST(&(croot->nodes_head));
@@ -114,14 +130,78 @@ bool tree_restore(const char *path, xcb_get_geometry_reply_t *geometry) {
     }
 
     restore_open_placeholder_windows(croot);
-    result = true;
+    return true;
+}
+
+/*
+ * Loads tree from 'path' (used for in-place restarts).
+ *
+ */
+bool tree_restore(const char *path, xcb_get_geometry_reply_t *geometry) {
+    bool result = false;
+    char *globbed = resolve_tilde(path);
+    char *buf = NULL;
+
+    if (!path_exists(globbed)) {
+        LOG("%s does not exist, not restoring tree\n", globbed);
+        goto out;
+    }
+
+    ssize_t len;
+    if ((len = map_file(globbed, &buf)) < 0) {
+        /* map_file already logged an error. */
+        goto out;
+    }
+
+    tree_restore_begin(geometry);
+    tree_append_json(focused, buf, len, NULL);
+    unmap_file(buf, len);
+    result = tree_restore_finish();
 
 out:
     free(globbed);
-    free(buf);
     return result;
 }
 
+/*
+ * Loads the tree from the given restart snapshot (see restart_snapshot.h).
+ * Returns false if the snapshot is unusable, in which case the layout file
+ * should be restored instead.
+ *
+ */
+bool tree_restore_snapshot(const uint8_t *data, size_t size, xcb_get_geometry_reply_t *geometry) {
+    const restart_snapshot_header *header = (const restart_snapshot_header *)data;
+    if (size < sizeof(restart_snapshot_header) ||
+        memcmp(header->magic, RESTART_SNAPSHOT_MAGIC, sizeof(header->magic)) != 0) {
+        ELOG("Not a restart snapshot, ignoring it\n");
+        return false;
+    }
+    if (header->version != RESTART_SNAPSHOT_VERSION) {
+        LOG("Restart snapshot has version %u, expected %u, ignoring it\n",
+            header->version, RESTART_SNAPSHOT_VERSION);
+        return false;
+    }
+    if (header->header_size < sizeof(restart_snapshot_header) ||
+        header->header_size > size ||
+        header->length > size - header->header_size) {
+        ELOG("Restart snapshot is truncated, ignoring it\n");
+        return false;
+    }
+
+    /* Decode the snapshot once without building anything, so that a corrupt
+     * snapshot can still fall back to the layout file. */
+    static const yajl_callbacks validate_callbacks = {0};
+    const uint8_t *cbor = data + header->header_size;
+    if (ipc_cbor_parse(&validate_callbacks, NULL, cbor, header->length) != yajl_status_ok) {
+        ELOG("Restart snapshot is corrupt, ignoring it\n");
+        return false;
+    }
+
+    tree_restore_begin(geometry);
+    tree_append_cbor(focused, cbor, header->length);
+    return tree_restore_finish();
+}
+
 /*
  * Initializes the tree by creating the root node. The CT_OUTPUT Cons below the
  * root node are created in randr.c for each Output.
@@ -180,17 +260,28 @@ Con *tree_open_con(Con *con, i3Window *window) {
 }
 
 /*
- * Closes the given container including all children.
- * Returns true if the container was killed or false if just WM_DELETE was sent
- * and the window is expected to kill itself.
- *
- * The dont_kill_parent flag is specified when the function calls itself
- * recursively while deleting a containers children.
+ * Closes the given container and its children, see tree_close_internal().
+ * parent_closes is set when the parent is closed as well (its windows are
+ * unmanaged, so nothing can abort it), which makes the fixups of the
+ * parent's percentages unnecessary.
  *
  */
-bool tree_close_internal(Con *con, kill_window_t kill_window, bool dont_kill_parent) {
+static bool close_con(Con *con, kill_window_t kill_window, bool dont_kill_parent, bool parent_closes) {
     Con *parent = con->parent;
 
+    /* Unmanaging a subtree cannot be aborted, so it is torn down in bulk: its
+     * IPC events, EWMH updates and the render are deferred until the subtree
+     * is gone, and focus moves to con right away instead of hopping through
+     * every child as they are closed one after the other. */
+    const bool bulk = (kill_window == DONT_KILL_WINDOW && !con_is_leaf(con));
+    bool bulk_begun = false;
+    if (bulk) {
+        bulk_begun = tree_bulk_begin();
+        if (focused != con && con_has_parent(focused, con)) {
+            con_focus(con);
+        }
+    }
+
     /* remove the urgency hint of the workspace (if set) */
     if (con->urgent) {
         con_set_urgency(con, false);
@@ -206,7 +297,7 @@ bool tree_close_internal(Con *con, kill_window_t kill_window, bool dont_kill_par
     for (child = TAILQ_FIRST(&(con->nodes_head)); child;) {
         nextchild = TAILQ_NEXT(child, nodes);
         DLOG("killing child=%p\n", child);
-        if (!tree_close_internal(child, kill_window, true)) {
+        if (!close_con(child, kill_window, true, bulk)) {
             abort_kill = true;
         }
         child = nextchild;
@@ -214,15 +305,19 @@ bool tree_close_internal(Con *con, kill_window_t kill_window, bool dont_kill_par
 
     if (abort_kill) {
         DLOG("One of the children could not be killed immediately (WM_DELETE sent), aborting.\n");
+        if (bulk_begun) {
+            tree_bulk_end();
+        }
         return false;
     }
 
     if (con->window != NULL) {
         if (kill_window != DONT_KILL_WINDOW) {
-            x_window_kill(con->window->id, kill_window);
+            x_window_kill(con->window, kill_window);
             return false;
         } else {
             xcb_void_cookie_t cookie;
+            PROBE2(window_unmanage, con->window->id, (uintptr_t)con);
             /* Ignore any further events by clearing the event mask,
              * unmap the window,
              * then reparent it to the root window. */
@@ -258,6 +353,7 @@ bool tree_close_internal(Con *con, kill_window_t kill_window, bool dont_kill_par
             add_ignore_event(cookie.sequence, 0);
         }
         ipc_send_window_event("close", con);
+        con_unindex_window(con);
         window_free(con->window);
         con->window = NULL;
     }
@@ -275,11 +371,11 @@ bool tree_close_internal(Con *con, kill_window_t kill_window, bool dont_kill_par
     if (con->urgency_timer != NULL) {
         DLOG("Removing urgency timer of con %p\n", con);
         workspace_update_urgent_flag(ws);
-        ev_timer_stop(main_loop, con->urgency_timer);
+        wheel_timer_stop(con->urgency_timer);
         FREE(con->urgency_timer);
     }
 
-    if (con->type != CT_FLOATING_CON) {
+    if (con->type != CT_FLOATING_CON && !parent_closes) {
         /* If the container is *not* floating, we might need to re-distribute
          * percentage values for the resized containers. */
         con_fix_percent(parent);
@@ -295,6 +391,9 @@ bool tree_close_internal(Con *con, kill_window_t kill_window, bool dont_kill_par
      * non-renderable state during that time. */
     if (!dont_kill_parent)
         tree_render();
+    if (bulk_begun) {
+        tree_bulk_end();
+    }
 
     /* kill the X11 part of this container */
     x_con_kill(con);
@@ -319,6 +418,19 @@ bool tree_close_internal(Con *con, kill_window_t kill_window, bool dont_kill_par
     return true;
 }
 
+/*
+ * Closes the given container including all children.
+ * Returns true if the container was killed or false if just WM_DELETE was sent
+ * and the window is expected to kill itself.
+ *
+ * The dont_kill_parent flag is specified when the function calls itself
+ * recursively while deleting a containers children.
+ *
+ */
+bool tree_close_internal(Con *con, kill_window_t kill_window, bool dont_kill_parent) {
+    return close_con(con, kill_window, dont_kill_parent, false);
+}
+
 /*
  * Splits (horizontally or vertically) the given container by creating a new
  * container which contains the old one and the future ones.
@@ -338,6 +450,8 @@ void tree_split(Con *con, orientation_t orientation) {
             }
             DLOG("Changing orientation of workspace\n");
             con->layout = (orientation == HORIZ) ? L_SPLITH : L_SPLITV;
+            con_set_dirty(con);
+            tree_note_flatten_candidate(con);
             return;
         } else {
             /* if there is more than one container on the workspace
@@ -358,6 +472,7 @@ void tree_split(Con *con, orientation_t orientation) {
         (parent->layout == L_SPLITH ||
          parent->layout == L_SPLITV)) {
         parent->layout = (orientation == HORIZ) ? L_SPLITH : L_SPLITV;
+        tree_note_flatten_candidate(parent);
         DLOG("Just changing orientation of existing container\n");
         return;
     }
@@ -369,6 +484,7 @@ void tree_split(Con *con, orientation_t orientation) {
     TAILQ_REPLACE(&(parent->nodes_head), con, new, nodes);
     TAILQ_REPLACE(&(parent->focus_head), con, new, focused);
     new->parent = parent;
+    con_invalidate_lookups();
     new->layout = (orientation == HORIZ) ? L_SPLITH : L_SPLITV;
 
     /* 3: swap 'percent' (resize factor) */
@@ -430,6 +546,11 @@ bool level_down(void) {
 static void mark_unmapped(Con *con) {
     Con *current;
 
+    /* Everything below an idle container is unmapped already. */
+    if (x_con_is_idle(con)) {
+        return;
+    }
+
     con->mapped = false;
     TAILQ_FOREACH (current, &(con->nodes_head), nodes) {
         mark_unmapped(current);
@@ -452,16 +573,260 @@ void tree_render(void) {
     if (croot == NULL)
         return;
 
+    if (render_scheduled) {
+        /* This render makes the scheduled one unnecessary. */
+        render_scheduled = false;
+        stats_renders_avoided++;
+    }
+
+    /* Rendering changes focus and geometry, which are part of the
+     * GET_WORKSPACES and GET_OUTPUTS replies. */
+    ipc_invalidate_reply_cache();
+
+    if (batch_active) {
+        batch_render_pending = true;
+        return;
+    }
+
+    const uint64_t start = stats_now();
+    PROBE0(render_start);
+    stats_render_begin();
+    con_begin_layout_pass();
     DLOG("-- BEGIN RENDERING --\n");
-    /* Reset map state for all nodes in tree */
-    /* TODO: a nicer method to walk all nodes would be good, maybe? */
-    mark_unmapped(croot);
-    croot->mapped = true;
+    if (switch_only && con_get_fullscreen_con(croot, CF_GLOBAL) == NULL) {
+        /* The other outputs look exactly like they did after the last
+         * render, so their map state stays as it is. */
+        Con *output;
+        TAILQ_FOREACH (output, &(croot->nodes_head), nodes) {
+            if (render_output_needed(output)) {
+                mark_unmapped(output);
+            }
+        }
 
-    render_con(croot);
+        render_dirty_outputs();
+    } else {
+        /* Reset map state for all nodes in tree */
+        /* TODO: a nicer method to walk all nodes would be good, maybe? */
+        mark_unmapped(croot);
+        croot->mapped = true;
+
+        render_con(croot);
+    }
+    focus_changed = false;
+    switch_only = false;
 
     x_push_changes(croot);
+    con_end_layout_pass();
+    tree_events_flush();
+    tree_shm_update();
+    raw_pointer_invalidate_index();
+    stats_render_end();
     DLOG("-- END RENDERING --\n");
+    stats_record_duration(STATS_TREE_RENDER, start);
+    PROBE1(render_done, stats_now() - start);
+}
+
+/*
+ * Renders the tree before the event loop waits for new events, unless
+ * tree_render() is called before. Several calls within one event loop
+ * iteration result in a single render. Callers which need the result (e.g.
+ * the geometry of a container) right away have to use tree_render().
+ *
+ */
+void tree_schedule_render(void) {
+    stats_renders_scheduled++;
+    if (render_scheduled) {
+        stats_renders_avoided++;
+        return;
+    }
+    render_scheduled = true;
+}
+
+/*
+ * Renders the tree if tree_schedule_render() was called since the last
+ * render. Returns whether it rendered.
+ *
+ */
+bool tree_flush_scheduled_render(void) {
+    if (!render_scheduled) {
+        return false;
+    }
+    render_scheduled = false;
+    tree_render();
+    return true;
+}
+
+/*
+ * Notes that the focus changed, so that the next tree_render() renders all
+ * outputs.
+ *
+ */
+void tree_note_focus_change(void) {
+    focus_changed = true;
+    switch_only = false;
+}
+
+/*
+ * Returns whether the focus changed since the last tree_render().
+ *
+ */
+bool tree_focus_changed(void) {
+    return focus_changed;
+}
+
+/*
+ * Notes that the tree (may have) changed, which bumps the generation reported
+ * to IPC clients.
+ *
+ */
+void tree_note_change(void) {
+    generation++;
+}
+
+/*
+ * Returns the current generation of the tree. It increases whenever
+ * something which is part of the GET_TREE, GET_WORKSPACES or GET_OUTPUTS
+ * replies (may have) changed.
+ *
+ */
+uint64_t tree_generation(void) {
+    return generation;
+}
+
+/*
+ * Notes that workspace_show() switched workspaces. If focus_clean is true, the
+ * focus did not change between the last tree_render() and the switch, so
+ * the next tree_render() only renders the outputs containing dirty
+ * containers (workspace_show() marks the newly shown workspace dirty).
+ *
+ */
+void tree_note_workspace_switch(bool focus_clean) {
+    focus_changed = !focus_clean;
+    switch_only = focus_clean;
+}
+
+/*
+ * Notes that only the dock area (and thereby the content geometry) of the
+ * given output changed. Marking the output dirty makes render_output_needed()
+ * true for it, so unless the focus changed since the last tree_render(), the
+ * other outputs are not rendered again.
+ *
+ */
+void tree_note_output_change(Con *output) {
+    if (output == NULL) {
+        return;
+    }
+    con_set_dirty(output);
+    if (!focus_changed) {
+        switch_only = true;
+    }
+}
+
+static void batch_timeout_cb(EV_P_ ev_timer *w, int revents) {
+    ELOG("Batch of commands was not committed within %.1f seconds, committing it now\n", BATCH_TIMEOUT);
+    tree_batch_commit();
+}
+
+/*
+ * Starts a batch of commands. Until tree_batch_commit() is called,
+ * tree_render(), EWMH desktop updates and IPC events (except for tick and
+ * shutdown events) are deferred. The batch is committed automatically when
+ * its owner disconnects or after a timeout.
+ *
+ * Returns false if a batch is already open.
+ *
+ */
+bool tree_batch_begin(struct ipc_client *owner) {
+    if (batch_active) {
+        return false;
+    }
+
+    DLOG("Beginning batch of commands (owner %p)\n", owner);
+    batch_active = true;
+    batch_render_pending = false;
+    batch_owner = owner;
+
+    batch_timer = scalloc(1, sizeof(struct ev_timer));
+    ev_timer_init(batch_timer, batch_timeout_cb, BATCH_TIMEOUT, 0.);
+    ev_timer_start(main_loop, batch_timer);
+    return true;
+}
+
+/*
+ * Ends the open batch: sends the deferred EWMH updates and IPC events and
+ * renders the tree once.
+ *
+ */
+void tree_batch_commit(void) {
+    if (!batch_active) {
+        return;
+    }
+
+    DLOG("Committing batch of commands\n");
+    batch_active = false;
+    batch_owner = NULL;
+    if (batch_timer != NULL) {
+        ev_timer_stop(main_loop, batch_timer);
+        FREE(batch_timer);
+    }
+
+    ewmh_flush_deferred_updates();
+    ipc_flush_deferred_events();
+    /* Events which were handled during the batch were not rendered. */
+    switch_only = false;
+    if (batch_render_pending) {
+        batch_render_pending = false;
+        tree_render();
+    }
+}
+
+/*
+ * Starts a bulk operation on the tree (closing a workspace, moving the
+ * workspaces of an output away): like a batch of commands, rendering, EWMH
+ * desktop updates and IPC events are deferred until tree_bulk_end(). Returns
+ * false if a batch is open already, the operation is then part of it and must
+ * not call tree_bulk_end().
+ *
+ */
+bool tree_bulk_begin(void) {
+    if (batch_active) {
+        return false;
+    }
+
+    DLOG("Beginning bulk operation\n");
+    batch_active = true;
+    batch_render_pending = false;
+    batch_owner = NULL;
+    return true;
+}
+
+/*
+ * Ends the bulk operation started by tree_bulk_begin(): sends the deferred
+ * EWMH updates and IPC events and renders the tree once.
+ *
+ */
+void tree_bulk_end(void) {
+    tree_batch_commit();
+}
+
+/*
+ * Returns true while a batch of commands is open.
+ *
+ */
+bool tree_batch_active(void) {
+    return batch_active;
+}
+
+/*
+ * Commits the open batch if it was started by the given IPC client, which is
+ * about to be freed.
+ *
+ */
+void tree_batch_client_gone(struct ipc_client *client) {
+    if (batch_active && batch_owner == client) {
+        DLOG("Owner of the open batch disconnected\n");
+        tree_batch_commit();
+    }
 }
 
 static Con *get_tree_next_workspace(Con *con, direction_t direction) {
@@ -539,7 +904,10 @@ static Con *get_tree_next(Con *con, direction_t direction) {
             return next;
         }
 
-        if (con_num_children(parent) > 1 && con_orientation(parent) == orientation) {
+        /* con is one of parent's tiling children, so it has siblings unless it
+         * is both the first and the last one. */
+        if (TAILQ_FIRST(&(parent->nodes_head)) != TAILQ_LAST(&(parent->nodes_head), nodes_head) &&
+            con_orientation(parent) == orientation) {
             Con *const next = previous ? TAILQ_PREV(con, nodes_head, nodes)
                                        : TAILQ_NEXT(con, nodes);
             if (next && con_fullscreen_permits_focusing(next)) {
@@ -636,19 +1004,12 @@ Con *get_tree_next_sibling(Con *con, position_t direction) {
 }
 
 /*
- * tree_flatten() removes pairs of redundant split containers, e.g.:
- *       [workspace, horizontal]
- *   [v-split]           [child3]
- *   [h-split]
- * [child1] [child2]
- * In this example, the v-split and h-split container are redundant.
- * Such a situation can be created by moving containers in a direction which is
- * not the orientation of their parent container. i3 needs to create a new
- * split container then and if you move containers this way multiple times,
- * redundant chains of split-containers can be the result.
+ * Flattens con and its only child if they are a pair of redundant split
+ * containers (see tree_flatten()). Returns true if it did, in which case con
+ * was freed.
  *
  */
-void tree_flatten(Con *con) {
+static bool flatten_pair(Con *con) {
     Con *current, *child, *parent = con->parent;
     DLOG("Checking if I can flatten con = %p / %s\n", con, con->name);
 
@@ -656,12 +1017,12 @@ void tree_flatten(Con *con) {
     if (con->type != CT_CON ||
         parent->layout == L_OUTPUT || /* con == "content" */
         con->window != NULL)
-        goto recurse;
+        return false;
 
     /* Ensure it got only one child */
     child = TAILQ_FIRST(&(con->nodes_head));
     if (child == NULL || TAILQ_NEXT(child, nodes) != NULL)
-        goto recurse;
+        return false;
 
     DLOG("child = %p, con = %p, parent = %p\n", child, con, parent);
 
@@ -673,7 +1034,7 @@ void tree_flatten(Con *con) {
         (child->layout != L_SPLITH && child->layout != L_SPLITV) ||
         con_orientation(con) == con_orientation(child) ||
         con_orientation(child) != con_orientation(parent))
-        goto recurse;
+        return false;
 
     DLOG("Alright, I have to flatten this situation now. Stay calm.\n");
     /* 1: save focus */
@@ -706,19 +1067,40 @@ void tree_flatten(Con *con) {
         TAILQ_INSERT_HEAD(&(parent->focus_head), focus_next, focused);
         DLOG("restored focus.\n");
     }
+    con_invalidate_lookups();
 
     /* 4: close the redundant cons */
     DLOG("closing redundant cons\n");
     tree_close_internal(con, DONT_KILL_WINDOW, true);
 
-    /* Well, we got to abort the recursion here because we destroyed the
+    return true;
+}
+
+/*
+ * tree_flatten() removes pairs of redundant split containers, e.g.:
+ *       [workspace, horizontal]
+ *   [v-split]           [child3]
+ *   [h-split]
+ * [child1] [child2]
+ * In this example, the v-split and h-split container are redundant.
+ * Such a situation can be created by moving containers in a direction which is
+ * not the orientation of their parent container. i3 needs to create a new
+ * split container then and if you move containers this way multiple times,
+ * redundant chains of split-containers can be the result.
+ *
+ */
+void tree_flatten(Con *con) {
+    Con *current;
+
+    /* Well, we got to abort the recursion here if we destroyed the
      * container. However, if tree_flatten() is called sufficiently often,
      * there can’t be the situation of having two pairs of redundant containers
      * at once. Therefore, we can safely abort the recursion on this level
      * after flattening. */
-    return;
+    if (flatten_pair(con)) {
+        return;
+    }
 
-recurse:
     /* We cannot use normal foreach here because tree_flatten might close the
      * current container. */
     current = TAILQ_FIRST(&(con->nodes_head));
@@ -735,3 +1117,85 @@ recurse:
         current = next;
     }
 }
+
+/* Containers whose children or layout changed since the last
+ * tree_flatten_candidates(). A redundant pair can only appear next to one of
+ * them, so there is no need to walk the whole tree. */
+static Con **flatten_candidates = NULL;
+static int num_flatten_candidates = 0;
+static int flatten_candidates_size = 0;
+
+/*
+ * Remembers that the children or the layout of the given container changed,
+ * so that the next tree_flatten_candidates() checks whether it (or its parent
+ * or children) became part of a pair of redundant split containers.
+ *
+ */
+void tree_note_flatten_candidate(Con *con) {
+    if (con == NULL || con->flatten_candidate) {
+        return;
+    }
+    if (num_flatten_candidates == flatten_candidates_size) {
+        flatten_candidates_size = max(2 * flatten_candidates_size, 16);
+        flatten_candidates = srealloc(flatten_candidates, flatten_candidates_size * sizeof(Con *));
+    }
+    flatten_candidates[num_flatten_candidates++] = con;
+    con->flatten_candidate = true;
+}
+
+/*
+ * Removes the given container from the list of candidates. Called when the
+ * container is freed.
+ *
+ */
+void tree_forget_flatten_candidate(Con *con) {
+    if (!con->flatten_candidate) {
+        return;
+    }
+    for (int i = num_flatten_candidates - 1; i >= 0; i--) {
+        if (flatten_candidates[i] == con) {
+            flatten_candidates[i] = flatten_candidates[--num_flatten_candidates];
+            break;
+        }
+    }
+    con->flatten_candidate = false;
+}
+
+/*
+ * Like tree_flatten(croot), but only looks at the containers noted with
+ * tree_note_flatten_candidate() since the last call, instead of the whole
+ * tree.
+ *
+ */
+void tree_flatten_candidates(void) {
+    /* Flattening detaches containers, which notes their parents as new
+     * candidates. That way, chains of redundant pairs are removed one pair
+     * after the other. */
+    while (num_flatten_candidates > 0) {
+        Con *con = flatten_candidates[--num_flatten_candidates];
+        con->flatten_candidate = false;
+        if (con->parent == NULL) {
+            continue;
+        }
+
+        /* The container can be the lower half of a pair (its layout changed),
+         * the upper half (its children changed) or the parent of a pair (its
+         * layout changed). */
+        if (flatten_pair(con->parent) || flatten_pair(con)) {
+            continue;
+        }
+
+        Con *current = TAILQ_FIRST(&(con->nodes_head));
+        while (current != NULL) {
+            Con *next = TAILQ_NEXT(current, nodes);
+            flatten_pair(current);
+            current = next;
+        }
+        current = TAILQ_FIRST(&(con->floating_head));
+        while (current != NULL) {
+            Con *next = TAILQ_NEXT(current, floating_windows);
+            flatten_pair(current);
+            current = next;
+        }
+    }
+}
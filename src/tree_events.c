@@ -0,0 +1,339 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * tree_events.c: Structural diffs of the layout tree for the tree IPC event.
+ *
+ * While at least one client is subscribed to the tree event, every container
+ * carries a copy of the properties clients mirror (parent, geometry, child and
+ * focus order). After each render, the tree is compared against that copy and
+ * the differences are sent as a single event with an increasing generation.
+ *
+ */
+#include "all.h"
+#include "yajl_utils.h"
+
+#include <inttypes.h>
+#include <locale.h>
+
+#include <yajl/yajl_gen.h>
+
+struct tree_event_state {
+    Con *parent;
+    Rect rect;
+    Rect deco_rect;
+    Rect window_rect;
+    double percent;
+
+    size_t num_nodes;
+    uintptr_t *nodes;
+    size_t num_floating;
+    uintptr_t *floating;
+    size_t num_focus;
+    uintptr_t *focus;
+};
+
+/* Whether the containers currently carry a recorded state. */
+static bool tracking = false;
+
+static uint64_t generation = 0;
+
+/* Containers which were freed since the last tree event. */
+static uintptr_t *removed = NULL;
+static size_t num_removed = 0;
+static size_t removed_size = 0;
+
+/* Scratch buffer for collecting the ids of a container’s children. */
+static uintptr_t *scratch = NULL;
+static size_t scratch_size = 0;
+
+static void scratch_reserve(size_t n) {
+    if (n > scratch_size) {
+        scratch_size = n * 2;
+        scratch = srealloc(scratch, scratch_size * sizeof(uintptr_t));
+    }
+}
+
+/* Collects the ids of all cons in the given list into scratch and stores the
+ * number of ids in count. */
+#define COLLECT_IDS(head, field, count)           \
+    do {                                          \
+        Con *_child;                              \
+        count = 0;                                \
+        TAILQ_FOREACH (_child, head, field) {     \
+            scratch_reserve(count + 1);           \
+            scratch[count++] = (uintptr_t)_child; \
+        }                                         \
+    } while (0)
+
+/*
+ * Replaces the stored id list with the contents of scratch if they differ.
+ * Returns true if the list changed.
+ *
+ */
+static bool update_ids(uintptr_t **ids, size_t *num, size_t count) {
+    if (*num == count && (count == 0 || memcmp(*ids, scratch, count * sizeof(uintptr_t)) == 0)) {
+        return false;
+    }
+
+    *ids = srealloc(*ids, count * sizeof(uintptr_t));
+    if (count > 0) {
+        memcpy(*ids, scratch, count * sizeof(uintptr_t));
+    }
+    *num = count;
+    return true;
+}
+
+static void free_state(Con *con) {
+    if (con->tree_event_state == NULL) {
+        return;
+    }
+    free(con->tree_event_state->nodes);
+    free(con->tree_event_state->floating);
+    free(con->tree_event_state->focus);
+    FREE(con->tree_event_state);
+}
+
+static void dump_ids(yajl_gen gen, const char *name, uintptr_t *ids, size_t num) {
+    ystr(name);
+    y(array_open);
+    for (size_t i = 0; i < num; i++) {
+        y(integer, ids[i]);
+    }
+    y(array_close);
+}
+
+static void dump_rect(yajl_gen gen, const char *name, Rect r) {
+    ystr(name);
+    y(map_open);
+    ystr("x");
+    y(integer, (int32_t)r.x);
+    ystr("y");
+    y(integer, (int32_t)r.y);
+    ystr("width");
+    y(integer, r.width);
+    ystr("height");
+    y(integer, r.height);
+    y(map_close);
+}
+
+static void change_open(yajl_gen gen, const char *change, Con *con) {
+    y(map_open);
+    ystr("change");
+    ystr(change);
+    ystr("id");
+    y(integer, (uintptr_t)con);
+}
+
+/*
+ * Compares the container with its recorded state, appends the differences to
+ * gen (if non-NULL) and records the current state. Returns the number of
+ * changes.
+ *
+ */
+static int diff_con(yajl_gen gen, Con *con) {
+    int changes = 0;
+    struct tree_event_state *state = con->tree_event_state;
+
+    if (state == NULL) {
+        state = con->tree_event_state = scalloc(1, sizeof(struct tree_event_state));
+        state->parent = con->parent;
+        if (gen != NULL) {
+            /* The new container is sent as a whole, including its subtree. */
+            change_open(gen, "add", con);
+            ystr("parent");
+            y(integer, (uintptr_t)con->parent);
+            ystr("node");
+            dump_node(gen, con, false);
+            y(map_close);
+            changes++;
+            gen = NULL;
+        }
+    }
+
+    if (state->parent != con->parent) {
+        if (gen != NULL) {
+            change_open(gen, "move", con);
+            ystr("parent");
+            y(integer, (uintptr_t)con->parent);
+            ystr("old_parent");
+            y(integer, (uintptr_t)state->parent);
+            y(map_close);
+            changes++;
+        }
+        state->parent = con->parent;
+    }
+
+    if (!rect_equals(state->rect, con->rect) ||
+        !rect_equals(state->deco_rect, con->deco_rect) ||
+        !rect_equals(state->window_rect, con->window_rect)) {
+        if (gen != NULL) {
+            change_open(gen, "rect", con);
+            dump_rect(gen, "rect", con->rect);
+            dump_rect(gen, "deco_rect", con->deco_rect);
+            dump_rect(gen, "window_rect", con->window_rect);
+            y(map_close);
+            changes++;
+        }
+        state->rect = con->rect;
+        state->deco_rect = con->deco_rect;
+        state->window_rect = con->window_rect;
+    }
+
+    if (state->percent != con->percent) {
+        if (gen != NULL) {
+            change_open(gen, "percent", con);
+            ystr("percent");
+            y(double, con->percent);
+            y(map_close);
+            changes++;
+        }
+        state->percent = con->percent;
+    }
+
+    size_t count;
+    COLLECT_IDS(&(con->nodes_head), nodes, count);
+    bool children_changed = update_ids(&(state->nodes), &(state->num_nodes), count);
+    COLLECT_IDS(&(con->floating_head), floating_windows, count);
+    children_changed |= update_ids(&(state->floating), &(state->num_floating), count);
+    if (children_changed && gen != NULL) {
+        change_open(gen, "children", con);
+        dump_ids(gen, "nodes", state->nodes, state->num_nodes);
+        dump_ids(gen, "floating_nodes", state->floating, state->num_floating);
+        y(map_close);
+        changes++;
+    }
+
+    COLLECT_IDS(&(con->focus_head), focused, count);
+    if (update_ids(&(state->focus), &(state->num_focus), count) && gen != NULL) {
+        change_open(gen, "focus", con);
+        dump_ids(gen, "focus", state->focus, state->num_focus);
+        y(map_close);
+        changes++;
+    }
+
+    Con *child;
+    TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
+        changes += diff_con(gen, child);
+    }
+    TAILQ_FOREACH (child, &(con->floating_head), floating_windows) {
+        changes += diff_con(gen, child);
+    }
+
+    return changes;
+}
+
+/*
+ * Starts tracking the tree for the tree IPC event by recording the current
+ * state of every container. Called when the first client subscribes.
+ *
+ */
+void tree_events_start(void) {
+    if (tracking || croot == NULL) {
+        return;
+    }
+
+    DLOG("Starting to track the tree for tree events\n");
+    diff_con(NULL, croot);
+    num_removed = 0;
+    tracking = true;
+}
+
+static void tree_events_stop(void) {
+    DLOG("No more tree event subscribers, dropping recorded state\n");
+    Con *con;
+    TAILQ_FOREACH (con, &all_cons, all_cons) {
+        free_state(con);
+    }
+    FREE(removed);
+    num_removed = 0;
+    removed_size = 0;
+    FREE(scratch);
+    scratch_size = 0;
+    tracking = false;
+}
+
+/*
+ * Compares the tree with the state recorded at the last call and sends a tree
+ * event describing the differences to all subscribed clients. Does nothing if
+ * nothing changed or nobody is subscribed.
+ *
+ */
+void tree_events_flush(void) {
+    if (!ipc_has_event_listeners(I3_IPC_EVENT_TREE)) {
+        if (tracking) {
+            tree_events_stop();
+        }
+        return;
+    }
+    if (!tracking) {
+        tree_events_start();
+        return;
+    }
+
+    setlocale(LC_NUMERIC, "C");
+    yajl_gen gen = ygenalloc();
+
+    y(map_open);
+    ystr("generation");
+    y(integer, generation + 1);
+    ystr("changes");
+    y(array_open);
+
+    /* Removals come first so that clients can apply the changes in order even
+     * if a container id was reused within the same event. */
+    for (size_t i = 0; i < num_removed; i++) {
+        y(map_open);
+        ystr("change");
+        ystr("remove");
+        ystr("id");
+        y(integer, removed[i]);
+        y(map_close);
+    }
+    const int changes = num_removed + diff_con(gen, croot);
+    num_removed = 0;
+
+    y(array_close);
+    y(map_close);
+
+    if (changes > 0) {
+        generation++;
+        DLOG("Sending tree event for generation %" PRIu64 " with %d changes\n", generation, changes);
+
+        const unsigned char *payload;
+        ylength length;
+        y(get_buf, &payload, &length);
+        ipc_send_event(I3_IPC_EVENT_TREE, (const char *)payload);
+    }
+
+    y(free);
+    setlocale(LC_NUMERIC, "");
+}
+
+/*
+ * Releases the recorded state of a container which is about to be freed and
+ * remembers its removal for the next tree event.
+ *
+ */
+void tree_events_con_freed(Con *con) {
+    if (con->tree_event_state == NULL) {
+        return;
+    }
+    free_state(con);
+
+    if (num_removed == removed_size) {
+        removed_size = (removed_size == 0 ? 16 : removed_size * 2);
+        removed = srealloc(removed, removed_size * sizeof(uintptr_t));
+    }
+    removed[num_removed++] = (uintptr_t)con;
+}
+
+/*
+ * Returns the generation of the last tree event which was sent.
+ *
+ */
+uint64_t tree_events_generation(void) {
+    return generation;
+}
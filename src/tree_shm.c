@@ -0,0 +1,248 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * tree_shm.c: Publishes a read-only snapshot of the layout tree in a shared
+ *             memory segment (see the tree_shm_size directive).
+ *
+ * Local clients which look at the tree very often (overlays, auto-tilers)
+ * can read the segment without any syscalls and without parsing JSON, instead
+ * of sending GET_TREE requests. The snapshot is updated after rendering, see
+ * include/tree_shm.h for the format.
+ *
+ */
+#include "all.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Segments larger than this are not useful: even huge trees need a few
+ * hundred KiB. */
+#define TREE_SHM_MAX_SIZE (64 * 1024 * 1024)
+
+static char *shm_name = NULL;
+static int shm_fd = -1;
+static uint8_t *segment = NULL;
+static size_t segment_size = 0;
+static i3_tree_shm_header *header = NULL;
+
+/* State of the current update. The node array grows from the header
+ * upwards, the names from the end of the segment downwards. */
+static i3_tree_shm_node *nodes;
+static uint32_t num_nodes;
+static size_t names_start;
+static bool truncated;
+
+/*
+ * Creates the segment with the given size. Returns false on errors, which are
+ * logged.
+ *
+ */
+static bool tree_shm_open(size_t size) {
+#if defined(__FreeBSD__)
+    sasprintf(&shm_name, "/tmp/i3-tree-%d", getpid());
+#else
+    sasprintf(&shm_name, "/i3-tree-%d", getpid());
+#endif
+    shm_fd = shm_open(shm_name, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+    if (shm_fd == -1) {
+        ELOG("Could not shm_open SHM segment for the tree: %s\n", strerror(errno));
+        FREE(shm_name);
+        return false;
+    }
+
+    if (ftruncate(shm_fd, size) == -1) {
+        ELOG("Could not ftruncate SHM segment for the tree: %s\n", strerror(errno));
+        tree_shm_close();
+        return false;
+    }
+
+    segment = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    if (segment == MAP_FAILED) {
+        ELOG("Could not mmap SHM segment for the tree: %s\n", strerror(errno));
+        segment = NULL;
+        tree_shm_close();
+        return false;
+    }
+
+    segment_size = size;
+    memset(segment, '\0', segment_size);
+    header = (i3_tree_shm_header *)segment;
+    header->version = I3_TREE_SHM_VERSION;
+    header->size = segment_size;
+    header->focused = I3_TREE_SHM_NONE;
+    /* Generations start at 1, so the first update always writes. */
+    header->generation = 0;
+    LOG("Publishing the tree in SHM segment \"%s\" (%zu bytes)\n", shm_name, segment_size);
+    return true;
+}
+
+/*
+ * Removes the segment.
+ *
+ */
+void tree_shm_close(void) {
+    if (segment != NULL) {
+        munmap(segment, segment_size);
+        segment = NULL;
+        header = NULL;
+        segment_size = 0;
+    }
+    if (shm_fd != -1) {
+        close(shm_fd);
+        shm_fd = -1;
+    }
+    if (shm_name != NULL) {
+        shm_unlink(shm_name);
+        FREE(shm_name);
+    }
+}
+
+/*
+ * Returns the path of the segment, or NULL if it is disabled.
+ *
+ */
+const char *tree_shm_path(void) {
+    return shm_name;
+}
+
+/*
+ * Creates, resizes or removes the segment according to the tree_shm_size
+ * directive, and updates the I3_TREE_SHM_PATH atom.
+ *
+ */
+void tree_shm_configure(void) {
+    const long min_size = sizeof(i3_tree_shm_header) + sizeof(i3_tree_shm_node);
+    size_t size = 0;
+    if (config.tree_shm_size > 0) {
+        size = max(min(config.tree_shm_size, TREE_SHM_MAX_SIZE), min_size);
+    }
+    if (size == segment_size) {
+        return;
+    }
+
+    tree_shm_close();
+    if (size > 0 && tree_shm_open(size)) {
+        tree_shm_update();
+    }
+    update_tree_shm_atom();
+}
+
+/*
+ * Stores the name at the end of the segment and returns its offset, or 0 if
+ * it does not fit.
+ *
+ */
+static uint32_t store_name(const char *name, uint32_t *length) {
+    const size_t len = (name != NULL ? strlen(name) : 0);
+    const size_t nodes_end = (uint8_t *)(nodes + num_nodes) - segment;
+    if (len == 0 || names_start < nodes_end + len) {
+        *length = 0;
+        return 0;
+    }
+    names_start -= len;
+    memcpy(segment + names_start, name, len);
+    *length = len;
+    return names_start;
+}
+
+/*
+ * Appends the container and its children to the node array. Returns the
+ * index of the container, or I3_TREE_SHM_NONE if it did not fit.
+ *
+ */
+static uint32_t store_con(Con *con, uint32_t parent, uint32_t workspace, uint32_t output) {
+    if ((uint8_t *)(nodes + num_nodes + 1) > segment + names_start) {
+        truncated = true;
+        return I3_TREE_SHM_NONE;
+    }
+
+    const uint32_t index = num_nodes++;
+    if (con->type == CT_WORKSPACE) {
+        workspace = index;
+    } else if (con->type == CT_OUTPUT) {
+        output = index;
+    }
+
+    i3_tree_shm_node *node = &nodes[index];
+    node->id = (uintptr_t)con;
+    node->window = (con->window != NULL ? con->window->id : 0);
+    node->type = con->type;
+    node->flags = ((con->urgent ? I3_TREE_SHM_URGENT : 0) |
+                   (con->type == CT_FLOATING_CON ? I3_TREE_SHM_FLOATING : 0) |
+                   (con->fullscreen_mode != CF_NONE ? I3_TREE_SHM_FULLSCREEN : 0) |
+                   (con->sticky ? I3_TREE_SHM_STICKY : 0));
+    node->parent = parent;
+    node->focus = I3_TREE_SHM_NONE;
+    node->workspace = workspace;
+    node->output = output;
+    node->x = con->rect.x;
+    node->y = con->rect.y;
+    node->width = con->rect.width;
+    node->height = con->rect.height;
+
+    const char *name = con->name;
+    if (con->window != NULL && con->window->name != NULL) {
+        name = i3string_as_utf8(con->window->name);
+    }
+    node->name_offset = store_name(name, &(node->name_length));
+
+    if (con == focused) {
+        header->focused = index;
+    }
+
+    Con *focus_child = TAILQ_FIRST(&(con->focus_head));
+    Con *child;
+    TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
+        const uint32_t child_index = store_con(child, index, workspace, output);
+        if (child == focus_child) {
+            nodes[index].focus = child_index;
+        }
+    }
+    TAILQ_FOREACH (child, &(con->floating_head), floating_windows) {
+        const uint32_t child_index = store_con(child, index, workspace, output);
+        if (child == focus_child) {
+            nodes[index].focus = child_index;
+        }
+    }
+    return index;
+}
+
+/*
+ * Writes the current tree into the segment, unless it did not change since
+ * the last update. Does nothing if the segment is disabled.
+ *
+ */
+void tree_shm_update(void) {
+    if (header == NULL || croot == NULL || header->generation == tree_generation()) {
+        return;
+    }
+
+    const bool was_truncated = header->truncated;
+
+    /* Readers retry while the sequence is odd. */
+    const uint32_t sequence = header->sequence;
+    __atomic_store_n(&(header->sequence), sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    nodes = (i3_tree_shm_node *)(segment + sizeof(i3_tree_shm_header));
+    num_nodes = 0;
+    names_start = segment_size;
+    truncated = false;
+    header->focused = I3_TREE_SHM_NONE;
+
+    store_con(croot, I3_TREE_SHM_NONE, I3_TREE_SHM_NONE, I3_TREE_SHM_NONE);
+
+    header->num_nodes = num_nodes;
+    header->truncated = truncated;
+    header->generation = tree_generation();
+
+    __atomic_store_n(&(header->sequence), sequence + 2, __ATOMIC_RELEASE);
+
+    if (truncated && !was_truncated) {
+        ELOG("The tree does not fit into its SHM segment of %zu bytes, increase tree_shm_size\n", segment_size);
+    }
+}
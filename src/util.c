@@ -9,12 +9,14 @@
  *
  */
 #include "all.h"
+#include "restart_snapshot.h"
 
 #include <ctype.h>
 #include <fcntl.h>
 #include <inttypes.h>
 #include <libgen.h>
 #include <locale.h>
+#include <sys/mman.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #if defined(__OpenBSD__)
@@ -213,6 +215,60 @@ static char **add_argument(char **original, char *opt_char, char *opt_arg, char
 #define y(x, ...) yajl_gen_##x(gen, ##__VA_ARGS__)
 #define ystr(str) yajl_gen_string(gen, (unsigned char *)str, strlen(str))
 
+/*
+ * Stores the given layout as a restart snapshot (see restart_snapshot.h) in an
+ * unlinked file and passes its descriptor to the new process in
+ * _I3_RESTART_SNAPSHOT_FD. The layout file stays the fallback, so errors are
+ * only logged.
+ *
+ */
+static void store_restart_snapshot(const unsigned char *json, size_t length) {
+    uint8_t *cbor;
+    size_t cbor_length;
+    if (!ipc_json_to_cbor(json, length, &cbor, &cbor_length)) {
+        ELOG("Could not encode the restart snapshot\n");
+        return;
+    }
+
+    char *filename = get_process_filename("restart-snapshot");
+    if (filename == NULL) {
+        free(cbor);
+        return;
+    }
+
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd == -1) {
+        ELOG("Could not create the restart snapshot \"%s\": %s\n", filename, strerror(errno));
+        free(filename);
+        free(cbor);
+        return;
+    }
+    /* The descriptor keeps the file around for the new process. */
+    unlink(filename);
+    free(filename);
+
+    restart_snapshot_header header = {
+        .version = RESTART_SNAPSHOT_VERSION,
+        .header_size = sizeof(restart_snapshot_header),
+        .length = cbor_length,
+    };
+    memcpy(header.magic, RESTART_SNAPSHOT_MAGIC, sizeof(header.magic));
+
+    if (writeall(fd, &header, sizeof(header)) == -1 ||
+        writeall(fd, cbor, cbor_length) == -1) {
+        ELOG("Could not write the restart snapshot: %s\n", strerror(errno));
+        close(fd);
+        free(cbor);
+        return;
+    }
+    free(cbor);
+
+    char *fdstr = NULL;
+    sasprintf(&fdstr, "%d", fd);
+    setenv("_I3_RESTART_SNAPSHOT_FD", fdstr, 1);
+    free(fdstr);
+}
+
 static char *store_restart_layout(void) {
     setlocale(LC_NUMERIC, "C");
     yajl_gen gen = yajl_gen_alloc(NULL);
@@ -225,6 +281,8 @@ static char *store_restart_layout(void) {
     size_t length;
     y(get_buf, &payload, &length);
 
+    store_restart_snapshot(payload, length);
+
     /* create a temporary file if one hasn't been specified, or just
      * resolve the tildes in the specified path */
     char *filename;
@@ -284,6 +342,7 @@ void i3_restart(bool forget_layout) {
     restore_geometry();
 
     ipc_shutdown(SHUTDOWN_REASON_RESTART, -1);
+    trace_close();
 
     LOG("restarting \"%s\"...\n", start_argv[0]);
     /* make sure -a is in the argument list or add it */
@@ -449,6 +508,51 @@ ssize_t slurp(const char *path, char **buf) {
     return (ssize_t)n;
 }
 
+/*
+ * Maps the file at path read-only into memory, returning the length of the
+ * file or -1 if it could not be mapped. buf is set to the mapping, which has
+ * to be released with unmap_file(), or NULL if the file is empty or -1 is
+ * returned.
+ *
+ */
+ssize_t map_file(const char *path, char **buf) {
+    *buf = NULL;
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        ELOG("Cannot open file \"%s\": %s\n", path, strerror(errno));
+        return -1;
+    }
+    struct stat stbuf;
+    if (fstat(fd, &stbuf) != 0) {
+        ELOG("Cannot fstat() \"%s\": %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    /* Empty files cannot be mapped. */
+    if (stbuf.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    void *data = mmap(NULL, stbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        ELOG("Cannot mmap() \"%s\": %s\n", path, strerror(errno));
+        return -1;
+    }
+    *buf = data;
+    return (ssize_t)stbuf.st_size;
+}
+
+/*
+ * Releases a mapping returned by map_file().
+ *
+ */
+void unmap_file(char *buf, ssize_t len) {
+    if (buf != NULL) {
+        munmap(buf, len);
+    }
+}
+
 /*
  * Convert a direction to its corresponding orientation.
  *
@@ -11,19 +11,368 @@
 
 #include <math.h>
 
+/* All window icons, and the icons by the hash of their data. Icons whose hash
+ * collides with that of a different icon are not in the hashmap. */
+static TAILQ_HEAD(window_icons_head, window_icon) window_icons = TAILQ_HEAD_INITIALIZER(window_icons);
+static hashmap_t *window_icons_by_hash;
+
+static uint64_t window_icon_hash(const uint32_t *pixels, uint32_t width, uint32_t height) {
+    uint64_t hash = 14695981039346656037ULL;
+    const uint32_t header[2] = {width, height};
+    const uint8_t *bytes = (const uint8_t *)header;
+    for (size_t i = 0; i < sizeof(header); i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    bytes = (const uint8_t *)pixels;
+    for (uint64_t i = 0; i < (uint64_t)width * height * 4; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* Icons with more pixels than this are converted on a worker thread. */
+#define ICON_SYNC_PIXELS (64 * 64)
+
+/* Icons no window uses anymore are freed while i3 is idle (so that closing
+ * many windows stays cheap), this many per run. Until then, they can be
+ * shared again, e.g. when an application is restarted. */
+#define UNUSED_ICONS_PER_RUN 16
+
+static bool free_unused_icons(maintenance_task *task);
+static maintenance_task unused_icons_task = MAINTENANCE_TASK_INITIALIZER("window_icons", free_unused_icons);
+
+/* After windows were closed, the text width cache is trimmed to this many
+ * entries per remaining window (plus some for marks and workspace names), as
+ * the titles of the closed windows are unlikely to be measured again. */
+#define TEXT_WIDTHS_PER_WINDOW 2
+#define TEXT_WIDTHS_EXTRA 64
+
+static bool trim_text_widths(maintenance_task *task);
+static maintenance_task text_widths_task = MAINTENANCE_TASK_INITIALIZER("text_width_cache", trim_text_widths);
+
+/* Renders the decorations again once icons were converted, see
+ * icon_job_done(). */
+static struct ev_timer *icon_redraw_timer;
+
+/*
+ * Converts the icon data for Cairo (which uses premultiplied alpha) and
+ * scales it to fit into a square of the given size. Only uses its arguments,
+ * so that it can run on a worker thread.
+ *
+ */
+static cairo_surface_t *window_icon_convert(const uint32_t *pixels, uint32_t width, uint32_t height, int size) {
+    const uint64_t len = (uint64_t)width * height;
+    uint32_t *data = smalloc(len * 4);
+
+    /* Cairo uses premultiplied alpha */
+    premultiply_argb(data, pixels, len);
+
+    cairo_surface_t *original = cairo_image_surface_create_for_data(
+        (unsigned char *)data,
+        CAIRO_FORMAT_ARGB32,
+        width,
+        height,
+        width * 4);
+    static cairo_user_data_key_t free_data;
+    cairo_surface_set_user_data(original, &free_data, data, free);
+
+    const double scale_x = (double)size / width;
+    const double scale_y = (double)size / height;
+    const double scale = (scale_x < scale_y ? scale_x : scale_y);
+    const int scaled_width = max(1, lround(width * scale));
+    const int scaled_height = max(1, lround(height * scale));
+    if ((uint32_t)scaled_width == width && (uint32_t)scaled_height == height) {
+        return original;
+    }
+
+    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, scaled_width, scaled_height);
+    cairo_t *cr = cairo_create(surface);
+    cairo_scale(cr, (double)scaled_width / width, (double)scaled_height / height);
+    cairo_set_source_surface(cr, original, 0, 0);
+    cairo_paint(cr);
+    cairo_destroy(cr);
+    cairo_surface_destroy(original);
+    return surface;
+}
+
+/* Converting an icon on a worker thread. The job holds a reference to the
+ * icon, whose pixels do not change. */
+struct icon_job {
+    struct window_icon *icon;
+    int size;
+    cairo_surface_t *surface;
+};
+
+static void icon_job_work(void *data) {
+    struct icon_job *job = data;
+    job->surface = window_icon_convert(job->icon->pixels, job->icon->width, job->icon->height, job->size);
+}
+
+static void window_icon_release(struct window_icon *icon);
+
+/*
+ * Frees the copy of the icon in the X server, which has to be uploaded again
+ * after the icon was scaled.
+ *
+ */
+static void window_icon_free_pixmap(struct window_icon *icon) {
+    if (icon->pixmap.id == XCB_NONE) {
+        return;
+    }
+    draw_util_surface_free(conn, &(icon->pixmap));
+    xcb_free_pixmap(conn, icon->pixmap.id);
+    icon->pixmap.id = XCB_NONE;
+}
+
+/*
+ * Marks the title bars of all windows using one of the converted icons for
+ * redrawing and renders them, once for all icons converted at the same time.
+ *
+ */
+static void icon_redraw_cb(EV_P_ ev_timer *w, int revents) {
+    Con *con;
+    TAILQ_FOREACH (con, &all_cons, all_cons) {
+        if (con->window != NULL && con->window->icon != NULL && con->window->icon->converted) {
+            con->window->name_x_changed = true;
+        }
+    }
+    struct window_icon *icon;
+    TAILQ_FOREACH (icon, &window_icons, icons) {
+        icon->converted = false;
+    }
+    tree_schedule_render();
+}
+
+static void icon_job_done(void *data) {
+    struct icon_job *job = data;
+    struct window_icon *icon = job->icon;
+
+    /* The icon might have been scaled to a different size meanwhile. */
+    if (icon->size != job->size) {
+        cairo_surface_destroy(job->surface);
+    } else {
+        if (icon->surface != NULL) {
+            cairo_surface_destroy(icon->surface);
+        }
+        window_icon_free_pixmap(icon);
+        icon->surface = job->surface;
+        icon->converted = true;
+
+        if (icon_redraw_timer == NULL) {
+            icon_redraw_timer = scalloc(1, sizeof(struct ev_timer));
+            ev_timer_init(icon_redraw_timer, icon_redraw_cb, 0., 0.);
+        }
+        if (!ev_is_active(icon_redraw_timer)) {
+            ev_timer_start(main_loop, icon_redraw_timer);
+        }
+    }
+
+    window_icon_release(icon);
+    free(job);
+}
+
+/*
+ * Converts the icon for Cairo and scales it to fit into a square of the given
+ * size. Large icons are converted on a worker thread. Until that is done, the
+ * title bar keeps the space for the icon free (or shows the icon at its
+ * previous size).
+ *
+ */
+static void window_icon_scale(struct window_icon *icon, int size) {
+    icon->size = size;
+    if ((uint64_t)icon->width * icon->height <= ICON_SYNC_PIXELS) {
+        if (icon->surface != NULL) {
+            cairo_surface_destroy(icon->surface);
+        }
+        window_icon_free_pixmap(icon);
+        icon->surface = window_icon_convert(icon->pixels, icon->width, icon->height, size);
+        return;
+    }
+
+    struct icon_job *job = scalloc(1, sizeof(struct icon_job));
+    job->icon = icon;
+    job->size = size;
+    icon->refcount++;
+    worker_submit(icon_job_work, icon_job_done, job);
+}
+
+/*
+ * Returns a reference to the icon with the given data (in the format of
+ * _NET_WM_ICON), creating it if no window uses the same icon yet.
+ *
+ */
+static struct window_icon *window_icon_get(const uint32_t *pixels, uint32_t width, uint32_t height, int size) {
+    if (window_icons_by_hash == NULL) {
+        window_icons_by_hash = hashmap_new();
+    }
+
+    const uint64_t hash = window_icon_hash(pixels, width, height);
+    struct window_icon *icon = hashmap_lookup(window_icons_by_hash, hash);
+    if (icon != NULL &&
+        icon->width == width && icon->height == height &&
+        memcmp(icon->pixels, pixels, (uint64_t)width * height * 4) == 0) {
+        DLOG("Sharing icon %p (%d windows)\n", icon, icon->refcount + 1);
+        icon->refcount++;
+        /* Unused icons are not rescaled, see window_icons_rescale(). */
+        if (icon->size != size) {
+            window_icon_scale(icon, size);
+        }
+        return icon;
+    }
+    const bool collision = (icon != NULL);
+
+    icon = scalloc_counted(&memory_counters[MEM_ICONS], 1, sizeof(struct window_icon));
+    icon->refcount = 1;
+    icon->hash = hash;
+    icon->width = width;
+    icon->height = height;
+    icon->pixels = smalloc_counted(&memory_counters[MEM_ICONS], (uint64_t)width * height * 4);
+    memcpy(icon->pixels, pixels, (uint64_t)width * height * 4);
+    window_icon_scale(icon, size);
+
+    TAILQ_INSERT_TAIL(&window_icons, icon, icons);
+    if (!collision) {
+        hashmap_insert(window_icons_by_hash, hash, icon);
+    }
+    return icon;
+}
+
+/*
+ * Releases a reference to the given icon (which may be NULL). Once no window
+ * uses it anymore, it is freed when i3 is idle.
+ *
+ */
+static void window_icon_release(struct window_icon *icon) {
+    if (icon == NULL || --icon->refcount > 0) {
+        return;
+    }
+    maintenance_schedule(&unused_icons_task);
+}
+
+static void window_icon_free(struct window_icon *icon) {
+    if (hashmap_lookup(window_icons_by_hash, icon->hash) == icon) {
+        hashmap_remove(window_icons_by_hash, icon->hash);
+    }
+    TAILQ_REMOVE(&window_icons, icon, icons);
+    if (icon->surface != NULL) {
+        cairo_surface_destroy(icon->surface);
+    }
+    window_icon_free_pixmap(icon);
+    free_counted(icon->pixels);
+    free_counted(icon);
+}
+
+/*
+ * Frees some of the icons which are not used by any window anymore.
+ *
+ */
+static bool free_unused_icons(maintenance_task *task) {
+    int freed = 0;
+    struct window_icon *icon = TAILQ_FIRST(&window_icons);
+    while (icon != NULL) {
+        struct window_icon *next = TAILQ_NEXT(icon, icons);
+        if (icon->refcount == 0) {
+            if (freed == UNUSED_ICONS_PER_RUN) {
+                return true;
+            }
+            window_icon_free(icon);
+            freed++;
+        }
+        icon = next;
+    }
+    return false;
+}
+
+/*
+ * Drops the widths of titles which are probably gone from the text width
+ * cache.
+ *
+ */
+static bool trim_text_widths(maintenance_task *task) {
+    predict_text_width_trim(window_pool.live * TEXT_WIDTHS_PER_WINDOW + TEXT_WIDTHS_EXTRA);
+    return false;
+}
+
+/*
+ * Returns the number of distinct window icons, the bytes of their scaled
+ * copies (the original data is counted in memory_counters[MEM_ICONS]) and of
+ * the pixmaps they were uploaded into.
+ *
+ */
+void window_icons_memory(uint64_t *count, uint64_t *surface_bytes, uint64_t *pixmap_bytes) {
+    *count = 0;
+    *surface_bytes = 0;
+    *pixmap_bytes = 0;
+    struct window_icon *icon;
+    TAILQ_FOREACH (icon, &window_icons, icons) {
+        (*count)++;
+        if (icon->surface != NULL) {
+            *surface_bytes += (uint64_t)cairo_image_surface_get_stride(icon->surface) *
+                              cairo_image_surface_get_height(icon->surface);
+        }
+        if (icon->pixmap.id != XCB_NONE) {
+            *pixmap_bytes += (uint64_t)icon->pixmap.width * icon->pixmap.height * 4;
+        }
+    }
+}
+
+/*
+ * Draws the icon into a square of the given size. The icon is uploaded into
+ * the X server the first time it is drawn, so that drawing it again does not
+ * send the pixels again.
+ *
+ */
+void window_icon_draw(struct window_icon *icon, surface_t *surface, int x, int y, int size) {
+    if (icon->surface == NULL) {
+        return;
+    }
+    if (icon->pixmap.id == XCB_NONE && !draw_util_image_upload(conn, icon->surface, &(icon->pixmap))) {
+        draw_util_image(icon->surface, surface, x, y, size, size);
+        return;
+    }
+    draw_util_image_pixmap(&(icon->pixmap), surface, x, y, size, size);
+}
+
+/*
+ * Returns the size window icons are scaled to: the height of the decoration
+ * minus a pixel of padding on each side.
+ *
+ */
+static int window_icon_size(void) {
+    return max(1, render_deco_height() - logical_px(2));
+}
+
+/*
+ * Scales all window icons to the current decoration height again. Called
+ * after reloading the configuration, which may change the font.
+ *
+ */
+void window_icons_rescale(void) {
+    const int size = window_icon_size();
+    struct window_icon *icon;
+    TAILQ_FOREACH (icon, &window_icons, icons) {
+        if (icon->refcount > 0 && icon->size != size) {
+            window_icon_scale(icon, size);
+        }
+    }
+}
+
 /*
  * Frees an i3Window and all its members.
  *
  */
 void window_free(i3Window *win) {
-    FREE(win->class_class);
-    FREE(win->class_instance);
-    FREE(win->role);
-    FREE(win->machine);
+    intern_release(win->class_class);
+    intern_release(win->class_instance);
+    intern_release(win->role);
+    intern_release(win->machine);
     i3string_free(win->name);
-    cairo_surface_destroy(win->icon);
+    window_icon_release(win->icon);
     FREE(win->ran_assignments);
-    FREE(win);
+    pool_free(&window_pool, win);
+
+    maintenance_schedule(&text_widths_task);
+    memory_trim_later();
 }
 
 /*
@@ -40,25 +389,43 @@ void window_update_class(i3Window *win, xcb_get_property_reply_t *prop) {
 
     /* We cannot use asprintf here since this property contains two
      * null-terminated strings (for compatibility reasons). Instead, we
-     * use strdup() on both strings */
+     * intern both strings separately. */
     const size_t prop_length = xcb_get_property_value_length(prop);
     char *new_class = xcb_get_property_value(prop);
     const size_t class_class_index = strnlen(new_class, prop_length) + 1;
 
-    FREE(win->class_instance);
-    FREE(win->class_class);
+    intern_release(win->class_instance);
+    intern_release(win->class_class);
 
-    win->class_instance = sstrndup(new_class, prop_length);
+    win->class_instance = intern_string(new_class, prop_length);
     if (class_class_index < prop_length)
-        win->class_class = sstrndup(new_class + class_class_index, prop_length - class_class_index);
+        win->class_class = intern_string(new_class + class_class_index, prop_length - class_class_index);
     else
         win->class_class = NULL;
     LOG("WM_CLASS changed to %s (instance), %s (class)\n",
         win->class_instance, win->class_class);
+    con_reindex_window_properties(win);
 
     free(prop);
 }
 
+/*
+ * Returns true if the property holds the same title as win->name, so that
+ * there is nothing to update. Clients like terminals re-set their title far
+ * more often than it actually changes.
+ *
+ */
+static bool window_name_unchanged(i3Window *win, xcb_get_property_reply_t *prop) {
+    if (win->name == NULL) {
+        return false;
+    }
+    /* Compare up to the first zero byte, see #3515. */
+    const char *value = xcb_get_property_value(prop);
+    const size_t len = strnlen(value, xcb_get_property_value_length(prop));
+    return (len == i3string_get_num_bytes(win->name) &&
+            memcmp(value, i3string_as_utf8(win->name), len) == 0);
+}
+
 /*
  * Updates the name by using _NET_WM_NAME (encoded in UTF-8) for the given
  * window. Further updates using window_update_name_legacy will be ignored.
@@ -71,6 +438,12 @@ void window_update_name(i3Window *win, xcb_get_property_reply_t *prop) {
         return;
     }
 
+    if (window_name_unchanged(win, prop)) {
+        win->uses_net_wm_name = true;
+        free(prop);
+        return;
+    }
+
     i3string_free(win->name);
 
     /* Truncate the name at the first zero byte. See #3515. */
@@ -80,7 +453,7 @@ void window_update_name(i3Window *win, xcb_get_property_reply_t *prop) {
     free(name);
 
     Con *con = con_by_window_id(win->id);
-    if (con != NULL && con->title_format != NULL) {
+    if (con != NULL && con->cold->title_format != NULL) {
         i3String *name = con_parse_title_format(con);
         ewmh_update_visible_name(win->id, i3string_as_utf8(name));
         I3STRING_FREE(name);
@@ -108,7 +481,7 @@ void window_update_name_legacy(i3Window *win, xcb_get_property_reply_t *prop) {
     }
 
     /* ignore update when the window is known to already have a UTF-8 name */
-    if (win->uses_net_wm_name) {
+    if (win->uses_net_wm_name || window_name_unchanged(win, prop)) {
         free(prop);
         return;
     }
@@ -120,7 +493,7 @@ void window_update_name_legacy(i3Window *win, xcb_get_property_reply_t *prop) {
     free(name);
 
     Con *con = con_by_window_id(win->id);
-    if (con != NULL && con->title_format != NULL) {
+    if (con != NULL && con->cold->title_format != NULL) {
         i3String *name = con_parse_title_format(con);
         ewmh_update_visible_name(win->id, i3string_as_utf8(name));
         I3STRING_FREE(name);
@@ -221,12 +594,11 @@ void window_update_role(i3Window *win, xcb_get_property_reply_t *prop) {
         return;
     }
 
-    char *new_role;
-    sasprintf(&new_role, "%.*s", xcb_get_property_value_length(prop),
-              (char *)xcb_get_property_value(prop));
-    FREE(win->role);
+    char *new_role = intern_string((char *)xcb_get_property_value(prop), xcb_get_property_value_length(prop));
+    intern_release(win->role);
     win->role = new_role;
     LOG("WM_WINDOW_ROLE changed to \"%s\"\n", win->role);
+    con_reindex_window_properties(win);
 
     free(prop);
 }
@@ -245,8 +617,9 @@ void window_update_type(i3Window *window, xcb_get_property_reply_t *reply) {
 
     window->window_type = new_type;
     LOG("_NET_WM_WINDOW_TYPE changed to %i.\n", window->window_type);
+    con_reindex_window_properties(window);
 
-    run_assignments(window);
+    run_assignments(window, WP_WINDOW_TYPE);
 }
 
 /*
@@ -470,6 +843,36 @@ void window_update_motif_hints(i3Window *win, xcb_get_property_reply_t *prop, bo
 #undef MWM_DECOR_TITLE
 }
 
+/*
+ * Updates the WM_PROTOCOLS (WM_TAKE_FOCUS and WM_DELETE_WINDOW), so that
+ * focusing and killing the window need no round-trip.
+ *
+ */
+void window_update_protocols(i3Window *win, xcb_get_property_reply_t *prop) {
+    win->needs_take_focus = false;
+    win->supports_delete_window = false;
+
+    if (prop == NULL || prop->type != XCB_ATOM_ATOM || prop->format != 32) {
+        DLOG("WM_PROTOCOLS not set.\n");
+        FREE(prop);
+        return;
+    }
+
+    const xcb_atom_t *atoms = xcb_get_property_value(prop);
+    const int num_atoms = xcb_get_property_value_length(prop) / sizeof(xcb_atom_t);
+    for (int i = 0; i < num_atoms; i++) {
+        if (atoms[i] == A_WM_TAKE_FOCUS) {
+            win->needs_take_focus = true;
+        } else if (atoms[i] == A_WM_DELETE_WINDOW) {
+            win->supports_delete_window = true;
+        }
+    }
+    DLOG("WM_PROTOCOLS changed: take_focus = %d, delete_window = %d\n",
+         win->needs_take_focus, win->supports_delete_window);
+
+    free(prop);
+}
+
 /*
  * Updates the WM_CLIENT_MACHINE
  *
@@ -481,8 +884,9 @@ void window_update_machine(i3Window *win, xcb_get_property_reply_t *prop) {
         return;
     }
 
-    FREE(win->machine);
-    win->machine = sstrndup((char *)xcb_get_property_value(prop), xcb_get_property_value_length(prop));
+    char *new_machine = intern_string((char *)xcb_get_property_value(prop), xcb_get_property_value_length(prop));
+    intern_release(win->machine);
+    win->machine = new_machine;
     LOG("WM_CLIENT_MACHINE changed to \"%s\"\n", win->machine);
 
     free(prop);
@@ -492,7 +896,7 @@ void window_update_icon(i3Window *win, xcb_get_property_reply_t *prop) {
     uint32_t *data = NULL;
     uint32_t width, height;
     uint64_t len = 0;
-    const uint32_t pref_size = (uint32_t)(render_deco_height() - logical_px(2));
+    const uint32_t pref_size = (uint32_t)window_icon_size();
 
     if (!prop || prop->type != XCB_ATOM_CARDINAL || prop->format != 32) {
         DLOG("_NET_WM_ICON is not set\n");
@@ -564,35 +968,9 @@ void window_update_icon(i3Window *win, xcb_get_property_reply_t *prop) {
 
     win->name_x_changed = true; /* trigger a redraw */
 
-    uint32_t *icon = smalloc(len * 4);
-
-    for (uint64_t i = 0; i < len; i++) {
-        uint8_t r, g, b, a;
-        const uint32_t pixel = data[2 + i];
-        a = (pixel >> 24) & 0xff;
-        r = (pixel >> 16) & 0xff;
-        g = (pixel >> 8) & 0xff;
-        b = (pixel >> 0) & 0xff;
-
-        /* Cairo uses premultiplied alpha */
-        r = (r * a) / 0xff;
-        g = (g * a) / 0xff;
-        b = (b * a) / 0xff;
-
-        icon[i] = ((uint32_t)a << 24) | (r << 16) | (g << 8) | b;
-    }
-
-    if (win->icon != NULL) {
-        cairo_surface_destroy(win->icon);
-    }
-    win->icon = cairo_image_surface_create_for_data(
-        (unsigned char *)icon,
-        CAIRO_FORMAT_ARGB32,
-        width,
-        height,
-        width * 4);
-    static cairo_user_data_key_t free_data;
-    cairo_surface_set_user_data(win->icon, &free_data, icon, free);
+    struct window_icon *icon = window_icon_get(data + 2, width, height, pref_size);
+    window_icon_release(win->icon);
+    win->icon = icon;
 
     FREE(prop);
 }
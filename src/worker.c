@@ -0,0 +1,159 @@
+/*
+ * vim:ts=4:sw=4:expandtab
+ *
+ * i3 - an improved dynamic tiling window manager
+ * © 2009 Michael Stapelberg and contributors (see also: LICENSE)
+ *
+ * worker.c: A small pool of threads for work which does not need any of i3's
+ *           state, like serializing IPC replies or scaling window icons.
+ *
+ * The threads are started when the first job is submitted. Finished jobs are
+ * passed back to the main loop using an ev_async watcher.
+ *
+ */
+#include "all.h"
+
+#include <locale.h>
+#include <pthread.h>
+
+/* At most this many threads are started, fewer on machines with fewer
+ * processors. */
+#define MAX_WORKERS 4
+
+struct job {
+    worker_fn work;
+    worker_fn done;
+    void *data;
+
+    TAILQ_ENTRY(job) jobs;
+};
+
+/* Protects both queues. The workers wait on pending_cond for jobs. */
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pending_cond = PTHREAD_COND_INITIALIZER;
+static TAILQ_HEAD(jobs_head, job) pending_jobs = TAILQ_HEAD_INITIALIZER(pending_jobs);
+static struct jobs_head finished_jobs = TAILQ_HEAD_INITIALIZER(finished_jobs);
+
+/* Signals the main loop that jobs are finished. */
+static struct ev_async *finished_watcher;
+static int num_workers = 0;
+static bool workers_started = false;
+
+static void *worker_main(void *arg) {
+    /* Numbers have to be formatted with a decimal point (e.g. in JSON),
+     * regardless of the locale of the main thread. */
+    locale_t c_locale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+    if (c_locale != (locale_t)0) {
+        uselocale(c_locale);
+    }
+
+    pthread_mutex_lock(&queue_lock);
+    while (true) {
+        struct job *job;
+        while ((job = TAILQ_FIRST(&pending_jobs)) == NULL) {
+            pthread_cond_wait(&pending_cond, &queue_lock);
+        }
+        TAILQ_REMOVE(&pending_jobs, job, jobs);
+        pthread_mutex_unlock(&queue_lock);
+
+        job->work(job->data);
+
+        pthread_mutex_lock(&queue_lock);
+        TAILQ_INSERT_TAIL(&finished_jobs, job, jobs);
+        ev_async_send(main_loop, finished_watcher);
+    }
+    return NULL;
+}
+
+/*
+ * Calls the done functions of the finished jobs, on the main thread.
+ *
+ */
+static void finished_cb(EV_P_ ev_async *w, int revents) {
+    struct jobs_head finished = TAILQ_HEAD_INITIALIZER(finished);
+    struct job *job;
+    pthread_mutex_lock(&queue_lock);
+    while ((job = TAILQ_FIRST(&finished_jobs)) != NULL) {
+        TAILQ_REMOVE(&finished_jobs, job, jobs);
+        TAILQ_INSERT_TAIL(&finished, job, jobs);
+    }
+    pthread_mutex_unlock(&queue_lock);
+
+    while ((job = TAILQ_FIRST(&finished)) != NULL) {
+        TAILQ_REMOVE(&finished, job, jobs);
+        job->done(job->data);
+        free(job);
+    }
+}
+
+/*
+ * Starts the worker threads. Returns false if not even one could be started.
+ *
+ */
+static bool start_workers(void) {
+    if (workers_started) {
+        return (num_workers > 0);
+    }
+    workers_started = true;
+
+    finished_watcher = scalloc(1, sizeof(struct ev_async));
+    ev_async_init(finished_watcher, finished_cb);
+    ev_async_start(main_loop, finished_watcher);
+
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    const int wanted = max(1, min(MAX_WORKERS, (int)processors));
+
+    /* The workers must not receive any signals, they are handled by the main
+     * thread (see sighandler.c). */
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    for (int i = 0; i < wanted; i++) {
+        pthread_t thread;
+        const int error = pthread_create(&thread, NULL, worker_main, NULL);
+        if (error != 0) {
+            ELOG("Could not start worker thread: %s\n", strerror(error));
+            break;
+        }
+        pthread_detach(thread);
+        num_workers++;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    DLOG("Started %d worker threads\n", num_workers);
+
+    if (num_workers == 0) {
+        ev_async_stop(main_loop, finished_watcher);
+        FREE(finished_watcher);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Runs work(data) on one of the worker threads and afterwards done(data) on
+ * the main loop. work must not touch any of i3's state (the tree, the
+ * configuration, the X11 connection, the log, …). Jobs are started in the
+ * order in which they were submitted, but may finish in any order.
+ *
+ * If no thread can be started, both functions are called right away.
+ *
+ */
+void worker_submit(worker_fn work, worker_fn done, void *data) {
+    if (!start_workers()) {
+        setlocale(LC_NUMERIC, "C");
+        work(data);
+        setlocale(LC_NUMERIC, "");
+        done(data);
+        return;
+    }
+
+    struct job *job = smalloc(sizeof(struct job));
+    job->work = work;
+    job->done = done;
+    job->data = data;
+
+    pthread_mutex_lock(&queue_lock);
+    TAILQ_INSERT_TAIL(&pending_jobs, job, jobs);
+    pthread_cond_signal(&pending_cond);
+    pthread_mutex_unlock(&queue_lock);
+}
@@ -11,6 +11,8 @@
 #include "all.h"
 #include "yajl_utils.h"
 
+#include <ctype.h>
+
 /*
  * Stores a copy of the name of the last used workspace for the workspace
  * back-and-forth switching.
@@ -22,16 +24,131 @@ char *previous_workspace_name = NULL;
  * keybindings. */
 static char **binding_workspace_names = NULL;
 
+/*
+ * Index of the workspaces (which are attached to an output's content
+ * container) by lower-cased name and by number. Names are unique, but many
+ * workspaces can share a number (e.g. "1" and "1: mail", or -1 for all named
+ * workspaces). When a bucket holds more than one workspace, the lookup falls
+ * back to walking the outputs, which keeps the order in which they are found.
+ *
+ */
+typedef struct workspace_bucket {
+    int count;
+    /* The workspace if count is 1 (NULL if it yet needs to be looked up). */
+    Con *ws;
+} workspace_bucket;
+
+static hashmap_t *workspaces_by_name;
+static hashmap_t *workspaces_by_num;
+
+static char *workspace_name_key(const char *name) {
+    char *key = sstrdup(name);
+    for (char *walk = key; *walk != '\0'; walk++) {
+        *walk = tolower((unsigned char)*walk);
+    }
+    return key;
+}
+
+static void bucket_add(workspace_bucket *bucket, Con *ws) {
+    bucket->ws = (bucket->count == 0 ? ws : NULL);
+    bucket->count++;
+}
+
+static void bucket_remove(workspace_bucket *bucket, Con *ws) {
+    bucket->count--;
+    if (bucket->ws == ws || bucket->count == 0) {
+        bucket->ws = NULL;
+    }
+}
+
+/*
+ * Adds the workspace to the name and number index. Called when the workspace
+ * is attached to a content container.
+ *
+ */
+void workspace_index(Con *ws) {
+    if (workspaces_by_name == NULL) {
+        workspaces_by_name = hashmap_new();
+        workspaces_by_num = hashmap_new();
+    }
+
+    if (ws->name != NULL) {
+        char *key = workspace_name_key(ws->name);
+        workspace_bucket *bucket = hashmap_lookup_str(workspaces_by_name, key);
+        if (bucket == NULL) {
+            bucket = scalloc(1, sizeof(workspace_bucket));
+            hashmap_insert_str(workspaces_by_name, key, bucket);
+        }
+        bucket_add(bucket, ws);
+        free(key);
+    }
+
+    workspace_bucket *bucket = hashmap_lookup(workspaces_by_num, (int64_t)ws->num);
+    if (bucket == NULL) {
+        bucket = scalloc(1, sizeof(workspace_bucket));
+        hashmap_insert(workspaces_by_num, (int64_t)ws->num, bucket);
+    }
+    bucket_add(bucket, ws);
+}
+
+/*
+ * Removes the workspace from the name and number index. Called when the
+ * workspace is detached, so its name and number must not change while it is
+ * attached.
+ *
+ */
+void workspace_unindex(Con *ws) {
+    if (workspaces_by_name == NULL) {
+        return;
+    }
+
+    if (ws->name != NULL) {
+        char *key = workspace_name_key(ws->name);
+        workspace_bucket *bucket = hashmap_lookup_str(workspaces_by_name, key);
+        if (bucket != NULL) {
+            bucket_remove(bucket, ws);
+            if (bucket->count <= 0) {
+                free(hashmap_remove_str(workspaces_by_name, key));
+            }
+        }
+        free(key);
+    }
+
+    workspace_bucket *bucket = hashmap_lookup(workspaces_by_num, (int64_t)ws->num);
+    if (bucket != NULL) {
+        bucket_remove(bucket, ws);
+        if (bucket->count <= 0) {
+            free(hashmap_remove(workspaces_by_num, (int64_t)ws->num));
+        }
+    }
+}
+
 /*
  * Returns the workspace with the given name or NULL if such a workspace does
  * not exist.
  *
  */
 Con *get_existing_workspace_by_name(const char *name) {
+    workspace_bucket *bucket = NULL;
+    if (workspaces_by_name != NULL) {
+        char *key = workspace_name_key(name);
+        bucket = hashmap_lookup_str(workspaces_by_name, key);
+        free(key);
+    }
+    if (bucket == NULL) {
+        return NULL;
+    }
+    if (bucket->ws != NULL) {
+        return bucket->ws;
+    }
+
     Con *output, *workspace = NULL;
     TAILQ_FOREACH (output, &(croot->nodes_head), nodes) {
         GREP_FIRST(workspace, output_get_content(output), !strcasecmp(child->name, name));
     }
+    if (bucket->count == 1) {
+        bucket->ws = workspace;
+    }
 
     return workspace;
 }
@@ -42,10 +159,24 @@ Con *get_existing_workspace_by_name(const char *name) {
  *
  */
 Con *get_existing_workspace_by_num(int num) {
+    workspace_bucket *bucket = NULL;
+    if (workspaces_by_num != NULL) {
+        bucket = hashmap_lookup(workspaces_by_num, (int64_t)num);
+    }
+    if (bucket == NULL) {
+        return NULL;
+    }
+    if (bucket->ws != NULL) {
+        return bucket->ws;
+    }
+
     Con *output, *workspace = NULL;
     TAILQ_FOREACH (output, &(croot->nodes_head), nodes) {
         GREP_FIRST(workspace, output_get_content(output), child->num == num);
     }
+    if (bucket->count == 1) {
+        bucket->ws = workspace;
+    }
 
     return workspace;
 }
@@ -70,6 +201,53 @@ static void _workspace_apply_default_orientation(Con *ws) {
     }
 }
 
+/* The active output of the first workspace assignment (whose output is
+ * active) for each workspace name and for each number of a numbered
+ * workspace assignment. Rebuilt on the next lookup after
+ * workspace_assignments_changed(). */
+static struct {
+    bool valid;
+    hashmap_t *by_name;
+    hashmap_t *by_num;
+} assigned_outputs;
+
+/*
+ * Notes that the workspace assignments or the outputs changed, which
+ * invalidates the results of get_assigned_output().
+ *
+ */
+void workspace_assignments_changed(void) {
+    assigned_outputs.valid = false;
+}
+
+static void assigned_outputs_build(void) {
+    if (assigned_outputs.by_name == NULL) {
+        assigned_outputs.by_name = hashmap_new();
+        assigned_outputs.by_num = hashmap_new();
+    } else {
+        hashmap_clear(assigned_outputs.by_name);
+        hashmap_clear(assigned_outputs.by_num);
+    }
+
+    struct Workspace_Assignment *assignment;
+    TAILQ_FOREACH (assignment, &ws_assignments, ws_assignments) {
+        Output *output = get_output_by_name(assignment->output, true);
+        if (output == NULL) {
+            continue;
+        }
+        if (hashmap_lookup_str(assigned_outputs.by_name, assignment->name) == NULL) {
+            hashmap_insert_str(assigned_outputs.by_name, assignment->name, output);
+        }
+        if (name_is_digits(assignment->name)) {
+            const uint64_t num = ws_name_to_number(assignment->name);
+            if (hashmap_lookup(assigned_outputs.by_num, num) == NULL) {
+                hashmap_insert(assigned_outputs.by_num, num, output);
+            }
+        }
+    }
+    assigned_outputs.valid = true;
+}
+
 /*
  * Returns the first output that is assigned to a workspace specified by the
  * given name or number. Returns NULL if no such output exists.
@@ -82,31 +260,18 @@ static void _workspace_apply_default_orientation(Con *ws) {
  *
  */
 Con *get_assigned_output(const char *name, long parsed_num) {
-    Con *output = NULL;
-    struct Workspace_Assignment *assignment;
-    TAILQ_FOREACH (assignment, &ws_assignments, ws_assignments) {
-        if (name && strcmp(assignment->name, name) == 0) {
-            DLOG("Found workspace name=\"%s\" assignment to output \"%s\"\n",
-                 name, assignment->output);
-            Output *assigned_by_name = get_output_by_name(assignment->output, true);
-            if (assigned_by_name) {
-                /* When the name matches exactly, skip numbered assignments. */
-                return assigned_by_name->con;
-            }
-        } else if (!output && /* Only keep the first numbered assignment. */
-                   parsed_num != -1 &&
-                   name_is_digits(assignment->name) &&
-                   ws_name_to_number(assignment->name) == parsed_num) {
-            DLOG("Found workspace number=%ld assignment to output \"%s\"\n",
-                 parsed_num, assignment->output);
-            Output *assigned_by_num = get_output_by_name(assignment->output, true);
-            if (assigned_by_num) {
-                output = assigned_by_num->con;
-            }
-        }
+    if (!assigned_outputs.valid) {
+        assigned_outputs_build();
     }
 
-    return output;
+    Output *output = NULL;
+    if (name != NULL) {
+        output = hashmap_lookup_str(assigned_outputs.by_name, name);
+    }
+    if (output == NULL && parsed_num != -1) {
+        output = hashmap_lookup(assigned_outputs.by_num, parsed_num);
+    }
+    return (output != NULL ? output->con : NULL);
 }
 
 /*
@@ -313,34 +478,22 @@ bool workspace_is_visible(Con *ws) {
 }
 
 /*
- * XXX: we need to clean up all this recursive walking code.
+ * Returns a container with a window in the given sticky group on the given
+ * output, other than exclude.
  *
  */
-static Con *_get_sticky(Con *con, const char *sticky_group, Con *exclude) {
-    Con *current;
-
-    TAILQ_FOREACH (current, &(con->nodes_head), nodes) {
-        if (current != exclude &&
-            current->sticky_group != NULL &&
-            current->window != NULL &&
-            strcmp(current->sticky_group, sticky_group) == 0)
-            return current;
-
-        Con *recurse = _get_sticky(current, sticky_group, exclude);
-        if (recurse != NULL)
-            return recurse;
-    }
+static Con *_get_sticky(Con *output, const char *sticky_group, Con *exclude) {
+    size_t num;
+    Con **group = con_by_sticky_group(sticky_group, &num);
+    for (size_t i = 0; i < num; i++) {
+        Con *current = group[i];
+        if (current == exclude || current->window == NULL)
+            continue;
 
-    TAILQ_FOREACH (current, &(con->floating_head), floating_windows) {
-        if (current != exclude &&
-            current->sticky_group != NULL &&
-            current->window != NULL &&
-            strcmp(current->sticky_group, sticky_group) == 0)
-            return current;
-
-        Con *recurse = _get_sticky(current, sticky_group, exclude);
-        if (recurse != NULL)
-            return recurse;
+        for (Con *parent = current->parent; parent != NULL; parent = parent->parent) {
+            if (parent == output)
+                return current;
+        }
     }
 
     return NULL;
@@ -359,7 +512,7 @@ static void workspace_reassign_sticky(Con *con) {
 
     /* handle all children and floating windows of this node */
     TAILQ_FOREACH (current, &(con->nodes_head), nodes) {
-        if (current->sticky_group == NULL) {
+        if (current->cold->sticky_group == NULL) {
             workspace_reassign_sticky(current);
             continue;
         }
@@ -367,7 +520,7 @@ static void workspace_reassign_sticky(Con *con) {
         LOG("Ah, this one is sticky: %s / %p\n", current->name, current);
         /* 2: find a window which we can re-assign */
         Con *output = con_get_output(current);
-        Con *src = _get_sticky(output, current->sticky_group, current);
+        Con *src = _get_sticky(output, current->cold->sticky_group, current);
 
         if (src == NULL) {
             LOG("No window found for this sticky group\n");
@@ -376,9 +529,11 @@ static void workspace_reassign_sticky(Con *con) {
         }
 
         x_move_win(src, current);
+        con_unindex_window(src);
         current->window = src->window;
         current->mapped = true;
         src->window = NULL;
+        con_index_window(current);
         src->mapped = false;
 
         x_reparent_child(current, src);
@@ -397,10 +552,9 @@ static void workspace_reassign_sticky(Con *con) {
  * focusing the con.
  *
  */
-static void workspace_defer_update_urgent_hint_cb(EV_P_ ev_timer *w, int revents) {
-    Con *con = w->data;
+static void workspace_defer_update_urgent_hint_cb(wheel_timer *timer) {
+    Con *con = timer->data;
 
-    ev_timer_stop(main_loop, con->urgency_timer);
     FREE(con->urgency_timer);
 
     if (con->urgent) {
@@ -409,7 +563,7 @@ static void workspace_defer_update_urgent_hint_cb(EV_P_ ev_timer *w, int revents
         con_update_parents_urgency(con);
         workspace_update_urgent_flag(con_get_workspace(con));
         ipc_send_window_event("urgent", con);
-        tree_render();
+        tree_schedule_render();
     }
 }
 
@@ -435,12 +589,18 @@ void workspace_show(Con *workspace) {
     /* enable fullscreen for the target workspace. If it happens to be the
      * same one we are currently on anyways, we can stop here. */
     workspace->fullscreen_mode = CF_OUTPUT;
+    con_set_dirty(workspace);
     current = con_get_workspace(focused);
     if (workspace == current) {
         DLOG("Not switching, already there.\n");
         return;
     }
 
+    /* If nothing else changed since the last render, the next render only
+     * needs to cover the newly shown workspace, see
+     * tree_note_workspace_switch(). */
+    const bool focus_clean = !tree_focus_changed();
+
     /* Used to correctly update focus when pushing sticky windows. Holds the
      * previously focused container in the same output as workspace. For
      * example, if a sticky window is focused and then we switch focus to a
@@ -460,7 +620,9 @@ void workspace_show(Con *workspace) {
         DLOG("Setting previous_workspace_name = %s\n", previous_workspace_name);
     }
 
-    workspace_reassign_sticky(workspace);
+    if (con_has_sticky_groups()) {
+        workspace_reassign_sticky(workspace);
+    }
 
     DLOG("switching to %p / %s\n", workspace, workspace->name);
     Con *next = con_descend_focused(workspace);
@@ -472,29 +634,26 @@ void workspace_show(Con *workspace) {
      * focus and thereby immediately destroy it */
     if (next->urgent && (int)(config.workspace_urgency_timer * 1000) > 0) {
         /* focus for now… */
-        next->urgent = false;
+        con_set_urgent_flag(next, false);
         con_focus(next);
 
         /* … but immediately reset urgency flags; they will be set to false by
          * the timer callback in case the container is focused at the time of
          * its expiration */
-        focused->urgent = true;
+        con_set_urgent_flag(focused, true);
         workspace->urgent = true;
 
         if (focused->urgency_timer == NULL) {
             DLOG("Deferring reset of urgency flag of con %p on newly shown workspace %p\n",
                  focused, workspace);
-            focused->urgency_timer = scalloc(1, sizeof(struct ev_timer));
-            /* use a repeating timer to allow for easy resets */
-            ev_timer_init(focused->urgency_timer, workspace_defer_update_urgent_hint_cb,
-                          config.workspace_urgency_timer, config.workspace_urgency_timer);
-            focused->urgency_timer->data = focused;
-            ev_timer_start(main_loop, focused->urgency_timer);
+            focused->urgency_timer = smalloc(sizeof(wheel_timer));
+            wheel_timer_init(focused->urgency_timer, workspace_defer_update_urgent_hint_cb, focused);
         } else {
             DLOG("Resetting urgency timer of con %p on workspace %p\n",
                  focused, workspace);
-            ev_timer_again(main_loop, focused->urgency_timer);
         }
+        /* Starting a running timer restarts it. */
+        wheel_timer_start(focused->urgency_timer, config.workspace_urgency_timer);
     } else
         con_focus(next);
 
@@ -510,15 +669,12 @@ void workspace_show(Con *workspace) {
         /* check if this workspace is currently visible */
         if (!workspace_is_visible(old)) {
             LOG("Closing old workspace (%p / %s), it is empty\n", old, old->name);
-            yajl_gen gen = ipc_marshal_workspace_event("empty", old, NULL);
+            ipc_prepared_event *event = ipc_prepare_workspace_event("empty", old, NULL);
             tree_close_internal(old, DONT_KILL_WINDOW, false);
 
-            const unsigned char *payload;
-            ylength length;
-            y(get_buf, &payload, &length);
-            ipc_send_event("workspace", I3_IPC_EVENT_WORKSPACE, (const char *)payload);
-
-            y(free);
+            if (event != NULL) {
+                ipc_send_prepared_event(event);
+            }
 
             /* Avoid calling output_push_sticky_windows later with a freed container. */
             if (old == old_focus) {
@@ -543,6 +699,8 @@ void workspace_show(Con *workspace) {
 
     /* Push any sticky windows to the now visible workspace. */
     output_push_sticky_windows(old_focus);
+
+    tree_note_workspace_switch(focus_clean);
 }
 
 /*
@@ -820,31 +978,14 @@ Con *workspace_back_and_forth_get(void) {
     return workspace_get(previous_workspace_name);
 }
 
-static bool get_urgency_flag(Con *con) {
-    Con *child;
-    TAILQ_FOREACH (child, &(con->nodes_head), nodes) {
-        if (child->urgent || get_urgency_flag(child)) {
-            return true;
-        }
-    }
-
-    TAILQ_FOREACH (child, &(con->floating_head), floating_windows) {
-        if (child->urgent || get_urgency_flag(child)) {
-            return true;
-        }
-    }
-
-    return false;
-}
-
 /*
- * Goes through all clients on the given workspace and updates the workspace’s
- * urgent flag accordingly.
+ * Updates the workspace’s urgent flag from the number of urgent containers on
+ * it, which the containers keep up to date.
  *
  */
 void workspace_update_urgent_flag(Con *ws) {
     bool old_flag = ws->urgent;
-    ws->urgent = get_urgency_flag(ws);
+    ws->urgent = (ws->urgent_descendants > 0);
     DLOG("Workspace urgency flag changed from %d to %d\n", old_flag, ws->urgent);
 
     if (old_flag != ws->urgent)
@@ -960,20 +1101,70 @@ Con *workspace_encapsulate(Con *ws) {
     return new;
 }
 
+/*
+ * Creates a workspace to replace the given one, which is the last workspace
+ * on its output and about to be moved away: the first workspace assigned to
+ * the output which does not exist yet, or else a new one.
+ *
+ */
+static void workspace_replace_last(Con *ws, Output *current_output) {
+    DLOG("Creating a new workspace to replace \"%s\" (last on its output).\n", ws->name);
+
+    /* check if we can find a workspace assigned to this output */
+    struct Workspace_Assignment *assignment;
+    TAILQ_FOREACH (assignment, &ws_assignments, ws_assignments) {
+        if (!output_triggers_assignment(current_output, assignment)) {
+            continue;
+        }
+        /* check if this workspace's name or num is already attached to the tree */
+        const int num = ws_name_to_number(assignment->name);
+        const bool attached = (num == -1)
+                                  ? get_existing_workspace_by_name(assignment->name)
+                                  : get_existing_workspace_by_num(num);
+        if (attached) {
+            continue;
+        }
+
+        /* so create the workspace referenced to by this assignment */
+        DLOG("Creating workspace from assignment %s.\n", assignment->name);
+        workspace_get(assignment->name);
+        return;
+    }
+
+    /* if we couldn't create the workspace using an assignment, create it on
+     * the output. Workspace init IPC events are sent either by
+     * workspace_get or create_workspace_on_output. */
+    create_workspace_on_output(current_output, ws->parent);
+}
+
 /*
  * Move the given workspace to the specified output.
  */
 void workspace_move_to_output(Con *ws, Output *output) {
-    DLOG("Moving workspace %p / %s to output %p / \"%s\".\n", ws, ws->name, output, output_primary_name(output));
+    workspaces_move_to_output(&ws, 1, output);
+}
 
-    Output *current_output = get_output_for_con(ws);
+/* A workspace moved by workspaces_move_to_output() and where it came from. */
+struct moved_workspace {
+    Con *ws;
+    Con *old_content;
+    bool was_visible;
+};
+
+/*
+ * Moves the given workspaces to the specified output at once. Unlike calling
+ * workspace_move_to_output() for each of them, the outputs they leave only
+ * switch to a remaining workspace once, the destination output only shows
+ * one of the moved workspaces (the focused one, or else the last one which
+ * was visible) and the tree is rendered once, when the IPC events are sent.
+ *
+ */
+void workspaces_move_to_output(Con **workspaces, int num_workspaces, Output *output) {
     Con *content = output_get_content(output->con);
-    DLOG("got output %p with content %p\n", output, content);
+    DLOG("Moving %d workspaces to output %p / \"%s\" with content %p\n",
+         num_workspaces, output, output_primary_name(output), content);
 
-    if (ws->parent == content) {
-        DLOG("Nothing to do, workspace already there\n");
-        return;
-    }
+    const bool bulk_begun = tree_bulk_begin();
 
     Con *previously_visible_ws = TAILQ_FIRST(&(content->focus_head));
     if (previously_visible_ws) {
@@ -982,86 +1173,101 @@ void workspace_move_to_output(Con *ws, Output *output) {
         DLOG("No previously visible workspace on output.\n");
     }
 
-    bool workspace_was_visible = workspace_is_visible(ws);
-    if (con_num_children(ws->parent) == 1) {
-        DLOG("Creating a new workspace to replace \"%s\" (last on its output).\n", ws->name);
-
-        /* check if we can find a workspace assigned to this output */
-        bool used_assignment = false;
-        struct Workspace_Assignment *assignment;
-        TAILQ_FOREACH (assignment, &ws_assignments, ws_assignments) {
-            if (!output_triggers_assignment(current_output, assignment)) {
-                continue;
-            }
-            /* check if this workspace's name or num is already attached to the tree */
-            const int num = ws_name_to_number(assignment->name);
-            const bool attached = (num == -1)
-                                      ? get_existing_workspace_by_name(assignment->name)
-                                      : get_existing_workspace_by_num(num);
-            if (attached) {
-                continue;
-            }
-
-            /* so create the workspace referenced to by this assignment */
-            DLOG("Creating workspace from assignment %s.\n", assignment->name);
-            workspace_get(assignment->name);
-            used_assignment = true;
-            break;
+    /* The workspace to show on the destination output. */
+    Con *focused_ws = con_get_workspace(focused);
+    Con *show = NULL;
+
+    struct moved_workspace *moved = scalloc(num_workspaces, sizeof(struct moved_workspace));
+    int num_moved = 0;
+    for (int i = 0; i < num_workspaces; i++) {
+        Con *ws = workspaces[i];
+        DLOG("Moving workspace %p / %s to output %p / \"%s\".\n", ws, ws->name, output, output_primary_name(output));
+        if (ws->parent == content) {
+            DLOG("Nothing to do, workspace already there\n");
+            continue;
         }
 
-        /* if we couldn't create the workspace using an assignment, create it on
-         * the output. Workspace init IPC events are sent either by
-         * workspace_get or create_workspace_on_output. */
-        if (!used_assignment) {
-            create_workspace_on_output(current_output, ws->parent);
+        const bool was_visible = workspace_is_visible(ws);
+        if (con_num_children(ws->parent) == 1) {
+            workspace_replace_last(ws, get_output_for_con(ws));
+        }
+        if (was_visible && (show == NULL || show != focused_ws)) {
+            show = ws;
         }
+
+        DLOG("Detaching\n");
+        moved[num_moved++] = (struct moved_workspace){
+            .ws = ws,
+            .old_content = ws->parent,
+            .was_visible = was_visible,
+        };
+        con_detach(ws);
     }
-    DLOG("Detaching\n");
-
-    /* detach from the old output and attach to the new output */
-    Con *old_content = ws->parent;
-    con_detach(ws);
-    if (workspace_was_visible) {
-        /* The workspace which we just detached was visible, so focus the next
-         * one in the focus-stack. */
-        Con *focus_ws = TAILQ_FIRST(&(old_content->focus_head));
-        DLOG("workspace was visible, focusing %p / %s now\n", focus_ws, focus_ws->name);
-        workspace_show(focus_ws);
+
+    /* The workspaces which we just detached were visible, so focus the next
+     * one in the focus-stack of their outputs. All moved workspaces are
+     * detached by now, so none of them is shown again on its old output. */
+    for (int i = 0; i < num_moved; i++) {
+        if (!moved[i].was_visible) {
+            continue;
+        }
+        bool shown = false;
+        for (int j = 0; j < i && !shown; j++) {
+            shown = (moved[j].was_visible && moved[j].old_content == moved[i].old_content);
+        }
+        if (!shown) {
+            Con *focus_ws = TAILQ_FIRST(&(moved[i].old_content->focus_head));
+            DLOG("workspace was visible, focusing %p / %s now\n", focus_ws, focus_ws->name);
+            workspace_show(focus_ws);
+        }
     }
-    con_attach(ws, content, false);
 
-    /* fix the coordinates of the floating containers */
-    Con *floating_con;
-    TAILQ_FOREACH (floating_con, &(ws->floating_head), floating_windows) {
-        floating_fix_coordinates(floating_con, &(old_content->rect), &(content->rect));
+    for (int i = 0; i < num_moved; i++) {
+        Con *ws = moved[i].ws;
+        /* Only one of the moved workspaces becomes visible. */
+        if (ws != show) {
+            ws->fullscreen_mode = CF_NONE;
+        }
+        con_attach(ws, content, false);
+
+        /* fix the coordinates of the floating containers */
+        Con *floating_con;
+        TAILQ_FOREACH (floating_con, &(ws->floating_head), floating_windows) {
+            floating_fix_coordinates(floating_con, &(moved[i].old_content->rect), &(content->rect));
+        }
+
+        ipc_send_workspace_event("move", ws, NULL);
     }
+    free(moved);
 
-    ipc_send_workspace_event("move", ws, NULL);
-    if (workspace_was_visible) {
+    if (show != NULL) {
         /* Focus the moved workspace on the destination output. */
-        workspace_show(ws);
+        workspace_show(show);
     }
 
     ewmh_update_desktop_properties();
 
-    if (!previously_visible_ws) {
-        return;
-    }
+    if (previously_visible_ws != NULL && num_moved > 0) {
+        /* NB: We cannot simply work with previously_visible_ws since it might
+         * have been cleaned up by workspace_show() already, depending on the
+         * focus order/number of other workspaces on the output. Instead, we
+         * loop through the available workspaces and only work with
+         * previously_visible_ws if we still find it. */
+        Con *ws;
+        TAILQ_FOREACH (ws, &(content->nodes_head), nodes) {
+            if (ws != previously_visible_ws) {
+                continue;
+            }
 
-    /* NB: We cannot simply work with previously_visible_ws since it might have
-     * been cleaned up by workspace_show() already, depending on the focus
-     * order/number of other workspaces on the output. Instead, we loop through
-     * the available workspaces and only work with previously_visible_ws if we
-     * still find it. */
-    TAILQ_FOREACH (ws, &(content->nodes_head), nodes) {
-        if (ws != previously_visible_ws) {
-            continue;
+            /* Call the on_remove_child callback of the workspace which
+             * previously was visible on the destination output. Since it is no
+             * longer visible, it might need to get cleaned up. */
+            CALL(previously_visible_ws, on_remove_child);
+            break;
         }
+    }
 
-        /* Call the on_remove_child callback of the workspace which previously
-         * was visible on the destination output. Since it is no longer visible,
-         * it might need to get cleaned up. */
-        CALL(previously_visible_ws, on_remove_child);
-        break;
+    if (bulk_begun) {
+        tree_bulk_end();
     }
 }
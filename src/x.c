@@ -12,6 +12,8 @@
 
 #include <unistd.h>
 
+#include "x_requests.h"
+
 #ifndef MAX
 #define MAX(x, y) ((x) > (y) ? (x) : (y))
 #endif
@@ -27,6 +29,18 @@ static xcb_window_t last_focused = XCB_NONE;
 /* Stores coordinates to warp mouse pointer to if set */
 static Rect *warp_to;
 
+/* The pointer position as last reported by an X11 event. It is only known
+ * while the pointer cannot have crossed to another output without i3 getting
+ * an event, that is, while it is over the root window or over a window which
+ * lies within a single output. */
+static struct {
+    bool known;
+    int16_t x;
+    int16_t y;
+    /* The window the event was reported for. */
+    xcb_window_t window;
+} pointer;
+
 /*
  * Describes the X11 state we may modify (map state, position, window stack).
  * There is one entry per container. The state represents the current situation
@@ -35,6 +49,19 @@ static Rect *warp_to;
  * represents the current order). It will be updated in x_push_changes().
  *
  */
+/*
+ * The shape of one kind (bounding or input) which x_shape_frame() last applied
+ * to a frame: the offset and size of the client window within the frame and
+ * the border rectangles added to its shape.
+ *
+ */
+typedef struct frame_shape {
+    bool applied;
+    Rect window_rect;
+    size_t rectangles_count;
+    xcb_rectangle_t rectangles[4];
+} frame_shape;
+
 typedef struct con_state {
     xcb_window_t id;
     bool mapped;
@@ -51,21 +78,41 @@ typedef struct con_state {
     bool need_reparent;
     xcb_window_t old_frame;
 
-    /* The container was child of floating container during the previous call of
-     * x_push_node(). This is used to remove the shape when the container is no
-     * longer floating. */
-    bool was_floating;
+    /* The client window is still a child of the root window (old_frame is
+     * XCB_NONE) and was viewable when it got adopted, see x_adopt_child().
+     * child_hidden is set once create_deferred_frames() unmapped it because
+     * the container was not shown. */
+    bool child_viewable;
+    bool child_hidden;
+
+    /* The shapes currently applied to the frame, so that x_push_node() only
+     * combines them again when the client shape or the frame geometry changed.
+     * Indexed by shape_index(). */
+    frame_shape shapes[2];
 
     Rect rect;
     Rect window_rect;
 
     bool initial;
 
+    /* Whether the frame window exists in X11 yet, see x_con_init(). */
+    bool created;
+
+    /* Position in old_state_head (counted from the bottom), only valid during
+     * x_push_stack(). */
+    int old_position;
+
+    /* Neither this container nor any of its descendants were mapped after
+     * the last x_push_changes(). Together with Con.dirty, this allows skipping
+     * hidden workspaces entirely. */
+    bool idle;
+
     char *name;
 
     CIRCLEQ_ENTRY(con_state) state;
     CIRCLEQ_ENTRY(con_state) old_state;
     TAILQ_ENTRY(con_state) initial_mapping_order;
+    TAILQ_ENTRY(con_state) deferred_frames;
 } con_state;
 
 CIRCLEQ_HEAD(state_head, con_state) state_head =
@@ -77,6 +124,24 @@ CIRCLEQ_HEAD(old_state_head, con_state) old_state_head =
 TAILQ_HEAD(initial_mapping_head, con_state) initial_mapping_head =
     TAILQ_HEAD_INITIALIZER(initial_mapping_head);
 
+/* The states whose frame window was not created yet because their container
+ * was never visible, see x_con_init(). */
+static TAILQ_HEAD(deferred_frames_head, con_state) deferred_frames_head =
+    TAILQ_HEAD_INITIALIZER(deferred_frames_head);
+
+/* Maps frame IDs to their con_state. Every state in state_head (and thus in
+ * old_state_head) is also stored here, so that state_for_frame() does not
+ * need to walk the list once per container during x_push_changes(). */
+static hashmap_t *state_by_frame;
+
+static pool_t con_state_pool = POOL_INITIALIZER("con_state", con_state);
+
+/* Set while x_push_changes() runs. The event masks of the mapped frames are
+ * only changed (see mask_frames()) once the push actually reconfigures or
+ * restacks a window. */
+static bool in_push = false;
+static bool frames_masked = false;
+
 /*
  * Returns the container state for the given frame. This function always
  * returns a container state (otherwise, there is a bug in the code and the
@@ -85,11 +150,12 @@ TAILQ_HEAD(initial_mapping_head, con_state) initial_mapping_head =
  *
  */
 static con_state *state_for_frame(xcb_window_t window) {
-    con_state *state;
-    CIRCLEQ_FOREACH (state, &state_head, state) {
-        if (state->id == window) {
-            return state;
-        }
+    con_state *state = NULL;
+    if (state_by_frame != NULL) {
+        state = hashmap_lookup(state_by_frame, window);
+    }
+    if (state != NULL) {
+        return state;
     }
 
     /* TODO: better error handling? */
@@ -98,6 +164,38 @@ static con_state *state_for_frame(xcb_window_t window) {
     return NULL;
 }
 
+/*
+ * Temporarily reduces the event mask of all mapped frames to
+ * SubstructureRedirect. This is done once per x_push_changes(), right before
+ * the first request which might generate EnterNotify events (every frame
+ * which is moved, resized, restacked or uncovered could receive one).
+ *
+ */
+static void mask_frames(void) {
+    if (!in_push || frames_masked) {
+        return;
+    }
+    frames_masked = true;
+
+    /* We need to keep SubstructureRedirect around, otherwise clients can send
+     * ConfigureWindow requests and get them applied directly instead of having
+     * them become ConfigureRequests that i3 handles. */
+    uint32_t values[] = {XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT};
+    con_state *state;
+    CIRCLEQ_FOREACH_REVERSE (state, &state_head, state) {
+        if (state->mapped)
+            xcb_change_window_attributes(conn, state->id, XCB_CW_EVENT_MASK, values);
+    }
+}
+
+/*
+ * See x_con_is_idle().
+ *
+ */
+static bool state_is_idle(Con *con, con_state *state) {
+    return !con->dirty && !con->mapped && state->idle;
+}
+
 /*
  * Changes the atoms on the root window and the windows themselves to properly
  * reflect the current focus for ewmh compliance.
@@ -123,11 +221,43 @@ static void change_ewmh_focus(xcb_window_t new_focus, xcb_window_t old_focus) {
  * Initializes the X11 part for the given container. Called exactly once for
  * every container from con_new().
  *
+ * Only the ID of the frame window is allocated here. The window itself (and
+ * its graphics context) is created by create_deferred_frames() once the
+ * container becomes visible, so that restoring a layout, managing windows or
+ * creating containers on invisible workspaces does not cost X11 requests (and
+ * a round trip per frame) before they are shown.
+ *
  */
 void x_con_init(Con *con) {
-    /* TODO: maybe create the window when rendering first? we could then even
-     * get the initial geometry right */
+    con->frame.id = xcb_generate_id(conn);
+    con->colormap = XCB_NONE;
+    con_index_frame(con);
+
+    struct con_state *state = pool_alloc(&con_state_pool);
+    state->id = con->frame.id;
+    state->mapped = false;
+    state->initial = true;
+    state->created = false;
+    DLOG("Adding window 0x%08x to lists\n", state->id);
+    CIRCLEQ_INSERT_HEAD(&state_head, state, state);
+    CIRCLEQ_INSERT_HEAD(&old_state_head, state, old_state);
+    TAILQ_INSERT_TAIL(&initial_mapping_head, state, initial_mapping_order);
+    TAILQ_INSERT_TAIL(&deferred_frames_head, state, deferred_frames);
+    if (state_by_frame == NULL) {
+        state_by_frame = hashmap_new();
+    }
+    hashmap_insert(state_by_frame, state->id, state);
+    stats_frames_deferred++;
+    stats_frames_pending++;
+    DLOG("adding new state for window id 0x%08x\n", state->id);
+}
 
+/*
+ * Creates the frame window of the given state's container with the ID
+ * allocated by x_con_init().
+ *
+ */
+static void create_frame(Con *con, con_state *state) {
     uint32_t mask = 0;
     uint32_t values[5];
 
@@ -166,8 +296,11 @@ void x_con_init(Con *con) {
     values[4] = win_colormap;
 
     Rect dims = {-15, -15, 10, 10};
-    xcb_window_t frame_id = create_window(conn, dims, con->depth, visual, XCB_WINDOW_CLASS_INPUT_OUTPUT, XCURSOR_CURSOR_POINTER, false, mask, values);
-    draw_util_surface_init(conn, &(con->frame), frame_id, get_visualtype_by_id(visual), dims.width, dims.height);
+    xcb_create_window(conn, con->depth, con->frame.id, root, dims.x, dims.y, dims.width, dims.height, 0,
+                      XCB_WINDOW_CLASS_INPUT_OUTPUT, visual, mask, values);
+    xcb_change_window_attributes(conn, con->frame.id, XCB_CW_CURSOR,
+                                 (uint32_t[]){xcursor_get_cursor(XCURSOR_CURSOR_POINTER)});
+    draw_util_surface_init(conn, &(con->frame), con->frame.id, get_visualtype_by_id(visual), dims.width, dims.height);
     xcb_change_property(conn,
                         XCB_PROP_MODE_REPLACE,
                         con->frame.id,
@@ -177,15 +310,70 @@ void x_con_init(Con *con) {
                         (strlen("i3-frame") + 1) * 2,
                         "i3-frame\0i3-frame\0");
 
-    struct con_state *state = scalloc(1, sizeof(struct con_state));
-    state->id = con->frame.id;
-    state->mapped = false;
+    /* The new window is on top of the X11 stack. */
+    state->created = true;
     state->initial = true;
-    DLOG("Adding window 0x%08x to lists\n", state->id);
-    CIRCLEQ_INSERT_HEAD(&state_head, state, state);
+    TAILQ_REMOVE(&deferred_frames_head, state, deferred_frames);
+    stats_frames_pending--;
+    stats_frames_created++;
+    CIRCLEQ_REMOVE(&old_state_head, state, old_state);
     CIRCLEQ_INSERT_HEAD(&old_state_head, state, old_state);
-    TAILQ_INSERT_TAIL(&initial_mapping_head, state, initial_mapping_order);
-    DLOG("adding new state for window id 0x%08x\n", state->id);
+    DLOG("Created frame 0x%08x for con %p\n", state->id, con);
+}
+
+/*
+ * Returns whether the frame window of the given container exists in X11, see
+ * x_con_init().
+ *
+ */
+bool x_con_has_frame(Con *con) {
+    return state_for_frame(con->frame.id)->created;
+}
+
+/*
+ * Creates the frames of all containers which are about to be mapped for the
+ * first time. This happens before the stack is pushed, so that the new frames
+ * are restacked along with the others.
+ *
+ * Adopted client windows which are still viewable on the root window are
+ * unmapped if their container is not shown, like they would be inside of an
+ * unmapped frame.
+ *
+ */
+static void create_deferred_frames(void) {
+    con_state *state, *next;
+    for (state = TAILQ_FIRST(&deferred_frames_head); state != NULL; state = next) {
+        next = TAILQ_NEXT(state, deferred_frames);
+        Con *con = con_by_frame_id(state->id);
+        if (con == NULL) {
+            continue;
+        }
+        if (con->mapped) {
+            create_frame(con, state);
+        } else if (state->child_viewable && !state->child_hidden && con->window != NULL) {
+            DLOG("Hiding adopted window 0x%08x of con %p\n", con->window->id, con);
+            /* Clear the event mask, so that the UnmapNotify does not make us
+             * unmanage the window. */
+            uint32_t values[] = {XCB_NONE};
+            xcb_change_window_attributes(conn, con->window->id, XCB_CW_EVENT_MASK, values);
+            xcb_unmap_window(conn, con->window->id);
+            values[0] = CHILD_EVENT_MASK & ~XCB_EVENT_MASK_ENTER_WINDOW;
+            xcb_change_window_attributes(conn, con->window->id, XCB_CW_EVENT_MASK, values);
+            state->child_hidden = true;
+        }
+    }
+}
+
+/*
+ * Makes the next x_push_node() combine the shapes of the frame again (if it is
+ * shaped), because the frame got a different client window.
+ *
+ */
+static void invalidate_shapes(con_state *state) {
+    /* No client window has a width of 0, so the cached shapes never match. */
+    for (size_t i = 0; i < sizeof(state->shapes) / sizeof(state->shapes[0]); i++) {
+        state->shapes[i].window_rect = (Rect){0, 0, 0, 0};
+    }
 }
 
 /*
@@ -207,6 +395,42 @@ void x_reinit(Con *con) {
     state->child_mapped = false;
     state->con = con;
     memset(&(state->window_rect), 0, sizeof(Rect));
+    invalidate_shapes(state);
+
+    /* The container just got a (new) client window. */
+    con_index_window(con);
+}
+
+/*
+ * Makes x_push_changes() reparent the client window of the given container,
+ * which is still a child of the root window, into the frame once the
+ * container is shown for the first time. Until then, neither the frame nor
+ * the reparenting cost any requests.
+ *
+ * viewable is set for windows which are adopted on startup: they get unmapped
+ * if the container is not shown (see create_deferred_frames()).
+ *
+ */
+void x_adopt_child(Con *con, bool viewable) {
+    struct con_state *state;
+    if ((state = state_for_frame(con->frame.id)) == NULL) {
+        ELOG("window state for con not found\n");
+        return;
+    }
+
+    state->need_reparent = true;
+    state->old_frame = XCB_NONE;
+    state->child_viewable = viewable;
+    state->child_hidden = false;
+}
+
+/*
+ * Returns whether the client window of the given container was unmapped by
+ * create_deferred_frames() and has not been shown since.
+ *
+ */
+bool x_con_child_hidden(Con *con) {
+    return state_for_frame(con->frame.id)->child_hidden;
 }
 
 /*
@@ -215,14 +439,33 @@ void x_reinit(Con *con) {
  *
  */
 void x_reparent_child(Con *con, Con *old) {
-    struct con_state *state;
+    struct con_state *state, *old_state;
     if ((state = state_for_frame(con->frame.id)) == NULL) {
         ELOG("window state for con not found\n");
         return;
     }
+    old_state = state_for_frame(old->frame.id);
 
     state->need_reparent = true;
-    state->old_frame = old->frame.id;
+    if (old_state->need_reparent) {
+        /* The client window never made it into the old frame, so the new
+         * container takes over the pending reparenting instead. */
+        state->old_frame = old_state->old_frame;
+        state->child_viewable = old_state->child_viewable;
+        state->child_hidden = old_state->child_hidden;
+        old_state->need_reparent = false;
+        old_state->old_frame = XCB_NONE;
+    } else {
+        /* The client window needs to be moved into the frame right away, even
+         * if the container is not visible: the old frame is about to be
+         * destroyed. */
+        if (!state->created) {
+            create_frame(con, state);
+        }
+        state->old_frame = old->frame.id;
+    }
+    invalidate_shapes(state);
+    con_set_dirty(con);
 }
 
 /*
@@ -251,23 +494,38 @@ void x_move_win(Con *src, Con *dest) {
     }
 }
 
-static void _x_con_kill(Con *con) {
+/*
+ * Frees the X11 state of the given container. Returns whether its frame
+ * window had been created.
+ *
+ */
+static bool _x_con_kill(Con *con) {
     con_state *state;
 
     if (con->colormap != XCB_NONE) {
         xcb_free_colormap(conn, con->colormap);
+        con->colormap = XCB_NONE;
     }
 
-    draw_util_surface_free(conn, &(con->frame));
+    state = state_for_frame(con->frame.id);
+    const bool created = state->created;
+    if (created) {
+        draw_util_surface_free(conn, &(con->frame));
+    } else {
+        TAILQ_REMOVE(&deferred_frames_head, state, deferred_frames);
+        stats_frames_pending--;
+    }
     draw_util_surface_free(conn, &(con->frame_buffer));
     xcb_free_pixmap(conn, con->frame_buffer.id);
     con->frame_buffer.id = XCB_NONE;
-    state = state_for_frame(con->frame.id);
+    x_deco_cache_free(con);
+    con_unindex_frame(con);
     CIRCLEQ_REMOVE(&state_head, state, state);
     CIRCLEQ_REMOVE(&old_state_head, state, old_state);
     TAILQ_REMOVE(&initial_mapping_head, state, initial_mapping_order);
+    hashmap_remove(state_by_frame, state->id);
     FREE(state->name);
-    free(state);
+    pool_free(&con_state_pool, state);
 
     /* Invalidate focused_id to correctly focus new windows with the same ID */
     if (con->frame.id == focused_id) {
@@ -276,6 +534,7 @@ static void _x_con_kill(Con *con) {
     if (con->frame.id == last_focused) {
         last_focused = XCB_NONE;
     }
+    return created;
 }
 
 /*
@@ -283,8 +542,9 @@ static void _x_con_kill(Con *con) {
  *
  */
 void x_con_kill(Con *con) {
-    _x_con_kill(con);
-    xcb_destroy_window(conn, con->frame.id);
+    if (_x_con_kill(con)) {
+        xcb_destroy_window(conn, con->frame.id);
+    }
 }
 
 /*
@@ -296,36 +556,15 @@ void x_con_reframe(Con *con) {
     x_con_init(con);
 }
 
-/*
- * Returns true if the client supports the given protocol atom (like WM_DELETE_WINDOW)
- *
- */
-bool window_supports_protocol(xcb_window_t window, xcb_atom_t atom) {
-    xcb_get_property_cookie_t cookie;
-    xcb_icccm_get_wm_protocols_reply_t protocols;
-    bool result = false;
-
-    cookie = xcb_icccm_get_wm_protocols(conn, window, A_WM_PROTOCOLS);
-    if (xcb_icccm_get_wm_protocols_reply(conn, cookie, &protocols, NULL) != 1)
-        return false;
-
-    /* Check if the client’s protocols have the requested atom set */
-    for (uint32_t i = 0; i < protocols.atoms_len; i++)
-        if (protocols.atoms[i] == atom)
-            result = true;
-
-    xcb_icccm_get_wm_protocols_reply_wipe(&protocols);
-
-    return result;
-}
-
 /*
  * Kills the given X11 window using WM_DELETE_WINDOW (if supported).
  *
  */
-void x_window_kill(xcb_window_t window, kill_window_t kill_window) {
+void x_window_kill(i3Window *win, kill_window_t kill_window) {
+    const xcb_window_t window = win->id;
+
     /* if this window does not support WM_DELETE_WINDOW, we kill it the hard way */
-    if (!window_supports_protocol(window, A_WM_DELETE_WINDOW)) {
+    if (!win->supports_delete_window) {
         if (kill_window == KILL_WINDOW) {
             LOG("Killing specific window 0x%08x\n", window);
             xcb_destroy_window(conn, window);
@@ -349,9 +588,10 @@ void x_window_kill(xcb_window_t window, kill_window_t kill_window) {
     ev->data.data32[0] = A_WM_DELETE_WINDOW;
     ev->data.data32[1] = XCB_CURRENT_TIME;
 
+    /* Not flushed here, so that killing many windows at once results in a
+     * single write. The main loop flushes before waiting for events. */
     LOG("Sending WM_DELETE to the client\n");
     xcb_send_event(conn, false, window, XCB_EVENT_MASK_NO_EVENT, (char *)ev);
-    xcb_flush(conn);
     free(event);
 }
 
@@ -360,21 +600,17 @@ static void x_draw_title_border(Con *con, struct deco_render_params *p) {
 
     Rect *dr = &(con->deco_rect);
 
-    /* Left */
-    draw_util_rectangle(&(con->parent->frame_buffer), p->color->border,
-                        dr->x, dr->y, 1, dr->height);
-
-    /* Right */
-    draw_util_rectangle(&(con->parent->frame_buffer), p->color->border,
-                        dr->x + dr->width - 1, dr->y, 1, dr->height);
-
-    /* Top */
-    draw_util_rectangle(&(con->parent->frame_buffer), p->color->border,
-                        dr->x, dr->y, dr->width, 1);
-
-    /* Bottom */
-    draw_util_rectangle(&(con->parent->frame_buffer), p->color->border,
-                        dr->x, dr->y + dr->height - 1, dr->width, 1);
+    xcb_rectangle_t sides[] = {
+        /* Left */
+        {dr->x, dr->y, 1, dr->height},
+        /* Right */
+        {dr->x + dr->width - 1, dr->y, 1, dr->height},
+        /* Top */
+        {dr->x, dr->y, dr->width, 1},
+        /* Bottom */
+        {dr->x, dr->y + dr->height - 1, dr->width, 1},
+    };
+    draw_util_rectangles(&(con->parent->frame_buffer), p->color->border, sides, sizeof(sides) / sizeof(sides[0]));
 }
 
 static void x_draw_decoration_after_title(Con *con, struct deco_render_params *p) {
@@ -400,6 +636,60 @@ static void x_draw_decoration_after_title(Con *con, struct deco_render_params *p
     x_draw_title_border(con, p);
 }
 
+/*
+ * Copies the freshly drawn title bar of the given container from its parent’s
+ * pixmap into the container’s title bar cache. The cache takes ownership of
+ * key.
+ *
+ */
+static void deco_cache_store(Con *con, char *key) {
+    Rect *dr = &(con->deco_rect);
+
+    if (con->deco_cache.id == XCB_NONE ||
+        con->deco_cache.width != (int)dr->width ||
+        con->deco_cache.height != (int)dr->height) {
+        x_deco_cache_free(con);
+
+        /* The parent never contains a window, so its pixmap always has the
+         * root depth (see x_push_node()). */
+        xcb_pixmap_t pixmap = xcb_generate_id(conn);
+        xcb_create_pixmap(conn, root_depth, pixmap, con->parent->frame.id, dr->width, dr->height);
+        draw_util_surface_init(conn, &(con->deco_cache), pixmap,
+                               get_visualtype_by_id(get_visualid_by_depth(root_depth)), dr->width, dr->height);
+    }
+
+    draw_util_copy_surface(&(con->parent->frame_buffer), &(con->deco_cache),
+                           dr->x, dr->y, 0, 0, dr->width, dr->height);
+    free(con->deco_cache_key);
+    con->deco_cache_key = key;
+}
+
+/*
+ * Frees the cached title bar of the given container (if any).
+ *
+ */
+void x_deco_cache_free(Con *con) {
+    FREE(con->deco_cache_key);
+    if (con->deco_cache.id == XCB_NONE) {
+        return;
+    }
+    draw_util_surface_free(conn, &(con->deco_cache));
+    xcb_free_pixmap(conn, con->deco_cache.id);
+    con->deco_cache.id = XCB_NONE;
+}
+
+/*
+ * Packs a color into 32 bits for the title bar cache key. Colors are parsed
+ * from #rrggbb(aa) strings, so no precision is lost.
+ *
+ */
+static uint32_t deco_cache_color(color_t color) {
+    return ((uint32_t)(color.red * 255 + 0.5) << 24) |
+           ((uint32_t)(color.green * 255 + 0.5) << 16) |
+           ((uint32_t)(color.blue * 255 + 0.5) << 8) |
+           (uint32_t)(color.alpha * 255 + 0.5);
+}
+
 /*
  * Get rectangles representing the border around the child window. Some borders
  * are adjacent to the screen-edge and thus not returned. Return value is the
@@ -452,6 +742,30 @@ static size_t x_get_border_rectangles(Con *con, xcb_rectangle_t rectangles[4]) {
     return count;
 }
 
+/*
+ * Returns true if the container needs a pixmap for its frame. Containers
+ * without a window hold the title bars of their children. A window only needs
+ * one if some part of the frame around it is visible (borders, or the
+ * background around windows with size increments), so fullscreen windows and
+ * borderless ones don’t keep a pixmap of their full size in the X server.
+ *
+ */
+static bool frame_buffer_needed(Con *con) {
+    /* The root con and output cons will never require a pixmap. In particular for the
+     * __i3 output, this will likely not work anyway because it might be ridiculously
+     * large, causing an XCB_ALLOC error. */
+    if (con->type == CT_ROOT || con->type == CT_OUTPUT)
+        return false;
+
+    if (!con_is_leaf(con) || con->window == NULL)
+        return true;
+
+    Rect *w = &(con->window_rect);
+    return (w->x != 0 || w->y != 0 ||
+            w->width != con->rect.width ||
+            w->height != con->rect.height);
+}
+
 /*
  * Draws the decoration of the given container onto its parent.
  *
@@ -483,7 +797,7 @@ void x_draw_decoration(Con *con) {
     /* Skip containers whose pixmap has not yet been created (can happen when
      * decoration rendering happens recursively for a window for which
      * x_push_node() was not yet called) */
-    if (leaf && con->frame_buffer.id == XCB_NONE)
+    if (leaf && con->frame_buffer.id == XCB_NONE && frame_buffer_needed(con))
         return;
 
     /* 1: build deco_params and compare with cache */
@@ -515,65 +829,64 @@ void x_draw_decoration(Con *con) {
     p->background = config.client.background;
     p->con_is_leaf = con_is_leaf(con);
     p->parent_layout = con->parent->layout;
+    if (p->parent_layout == L_TABBED) {
+        p->tabs_hidden_before = con->tabs_hidden_before;
+        p->tabs_hidden_after = con->tabs_hidden_after;
+    }
 
-    if (con->deco_render_params != NULL &&
+    if (con->cold->deco_render_params != NULL &&
         (con->window == NULL || !con->window->name_x_changed) &&
         !parent->pixmap_recreated &&
         !con->pixmap_recreated &&
-        !con->mark_changed &&
-        memcmp(p, con->deco_render_params, sizeof(struct deco_render_params)) == 0) {
+        !con->cold->mark_changed &&
+        memcmp(p, con->cold->deco_render_params, sizeof(struct deco_render_params)) == 0) {
         free(p);
         goto copy_pixmaps;
     }
 
     Con *next = con;
     while ((next = TAILQ_NEXT(next, nodes))) {
-        FREE(next->deco_render_params);
+        FREE(next->cold->deco_render_params);
     }
 
-    FREE(con->deco_render_params);
-    con->deco_render_params = p;
+    FREE(con->cold->deco_render_params);
+    con->cold->deco_render_params = p;
 
-    if (con->window != NULL && con->window->name_x_changed)
+    /* The window title or icon changed, the cached title bar is stale. */
+    const bool title_changed = (con->window != NULL && con->window->name_x_changed);
+    if (title_changed)
         con->window->name_x_changed = false;
 
     parent->pixmap_recreated = false;
     con->pixmap_recreated = false;
-    con->mark_changed = false;
+    con->cold->mark_changed = false;
 
     /* 2: draw the client.background, but only for the parts around the window_rect */
-    if (con->window != NULL) {
+    if (con->window != NULL && con->frame_buffer.id != XCB_NONE) {
         /* Clear visible windows before beginning to draw */
         draw_util_clear_surface(&(con->frame_buffer), (color_t){.red = 0.0, .green = 0.0, .blue = 0.0});
 
-        /* top area */
-        draw_util_rectangle(&(con->frame_buffer), config.client.background,
-                            0, 0, r->width, w->y);
-        /* bottom area */
-        draw_util_rectangle(&(con->frame_buffer), config.client.background,
-                            0, w->y + w->height, r->width, r->height - (w->y + w->height));
-        /* left area */
-        draw_util_rectangle(&(con->frame_buffer), config.client.background,
-                            0, 0, w->x, r->height);
-        /* right area */
-        draw_util_rectangle(&(con->frame_buffer), config.client.background,
-                            w->x + w->width, 0, r->width - (w->x + w->width), r->height);
+        xcb_rectangle_t areas[] = {
+            /* top area */
+            {0, 0, r->width, w->y},
+            /* bottom area */
+            {0, w->y + w->height, r->width, r->height - (w->y + w->height)},
+            /* left area */
+            {0, 0, w->x, r->height},
+            /* right area */
+            {w->x + w->width, 0, r->width - (w->x + w->width), r->height},
+        };
+        draw_util_rectangles(&(con->frame_buffer), config.client.background, areas, sizeof(areas) / sizeof(areas[0]));
     }
 
     /* 3: draw a rectangle in border color around the client */
-    if (p->border_style != BS_NONE && p->con_is_leaf) {
+    if (p->border_style != BS_NONE && p->con_is_leaf && con->frame_buffer.id != XCB_NONE) {
         /* Fill the border. We don’t just fill the whole rectangle because some
          * children are not freely resizable and we want their background color
          * to "shine through". */
         xcb_rectangle_t rectangles[4];
         size_t rectangles_count = x_get_border_rectangles(con, rectangles);
-        for (size_t i = 0; i < rectangles_count; i++) {
-            draw_util_rectangle(&(con->frame_buffer), p->color->child_border,
-                                rectangles[i].x,
-                                rectangles[i].y,
-                                rectangles[i].width,
-                                rectangles[i].height);
-        }
+        draw_util_rectangles(&(con->frame_buffer), p->color->child_border, rectangles, rectangles_count);
 
         /* Highlight the side of the border at which the next window will be
          * opened if we are rendering a single window within a split container
@@ -603,7 +916,7 @@ void x_draw_decoration(Con *con) {
      * transparency. */
     if (con == TAILQ_FIRST(&(con->parent->nodes_head))) {
         draw_util_clear_surface(&(con->parent->frame_buffer), COLOR_TRANSPARENT);
-        FREE(con->parent->deco_render_params);
+        FREE(con->parent->cold->deco_render_params);
     }
 
     /* if this is a borderless/1pixel window, we don’t need to render the
@@ -611,78 +924,107 @@ void x_draw_decoration(Con *con) {
     if (p->border_style != BS_NORMAL)
         goto copy_pixmaps;
 
-    /* 4: paint the bar */
-    draw_util_rectangle(&(parent->frame_buffer), p->color->background,
-                        con->deco_rect.x, con->deco_rect.y, con->deco_rect.width, con->deco_rect.height);
-
-    /* 5: draw title border */
-    x_draw_title_border(con, p);
-
-    /* 6: draw the icon and title */
-    int text_offset_y = (con->deco_rect.height - config.font.height) / 2;
+    /* Tabs which are not shown (see tab_min_width) have no title bar. */
+    if (con->deco_rect.width == 0)
+        goto copy_pixmaps;
 
+    /* 4: collect everything which ends up in the title bar, so that unchanged
+     * title bars can be copied from the cache instead of being drawn again */
     struct Window *win = con->window;
 
-    const int deco_width = (int)con->deco_rect.width;
-    const int title_padding = logical_px(2);
-
-    int mark_width = 0;
-    if (config.show_marks && !TAILQ_EMPTY(&(con->marks_head))) {
-        char *formatted_mark = sstrdup("");
-        bool had_visible_mark = false;
-
+    char *formatted_mark = NULL;
+    if (config.show_marks && !TAILQ_EMPTY(&(con->cold->marks_head))) {
         mark_t *mark;
-        TAILQ_FOREACH (mark, &(con->marks_head), marks) {
+        TAILQ_FOREACH (mark, &(con->cold->marks_head), marks) {
             if (mark->name[0] == '_')
                 continue;
-            had_visible_mark = true;
 
-            char *buf;
-            sasprintf(&buf, "%s[%s]", formatted_mark, mark->name);
-            free(formatted_mark);
-            formatted_mark = buf;
+            formatted_mark = frame_asprintf("%s[%s]", (formatted_mark ? formatted_mark : ""), mark->name);
         }
+    }
 
-        if (had_visible_mark) {
-            i3String *mark = i3string_from_utf8(formatted_mark);
-            mark_width = predict_text_width(mark);
-
-            int mark_offset_x = (config.title_align == ALIGN_RIGHT)
-                                    ? title_padding
-                                    : deco_width - mark_width - title_padding;
-
-            draw_util_text(mark, &(parent->frame_buffer),
-                           p->color->text, p->color->background,
-                           con->deco_rect.x + mark_offset_x,
-                           con->deco_rect.y + text_offset_y, mark_width);
-            I3STRING_FREE(mark);
-
-            mark_width += title_padding;
+    /* Indicate the tabs which are not shown next to the first and last tab
+     * which are. */
+    if (p->tabs_hidden_before > 0 || p->tabs_hidden_after > 0) {
+        char before[16] = "", after[16] = "";
+        if (p->tabs_hidden_before > 0) {
+            snprintf(before, sizeof(before), "[<%d]", p->tabs_hidden_before);
         }
-
-        FREE(formatted_mark);
+        if (p->tabs_hidden_after > 0) {
+            snprintf(after, sizeof(after), "[%d>]", p->tabs_hidden_after);
+        }
+        formatted_mark = frame_asprintf("%s%s%s", before, (formatted_mark ? formatted_mark : ""), after);
     }
 
     i3String *title = NULL;
     if (win == NULL) {
-        if (con->title_format == NULL) {
-            char *_title;
+        if (con->cold->title_format == NULL) {
             char *tree = con_get_tree_representation(con);
-            sasprintf(&_title, "i3: %s", tree);
+            title = i3string_from_utf8(frame_asprintf("i3: %s", tree));
             free(tree);
-
-            title = i3string_from_utf8(_title);
-            FREE(_title);
         } else {
             title = con_parse_title_format(con);
         }
     } else {
-        title = con->title_format == NULL ? win->name : con_parse_title_format(con);
+        title = con->cold->title_format == NULL ? win->name : con_parse_title_format(con);
+    }
+
+    char *cache_key = NULL;
+    if (title != NULL && con->deco_rect.width > 0 && con->deco_rect.height > 0) {
+        /* The key contains the values of the colors and the font, so that
+         * reloading the configuration only invalidates the title bars whose
+         * appearance actually changed. */
+        cache_key = frame_asprintf("%08x %08x %08x %d %s\x1f%u %u %d %d %d\x1f%s\x1f%s",
+                                   deco_cache_color(p->color->border), deco_cache_color(p->color->background),
+                                   deco_cache_color(p->color->text), config.font.height,
+                                   (config.font.pattern ? config.font.pattern : ""),
+                                   con->deco_rect.width, con->deco_rect.height,
+                                   con->window_icon_padding, config.title_align, i3string_is_markup(title),
+                                   (formatted_mark ? formatted_mark : ""), i3string_as_utf8(title));
+
+        if (!title_changed && con->deco_cache_key != NULL &&
+            strcmp(cache_key, con->deco_cache_key) == 0) {
+            draw_util_copy_surface(&(con->deco_cache), &(parent->frame_buffer), 0, 0,
+                                   con->deco_rect.x, con->deco_rect.y,
+                                   con->deco_rect.width, con->deco_rect.height);
+            goto free_title;
+        }
     }
-    if (title == NULL) {
-        goto copy_pixmaps;
+
+    /* 5: paint the bar */
+    draw_util_rectangle(&(parent->frame_buffer), p->color->background,
+                        con->deco_rect.x, con->deco_rect.y, con->deco_rect.width, con->deco_rect.height);
+
+    /* 6: draw title border */
+    x_draw_title_border(con, p);
+
+    /* 7: draw the marks, icon and title */
+    int text_offset_y = (con->deco_rect.height - config.font.height) / 2;
+
+    const int deco_width = (int)con->deco_rect.width;
+    const int title_padding = logical_px(2);
+
+    int mark_width = 0;
+    if (formatted_mark != NULL) {
+        i3String *mark = i3string_from_utf8(formatted_mark);
+        mark_width = predict_text_width(mark);
+
+        int mark_offset_x = (config.title_align == ALIGN_RIGHT)
+                                ? title_padding
+                                : deco_width - mark_width - title_padding;
+
+        draw_util_text(mark, &(parent->frame_buffer),
+                       p->color->text, p->color->background,
+                       con->deco_rect.x + mark_offset_x,
+                       con->deco_rect.y + text_offset_y, mark_width);
+        I3STRING_FREE(mark);
+
+        mark_width += title_padding;
     }
 
+    if (title == NULL) {
+        goto free_title;
+    }
     /* icon_padding is applied horizontally only, the icon will always use all
      * available vertical space. */
     int icon_size = max(0, con->deco_rect.height - logical_px(2));
@@ -730,23 +1072,40 @@ void x_draw_decoration(Con *con) {
                    con->deco_rect.x + title_offset_x,
                    con->deco_rect.y + text_offset_y,
                    deco_width - mark_width - 2 * title_padding - total_icon_space);
-    if (has_icon) {
-        draw_util_image(
+    /* A large icon which is still being converted is left out, its space
+     * stays free. */
+    if (has_icon && win->icon->surface != NULL) {
+        window_icon_draw(
             win->icon,
             &(parent->frame_buffer),
             con->deco_rect.x + icon_offset_x,
             con->deco_rect.y + logical_px(1),
-            icon_size,
             icon_size);
     }
 
-    if (win == NULL || con->title_format != NULL) {
-        I3STRING_FREE(title);
+    x_draw_decoration_after_title(con, p);
+
+    if (cache_key != NULL) {
+        deco_cache_store(con, sstrdup(cache_key));
     }
 
-    x_draw_decoration_after_title(con, p);
+free_title:
+    if (win == NULL || con->cold->title_format != NULL) {
+        I3STRING_FREE(title);
+    }
 copy_pixmaps:
-    draw_util_copy_surface(&(con->frame_buffer), &(con->frame), 0, 0, 0, 0, con->rect.width, con->rect.height);
+    if (con->frame_buffer.id != XCB_NONE)
+        draw_util_copy_surface(&(con->frame_buffer), &(con->frame), 0, 0, 0, 0, con->rect.width, con->rect.height);
+}
+
+/*
+ * Returns true if the given container and all of its descendants are unmapped
+ * and have not changed since the last x_push_changes(). Pushing (or
+ * decorating) such a subtree again would not change anything.
+ *
+ */
+bool x_con_is_idle(Con *con) {
+    return state_is_idle(con, state_for_frame(con->frame.id));
 }
 
 /*
@@ -755,19 +1114,52 @@ copy_pixmaps:
  * while drawing the decoration needs to happen in the actual order.
  *
  */
+static void deco_recurse(Con *con, Con *fullscreen);
+
 void x_deco_recurse(Con *con) {
+    deco_recurse(con, NULL);
+}
+
+/*
+ * See x_deco_recurse(). fullscreen is the fullscreen container which covers
+ * con's workspace, if con contains it.
+ *
+ * Tiling containers which are covered by a fullscreen container are skipped:
+ * they cannot be seen, but are still mapped, so title changes would redraw
+ * them. Their decorations are drawn once the fullscreen mode ends, since the
+ * changed title (name_x_changed) or marks (mark_changed) are still flagged
+ * and the cached drawing parameters no longer match.
+ *
+ */
+static void deco_recurse(Con *con, Con *fullscreen) {
     Con *current;
     bool leaf = TAILQ_EMPTY(&(con->nodes_head)) &&
                 TAILQ_EMPTY(&(con->floating_head));
     con_state *state = state_for_frame(con->frame.id);
 
+    if (state_is_idle(con, state)) {
+        return;
+    }
+
+    if (con->type == CT_WORKSPACE) {
+        fullscreen = con_get_fullscreen_covering_ws(con);
+    } else if (con == fullscreen) {
+        /* Everything inside of the fullscreen container is visible. */
+        fullscreen = NULL;
+    }
+
     if (!leaf) {
         TAILQ_FOREACH (current, &(con->nodes_head), nodes) {
-            x_deco_recurse(current);
+            if (fullscreen != NULL && current != fullscreen && !con_has_parent(fullscreen, current)) {
+                continue;
+            }
+            deco_recurse(current, fullscreen);
         }
 
+        /* Floating windows may be shown above the fullscreen container (see
+         * popup_during_fullscreen). */
         TAILQ_FOREACH (current, &(con->floating_head), floating_windows) {
-            x_deco_recurse(current);
+            deco_recurse(current, NULL);
         }
 
         if (state->mapped) {
@@ -805,68 +1197,107 @@ static void set_hidden_state(Con *con) {
     state->is_hidden = should_be_hidden;
 }
 
+/*
+ * Returns the cached shape of the given kind of the frame of this state, or
+ * NULL for kinds i3 does not shape frames for.
+ *
+ */
+static frame_shape *shape_for_kind(con_state *state, xcb_shape_sk_t shape_kind) {
+    switch (shape_kind) {
+        case XCB_SHAPE_SK_BOUNDING:
+            return &(state->shapes[0]);
+        case XCB_SHAPE_SK_INPUT:
+            return &(state->shapes[1]);
+        default:
+            return NULL;
+    }
+}
+
 /*
  * Set the container frame shape as the union of the window shape and the
- * shape of the frame borders.
+ * shape of the frame borders. Unless force is set (the client changed its
+ * shape), nothing is sent when the shape was already applied with the same
+ * window position and borders.
+ *
  */
-static void x_shape_frame(Con *con, xcb_shape_sk_t shape_kind) {
+static void x_shape_frame(Con *con, xcb_shape_sk_t shape_kind, bool force) {
     assert(con->window);
 
+    con_state *state = state_for_frame(con->frame.id);
+    frame_shape *shape = shape_for_kind(state, shape_kind);
+    if (shape == NULL) {
+        return;
+    }
+
+    Rect window_rect = con->window_rect;
+    window_rect.x += con->border_width;
+    window_rect.y += con->border_width;
+    xcb_rectangle_t rectangles[4];
+    size_t rectangles_count = x_get_border_rectangles(con, rectangles);
+
+    if (!force && shape->applied &&
+        rect_equals(shape->window_rect, window_rect) &&
+        shape->rectangles_count == rectangles_count &&
+        memcmp(shape->rectangles, rectangles, rectangles_count * sizeof(xcb_rectangle_t)) == 0) {
+        return;
+    }
+
+    mask_frames();
     xcb_shape_combine(conn, XCB_SHAPE_SO_SET, shape_kind, shape_kind,
                       con->frame.id,
-                      con->window_rect.x + con->border_width,
-                      con->window_rect.y + con->border_width,
+                      window_rect.x,
+                      window_rect.y,
                       con->window->id);
-    xcb_rectangle_t rectangles[4];
-    size_t rectangles_count = x_get_border_rectangles(con, rectangles);
     if (rectangles_count) {
         xcb_shape_rectangles(conn, XCB_SHAPE_SO_UNION, shape_kind,
                              XCB_CLIP_ORDERING_UNSORTED, con->frame.id,
                              0, 0, rectangles_count, rectangles);
     }
+
+    shape->applied = true;
+    shape->window_rect = window_rect;
+    shape->rectangles_count = rectangles_count;
+    memcpy(shape->rectangles, rectangles, rectangles_count * sizeof(xcb_rectangle_t));
 }
 
 /*
- * Reset the container frame shape.
+ * Reset the container frame shape (if it is shaped).
+ *
  */
 static void x_unshape_frame(Con *con, xcb_shape_sk_t shape_kind) {
     assert(con->window);
 
+    con_state *state = state_for_frame(con->frame.id);
+    frame_shape *shape = shape_for_kind(state, shape_kind);
+    if (shape == NULL || !shape->applied) {
+        return;
+    }
+
+    mask_frames();
     xcb_shape_mask(conn, XCB_SHAPE_SO_SET, shape_kind, con->frame.id, 0, 0, XCB_PIXMAP_NONE);
+    shape->applied = false;
 }
 
 /*
- * Shape or unshape container frame based on the con state.
+ * Shape or unshape container frame based on the con state. Floating frames
+ * of shaped windows are shaped, all other frames are not.
+ *
  */
-static void set_shape_state(Con *con, bool need_reshape) {
+static void set_shape_state(Con *con) {
     if (!shape_supported || con->window == NULL) {
         return;
     }
 
-    struct con_state *state;
-    if ((state = state_for_frame(con->frame.id)) == NULL) {
-        ELOG("window state for con %p not found\n", con);
-        return;
-    }
-
-    if (need_reshape && con_is_floating(con)) {
-        /* We need to reshape the window frame only if it already has shape. */
-        if (con->window->shaped) {
-            x_shape_frame(con, XCB_SHAPE_SK_BOUNDING);
-        }
-        if (con->window->input_shaped) {
-            x_shape_frame(con, XCB_SHAPE_SK_INPUT);
-        }
+    const bool floating = con_is_floating(con);
+    if (floating && con->window->shaped) {
+        x_shape_frame(con, XCB_SHAPE_SK_BOUNDING, false);
+    } else {
+        x_unshape_frame(con, XCB_SHAPE_SK_BOUNDING);
     }
-
-    if (state->was_floating && !con_is_floating(con)) {
-        /* Remove the shape when container is no longer floating. */
-        if (con->window->shaped) {
-            x_unshape_frame(con, XCB_SHAPE_SK_BOUNDING);
-        }
-        if (con->window->input_shaped) {
-            x_unshape_frame(con, XCB_SHAPE_SK_INPUT);
-        }
+    if (floating && con->window->input_shaped) {
+        x_shape_frame(con, XCB_SHAPE_SK_INPUT, false);
+    } else {
+        x_unshape_frame(con, XCB_SHAPE_SK_INPUT);
     }
 }
 
@@ -883,6 +1314,19 @@ void x_push_node(Con *con) {
 
     state = state_for_frame(con->frame.id);
 
+    if (state_is_idle(con, state)) {
+        return;
+    }
+
+    /* The frame of a container which was never visible does not exist yet
+     * (see create_deferred_frames()), so there is nothing to push for it. */
+    if (!state->created) {
+        TAILQ_FOREACH (current, &(con->focus_head), focused) {
+            x_push_node(current);
+        }
+        return;
+    }
+
     if (state->name != NULL) {
         DLOG("pushing name %s for con %p\n", state->name, con);
 
@@ -907,10 +1351,8 @@ void x_push_node(Con *con) {
             con->mapped = false;
     }
 
-    bool need_reshape = false;
-
     /* reparent the child window (when the window was moved due to a sticky
-     * container) */
+     * container, or when the container is shown for the first time) */
     if (state->need_reparent && con->window != NULL) {
         DLOG("Reparenting child window\n");
 
@@ -918,47 +1360,46 @@ void x_push_node(Con *con) {
          * UnmapNotify events (otherwise the handler would close the container).
          * These events are generated automatically when reparenting. */
         uint32_t values[] = {XCB_NONE};
-        xcb_change_window_attributes(conn, state->old_frame, XCB_CW_EVENT_MASK, values);
+        if (state->old_frame != XCB_NONE) {
+            xcb_change_window_attributes(conn, state->old_frame, XCB_CW_EVENT_MASK, values);
+        }
         xcb_change_window_attributes(conn, con->window->id, XCB_CW_EVENT_MASK, values);
 
         xcb_reparent_window(conn, con->window->id, con->frame.id, 0, 0);
 
-        values[0] = FRAME_EVENT_MASK;
-        xcb_change_window_attributes(conn, state->old_frame, XCB_CW_EVENT_MASK, values);
-        values[0] = CHILD_EVENT_MASK;
-        xcb_change_window_attributes(conn, con->window->id, XCB_CW_EVENT_MASK, values);
+        if (state->old_frame != XCB_NONE) {
+            values[0] = FRAME_EVENT_MASK;
+            xcb_change_window_attributes(conn, state->old_frame, XCB_CW_EVENT_MASK, values);
+            values[0] = CHILD_EVENT_MASK;
+            xcb_change_window_attributes(conn, con->window->id, XCB_CW_EVENT_MASK, values);
+
+            con->ignore_unmap++;
+            DLOG("ignore_unmap for reparenting of con %p (win 0x%08x) is now %d\n",
+                 con, con->window->id, con->ignore_unmap);
+        } else {
+            /* The window comes from the root window (see x_adopt_child()).
+             * EnterNotifys are enabled once it is mapped below. */
+            values[0] = CHILD_EVENT_MASK & ~XCB_EVENT_MASK_ENTER_WINDOW;
+            xcb_change_window_attributes(conn, con->window->id, XCB_CW_EVENT_MASK, values);
+        }
 
         state->old_frame = XCB_NONE;
         state->need_reparent = false;
-
-        con->ignore_unmap++;
-        DLOG("ignore_unmap for reparenting of con %p (win 0x%08x) is now %d\n",
-             con, con->window->id, con->ignore_unmap);
-
-        need_reshape = true;
+        state->child_viewable = false;
+        state->child_hidden = false;
     }
 
-    /* We need to update shape when window frame dimensions is updated. */
-    need_reshape |= state->rect.width != rect.width ||
-                    state->rect.height != rect.height ||
-                    state->window_rect.width != con->window_rect.width ||
-                    state->window_rect.height != con->window_rect.height;
-
-    /* We need to set shape when container becomes floating. */
-    need_reshape |= con_is_floating(con) && !state->was_floating;
+    /* Title bars are drawn onto the parent’s pixmap, so the pixmap of a window
+     * is only used for what is visible around it (issue #1013). */
+    bool is_pixmap_needed = frame_buffer_needed(con);
 
-    /* The pixmap of a borderless leaf container will not be used except
-     * for the titlebar in a stack or tabs (issue #1013). */
-    bool is_pixmap_needed = (con->border_style != BS_NONE ||
-                             !con_is_leaf(con) ||
-                             con->parent->layout == L_STACKED ||
-                             con->parent->layout == L_TABBED);
-
-    /* The root con and output cons will never require a pixmap. In particular for the
-     * __i3 output, this will likely not work anyway because it might be ridiculously
-     * large, causing an XCB_ALLOC error. */
-    if (con->type == CT_ROOT || con->type == CT_OUTPUT)
-        is_pixmap_needed = false;
+    /* Check if the container has an unneeded pixmap left over from
+     * previously having a border or titlebar. */
+    if (!is_pixmap_needed && con->frame_buffer.id != XCB_NONE) {
+        draw_util_surface_free(conn, &(con->frame_buffer));
+        xcb_free_pixmap(conn, con->frame_buffer.id);
+        con->frame_buffer.id = XCB_NONE;
+    }
 
     bool fake_notify = false;
     /* Set new position if rect changed (and if height > 0) or if the pixmap
@@ -972,14 +1413,6 @@ void x_push_node(Con *con) {
         bool has_rect_changed = (state->rect.x != rect.x || state->rect.y != rect.y ||
                                  state->rect.width != rect.width || state->rect.height != rect.height);
 
-        /* Check if the container has an unneeded pixmap left over from
-         * previously having a border or titlebar. */
-        if (!is_pixmap_needed && con->frame_buffer.id != XCB_NONE) {
-            draw_util_surface_free(conn, &(con->frame_buffer));
-            xcb_free_pixmap(conn, con->frame_buffer.id);
-            con->frame_buffer.id = XCB_NONE;
-        }
-
         if (is_pixmap_needed && (has_rect_changed || con->frame_buffer.id == XCB_NONE)) {
             if (con->frame_buffer.id == XCB_NONE) {
                 con->frame_buffer.id = xcb_generate_id(conn);
@@ -1027,6 +1460,7 @@ void x_push_node(Con *con) {
         }
 
         DLOG("setting rect (%d, %d, %d, %d)\n", rect.x, rect.y, rect.width, rect.height);
+        mask_frames();
         /* flush to ensure that the following commands are sent in a single
          * buffer and will be processed directly afterwards (the contents of a
          * window get lost when resizing it, therefore we want to provide it as
@@ -1047,12 +1481,13 @@ void x_push_node(Con *con) {
         !rect_equals(state->window_rect, con->window_rect)) {
         DLOG("setting window rect (%d, %d, %d, %d)\n",
              con->window_rect.x, con->window_rect.y, con->window_rect.width, con->window_rect.height);
+        mask_frames();
         xcb_set_window_rect(conn, con->window->id, con->window_rect);
         memcpy(&(state->window_rect), &(con->window_rect), sizeof(Rect));
         fake_notify = true;
     }
 
-    set_shape_state(con, need_reshape);
+    set_shape_state(con);
 
     /* Map if map state changed, also ensure that the child window
      * is changed if we are mapped and there is a new, unmapped child window.
@@ -1097,7 +1532,6 @@ void x_push_node(Con *con) {
     }
 
     state->unmap_now = (state->mapped != con->mapped) && !con->mapped;
-    state->was_floating = con_is_floating(con);
 
     if (fake_notify) {
         DLOG("Sending fake configure notify\n");
@@ -1122,13 +1556,19 @@ void x_push_node(Con *con) {
  * PointerRoot and will then be set to the new window, generating unnecessary
  * FocusIn/FocusOut events.
  *
+ * Returns whether the container is idle afterwards (see x_con_is_idle()).
+ *
  */
-static void x_push_node_unmaps(Con *con) {
+static bool x_push_node_unmaps(Con *con) {
     Con *current;
     con_state *state;
 
     state = state_for_frame(con->frame.id);
 
+    if (state_is_idle(con, state)) {
+        return true;
+    }
+
     /* map/unmap if map state changed, also ensure that the child window
      * is changed if we are mapped *and* in initial state (meaning the
      * container was empty before, but now got a child) */
@@ -1143,6 +1583,9 @@ static void x_push_node_unmaps(Con *con) {
 
         cookie = xcb_unmap_window(conn, con->frame.id);
         DLOG("unmapping container %p / %s (serial %d)\n", con, con->name, cookie.sequence);
+        /* Do not keep the title bar of hidden containers (e.g. on invisible
+         * workspaces) around, it is drawn again once they are shown. */
+        x_deco_cache_free(con);
         /* we need to increase ignore_unmap for this container (if it
          * contains a window) and for every window "under" this one which
          * contains a window */
@@ -1151,16 +1594,22 @@ static void x_push_node_unmaps(Con *con) {
             DLOG("ignore_unmap for con %p (frame 0x%08x) now %d\n", con, con->frame.id, con->ignore_unmap);
         }
         state->mapped = con->mapped;
+        state->unmap_now = false;
     }
 
+    bool idle = !con->mapped && !state->mapped;
+
     /* handle all children and floating windows of this node */
     TAILQ_FOREACH (current, &(con->nodes_head), nodes) {
-        x_push_node_unmaps(current);
+        idle &= x_push_node_unmaps(current);
     }
 
     TAILQ_FOREACH (current, &(con->floating_head), floating_windows) {
-        x_push_node_unmaps(current);
+        idle &= x_push_node_unmaps(current);
     }
+
+    state->idle = idle;
+    return idle;
 }
 
 /*
@@ -1181,6 +1630,142 @@ static bool is_con_attached(Con *con) {
     return false;
 }
 
+/*
+ * Restacks the frames so that their X11 stacking order matches state_head.
+ * X11 has the order of old_state_head until then.
+ *
+ * Since render_con() raises every container on each render, most frames keep
+ * their relative order. Only the frames which are not part of the longest
+ * sequence of frames that kept their relative order are restacked, each one
+ * directly above its new lower neighbour. That way, raising one floating
+ * window costs one ConfigureWindow request instead of one per window above
+ * its old position.
+ *
+ * Returns whether the stack changed or a new frame appeared.
+ *
+ */
+static bool x_push_stack(void) {
+    con_state *state;
+    int num_states = 0;
+    CIRCLEQ_FOREACH_REVERSE (state, &old_state_head, old_state) {
+        if (state->created) {
+            state->old_position = num_states++;
+        }
+    }
+    if (num_states == 0) {
+        return false;
+    }
+
+    /* The new stack from bottom to top */
+    con_state **stack = frame_alloc(num_states * sizeof(con_state *));
+    bool new_frames = false;
+    bool sorted = true;
+    int n = 0;
+    CIRCLEQ_FOREACH_REVERSE (state, &state_head, state) {
+        /* Frames which do not exist yet are restacked once created. */
+        if (!state->created) {
+            continue;
+        }
+        if (n > 0 && state->old_position < stack[n - 1]->old_position) {
+            sorted = false;
+        }
+        new_frames |= state->initial;
+        state->initial = false;
+        stack[n++] = state;
+    }
+    if (sorted) {
+        return new_frames;
+    }
+
+    /* Find the longest increasing subsequence of old positions: tails[k] is
+     * the index of the smallest last element of an increasing subsequence of
+     * length k + 1, preds[i] the element before i in its subsequence. */
+    int *tails = frame_alloc(n * sizeof(int));
+    int *preds = frame_alloc(n * sizeof(int));
+    int length = 0;
+    for (int i = 0; i < n; i++) {
+        int lo = 0, hi = length;
+        while (lo < hi) {
+            const int mid = (lo + hi) / 2;
+            if (stack[tails[mid]]->old_position < stack[i]->old_position) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        preds[i] = (lo > 0 ? tails[lo - 1] : -1);
+        tails[lo] = i;
+        if (lo == length) {
+            length++;
+        }
+    }
+
+    bool *keep = frame_alloc(n * sizeof(bool));
+    memset(keep, 0, n * sizeof(bool));
+    int lowest_kept = -1;
+    for (int i = tails[length - 1]; i != -1; i = preds[i]) {
+        keep[i] = true;
+        lowest_kept = i;
+    }
+
+    /* X11 correctly represents the stack if we push it from bottom to top:
+     * the lower neighbour of each frame is already in place. The frames below
+     * the lowest kept frame go directly below it, so that they end up below
+     * all other kept frames. */
+    for (int i = 0; i < n; i++) {
+        if (keep[i]) {
+            continue;
+        }
+        uint32_t values[2];
+        if (i > 0) {
+            values[0] = stack[i - 1]->id;
+            values[1] = XCB_STACK_MODE_ABOVE;
+        } else {
+            values[0] = stack[lowest_kept]->id;
+            values[1] = XCB_STACK_MODE_BELOW;
+        }
+        mask_frames();
+        xcb_configure_window(conn, stack[i]->id, XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE, values);
+    }
+    return true;
+}
+
+/*
+ * Returns true if the given rect lies entirely within the given output.
+ *
+ */
+static bool rect_on_output(Rect rect, Output *output) {
+    return (output != NULL && rect.width > 0 && rect.height > 0 &&
+            get_output_containing(rect.x, rect.y) == output &&
+            get_output_containing(rect.x + rect.width - 1, rect.y + rect.height - 1) == output);
+}
+
+/*
+ * Returns true if the pointer cannot leave the output it was last seen on
+ * without i3 receiving an event.
+ *
+ */
+static bool pointer_within_output(void) {
+    Output *output = get_output_containing(pointer.x, pointer.y);
+    if (output == NULL) {
+        return false;
+    }
+    /* Entering any managed window from the root window generates an
+     * EnterNotify. */
+    if (pointer.window == root) {
+        return true;
+    }
+
+    /* Moving the pointer inside a client window does not generate any events
+     * for i3, so the position is only good enough while the window does not
+     * span multiple outputs. */
+    Con *con = con_by_frame_id(pointer.window);
+    if (con == NULL) {
+        con = con_by_window_id(pointer.window);
+    }
+    return (con != NULL && rect_on_output(con->rect, output));
+}
+
 /*
  * Pushes all changes (state of each node, see x_push_node() and the window
  * stack) to X11.
@@ -1195,73 +1780,65 @@ static bool is_con_attached(Con *con) {
 void x_push_changes(Con *con) {
     con_state *state;
     xcb_query_pointer_cookie_t pointercookie;
-
-    /* If we need to warp later, we request the pointer position as soon as possible */
+    const uint64_t start = stats_now();
+    PROBE0(push_start);
+    stats_push_begin();
+    con_begin_layout_pass();
+
+    /* If we need to warp later, we request the pointer position as soon as
+     * possible, unless the last known position already tells us whether the
+     * pointer is on the output of the target. */
+    bool query_pointer = false;
     if (warp_to) {
-        pointercookie = xcb_query_pointer(conn, root);
+        query_pointer = !pointer.known;
+        if (!query_pointer) {
+            DLOG("Pointer at known position %d, %d, not querying it\n", pointer.x, pointer.y);
+        } else {
+            pointercookie = xcb_query_pointer(conn, root);
+        }
     }
 
     DLOG("-- PUSHING WINDOW STACK --\n");
-    /* We need to keep SubstructureRedirect around, otherwise clients can send
-     * ConfigureWindow requests and get them applied directly instead of having
-     * them become ConfigureRequests that i3 handles. */
-    uint32_t values[1] = {XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT};
-    CIRCLEQ_FOREACH_REVERSE (state, &state_head, state) {
-        if (state->mapped)
-            xcb_change_window_attributes(conn, state->id, XCB_CW_EVENT_MASK, values);
-    }
-    bool order_changed = false;
-    bool stacking_changed = false;
+    in_push = true;
+    uint32_t values[1];
 
-    /* count first, necessary to (re)allocate memory for the bottom-to-top
-     * stack afterwards */
-    int cnt = 0;
-    CIRCLEQ_FOREACH_REVERSE (state, &state_head, state) {
-        if (con_has_managed_window(state->con)) {
-            cnt++;
-        }
-    }
+    /* Warping the pointer generates EnterNotify events on whichever frame
+     * ends up below it. */
+    create_deferred_frames();
 
-    /* The bottom-to-top window stack of all windows which are managed by i3.
-     * Used for x_get_window_stack(). */
-    static xcb_window_t *client_list_windows = NULL;
-    static int client_list_count = 0;
-
-    if (cnt != client_list_count) {
-        client_list_windows = srealloc(client_list_windows, sizeof(xcb_window_t) * cnt);
-        client_list_count = cnt;
+    if (warp_to) {
+        mask_frames();
     }
 
-    xcb_window_t *walk = client_list_windows;
-
-    /* X11 correctly represents the stack if we push it from bottom to top */
-    CIRCLEQ_FOREACH_REVERSE (state, &state_head, state) {
-        if (con_has_managed_window(state->con))
-            memcpy(walk++, &(state->con->window->id), sizeof(xcb_window_t));
-
-        con_state *prev = CIRCLEQ_PREV(state, state);
-        con_state *old_prev = CIRCLEQ_PREV(state, old_state);
-        if (prev != old_prev)
-            order_changed = true;
-        if ((state->initial || order_changed) && prev != CIRCLEQ_END(&state_head)) {
-            stacking_changed = true;
-            uint32_t mask = 0;
-            mask |= XCB_CONFIG_WINDOW_SIBLING;
-            mask |= XCB_CONFIG_WINDOW_STACK_MODE;
-            uint32_t values[] = {state->id, XCB_STACK_MODE_ABOVE};
-
-            xcb_configure_window(conn, prev->id, mask, values);
-        }
-        state->initial = false;
-    }
+    const bool stacking_changed = x_push_stack();
 
     /* If we re-stacked something (or a new window appeared), we need to update
-     * the _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING hints */
+     * the _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING hints. The set of
+     * managed windows can only change together with the stack, so the lists
+     * are only rebuilt in that case. */
     if (stacking_changed) {
-        DLOG("Client list changed (%i clients)\n", cnt);
+        /* The bottom-to-top window stack of all windows which are managed by
+         * i3. */
+        static xcb_window_t *client_list_windows = NULL;
+        static int client_list_count = 0;
+        static int client_list_size = 0;
+
+        client_list_count = 0;
+        CIRCLEQ_FOREACH_REVERSE (state, &state_head, state) {
+            if (!con_has_managed_window(state->con))
+                continue;
+
+            if (client_list_count == client_list_size) {
+                client_list_size = (client_list_size == 0 ? 64 : client_list_size * 2);
+                client_list_windows = srealloc(client_list_windows, sizeof(xcb_window_t) * client_list_size);
+            }
+            client_list_windows[client_list_count++] = state->con->window->id;
+        }
+
+        DLOG("Client list changed (%i clients)\n", client_list_count);
         ewmh_update_client_list_stacking(client_list_windows, client_list_count);
 
-        walk = client_list_windows;
+        xcb_window_t *walk = client_list_windows;
 
         /* reorder by initial mapping */
         TAILQ_FOREACH (state, &initial_mapping_head, initial_mapping_order) {
@@ -1276,33 +1853,58 @@ void x_push_changes(Con *con) {
     x_push_node(con);
 
     if (warp_to) {
-        xcb_query_pointer_reply_t *pointerreply = xcb_query_pointer_reply(conn, pointercookie, NULL);
-        if (!pointerreply) {
-            ELOG("Could not query pointer position, not warping pointer\n");
-        } else {
-            int mid_x = warp_to->x + (warp_to->width / 2);
-            int mid_y = warp_to->y + (warp_to->height / 2);
-
-            Output *current = get_output_containing(pointerreply->root_x, pointerreply->root_y);
-            Output *target = get_output_containing(mid_x, mid_y);
-            if (current != target) {
-                /* Ignore MotionNotify events generated by warping */
-                xcb_change_window_attributes(conn, root, XCB_CW_EVENT_MASK, (uint32_t[]){XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT});
-                xcb_warp_pointer(conn, XCB_NONE, root, 0, 0, 0, 0, mid_x, mid_y);
-                xcb_change_window_attributes(conn, root, XCB_CW_EVENT_MASK, (uint32_t[]){ROOT_EVENT_MASK});
+        if (query_pointer) {
+            /* The pointer can be anywhere after the query, so it stays
+             * unknown until an event reports it again. */
+            xcb_query_pointer_reply_t *pointerreply = xcb_query_pointer_reply(conn, pointercookie, NULL);
+            if (!pointerreply) {
+                ELOG("Could not query pointer position, not warping pointer\n");
+                warp_to = NULL;
+            } else {
+                pointer.x = pointerreply->root_x;
+                pointer.y = pointerreply->root_y;
+                free(pointerreply);
             }
+        }
+    }
 
-            free(pointerreply);
+    if (warp_to) {
+        int mid_x = warp_to->x + (warp_to->width / 2);
+        int mid_y = warp_to->y + (warp_to->height / 2);
+
+        Output *current = get_output_containing(pointer.x, pointer.y);
+        Output *target = get_output_containing(mid_x, mid_y);
+        if (current != target) {
+            /* Ignore MotionNotify events generated by warping */
+            xcb_change_window_attributes(conn, root, XCB_CW_EVENT_MASK, (uint32_t[]){XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT});
+            xcb_warp_pointer(conn, XCB_NONE, root, 0, 0, 0, 0, mid_x, mid_y);
+            xcb_change_window_attributes(conn, root, XCB_CW_EVENT_MASK, (uint32_t[]){ROOT_EVENT_MASK});
+
+            /* The EnterNotify for the target is masked, so remember where
+             * the pointer is now. */
+            pointer.x = mid_x;
+            pointer.y = mid_y;
+            pointer.window = XCB_NONE;
+            pointer.known = rect_on_output(*warp_to, target);
         }
         warp_to = NULL;
     }
 
-    values[0] = FRAME_EVENT_MASK;
-    CIRCLEQ_FOREACH_REVERSE (state, &state_head, state) {
-        if (state->mapped)
-            xcb_change_window_attributes(conn, state->id, XCB_CW_EVENT_MASK, values);
+    /* The window below the pointer might span multiple outputs from now on. */
+    if (pointer.known && pointer.window != XCB_NONE) {
+        pointer.known = pointer_within_output();
     }
 
+    if (frames_masked) {
+        values[0] = FRAME_EVENT_MASK;
+        CIRCLEQ_FOREACH_REVERSE (state, &state_head, state) {
+            if (state->mapped)
+                xcb_change_window_attributes(conn, state->id, XCB_CW_EVENT_MASK, values);
+        }
+        frames_masked = false;
+    }
+    in_push = false;
+
     x_deco_recurse(con);
 
     xcb_window_t to_focus = focused->frame.id;
@@ -1388,7 +1990,14 @@ void x_push_changes(Con *con) {
         CIRCLEQ_INSERT_TAIL(&old_state_head, state, old_state);
     }
 
+    con_end_layout_pass();
+    stats_push_end();
     xcb_flush(conn);
+    stats_record_duration(STATS_X_PUSH_CHANGES, start);
+    PROBE1(push_done, stats_now() - start);
+
+    /* Nothing allocated from the frame arena is used after a push. */
+    frame_reset();
 }
 
 /*
@@ -1420,6 +2029,7 @@ void x_set_name(Con *con, const char *name) {
 
     FREE(state->name);
     state->name = sstrdup(name);
+    con_set_dirty(con);
 }
 
 /*
@@ -1436,6 +2046,21 @@ void update_shmlog_atom(void) {
     }
 }
 
+/*
+ * Set up the I3_TREE_SHM_PATH atom.
+ *
+ */
+void update_tree_shm_atom(void) {
+    const char *path = tree_shm_path();
+    if (path == NULL) {
+        xcb_delete_property(conn, root, A_I3_TREE_SHM_PATH);
+    } else {
+        xcb_change_property(conn, XCB_PROP_MODE_REPLACE, root,
+                            A_I3_TREE_SHM_PATH, A_UTF8_STRING, 8,
+                            strlen(path), path);
+    }
+}
+
 /*
  * Sets up i3 specific atoms (I3_SOCKET_PATH and I3_CONFIG_PATH)
  *
@@ -1463,6 +2088,28 @@ void x_set_warp_to(Rect *rect) {
         warp_to = rect;
 }
 
+/*
+ * Remembers the pointer position reported by an event for the given window
+ * (root coordinates). x_push_changes() uses it to decide whether to warp the
+ * pointer instead of querying its position.
+ *
+ */
+void x_pointer_moved(xcb_window_t window, int16_t root_x, int16_t root_y) {
+    pointer.x = root_x;
+    pointer.y = root_y;
+    pointer.window = window;
+    pointer.known = pointer_within_output();
+}
+
+/*
+ * Forgets the pointer position, e.g. while i3 does not receive the events
+ * which would report its changes. The next warp queries it again.
+ *
+ */
+void x_pointer_unknown(void) {
+    pointer.known = false;
+}
+
 /*
  * Applies the given mask to the event mask of every i3 window decoration X11
  * window. This is useful to disable EnterNotify while resizing so that focus
@@ -1472,6 +2119,9 @@ void x_set_warp_to(Rect *rect) {
 void x_mask_event_mask(uint32_t mask) {
     uint32_t values[] = {FRAME_EVENT_MASK & mask};
 
+    /* The pointer can cross windows without i3 noticing now. */
+    x_pointer_unknown();
+
     con_state *state;
     CIRCLEQ_FOREACH_REVERSE (state, &state_head, state) {
         if (state->mapped)
@@ -1503,8 +2153,10 @@ void x_set_shape(Con *con, xcb_shape_sk_t kind, bool enable) {
     }
 
     if (con_is_floating(con)) {
+        /* The client changed its shape, so the frame needs to be shaped again
+         * even if its geometry did not change. */
         if (enable) {
-            x_shape_frame(con, kind);
+            x_shape_frame(con, kind, true);
         } else {
             x_unshape_frame(con, kind);
         }
@@ -9,6 +9,8 @@
  */
 #include "all.h"
 
+#include "x_requests.h"
+
 unsigned int xcb_numlock_mask;
 
 /*
@@ -163,25 +165,52 @@ bool xcb_reply_contains_atom(xcb_get_property_reply_t *prop, xcb_atom_t atom) {
     return false;
 }
 
-/*
- * Get depth of visual specified by visualid
- *
- */
-uint16_t get_visual_depth(xcb_visualid_t visual_id) {
-    xcb_depth_iterator_t depth_iter;
+/* The visuals of the root screen by id, and the first visual of each depth.
+ * The screen's visuals never change, so the table is built on the first
+ * lookup (by manage_window() or x_con_init(), for every new window). */
+struct visual_entry {
+    uint16_t depth;
+    xcb_visualtype_t *type;
+};
 
-    depth_iter = xcb_screen_allowed_depths_iterator(root_screen);
-    for (; depth_iter.rem; xcb_depth_next(&depth_iter)) {
-        xcb_visualtype_iterator_t visual_iter;
+#define MAX_DEPTH 32
+
+static hashmap_t *visuals = NULL;
+static xcb_visualid_t visual_by_depth[MAX_DEPTH + 1];
 
-        visual_iter = xcb_depth_visuals_iterator(depth_iter.data);
+static void visuals_init(void) {
+    if (visuals != NULL) {
+        return;
+    }
+
+    visuals = hashmap_new();
+    xcb_depth_iterator_t depth_iter = xcb_screen_allowed_depths_iterator(root_screen);
+    for (; depth_iter.rem; xcb_depth_next(&depth_iter)) {
+        const uint16_t depth = depth_iter.data->depth;
+        xcb_visualtype_iterator_t visual_iter = xcb_depth_visuals_iterator(depth_iter.data);
+        if (visual_iter.rem && depth <= MAX_DEPTH && visual_by_depth[depth] == 0) {
+            visual_by_depth[depth] = visual_iter.data->visual_id;
+        }
         for (; visual_iter.rem; xcb_visualtype_next(&visual_iter)) {
-            if (visual_id == visual_iter.data->visual_id) {
-                return depth_iter.data->depth;
+            if (hashmap_lookup(visuals, visual_iter.data->visual_id) != NULL) {
+                continue;
             }
+            struct visual_entry *entry = smalloc(sizeof(struct visual_entry));
+            entry->depth = depth;
+            entry->type = visual_iter.data;
+            hashmap_insert(visuals, visual_iter.data->visual_id, entry);
         }
     }
-    return 0;
+}
+
+/*
+ * Get depth of visual specified by visualid
+ *
+ */
+uint16_t get_visual_depth(xcb_visualid_t visual_id) {
+    visuals_init();
+    struct visual_entry *entry = hashmap_lookup(visuals, visual_id);
+    return (entry != NULL ? entry->depth : 0);
 }
 
 /*
@@ -189,20 +218,9 @@ uint16_t get_visual_depth(xcb_visualid_t visual_id) {
  *
  */
 xcb_visualtype_t *get_visualtype_by_id(xcb_visualid_t visual_id) {
-    xcb_depth_iterator_t depth_iter;
-
-    depth_iter = xcb_screen_allowed_depths_iterator(root_screen);
-    for (; depth_iter.rem; xcb_depth_next(&depth_iter)) {
-        xcb_visualtype_iterator_t visual_iter;
-
-        visual_iter = xcb_depth_visuals_iterator(depth_iter.data);
-        for (; visual_iter.rem; xcb_visualtype_next(&visual_iter)) {
-            if (visual_id == visual_iter.data->visual_id) {
-                return visual_iter.data;
-            }
-        }
-    }
-    return 0;
+    visuals_init();
+    struct visual_entry *entry = hashmap_lookup(visuals, visual_id);
+    return (entry != NULL ? entry->type : NULL);
 }
 
 /*
@@ -210,21 +228,8 @@ xcb_visualtype_t *get_visualtype_by_id(xcb_visualid_t visual_id) {
  *
  */
 xcb_visualid_t get_visualid_by_depth(uint16_t depth) {
-    xcb_depth_iterator_t depth_iter;
-
-    depth_iter = xcb_screen_allowed_depths_iterator(root_screen);
-    for (; depth_iter.rem; xcb_depth_next(&depth_iter)) {
-        if (depth_iter.data->depth != depth)
-            continue;
-
-        xcb_visualtype_iterator_t visual_iter;
-
-        visual_iter = xcb_depth_visuals_iterator(depth_iter.data);
-        if (!visual_iter.rem)
-            continue;
-        return visual_iter.data->visual_id;
-    }
-    return 0;
+    visuals_init();
+    return (depth <= MAX_DEPTH ? visual_by_depth[depth] : 0);
 }
 
 /*
@@ -55,6 +55,7 @@ static void query_screens(xcb_connection_t *conn) {
                can always see the complete workspace */
             s->rect.width = min(s->rect.width, screen_info[screen].width);
             s->rect.height = min(s->rect.height, screen_info[screen].height);
+            randr_outputs_changed();
         } else {
             s = scalloc(1, sizeof(Output));
             struct output_name *output_name = scalloc(1, sizeof(struct output_name));
@@ -67,6 +68,7 @@ static void query_screens(xcb_connection_t *conn) {
             s->rect.y = screen_info[screen].y_org;
             s->rect.width = screen_info[screen].width;
             s->rect.height = screen_info[screen].height;
+            randr_outputs_changed();
             /* We always treat the screen at 0x0 as the primary screen */
             if (s->rect.x == 0 && s->rect.y == 0)
                 TAILQ_INSERT_HEAD(&outputs, s, outputs);
@@ -98,6 +100,7 @@ static void query_screens(xcb_connection_t *conn) {
 static void use_root_output(xcb_connection_t *conn) {
     Output *s = create_root_output(conn);
     s->active = true;
+    randr_outputs_changed();
     TAILQ_INSERT_TAIL(&outputs, s, outputs);
     output_init_con(s);
     init_ws_for_output(s);
@@ -72,4 +72,33 @@ $ws = get_ws($tmp);
 @nodes = @{$ws->{nodes}};
 is(@nodes, 2, 'all three windows on workspace level');
 
+################################################################################
+# Moving a window out of a split container flattens the pair it leaves behind,
+# even when the windows of that pair were not touched.
+################################################################################
+
+$tmp = fresh_workspace;
+
+$left = open_window;
+my $top = open_window;
+cmd 'split v';
+my $bottom = open_window;
+cmd 'focus up';
+cmd 'split h';
+$right = open_window;
+
+$ws = get_ws($tmp);
+@nodes = @{$ws->{nodes}};
+is(@nodes, 2, 'two nodes on workspace level');
+is($nodes[1]->{layout}, 'splitv', 'second node is splitv');
+is(@{$nodes[1]->{nodes}}, 2, 'two nodes in the splitv node');
+
+cmd '[id="' . $bottom->id . '"] move right';
+
+$ws = get_ws($tmp);
+@nodes = @{$ws->{nodes}};
+is(@nodes, 4, 'all four windows on workspace level');
+is_deeply([ map { $_->{window} } @nodes ], [ $left->id, $top->id, $right->id, $bottom->id ],
+          'windows kept their order');
+
 done_testing;
@@ -64,6 +64,7 @@ is($bar_config->{status_command}, 'i3status --foo', 'status_command correct');
 ok(!$bar_config->{verbose}, 'verbose off by default');
 ok($bar_config->{workspace_buttons}, 'workspace buttons enabled per default');
 is($bar_config->{workspace_min_width}, 0, 'workspace_min_width ok');
+is($bar_config->{status_update_interval}, 0, 'status_update_interval ok');
 ok($bar_config->{binding_mode_indicator}, 'mode indicator enabled per default');
 is($bar_config->{mode}, 'dock', 'dock mode by default');
 is($bar_config->{position}, 'bottom', 'position bottom by default');
@@ -104,6 +105,7 @@ bar {
     font Terminus
     workspace_buttons no
     workspace_min_width 30
+    status_update_interval 100 ms
     binding_mode_indicator no
     verbose yes
     socket_path /tmp/foobar
@@ -137,6 +139,7 @@ is($bar_config->{status_command}, 'i3status --bar', 'status_command correct');
 ok($bar_config->{verbose}, 'verbose on');
 ok(!$bar_config->{workspace_buttons}, 'workspace buttons disabled');
 is($bar_config->{workspace_min_width}, 30, 'workspace_min_width ok');
+is($bar_config->{status_update_interval}, 100, 'status_update_interval ok');
 ok(!$bar_config->{binding_mode_indicator}, 'mode indicator disabled');
 is($bar_config->{mode}, 'dock', 'dock mode');
 is($bar_config->{position}, 'top', 'position top');
@@ -64,7 +64,106 @@ unlike($stdout, qr#$random_nop#, 'random nop not found in shm log');
 like($stderr, qr#^$#, 'stderr empty');
 
 ################################################################################
-# 4: disable logging and verify it no longer works
+# 4: restrict debug logging to some files and verify only their messages show up
+################################################################################
+
+cmd 'debuglog filter x.c,handlers';
+
+my $filtered_nop = mktemp('nop.XXXXXX');
+cmd "nop $filtered_nop";
+
+run [ 'i3-dump-log' ],
+    '>', \$stdout,
+    '2>', \$stderr;
+
+like($stdout, qr#NOP: $filtered_nop#, 'nop message found in shm log');
+unlike($stdout, qr#COMMAND: \*nop $filtered_nop\*#, 'filtered debug message not found in shm log');
+
+cmd 'debuglog filter commands_parser.c';
+
+my $unfiltered_nop = mktemp('nop.XXXXXX');
+cmd "nop $unfiltered_nop";
+
+run [ 'i3-dump-log' ],
+    '>', \$stdout,
+    '2>', \$stderr;
+
+like($stdout, qr#COMMAND: \*nop $unfiltered_nop\*#, 'debug message of the selected file found in shm log');
+
+cmd 'debuglog filter off';
+
+################################################################################
+# 5: filter the dumped log by pattern, time and number of lines
+################################################################################
+
+my $first_nop = mktemp('nop.XXXXXX');
+my $second_nop = mktemp('nop.XXXXXX');
+cmd "nop $first_nop";
+cmd "nop $second_nop";
+
+run [ 'i3-dump-log', '-g', "NOP: ($first_nop|$second_nop)" ],
+    '>', \$stdout,
+    '2>', \$stderr;
+
+is(scalar(() = $stdout =~ /\n/g), 2, 'only matching lines dumped');
+like($stdout, qr#NOP: $first_nop#, 'first nop dumped');
+like($stdout, qr#NOP: $second_nop#, 'second nop dumped');
+
+run [ 'i3-dump-log', '-g', "NOP: ($first_nop|$second_nop)", '-n', '1' ],
+    '>', \$stdout,
+    '2>', \$stderr;
+
+unlike($stdout, qr#$first_nop#, 'older line not dumped with -n 1');
+like($stdout, qr#NOP: $second_nop#, 'last line dumped with -n 1');
+
+run [ 'i3-dump-log', '-g', "NOP: $first_nop", '-b', '0' ],
+    '>', \$stdout,
+    '2>', \$stderr;
+
+is($stdout, '', 'no lines dumped before the epoch');
+
+run [ 'i3-dump-log', '-g', "NOP: $first_nop", '-a', '-1h' ],
+    '>', \$stdout,
+    '2>', \$stderr;
+
+like($stdout, qr#NOP: $first_nop#, 'line of the last hour dumped');
+
+################################################################################
+# 6: verify the rings are merged in order and can be dumped individually
+################################################################################
+
+run [ 'i3-dump-log', '-g', "NOP: ($first_nop|$second_nop)" ],
+    '>', \$stdout,
+    '2>', \$stderr;
+
+like($stdout, qr#NOP: $first_nop.*NOP: $second_nop#s, 'lines dumped in the order they were logged');
+
+# Errors are stored in the important ring, the nop messages in the main ring.
+my $invalid = 'invalid' . mktemp('XXXXXX');
+cmd $invalid;
+
+run [ 'i3-dump-log', '-r', 'important' ],
+    '>', \$stdout,
+    '2>', \$stderr;
+
+like($stdout, qr#Your command: $invalid#, 'error found in the important ring');
+unlike($stdout, qr#NOP: $first_nop#, 'nop message not found in the important ring');
+
+run [ 'i3-dump-log', '-r', 'main,ipc' ],
+    '>', \$stdout,
+    '2>', \$stderr;
+
+like($stdout, qr#NOP: $first_nop#, 'nop message found in the main ring');
+unlike($stdout, qr#Your command: $invalid#, 'error not found in the main ring');
+
+run [ 'i3-dump-log', '-V', '-n', '0' ],
+    '>', \$stdout,
+    '2>', \$stderr;
+
+like($stdout, qr#^ring important: size = \d+#m, 'rings listed with -V');
+
+################################################################################
+# 7: disable logging and verify it no longer works
 ################################################################################
 
 cmd 'shmlog off';
@@ -105,4 +105,21 @@ my $dock_win = open_window({
 @clients = get_client_list;
 is(@clients, 0, 'Dock clients are not included in the list');
 
+# Restacking windows (e.g. by switching workspaces) does not change the
+# initial mapping order
+
+my $ws = fresh_workspace;
+my $win4 = open_window;
+my $win5 = open_window;
+fresh_workspace;
+my $win6 = open_window;
+cmd "workspace $ws";
+sync_with_i3;
+
+@clients = get_client_list;
+is(@clients, 3, 'All clients are still in the list after restacking');
+is($clients[0], $win4->{id}, 'Correct client in position one');
+is($clients[1], $win5->{id}, 'Correct client in position two');
+is($clients[2], $win6->{id}, 'Correct client in position three');
+
 done_testing;
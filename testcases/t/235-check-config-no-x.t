@@ -88,4 +88,50 @@ EOT
 is($ret, 0, "exit code == 0");
 is($out, "", 'valid config file');
 
+################################################################################
+# 5: test that keysyms are compared case-insensitively and that keycodes are
+# checked as well
+################################################################################
+
+$cfg = <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+bindsym Mod1+x nop 1
+bindsym Mod1+X nop 2
+EOT
+
+($ret, $out) = check_config($cfg);
+is($ret, 1, "exit code == 1");
+like($out, qr/ERROR: *Duplicate keybinding in config file/, 'duplicate keysyms differing in case');
+
+$cfg = <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+bindcode Mod1+38 nop 1
+bindcode Mod1+38 nop 2
+EOT
+
+($ret, $out) = check_config($cfg);
+is($ret, 1, "exit code == 1");
+like($out, qr/ERROR: *Duplicate keybinding in config file/, 'duplicate keycodes');
+
+################################################################################
+# 6: test that bindings differing in modifiers, release mode or keysym versus
+# keycode are no duplicates
+################################################################################
+
+$cfg = <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+bindsym Mod1+x nop 1
+bindsym Mod4+x nop 2
+bindsym --release Mod1+x nop 3
+bindcode Mod1+38 nop 4
+bindcode Mod1+39 nop 5
+EOT
+
+($ret, $out) = check_config($cfg);
+is($ret, 0, "exit code == 0");
+is($out, "", 'no duplicate keybindings');
+
 done_testing;
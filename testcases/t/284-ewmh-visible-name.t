@@ -65,6 +65,21 @@ is(get_visible_name($con), 'custom', 'sanity check: a visible name is set');
 cmd 'title_format %title';
 is(get_visible_name($con), undef, 'the visible name is removed again');
 
+###############################################################################
+# 3: The visible name follows changes of the placeholder values.
+###############################################################################
+
+fresh_workspace;
+$con = open_window(name => 'first title', wm_class => 'vis_class');
+cmd 'title_format "[%title] %title"';
+is(get_visible_name($con), '[first title] first title', 'placeholders are replaced');
+
+$con->name('second title');
+is(get_visible_name($con), '[second title] second title', 'the visible name follows the title');
+
+cmd 'title_format "%title%%class"';
+is(get_visible_name($con), 'second title%vis_class', 'a new format is used');
+
 ###############################################################################
 
 done_testing;
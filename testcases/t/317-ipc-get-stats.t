@@ -0,0 +1,166 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that the GET_STATS reply tracks the allocator pools, X events,
+# render latencies, deferred frames, startup phases and IPC clients.
+use i3test;
+use File::Temp qw(tempfile);
+use IO::Handle;
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+sub pool_stats {
+    my ($name) = @_;
+    my $stats = $i3->message(13, "")->recv;
+    my ($pool) = grep { $_->{name} eq $name } @{$stats->{pools}};
+    return $pool;
+}
+
+my $pool = pool_stats('con');
+ok(defined($pool), 'con pool is reported');
+cmp_ok($pool->{live}, '>', 0, 'some containers are live');
+cmp_ok($pool->{peak}, '>=', $pool->{live}, 'peak >= live');
+cmp_ok($pool->{capacity}, '>=', $pool->{live}, 'capacity >= live');
+
+my $live = $pool->{live};
+
+fresh_workspace;
+my $window = open_window;
+
+$pool = pool_stats('con');
+cmp_ok($pool->{live}, '>', $live, 'opening a window allocates containers');
+ok(defined(pool_stats('window')), 'window pool is reported');
+ok(defined(pool_stats('con_state')), 'con_state pool is reported');
+
+my $live_with_window = $pool->{live};
+$window->unmap;
+wait_for_unmap $window;
+fresh_workspace;
+
+$pool = pool_stats('con');
+cmp_ok($pool->{live}, '<', $live_with_window, 'closing the window releases its container');
+
+my $stats = $i3->message(13, "")->recv;
+ok(exists($stats->{text_width_cache}->{hits}), 'text width cache hits are reported');
+ok(exists($stats->{text_width_cache}->{misses}), 'text width cache misses are reported');
+
+cmp_ok($stats->{x_events}->{MapRequest}, '>', 0, 'MapRequest events are counted');
+ok(exists($stats->{x_event_time_us}->{MapRequest}), 'time spent handling MapRequest events is reported');
+
+my $render = $stats->{latency}->{tree_render};
+cmp_ok($render->{count}, '>', 0, 'tree_render calls are timed');
+my $in_buckets = 0;
+$in_buckets += $_->{count} for @{$render->{buckets}};
+is($in_buckets, $render->{count}, 'every tree_render call is in a bucket');
+is($render->{buckets}->[-1]->{le_us}, undef, 'last bucket is unbounded');
+ok(exists($stats->{latency}->{x_push_changes}), 'x_push_changes is timed');
+ok(exists($stats->{latency}->{run_assignments}), 'run_assignments is timed');
+
+# X requests are counted from the first GET_STATS request on.
+open_window;
+$stats = $i3->message(13, "")->recv;
+cmp_ok($stats->{x_requests}->{pushes}, '>', 0, 'pushes are counted');
+cmp_ok($stats->{x_requests}->{total}, '>', 0, 'X requests are counted');
+
+my $per_render = $stats->{x_requests}->{per_render};
+cmp_ok($stats->{x_requests}->{renders}, '>', 0, 'renders are counted');
+cmp_ok($per_render->{map_window}->{total}, '>', 0, 'map requests are counted per render');
+cmp_ok($per_render->{configure_window}->{max}, '>', 0, 'configure requests are counted per render');
+ok(exists($stats->{x_requests}->{renders_scheduled}), 'scheduled renders are counted');
+cmp_ok($stats->{x_requests}->{renders_avoided}, '<=', $stats->{x_requests}->{renders_scheduled},
+       'only scheduled renders are avoided');
+
+# Moving the focus between containers without windows does not touch
+# _NET_ACTIVE_WINDOW (it stays None) or the frames' _NET_WM_STATE.
+fresh_workspace;
+open_window;
+cmd 'split v';
+open_window;
+cmd 'focus parent';
+my $elided = $i3->message(13, "")->recv->{x_requests}->{per_render}->{elided}->{total};
+cmd 'focus parent';
+$stats = $i3->message(13, "")->recv;
+cmp_ok($stats->{x_requests}->{per_render}->{elided}->{total}, '>', $elided,
+       'unchanged focus properties are not written again');
+
+# Moving a window to a new workspace does not create the frame of the
+# workspace until it is shown.
+fresh_workspace;
+open_window;
+my $frames = $i3->message(13, "")->recv->{frames};
+cmd 'move container to workspace frames_hidden';
+$stats = $i3->message(13, "")->recv;
+cmp_ok($stats->{frames}->{deferred}, '>', $frames->{deferred}, 'frame creation is deferred');
+cmp_ok($stats->{frames}->{pending}, '>', $frames->{pending}, 'frame of the hidden workspace does not exist');
+$frames = $stats->{frames};
+cmd 'workspace frames_hidden';
+$stats = $i3->message(13, "")->recv;
+cmp_ok($stats->{frames}->{created}, '>', $frames->{created}, 'frame is created once the workspace is shown');
+cmp_ok($stats->{frames}->{pending}, '<', $frames->{pending}, 'no frame is pending for the visible workspace');
+
+# A window which is swallowed on an invisible workspace neither gets a frame
+# nor is reparented until the workspace is shown.
+sub parent_of {
+    my ($window) = @_;
+    my $cookie = $x->query_tree($window->id);
+    return $x->query_tree_reply($cookie->{sequence})->{parent};
+}
+
+my $swallow_ws = get_unused_workspace;
+my ($fh, $filename) = tempfile(UNLINK => 1);
+print $fh '{"swallows": [{"title": "^frames_swallowed$"}]}';
+$fh->flush;
+my $visible_ws = fresh_workspace;
+cmd "workspace $swallow_ws; append_layout $filename; workspace $visible_ws";
+sync_with_i3;
+
+$frames = $i3->message(13, "")->recv->{frames};
+my $swallowed = open_window(name => 'frames_swallowed', dont_map => 1);
+$swallowed->map;
+sync_with_i3;
+$stats = $i3->message(13, "")->recv;
+is($stats->{frames}->{created}, $frames->{created}, 'no frame is created for the invisible window');
+is(parent_of($swallowed), $x->get_root_window(), 'invisible window is not reparented');
+
+cmd "workspace $swallow_ws";
+sync_with_i3;
+isnt(parent_of($swallowed), $x->get_root_window(), 'window is reparented once it is shown');
+
+# The steps of a reload are timed individually.
+cmd 'reload';
+$stats = $i3->message(13, "")->recv;
+for my $step (qw(parse_file check_for_duplicate_bindings reorder_bindings translate_keysyms reload)) {
+    cmp_ok($stats->{latency}->{$step}->{count}, '>', 0, "$step is timed on reload");
+}
+
+# Every startup phase was reached and the phases follow each other.
+my @phases = @{$stats->{startup}->{phases}};
+is_deeply([ map { $_->{name} } @phases ],
+          [ qw(x_connect atoms config wm_selection xkb font tree outputs render manage_windows autostart bars) ],
+          'all startup phases are reported in order');
+my $end = 0;
+for my $phase (@phases) {
+    is($phase->{start_us}, $end, "startup phase $phase->{name} begins when the previous one ends");
+    $end = $phase->{start_us} + $phase->{duration_us};
+}
+is($stats->{startup}->{total_us}, $end, 'total startup time is the end of the last phase');
+
+my @clients = @{$stats->{ipc_clients}};
+cmp_ok(scalar @clients, '>', 0, 'IPC clients are listed');
+ok((grep { $_->{bytes_sent} > 0 } @clients), 'bytes sent to clients are counted');
+
+done_testing;
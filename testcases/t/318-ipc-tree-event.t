@@ -0,0 +1,58 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that the tree event reports structural diffs with increasing
+# generations.
+use i3test;
+
+my $ws = fresh_workspace;
+my $first = open_window;
+
+my $second;
+my @events = events_for(
+    sub { $second = open_window },
+    'tree');
+
+ok(@events > 0, 'received tree events when opening a window');
+my @changes = map { @{$_->{changes}} } @events;
+my ($add) = grep { $_->{change} eq 'add' } @changes;
+ok(defined($add), 'the new container was added');
+ok(defined($add->{node}->{window}), 'the added node is sent as a whole');
+my ($children) = grep { $_->{change} eq 'children' && $_->{id} == $add->{parent} } @changes;
+ok(defined($children), 'the parent reports its new children');
+
+my @rects = grep { $_->{change} eq 'rect' } @changes;
+ok(@rects > 0, 'the existing window was resized');
+ok(defined($rects[0]->{rect}->{width}), 'rect changes carry the new rect');
+
+for my $i (1 .. $#events) {
+    is($events[$i]->{generation}, $events[$i - 1]->{generation} + 1, 'generations are consecutive');
+}
+
+my $tree = i3(get_socket_path())->get_tree->recv;
+is($tree->{tree_generation}, $events[-1]->{generation}, 'GET_TREE reports the last generation');
+
+my $id = get_focused($ws);
+@events = events_for(
+    sub {
+        $second->unmap;
+        wait_for_unmap $second;
+    },
+    'tree');
+@changes = map { @{$_->{changes}} } @events;
+ok((grep { $_->{change} eq 'remove' && $_->{id} == $id } @changes), 'the killed container was removed');
+
+done_testing;
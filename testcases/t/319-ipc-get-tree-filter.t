@@ -0,0 +1,55 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that GET_TREE can be restricted to a subtree, criteria, a depth and
+# a list of fields, and that payloads which are no JSON are still ignored.
+use i3test;
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+my $ws = fresh_workspace;
+my $first = open_window(wm_class => 'tree-filter');
+my $second = open_window;
+my $ws_con = get_ws($ws);
+
+my $tree = $i3->get_tree({ root => $ws_con->{id}, fields => [ 'id', 'window', 'rect', 'name' ] })->recv;
+is($tree->{id}, $ws_con->{id}, 'the requested subtree is returned');
+is(scalar @{$tree->{nodes}}, 2, 'children are included');
+is_deeply([ sort keys %{$tree->{nodes}->[0]} ],
+          [ qw(floating_nodes id name nodes rect window) ],
+          'only the requested fields are serialized');
+
+$tree = $i3->get_tree({ root => $ws_con->{id}, depth => 0 })->recv;
+is(scalar @{$tree->{nodes}}, 0, 'depth 0 omits the children');
+ok($tree->{truncated}, 'the container is marked as truncated');
+ok(exists($tree->{layout}), 'all fields are serialized without a field list');
+
+my $matches = $i3->get_tree({ criteria => { class => '^tree-filter$' }, fields => [ 'window' ] })->recv;
+is(scalar @$matches, 1, 'one container matches the criteria');
+is($matches->[0]->{window}, $first->{id}, 'the matching window is returned');
+
+$tree = $i3->get_tree({ root => $ws_con->{id}, depth => 1 })->recv;
+ok(!exists($tree->{truncated}), 'the container is not marked as truncated');
+ok(!exists($tree->{nodes}->[0]->{truncated}), 'leaves are not marked as truncated');
+
+my $error = $i3->get_tree({ root => 1 })->recv;
+ok(!$error->{success}, 'an unknown root is rejected');
+
+$tree = $i3->get_tree('junk')->recv;
+is($tree->{type}, 'root', 'payloads which are no JSON are ignored');
+
+done_testing;
@@ -0,0 +1,59 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that replies are CBOR-encoded after a SET_ENCODING message.
+use i3test;
+use IO::Socket::UNIX;
+
+my $sock = IO::Socket::UNIX->new(Peer => get_socket_path());
+my $magic = "i3-ipc";
+
+sub send_message {
+    my ($type, $payload) = @_;
+    print $sock $magic . pack("LL", length($payload), $type) . $payload;
+}
+
+sub recv_message {
+    read($sock, my $header, length($magic) + 8);
+    my ($len, $type) = unpack("LL", substr($header, length($magic)));
+    read($sock, my $payload, $len);
+    return ($type, $payload);
+}
+
+send_message(14, 'cbor');
+my ($type, $reply) = recv_message;
+is($type, 14, 'received the SET_ENCODING reply');
+is($reply, '{"success":true}', 'the SET_ENCODING reply is JSON');
+
+send_message(7, '');
+($type, $reply) = recv_message;
+is($type, 7, 'received the VERSION reply');
+is(ord(substr($reply, 0, 1)), 0xbf, 'the reply is an indefinite-length CBOR map');
+is(ord(substr($reply, -1)), 0xff, 'the map is terminated');
+like($reply, qr/\x6ehuman_readable/, 'keys are CBOR text strings');
+
+send_message(14, 'bogus');
+($type, $reply) = recv_message;
+like($reply, qr/"success":false/, 'unknown encodings are rejected');
+
+send_message(14, 'json');
+recv_message;
+send_message(7, '');
+($type, $reply) = recv_message;
+like($reply, qr/^\{"major":/, 'JSON can be selected again');
+
+close $sock;
+done_testing;
@@ -0,0 +1,65 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that 'batch begin' defers rendering and IPC events until
+# 'batch commit'.
+use i3test;
+
+my $ws = fresh_workspace;
+my $window = open_window;
+my $old_rect = $window->rect;
+
+my $result = cmd 'batch begin';
+ok($result->[0]->{success}, 'batch begin succeeds');
+
+$result = cmd 'batch begin';
+ok(!$result->[0]->{success}, 'batches cannot be nested');
+
+my $other = get_unused_workspace;
+my @events = events_for(
+    sub {
+        cmd 'split h';
+        cmd 'open';
+        cmd "workspace $other";
+    },
+    'workspace');
+is(scalar @events, 0, 'workspace events are deferred during a batch');
+is($window->rect->width, $old_rect->width, 'the tree is not rendered during a batch');
+
+@events = events_for(
+    sub { cmd 'batch commit' },
+    'workspace');
+ok(scalar @events > 0, 'deferred workspace events are sent on commit');
+is($events[-1]->{change}, 'focus', 'the focus event was sent');
+is(focused_ws, $other, 'the new workspace is focused after the commit');
+
+$result = cmd 'batch commit';
+ok(!$result->[0]->{success}, 'committing without an open batch fails');
+
+# A batch is committed when its owner disconnects.
+cmd "workspace $ws";
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+$i3->command('batch begin')->recv;
+$i3->command('open')->recv;
+undef $i3;
+sync_with_i3;
+
+$result = cmd 'batch begin';
+ok($result->[0]->{success}, 'the batch of a disconnected client was committed');
+cmd 'batch commit';
+
+done_testing;
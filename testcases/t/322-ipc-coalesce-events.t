@@ -0,0 +1,67 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Tests that ipc_coalesce_events merges repeated window::title events of a
+# window and that subscribers to window_uncoalesced still get every update.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+ipc_coalesce_events window::title 500 ms
+EOT
+use Time::HiRes qw(sleep);
+
+my $window = open_window(name => 'Window 0');
+
+# Let a coalescing interval started by the initial title pass.
+sleep(0.6);
+
+my @events = events_for(
+    sub {
+	$window->name('Title 1');
+	sync_with_i3;
+	$window->name('Title 2');
+	sync_with_i3;
+	$window->name('Title 3');
+	sync_with_i3;
+    },
+    'window');
+
+my @titles = map { $_->{container}->{name} } grep { $_->{change} eq 'title' } @events;
+is_deeply(\@titles, [ 'Title 1' ], 'only the first title change was sent immediately');
+
+@events = events_for(
+    sub { sleep(0.6) },
+    'window');
+
+@titles = map { $_->{container}->{name} } grep { $_->{change} eq 'title' } @events;
+is_deeply(\@titles, [ 'Title 3' ], 'latest title sent at the end of the interval');
+
+sleep(0.6);
+
+@events = events_for(
+    sub {
+	$window->name('Title 4');
+	sync_with_i3;
+	$window->name('Title 5');
+	sync_with_i3;
+    },
+    'window_uncoalesced');
+
+@titles = map { $_->{container}->{name} } grep { $_->{change} eq 'title' } @events;
+is_deeply(\@titles, [ 'Title 4', 'Title 5' ], 'uncoalesced subscriber got every title change');
+
+done_testing;
@@ -0,0 +1,41 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Tests that the cached GET_WORKSPACES and GET_MARKS replies are invalidated
+# when workspaces or marks change.
+use i3test;
+
+my $i3 = i3(get_socket_path());
+
+my $tmp = fresh_workspace;
+my $first = $i3->get_workspaces->recv;
+my $second = $i3->get_workspaces->recv;
+is_deeply($second, $first, 'identical replies without changes in between');
+
+my $renamed = get_unused_workspace;
+cmd "rename workspace to $renamed";
+my @names = map { $_->{name} } @{$i3->get_workspaces->recv};
+ok((grep { $_ eq $renamed } @names), 'renamed workspace is listed');
+ok(!(grep { $_ eq $tmp } @names), 'old workspace name is gone');
+
+open_window;
+is_deeply($i3->get_marks->recv, [], 'no marks yet');
+cmd 'mark foo';
+is_deeply($i3->get_marks->recv, [ 'foo' ], 'mark is listed');
+cmd 'unmark foo';
+is_deeply($i3->get_marks->recv, [], 'mark is gone again');
+
+done_testing;
@@ -0,0 +1,66 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that key bindings, whose commands are parsed once when the
+# configuration is loaded, execute chained commands, criteria and reloads
+# just like commands which are parsed on every key press.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+bindsym Mod1+m mark --add first, mark --add second; mark --add third
+bindsym Mod1+k [con_mark="^first\$"] mark --add matched
+bindsym Mod1+r reload, mark --add after_reload
+EOT
+use i3test::XTEST;
+use ExtUtils::PkgConfig;
+
+SKIP: {
+    skip "libxcb-xkb too old (need >= 1.11)", 1 unless
+        ExtUtils::PkgConfig->atleast_version('xcb-xkb', '1.11');
+
+sub press_alt_with {
+    my ($keycode) = @_;
+    xtest_key_press(64); # Alt_L
+    xtest_key_press($keycode);
+    xtest_key_release($keycode);
+    xtest_key_release(64); # Alt_L
+    xtest_sync_with_i3;
+}
+
+my $i3 = i3(get_socket_path());
+fresh_workspace;
+my $window = open_window;
+
+press_alt_with(58); # m
+is_deeply([ sort @{$i3->get_marks->recv} ], [ 'first', 'second', 'third' ],
+    'chained commands of the binding were executed');
+
+my $other = open_window;
+press_alt_with(45); # k
+my @matched = grep { grep { $_ eq 'matched' } @{$_->{marks}} } @{get_ws(focused_ws)->{nodes}};
+is(scalar @matched, 1, 'one container got the mark');
+ok((grep { $_ eq 'first' } @{$matched[0]->{marks}}), 'criteria of the binding were applied');
+
+press_alt_with(27); # r
+ok((grep { $_ eq 'after_reload' } @{$i3->get_marks->recv}),
+    'binding continued after reloading the configuration');
+
+press_alt_with(58); # m
+ok((grep { $_ eq 'first' } @{$i3->get_marks->recv}), 'binding still works after reload');
+}
+
+done_testing;
@@ -0,0 +1,130 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Tests that criteria which are looked up in the container indexes (exact
+# class, instance, window type, marks, con_id and workspace) select the same
+# windows as regular expression matching and follow property changes.
+#
+use i3test;
+use X11::XCB qw(PROP_MODE_REPLACE);
+
+sub change_window_class {
+    my ($window, $class) = @_;
+    my $atomname = $x->atom(name => 'WM_CLASS');
+    my $atomtype = $x->atom(name => 'STRING');
+    $x->change_property(
+        PROP_MODE_REPLACE,
+        $window->id,
+        $atomname->id,
+        $atomtype->id,
+        8,
+        length($class) + 1,
+        $class
+    );
+    sync_with_i3;
+}
+
+sub marked {
+    my ($ws, $mark) = @_;
+    my @floating = map { @{$_->{nodes}} } @{get_ws($ws)->{floating_nodes}};
+    my @cons = grep {
+        my $con = $_;
+        grep { $_ eq $mark } @{$con->{marks}}
+    } (@{get_ws_content($ws)}, @floating);
+    return scalar @cons;
+}
+
+my $ws = fresh_workspace;
+
+my $first = open_window(wm_class => 'indexed');
+my $second = open_window(wm_class => 'indexed');
+my $other = open_window(wm_class => 'indexedfoo');
+
+###############################################################################
+# Exact class and instance criteria only select windows with that value.
+###############################################################################
+
+cmd '[class="^indexed$"] mark --add exact';
+is(marked($ws, 'exact'), 2, 'exact class matched both windows');
+
+cmd '[instance="^indexedfoo$"] mark --add instance';
+is(marked($ws, 'instance'), 1, 'exact instance matched one window');
+
+cmd '[class="indexed"] mark --add substring';
+is(marked($ws, 'substring'), 3, 'non-exact class still matches as a regex');
+
+cmd '[class="^nonexistent$"] kill';
+is_num_children($ws, 3, 'no window killed by an unknown class');
+
+###############################################################################
+# The index follows WM_CLASS changes.
+###############################################################################
+
+change_window_class($second, "renamed\0Renamed");
+
+cmd '[class="^Renamed$"] mark --add renamed';
+is(marked($ws, 'renamed'), 1, 'renamed window found by its new class');
+
+cmd '[class="^indexed$"] mark --add after_rename';
+is(marked($ws, 'after_rename'), 1, 'renamed window not found by its old class');
+
+###############################################################################
+# Like with PCRE, ^value$ also matches values with a trailing newline.
+###############################################################################
+
+my $newline = open_window(wm_class => 'newline');
+change_window_class($newline, "newline\0Newline\n");
+
+cmd '[class="^Newline$"] mark --add newline';
+is(marked($ws, 'newline'), 1, 'class with a trailing newline matched');
+
+cmd '[class="^Newline$"] kill';
+wait_for_unmap $newline;
+
+###############################################################################
+# con_mark, con_id and workspace criteria.
+###############################################################################
+
+cmd '[con_mark="^renamed$"] kill';
+wait_for_unmap $second;
+is_num_children($ws, 2, 'window killed by exact mark');
+
+my $id = get_ws_content($ws)->[0]->{id};
+cmd qq|[con_id="$id"] mark --add by_id|;
+is(marked($ws, 'by_id'), 1, 'con_id matched one window');
+
+my $other_ws = fresh_workspace;
+open_window(wm_class => 'indexed');
+
+cmd qq|[workspace="^$ws\$"] mark --add by_workspace|;
+is(marked($ws, 'by_workspace'), 2, 'both windows on the workspace matched');
+is(marked($other_ws, 'by_workspace'), 0, 'window on another workspace not matched');
+
+cmd '[workspace="__focused__"] mark --add focused_workspace';
+is(marked($other_ws, 'focused_workspace'), 1, 'window on the focused workspace matched');
+is(marked($ws, 'focused_workspace'), 0, 'windows on other workspaces not matched');
+
+###############################################################################
+# Window type criteria.
+###############################################################################
+
+open_floating_window;
+
+cmd '[window_type="utility"] mark --add utility';
+is(marked($other_ws, 'utility'), 1, 'utility window matched by its type');
+is(marked($ws, 'utility'), 0, 'normal windows not matched by type utility');
+
+done_testing;
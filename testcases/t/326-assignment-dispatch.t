@@ -0,0 +1,47 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Tests that for_window rules which are bucketed by their exact class or
+# instance still run in config order together with the other rules, and that
+# window type criteria are respected.
+#
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+for_window [class="^Dispatch\$"] mark --add first
+for_window [title="dispatch"] mark --add second
+for_window [instance="^Dispatch\$"] mark --add third
+for_window [class="^Dispatch\$" window_type="utility"] mark --add utility
+for_window [class="^Other\$"] mark --add other
+for_window [class="^Dispatch\$"] mark --add fourth
+EOT
+
+my $ws = fresh_workspace;
+
+my $window = open_window(name => 'dispatch', wm_class => 'Dispatch');
+my $con = @{get_ws_content($ws)}[0];
+
+is_deeply($con->{marks}, [ 'first', 'second', 'third', 'fourth' ],
+    'rules from all buckets ran in config order');
+
+$window = open_floating_window(name => 'dispatch', wm_class => 'Dispatch');
+$con = @{get_ws($ws)->{floating_nodes}}[0]->{nodes}->[0];
+
+is_deeply($con->{marks}, [ 'first', 'second', 'third', 'utility', 'fourth' ],
+    'window type rule ran for the utility window');
+
+done_testing;
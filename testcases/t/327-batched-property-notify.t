@@ -0,0 +1,58 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Tests that a burst of PropertyNotify events, which i3 handles together, still
+# results in the latest value of every property.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+for_window [class="Burst"] mark burst_mark
+EOT
+use X11::XCB qw(PROP_MODE_REPLACE);
+
+my $ws = fresh_workspace;
+my $window = open_window(name => 'Title 0');
+
+my @events = events_for(
+    sub {
+        my $atomname = $x->atom(name => 'WM_CLASS');
+        my $atomtype = $x->atom(name => 'STRING');
+        $window->name("Title $_") for 1 .. 5;
+        $x->change_property(
+            PROP_MODE_REPLACE,
+            $window->id,
+            $atomname->id,
+            $atomtype->id,
+            8,
+            length("burst\0Burst") + 1,
+            "burst\0Burst"
+        );
+        $window->name('Final title');
+        $x->flush;
+        sync_with_i3;
+    },
+    'window');
+
+my @titles = grep { $_->{change} eq 'title' } @events;
+ok(@titles >= 1 && @titles <= 6, 'Received at most one title event per change');
+is($titles[-1]->{container}->{name}, 'Final title', 'Last title event has the latest title');
+
+my $con = @{get_ws_content($ws)}[0];
+is($con->{name}, 'Final title', 'Window has the latest title');
+is($con->{window_properties}->{class}, 'Burst', 'Window has the latest class');
+is_deeply($con->{marks}, [ 'burst_mark' ], 'Assignments ran for the new class');
+
+done_testing;
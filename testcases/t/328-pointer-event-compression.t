@@ -0,0 +1,49 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Tests that focus follows the mouse to the final pointer position when the
+# pointer sweeps across several windows, whose EnterNotify events i3
+# compresses.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+fake-outputs 1000x1000+0+0
+EOT
+
+fresh_workspace;
+$x->root->warp_pointer(0, 500);
+sync_with_i3;
+
+my @windows = map { open_window } 1 .. 4;
+is($x->input_focus, $windows[-1]->id, 'last window focused');
+
+# Sweep from the last window to the first one without waiting for i3.
+my @events = events_for(
+    sub {
+        $x->root->warp_pointer($_, 500) for (950, 700, 450, 200, 50);
+        $x->flush;
+        sync_with_i3;
+    },
+    'window');
+
+is($x->input_focus, $windows[0]->id, 'window under the final pointer position focused');
+
+my @focus = grep { $_->{change} eq 'focus' } @events;
+cmp_ok(scalar @focus, '>=', 1, 'received a focus event');
+is($focus[-1]->{container}->{window}, $windows[0]->id, 'last focus event is for the first window');
+
+done_testing;
@@ -0,0 +1,59 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Tests that live_resize resizes tiling containers while dragging their border
+# and that releasing the button keeps the final size.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+fake-outputs 1000x1000+0+0
+default_border pixel 4
+live_resize yes
+drag_refresh_rate 1000 Hz
+EOT
+use i3test::XTEST;
+use Time::HiRes qw(sleep);
+
+my $ws = fresh_workspace;
+my $left = open_window;
+my $right = open_window;
+
+sub left_width {
+    my @nodes = @{get_ws_content($ws)};
+    return $nodes[0]->{rect}->{width};
+}
+
+is(left_width(), 500, 'containers start with equal sizes');
+
+# Press on the right border of the left window.
+xtest_button_press(1, 498, 500);
+xtest_sync_with_i3;
+
+$x->root->warp_pointer(700, 500);
+$x->flush;
+# Leave time for the next frame of the drag loop.
+sleep(0.05);
+sync_with_i3;
+
+is(left_width(), 700, 'left container resized while dragging');
+
+xtest_button_release(1, 700, 500);
+xtest_sync_with_i3;
+
+is(left_width(), 700, 'left container keeps its size after the drag');
+
+done_testing;
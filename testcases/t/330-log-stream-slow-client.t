@@ -0,0 +1,80 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that a log stream client which does not read its socket neither
+# blocks i3 nor, in lossy mode, gets disconnected. Instead, lines are dropped
+# and the client is told how many.
+#
+use i3test;
+use IO::Socket::UNIX;
+use IO::Select;
+use Time::HiRes qw(time);
+
+cmd 'shmlog on';
+cmd 'debuglog on';
+
+my $atom = $x->atom(name => 'I3_LOG_STREAM_SOCKET_PATH');
+my $cookie = $x->get_property(0, $x->get_root_window(), $atom->id, GET_PROPERTY_TYPE_ANY, 0, 256);
+my $reply = $x->get_property_reply($cookie->{sequence});
+my $path = $reply->{value};
+ok(defined($path) && length($path) > 0, 'log stream socket path is set');
+
+my $client = IO::Socket::UNIX->new(Peer => $path);
+ok(defined($client), 'connected to the log stream socket');
+$client->autoflush(1);
+print $client "lossy\n";
+sync_with_i3;
+
+################################################################################
+# 1: Flood the log while the client does not read. i3 must keep responding.
+################################################################################
+
+my $filler = 'x' x 4000;
+my $start = time();
+cmd "nop $filler" for 1 .. 600;
+my $elapsed = time() - $start;
+cmp_ok($elapsed, '<', 30, 'i3 does not block on a slow log stream client');
+
+does_i3_live;
+
+################################################################################
+# 2: Drain the socket and verify the client is told about dropped lines.
+################################################################################
+
+my $select = IO::Select->new($client);
+my $dropped = 0;
+my $tail = '';
+my $deadline = time() + 10;
+while (time() < $deadline) {
+    if (!$select->can_read(0.5)) {
+        # The note is queued in front of the next line which fits again.
+        cmd 'nop after-drop';
+        next;
+    }
+    my $n = sysread($client, my $buf, 65536);
+    last unless $n;
+    $tail .= $buf;
+    if ($tail =~ /i3: \d+ log lines dropped/) {
+        $dropped = 1;
+        last;
+    }
+    # Keep a short tail in case the note is split across two reads.
+    $tail = substr($tail, -256);
+}
+
+ok($dropped, 'dropped lines are reported');
+
+done_testing;
@@ -0,0 +1,96 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that looking up workspaces by name and number still finds the
+# right workspace after renaming and closing workspaces.
+#
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+fake-outputs 1024x768+0+0,1024x768+1024+0
+EOT
+
+################################################################################
+# Lookups by name are case-insensitive and follow renames.
+################################################################################
+
+cmd 'workspace foo';
+open_window;
+cmd 'workspace 2';
+open_window;
+
+cmd 'rename workspace foo to Bar';
+ok(!workspace_exists('foo'), 'old name is gone');
+ok(workspace_exists('Bar'), 'new name exists');
+
+cmd 'workspace bar';
+is(focused_ws, 'Bar', 'workspace found by its new name, ignoring case');
+
+cmd 'rename workspace to BAR';
+is(focused_ws, 'BAR', 'case of the name changed');
+
+cmd 'workspace 2';
+cmd 'workspace foo';
+is(focused_ws, 'foo', 'new workspace created under the old name');
+is(scalar @{get_ws_content('BAR')}, 1, 'renamed workspace kept its window');
+
+################################################################################
+# Lookups by number follow renames and find the remaining workspace when
+# several share a number.
+################################################################################
+
+cmd 'workspace 3: mail';
+open_window;
+cmd 'workspace 3';
+open_window;
+
+cmd 'workspace number 3';
+like(focused_ws, qr/^3/, 'workspace number 3 found');
+
+cmd 'rename workspace 3 to 4';
+cmd 'workspace number 3';
+is(focused_ws, '3: mail', 'remaining workspace with number 3 found');
+
+cmd 'workspace number 4';
+is(focused_ws, '4', 'renamed workspace found by its new number');
+
+################################################################################
+# Closed workspaces are no longer found.
+################################################################################
+
+cmd 'workspace number 3';
+is(focused_ws, '3: mail', 'workspace number 3 focused');
+cmd 'kill';
+sync_with_i3;
+cmd 'workspace 2';
+ok(!workspace_exists('3: mail'), 'empty workspace closed');
+
+cmd 'workspace number 3';
+is(focused_ws, '3', 'workspace number 3 created again');
+
+################################################################################
+# Workspaces moved to another output are still found.
+################################################################################
+
+cmd 'workspace 2';
+cmd 'move workspace to output right';
+cmd 'workspace foo';
+cmd 'workspace 2';
+is(focused_ws, '2', 'moved workspace found');
+is(scalar @{get_ws_content('2')}, 1, 'moved workspace kept its window');
+
+done_testing;
@@ -0,0 +1,82 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that switching workspaces, which only renders the output of the
+# newly shown workspace, keeps the other outputs intact and still picks up
+# focus changes which happened before the switch.
+#
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+fake-outputs 1024x768+0+0,1024x768+1024+0
+workspace 1 output fake-0
+workspace 2 output fake-1
+workspace 3 output fake-1
+EOT
+
+cmd 'workspace 1';
+my $A = open_window;
+my $B = open_window;
+cmd 'layout tabbed';
+
+cmd 'workspace 2';
+my $C = open_window;
+my $S = open_floating_window;
+cmd 'sticky enable';
+
+cmd 'workspace 3';
+my $D = open_window;
+sync_with_i3;
+
+ok(!$A->mapped, 'inactive tab on fake-0 is not mapped');
+ok($B->mapped, 'active tab on fake-0 is still mapped');
+ok(!$C->mapped, 'window on the previous workspace is unmapped');
+ok($D->mapped, 'window on the new workspace is mapped');
+ok($S->mapped, 'sticky window followed the switch');
+is(scalar @{get_ws('3')->{floating_nodes}}, 1, 'sticky window moved to workspace 3');
+
+cmd 'workspace 2';
+sync_with_i3;
+
+ok($B->mapped, 'active tab on fake-0 is still mapped');
+ok($C->mapped, 'window on workspace 2 is mapped again');
+ok(!$D->mapped, 'window on workspace 3 is unmapped');
+ok($S->mapped, 'sticky window is still mapped');
+
+################################################################################
+# Focus changes before the switch change the visible tab on fake-0.
+################################################################################
+
+cmd '[id="' . $A->id . '"] focus, [id="' . $C->id . '"] focus, workspace 3';
+sync_with_i3;
+
+ok($A->mapped, 'newly focused tab on fake-0 is mapped');
+ok(!$B->mapped, 'previously active tab on fake-0 is unmapped');
+ok($D->mapped, 'window on workspace 3 is mapped');
+ok(!$C->mapped, 'window on workspace 2 is unmapped');
+
+################################################################################
+# Switching to a workspace on the other output.
+################################################################################
+
+cmd 'workspace 1';
+sync_with_i3;
+
+is($x->input_focus, $A->id, 'focus moved to fake-0');
+ok($D->mapped, 'window on workspace 3 stays mapped');
+
+done_testing;
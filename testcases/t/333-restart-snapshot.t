@@ -0,0 +1,57 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that the layout is restored from the restart snapshot after an
+# in-place restart, even when the JSON layout file cannot be written.
+#
+use List::Util qw(first);
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+restart_state /proc/i3-does-not-exist/restart-state
+EOT
+
+my $tmp = fresh_workspace;
+my $first = open_window;
+my $second = open_window;
+cmd 'split v';
+my $third = open_window;
+cmd 'border pixel 1';
+cmd 'mark snapshot';
+cmd '[id="' . $first->id . '"] focus';
+
+my $old_tree = get_ws($tmp);
+
+cmd 'restart';
+does_i3_live;
+
+my $new_tree = get_ws($tmp);
+ok($new_tree, 'workspace still exists after restart');
+is(scalar @{$new_tree->{nodes}}, 2, 'workspace still has two children');
+
+my $split = $new_tree->{nodes}->[1];
+is($split->{layout}, 'splitv', 'split container was restored');
+is(scalar @{$split->{nodes}}, 2, 'split container still has two children');
+
+my $node = first { $_->{window} == $third->id } @{$split->{nodes}};
+ok($node, 'third window is still in the split container');
+is($node->{border}, 'pixel', 'border style was restored');
+is_deeply($node->{marks}, ['snapshot'], 'mark was restored');
+
+is($x->input_focus, $first->id, 'focus was restored');
+
+done_testing;
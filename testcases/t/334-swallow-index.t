@@ -0,0 +1,67 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+# Verifies that windows are swallowed by the first matching placeholder in
+# tree order, no matter which of its criteria are exact strings (and thus
+# indexed by con_for_window()).
+use i3test;
+use File::Temp qw(tempfile);
+use IO::Handle;
+
+my $ws = fresh_workspace;
+
+my ($fh, $filename) = tempfile(UNLINK => 1);
+print $fh <<'EOT';
+{
+    "layout": "splith",
+    "nodes": [
+        {
+            "name": "regex",
+            "swallows": [ { "class": "^swallow_idx" } ]
+        },
+        {
+            "name": "exact",
+            "swallows": [ { "class": "^swallow_idx_a$" } ]
+        },
+        {
+            "name": "title",
+            "swallows": [ { "title": "^swallow title$" } ]
+        }
+    ]
+}
+EOT
+$fh->flush;
+cmd "append_layout $filename";
+
+my @nodes = @{get_ws_content($ws)->[0]->{nodes}};
+is(@nodes, 3, 'three placeholders on the workspace');
+
+my $first = open_window(wm_class => 'swallow_idx_a');
+@nodes = @{get_ws_content($ws)->[0]->{nodes}};
+is($nodes[0]->{window}, $first->id, 'first window swallowed by the regex placeholder');
+is($nodes[1]->{window}, undef, 'exact placeholder still waiting');
+
+my $second = open_window(wm_class => 'swallow_idx_a');
+@nodes = @{get_ws_content($ws)->[0]->{nodes}};
+is($nodes[1]->{window}, $second->id, 'second window swallowed by the exact placeholder');
+
+my $third = open_window(name => 'swallow title', wm_class => 'other');
+@nodes = @{get_ws_content($ws)->[0]->{nodes}};
+is(@nodes, 3, 'still three nodes on the workspace');
+is($nodes[2]->{window}, $third->id, 'third window swallowed by its title');
+
+close($fh);
+
+done_testing;
@@ -0,0 +1,51 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+# Verifies that moving the pointer focuses the output below it when the
+# outputs do not form a regular grid, and that i3 keeps the focus when the
+# pointer is in a gap between the outputs.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+fake-outputs 1024x768+0+0,800x600+1024+0,1024x768+0+768
+EOT
+
+sub synced_warp_pointer {
+    my ($x_px, $y_px) = @_;
+    sync_with_i3;
+    $x->root->warp_pointer($x_px, $y_px);
+    sync_with_i3;
+}
+
+synced_warp_pointer(10, 10);
+is(focused_output, 'fake-0', 'focus on the first output');
+
+synced_warp_pointer(1500, 500);
+is(focused_output, 'fake-1', 'focus on the second output');
+
+synced_warp_pointer(1500, 700);
+is(focused_output, 'fake-1', 'focus kept in the gap below the second output');
+
+synced_warp_pointer(500, 1000);
+is(focused_output, 'fake-2', 'focus on the third output');
+
+synced_warp_pointer(1023, 767);
+is(focused_output, 'fake-0', 'focus on the first output at its corner');
+
+synced_warp_pointer(1024, 0);
+is(focused_output, 'fake-1', 'focus on the second output at its edge');
+
+done_testing;
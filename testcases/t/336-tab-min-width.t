@@ -0,0 +1,55 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+# Verifies that tabbed containers only show as many tabs as fit at
+# tab_min_width and scroll to the focused tab.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+fake-outputs 1000x500+0+0
+tab_min_width 200 px
+EOT
+
+sub deco_widths {
+    my ($ws) = @_;
+    return [ map { $_->{deco_rect}->{width} } @{get_ws_content($ws)->[0]->{nodes}} ];
+}
+
+my $ws = fresh_workspace;
+my @windows = (open_window);
+cmd 'layout tabbed';
+push @windows, open_window for 2..3;
+
+is_deeply(deco_widths($ws), [ 333, 333, 334 ], 'all tabs shown while they fit');
+
+push @windows, open_window for 4..8;
+
+is_deeply(deco_widths($ws), [ 0, 0, 0, 200, 200, 200, 200, 200 ],
+    'only the last five tabs are shown when the last one is focused');
+
+cmd '[id="' . $windows[1]->id . '"] focus';
+is_deeply(deco_widths($ws), [ 0, 200, 200, 200, 200, 200, 0, 0 ],
+    'the shown tabs scroll to the focused tab');
+
+cmd '[id="' . $windows[3]->id . '"] focus';
+is_deeply(deco_widths($ws), [ 0, 200, 200, 200, 200, 200, 0, 0 ],
+    'the shown tabs do not scroll while the focused tab is shown');
+
+cmd '[id="' . $windows[0]->id . '"] focus';
+is_deeply(deco_widths($ws), [ 200, 200, 200, 200, 200, 0, 0, 0 ],
+    'the first tabs are shown when the first tab is focused');
+
+done_testing;
@@ -0,0 +1,91 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Tests that regular expression criteria on the (interned) window class give
+# the same results for many windows sharing a class, follow WM_CLASS changes
+# and that __focused__ compares the class of the focused window.
+#
+use i3test;
+use X11::XCB qw(PROP_MODE_REPLACE);
+
+sub change_window_class {
+    my ($window, $class) = @_;
+    my $atomname = $x->atom(name => 'WM_CLASS');
+    my $atomtype = $x->atom(name => 'STRING');
+    $x->change_property(
+        PROP_MODE_REPLACE,
+        $window->id,
+        $atomname->id,
+        $atomtype->id,
+        8,
+        length($class) + 1,
+        $class
+    );
+    sync_with_i3;
+}
+
+sub marked {
+    my ($ws, $mark) = @_;
+    my @floating = map { @{$_->{nodes}} } @{get_ws($ws)->{floating_nodes}};
+    my @cons = grep {
+        my $con = $_;
+        grep { $_ eq $mark } @{$con->{marks}}
+    } (@{get_ws_content($ws)}, @floating);
+    return scalar @cons;
+}
+
+my $ws = fresh_workspace;
+
+my @shared = map { open_window(wm_class => 'shared') } 1..3;
+my $other = open_window(wm_class => 'other');
+
+###############################################################################
+# A regular expression matches all windows sharing a class, every time.
+###############################################################################
+
+cmd '[class="^sha.ed$"] mark --add first';
+is(marked($ws, 'first'), 3, 'regex matched all windows with the shared class');
+
+cmd '[class="^sha.ed$"] mark --add second';
+is(marked($ws, 'second'), 3, 'regex matched the same windows again');
+
+###############################################################################
+# Changing WM_CLASS is reflected in later matches.
+###############################################################################
+
+change_window_class($shared[0], "renamed\0Renamed");
+
+cmd '[class="^sha.ed$"] mark --add after_rename';
+is(marked($ws, 'after_rename'), 2, 'renamed window no longer matched by its old class');
+
+cmd '[class="^Ren.med$"] mark --add renamed';
+is(marked($ws, 'renamed'), 1, 'renamed window matched by its new class');
+
+change_window_class($shared[0], "shared\0shared");
+
+cmd '[class="^sha.ed$"] mark --add renamed_back';
+is(marked($ws, 'renamed_back'), 3, 'window matched again after changing its class back');
+
+###############################################################################
+# __focused__ matches the windows with the class of the focused window.
+###############################################################################
+
+cmd '[id="' . $shared[1]->id . '"] focus';
+
+cmd '[class="__focused__"] mark --add focused_class';
+is(marked($ws, 'focused_class'), 3, 'all windows with the focused class matched');
+
+done_testing;
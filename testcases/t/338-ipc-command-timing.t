@@ -0,0 +1,85 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that RUN_COMMAND replies contain the time spent on each command
+# after a SET_COMMAND_TIMING message.
+use i3test;
+use IO::Socket::UNIX;
+use JSON::XS;
+
+my $sock = IO::Socket::UNIX->new(Peer => get_socket_path());
+my $magic = "i3-ipc";
+
+sub send_message {
+    my ($type, $payload) = @_;
+    print $sock $magic . pack("LL", length($payload), $type) . $payload;
+}
+
+sub recv_message {
+    read($sock, my $header, length($magic) + 8);
+    my ($len, $type) = unpack("LL", substr($header, length($magic)));
+    read($sock, my $payload, $len);
+    return ($type, $payload);
+}
+
+sub run_command {
+    send_message(0, shift);
+    my ($type, $reply) = recv_message;
+    return decode_json($reply);
+}
+
+fresh_workspace;
+
+my $result = run_command('nop');
+ok(!exists($result->[0]->{timing}), 'no timing by default');
+
+send_message(15, 'true');
+my ($type, $reply) = recv_message;
+is($type, 15, 'received the SET_COMMAND_TIMING reply');
+is($reply, '{"success":true}', 'command timing enabled');
+
+$result = run_command('open, open; [con_mark=none] focus; nop');
+is(scalar @$result, 4, 'one result per command');
+for my $r (@$result) {
+    my $timing = $r->{timing};
+    ok(defined($timing), 'result has a timing map');
+    for my $key (qw(parse_us exec_us render_us push_us)) {
+        ok(exists($timing->{$key}) && $timing->{$key} >= 0, "timing contains $key");
+    }
+}
+ok(!$result->[2]->{success}, 'the command with criteria failed');
+is($result->[0]->{timing}->{render_us}, $result->[3]->{timing}->{render_us},
+   'the render time is shared by all commands');
+ok($result->[0]->{timing}->{push_us} <= $result->[0]->{timing}->{render_us},
+   'the push time is part of the render time');
+
+$result = run_command('nop; foobar');
+is(scalar @$result, 2, 'two results');
+ok(exists($result->[0]->{timing}), 'the parsed command has a timing map');
+ok($result->[1]->{parse_error}, 'the second command is a parse error');
+ok(!exists($result->[1]->{timing}), 'the parse error has no timing map');
+
+send_message(15, 'bogus');
+($type, $reply) = recv_message;
+like($reply, qr/"success":false/, 'invalid payloads are rejected');
+
+send_message(15, 'false');
+recv_message;
+$result = run_command('nop');
+ok(!exists($result->[0]->{timing}), 'timing can be disabled again');
+
+close $sock;
+done_testing;
@@ -0,0 +1,89 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies the GET_MEMORY reply and that its counters follow the objects.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-iso10646-1
+
+for_window [class="^memtest\$"] mark memtest
+bindsym Mod1+x nop
+EOT
+use IO::Socket::UNIX;
+use JSON::XS;
+
+my $sock = IO::Socket::UNIX->new(Peer => get_socket_path());
+my $magic = "i3-ipc";
+
+sub get_memory {
+    print $sock $magic . pack("LL", 0, 16);
+    read($sock, my $header, length($magic) + 8);
+    my ($len, $type) = unpack("LL", substr($header, length($magic)));
+    read($sock, my $payload, $len);
+    is($type, 16, 'received the MEMORY reply');
+    return decode_json($payload);
+}
+
+my $memory = get_memory;
+for my $category (qw(cons windows icons decorations ipc regexes shmlog config)) {
+    ok(exists($memory->{$category}), "reply contains $category");
+}
+cmp_ok($memory->{cons}->{count}, '>', 0, 'containers are counted');
+cmp_ok($memory->{cons}->{bytes}, '>', 0, 'containers have a size');
+cmp_ok($memory->{ipc}->{clients}, '>=', 1, 'this client is counted');
+cmp_ok($memory->{regexes}->{count}, '>=', 1, 'the for_window regex is counted');
+cmp_ok($memory->{config}->{bindings}, '>=', 1, 'bindings are counted');
+cmp_ok($memory->{config}->{assignments}, '>=', 1, 'for_window is counted');
+
+fresh_workspace;
+my $before = get_memory;
+my $window = open_window(wm_class => 'memtest');
+my $with_window = get_memory;
+is($with_window->{windows}->{count}, $before->{windows}->{count} + 1, 'the window is counted');
+cmp_ok($with_window->{windows}->{property_bytes}, '>', $before->{windows}->{property_bytes},
+       'the window class is interned');
+is($with_window->{cons}->{marks}, $before->{cons}->{marks} + 1, 'the mark is counted');
+
+$window->destroy;
+sync_with_i3;
+my $after = get_memory;
+is($after->{windows}->{count}, $before->{windows}->{count}, 'the window is gone');
+is($after->{windows}->{property_bytes}, $before->{windows}->{property_bytes},
+   'the interned properties were released');
+
+################################################################################
+# Windows which cover their whole frame don’t keep a frame pixmap.
+################################################################################
+
+fresh_workspace;
+$window = open_window;
+my $bordered = get_memory;
+is($bordered->{decorations}->{bytes},
+   $bordered->{decorations}->{frame_bytes} + $bordered->{decorations}->{title_cache_bytes},
+   'decoration bytes are split into frames and title caches');
+
+cmd 'fullscreen enable';
+my $fullscreen = get_memory;
+cmp_ok($fullscreen->{decorations}->{frame_bytes}, '<', $bordered->{decorations}->{frame_bytes},
+       'the fullscreen window has no frame pixmap');
+
+cmd 'fullscreen disable';
+my $restored = get_memory;
+is($restored->{decorations}->{frame_bytes}, $bordered->{decorations}->{frame_bytes},
+   'the frame pixmap is created again');
+
+close $sock;
+done_testing;
@@ -0,0 +1,62 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that commands started by the launcher process get the environment
+# and signal dispositions they got when i3 forked itself.
+use i3test;
+use File::Temp qw(:POSIX);
+use POSIX qw(mkfifo);
+use Time::HiRes qw(sleep);
+
+sub exec_and_read {
+    my ($command) = @_;
+    my $tmp = tmpnam();
+    mkfifo($tmp, 0600) or BAIL_OUT "Could not create FIFO in $tmp: $!";
+
+    cmd qq|exec --no-startup-id "$command >$tmp"|;
+
+    open(my $fh, '<', $tmp);
+    chomp(my $output = <$fh>);
+    close($fh);
+    unlink($tmp);
+    return $output;
+}
+
+is(exec_and_read('echo $I3SOCK'), get_socket_path(), 'I3SOCK is set');
+is(exec_and_read('echo ${LISTEN_FDS:-unset}'), 'unset', 'LISTEN_FDS is not set');
+
+# SigIgn is a hexadecimal mask, SIGPIPE is signal 13.
+my $ignored = exec_and_read('grep SigIgn /proc/self/status');
+SKIP: {
+    skip 'no /proc/self/status', 1 unless $ignored =~ /^SigIgn:\s+([0-9a-f]+)$/;
+    is(hex($1) & (1 << 12), 0, 'SIGPIPE is not ignored');
+}
+
+# Several commands in quick succession are all started.
+my $tmp = tmpnam();
+cmd qq|exec --no-startup-id "echo 1 >>$tmp"|;
+cmd qq|exec --no-startup-id "echo 2 >>$tmp"|;
+cmd qq|exec --no-startup-id "echo 3 >>$tmp"|;
+my $lines = 0;
+for (1 .. 100) {
+    $lines = (-e $tmp ? scalar(() = do { local (@ARGV) = ($tmp); <> }) : 0);
+    last if $lines == 3;
+    sleep(0.05);
+}
+is($lines, 3, 'all commands were started');
+unlink($tmp);
+
+done_testing;
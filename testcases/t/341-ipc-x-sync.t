@@ -0,0 +1,63 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that X_SYNC replies arrive in order with pipelined commands and
+# only once the X server processed the effects of the preceding commands.
+use i3test;
+use IO::Socket::UNIX;
+
+my $sock = IO::Socket::UNIX->new(Peer => get_socket_path());
+my $magic = "i3-ipc";
+
+sub send_message {
+    my ($type, $payload) = @_;
+    print $sock $magic . pack("LL", length($payload), $type) . $payload;
+}
+
+sub read_reply {
+    read($sock, my $header, length($magic) + 8);
+    my ($len, $type) = unpack("LL", substr($header, length($magic)));
+    read($sock, my $payload, $len);
+    return ($type, $payload);
+}
+
+fresh_workspace;
+my $window = open_floating_window;
+my ($before) = $window->rect;
+
+# Send all messages before reading any reply.
+my @widths = map { 200 + 10 * $_ } (1..10);
+for my $width (@widths) {
+    send_message(0, "[id=\"" . $window->id . "\"] resize set $width px 200 px");
+    send_message(17, "");
+}
+
+my @types;
+for (1..(2 * @widths)) {
+    my ($type, $payload) = read_reply;
+    push @types, $type;
+}
+is_deeply(\@types, [ (0, 17) x @widths ], 'replies arrived in the order of the messages');
+
+# X_SYNC guarantees that the X server processed the resize, so the geometry
+# which other clients see is the one i3 set.
+my ($after) = $window->rect;
+my $node = (grep { $_->{window} == $window->id } @{get_ws(focused_ws())->{floating_nodes}->[0]->{nodes}})[0];
+isnt($after->width, $before->width, 'the window was resized');
+is($after->width, $node->{window_rect}->{width}, 'the X server has the geometry of the last resize');
+
+close $sock;
+done_testing;
@@ -0,0 +1,70 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that large GET_TREE replies, which are serialized on a worker
+# thread, are complete and keep their place among the other replies.
+use i3test;
+use IO::Socket::UNIX;
+use JSON::XS;
+
+my $sock = IO::Socket::UNIX->new(Peer => get_socket_path());
+my $magic = "i3-ipc";
+
+sub send_message {
+    my ($type, $payload) = @_;
+    print $sock $magic . pack("LL", length($payload), $type) . $payload;
+}
+
+sub read_reply {
+    read($sock, my $header, length($magic) + 8);
+    my ($len, $type) = unpack("LL", substr($header, length($magic)));
+    read($sock, my $payload, $len);
+    return ($type, $payload);
+}
+
+fresh_workspace;
+my $window = open_window;
+
+# Make the tree large enough to be serialized on the worker thread.
+my @marks = map { sprintf("mark_%03d_%s", $_, 'x' x 1000) } (1..100);
+cmd "mark --add $_" for @marks;
+
+send_message(4, "");
+send_message(7, "");
+send_message(0, "nop");
+send_message(4, "");
+
+my @replies = map { [ read_reply ] } (1..4);
+is_deeply([ map { $_->[0] } @replies ], [ 4, 7, 0, 4 ], 'replies arrived in the order of the messages');
+
+my $first = decode_json($replies[0]->[1]);
+my $second = decode_json($replies[3]->[1]);
+is_deeply($first, $second, 'both trees are the same');
+
+my @nodes = ($first);
+my $con;
+while (my $node = shift @nodes) {
+    if (defined($node->{window}) && $node->{window} == $window->id) {
+        $con = $node;
+        last;
+    }
+    push @nodes, @{$node->{nodes}}, @{$node->{floating_nodes}};
+}
+ok(defined($con), 'the window is in the tree');
+is_deeply($con->{marks}, \@marks, 'all marks were serialized');
+
+close $sock;
+done_testing;
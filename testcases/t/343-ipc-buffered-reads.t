@@ -0,0 +1,71 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that i3 handles all messages which arrive in a single read, and
+# messages which are split across several writes.
+use i3test;
+use IO::Socket::UNIX;
+use JSON::XS;
+use Time::HiRes qw(sleep);
+
+my $sock = IO::Socket::UNIX->new(Peer => get_socket_path());
+$sock->autoflush(1);
+my $magic = "i3-ipc";
+
+sub message {
+    my ($type, $payload) = @_;
+    return $magic . pack("LL", length($payload), $type) . $payload;
+}
+
+sub read_reply {
+    read($sock, my $header, length($magic) + 8);
+    my ($len, $type) = unpack("LL", substr($header, length($magic)));
+    read($sock, my $payload, $len);
+    return ($type, $payload);
+}
+
+fresh_workspace;
+open_window;
+
+################################################################################
+# Many messages written at once all get a reply, in order.
+################################################################################
+
+my $count = 500;
+print $sock join('', map { message(0, "nop $_") } (1..$count));
+
+my @types = map { (read_reply)[0] } (1..$count);
+is_deeply(\@types, [ (0) x $count ], 'all messages were handled');
+
+################################################################################
+# A message split across writes is handled once it is complete.
+################################################################################
+
+my $split = message(0, 'mark split_mark') . message(1, '');
+for my $part (substr($split, 0, 3), substr($split, 3, 10), substr($split, 13)) {
+    print $sock $part;
+    sleep 0.05;
+}
+
+my ($type, $payload) = read_reply;
+is($type, 0, 'got the command reply');
+is_deeply(decode_json($payload), [ { success => JSON::XS::true } ], 'the command succeeded');
+($type, $payload) = read_reply;
+is($type, 1, 'got the workspaces reply');
+is_deeply(i3(get_socket_path())->get_marks->recv, [ 'split_mark' ], 'the split command was run');
+
+close $sock;
+done_testing;
@@ -0,0 +1,134 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that subscriptions with filters only receive the matching events.
+use i3test;
+use IO::Socket::UNIX;
+use JSON::XS;
+
+my $magic = "i3-ipc";
+
+sub send_message {
+    my ($sock, $type, $payload) = @_;
+    print $sock $magic . pack("LL", length($payload), $type) . $payload;
+}
+
+sub read_reply {
+    my ($sock) = @_;
+    read($sock, my $header, length($magic) + 8);
+    my ($len, $type) = unpack("LL", substr($header, length($magic)));
+    read($sock, my $payload, $len);
+    return ($type, decode_json($payload));
+}
+
+# Subscribes with the given filters (and to tick events), runs the code and
+# returns the window and workspace events received until the final tick.
+sub events_for {
+    my ($filters, $code) = @_;
+
+    my $sock = IO::Socket::UNIX->new(Peer => get_socket_path());
+    $sock->autoflush(1);
+    send_message($sock, 2, encode_json([ @$filters, 'tick' ]));
+    my ($type, $reply) = read_reply($sock);
+    ok($reply->{success}, 'subscribed');
+    # The first tick event
+    read_reply($sock);
+
+    $code->();
+    send_message($sock, 10, 'done');
+
+    my @events;
+    while (1) {
+        my ($type, $event) = read_reply($sock);
+        # The reply to SEND_TICK
+        next if $type == 10;
+        if ($type == (0x80000000 | 7)) {
+            last if $event->{payload} eq 'done';
+            next;
+        }
+        push @events, [ $type & 0x7f, $event->{change} ];
+    }
+    close $sock;
+    return \@events;
+}
+
+my $ws = fresh_workspace;
+my $first = open_window;
+my $first_id = get_focused($ws);
+my $second = open_window;
+my $second_id = get_focused($ws);
+
+################################################################################
+# Filter window events by change and container.
+################################################################################
+
+my $events = events_for(
+    [ { event => 'window', change => 'mark', con_id => $second_id + 0 } ],
+    sub {
+        cmd qq|[con_id="$first_id"] mark first|;
+        cmd qq|[con_id="$second_id"] mark second|;
+        cmd qq|[con_id="$first_id"] focus|;
+    });
+is_deeply($events, [ [ 3, 'mark' ] ], 'only the mark event of the second window was sent');
+
+################################################################################
+# Several filters for the same event type match any of them.
+################################################################################
+
+$events = events_for(
+    [ { event => 'window', change => [ 'focus' ] },
+      { event => 'window', change => 'mark', workspace => $ws } ],
+    sub {
+        cmd qq|[con_id="$second_id"] focus|;
+        cmd qq|[con_id="$second_id"] mark --add third|;
+    });
+is_deeply($events, [ [ 3, 'focus' ], [ 3, 'mark' ] ], 'events matching either filter were sent');
+
+################################################################################
+# Filter workspace events by workspace name.
+################################################################################
+
+my $other = get_unused_workspace;
+$events = events_for(
+    [ { event => 'workspace', change => 'focus', workspace => $other } ],
+    sub {
+        cmd "workspace $other";
+        cmd "workspace $ws";
+    });
+is_deeply($events, [ [ 0, 'focus' ] ], 'only the focus event for the other workspace was sent');
+
+################################################################################
+# Subscribing without a filter again receives all events.
+################################################################################
+
+$events = events_for(
+    [ { event => 'window', change => 'title' }, 'window' ],
+    sub {
+        cmd qq|[con_id="$first_id"] focus|;
+    });
+is_deeply($events, [ [ 3, 'focus' ] ], 'the unfiltered subscription receives all events');
+
+################################################################################
+# Invalid filters are rejected.
+################################################################################
+
+my $sock = IO::Socket::UNIX->new(Peer => get_socket_path());
+send_message($sock, 2, encode_json([ { event => 'window', class => '(' } ]));
+my (undef, $reply) = read_reply($sock);
+ok(!$reply->{success}, 'invalid regular expressions are rejected');
+close $sock;
+
+done_testing;
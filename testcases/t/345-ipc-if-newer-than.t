@@ -0,0 +1,108 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that GET_TREE, GET_WORKSPACES and GET_OUTPUTS requests with
+# if_newer_than only send the full reply if the tree changed.
+use i3test;
+use IO::Socket::UNIX;
+use JSON::XS;
+
+my $magic = "i3-ipc";
+
+sub send_message {
+    my ($sock, $type, $payload) = @_;
+    print $sock $magic . pack("LL", length($payload), $type) . $payload;
+}
+
+sub read_reply {
+    my ($sock) = @_;
+    read($sock, my $header, length($magic) + 8);
+    my ($len, $type) = unpack("LL", substr($header, length($magic)));
+    read($sock, my $payload, $len);
+    return ($type, decode_json($payload));
+}
+
+my $sock = IO::Socket::UNIX->new(Peer => get_socket_path());
+$sock->autoflush(1);
+
+sub request {
+    my ($type, $payload) = @_;
+    send_message($sock, $type, $payload);
+    my ($reply_type, $reply) = read_reply($sock);
+    is($reply_type, $type, 'reply has the type of the request');
+    return $reply;
+}
+
+my $ws = fresh_workspace;
+open_window;
+
+################################################################################
+# Unconditional requests get the usual replies.
+################################################################################
+
+is(ref(request(1, '')), 'ARRAY', 'GET_WORKSPACES reply is a list');
+is(ref(request(3, '')), 'ARRAY', 'GET_OUTPUTS reply is a list');
+is(request(4, '')->{type}, 'root', 'GET_TREE reply is the root container');
+
+################################################################################
+# The first conditional request contains the reply and its generation.
+################################################################################
+
+my $reply = request(4, encode_json({ if_newer_than => 0 }));
+ok(!$reply->{unchanged}, 'tree is newer than generation 0');
+is($reply->{reply}->{type}, 'root', 'reply contains the tree');
+my $generation = $reply->{generation};
+ok($generation > 0, 'reply contains the generation');
+
+################################################################################
+# Nothing changed, so the replies are tiny.
+################################################################################
+
+for my $type (1, 3, 4) {
+    $reply = request($type, encode_json({ if_newer_than => $generation }));
+    ok($reply->{unchanged}, "type $type: unchanged");
+    is($reply->{generation}, $generation, "type $type: same generation");
+    ok(!exists($reply->{reply}), "type $type: no reply");
+}
+
+################################################################################
+# Changing the tree bumps the generation.
+################################################################################
+
+cmd 'split v';
+open_window;
+
+$reply = request(1, encode_json({ if_newer_than => $generation }));
+ok(!$reply->{unchanged}, 'workspaces changed');
+ok($reply->{generation} > $generation, 'generation increased');
+ok((grep { $_->{name} eq $ws } @{$reply->{reply}}), 'reply contains the workspaces');
+
+$reply = request(4, encode_json({ if_newer_than => $generation, depth => 0 }));
+ok(!$reply->{unchanged}, 'tree changed');
+is($reply->{reply}->{type}, 'root', 'filters still apply');
+is(scalar @{$reply->{reply}->{nodes}}, 0, 'depth still applies');
+
+################################################################################
+# A generation from a previous i3 instance yields the full reply.
+################################################################################
+
+$reply = request(3, encode_json({ if_newer_than => $reply->{generation} + 1000 }));
+ok(!$reply->{unchanged}, 'unknown generation is not unchanged');
+is(ref($reply->{reply}), 'ARRAY', 'reply contains the outputs');
+
+close $sock;
+
+done_testing;
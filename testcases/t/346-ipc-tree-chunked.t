@@ -0,0 +1,86 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that chunked GET_TREE replies are split into messages which form
+# the usual reply, terminated by an empty message.
+use i3test;
+use IO::Socket::UNIX;
+use JSON::XS;
+
+my $sock = IO::Socket::UNIX->new(Peer => get_socket_path());
+my $magic = "i3-ipc";
+
+sub send_message {
+    my ($type, $payload) = @_;
+    print $sock $magic . pack("LL", length($payload), $type) . $payload;
+}
+
+sub read_reply {
+    read($sock, my $header, length($magic) + 8);
+    my ($len, $type) = unpack("LL", substr($header, length($magic)));
+    read($sock, my $payload, $len);
+    return ($type, $payload);
+}
+
+# Reads the messages of a chunked reply and returns their payloads.
+sub read_chunks {
+    my @chunks;
+    while (1) {
+        my ($type, $payload) = read_reply;
+        is($type, 4, 'chunk is a TREE message');
+        last if length($payload) == 0;
+        push @chunks, $payload;
+    }
+    return @chunks;
+}
+
+fresh_workspace;
+my $window = open_window;
+
+# Make the tree span several chunks.
+my @marks = map { sprintf("mark_%03d_%s", $_, 'x' x 1000) } (1..200);
+cmd "mark --add $_" for @marks;
+
+send_message(4, "");
+my (undef, $plain) = read_reply;
+
+send_message(4, encode_json({ chunked => JSON::XS::true }));
+send_message(0, "nop");
+my @chunks = read_chunks;
+ok(@chunks > 1, 'reply was split into several chunks');
+ok(!(grep { length($_) > 64 * 1024 } @chunks), 'chunks are at most 64 KiB');
+is_deeply(decode_json(join('', @chunks)), decode_json($plain), 'chunks form the usual reply');
+
+my ($type) = read_reply;
+is($type, 0, 'next reply follows the chunks');
+
+################################################################################
+# Errors and filters are chunked as well.
+################################################################################
+
+send_message(4, encode_json({ chunked => JSON::XS::true, root => 1 }));
+my $error = decode_json(join('', read_chunks));
+ok(!$error->{success}, 'error for an unknown root');
+
+send_message(4, encode_json({ chunked => JSON::XS::true, depth => 0, fields => [ 'type' ] }));
+@chunks = read_chunks;
+is(scalar @chunks, 1, 'small reply fits into one chunk');
+my $root = decode_json($chunks[0]);
+is($root->{type}, 'root', 'reply is the root container');
+is_deeply($root->{nodes}, [], 'filters still apply');
+
+close $sock;
+done_testing;
@@ -0,0 +1,97 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that the tree is published in the shared memory segment announced
+# in the I3_TREE_SHM_PATH atom and updated after rendering.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+fake-outputs 1024x768+0+0
+tree_shm_size 1048576
+EOT
+
+sub shm_path {
+    sync_with_i3;
+
+    my $cookie = $x->get_property(
+        0,
+        $x->get_root_window(),
+        $x->atom(name => 'I3_TREE_SHM_PATH')->id,
+        $x->atom(name => 'UTF8_STRING')->id,
+        0,
+        4096,
+    );
+    my $reply = $x->get_property_reply($cookie->{sequence});
+    return $reply->{value_len} == 0 ? undef : $reply->{value};
+}
+
+# Returns the header and the nodes of the segment (as hashes).
+sub read_segment {
+    my $path = shm_path;
+    open(my $fh, '<:raw', "/dev/shm$path") or die "Could not open $path: $!";
+    read($fh, my $data, -s $fh);
+    close($fh);
+
+    my %header;
+    @header{qw(version size sequence num_nodes truncated focused generation)} =
+        unpack('LLLLLLQ', $data);
+
+    my @nodes;
+    for my $i (0 .. $header{num_nodes} - 1) {
+        my %node;
+        @node{qw(id window type flags parent focus workspace output x y width height name_offset name_length)} =
+            unpack('QLLLLLLLllLLLL', substr($data, 32 + $i * 64, 64));
+        $node{name} = substr($data, $node{name_offset}, $node{name_length});
+        push @nodes, \%node;
+    }
+    return (\%header, \@nodes);
+}
+
+ok(defined(shm_path), 'I3_TREE_SHM_PATH is set');
+
+my $ws = fresh_workspace;
+my $window = open_window(name => 'shm window');
+
+my ($header, $nodes) = read_segment;
+is($header->{version}, 1, 'version is 1');
+is($header->{sequence} % 2, 0, 'segment is not being written');
+ok(!$header->{truncated}, 'tree fits');
+is($nodes->[0]->{type}, 0, 'first node is the root');
+
+my $focused = $nodes->[$header->{focused}];
+is($focused->{window}, $window->id, 'focused node is the window');
+is($focused->{name}, 'shm window', 'window title is stored');
+is($focused->{id}, get_focused($ws), 'container id matches the IPC id');
+is($nodes->[$focused->{workspace}]->{name}, $ws, 'workspace index is set');
+is($nodes->[$focused->{output}]->{type}, 1, 'output index is set');
+ok($focused->{width} > 0 && $focused->{height} > 0, 'rect is stored');
+
+my $workspace = $nodes->[$focused->{workspace}];
+is($nodes->[$workspace->{focus}]->{window}, $window->id, 'focus child is the window');
+
+################################################################################
+# The segment is updated after changes.
+################################################################################
+
+my $generation = $header->{generation};
+my $second = open_window(name => 'second window');
+
+($header, $nodes) = read_segment;
+ok($header->{generation} > $generation, 'generation increased');
+is($nodes->[$header->{focused}]->{window}, $second->id, 'new window is focused');
+
+done_testing;
@@ -0,0 +1,137 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that bindings have stable ids, which are exposed in
+# GET_BINDING_MODES and GET_CONFIG and carried by compact binding events.
+use i3test i3_autostart => 0;
+use i3test::XTEST;
+use IO::Socket::UNIX;
+use JSON::XS;
+
+my $config = <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+bindcode 39 nop s
+bindsym Mod4+a nop a
+
+mode "resize" {
+    bindcode 39 nop resize s
+}
+EOT
+
+my $pid = launch_with_config($config);
+
+my $magic = "i3-ipc";
+
+sub send_message {
+    my ($sock, $type, $payload) = @_;
+    print $sock $magic . pack("LL", length($payload), $type) . $payload;
+}
+
+sub read_reply {
+    my ($sock) = @_;
+    read($sock, my $header, length($magic) + 8);
+    my ($len, $type) = unpack("LL", substr($header, length($magic)));
+    read($sock, my $payload, $len);
+    return ($type, decode_json($payload));
+}
+
+sub connect_i3 {
+    my $sock = IO::Socket::UNIX->new(Peer => get_socket_path());
+    $sock->autoflush(1);
+    return $sock;
+}
+
+# Returns a map from "mode: command" to the binding id.
+sub binding_ids {
+    my ($modes) = @_;
+    my %ids;
+    for my $mode (@$modes) {
+        $ids{"$mode->{name}: $_->{command}"} = $_->{id} for @{$mode->{bindings}};
+    }
+    return \%ids;
+}
+
+my $sock = connect_i3;
+
+################################################################################
+# GET_BINDING_MODES without payload still lists the names.
+################################################################################
+
+send_message($sock, 8, '');
+my ($type, $reply) = read_reply($sock);
+is_deeply([ sort @$reply ], [ 'default', 'resize' ], 'mode names');
+
+send_message($sock, 8, encode_json({ bindings => JSON::XS::true }));
+($type, $reply) = read_reply($sock);
+my $ids = binding_ids($reply);
+is(scalar keys %$ids, 3, 'all bindings are listed');
+ok(!(grep { !$_ } values %$ids), 'all ids are set');
+my %unique = map { $_ => 1 } values %$ids;
+is(scalar keys %unique, 3, 'ids are unique');
+isnt($ids->{'default: nop s'}, $ids->{'resize: nop resize s'}, 'same input in another mode gets another id');
+
+send_message($sock, 9, '');
+($type, $reply) = read_reply($sock);
+is_deeply(binding_ids($reply->{binding_modes}), $ids, 'GET_CONFIG contains the same ids');
+
+################################################################################
+# The ids stay the same across reloads.
+################################################################################
+
+cmd 'reload';
+send_message($sock, 8, encode_json({ bindings => JSON::XS::true }));
+($type, $reply) = read_reply($sock);
+is_deeply(binding_ids($reply), $ids, 'ids did not change on reload');
+
+################################################################################
+# Compact binding events only carry the id.
+################################################################################
+
+my $events = connect_i3;
+send_message($events, 2, '[ "binding_compact", "tick" ]');
+($type, $reply) = read_reply($events);
+ok($reply->{success}, 'subscribed');
+# The first tick event
+read_reply($events);
+
+xtest_key_press(39);
+xtest_key_release(39);
+xtest_sync_with_i3;
+send_message($sock, 10, 'done');
+
+my @bindings;
+while (1) {
+    my ($type, $event) = read_reply($events);
+    if ($type == (0x80000000 | 7)) {
+        last if $event->{payload} eq 'done';
+        next;
+    }
+    push @bindings, $event if $type == (0x80000000 | 5);
+}
+
+is(scalar @bindings, 1, 'one binding event');
+is($bindings[0]->{change}, 'run', 'change is run');
+is($bindings[0]->{id}, $ids->{'default: nop s'}, 'event carries the binding id');
+ok(exists($bindings[0]->{time}), 'event carries the time');
+ok(!exists($bindings[0]->{binding}), 'event does not carry the binding');
+
+close $events;
+close $sock;
+exit_gracefully($pid);
+
+done_testing;
@@ -0,0 +1,85 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Tests that i3 keeps track of changes to WM_PROTOCOLS after managing a window
+# (it no longer asks for the property when killing the window).
+#
+use i3test;
+
+my $delete_window = $x->atom(name => 'WM_DELETE_WINDOW');
+my $wm_protocols = $x->atom(name => 'WM_PROTOCOLS');
+my $atom_type = $x->atom(name => 'ATOM');
+
+sub set_protocols {
+    my ($window, @protocols) = @_;
+    $x->change_property(
+        PROP_MODE_REPLACE,
+        $window->id,
+        $wm_protocols->id,
+        $atom_type->id,
+        32,
+        scalar @protocols,
+        pack('L*', map { $_->id } @protocols)
+    );
+    $x->flush;
+    sync_with_i3;
+}
+
+sub recv_delete_window {
+    my $received = 0;
+    wait_for_event 2, sub {
+        my ($event) = @_;
+        return 0 unless $event->{response_type} == 161;
+
+        my ($atom) = unpack "L", $event->{data};
+        $received = ($atom == $delete_window->id);
+        return $received;
+    };
+    return $received;
+}
+
+subtest 'WM_DELETE_WINDOW added after mapping', sub {
+    my $ws = fresh_workspace;
+    my $window = open_window;
+
+    set_protocols($window, $delete_window);
+
+    cmd '[id="' . $window->id . '"] kill';
+    ok(recv_delete_window(), 'received WM_DELETE_WINDOW');
+
+    my ($nodes) = get_ws_content($ws);
+    is(@$nodes, 1, 'window was not destroyed');
+
+    done_testing;
+};
+
+subtest 'WM_DELETE_WINDOW removed after mapping', sub {
+    my $ws = fresh_workspace;
+    my $window = open_window({ protocols => [ $delete_window ] });
+
+    set_protocols($window);
+
+    cmd '[id="' . $window->id . '"] kill';
+    wait_for_unmap $window;
+    sync_with_i3;
+
+    my ($nodes) = get_ws_content($ws);
+    is(@$nodes, 0, 'window was destroyed');
+
+    done_testing;
+};
+
+done_testing;
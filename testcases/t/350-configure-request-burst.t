@@ -0,0 +1,46 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Tests that a burst of ConfigureRequests for a floating window is applied as
+# a whole: the latest value of every member wins.
+#
+use i3test;
+
+fresh_workspace;
+
+my $window = open_floating_window(rect => [ 0, 0, 100, 100 ]);
+
+for my $width (101 .. 110) {
+    $window->rect(X11::XCB::Rect->new(x => 20, y => 30, width => $width, height => 200));
+}
+sync_with_i3;
+
+my ($absolute, $top) = $window->rect;
+is($absolute->width, 110, 'the latest width was applied');
+is($absolute->height, 200, 'the latest height was applied');
+
+# Requests which only change some members are merged.
+$x->configure_window($window->id, CONFIG_WINDOW_WIDTH, (250));
+$x->configure_window($window->id, CONFIG_WINDOW_HEIGHT, (150));
+$x->configure_window($window->id, CONFIG_WINDOW_WIDTH, (300));
+$x->flush;
+sync_with_i3;
+
+($absolute, $top) = $window->rect;
+is($absolute->width, 300, 'width of the last request');
+is($absolute->height, 150, 'height of the earlier request');
+
+done_testing;
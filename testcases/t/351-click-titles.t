@@ -0,0 +1,66 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that clicking the title bars of tabbed and stacked containers
+# focuses the right window, also after windows were closed or moved (the
+# title bars are looked up in an array which is computed when rendering).
+use i3test;
+use i3test::XTEST;
+
+# Returns the centre of the title bar of the given window (in root
+# coordinates). The workspace is the parent of all windows.
+sub title_position {
+    my ($ws, $window) = @_;
+    my $workspace = get_ws($ws);
+    my ($node) = grep { $_->{window} == $window->id } @{$workspace->{nodes}};
+    my $deco = $node->{deco_rect};
+    return ($workspace->{rect}->{x} + $deco->{x} + int($deco->{width} / 2),
+            $workspace->{rect}->{y} + $deco->{y} + int($deco->{height} / 2));
+}
+
+sub click_title {
+    my ($ws, $window) = @_;
+    my ($x, $y) = title_position($ws, $window);
+    xtest_button_press(1, $x, $y);
+    xtest_button_release(1, $x, $y);
+    xtest_sync_with_i3;
+}
+
+for my $layout (qw(tabbed stacked)) {
+    my $ws = fresh_workspace;
+    cmd "layout $layout";
+    my @windows = map { open_window } (1 .. 9);
+
+    for my $window (@windows[4, 0, 8, 3, 7]) {
+        click_title($ws, $window);
+        is($x->input_focus, $window->id, "clicking the $layout title focuses the window");
+    }
+
+    # Closing a window changes the positions of the other title bars.
+    $windows[2]->destroy;
+    splice(@windows, 2, 1);
+    sync_with_i3;
+    for my $window (@windows[2, 7]) {
+        click_title($ws, $window);
+        is($x->input_focus, $window->id, "clicking the $layout title focuses the window after closing one");
+    }
+
+    cmd '[id=' . $windows[0]->id . '] focus, move right';
+    click_title($ws, $windows[0]);
+    is($x->input_focus, $windows[0]->id, "clicking the $layout title focuses the moved window");
+}
+
+done_testing;
@@ -0,0 +1,74 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that moving many windows with one criteria command (which fixes
+# the percentages and _NET_WM_DESKTOP once, after all moves) leaves the
+# target with evenly distributed windows and updated desktops.
+use i3test;
+use List::Util qw(sum);
+use X11::XCB qw(:all);
+
+sub get_net_wm_desktop {
+    my ($window) = @_;
+    sync_with_i3;
+    my $cookie = $x->get_property(
+        0,
+        $window->{id},
+        $x->atom(name => '_NET_WM_DESKTOP')->id,
+        $x->atom(name => 'CARDINAL')->id,
+        0,
+        1
+    );
+    my $reply = $x->get_property_reply($cookie->{sequence});
+    return undef if $reply->{length} != 1;
+    return unpack("L", $reply->{value});
+}
+
+sub percentages {
+    my ($ws) = @_;
+    return map { $_->{percent} } @{get_ws($ws)->{nodes}};
+}
+
+my $target = fresh_workspace;
+my $resident = open_window;
+
+my $source = fresh_workspace;
+my @windows = map { open_window(wm_class => 'bulk') } (1 .. 20);
+my $other = open_window;
+
+cmd qq|[class="^bulk\$"] move to workspace $target|;
+
+is(@{get_ws_content($source)}, 1, 'only the other window is left behind');
+my @percentages = percentages($target);
+is(@percentages, 21, 'all windows were moved');
+ok(abs(sum(@percentages) - 1.0) < 0.0001, 'the percentages add up to 1');
+ok(abs($percentages[10] - 1.0 / 21) < 0.0001, 'the windows are distributed evenly');
+
+my $desktop = get_net_wm_desktop($resident);
+is(get_net_wm_desktop($windows[0]), $desktop, '_NET_WM_DESKTOP of the first window was updated');
+is(get_net_wm_desktop($windows[19]), $desktop, '_NET_WM_DESKTOP of the last window was updated');
+
+# Move them back next to the other window using its mark.
+cmd '[id=' . $other->id . '] mark other';
+cmd qq|[class="^bulk\$"] move to mark other|;
+
+is(@{get_ws_content($target)}, 1, 'only the resident window is left on the target');
+@percentages = percentages($source);
+is(@percentages, 21, 'all windows were moved to the mark');
+ok(abs(sum(@percentages) - 1.0) < 0.0001, 'the percentages add up to 1 again');
+is(get_net_wm_desktop($windows[5]), get_net_wm_desktop($other), '_NET_WM_DESKTOP was updated again');
+
+done_testing;
@@ -0,0 +1,45 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+#
+# Verifies that raising one floating window only restacks that window instead
+# of every window which was above it.
+use i3test;
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+sub configure_requests {
+    my $stats = $i3->message(13, "")->recv;
+    return $stats->{x_requests}->{per_render}->{configure_window}->{total};
+}
+
+fresh_workspace;
+
+my @windows = map { open_floating_window } (1 .. 10);
+sync_with_i3;
+
+my $before = configure_requests;
+cmd '[id="' . $windows[0]->id . '"] focus';
+sync_with_i3;
+my $after = configure_requests;
+
+cmp_ok($after - $before, '<=', 2, 'raising the lowest window restacks only that window');
+
+my @floating = @{get_ws(focused_ws)->{floating_nodes}};
+is($floating[-1]->{nodes}->[0]->{window}, $windows[0]->id, 'the window is on top');
+
+done_testing;
@@ -0,0 +1,109 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+#
+# Verifies that the queue limit applies the backpressure policy of clients
+# which do not read their events: by default they are disconnected, with
+# SET_BACKPRESSURE "drop" the events are discarded and a lagged event is sent
+# once the client caught up.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+ipc_queue_limit 65536
+EOT
+use IO::Socket::UNIX;
+use IO::Select;
+use JSON::XS;
+use Time::HiRes qw(time);
+
+my $magic = "i3-ipc";
+
+sub connect_client {
+    my ($policy) = @_;
+    my $sock = IO::Socket::UNIX->new(Peer => get_socket_path());
+    $sock->autoflush(1);
+    if (defined($policy)) {
+        print $sock $magic . pack("LL", length($policy), 18) . $policy;
+    }
+    my $payload = '["tick"]';
+    print $sock $magic . pack("LL", length($payload), 2) . $payload;
+    return $sock;
+}
+
+# Reads messages until one satisfies the condition (or the socket is closed)
+# and returns all messages read as [type, payload] pairs.
+sub read_until {
+    my ($sock, $cond) = @_;
+    my $select = IO::Select->new($sock);
+    my $buffer = '';
+    my @messages;
+    my $deadline = time() + 20;
+    while (time() < $deadline) {
+        next unless $select->can_read(0.5);
+        my $n = sysread($sock, my $chunk, 65536);
+        last unless $n;
+        $buffer .= $chunk;
+        while (length($buffer) >= length($magic) + 8) {
+            my ($len, $type) = unpack("LL", substr($buffer, length($magic), 8));
+            last if length($buffer) < length($magic) + 8 + $len;
+            push @messages, [ $type, substr($buffer, length($magic) + 8, $len) ];
+            $buffer = substr($buffer, length($magic) + 8 + $len);
+            return @messages if $cond->($messages[-1]);
+        }
+    }
+    return @messages;
+}
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+my $reply = $i3->message(18, 'invalid')->recv;
+ok(!$reply->{success}, 'invalid backpressure policies are rejected');
+
+my $killed = connect_client();
+my $dropping = connect_client('drop');
+
+my @replies = read_until($dropping, sub { $_[0]->[0] == 2 });
+is($replies[0]->[0], 18, 'received the SET_BACKPRESSURE reply');
+is($replies[0]->[1], '{"success":true}', 'backpressure policy selected');
+
+# Neither client reads, so the socket buffers fill up and i3 has to queue
+# the events.
+my $filler = 'x' x 1000;
+$i3->message(10, $filler)->recv for 1 .. 2000;
+does_i3_live;
+
+my $stats = $i3->message(13, "")->recv;
+my ($dropping_stats) = grep { $_->{backpressure} eq 'drop' } @{$stats->{ipc_clients}};
+cmp_ok($dropping_stats->{dropped_events}, '>', 0, 'events were dropped');
+cmp_ok($dropping_stats->{queued_bytes}, '<', 2 * 65536, 'the queue stays around the limit');
+
+# The killed client reaches EOF after its events and replies.
+my @messages = read_until($killed, sub { 0 });
+cmp_ok(scalar @messages, '<', 2000, 'the client exceeding the limit was disconnected');
+
+# The dropping client stays connected and is told that events were lost in
+# front of the next event which fit into the queue.
+$i3->message(10, 'after')->recv;
+my @events = read_until($dropping, sub { $_[0]->[1] =~ /"after"/ });
+like($events[-1]->[1], qr/"after"/, 'the dropping client still receives events');
+
+my ($lagged) = map { decode_json($_->[1]) } grep { $_->[0] == 0x8000000A } @events;
+ok(defined($lagged), 'received a lagged event');
+is($lagged->{change}, 'lagged', 'lagged event has the lagged change');
+cmp_ok($lagged->{dropped_events}, '>', 0, 'lagged event counts the dropped events');
+
+done_testing;
@@ -0,0 +1,59 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+#
+# Verifies that cleanup after closing windows is queued and run once i3 is
+# idle, see src/maintenance.c.
+use i3test;
+use Time::HiRes qw(sleep);
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+sub task_stats {
+    my ($name) = @_;
+    my $stats = $i3->message(13, "")->recv;
+    my ($task) = grep { $_->{name} eq $name } @{$stats->{maintenance}->{tasks}};
+    return ($stats, $task);
+}
+
+fresh_workspace;
+
+# Measure many distinct titles.
+my @windows = map { open_window(name => "maintenance title $_") } (1..100);
+cmd 'layout tabbed';
+sync_with_i3;
+
+my ($stats) = task_stats('text_width_cache');
+cmp_ok($stats->{text_width_cache}->{size}, '>=', 100, 'the titles were measured');
+
+$_->unmap for @windows;
+wait_for_unmap $_ for @windows;
+
+my $task;
+for (1..50) {
+    ($stats, $task) = task_stats('text_width_cache');
+    last if defined($task) && $task->{runs} > 0 && !$task->{queued};
+    sleep 0.05;
+}
+
+ok(defined($task), 'the text width cache task is reported');
+cmp_ok($task->{runs}, '>', 0, 'the task ran');
+ok(!$task->{queued}, 'the task is not queued anymore');
+cmp_ok($stats->{maintenance}->{slices}, '>', 0, 'idle slices are counted');
+cmp_ok($stats->{text_width_cache}->{size}, '<', 100, 'the text width cache was trimmed');
+
+done_testing;
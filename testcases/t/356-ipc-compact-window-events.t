@@ -0,0 +1,58 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Tests that subscribers to window_compact get window events which only carry
+# the container and window ids and the changed fields.
+use i3test;
+
+my $window = open_window(name => 'Window 0');
+my $con_id = get_focused(focused_ws);
+
+my @events = events_for(
+    sub {
+	$window->name('Title 1');
+	sync_with_i3;
+	cmd 'mark foo';
+	cmd 'fullscreen enable';
+    },
+    'window_compact');
+
+my ($title) = grep { $_->{change} eq 'title' } @events;
+ok(defined($title), 'got a title event');
+is($title->{id}, $con_id, 'title event carries the container id');
+is($title->{window}, $window->id, 'title event carries the window id');
+is($title->{name}, 'Title 1', 'title event carries the new title');
+ok(!exists($title->{container}), 'title event does not carry the container');
+ok(!exists($title->{marks}), 'title event does not carry unchanged fields');
+
+my ($mark) = grep { $_->{change} eq 'mark' } @events;
+is_deeply($mark->{marks}, [ 'foo' ], 'mark event carries the marks');
+
+my ($fullscreen) = grep { $_->{change} eq 'fullscreen_mode' } @events;
+is($fullscreen->{fullscreen_mode}, 1, 'fullscreen event carries the fullscreen mode');
+
+# Regular subscribers still get the whole container.
+@events = events_for(
+    sub {
+	$window->name('Title 2');
+	sync_with_i3;
+    },
+    'window');
+
+($title) = grep { $_->{change} eq 'title' } @events;
+is($title->{container}->{name}, 'Title 2', 'window subscribers get the container');
+
+done_testing;
@@ -0,0 +1,62 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Tests that killing a workspace closes all of its containers at once: the
+# placeholders are closed right away (rendering once), the windows are asked
+# to close.
+#
+use i3test;
+use File::Temp qw(tempfile);
+
+my $ws = fresh_workspace;
+
+my ($fh, $filename) = tempfile(UNLINK => 1);
+print $fh <<'EOT';
+{
+    "layout": "splitv",
+    "nodes": [
+        { "swallows": [ { "class": "^no-such-window$" } ] },
+        {
+            "layout": "splith",
+            "nodes": [
+                { "swallows": [ { "class": "^no-such-window$" } ] },
+                { "swallows": [ { "class": "^no-such-window$" } ] }
+            ]
+        }
+    ]
+}
+EOT
+$fh->flush;
+cmd "append_layout $filename";
+
+my $window = open_window;
+is(@{get_ws_content($ws)}, 2, 'layout and window on the workspace');
+
+my $ws_id = get_ws($ws)->{id};
+my @events = events_for(
+    sub {
+        cmd "[con_id=$ws_id] kill";
+        wait_for_unmap $window;
+    },
+    'window');
+
+is(@{get_ws_content($ws)}, 0, 'workspace is empty');
+is(scalar(grep { $_->{change} eq 'close' } @events), 1, 'received one window::close event');
+
+my $second = open_window;
+is($x->input_focus, $second->id, 'new window is focused');
+
+done_testing;
@@ -0,0 +1,103 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that clients can select a priority class with SET_PRIORITY or in
+# SUBSCRIBE, that GET_STATS reports it and that bulk clients (whose events
+# are written later) still receive all of their events.
+use i3test;
+use IO::Socket::UNIX;
+use IO::Select;
+use JSON::XS;
+use Time::HiRes qw(time);
+
+my $magic = "i3-ipc";
+
+sub send_message {
+    my ($sock, $type, $payload) = @_;
+    print $sock $magic . pack("LL", length($payload), $type) . $payload;
+}
+
+# Reads messages until one satisfies the condition (or the socket is closed)
+# and returns all messages read as [type, payload] pairs.
+sub read_until {
+    my ($sock, $cond) = @_;
+    my $select = IO::Select->new($sock);
+    my $buffer = '';
+    my @messages;
+    my $deadline = time() + 20;
+    while (time() < $deadline) {
+        next unless $select->can_read(0.5);
+        my $n = sysread($sock, my $chunk, 65536);
+        last unless $n;
+        $buffer .= $chunk;
+        while (length($buffer) >= length($magic) + 8) {
+            my ($len, $type) = unpack("LL", substr($buffer, length($magic), 8));
+            last if length($buffer) < length($magic) + 8 + $len;
+            push @messages, [ $type, substr($buffer, length($magic) + 8, $len) ];
+            $buffer = substr($buffer, length($magic) + 8 + $len);
+            return @messages if $cond->($messages[-1]);
+        }
+    }
+    return @messages;
+}
+
+sub connect_client {
+    my $sock = IO::Socket::UNIX->new(Peer => get_socket_path());
+    $sock->autoflush(1);
+    return $sock;
+}
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+my $reply = $i3->message(19, 'invalid')->recv;
+ok(!$reply->{success}, 'invalid priority classes are rejected');
+
+my $bulk = connect_client();
+send_message($bulk, 19, 'bulk');
+send_message($bulk, 2, '["tick"]');
+my @replies = read_until($bulk, sub { $_[0]->[0] == 2 });
+is($replies[0]->[0], 19, 'received the SET_PRIORITY reply');
+is($replies[0]->[1], '{"success":true}', 'priority class selected');
+
+my $interactive = connect_client();
+send_message($interactive, 2, '["tick", {"priority": "interactive"}]');
+@replies = read_until($interactive, sub { $_[0]->[0] == 2 });
+is(decode_json($replies[-1]->[1])->{success}, JSON::XS::true, 'subscribed with a priority class');
+
+my $stats = $i3->message(13, "")->recv;
+my ($bulk_stats) = grep { $_->{priority} eq 'bulk' } @{$stats->{ipc_clients}};
+ok(defined($bulk_stats), 'GET_STATS reports the bulk client');
+is($bulk_stats->{backpressure}, 'coalesce', 'bulk clients coalesce their events');
+my ($interactive_stats) = grep { $_->{priority} eq 'interactive' } @{$stats->{ipc_clients}};
+ok(defined($interactive_stats), 'GET_STATS reports the interactive client');
+
+$i3->message(10, "tick-$_")->recv for 1 .. 50;
+
+for my $client ([ $interactive, 'interactive' ], [ $bulk, 'bulk' ]) {
+    my ($sock, $name) = @$client;
+    my @ticks = grep { $_->[0] == 0x80000007 }
+        read_until($sock, sub { $_[0]->[1] =~ /"tick-50"/ });
+    # The first tick event is sent right after subscribing.
+    is(scalar @ticks, 51, "the $name client received all tick events");
+}
+
+my $invalid = connect_client();
+send_message($invalid, 2, '[{"priority": "urgent"}]');
+@replies = read_until($invalid, sub { $_[0]->[0] == 2 });
+is(decode_json($replies[-1]->[1])->{success}, JSON::XS::false, 'invalid priority classes fail the subscription');
+
+done_testing;
@@ -0,0 +1,62 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Tests that AnyEvent::I3 matches pipelined replies to their requests in
+# order and passes subscription filters on to i3.
+use i3test;
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+my $tmp = fresh_workspace;
+my $window = open_window(name => 'Before');
+
+# Several requests of the same type in flight at once
+my @cvs = map { $i3->command("mark --add pipelined-$_") } 1 .. 3;
+is(scalar(grep { $_->recv->[0]->{success} } @cvs), 3, 'all pipelined commands got their reply');
+
+my $replies = $i3->pipeline(
+    [ AnyEvent::I3::TYPE_RUN_COMMAND, 'open' ],
+    [ AnyEvent::I3::TYPE_GET_MARKS ],
+    [ AnyEvent::I3::TYPE_RUN_COMMAND, 'nop' ],
+    [ AnyEvent::I3::TYPE_GET_WORKSPACES ],
+)->recv;
+is(scalar @$replies, 4, 'got all replies of the pipeline');
+ok($replies->[0]->[0]->{success}, 'first command succeeded');
+is_deeply([ sort @{$replies->[1]} ], [ map { "pipelined-$_" } 1 .. 3 ], 'GET_MARKS reply in its place');
+ok($replies->[2]->[0]->{success}, 'second command succeeded');
+ok((grep { $_->{name} eq $tmp } @{$replies->[3]}), 'GET_WORKSPACES reply in its place');
+
+# Only the title changes match the filter.
+my @titles;
+events_for(
+    sub {
+	$window->name('After');
+	sync_with_i3;
+	cmd 'mark filtered';
+    },
+    undef,
+    {
+	window => {
+	    cb => sub { push @titles, shift },
+	    filters => [ { change => [ 'title' ] } ],
+	},
+    });
+
+is(scalar @titles, 1, 'received only the title event');
+is($titles[0]->{change}, 'title', 'the event is a title change');
+
+done_testing;
@@ -0,0 +1,72 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Verifies that the GET_STATS reply contains the latency from key presses to
+# the flush of their results, globally and per binding.
+use i3test
+    i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+bindsym Print nop latency
+EOT
+use i3test::XTEST;
+
+my $i3 = i3(get_socket_path());
+$i3->connect->recv;
+
+my $stats = $i3->message(13, "")->recv;
+is($stats->{input_latency}->{all}->{count}, 0, 'no presses measured yet');
+is_deeply($stats->{input_latency}->{bindings}, [], 'no bindings measured yet');
+
+for (1 .. 3) {
+    is(listen_for_binding(
+        sub {
+            xtest_key_press(107);
+            xtest_key_release(107);
+            xtest_sync_with_i3;
+        },
+        ),
+       'latency',
+       'triggered the "Print" keybinding');
+}
+
+# An unbound key is measured, too.
+xtest_key_press(38); # a
+xtest_key_release(38);
+xtest_sync_with_i3;
+
+$stats = $i3->message(13, "")->recv;
+my $all = $stats->{input_latency}->{all};
+is($all->{count}, 4, 'all presses measured');
+cmp_ok($all->{min_us}, '<=', $all->{p50_us}, 'median not below the minimum');
+cmp_ok($all->{p50_us}, '<=', $all->{p99_us}, 'percentiles ordered');
+cmp_ok($all->{p999_us}, '<=', $all->{max_us}, 'percentiles not above the maximum');
+my $in_buckets = 0;
+$in_buckets += $_->{count} for @{$all->{buckets}};
+is($in_buckets, $all->{count}, 'every press is in a bucket');
+
+my @bindings = @{$stats->{input_latency}->{bindings}};
+is(scalar @bindings, 1, 'one binding measured');
+is($bindings[0]->{command}, 'nop latency', 'binding command reported');
+is($bindings[0]->{input}, 'Print', 'binding symbol reported');
+is($bindings[0]->{input_type}, 'keyboard', 'binding input type reported');
+is($bindings[0]->{latency}->{count}, 3, 'binding presses measured');
+
+my $modes = $i3->message(8, '{"bindings":true}')->recv;
+is($bindings[0]->{id}, $modes->[0]->{bindings}->[0]->{id}, 'binding id matches GET_BINDING_MODES');
+
+done_testing;
@@ -59,6 +59,35 @@ open_window(wm_class => 'doesnotworkforme');
 sync_with_i3;
 is_deeply(get_marks(), [ 'none' ], 'the resource fallback was used');
 
+cmd 'kill';
+
+################################################################################
+# The resource database is kept across reloads, until RESOURCE_MANAGER changes.
+################################################################################
+
+cmd 'reload';
+open_window(wm_class => 'worksforme');
+sync_with_i3;
+is_deeply(get_marks(), [ 'works' ], 'the resource is still set after a reload');
+
+cmd 'kill';
+
+$x->change_property(
+    PROP_MODE_REPLACE,
+    $x->get_root_window(),
+    $x->atom(name => 'RESOURCE_MANAGER')->id,
+    $x->atom(name => 'STRING')->id,
+    32,
+    length('*mark: changed'),
+    '*mark: changed');
+$x->flush;
+sync_with_i3;
+
+cmd 'reload';
+open_window(wm_class => 'worksforme');
+sync_with_i3;
+is_deeply(get_marks(), [ 'changed' ], 'the changed resource is used after a reload');
+
 exit_gracefully($pid);
 
 done_testing;
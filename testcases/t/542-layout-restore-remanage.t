@@ -149,4 +149,43 @@ subtest 'regression test that window gets only swallowed once', sub {
     isnt($content[0]->{nodes}[1]->{nodes}[1]->{window}, $window->id, 'thid placeholder did not swallow window');
 };
 
+############################################################
+# Make sure the swallowed window survives the destruction of the placeholder
+############################################################
+# The placeholder window used to stay in the window ID index, so its
+# UnmapNotify/DestroyNotify unmanaged the window which replaced it.
+$ws = fresh_workspace;
+
+($fh, $filename) = tempfile(UNLINK => 1);
+print $fh <<EOT;
+{
+    "layout": "splitv",
+    "nodes": [
+        {
+            "swallows": [
+                {
+                    "title": "swallow_me"
+                }
+            ]
+        }
+    ]
+}
+EOT
+$fh->flush;
+cmd "append_layout $filename";
+
+$window = open_window(name => 'not_yet');
+change_window_title($window, "swallow_me");
+
+# Let i3 process the events of the killed placeholder.
+sync_with_i3;
+sync_with_i3;
+does_i3_live;
+
+@content = @{get_ws_content($ws)};
+is(@content, 1, 'one node on the workspace');
+is($content[0]->{nodes}[0]->{window}, $window->id, 'window still managed after the placeholder was destroyed');
+
+close($fh);
+
 done_testing;
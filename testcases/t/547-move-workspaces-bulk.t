@@ -0,0 +1,67 @@
+#!perl
+# vim:ts=4:sw=4:expandtab
+#
+# Please read the following documents before working on tests:
+# • https://build.i3wm.org/docs/testsuite.html
+#   (or docs/testsuite)
+#
+# • https://build.i3wm.org/docs/lib-i3test.html
+#   (alternatively: perldoc ./testcases/lib/i3test.pm)
+#
+# • https://build.i3wm.org/docs/ipc.html
+#   (or docs/ipc)
+#
+# • http://onyxneon.com/books/modern_perl/modern_perl_a4.pdf
+#   (unless you are already familiar with Perl)
+#
+# Tests that 'move workspace to output' with criteria matching windows on
+# several workspaces moves all of them at once: every workspace is moved once
+# (even if several of its windows match) and the focused one is shown on the
+# destination output.
+use i3test i3_config => <<EOT;
+# i3 config file (v4)
+font -misc-fixed-medium-r-normal--13-120-75-75-C-70-iso10646-1
+
+fake-outputs 1024x768+0+0,1024x768+1024+0,1024x768+0+768
+EOT
+
+sub is_ws {
+    my ($ws, $out, $msg) = @_;
+
+    local $Test::Builder::Level = $Test::Builder::Level + 1;
+    is(get_output_for_workspace($ws), "fake-$out", "Workspace $ws -> $out: $msg");
+}
+
+cmd 'focus output fake-1, workspace 2';
+open_window;
+cmd 'mark b1';
+open_window;
+cmd 'mark b2';
+cmd 'focus output fake-2, workspace 3';
+open_window;
+cmd 'mark b3';
+cmd 'focus output fake-1';
+
+is_ws(2, 1, 'sanity check');
+is_ws(3, 2, 'sanity check');
+
+my @events = events_for(
+    sub { cmd '[con_mark=b] move workspace to output fake-0' },
+    'workspace');
+
+is_ws(2, 0, 'moved with the other workspace');
+is_ws(3, 0, 'moved with the other workspace');
+
+my @moves = grep { $_->{change} eq 'move' } @events;
+is(scalar @moves, 2, 'one move event per workspace');
+is_deeply([ sort map { $_->{current}->{name} } @moves ], [ '2', '3' ],
+    'move events for both workspaces');
+
+is(focused_ws, '2', 'focused workspace is still focused');
+
+my $i3 = i3(get_socket_path());
+my @visible = grep { $_->{visible} && $_->{output} eq 'fake-0' } @{$i3->get_workspaces->recv};
+is(scalar @visible, 1, 'only one workspace is visible on the destination output');
+is($visible[0]->{name}, '2', 'the focused workspace is visible');
+
+done_testing;